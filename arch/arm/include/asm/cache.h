@@ -29,6 +29,18 @@
 #define PREFETCH_DISTANCE 3
 #endif
 
+/*
+ * memcpy() hands copies of at least this many bytes to NEON when the
+ * unit is free, below it the cost of taking the unit is not won back.
+ */
+#define NEON_COPY_MIN		1024
+
+/*
+ * Likewise for csum_partial() and csum_partial_copy_nocheck(), whose
+ * ldm/adcs loop is already close to a cycle a word.
+ */
+#define NEON_CSUM_MIN		256
+
 
 #define ARCH_DMA_MINALIGN	L1_CACHE_BYTES
 
@@ -91,8 +91,31 @@
 
 #define REV_PL310_R2P0				4
 
+/* L310 event counter sources, L2X0_EVENT_CNTx_CFG[5:2] */
+#define L2X0_EVENT_CO			0x1	/* eviction, castout */
+#define L2X0_EVENT_DRHIT		0x2	/* data read hit */
+#define L2X0_EVENT_DRREQ		0x3	/* data read lookup */
+#define L2X0_EVENT_DWHIT		0x4	/* data write hit */
+#define L2X0_EVENT_DWREQ		0x5	/* data write lookup */
+#define L2X0_EVENT_DWTREQ		0x6	/* write-through data write */
+#define L2X0_EVENT_IRHIT		0x7	/* instruction read hit */
+#define L2X0_EVENT_IRREQ		0x8	/* instruction read lookup */
+#define L2X0_EVENT_WA			0x9	/* write allocation */
+#define L2X0_EVENT_IPFALLOC		0xA	/* prefetch hint allocation */
+#define L2X0_EVENT_EPFHIT		0xB	/* prefetch hint hit */
+#define L2X0_EVENT_EPFALLOC		0xC	/* prefetch allocation */
+#define L2X0_EVENT_SRRCVD		0xD	/* speculative read received */
+#define L2X0_EVENT_SRCONF		0xE	/* speculative read confirmed */
+#define L2X0_EVENT_EPFRCVD		0xF	/* prefetch hint received */
+
 #ifndef __ASSEMBLY__
 extern void __init l2x0_init(void __iomem *base, __u32 aux_val, __u32 aux_mask);
+
+#ifdef CONFIG_CACHE_L2X0_PMU
+extern void __init l2x0_pmu_register(void __iomem *base, u32 cache_id);
+#else
+static inline void l2x0_pmu_register(void __iomem *base, u32 cache_id) { }
+#endif
 #endif
 
 #endif
@@ -7,6 +7,7 @@
 * it under the terms of the GNU General Public License version 2 as
 * published by the Free Software Foundation.
 */
+#include <linux/types.h>
 #include <asm/hwcap.h>
 #define cpu_has_neon() (!!(elf_hwcap & HWCAP_NEON))
 #ifdef __ARM_NEON__
@@ -26,5 +27,6 @@
 BUILD_BUG_ON_MSG(1, "kernel_neon_begin() called from NEON code")
 #else
 void kernel_neon_begin(void);
+bool kernel_neon_try_begin(void);
 #endif
 void kernel_neon_end(void);
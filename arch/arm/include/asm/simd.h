@@ -0,0 +1,6 @@
+#ifndef __ASM_ARM_SIMD_H
+#define __ASM_ARM_SIMD_H
+
+#include <asm-generic/simd.h>
+
+#endif
@@ -51,6 +51,8 @@ extern void __aeabi_ulcmp(void);
 
 extern void fpundefinstr(void);
 
+extern void lz4_copy_neon(void);
+
 
 EXPORT_SYMBOL(__backtrace);
 
@@ -117,6 +119,11 @@ EXPORT_SYMBOL(__put_user_8);
 	/* crypto hash */
 EXPORT_SYMBOL(sha_transform);
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+	/* lz4 */
+EXPORT_SYMBOL(lz4_copy_neon);
+#endif
+
 	/* gcc lib functions */
 EXPORT_SYMBOL(__ashldi3);
 EXPORT_SYMBOL(__ashrdi3);
@@ -580,32 +580,27 @@ static int armpmu_event_init(struct perf_event *event)
 	return err;
 }
 
+/*
+ * The core brackets every context switch and every add or del with
+ * these.  The events themselves are programmed by armpmu_start() and
+ * armpmu_stop(), so all there is to do here is to turn the whole PMU on
+ * and off, and only when something is counting: a switch between tasks
+ * that have no events leaves it alone.
+ */
 static void armpmu_enable(struct pmu *pmu)
 {
-	/* Enable all of the perf events on hardware. */
-	int idx, enabled = 0;
 	struct cpu_hw_events *cpuc = &__get_cpu_var(cpu_hw_events);
 
-	if (!armpmu)
-		return;
-
-	for (idx = 0; idx <= armpmu->num_events; ++idx) {
-		struct perf_event *event = cpuc->events[idx];
-
-		if (!event)
-			continue;
-
-		armpmu->enable(&event->hw, idx);
-		enabled = 1;
-	}
-
-	if (enabled)
+	if (armpmu && !bitmap_empty(cpuc->used_mask, ARMPMU_MAX_HWEVENTS))
 		armpmu->start();
 }
 
 static void armpmu_disable(struct pmu *pmu)
 {
-	if (armpmu)
+	struct cpu_hw_events *cpuc = &__get_cpu_var(cpu_hw_events);
+
+	/* with no counter in use, the last enable left it stopped */
+	if (armpmu && !bitmap_empty(cpuc->used_mask, ARMPMU_MAX_HWEVENTS))
 		armpmu->stop();
 }
 
@@ -0,0 +1,51 @@
+/*
+ * linux/arch/arm/lib/copy-neon.c
+ *
+ * Large memcpy() and copy_page() through NEON
+ *
+ * memcpy() of NEON_COPY_MIN bytes or more and every copy_page() come
+ * here, and go through the NEON loop whenever kernel_neon_try_begin()
+ * can take the unit, falling back to the ldm/stm code otherwise.  The
+ * "enable" parameter turns it off, to compare the two.
+ *
+ * copy_{to,from}_user() are left alone: a fault taken with the unit
+ * held would run with preemption disabled and fail instead of sleeping.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/kernel.h>
+#include <linux/linkage.h>
+#include <linux/moduleparam.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+void *__memcpy_arm(void *dest, const void *src, size_t n);
+void __copy_page_arm(void *to, const void *from);
+asmlinkage void __memcpy_neon(void *dest, const void *src, size_t n);
+
+static bool enable = true;
+module_param(enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Use NEON for large memcpy() and copy_page()");
+
+notrace void *__memcpy_large(void *dest, const void *src, size_t n)
+{
+	if (!enable || !kernel_neon_try_begin())
+		return __memcpy_arm(dest, src, n);
+
+	__memcpy_neon(dest, src, n);
+	kernel_neon_end();
+	return dest;
+}
+
+notrace void __copy_page_large(void *to, const void *from)
+{
+	if (!enable || !kernel_neon_try_begin()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	__memcpy_neon(to, from, PAGE_SIZE);
+	kernel_neon_end();
+}
@@ -0,0 +1,178 @@
+/*
+ * linux/arch/arm/lib/csum-neon.c
+ *
+ * Large csum_partial() and csum_partial_copy_nocheck() through NEON
+ *
+ * Buffers of NEON_CSUM_MIN bytes or more come here, and are summed by
+ * the NEON loop whenever kernel_neon_try_begin() can take the unit,
+ * falling back to the adcs code otherwise.  That leaves out whatever
+ * runs in softirq context, most of the receive path, but not the copy
+ * and checksum of data sent from process context, nor the ones done
+ * when a socket read verifies what it copies out.
+ *
+ * The NEON code is only used once it has been checked against the adcs
+ * code at boot: a wrong checksum silently drops packets, which is much
+ * harder to track down than a failed self-test.  The "enable" parameter
+ * turns it off, to compare the two.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/linkage.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <asm/checksum.h>
+#include <asm/neon.h>
+
+/* what the vpadal loop can take without a lane overflowing */
+#define CSUM_NEON_MAX		(512 << 10)
+
+__wsum __csum_partial_arm(const void *buf, int len, __wsum sum);
+__wsum __csum_partial_copy_arm(const void *src, void *dst, int len,
+			       __wsum sum);
+asmlinkage u64 __csum_neon(const void *buf, int len);
+asmlinkage u64 __csum_copy_neon(const void *src, void *dst, int len);
+
+static bool enable = true;
+module_param(enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Use NEON for large checksums");
+
+static bool csum_neon_ok;
+
+static inline bool csum_neon_begin(int len)
+{
+	return csum_neon_ok && enable && len < CSUM_NEON_MAX &&
+	       kernel_neon_try_begin();
+}
+
+/*
+ * Add the bytes the NEON loop left over to @s, pairing them as the loop
+ * did since it stopped on an even offset, and fold it all to 32 bits.
+ */
+static __wsum csum_tail(u64 s, const u8 *p, int len, __wsum sum)
+{
+	for (; len > 1; len -= 2, p += 2)
+		s += p[0] | p[1] << 8;
+	if (len)
+		s += p[0];
+	s += (__force u32)sum;
+
+	s = (s & 0xffffffff) + (s >> 32);
+	s = (s & 0xffffffff) + (s >> 32);
+	return (__force __wsum)(u32)s;
+}
+
+notrace __wsum __csum_partial_large(const void *buf, int len, __wsum sum)
+{
+	int n = len & ~15;
+	u64 s;
+
+	if (!csum_neon_begin(len))
+		return __csum_partial_arm(buf, len, sum);
+
+	s = __csum_neon(buf, n);
+	kernel_neon_end();
+
+	return csum_tail(s, buf + n, len - n, sum);
+}
+
+notrace __wsum __csum_partial_copy_large(const void *src, void *dst, int len,
+					 __wsum sum)
+{
+	int n = len & ~15;
+	u64 s;
+
+	if (!csum_neon_begin(len))
+		return __csum_partial_copy_arm(src, dst, len, sum);
+
+	s = __csum_copy_neon(src, dst, n);
+	kernel_neon_end();
+
+	memcpy(dst + n, src + n, len - n);
+	return csum_tail(s, dst + n, len - n, sum);
+}
+
+#define CSUM_TEST_LEN		2048
+#define CSUM_BENCH_LEN		1500
+#define CSUM_BENCH_LOOPS	2000
+
+static unsigned int __init csum_speed(const void *buf, bool neon)
+{
+	ktime_t start;
+	u64 ns;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < CSUM_BENCH_LOOPS; i++) {
+		if (neon)
+			__csum_partial_large(buf, CSUM_BENCH_LEN, 0);
+		else
+			__csum_partial_arm(buf, CSUM_BENCH_LEN, 0);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	/* bytes per ns * 1000 is MB/s */
+	return ns ? div64_u64((u64)CSUM_BENCH_LEN * CSUM_BENCH_LOOPS * 1000,
+			      ns) : 0;
+}
+
+static int __init csum_neon_init(void)
+{
+	unsigned int arm, neon;
+	u8 *buf, *dst, *ref;
+	int len, off, ret = 0;
+	__wsum sum;
+
+	if (!cpu_has_neon())
+		return 0;
+
+	buf = kmalloc(3 * (CSUM_TEST_LEN + 16), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	dst = buf + CSUM_TEST_LEN + 16;
+	ref = dst + CSUM_TEST_LEN + 16;
+	get_random_bytes(buf, CSUM_TEST_LEN + 16);
+
+	csum_neon_ok = true;
+	for (len = NEON_CSUM_MIN; len <= CSUM_TEST_LEN; len += 37) {
+		for (off = 0; off < 16; off++) {
+			sum = (__force __wsum)(len * 0x01010101);
+
+			if (csum_fold(__csum_partial_large(buf + off, len, sum)) !=
+			    csum_fold(__csum_partial_arm(buf + off, len, sum)))
+				goto fail;
+
+			memset(dst, 0, len + 16);
+			memset(ref, 0, len + 16);
+			if (csum_fold(__csum_partial_copy_large(buf + off,
+					dst + 15 - off, len, sum)) !=
+			    csum_fold(__csum_partial_copy_arm(buf + off,
+					ref + 15 - off, len, sum)) ||
+			    memcmp(dst, ref, len + 16))
+				goto fail;
+		}
+	}
+
+	arm = csum_speed(buf, false);
+	neon = csum_speed(buf, true);
+	printk(KERN_INFO "csum: %d byte buffers, arm %u MB/sec, neon %u MB/sec\n",
+	       CSUM_BENCH_LEN, arm, neon);
+	goto out;
+
+fail:
+	csum_neon_ok = false;
+	WARN(1, "csum: NEON checksum self-test failed at len %d offset %d, "
+		"not using it\n", len, off);
+	ret = -EINVAL;
+out:
+	kfree(buf);
+	return ret;
+}
+late_initcall(csum_neon_init);
@@ -14,6 +14,7 @@
 
 #include <linux/err.h>
 #include <linux/gpio.h>
+#include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/omapfb.h>
 #include <linux/regulator/consumer.h>
@@ -1113,6 +1114,9 @@ void __init omap4_tuna_display_init(void)
 	omapfb_set_platform_data(&tuna_fb_pdata);
 	tuna_hdmi_mux_init();
 	omap_display_init(&tuna_dss_data);
+
+	/* keep vsync and framedone handling off the UI thread's cpu */
+	irq_set_balance_avoid_fg(OMAP44XX_IRQ_DSS_DISPC, true);
 }
 
 static int __init get_panel_id(char *str)
@@ -177,6 +177,7 @@ void __init omap4_tuna_input_init(void)
 
 	i2c_register_board_info(3, tuna_i2c3_boardinfo_final,
 		ARRAY_SIZE(tuna_i2c3_boardinfo_final));
+	irq_set_balance_avoid_fg(OMAP_GPIO_IRQ(GPIO_TOUCH_IRQ), true);
 
 	omap_mux_init_gpio(8, OMAP_PIN_INPUT);
 	omap_mux_init_gpio(30, OMAP_PIN_INPUT);
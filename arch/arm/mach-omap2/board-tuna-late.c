@@ -0,0 +1,225 @@
+/* arch/arm/mach-omap2/board-tuna-late.c
+ *
+ * Late probing of the tuna peripherals nothing needs to show the first
+ * frame: NFC, the vibrator, the modem.  The board files hand their probe
+ * to tuna_late_probe_add() instead of running it from their initcall,
+ * and all of them are run once userspace writes to
+ * /sys/kernel/late_probe/boot_completed.  Writing a name to "probe"
+ * runs that one right away, for a HAL that needs its device before
+ * then, and if userspace never says anything they are run anyway
+ * "timeout" seconds after the initcalls.  "report" shows what each of
+ * them took off the boot path.
+ *
+ * Booting with tuna_late_probe=0 probes them as they are added, as the
+ * board files used to; tuna_late_probe=<n> sets the timeout instead.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/hrtimer.h>
+#include <linux/jiffies.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/string.h>
+#include <asm/mach-types.h>
+
+#include "board-tuna.h"
+
+#define LATE_PROBE_TIMEOUT	30	/* seconds */
+
+static LIST_HEAD(late_probes);
+static DEFINE_MUTEX(late_probe_lock);
+static bool late_probe_enabled = true;
+static bool late_probe_all;		/* boot_completed, or the timeout */
+static unsigned int late_probe_timeout = LATE_PROBE_TIMEOUT;
+static s64 late_probe_at_ms;		/* uptime when they were all run */
+
+static int __init late_probe_setup(char *str)
+{
+	late_probe_timeout = simple_strtoul(str, NULL, 0);
+	late_probe_enabled = late_probe_timeout != 0;
+	return 1;
+}
+__setup("tuna_late_probe=", late_probe_setup);
+
+static void late_probe_run(struct tuna_late_probe *lp)
+{
+	ktime_t start;
+
+	if (lp->done)
+		return;
+
+	start = ktime_get();
+	lp->ret = lp->probe();
+	lp->usecs = ktime_us_delta(ktime_get(), start);
+	lp->done = true;
+
+	if (lp->ret)
+		pr_err("late_probe: %s failed: %d\n", lp->name, lp->ret);
+}
+
+static void late_probe_run_all(const char *why)
+{
+	struct tuna_late_probe *lp;
+	s64 usecs = 0;
+	int n = 0;
+
+	mutex_lock(&late_probe_lock);
+	if (late_probe_all)
+		goto out;
+	late_probe_all = true;
+	late_probe_at_ms = ktime_to_ms(ktime_get());
+
+	list_for_each_entry(lp, &late_probes, list) {
+		if (lp->done)
+			continue;
+		late_probe_run(lp);
+		usecs += lp->usecs;
+		n++;
+	}
+	pr_info("late_probe: %s at %lld ms, %d probes took %lld usecs\n",
+		why, late_probe_at_ms, n, usecs);
+out:
+	mutex_unlock(&late_probe_lock);
+}
+
+static void late_probe_timeout_work(struct work_struct *work)
+{
+	late_probe_run_all("timeout");
+}
+static DECLARE_DELAYED_WORK(late_probe_work, late_probe_timeout_work);
+
+void tuna_late_probe_add(struct tuna_late_probe *lp)
+{
+	mutex_lock(&late_probe_lock);
+	list_add_tail(&lp->list, &late_probes);
+	if (!late_probe_enabled || late_probe_all)
+		late_probe_run(lp);
+	mutex_unlock(&late_probe_lock);
+}
+
+static ssize_t boot_completed_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	cancel_delayed_work_sync(&late_probe_work);
+	late_probe_run_all("boot completed");
+	return count;
+}
+
+static ssize_t boot_completed_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", late_probe_all);
+}
+
+static ssize_t probe_store(struct kobject *kobj, struct kobj_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct tuna_late_probe *lp;
+	size_t len = count;
+	int ret = -ENODEV;
+
+	if (len && buf[len - 1] == '\n')
+		len--;
+
+	mutex_lock(&late_probe_lock);
+	list_for_each_entry(lp, &late_probes, list) {
+		if (strlen(lp->name) != len || strncmp(lp->name, buf, len))
+			continue;
+		late_probe_run(lp);
+		ret = lp->ret;
+		break;
+	}
+	mutex_unlock(&late_probe_lock);
+
+	return ret ? ret : count;
+}
+
+static ssize_t report_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf)
+{
+	struct tuna_late_probe *lp;
+	s64 usecs = 0;
+	ssize_t n = 0;
+
+	mutex_lock(&late_probe_lock);
+	list_for_each_entry(lp, &late_probes, list) {
+		if (lp->done) {
+			n += scnprintf(buf + n, PAGE_SIZE - n,
+				       "%-16s %8lld usecs %d\n",
+				       lp->name, lp->usecs, lp->ret);
+			usecs += lp->usecs;
+		} else {
+			n += scnprintf(buf + n, PAGE_SIZE - n,
+				       "%-16s  pending\n", lp->name);
+		}
+	}
+	n += scnprintf(buf + n, PAGE_SIZE - n,
+		       "total %lld usecs off the boot path", usecs);
+	if (late_probe_all)
+		n += scnprintf(buf + n, PAGE_SIZE - n, ", run at %lld ms",
+			       late_probe_at_ms);
+	n += scnprintf(buf + n, PAGE_SIZE - n, "\n");
+	mutex_unlock(&late_probe_lock);
+
+	return n;
+}
+
+static ssize_t timeout_show(struct kobject *kobj, struct kobj_attribute *attr,
+			    char *buf)
+{
+	return sprintf(buf, "%u\n", late_probe_timeout);
+}
+
+static struct kobj_attribute boot_completed_attr =
+	__ATTR(boot_completed, 0600, boot_completed_show, boot_completed_store);
+static struct kobj_attribute probe_attr =
+	__ATTR(probe, 0200, NULL, probe_store);
+static struct kobj_attribute report_attr = __ATTR_RO(report);
+static struct kobj_attribute timeout_attr = __ATTR_RO(timeout);
+
+static struct attribute *late_probe_attrs[] = {
+	&boot_completed_attr.attr,
+	&probe_attr.attr,
+	&report_attr.attr,
+	&timeout_attr.attr,
+	NULL,
+};
+
+static struct attribute_group late_probe_attr_group = {
+	.attrs = late_probe_attrs,
+};
+
+static int __init late_probe_init(void)
+{
+	struct kobject *kobj;
+
+	if (!machine_is_tuna() || !late_probe_enabled)
+		return 0;
+
+	kobj = kobject_create_and_add("late_probe", kernel_kobj);
+	if (!kobj || sysfs_create_group(kobj, &late_probe_attr_group)) {
+		/* nothing could tell us when to probe, so do it now */
+		pr_err("late_probe: sysfs setup failed\n");
+		late_probe_run_all("no sysfs");
+		return 0;
+	}
+
+	schedule_delayed_work(&late_probe_work, late_probe_timeout * HZ);
+	return 0;
+}
+/* after the board files' late_initcalls have added their probes */
+late_initcall_sync(late_probe_init);
@@ -730,6 +730,36 @@ void __init modem_toro_init(void)
 	platform_device_register(&lte_modem_wake);
 }
 
+static int tuna_modem_probe(void)
+{
+	switch (omap4_tuna_get_type()) {
+	case TUNA_TYPE_MAGURO:	/* HSPA */
+		platform_device_register(&umts_modem);
+		device_enable_async_suspend(&umts_modem.dev);
+		break;
+
+	case TUNA_TYPE_TORO:	/* LTE */
+		platform_device_register(&cdma_modem);
+		platform_device_register(&lte_modem);
+
+		/* the modems resume in parallel with the rest of the board */
+		device_enable_async_suspend(&cdma_modem.dev);
+		device_enable_async_suspend(&lte_modem_wake.dev);
+		device_enable_async_suspend(&lte_modem.dev);
+		device_pm_add_link(&lte_modem.dev, &lte_modem_wake.dev);
+		break;
+
+	default:
+		break;
+	}
+	return 0;
+}
+
+static struct tuna_late_probe tuna_modem_late_probe = {
+	.name = "modem",
+	.probe = tuna_modem_probe,
+};
+
 static int __init init_modem(void)
 {
 	pr_debug("[MODEM_IF] init_modem\n");
@@ -738,22 +768,21 @@ static int __init init_modem(void)
 	case TUNA_TYPE_MAGURO:	/* HSPA */
 		/* umts gpios configuration */
 		umts_modem_cfg_gpio();
-		platform_device_register(&umts_modem);
 		break;
 
 	case TUNA_TYPE_TORO:	/* LTE */
 		/* cdma gpios configuration */
 		cdma_modem_cfg_gpio();
-		platform_device_register(&cdma_modem);
-
 		/* lte gpios configuration */
 		lte_modem_cfg_gpio();
-		platform_device_register(&lte_modem);
 		break;
 
 	default:
-		break;
+		return 0;
 	}
+
+	/* the modem_if devices wait for boot completion, or for rild */
+	tuna_late_probe_add(&tuna_modem_late_probe);
 	return 0;
 }
 late_initcall(init_modem);
@@ -25,6 +25,7 @@
 #include <plat/serial.h>
 
 #include "mux.h"
+#include "board-tuna.h"
 
 #define GPIO_NFC_EN	173
 #define GPIO_NFC_FW	172
@@ -104,36 +105,21 @@ static irqreturn_t nfc_irq_isr(int irq, void *dev)
 	return IRQ_HANDLED;
 }
 
-void __init omap4_tuna_nfc_init(void)
+static int tuna_nfc_probe(void)
 {
 	struct platform_device *pdev;
 	int irq;
 
-	gpio_request(GPIO_NFC_FW, "nfc_fw");
-	gpio_direction_output(GPIO_NFC_FW, 0);
-	omap_mux_init_gpio(GPIO_NFC_FW, OMAP_PIN_OUTPUT);
-
-	gpio_request(GPIO_NFC_EN, "nfc_en");
-	gpio_direction_output(GPIO_NFC_EN, 0);
-	omap_mux_init_gpio(GPIO_NFC_EN, OMAP_PIN_OUTPUT);
-
-	gpio_request(GPIO_NFC_IRQ, "nfc_irq");
-	gpio_direction_input(GPIO_NFC_IRQ);
-	omap_mux_init_gpio(GPIO_NFC_IRQ, OMAP_PIN_INPUT_PULLUP |
-			OMAP_PIN_OFF_WAKEUPENABLE);
-
-	wake_lock_init(&nfc_wake_lock, WAKE_LOCK_SUSPEND, "nfc");
-
 	irq = gpio_to_irq(GPIO_NFC_IRQ);
 	if (request_irq(irq, nfc_irq_isr, IRQF_TRIGGER_RISING, "nfc_irq",
 			NULL)) {
 		pr_err("%s: request_irq() failed\n", __func__);
-		return;
+		return -EBUSY;
 	}
 
 	if (enable_irq_wake(irq)) {
 		pr_err("%s: irq_set_irq_wake() failed\n", __func__);
-		return;
+		return -EINVAL;
 	}
 
 	nfc_power = PWR_OFF;
@@ -141,8 +127,35 @@ void __init omap4_tuna_nfc_init(void)
 	pdev = platform_device_register_simple("nfc-power", -1, NULL, 0);
 	if (IS_ERR(pdev)) {
 		pr_err("%s: platform_device_register_simple() failed\n", __func__);
-		return;
+		return PTR_ERR(pdev);
 	}
 	if (device_create_file(&pdev->dev, &dev_attr_nfc_power))
 		pr_err("%s: device_create_file() failed\n", __func__);
+	return 0;
+}
+
+static struct tuna_late_probe tuna_nfc_late_probe = {
+	.name = "nfc",
+	.probe = tuna_nfc_probe,
+};
+
+void __init omap4_tuna_nfc_init(void)
+{
+	gpio_request(GPIO_NFC_FW, "nfc_fw");
+	gpio_direction_output(GPIO_NFC_FW, 0);
+	omap_mux_init_gpio(GPIO_NFC_FW, OMAP_PIN_OUTPUT);
+
+	gpio_request(GPIO_NFC_EN, "nfc_en");
+	gpio_direction_output(GPIO_NFC_EN, 0);
+	omap_mux_init_gpio(GPIO_NFC_EN, OMAP_PIN_OUTPUT);
+
+	gpio_request(GPIO_NFC_IRQ, "nfc_irq");
+	gpio_direction_input(GPIO_NFC_IRQ);
+	omap_mux_init_gpio(GPIO_NFC_IRQ, OMAP_PIN_INPUT_PULLUP |
+			OMAP_PIN_OFF_WAKEUPENABLE);
+
+	wake_lock_init(&nfc_wake_lock, WAKE_LOCK_SUSPEND, "nfc");
+
+	/* the pins are set up, the pn544 stays off until it is probed */
+	tuna_late_probe_add(&tuna_nfc_late_probe);
 }
@@ -193,7 +193,7 @@ static enum hrtimer_restart vibrator_timer_func(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
-static int __init vibrator_init(void)
+static int vibrator_init(void)
 {
 	int ret;
 
@@ -234,6 +234,21 @@ err_dm_timer_init:
 	return -1;
 }
 
+static int vibrator_probe(void)
+{
+	int ret;
+
+	ret = vibrator_init();
+	if (ret < 0)
+		gpio_free(vibdata.gpio_en);
+	return ret;
+}
+
+static struct tuna_late_probe vibrator_late_probe = {
+	.name = "vibrator",
+	.probe = vibrator_probe,
+};
+
 static int __init omap4_tuna_vibrator_init(void)
 {
 	int ret;
@@ -254,11 +269,9 @@ static int __init omap4_tuna_vibrator_init(void)
 
 	gpio_direction_output(vibdata.gpio_en, 0);
 
-	ret = vibrator_init();
-	if (ret < 0)
-		gpio_free(vibdata.gpio_en);
+	tuna_late_probe_add(&vibrator_late_probe);
 
-	return ret;
+	return 0;
 }
 
 /*
@@ -432,8 +432,18 @@ int __init tuna_wlan_init(void)
 {
 	pr_debug("%s: start\n", __func__);
 
+	int ret;
+
 	tuna_wlan_gpio();
 	tuna_init_wifi_mem();
 	platform_device_register(&omap_vwlan_device);
-	return platform_device_register(&tuna_wifi_device);
+	ret = platform_device_register(&tuna_wifi_device);
+	if (ret)
+		return ret;
+
+	/* nothing else on the board waits for WiFi across suspend */
+	device_enable_async_suspend(&omap_vwlan_device.dev);
+	device_enable_async_suspend(&tuna_wifi_device.dev);
+	return device_pm_add_link(&tuna_wifi_device.dev,
+				  &omap_vwlan_device.dev);
 }
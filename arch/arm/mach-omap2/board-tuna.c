@@ -27,6 +27,7 @@
 #include <linux/omap_ion.h>
 #include <linux/usb/otg.h>
 #include <linux/hwspinlock.h>
+#include <linux/i2c.h>
 #include <linux/i2c/twl.h>
 #include <linux/regulator/machine.h>
 #include <linux/regulator/fixed.h>
@@ -237,8 +238,38 @@ static void __init tuna_bt_init(void)
 						OMAP_PIN_INPUT_PULLDOWN);
 
 	platform_device_register(&bcm4330_bluetooth_device);
+	device_enable_async_suspend(&bcm4330_bluetooth_device.dev);
 }
 
+/*
+ * I2C clients that can be suspended and resumed in parallel with the rest
+ * of the board, after their adapter: the touchscreen and the sensors.  They
+ * are only created once their bus is probed, so catch them as they appear.
+ */
+static const char * const tuna_async_i2c_clients[] = {
+	"mms_ts", "mpu3050", "bma250", "yas530", "gp2a", "bmp180",
+};
+
+static int tuna_i2c_notifier_call(struct notifier_block *nb,
+				  unsigned long action, void *data)
+{
+	struct i2c_client *client = i2c_verify_client(data);
+	int i;
+
+	if (action != BUS_NOTIFY_ADD_DEVICE || !client)
+		return NOTIFY_DONE;
+
+	for (i = 0; i < ARRAY_SIZE(tuna_async_i2c_clients); i++)
+		if (!strcmp(client->name, tuna_async_i2c_clients[i]))
+			device_enable_async_suspend(&client->dev);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block tuna_i2c_notifier = {
+	.notifier_call = tuna_i2c_notifier_call,
+};
+
 static struct twl4030_madc_platform_data twl6030_madc = {
 	.irq_line = -1,
 };
@@ -1341,6 +1372,7 @@ static void __init tuna_init(void)
 
 	tuna_wlan_init();
 	tuna_audio_init();
+	bus_register_notifier(&i2c_bus_type, &tuna_i2c_notifier);
 	tuna_i2c_init();
 	tuna_gsd4t_gps_init();
 	platform_add_devices(tuna_devices, ARRAY_SIZE(tuna_devices));
@@ -1404,6 +1436,8 @@ static void __init tuna_reserve(void)
 
 	omap_ram_console_init(OMAP_RAM_CONSOLE_START_DEFAULT,
 				OMAP_RAM_CONSOLE_SIZE_DEFAULT);
+	omap_pstore_ftrace_init(OMAP_PSTORE_FTRACE_START_DEFAULT,
+				OMAP_PSTORE_FTRACE_SIZE_DEFAULT);
 
 
 	/* do the static reservations first */
@@ -14,6 +14,9 @@
 #ifndef _MACH_OMAP2_BOARD_TUNA_H_
 #define _MACH_OMAP2_BOARD_TUNA_H_
 
+#include <linux/list.h>
+#include <linux/types.h>
+
 #define TUNA_REV_MASK		0xf
 #define TUNA_REV_03		0x3
 #define TUNA_REV_SAMPLE_4	0x3
@@ -58,6 +61,22 @@ enum pogo_power_state {
 void tuna_otg_pogo_charger(enum pogo_power_state);
 void tuna_otg_set_dock_switch(int enable);
 
+/*
+ * A peripheral nothing needs for the first frame, whose probe is run
+ * once userspace says it has booted, see board-tuna-late.c.  @probe
+ * is called once, from process context, and can't be __init.
+ */
+struct tuna_late_probe {
+	const char *name;
+	int (*probe)(void);
+
+	struct list_head list;
+	bool done;
+	int ret;
+	s64 usecs;
+};
+void tuna_late_probe_add(struct tuna_late_probe *lp);
+
 extern struct mmc_platform_data tuna_wifi_data;
 extern struct class *sec_class;
 
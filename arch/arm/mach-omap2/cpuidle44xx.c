@@ -19,6 +19,10 @@
 #include <linux/cpu.h>
 #include <linux/delay.h>
 #include <linux/cpu_pm.h>
+#include <linux/tick.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/log2_hist.h>
 
 #include <asm/cacheflush.h>
 #include <asm/proc-fns.h>
@@ -78,6 +82,11 @@ module_param(only_state, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(only_state,
 	"Select only power state allowed (0=any, 1=WFI, 2=INA, 3=CSWR, 4=OSWR)");
 
+static bool predict = true;
+module_param(predict, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(predict,
+	"Demote states the predicted idle time does not cover (0=off, 1=on)");
+
 static const int omap4_poke_interrupt[2] = {
 	OMAP44XX_IRQ_CPUIDLE_POKE0,
 	OMAP44XX_IRQ_CPUIDLE_POKE1
@@ -101,6 +110,40 @@ static struct omap4_processor_cx *omap4_idle_requested_cx[NR_CPUS];
 static int omap4_idle_ready_count;
 static DEFINE_SPINLOCK(omap4_idle_lock);
 static struct clockdomain *cpu1_cd;
+/* shared state cpu0 committed to, valid once omap4_idle_ready_count is set */
+static struct omap4_processor_cx *omap4_idle_shared_cx;
+
+/*
+ * Per-cpu idle time predictor.  The last few idle durations are kept and,
+ * when they are regular enough, their average is the expected idle time,
+ * capped by the next timer event.  wake is when the current idle period is
+ * expected to end, so the other cpu can tell how much of it is left.
+ */
+#define OMAP4_IDLE_HISTORY		8
+
+struct omap4_idle_predictor {
+	u32 history[OMAP4_IDLE_HISTORY];
+	int next;
+	u32 predicted;
+	ktime_t wake;
+};
+
+static DEFINE_PER_CPU(struct omap4_idle_predictor, omap4_idle_pred);
+
+#ifdef CONFIG_PM_DEBUG
+/* log2 buckets of residency, from <32us up to >=32ms */
+#define OMAP4_IDLE_HIST_BUCKETS		12
+#define OMAP4_IDLE_HIST_MIN_SHIFT	5
+
+struct omap4_idle_stats {
+	unsigned long count[OMAP4_MAX_STATES];
+	unsigned long early[OMAP4_MAX_STATES];
+	unsigned long predicted[OMAP4_MAX_STATES][OMAP4_IDLE_HIST_BUCKETS];
+	unsigned long actual[OMAP4_MAX_STATES][OMAP4_IDLE_HIST_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct omap4_idle_stats, omap4_idle_stats);
+#endif
 
 /*
  * Raw measured exit latency numbers (us):
@@ -138,6 +181,120 @@ static void omap4_update_actual_state(struct cpuidle_device *dev,
 	}
 }
 
+/*
+ * Average of the recent idle durations, or UINT_MAX when they are too
+ * scattered to predict anything.  The longest sample is dropped and the
+ * average retried a couple of times so a single long sleep does not hide
+ * an otherwise regular wakeup pattern.
+ */
+static u32 omap4_idle_typical_us(struct omap4_idle_predictor *p)
+{
+	u32 thresh = UINT_MAX;
+	u32 longest;
+	u64 avg, var;
+	s64 diff;
+	int i, n, tries;
+
+	for (tries = 0; tries < 3; tries++) {
+		avg = 0;
+		longest = 0;
+		n = 0;
+		for (i = 0; i < OMAP4_IDLE_HISTORY; i++) {
+			if (!p->history[i] || p->history[i] >= thresh)
+				continue;
+			avg += p->history[i];
+			longest = max(longest, p->history[i]);
+			n++;
+		}
+		if (n < OMAP4_IDLE_HISTORY / 2)
+			break;
+		avg = div_u64(avg, n);
+
+		var = 0;
+		for (i = 0; i < OMAP4_IDLE_HISTORY; i++) {
+			if (!p->history[i] || p->history[i] >= thresh)
+				continue;
+			diff = (s64)p->history[i] - avg;
+			var += diff * diff;
+		}
+		var = div_u64(var, n);
+
+		/* standard deviation within a quarter of the average */
+		if (var * 16 <= avg * avg)
+			return avg;
+
+		thresh = longest;
+	}
+
+	return UINT_MAX;
+}
+
+/*
+ * returns the expected idle time of the local cpu, in us.  A cpu parked by
+ * the hotplug policy is only expected to wake for its timers.
+ */
+static u32 omap4_idle_predict(int cpu)
+{
+	struct omap4_idle_predictor *p = &per_cpu(omap4_idle_pred, cpu);
+	s64 timer_us = ktime_to_us(tick_nohz_get_sleep_length());
+
+	if (cpu_is_parked(cpu))
+		p->predicted = min_t(s64, timer_us, UINT_MAX);
+	else
+		p->predicted = min_t(s64, timer_us, omap4_idle_typical_us(p));
+	p->wake = ktime_add_us(ktime_get(), p->predicted);
+
+	return p->predicted;
+}
+
+/* pick the deepest state at or above cx whose target residency fits in us */
+static struct omap4_processor_cx *omap4_idle_demote(
+	struct omap4_processor_cx *cx, s64 us)
+{
+	while (cx->type > OMAP4_STATE_C1 &&
+	       (!cx->valid || cx->target_residency > us))
+		cx = &omap4_power_states[cx->type - 1];
+
+	return cx;
+}
+
+#ifdef CONFIG_PM_DEBUG
+static int omap4_idle_hist_bucket(u32 us)
+{
+	return log2_hist_bucket(us >> OMAP4_IDLE_HIST_MIN_SHIFT,
+				OMAP4_IDLE_HIST_BUCKETS);
+}
+
+static void omap4_idle_account(int cpu, struct omap4_processor_cx *cx,
+	u32 predicted, u32 actual)
+{
+	struct omap4_idle_stats *st = &per_cpu(omap4_idle_stats, cpu);
+
+	st->count[cx->type]++;
+	if (actual < cx->target_residency)
+		st->early[cx->type]++;
+	st->predicted[cx->type][omap4_idle_hist_bucket(predicted)]++;
+	st->actual[cx->type][omap4_idle_hist_bucket(actual)]++;
+}
+#else
+static inline void omap4_idle_account(int cpu, struct omap4_processor_cx *cx,
+	u32 predicted, u32 actual)
+{
+}
+#endif
+
+static void omap4_idle_record(int cpu, struct omap4_processor_cx *cx,
+	u32 actual)
+{
+	struct omap4_idle_predictor *p = &per_cpu(omap4_idle_pred, cpu);
+
+	p->history[p->next] = actual;
+	p->next = (p->next + 1) % OMAP4_IDLE_HISTORY;
+	p->wake = ktime_set(0, 0);
+
+	omap4_idle_account(cpu, cx, p->predicted, actual);
+}
+
 static bool omap4_gic_interrupt_pending(void)
 {
 	void __iomem *gic_cpu = omap4_get_gic_cpu_base();
@@ -225,9 +382,12 @@ static int omap4_enter_idle_wfi(struct cpuidle_device *dev,
 	struct cpuidle_state *state)
 {
 	ktime_t preidle, postidle;
+	u32 residency;
 
 	local_fiq_disable();
 
+	omap4_idle_predict(dev->cpu);
+
 	preidle = ktime_get();
 
 	omap4_wfi_until_interrupt();
@@ -237,9 +397,12 @@ static int omap4_enter_idle_wfi(struct cpuidle_device *dev,
 	local_fiq_enable();
 	local_irq_enable();
 
+	residency = ktime_to_us(ktime_sub(postidle, preidle));
+	omap4_idle_record(dev->cpu, &omap4_power_states[OMAP4_STATE_C1],
+			  residency);
 	omap4_update_actual_state(dev, &omap4_power_states[OMAP4_STATE_C1]);
 
-	return ktime_to_us(ktime_sub(postidle, preidle));
+	return residency;
 }
 
 static inline bool omap4_all_cpus_idle(void)
@@ -269,6 +432,30 @@ static inline struct omap4_processor_cx *omap4_get_idle_state(void)
 	return cx;
 }
 
+/*
+ * Shared state for both cpus, demoted to what the shortest remaining
+ * predicted idle time of the online cpus covers.  Returns the C1 state
+ * if not even the shallowest shared state is expected to pay off.
+ */
+static struct omap4_processor_cx *omap4_predict_shared_state(void)
+{
+	struct omap4_processor_cx *cx = omap4_get_idle_state();
+	ktime_t now = ktime_get();
+	s64 remaining = LLONG_MAX;
+	int i;
+
+	assert_spin_locked(&omap4_idle_lock);
+
+	if (!predict)
+		return cx;
+
+	for_each_online_cpu(i)
+		remaining = min(remaining,
+			ktime_us_delta(per_cpu(omap4_idle_pred, i).wake, now));
+
+	return omap4_idle_demote(cx, remaining);
+}
+
 static void omap4_cpu_poke_others(int cpu)
 {
 	int i;
@@ -419,6 +606,7 @@ static int omap4_enter_idle(struct cpuidle_device *dev,
 	ktime_t preidle, postidle;
 	bool idle = true;
 	int cpu = dev->cpu;
+	u32 predicted, residency;
 
 	/*
 	 * If disallow_smp_idle is set, revert to the old hotplug governor
@@ -427,6 +615,14 @@ static int omap4_enter_idle(struct cpuidle_device *dev,
 	if (dev->cpu != 0 && disallow_smp_idle)
 		return omap4_enter_idle_wfi(dev, state);
 
+	/*
+	 * Waking up before the target residency costs the exit latency for
+	 * nothing, so only go as deep as the predicted idle time allows.
+	 */
+	predicted = omap4_idle_predict(cpu);
+	if (predict)
+		cx = omap4_idle_demote(cx, predicted);
+
 	/* Clamp the power state at max_state */
 	if (max_state > 0 && (cx->type > max_state - 1))
 		cx = &omap4_power_states[max_state - 1];
@@ -496,6 +692,20 @@ static int omap4_enter_idle(struct cpuidle_device *dev,
 	 */
 	if (cpu == 0) {
 		BUG_ON(omap4_idle_ready_count != 0);
+
+		/*
+		 * Only start the shared-OFF handshake if both cpus are
+		 * expected to stay idle long enough for it.  Otherwise let
+		 * cpu1 go back to its governor and sit in wfi until woken.
+		 */
+		omap4_idle_shared_cx = omap4_predict_shared_state();
+		if (omap4_idle_shared_cx->type == OMAP4_STATE_C1) {
+			omap4_cpu_update_state(cpu, NULL);
+			spin_unlock(&omap4_idle_lock);
+			omap4_wfi_until_interrupt();
+			goto out;
+		}
+
 		/* cpu0 requests shared-OFF */
 		omap4_idle_ready_count = 1;
 		/* cpu0 can no longer abort shared-OFF, but cpu1 can */
@@ -519,7 +729,7 @@ static int omap4_enter_idle(struct cpuidle_device *dev,
 			goto out;
 		}
 
-		actual_cx = omap4_get_idle_state();
+		actual_cx = omap4_idle_shared_cx;
 		spin_unlock(&omap4_idle_lock);
 
 		/* cpu1 is turning itself off, continue with turning cpu0 off */
@@ -571,7 +781,7 @@ static int omap4_enter_idle(struct cpuidle_device *dev,
 
 		/* cpu1 can no longer abort shared-OFF */
 
-		actual_cx = omap4_get_idle_state();
+		actual_cx = omap4_idle_shared_cx;
 		spin_unlock(&omap4_idle_lock);
 
 		omap4_enter_idle_secondary(cpu);
@@ -588,14 +798,99 @@ static int omap4_enter_idle(struct cpuidle_device *dev,
 out:
 	postidle = ktime_get();
 
+	residency = ktime_to_us(ktime_sub(postidle, preidle));
+	omap4_idle_record(cpu, actual_cx, residency);
 	omap4_update_actual_state(dev, actual_cx);
 
 	local_irq_enable();
 	local_fiq_enable();
 
-	return ktime_to_us(ktime_sub(postidle, preidle));
+	return residency;
 }
 
+#ifdef CONFIG_PM_DEBUG
+static int omap4_idle_stats_show(struct seq_file *sf, void *unused)
+{
+	struct omap4_idle_stats *st;
+	char label[8];
+	int cpu, i, b;
+
+	seq_printf(sf, "%-8s %8s %8s", "state", "count", "early");
+	for (b = 0; b < OMAP4_IDLE_HIST_BUCKETS; b++) {
+		snprintf(label, sizeof(label), "%s%llu",
+			 b < OMAP4_IDLE_HIST_BUCKETS - 1 ? "<" : ">=",
+			 log2_hist_bound(b, OMAP4_IDLE_HIST_BUCKETS) <<
+			 OMAP4_IDLE_HIST_MIN_SHIFT);
+		seq_printf(sf, " %6s", label);
+	}
+	seq_printf(sf, "\n");
+
+	for_each_possible_cpu(cpu) {
+		st = &per_cpu(omap4_idle_stats, cpu);
+		seq_printf(sf, "cpu%d\n", cpu);
+		for (i = 0; i < OMAP4_MAX_STATES; i++) {
+			if (!omap4_power_states[i].valid)
+				continue;
+
+			seq_printf(sf, "C%d pred  %8lu %8lu", i + 1,
+				   st->count[i], st->early[i]);
+			for (b = 0; b < OMAP4_IDLE_HIST_BUCKETS; b++)
+				seq_printf(sf, " %6lu", st->predicted[i][b]);
+			seq_printf(sf, "\nC%d act  %18s", i + 1, "");
+			for (b = 0; b < OMAP4_IDLE_HIST_BUCKETS; b++)
+				seq_printf(sf, " %6lu", st->actual[i][b]);
+			seq_printf(sf, "\n");
+		}
+	}
+
+	return 0;
+}
+
+static int omap4_idle_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap4_idle_stats_show, inode->i_private);
+}
+
+/* Any write clears the statistics */
+static ssize_t omap4_idle_stats_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(omap4_idle_stats, cpu), 0,
+		       sizeof(struct omap4_idle_stats));
+
+	return count;
+}
+
+static const struct file_operations omap4_idle_stats_fops = {
+	.open = omap4_idle_stats_open,
+	.read = seq_read,
+	.write = omap4_idle_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void __init omap4_idle_dbg_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_dir("cpuidle44xx", NULL);
+	if (IS_ERR_OR_NULL(d)) {
+		pr_warning("%s: unable to create debugfs dir\n", __func__);
+		return;
+	}
+
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, d, NULL,
+			    &omap4_idle_stats_fops);
+}
+#else
+static inline void omap4_idle_dbg_init(void)
+{
+}
+#endif
+
 DEFINE_PER_CPU(struct cpuidle_device, omap4_idle_dev);
 
 /**
@@ -737,6 +1032,8 @@ int __init omap4_idle_init(void)
 			GIC_DIST_TARGET + omap4_poke_interrupt[cpu_id]);
 	}
 
+	omap4_idle_dbg_init();
+
 	return 0;
 }
 #else
@@ -20,6 +20,11 @@
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
 #include <linux/pm_qos.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/log2_hist.h>
 #include <plat/common.h>
 #include <plat/omap_device.h>
 #include <plat/omap_hwmod.h>
@@ -35,6 +40,9 @@
 #include <linux/custom_voltage.h>
 #endif
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/dvfs.h>
+
 /**
  * DOC: Introduction
  * =================
@@ -177,6 +185,40 @@ struct omap_vdd_user_list {
 	struct plist_node node;
 };
 
+/* Phases of a scale timed in struct omap_dvfs_stats */
+#define DVFS_STAT_VOLT		0
+#define DVFS_STAT_CLK		1
+#define DVFS_STAT_DEP		2
+#define DVFS_STAT_PHASES	3
+
+/* Power of two histogram buckets: <16us, <32us, ... , >=4096us */
+#define DVFS_STAT_BUCKETS	10
+#define DVFS_STAT_MIN_SHIFT	4
+
+/**
+ * struct omap_dvfs_stats - Per vdd transition statistics
+ * @scales:	number of _dvfs_scale calls
+ * @count:	number of times each phase actually ran
+ * @total_us:	time spent in each phase
+ * @max_us:	longest run of each phase
+ * @hist:	duration histogram of each phase
+ * @freq_blocked: frequency requests overruled by another device's
+ * @volt_blocked: voltage requests overruled by another device's
+ * @freq_holder: device holding the frequency at the last block
+ * @volt_holder: device holding the voltage at the last block
+ */
+struct omap_dvfs_stats {
+	unsigned long scales;
+	unsigned long count[DVFS_STAT_PHASES];
+	u64 total_us[DVFS_STAT_PHASES];
+	u32 max_us[DVFS_STAT_PHASES];
+	unsigned long hist[DVFS_STAT_PHASES][DVFS_STAT_BUCKETS];
+	unsigned long freq_blocked;
+	unsigned long volt_blocked;
+	struct device *freq_holder;
+	struct device *volt_holder;
+};
+
 /**
  * struct omap_vdd_dvfs_info - The per vdd dvfs info
  * @node:	list node for vdd_dvfs_info list
@@ -184,6 +226,10 @@ struct omap_vdd_user_list {
  * @vdd_user_list: The vdd user list
  * @voltdm:	Voltage domains for which dvfs info stored
  * @dev_list:	Device list maintained per domain
+ * @deferred_vdata: lower voltage still to be set, NULL if none
+ * @deferred_dev: target device of the scale that deferred it
+ * @deferred_work: work setting @deferred_vdata on omap_dvfs_worker
+ * @stats:	transition statistics, protected by omap_dvfs_lock
  *
  * This is a fundamental structure used to store all the required
  * DVFS related information for a vdd.
@@ -195,11 +241,41 @@ struct omap_vdd_dvfs_info {
 	struct plist_head vdd_user_list;
 	struct voltagedomain *voltdm;
 	struct list_head dev_list;
+
+	struct omap_volt_data *deferred_vdata;
+	struct device *deferred_dev;
+	struct kthread_work deferred_work;
+
+	struct omap_dvfs_stats stats;
 };
 
 static LIST_HEAD(omap_dvfs_info_list);
 DEFINE_MUTEX(omap_dvfs_lock);
 
+/*
+ * Voltage reductions are done from this worker once the device frequencies
+ * are already down, so that the requester does not wait for the regulator.
+ * A later scale of the same vdd supersedes a reduction still pending.
+ */
+static DEFINE_KTHREAD_WORKER(omap_dvfs_worker);
+static struct task_struct *omap_dvfs_task;
+
+/* Account one run of @phase that started at @start, returns its length */
+static u32 _dvfs_stat_phase(struct omap_vdd_dvfs_info *dvfs_info,
+			    int phase, ktime_t start)
+{
+	struct omap_dvfs_stats *st = &dvfs_info->stats;
+	u32 us = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	st->hist[phase][log2_hist_bucket(us >> DVFS_STAT_MIN_SHIFT,
+					 DVFS_STAT_BUCKETS)]++;
+	st->count[phase]++;
+	st->total_us[phase] += us;
+	if (us > st->max_us[phase])
+		st->max_us[phase] = us;
+	return us;
+}
+
 /* QoS expected */
 static struct pm_qos_request_list omap_dvfs_pm_qos_handle;
 
@@ -439,6 +515,66 @@ static int _add_freq_request(struct omap_vdd_dvfs_info *dvfs_info,
 	return 0;
 }
 
+/**
+ * _note_blocked_request() - Account requests overruled by other devices
+ * @dvfs_info:	omap_vdd_dvfs_info pointer for the required vdd
+ * @req_dev:	device that made the request
+ * @target_dev:	target device of the frequency request
+ * @freq:	requested frequency
+ * @volt:	voltage requested along with it
+ *
+ * Called once both requests are recorded: if the highest entry of either
+ * list belongs to another device, @req_dev does not get what it asked for.
+ */
+static void _note_blocked_request(struct omap_vdd_dvfs_info *dvfs_info,
+	struct device *req_dev, struct device *target_dev,
+	unsigned long freq, unsigned long volt)
+{
+	struct omap_vdd_dev_list *temp_dev;
+	struct omap_dev_user_list *dev_user;
+	struct omap_vdd_user_list *vdd_user;
+	struct device *holder = NULL;
+	unsigned long held = 0;
+
+	list_for_each_entry(temp_dev, &dvfs_info->dev_list, node) {
+		if (temp_dev->dev != target_dev)
+			continue;
+		spin_lock(&temp_dev->user_lock);
+		dev_user = container_of(plist_last(&temp_dev->freq_user_list),
+					struct omap_dev_user_list, node);
+		if (dev_user->node.prio > freq && dev_user->dev != req_dev) {
+			holder = dev_user->dev;
+			held = dev_user->node.prio;
+		}
+		spin_unlock(&temp_dev->user_lock);
+		break;
+	}
+	if (holder) {
+		dvfs_info->stats.freq_blocked++;
+		dvfs_info->stats.freq_holder = holder;
+		trace_dvfs_request_blocked(dvfs_info->voltdm->name,
+					   dev_name(req_dev), dev_name(holder),
+					   freq, held);
+	}
+
+	holder = NULL;
+	spin_lock(&dvfs_info->user_lock);
+	vdd_user = container_of(plist_last(&dvfs_info->vdd_user_list),
+				struct omap_vdd_user_list, node);
+	if (vdd_user->node.prio > volt && vdd_user->dev != req_dev) {
+		holder = vdd_user->dev;
+		held = vdd_user->node.prio;
+	}
+	spin_unlock(&dvfs_info->user_lock);
+	if (holder) {
+		dvfs_info->stats.volt_blocked++;
+		dvfs_info->stats.volt_holder = holder;
+		trace_dvfs_request_blocked(dvfs_info->voltdm->name,
+					   dev_name(req_dev), dev_name(holder),
+					   volt, held);
+	}
+}
+
 /**
  * _remove_freq_request() - Remove the requested device frequency
  *
@@ -736,6 +872,9 @@ static int _dvfs_scale(struct device *req_dev, struct device *target_dev,
 	struct omap_volt_data *new_vdata;
 	struct omap_volt_data *curr_vdata;
 	struct list_head *dev_list;
+	u32 volt_us = 0, clk_us = 0, dep_us = 0;
+	int nr_clk = 0;
+	ktime_t start;
 
 	voltdm = tdvfs_info->voltdm;
 	if (IS_ERR_OR_NULL(voltdm)) {
@@ -762,6 +901,10 @@ static int _dvfs_scale(struct device *req_dev, struct device *target_dev,
 		return PTR_ERR(curr_vdata);
 	}
 
+	/* Decided against the voltage in use, which may still be the old one */
+	tdvfs_info->deferred_vdata = NULL;
+	tdvfs_info->stats.scales++;
+
 	/* Disable smartreflex module across voltage and frequency scaling */
 	omap_sr_disable(voltdm);
 
@@ -770,18 +913,7 @@ static int _dvfs_scale(struct device *req_dev, struct device *target_dev,
 	if (!curr_volt)
 		curr_volt = omap_get_operation_voltage(curr_vdata);
 
-	/* Make a decision to scale dependent domain based on nominal voltage */
-	if (omap_get_nominal_voltage(new_vdata) >
-			omap_get_nominal_voltage(curr_vdata)) {
-		ret = _dep_scale_domains(target_dev, vdd);
-		if (ret) {
-			dev_err(target_dev,
-				"%s: Error(%d)scale dependent with %ld volt\n",
-				__func__, ret, new_volt);
-			goto fail;
-		}
-	}
-
+	start = ktime_get();
 	if (voltdm->abb && omap_get_nominal_voltage(new_vdata) >
 			omap_get_nominal_voltage(curr_vdata)) {
 		ret = omap_ldo_abb_pre_scale(voltdm, new_vdata);
@@ -792,20 +924,48 @@ static int _dvfs_scale(struct device *req_dev, struct device *target_dev,
 		}
 	}
 
-	/* Now decide on switching OPP */
+	/*
+	 * Now decide on switching OPP.  A higher voltage is safe at the
+	 * current rates, so it is sent before the dependent domains are
+	 * scaled, and ramps while they do: a scale up costs the longest
+	 * ramp, not the sum of them.
+	 */
 	if (curr_volt == new_volt) {
 		volt_scale_dir = DVFS_VOLT_SCALE_NONE;
 	} else if (curr_volt < new_volt) {
-		ret = voltdm_scale(voltdm, new_vdata);
+		ret = voltdm_scale_start(voltdm, new_vdata);
 		if (ret) {
 			dev_err(target_dev,
 				"%s: Unable to scale the %s to %ld volt\n",
 				__func__, voltdm->name, new_volt);
+			voltdm_scale_finish(voltdm);
 			goto fail;
 		}
 		volt_scale_dir = DVFS_VOLT_SCALE_UP;
 	}
 
+	/* Make a decision to scale dependent domain based on nominal voltage */
+	if (omap_get_nominal_voltage(new_vdata) >
+			omap_get_nominal_voltage(curr_vdata)) {
+		ktime_t dep_start = ktime_get();
+
+		ret = _dep_scale_domains(target_dev, vdd);
+		dep_us += _dvfs_stat_phase(tdvfs_info, DVFS_STAT_DEP,
+					   dep_start);
+		if (ret) {
+			dev_err(target_dev,
+				"%s: Error(%d)scale dependent with %ld volt\n",
+				__func__, ret, new_volt);
+			if (DVFS_VOLT_SCALE_UP == volt_scale_dir)
+				voltdm_scale_finish(voltdm);
+			goto fail;
+		}
+	}
+
+	/* Whatever is left of the ramp */
+	if (DVFS_VOLT_SCALE_UP == volt_scale_dir)
+		voltdm_scale_finish(voltdm);
+
 	if (voltdm->abb && omap_get_nominal_voltage(new_vdata) >
 			omap_get_nominal_voltage(curr_vdata)) {
 		ret = omap_ldo_abb_post_scale(voltdm, new_vdata);
@@ -815,6 +975,8 @@ static int _dvfs_scale(struct device *req_dev, struct device *target_dev,
 			goto fail;
 		}
 	}
+	if (DVFS_VOLT_SCALE_UP == volt_scale_dir)
+		volt_us += _dvfs_stat_phase(tdvfs_info, DVFS_STAT_VOLT, start);
 
 	/*
 	 * Move all devices in list to the required frequencies.
@@ -823,6 +985,7 @@ static int _dvfs_scale(struct device *req_dev, struct device *target_dev,
 	 * after the frequency on which they depend. In case of scaling
 	 * down to lower OPP the order of scaling frequencies is reverse.
 	 */
+	start = ktime_get();
 	dev_list = (volt_scale_dir == DVFS_VOLT_SCALE_DOWN) ?
 			tdvfs_info->dev_list.prev : tdvfs_info->dev_list.next;
 	while (dev_list != &tdvfs_info->dev_list) {
@@ -877,6 +1040,7 @@ static int _dvfs_scale(struct device *req_dev, struct device *target_dev,
 		}
 
 		r = clk_set_rate(temp_dev->clk, freq);
+		nr_clk++;
 		if (r < 0) {
 			dev_err(dev, "%s: clk set rate frq=%ld failed(%d)\n",
 				__func__, freq, r);
@@ -886,10 +1050,27 @@ next:
 		dev_list = (volt_scale_dir == DVFS_VOLT_SCALE_DOWN) ?
 				dev_list->prev : dev_list->next;
 	}
+	if (nr_clk)
+		clk_us = _dvfs_stat_phase(tdvfs_info, DVFS_STAT_CLK, start);
 
 	if (ret)
 		goto fail;
 
+	/*
+	 * Every device now runs at a rate the current voltage supports, the
+	 * reduction (and that of the dependent domains) can wait.
+	 */
+	if (DVFS_VOLT_SCALE_DOWN == volt_scale_dir && omap_dvfs_task) {
+		tdvfs_info->deferred_vdata = new_vdata;
+		tdvfs_info->deferred_dev = target_dev;
+		queue_kthread_work(&omap_dvfs_worker,
+				   &tdvfs_info->deferred_work);
+		new_vdata = curr_vdata;
+		new_volt = curr_volt;
+		goto out;
+	}
+
+	start = ktime_get();
 	if (voltdm->abb && omap_get_nominal_voltage(new_vdata) <
 			omap_get_nominal_voltage(curr_vdata)) {
 		ret = omap_ldo_abb_pre_scale(voltdm, new_vdata);
@@ -910,11 +1091,15 @@ next:
 			pr_err("%s: ABB postscale failed for vdd%s: %d\n",
 			__func__, voltdm->name, ret);
 	}
+	if (DVFS_VOLT_SCALE_DOWN == volt_scale_dir)
+		volt_us += _dvfs_stat_phase(tdvfs_info, DVFS_STAT_VOLT, start);
 
 	/* Make a decision to scale dependent domain based on nominal voltage */
 	if (omap_get_nominal_voltage(new_vdata) <
 			omap_get_nominal_voltage(curr_vdata)) {
+		start = ktime_get();
 		_dep_scale_domains(target_dev, vdd);
+		dep_us += _dvfs_stat_phase(tdvfs_info, DVFS_STAT_DEP, start);
 	}
 
 	/* Ensure that current voltage data pointer points to new volt */
@@ -934,9 +1119,101 @@ out:
 	/* Re-enable Smartreflex module */
 	omap_sr_enable(voltdm, new_vdata);
 
+	trace_dvfs_scale(voltdm->name, curr_volt, new_volt,
+			 volt_us, clk_us, dep_us);
 	return ret;
 }
 
+/**
+ * _dvfs_scale_deferred() - Lower a vdd voltage left pending by _dvfs_scale
+ * @work:	deferred_work of the vdd's omap_vdd_dvfs_info
+ *
+ * This is the part of a scale down that _dvfs_scale leaves once the
+ * frequencies are changed: ABB, voltage and dependent domains.
+ */
+static void _dvfs_scale_deferred(struct kthread_work *work)
+{
+	struct omap_vdd_dvfs_info *tdvfs_info = container_of(work,
+			struct omap_vdd_dvfs_info, deferred_work);
+	struct voltagedomain *voltdm = tdvfs_info->voltdm;
+	struct omap_volt_data *new_vdata, *curr_vdata;
+	unsigned long curr_volt;
+	u32 volt_us, dep_us = 0;
+	ktime_t start;
+	int ret;
+
+	mutex_lock(&omap_dvfs_lock);
+	new_vdata = tdvfs_info->deferred_vdata;
+	tdvfs_info->deferred_vdata = NULL;
+	/* Superseded by a scale since it was queued */
+	if (!new_vdata)
+		goto out;
+#ifdef CONFIG_OMAP4_DPLL_CASCADING
+	/* Staying on the higher voltage is always safe */
+	if (omap4_is_in_dpll_cascading())
+		goto out;
+#endif
+	curr_vdata = omap_voltage_get_curr_vdata(voltdm);
+	if (IS_ERR_OR_NULL(curr_vdata)) {
+		pr_err("%s:%s: Bad Current voltage data\n",
+			__func__, voltdm->name);
+		goto out;
+	}
+
+	pm_qos_update_request(&omap_dvfs_pm_qos_handle, 0);
+	omap_sr_disable(voltdm);
+	curr_volt = omap_vp_get_curr_volt(voltdm);
+	if (!curr_volt)
+		curr_volt = omap_get_operation_voltage(curr_vdata);
+
+	start = ktime_get();
+	if (voltdm->abb && omap_get_nominal_voltage(new_vdata) <
+			omap_get_nominal_voltage(curr_vdata)) {
+		ret = omap_ldo_abb_pre_scale(voltdm, new_vdata);
+		if (ret) {
+			pr_err("%s: ABB prescale failed for vdd%s: %d\n",
+			__func__, voltdm->name, ret);
+			new_vdata = curr_vdata;
+			goto out_sr;
+		}
+	}
+
+	voltdm_scale_start(voltdm, new_vdata);
+
+	/*
+	 * ABB can only switch once the voltage settled, without ABB the
+	 * dependent domains go down while this one ramps.
+	 */
+	if (voltdm->abb)
+		voltdm_scale_finish(voltdm);
+
+	if (voltdm->abb && omap_get_nominal_voltage(new_vdata) <
+			omap_get_nominal_voltage(curr_vdata)) {
+		ret = omap_ldo_abb_post_scale(voltdm, new_vdata);
+		if (ret)
+			pr_err("%s: ABB postscale failed for vdd%s: %d\n",
+			__func__, voltdm->name, ret);
+	}
+	volt_us = _dvfs_stat_phase(tdvfs_info, DVFS_STAT_VOLT, start);
+
+	if (omap_get_nominal_voltage(new_vdata) <
+			omap_get_nominal_voltage(curr_vdata)) {
+		start = ktime_get();
+		_dep_scale_domains(tdvfs_info->deferred_dev, voltdm->vdd);
+		dep_us = _dvfs_stat_phase(tdvfs_info, DVFS_STAT_DEP, start);
+	}
+	voltdm_scale_finish(voltdm);
+
+	trace_dvfs_scale(voltdm->name, curr_volt,
+			 omap_get_operation_voltage(new_vdata),
+			 volt_us, 0, dep_us);
+out_sr:
+	omap_sr_enable(voltdm, new_vdata);
+	pm_qos_update_request(&omap_dvfs_pm_qos_handle, PM_QOS_DEFAULT_VALUE);
+out:
+	mutex_unlock(&omap_dvfs_lock);
+}
+
 /* Public functions */
 
 /**
@@ -1034,6 +1311,8 @@ int omap_device_scale(struct device *req_dev, struct device *target_dev,
 		goto out;
 	}
 
+	_note_blocked_request(tdvfs_info, req_dev, target_dev, freq, volt);
+
 	/* Check for any dep domains and add the user request */
 	ret = _dep_scan_domains(target_dev, tdvfs_info->voltdm->vdd, volt);
 	if (ret) {
@@ -1239,6 +1518,79 @@ static struct file_operations debugdvfs_fops = {
 	.release = single_release,
 };
 
+static int dvfs_dump_stats(struct seq_file *sf, void *unused)
+{
+	static const char * const phase_name[DVFS_STAT_PHASES] = {
+		[DVFS_STAT_VOLT] = "voltage",
+		[DVFS_STAT_CLK] = "clock",
+		[DVFS_STAT_DEP] = "dependent",
+	};
+	struct omap_vdd_dvfs_info *dvfs_info = sf->private;
+	struct omap_dvfs_stats *st = &dvfs_info->stats;
+	char label[8];
+	int i, b;
+
+	mutex_lock(&omap_dvfs_lock);
+	seq_printf(sf, "vdd_%s: %lu scales\n", dvfs_info->voltdm->name,
+		   st->scales);
+	seq_printf(sf, "blocked: freq %lu (last by %s) volt %lu (last by %s)\n",
+		   st->freq_blocked,
+		   st->freq_holder ? dev_name(st->freq_holder) : "-",
+		   st->volt_blocked,
+		   st->volt_holder ? dev_name(st->volt_holder) : "-");
+
+	seq_printf(sf, "%-10s %8s %8s %8s", "phase", "count", "avg_us",
+		   "max_us");
+	for (b = 0; b < DVFS_STAT_BUCKETS; b++) {
+		snprintf(label, sizeof(label), "%s%llu",
+			 b < DVFS_STAT_BUCKETS - 1 ? "<" : ">=",
+			 log2_hist_bound(b, DVFS_STAT_BUCKETS) <<
+			 DVFS_STAT_MIN_SHIFT);
+		seq_printf(sf, " %8s", label);
+	}
+	seq_printf(sf, "\n");
+
+	for (i = 0; i < DVFS_STAT_PHASES; i++) {
+		u64 avg = 0;
+
+		if (st->count[i])
+			avg = div_u64(st->total_us[i], st->count[i]);
+		seq_printf(sf, "%-10s %8lu %8llu %8u", phase_name[i],
+			   st->count[i], avg, st->max_us[i]);
+		for (b = 0; b < DVFS_STAT_BUCKETS; b++)
+			seq_printf(sf, " %8lu", st->hist[i][b]);
+		seq_printf(sf, "\n");
+	}
+	mutex_unlock(&omap_dvfs_lock);
+	return 0;
+}
+
+static int dvfs_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvfs_dump_stats, inode->i_private);
+}
+
+/* Any write clears the statistics */
+static ssize_t dvfs_stats_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct seq_file *sf = file->private_data;
+	struct omap_vdd_dvfs_info *dvfs_info = sf->private;
+
+	mutex_lock(&omap_dvfs_lock);
+	memset(&dvfs_info->stats, 0, sizeof(dvfs_info->stats));
+	mutex_unlock(&omap_dvfs_lock);
+	return count;
+}
+
+static struct file_operations debugdvfs_stats_fops = {
+	.open = dvfs_stats_open,
+	.read = seq_read,
+	.write = dvfs_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static struct dentry __initdata *dvfsdebugfs_dir;
 
 static void __init dvfs_dbg_init(struct omap_vdd_dvfs_info *dvfs_info)
@@ -1267,6 +1619,8 @@ static void __init dvfs_dbg_init(struct omap_vdd_dvfs_info *dvfs_info)
 
 	debugfs_create_file("info", S_IRUGO, ddir,
 			    (void *)dvfs_info, &debugdvfs_fops);
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, ddir,
+			    (void *)dvfs_info, &debugdvfs_stats_fops);
 }
 #else				/* CONFIG_PM_DEBUG */
 static inline void dvfs_dbg_init(struct omap_vdd_dvfs_info *dvfs_info)
@@ -1333,6 +1687,8 @@ int __init omap_dvfs_register_device(struct device *dev, char *voltdm_name,
 		plist_head_init(&dvfs_info->vdd_user_list);
 		/* Init the device list */
 		INIT_LIST_HEAD(&dvfs_info->dev_list);
+		init_kthread_work(&dvfs_info->deferred_work,
+				  _dvfs_scale_deferred);
 
 		list_add(&dvfs_info->node, &omap_dvfs_info_list);
 
@@ -1371,10 +1727,24 @@ int __init omap_dvfs_register_device(struct device *dev, char *voltdm_name,
 
 	/* Simpler to have a single request for all domains */
 	if (!qos_create) {
+		struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+		struct task_struct *task;
+
 		pm_qos_add_request(&omap_dvfs_pm_qos_handle,
 				PM_QOS_CPU_DMA_LATENCY,
 				PM_QOS_DEFAULT_VALUE);
 		qos_create = true;
+
+		/* Without the worker voltage is lowered synchronously */
+		task = kthread_run(kthread_worker_fn, &omap_dvfs_worker,
+				   "omap_dvfs");
+		if (IS_ERR(task)) {
+			pr_warning("%s: no dvfs worker (%ld)\n", __func__,
+				   PTR_ERR(task));
+		} else {
+			sched_setscheduler_nocheck(task, SCHED_FIFO, &param);
+			omap_dvfs_task = task;
+		}
 	}
 	/* Fall through */
 out:
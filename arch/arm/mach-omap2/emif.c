@@ -21,6 +21,10 @@
 #include <linux/platform_device.h>
 #include <linux/reboot.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
 
 #include <plat/omap_hwmod.h>
 #include <plat/omap_device.h>
@@ -40,6 +44,11 @@ struct emif_instance {
 	u16 irq;
 	struct platform_device *pdev;
 	bool ddr_refresh_disabled;
+	s8 sr_timer_max;		/* board SR_TIM, -1 without self-refresh */
+	u8 sr_timer;			/* SR_TIM programmed now */
+	bool idle;			/* load is under EMIF_LOAD_IDLE */
+	u32 reads, writes, cycles;	/* last performance counter values */
+	u32 read_kbs, write_kbs, load;	/* last sample, load in permille */
 };
 static struct emif_instance emif[EMIF_NUM_INSTANCES];
 static struct emif_regs *emif_curr_regs[EMIF_NUM_INSTANCES];
@@ -50,6 +59,11 @@ static u32 emif_temperature_level[EMIF_NUM_INSTANCES] = { SDRAM_TEMP_NOMINAL,
 	SDRAM_TEMP_NOMINAL
 };
 
+static DEFINE_SPINLOCK(emif_lp_lock);	/* PWR_MGMT_CTRL updates */
+static u32 emif_max_freq;
+static struct delayed_work emif_policy_work;
+static unsigned long emif_last_sample;
+
 static u32 emif_notify_pending;
 static u32 emif_thermal_handling_pending;
 static u32 T_den, T_num;
@@ -520,6 +534,7 @@ static void set_lp_mode(u32 emif_nr, u32 lpmode)
 {
 	u32 temp;
 	void __iomem *base = emif[emif_nr].base;
+	unsigned long flags;
 
 	if (is_emif_erratum(POWER_DOWN_NOT_EFFICIENT_i743) &&
 		(LP_MODE_PWR_DN == lpmode)) {
@@ -532,6 +547,8 @@ static void set_lp_mode(u32 emif_nr, u32 lpmode)
 		lpmode = LP_MODE_SELF_REFRESH;
 	}
 
+	spin_lock_irqsave(&emif_lp_lock, flags);
+
 	/* Extract current lp mode value */
 	temp = readl(base + OMAP44XX_EMIF_PWR_MGMT_CTRL);
 
@@ -540,6 +557,36 @@ static void set_lp_mode(u32 emif_nr, u32 lpmode)
 	temp |= lpmode << OMAP44XX_REG_LP_MODE_SHIFT;
 	writel(temp, base + OMAP44XX_EMIF_PWR_MGMT_CTRL);
 
+	spin_unlock_irqrestore(&emif_lp_lock, flags);
+}
+
+/*
+ * set_sr_timer - Set the self-refresh idle timer of a EMIF instance.
+ *
+ * Both EMIF_PWR_MGMT_CTRL[7:4] REG_SR_TIM and its shadow are written,
+ * so that the next frequency update keeps the value.
+ */
+static void set_sr_timer(u32 emif_nr, u32 sr_timer)
+{
+	u32 temp;
+	void __iomem *base = emif[emif_nr].base;
+	unsigned long flags;
+
+	spin_lock_irqsave(&emif_lp_lock, flags);
+
+	temp = __raw_readl(base + OMAP44XX_EMIF_PWR_MGMT_CTRL_SHDW);
+	mask_n_set(temp, OMAP44XX_REG_SR_TIM_SHDW_SHIFT,
+		   OMAP44XX_REG_SR_TIM_SHDW_MASK, sr_timer);
+	__raw_writel(temp, base + OMAP44XX_EMIF_PWR_MGMT_CTRL_SHDW);
+
+	temp = readl(base + OMAP44XX_EMIF_PWR_MGMT_CTRL);
+	mask_n_set(temp, OMAP44XX_REG_SR_TIM_SHIFT,
+		   OMAP44XX_REG_SR_TIM_MASK, sr_timer);
+	writel(temp, base + OMAP44XX_EMIF_PWR_MGMT_CTRL);
+
+	spin_unlock_irqrestore(&emif_lp_lock, flags);
+
+	emif[emif_nr].sr_timer = sr_timer;
 }
 
 /*
@@ -1089,6 +1136,8 @@ static int do_emif_setup_registers(u32 emif_nr, u32 freq, u32 volt_state)
 		return -ENOMEM;
 
 	emif_curr_regs[emif_nr] = regs;
+	if (freq > emif_max_freq)
+		emif_max_freq = freq;
 	setup_registers(emif_nr, regs, volt_state);
 	setup_temperature_sensitive_regs(emif_nr, regs);
 
@@ -1422,6 +1471,9 @@ static void __init setup_lowpower_regs(u32 emif_nr,
 					" cycles\n", __func__,
 					16 << (EMIF_ERRATUM_SR_TIMER_MIN - 1));
 		}
+		emif[emif_nr].sr_timer_max = ddr_sr_timer;
+		emif[emif_nr].sr_timer = ddr_sr_timer;
+
 		/* Program the idle delay */
 		temp = __raw_readl(base + OMAP44XX_EMIF_PWR_MGMT_CTRL_SHDW);
 		mask_n_set(temp, OMAP44XX_REG_SR_TIM_SHDW_SHIFT,
@@ -1438,6 +1490,7 @@ static void __init setup_lowpower_regs(u32 emif_nr,
 		set_lp_mode(emif_nr, LP_MODE_SELF_REFRESH);
 	} else {
 		/* Disable Automatic power management if < 0 */
+		emif[emif_nr].sr_timer_max = -1;
 
 		/* Program the idle delay to 0x0 */
 		temp = __raw_readl(base + OMAP44XX_EMIF_PWR_MGMT_CTRL_SHDW);
@@ -1450,6 +1503,181 @@ static void __init setup_lowpower_regs(u32 emif_nr,
 	}
 }
 
+/*
+ * Adaptive self-refresh policy
+ *
+ * The board self-refresh idle timer is kept while the DDR is loaded, so
+ * that bursts do not pay for self-refresh exits.  Once the load sampled
+ * from the EMIF performance counters stays under EMIF_LOAD_IDLE, the
+ * timer is cut by EMIF_SR_TIM_IDLE_STEPS, each step halving it, and the
+ * SDRAM self-refreshes sooner.  It goes back over EMIF_LOAD_BUSY.  The
+ * timer counts DDR cycles, so it is also cut by a step for every halving
+ * of the DDR clock by DVFS, to keep the same timeout in time.
+ */
+#define EMIF_POLICY_MS			200
+#define EMIF_LOAD_IDLE			50	/* permille */
+#define EMIF_LOAD_BUSY			200	/* permille */
+#define EMIF_SR_TIM_IDLE_STEPS		4
+
+#define EMIF_PERF_CNT_CFG_READS		0x2
+#define EMIF_PERF_CNT_CFG_WRITES	0x3
+/* a BL8 burst on the 32 bit bus: 32 bytes in 2 EMIF clock cycles */
+#define EMIF_ACCESS_BYTES		32
+#define EMIF_ACCESS_CYCLES		2
+
+static void __init start_perf_counters(u32 emif_nr)
+{
+	void __iomem *base = emif[emif_nr].base;
+	u32 cfg = 0;
+
+	mask_n_set(cfg, OMAP44XX_REG_CNTR1_CFG_SHIFT,
+		   OMAP44XX_REG_CNTR1_CFG_MASK, EMIF_PERF_CNT_CFG_READS);
+	mask_n_set(cfg, OMAP44XX_REG_CNTR2_CFG_SHIFT,
+		   OMAP44XX_REG_CNTR2_CFG_MASK, EMIF_PERF_CNT_CFG_WRITES);
+	__raw_writel(cfg, base + OMAP44XX_EMIF_PERF_CNT_CFG);
+	__raw_writel(0, base + OMAP44XX_EMIF_PERF_CNT_SEL);
+
+	emif[emif_nr].reads = __raw_readl(base + OMAP44XX_EMIF_PERF_CNT_1);
+	emif[emif_nr].writes = __raw_readl(base + OMAP44XX_EMIF_PERF_CNT_2);
+	emif[emif_nr].cycles = __raw_readl(base + OMAP44XX_EMIF_PERF_CNT_TIM);
+}
+
+static void sample_perf_counters(u32 emif_nr, u32 ms)
+{
+	struct emif_instance *e = &emif[emif_nr];
+	u32 reads, writes, cycles;
+
+	reads = __raw_readl(e->base + OMAP44XX_EMIF_PERF_CNT_1);
+	writes = __raw_readl(e->base + OMAP44XX_EMIF_PERF_CNT_2);
+	cycles = __raw_readl(e->base + OMAP44XX_EMIF_PERF_CNT_TIM);
+
+	/* the counters are free running, deltas survive a wrap */
+	e->read_kbs = div_u64((u64)(reads - e->reads) * EMIF_ACCESS_BYTES, ms);
+	e->write_kbs = div_u64((u64)(writes - e->writes) * EMIF_ACCESS_BYTES,
+			       ms);
+	e->load = cycles == e->cycles ? 0 :
+		div_u64((u64)(reads - e->reads + writes - e->writes) *
+			EMIF_ACCESS_CYCLES * 1000, cycles - e->cycles);
+
+	e->reads = reads;
+	e->writes = writes;
+	e->cycles = cycles;
+}
+
+static void update_sr_timer(u32 emif_nr)
+{
+	struct emif_instance *e = &emif[emif_nr];
+	u32 freq, steps = 0, sr_timer, floor;
+
+	if (e->load < EMIF_LOAD_IDLE)
+		e->idle = true;
+	else if (e->load > EMIF_LOAD_BUSY)
+		e->idle = false;
+	if (e->idle)
+		steps = EMIF_SR_TIM_IDLE_STEPS;
+
+	/* the current CORE OPP, as the DDR clock it runs at */
+	freq = emif_curr_regs[emif_nr] ? emif_curr_regs[emif_nr]->freq : 0;
+	for (; freq && (freq << 1) <= emif_max_freq; freq <<= 1)
+		steps++;
+
+	floor = is_emif_erratum(SR_TIMER_i735) ? EMIF_ERRATUM_SR_TIMER_MIN : 1;
+	floor = min_t(u32, floor, e->sr_timer_max);
+	sr_timer = e->sr_timer_max > steps ? e->sr_timer_max - steps : 0;
+	sr_timer = max(sr_timer, floor);
+
+	if (sr_timer != e->sr_timer)
+		set_sr_timer(emif_nr, sr_timer);
+}
+
+static void emif_policy_work_fn(struct work_struct *work)
+{
+	u32 ms = max(jiffies_to_msecs(jiffies - emif_last_sample), 1U);
+	int emif_nr;
+
+	emif_last_sample = jiffies;
+	for (emif_nr = EMIF1; emif_nr < EMIF_NUM_INSTANCES; emif_nr++) {
+		if (!emif_devices[emif_nr])
+			continue;
+		sample_perf_counters(emif_nr, ms);
+		if (emif[emif_nr].sr_timer_max >= 0)
+			update_sr_timer(emif_nr);
+	}
+
+	schedule_delayed_work(&emif_policy_work,
+			      msecs_to_jiffies(EMIF_POLICY_MS));
+}
+
+static int emif_dev_to_nr(struct device *dev)
+{
+	int emif_nr;
+
+	for (emif_nr = EMIF1; emif_nr < EMIF_NUM_INSTANCES; emif_nr++)
+		if (emif[emif_nr].pdev && dev == &emif[emif_nr].pdev->dev)
+			return emif_nr;
+	return -ENODEV;
+}
+
+static ssize_t emif_bandwidth_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	int emif_nr = emif_dev_to_nr(dev);
+
+	if (emif_nr < 0)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%u %u\n", emif[emif_nr].read_kbs,
+			emif[emif_nr].write_kbs);
+}
+static DEVICE_ATTR(bandwidth, S_IRUGO, emif_bandwidth_show, NULL);
+
+static ssize_t emif_load_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	int emif_nr = emif_dev_to_nr(dev);
+
+	if (emif_nr < 0)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", emif[emif_nr].load);
+}
+static DEVICE_ATTR(load, S_IRUGO, emif_load_show, NULL);
+
+static ssize_t emif_sr_timer_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	int emif_nr = emif_dev_to_nr(dev);
+
+	if (emif_nr < 0 || emif[emif_nr].sr_timer_max < 0)
+		return snprintf(buf, PAGE_SIZE, "disabled\n");
+
+	/* as cycles: 16 for 1, 32 for 2 ... */
+	return snprintf(buf, PAGE_SIZE, "%u\n", emif[emif_nr].sr_timer ?
+			8 << emif[emif_nr].sr_timer : 0);
+}
+static DEVICE_ATTR(sr_timer, S_IRUGO, emif_sr_timer_show, NULL);
+
+static struct attribute *emif_policy_attrs[] = {
+	&dev_attr_bandwidth.attr,
+	&dev_attr_load.attr,
+	&dev_attr_sr_timer.attr,
+	NULL,
+};
+
+static const struct attribute_group emif_policy_group = {
+	.attrs = emif_policy_attrs,
+};
+
+static void __init init_emif_policy(u32 emif_nr)
+{
+	if (!emif_devices[emif_nr])
+		return;
+
+	start_perf_counters(emif_nr);
+	WARN_ON(sysfs_create_group(&emif[emif_nr].pdev->dev.kobj,
+				   &emif_policy_group));
+}
+
 /*
  * omap_init_emif_timings - reprogram EMIF timing parameters
  *
@@ -1495,6 +1723,13 @@ static int __init omap_init_emif_timings(void)
 		setup_lowpower_regs(EMIF2, emif_devices[EMIF2]);
 	}
 
+	init_emif_policy(EMIF1);
+	init_emif_policy(EMIF2);
+	emif_last_sample = jiffies;
+	INIT_DELAYED_WORK_DEFERRABLE(&emif_policy_work, emif_policy_work_fn);
+	schedule_delayed_work(&emif_policy_work,
+			      msecs_to_jiffies(EMIF_POLICY_MS));
+
 	clk_put(dpll_core_m2_clk);
 
 	return ret;
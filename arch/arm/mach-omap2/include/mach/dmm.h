@@ -138,6 +138,33 @@ struct dmm *dmm_pat_init(u32 id);
  */
 s32 dmm_pat_refill(struct dmm *dmm, struct pat *desc, enum pat_mode mode);
 
+/**
+ * Program the physical address translator for a list of areas at once.
+ * @param dmm      Device data
+ * @param desc     array of PAT descriptors, in coherent memory
+ * @param desc_pa  physical address of desc, 16 aligned
+ * @param n        number of descriptors
+ * @return an error status.
+ */
+s32 dmm_pat_refill_list(struct dmm *dmm, struct pat *desc, u32 desc_pa,
+			u32 n);
+
+/**
+ * PAT refill statistics.
+ */
+struct dmm_pat_stats {
+	u32 refills;		/* refill operations */
+	u32 areas;		/* areas refilled by them */
+	u32 max_ns;		/* longest refill */
+	u64 total_ns;		/* time spent refilling */
+};
+
+/**
+ * Get the PAT refill statistics.
+ * @param stats  where they are stored
+ */
+void dmm_pat_get_stats(struct dmm_pat_stats *stats);
+
 /**
  * Clean up the physical address translator.
  * @param dmm    Device data
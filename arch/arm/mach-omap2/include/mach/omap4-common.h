@@ -68,6 +68,8 @@ static inline void __iomem *omap4_get_scu_base(void)
 extern void __iomem *omap4_get_gic_dist_base(void);
 extern void __iomem *omap4_get_gic_cpu_base(void);
 extern void __iomem *omap4_get_sar_ram_base(void);
+extern void omap4_sar_update(u32 val, u32 offset);
+extern void omap4_sar_update_stats(u32 *written, u32 *skipped);
 extern void *omap_get_dram_barrier_base(void);
 extern dma_addr_t omap4_secure_ram_phys;
 extern void __init gic_init_irq(void);
@@ -245,6 +245,17 @@ static u32 omap2_get_pte_attr(struct iotlb_entry *e)
 	return attr;
 }
 
+/* the other way round: @e's pgsz is that of the entry @pte comes from */
+static void omap2_pte_to_e(u32 pte, struct iotlb_entry *e)
+{
+	pte >>= (((e->pgsz == MMU_CAM_PGSZ_4K) ||
+			(e->pgsz == MMU_CAM_PGSZ_64K)) ? 0 : 6);
+
+	e->mixed = (pte >> 5) & MMU_RAM_MIXED_MASK;
+	e->endian = pte & MMU_RAM_ENDIAN_MASK;
+	e->elsz = (pte << 3) & MMU_RAM_ELSZ_MASK;
+}
+
 static ssize_t omap2_dump_cr(struct iommu *obj, struct cr_regs *cr, char *buf)
 {
 	char *p = buf;
@@ -350,6 +361,7 @@ static const struct iommu_functions omap2_iommu_ops = {
 	.dump_cr	= omap2_dump_cr,
 
 	.get_pte_attr	= omap2_get_pte_attr,
+	.pte_to_e	= omap2_pte_to_e,
 
 	.save_ctx	= omap2_iommu_save_ctx,
 	.restore_ctx	= omap2_iommu_restore_ctx,
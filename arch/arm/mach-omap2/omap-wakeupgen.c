@@ -58,11 +58,6 @@ static inline void wakeupgen_writel(u32 val, u8 idx, u32 cpu)
 				(cpu * CPU_ENA_OFFSET) + (idx * 4));
 }
 
-static inline void sar_writel(u32 val, u32 offset, u8 idx)
-{
-	__raw_writel(val, sar_base + offset + (idx * 4));
-}
-
 static void _wakeupgen_set_all(unsigned int cpu, unsigned int reg)
 {
 	u8 i;
@@ -271,9 +266,9 @@ void omap_wakeupgen_save(void)
 	for (i = 0; i < NR_BANKS; i++) {
 		/* Save the CPUx interrupt mask for IRQ 0 to 127 */
 		val = wakeupgen_readl(i, 0);
-		sar_writel(val, WAKEUPGENENB_OFFSET_CPU0, i);
+		omap4_sar_update(val, WAKEUPGENENB_OFFSET_CPU0 + i * 4);
 		val = wakeupgen_readl(i, 1);
-		sar_writel(val, WAKEUPGENENB_OFFSET_CPU1, i);
+		omap4_sar_update(val, WAKEUPGENENB_OFFSET_CPU1 + i * 4);
 
 		/*
 		 * Disable the secure interrupts for CPUx. The restore
@@ -282,27 +277,21 @@ void omap_wakeupgen_save(void)
 		 * to be enabled from HLOS. So overwrite the SAR location
 		 * so that the secure interrupt remains disabled.
 		 */
-		sar_writel(0x0, WAKEUPGENENB_SECURE_OFFSET_CPU0, i);
-		sar_writel(0x0, WAKEUPGENENB_SECURE_OFFSET_CPU1, i);
+		omap4_sar_update(0x0, WAKEUPGENENB_SECURE_OFFSET_CPU0 + i * 4);
+		omap4_sar_update(0x0, WAKEUPGENENB_SECURE_OFFSET_CPU1 + i * 4);
 	}
 
 	/* Save AuxBoot* registers */
 	val = __raw_readl(wakeupgen_base + OMAP_AUX_CORE_BOOT_0);
-	__raw_writel(val, sar_base + AUXCOREBOOT0_OFFSET);
-	val = __raw_readl(wakeupgen_base + OMAP_AUX_CORE_BOOT_0);
-	__raw_writel(val, sar_base + AUXCOREBOOT1_OFFSET);
-
-	/* Save SyncReq generation logic */
-	val = __raw_readl(wakeupgen_base + OMAP_AUX_CORE_BOOT_0);
-	__raw_writel(val, sar_base + AUXCOREBOOT0_OFFSET);
+	omap4_sar_update(val, AUXCOREBOOT0_OFFSET);
 	val = __raw_readl(wakeupgen_base + OMAP_AUX_CORE_BOOT_0);
-	__raw_writel(val, sar_base + AUXCOREBOOT1_OFFSET);
+	omap4_sar_update(val, AUXCOREBOOT1_OFFSET);
 
 	/* Save SyncReq generation logic */
 	val = __raw_readl(wakeupgen_base + OMAP_PTMSYNCREQ_MASK);
-	__raw_writel(val, sar_base + PTMSYNCREQ_MASK_OFFSET);
+	omap4_sar_update(val, PTMSYNCREQ_MASK_OFFSET);
 	val = __raw_readl(wakeupgen_base + OMAP_PTMSYNCREQ_EN);
-	__raw_writel(val, sar_base + PTMSYNCREQ_EN_OFFSET);
+	omap4_sar_update(val, PTMSYNCREQ_EN_OFFSET);
 
 	/* Set the Backup Bit Mask status */
 	val = __raw_readl(sar_base + SAR_BACKUP_STATUS_OFFSET);
@@ -31,6 +31,9 @@
 #include <linux/thermal_framework.h>
 #include <linux/platform_device.h>
 #include <linux/omap4_duty_cycle.h>
+#include <linux/slab.h>
+#include <linux/tick.h>
+#include <linux/math64.h>
 
 #include <asm/system.h>
 #include <asm/smp_plat.h>
@@ -63,6 +66,7 @@ static struct lpj_info global_lpj_ref;
 #endif
 
 static struct cpufreq_frequency_table *freq_table;
+static unsigned int *freq_energy;
 static atomic_t freq_table_users = ATOMIC_INIT(0);
 static struct clk *mpu_clk;
 static char *mpu_clk_name;
@@ -335,85 +339,124 @@ static struct early_suspend omap_cpu_early_suspend_handler = {
 
 static inline void freq_table_free(void)
 {
-	if (atomic_dec_and_test(&freq_table_users))
+	if (atomic_dec_and_test(&freq_table_users)) {
 		opp_free_cpufreq_table(mpu_dev, &freq_table);
+		kfree(freq_energy);
+		freq_energy = NULL;
+	}
 }
 
-#if defined(CONFIG_OMAP_THERMAL) || defined(CONFIG_OMAP4_DUTY_CYCLE)
-void omap_thermal_step_freq_down(void)
+/*
+ * Energy per cycle of each OPP, estimated from its voltage as C * V^2 for a
+ * 1nF effective capacitance.  Only the ordering matters to the governors:
+ * with leakage left out, OPPs sharing a voltage cost the same per cycle and
+ * the lower ones are reported as inefficient.
+ */
+static unsigned int *omap_cpufreq_energy_table(void)
 {
-	unsigned int cur;
-
-	if (!omap_cpufreq_ready) {
-		pr_warn_once("%s: Thermal throttle prior to CPUFREQ ready\n",
-			     __func__);
-		return;
+	unsigned int *energy;
+	int i, n;
+
+	for (n = 0; freq_table[n].frequency != CPUFREQ_TABLE_END; n++)
+		;
+
+	energy = kcalloc(n, sizeof(*energy), GFP_KERNEL);
+	if (!energy)
+		return NULL;
+
+	rcu_read_lock();
+	for (i = 0; i < n; i++) {
+		unsigned long freq = freq_table[i].frequency * 1000;
+		unsigned long mv;
+		struct opp *opp;
+
+		if (freq_table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+		opp = opp_find_freq_exact(mpu_dev, freq, true);
+		if (IS_ERR(opp)) {
+			rcu_read_unlock();
+			kfree(energy);
+			return NULL;
+		}
+		mv = opp_get_voltage(opp) / 1000;
+		energy[i] = mv * mv / 1000;
 	}
+	rcu_read_unlock();
 
-	mutex_lock(&omap_cpufreq_lock);
-
-	max_thermal = omap_thermal_lower_speed();
+	return energy;
+}
 
-	pr_warn("%s: temperature too high, starting cpu throttling at max %u\n",
-		__func__, max_thermal);
+#if defined(CONFIG_OMAP_THERMAL) || defined(CONFIG_OMAP4_DUTY_CYCLE)
+/*
+ * omap_thermal_level_to_freq: frequency cap for a cooling level
+ * @param cooling_level: number of OPPs to step down from the maximum
+ *
+ * Levels past the lowest OPP are clamped to it.
+*/
+static unsigned int omap_thermal_level_to_freq(int cooling_level)
+{
+	unsigned int freq = max_freq;
+	unsigned int lower;
+	int i;
 
-	if (!omap_cpufreq_suspended) {
-		cur = omap_getspeed(0);
-		if (cur > max_thermal)
-			omap_cpufreq_scale(max_thermal, cur);
+	while (cooling_level-- > 0) {
+		lower = 0;
+		for (i = 0; freq_table[i].frequency != CPUFREQ_TABLE_END; i++)
+			if (freq_table[i].frequency > lower &&
+			    freq_table[i].frequency < freq)
+				lower = freq_table[i].frequency;
+		if (!lower)
+			break;
+		freq = lower;
 	}
 
-	mutex_unlock(&omap_cpufreq_lock);
+	return freq;
 }
 
-void omap_thermal_step_freq_up(void)
+/*
+ * cpufreq_apply_cooling: based on requested cooling level, throttle the cpu
+ * @param cooling_level: number of OPPs to step down from the maximum
+ *
+ * The maximum cpu frequency will be readjusted based on the required
+ * cooling_level.  The level is absolute, so a governor can walk the cap
+ * down and back up one OPP at a time instead of releasing the throttle
+ * all at once.
+*/
+static int cpufreq_apply_cooling(struct thermal_dev *dev,
+				int cooling_level)
 {
 	unsigned int cur;
 
-	if (!omap_cpufreq_ready)
-		return;
+	if (cooling_level < 0)
+		cooling_level = 0;
+
+	if (!omap_cpufreq_ready) {
+		pr_warn_once("%s: Thermal throttle prior to CPUFREQ ready\n",
+			     __func__);
+		return -EAGAIN;
+	}
 
 	mutex_lock(&omap_cpufreq_lock);
 
-	if (max_thermal == max_freq) {
-		pr_warn("%s: not throttling\n", __func__);
+	if (cooling_level == current_cooling_level)
 		goto out;
-	}
 
-	max_thermal = max_freq;
+	max_thermal = omap_thermal_level_to_freq(cooling_level);
+
+	pr_info("%s: cool level %i -> %i, cpu max %u\n", __func__,
+		current_cooling_level, cooling_level, max_thermal);
 
-	pr_warn("%s: temperature reduced, stepping up to %i\n",
-		__func__, current_target_freq);
+	current_cooling_level = cooling_level;
 
 	if (!omap_cpufreq_suspended) {
 		cur = omap_getspeed(0);
-		omap_cpufreq_scale(current_target_freq, cur);
+		if (cur > max_thermal)
+			omap_cpufreq_scale(max_thermal, cur);
+		else if (current_target_freq > cur)
+			omap_cpufreq_scale(current_target_freq, cur);
 	}
 out:
 	mutex_unlock(&omap_cpufreq_lock);
-}
-
-/*
- * cpufreq_apply_cooling: based on requested cooling level, throttle the cpu
- * @param cooling_level: percentage of required cooling at the moment
- *
- * The maximum cpu frequency will be readjusted based on the required
- * cooling_level.
-*/
-static int cpufreq_apply_cooling(struct thermal_dev *dev,
-				int cooling_level)
-{
-	if (cooling_level < current_cooling_level) {
-		pr_err("%s: Unthrottle cool level %i curr cool %i\n",
-			__func__, cooling_level, current_cooling_level);
-		omap_thermal_step_freq_up();
-	} else if (cooling_level > current_cooling_level) {
-		pr_err("%s: Throttle cool level %i curr cool %i\n",
-			__func__, cooling_level, current_cooling_level);
-		omap_thermal_step_freq_down();
-	}
-
-	current_cooling_level = cooling_level;
 
 	return 0;
 }
@@ -445,13 +488,55 @@ static void __exit omap_duty_cooling_exit(void) { }
 
 #ifdef CONFIG_OMAP_THERMAL
 
+#ifdef CONFIG_OMAP_POWER_BUDGET
+static DEFINE_PER_CPU(u64, cooling_prev_idle);
+static DEFINE_PER_CPU(u64, cooling_prev_wall);
+
+/*
+ * cpufreq_cooling_load: busiest online cpu, in percent, since the last call
+ * for the power budget to split against the GPU.
+ */
+static int cpufreq_cooling_load(struct thermal_dev *dev)
+{
+	u64 idle, wall, d_idle, d_wall;
+	int cpu, load, max_load = 0;
+
+	for_each_online_cpu(cpu) {
+		idle = get_cpu_idle_time_us(cpu, &wall);
+		if (idle == -1ULL)
+			return -EOPNOTSUPP;
+
+		d_idle = idle - per_cpu(cooling_prev_idle, cpu);
+		d_wall = wall - per_cpu(cooling_prev_wall, cpu);
+		per_cpu(cooling_prev_idle, cpu) = idle;
+		per_cpu(cooling_prev_wall, cpu) = wall;
+
+		if (!d_wall || d_idle > d_wall)
+			continue;
+
+		load = div64_u64(100 * (d_wall - d_idle), d_wall);
+		max_load = max(max_load, load);
+	}
+
+	return max_load;
+}
+#endif
+
 static struct thermal_dev_ops cpufreq_cooling_ops = {
 	.cool_device = cpufreq_apply_cooling,
+#ifdef CONFIG_OMAP_POWER_BUDGET
+	.get_load = cpufreq_cooling_load,
+#endif
 };
 
 static struct thermal_dev thermal_dev = {
 	.name		= "cpufreq_cooling",
+#ifdef CONFIG_OMAP_POWER_BUDGET
+	/* cooled by the power budget, which splits the cpu domain level */
+	.domain_name	= "mpu",
+#else
 	.domain_name	= "cpu",
+#endif
 	.dev_ops	= &cpufreq_cooling_ops,
 };
 
@@ -500,6 +585,10 @@ static int __cpuinit omap_cpu_init(struct cpufreq_policy *policy)
 
 	cpufreq_frequency_table_get_attr(freq_table, policy->cpu);
 
+	if (!freq_energy)
+		freq_energy = omap_cpufreq_energy_table();
+	cpufreq_frequency_table_set_energy(freq_energy, policy->cpu);
+
 	policy->min = 384000;
 	policy->max = 1228800;
 	policy->cur = omap_getspeed(policy->cpu);
@@ -607,6 +696,7 @@ static struct freq_attr omap_UV_mV_table = {
 
 static struct freq_attr *omap_cpufreq_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
+	&cpufreq_freq_attr_scaling_energy_per_cycle,
 	&omap_cpufreq_attr_screen_off_freq,
 #ifdef CONFIG_CUSTOM_VOTAGE
        &omap_UV_mV_table,
@@ -42,6 +42,11 @@
 #include <linux/errno.h>
 #include <linux/linkage.h>
 #include <linux/smp.h>
+#include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+#include <linux/log2_hist.h>
 
 #include <asm/cacheflush.h>
 #include <linux/dma-mapping.h>
@@ -99,8 +104,30 @@ static u32 max_spi_irq, max_spi_reg;
 struct omap4_cpu_pm_info {
 	struct powerdomain *pwrdm;
 	void __iomem *scu_sar_addr;
+	u32 scu_pwr_st;
+};
+
+/*
+ * Latency of omap4_enter_lowpower() per save_state: entry up to the
+ * low level suspend, exit from its return, not counting the time the
+ * hardware and ROM code take to bring the CPU back.  Histograms in
+ * powers of two microseconds from 32us.
+ */
+#define MPUSS_SAVE_STATES		4
+#define MPUSS_LAT_BINS			8
+
+struct mpuss_lat_stats {
+	unsigned int count;
+	u64 entry_total_us;
+	u64 exit_total_us;
+	u32 entry_max_us;
+	u32 exit_max_us;
+	unsigned int entry_hist[MPUSS_LAT_BINS];
+	unsigned int exit_hist[MPUSS_LAT_BINS];
 };
 
+static DEFINE_PER_CPU(struct mpuss_lat_stats [MPUSS_SAVE_STATES], mpuss_lat);
+
 static void __iomem *gic_dist_base;
 static void __iomem *gic_cpu_base;
 static void __iomem *sar_base;
@@ -117,6 +144,12 @@ static inline void sar_writel(u32 val, u32 offset, u8 idx)
 	__raw_writel(val, sar_base + offset + 4 * idx);
 }
 
+/* GIC context words go through omap4_sar_update(), only written if changed */
+static inline void gic_sar_save(u32 val, u32 offset, u8 idx)
+{
+	omap4_sar_update(val, offset + 4 * idx);
+}
+
 static inline u32 gic_readl(u32 offset, u8 idx)
 {
 	return __raw_readl(gic_dist_base + offset + 4 * idx);
@@ -204,7 +237,11 @@ static void scu_pwrst_prepare(unsigned int cpu_id, unsigned int cpu_state)
 		break;
 	}
 
+	/* SAR RAM keeps it, and it is slow to write */
+	if (scu_pwr_st == pm_info->scu_pwr_st)
+		return;
 	__raw_writel(scu_pwr_st, pm_info->scu_sar_addr);
+	pm_info->scu_pwr_st = scu_pwr_st;
 }
 
 static void gic_save_ppi(void)
@@ -293,15 +330,15 @@ static void gic_save_context(void)
 
 	/* Save CPU 0 Interrupt Set Enable register */
 	val = gic_readl(GIC_DIST_ENABLE_SET, 0);
-	sar_writel(val, ICDISER_CPU0_OFFSET, 0);
+	gic_sar_save(val, ICDISER_CPU0_OFFSET, 0);
 
 	/* Disable interrupts on CPU1 */
-	sar_writel(GIC_MASK_ALL, ICDISER_CPU1_OFFSET, 0);
+	gic_sar_save(GIC_MASK_ALL, ICDISER_CPU1_OFFSET, 0);
 
 	/* Save all SPI Set Enable register */
 	for (i = 0; i < max_spi_reg; i++) {
 		val = gic_readl(GIC_DIST_ENABLE_SET + SPI_ENABLE_SET_OFFSET, i);
-		sar_writel(val, ICDISER_SPI_OFFSET, i);
+		gic_sar_save(val, ICDISER_SPI_OFFSET, i);
 	}
 
 	/*
@@ -318,33 +355,33 @@ static void gic_save_context(void)
 		val = gic_readl(GIC_DIST_PRI, i);
 
 		/* Save the priority bits of the Interrupts */
-		sar_writel(val >> 0x1, ICDIPR_SFI_CPU0_OFFSET, i);
+		gic_sar_save(val >> 0x1, ICDIPR_SFI_CPU0_OFFSET, i);
 
 		/* Disable the interrupts on CPU1 */
-		sar_writel(GIC_MASK_ALL, ICDIPR_SFI_CPU1_OFFSET, i);
+		gic_sar_save(GIC_MASK_ALL, ICDIPR_SFI_CPU1_OFFSET, i);
 	}
 
 	/* Save PPI priority registers (Private Peripheral Intterupts) */
 	val = gic_readl(GIC_DIST_PRI + PPI_PRI_OFFSET, 0);
-	sar_writel(val >> 0x1, ICDIPR_PPI_CPU0_OFFSET, 0);
-	sar_writel(GIC_MASK_ALL, ICDIPR_PPI_CPU1_OFFSET, 0);
+	gic_sar_save(val >> 0x1, ICDIPR_PPI_CPU0_OFFSET, 0);
+	gic_sar_save(GIC_MASK_ALL, ICDIPR_PPI_CPU1_OFFSET, 0);
 
 	/* SPI priority registers - 4 interrupts/register */
 	for (i = 0; i < (max_spi_irq / 4); i++) {
 		val = gic_readl((GIC_DIST_PRI + SPI_PRI_OFFSET), i);
-		sar_writel(val >> 0x1, ICDIPR_SPI_OFFSET, i);
+		gic_sar_save(val >> 0x1, ICDIPR_SPI_OFFSET, i);
 	}
 
 	/* SPI Interrupt Target registers - 4 interrupts/register */
 	for (i = 0; i < (max_spi_irq / 4); i++) {
 		val = gic_readl((GIC_DIST_TARGET + SPI_TARGET_OFFSET), i);
-		sar_writel(val, ICDIPTR_SPI_OFFSET, i);
+		gic_sar_save(val, ICDIPTR_SPI_OFFSET, i);
 	}
 
 	/* SPI Interrupt Congigeration eegisters- 16 interrupts/register */
 	for (i = 0; i < (max_spi_irq / 16); i++) {
 		val = gic_readl((GIC_DIST_CONFIG + SPI_CONFIG_OFFSET), i);
-		sar_writel(val, ICDICFR_OFFSET, i);
+		gic_sar_save(val, ICDICFR_OFFSET, i);
 	}
 
 	/* Set the Backup Bit Mask status for GIC */
@@ -471,6 +508,29 @@ static inline void restore_l3instr_regs(void)
 		__raw_writel(l3instr_reg[i].val, l3instr_reg[i].addr);
 }
 
+static unsigned int mpuss_lat_bin(u32 us)
+{
+	return log2_hist_bucket(us >> 5, MPUSS_LAT_BINS);
+}
+
+static void mpuss_lat_account(unsigned int cpu, unsigned int save_state,
+			      u64 start, u64 suspend, u64 resume)
+{
+	struct mpuss_lat_stats *st = &per_cpu(mpuss_lat, cpu)[save_state];
+	u32 entry = div_u64(suspend - start, NSEC_PER_USEC);
+	u32 exit = div_u64(sched_clock() - resume, NSEC_PER_USEC);
+
+	st->count++;
+	st->entry_total_us += entry;
+	st->exit_total_us += exit;
+	if (entry > st->entry_max_us)
+		st->entry_max_us = entry;
+	if (exit > st->exit_max_us)
+		st->exit_max_us = exit;
+	st->entry_hist[mpuss_lat_bin(entry)]++;
+	st->exit_hist[mpuss_lat_bin(exit)]++;
+}
+
 /*
  * OMAP4 MPUSS Low Power Entry Function
  *
@@ -499,10 +559,13 @@ int omap4_enter_lowpower(unsigned int cpu, unsigned int power_state)
 	unsigned int save_state = 0;
 	unsigned int wakeup_cpu;
 	unsigned int inst_clk_enab = 0;
+	u64 t_start = 0, t_suspend = 0, t_resume = 0;
 
 	if ((cpu >= NR_CPUS) || (omap_rev() == OMAP4430_REV_ES1_0))
 		goto ret;
 
+	t_start = sched_clock();
+
 	switch (power_state) {
 	case PWRDM_POWER_ON:
 	case PWRDM_POWER_INACTIVE:
@@ -628,7 +691,9 @@ cpu_prepare:
 	 * and its low power state.
 	 */
 	stop_critical_timings();
+	t_suspend = sched_clock();
 	omap4_cpu_suspend(cpu, save_state);
+	t_resume = sched_clock();
 	start_critical_timings();
 
 	/*
@@ -709,6 +774,9 @@ cpu_prepare:
 	pwrdm_post_transition();
 
 ret:
+	if (t_resume)
+		mpuss_lat_account(cpu, save_state, t_start, t_suspend,
+				  t_resume);
 	return 0;
 }
 
@@ -760,6 +828,7 @@ int __init omap4_mpuss_init(void)
 	/* Initilaise per CPU PM information */
 	pm_info = &per_cpu(omap4_pm_info, 0x0);
 	pm_info->scu_sar_addr = sar_base + SCU_OFFSET0;
+	pm_info->scu_pwr_st = ~0;
 	pm_info->pwrdm = pwrdm_lookup("cpu0_pwrdm");
 	if (!pm_info->pwrdm) {
 		pr_err("Lookup failed for CPU0 pwrdm\n");
@@ -775,6 +844,7 @@ int __init omap4_mpuss_init(void)
 
 	pm_info = &per_cpu(omap4_pm_info, 0x1);
 	pm_info->scu_sar_addr = sar_base + SCU_OFFSET1;
+	pm_info->scu_pwr_st = ~0;
 	pm_info->pwrdm = pwrdm_lookup("cpu1_pwrdm");
 	if (!pm_info->pwrdm) {
 		pr_err("Lookup failed for CPU1 pwrdm\n");
@@ -856,5 +926,76 @@ int __init omap4_mpuss_init(void)
 	return 0;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static const char * const mpuss_save_state_names[MPUSS_SAVE_STATES] = {
+	"INACTIVE", "CSWR", "OSWR", "OFF",
+};
+
+static void mpuss_lat_show_hist(struct seq_file *s, const char *name,
+				const unsigned int *hist)
+{
+	int i;
+
+	seq_printf(s, "    %s:", name);
+	for (i = 0; i < MPUSS_LAT_BINS; i++)
+		seq_printf(s, " %u", hist[i]);
+	seq_printf(s, "\n");
+}
+
+static int mpuss_lat_show(struct seq_file *s, void *unused)
+{
+	struct mpuss_lat_stats *st;
+	u32 written, skipped;
+	int cpu, i;
+
+	omap4_sar_update_stats(&written, &skipped);
+	seq_printf(s, "SAR context words: %u written, %u unchanged\n",
+		   written, skipped);
+	seq_printf(s, "histograms from <32us, doubling, to >=2048us\n");
+
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < MPUSS_SAVE_STATES; i++) {
+			st = &per_cpu(mpuss_lat, cpu)[i];
+			if (!st->count)
+				continue;
+			seq_printf(s, "cpu%d %s: %u, entry avg %llu max %u us, "
+				   "exit avg %llu max %u us\n", cpu,
+				   mpuss_save_state_names[i], st->count,
+				   div_u64(st->entry_total_us, st->count),
+				   st->entry_max_us,
+				   div_u64(st->exit_total_us, st->count),
+				   st->exit_max_us);
+			mpuss_lat_show_hist(s, "entry", st->entry_hist);
+			mpuss_lat_show_hist(s, "exit", st->exit_hist);
+		}
+	}
+
+	return 0;
+}
+
+static int mpuss_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mpuss_lat_show, NULL);
+}
+
+static const struct file_operations mpuss_lat_fops = {
+	.open		= mpuss_lat_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init omap4_mpuss_debugfs_init(void)
+{
+	if (!cpu_is_omap44xx())
+		return 0;
+
+	debugfs_create_file("mpuss_lowpower", S_IRUGO, NULL, NULL,
+			    &mpuss_lat_fops);
+	return 0;
+}
+late_initcall(omap4_mpuss_debugfs_init);
+#endif
+
 #endif
 
@@ -15,6 +15,7 @@
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/bitmap.h>
 
 #include <plat/usb.h>
 
@@ -1127,6 +1128,53 @@ static const u32 omap447x_sar_ram3_layout[][4] = {
 	{L4CORE_INDEX, 0x604, 1, 0x000004B8},
 };
 
+/*
+ * The GIC and WakeupGen contexts saved to SAR bank 3 before MPUSS OSWR
+ * and OFF seldom change from one entry to the next, and SAR RAM keeps
+ * them across both.  Writing SAR RAM is much slower than reading the
+ * MPU's own GIC and WakeupGen, so only the words that changed since
+ * they were last saved are written again.
+ */
+#define SAR_CTX_START		ICDISER_CPU0_OFFSET
+#define SAR_CTX_WORDS		((PTMSYNCREQ_EN_OFFSET + 4 - SAR_CTX_START) / 4)
+
+static u32 sar_ctx[SAR_CTX_WORDS];
+static DECLARE_BITMAP(sar_ctx_valid, SAR_CTX_WORDS);
+static u32 sar_ctx_written, sar_ctx_skipped;
+
+/**
+ * omap4_sar_update() - save a GIC or WakeupGen context word to SAR RAM
+ * @val:	value to save
+ * @offset:	offset in SAR RAM, in the GIC and WakeupGen save area
+ *
+ * Only for the last CPU going down to MPUSS OSWR or OFF, with interrupts
+ * off.
+ */
+void omap4_sar_update(u32 val, u32 offset)
+{
+	unsigned int i = (offset - SAR_CTX_START) / 4;
+
+	if (offset < SAR_CTX_START || i >= SAR_CTX_WORDS) {
+		__raw_writel(val, sar_ram_base + offset);
+		return;
+	}
+
+	if (test_bit(i, sar_ctx_valid) && sar_ctx[i] == val) {
+		sar_ctx_skipped++;
+		return;
+	}
+	__raw_writel(val, sar_ram_base + offset);
+	sar_ctx[i] = val;
+	__set_bit(i, sar_ctx_valid);
+	sar_ctx_written++;
+}
+
+void omap4_sar_update_stats(u32 *written, u32 *skipped)
+{
+	*written = sar_ctx_written;
+	*skipped = sar_ctx_skipped;
+}
+
 /*
  * omap_sar_save :
  * common routine to save the registers to  SAR RAM with the
@@ -125,10 +125,16 @@ void __init omap_ion_init(void)
 		omap4_ion_heap_secure_output_wfdhdcp_size = (SZ_1M * 16);
 #endif
 		omap4_ducati_heap_size = (SZ_1M * 105);
+#ifdef CONFIG_ION_OMAP_DYNAMIC_TILER
+		/* tiler buffers take their pages when they are allocated */
+		omap4_ion_heap_nonsec_tiler_mem_size = 0;
+		omap4_ion_heap_tiler_mem_size = 0;
+#else
 		omap4_ion_heap_nonsec_tiler_mem_size = nonsecure;
 		omap4_ion_heap_tiler_mem_size =
 					 (ALIGN(omap4_ion_pdata.tiler2d_size +
 					 nonsecure, SZ_2M) - nonsecure);
+#endif
 	}
 
 	/* carveout addresses */
@@ -107,3 +107,71 @@ int __init omap_ram_console_init(phys_addr_t phy_addr, size_t size)
 
 	return ret;
 }
+
+#ifdef CONFIG_PSTORE_FTRACE
+static struct resource pstore_ftrace_resources[] = {
+	{
+		.flags  = IORESOURCE_MEM,
+	},
+};
+
+static struct platform_device pstore_ftrace_device = {
+	.name		= "pstore_ftrace",
+	.id		= -1,
+	.num_resources	= ARRAY_SIZE(pstore_ftrace_resources),
+	.resource	= pstore_ftrace_resources,
+};
+
+static __initdata bool omap_pstore_ftrace_inited;
+
+static int __init omap_pstore_ftrace_register(void)
+{
+	int ret;
+
+	if (!omap_pstore_ftrace_inited)
+		return -ENODEV;
+
+	ret = platform_device_register(&pstore_ftrace_device);
+	if (ret) {
+		pr_err("%s: unable to register pstore ftrace device:"
+			"start=0x%08x, end=0x%08x, ret=%d\n",
+			__func__, (u32)pstore_ftrace_resources[0].start,
+			(u32)pstore_ftrace_resources[0].end, ret);
+		memblock_add(pstore_ftrace_resources[0].start,
+			(pstore_ftrace_resources[0].end -
+			 pstore_ftrace_resources[0].start + 1));
+	}
+
+	return ret;
+}
+device_initcall(omap_pstore_ftrace_register);
+
+/**
+ * omap_pstore_ftrace_init() - reserve ram for the persistent trace ring
+ * @phy_addr:	physical address of the start of the ring
+ * @size:	size of the ring, split evenly between the cpus
+ *
+ * Same rules as omap_ram_console_init(): called from the board's memory
+ * reservation routine, and the ram must be kept in self refresh across
+ * a warm reset.
+ */
+int __init omap_pstore_ftrace_init(phys_addr_t phy_addr, size_t size)
+{
+	int ret;
+
+	ret = memblock_remove(phy_addr, size);
+	if (ret) {
+		pr_err("%s: unable to remove memory for pstore ftrace:"
+			"start=0x%08x, size=0x%08x, ret=%d\n",
+			__func__, (u32)phy_addr, (u32)size, ret);
+		return ret;
+	}
+
+	pstore_ftrace_resources[0].start = phy_addr;
+	pstore_ftrace_resources[0].end = phy_addr + size - 1;
+
+	omap_pstore_ftrace_inited = true;
+
+	return ret;
+}
+#endif
@@ -21,6 +21,11 @@
 #define OMAP_RAM_CONSOLE_START_DEFAULT	(PLAT_PHYS_OFFSET + SZ_512M)
 #define OMAP_RAM_CONSOLE_SIZE_DEFAULT	SZ_2M
 
+/* The persistent trace ring goes right after the ram console */
+#define OMAP_PSTORE_FTRACE_START_DEFAULT	(OMAP_RAM_CONSOLE_START_DEFAULT + \
+						 OMAP_RAM_CONSOLE_SIZE_DEFAULT)
+#define OMAP_PSTORE_FTRACE_SIZE_DEFAULT		SZ_1M
+
 #ifdef CONFIG_OMAP_RAM_CONSOLE
 extern int omap_ram_console_init(phys_addr_t phy_addr, size_t size);
 #else
@@ -30,4 +35,13 @@ static inline int omap_ram_console_init(phys_addr_t phy_addr, size_t size)
 }
 #endif /* CONFIG_OMAP_RAM_CONSOLE */
 
+#if defined(CONFIG_OMAP_RAM_CONSOLE) && defined(CONFIG_PSTORE_FTRACE)
+extern int omap_pstore_ftrace_init(phys_addr_t phy_addr, size_t size);
+#else
+static inline int omap_pstore_ftrace_init(phys_addr_t phy_addr, size_t size)
+{
+	return 0;
+}
+#endif
+
 #endif
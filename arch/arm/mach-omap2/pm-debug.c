@@ -212,6 +212,7 @@ enum {
 	DEBUG_FILE_TIMERS,
 	DEBUG_FILE_LAST_COUNTERS,
 	DEBUG_FILE_LAST_TIMERS,
+	DEBUG_FILE_WAKEUP_LAT,
 };
 
 struct pm_module_def {
@@ -527,6 +528,29 @@ static int pwrdm_dbg_show_last_timer(struct powerdomain *pwrdm, void *user)
 	return 0;
 }
 
+static int pwrdm_dbg_show_wakeuplat(struct powerdomain *pwrdm, void *user)
+{
+	struct seq_file *s = (struct seq_file *)user;
+	struct powerdomain_wakeuplat_stats *st = &pwrdm->wakeuplat_stats;
+
+	if (!st->updates)
+		return 0;
+
+	mutex_lock(&pwrdm->wakeuplat_mutex);
+	seq_printf(s, "%s: min %ld us, %lu updates, %lu applied, peak %u/s\n",
+		   pwrdm->name, (long)pwrdm->wakeuplat_min, st->updates,
+		   st->applied, st->peak_rate);
+	mutex_unlock(&pwrdm->wakeuplat_mutex);
+
+	return 0;
+}
+
+static int pm_dbg_show_wakeuplat(struct seq_file *s, void *unused)
+{
+	pwrdm_for_each(pwrdm_dbg_show_wakeuplat, s);
+	return 0;
+}
+
 static int pm_dbg_show_counters(struct seq_file *s, void *unused)
 {
 	pwrdm_for_each(pwrdm_dbg_show_counter, s);
@@ -567,6 +591,9 @@ static int pm_dbg_open(struct inode *inode, struct file *file)
 	case DEBUG_FILE_LAST_COUNTERS:
 		return single_open(file, pm_dbg_show_last_counters,
 			&inode->i_private);
+	case DEBUG_FILE_WAKEUP_LAT:
+		return single_open(file, pm_dbg_show_wakeuplat,
+			&inode->i_private);
 	case DEBUG_FILE_LAST_TIMERS:
 	default:
 		return single_open(file, pm_dbg_show_last_timers,
@@ -786,6 +813,8 @@ static int __init pm_dbg_init(void)
 		d, (void *)DEBUG_FILE_LAST_COUNTERS, &debug_fops);
 	(void) debugfs_create_file("last_time", S_IRUGO,
 		d, (void *)DEBUG_FILE_LAST_TIMERS, &debug_fops);
+	(void) debugfs_create_file("wakeup_lat", S_IRUGO,
+		d, (void *)DEBUG_FILE_WAKEUP_LAT, &debug_fops);
 
 	pwrdm_for_each(pwrdms_setup, (void *)d);
 
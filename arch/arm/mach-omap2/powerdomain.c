@@ -20,6 +20,7 @@
 #include <linux/errno.h>
 #include <linux/string.h>
 #include <linux/slab.h>
+#include <linux/jiffies.h>
 
 #include <trace/events/power.h>
 
@@ -132,6 +133,7 @@ static int _pwrdm_register(struct powerdomain *pwrdm)
 	/* Initialize priority ordered list for wakeup latency constraint */
 	spin_lock_init(&pwrdm->wakeuplat_lock);
 	plist_head_init(&pwrdm->wakeuplat_dev_list);
+	pwrdm->wakeuplat_min = -1;
 
 	/* res_mutex protects res_list add and del ops */
 	mutex_init(&pwrdm->wakeuplat_mutex);
@@ -1055,6 +1057,18 @@ bool pwrdm_can_ever_lose_context(struct powerdomain *pwrdm)
 	return 0;
 }
 
+static void pwrdm_wakeuplat_count(struct powerdomain *pwrdm)
+{
+	struct powerdomain_wakeuplat_stats *st = &pwrdm->wakeuplat_stats;
+
+	st->updates++;
+	if (time_after_eq(jiffies, st->window + HZ)) {
+		st->window = jiffies;
+		st->window_updates = 0;
+	}
+	if (++st->window_updates > st->peak_rate)
+		st->peak_rate = st->window_updates;
+}
 
 /**
  * pwrdm_wakeuplat_set_constraint - Set powerdomain wakeup latency constraint
@@ -1081,6 +1095,7 @@ int pwrdm_wakeuplat_set_constraint (struct powerdomain *pwrdm,
 	}
 
 	mutex_lock(&pwrdm->wakeuplat_mutex);
+	pwrdm_wakeuplat_count(pwrdm);
 
 	plist_for_each_entry(user, &pwrdm->wakeuplat_dev_list, node) {
 		if (user->dev == dev) {
@@ -1140,6 +1155,7 @@ int pwrdm_wakeuplat_release_constraint (struct powerdomain *pwrdm,
 	}
 
 	mutex_lock(&pwrdm->wakeuplat_mutex);
+	pwrdm_wakeuplat_count(pwrdm);
 
 	plist_for_each_entry(user, &pwrdm->wakeuplat_dev_list, node) {
 		if (user->dev == dev) {
@@ -1173,7 +1189,10 @@ exit_rls:
  *
  * Finds minimum latency value from all entries in the list and
  * the power domain power state neeting the constraint. Programs
- * new state if it is different from next power state.
+ * new state if it is different from next power state.  Nothing is done
+ * if the minimum is the one the power state was last checked against,
+ * which is what most updates come to: a device changing a constraint
+ * that is not the strictest, or setting it back to what it was.
  * Returns -EINVAL if the powerdomain or device pointer is NULL or
  * no such entry exists in the list, or -ERANGE if constraint can't be met,
  * or returns 0 upon success.
@@ -1184,11 +1203,15 @@ int pwrdm_wakeuplat_update_pwrst(struct powerdomain *pwrdm)
 	int ret = 0, new_state;
 	unsigned long min_latency = -1;
 
+	/* the list is in ascending order: the strictest constraint first */
 	if (!plist_head_empty(&pwrdm->wakeuplat_dev_list)) {
-		node = plist_last(&pwrdm->wakeuplat_dev_list);
+		node = plist_first(&pwrdm->wakeuplat_dev_list);
 		min_latency = node->prio;
 	}
 
+	if (min_latency == pwrdm->wakeuplat_min)
+		return pwrdm->wakeuplat_ret;
+
 	/* Find power state with wakeup latency < minimum constraint. */
 	for (new_state = 0x0; new_state < PWRDM_MAX_PWRSTS; new_state++) {
 		if (min_latency == -1 ||
@@ -1202,6 +1225,10 @@ int pwrdm_wakeuplat_update_pwrst(struct powerdomain *pwrdm)
 		ret = -ERANGE;
 	}
 
+	pwrdm->wakeuplat_min = min_latency;
+	pwrdm->wakeuplat_ret = ret;
+	pwrdm->wakeuplat_stats.applied++;
+
 	if (pwrdm_read_next_pwrst(pwrdm) != new_state) {
 		if (cpu_is_omap44xx() || cpu_is_omap34xx())
 			omap_set_pwrdm_state(pwrdm, new_state);
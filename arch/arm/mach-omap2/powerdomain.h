@@ -112,6 +112,23 @@ struct powerdomain_time_stats {
 	s64 state[PWRDM_MAX_PWRSTS];
 };
 
+/**
+ * struct powerdomain_wakeuplat_stats - wakeup latency constraint activity
+ * @updates: constraints set or released
+ * @applied: updates that changed the strictest constraint, and so had the
+ *	power state checked against it
+ * @peak_rate: most updates seen within a second
+ * @window: jiffies the current second started at
+ * @window_updates: updates within the current second
+ */
+struct powerdomain_wakeuplat_stats {
+	unsigned long updates;
+	unsigned long applied;
+	unsigned int peak_rate;
+	unsigned long window;
+	unsigned int window_updates;
+};
+
 /**
  * struct powerdomain - OMAP powerdomain
  * @name: Powerdomain name
@@ -135,6 +152,10 @@ struct powerdomain_time_stats {
  * @wakeup_lat: Wakeup latencies for possible powerdomain power states
  * @wakeuplat_lock: spinlock for plist
  * @wakeuplat_dev_list: plist_head linking all devices placing constraint
+ * @wakeuplat_min: strictest constraint the power state was last set for,
+ *	-1 if none
+ * @wakeuplat_ret: result of checking the power state against it
+ * @wakeuplat_stats: how often constraints change, under @wakeuplat_mutex
  * @wa * @prcm_partition possible values are defined in mach-omap2/prcm44xx.h.
  */
 struct powerdomain {
@@ -169,6 +190,9 @@ struct powerdomain {
 	spinlock_t wakeuplat_lock;
 	struct plist_head wakeuplat_dev_list;
 	struct mutex wakeuplat_mutex;
+	unsigned long wakeuplat_min;
+	int wakeuplat_ret;
+	struct powerdomain_wakeuplat_stats wakeuplat_stats;
 };
 
 struct wakeuplat_dev_list {
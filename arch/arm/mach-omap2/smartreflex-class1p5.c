@@ -27,6 +27,12 @@
 #include <linux/slab.h>
 #include <linux/opp.h>
 #include <linux/pm_qos.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#include <plat/temperature_sensor.h>
 
 #include "smartreflex.h"
 #include "voltage.h"
@@ -37,6 +43,11 @@
 #define SR1P5_STABLE_SAMPLES	10
 #define SR1P5_MAX_TRIGGERS	5
 
+/* calibrations are kept below and above the die sensor's t_hot */
+#define SR1P5_TEMP_BANDS	2
+/* a recheck moving an OPP by more than about a PMIC step is drift */
+#define SR1P5_DRIFT_UV		12500
+
 /*
  * We expect events in 10uS, if we don't receive it in twice as long,
  * we stop waiting for the event and use the current value
@@ -55,6 +66,15 @@
  *			consumed by the work item.
  * @work_active:	have we scheduled a work item?
  * @qos:		pm qos handle
+ * @nr_opps:		number of OPPs of @voltdm
+ * @band:		temperature band the calibrated voltages are for
+ * @calib_cache:	calibrated voltage per OPP and band, 0 if none yet
+ * @recal_prev:		calibrated voltage of @vdata being rechecked, if any
+ * @calib_start:	when the calibration in progress started
+ * @nr_calibs:		completed calibrations, taking @calib_total_us in all
+ *			and @calib_max_us at most
+ * @nr_restored:	calibrations restored from @calib_cache on band changes
+ * @nr_drifts:		rechecks that found the voltage had drifted
  */
 struct sr_class1p5_work_data {
 	struct delayed_work work;
@@ -65,13 +85,116 @@ struct sr_class1p5_work_data {
 	unsigned long u_volt_samples[SR1P5_STABLE_SAMPLES];
 	bool work_active;
 	struct pm_qos_request_list qos;
+	int nr_opps;
+	int band;
+	u32 (*calib_cache)[SR1P5_TEMP_BANDS];
+	u32 recal_prev;
+	ktime_t calib_start;
+	unsigned int nr_calibs;
+	u64 calib_total_us;
+	u32 calib_max_us;
+	unsigned int nr_restored;
+	unsigned int nr_drifts;
 };
 
+/* for debugfs and the recheck work, under omap_dvfs_lock */
+static struct sr_class1p5_work_data *sr1p5_vdds[MAX_VDDS];
+
 #if CONFIG_OMAP_SR_CLASS1P5_RECALIBRATION_DELAY
 /* recal_work:	recalibration calibration work */
 static struct delayed_work recal_work;
 #endif
 
+static int sr1p5_opp_index(struct sr_class1p5_work_data *work_data,
+			   struct omap_volt_data *vdata)
+{
+	int idx = vdata - work_data->voltdm->vdd->volt_data;
+
+	return (idx >= 0 && idx < work_data->nr_opps) ? idx : -1;
+}
+
+/**
+ * sr1p5_sync_band() - use the calibrations of the current temperature band
+ * @work_data:	class data of the voltage domain
+ *
+ * Keeps the calibrated voltages of all OPPs for the band being left, and
+ * puts back those found earlier in the new one.  OPPs not calibrated in
+ * that band yet go back to nominal, to be calibrated on their next use.
+ * Returns true if the band changed.
+ */
+static bool sr1p5_sync_band(struct sr_class1p5_work_data *work_data)
+{
+	struct omap_volt_data *vdata = work_data->voltdm->vdd->volt_data;
+	int band = omap_temp_sensor_hot() ? 1 : 0;
+	int i;
+
+	if (band == work_data->band)
+		return false;
+
+	for (i = 0; i < work_data->nr_opps; i++, vdata++) {
+		work_data->calib_cache[i][work_data->band] =
+			vdata->volt_calibrated;
+		vdata->volt_calibrated = work_data->calib_cache[i][band];
+		vdata->volt_dynamic_nominal = omap_get_dyn_nominal(vdata);
+		if (vdata->volt_calibrated)
+			work_data->nr_restored++;
+	}
+	pr_info("%s: %s: using %s calibrations\n", __func__,
+		work_data->voltdm->name, band ? "hot" : "normal");
+	work_data->band = band;
+	work_data->recal_prev = 0;
+
+	return true;
+}
+
+/**
+ * sr1p5_calib_done() - account a completed calibration
+ * @work_data:	class data of the voltage domain
+ * @vdata:	OPP just calibrated
+ *
+ * If it was a recheck of an OPP calibrated earlier and the voltage has
+ * drifted, the other OPPs have most likely drifted too: drop their
+ * calibrations so that they are redone on their next use, from the
+ * dynamic nominal voltage.
+ */
+static void sr1p5_calib_done(struct sr_class1p5_work_data *work_data,
+			     struct omap_volt_data *vdata)
+{
+	struct omap_volt_data *v = work_data->voltdm->vdd->volt_data;
+	s64 us = ktime_us_delta(ktime_get(), work_data->calib_start);
+	int idx = sr1p5_opp_index(work_data, vdata);
+	int i, drift;
+
+	if (us < 0)
+		us = 0;
+	work_data->nr_calibs++;
+	work_data->calib_total_us += us;
+	if (us > work_data->calib_max_us)
+		work_data->calib_max_us = us;
+
+	if (idx >= 0)
+		work_data->calib_cache[idx][work_data->band] =
+			vdata->volt_calibrated;
+
+	if (!work_data->recal_prev)
+		return;
+
+	drift = abs((int)vdata->volt_calibrated - (int)work_data->recal_prev);
+	work_data->recal_prev = 0;
+	if (drift <= SR1P5_DRIFT_UV)
+		return;
+
+	pr_info("%s: %s: drifted by %duV, recalibrating on demand\n",
+		__func__, work_data->voltdm->name, drift);
+	work_data->nr_drifts++;
+	for (i = 0; i < work_data->nr_opps; i++, v++) {
+		if (i == idx)
+			continue;
+		work_data->calib_cache[i][work_data->band] = 0;
+		v->volt_calibrated = 0;
+	}
+}
+
 /**
  * sr_class1p5_notify() - isr notifier for status events
  * @voltdm:	voltage domain for which we were triggered
@@ -305,6 +428,7 @@ done_calib:
 	volt_data->volt_calibrated = u_volt_safe;
 	/* Setup my dynamic voltage for the next calibration for this opp */
 	volt_data->volt_dynamic_nominal = omap_get_dyn_nominal(volt_data);
+	sr1p5_calib_done(work_data, volt_data);
 
 	/*
 	 * if the voltage we decided as safe is not the current voltage,
@@ -336,17 +460,23 @@ done_calib:
 #if CONFIG_OMAP_SR_CLASS1P5_RECALIBRATION_DELAY
 
 /**
- * sr_class1p5_voltdm_recal() - Helper routine to reset calibration.
- * @voltdm:	Voltage domain to reset calibration for
+ * sr_class1p5_voltdm_recal() - Helper routine to recheck calibration.
+ * @voltdm:	Voltage domain to recheck calibration for
  * @user:	unused
  *
+ * Only the current OPP is calibrated again, the others keep their
+ * calibrated voltages unless this one is found to have drifted, see
+ * sr1p5_calib_done().
+ *
  * NOTE: Appropriate locks must be held by calling path to ensure mutual
  * exclusivity
  */
 static int sr_class1p5_voltdm_recal(struct voltagedomain *voltdm,
 		void *user)
 {
+	struct sr_class1p5_work_data *work_data = NULL;
 	struct omap_volt_data *vdata;
+	int i;
 
 	/*
 	 * we need to go no further if sr is not enabled for this domain or
@@ -364,11 +494,20 @@ static int sr_class1p5_voltdm_recal(struct voltagedomain *voltdm,
 		return -ENXIO;
 	}
 
+	for (i = 0; i < MAX_VDDS; i++)
+		if (sr1p5_vdds[i] && sr1p5_vdds[i]->voltdm == voltdm)
+			work_data = sr1p5_vdds[i];
+
+	/* not calibrated yet, or being calibrated: nothing to recheck */
+	if (!work_data || work_data->work_active || !vdata->volt_calibrated)
+		return 0;
+
 	omap_sr_disable(voltdm);
-	omap_voltage_calib_reset(voltdm);
+	work_data->recal_prev = vdata->volt_calibrated;
+	vdata->volt_calibrated = 0;
 	voltdm_reset(voltdm);
 	omap_sr_enable(voltdm, vdata);
-	pr_info("%s: %s: calibration reset\n", __func__, voltdm->name);
+	pr_info("%s: %s: rechecking calibration\n", __func__, voltdm->name);
 
 	return 0;
 }
@@ -377,9 +516,8 @@ static int sr_class1p5_voltdm_recal(struct voltagedomain *voltdm,
  * sr_class1p5_recal_work() - work which actually does the calibration
  * @work: pointer to the work
  *
- * on a periodic basis, we come and reset our calibration setup
- * so that a recalibration of the OPPs take place. This takes
- * care of aging factor in the system.
+ * on a periodic basis, we come and recheck the calibration of the
+ * current OPPs, so that aging is taken care of.
  */
 static void sr_class1p5_recal_work(struct work_struct *work)
 {
@@ -420,10 +558,6 @@ static int sr_class1p5_enable(struct voltagedomain *voltdm,
 		return -EINVAL;
 	}
 
-	/* If already calibrated, nothing to do here.. */
-	if (volt_data->volt_calibrated)
-		return 0;
-
 	work_data = (struct sr_class1p5_work_data *)voltdm_cdata;
 	if (IS_ERR_OR_NULL(work_data)) {
 		pr_err("%s: bad work data??\n", __func__);
@@ -433,6 +567,14 @@ static int sr_class1p5_enable(struct voltagedomain *voltdm,
 	if (work_data->work_active)
 		return 0;
 
+	/* we were just scaled for the band we are leaving */
+	if (sr1p5_sync_band(work_data))
+		voltdm_scale(voltdm, volt_data);
+
+	/* If already calibrated, nothing to do here.. */
+	if (volt_data->volt_calibrated)
+		return 0;
+
 	omap_vp_enable(voltdm);
 	r = sr_enable(voltdm, volt_data);
 	if (r) {
@@ -444,6 +586,7 @@ static int sr_class1p5_enable(struct voltagedomain *voltdm,
 	work_data->vdata = volt_data;
 	work_data->work_active = true;
 	work_data->num_calib_triggers = 0;
+	work_data->calib_start = ktime_get();
 	/* Dont interrupt me untill calibration is complete */
 	pm_qos_update_request(&work_data->qos, 0);
 	/* program the workqueue and leave it to calibrate offline.. */
@@ -516,6 +659,12 @@ static int sr_class1p5_disable(struct voltagedomain *voltdm,
 		sr_disable(voltdm);
 		/* Cancelled SR, so no more need to keep request */
 		pm_qos_update_request(&work_data->qos, PM_QOS_DEFAULT_VALUE);
+		/* an interrupted recheck keeps the voltage it had */
+		if (work_data->recal_prev) {
+			work_data->vdata->volt_calibrated =
+				work_data->recal_prev;
+			work_data->recal_prev = 0;
+		}
 	}
 
 	/* If already calibrated, don't need to reset voltage */
@@ -561,6 +710,8 @@ static int sr_class1p5_init(struct voltagedomain *voltdm,
 			    void **voltdm_cdata, void *class_priv_data)
 {
 	struct sr_class1p5_work_data *work_data;
+	struct omap_volt_data *vdata;
+	int i;
 
 	if (IS_ERR_OR_NULL(voltdm) || IS_ERR_OR_NULL(voltdm_cdata)) {
 		pr_err("%s: bad parameters!\n", __func__);
@@ -581,6 +732,22 @@ static int sr_class1p5_init(struct voltagedomain *voltdm,
 	}
 
 	work_data->voltdm = voltdm;
+	for (vdata = voltdm->vdd->volt_data; vdata->volt_nominal; vdata++)
+		work_data->nr_opps++;
+	work_data->calib_cache = kcalloc(work_data->nr_opps,
+					 sizeof(*work_data->calib_cache),
+					 GFP_KERNEL);
+	if (!work_data->calib_cache) {
+		kfree(work_data);
+		return -ENOMEM;
+	}
+	work_data->band = omap_temp_sensor_hot() ? 1 : 0;
+	for (i = 0; i < MAX_VDDS; i++)
+		if (!sr1p5_vdds[i]) {
+			sr1p5_vdds[i] = work_data;
+			break;
+		}
+
 	INIT_DELAYED_WORK_DEFERRABLE(&work_data->work, sr_class1p5_calib_work);
 	*voltdm_cdata = (void *)work_data;
 	pm_qos_add_request(&work_data->qos, PM_QOS_CPU_DMA_LATENCY,
@@ -607,6 +774,7 @@ static int sr_class1p5_deinit(struct voltagedomain *voltdm,
 			      void **voltdm_cdata, void *class_priv_data)
 {
 	struct sr_class1p5_work_data *work_data;
+	int i;
 
 	if (IS_ERR_OR_NULL(voltdm) || IS_ERR_OR_NULL(voltdm_cdata)) {
 		pr_err("%s: bad parameters!\n", __func__);
@@ -635,7 +803,12 @@ static int sr_class1p5_deinit(struct voltagedomain *voltdm,
 	voltdm_reset(voltdm);
 	pm_qos_remove_request(&work_data->qos);
 
+	for (i = 0; i < MAX_VDDS; i++)
+		if (sr1p5_vdds[i] == work_data)
+			sr1p5_vdds[i] = NULL;
+
 	*voltdm_cdata = NULL;
+	kfree(work_data->calib_cache);
 	kfree(work_data);
 
 	return 0;
@@ -658,6 +831,58 @@ static struct omap_sr_class_data class1p5_data = {
 	.notify_flags = SR_NOTIFY_MCUBOUND,
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int sr_class1p5_stats_show(struct seq_file *s, void *unused)
+{
+	struct sr_class1p5_work_data *work_data;
+	struct omap_volt_data *vdata;
+	int i, j;
+
+	mutex_lock(&omap_dvfs_lock);
+	for (i = 0; i < MAX_VDDS; i++) {
+		work_data = sr1p5_vdds[i];
+		if (!work_data)
+			continue;
+
+		seq_printf(s, "vdd_%s: %s band, %u calibrations, avg %llu us, "
+			   "max %u us, %u restored, %u drifts\n",
+			   work_data->voltdm->name,
+			   work_data->band ? "hot" : "normal",
+			   work_data->nr_calibs, work_data->nr_calibs ?
+			   div_u64(work_data->calib_total_us,
+				   work_data->nr_calibs) : 0ULL,
+			   work_data->calib_max_us, work_data->nr_restored,
+			   work_data->nr_drifts);
+		seq_printf(s, "%10s %10s %10s %10s %10s\n", "nominal",
+			   "calib", "saved", "normal", "hot");
+		vdata = work_data->voltdm->vdd->volt_data;
+		for (j = 0; j < work_data->nr_opps; j++, vdata++)
+			seq_printf(s, "%10u %10u %10d %10u %10u\n",
+				   vdata->volt_nominal, vdata->volt_calibrated,
+				   vdata->volt_calibrated ?
+				   (int)vdata->volt_nominal -
+				   (int)vdata->volt_calibrated : 0,
+				   work_data->calib_cache[j][0],
+				   work_data->calib_cache[j][1]);
+	}
+	mutex_unlock(&omap_dvfs_lock);
+
+	return 0;
+}
+
+static int sr_class1p5_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sr_class1p5_stats_show, NULL);
+}
+
+static const struct file_operations sr_class1p5_stats_fops = {
+	.open		= sr_class1p5_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 /**
  * sr_class1p5_driver_init() - register class 1p5 as default
  *
@@ -686,6 +911,10 @@ static int __init sr_class1p5_driver_init(void)
 #endif
 		pr_info("SmartReflex class 1.5 driver: initialized (%dms)\n",
 			CONFIG_OMAP_SR_CLASS1P5_RECALIBRATION_DELAY);
+#ifdef CONFIG_DEBUG_FS
+		debugfs_create_file("sr_class1p5", S_IRUGO, NULL, NULL,
+				    &sr_class1p5_stats_fops);
+#endif
 	}
 	return r;
 }
@@ -2,6 +2,7 @@
 #include <linux/delay.h>
 #include <linux/init.h>
 #include <linux/clk.h>
+#include <linux/hrtimer.h>
 
 #include <plat/cpu.h>
 
@@ -221,7 +222,14 @@ void omap_vc_post_scale(struct voltagedomain *voltdm,
 	/* SMPS slew rate / step size. 2us added as buffer. */
 	smps_delay = ((smps_steps * voltdm->pmic->step_size) /
 			voltdm->pmic->slew_rate) + 2;
-	udelay(smps_delay);
+	voltdm->ramp_us += smps_delay;
+	if (voltdm->ramp_defer) {
+		/* voltdm_scale_finish() waits for what is left of it */
+		voltdm->ramp_end = ktime_add_us(ktime_get(), smps_delay);
+	} else {
+		voltdm->ramp_wait_us += smps_delay;
+		udelay(smps_delay);
+	}
 
 	voltdm->curr_volt = target_vdata;
 
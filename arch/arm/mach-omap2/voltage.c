@@ -25,6 +25,7 @@
 #include <linux/err.h>
 #include <linux/debugfs.h>
 #include <linux/slab.h>
+#include <linux/hrtimer.h>
 
 #include <plat/common.h>
 
@@ -103,16 +104,8 @@ struct omap_volt_data *omap_voltage_get_curr_vdata(struct voltagedomain *voltdm)
 	return voltdm->curr_volt;
 }
 
-/**
- * voltdm_scale() - API to scale voltage of a particular voltage domain.
- * @voltdm: pointer to the voltage domain which is to be scaled.
- * @target_volt: The target voltage of the voltage domain
- *
- * This API should be called by the kernel to do the voltage scaling
- * for a particular voltage domain during DVFS.
- */
-int voltdm_scale(struct voltagedomain *voltdm,
-		 struct omap_volt_data *target_v)
+static int _voltdm_scale_start(struct voltagedomain *voltdm,
+			       struct omap_volt_data *target_v, bool defer)
 {
 	int ret = 0;
 	struct omap_voltage_notifier notify;
@@ -136,16 +129,85 @@ int voltdm_scale(struct voltagedomain *voltdm,
 			OMAP_VOLTAGE_PRECHANGE,
 			(void *)&notify);
 
+	voltdm->ramp_pending = true;
+	voltdm->ramp_defer = defer;
+	voltdm->ramp_target = target_v;
+	voltdm->ramp_end = defer ? ktime_get() : ktime_set(0, 0);
+
 	ret = voltdm->scale(voltdm, target_v);
 	if (ret)
 		pr_err("%s: voltage scale failed for vdd%s: %d\n",
 			__func__, voltdm->name, ret);
 
-	notify.op_result = ret;
+	voltdm->ramp_defer = false;
+	voltdm->ramp_ret = ret;
+	return ret;
+}
+
+/**
+ * voltdm_scale_start() - Scale a voltage domain without waiting for the ramp
+ * @voltdm: pointer to the voltage domain which is to be scaled.
+ * @target_volt: The target voltage of the voltage domain
+ *
+ * As voltdm_scale(), but returns once the PMIC has the new voltage: the
+ * SMPS ramp is left to voltdm_scale_finish(), which must follow before
+ * anything relies on the new voltage.  Domains scaled this way ramp at
+ * the same time.
+ */
+int voltdm_scale_start(struct voltagedomain *voltdm,
+		       struct omap_volt_data *target_v)
+{
+	return _voltdm_scale_start(voltdm, target_v, true);
+}
+
+/**
+ * voltdm_scale_finish() - Wait for the ramp of voltdm_scale_start()
+ * @voltdm: pointer to the voltage domain being scaled.
+ *
+ * Waits for what is left of the ramp and tells the notifiers the voltage
+ * is stable.  Returns the result of the scale.
+ */
+int voltdm_scale_finish(struct voltagedomain *voltdm)
+{
+	struct omap_voltage_notifier notify;
+	s64 left;
+
+	if (!voltdm || IS_ERR(voltdm) || !voltdm->ramp_pending)
+		return 0;
+
+	left = ktime_us_delta(voltdm->ramp_end, ktime_get());
+	if (left > 0) {
+		voltdm->ramp_wait_us += left;
+		udelay(left);
+	}
+	voltdm->ramp_pending = false;
+
+	notify.voltdm = voltdm;
+	notify.target_volt = omap_get_operation_voltage(voltdm->ramp_target);
+	notify.op_result = voltdm->ramp_ret;
 	srcu_notifier_call_chain(&voltdm->change_notify_list,
 			OMAP_VOLTAGE_POSTCHANGE,
 			(void *)&notify);
 
+	return voltdm->ramp_ret;
+}
+
+/**
+ * voltdm_scale() - API to scale voltage of a particular voltage domain.
+ * @voltdm: pointer to the voltage domain which is to be scaled.
+ * @target_volt: The target voltage of the voltage domain
+ *
+ * This API should be called by the kernel to do the voltage scaling
+ * for a particular voltage domain during DVFS.
+ */
+int voltdm_scale(struct voltagedomain *voltdm,
+		 struct omap_volt_data *target_v)
+{
+	int ret;
+
+	ret = _voltdm_scale_start(voltdm, target_v, false);
+	if (!IS_ERR_OR_NULL(voltdm) && voltdm->ramp_pending)
+		ret = voltdm_scale_finish(voltdm);
 	return ret;
 }
 
@@ -445,6 +507,10 @@ static void __init voltdm_debugfs_init(struct dentry *voltage_dir,
 	(void) debugfs_create_file("curr_margin_volt", S_IRUGO,
 				voltdm->debug_dir, (void *) voltdm,
 				&margin_volt_debug_fops);
+	(void) debugfs_create_u32("ramp_us", S_IRUGO, voltdm->debug_dir,
+				&voltdm->ramp_us);
+	(void) debugfs_create_u32("ramp_wait_us", S_IRUGO, voltdm->debug_dir,
+				&voltdm->ramp_wait_us);
 }
 
 /**
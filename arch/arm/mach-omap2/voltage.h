@@ -16,6 +16,7 @@
 
 #include <linux/notifier.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 
 struct omap_volt_data;
 
@@ -72,6 +73,13 @@ struct omap_vfsm_instance {
  * @scale: function used to scale the voltage of the voltagedomain
  * @curr_volt: current nominal voltage for this voltage domain
  * @change_notify_list: notifiers that need to be told on pre and post change
+ * @ramp_pending: a scale was started and voltdm_scale_finish() is due
+ * @ramp_defer: the scale in progress leaves the SMPS ramp to the caller
+ * @ramp_end: when the ramp of a voltdm_scale_start() is over
+ * @ramp_target: voltage of the scale in progress
+ * @ramp_ret: result of the scale in progress
+ * @ramp_us: SMPS ramp time of all scales, from the PMIC slew rate
+ * @ramp_wait_us: how much of it was busy waited
  */
 struct voltagedomain {
 	char *name;
@@ -101,6 +109,14 @@ struct voltagedomain {
 	struct omap_vdd_info *vdd;
 	struct srcu_notifier_head change_notify_list;
 	struct dentry *debug_dir;
+
+	bool ramp_pending;
+	bool ramp_defer;
+	ktime_t ramp_end;
+	struct omap_volt_data *ramp_target;
+	int ramp_ret;
+	u32 ramp_us;
+	u32 ramp_wait_us;
 };
 
 /* Notifier values for voltage changes */
@@ -337,6 +353,9 @@ int voltdm_for_each_pwrdm(struct voltagedomain *voltdm,
 				    struct powerdomain *pwrdm));
 int voltdm_scale(struct voltagedomain *voltdm,
 		 struct omap_volt_data *target_volt);
+int voltdm_scale_start(struct voltagedomain *voltdm,
+		       struct omap_volt_data *target_volt);
+int voltdm_scale_finish(struct voltagedomain *voltdm);
 void voltdm_reset(struct voltagedomain *voltdm);
 
 static inline int voltdm_register_notifier(struct voltagedomain *voltdm,
@@ -0,0 +1,232 @@
+/*
+ * arch/arm/mm/cache-l2x0-pmu.c - L310 event counters as a perf PMU
+ *
+ * The L310 has two 32-bit event counters of its own, counting for the
+ * whole cache rather than for a CPU, so they are registered as a PMU of
+ * their own, "l2x0", with a dynamic type read from
+ * /sys/bus/event_source/devices/l2x0/type.  attr.config is the event
+ * source number from the TRM (L2X0_EVENT_*), and perf tools know them
+ * by name as l2x0-<event>.
+ *
+ * Counting only: there is no sampling, the overflow interrupt isn't
+ * wired up and the counters are read every second while in use, so
+ * that they can't wrap unnoticed.  Events have to be opened on CPU 0, as system
+ * wide ones, since anything else would count the same thing twice.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define pr_fmt(fmt) "l2x0 pmu: " fmt
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/workqueue.h>
+#include <linux/perf_event.h>
+#include <linux/spinlock.h>
+
+#include <asm/hardware/cache-l2x0.h>
+
+#define L2X0_PMU_COUNTERS	2
+#define L2X0_PMU_POLL		HZ
+
+static void __iomem *l2x0_pmu_base;
+static struct perf_event *l2x0_pmu_events[L2X0_PMU_COUNTERS];
+static int l2x0_pmu_active;
+static DEFINE_RAW_SPINLOCK(l2x0_pmu_lock);
+static struct pmu l2x0_pmu;
+
+/* counter 0 lives above counter 1 */
+static void __iomem *l2x0_pmu_cfg(int idx)
+{
+	return l2x0_pmu_base + (idx ? L2X0_EVENT_CNT1_CFG : L2X0_EVENT_CNT0_CFG);
+}
+
+static void __iomem *l2x0_pmu_val(int idx)
+{
+	return l2x0_pmu_base + (idx ? L2X0_EVENT_CNT1_VAL : L2X0_EVENT_CNT0_VAL);
+}
+
+static void l2x0_pmu_event_read(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev, now;
+
+	do {
+		prev = local64_read(&hwc->prev_count);
+		now = readl_relaxed(l2x0_pmu_val(hwc->idx));
+	} while (local64_cmpxchg(&hwc->prev_count, prev, now) != prev);
+
+	local64_add((now - prev) & 0xffffffff, &event->count);
+}
+
+static void l2x0_pmu_poll(struct work_struct *work);
+static DECLARE_DELAYED_WORK(l2x0_pmu_work, l2x0_pmu_poll);
+
+static void l2x0_pmu_poll(struct work_struct *work)
+{
+	unsigned long flags;
+	int i;
+
+	raw_spin_lock_irqsave(&l2x0_pmu_lock, flags);
+	for (i = 0; i < L2X0_PMU_COUNTERS; i++) {
+		struct perf_event *event = l2x0_pmu_events[i];
+
+		if (event && !(event->hw.state & PERF_HES_STOPPED))
+			l2x0_pmu_event_read(event);
+	}
+	if (l2x0_pmu_active)
+		schedule_delayed_work(&l2x0_pmu_work, L2X0_PMU_POLL);
+	raw_spin_unlock_irqrestore(&l2x0_pmu_lock, flags);
+}
+
+static void l2x0_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	hwc->state = 0;
+	/* the counter keeps its value, only count from here */
+	local64_set(&hwc->prev_count, readl_relaxed(l2x0_pmu_val(hwc->idx)));
+	writel_relaxed(hwc->config_base << 2, l2x0_pmu_cfg(hwc->idx));
+}
+
+static void l2x0_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	writel_relaxed(0, l2x0_pmu_cfg(hwc->idx));
+	l2x0_pmu_event_read(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int l2x0_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+	int idx, ret = -EAGAIN;
+
+	raw_spin_lock_irqsave(&l2x0_pmu_lock, irqflags);
+	for (idx = 0; idx < L2X0_PMU_COUNTERS; idx++)
+		if (!l2x0_pmu_events[idx])
+			break;
+	if (idx == L2X0_PMU_COUNTERS)
+		goto out;
+
+	hwc->idx = idx;
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	l2x0_pmu_events[idx] = event;
+
+	if (!l2x0_pmu_active++) {
+		writel_relaxed(1, l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+		schedule_delayed_work(&l2x0_pmu_work, L2X0_PMU_POLL);
+	}
+
+	if (flags & PERF_EF_START)
+		l2x0_pmu_event_start(event, 0);
+	ret = 0;
+out:
+	raw_spin_unlock_irqrestore(&l2x0_pmu_lock, irqflags);
+	return ret;
+}
+
+static void l2x0_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+
+	raw_spin_lock_irqsave(&l2x0_pmu_lock, irqflags);
+	l2x0_pmu_event_stop(event, PERF_EF_UPDATE);
+	l2x0_pmu_events[hwc->idx] = NULL;
+	hwc->idx = -1;
+
+	/* the poll stops rescheduling itself */
+	if (!--l2x0_pmu_active)
+		writel_relaxed(0, l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+	raw_spin_unlock_irqrestore(&l2x0_pmu_lock, irqflags);
+}
+
+static void l2x0_pmu_event_update(struct perf_event *event)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&l2x0_pmu_lock, flags);
+	if (!(event->hw.state & PERF_HES_STOPPED))
+		l2x0_pmu_event_read(event);
+	raw_spin_unlock_irqrestore(&l2x0_pmu_lock, flags);
+}
+
+static int l2x0_pmu_event_init(struct perf_event *event)
+{
+	struct perf_event_attr *attr = &event->attr;
+
+	if (attr->type != l2x0_pmu.type)
+		return -ENOENT;
+
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	/* it can't tell who caused the cache traffic */
+	if (attr->exclude_user || attr->exclude_kernel || attr->exclude_hv ||
+	    attr->exclude_idle)
+		return -EINVAL;
+
+	if (event->cpu != 0)
+		return -EINVAL;
+
+	if (attr->config < L2X0_EVENT_CO || attr->config > L2X0_EVENT_EPFRCVD)
+		return -EINVAL;
+
+	/* the whole group has to fit in the two counters */
+	if (event->group_leader != event &&
+	    event->group_leader->pmu == &l2x0_pmu &&
+	    event->group_leader->nr_siblings >= L2X0_PMU_COUNTERS - 1)
+		return -EINVAL;
+
+	event->hw.config_base = attr->config;
+	event->hw.idx = -1;
+	return 0;
+}
+
+static struct pmu l2x0_pmu = {
+	.task_ctx_nr	= perf_invalid_context,
+	.event_init	= l2x0_pmu_event_init,
+	.add		= l2x0_pmu_event_add,
+	.del		= l2x0_pmu_event_del,
+	.start		= l2x0_pmu_event_start,
+	.stop		= l2x0_pmu_event_stop,
+	.read		= l2x0_pmu_event_update,
+};
+
+void __init l2x0_pmu_register(void __iomem *base, u32 cache_id)
+{
+	if ((cache_id & L2X0_CACHE_ID_PART_MASK) != L2X0_CACHE_ID_PART_L310)
+		return;
+
+	l2x0_pmu_base = base;
+}
+
+static int __init l2x0_pmu_init(void)
+{
+	int ret;
+
+	if (!l2x0_pmu_base)
+		return 0;
+
+	/* left counting by the bootloader? */
+	writel_relaxed(0, l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+	writel_relaxed(0, l2x0_pmu_cfg(0));
+	writel_relaxed(0, l2x0_pmu_cfg(1));
+
+	ret = perf_pmu_register(&l2x0_pmu, "l2x0", -1);
+	if (ret)
+		pr_err("registration failed: %d\n", ret);
+	else
+		pr_info("%d counters, type %d\n", L2X0_PMU_COUNTERS,
+			l2x0_pmu.type);
+	return ret;
+}
+device_initcall(l2x0_pmu_init);
@@ -35,6 +35,10 @@
 #include <linux/io.h>
 #include <linux/slab.h>
 #include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/system.h>
 #include <mach/hardware.h>
@@ -62,6 +66,7 @@ static struct omap_dma_dev_attr *d;
 
 static int enable_1510_mode;
 static u32 errata;
+static int sglist_mode;		/* descriptors are loaded by the hardware */
 
 static struct omap_dma_global_context_registers {
 	u32 dma_irqenable_l0;
@@ -703,6 +708,9 @@ int omap_request_dma(int dev_id, const char *dev_name,
 	chan->callback = callback;
 	chan->data = data;
 	chan->flags = 0;
+	chan->sg = NULL;
+	chan->transfers = chan->irqs = 0;
+	chan->sg_lists = chan->sg_entries = 0;
 
 #ifndef CONFIG_ARCH_OMAP1
 	if (cpu_class_is_omap2()) {
@@ -777,6 +785,8 @@ void omap_free_dma(int lch)
 
 		/* Make sure the DMA transfer is stopped. */
 		p->dma_write(0, CCR, lch);
+		if (sglist_mode)
+			p->dma_write(0, CDP, lch);
 		omap_clear_dma(lch);
 	}
 
@@ -918,6 +928,7 @@ void omap_start_dma(int lch)
 	p->dma_write(l, CCR, lch);
 
 	dma_chan[lch].flags |= OMAP_DMA_ACTIVE;
+	dma_chan[lch].transfers++;
 }
 EXPORT_SYMBOL(omap_start_dma);
 
@@ -983,6 +994,13 @@ void omap_stop_dma(int lch)
 		} while (next_lch != -1);
 	}
 
+	/* drop any scatter-gather list, back to normal mode */
+	if (dma_chan[lch].sg) {
+		dma_chan[lch].sg = NULL;
+		if (sglist_mode)
+			p->dma_write(0, CDP, lch);
+	}
+
 	dma_chan[lch].flags &= ~OMAP_DMA_ACTIVE;
 }
 EXPORT_SYMBOL(omap_stop_dma);
@@ -1782,6 +1800,197 @@ int omap_get_dma_chain_src_pos(int chain_id)
 	return p->dma_read(CSAC, lch);
 }
 EXPORT_SYMBOL(omap_get_dma_chain_src_pos);
+
+/*
+ * Scatter-gather lists
+ *
+ * The channel is set up as usual, with the device side address,
+ * synchronization and data type.  A list then supplies the memory side
+ * address and element count of each block.  On omap3630 and omap4 the
+ * blocks are loaded by the hardware from linked list descriptors, and
+ * only the last one interrupts.  Elsewhere they are loaded from the
+ * interrupt handler.  Either way, the channel callback is called once,
+ * when the whole list is done, or on an error.
+ */
+
+/**
+ * @brief omap_dma_sg_alloc : Allocate a scatter-gather list
+ *
+ * @param max - Number of entries it can take
+ * @param gfp - Allocation flags
+ *
+ * @return - The list, or NULL
+ */
+struct omap_dma_sg *omap_dma_sg_alloc(int max, gfp_t gfp)
+{
+	struct omap_dma_sg *sg;
+
+	sg = kzalloc(sizeof(*sg), gfp);
+	if (!sg)
+		return NULL;
+
+	sg->desc = dma_alloc_coherent(NULL, max * sizeof(*sg->desc),
+				      &sg->desc_pa, gfp);
+	if (!sg->desc) {
+		kfree(sg);
+		return NULL;
+	}
+	sg->max = max;
+
+	return sg;
+}
+EXPORT_SYMBOL(omap_dma_sg_alloc);
+
+void omap_dma_sg_free(struct omap_dma_sg *sg)
+{
+	if (!sg)
+		return;
+
+	dma_free_coherent(NULL, sg->max * sizeof(*sg->desc), sg->desc,
+			  sg->desc_pa);
+	kfree(sg);
+}
+EXPORT_SYMBOL(omap_dma_sg_free);
+
+/**
+ * @brief omap_dma_sg_prep : Fill a list from a mapped scatterlist
+ *
+ * @param lch - Channel the list is for, its data type must be set
+ * @param sg - The list
+ * @param sgl - Mapped scatterlist
+ * @param sg_len - Number of entries in it
+ * @param to_dev - Whether memory is the source of the transfer
+ *
+ * @return - Success : 0
+ *	     Failure : -EINVAL
+ */
+int omap_dma_sg_prep(int lch, struct omap_dma_sg *sg,
+		     struct scatterlist *sgl, int sg_len, int to_dev)
+{
+	struct omap_dma_sg_desc *desc;
+	struct scatterlist *s;
+	u32 es, nelem;
+	int i;
+
+	if (unlikely(lch < 0 || lch >= dma_lch_count)) {
+		printk(KERN_ERR "Invalid channel id\n");
+		return -EINVAL;
+	}
+	if (unlikely(sg_len <= 0 || sg_len > sg->max))
+		return -EINVAL;
+
+	/* element size, from the data type */
+	es = p->dma_read(CSDP, lch) & 0x3;
+
+	for_each_sg(sgl, s, sg_len, i) {
+		nelem = sg_dma_len(s) >> es;
+		if (unlikely(!nelem || nelem << es != sg_dma_len(s) ||
+			     nelem > DMA_LIST_DESC_ELEM_MASK))
+			return -EINVAL;
+
+		desc = sg->desc + i;
+		desc->next = sg->desc_pa + (i + 1) * sizeof(*desc);
+		desc->nelem = nelem | DMA_LIST_DESC_NEXT_TYPE3 |
+			(to_dev ? DMA_LIST_DESC_SRC_VALID :
+				  DMA_LIST_DESC_DST_VALID);
+		desc->addr = sg_dma_address(s);
+	}
+
+	/* only the last one ends the list, and interrupts */
+	sg->desc[sg_len - 1].next = DMA_LIST_DESC_END;
+	sg->desc[sg_len - 1].nelem |= DMA_LIST_DESC_BLK_IE;
+	sg->n = sg_len;
+	sg->to_dev = to_dev;
+
+	return 0;
+}
+EXPORT_SYMBOL(omap_dma_sg_prep);
+
+/* load entry i of the list into the channel registers */
+static void omap_dma_sg_load(int lch, struct omap_dma_sg *sg, int i)
+{
+	p->dma_write(sg->desc[i].addr, sg->to_dev ? CSSA : CDSA, lch);
+	p->dma_write(sg->desc[i].nelem & DMA_LIST_DESC_ELEM_MASK, CEN, lch);
+	p->dma_write(1, CFN, lch);
+}
+
+/**
+ * @brief omap_start_dma_sg : Start the transfer of a prepared list
+ *
+ * @param lch - Channel
+ * @param sg - The list, must stay around until the callback
+ *
+ * @return - Success : 0
+ *	     Failure : -EINVAL, -EBUSY
+ */
+int omap_start_dma_sg(int lch, struct omap_dma_sg *sg)
+{
+	struct omap_dma_lch *chan;
+	u32 l;
+
+	if (unlikely(lch < 0 || lch >= dma_lch_count)) {
+		printk(KERN_ERR "Invalid channel id\n");
+		return -EINVAL;
+	}
+	if (unlikely(!sg->n))
+		return -EINVAL;
+
+	chan = dma_chan + lch;
+	if (chan->sg || chan->chain_id != -1 || chan->next_lch != -1)
+		return -EBUSY;
+
+	chan->sg = sg;
+	chan->sg_lists++;
+	chan->sg_entries += sg->n;
+
+	if (sglist_mode) {
+		/* make sure the descriptors are written out */
+		wmb();
+
+		p->dma_write(sg->desc_pa, CNDP, lch);
+		p->dma_write(0, CCDN, lch);
+		p->dma_write(1, CFN, lch);
+
+		l = DMA_LIST_CDP_LISTMODE | DMA_LIST_CDP_TYPE3;
+		l |= sg->to_dev ? DMA_LIST_CDP_SRC_VALID :
+				  DMA_LIST_CDP_DST_VALID;
+		p->dma_write(l, CDP, lch);
+	} else {
+		omap_dma_sg_load(lch, sg, 0);
+		chan->sg_next = 1;
+	}
+
+	omap_start_dma(lch);
+
+	return 0;
+}
+EXPORT_SYMBOL(omap_start_dma_sg);
+
+/*
+ * A block of a list is done: returns 1 if the next one was started,
+ * 0 if the list is done and the callback should be called.
+ */
+static int omap_dma_sg_irq(int lch, u32 status)
+{
+	struct omap_dma_lch *chan = dma_chan + lch;
+	struct omap_dma_sg *sg = chan->sg;
+
+	/* errors are left to the callback, which stops the channel */
+	if (!(status & OMAP_DMA_BLOCK_IRQ) ||
+	    (status & (OMAP2_DMA_TRANS_ERR_IRQ | OMAP_DMA_DROP_IRQ)))
+		return 0;
+
+	if (!sglist_mode && chan->sg_next < sg->n) {
+		omap_dma_sg_load(lch, sg, chan->sg_next++);
+		omap_start_dma(lch);
+		return 1;
+	}
+
+	chan->sg = NULL;
+	if (sglist_mode)
+		p->dma_write(0, CDP, lch);
+	return 0;
+}
 #endif	/* ifndef CONFIG_ARCH_OMAP1 */
 
 /*----------------------------------------------------------------------------*/
@@ -1816,6 +2025,7 @@ static int omap1_dma_handle_ch(int ch)
 		       "with device %d\n", dma_chan[ch].dev_id);
 	if (likely(csr & OMAP_DMA_BLOCK_IRQ))
 		dma_chan[ch].flags &= ~OMAP_DMA_ACTIVE;
+	dma_chan[ch].irqs++;
 	if (likely(dma_chan[ch].callback != NULL))
 		dma_chan[ch].callback(ch, csr, dma_chan[ch].data);
 
@@ -1910,6 +2120,10 @@ static int omap2_dma_handle_ch(int ch)
 		p->dma_write(status, CSR, ch);
 	}
 
+	dma_chan[ch].irqs++;
+	if (dma_chan[ch].sg && omap_dma_sg_irq(ch, status))
+		return 0;
+
 	if (likely(dma_chan[ch].callback != NULL))
 		dma_chan[ch].callback(ch, status, dma_chan[ch].data);
 
@@ -2054,6 +2268,11 @@ static int __devinit omap_system_dma_probe(struct platform_device *pdev)
 		omap_dma_set_global_params(DMA_DEFAULT_ARB_RATE,
 				DMA_DEFAULT_FIFO_DEPTH, 1);
 
+	/* only these have the linked list registers */
+	if ((cpu_is_omap3630() || cpu_is_omap4430()) &&
+	    (p->dma_read(CAPS_0, 0) & DMA_CAPS_SGLIST_SUPPORT))
+		sglist_mode = 1;
+
 	if (cpu_class_is_omap2()) {
 		strcpy(irq_name, "0");
 		dma_irq = platform_get_irq_byname(pdev, irq_name);
@@ -2145,6 +2364,50 @@ MODULE_AUTHOR("Texas Instruments Inc");
  * Reserve the omap SDMA channels using cmdline bootarg
  * "omap_dma_reserve_ch=". The valid range is 1 to 32
  */
+#ifdef CONFIG_DEBUG_FS
+static int omap_dma_stats_show(struct seq_file *s, void *unused)
+{
+	struct omap_dma_lch *chan;
+	int ch;
+
+	seq_printf(s, "%-4s %-4s %-10s %-10s %-8s %-8s %s\n", "lch", "dev",
+		   "transfers", "irqs", "lists", "entries", "name");
+	for (ch = 0; ch < dma_chan_count; ch++) {
+		chan = dma_chan + ch;
+		if (chan->dev_id == -1)
+			continue;
+		seq_printf(s, "%-4d %-4d %-10u %-10u %-8u %-8u %s\n", ch,
+			   chan->dev_id, chan->transfers, chan->irqs,
+			   chan->sg_lists, chan->sg_entries,
+			   chan->dev_name ? chan->dev_name : "");
+	}
+	return 0;
+}
+
+static int omap_dma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap_dma_stats_show, inode->i_private);
+}
+
+static const struct file_operations omap_dma_stats_fops = {
+	.open           = omap_dma_stats_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
+static int __init omap_dma_debugfs_init(void)
+{
+	if (!dma_chan)
+		return 0;
+
+	debugfs_create_file("omap_dma", S_IRUGO, NULL, NULL,
+			    &omap_dma_stats_fops);
+	return 0;
+}
+late_initcall(omap_dma_debugfs_init);
+#endif
+
 static int __init omap_dma_cmdline_reserve_ch(char *str)
 {
 	if (get_option(&str, &omap_dma_reserve_channels) != 1)
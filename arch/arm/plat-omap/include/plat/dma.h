@@ -268,6 +268,21 @@
 #define DMA_IDLEMODE_NO_IDLE			0x1
 #define DMA_IDLEMODE_FORCE_IDLE			0x0
 
+/* Descriptor (linked list) mode, omap3630 and omap4 */
+#define DMA_CAPS_SGLIST_SUPPORT		(1 << 20)	/* CAPS_0 */
+
+#define DMA_LIST_CDP_DST_VALID		(1 << 0)
+#define DMA_LIST_CDP_SRC_VALID		(1 << 2)
+#define DMA_LIST_CDP_TYPE3		(3 << 4)
+#define DMA_LIST_CDP_LISTMODE		(1 << 8)
+
+#define DMA_LIST_DESC_ELEM_MASK		0xffffff
+#define DMA_LIST_DESC_SRC_VALID		(1 << 24)
+#define DMA_LIST_DESC_DST_VALID		(1 << 26)
+#define DMA_LIST_DESC_BLK_IE		(1 << 28)
+#define DMA_LIST_DESC_NEXT_TYPE3	(3 << 29)
+#define DMA_LIST_DESC_END		0xfffffffc
+
 /* Chaining modes*/
 #ifndef CONFIG_ARCH_OMAP1
 #define OMAP_DMA_STATIC_CHAIN		0x1
@@ -416,6 +431,34 @@ struct omap_dma_lch {
 	int state;
 	int chain_id;
 	int status;
+	/* scatter-gather list in progress */
+	struct omap_dma_sg *sg;
+	int sg_next;		/* next entry, when loaded by software */
+	/* statistics */
+	u32 transfers;		/* transfers started */
+	u32 irqs;		/* interrupts taken */
+	u32 sg_lists;		/* scatter-gather lists started */
+	u32 sg_entries;		/* entries in them */
+};
+
+/*
+ * Type 3 linked list descriptor: only the memory side address changes
+ * from one descriptor to the next, everything else is taken from the
+ * channel registers.
+ */
+struct omap_dma_sg_desc {
+	u32 next;		/* phys.addr of the next one, or LIST_DESC_END */
+	u32 nelem;		/* elements, and DMA_LIST_DESC_* flags */
+	u32 addr;		/* memory side start address */
+	u32 pad;		/* descriptors are 16-byte aligned */
+};
+
+struct omap_dma_sg {
+	struct omap_dma_sg_desc *desc;	/* coherent descriptors */
+	dma_addr_t desc_pa;		/* phys.addr of descriptors */
+	int max;			/* descriptors allocated */
+	int n;				/* descriptors in the list */
+	int to_dev;			/* memory is the source */
 };
 
 struct omap_dma_dev_attr {
@@ -519,6 +562,14 @@ extern int omap_get_dma_chain_src_pos(int chain_id);
 extern int omap_modify_dma_chain_params(int chain_id,
 					struct omap_dma_channel_params params);
 extern int omap_dma_chain_status(int chain_id);
+
+/* Scatter-gather APIs */
+struct scatterlist;
+extern struct omap_dma_sg *omap_dma_sg_alloc(int max, gfp_t gfp);
+extern void omap_dma_sg_free(struct omap_dma_sg *sg);
+extern int omap_dma_sg_prep(int lch, struct omap_dma_sg *sg,
+			    struct scatterlist *sgl, int sg_len, int to_dev);
+extern int omap_start_dma_sg(int lch, struct omap_dma_sg *sg);
 #endif
 
 #if defined(CONFIG_ARCH_OMAP1) && defined(CONFIG_FB_OMAP)
@@ -33,4 +33,13 @@ void dsscomp_set_platform_data(struct dsscomp_platform_data *data);
 int dsscomp_apply(dsscomp_t comp);
 u32 dsscomp_mgr_callback(void *data, int id, int status);
 
+/*
+ * display notifiers are called from interrupt context each time a new
+ * composition is first displayed, with the overlay manager index as the
+ * action and a pointer to the ktime_t of the event as data
+ */
+struct notifier_block;
+int dsscomp_register_display_notifier(struct notifier_block *nb);
+int dsscomp_unregister_display_notifier(struct notifier_block *nb);
+
 #endif
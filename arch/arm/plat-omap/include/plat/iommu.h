@@ -27,6 +27,14 @@ struct iotlb_entry {
 	};
 };
 
+/* IOMMU errors */
+#define OMAP_IOMMU_ERR_TLB_MISS		(1 << 0)
+#define OMAP_IOMMU_ERR_TRANS_FAULT	(1 << 1)
+#define OMAP_IOMMU_ERR_EMU_MISS		(1 << 2)
+#define OMAP_IOMMU_ERR_TBLWALK_FAULT	(1 << 3)
+#define OMAP_IOMMU_ERR_MULTIHIT_FAULT	(1 << 4)
+#define OMAP_IOMMU_ERR_NR		5
+
 struct iommu {
 	const char	*name;
 	struct module	*owner;
@@ -45,6 +53,7 @@ struct iommu {
 	spinlock_t	page_table_lock; /* protect iopgd */
 
 	int		nr_tlb_entries;
+	int		nr_tlb_locked;	/* by iommu_lock_tlb() */
 
 	struct list_head	mmap;
 	struct mutex		mmap_lock; /* protect mmap */
@@ -59,6 +68,9 @@ struct iommu {
 	unsigned int pm_constraint;
 	void *secure_ttb;
 	bool secure_mode;
+
+	/* faults seen by the fault handler, by OMAP_IOMMU_ERR_* bit */
+	unsigned long nr_errs[OMAP_IOMMU_ERR_NR];
 };
 
 struct cr_regs {
@@ -102,6 +114,7 @@ struct iommu_functions {
 	ssize_t (*dump_cr)(struct iommu *obj, struct cr_regs *cr, char *buf);
 
 	u32 (*get_pte_attr)(struct iotlb_entry *e);
+	void (*pte_to_e)(u32 pte, struct iotlb_entry *e);
 
 	void (*save_ctx)(struct iommu *obj);
 	void (*restore_ctx)(struct iommu *obj);
@@ -119,13 +132,6 @@ struct iommu_platform_data {
 	void __iomem *io_base;
 };
 
-/* IOMMU errors */
-#define OMAP_IOMMU_ERR_TLB_MISS		(1 << 0)
-#define OMAP_IOMMU_ERR_TRANS_FAULT	(1 << 1)
-#define OMAP_IOMMU_ERR_EMU_MISS		(1 << 2)
-#define OMAP_IOMMU_ERR_TBLWALK_FAULT	(1 << 3)
-#define OMAP_IOMMU_ERR_MULTIHIT_FAULT	(1 << 4)
-
 #if defined(CONFIG_ARCH_OMAP1)
 #error "iommu for this processor not implemented yet"
 #else
@@ -174,6 +180,8 @@ extern int iopgtable_store_entry(struct iommu *obj, struct iotlb_entry *e);
 extern void iopgtable_lookup_entry(struct iommu *obj, u32 da, u32 **ppgd,
 				   u32 **ppte);
 extern size_t iopgtable_clear_entry(struct iommu *obj, u32 iova);
+extern int iommu_lock_tlb(struct iommu *obj, u32 da, size_t bytes);
+extern void iommu_unlock_tlb(struct iommu *obj);
 
 extern int iommu_set_da_range(struct iommu *obj, u32 start, u32 end);
 extern struct iommu *iommu_get(const char *name);
@@ -63,4 +63,11 @@ void omap_temp_sensor_idle(int idle_state);
 static inline void omap_temp_sensor_idle(int idle_state) { }
 #endif
 
+#ifdef CONFIG_OMAP_DIE_TEMP_SENSOR
+/* past the t_hot alert and not yet back under t_cold */
+bool omap_temp_sensor_hot(void);
+#else
+static inline bool omap_temp_sensor_hot(void) { return false; }
+#endif
+
 #endif
@@ -208,6 +208,73 @@ static ssize_t debug_read_pagetable(struct file *file, char __user *userbuf,
 	return bytes;
 }
 
+/* how many pages of each size the page table maps */
+static void count_iopages(struct iommu *obj, unsigned long *nr)
+{
+	int i, j;
+	u32 *iopgd;
+
+	spin_lock(&obj->page_table_lock);
+
+	iopgd = iopgd_offset(obj, 0);
+	for (i = 0; i < PTRS_PER_IOPGD; i++, iopgd++) {
+		u32 *iopte;
+
+		if (!*iopgd)
+			continue;
+
+		if (!iopgd_is_table(*iopgd)) {
+			/* a supersection takes 16 entries */
+			if ((*iopgd & IOPGD_SUPER) == IOPGD_SUPER)
+				nr[3] += !(i & 15);
+			else
+				nr[2]++;
+			continue;
+		}
+
+		iopte = iopte_offset(iopgd, 0);
+		for (j = 0; j < PTRS_PER_IOPTE; j++, iopte++) {
+			if (!*iopte)
+				continue;
+
+			/* and so does a large page */
+			if ((*iopte & 3) == IOPTE_LARGE)
+				nr[1] += !(j & 15);
+			else
+				nr[0]++;
+		}
+	}
+
+	spin_unlock(&obj->page_table_lock);
+}
+
+static ssize_t debug_read_stats(struct file *file, char __user *userbuf,
+				size_t count, loff_t *ppos)
+{
+	static const char *errs[OMAP_IOMMU_ERR_NR] = {
+		"tlb miss", "translation fault", "emu miss",
+		"table walk fault", "multi-hit fault",
+	};
+	struct iommu *obj = file->private_data;
+	unsigned long nr[4] = { 0 };
+	char buf[MAXCOLUMN * 8], *p = buf;
+	int i;
+
+	mutex_lock(&iommu_debug_lock);
+
+	for (i = 0; i < OMAP_IOMMU_ERR_NR; i++)
+		p += sprintf(p, "%-18s %lu\n", errs[i], obj->nr_errs[i]);
+	p += sprintf(p, "%-18s %d\n", "locked entries", obj->nr_tlb_locked);
+
+	count_iopages(obj, nr);
+	p += sprintf(p, "pages: 4K %lu 64K %lu 1M %lu 16M %lu\n",
+		     nr[0], nr[1], nr[2], nr[3]);
+
+	mutex_unlock(&iommu_debug_lock);
+
+	return simple_read_from_buffer(userbuf, count, ppos, buf, p - buf);
+}
+
 static ssize_t debug_read_mmap(struct file *file, char __user *userbuf,
 			       size_t count, loff_t *ppos)
 {
@@ -341,6 +408,7 @@ static int debug_open_generic(struct inode *inode, struct file *file)
 DEBUG_FOPS_RO(ver);
 DEBUG_FOPS_RO(regs);
 DEBUG_FOPS_RO(tlb);
+DEBUG_FOPS_RO(stats);
 DEBUG_FOPS(pagetable);
 DEBUG_FOPS_RO(mmap);
 DEBUG_FOPS(mem);
@@ -379,6 +447,7 @@ static int iommu_debug_register(struct device *dev, void *data)
 	DEBUG_ADD_FILE_RO(ver);
 	DEBUG_ADD_FILE_RO(regs);
 	DEBUG_ADD_FILE_RO(tlb);
+	DEBUG_ADD_FILE_RO(stats);
 	DEBUG_ADD_FILE(pagetable);
 	DEBUG_ADD_FILE_RO(mmap);
 	DEBUG_ADD_FILE(mem);
@@ -771,6 +771,172 @@ static void iopgtable_clear_entry_all(struct iommu *obj)
 	spin_unlock(&obj->page_table_lock);
 }
 
+/*
+ * The iotlb entry for the page table entry mapping @da, or 0 if there is
+ * none.  Called with page_table_lock held.
+ */
+static size_t iopgtable_to_iotlb_entry(struct iommu *obj, u32 da,
+				       struct iotlb_entry *e)
+{
+	u32 *iopgd = iopgd_offset(obj, da);
+	u32 desc, pa, pgsz;
+
+	if (!*iopgd)
+		return 0;
+
+	if (iopgd_is_table(*iopgd)) {
+		desc = *iopte_offset(iopgd, da);
+		if (!desc)
+			return 0;
+
+		if ((desc & 3) == IOPTE_LARGE) {
+			da &= IOLARGE_MASK;
+			pa = desc & IOLARGE_MASK;
+			pgsz = MMU_CAM_PGSZ_64K;
+		} else {
+			da &= IOPTE_MASK;
+			pa = desc & IOPTE_MASK;
+			pgsz = MMU_CAM_PGSZ_4K;
+		}
+	} else {
+		desc = *iopgd;
+		if ((desc & IOPGD_SUPER) == IOPGD_SUPER) {
+			da &= IOSUPER_MASK;
+			pa = desc & IOSUPER_MASK;
+			pgsz = MMU_CAM_PGSZ_16M;
+		} else {
+			da &= IOSECTION_MASK;
+			pa = desc & IOSECTION_MASK;
+			pgsz = MMU_CAM_PGSZ_1M;
+		}
+	}
+
+	iotlb_init_entry(e, da, pa, pgsz);
+	arch_iommu->pte_to_e(desc, e);
+
+	return iopgsz_to_bytes(pgsz);
+}
+
+/**
+ * iommu_lock_tlb - Preload and lock the iotlb entries of a range
+ * @obj:	target iommu
+ * @da:		start of the range, in iommu device virtual address
+ * @bytes:	its size
+ *
+ * Load the current page table entries of the range into the preserved
+ * part of the iotlb, where they stay until iommu_unlock_tlb(), so that the
+ * buffers a remote core or the ISS goes through every frame no longer take
+ * table walks.  Entries are few: at most half of the iotlb can be locked,
+ * so the range had better be mapped with large pages.  Locked entries are
+ * lost when the iommu is put for the last time.
+ *
+ * Returns the number of entries locked.
+ **/
+int iommu_lock_tlb(struct iommu *obj, u32 da, size_t bytes)
+{
+	struct iotlb_entry *e;
+	u32 end = da + bytes;
+	int i, n, room, err = 0;
+
+	if (!obj || !bytes || end < da)
+		return -EINVAL;
+
+	if (obj->secure_mode) {
+		WARN_ON(1);
+		return -EBUSY;
+	}
+
+	mutex_lock(&obj->iommu_lock);
+
+	if (!obj->refcount) {
+		err = -ENODEV;
+		goto out;
+	}
+
+	room = obj->nr_tlb_entries / 2 - obj->nr_tlb_locked;
+	if (room <= 0) {
+		err = -ENOSPC;
+		goto out;
+	}
+
+	e = kcalloc(room, sizeof(*e), GFP_KERNEL);
+	if (!e) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	spin_lock(&obj->page_table_lock);
+	for (n = 0; da < end; n++) {
+		size_t size;
+
+		if (n == room) {
+			err = -ENOSPC;
+			break;
+		}
+
+		size = iopgtable_to_iotlb_entry(obj, da, &e[n]);
+		if (!size) {
+			dev_err(obj->dev, "%s: %08x isn't mapped\n",
+				__func__, da);
+			err = -EFAULT;
+			break;
+		}
+		e[n].prsvd = MMU_CAM_P;
+		da = e[n].da + size;
+	}
+	spin_unlock(&obj->page_table_lock);
+
+	for (i = 0; !err && i < n; i++) {
+		/* a second entry for the same page would be a multi-hit */
+		flush_iotlb_page(obj, e[i].da);
+		err = load_iotlb_entry(obj, &e[i]);
+		if (!err)
+			obj->nr_tlb_locked++;
+	}
+	if (!err)
+		err = n;
+
+	kfree(e);
+out:
+	mutex_unlock(&obj->iommu_lock);
+	return err;
+}
+EXPORT_SYMBOL_GPL(iommu_lock_tlb);
+
+/**
+ * iommu_unlock_tlb - Drop the iotlb entries locked by iommu_lock_tlb()
+ * @obj:	target iommu
+ **/
+void iommu_unlock_tlb(struct iommu *obj)
+{
+	struct iotlb_lock l;
+	struct cr_regs cr;
+	int i;
+
+	if (!obj || obj->secure_mode)
+		return;
+
+	mutex_lock(&obj->iommu_lock);
+
+	if (!obj->refcount || !obj->nr_tlb_locked)
+		goto out;
+
+	/* the global flush leaves preserved entries alone: go one by one */
+	iotlb_lock_get(obj, &l);
+	for_each_iotlb_cr(obj, l.base, i, cr)
+		if (iotlb_cr_valid(&cr))
+			flush_iotlb_page(obj, iotlb_cr_to_virt(&cr));
+
+	l.base = 0;
+	l.vict = 0;
+	iotlb_lock_set(obj, &l);
+
+	obj->nr_tlb_locked = 0;
+out:
+	mutex_unlock(&obj->iommu_lock);
+}
+EXPORT_SYMBOL_GPL(iommu_unlock_tlb);
+
 /*
  *	Device IOMMU generic operations
  */
@@ -779,6 +945,7 @@ static irqreturn_t iommu_fault_handler(int irq, void *data)
 	u32 da, errs;
 	u32 *iopgd, *iopte;
 	struct iommu *obj = data;
+	int i;
 
 	if (!obj->refcount)
 		return IRQ_NONE;
@@ -787,6 +954,10 @@ static irqreturn_t iommu_fault_handler(int irq, void *data)
 	if (errs == 0)
 		return IRQ_HANDLED;
 
+	for (i = 0; i < OMAP_IOMMU_ERR_NR; i++)
+		if (errs & (1 << i))
+			obj->nr_errs[i]++;
+
 	/* Fault callback or TLB/PTE Dynamic loading */
 	if (obj->isr && !obj->isr(obj, da, errs, obj->isr_priv))
 		return IRQ_HANDLED;
@@ -891,6 +1062,7 @@ struct iommu *iommu_get(const char *name)
 			goto err_enable;
 
 		flush_iotlb_all(obj);
+		obj->nr_tlb_locked = 0;
 	}
 
 	if (!try_module_get(obj->owner))
@@ -121,6 +121,27 @@ static unsigned sgtable_nents(size_t bytes, u32 da, u32 pa)
 	return nr_entries;
 }
 
+/*
+ * the largest iommu page the start of 'sgt' could be mapped with, given a
+ * suitably aligned 'da': the physically contiguous run of its first
+ * elements, and how that is aligned.
+ */
+static u32 sgtable_da_align(const struct sg_table *sgt)
+{
+	struct scatterlist *sg = sgt->sgl;
+	unsigned int n = sgt->nents;
+	u32 pa = sg_phys(sg);
+	size_t len = 0;
+
+	do {
+		len += sg_dma_len(sg);
+		sg = sg_next(sg);
+	} while (--n && sg_phys(sg) == pa + len);
+
+	return max_t(u32, min_t(u32, max_alignment(pa), iopgsz_max(len)),
+		     PAGE_SIZE);
+}
+
 /* allocate and initialize sg_table header(a kind of 'superblock') */
 static struct sg_table *sgtable_alloc(const size_t bytes, u32 flags,
 							u32 da, u32 pa)
@@ -268,7 +289,8 @@ EXPORT_SYMBOL_GPL(find_iovm_area);
  * in iovmas mmap, and returns the new allocated iovma.
  */
 static struct iovm_struct *alloc_iovm_area(struct iommu *obj, u32 da,
-					   size_t bytes, u32 flags)
+					   size_t bytes, u32 flags,
+					   const struct sg_table *sgt)
 {
 	struct iovm_struct *new, *tmp;
 	u32 start, prev_end, alignment;
@@ -285,6 +307,8 @@ static struct iovm_struct *alloc_iovm_area(struct iommu *obj, u32 da,
 
 		if (flags & IOVMF_LINEAR)
 			alignment = iopgsz_max(bytes);
+		else if (sgt)
+			alignment = sgtable_da_align(sgt);
 		start = roundup(start, alignment);
 	} else if (start < obj->da_start || start > obj->da_end ||
 					obj->da_end - start < bytes) {
@@ -455,58 +479,71 @@ static inline void sgtable_drain_kmalloc(struct sg_table *sgt)
 	BUG_ON(!sgt);
 }
 
-/* create 'da' <-> 'pa' mapping from 'sgt' */
+/*
+ * create 'da' <-> 'pa' mapping from 'sgt'
+ *
+ * Physically contiguous runs of elements are mapped as if they were one,
+ * with the largest pages their alignment allows rather than the size of
+ * each element: ION and carveout buffers come in as a list of 4KB pages,
+ * which made for a TLB miss every 4KB of a video frame.
+ */
 static int map_iovm_area(struct iommu *obj, struct iovm_struct *new,
 			 const struct sg_table *sgt, u32 flags)
 {
-	int err;
-	unsigned int i, j;
+	int err = 0;
+	unsigned int n;
 	struct scatterlist *sg;
-	u32 da = new->da_start;
+	u32 start, da = new->da_start;
+	size_t bytes;
 
 	if (!obj || !sgt)
 		return -EINVAL;
 
 	BUG_ON(!sgtable_ok(sgt));
 
-	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
-		u32 pa;
-		int pgsz;
-		size_t bytes;
-		struct iotlb_entry e;
+	sg = sgt->sgl;
+	n = sgt->nents;
+	while (n) {
+		u32 pa = sg_phys(sg);
+		size_t len = 0;
 
-		pa = sg_phys(sg);
-		bytes = sg_dma_len(sg);
+		do {
+			len += sg_dma_len(sg);
+			sg = sg_next(sg);
+		} while (--n && sg_phys(sg) == pa + len);
 
-		flags &= ~IOVMF_PGSZ_MASK;
-		pgsz = bytes_to_iopgsz(bytes);
-		if (pgsz < 0)
-			goto err_out;
-		flags |= pgsz;
+		while (len) {
+			struct iotlb_entry e;
 
-		pr_debug("%s: [%d] %08x %08x(%x)\n", __func__,
-			 i, da, pa, bytes);
+			bytes = max_alignment(da | pa);
+			bytes = min_t(unsigned, bytes, iopgsz_max(len));
+			if (!bytes) {
+				err = -EINVAL;
+				goto err_out;
+			}
 
-		iotlb_init_entry(&e, da, pa, flags);
-		err = iopgtable_store_entry(obj, &e);
-		if (err)
-			goto err_out;
+			flags &= ~IOVMF_PGSZ_MASK;
+			flags |= bytes_to_iopgsz(bytes);
 
-		da += bytes;
+			pr_debug("%s: %08x %08x(%x)\n", __func__, da, pa, bytes);
+
+			iotlb_init_entry(&e, da, pa, flags);
+			err = iopgtable_store_entry(obj, &e);
+			if (err)
+				goto err_out;
+
+			da += bytes;
+			pa += bytes;
+			len -= bytes;
+		}
 	}
 	return 0;
 
 err_out:
-	da = new->da_start;
-
-	for_each_sg(sgt->sgl, sg, i, j) {
-		size_t bytes;
-
-		bytes = iopgtable_clear_entry(obj, da);
+	for (start = new->da_start; start < da; start += bytes) {
+		bytes = iopgtable_clear_entry(obj, start);
 
 		BUG_ON(!iopgsz_ok(bytes));
-
-		da += bytes;
 	}
 	return err;
 }
@@ -588,7 +625,7 @@ static u32 map_iommu_region(struct iommu *obj, u32 da,
 
 	mutex_lock(&obj->mmap_lock);
 
-	new = alloc_iovm_area(obj, da, bytes, flags);
+	new = alloc_iovm_area(obj, da, bytes, flags, sgt);
 	if (IS_ERR(new)) {
 		err = PTR_ERR(new);
 		goto err_alloc_iovma;
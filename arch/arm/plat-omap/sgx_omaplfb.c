@@ -33,10 +33,16 @@
 #define OMAPLFB_NUM_DEV 1
 #endif
 
+#if defined(CONFIG_OMAPLFB_NUM_BUFFERS)
+#define OMAPLFB_NUM_BUFFERS CONFIG_OMAPLFB_NUM_BUFFERS
+#else
+#define OMAPLFB_NUM_BUFFERS 2
+#endif
+
 static struct sgx_omaplfb_config omaplfb_config[OMAPLFB_NUM_DEV] = {
 	{
-	.tiler2d_buffers = 2,
-	.swap_chain_length = 2,
+	.tiler2d_buffers = OMAPLFB_NUM_BUFFERS,
+	.swap_chain_length = OMAPLFB_NUM_BUFFERS,
 	}
 };
 
@@ -24,6 +24,7 @@
 #include <linux/proc_fs.h>
 
 #include <asm/cputype.h>
+#include <asm/neon.h>
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
 
@@ -532,29 +533,74 @@ void vfp_flush_hwstate(struct thread_info *thread)
 /*
  * Kernel-side NEON support functions
  */
+static bool vfp_state_in_hw(unsigned int cpu, struct thread_info *thread)
+{
+#ifdef CONFIG_SMP
+	if (thread->vfpstate.hard.cpu != cpu)
+		return false;
+#endif
+	return vfp_current_hw_state[cpu] == &thread->vfpstate;
+}
+
 void kernel_neon_begin(void)
 {
- unsigned int cpu;
- u32 fpexc;
+	struct thread_info *thread = current_thread_info();
+	unsigned int cpu;
+	u32 fpexc;
 
- /*
-	* Kernel mode NEON is only allowed outside of interrupt context
-	* with preemption disabled. This will make sure that the kernel
-	* mode NEON register contents never need to be preserved.
-	*/
- cpu = get_cpu();
+	/*
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * with preemption disabled. This will make sure that the kernel
+	 * mode NEON register contents never need to be preserved.
+	 */
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
 
- fpexc = fmrx(FPEXC) | FPEXC_EN;
- fmxr(FPEXC, fpexc);
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
 
+	/*
+	 * Save the userland NEON/VFP state. Under UP,
+	 * the owner could be a task other than 'current'
+	 */
+	if (vfp_state_in_hw(cpu, thread))
+		vfp_save_state(&thread->vfpstate, fpexc);
 #ifndef CONFIG_SMP
- else if (vfp_current_hw_state[cpu] != NULL)
- vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+	else if (vfp_current_hw_state[cpu] != NULL)
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc);
 #endif
- vfp_current_hw_state[cpu] = NULL;
+	vfp_current_hw_state[cpu] = NULL;
 }
 EXPORT_SYMBOL(kernel_neon_begin);
 
+/*
+ * kernel_neon_begin() for callers that have a fallback and only want
+ * the unit when taking it is cheap and safe: outside interrupt context,
+ * once VFP access has been enabled on this CPU, and while the unit is
+ * switched off.  That last one means no other kernel mode NEON section
+ * is running on this CPU, which memcpy() called from inside one would
+ * otherwise end early, and that current has no live register state to
+ * save.  Returns false, having done nothing, when any of these fails.
+ */
+bool kernel_neon_try_begin(void)
+{
+	const u32 access = CPACC_FULL(10) | CPACC_FULL(11);
+	bool ok;
+
+	if (in_interrupt() || !cpu_has_neon())
+		return false;
+
+	preempt_disable();
+	ok = (get_copro_access() & access) == access &&
+	     !(fmrx(FPEXC) & FPEXC_EN);
+	if (ok)
+		kernel_neon_begin();
+	preempt_enable();
+
+	return ok;
+}
+EXPORT_SYMBOL(kernel_neon_try_begin);
+
 void kernel_neon_end(void)
 {
  /* Disable the NEON/VFP unit. */
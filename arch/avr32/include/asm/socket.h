@@ -62,4 +62,7 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_BUSY_POLL		46
+#define SO_BUSY_POLL_STATS	47
+
 #endif /* __ASM_AVR32_SOCKET_H */
@@ -62,5 +62,8 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_BUSY_POLL		46
+#define SO_BUSY_POLL_STATS	47
+
 #endif /* _ASM_SOCKET_H */
 
@@ -69,4 +69,7 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_BUSY_POLL		46
+#define SO_BUSY_POLL_STATS	47
+
 #endif	/* _ASM_POWERPC_SOCKET_H */
@@ -57,6 +57,14 @@ struct cgroup_subsys blkio_subsys = {
 };
 EXPORT_SYMBOL_GPL(blkio_subsys);
 
+/* whether @blkiop is to be told about changes to @blkg */
+static inline bool blkio_policy_owns(struct blkio_policy_type *blkiop,
+				     struct blkio_group *blkg)
+{
+	return blkiop->plid == blkg->plid &&
+	       (!blkg->blkiop || blkg->blkiop == blkiop);
+}
+
 static inline void blkio_policy_insert_node(struct blkio_cgroup *blkcg,
 					    struct blkio_policy_node *pn)
 {
@@ -126,7 +134,7 @@ blkio_update_group_weight(struct blkio_group *blkg, unsigned int weight)
 
 	list_for_each_entry(blkiop, &blkio_list, list) {
 		/* If this policy does not own the blkg, do not send updates */
-		if (blkiop->plid != blkg->plid)
+		if (!blkio_policy_owns(blkiop, blkg))
 			continue;
 		if (blkiop->ops.blkio_update_group_weight_fn)
 			blkiop->ops.blkio_update_group_weight_fn(blkg->key,
@@ -142,7 +150,7 @@ static inline void blkio_update_group_bps(struct blkio_group *blkg, u64 bps,
 	list_for_each_entry(blkiop, &blkio_list, list) {
 
 		/* If this policy does not own the blkg, do not send updates */
-		if (blkiop->plid != blkg->plid)
+		if (!blkio_policy_owns(blkiop, blkg))
 			continue;
 
 		if (fileid == BLKIO_THROTL_read_bps_device
@@ -165,7 +173,7 @@ static inline void blkio_update_group_iops(struct blkio_group *blkg,
 	list_for_each_entry(blkiop, &blkio_list, list) {
 
 		/* If this policy does not own the blkg, do not send updates */
-		if (blkiop->plid != blkg->plid)
+		if (!blkio_policy_owns(blkiop, blkg))
 			continue;
 
 		if (fileid == BLKIO_THROTL_read_iops_device
@@ -1578,7 +1586,7 @@ static void blkiocg_destroy(struct cgroup_subsys *subsys, struct cgroup *cgroup)
 		 */
 		spin_lock(&blkio_list_lock);
 		list_for_each_entry(blkiop, &blkio_list, list) {
-			if (blkiop->plid != blkg->plid)
+			if (!blkio_policy_owns(blkiop, blkg))
 				continue;
 			blkiop->ops.blkio_unlink_group_fn(key, blkg);
 		}
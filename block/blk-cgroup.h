@@ -169,6 +169,11 @@ struct blkio_group {
 	dev_t dev;
 	/* policy which owns this blk group */
 	enum blkio_policy_id plid;
+	/*
+	 * Set when more than one io scheduler implements plid: the one
+	 * that created the group, and the only one told about changes.
+	 */
+	struct blkio_policy_type *blkiop;
 
 	/* Need to serialize the stats in the case of reset/update */
 	spinlock_t stats_lock;
@@ -509,6 +509,9 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	if (blk_throtl_init(q))
 		goto fail_id;
 
+	/* the histograms are only statistics, a queue works without them */
+	blk_lat_hist_init(q);
+
 	setup_timer(&q->backing_dev_info.laptop_mode_wb_timer,
 		    laptop_mode_timer_fn, (unsigned long) q);
 	setup_timer(&q->timeout, blk_rq_timed_out_timer, (unsigned long) q);
@@ -1100,6 +1103,12 @@ int blk_reinsert_request(struct request_queue *q, struct request *rq)
 	if (blk_rq_tagged(rq))
 		blk_queue_end_tag(q, rq);
 
+	/* taken for the urgent one by blk_fetch_request(), let it be marked */
+	if (test_bit(REQ_ATOM_URGENT, &rq->atomic_flags)) {
+		q->dispatched_urgent = false;
+		blk_clear_rq_urgent(rq);
+	}
+
 	BUG_ON(blk_queued_rq(rq));
 
 	return elv_reinsert_request(q, rq);
@@ -1332,6 +1341,7 @@ static bool attempt_plug_merge(struct request_queue *q, struct bio *bio,
 		if (rq->q != q)
 			continue;
 
+		(*request_count)++;
 		el_ret = elv_try_merge(rq, bio);
 		if (el_ret == ELEVATOR_BACK_MERGE) {
 			ret = bio_attempt_back_merge(q, rq, bio);
@@ -1367,6 +1377,7 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	struct blk_plug *plug;
 	int el_ret, rw_flags, where = ELEVATOR_INSERT_SORT;
 	struct request *req;
+	unsigned int request_count = 0;
 
 	/*
 	 * low level driver can indicate that it wants pages above a
@@ -1383,8 +1394,13 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 
 	/*
 	 * Check if we can merge with the plugged list before grabbing
-	 * any locks.
+	 * any locks.  Bios of a plugged submitter are batched and merged
+	 * here, and only take the queue lock once per request for the
+	 * elevator merge and allocation, then once per batch on unplug.
 	 */
+	if (attempt_plug_merge(q, bio, &request_count))
+		goto out;
+
 	spin_lock_irq(q->queue_lock);
 
 	el_ret = elv_merge(q, &req, bio);
@@ -1443,12 +1459,22 @@ get_rq:
 		 */
 		if (list_empty(&plug->list))
 			trace_block_plug(q);
-		else if (!plug->should_sort) {
-			struct request *__rq;
+		else {
+			if (!plug->should_sort) {
+				struct request *__rq;
 
-			__rq = list_entry_rq(plug->list.prev);
-			if (__rq->q != q)
-				plug->should_sort = 1;
+				__rq = list_entry_rq(plug->list.prev);
+				if (__rq->q != q)
+					plug->should_sort = 1;
+			}
+			/*
+			 * Don't let a long plug hold back requests the
+			 * driver could already be working on.
+			 */
+			if (request_count >= BLK_MAX_REQUEST_COUNT) {
+				blk_flush_plug_list(plug, false);
+				trace_block_plug(q);
+			}
 		}
 		list_add_tail(&req->queuelist, &plug->list);
 		drive_stat_acct(req, 1);
@@ -2065,6 +2091,8 @@ void blk_dequeue_request(struct request *rq)
 	if (blk_account_rq(rq)) {
 		q->in_flight[rq_is_sync(rq)]++;
 		set_io_start_time_ns(rq);
+		blk_lat_hist_dispatch(rq);
+		blk_ra_io_start(q, rq);
 	}
 }
 
@@ -2362,6 +2390,8 @@ static void blk_finish_request(struct request *req, int error)
 	if (req->cmd_flags & REQ_DONTPREP)
 		blk_unprep_request(req);
 
+	if (blk_account_rq(req))
+		blk_lat_hist_done(req);
 
 	blk_account_io_done(req);
 
@@ -0,0 +1,163 @@
+/*
+ * Per queue request latency histograms
+ *
+ * Two histograms are kept for every request queue: the time a request
+ * spent queued, from its allocation until it was handed to the driver,
+ * which is the scheduler's share of the latency, and the time from then
+ * until it completed, which is the device's.  Each is split by direction,
+ * sync or async and request size, and counts requests in power of two
+ * buckets of microseconds.
+ *
+ * They are exported in /sys/block/<dev>/queue/latency_hist_{queue,service}
+ * and cleared by writing anything to those files.
+ */
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
+#include <linux/log2_hist.h>
+
+#include "blk.h"
+
+/* log2 histograms of 1us buckets, see <linux/log2_hist.h> */
+#define BLK_LAT_HIST_BUCKETS	20
+#define BLK_LAT_HIST_SIZES	5
+
+struct blk_lat_hist {
+	/* [hist][write][sync][size][bucket] */
+	u32 count[2][2][2][BLK_LAT_HIST_SIZES][BLK_LAT_HIST_BUCKETS];
+};
+
+static const char *blk_lat_hist_size_name[BLK_LAT_HIST_SIZES] = {
+	"4k", "16k", "64k", "256k", "large",
+};
+
+int blk_lat_hist_init(struct request_queue *q)
+{
+	q->lat_hist = kzalloc(sizeof(*q->lat_hist), GFP_KERNEL);
+	if (!q->lat_hist)
+		return -ENOMEM;
+	return 0;
+}
+
+void blk_lat_hist_exit(struct request_queue *q)
+{
+	kfree(q->lat_hist);
+	q->lat_hist = NULL;
+}
+
+static int blk_lat_hist_bucket(u64 delta_ns)
+{
+	return log2_hist_bucket(div_u64(delta_ns, NSEC_PER_USEC),
+				BLK_LAT_HIST_BUCKETS);
+}
+
+static int blk_lat_hist_size(unsigned int bytes)
+{
+	int i;
+
+	/* 4k, then a factor of four per size */
+	for (i = 0; i < BLK_LAT_HIST_SIZES - 1; i++)
+		if (bytes <= (4096U << (2 * i)))
+			break;
+	return i;
+}
+
+/* the queue lock keeps preemption off around sched_clock() */
+static void blk_lat_hist_add(struct request *rq, int hist, u64 start)
+{
+	u64 now = sched_clock();
+
+	if (!start || (s64)(now - start) < 0)
+		return;
+
+	rq->q->lat_hist->count[hist][rq_data_dir(rq)][rq_is_sync(rq)]
+		[blk_lat_hist_size(rq->io_start_bytes)]
+		[blk_lat_hist_bucket(now - start)]++;
+}
+
+/*
+ * Called with the queue lock held once @rq was taken off the queue by
+ * the driver, right after its io_start_time_ns was stamped.
+ */
+void blk_lat_hist_dispatch(struct request *rq)
+{
+	if (!rq->q->lat_hist)
+		return;
+
+	rq->io_start_bytes = blk_rq_bytes(rq);
+	blk_lat_hist_add(rq, BLK_LAT_QUEUE, rq_start_time_ns(rq));
+}
+
+/* called with the queue lock held when @rq completes */
+void blk_lat_hist_done(struct request *rq)
+{
+	if (!rq->q->lat_hist)
+		return;
+
+	blk_lat_hist_add(rq, BLK_LAT_SERVICE, rq_io_start_time_ns(rq));
+}
+
+ssize_t blk_lat_hist_show(struct request_queue *q, char *page, int hist)
+{
+	struct blk_lat_hist *h = q->lat_hist;
+	ssize_t len;
+	int w, s, size, i;
+
+	if (!h)
+		return -ENOMEM;
+
+	len = scnprintf(page, PAGE_SIZE, "%-16s", "usecs");
+	for (i = 0; i < BLK_LAT_HIST_BUCKETS; i++)
+		len += scnprintf(page + len, PAGE_SIZE - len, " %s%llu",
+				 i < BLK_LAT_HIST_BUCKETS - 1 ? "<" : ">=",
+				 log2_hist_bound(i, BLK_LAT_HIST_BUCKETS));
+	len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+
+	spin_lock_irq(q->queue_lock);
+	for (w = 0; w < 2; w++) {
+		for (s = 1; s >= 0; s--) {
+			for (size = 0; size < BLK_LAT_HIST_SIZES; size++) {
+				u32 *count = h->count[hist][w][s][size];
+				char name[24];
+
+				for (i = 0; i < BLK_LAT_HIST_BUCKETS; i++)
+					if (count[i])
+						break;
+				if (i == BLK_LAT_HIST_BUCKETS)
+					continue;
+
+				snprintf(name, sizeof(name), "%s_%s_%s",
+					 w ? "write" : "read",
+					 s ? "sync" : "async",
+					 blk_lat_hist_size_name[size]);
+				len += scnprintf(page + len, PAGE_SIZE - len,
+						 "%-16s", name);
+				for (i = 0; i < BLK_LAT_HIST_BUCKETS; i++)
+					len += scnprintf(page + len,
+							 PAGE_SIZE - len,
+							 " %u", count[i]);
+				len += scnprintf(page + len, PAGE_SIZE - len,
+						 "\n");
+			}
+		}
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	return len;
+}
+
+ssize_t blk_lat_hist_store(struct request_queue *q, const char *page,
+			   size_t count, int hist)
+{
+	struct blk_lat_hist *h = q->lat_hist;
+
+	if (!h)
+		return -ENOMEM;
+
+	spin_lock_irq(q->queue_lock);
+	memset(h->count[hist], 0, sizeof(h->count[hist]));
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
@@ -100,6 +100,51 @@ queue_ra_store(struct request_queue *q, const char *page, size_t count)
 	return ret;
 }
 
+static ssize_t queue_ra_max_show(struct request_queue *q, char *page)
+{
+	unsigned long ra_kb = q->backing_dev_info.ra_max_pages <<
+					(PAGE_CACHE_SHIFT - 10);
+
+	return queue_var_show(ra_kb, (page));
+}
+
+static ssize_t
+queue_ra_max_store(struct request_queue *q, const char *page, size_t count)
+{
+	unsigned long ra_kb;
+	ssize_t ret = queue_var_store(&ra_kb, page, count);
+
+	bdi_set_ra_max_pages(&q->backing_dev_info,
+			     ra_kb >> (PAGE_CACHE_SHIFT - 10));
+
+	return ret;
+}
+
+static ssize_t queue_ra_window_show(struct request_queue *q, char *page)
+{
+	unsigned long ra_kb = q->backing_dev_info.ra_window <<
+					(PAGE_CACHE_SHIFT - 10);
+
+	return queue_var_show(ra_kb, (page));
+}
+
+static ssize_t queue_read_bw_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(q->backing_dev_info.read_bandwidth, (page));
+}
+
+static ssize_t queue_ra_hits_show(struct request_queue *q, char *page)
+{
+	return sprintf(page, "%lld\n",
+		       bdi_stat_sum(&q->backing_dev_info, BDI_RA_HIT));
+}
+
+static ssize_t queue_ra_misses_show(struct request_queue *q, char *page)
+{
+	return sprintf(page, "%lld\n",
+		       bdi_stat_sum(&q->backing_dev_info, BDI_RA_MISS));
+}
+
 static ssize_t queue_max_sectors_show(struct request_queue *q, char *page)
 {
 	int max_sectors_kb = queue_max_sectors(q) >> 1;
@@ -280,6 +325,32 @@ static struct queue_sysfs_entry queue_ra_entry = {
 	.store = queue_ra_store,
 };
 
+static struct queue_sysfs_entry queue_ra_max_entry = {
+	.attr = {.name = "read_ahead_max_kb", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_ra_max_show,
+	.store = queue_ra_max_store,
+};
+
+static struct queue_sysfs_entry queue_ra_window_entry = {
+	.attr = {.name = "read_ahead_window_kb", .mode = S_IRUGO },
+	.show = queue_ra_window_show,
+};
+
+static struct queue_sysfs_entry queue_read_bw_entry = {
+	.attr = {.name = "read_bandwidth_kb", .mode = S_IRUGO },
+	.show = queue_read_bw_show,
+};
+
+static struct queue_sysfs_entry queue_ra_hits_entry = {
+	.attr = {.name = "read_ahead_hits", .mode = S_IRUGO },
+	.show = queue_ra_hits_show,
+};
+
+static struct queue_sysfs_entry queue_ra_misses_entry = {
+	.attr = {.name = "read_ahead_misses", .mode = S_IRUGO },
+	.show = queue_ra_misses_show,
+};
+
 static struct queue_sysfs_entry queue_max_sectors_entry = {
 	.attr = {.name = "max_sectors_kb", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_max_sectors_show,
@@ -382,9 +453,50 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+#ifdef CONFIG_BLK_LATENCY_HIST
+static ssize_t queue_lat_hist_queue_show(struct request_queue *q, char *page)
+{
+	return blk_lat_hist_show(q, page, BLK_LAT_QUEUE);
+}
+
+static ssize_t queue_lat_hist_queue_store(struct request_queue *q,
+					  const char *page, size_t count)
+{
+	return blk_lat_hist_store(q, page, count, BLK_LAT_QUEUE);
+}
+
+static ssize_t queue_lat_hist_service_show(struct request_queue *q, char *page)
+{
+	return blk_lat_hist_show(q, page, BLK_LAT_SERVICE);
+}
+
+static ssize_t queue_lat_hist_service_store(struct request_queue *q,
+					    const char *page, size_t count)
+{
+	return blk_lat_hist_store(q, page, count, BLK_LAT_SERVICE);
+}
+
+static struct queue_sysfs_entry queue_lat_hist_queue_entry = {
+	.attr = {.name = "latency_hist_queue", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_lat_hist_queue_show,
+	.store = queue_lat_hist_queue_store,
+};
+
+static struct queue_sysfs_entry queue_lat_hist_service_entry = {
+	.attr = {.name = "latency_hist_service", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_lat_hist_service_show,
+	.store = queue_lat_hist_service_store,
+};
+#endif
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
+	&queue_ra_max_entry.attr,
+	&queue_ra_window_entry.attr,
+	&queue_read_bw_entry.attr,
+	&queue_ra_hits_entry.attr,
+	&queue_ra_misses_entry.attr,
 	&queue_max_hw_sectors_entry.attr,
 	&queue_max_sectors_entry.attr,
 	&queue_max_segments_entry.attr,
@@ -404,6 +516,10 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+#ifdef CONFIG_BLK_LATENCY_HIST
+	&queue_lat_hist_queue_entry.attr,
+	&queue_lat_hist_service_entry.attr,
+#endif
 	NULL,
 };
 
@@ -490,6 +606,7 @@ static void blk_release_queue(struct kobject *kobj)
 		__blk_queue_free_tags(q);
 
 	blk_throtl_release(q);
+	blk_lat_hist_exit(q);
 	blk_trace_shutdown(q);
 
 	bdi_destroy(&q->backing_dev_info);
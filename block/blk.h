@@ -124,6 +124,38 @@ static inline void elv_deactivate_rq(struct request_queue *q, struct request *rq
 		e->type->ops.elevator_deactivate_req_fn(q, rq);
 }
 
+/*
+ * Feed the adaptive readahead window of the queue's bdi with the bytes
+ * read over each period the queue had requests in flight.  Called with
+ * the queue lock held once @rq has been counted in q->in_flight.
+ */
+static inline void blk_ra_io_start(struct request_queue *q,
+				   struct request *rq)
+{
+	if (!q->backing_dev_info.ra_max_pages)
+		return;
+
+	if (!q->ra_busy_start)
+		q->ra_busy_start = ktime_to_ns(ktime_get());
+	if (rq_data_dir(rq) == READ)
+		q->ra_busy_bytes += blk_rq_bytes(rq);
+}
+
+/* and once a request left q->in_flight */
+static inline void blk_ra_io_done(struct request_queue *q)
+{
+	u64 now;
+
+	if (!q->ra_busy_start || q->in_flight[0] || q->in_flight[1])
+		return;
+
+	now = ktime_to_ns(ktime_get());
+	bdi_ra_account_read(&q->backing_dev_info, q->ra_busy_bytes,
+			    now - q->ra_busy_start);
+	q->ra_busy_start = 0;
+	q->ra_busy_bytes = 0;
+}
+
 #ifdef CONFIG_FAIL_IO_TIMEOUT
 int blk_should_fake_timeout(struct request_queue *);
 ssize_t part_timeout_show(struct device *, struct device_attribute *, char *);
@@ -257,4 +289,28 @@ static inline void blk_throtl_exit(struct request_queue *q) { }
 static inline void blk_throtl_release(struct request_queue *q) { }
 #endif /* CONFIG_BLK_DEV_THROTTLING */
 
+/*
+ * Internal latency histogram interface
+ */
+enum {
+	BLK_LAT_QUEUE,		/* from allocation to dispatch */
+	BLK_LAT_SERVICE,	/* from dispatch to completion */
+};
+
+#ifdef CONFIG_BLK_LATENCY_HIST
+extern int blk_lat_hist_init(struct request_queue *q);
+extern void blk_lat_hist_exit(struct request_queue *q);
+extern void blk_lat_hist_dispatch(struct request *rq);
+extern void blk_lat_hist_done(struct request *rq);
+extern ssize_t blk_lat_hist_show(struct request_queue *q, char *page,
+				 int hist);
+extern ssize_t blk_lat_hist_store(struct request_queue *q, const char *page,
+				  size_t count, int hist);
+#else /* CONFIG_BLK_LATENCY_HIST */
+static inline int blk_lat_hist_init(struct request_queue *q) { return 0; }
+static inline void blk_lat_hist_exit(struct request_queue *q) { }
+static inline void blk_lat_hist_dispatch(struct request *rq) { }
+static inline void blk_lat_hist_done(struct request *rq) { }
+#endif /* CONFIG_BLK_LATENCY_HIST */
+
 #endif /* BLK_INTERNAL_H */
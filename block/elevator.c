@@ -595,6 +595,7 @@ void elv_requeue_request(struct request_queue *q, struct request *rq)
 	 */
 	if (blk_account_rq(rq)) {
 		q->in_flight[rq_is_sync(rq)]--;
+		blk_ra_io_done(q);
 		if (rq->cmd_flags & REQ_SORTED)
 			elv_deactivate_rq(q, rq);
 	}
@@ -629,6 +630,7 @@ int elv_reinsert_request(struct request_queue *q, struct request *rq)
 		 */
 		if (blk_account_rq(rq)) {
 			q->in_flight[rq_is_sync(rq)]--;
+			blk_ra_io_done(q);
 			if (rq->cmd_flags & REQ_SORTED)
 				elv_deactivate_rq(q, rq);
 		}
@@ -843,6 +845,7 @@ void elv_completed_request(struct request_queue *q, struct request *rq)
 	 */
 	if (blk_account_rq(rq)) {
 		q->in_flight[rq_is_sync(rq)]--;
+		blk_ra_io_done(q);
 		if ((rq->cmd_flags & REQ_SORTED) &&
 		    e->type->ops.elevator_completed_req_fn)
 			e->type->ops.elevator_completed_req_fn(q, rq);
@@ -99,16 +99,50 @@ static const struct row_queue_params row_queues_def[] = {
 #define ROW_IDLE_TIME_MSEC 5	/* msec */
 #define ROW_READ_FREQ_MSEC 20	/* msec */
 
+/*
+ * Think time is a decaying average, in fixed point, of the time between
+ * a queue's last request completing and its next one arriving.  Until a
+ * few samples are in, idling falls back to the insertion frequency.
+ */
+#define ROW_TTIME_MIN_SAMPLES	80
+#define ROW_IDLE_MIN_USEC	500	/* shortest idle period, usec */
+
+/* requests further apart than this are not sequential */
+#define ROW_SEEK_THR		(8 * 100)	/* sectors */
+#define ROWQ_SEEKY(idle)	(hweight32((idle)->seek_history) > 32 / 8)
+
 /**
  * struct rowq_idling_data -  parameters for idling on the queue
  * @last_insert_time:	time the last request was inserted
  *			to the queue
+ * @last_complete_time:	time the last request of the queue
+ *			completed
  * @begin_idling:	flag indicating wether we should idle
+ * @idle_us:		how long to idle on the queue (usec)
+ * @ttime_samples:	think time sample weight
+ * @ttime_total:	weighted sum of think time samples
+ * @ttime_mean:		think time (usec)
+ * @last_end:		sector following the last inserted request
+ * @seek_history:	one bit per recent request, set if it was
+ *			not sequential with the one before it
+ * @idle_hits:		idle periods ended by a request on the queue
+ * @idle_misses:	idle periods that ran out
  *
  */
 struct rowq_idling_data {
 	ktime_t			last_insert_time;
+	ktime_t			last_complete_time;
 	bool			begin_idling;
+	u32			idle_us;
+
+	u32			ttime_samples;
+	u64			ttime_total;
+	u32			ttime_mean;
+	sector_t		last_end;
+	u32			seek_history;
+
+	u32			idle_hits;
+	u32			idle_misses;
 };
 
 /**
@@ -244,6 +278,8 @@ static enum hrtimer_restart row_idle_hrtimer_fn(struct hrtimer *hr_timer)
 	/* Mark idling process as done */
 	rd->row_queues[rd->rd_idle_data.idling_queue_idx].
 			idle_data.begin_idling = false;
+	rd->row_queues[rd->rd_idle_data.idling_queue_idx].
+			idle_data.idle_misses++;
 	rd->rd_idle_data.idling_queue_idx = ROWQ_MAX_PRIO;
 
 	if (!rd->nr_reqs[READ] && !rd->nr_reqs[WRITE])
@@ -254,6 +290,74 @@ static enum hrtimer_restart row_idle_hrtimer_fn(struct hrtimer *hr_timer)
 	return HRTIMER_NORESTART;
 }
 
+/*
+ * row_update_idling() - Decide whether to idle on a read queue
+ * @rd:		pointer to struct row_data
+ * @rqueue:	queue rq is being added to
+ * @rq:		request being added
+ *
+ * Idling pays off only if the queue's next request is expected within
+ * the idle window.  Seeky queues on non-rotational devices are not
+ * idled on: their requests cost the same wherever they land, so
+ * holding the device back for them gains nothing.
+ *
+ */
+static void row_update_idling(struct row_data *rd, struct row_queue *rqueue,
+			      struct request *rq)
+{
+	struct rowq_idling_data *idle = &rqueue->idle_data;
+	u32 window_us = rd->rd_idle_data.idle_time_ms * USEC_PER_MSEC;
+	ktime_t now = ktime_get();
+	s64 ttime = 0, diff_ms;
+	sector_t pos = blk_rq_pos(rq);
+
+	/* the reader waited for its previous request before this one */
+	if (list_empty(&rqueue->fifo) &&
+	    ktime_to_ns(ktime_sub(idle->last_complete_time,
+				  idle->last_insert_time)) > 0)
+		ttime = min_t(s64, 2 * window_us,
+			      ktime_us_delta(now, idle->last_complete_time));
+
+	idle->ttime_samples = (7 * idle->ttime_samples + 256) / 8;
+	idle->ttime_total = (7 * idle->ttime_total + 256 * ttime) / 8;
+	idle->ttime_mean = div_u64(idle->ttime_total + 128,
+				   idle->ttime_samples);
+
+	idle->seek_history <<= 1;
+	if ((pos > idle->last_end ? pos - idle->last_end :
+	     idle->last_end - pos) > ROW_SEEK_THR)
+		idle->seek_history |= 1;
+	idle->last_end = pos + blk_rq_sectors(rq);
+
+	diff_ms = ktime_to_ms(ktime_sub(now, idle->last_insert_time));
+	idle->last_insert_time = now;
+	if (unlikely(diff_ms < 0)) {
+		pr_err("ROW BUG: %s diff_ms < 0", __func__);
+		idle->begin_idling = false;
+		return;
+	}
+
+	if (idle->ttime_samples < ROW_TTIME_MIN_SAMPLES) {
+		idle->begin_idling = diff_ms < rd->rd_idle_data.freq_ms;
+		idle->idle_us = window_us;
+	} else if (blk_queue_nonrot(rd->dispatch_queue) && ROWQ_SEEKY(idle)) {
+		idle->begin_idling = false;
+	} else {
+		idle->begin_idling = idle->ttime_mean < window_us;
+		/* allow for the spread around the mean */
+		idle->idle_us = clamp_t(u32, 2 * idle->ttime_mean,
+					ROW_IDLE_MIN_USEC, window_us);
+	}
+
+	if (idle->begin_idling)
+		row_log_rowq(rd, rqueue->prio, "Enable idling (%uus)",
+			     idle->idle_us);
+	else
+		row_log_rowq(rd, rqueue->prio,
+			"Disable idling (%ldms, ttime %uus)",
+			(long)diff_ms, idle->ttime_mean);
+}
+
 /******************* Elevator callback functions *********************/
 
 /*
@@ -267,46 +371,32 @@ static void row_add_request(struct request_queue *q,
 {
 	struct row_data *rd = (struct row_data *)q->elevator->elevator_data;
 	struct row_queue *rqueue = RQ_ROWQ(rq);
-	s64 diff_ms;
-
-	list_add_tail(&rq->queuelist, &rqueue->fifo);
-	rd->nr_reqs[rq_data_dir(rq)]++;
-	rqueue->nr_req++;
-	rq_set_fifo_time(rq, jiffies); /* for statistics*/
 
 	if (row_queues_def[rqueue->prio].idling_enabled) {
 		if (rd->rd_idle_data.idling_queue_idx == rqueue->prio &&
 		    hrtimer_active(&rd->rd_idle_data.hr_timer)) {
-			(void)hrtimer_cancel(&rd->rd_idle_data.hr_timer);
+			/* not a hit if it ran out while we got here */
+			if (hrtimer_cancel(&rd->rd_idle_data.hr_timer))
+				rqueue->idle_data.idle_hits++;
 			row_log_rowq(rd, rqueue->prio,
 				"Canceled delayed work on %d",
 				rd->rd_idle_data.idling_queue_idx);
 			rd->rd_idle_data.idling_queue_idx = ROWQ_MAX_PRIO;
 		}
-		diff_ms = ktime_to_ms(ktime_sub(ktime_get(),
-				rqueue->idle_data.last_insert_time));
-		if (unlikely(diff_ms < 0)) {
-			pr_err("ROW BUG: %s diff_ms < 0", __func__);
-			rqueue->idle_data.begin_idling = false;
-			return;
-		}
-		if (diff_ms < rd->rd_idle_data.freq_ms) {
-			rqueue->idle_data.begin_idling = true;
-			row_log_rowq(rd, rqueue->prio, "Enable idling");
-		} else {
-			rqueue->idle_data.begin_idling = false;
-			row_log_rowq(rd, rqueue->prio, "Disable idling (%ldms)",
-				(long)diff_ms);
-		}
-
-		rqueue->idle_data.last_insert_time = ktime_get();
+		row_update_idling(rd, rqueue, rq);
 	}
+
+	list_add_tail(&rq->queuelist, &rqueue->fifo);
+	rd->nr_reqs[rq_data_dir(rq)]++;
+	rqueue->nr_req++;
+	rq_set_fifo_time(rq, jiffies); /* for statistics*/
+
 	if (row_queues_def[rqueue->prio].is_urgent &&
 	    row_rowq_unserved(rd, rqueue->prio)) {
 		row_log_rowq(rd, rqueue->prio,
 			"added urgent request (total on queue=%d)",
 			rqueue->nr_req);
-		rq->cmd_flags;
+		rq->cmd_flags |= REQ_URGENT;
 	} else
 		row_log_rowq(rd, rqueue->prio,
 			"added request (total on queue=%d)", rqueue->nr_req);
@@ -338,6 +428,9 @@ static int row_reinsert_req(struct request_queue *q,
 	list_add(&rq->queuelist, &rqueue->fifo);
 	rd->nr_reqs[rq_data_dir(rq)]++;
 	rqueue->nr_req++;
+	/* back in the scheduler, no longer holding off other urgent ones */
+	if ((rq->cmd_flags & REQ_URGENT) && rd->nr_urgent_in_flight)
+		rd->nr_urgent_in_flight--;
 
 	row_log_rowq(rd, rqueue->prio,
 		"request reinserted (total on queue=%d)", rqueue->nr_req);
@@ -348,8 +441,13 @@ static int row_reinsert_req(struct request_queue *q,
 static void row_completed_req(struct request_queue *q, struct request *rq)
 {
 	struct row_data *rd = q->elevator->elevator_data;
+	struct row_queue *rqueue = RQ_ROWQ(rq);
+
+	/* think time runs from here, see row_update_idling() */
+	if (row_queues_def[rqueue->prio].idling_enabled)
+		rqueue->idle_data.last_complete_time = ktime_get();
 
-	 if (rq->cmd_flags) {
+	if (rq->cmd_flags & REQ_URGENT) {
 		if (!rd->nr_urgent_in_flight) {
 			pr_err("ROW BUG: %s() nr_urgent_in_flight = 0",
 				__func__);
@@ -430,7 +528,7 @@ static void row_dispatch_insert(struct row_data *rd, int queue_idx)
 	row_clear_rowq_unserved(rd, queue_idx);
 	row_log_rowq(rd, queue_idx, " Dispatched request nr_disp = %d",
 		     rd->row_queues[queue_idx].nr_dispatched);
-	if (rq->cmd_flags)
+	if (rq->cmd_flags & REQ_URGENT)
 		rd->nr_urgent_in_flight++;
 }
 
@@ -511,7 +609,8 @@ check_idling:
 
 initiate_idling:
 	hrtimer_start(&rd->rd_idle_data.hr_timer,
-		ktime_set(0, rd->rd_idle_data.idle_time_ms * NSEC_PER_MSEC),
+		ktime_set(0, rd->row_queues[i].idle_data.idle_us *
+			  NSEC_PER_USEC),
 		HRTIMER_MODE_REL);
 
 	rd->rd_idle_data.idling_queue_idx = i;
@@ -659,6 +758,8 @@ static void *row_init_queue(struct request_queue *q)
 		rdata->row_queues[i].idle_data.begin_idling = false;
 		rdata->row_queues[i].idle_data.last_insert_time =
 			ktime_set(0, 0);
+		rdata->row_queues[i].idle_data.idle_us =
+			ROW_IDLE_TIME_MSEC * USEC_PER_MSEC;
 	}
 
 	/*
@@ -741,7 +842,7 @@ static enum row_queue_prio row_get_queue_prio(struct request *rq)
 				rq->rq_disk->disk_name, __func__);
 			q_type = ROWQ_PRIO_REG_WRITE;
 		}
-		rq->cmd_flags;
+		rq->cmd_flags |= REQ_URGENT;
 		break;
 	case IOPRIO_CLASS_IDLE:
 		if (data_dir == READ)
@@ -874,10 +975,35 @@ STORE_FUNCTION(row_rd_idle_data_freq_store, &rowd->rd_idle_data.freq_ms,
 
 #undef STORE_FUNCTION
 
+/* idle hits and misses, think time and seekiness of the idling queues */
+static ssize_t row_idle_stats_show(struct elevator_queue *e, char *page)
+{
+	struct row_data *rowd = e->elevator_data;
+	struct rowq_idling_data *idle;
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < ROWQ_MAX_PRIO; i++) {
+		if (!row_queues_def[i].idling_enabled)
+			continue;
+		idle = &rowd->row_queues[i].idle_data;
+		len += snprintf(page + len, PAGE_SIZE - len,
+				"rowq%d hits %u misses %u ttime %uus%s\n", i,
+				idle->idle_hits, idle->idle_misses,
+				idle->ttime_mean,
+				ROWQ_SEEKY(idle) ? " seeky" : "");
+	}
+
+	return len;
+}
+
 #define ROW_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, row_##name##_show, \
 				      row_##name##_store)
 
+#define ROW_ATTR_RO(name) \
+	__ATTR(name, S_IRUGO, row_##name##_show, NULL)
+
 static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(hp_read_quantum),
 	ROW_ATTR(rp_read_quantum),
@@ -888,6 +1014,7 @@ static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(lp_swrite_quantum),
 	ROW_ATTR(rd_idle_data),
 	ROW_ATTR(rd_idle_data_freq),
+	ROW_ATTR_RO(idle_stats),
 	__ATTR_NULL
 };
 
@@ -16,6 +16,12 @@
 * The plus version fixes writes_starved not being initialized on startup
 * and also modifies the write starvation counting logic.
 *
+* With group scheduling, requests are queued per blkio cgroup. The groups
+* with requests take turns, each dispatching group_quantum requests scaled
+* by its weight, and a group with an expired request goes first when a
+* turn is over. Deadlines are scaled by the weight relative to the root
+* group. Within a group requests are dispatched as above.
+*
 */
 #include <linux/blkdev.h>
 #include <linux/elevator.h>
@@ -23,6 +29,7 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/slab.h>
+#include "blk-cgroup.h"
 enum { ASYNC, SYNC };
 /* Tunables */
 static const int sync_read_expire = (HZ / 4); /* max time before a sync read is submitted. */
@@ -32,60 +39,308 @@ static const int async_write_expire = (HZ * 2); /* ditto for async, these limits
 static const int writes_starved = 1; /* max times reads can starve a write */
 static const int fifo_batch = 3; /* # of sequential requests treated as one
 by the above parameters. For throughput. */
-/* Elevator data */
-struct sio_data {
+static const int group_quantum = 8; /* # of requests a group of default weight
+dispatches in its turn. */
+/* Per blkio cgroup data */
+struct sio_group {
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+struct blkio_group blkg;
+struct hlist_node sd_node;
+#endif
 /* Request queues */
 struct list_head fifo_list[2][2];
+/* On the active list while requests are queued */
+struct list_head active_node;
+unsigned int nr_queued;
+unsigned int weight;
 /* Attributes */
 unsigned int batched;
 unsigned int starved;
+int ref;
+/* Statistics: requests dispatched and their time in the queue */
+unsigned long dispatched[2];
+unsigned long wait_total;
+unsigned long wait_max;
+};
+/* Elevator data */
+struct sio_data {
+struct request_queue *queue;
+struct sio_group root_group;
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+struct hlist_head group_list;
+#endif
+/* Groups with requests queued, the first one is being served */
+struct list_head active_list;
+unsigned int served;
 /* Settings */
 int fifo_expire[2][2];
 int fifo_batch;
 int writes_starved;
+int group_quantum;
 };
+#define RQ_SIOG(rq) ((struct sio_group *) (rq)->elv.priv[0])
+static inline struct sio_group *
+sio_rq_group(struct sio_data *sd, struct request *rq)
+{
+/* Requests allocated while switching elevators have no group */
+return RQ_SIOG(rq) ? RQ_SIOG(rq) : &sd->root_group;
+}
+static void
+sio_init_group(struct sio_group *sg)
+{
+INIT_LIST_HEAD(&sg->fifo_list[SYNC][READ]);
+INIT_LIST_HEAD(&sg->fifo_list[SYNC][WRITE]);
+INIT_LIST_HEAD(&sg->fifo_list[ASYNC][READ]);
+INIT_LIST_HEAD(&sg->fifo_list[ASYNC][WRITE]);
+INIT_LIST_HEAD(&sg->active_node);
+sg->weight = BLKIO_WEIGHT_DEFAULT;
+sg->ref = 1;
+}
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+static struct blkio_policy_type blkio_policy_sio;
+static inline struct sio_group *
+sio_group_of_blkg(struct blkio_group *blkg)
+{
+return blkg ? container_of(blkg, struct sio_group, blkg) : NULL;
+}
+static void
+sio_free_group(struct sio_group *sg)
+{
+free_percpu(sg->blkg.stats_cpu);
+kfree(sg);
+}
+static void
+sio_put_group(struct sio_group *sg)
+{
+BUG_ON(sg->ref <= 0);
+if (!--sg->ref)
+sio_free_group(sg);
+}
+static dev_t
+sio_queue_dev(struct sio_data *sd)
+{
+struct backing_dev_info *bdi = &sd->queue->backing_dev_info;
+unsigned int major, minor;
+/* bdi->dev may not be set up yet, the groups get it later on */
+if (!bdi->dev || !dev_name(bdi->dev))
+return 0;
+sscanf(dev_name(bdi->dev), "%u:%u", &major, &minor);
+return MKDEV(major, minor);
+}
+static void
+sio_link_group(struct sio_data *sd, struct sio_group *sg,
+struct blkio_cgroup *blkcg)
+{
+dev_t dev = sio_queue_dev(sd);
+sg->blkg.blkiop = &blkio_policy_sio;
+blkiocg_add_blkio_group(blkcg, &sg->blkg, sd, dev, BLKIO_POLICY_PROP);
+sg->weight = blkcg_get_weight(blkcg, dev);
+hlist_add_head(&sg->sd_node, &sd->group_list);
+}
+static struct sio_group *
+sio_find_group(struct sio_data *sd, struct blkio_cgroup *blkcg)
+{
+struct sio_group *sg;
+/* Common case, avoid the lookup */
+if (blkcg == &blkio_root_cgroup)
+sg = &sd->root_group;
+else
+sg = sio_group_of_blkg(blkiocg_lookup_group(blkcg, sd));
+if (sg && !sg->blkg.dev)
+sg->blkg.dev = sio_queue_dev(sd);
+return sg;
+}
+/*
+* Called without the queue lock. The per cpu stats of a new group may
+* only be allocated if the request allocation may sleep, otherwise the
+* root group is used.
+*/
+static struct sio_group *
+sio_get_group(struct sio_data *sd, gfp_t gfp_mask)
+{
+struct request_queue *q = sd->queue;
+struct sio_group *sg, *new = NULL;
+bool alloc = gfp_mask & __GFP_WAIT;
+for (;;) {
+rcu_read_lock();
+spin_lock_irq(q->queue_lock);
+sg = sio_find_group(sd, task_blkio_cgroup(current));
+if (!sg && new) {
+sio_link_group(sd, new, task_blkio_cgroup(current));
+sg = new;
+new = NULL;
+}
+if (!sg && !alloc)
+sg = &sd->root_group;
+if (sg)
+sg->ref++;
+spin_unlock_irq(q->queue_lock);
+rcu_read_unlock();
+if (sg)
+break;
+alloc = false;
+new = kzalloc_node(sizeof(*new), gfp_mask, q->node);
+if (!new)
+continue;
+sio_init_group(new);
+if (blkio_alloc_blkg_stats(&new->blkg)) {
+kfree(new);
+new = NULL;
+}
+}
+/* Some other task linked the group first */
+if (new)
+sio_free_group(new);
+return sg;
+}
+static void
+sio_destroy_group(struct sio_group *sg)
+{
+hlist_del_init(&sg->sd_node);
+/* Requests still queued hold on to the group */
+sio_put_group(sg);
+}
+/*
+* The cgroup is going away. No new requests will be queued to the group,
+* it is freed once those already queued are done.
+*/
+static void
+sio_unlink_blkio_group(void *key, struct blkio_group *blkg)
+{
+struct sio_data *sd = key;
+unsigned long flags;
+spin_lock_irqsave(sd->queue->queue_lock, flags);
+sio_destroy_group(sio_group_of_blkg(blkg));
+spin_unlock_irqrestore(sd->queue->queue_lock, flags);
+}
+static void
+sio_update_blkio_group_weight(void *key, struct blkio_group *blkg,
+unsigned int weight)
+{
+sio_group_of_blkg(blkg)->weight = weight;
+}
+static int
+sio_set_request(struct request_queue *q, struct request *rq, gfp_t gfp_mask)
+{
+struct sio_data *sd = q->elevator->elevator_data;
+rq->elv.priv[0] = sio_get_group(sd, gfp_mask);
+return 0;
+}
+static void
+sio_put_request(struct request *rq)
+{
+struct sio_group *sg = RQ_SIOG(rq);
+if (sg) {
+rq->elv.priv[0] = NULL;
+sio_put_group(sg);
+}
+}
+static void
+sio_completed_request(struct request_queue *q, struct request *rq)
+{
+struct sio_data *sd = q->elevator->elevator_data;
+blkiocg_update_completion_stats(&sio_rq_group(sd, rq)->blkg,
+rq_start_time_ns(rq), rq_io_start_time_ns(rq), rq_data_dir(rq),
+rq_is_sync(rq));
+}
+static inline const char *
+sio_group_path(struct sio_group *sg)
+{
+return blkg_path(&sg->blkg);
+}
+#define sio_blkiocg_update(func, sg, args...) func(&(sg)->blkg, args)
+#else
+static inline const char *
+sio_group_path(struct sio_group *sg)
+{
+return "/";
+}
+#define sio_blkiocg_update(func, sg, args...) do { } while (0)
+#endif /* CONFIG_SIOPLUS_GROUP_IOSCHED */
+/*
+* Deadlines are scaled by the group's weight relative to the root group,
+* which keeps the configured expire times: the requests of a group of half
+* the root's weight expire in twice the time.
+*/
+static inline unsigned long
+sio_group_expire(struct sio_data *sd, struct sio_group *sg, int sync,
+int data_dir)
+{
+return (unsigned long)sd->fifo_expire[sync][data_dir] *
+sd->root_group.weight / sg->weight;
+}
+/* # of requests the group dispatches in its turn */
+static inline unsigned int
+sio_group_quantum(struct sio_data *sd, struct sio_group *sg)
+{
+return max_t(unsigned int, 1,
+sd->group_quantum * sg->weight / BLKIO_WEIGHT_DEFAULT);
+}
+static void
+sio_remove_request(struct sio_data *sd, struct request *rq)
+{
+struct sio_group *sg = sio_rq_group(sd, rq);
+rq_fifo_clear(rq);
+sio_blkiocg_update(blkiocg_update_io_remove_stats, sg,
+rq_data_dir(rq), rq_is_sync(rq));
+if (--sg->nr_queued)
+return;
+/* The group leaves the active list, ending its turn */
+if (sd->active_list.next == &sg->active_node)
+sd->served = 0;
+list_del_init(&sg->active_node);
+}
 static void
 sio_merged_requests(struct request_queue *q, struct request *rq,
 struct request *next)
 {
+struct sio_data *sd = q->elevator->elevator_data;
 /*
 * If next expires before rq, assign its expire time to rq
 * and move into next position (next will be deleted) in fifo.
+* Only within the same group.
 */
-if (!list_empty(&rq->queuelist) && !list_empty(&next->queuelist)) {
+if (!list_empty(&rq->queuelist) && !list_empty(&next->queuelist) &&
+sio_rq_group(sd, rq) == sio_rq_group(sd, next)) {
 if (time_before(rq_fifo_time(next), rq_fifo_time(rq))) {
 list_move(&rq->queuelist, &next->queuelist);
 rq_set_fifo_time(rq, rq_fifo_time(next));
 }
 }
+sio_blkiocg_update(blkiocg_update_io_merged_stats, sio_rq_group(sd, rq),
+rq_data_dir(next), rq_is_sync(next));
 /* Delete next request */
-rq_fifo_clear(next);
+sio_remove_request(sd, next);
 }
 static void
 sio_add_request(struct request_queue *q, struct request *rq)
 {
 struct sio_data *sd = q->elevator->elevator_data;
+struct sio_group *sg = sio_rq_group(sd, rq);
 const int sync = rq_is_sync(rq);
 const int data_dir = rq_data_dir(rq);
 /*
-* Add request to the proper fifo list and set its
-* expire time.
+* Add request to the proper fifo list of its group and set
+* its expire time.
 */
-rq_set_fifo_time(rq, jiffies + sd->fifo_expire[sync][data_dir]);
-list_add_tail(&rq->queuelist, &sd->fifo_list[sync][data_dir]);
+rq_set_fifo_time(rq, jiffies + sio_group_expire(sd, sg, sync, data_dir));
+list_add_tail(&rq->queuelist, &sg->fifo_list[sync][data_dir]);
+if (!sg->nr_queued++)
+list_add_tail(&sg->active_node, &sd->active_list);
+sio_blkiocg_update(blkiocg_update_io_add_stats, sg, &sg->blkg,
+data_dir, sync);
 }
 static int
 sio_queue_empty(struct request_queue *q)
 {
 struct sio_data *sd = q->elevator->elevator_data;
-/* Check if fifo lists are empty */
-return list_empty(&sd->fifo_list[SYNC][READ]) && list_empty(&sd->fifo_list[SYNC][WRITE]) &&
-list_empty(&sd->fifo_list[ASYNC][READ]) && list_empty(&sd->fifo_list[ASYNC][WRITE]);
+/* Only groups with requests are on the active list */
+return list_empty(&sd->active_list);
 }
 static struct request *
-sio_expired_request(struct sio_data *sd, int sync, int data_dir)
+sio_expired_request(struct sio_group *sg, int sync, int data_dir)
 {
-struct list_head *list = &sd->fifo_list[sync][data_dir];
+struct list_head *list = &sg->fifo_list[sync][data_dir];
 struct request *rq;
 if (list_empty(list))
 return NULL;
@@ -97,40 +352,40 @@ return rq;
 return NULL;
 }
 static struct request *
-sio_choose_expired_request(struct sio_data *sd)
+sio_choose_expired_request(struct sio_group *sg)
 {
 struct request *rq;
 
 /* Reset (non-expired-)batch-counter */
- sd->batched = 0;
+ sg->batched = 0;
 
 /*
 * Check expired requests.
 * Asynchronous requests have priority over synchronous.
 * Write requests have priority over read.
 */
-rq = sio_expired_request(sd, ASYNC, WRITE);
+rq = sio_expired_request(sg, ASYNC, WRITE);
 if (rq)
 return rq;
-rq = sio_expired_request(sd, ASYNC, READ);
+rq = sio_expired_request(sg, ASYNC, READ);
 if (rq)
 return rq;
-rq = sio_expired_request(sd, SYNC, WRITE);
+rq = sio_expired_request(sg, SYNC, WRITE);
 if (rq)
 return rq;
-rq = sio_expired_request(sd, SYNC, READ);
+rq = sio_expired_request(sg, SYNC, READ);
 if (rq)
 return rq;
 return NULL;
 }
 static struct request *
-sio_choose_request(struct sio_data *sd, int data_dir)
+sio_choose_request(struct sio_group *sg, int data_dir)
 {
-struct list_head *sync = sd->fifo_list[SYNC];
-struct list_head *async = sd->fifo_list[ASYNC];
+struct list_head *sync = sg->fifo_list[SYNC];
+struct list_head *async = sg->fifo_list[ASYNC];
 
 /* Increase (non-expired-)batch-counter */
- sd->batched++;
+ sg->batched++;
 
 /*
 * Retrieve request from available fifo list.
@@ -147,56 +402,104 @@ if (!list_empty(&async[!data_dir]))
 return rq_entry_fifo(async[!data_dir].next);
 return NULL;
 }
+static bool
+sio_group_expired(struct sio_group *sg)
+{
+return sio_expired_request(sg, ASYNC, WRITE) ||
+sio_expired_request(sg, ASYNC, READ) ||
+sio_expired_request(sg, SYNC, WRITE) ||
+sio_expired_request(sg, SYNC, READ);
+}
+static struct sio_group *
+sio_choose_group(struct sio_data *sd)
+{
+struct sio_group *sg;
+if (list_empty(&sd->active_list))
+return NULL;
+sg = list_first_entry(&sd->active_list, struct sio_group, active_node);
+if (sd->served < sio_group_quantum(sd, sg))
+return sg;
+/*
+* Turn is over, pass it on to the next group. One with
+* an expired request jumps the queue.
+*/
+sd->served = 0;
+list_move_tail(&sg->active_node, &sd->active_list);
+list_for_each_entry(sg, &sd->active_list, active_node) {
+if (sio_group_expired(sg)) {
+list_move(&sg->active_node, &sd->active_list);
+return sg;
+}
+}
+return list_first_entry(&sd->active_list, struct sio_group, active_node);
+}
 static inline void
-sio_dispatch_request(struct sio_data *sd, struct request *rq)
+sio_dispatch_request(struct sio_data *sd, struct sio_group *sg,
+struct request *rq)
 {
+unsigned long wait = jiffies - rq->start_time;
 /*
 * Remove the request from the fifo list
 * and dispatch it.
 */
-rq_fifo_clear(rq);
+sd->served++;
+sio_remove_request(sd, rq);
 elv_dispatch_add_tail(rq->q, rq);
 
 if (rq_data_dir(rq)) {
-sd->starved = 0;
+sg->starved = 0;
 } else {
-if (!list_empty(&sd->fifo_list[SYNC][WRITE]) ||
-!list_empty(&sd->fifo_list[ASYNC][WRITE]))
-sd->starved++;
+if (!list_empty(&sg->fifo_list[SYNC][WRITE]) ||
+!list_empty(&sg->fifo_list[ASYNC][WRITE]))
+sg->starved++;
 }
+
+/* Update statistics */
+sg->dispatched[rq_data_dir(rq)]++;
+sg->wait_total += wait;
+if (wait > sg->wait_max)
+sg->wait_max = wait;
+sio_blkiocg_update(blkiocg_update_dispatch_stats, sg, blk_rq_bytes(rq),
+rq_data_dir(rq), rq_is_sync(rq));
 }
 static int
 sio_dispatch_requests(struct request_queue *q, int force)
 {
 struct sio_data *sd = q->elevator->elevator_data;
+struct sio_group *sg;
 struct request *rq = NULL;
 int data_dir = READ;
+/* Retrieve the group whose turn it is */
+sg = sio_choose_group(sd);
+if (!sg)
+return 0;
 /*
 * Retrieve any expired request after a batch of
 * sequential requests.
 */
-if (sd->batched >= sd->fifo_batch)
-rq = sio_choose_expired_request(sd);
+if (sg->batched >= sd->fifo_batch)
+rq = sio_choose_expired_request(sg);
 
 /* Retrieve request */
 if (!rq) {
-if (sd->starved >= sd->writes_starved)
+if (sg->starved >= sd->writes_starved)
 data_dir = WRITE;
-rq = sio_choose_request(sd, data_dir);
+rq = sio_choose_request(sg, data_dir);
 if (!rq)
 return 0;
 }
 /* Dispatch request */
-sio_dispatch_request(sd, rq);
+sio_dispatch_request(sd, sg, rq);
 return 1;
 }
 static struct request *
 sio_former_request(struct request_queue *q, struct request *rq)
 {
 struct sio_data *sd = q->elevator->elevator_data;
+struct sio_group *sg = sio_rq_group(sd, rq);
 const int sync = rq_is_sync(rq);
 const int data_dir = rq_data_dir(rq);
-if (rq->queuelist.prev == &sd->fifo_list[sync][data_dir])
+if (rq->queuelist.prev == &sg->fifo_list[sync][data_dir])
 return NULL;
 /* Return former request */
 return list_entry(rq->queuelist.prev, struct request, queuelist);
@@ -205,9 +508,10 @@ static struct request *
 sio_latter_request(struct request_queue *q, struct request *rq)
 {
 struct sio_data *sd = q->elevator->elevator_data;
+struct sio_group *sg = sio_rq_group(sd, rq);
 const int sync = rq_is_sync(rq);
 const int data_dir = rq_data_dir(rq);
-if (rq->queuelist.next == &sd->fifo_list[sync][data_dir])
+if (rq->queuelist.next == &sg->fifo_list[sync][data_dir])
 return NULL;
 /* Return latter request */
 return list_entry(rq->queuelist.next, struct request, queuelist);
@@ -217,32 +521,57 @@ sio_init_queue(struct request_queue *q)
 {
 struct sio_data *sd;
 /* Allocate structure */
-sd = kmalloc_node(sizeof(*sd), GFP_KERNEL, q->node);
+sd = kzalloc_node(sizeof(*sd), GFP_KERNEL, q->node);
 if (!sd)
 return NULL;
-/* Initialize fifo lists */
-INIT_LIST_HEAD(&sd->fifo_list[SYNC][READ]);
-INIT_LIST_HEAD(&sd->fifo_list[SYNC][WRITE]);
-INIT_LIST_HEAD(&sd->fifo_list[ASYNC][READ]);
-INIT_LIST_HEAD(&sd->fifo_list[ASYNC][WRITE]);
+sd->queue = q;
+INIT_LIST_HEAD(&sd->active_list);
+/* Initialize root group */
+sio_init_group(&sd->root_group);
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+INIT_HLIST_HEAD(&sd->group_list);
+/* One reference is dropped on exit, the other keeps it from being freed */
+sd->root_group.ref = 2;
+if (blkio_alloc_blkg_stats(&sd->root_group.blkg)) {
+kfree(sd);
+return NULL;
+}
+rcu_read_lock();
+sio_link_group(sd, &sd->root_group, &blkio_root_cgroup);
+rcu_read_unlock();
+#endif
 /* Initialize data */
-sd->batched = 0;
 sd->fifo_expire[SYNC][READ] = sync_read_expire;
 sd->fifo_expire[SYNC][WRITE] = sync_write_expire;
 sd->fifo_expire[ASYNC][READ] = async_read_expire;
 sd->fifo_expire[ASYNC][WRITE] = async_write_expire;
 sd->fifo_batch = fifo_batch;
 sd->writes_starved = writes_starved;
+sd->group_quantum = group_quantum;
 return sd;
 }
 static void
 sio_exit_queue(struct elevator_queue *e)
 {
 struct sio_data *sd = e->elevator_data;
-BUG_ON(!list_empty(&sd->fifo_list[SYNC][READ]));
-BUG_ON(!list_empty(&sd->fifo_list[SYNC][WRITE]));
-BUG_ON(!list_empty(&sd->fifo_list[ASYNC][READ]));
-BUG_ON(!list_empty(&sd->fifo_list[ASYNC][WRITE]));
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+struct request_queue *q = sd->queue;
+struct hlist_node *pos, *n;
+struct sio_group *sg;
+#endif
+BUG_ON(!list_empty(&sd->active_list));
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+spin_lock_irq(q->queue_lock);
+hlist_for_each_entry_safe(sg, pos, n, &sd->group_list, sd_node) {
+/* Unless the cgroup removal path got to it first */
+if (!blkiocg_del_blkio_group(&sg->blkg))
+sio_destroy_group(sg);
+}
+spin_unlock_irq(q->queue_lock);
+/* The cgroup removal path may still be looking at sd */
+synchronize_rcu();
+free_percpu(sd->root_group.blkg.stats_cpu);
+#endif
 /* Free structure */
 kfree(sd);
 }
@@ -276,6 +605,7 @@ SHOW_FUNCTION(sio_async_read_expire_show, sd->fifo_expire[ASYNC][READ], 1);
 SHOW_FUNCTION(sio_async_write_expire_show, sd->fifo_expire[ASYNC][WRITE], 1);
 SHOW_FUNCTION(sio_fifo_batch_show, sd->fifo_batch, 0);
 SHOW_FUNCTION(sio_writes_starved_show, sd->writes_starved, 0);
+SHOW_FUNCTION(sio_group_quantum_show, sd->group_quantum, 0);
 #undef SHOW_FUNCTION
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV) \
 static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count) \
@@ -299,7 +629,41 @@ STORE_FUNCTION(sio_async_read_expire_store, &sd->fifo_expire[ASYNC][READ], 0, IN
 STORE_FUNCTION(sio_async_write_expire_store, &sd->fifo_expire[ASYNC][WRITE], 0, INT_MAX, 1);
 STORE_FUNCTION(sio_fifo_batch_store, &sd->fifo_batch, 1, INT_MAX, 0);
 STORE_FUNCTION(sio_writes_starved_store, &sd->writes_starved, 1, INT_MAX, 0);
+STORE_FUNCTION(sio_group_quantum_store, &sd->group_quantum, 1, INT_MAX, 0);
 #undef STORE_FUNCTION
+static int
+sio_group_stats_show_one(struct sio_group *sg, char *page, int len)
+{
+unsigned long nr = sg->dispatched[READ] + sg->dispatched[WRITE];
+return len + scnprintf(page + len, PAGE_SIZE - len,
+"%s %u %lu %lu %u %u\n", sio_group_path(sg), sg->weight,
+sg->dispatched[READ], sg->dispatched[WRITE],
+nr ? jiffies_to_msecs(sg->wait_total / nr) : 0,
+jiffies_to_msecs(sg->wait_max));
+}
+/*
+* Per group: cgroup, weight, dispatched reads and writes, average and
+* max time in the queue in ms.
+*/
+static ssize_t
+sio_group_stats_show(struct elevator_queue *e, char *page)
+{
+struct sio_data *sd = e->elevator_data;
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+struct hlist_node *pos;
+struct sio_group *sg;
+#endif
+int len = 0;
+spin_lock_irq(sd->queue->queue_lock);
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+hlist_for_each_entry(sg, pos, &sd->group_list, sd_node)
+len = sio_group_stats_show_one(sg, page, len);
+#else
+len = sio_group_stats_show_one(&sd->root_group, page, len);
+#endif
+spin_unlock_irq(sd->queue->queue_lock);
+return len;
+}
 #define DD_ATTR(name) \
 __ATTR(name, S_IRUGO|S_IWUSR, sio_##name##_show, \
 sio_##name##_store)
@@ -310,6 +674,8 @@ DD_ATTR(async_read_expire),
 DD_ATTR(async_write_expire),
 DD_ATTR(fifo_batch),
 DD_ATTR(writes_starved),
+DD_ATTR(group_quantum),
+__ATTR(group_stats, S_IRUGO, sio_group_stats_show, NULL),
 __ATTR_NULL
 };
 static struct elevator_type iosched_sioplus = {
@@ -320,6 +686,11 @@ static struct elevator_type iosched_sioplus = {
 .elevator_queue_empty_fn	= sio_queue_empty,
 .elevator_former_req_fn	= sio_former_request,
 .elevator_latter_req_fn	= sio_latter_request,
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+.elevator_completed_req_fn	= sio_completed_request,
+.elevator_set_req_fn	= sio_set_request,
+.elevator_put_req_fn	= sio_put_request,
+#endif
 .elevator_init_fn	= sio_init_queue,
 .elevator_exit_fn	= sio_exit_queue,
 },
@@ -327,15 +698,28 @@ static struct elevator_type iosched_sioplus = {
 .elevator_name = "sioplus",
 .elevator_owner = THIS_MODULE,
 };
+#ifdef CONFIG_SIOPLUS_GROUP_IOSCHED
+static struct blkio_policy_type blkio_policy_sio = {
+.ops = {
+.blkio_unlink_group_fn	= sio_unlink_blkio_group,
+.blkio_update_group_weight_fn	= sio_update_blkio_group_weight,
+},
+.plid = BLKIO_POLICY_PROP,
+};
+#else
+static struct blkio_policy_type blkio_policy_sio;
+#endif
 static int __init sioplus_init(void)
 {
 /* Register elevator */
 elv_register(&iosched_sioplus);
+blkio_policy_register(&blkio_policy_sio);
 return 0;
 }
 static void __exit sioplus_exit(void)
 {
 /* Unregister elevator */
+blkio_policy_unregister(&blkio_policy_sio);
 elv_unregister(&iosched_sioplus);
 }
 module_init(sioplus_init);
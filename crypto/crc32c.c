@@ -40,6 +40,7 @@
 #include <linux/module.h>
 #include <linux/string.h>
 #include <linux/kernel.h>
+#include <linux/hrtimer.h>
 
 #define CHKSUM_BLOCK_SIZE	1
 #define CHKSUM_DIGEST_SIZE	4
@@ -133,7 +134,7 @@ static const u32 crc32c_table[256] = {
  * crc using table.
  */
 
-static u32 crc32c(u32 crc, const u8 *data, unsigned int length)
+static u32 crc32c_sb1(u32 crc, const u8 *data, unsigned int length)
 {
 	while (length--)
 		crc = crc32c_table[(crc ^ *data++) & 0xFFL] ^ (crc >> 8);
@@ -141,6 +142,49 @@ static u32 crc32c(u32 crc, const u8 *data, unsigned int length)
 	return crc;
 }
 
+/*
+ * Slice by 8: crc32c_sb8_table[n][i] is the crc of byte i followed by n
+ * zero bytes, so that eight bytes can be looked up at once, with eight
+ * times the table to keep in cache.  Filled in from crc32c_table at init.
+ */
+static u32 crc32c_sb8_table[8][256] __read_mostly;
+
+static u32 crc32c_sb8(u32 crc, const u8 *data, unsigned int length)
+{
+	const u32 (*t)[256] = crc32c_sb8_table;
+	const __le32 *p;
+	u32 q;
+
+	while (length && ((unsigned long)data & 3)) {
+		crc = t[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+		length--;
+	}
+
+	for (p = (const __le32 *)data; length >= 8; length -= 8) {
+		q = crc ^ le32_to_cpu(*p++);
+		crc = t[7][q & 0xff] ^ t[6][(q >> 8) & 0xff] ^
+		      t[5][(q >> 16) & 0xff] ^ t[4][q >> 24];
+		q = le32_to_cpu(*p++);
+		crc ^= t[3][q & 0xff] ^ t[2][(q >> 8) & 0xff] ^
+		       t[1][(q >> 16) & 0xff] ^ t[0][q >> 24];
+	}
+
+	for (data = (const u8 *)p; length; length--)
+		crc = t[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+/* the faster of the two on this CPU, measured at init */
+static bool crc32c_use_sb8 __read_mostly;
+
+static u32 crc32c(u32 crc, const u8 *data, unsigned int length)
+{
+	if (crc32c_use_sb8)
+		return crc32c_sb8(crc, data, length);
+	return crc32c_sb1(crc, data, length);
+}
+
 /*
  * Steps through buffer one byte at at time, calculates reflected
  * crc using table.
@@ -242,8 +286,57 @@ static struct shash_alg alg = {
 	}
 };
 
+static s64 __init crc32c_time(u32 (*fn)(u32, const u8 *, unsigned int),
+			      const u8 *buf, unsigned int len, u32 *crc)
+{
+	ktime_t start;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < 16; i++)
+		*crc = fn(*crc, buf, len);
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+/*
+ * Slice by 8 wins on most CPUs, but a small L1 can lose more to the 8KB
+ * of tables than the loop saves, so time both over a 4KB block (the
+ * tables themselves make a good enough buffer) and keep the faster.
+ */
+static void __init crc32c_select(void)
+{
+	const u8 *buf = (const u8 *)crc32c_sb8_table[1] + 1;
+	u32 crc1 = ~0, crc8 = ~0;
+	s64 t1, t8;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc32c_sb8_table[0][i] = crc32c_table[i];
+		for (j = 1; j < 8; j++)
+			crc32c_sb8_table[j][i] =
+				crc32c_table[crc32c_sb8_table[j - 1][i] & 0xff] ^
+				(crc32c_sb8_table[j - 1][i] >> 8);
+	}
+
+	/* warm both up, then measure */
+	crc32c_time(crc32c_sb1, buf, 4096, &crc1);
+	crc32c_time(crc32c_sb8, buf, 4096, &crc8);
+	t1 = crc32c_time(crc32c_sb1, buf, 4096, &crc1);
+	t8 = crc32c_time(crc32c_sb8, buf, 4096, &crc8);
+
+	if (crc1 != crc8) {
+		WARN(1, "crc32c: slice-by-8 disagrees with the byte loop\n");
+		return;
+	}
+
+	crc32c_use_sb8 = t8 < t1;
+	pr_info("crc32c: byte loop %lld ns, slice-by-8 %lld ns per 64KB, "
+		"using %s\n", t1, t8, crc32c_use_sb8 ? "slice-by-8" : "bytes");
+}
+
 static int __init crc32c_mod_init(void)
 {
+	crc32c_select();
 	return crypto_register_shash(&alg);
 }
 
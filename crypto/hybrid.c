@@ -0,0 +1,828 @@
+/*
+ * Hybrid dispatch between a crypto engine and the CPU.
+ *
+ * hybrid(<hw>,<cpu>) takes two asynchronous implementations of the same
+ * algorithm, typically an offload engine driver and a NEON or assembler
+ * one, and hands each request to one of them by length.  Below some size
+ * setting up the DMA and taking the interrupt costs an engine more than
+ * the CPU needs for the whole request; above it the engine is about as
+ * fast and leaves the CPU free for other work.
+ *
+ * The size is found when the instance is created by timing both sides
+ * on requests of increasing length, unless the threshold parameter sets
+ * it.  Only one-shot hashes (digest) are dispatched: the state of an
+ * incremental hash cannot move between implementations, so init, update
+ * and final always go to <cpu>.
+ *
+ * Requests and bytes seen by each side are in debugfs, crypto_hybrid.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/internal/hash.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/err.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+enum { HYBRID_HW, HYBRID_CPU, HYBRID_NR };
+
+static const char * const hybrid_side_names[HYBRID_NR] = { "hw", "cpu" };
+
+/* calibration: requests of 64 bytes to HYBRID_CALIB_MAX, best of RUNS */
+#define HYBRID_CALIB_MIN	64
+#define HYBRID_CALIB_MAX	16384
+#define HYBRID_CALIB_RUNS	4
+
+static unsigned int threshold;
+module_param(threshold, uint, 0644);
+MODULE_PARM_DESC(threshold, "Requests of at least this many bytes go to "
+		 "the engine of new instances (0: measure)");
+
+struct hybrid_stats {
+	atomic_long_t reqs;
+	atomic64_t bytes;
+};
+
+struct hybrid_instance_ctx {
+	union {
+		struct crypto_spawn cipher[HYBRID_NR];
+		struct crypto_ahash_spawn hash[HYBRID_NR];
+	};
+	unsigned int threshold;
+	struct hybrid_stats stats[HYBRID_NR];
+
+	const char *name;
+	struct list_head list;
+};
+
+struct hybrid_cipher_ctx {
+	struct crypto_ablkcipher *child[HYBRID_NR];
+};
+
+struct hybrid_hash_ctx {
+	struct crypto_ahash *child[HYBRID_NR];
+};
+
+static LIST_HEAD(hybrid_instances);
+static DEFINE_MUTEX(hybrid_mutex);
+static struct dentry *hybrid_debugfs;
+
+static int hybrid_account(struct hybrid_instance_ctx *ictx, int side,
+			  unsigned int nbytes)
+{
+	atomic_long_inc(&ictx->stats[side].reqs);
+	atomic64_add(nbytes, &ictx->stats[side].bytes);
+
+	return side;
+}
+
+static int hybrid_side(struct hybrid_instance_ctx *ictx, unsigned int nbytes)
+{
+	return hybrid_account(ictx, nbytes >= ictx->threshold ?
+				    HYBRID_HW : HYBRID_CPU, nbytes);
+}
+
+static void hybrid_cipher_done(struct crypto_async_request *areq, int err)
+{
+	struct ablkcipher_request *req = areq->data;
+
+	req->base.complete(&req->base, err);
+}
+
+static int hybrid_cipher_setkey(struct crypto_ablkcipher *parent,
+				const u8 *key, unsigned int keylen)
+{
+	struct hybrid_cipher_ctx *ctx = crypto_ablkcipher_ctx(parent);
+	struct crypto_ablkcipher *child;
+	int i, err = 0;
+
+	for (i = 0; i < HYBRID_NR && !err; i++) {
+		child = ctx->child[i];
+		crypto_ablkcipher_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+		crypto_ablkcipher_set_flags(child,
+				crypto_ablkcipher_get_flags(parent) &
+				CRYPTO_TFM_REQ_MASK);
+		err = crypto_ablkcipher_setkey(child, key, keylen);
+		crypto_ablkcipher_set_flags(parent,
+				crypto_ablkcipher_get_flags(child) &
+				CRYPTO_TFM_RES_MASK);
+	}
+
+	return err;
+}
+
+static struct ablkcipher_request *hybrid_cipher_subreq(
+	struct ablkcipher_request *req)
+{
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct crypto_instance *inst = crypto_tfm_alg_instance(&tfm->base);
+	struct hybrid_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct hybrid_cipher_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+	struct ablkcipher_request *subreq = ablkcipher_request_ctx(req);
+
+	ablkcipher_request_set_tfm(subreq,
+				   ctx->child[hybrid_side(ictx, req->nbytes)]);
+	ablkcipher_request_set_callback(subreq, req->base.flags,
+					hybrid_cipher_done, req);
+	ablkcipher_request_set_crypt(subreq, req->src, req->dst, req->nbytes,
+				     req->info);
+
+	return subreq;
+}
+
+static int hybrid_cipher_encrypt(struct ablkcipher_request *req)
+{
+	return crypto_ablkcipher_encrypt(hybrid_cipher_subreq(req));
+}
+
+static int hybrid_cipher_decrypt(struct ablkcipher_request *req)
+{
+	return crypto_ablkcipher_decrypt(hybrid_cipher_subreq(req));
+}
+
+static int hybrid_cipher_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct hybrid_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct hybrid_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_ablkcipher *cipher;
+	unsigned int reqsize = 0;
+	int i;
+
+	for (i = 0; i < HYBRID_NR; i++) {
+		cipher = __crypto_ablkcipher_cast(
+			crypto_spawn_tfm(&ictx->cipher[i],
+					 CRYPTO_ALG_TYPE_ABLKCIPHER,
+					 CRYPTO_ALG_TYPE_MASK));
+		if (IS_ERR(cipher)) {
+			if (i)
+				crypto_free_ablkcipher(ctx->child[0]);
+			return PTR_ERR(cipher);
+		}
+
+		ctx->child[i] = cipher;
+		reqsize = max(reqsize, crypto_ablkcipher_reqsize(cipher));
+	}
+
+	tfm->crt_ablkcipher.reqsize = sizeof(struct ablkcipher_request) +
+				      reqsize;
+	return 0;
+}
+
+static void hybrid_cipher_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct hybrid_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_ablkcipher(ctx->child[HYBRID_HW]);
+	crypto_free_ablkcipher(ctx->child[HYBRID_CPU]);
+}
+
+static void hybrid_hash_done(struct crypto_async_request *areq, int err)
+{
+	struct ahash_request *req = areq->data;
+
+	req->base.complete(&req->base, err);
+}
+
+static int hybrid_hash_setkey(struct crypto_ahash *parent, const u8 *key,
+			      unsigned int keylen)
+{
+	struct hybrid_hash_ctx *ctx = crypto_ahash_ctx(parent);
+	struct crypto_ahash *child;
+	int i, err = 0;
+
+	for (i = 0; i < HYBRID_NR && !err; i++) {
+		child = ctx->child[i];
+		crypto_ahash_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+		crypto_ahash_set_flags(child, crypto_ahash_get_flags(parent) &
+					      CRYPTO_TFM_REQ_MASK);
+		err = crypto_ahash_setkey(child, key, keylen);
+		crypto_ahash_set_flags(parent, crypto_ahash_get_flags(child) &
+					       CRYPTO_TFM_RES_MASK);
+	}
+
+	return err;
+}
+
+static struct ahash_request *hybrid_hash_subreq(struct ahash_request *req,
+						int side)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct hybrid_hash_ctx *ctx = crypto_ahash_ctx(tfm);
+	struct ahash_request *subreq = ahash_request_ctx(req);
+
+	ahash_request_set_tfm(subreq, ctx->child[side]);
+	ahash_request_set_callback(subreq, req->base.flags, hybrid_hash_done,
+				   req);
+	ahash_request_set_crypt(subreq, req->src, req->result, req->nbytes);
+
+	return subreq;
+}
+
+static struct hybrid_instance_ctx *hybrid_hash_ictx(struct ahash_request *req)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+
+	return crypto_instance_ctx(crypto_tfm_alg_instance(&tfm->base));
+}
+
+static int hybrid_hash_init(struct ahash_request *req)
+{
+	return crypto_ahash_init(hybrid_hash_subreq(req, HYBRID_CPU));
+}
+
+static int hybrid_hash_update(struct ahash_request *req)
+{
+	hybrid_account(hybrid_hash_ictx(req), HYBRID_CPU, req->nbytes);
+	return crypto_ahash_update(hybrid_hash_subreq(req, HYBRID_CPU));
+}
+
+static int hybrid_hash_final(struct ahash_request *req)
+{
+	return crypto_ahash_final(hybrid_hash_subreq(req, HYBRID_CPU));
+}
+
+static int hybrid_hash_finup(struct ahash_request *req)
+{
+	hybrid_account(hybrid_hash_ictx(req), HYBRID_CPU, req->nbytes);
+	return crypto_ahash_finup(hybrid_hash_subreq(req, HYBRID_CPU));
+}
+
+static int hybrid_hash_digest(struct ahash_request *req)
+{
+	int side = hybrid_side(hybrid_hash_ictx(req), req->nbytes);
+
+	return crypto_ahash_digest(hybrid_hash_subreq(req, side));
+}
+
+static int hybrid_hash_export(struct ahash_request *req, void *out)
+{
+	return crypto_ahash_export(hybrid_hash_subreq(req, HYBRID_CPU), out);
+}
+
+static int hybrid_hash_import(struct ahash_request *req, const void *in)
+{
+	return crypto_ahash_import(hybrid_hash_subreq(req, HYBRID_CPU), in);
+}
+
+static int hybrid_hash_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct hybrid_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct hybrid_hash_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_ahash *hash;
+	unsigned int reqsize = 0;
+	int i;
+
+	for (i = 0; i < HYBRID_NR; i++) {
+		hash = crypto_spawn_ahash(&ictx->hash[i]);
+		if (IS_ERR(hash)) {
+			if (i)
+				crypto_free_ahash(ctx->child[0]);
+			return PTR_ERR(hash);
+		}
+
+		ctx->child[i] = hash;
+		reqsize = max(reqsize, crypto_ahash_reqsize(hash));
+	}
+
+	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
+				 sizeof(struct ahash_request) + reqsize);
+	return 0;
+}
+
+static void hybrid_hash_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct hybrid_hash_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_ahash(ctx->child[HYBRID_HW]);
+	crypto_free_ahash(ctx->child[HYBRID_CPU]);
+}
+
+/*
+ * Calibration
+ */
+
+struct hybrid_result {
+	struct completion completion;
+	int err;
+};
+
+static void hybrid_calib_done(struct crypto_async_request *req, int err)
+{
+	struct hybrid_result *res = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+
+	res->err = err;
+	complete(&res->completion);
+}
+
+static int hybrid_calib_wait(int ret, struct hybrid_result *res)
+{
+	if (ret == -EINPROGRESS || ret == -EBUSY) {
+		wait_for_completion(&res->completion);
+		INIT_COMPLETION(res->completion);
+		ret = res->err;
+	}
+	return ret;
+}
+
+/* nanoseconds the fastest of HYBRID_CALIB_RUNS requests of @len took */
+static s64 hybrid_time_cipher(void *tfm, struct scatterlist *sg,
+			      unsigned int len, u8 *scratch)
+{
+	struct ablkcipher_request *req;
+	struct hybrid_result res;
+	s64 best = LLONG_MAX;
+	ktime_t start;
+	int i, err = 0;
+
+	req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	init_completion(&res.completion);
+	ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					hybrid_calib_done, &res);
+	ablkcipher_request_set_crypt(req, sg, sg, len, scratch);
+
+	for (i = 0; i < HYBRID_CALIB_RUNS; i++) {
+		start = ktime_get();
+		err = hybrid_calib_wait(crypto_ablkcipher_encrypt(req), &res);
+		if (err)
+			break;
+		best = min(best, ktime_to_ns(ktime_sub(ktime_get(), start)));
+	}
+
+	ablkcipher_request_free(req);
+	return err ? err : best;
+}
+
+static s64 hybrid_time_hash(void *tfm, struct scatterlist *sg,
+			    unsigned int len, u8 *scratch)
+{
+	struct ahash_request *req;
+	struct hybrid_result res;
+	s64 best = LLONG_MAX;
+	ktime_t start;
+	int i, err = 0;
+
+	req = ahash_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	init_completion(&res.completion);
+	ahash_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				   hybrid_calib_done, &res);
+	ahash_request_set_crypt(req, sg, scratch, len);
+
+	for (i = 0; i < HYBRID_CALIB_RUNS; i++) {
+		start = ktime_get();
+		err = hybrid_calib_wait(crypto_ahash_digest(req), &res);
+		if (err)
+			break;
+		best = min(best, ktime_to_ns(ktime_sub(ktime_get(), start)));
+	}
+
+	ahash_request_free(req);
+	return err ? err : best;
+}
+
+/*
+ * The smallest length, doubling from HYBRID_CALIB_MIN, at which the
+ * engine keeps up with the CPU, or UINT_MAX if it never does.  @scratch
+ * holds the IV or the digest and is as large as either may be.
+ */
+static unsigned int hybrid_calibrate(struct hybrid_instance_ctx *ictx,
+				     void *tfms[HYBRID_NR],
+				     s64 (*time)(void *tfm,
+						 struct scatterlist *sg,
+						 unsigned int len,
+						 u8 *scratch),
+				     u8 *scratch)
+{
+	struct scatterlist sg;
+	unsigned int len, found = UINT_MAX;
+	s64 t[HYBRID_NR];
+	void *buf;
+	int i;
+
+	buf = kzalloc(HYBRID_CALIB_MAX, GFP_KERNEL);
+	if (!buf)
+		return found;
+
+	for (len = HYBRID_CALIB_MIN; len <= HYBRID_CALIB_MAX; len <<= 1) {
+		sg_init_one(&sg, buf, len);
+		for (i = 0; i < HYBRID_NR; i++)
+			t[i] = time(tfms[i], &sg, len, scratch);
+		if (t[HYBRID_HW] < 0 || t[HYBRID_CPU] < 0) {
+			pr_warn("hybrid: %s: calibration failed: %lld\n",
+				ictx->name, min(t[HYBRID_HW], t[HYBRID_CPU]));
+			break;
+		}
+		if (t[HYBRID_HW] <= t[HYBRID_CPU]) {
+			found = len;
+			break;
+		}
+	}
+
+	kfree(buf);
+	return found;
+}
+
+static int hybrid_set_threshold(struct hybrid_instance_ctx *ictx, u32 type,
+				unsigned int keylen)
+{
+	void *tfms[HYBRID_NR] = { NULL, NULL };
+	u8 *scratch;
+	int i, err = 0;
+
+	if (threshold) {
+		ictx->threshold = threshold;
+		return 0;
+	}
+
+	/* large enough for any IV, any digest and any key */
+	scratch = kzalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!scratch)
+		return -ENOMEM;
+	memset(scratch, 0x5a, keylen);
+
+	for (i = 0; i < HYBRID_NR; i++) {
+		if (type == CRYPTO_ALG_TYPE_AHASH)
+			tfms[i] = crypto_spawn_ahash(&ictx->hash[i]);
+		else
+			tfms[i] = __crypto_ablkcipher_cast(
+				crypto_spawn_tfm(&ictx->cipher[i],
+						 CRYPTO_ALG_TYPE_ABLKCIPHER,
+						 CRYPTO_ALG_TYPE_MASK));
+		if (IS_ERR(tfms[i])) {
+			err = PTR_ERR(tfms[i]);
+			tfms[i] = NULL;
+			goto out;
+		}
+		if (type != CRYPTO_ALG_TYPE_AHASH)
+			err = crypto_ablkcipher_setkey(tfms[i], scratch,
+						       keylen);
+		if (err)
+			goto out;
+	}
+	memset(scratch, 0, keylen);
+
+	if (type == CRYPTO_ALG_TYPE_AHASH)
+		ictx->threshold = hybrid_calibrate(ictx, tfms,
+						   hybrid_time_hash, scratch);
+	else
+		ictx->threshold = hybrid_calibrate(ictx, tfms,
+						   hybrid_time_cipher,
+						   scratch);
+
+	if (ictx->threshold == UINT_MAX)
+		pr_info("hybrid: %s: engine slower at all sizes\n",
+			ictx->name);
+	else
+		pr_info("hybrid: %s: engine from %u bytes\n", ictx->name,
+			ictx->threshold);
+
+out:
+	for (i = 0; i < HYBRID_NR; i++) {
+		if (!tfms[i])
+			continue;
+		if (type == CRYPTO_ALG_TYPE_AHASH)
+			crypto_free_ahash(tfms[i]);
+		else
+			crypto_free_ablkcipher(tfms[i]);
+	}
+	kfree(scratch);
+	return err;
+}
+
+/* Name and priority of an instance, from those of its two algorithms */
+static int hybrid_init_alg(struct crypto_alg *inst_alg,
+			   struct crypto_alg *algs[HYBRID_NR])
+{
+	if (strcmp(algs[HYBRID_HW]->cra_name, algs[HYBRID_CPU]->cra_name))
+		return -EINVAL;
+
+	if (snprintf(inst_alg->cra_driver_name, CRYPTO_MAX_ALG_NAME,
+		     "hybrid(%s,%s)", algs[HYBRID_HW]->cra_driver_name,
+		     algs[HYBRID_CPU]->cra_driver_name) >= CRYPTO_MAX_ALG_NAME)
+		return -ENAMETOOLONG;
+
+	memcpy(inst_alg->cra_name, algs[HYBRID_HW]->cra_name,
+	       CRYPTO_MAX_ALG_NAME);
+
+	inst_alg->cra_priority = max(algs[HYBRID_HW]->cra_priority,
+				     algs[HYBRID_CPU]->cra_priority) + 50;
+	inst_alg->cra_blocksize = algs[HYBRID_HW]->cra_blocksize;
+	inst_alg->cra_alignmask = algs[HYBRID_HW]->cra_alignmask |
+				  algs[HYBRID_CPU]->cra_alignmask;
+
+	return 0;
+}
+
+static void hybrid_list_add(struct hybrid_instance_ctx *ictx)
+{
+	mutex_lock(&hybrid_mutex);
+	list_add_tail(&ictx->list, &hybrid_instances);
+	mutex_unlock(&hybrid_mutex);
+}
+
+static void hybrid_list_del(struct hybrid_instance_ctx *ictx)
+{
+	mutex_lock(&hybrid_mutex);
+	list_del(&ictx->list);
+	mutex_unlock(&hybrid_mutex);
+}
+
+static int hybrid_create_cipher(struct crypto_template *tmpl,
+				struct rtattr **tb)
+{
+	struct crypto_alg *algs[HYBRID_NR] = { NULL, NULL };
+	struct hybrid_instance_ctx *ictx;
+	struct crypto_instance *inst;
+	int i, err;
+
+	for (i = 0; i < HYBRID_NR; i++) {
+		algs[i] = crypto_attr_alg(tb[i + 1], CRYPTO_ALG_TYPE_ABLKCIPHER,
+					  CRYPTO_ALG_TYPE_MASK);
+		err = PTR_ERR(algs[i]);
+		if (IS_ERR(algs[i])) {
+			algs[i] = NULL;
+			goto out_put_algs;
+		}
+	}
+
+	err = -EINVAL;
+	if (algs[HYBRID_HW]->cra_ablkcipher.ivsize !=
+	    algs[HYBRID_CPU]->cra_ablkcipher.ivsize)
+		goto out_put_algs;
+
+	inst = kzalloc(sizeof(*inst) + sizeof(*ictx), GFP_KERNEL);
+	err = -ENOMEM;
+	if (!inst)
+		goto out_put_algs;
+
+	err = hybrid_init_alg(&inst->alg, algs);
+	if (err)
+		goto out_free_inst;
+
+	ictx = crypto_instance_ctx(inst);
+	for (i = 0; i < HYBRID_NR; i++) {
+		err = crypto_init_spawn(&ictx->cipher[i], algs[i], inst,
+					CRYPTO_ALG_TYPE_MASK);
+		if (err)
+			goto out_drop_spawns;
+	}
+
+	inst->alg.cra_flags = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC;
+	inst->alg.cra_type = &crypto_ablkcipher_type;
+
+	inst->alg.cra_ablkcipher.ivsize = algs[HYBRID_HW]->cra_ablkcipher.ivsize;
+	inst->alg.cra_ablkcipher.min_keysize =
+		max(algs[HYBRID_HW]->cra_ablkcipher.min_keysize,
+		    algs[HYBRID_CPU]->cra_ablkcipher.min_keysize);
+	inst->alg.cra_ablkcipher.max_keysize =
+		min(algs[HYBRID_HW]->cra_ablkcipher.max_keysize,
+		    algs[HYBRID_CPU]->cra_ablkcipher.max_keysize);
+
+	inst->alg.cra_ctxsize = sizeof(struct hybrid_cipher_ctx);
+
+	inst->alg.cra_init = hybrid_cipher_init_tfm;
+	inst->alg.cra_exit = hybrid_cipher_exit_tfm;
+
+	inst->alg.cra_ablkcipher.setkey = hybrid_cipher_setkey;
+	inst->alg.cra_ablkcipher.encrypt = hybrid_cipher_encrypt;
+	inst->alg.cra_ablkcipher.decrypt = hybrid_cipher_decrypt;
+
+	ictx->name = inst->alg.cra_driver_name;
+	err = hybrid_set_threshold(ictx, CRYPTO_ALG_TYPE_ABLKCIPHER,
+				   inst->alg.cra_ablkcipher.min_keysize);
+	if (err)
+		goto out_drop_spawns;
+
+	hybrid_list_add(ictx);
+	err = crypto_register_instance(tmpl, inst);
+	if (err) {
+		hybrid_list_del(ictx);
+		goto out_drop_spawns;
+	}
+
+out_put_algs:
+	for (i = 0; i < HYBRID_NR; i++)
+		if (algs[i])
+			crypto_mod_put(algs[i]);
+	return err;
+
+out_drop_spawns:
+	while (--i >= 0)
+		crypto_drop_spawn(&ictx->cipher[i]);
+out_free_inst:
+	kfree(inst);
+	goto out_put_algs;
+}
+
+static int hybrid_create_hash(struct crypto_template *tmpl,
+			      struct rtattr **tb)
+{
+	struct hash_alg_common *halgs[HYBRID_NR] = { NULL, NULL };
+	struct crypto_alg *algs[HYBRID_NR];
+	struct hybrid_instance_ctx *ictx;
+	struct ahash_instance *inst;
+	int i, err;
+
+	for (i = 0; i < HYBRID_NR; i++) {
+		halgs[i] = ahash_attr_alg(tb[i + 1], 0, 0);
+		err = PTR_ERR(halgs[i]);
+		if (IS_ERR(halgs[i])) {
+			halgs[i] = NULL;
+			goto out_put_algs;
+		}
+		algs[i] = &halgs[i]->base;
+	}
+
+	err = -EINVAL;
+	if (halgs[HYBRID_HW]->digestsize != halgs[HYBRID_CPU]->digestsize)
+		goto out_put_algs;
+
+	inst = kzalloc(ahash_instance_headroom() + sizeof(struct crypto_instance) +
+		       sizeof(*ictx), GFP_KERNEL);
+	err = -ENOMEM;
+	if (!inst)
+		goto out_put_algs;
+
+	err = hybrid_init_alg(&inst->alg.halg.base, algs);
+	if (err)
+		goto out_free_inst;
+
+	ictx = ahash_instance_ctx(inst);
+	for (i = 0; i < HYBRID_NR; i++) {
+		err = crypto_init_ahash_spawn(&ictx->hash[i], halgs[i],
+					      ahash_crypto_instance(inst));
+		if (err)
+			goto out_drop_spawns;
+	}
+
+	inst->alg.halg.base.cra_flags = CRYPTO_ALG_ASYNC;
+
+	inst->alg.halg.digestsize = halgs[HYBRID_CPU]->digestsize;
+	inst->alg.halg.statesize = halgs[HYBRID_CPU]->statesize;
+	inst->alg.halg.base.cra_ctxsize = sizeof(struct hybrid_hash_ctx);
+
+	inst->alg.halg.base.cra_init = hybrid_hash_init_tfm;
+	inst->alg.halg.base.cra_exit = hybrid_hash_exit_tfm;
+
+	inst->alg.init   = hybrid_hash_init;
+	inst->alg.update = hybrid_hash_update;
+	inst->alg.final  = hybrid_hash_final;
+	inst->alg.finup  = hybrid_hash_finup;
+	inst->alg.export = hybrid_hash_export;
+	inst->alg.import = hybrid_hash_import;
+	inst->alg.setkey = hybrid_hash_setkey;
+	inst->alg.digest = hybrid_hash_digest;
+
+	/* keyed hashes are calibrated unkeyed, which costs the same */
+	ictx->name = inst->alg.halg.base.cra_driver_name;
+	err = hybrid_set_threshold(ictx, CRYPTO_ALG_TYPE_AHASH, 0);
+	if (err)
+		goto out_drop_spawns;
+
+	hybrid_list_add(ictx);
+	err = ahash_register_instance(tmpl, inst);
+	if (err) {
+		hybrid_list_del(ictx);
+		goto out_drop_spawns;
+	}
+
+out_put_algs:
+	for (i = 0; i < HYBRID_NR; i++)
+		if (halgs[i])
+			crypto_mod_put(&halgs[i]->base);
+	return err;
+
+out_drop_spawns:
+	while (--i >= 0)
+		crypto_drop_ahash(&ictx->hash[i]);
+out_free_inst:
+	kfree(inst);
+	goto out_put_algs;
+}
+
+static int hybrid_create(struct crypto_template *tmpl, struct rtattr **tb)
+{
+	struct crypto_attr_type *algt;
+
+	algt = crypto_get_attr_type(tb);
+	if (IS_ERR(algt))
+		return PTR_ERR(algt);
+
+	switch (algt->type & algt->mask & CRYPTO_ALG_TYPE_MASK) {
+	case CRYPTO_ALG_TYPE_BLKCIPHER:
+		return hybrid_create_cipher(tmpl, tb);
+	case CRYPTO_ALG_TYPE_DIGEST:
+		return hybrid_create_hash(tmpl, tb);
+	}
+
+	return -EINVAL;
+}
+
+static void hybrid_free(struct crypto_instance *inst)
+{
+	struct hybrid_instance_ctx *ictx = crypto_instance_ctx(inst);
+	int i;
+
+	hybrid_list_del(ictx);
+
+	switch (inst->alg.cra_flags & CRYPTO_ALG_TYPE_MASK) {
+	case CRYPTO_ALG_TYPE_AHASH:
+		for (i = 0; i < HYBRID_NR; i++)
+			crypto_drop_ahash(&ictx->hash[i]);
+		kfree(ahash_instance(inst));
+		return;
+	default:
+		for (i = 0; i < HYBRID_NR; i++)
+			crypto_drop_spawn(&ictx->cipher[i]);
+		kfree(inst);
+	}
+}
+
+static struct crypto_template hybrid_tmpl = {
+	.name = "hybrid",
+	.create = hybrid_create,
+	.free = hybrid_free,
+	.module = THIS_MODULE,
+};
+
+static int hybrid_stats_show(struct seq_file *m, void *v)
+{
+	struct hybrid_instance_ctx *ictx;
+	int i;
+
+	mutex_lock(&hybrid_mutex);
+	list_for_each_entry(ictx, &hybrid_instances, list) {
+		seq_printf(m, "%s threshold %u", ictx->name, ictx->threshold);
+		for (i = 0; i < HYBRID_NR; i++)
+			seq_printf(m, " %s %lu %llu", hybrid_side_names[i],
+				   atomic_long_read(&ictx->stats[i].reqs),
+				   (unsigned long long)
+				   atomic64_read(&ictx->stats[i].bytes));
+		seq_putc(m, '\n');
+	}
+	mutex_unlock(&hybrid_mutex);
+
+	return 0;
+}
+
+static int hybrid_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, hybrid_stats_show, NULL);
+}
+
+static const struct file_operations hybrid_stats_fops = {
+	.open		= hybrid_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init hybrid_init(void)
+{
+	int err;
+
+	err = crypto_register_template(&hybrid_tmpl);
+	if (err)
+		return err;
+
+	hybrid_debugfs = debugfs_create_file("crypto_hybrid", S_IRUGO, NULL,
+					     NULL, &hybrid_stats_fops);
+	return 0;
+}
+
+static void __exit hybrid_exit(void)
+{
+	debugfs_remove(hybrid_debugfs);
+	crypto_unregister_template(&hybrid_tmpl);
+}
+
+module_init(hybrid_init);
+module_exit(hybrid_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Dispatch between a crypto engine and the CPU by size");
@@ -425,3 +425,167 @@ int dma_buf_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma,
  return dmabuf->ops->mmap(dmabuf, vma);
 }
 EXPORT_SYMBOL_GPL(dma_buf_mmap);
+
+/*
+ * Importer side mapping cache.  A device that sees the same few buffers
+ * over and over, like a display or gpu going round a swap chain, keeps
+ * them attached and mapped here instead of attaching and mapping on every
+ * use.  Each entry holds a reference to its dma_buf, so an entry is never
+ * stale: the buffer cannot go away, nor its struct dma_buf be reused,
+ * while it is cached.
+ */
+struct dma_buf_map {
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	struct list_head node;
+	unsigned int users;
+};
+
+/**
+ * dma_buf_map_cache_init - set up a mapping cache
+ * @cache: [in] cache to set up
+ * @dev: [in] device the cached buffers are attached to
+ * @dir: [in] direction they are mapped for
+ * @size: [in] number of idle mappings kept
+ */
+void dma_buf_map_cache_init(struct dma_buf_map_cache *cache,
+			    struct device *dev, enum dma_data_direction dir,
+			    unsigned int size)
+{
+	memset(cache, 0, sizeof(*cache));
+	cache->dev = dev;
+	cache->dir = dir;
+	cache->size = size;
+	INIT_LIST_HEAD(&cache->lru);
+	mutex_init(&cache->lock);
+}
+EXPORT_SYMBOL_GPL(dma_buf_map_cache_init);
+
+static void dma_buf_map_free(struct dma_buf_map_cache *cache,
+			     struct dma_buf_map *map)
+{
+	dma_buf_unmap_attachment(map->attach, map->sgt, cache->dir);
+	dma_buf_detach(map->dmabuf, map->attach);
+	dma_buf_put(map->dmabuf);
+	kfree(map);
+}
+
+/* called with cache->lock held; mappings in use are never evicted */
+static void dma_buf_map_cache_trim(struct dma_buf_map_cache *cache,
+				   unsigned int size)
+{
+	struct dma_buf_map *map, *tmp;
+
+	list_for_each_entry_safe_reverse(map, tmp, &cache->lru, node) {
+		if (cache->count <= size)
+			break;
+		if (map->users)
+			continue;
+		list_del(&map->node);
+		cache->count--;
+		cache->evictions++;
+		dma_buf_map_free(cache, map);
+	}
+}
+
+/**
+ * dma_buf_map_cache_get - find or create the mapping of a buffer
+ * @cache: [in] the cache
+ * @dmabuf: [in] buffer to map; the caller holds a reference to it
+ *
+ * Returns the mapping, whose sg_table stays valid until it is given back
+ * with dma_buf_map_cache_put(), or a negative error.
+ */
+struct dma_buf_map *dma_buf_map_cache_get(struct dma_buf_map_cache *cache,
+					  struct dma_buf *dmabuf)
+{
+	struct dma_buf_map *map;
+	int ret;
+
+	mutex_lock(&cache->lock);
+	list_for_each_entry(map, &cache->lru, node) {
+		if (map->dmabuf == dmabuf) {
+			list_move(&map->node, &cache->lru);
+			map->users++;
+			cache->hits++;
+			goto out;
+		}
+	}
+	cache->misses++;
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	map->attach = dma_buf_attach(dmabuf, cache->dev);
+	if (IS_ERR(map->attach)) {
+		ret = PTR_ERR(map->attach);
+		goto err_free;
+	}
+	map->sgt = dma_buf_map_attachment(map->attach, cache->dir);
+	if (IS_ERR_OR_NULL(map->sgt)) {
+		ret = map->sgt ? PTR_ERR(map->sgt) : -ENOMEM;
+		goto err_detach;
+	}
+	get_dma_buf(dmabuf);
+	map->dmabuf = dmabuf;
+	map->users = 1;
+	list_add(&map->node, &cache->lru);
+	cache->count++;
+	dma_buf_map_cache_trim(cache, cache->size);
+out:
+	mutex_unlock(&cache->lock);
+	return map;
+
+err_detach:
+	dma_buf_detach(dmabuf, map->attach);
+err_free:
+	kfree(map);
+err:
+	mutex_unlock(&cache->lock);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(dma_buf_map_cache_get);
+
+/**
+ * dma_buf_map_sg_table - the sg_table of a mapping from the cache
+ * @map: [in] mapping returned by dma_buf_map_cache_get()
+ */
+struct sg_table *dma_buf_map_sg_table(struct dma_buf_map *map)
+{
+	return map->sgt;
+}
+EXPORT_SYMBOL_GPL(dma_buf_map_sg_table);
+
+/**
+ * dma_buf_map_cache_put - give back a mapping from dma_buf_map_cache_get()
+ * @cache: [in] the cache
+ * @map: [in] the mapping, which stays cached
+ */
+void dma_buf_map_cache_put(struct dma_buf_map_cache *cache,
+			   struct dma_buf_map *map)
+{
+	mutex_lock(&cache->lock);
+	WARN_ON(!map->users);
+	map->users--;
+	dma_buf_map_cache_trim(cache, cache->size);
+	mutex_unlock(&cache->lock);
+}
+EXPORT_SYMBOL_GPL(dma_buf_map_cache_put);
+
+/**
+ * dma_buf_map_cache_flush - drop every mapping not in use
+ * @cache: [in] the cache
+ *
+ * Also what an importer does before going away, when all the mappings it
+ * got have been given back.
+ */
+void dma_buf_map_cache_flush(struct dma_buf_map_cache *cache)
+{
+	mutex_lock(&cache->lock);
+	dma_buf_map_cache_trim(cache, 0);
+	mutex_unlock(&cache->lock);
+}
+EXPORT_SYMBOL_GPL(dma_buf_map_cache_flush);
@@ -20,6 +20,8 @@
 #include <linux/device.h>
 #include <linux/kallsyms.h>
 #include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
 #include <linux/resume-trace.h>
@@ -58,6 +60,21 @@ struct dpm_drv_wd_data {
 
 static int async_error;
 
+/*
+ * Suspend/resume ordering links between devices that are not parent and
+ * child, see device_pm_add_link().  They are only ever added, and hold a
+ * reference to both of their devices, so the async threads walk the list
+ * without locking.  A link to an unregistered device costs nothing, its
+ * completion stays done.
+ */
+struct dpm_link {
+	struct list_head node;
+	struct device *consumer;
+	struct device *supplier;
+};
+
+static LIST_HEAD(dpm_links);
+
 /**
  * device_pm_init - Initialize the PM-related part of a device object.
  * @dev: Device object being initialized.
@@ -187,29 +204,105 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 	}
 }
 
+/**
+ * device_pm_add_link - Make a device suspend before and resume after another.
+ * @consumer: Device that needs @supplier to be working.
+ * @supplier: Device @consumer depends on.
+ *
+ * Like a parent for its children, @supplier is suspended only once @consumer
+ * has been, and resumed before it, whether either is handled asynchronously
+ * or not.  Both devices must be registered, and @consumer must not have any
+ * children yet since it may be moved after @supplier in dpm_list.  The link
+ * can't be removed.
+ */
+int device_pm_add_link(struct device *consumer, struct device *supplier)
+{
+	struct dpm_link *link;
+	struct device *dev = supplier;
+
+	link = kmalloc(sizeof(*link), GFP_KERNEL);
+	if (!link)
+		return -ENOMEM;
+
+	link->consumer = get_device(consumer);
+	link->supplier = get_device(supplier);
+
+	mutex_lock(&dpm_list_mtx);
+	/* synchronous devices are still handled in dpm_list order */
+	list_for_each_entry_continue(dev, &dpm_list, power.entry)
+		if (dev == consumer)
+			break;
+	if (dev != consumer)
+		device_pm_move_after(consumer, supplier);
+	list_add_tail_rcu(&link->node, &dpm_links);
+	mutex_unlock(&dpm_list_mtx);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(device_pm_add_link);
+
 /**
  * dpm_wait - Wait for a PM operation to complete.
  * @dev: Device to wait for.
  * @async: If unset, wait only if the device's power.async_suspend flag is set.
+ *
+ * Return true if the operation was still in progress.
  */
-static void dpm_wait(struct device *dev, bool async)
+static bool dpm_wait(struct device *dev, bool async)
 {
 	if (!dev)
-		return;
+		return false;
 
-	if (async || (pm_async_enabled && dev->power.async_suspend))
-		wait_for_completion(&dev->power.completion);
+	if (!async && !(pm_async_enabled && dev->power.async_suspend))
+		return false;
+
+	if (completion_done(&dev->power.completion))
+		return false;
+
+	wait_for_completion(&dev->power.completion);
+	return true;
 }
 
-static int dpm_wait_fn(struct device *dev, void *async_ptr)
+struct dpm_wait_data {
+	bool async;
+	struct device *blocker;		/* last device actually waited for */
+};
+
+static int dpm_wait_fn(struct device *dev, void *data)
 {
-	dpm_wait(dev, *((bool *)async_ptr));
+	struct dpm_wait_data *wd = data;
+
+	if (dpm_wait(dev, wd->async))
+		wd->blocker = dev;
 	return 0;
 }
 
-static void dpm_wait_for_children(struct device *dev, bool async)
+/* Wait for the devices that have to be suspended before @dev. */
+static struct device *dpm_wait_for_consumers(struct device *dev, bool async)
+{
+	struct dpm_wait_data wd = { .async = async };
+	struct dpm_link *link;
+
+	device_for_each_child(dev, &wd, dpm_wait_fn);
+	list_for_each_entry_rcu(link, &dpm_links, node)
+		if (link->supplier == dev)
+			dpm_wait_fn(link->consumer, &wd);
+
+	return wd.blocker;
+}
+
+/* Wait for the devices that have to be resumed before @dev. */
+static struct device *dpm_wait_for_suppliers(struct device *dev, bool async)
 {
-       device_for_each_child(dev, &async, dpm_wait_fn);
+	struct dpm_wait_data wd = { .async = async };
+	struct dpm_link *link;
+
+	dpm_wait_fn(dev->parent, &wd);
+	list_for_each_entry_rcu(link, &dpm_links, node)
+		if (link->consumer == dev)
+			dpm_wait_fn(link->supplier, &wd);
+
+	return wd.blocker;
 }
 
 /**
@@ -511,12 +604,15 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
  */
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready;
+	struct device *blocker;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
-	dpm_wait(dev->parent, async);
+	blocker = dpm_wait_for_suppliers(dev, async);
+	ready = ktime_get();
 	device_lock(dev);
 
 	/*
@@ -568,6 +664,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
  Unlock:
 	device_unlock(dev);
 	complete_all(&dev->power.completion);
+	suspend_time_dev(dev, blocker, async, start, ready);
 
 	TRACE_RESUME(error);
 	return error;
@@ -631,6 +728,7 @@ void dpm_resume(pm_message_t state)
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
+	suspend_time_dev_begin(true);
 
 	list_for_each_entry(dev, &dpm_suspended_list, power.entry) {
 		INIT_COMPLETION(dev->power.completion);
@@ -871,11 +969,14 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
  */
 static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready;
+	struct device *blocker;
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
 
-	dpm_wait_for_children(dev, async);
+	blocker = dpm_wait_for_consumers(dev, async);
+	ready = ktime_get();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -939,6 +1040,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	destroy_timer_on_stack(&timer);
 
 	complete_all(&dev->power.completion);
+	suspend_time_dev(dev, blocker, async, start, ready);
 
 	if (error)
 		async_error = error;
@@ -985,6 +1087,7 @@ int dpm_suspend(pm_message_t state)
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
+	suspend_time_dev_begin(false);
 	while (!list_empty(&dpm_prepared_list)) {
 		struct device *dev = to_device(dpm_prepared_list.prev);
 
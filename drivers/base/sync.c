@@ -18,6 +18,7 @@
 #include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
@@ -36,6 +37,11 @@ static DEFINE_SPINLOCK(sync_timeline_list_lock);
 static LIST_HEAD(sync_fence_list_head);
 static DEFINE_SPINLOCK(sync_fence_list_lock);
 
+/* merges, those that reused a fence, sync_pts not copied by merges */
+static atomic_t sync_merges = ATOMIC_INIT(0);
+static atomic_t sync_merges_reused = ATOMIC_INIT(0);
+static atomic_t sync_merge_pts_skipped = ATOMIC_INIT(0);
+
 struct sync_timeline *sync_timeline_create(const struct sync_timeline_ops *ops,
 					   int size, const char *name)
 {
@@ -180,6 +186,30 @@ void sync_pt_free(struct sync_pt *pt)
 	kfree(pt);
 }
 
+/*
+ * The time from a sync_pt being added to a fence to it signaling.
+ * Call with pt->parent->active_list_lock held.
+ */
+static void sync_timeline_account_signal(struct sync_pt *pt)
+{
+	struct sync_timeline *obj = pt->parent;
+	s64 ns;
+
+	if (!pt->activated.tv64)
+		return;
+
+	ns = ktime_to_ns(ktime_sub(pt->timestamp, pt->activated));
+	if (ns <= 0) {
+		obj->signaled_on_activate++;
+		return;
+	}
+
+	obj->signaled_pts++;
+	obj->signal_ns += ns;
+	if (ns > obj->max_signal_ns)
+		obj->max_signal_ns = ns;
+}
+
 /* call with pt->parent->active_list_lock held */
 static int _sync_pt_has_signaled(struct sync_pt *pt)
 {
@@ -191,8 +221,11 @@ static int _sync_pt_has_signaled(struct sync_pt *pt)
 	if (!pt->status && pt->parent->destroyed)
 		pt->status = -ENOENT;
 
-	if (pt->status != old_status)
+	if (pt->status != old_status) {
 		pt->timestamp = ktime_get();
+		if (pt->status > 0)
+			sync_timeline_account_signal(pt);
+	}
 
 	return pt->status;
 }
@@ -211,6 +244,7 @@ static void sync_pt_activate(struct sync_pt *pt)
 
 	spin_lock_irqsave(&obj->active_list_lock, flags);
 
+	pt->activated = ktime_get();
 	err = _sync_pt_has_signaled(pt);
 	if (err != 0)
 		goto out;
@@ -292,14 +326,75 @@ static int sync_fence_copy_pts(struct sync_fence *dst, struct sync_fence *src)
 	list_for_each(pos, &src->pt_list_head) {
 		struct sync_pt *orig_pt =
 			container_of(pos, struct sync_pt, pt_list);
-		struct sync_pt *new_pt = sync_pt_dup(orig_pt);
+		struct sync_pt *new_pt;
+
+		/* a signaled sync_pt changes nothing to the status */
+		if (orig_pt->status == 1) {
+			atomic_inc(&sync_merge_pts_skipped);
+			continue;
+		}
 
+		new_pt = sync_pt_dup(orig_pt);
 		if (new_pt == NULL)
 			return -ENOMEM;
 
 		new_pt->fence = dst;
 		list_add(&new_pt->pt_list, &dst->pt_list_head);
-		sync_pt_activate(new_pt);
+	}
+
+	return 0;
+}
+
+/*
+ * Like sync_fence_copy_pts(), but of two sync_pts on the same timeline
+ * only the one that signals last is kept.
+ */
+static int sync_fence_merge_pts(struct sync_fence *dst, struct sync_fence *src)
+{
+	struct list_head *src_pos, *dst_pos, *n;
+
+	list_for_each(src_pos, &src->pt_list_head) {
+		struct sync_pt *src_pt =
+			container_of(src_pos, struct sync_pt, pt_list);
+		bool collapsed = false;
+
+		if (src_pt->status == 1) {
+			atomic_inc(&sync_merge_pts_skipped);
+			continue;
+		}
+
+		list_for_each_safe(dst_pos, n, &dst->pt_list_head) {
+			struct sync_pt *dst_pt =
+				container_of(dst_pos, struct sync_pt, pt_list);
+
+			if (dst_pt->parent != src_pt->parent)
+				continue;
+
+			collapsed = true;
+			atomic_inc(&sync_merge_pts_skipped);
+			if (dst_pt->parent->ops->compare(dst_pt, src_pt) == -1) {
+				struct sync_pt *new_pt = sync_pt_dup(src_pt);
+
+				if (new_pt == NULL)
+					return -ENOMEM;
+
+				new_pt->fence = dst;
+				list_replace(&dst_pt->pt_list,
+					     &new_pt->pt_list);
+				sync_pt_free(dst_pt);
+			}
+			break;
+		}
+
+		if (!collapsed) {
+			struct sync_pt *new_pt = sync_pt_dup(src_pt);
+
+			if (new_pt == NULL)
+				return -ENOMEM;
+
+			new_pt->fence = dst;
+			list_add(&new_pt->pt_list, &dst->pt_list_head);
+		}
 	}
 
 	return 0;
@@ -366,8 +461,23 @@ struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b)
 {
 	struct sync_fence *fence;
+	struct list_head *pos;
 	int err;
 
+	atomic_inc(&sync_merges);
+
+	/* merging with a signaled fence gives the other one */
+	if (b->status == 1 || a == b) {
+		atomic_inc(&sync_merges_reused);
+		get_file(a->file);
+		return a;
+	}
+	if (a->status == 1) {
+		atomic_inc(&sync_merges_reused);
+		get_file(b->file);
+		return b;
+	}
+
 	fence = sync_fence_alloc(name);
 	if (fence == NULL)
 		return NULL;
@@ -376,10 +486,15 @@ struct sync_fence *sync_fence_merge(const char *name,
 	if (err < 0)
 		goto err;
 
-	err = sync_fence_copy_pts(fence, b);
+	err = sync_fence_merge_pts(fence, b);
 	if (err < 0)
 		goto err;
 
+	list_for_each(pos, &fence->pt_list_head) {
+		struct sync_pt *pt = container_of(pos, struct sync_pt, pt_list);
+		sync_pt_activate(pt);
+	}
+
 	fence->status = sync_fence_get_status(fence);
 
 	return fence;
@@ -437,6 +552,11 @@ int sync_fence_wait_async(struct sync_fence *fence,
 	unsigned long flags;
 	int err = 0;
 
+	/* status only ever changes from 0, no need for a waiter */
+	err = ACCESS_ONCE(fence->status);
+	if (err)
+		return err;
+
 	waiter = kzalloc(sizeof(struct sync_fence_waiter), GFP_KERNEL);
 	if (waiter == NULL)
 		return -ENOMEM;
@@ -702,6 +822,8 @@ static void sync_print_obj(struct seq_file *s, struct sync_timeline *obj)
 {
 	struct list_head *pos;
 	unsigned long flags;
+	unsigned long signaled_pts, signaled_on_activate;
+	u64 signal_ns, max_signal_ns;
 
 	seq_printf(s, "%s %s", obj->name, obj->ops->driver_name);
 
@@ -712,6 +834,21 @@ static void sync_print_obj(struct seq_file *s, struct sync_timeline *obj)
 
 	seq_printf(s, "\n");
 
+	spin_lock_irqsave(&obj->active_list_lock, flags);
+	signaled_pts = obj->signaled_pts;
+	signal_ns = obj->signal_ns;
+	max_signal_ns = obj->max_signal_ns;
+	signaled_on_activate = obj->signaled_on_activate;
+	spin_unlock_irqrestore(&obj->active_list_lock, flags);
+
+	seq_printf(s, "  signaled %lu avg %llu us max %llu us, "
+		   "%lu already when fenced\n", signaled_pts,
+		   signaled_pts ?
+			div64_u64(signal_ns,
+				  (u64)signaled_pts * NSEC_PER_USEC) : 0,
+		   div_u64(max_signal_ns, NSEC_PER_USEC),
+		   signaled_on_activate);
+
 	spin_lock_irqsave(&obj->child_list_lock, flags);
 	list_for_each(pos, &obj->child_list_head) {
 		struct sync_pt *pt =
@@ -751,6 +888,11 @@ static int sync_debugfs_show(struct seq_file *s, void *unused)
 	unsigned long flags;
 	struct list_head *pos;
 
+	seq_printf(s, "merges: %d, %d of a signaled fence, "
+		   "%d sync_pts not copied\n\n",
+		   atomic_read(&sync_merges), atomic_read(&sync_merges_reused),
+		   atomic_read(&sync_merge_pts_skipped));
+
 	seq_printf(s, "objs:\n--------------\n");
 
 	spin_lock_irqsave(&sync_timeline_list_lock, flags);
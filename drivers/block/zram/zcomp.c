@@ -8,6 +8,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/module.h>
 #include <linux/string.h>
 #include <linux/err.h>
 #include <linux/slab.h>
@@ -19,6 +20,9 @@
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 #include "zcomp_lz4.h"
 #endif
+#ifdef CONFIG_ZRAM_LZ4HC_COMPRESS
+#include "zcomp_lz4hc.h"
+#endif
 
 /*
  * single zcomp_strm backend
@@ -47,6 +51,9 @@ static struct zcomp_backend *backends[] = {
 	&zcomp_lzo,
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 	&zcomp_lz4,
+#endif
+#ifdef CONFIG_ZRAM_LZ4HC_COMPRESS
+	&zcomp_lz4hc,
 #endif
 	NULL
 };
@@ -285,6 +292,7 @@ ssize_t zcomp_available_show(const char *comp, char *buf)
 	sz += scnprintf(buf + sz, PAGE_SIZE - sz, "\n");
 	return sz;
 }
+EXPORT_SYMBOL_GPL(zcomp_available_show);
 
 bool zcomp_set_max_streams(struct zcomp *comp, int num_strm)
 {
@@ -295,11 +303,13 @@ struct zcomp_strm *zcomp_strm_find(struct zcomp *comp)
 {
 	return comp->strm_find(comp);
 }
+EXPORT_SYMBOL_GPL(zcomp_strm_find);
 
 void zcomp_strm_release(struct zcomp *comp, struct zcomp_strm *zstrm)
 {
 	comp->strm_release(comp, zstrm);
 }
+EXPORT_SYMBOL_GPL(zcomp_strm_release);
 
 int zcomp_compress(struct zcomp *comp, struct zcomp_strm *zstrm,
 		const unsigned char *src, size_t *dst_len)
@@ -307,18 +317,21 @@ int zcomp_compress(struct zcomp *comp, struct zcomp_strm *zstrm,
 	return comp->backend->compress(src, zstrm->buffer, dst_len,
 			zstrm->private);
 }
+EXPORT_SYMBOL_GPL(zcomp_compress);
 
 int zcomp_decompress(struct zcomp *comp, const unsigned char *src,
 		size_t src_len, unsigned char *dst)
 {
 	return comp->backend->decompress(src, src_len, dst);
 }
+EXPORT_SYMBOL_GPL(zcomp_decompress);
 
 void zcomp_destroy(struct zcomp *comp)
 {
 	comp->destroy(comp);
 	kfree(comp);
 }
+EXPORT_SYMBOL_GPL(zcomp_destroy);
 
 /*
  * search available compressors for requested algorithm.
@@ -351,3 +364,4 @@ struct zcomp *zcomp_create(const char *compress, int max_strm)
 	}
 	return comp;
 }
+EXPORT_SYMBOL_GPL(zcomp_create);
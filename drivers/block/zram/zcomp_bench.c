@@ -0,0 +1,269 @@
+/*
+ * zcomp backend benchmark
+ *
+ * Compresses and decompresses a set of pages of each content type with
+ * every backend zram was built with, and logs one line per result:
+ *
+ *   zcomp_bench: backend=lzo content=text comp_mbs=... decomp_mbs=...
+ *                ratio_pct=...
+ *
+ * The pages are made from a fixed seed, so that the numbers of two
+ * kernels can be compared.  Pages compressing to more than zram's
+ * max_zpage_size are copied instead of decompressed, as zram does.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/err.h>
+
+#include "zcomp.h"
+#include "zram_drv.h"
+
+#define BENCH_PAGES	64
+#define BENCH_SEED	0x7a636f6d
+
+static char *backends;
+module_param(backends, charp, 0444);
+MODULE_PARM_DESC(backends, "Comma separated backends to run (default all)");
+
+static unsigned int msecs = 200;
+module_param(msecs, uint, 0444);
+MODULE_PARM_DESC(msecs, "Time spent on each measurement");
+
+static const char * const words[] = {
+	"the", "binder", "of", "surface", "and", "to", "activity", "a",
+	"window", "in", "view", "is", "layout", "for", "service", "with",
+};
+
+static void fill_zero(u8 *page, struct rnd_state *rnd)
+{
+	memset(page, 0, PAGE_SIZE);
+}
+
+static void fill_text(u8 *page, struct rnd_state *rnd)
+{
+	const char *w;
+	size_t off = 0, len;
+
+	while (off < PAGE_SIZE) {
+		w = words[prandom32(rnd) % ARRAY_SIZE(words)];
+		len = min(strlen(w), PAGE_SIZE - off);
+		memcpy(page + off, w, len);
+		off += len;
+		if (off < PAGE_SIZE)
+			page[off++] = ' ';
+	}
+}
+
+static void fill_random(u8 *page, struct rnd_state *rnd)
+{
+	u32 *p = (u32 *)page;
+	int i;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(u32); i++)
+		p[i] = prandom32(rnd);
+}
+
+/* what an app heap looks like: small values and pointers among zeroes */
+static void fill_heap(u8 *page, struct rnd_state *rnd)
+{
+	u32 *p = (u32 *)page;
+	u32 r;
+	int i;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(u32); i++) {
+		r = prandom32(rnd);
+		if (r & 1)
+			p[i] = 0;
+		else if (r & 2)
+			p[i] = (r >> 8) & 0xff;
+		else
+			p[i] = 0x40000000 | ((r >> 4) & 0xfffff0);
+	}
+}
+
+static const struct {
+	const char *name;
+	void (*fill)(u8 *page, struct rnd_state *rnd);
+} contents[] = {
+	{ "zero", fill_zero },
+	{ "text", fill_text },
+	{ "heap", fill_heap },
+	{ "random", fill_random },
+};
+
+struct bench_buf {
+	u8 *src;			/* BENCH_PAGES pages */
+	u8 *comp;			/* 2 pages per source page */
+	size_t clen[BENCH_PAGES];
+	u8 *dst;
+};
+
+/* bytes per ns * 1000 is MB/s */
+static unsigned int bench_mbs(u64 bytes, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ns ? div64_u64(bytes * 1000, ns) : 0;
+}
+
+static bool bench_expired(ktime_t start)
+{
+	return ktime_to_ns(ktime_sub(ktime_get(), start)) >=
+	       (s64)msecs * NSEC_PER_MSEC;
+}
+
+static int bench_one(const char *backend, const char *content,
+		     struct bench_buf *b)
+{
+	unsigned int comp_mbs, decomp_mbs;
+	struct zcomp_strm *zstrm;
+	struct zcomp *comp;
+	u64 bytes, csize = 0;
+	ktime_t start;
+	size_t clen;
+	int i, ret = 0;
+
+	comp = zcomp_create(backend, 1);
+	if (IS_ERR(comp))
+		return PTR_ERR(comp);
+	zstrm = zcomp_strm_find(comp);
+
+	/* keep a copy of each page for the decompression pass */
+	for (i = 0; i < BENCH_PAGES; i++) {
+		ret = zcomp_compress(comp, zstrm, b->src + i * PAGE_SIZE,
+				     &b->clen[i]);
+		if (ret)
+			goto out;
+		memcpy(b->comp + i * 2 * PAGE_SIZE, zstrm->buffer, b->clen[i]);
+		csize += b->clen[i] > max_zpage_size ? PAGE_SIZE : b->clen[i];
+	}
+
+	bytes = 0;
+	start = ktime_get();
+	do {
+		for (i = 0; i < BENCH_PAGES; i++)
+			zcomp_compress(comp, zstrm, b->src + i * PAGE_SIZE,
+				       &clen);
+		bytes += BENCH_PAGES * PAGE_SIZE;
+	} while (!bench_expired(start));
+	comp_mbs = bench_mbs(bytes, start);
+
+	for (i = 0; i < BENCH_PAGES; i++) {
+		if (b->clen[i] > max_zpage_size)
+			continue;
+		ret = zcomp_decompress(comp, b->comp + i * 2 * PAGE_SIZE,
+				       b->clen[i], b->dst);
+		if (ret || memcmp(b->dst, b->src + i * PAGE_SIZE, PAGE_SIZE)) {
+			pr_err("zcomp_bench: %s: %s page %d does not decompress\n",
+			       backend, content, i);
+			ret = -EIO;
+			goto out;
+		}
+	}
+
+	bytes = 0;
+	start = ktime_get();
+	do {
+		for (i = 0; i < BENCH_PAGES; i++) {
+			if (b->clen[i] > max_zpage_size)
+				memcpy(b->dst, b->src + i * PAGE_SIZE,
+				       PAGE_SIZE);
+			else
+				zcomp_decompress(comp,
+						 b->comp + i * 2 * PAGE_SIZE,
+						 b->clen[i], b->dst);
+		}
+		bytes += BENCH_PAGES * PAGE_SIZE;
+	} while (!bench_expired(start));
+	decomp_mbs = bench_mbs(bytes, start);
+
+	pr_info("zcomp_bench: backend=%s content=%s comp_mbs=%u "
+		"decomp_mbs=%u ratio_pct=%u\n", backend, content, comp_mbs,
+		decomp_mbs, (unsigned int)div64_u64(csize * 100,
+					BENCH_PAGES * PAGE_SIZE));
+out:
+	zcomp_strm_release(comp, zstrm);
+	zcomp_destroy(comp);
+	return ret;
+}
+
+static bool backend_wanted(const char *name)
+{
+	const char *p = backends;
+	size_t len = strlen(name);
+
+	if (!p || !*p)
+		return true;
+
+	while ((p = strstr(p, name))) {
+		if ((p == backends || p[-1] == ',') &&
+		    (p[len] == ',' || p[len] == '\0'))
+			return true;
+		p += len;
+	}
+	return false;
+}
+
+static int __init zcomp_bench_init(void)
+{
+	struct rnd_state rnd;
+	struct bench_buf b;
+	char *names, *p, *name;
+	int c, i, ret = -ENOMEM;
+
+	names = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	b.src = vmalloc(BENCH_PAGES * PAGE_SIZE);
+	b.comp = vmalloc(BENCH_PAGES * 2 * PAGE_SIZE);
+	b.dst = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!names || !b.src || !b.comp || !b.dst)
+		goto out;
+
+	/* no backend is the current one, so none of them is bracketed */
+	zcomp_available_show("", names);
+
+	for (c = 0; c < ARRAY_SIZE(contents); c++) {
+		prandom32_seed(&rnd, BENCH_SEED);
+		for (i = 0; i < BENCH_PAGES; i++)
+			contents[c].fill(b.src + i * PAGE_SIZE, &rnd);
+
+		for (p = names; (name = strsep(&p, " \n")); ) {
+			if (!*name || !backend_wanted(name))
+				continue;
+			ret = bench_one(name, contents[c].name, &b);
+			if (ret)
+				goto out;
+		}
+		/* strsep() cut the list up */
+		zcomp_available_show("", names);
+	}
+
+	/*
+	 * As tcrypt does, fail on purpose so that the module does not
+	 * stay loaded, and can be inserted again right away.
+	 */
+	ret = -EAGAIN;
+out:
+	kfree(b.dst);
+	vfree(b.comp);
+	vfree(b.src);
+	kfree(names);
+	return ret;
+}
+
+module_init(zcomp_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("zram compression backend benchmark");
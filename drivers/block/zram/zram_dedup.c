@@ -0,0 +1,137 @@
+/*
+ * Same page deduplication for zram
+ *
+ * Every zsmalloc object of a device running with use_dedup is tracked by
+ * a refcounted zram_entry, kept in a per-device rbtree ordered by the
+ * crc32 of the uncompressed page. A page whose checksum and content match
+ * an existing object just takes another reference to it.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/rbtree.h>
+#include <linux/crc32.h>
+
+#include "zram_drv.h"
+#include "zram_dedup.h"
+
+u32 zram_dedup_checksum(unsigned char *mem)
+{
+	return crc32_le(0, mem, PAGE_SIZE);
+}
+
+/* content check, the checksum alone is not collision free */
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+				unsigned char *mem, unsigned char *buf)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned char *cmem;
+	bool match = false;
+
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE)
+		match = !memcmp(mem, cmem, PAGE_SIZE);
+	else if (!zcomp_decompress(zram->comp, cmem, entry->len, buf))
+		match = !memcmp(mem, buf, PAGE_SIZE);
+	zs_unmap_object(meta->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look up an object holding the same content as @mem. On success a new
+ * reference is taken on the returned entry. @buf is PAGE_SIZE scratch
+ * space for decompression.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, unsigned char *mem,
+				u32 checksum, unsigned char *buf)
+{
+	struct zram_meta *meta = zram->meta;
+	struct rb_node *node;
+	struct zram_entry *entry;
+
+	spin_lock(&meta->dedup_lock);
+	node = meta->dedup_root.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct zram_entry, rb_node);
+		if (checksum == entry->checksum) {
+			entry->refcount++;
+			spin_unlock(&meta->dedup_lock);
+
+			if (zram_dedup_match(zram, entry, mem, buf))
+				return entry;
+
+			/* collisions are rare, don't bother walking them */
+			zram_dedup_put(zram, entry);
+			return NULL;
+		}
+		node = checksum < entry->checksum ?
+			node->rb_left : node->rb_right;
+	}
+	spin_unlock(&meta->dedup_lock);
+
+	return NULL;
+}
+
+/* Track a freshly stored object, returns it with one reference held */
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				size_t len, u32 checksum)
+{
+	struct zram_meta *meta = zram->meta;
+	struct rb_node **rb_node, *parent = NULL;
+	struct zram_entry *entry, *cur;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+
+	spin_lock(&meta->dedup_lock);
+	rb_node = &meta->dedup_root.rb_node;
+	while (*rb_node) {
+		parent = *rb_node;
+		cur = rb_entry(parent, struct zram_entry, rb_node);
+		if (checksum < cur->checksum)
+			rb_node = &parent->rb_left;
+		else
+			rb_node = &parent->rb_right;
+	}
+	rb_link_node(&entry->rb_node, parent, rb_node);
+	rb_insert_color(&entry->rb_node, &meta->dedup_root);
+	spin_unlock(&meta->dedup_lock);
+
+	return entry;
+}
+
+/*
+ * Drop a reference, freeing the object with the last one. Returns true
+ * if other slots still share the object.
+ */
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned long refcount;
+
+	spin_lock(&meta->dedup_lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &meta->dedup_root);
+	spin_unlock(&meta->dedup_lock);
+
+	if (refcount)
+		return true;
+
+	zs_free(meta->mem_pool, entry->handle);
+	kfree(entry);
+	return false;
+}
@@ -0,0 +1,42 @@
+/*
+ * Same page deduplication for zram
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+struct zram_entry;
+
+#ifdef CONFIG_ZRAM_DEDUP
+u32 zram_dedup_checksum(unsigned char *mem);
+struct zram_entry *zram_dedup_find(struct zram *zram, unsigned char *mem,
+				u32 checksum, unsigned char *buf);
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				size_t len, u32 checksum);
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+#else
+static inline u32 zram_dedup_checksum(unsigned char *mem) { return 0; }
+static inline struct zram_entry *zram_dedup_find(struct zram *zram,
+		unsigned char *mem, u32 checksum, unsigned char *buf)
+{
+	return NULL;
+}
+static inline struct zram_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, size_t len, u32 checksum)
+{
+	return NULL;
+}
+static inline bool zram_dedup_put(struct zram *zram,
+		struct zram_entry *entry)
+{
+	return false;
+}
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
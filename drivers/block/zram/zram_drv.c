@@ -34,12 +34,16 @@
 #include <linux/vmalloc.h>
 #include <linux/ratelimit.h>
 #include <linux/err.h>
+#include <linux/workqueue.h>
+#include <linux/cpumask.h>
 
 #include "zram_drv.h"
+#include "zram_dedup.h"
 
 /* Globals */
 static int zram_major;
 static struct zram *zram_devices;
+static struct workqueue_struct *zram_comp_wq;
 static const char *default_compressor = "lzo";
 
 /*
@@ -117,6 +121,40 @@ static ssize_t mem_used_total_show(struct device *dev,
 	return scnprintf(buf, PAGE_SIZE, "%llu\n", val << PAGE_SHIFT);
 }
 
+static ssize_t pages_compacted_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zs_pool_stats pool_stats = { 0 };
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta = zram->meta;
+
+	down_read(&zram->init_lock);
+	if (init_done(zram))
+		zs_pool_stats(meta->mem_pool, &pool_stats);
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", pool_stats.pages_compacted);
+}
+
+static ssize_t compact_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	meta = zram->meta;
+	zs_compact(meta->mem_pool);
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
 static ssize_t max_comp_streams_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -159,6 +197,60 @@ out:
 	return ret;
 }
 
+static ssize_t async_comp_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", zram->async_comp);
+}
+
+static ssize_t async_comp_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtoint(buf, 10, &val) || (val != 0 && val != 1))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	zram->async_comp = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t swap_readahead_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n",
+			 !blk_queue_no_swap_ra(zram->disk->queue));
+}
+
+/* every page swap reads ahead in vain is a decompression wasted */
+static ssize_t swap_readahead_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+	struct request_queue *q = zram->disk->queue;
+
+	if (kstrtoint(buf, 10, &val) || (val != 0 && val != 1))
+		return -EINVAL;
+
+	spin_lock_irq(q->queue_lock);
+	if (val)
+		queue_flag_clear(QUEUE_FLAG_NO_SWAP_RA, q);
+	else
+		queue_flag_set(QUEUE_FLAG_NO_SWAP_RA, q);
+	spin_unlock_irq(q->queue_lock);
+
+	return len;
+}
+
 static ssize_t comp_algorithm_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -187,6 +279,74 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtoint(buf, 10, &val) || (val != 0 && val != 1))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_compressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+	/* "none" disables recompression */
+	if (sysfs_streq(buf, "none"))
+		zram->recomp_compressor[0] = 0x00;
+	else
+		strlcpy(zram->recomp_compressor, buf,
+				sizeof(zram->recomp_compressor));
+	up_write(&zram->init_lock);
+	return len;
+}
+
 /* flag operations needs meta->tb_lock */
 static int zram_test_flag(struct zram_meta *meta, u32 index,
 			enum zram_pageflags flag)
@@ -219,11 +379,422 @@ static void zram_set_obj_size(struct zram_meta *meta,
 	meta->table[index].value = (flags << ZRAM_FLAG_SHIFT) | size;
 }
 
+/*
+ * Called on every read and write of a slot, under its ZRAM_ACCESS lock:
+ * drops the idle mark and records the access time.
+ */
+static void zram_accessed(struct zram *zram, u32 index)
+{
+	struct zram_meta *meta = zram->meta;
+
+	if (zram_test_flag(meta, index, ZRAM_IDLE)) {
+		zram_clear_flag(meta, index, ZRAM_IDLE);
+		atomic64_dec(&zram->stats.idle_pages);
+	}
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	meta->table[index].ac_time = jiffies;
+#endif
+}
+
+static inline bool zram_dedup_enabled(struct zram *zram)
+{
+#ifdef CONFIG_ZRAM_DEDUP
+	return zram->use_dedup;
+#else
+	return false;
+#endif
+}
+
+/* zsmalloc handle of a slot which is not ZRAM_WB, needs the slot lock */
+static unsigned long zram_get_handle(struct zram *zram, u32 index)
+{
+	struct zram_meta *meta = zram->meta;
+
+	if (zram_dedup_enabled(zram))
+		return meta->table[index].entry ?
+			meta->table[index].entry->handle : 0;
+	return meta->table[index].handle;
+}
+
+static inline bool zram_slot_allocated(struct zram_meta *meta, u32 index)
+{
+	return meta->table[index].handle ||
+		zram_test_flag(meta, index, ZRAM_SAME);
+}
+
 static inline int is_partial_io(struct bio_vec *bvec)
 {
 	return bvec->bv_len != PAGE_SIZE;
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+static inline bool zram_wb_enabled(struct zram *zram)
+{
+	return zram->backing_dev != NULL;
+}
+
+static void reset_bdev(struct zram *zram)
+{
+	if (!zram_wb_enabled(zram))
+		return;
+
+	blkdev_put(zram->bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	filp_close(zram->backing_dev, NULL);
+	zram->backing_dev = NULL;
+	zram->bdev = NULL;
+
+	vfree(zram->bitmap);
+	zram->bitmap = NULL;
+	zram->nr_pages = 0;
+}
+
+static ssize_t backing_dev_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char *p;
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	if (!zram_wb_enabled(zram)) {
+		up_read(&zram->init_lock);
+		return scnprintf(buf, PAGE_SIZE, "none\n");
+	}
+
+	p = d_path(&zram->backing_dev->f_path, buf, PAGE_SIZE - 1);
+	if (IS_ERR(p)) {
+		ret = PTR_ERR(p);
+	} else {
+		ret = strlen(p);
+		memmove(buf, p, ret);
+		buf[ret++] = '\n';
+	}
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
+static ssize_t backing_dev_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	char *file_name;
+	size_t sz;
+	struct file *backing_dev = NULL;
+	struct inode *inode;
+	struct block_device *bdev = NULL;
+	unsigned long nr_pages, *bitmap = NULL;
+	struct zram *zram = dev_to_zram(dev);
+	int err;
+
+	file_name = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!file_name)
+		return -ENOMEM;
+
+	strlcpy(file_name, buf, PATH_MAX);
+	/* ignore trailing newline */
+	sz = strlen(file_name);
+	if (sz > 0 && file_name[sz - 1] == '\n')
+		file_name[sz - 1] = 0x00;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		pr_info("Can't setup backing device for initialized device\n");
+		err = -EBUSY;
+		goto out;
+	}
+
+	backing_dev = filp_open(file_name, O_RDWR | O_LARGEFILE, 0);
+	if (IS_ERR(backing_dev)) {
+		err = PTR_ERR(backing_dev);
+		backing_dev = NULL;
+		goto out;
+	}
+
+	inode = backing_dev->f_mapping->host;
+	/* Support only block device in this moment */
+	if (!S_ISBLK(inode->i_mode)) {
+		err = -ENOTBLK;
+		goto out;
+	}
+
+	bdev = bdgrab(I_BDEV(inode));
+	err = blkdev_get(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL, zram);
+	if (err < 0) {
+		/* blkdev_get() drops the bdev reference on failure */
+		bdev = NULL;
+		goto out;
+	}
+
+	nr_pages = i_size_read(inode) >> PAGE_SHIFT;
+	if (nr_pages < 2) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	bitmap = vzalloc(BITS_TO_LONGS(nr_pages) * sizeof(long));
+	if (!bitmap) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	err = set_blocksize(bdev, PAGE_SIZE);
+	if (err)
+		goto out;
+
+	zram->bdev = bdev;
+	zram->backing_dev = backing_dev;
+	zram->bitmap = bitmap;
+	zram->nr_pages = nr_pages;
+	up_write(&zram->init_lock);
+
+	pr_info("setup backing device %s\n", file_name);
+	kfree(file_name);
+
+	return len;
+out:
+	vfree(bitmap);
+	if (bdev)
+		blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	if (backing_dev)
+		filp_close(backing_dev, NULL);
+	up_write(&zram->init_lock);
+	kfree(file_name);
+
+	return err;
+}
+
+static unsigned long alloc_block_bdev(struct zram *zram)
+{
+	unsigned long blk_idx = 1;
+retry:
+	/* skip bit 0 so that a valid entry is never confused with handle 0 */
+	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_pages, blk_idx);
+	if (blk_idx == zram->nr_pages)
+		return 0;
+
+	if (test_and_set_bit(blk_idx, zram->bitmap))
+		goto retry;
+
+	atomic64_inc(&zram->stats.bd_count);
+	return blk_idx;
+}
+
+static void free_block_bdev(struct zram *zram, unsigned long blk_idx)
+{
+	int was_set;
+
+	was_set = test_and_clear_bit(blk_idx, zram->bitmap);
+	WARN_ON_ONCE(!was_set);
+	atomic64_dec(&zram->stats.bd_count);
+}
+
+struct zram_bdev_io {
+	struct completion done;
+	int error;
+};
+
+static void zram_bdev_end_io(struct bio *bio, int err)
+{
+	struct zram_bdev_io *io = bio->bi_private;
+
+	if (!test_bit(BIO_UPTODATE, &bio->bi_flags) && !err)
+		err = -EIO;
+	io->error = err;
+	complete(&io->done);
+}
+
+/* synchronous single page I/O against the backing device */
+static int __zram_bdev_rw(struct zram *zram, struct page *page,
+			  unsigned long entry, int rw)
+{
+	struct zram_bdev_io io;
+	struct bio *bio;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = entry * SECTORS_PER_PAGE;
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+
+	init_completion(&io.done);
+	io.error = 0;
+	bio->bi_private = &io;
+	bio->bi_end_io = zram_bdev_end_io;
+	submit_bio(rw == READ ? READ_SYNC : WRITE_SYNC, bio);
+	wait_for_completion(&io.done);
+	bio_put(bio);
+
+	if (rw == READ)
+		atomic64_inc(&zram->stats.bd_reads);
+	else
+		atomic64_inc(&zram->stats.bd_writes);
+
+	return io.error;
+}
+
+/*
+ * Backing device I/O issued from zram_make_request(), that is on behalf
+ * of swap-out and swap-in, hence WQ_MEM_RECLAIM.
+ */
+static struct workqueue_struct *zram_bdev_wq;
+
+struct zram_bdev_work {
+	struct work_struct work;
+	struct zram *zram;
+	struct page *page;
+	unsigned long entry;
+	int rw;
+	int error;
+};
+
+static void zram_bdev_work_fn(struct work_struct *work)
+{
+	struct zram_bdev_work *w = container_of(work, struct zram_bdev_work,
+						work);
+
+	w->error = __zram_bdev_rw(w->zram, w->page, w->entry, w->rw);
+}
+
+/*
+ * From zram_make_request() current->bio_list is active, so a bio
+ * submitted here would only be queued until we return and waiting for
+ * it would never end: have a worker submit and wait for it instead.
+ */
+static int zram_bdev_rw(struct zram *zram, struct page *page,
+			unsigned long entry, int rw)
+{
+	struct zram_bdev_work w;
+
+	if (!current->bio_list)
+		return __zram_bdev_rw(zram, page, entry, rw);
+
+	w.zram = zram;
+	w.page = page;
+	w.entry = entry;
+	w.rw = rw;
+	INIT_WORK_ONSTACK(&w.work, zram_bdev_work_fn);
+	queue_work(zram_bdev_wq, &w.work);
+	flush_work(&w.work);
+	destroy_work_on_stack(&w.work);
+
+	return w.error;
+}
+
+static int __init zram_bdev_init(void)
+{
+	zram_bdev_wq = alloc_workqueue("zram_bdev",
+			WQ_MEM_RECLAIM | WQ_UNBOUND, 0);
+	return zram_bdev_wq ? 0 : -ENOMEM;
+}
+
+static void zram_bdev_exit(void)
+{
+	destroy_workqueue(zram_bdev_wq);
+}
+
+/*
+ * Read a written back slot into @page. Returns -EAGAIN if the slot
+ * is not (or no longer) stored on the backing device.
+ */
+static int read_from_bdev(struct zram *zram, struct page *page, u32 index)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned long entry = 0;
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		entry = meta->table[index].handle;
+		zram_accessed(zram, index);
+	}
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	if (!entry)
+		return -EAGAIN;
+
+	return zram_bdev_rw(zram, page, entry, READ);
+}
+
+static int read_from_bdev_mem(struct zram *zram, char *mem, u32 index)
+{
+	struct page *page;
+	void *src;
+	int ret;
+
+	page = alloc_page(GFP_NOIO);
+	if (!page)
+		return -ENOMEM;
+
+	ret = read_from_bdev(zram, page, index);
+	if (!ret) {
+		src = kmap_atomic(page);
+		memcpy(mem, src, PAGE_SIZE);
+		kunmap_atomic(src);
+	}
+	__free_page(page);
+
+	return ret;
+}
+
+static void zram_free_page(struct zram *zram, size_t index);
+
+/*
+ * Store a full incompressible page straight on the backing device
+ * instead of wasting a PAGE_SIZE zsmalloc object on it.
+ */
+static int write_to_bdev(struct zram *zram, struct page *page, u32 index)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned long entry;
+	int ret;
+
+	entry = alloc_block_bdev(zram);
+	if (!entry)
+		return -ENOSPC;
+
+	ret = zram_bdev_rw(zram, page, entry, WRITE);
+	if (ret) {
+		free_block_bdev(zram, entry);
+		return ret;
+	}
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	zram_free_page(zram, index);
+	meta->table[index].handle = entry;
+	zram_set_flag(meta, index, ZRAM_WB);
+	zram_accessed(zram, index);
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	atomic64_inc(&zram->stats.pages_stored);
+	return 0;
+}
+#else
+static inline bool zram_wb_enabled(struct zram *zram) { return false; }
+static inline void reset_bdev(struct zram *zram) {}
+static inline void free_block_bdev(struct zram *zram, unsigned long blk_idx) {}
+static inline int zram_bdev_init(void) { return 0; }
+static inline void zram_bdev_exit(void) {}
+
+static int read_from_bdev(struct zram *zram, struct page *page, u32 index)
+{
+	return -EIO;
+}
+
+static int read_from_bdev_mem(struct zram *zram, char *mem, u32 index)
+{
+	return -EIO;
+}
+
+static int write_to_bdev(struct zram *zram, struct page *page, u32 index)
+{
+	return -EIO;
+}
+#endif
+
 /*
  * Check if request is within bounds and aligned on zram logical blocks.
  */
@@ -255,7 +826,7 @@ static void zram_meta_free(struct zram_meta *meta)
 	kfree(meta);
 }
 
-static struct zram_meta *zram_meta_alloc(u64 disksize)
+static struct zram_meta *zram_meta_alloc(char *pool_name, u64 disksize)
 {
 	size_t num_pages;
 	struct zram_meta *meta = kmalloc(sizeof(*meta), GFP_KERNEL);
@@ -269,12 +840,16 @@ static struct zram_meta *zram_meta_alloc(u64 disksize)
 		goto free_meta;
 	}
 
-	meta->mem_pool = zs_create_pool(GFP_NOIO | __GFP_HIGHMEM |
+	meta->mem_pool = zs_create_pool(pool_name, GFP_NOIO | __GFP_HIGHMEM |
 					__GFP_NOWARN);
 	if (!meta->mem_pool) {
 		pr_err("Error creating memory pool\n");
 		goto free_table;
 	}
+#ifdef CONFIG_ZRAM_DEDUP
+	meta->dedup_root = RB_ROOT;
+	spin_lock_init(&meta->dedup_lock);
+#endif
 
 	return meta;
 
@@ -294,31 +869,61 @@ static void update_position(u32 *index, int *offset, struct bio_vec *bvec)
 	*offset = (*offset + bvec->bv_len) % PAGE_SIZE;
 }
 
-static int page_zero_filled(void *ptr)
+/*
+ * Check whether the page is filled with one repeated word and return that
+ * word in @element. The last word is tested first, since a page which is
+ * not same-filled usually differs there already.
+ */
+static bool page_same_filled(void *ptr, unsigned long *element)
 {
-	unsigned int pos;
+	unsigned int pos, last_pos = PAGE_SIZE / sizeof(unsigned long) - 1;
 	unsigned long *page;
+	unsigned long val;
 
 	page = (unsigned long *)ptr;
+	val = page[0];
+
+	if (val != page[last_pos])
+		return false;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
-			return 0;
+	for (pos = 1; pos < last_pos; pos++) {
+		if (val != page[pos])
+			return false;
 	}
 
-	return 1;
+	*element = val;
+	return true;
+}
+
+static void zram_fill_page(void *ptr, unsigned long len,
+					unsigned long value)
+{
+	unsigned long *page = ptr;
+	unsigned long i;
+
+	WARN_ON_ONCE(!IS_ALIGNED(len, sizeof(unsigned long)));
+
+	if (likely(value == 0)) {
+		memset(ptr, 0, len);
+	} else {
+		for (i = 0; i < len / sizeof(*page); i++)
+			page[i] = value;
+	}
 }
 
-static void handle_zero_page(struct bio_vec *bvec)
+static void handle_same_page(struct bio_vec *bvec, unsigned long element)
 {
 	struct page *page = bvec->bv_page;
 	void *user_mem;
 
 	user_mem = kmap_atomic(page);
 	if (is_partial_io(bvec))
-		memset(user_mem + bvec->bv_offset, 0, bvec->bv_len);
-	else
+		zram_fill_page(user_mem + bvec->bv_offset, bvec->bv_len,
+				element);
+	else if (!element)
 		clear_page(user_mem);
+	else
+		zram_fill_page(user_mem, PAGE_SIZE, element);
 	kunmap_atomic(user_mem);
 
 	flush_dcache_page(page);
@@ -334,23 +939,55 @@ static void zram_free_page(struct zram *zram, size_t index)
 {
 	struct zram_meta *meta = zram->meta;
 	unsigned long handle = meta->table[index].handle;
+	bool shared = false;
 
-	if (unlikely(!handle)) {
-		/*
-		 * No memory is allocated for zero filled pages.
-		 * Simply clear zero page flag.
-		 */
-		if (zram_test_flag(meta, index, ZRAM_ZERO)) {
-			zram_clear_flag(meta, index, ZRAM_ZERO);
+	zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+	if (zram_test_flag(meta, index, ZRAM_IDLE)) {
+		zram_clear_flag(meta, index, ZRAM_IDLE);
+		atomic64_dec(&zram->stats.idle_pages);
+	}
+
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		zram_clear_flag(meta, index, ZRAM_WB);
+		free_block_bdev(zram, handle);
+		meta->table[index].handle = 0;
+		atomic64_dec(&zram->stats.pages_stored);
+		return;
+	}
+
+	/*
+	 * No memory is allocated for same element filled pages.
+	 * Simply clear same page flag.
+	 */
+	if (zram_test_flag(meta, index, ZRAM_SAME)) {
+		zram_clear_flag(meta, index, ZRAM_SAME);
+		if (!meta->table[index].element)
 			atomic64_dec(&zram->stats.zero_pages);
-		}
+		atomic64_dec(&zram->stats.same_pages);
+		meta->table[index].element = 0;
 		return;
 	}
 
-	zs_free(meta->mem_pool, handle);
+	if (unlikely(!handle))
+		return;
+
+	if (zram_dedup_enabled(zram))
+		shared = zram_dedup_put(zram, meta->table[index].entry);
+	else
+		zs_free(meta->mem_pool, handle);
+
+	if (zram_test_flag(meta, index, ZRAM_HUGE)) {
+		zram_clear_flag(meta, index, ZRAM_HUGE);
+		atomic64_dec(&zram->stats.huge_pages);
+	}
+	zram_clear_flag(meta, index, ZRAM_RECOMP);
 
-	atomic64_sub(zram_get_obj_size(meta, index),
-			&zram->stats.compr_data_size);
+	if (shared)
+		atomic64_sub(zram_get_obj_size(meta, index),
+				&zram->stats.dup_data_size);
+	else
+		atomic64_sub(zram_get_obj_size(meta, index),
+				&zram->stats.compr_data_size);
 	atomic64_dec(&zram->stats.pages_stored);
 
 	meta->table[index].handle = 0;
@@ -366,10 +1003,25 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	size_t size;
 
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
-	handle = meta->table[index].handle;
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		/* caller has to fetch it from the backing device */
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return -EAGAIN;
+	}
+
+	if (zram_test_flag(meta, index, ZRAM_SAME)) {
+		unsigned long element = meta->table[index].element;
+
+		zram_accessed(zram, index);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		zram_fill_page(mem, PAGE_SIZE, element);
+		return 0;
+	}
+
+	handle = zram_get_handle(zram, index);
 	size = zram_get_obj_size(meta, index);
 
-	if (!handle || zram_test_flag(meta, index, ZRAM_ZERO)) {
+	if (!handle) {
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 		clear_page(mem);
 		return 0;
@@ -378,9 +1030,12 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE)
 		copy_page(mem, cmem);
+	else if (zram_test_flag(meta, index, ZRAM_RECOMP))
+		ret = zcomp_decompress(zram->recomp, cmem, size, mem);
 	else
 		ret = zcomp_decompress(zram->comp, cmem, size, mem);
 	zs_unmap_object(meta->mem_pool, handle);
+	zram_accessed(zram, index);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
 	/* Should NEVER happen. Return bio error if it does. */
@@ -392,6 +1047,21 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	return 0;
 }
 
+/* like zram_decompress_page(), but may sleep to read the backing device */
+static int zram_read_page(struct zram *zram, char *mem, u32 index)
+{
+	int ret = zram_decompress_page(zram, mem, index);
+
+	if (ret == -EAGAIN) {
+		ret = read_from_bdev_mem(zram, mem, index);
+		/* slot was rewritten meanwhile */
+		if (ret == -EAGAIN)
+			ret = zram_decompress_page(zram, mem, index);
+	}
+
+	return ret;
+}
+
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 			  u32 index, int offset, struct bio *bio)
 {
@@ -402,44 +1072,59 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	page = bvec->bv_page;
 
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
-	if (unlikely(!meta->table[index].handle) ||
-			zram_test_flag(meta, index, ZRAM_ZERO)) {
+	if (zram_test_flag(meta, index, ZRAM_SAME)) {
+		unsigned long element = meta->table[index].element;
+
+		zram_accessed(zram, index);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		handle_same_page(bvec, element);
+		return 0;
+	}
+	if (unlikely(!meta->table[index].handle)) {
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
-		handle_zero_page(bvec);
+		handle_same_page(bvec, 0);
 		return 0;
 	}
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
-	if (is_partial_io(bvec))
+	if (is_partial_io(bvec)) {
 		/* Use  a temporary buffer to decompress the page */
 		uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
+		if (!uncmem) {
+			pr_info("Unable to allocate temp memory\n");
+			return -ENOMEM;
+		}
 
-	user_mem = kmap_atomic(page);
-	if (!is_partial_io(bvec))
-		uncmem = user_mem;
+		ret = zram_read_page(zram, uncmem, index);
+		if (likely(!ret)) {
+			user_mem = kmap_atomic(page);
+			memcpy(user_mem + bvec->bv_offset, uncmem + offset,
+					bvec->bv_len);
+			kunmap_atomic(user_mem);
+		}
+		kfree(uncmem);
+	} else {
+		user_mem = kmap_atomic(page);
+		ret = zram_decompress_page(zram, user_mem, index);
+		kunmap_atomic(user_mem);
 
-	if (!uncmem) {
-		pr_info("Unable to allocate temp memory\n");
-		ret = -ENOMEM;
-		goto out_cleanup;
+		/* written back pages are read outside of the atomic kmap */
+		if (ret == -EAGAIN) {
+			ret = read_from_bdev(zram, page, index);
+			if (ret == -EAGAIN) {
+				user_mem = kmap_atomic(page);
+				ret = zram_decompress_page(zram, user_mem, index);
+				kunmap_atomic(user_mem);
+			}
+		}
 	}
 
-	ret = zram_decompress_page(zram, uncmem, index);
 	/* Should NEVER happen. Return bio error if it does. */
 	if (unlikely(ret))
-		goto out_cleanup;
-
-	if (is_partial_io(bvec))
-		memcpy(user_mem + bvec->bv_offset, uncmem + offset,
-				bvec->bv_len);
+		return ret;
 
 	flush_dcache_page(page);
-	ret = 0;
-out_cleanup:
-	kunmap_atomic(user_mem);
-	if (is_partial_io(bvec))
-		kfree(uncmem);
-	return ret;
+	return 0;
 }
 
 static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
@@ -453,6 +1138,9 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	struct zram_meta *meta = zram->meta;
 	static unsigned long zram_rs_time;
 	struct zcomp_strm *zstrm;
+	struct zram_entry *entry = NULL;
+	unsigned long element;
+	u32 checksum = 0;
 	bool locked = false;
 
 	page = bvec->bv_page;
@@ -466,7 +1154,7 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			ret = -ENOMEM;
 			goto out;
 		}
-		ret = zram_decompress_page(zram, uncmem, index);
+		ret = zram_read_page(zram, uncmem, index);
 		if (ret)
 			goto out;
 	}
@@ -484,19 +1172,52 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		uncmem = user_mem;
 	}
 
-	if (page_zero_filled(uncmem)) {
-		kunmap_atomic(user_mem);
+	if (page_same_filled(uncmem, &element)) {
+		if (user_mem)
+			kunmap_atomic(user_mem);
 		/* Free memory associated with this sector now. */
 		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
 		zram_free_page(zram, index);
-		zram_set_flag(meta, index, ZRAM_ZERO);
+		zram_set_flag(meta, index, ZRAM_SAME);
+		meta->table[index].element = element;
+		zram_accessed(zram, index);
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
-		atomic64_inc(&zram->stats.zero_pages);
+		atomic64_inc(&zram->stats.same_pages);
+		if (!element)
+			atomic64_inc(&zram->stats.zero_pages);
 		ret = 0;
 		goto out;
 	}
 
+	if (zram_dedup_enabled(zram)) {
+		checksum = zram_dedup_checksum(uncmem);
+		entry = zram_dedup_find(zram, uncmem, checksum, zstrm->buffer);
+		if (entry) {
+			if (user_mem)
+				kunmap_atomic(user_mem);
+			zcomp_strm_release(zram->comp, zstrm);
+			locked = false;
+
+			clen = entry->len;
+			bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+			zram_free_page(zram, index);
+			meta->table[index].entry = entry;
+			zram_set_obj_size(meta, index, clen);
+			if (clen == PAGE_SIZE)
+				zram_set_flag(meta, index, ZRAM_HUGE);
+			zram_accessed(zram, index);
+			bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+			atomic64_add(clen, &zram->stats.dup_data_size);
+			atomic64_inc(&zram->stats.dedup_hits);
+			atomic64_inc(&zram->stats.pages_stored);
+			if (clen == PAGE_SIZE)
+				atomic64_inc(&zram->stats.huge_pages);
+			goto out;
+		}
+	}
+
 	ret = zcomp_compress(zram->comp, zstrm, uncmem, &clen);
 	if (!is_partial_io(bvec)) {
 		kunmap_atomic(user_mem);
@@ -510,6 +1231,18 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	}
 	src = zstrm->buffer;
 	if (unlikely(clen > max_zpage_size)) {
+		if (zram_wb_enabled(zram) && !is_partial_io(bvec)) {
+			zcomp_strm_release(zram->comp, zstrm);
+			locked = false;
+			ret = write_to_bdev(zram, page, index);
+			if (!ret)
+				goto out;
+			/* backing device is full or failing, keep it in RAM */
+			zstrm = zcomp_strm_find(zram->comp);
+			locked = true;
+			src = zstrm->buffer;
+			ret = 0;
+		}
 		clen = PAGE_SIZE;
 		if (is_partial_io(bvec))
 			src = uncmem;
@@ -538,6 +1271,15 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	locked = false;
 	zs_unmap_object(meta->mem_pool, handle);
 
+	if (zram_dedup_enabled(zram)) {
+		entry = zram_dedup_insert(zram, handle, clen, checksum);
+		if (!entry) {
+			zs_free(meta->mem_pool, handle);
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
 	/*
 	 * Free memory associated with this sector
 	 * before overwriting unused sectors.
@@ -545,13 +1287,21 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
 	zram_free_page(zram, index);
 
-	meta->table[index].handle = handle;
+	if (entry)
+		meta->table[index].entry = entry;
+	else
+		meta->table[index].handle = handle;
 	zram_set_obj_size(meta, index, clen);
+	if (clen == PAGE_SIZE)
+		zram_set_flag(meta, index, ZRAM_HUGE);
+	zram_accessed(zram, index);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
 	/* Update stats */
 	atomic64_add(clen, &zram->stats.compr_data_size);
 	atomic64_inc(&zram->stats.pages_stored);
+	if (clen == PAGE_SIZE)
+		atomic64_inc(&zram->stats.huge_pages);
 out:
 	if (locked)
 		zcomp_strm_release(zram->comp, zstrm);
@@ -622,6 +1372,316 @@ static void zram_bio_discard(struct zram *zram, u32 index,
 	}
 }
 
+/*
+ * idle - mark slots idle; the mark is dropped on the next access
+ *   "all":  mark every allocated slot
+ *   <secs>: mark slots which were not accessed for <secs> seconds
+ *           (CONFIG_ZRAM_MEMORY_TRACKING)
+ */
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages, index;
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	unsigned long age = 0;
+#endif
+	ssize_t ret = len;
+
+	if (!sysfs_streq(buf, "all")) {
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+		unsigned int secs;
+
+		if (kstrtouint(buf, 10, &secs))
+			return -EINVAL;
+		age = (unsigned long)secs * HZ;
+#else
+		return -EINVAL;
+#endif
+	}
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (!zram_slot_allocated(meta, index) ||
+				zram_test_flag(meta, index, ZRAM_IDLE))
+			goto next;
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+		if (age &&
+			time_before(jiffies, meta->table[index].ac_time + age))
+			goto next;
+#endif
+		zram_set_flag(meta, index, ZRAM_IDLE);
+		atomic64_inc(&zram->stats.idle_pages);
+next:
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		if (!(index % 1024))
+			cond_resched();
+	}
+out:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
+/*
+ * recompress - re-encode slots with the secondary algorithm
+ *   "idle":    slots marked idle through the idle attribute
+ *   "huge":    slots stored uncompressed
+ *   <bytes>:   slots whose compressed size is at least <bytes>
+ */
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages, index, handle;
+	unsigned int threshold = 0;
+	bool idle_only = false, huge_only = false, idle;
+	struct zcomp_strm *zstrm;
+	size_t size, clen;
+	unsigned char *cmem;
+	char *mem;
+	ssize_t ret = len;
+
+	if (sysfs_streq(buf, "idle"))
+		idle_only = true;
+	else if (sysfs_streq(buf, "huge"))
+		huge_only = true;
+	else if (kstrtouint(buf, 10, &threshold) || !threshold)
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	if (!zram->recomp) {
+		ret = -ENODEV;
+		goto release_init_lock;
+	}
+
+	/* shared objects can't carry a per-slot algorithm */
+	if (zram_dedup_enabled(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	mem = (char *)__get_free_page(GFP_KERNEL);
+	if (!mem) {
+		ret = -ENOMEM;
+		goto release_init_lock;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (!meta->table[index].handle ||
+				zram_test_flag(meta, index, ZRAM_SAME) ||
+				zram_test_flag(meta, index, ZRAM_WB) ||
+				zram_test_flag(meta, index, ZRAM_UNDER_WB) ||
+				zram_test_flag(meta, index, ZRAM_RECOMP))
+			goto next;
+
+		size = zram_get_obj_size(meta, index);
+		if (idle_only && !zram_test_flag(meta, index, ZRAM_IDLE))
+			goto next;
+		if (huge_only && !zram_test_flag(meta, index, ZRAM_HUGE))
+			goto next;
+		if (threshold && size < threshold)
+			goto next;
+
+		/* keeps writeback away and tells us about rewrites */
+		zram_set_flag(meta, index, ZRAM_UNDER_WB);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		if (zram_decompress_page(zram, mem, index))
+			goto abort;
+
+		zstrm = zcomp_strm_find(zram->recomp);
+		if (zcomp_compress(zram->recomp, zstrm, mem, &clen) ||
+				clen >= size || clen > max_zpage_size) {
+			zcomp_strm_release(zram->recomp, zstrm);
+			goto abort;
+		}
+
+		handle = zs_malloc(meta->mem_pool, clen);
+		if (!handle) {
+			zcomp_strm_release(zram->recomp, zstrm);
+			goto abort;
+		}
+		cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_WO);
+		memcpy(cmem, zstrm->buffer, clen);
+		zs_unmap_object(meta->mem_pool, handle);
+		zcomp_strm_release(zram->recomp, zstrm);
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		/* freed or overwritten meanwhile */
+		if (!zram_test_flag(meta, index, ZRAM_UNDER_WB)) {
+			bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+			zs_free(meta->mem_pool, handle);
+			continue;
+		}
+
+		idle = zram_test_flag(meta, index, ZRAM_IDLE);
+		zram_free_page(zram, index);
+		meta->table[index].handle = handle;
+		zram_set_obj_size(meta, index, clen);
+		zram_set_flag(meta, index, ZRAM_RECOMP);
+		/* recompression is not an access */
+		if (idle) {
+			zram_set_flag(meta, index, ZRAM_IDLE);
+			atomic64_inc(&zram->stats.idle_pages);
+		}
+		atomic64_add(clen, &zram->stats.compr_data_size);
+		atomic64_inc(&zram->stats.pages_stored);
+		atomic64_inc(&zram->stats.num_recompressed);
+next:
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		cond_resched();
+		continue;
+abort:
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		cond_resched();
+	}
+	free_page((unsigned long)mem);
+
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+/*
+ * writeback - move slots from zsmalloc to the backing device
+ *   "huge": write back incompressible pages
+ *   "idle": write back pages marked idle through the idle attribute
+ *   <secs>: write back pages which were not accessed for <secs> seconds
+ */
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages, index, entry, age = 0;
+	struct page *page;
+	bool huge_only = false, idle_only = false, idle;
+	ssize_t ret = 0;
+
+	if (sysfs_streq(buf, "huge")) {
+		huge_only = true;
+	} else if (sysfs_streq(buf, "idle")) {
+		idle_only = true;
+	} else {
+		unsigned int secs;
+
+		if (kstrtouint(buf, 10, &secs))
+			return -EINVAL;
+		age = (unsigned long)secs * HZ;
+	}
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	if (!zram_wb_enabled(zram)) {
+		ret = -ENODEV;
+		goto release_init_lock;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto release_init_lock;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (!meta->table[index].handle ||
+				zram_test_flag(meta, index, ZRAM_SAME) ||
+				zram_test_flag(meta, index, ZRAM_WB) ||
+				zram_test_flag(meta, index, ZRAM_UNDER_WB))
+			goto next;
+		if (huge_only && !zram_test_flag(meta, index, ZRAM_HUGE))
+			goto next;
+		if (idle_only && !zram_test_flag(meta, index, ZRAM_IDLE))
+			goto next;
+		if (!huge_only && !idle_only &&
+			time_before(jiffies, meta->table[index].ac_time + age))
+			goto next;
+
+		zram_set_flag(meta, index, ZRAM_UNDER_WB);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		entry = alloc_block_bdev(zram);
+		if (!entry) {
+			ret = -ENOSPC;
+			bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+			zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+			bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+			break;
+		}
+
+		if (zram_decompress_page(zram, page_address(page), index) ||
+				zram_bdev_rw(zram, page, entry, WRITE)) {
+			free_block_bdev(zram, entry);
+			bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+			zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+			bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+			continue;
+		}
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		/*
+		 * The slot was freed or overwritten while we were writing
+		 * it out; the block on the backing device is stale.
+		 */
+		if (!zram_test_flag(meta, index, ZRAM_UNDER_WB)) {
+			bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+			free_block_bdev(zram, entry);
+			continue;
+		}
+
+		idle = zram_test_flag(meta, index, ZRAM_IDLE);
+		zram_free_page(zram, index);
+		meta->table[index].handle = entry;
+		zram_set_flag(meta, index, ZRAM_WB);
+		/* writeback is not an access, keep the slot cold */
+		if (idle) {
+			zram_set_flag(meta, index, ZRAM_IDLE);
+			atomic64_inc(&zram->stats.idle_pages);
+		}
+		atomic64_inc(&zram->stats.pages_stored);
+next:
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		cond_resched();
+	}
+	__free_page(page);
+
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret ? ret : len;
+}
+#endif
+
 static void zram_reset_device(struct zram *zram, bool reset_capacity)
 {
 	size_t index;
@@ -637,13 +1697,21 @@ static void zram_reset_device(struct zram *zram, bool reset_capacity)
 	/* Free all pages that are still in this zram device */
 	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
 		unsigned long handle = meta->table[index].handle;
-		if (!handle)
+		if (!handle || zram_test_flag(meta, index, ZRAM_SAME) ||
+				zram_test_flag(meta, index, ZRAM_WB))
 			continue;
 
-		zs_free(meta->mem_pool, handle);
+		if (zram_dedup_enabled(zram))
+			zram_dedup_put(zram, meta->table[index].entry);
+		else
+			zs_free(meta->mem_pool, handle);
 	}
+	reset_bdev(zram);
 
 	zcomp_destroy(zram->comp);
+	if (zram->recomp)
+		zcomp_destroy(zram->recomp);
+	zram->recomp = NULL;
 	zram->max_comp_streams = 1;
 
 	zram_meta_free(zram->meta);
@@ -670,7 +1738,7 @@ static ssize_t disksize_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	u64 disksize;
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp = NULL;
 	struct zram_meta *meta;
 	struct zram *zram = dev_to_zram(dev);
 	int err;
@@ -680,7 +1748,7 @@ static ssize_t disksize_store(struct device *dev,
 		return -EINVAL;
 
 	disksize = PAGE_ALIGN(disksize);
-	meta = zram_meta_alloc(disksize);
+	meta = zram_meta_alloc(zram->disk->disk_name, disksize);
 	if (!meta)
 		return -ENOMEM;
 
@@ -692,6 +1760,17 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+	if (zram->recomp_compressor[0]) {
+		recomp = zcomp_create(zram->recomp_compressor, 1);
+		if (IS_ERR(recomp)) {
+			pr_info("Cannot initialise %s recompressing backend\n",
+					zram->recomp_compressor);
+			err = PTR_ERR(recomp);
+			recomp = NULL;
+			goto out_destroy_comp_unlocked;
+		}
+	}
+
 	down_write(&zram->init_lock);
 	if (init_done(zram)) {
 		pr_info("Cannot change disksize for initialized device\n");
@@ -701,6 +1780,7 @@ static ssize_t disksize_store(struct device *dev,
 
 	zram->meta = meta;
 	zram->comp = comp;
+	zram->recomp = recomp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
 	up_write(&zram->init_lock);
@@ -716,6 +1796,9 @@ static ssize_t disksize_store(struct device *dev,
 
 out_destroy_comp:
 	up_write(&zram->init_lock);
+out_destroy_comp_unlocked:
+	if (recomp)
+		zcomp_destroy(recomp);
 	zcomp_destroy(comp);
 out_free_meta:
 	zram_meta_free(meta);
@@ -763,6 +1846,109 @@ out:
 	return ret;
 }
 
+/* one multi-page write bio spread over the online CPUs */
+struct zram_bio_batch {
+	atomic_t pending;
+	int error;
+	struct completion done;
+};
+
+struct zram_work {
+	struct work_struct work;
+	struct zram *zram;
+	struct bio *bio;
+	struct bio_vec *bvec;
+	u32 index;
+	struct zram_bio_batch *batch;
+};
+
+static void zram_comp_work_fn(struct work_struct *work)
+{
+	struct zram_work *zw = container_of(work, struct zram_work, work);
+	struct zram_bio_batch *batch = zw->batch;
+	int ret;
+
+	ret = zram_bvec_rw(zw->zram, zw->bvec, zw->index, 0, zw->bio);
+	if (unlikely(ret))
+		batch->error = ret;
+
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+/*
+ * Parallel compression pays off only for writes of several full pages on
+ * an SMP system with enough streams for the workers to run concurrently.
+ */
+static bool zram_can_async_write(struct zram *zram, struct bio *bio,
+				int offset)
+{
+	struct bio_vec *bvec;
+	int i;
+
+	if (!zram->async_comp || zram->max_comp_streams < 2 ||
+			num_online_cpus() < 2)
+		return false;
+	if (bio_data_dir(bio) != WRITE || offset ||
+			bio->bi_vcnt - bio->bi_idx < 2)
+		return false;
+
+	bio_for_each_segment(bvec, bio, i) {
+		if (is_partial_io(bvec))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Compress the pages of @bio in parallel: one page in every
+ * num_online_cpus() is handled inline by the submitter, the others go to
+ * the unbound zram_comp_wq, whose workers the scheduler spreads over the
+ * CPUs. Being unbound, the queue needs no CPU hotplug protection. The
+ * submitter then waits for the workers. Returns -EAGAIN if the bio has
+ * to go the serial way.
+ */
+static int zram_async_write(struct zram *zram, struct bio *bio, u32 index)
+{
+	struct zram_bio_batch batch;
+	struct zram_work *works;
+	struct bio_vec *bvec;
+	int i, nr, share;
+
+	nr = bio->bi_vcnt - bio->bi_idx;
+	works = kmalloc(nr * sizeof(*works), GFP_NOIO | __GFP_NOWARN);
+	if (!works)
+		return -EAGAIN;
+
+	atomic_set(&batch.pending, nr);
+	batch.error = 0;
+	init_completion(&batch.done);
+
+	share = num_online_cpus();
+	bio_for_each_segment(bvec, bio, i) {
+		struct zram_work *zw = &works[i - bio->bi_idx];
+
+		INIT_WORK(&zw->work, zram_comp_work_fn);
+		zw->zram = zram;
+		zw->bio = bio;
+		zw->bvec = bvec;
+		zw->index = index++;
+		zw->batch = &batch;
+
+		if ((i - bio->bi_idx) % share)
+			queue_work(zram_comp_wq, &zw->work);
+	}
+
+	for (i = 0; i < nr; i += share)
+		zram_comp_work_fn(&works[i].work);
+
+	wait_for_completion(&batch.done);
+	kfree(works);
+
+	return batch.error;
+}
+
 static void __zram_make_request(struct zram *zram, struct bio *bio)
 {
 	int i, offset;
@@ -778,6 +1964,18 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 		return;
 	}
 
+	if (zram_can_async_write(zram, bio, offset)) {
+		int ret = zram_async_write(zram, bio, index);
+
+		if (!ret) {
+			set_bit(BIO_UPTODATE, &bio->bi_flags);
+			bio_endio(bio, 0);
+			return;
+		}
+		if (ret != -EAGAIN)
+			goto out;
+	}
+
 	bio_for_each_segment(bvec, bio, i) {
 		int max_transfer_size = PAGE_SIZE - offset;
 
@@ -868,10 +2066,29 @@ static DEVICE_ATTR(initstate, S_IRUGO, initstate_show, NULL);
 static DEVICE_ATTR(reset, S_IWUSR, NULL, reset_store);
 static DEVICE_ATTR(orig_data_size, S_IRUGO, orig_data_size_show, NULL);
 static DEVICE_ATTR(mem_used_total, S_IRUGO, mem_used_total_show, NULL);
+static DEVICE_ATTR(compact, S_IWUSR, NULL, compact_store);
+static DEVICE_ATTR(pages_compacted, S_IRUGO, pages_compacted_show, NULL);
 static DEVICE_ATTR(max_comp_streams, S_IRUGO | S_IWUSR,
 		max_comp_streams_show, max_comp_streams_store);
 static DEVICE_ATTR(comp_algorithm, S_IRUGO | S_IWUSR,
 		comp_algorithm_show, comp_algorithm_store);
+static DEVICE_ATTR(async_comp, S_IRUGO | S_IWUSR,
+		async_comp_show, async_comp_store);
+static DEVICE_ATTR(swap_readahead, S_IRUGO | S_IWUSR,
+		swap_readahead_show, swap_readahead_store);
+static DEVICE_ATTR(recomp_algorithm, S_IRUGO | S_IWUSR,
+		recomp_algorithm_show, recomp_algorithm_store);
+static DEVICE_ATTR(recompress, S_IWUSR, NULL, recompress_store);
+static DEVICE_ATTR(idle, S_IWUSR, NULL, idle_store);
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR(use_dedup, S_IRUGO | S_IWUSR,
+		use_dedup_show, use_dedup_store);
+#endif
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR(backing_dev, S_IRUGO | S_IWUSR,
+		backing_dev_show, backing_dev_store);
+static DEVICE_ATTR(writeback, S_IWUSR, NULL, writeback_store);
+#endif
 
 ZRAM_ATTR_RO(num_reads);
 ZRAM_ATTR_RO(num_writes);
@@ -880,7 +2097,20 @@ ZRAM_ATTR_RO(failed_writes);
 ZRAM_ATTR_RO(invalid_io);
 ZRAM_ATTR_RO(notify_free);
 ZRAM_ATTR_RO(zero_pages);
+ZRAM_ATTR_RO(same_pages);
 ZRAM_ATTR_RO(compr_data_size);
+ZRAM_ATTR_RO(huge_pages);
+ZRAM_ATTR_RO(idle_pages);
+ZRAM_ATTR_RO(num_recompressed);
+#ifdef CONFIG_ZRAM_DEDUP
+ZRAM_ATTR_RO(dup_data_size);
+ZRAM_ATTR_RO(dedup_hits);
+#endif
+#ifdef CONFIG_ZRAM_WRITEBACK
+ZRAM_ATTR_RO(bd_count);
+ZRAM_ATTR_RO(bd_reads);
+ZRAM_ATTR_RO(bd_writes);
+#endif
 
 static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_disksize.attr,
@@ -893,11 +2123,34 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_invalid_io.attr,
 	&dev_attr_notify_free.attr,
 	&dev_attr_zero_pages.attr,
+	&dev_attr_same_pages.attr,
 	&dev_attr_orig_data_size.attr,
 	&dev_attr_compr_data_size.attr,
 	&dev_attr_mem_used_total.attr,
+	&dev_attr_compact.attr,
+	&dev_attr_pages_compacted.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_async_comp.attr,
+	&dev_attr_swap_readahead.attr,
+	&dev_attr_huge_pages.attr,
+	&dev_attr_idle.attr,
+	&dev_attr_idle_pages.attr,
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+	&dev_attr_num_recompressed.attr,
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+	&dev_attr_dup_data_size.attr,
+	&dev_attr_dedup_hits.attr,
+#endif
+#ifdef CONFIG_ZRAM_WRITEBACK
+	&dev_attr_backing_dev.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_bd_count.attr,
+	&dev_attr_bd_reads.attr,
+	&dev_attr_bd_writes.attr,
+#endif
 	NULL,
 };
 
@@ -1002,6 +2255,9 @@ static int __init zram_init(void)
 {
 	int ret, dev_id;
 
+	/* all page flags have to fit into table[].value */
+	BUILD_BUG_ON(__NR_ZRAM_PAGEFLAGS > BITS_PER_LONG);
+
 	if (num_devices > max_num_devices) {
 		pr_warn("Invalid value for num_devices: %u\n",
 				num_devices);
@@ -1009,11 +2265,23 @@ static int __init zram_init(void)
 		goto out;
 	}
 
+	/* may run on behalf of swap-out, hence WQ_MEM_RECLAIM */
+	zram_comp_wq = alloc_workqueue("zram_comp",
+			WQ_MEM_RECLAIM | WQ_UNBOUND, 0);
+	if (!zram_comp_wq) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = zram_bdev_init();
+	if (ret)
+		goto destroy_wq;
+
 	zram_major = register_blkdev(0, "zram");
 	if (zram_major <= 0) {
 		pr_warn("Unable to get major number\n");
 		ret = -EBUSY;
-		goto out;
+		goto destroy_bdev_wq;
 	}
 
 	/* Allocate the device array and initialize each one */
@@ -1039,6 +2307,10 @@ free_devices:
 	kfree(zram_devices);
 unregister:
 	unregister_blkdev(zram_major, "zram");
+destroy_bdev_wq:
+	zram_bdev_exit();
+destroy_wq:
+	destroy_workqueue(zram_comp_wq);
 out:
 	return ret;
 }
@@ -1060,6 +2332,8 @@ static void __exit zram_exit(void)
 	}
 
 	unregister_blkdev(zram_major, "zram");
+	zram_bdev_exit();
+	destroy_workqueue(zram_comp_wq);
 
 	kfree(zram_devices);
 	pr_debug("Cleanup done!\n");
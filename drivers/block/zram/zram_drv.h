@@ -17,6 +17,7 @@
 #define _ZRAM_DRV_H_
 
 #include <linux/spinlock.h>
+#include <linux/rbtree.h>
 #include <linux/zsmalloc.h>
 
 #include "zcomp.h"
@@ -66,19 +67,43 @@ static const size_t max_zpage_size = PAGE_SIZE / 10 * 9;
 
 /* Flags for zram pages (table[page_no].value) */
 enum zram_pageflags {
-	/* Page consists entirely of zeros */
-	ZRAM_ZERO = ZRAM_FLAG_SHIFT + 1,
+	/* Page consists of the same element, kept in table.element */
+	ZRAM_SAME = ZRAM_FLAG_SHIFT + 1,
 	ZRAM_ACCESS,	/* page in now accessed */
+	ZRAM_WB,	/* page is stored on backing_device */
+	ZRAM_UNDER_WB,	/* page is under writeback or recompression */
+	ZRAM_HUGE,	/* incompressible page */
+	ZRAM_IDLE,	/* not accessed since last idle marking */
+	ZRAM_RECOMP,	/* compressed with the secondary algorithm */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+/* Refcounted zsmalloc object shared by identical pages, see zram_dedup.c */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 len;
+	u32 checksum;
+	unsigned long refcount;
+	unsigned long handle;
+};
+
 /* Allocated for each disk page */
 struct zram_table_entry {
-	unsigned long handle;
+	union {
+		/* zsmalloc handle, or backing device block index for ZRAM_WB */
+		unsigned long handle;
+		/* zsmalloc object of a use_dedup device */
+		struct zram_entry *entry;
+		/* fill word of a ZRAM_SAME page */
+		unsigned long element;
+	};
 	unsigned long value;
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	unsigned long ac_time;	/* jiffies of last read or write */
+#endif
 };
 
 struct zram_stats {
@@ -90,12 +115,28 @@ struct zram_stats {
 	atomic64_t invalid_io;	/* non-page-aligned I/O requests */
 	atomic64_t notify_free;	/* no. of swap slot free notifications */
 	atomic64_t zero_pages;		/* no. of zero filled pages */
+	atomic64_t same_pages;		/* no. of same element filled pages */
 	atomic64_t pages_stored;	/* no. of pages currently stored */
+	atomic64_t huge_pages;		/* no. of huge pages in zsmalloc */
+	atomic64_t idle_pages;		/* no. of slots marked idle */
+	atomic64_t num_recompressed;	/* no. of slots recompressed */
+	atomic64_t dup_data_size;	/* compressed bytes saved by dedup */
+	atomic64_t dedup_hits;		/* no. of writes served by dedup */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	atomic64_t bd_count;		/* no. of pages in backing device */
+	atomic64_t bd_reads;		/* no. of reads from backing device */
+	atomic64_t bd_writes;		/* no. of writes to backing device */
+#endif
 };
 
 struct zram_meta {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
+#ifdef CONFIG_ZRAM_DEDUP
+	/* zram_entry objects ordered by checksum */
+	struct rb_root dedup_root;
+	spinlock_t dedup_lock;
+#endif
 };
 
 struct zram {
@@ -112,7 +153,22 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	int max_comp_streams;
+	/* compress the pages of multi-page writes in parallel */
+	bool async_comp;
 	struct zram_stats stats;
 	char compressor[10];
+	/* optional secondary algorithm for cold slots, "" if none */
+	struct zcomp *recomp;
+	char recomp_compressor[10];
+#ifdef CONFIG_ZRAM_DEDUP
+	bool use_dedup;
+#endif
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct file *backing_dev;
+	struct block_device *bdev;
+	/* one bit per PAGE_SIZE block of bdev, bit 0 is never used */
+	unsigned long *bitmap;
+	unsigned long nr_pages;
+#endif
 };
 #endif
@@ -15,12 +15,16 @@
 
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/cpufreq.h>
 #include <linux/sched.h>
 #include <linux/jiffies.h>
 #include <linux/kthread.h>
 #include <linux/moduleparam.h>
+#include <linux/input.h>
+#include <linux/slab.h>
+#include <linux/time.h>
 
 struct cpu_sync {
 	struct task_struct *thread;
@@ -31,16 +35,115 @@ struct cpu_sync {
 	bool pending;
 	int src_cpu;
 	unsigned int boost_min;
+	unsigned int input_boost_min;
+	unsigned int input_boost_freq;
+	unsigned int input_boost_ms;
+	struct delayed_work input_boost_rem;
+	/* input boost statistics, in jiffies */
+	unsigned long input_boost_hits;
+	unsigned long input_boost_start;
+	unsigned long input_boost_time;
 };
 
 static DEFINE_PER_CPU(struct cpu_sync, sync_info);
 static struct workqueue_struct *boost_rem_wq;
+static struct workqueue_struct *input_boost_wq;
+static struct work_struct input_boost_work;
 
 static unsigned int boost_ms = 50;
 module_param(boost_ms, uint, 0644);
 
 static unsigned int sync_threshold;
 module_param(sync_threshold, uint, 0644);
+
+/*
+ * input_boost_freq and input_boost_ms take either a single value for every
+ * cpu, or "cpu:value" pairs separated by spaces, e.g. "0:1200000 1:920000".
+ * A zero frequency disables the input boost of that cpu.
+ */
+#define DEFAULT_INPUT_BOOST_MS		40
+/* events closer than this only keep an existing boost alive */
+#define MIN_INPUT_INTERVAL_US		(20 * USEC_PER_MSEC)
+
+static u64 last_input_time;
+
+static int set_input_boost_param(const char *buf, const struct kernel_param *kp)
+{
+	size_t off = (size_t)kp->arg;
+	unsigned int cpu, val;
+	const char *cp = buf;
+	int n;
+
+	if (sscanf(buf, "%u%n", &val, &n) == 1 && strchr(buf, ':') == NULL) {
+		for_each_possible_cpu(cpu)
+			*(unsigned int *)((void *)&per_cpu(sync_info, cpu) +
+					  off) = val;
+		return 0;
+	}
+
+	while (sscanf(cp, "%u:%u%n", &cpu, &val, &n) == 2) {
+		if (cpu >= nr_cpu_ids)
+			return -EINVAL;
+		*(unsigned int *)((void *)&per_cpu(sync_info, cpu) + off) = val;
+		cp += n;
+		while (*cp == ' ')
+			cp++;
+		if (*cp == '\0' || *cp == '\n')
+			return 0;
+	}
+
+	return -EINVAL;
+}
+
+static int get_input_boost_param(char *buf, const struct kernel_param *kp)
+{
+	size_t off = (size_t)kp->arg;
+	unsigned int cpu;
+	int cnt = 0;
+
+	for_each_possible_cpu(cpu)
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%u:%u ", cpu,
+				*(unsigned int *)((void *)&per_cpu(sync_info,
+								  cpu) + off));
+	if (cnt)
+		buf[cnt - 1] = '\n';
+	return cnt;
+}
+
+static const struct kernel_param_ops input_boost_param_ops = {
+	.set = set_input_boost_param,
+	.get = get_input_boost_param,
+};
+
+module_param_cb(input_boost_freq, &input_boost_param_ops,
+		(void *)offsetof(struct cpu_sync, input_boost_freq), 0644);
+module_param_cb(input_boost_ms, &input_boost_param_ops,
+		(void *)offsetof(struct cpu_sync, input_boost_ms), 0644);
+
+/* per cpu "cpu:hits:boosted_ms", including a boost still in progress */
+static int get_input_boost_stats(char *buf, const struct kernel_param *kp)
+{
+	unsigned int cpu;
+	int cnt = 0;
+
+	for_each_possible_cpu(cpu) {
+		struct cpu_sync *s = &per_cpu(sync_info, cpu);
+		unsigned long time = s->input_boost_time;
+
+		if (s->input_boost_min)
+			time += jiffies - s->input_boost_start;
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%u:%lu:%u\n", cpu,
+				s->input_boost_hits, jiffies_to_msecs(time));
+	}
+	return cnt;
+}
+
+static const struct kernel_param_ops input_boost_stats_ops = {
+	.get = get_input_boost_stats,
+};
+
+module_param_cb(input_boost_stats, &input_boost_stats_ops, NULL, 0444);
+
 /*
  * The CPUFREQ_ADJUST notifier is used to override the current policy min to
  * make sure policy min >= boost_min. The cpufreq framework then does the job
@@ -50,12 +153,19 @@ static int boost_adjust_notify(struct notifier_block *nb, unsigned long val, voi
 {
 	struct cpufreq_policy *policy = data;
 	unsigned int cpu = policy->cpu;
-	struct cpu_sync *s = &per_cpu(sync_info, cpu);
-	unsigned int min = s->boost_min;
+	unsigned int min = 0;
+	unsigned int j;
 
 	if (val != CPUFREQ_ADJUST)
 		return NOTIFY_OK;
 
+	/* cpus sharing a policy each get the highest boost among them */
+	for_each_cpu(j, policy->cpus) {
+		struct cpu_sync *s = &per_cpu(sync_info, j);
+
+		min = max(min, max(s->boost_min, s->input_boost_min));
+	}
+
 	if (min == 0)
 		return NOTIFY_OK;
 
@@ -86,6 +196,140 @@ static void do_boost_rem(struct work_struct *work)
 	cpufreq_update_policy(s->cpu);
 }
 
+static void do_input_boost_rem(struct work_struct *work)
+{
+	struct cpu_sync *s = container_of(work, struct cpu_sync,
+						input_boost_rem.work);
+
+	pr_debug("Removing input boost for CPU%d\n", s->cpu);
+	s->input_boost_time += jiffies - s->input_boost_start;
+	s->input_boost_min = 0;
+	/* Force policy re-evaluation to trigger adjust notifier. */
+	cpufreq_update_policy(s->cpu);
+}
+
+/*
+ * Raise the floor of every cpu with an input boost frequency, or just push
+ * back the removal while input keeps coming.
+ */
+static void do_input_boost(struct work_struct *work)
+{
+	unsigned int cpu;
+	struct cpu_sync *s;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		s = &per_cpu(sync_info, cpu);
+		if (!s->input_boost_freq || !s->input_boost_ms)
+			continue;
+
+		cancel_delayed_work_sync(&s->input_boost_rem);
+		if (s->input_boost_min != s->input_boost_freq) {
+			pr_debug("Input boost for CPU%d\n", cpu);
+			if (!s->input_boost_min)
+				s->input_boost_start = jiffies;
+			s->input_boost_min = s->input_boost_freq;
+			s->input_boost_hits++;
+			cpufreq_update_policy(cpu);
+		}
+		queue_delayed_work_on(cpu, boost_rem_wq, &s->input_boost_rem,
+				      msecs_to_jiffies(s->input_boost_ms));
+	}
+	put_online_cpus();
+}
+
+/*
+ * Events less than MIN_INPUT_INTERVAL_US after the last one handled are
+ * dropped: they neither start a boost nor push back its removal.  A steady
+ * stream of input still extends the boost every MIN_INPUT_INTERVAL_US.
+ */
+static void cpuboost_input_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	u64 now;
+
+	now = ktime_to_us(ktime_get());
+	if (now - last_input_time < MIN_INPUT_INTERVAL_US)
+		return;
+
+	if (work_pending(&input_boost_work))
+		return;
+
+	queue_work(input_boost_wq, &input_boost_work);
+	last_input_time = now;
+}
+
+static int cpuboost_input_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void cpuboost_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id cpuboost_ids[] = {
+	/* multi-touch touchscreen, e.g. atmel_mxt_ts */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			BIT_MASK(ABS_MT_POSITION_X) |
+			BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	/* touchpad */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	/* keypad */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler cpuboost_input_handler = {
+	.event		= cpuboost_input_event,
+	.connect	= cpuboost_input_connect,
+	.disconnect	= cpuboost_input_disconnect,
+	.name		= "cpu-boost",
+	.id_table	= cpuboost_ids,
+};
+
 static int boost_mig_sync_thread(void *data)
 {
 	int dest_cpu = (int) data;
@@ -175,18 +419,29 @@ static int cpu_boost_init(void)
 	if (!boost_rem_wq)
 		return -EFAULT;
 
+	input_boost_wq = alloc_workqueue("cpuboost_wq", WQ_HIGHPRI, 0);
+	if (!input_boost_wq)
+		return -EFAULT;
+
+	INIT_WORK(&input_boost_work, do_input_boost);
+
 	for_each_possible_cpu(cpu) {
 		s = &per_cpu(sync_info, cpu);
 		s->cpu = cpu;
 		init_waitqueue_head(&s->sync_wq);
 		spin_lock_init(&s->lock);
 		INIT_DELAYED_WORK(&s->boost_rem, do_boost_rem);
+		INIT_DELAYED_WORK(&s->input_boost_rem, do_input_boost_rem);
+		s->input_boost_ms = DEFAULT_INPUT_BOOST_MS;
 		s->thread = kthread_run(boost_mig_sync_thread, (void *)cpu,
 					"boost_sync/%d", cpu);
 	}
 	atomic_notifier_chain_register(&migration_notifier_head,
 					&boost_migration_nb);
 
+	if (input_register_handler(&cpuboost_input_handler))
+		pr_err("Failed to register input handler\n");
+
 	return 0;
 }
 late_initcall(cpu_boost_init);
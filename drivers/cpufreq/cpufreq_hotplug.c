@@ -48,6 +48,20 @@
 /* default number of sampling periods to average before hotplug-out decision */
 #define DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS		(20)
 
+/* hotplug decisions from the average load across online CPUs */
+#define HOTPLUG_MODE_LOAD				(0)
+/* hotplug decisions from the average number of runnable tasks */
+#define HOTPLUG_MODE_NR_RUNNING				(1)
+
+/* more than 1.5 runnable tasks on average onlines CPU1, x100 */
+#define DEFAULT_NR_RUNNING_IN				(150)
+
+/* fewer than 0.8 runnable tasks on average takes CPU1 down, x100 */
+#define DEFAULT_NR_RUNNING_OUT				(80)
+
+/* CPU1 stays online at least this long (mSec) once brought up */
+#define DEFAULT_MIN_ONLINE_TIME				(1000)
+
 static void do_dbs_timer(struct work_struct *work);
 static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		unsigned int event);
@@ -99,6 +113,11 @@ static struct dbs_tuners {
 	unsigned int *hotplug_load_history;
 	unsigned int ignore_nice;
 	unsigned int io_is_busy;
+	unsigned int hotplug_mode;
+	unsigned int nr_running_in;
+	unsigned int nr_running_out;
+	unsigned int min_online_time;
+	unsigned int park_cpu;
 } dbs_tuners_ins = {
 	.sampling_rate =		DEFAULT_SAMPLING_PERIOD,
 	.up_threshold =			DEFAULT_UP_FREQ_MIN_LOAD,
@@ -109,8 +128,37 @@ static struct dbs_tuners {
 	.hotplug_load_index =		0,
 	.ignore_nice =			0,
 	.io_is_busy =			0,
+	.hotplug_mode =			HOTPLUG_MODE_LOAD,
+	.nr_running_in =		DEFAULT_NR_RUNNING_IN,
+	.nr_running_out =		DEFAULT_NR_RUNNING_OUT,
+	.min_online_time =		DEFAULT_MIN_ONLINE_TIME,
+	.park_cpu =			0,
 };
 
+/*
+ * State of the auxiliary CPU: when it was last brought into use and how
+ * many consecutive samples voted to add or remove it in
+ * HOTPLUG_MODE_NR_RUNNING.  Whether it is parked is cpu_is_parked(1).
+ */
+static struct hotplug_state {
+	unsigned long active_since;
+	unsigned int nr_in_periods;
+	unsigned int nr_out_periods;
+} hp_state;
+
+/* cost of the transitions, only up/down are real hotplugs */
+static struct hotplug_stats {
+	unsigned long up_count;
+	unsigned long down_count;
+	unsigned long park_count;
+	u64 up_time_us;
+	u64 down_time_us;
+	u64 park_time_us;
+	unsigned int up_max_us;
+	unsigned int down_max_us;
+	unsigned int park_max_us;
+} hp_stats;
+
 /*
  * A corner case exists when switching io_is_busy at run-time: comparing idle
  * times from a non-io_is_busy period to an io_is_busy period (or vice-versa)
@@ -156,6 +204,33 @@ show_one(hotplug_in_sampling_periods, hotplug_in_sampling_periods);
 show_one(hotplug_out_sampling_periods, hotplug_out_sampling_periods);
 show_one(ignore_nice_load, ignore_nice);
 show_one(io_is_busy, io_is_busy);
+show_one(hotplug_mode, hotplug_mode);
+show_one(nr_running_in, nr_running_in);
+show_one(nr_running_out, nr_running_out);
+show_one(min_online_time, min_online_time);
+show_one(park_cpu, park_cpu);
+
+static ssize_t show_hotplug_stats(struct kobject *kobj, struct attribute *attr,
+				  char *buf)
+{
+	u64 up_avg = 0, down_avg = 0, park_avg = 0;
+
+	mutex_lock(&dbs_mutex);
+	if (hp_stats.up_count)
+		up_avg = div_u64(hp_stats.up_time_us, hp_stats.up_count);
+	if (hp_stats.down_count)
+		down_avg = div_u64(hp_stats.down_time_us, hp_stats.down_count);
+	if (hp_stats.park_count)
+		park_avg = div_u64(hp_stats.park_time_us, hp_stats.park_count);
+	mutex_unlock(&dbs_mutex);
+
+	return sprintf(buf, "up %lu avg %llu max %u us\n"
+			    "down %lu avg %llu max %u us\n"
+			    "park %lu avg %llu max %u us\n",
+		       hp_stats.up_count, up_avg, hp_stats.up_max_us,
+		       hp_stats.down_count, down_avg, hp_stats.down_max_us,
+		       hp_stats.park_count, park_avg, hp_stats.park_max_us);
+}
 
 static ssize_t store_sampling_rate(struct kobject *a, struct attribute *b,
 				   const char *buf, size_t count)
@@ -384,8 +459,101 @@ define_one_global_rw(down_differential);
 define_one_global_rw(down_threshold);
 define_one_global_rw(hotplug_in_sampling_periods);
 define_one_global_rw(hotplug_out_sampling_periods);
+static ssize_t store_hotplug_mode(struct kobject *a, struct attribute *b,
+				  const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1 || input > HOTPLUG_MODE_NR_RUNNING)
+		return -EINVAL;
+
+	mutex_lock(&dbs_mutex);
+	dbs_tuners_ins.hotplug_mode = input;
+	hp_state.nr_in_periods = 0;
+	hp_state.nr_out_periods = 0;
+	mutex_unlock(&dbs_mutex);
+
+	return count;
+}
+
+static ssize_t store_nr_running_in(struct kobject *a, struct attribute *b,
+				   const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1 || input <= dbs_tuners_ins.nr_running_out)
+		return -EINVAL;
+
+	mutex_lock(&dbs_mutex);
+	dbs_tuners_ins.nr_running_in = input;
+	mutex_unlock(&dbs_mutex);
+
+	return count;
+}
+
+static ssize_t store_nr_running_out(struct kobject *a, struct attribute *b,
+				    const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1 || input >= dbs_tuners_ins.nr_running_in)
+		return -EINVAL;
+
+	mutex_lock(&dbs_mutex);
+	dbs_tuners_ins.nr_running_out = input;
+	mutex_unlock(&dbs_mutex);
+
+	return count;
+}
+
+static ssize_t store_min_online_time(struct kobject *a, struct attribute *b,
+				     const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&dbs_mutex);
+	dbs_tuners_ins.min_online_time = input;
+	mutex_unlock(&dbs_mutex);
+
+	return count;
+}
+
+static ssize_t store_park_cpu(struct kobject *a, struct attribute *b,
+			      const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&dbs_mutex);
+	dbs_tuners_ins.park_cpu = !!input;
+	mutex_unlock(&dbs_mutex);
+
+	return count;
+}
+
 define_one_global_rw(ignore_nice_load);
 define_one_global_rw(io_is_busy);
+define_one_global_rw(hotplug_mode);
+define_one_global_rw(nr_running_in);
+define_one_global_rw(nr_running_out);
+define_one_global_rw(min_online_time);
+define_one_global_rw(park_cpu);
+define_one_global_ro(hotplug_stats);
 
 static struct attribute *dbs_attributes[] = {
 	&sampling_rate.attr,
@@ -396,6 +564,12 @@ static struct attribute *dbs_attributes[] = {
 	&hotplug_out_sampling_periods.attr,
 	&ignore_nice_load.attr,
 	&io_is_busy.attr,
+	&hotplug_mode.attr,
+	&nr_running_in.attr,
+	&nr_running_out.attr,
+	&min_online_time.attr,
+	&park_cpu.attr,
+	&hotplug_stats.attr,
 	NULL
 };
 
@@ -406,6 +580,126 @@ static struct attribute_group dbs_attr_group = {
 
 /************************** sysfs end ************************/
 
+static unsigned int hotplug_elapsed_us(ktime_t start)
+{
+	return ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+static bool hotplug_aux_cpu_active(void)
+{
+	return cpu_online(1) && !cpu_is_parked(1);
+}
+
+/*
+ * Bring CPU1 into use, either by onlining it or, if it was only parked,
+ * by letting it take work again.  Called with timer_mutex held.
+ */
+static void hotplug_aux_cpu_up(struct cpu_dbs_info_s *this_dbs_info)
+{
+	ktime_t start;
+	unsigned int us;
+
+	if (cpu_is_parked(1)) {
+		mutex_unlock(&this_dbs_info->timer_mutex);
+		if (!set_cpu_parked(1, false))
+			hp_state.active_since = jiffies;
+		mutex_lock(&this_dbs_info->timer_mutex);
+		return;
+	}
+
+	/* hotplug with cpufreq is nasty
+	 * a call to cpufreq_governor_dbs may cause a lockup.
+	 * wq is not running here so its safe.
+	 */
+	mutex_unlock(&this_dbs_info->timer_mutex);
+	start = ktime_get();
+	if (!cpu_up(1)) {
+		us = hotplug_elapsed_us(start);
+		hp_stats.up_count++;
+		hp_stats.up_time_us += us;
+		hp_stats.up_max_us = max(hp_stats.up_max_us, us);
+		hp_state.active_since = jiffies;
+	}
+	mutex_lock(&this_dbs_info->timer_mutex);
+}
+
+/*
+ * Take CPU1 out of use once it has been active for min_online_time,
+ * parking it instead of unplugging when park_cpu is set.
+ * Called with timer_mutex held.
+ */
+static void hotplug_aux_cpu_down(struct cpu_dbs_info_s *this_dbs_info)
+{
+	ktime_t start;
+	unsigned int us;
+
+	if (time_before(jiffies, hp_state.active_since +
+			msecs_to_jiffies(dbs_tuners_ins.min_online_time)))
+		return;
+
+	if (dbs_tuners_ins.park_cpu) {
+		mutex_unlock(&this_dbs_info->timer_mutex);
+		start = ktime_get();
+		if (!set_cpu_parked(1, true)) {
+			us = hotplug_elapsed_us(start);
+			hp_stats.park_count++;
+			hp_stats.park_time_us += us;
+			hp_stats.park_max_us = max(hp_stats.park_max_us, us);
+		}
+		mutex_lock(&this_dbs_info->timer_mutex);
+		return;
+	}
+
+	mutex_unlock(&this_dbs_info->timer_mutex);
+	start = ktime_get();
+	if (!cpu_down(1)) {
+		us = hotplug_elapsed_us(start);
+		hp_stats.down_count++;
+		hp_stats.down_time_us += us;
+		hp_stats.down_max_us = max(hp_stats.down_max_us, us);
+	}
+	mutex_lock(&this_dbs_info->timer_mutex);
+}
+
+/*
+ * HOTPLUG_MODE_NR_RUNNING: vote on CPU1 from the time averaged number of
+ * runnable tasks.  It has to stay above nr_running_in for
+ * hotplug_in_sampling_periods, or below nr_running_out for
+ * hotplug_out_sampling_periods, before anything happens.
+ * Returns true if CPU1 was brought up or taken down.
+ */
+static bool dbs_check_nr_running(struct cpu_dbs_info_s *this_dbs_info)
+{
+	unsigned int nr = (avg_nr_running() * 100) >> FSHIFT;
+	bool active = hotplug_aux_cpu_active();
+
+	if (!active && nr > dbs_tuners_ins.nr_running_in)
+		hp_state.nr_in_periods++;
+	else
+		hp_state.nr_in_periods = 0;
+
+	if (active && nr < dbs_tuners_ins.nr_running_out)
+		hp_state.nr_out_periods++;
+	else
+		hp_state.nr_out_periods = 0;
+
+	if (hp_state.nr_in_periods >=
+			dbs_tuners_ins.hotplug_in_sampling_periods) {
+		hp_state.nr_in_periods = 0;
+		hotplug_aux_cpu_up(this_dbs_info);
+		return true;
+	}
+
+	if (hp_state.nr_out_periods >=
+			dbs_tuners_ins.hotplug_out_sampling_periods) {
+		hp_state.nr_out_periods = 0;
+		hotplug_aux_cpu_down(this_dbs_info);
+		return !hotplug_aux_cpu_active();
+	}
+
+	return false;
+}
+
 static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 {
 	/* combined load of all enabled CPUs */
@@ -458,6 +752,10 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		/* load is the percentage of time not spent in idle */
 		load = 100 * (wall_time - idle_time) / wall_time;
 
+		/* a parked cpu is online but takes no tasks, leave it out */
+		if (!cpu_active(j))
+			continue;
+
 		/* keep track of combined load across all CPUs */
 		total_load += load;
 
@@ -470,7 +768,7 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	max_load_freq = max_load * policy->cur;
 
 	/* calculate the average load across all related CPUs */
-	avg_load = total_load / num_online_cpus();
+	avg_load = total_load / num_active_cpus();
 
 
 	/*
@@ -510,18 +808,14 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	if (++dbs_tuners_ins.hotplug_load_index == periods)
 		dbs_tuners_ins.hotplug_load_index = 0;
 
-	/* check if auxiliary CPU is needed based on avg_load */
-	if (avg_load > dbs_tuners_ins.up_threshold) {
-		/* should we enable auxillary CPUs? */
-		if (num_online_cpus() < 2 && hotplug_in_avg_load >
+	if (dbs_tuners_ins.hotplug_mode == HOTPLUG_MODE_NR_RUNNING) {
+		if (dbs_check_nr_running(this_dbs_info))
+			goto out;
+	} else if (avg_load > dbs_tuners_ins.up_threshold) {
+		/* check if auxiliary CPU is needed based on avg_load */
+		if (!hotplug_aux_cpu_active() && hotplug_in_avg_load >
 				dbs_tuners_ins.up_threshold) {
-			/* hotplug with cpufreq is nasty
-			 * a call to cpufreq_governor_dbs may cause a lockup.
-			 * wq is not running here so its safe.
-			 */
-			mutex_unlock(&this_dbs_info->timer_mutex);
-			cpu_up(1);
-			mutex_lock(&this_dbs_info->timer_mutex);
+			hotplug_aux_cpu_up(this_dbs_info);
 			goto out;
 		}
 	}
@@ -541,12 +835,10 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		/* are we at the minimum frequency already? */
 		if (policy->cur == policy->min) {
 			/* should we disable auxillary CPUs? */
-			if (num_online_cpus() > 1 && hotplug_out_avg_load <
-					dbs_tuners_ins.down_threshold) {
-				mutex_unlock(&this_dbs_info->timer_mutex);
-				cpu_down(1);
-				mutex_lock(&this_dbs_info->timer_mutex);
-			}
+			if (dbs_tuners_ins.hotplug_mode == HOTPLUG_MODE_LOAD &&
+			    hotplug_aux_cpu_active() && hotplug_out_avg_load <
+					dbs_tuners_ins.down_threshold)
+				hotplug_aux_cpu_down(this_dbs_info);
 			goto out;
 		}
 	}
@@ -647,6 +939,7 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		}
 		this_dbs_info->cpu = cpu;
 		this_dbs_info->freq_table = cpufreq_frequency_get_table(cpu);
+		hp_state.active_since = jiffies;
 		/*
 		 * Start the timerschedule work, when this governor
 		 * is used for first time
@@ -676,6 +969,9 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 			sysfs_remove_group(cpufreq_global_kobject,
 					   &dbs_attr_group);
 		kfree(dbs_tuners_ins.hotplug_load_history);
+		/* a parked CPU1 is online, hand it back to the scheduler */
+		if (cpu_is_parked(1))
+			set_cpu_parked(1, false);
 		/*
 		 * XXX BIG CAVEAT: Stopping the governor with CPU1 offline
 		 * will result in it remaining offline until the user onlines
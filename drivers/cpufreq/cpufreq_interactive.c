@@ -19,6 +19,7 @@
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/irq_work.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/rwsem.h>
@@ -52,6 +53,11 @@ struct cpufreq_interactive_cpuinfo {
 	u64 hispeed_validate_time;
 	struct rw_semaphore enable_sem;
 	int governor_enabled;
+	struct update_util_data update_util;
+	struct irq_work irq_work;
+	u64 last_sched_eval;
+	bool sched_hooked;
+	bool latency_boost;
 };
 
 static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
@@ -112,6 +118,12 @@ static u64 boostpulse_endtime;
 #define DEFAULT_TIMER_SLACK (4 * DEFAULT_TIMER_RATE)
 static int timer_slack_val = DEFAULT_TIMER_SLACK;
 
+/*
+ * Non-zero means load is evaluated when the scheduler enqueues, dequeues or
+ * ticks a task on the cpu, rather than from the sampling timer.
+ */
+static int sched_input_val;
+
 static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		unsigned int event);
 
@@ -138,8 +150,12 @@ void cpufreq_interactive_set_timer_rate(unsigned long val, unsigned int reset)
 }
 #endif
 
+/*
+ * Start a new load window.  The sampling timers are only armed when @arm is
+ * set; with scheduler input the next window is closed by the scheduler.
+ */
 static void cpufreq_interactive_timer_resched(
-	struct cpufreq_interactive_cpuinfo *pcpu)
+	struct cpufreq_interactive_cpuinfo *pcpu, bool arm)
 {
 	unsigned long expires;
 	unsigned long flags;
@@ -150,6 +166,11 @@ static void cpufreq_interactive_timer_resched(
 				     &pcpu->time_in_idle_timestamp);
 	pcpu->cputime_speedadj = 0;
 	pcpu->cputime_speedadj_timestamp = pcpu->time_in_idle_timestamp;
+	if (!arm) {
+		spin_unlock_irqrestore(&pcpu->load_lock, flags);
+		return;
+	}
+
 	expires = jiffies + usecs_to_jiffies(timer_rate);
 	mod_timer_pinned(&pcpu->cpu_timer, expires);
 
@@ -323,8 +344,20 @@ static void cpufreq_interactive_timer(unsigned long data)
 
 	do_div(cputime_speedadj, delta_time);
 	loadadjfreq = (unsigned int)cputime_speedadj * 100;
+
+	/*
+	 * The idle time only shows a burst once it has run for a window,
+	 * the scheduler's usage of the cpu already includes the history of
+	 * whatever just woke up on it.
+	 */
+	if (sched_input_val)
+		loadadjfreq = max(loadadjfreq, (unsigned int)
+				  (((u64)sched_cpu_usage(data) *
+				    pcpu->policy->cur * 100) >>
+				   SCHED_LOAD_SHIFT));
+
 	cpu_load = loadadjfreq / pcpu->target_freq;
-	boosted = boost_val || now < boostpulse_endtime;
+	boosted = boost_val || now < boostpulse_endtime || pcpu->latency_boost;
 
 	if (cpu_load >= go_hispeed_load || boosted) {
 		if (pcpu->target_freq < hispeed_freq) {
@@ -359,6 +392,9 @@ static void cpufreq_interactive_timer(unsigned long data)
 		goto rearm;
 
 	new_freq = pcpu->freq_table[index].frequency;
+	new_freq = cpufreq_frequency_table_efficient(pcpu->policy,
+						     pcpu->freq_table,
+						     new_freq);
 
 	/*
 	 * Do not scale below floor_freq unless we have been at or above the
@@ -412,7 +448,7 @@ rearm_if_notmax:
 
 rearm:
 	if (!timer_pending(&pcpu->cpu_timer))
-		cpufreq_interactive_timer_resched(pcpu);
+		cpufreq_interactive_timer_resched(pcpu, !sched_input_val);
 
 exit:
 	up_read(&pcpu->enable_sem);
@@ -444,7 +480,7 @@ static void cpufreq_interactive_idle_start(void)
 		 * the CPUFreq driver.
 		 */
 		if (!pending)
-			cpufreq_interactive_timer_resched(pcpu);
+			cpufreq_interactive_timer_resched(pcpu, true);
 	}
 
 	up_read(&pcpu->enable_sem);
@@ -462,9 +498,27 @@ static void cpufreq_interactive_idle_end(void)
 		return;
 	}
 
+	/*
+	 * With scheduler input the first enqueue or tick re-evaluates; only
+	 * the timer left by idle_start needs handling.
+	 */
+	if (sched_input_val) {
+		if (timer_pending(&pcpu->cpu_timer)) {
+			bool expired = time_after_eq(jiffies,
+						     pcpu->cpu_timer.expires);
+
+			del_timer(&pcpu->cpu_timer);
+			del_timer(&pcpu->cpu_slack_timer);
+			if (expired)
+				cpufreq_interactive_timer(smp_processor_id());
+		}
+		up_read(&pcpu->enable_sem);
+		return;
+	}
+
 	/* Arm the timer for 1-2 ticks later if not already. */
 	if (!timer_pending(&pcpu->cpu_timer)) {
-		cpufreq_interactive_timer_resched(pcpu);
+		cpufreq_interactive_timer_resched(pcpu, true);
 	} else if (time_after_eq(jiffies, pcpu->cpu_timer.expires)) {
 		del_timer(&pcpu->cpu_timer);
 		del_timer(&pcpu->cpu_slack_timer);
@@ -474,6 +528,87 @@ static void cpufreq_interactive_idle_end(void)
 	up_read(&pcpu->enable_sem);
 }
 
+/*
+ * Called by the scheduler with the run queue locked: only note that the
+ * load changed, the evaluation runs from irq_work once the lock is dropped.
+ *
+ * A latency sensitive task queued on the cpu boosts that cpu to hispeed
+ * like boostpulse does, but only while the task is runnable; this is
+ * reported whatever the load input.
+ */
+static void cpufreq_interactive_update_util(struct update_util_data *data,
+					    u64 time, unsigned int flags)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		container_of(data, struct cpufreq_interactive_cpuinfo,
+			     update_util);
+	bool latency = flags & SCHED_CPUFREQ_LATENCY;
+
+	if (latency != pcpu->latency_boost) {
+		pcpu->latency_boost = latency;
+		pcpu->last_sched_eval = time;
+		irq_work_queue(&pcpu->irq_work);
+		return;
+	}
+
+	if (!sched_input_val)
+		return;
+
+	/* a load window shorter than a tick says nothing useful */
+	if (time - pcpu->last_sched_eval < TICK_NSEC)
+		return;
+
+	pcpu->last_sched_eval = time;
+	irq_work_queue(&pcpu->irq_work);
+}
+
+static void cpufreq_interactive_irq_work(struct irq_work *work)
+{
+	cpufreq_interactive_timer(smp_processor_id());
+}
+
+static void cpufreq_interactive_arm_timers(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int cpu)
+{
+	unsigned long expires;
+
+	expires = jiffies + usecs_to_jiffies(timer_rate);
+	pcpu->cpu_timer.expires = expires;
+	add_timer_on(&pcpu->cpu_timer, cpu);
+	if (timer_slack_val >= 0) {
+		expires += usecs_to_jiffies(timer_slack_val);
+		pcpu->cpu_slack_timer.expires = expires;
+		add_timer_on(&pcpu->cpu_slack_timer, cpu);
+	}
+}
+
+/* Caller holds gov_lock and pcpu->enable_sem for write. */
+static void cpufreq_interactive_sched_start(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int cpu)
+{
+	if (pcpu->sched_hooked)
+		return;
+
+	pcpu->last_sched_eval = 0;
+	pcpu->latency_boost = false;
+	cpufreq_add_update_util_hook(cpu, &pcpu->update_util,
+				     cpufreq_interactive_update_util);
+	pcpu->sched_hooked = true;
+}
+
+/* Caller holds gov_lock and pcpu->enable_sem for write. */
+static void cpufreq_interactive_sched_stop(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int cpu)
+{
+	if (!pcpu->sched_hooked)
+		return;
+
+	cpufreq_remove_update_util_hook(cpu);
+	synchronize_sched();
+	irq_work_sync(&pcpu->irq_work);
+	pcpu->sched_hooked = false;
+}
+
 static int cpufreq_interactive_speedchange_task(void *data)
 {
 	unsigned int cpu;
@@ -826,6 +961,49 @@ static ssize_t store_timer_slack(
 
 define_one_global_rw(timer_slack);
 
+static ssize_t show_sched_input(
+	struct kobject *kobj, struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", sched_input_val);
+}
+
+static ssize_t store_sched_input(
+	struct kobject *kobj, struct attribute *attr, const char *buf,
+	size_t count)
+{
+	int ret;
+	unsigned long val;
+	unsigned int j;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&gov_lock);
+	if (!!val == sched_input_val) {
+		mutex_unlock(&gov_lock);
+		return count;
+	}
+
+	sched_input_val = !!val;
+	for_each_online_cpu(j) {
+		pcpu = &per_cpu(cpuinfo, j);
+		down_write(&pcpu->enable_sem);
+		if (pcpu->governor_enabled) {
+			del_timer_sync(&pcpu->cpu_timer);
+			del_timer_sync(&pcpu->cpu_slack_timer);
+			if (!sched_input_val)
+				cpufreq_interactive_arm_timers(pcpu, j);
+		}
+		up_write(&pcpu->enable_sem);
+	}
+	mutex_unlock(&gov_lock);
+	return count;
+}
+
+define_one_global_rw(sched_input);
+
 static ssize_t show_boost(struct kobject *kobj, struct attribute *attr,
 			  char *buf)
 {
@@ -907,6 +1085,7 @@ static struct attribute *interactive_attributes[] = {
 	&min_sample_time_attr.attr,
 	&timer_rate_attr.attr,
 	&timer_slack.attr,
+	&sched_input.attr,
 	&boost.attr,
 	&boostpulse.attr,
 	&boostpulse_duration.attr,
@@ -959,8 +1138,6 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			hispeed_freq = policy->max;
 
 		for_each_cpu(j, policy->cpus) {
-			unsigned long expires;
-
 			pcpu = &per_cpu(cpuinfo, j);
 			pcpu->policy = policy;
 			pcpu->target_freq = policy->cur;
@@ -971,14 +1148,9 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			pcpu->hispeed_validate_time =
 				pcpu->floor_validate_time;
 			down_write(&pcpu->enable_sem);
-			expires = jiffies + usecs_to_jiffies(timer_rate);
-			pcpu->cpu_timer.expires = expires;
-			add_timer_on(&pcpu->cpu_timer, j);
-			if (timer_slack_val >= 0) {
-				expires += usecs_to_jiffies(timer_slack_val);
-				pcpu->cpu_slack_timer.expires = expires;
-				add_timer_on(&pcpu->cpu_slack_timer, j);
-			}
+			cpufreq_interactive_sched_start(pcpu, j);
+			if (!sched_input_val)
+				cpufreq_interactive_arm_timers(pcpu, j);
 			pcpu->governor_enabled = 1;
 			up_write(&pcpu->enable_sem);
 		}
@@ -1011,6 +1183,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			pcpu = &per_cpu(cpuinfo, j);
 			down_write(&pcpu->enable_sem);
 			pcpu->governor_enabled = 0;
+			cpufreq_interactive_sched_stop(pcpu, j);
 			del_timer_sync(&pcpu->cpu_timer);
 			del_timer_sync(&pcpu->cpu_slack_timer);
 			up_write(&pcpu->enable_sem);
@@ -1066,6 +1239,7 @@ static int __init cpufreq_interactive_init(void)
 		pcpu->cpu_slack_timer.function = cpufreq_interactive_nop_timer;
 		spin_lock_init(&pcpu->load_lock);
 		init_rwsem(&pcpu->enable_sem);
+		init_irq_work(&pcpu->irq_work, cpufreq_interactive_irq_work);
 	}
 
 	spin_lock_init(&target_loads_lock);
@@ -57,6 +57,7 @@
 static atomic_t active_count = ATOMIC_INIT(0);
 struct cpufreq_ondemandplus_cpuinfo {
 struct timer_list cpu_timer;
+struct timer_list cpu_slack_timer;
 int timer_idlecancel;
 u64 time_in_idle;
 u64 idle_exit_time;
@@ -68,6 +69,9 @@ struct cpufreq_policy *policy;
 struct cpufreq_frequency_table *freq_table;
 unsigned int target_freq;
 int governor_enabled;
+u64 idle_start_time;
+unsigned long idle_ramps;
+unsigned long idle_exit_evals;
 };
 static DEFINE_PER_CPU(struct cpufreq_ondemandplus_cpuinfo, cpuinfo);
 /* realtime thread handles frequency scaling */
@@ -94,6 +98,23 @@ static u64 staycycles_resetfreq;
 #define DEFAULT_IO_IS_BUSY 2
 static unsigned int io_is_busy;
 /*
+* The sampling timer is deferrable, so it does not wake an idle CPU.
+* A CPU going idle above min still gets woken by the slack timer,
+* timer_slack after its next sample is due, so it cannot hold the
+* other CPUs of its policy up for long.
+*/
+#define DEFAULT_TIMER_SLACK (4 * DEFAULT_TIMER_RATE)
+static unsigned long timer_slack;
+/*
+* Leaving an idle period of at least idle_ramp_samples sampling
+* periods with the screen on jumps straight to idle_ramp_freq, the
+* load model takes over from the next sample. 0 disables the ramp.
+*/
+#define DEFAULT_IDLE_RAMP_SAMPLES 5
+static unsigned long idle_ramp_samples;
+#define DEFAULT_IDLE_RAMP_FREQ DEFAULT_INTER_LOFREQ
+static unsigned int idle_ramp_freq;
+/*
 * Tunables end
 */
 static int cpufreq_governor_ondemandplus(struct cpufreq_policy *policy,
@@ -346,6 +367,13 @@ exit:
 
 return;
 }
+static void cpufreq_ondemandplus_nop_timer(unsigned long data)
+{
+/*
+* The purpose of the slack timer is to wake the CPU from idle, so
+* that its deferrable sampling timer can run.
+*/
+}
 static void cpufreq_ondemandplus_idle_start(void)
 {
 struct cpufreq_ondemandplus_cpuinfo *pcpu =
@@ -354,6 +382,7 @@ int pending;
 if (!pcpu->governor_enabled)
 return;
 pcpu->idling = 1;
+pcpu->idle_start_time = ktime_to_us(ktime_get());
 smp_wmb();
 pending = timer_pending(&pcpu->cpu_timer);
 if (pcpu->target_freq != pcpu->policy->min) {
@@ -373,6 +402,9 @@ pcpu->timer_idlecancel = 0;
 mod_timer(&pcpu->cpu_timer,
 jiffies + usecs_to_jiffies(timer_rate));
 }
+/* that timer is deferrable, the slack timer makes sure it runs */
+mod_timer(&pcpu->cpu_slack_timer, jiffies +
+usecs_to_jiffies(timer_rate + timer_slack));
 #endif
 } else {
 /*
@@ -383,6 +415,7 @@ jiffies + usecs_to_jiffies(timer_rate));
 */
 if (pending && pcpu->timer_idlecancel) {
 del_timer(&pcpu->cpu_timer);
+del_timer(&pcpu->cpu_slack_timer);
 /*
 * Ensure last timer run time is after current idle
 * sample start time, so next idle exit will always
@@ -393,12 +426,76 @@ pcpu->timer_idlecancel = 0;
 }
 }
 }
+/*
+* Coming out of a long idle period the load of the samples is close
+* to nothing, and the threshold model needs several of them to ramp
+* up again. Go to idle_ramp_freq at once instead and start a new
+* sample from here.
+*/
+static bool cpufreq_ondemandplus_idle_ramp(
+struct cpufreq_ondemandplus_cpuinfo *pcpu, unsigned int cpu)
+{
+unsigned int freq = idle_ramp_freq;
+unsigned int index;
+unsigned long flags;
+u64 idle_us;
+if (!freq || !idle_ramp_samples || !pcpu->idle_start_time ||
+max_capped == screen_off_max_freq)
+return false;
+idle_us = ktime_to_us(ktime_get()) - pcpu->idle_start_time;
+if (idle_us < (u64)idle_ramp_samples * timer_rate)
+return false;
+if (freq > pcpu->policy->max)
+freq = pcpu->policy->max;
+if (cpufreq_frequency_table_target(pcpu->policy, pcpu->freq_table,
+freq, CPUFREQ_RELATION_L, &index))
+return false;
+freq = pcpu->freq_table[index].frequency;
+if (freq <= pcpu->target_freq)
+return false;
+trace_cpufreq_ondemandplus_target(cpu, 0, pcpu->target_freq, freq);
+pcpu->target_set_time_in_idle = get_cpu_idle_time(cpu,
+&pcpu->target_set_time);
+pcpu->target_freq = freq;
+pcpu->idle_ramps++;
+spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+cpumask_set_cpu(cpu, &speedchange_cpumask);
+spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+wake_up_process(speedchange_task);
+return true;
+}
 static void cpufreq_ondemandplus_idle_end(void)
 {
+unsigned int cpu = smp_processor_id();
 struct cpufreq_ondemandplus_cpuinfo *pcpu =
-&per_cpu(cpuinfo, smp_processor_id());
+&per_cpu(cpuinfo, cpu);
+bool ramped;
 pcpu->idling = 0;
 smp_wmb();
+if (!pcpu->governor_enabled)
+return;
+del_timer(&pcpu->cpu_slack_timer);
+ramped = cpufreq_ondemandplus_idle_ramp(pcpu, cpu);
+pcpu->idle_start_time = 0;
+if (ramped) {
+pcpu->time_in_idle = get_cpu_idle_time(cpu,
+&pcpu->idle_exit_time);
+pcpu->timer_idlecancel = 0;
+mod_timer(&pcpu->cpu_timer,
+jiffies + usecs_to_jiffies(timer_rate));
+return;
+}
+/*
+* A sample that came due while the CPU was idle has been deferred,
+* evaluate it now rather than at the next tick.
+*/
+if (timer_pending(&pcpu->cpu_timer) &&
+time_after_eq(jiffies, pcpu->cpu_timer.expires)) {
+del_timer(&pcpu->cpu_timer);
+pcpu->idle_exit_evals++;
+cpufreq_ondemandplus_timer(cpu);
+return;
+}
 /*
 * Arm the timer for 1-2 ticks later if not already, and if the timer
 * function has already processed the previous load sampling
@@ -414,7 +511,7 @@ if (timer_pending(&pcpu->cpu_timer) == 0 &&
 pcpu->timer_run_time >= pcpu->idle_exit_time &&
 pcpu->governor_enabled) {
 pcpu->time_in_idle =
-get_cpu_idle_time(smp_processor_id(),
+get_cpu_idle_time(cpu,
 &pcpu->idle_exit_time);
 pcpu->timer_idlecancel = 0;
 mod_timer(&pcpu->cpu_timer,
@@ -649,6 +746,75 @@ return count;
 }
 static struct global_attr io_is_busy_attr = __ATTR(io_is_busy, 0644,
 show_io_is_busy, store_io_is_busy);
+static ssize_t show_timer_slack(struct kobject *kobj,
+struct attribute *attr, char *buf)
+{
+return sprintf(buf, "%lu\n", timer_slack);
+}
+static ssize_t store_timer_slack(struct kobject *kobj,
+struct attribute *attr, const char *buf, size_t count)
+{
+int ret;
+unsigned long val;
+ret = kstrtoul(buf, 0, &val);
+if (ret < 0)
+return ret;
+timer_slack = val;
+return count;
+}
+static struct global_attr timer_slack_attr = __ATTR(timer_slack, 0644,
+show_timer_slack, store_timer_slack);
+static ssize_t show_idle_ramp_samples(struct kobject *kobj,
+struct attribute *attr, char *buf)
+{
+return sprintf(buf, "%lu\n", idle_ramp_samples);
+}
+static ssize_t store_idle_ramp_samples(struct kobject *kobj,
+struct attribute *attr, const char *buf, size_t count)
+{
+int ret;
+unsigned long val;
+ret = kstrtoul(buf, 0, &val);
+if (ret < 0)
+return ret;
+idle_ramp_samples = val;
+return count;
+}
+static struct global_attr idle_ramp_samples_attr = __ATTR(idle_ramp_samples,
+0644, show_idle_ramp_samples, store_idle_ramp_samples);
+static ssize_t show_idle_ramp_freq(struct kobject *kobj,
+struct attribute *attr, char *buf)
+{
+return sprintf(buf, "%u\n", idle_ramp_freq);
+}
+static ssize_t store_idle_ramp_freq(struct kobject *kobj,
+struct attribute *attr, const char *buf, size_t count)
+{
+int ret;
+unsigned int val;
+ret = kstrtouint(buf, 0, &val);
+if (ret < 0)
+return ret;
+idle_ramp_freq = val;
+return count;
+}
+static struct global_attr idle_ramp_freq_attr = __ATTR(idle_ramp_freq, 0644,
+show_idle_ramp_freq, store_idle_ramp_freq);
+static ssize_t show_idle_exit_stats(struct kobject *kobj,
+struct attribute *attr, char *buf)
+{
+ssize_t len = 0;
+unsigned int cpu;
+for_each_possible_cpu(cpu) {
+struct cpufreq_ondemandplus_cpuinfo *pcpu =
+&per_cpu(cpuinfo, cpu);
+len += sprintf(buf + len, "cpu%u ramps %lu evals %lu\n", cpu,
+pcpu->idle_ramps, pcpu->idle_exit_evals);
+}
+return len;
+}
+static struct global_attr idle_exit_stats_attr = __ATTR(idle_exit_stats, 0444,
+show_idle_exit_stats, NULL);
 static struct attribute *ondemandplus_attributes[] = {
 &timer_rate_attr.attr,
 &up_threshold_attr.attr,
@@ -658,6 +824,10 @@ static struct attribute *ondemandplus_attributes[] = {
 &inter_staycycles_attr.attr,
 &staycycles_resetfreq_attr.attr,
 &io_is_busy_attr.attr,
+&timer_slack_attr.attr,
+&idle_ramp_samples_attr.attr,
+&idle_ramp_freq_attr.attr,
+&idle_exit_stats_attr.attr,
 NULL,
 };
 static struct attribute_group ondemandplus_attr_group = {
@@ -723,6 +893,7 @@ pcpu = &per_cpu(cpuinfo, j);
 pcpu->governor_enabled = 0;
 smp_wmb();
 del_timer_sync(&pcpu->cpu_timer);
+del_timer_sync(&pcpu->cpu_slack_timer);
 /*
 * Reset idle exit time since we may cancel the timer
 * before it can run after the last idle exit time,
@@ -761,12 +932,17 @@ inter_lofreq = DEFAULT_INTER_LOFREQ;
 inter_staycycles = DEFAULT_INTER_STAYCYCLES;
 staycycles_resetfreq = DEFAULT_STAYCYCLES_RESETFREQ;
 io_is_busy = DEFAULT_IO_IS_BUSY;
+timer_slack = DEFAULT_TIMER_SLACK;
+idle_ramp_samples = DEFAULT_IDLE_RAMP_SAMPLES;
+idle_ramp_freq = DEFAULT_IDLE_RAMP_FREQ;
 /* Initalize per-cpu timers */
 for_each_possible_cpu(i) {
 pcpu = &per_cpu(cpuinfo, i);
-init_timer(&pcpu->cpu_timer);
+init_timer_deferrable(&pcpu->cpu_timer);
 pcpu->cpu_timer.function = cpufreq_ondemandplus_timer;
 pcpu->cpu_timer.data = i;
+init_timer(&pcpu->cpu_slack_timer);
+pcpu->cpu_slack_timer.function = cpufreq_ondemandplus_nop_timer;
 }
 spin_lock_init(&speedchange_cpumask_lock);
 speedchange_task =
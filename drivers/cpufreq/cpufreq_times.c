@@ -0,0 +1,305 @@
+/*
+ *  drivers/cpufreq/cpufreq_times.c
+ *
+ *  Time in each cpu frequency, per task and per uid.
+ *
+ *  The scheduler tick charges the cputime it accounts to a task to the
+ *  frequency of its cpu, both in the task and in the entry of its uid.
+ *  Nothing is locked on that path: the frequency index of each cpu is
+ *  kept up to date by the transition notifier, a task's own array is
+ *  only written from the cpu it runs on, and uid entries, which are
+ *  never freed, are found under rcu and added to atomically.  Reading
+ *  /proc/uid_time_in_state walks the uid entries, not the tasks.
+ *
+ *  All the cpus share one table of frequencies, that of the first
+ *  policy seen; a frequency that is not in it is not accounted.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/cpufreq_times.h>
+#include <linux/cpu.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/list.h>
+#include <linux/proc_fs.h>
+#include <linux/rculist.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <asm/atomic.h>
+#include <asm/cputime.h>
+
+#define UID_HASH_BITS	7
+#define UID_HASH_SIZE	(1 << UID_HASH_BITS)
+
+struct uid_entry {
+	uid_t uid;
+	struct hlist_node hash;
+	atomic64_t time_in_state[0];
+};
+
+static struct hlist_head uid_hash_table[UID_HASH_SIZE];
+static DEFINE_SPINLOCK(uid_lock);	/* adding to uid_hash_table */
+
+static unsigned int *freq_table;
+static unsigned int nr_freqs;		/* set once freq_table is filled */
+static DEFINE_SPINLOCK(freq_table_lock);
+
+static DEFINE_PER_CPU(int, freq_index) = -1;
+
+static int freq_to_index(unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < nr_freqs; i++)
+		if (freq_table[i] == freq)
+			return i;
+	return -1;
+}
+
+static struct uid_entry *find_uid_entry(uid_t uid)
+{
+	struct uid_entry *e;
+	struct hlist_node *node;
+
+	hlist_for_each_entry_rcu(e, node,
+				 &uid_hash_table[hash_32(uid, UID_HASH_BITS)],
+				 hash)
+		if (e->uid == uid)
+			return e;
+	return NULL;
+}
+
+/* called from the tick, with interrupts off */
+static struct uid_entry *find_or_add_uid_entry(uid_t uid)
+{
+	struct uid_entry *e;
+
+	e = find_uid_entry(uid);
+	if (e)
+		return e;
+
+	spin_lock(&uid_lock);
+	e = find_uid_entry(uid);
+	if (!e) {
+		e = kzalloc(sizeof(*e) + nr_freqs * sizeof(atomic64_t),
+			    GFP_ATOMIC);
+		if (e) {
+			e->uid = uid;
+			hlist_add_head_rcu(&e->hash,
+				&uid_hash_table[hash_32(uid, UID_HASH_BITS)]);
+		}
+	}
+	spin_unlock(&uid_lock);
+	return e;
+}
+
+void cpufreq_task_times_init(struct task_struct *p)
+{
+	unsigned int n = ACCESS_ONCE(nr_freqs);
+
+	/* dup_task_struct() copied the parent's pointer */
+	p->time_in_state = NULL;
+	p->max_state = 0;
+	if (!n)
+		return;
+
+	p->time_in_state = kcalloc(n, sizeof(cputime64_t), GFP_KERNEL);
+	if (p->time_in_state)
+		p->max_state = n;
+}
+
+void cpufreq_task_times_exit(struct task_struct *p)
+{
+	kfree(p->time_in_state);
+	p->time_in_state = NULL;
+}
+
+void cpufreq_task_times_account(struct task_struct *p, cputime_t cputime)
+{
+	int i = __get_cpu_var(freq_index);
+	struct uid_entry *e;
+
+	if (i < 0)
+		return;
+
+	/* tasks forked before the table was known get their array late */
+	if (unlikely(!p->time_in_state)) {
+		p->time_in_state = kcalloc(nr_freqs, sizeof(cputime64_t),
+					   GFP_ATOMIC);
+		if (p->time_in_state)
+			p->max_state = nr_freqs;
+	}
+	if (p->time_in_state)
+		p->time_in_state[i] = cputime64_add(p->time_in_state[i],
+					cputime_to_cputime64(cputime));
+
+	rcu_read_lock();
+	e = find_or_add_uid_entry(task_uid(p));
+	if (e)
+		atomic64_add(cputime_to_cputime64(cputime),
+			     &e->time_in_state[i]);
+	rcu_read_unlock();
+}
+
+int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
+			    struct pid *pid, struct task_struct *p)
+{
+	unsigned int i, n = ACCESS_ONCE(nr_freqs);
+
+	smp_rmb();
+	for (i = 0; i < n; i++) {
+		cputime64_t t = 0;
+
+		if (p->time_in_state && i < p->max_state)
+			t = p->time_in_state[i];
+		seq_printf(m, "%u %llu\n", freq_table[i],
+			   (unsigned long long)cputime64_to_clock_t(t));
+	}
+	return 0;
+}
+
+static int uid_time_in_state_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *e;
+	struct hlist_node *node;
+	unsigned int i;
+	unsigned int n = ACCESS_ONCE(nr_freqs);
+	int b;
+
+	smp_rmb();
+	seq_puts(m, "uid:");
+	for (i = 0; i < n; i++)
+		seq_printf(m, " %u", freq_table[i]);
+	seq_putc(m, '\n');
+
+	rcu_read_lock();
+	for (b = 0; b < UID_HASH_SIZE; b++) {
+		hlist_for_each_entry_rcu(e, node, &uid_hash_table[b], hash) {
+			seq_printf(m, "%u:", e->uid);
+			for (i = 0; i < n; i++)
+				seq_printf(m, " %llu", (unsigned long long)
+					cputime64_to_clock_t(
+					atomic64_read(&e->time_in_state[i])));
+			seq_putc(m, '\n');
+		}
+	}
+	rcu_read_unlock();
+	return 0;
+}
+
+static int uid_time_in_state_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_time_in_state_show, NULL);
+}
+
+static const struct file_operations uid_time_in_state_fops = {
+	.open		= uid_time_in_state_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* the first cpu with a frequency table gives the one of every cpu */
+static void cpufreq_times_create_table(unsigned int cpu)
+{
+	struct cpufreq_frequency_table *table;
+	unsigned int *freqs;
+	int i, n = 0;
+
+	if (nr_freqs)
+		return;
+	table = cpufreq_frequency_get_table(cpu);
+	if (!table)
+		return;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++)
+		n++;
+	freqs = kcalloc(n, sizeof(*freqs), GFP_KERNEL);
+	if (!freqs)
+		return;
+
+	n = 0;
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		unsigned int freq = table[i].frequency;
+		int j;
+
+		if (freq == CPUFREQ_ENTRY_INVALID)
+			continue;
+		for (j = 0; j < n && freqs[j] != freq; j++)
+			;
+		if (j == n)
+			freqs[n++] = freq;
+	}
+
+	spin_lock(&freq_table_lock);
+	if (!nr_freqs && n) {
+		freq_table = freqs;
+		freqs = NULL;
+		/* the table before its size, the size before any index */
+		smp_wmb();
+		nr_freqs = n;
+	}
+	spin_unlock(&freq_table_lock);
+	kfree(freqs);
+}
+
+static int cpufreq_times_policy_notifier(struct notifier_block *nb,
+					 unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	unsigned int cpu;
+
+	if (val != CPUFREQ_NOTIFY)
+		return 0;
+
+	cpufreq_times_create_table(policy->cpu);
+	if (!nr_freqs)
+		return 0;
+	smp_rmb();
+	for_each_cpu(cpu, policy->cpus)
+		per_cpu(freq_index, cpu) = freq_to_index(policy->cur);
+	return 0;
+}
+
+static int cpufreq_times_transition_notifier(struct notifier_block *nb,
+					     unsigned long val, void *data)
+{
+	struct cpufreq_freqs *freq = data;
+
+	if (val != CPUFREQ_POSTCHANGE || !nr_freqs)
+		return 0;
+	smp_rmb();
+	per_cpu(freq_index, freq->cpu) = freq_to_index(freq->new);
+	return 0;
+}
+
+static struct notifier_block cpufreq_times_policy_nb = {
+	.notifier_call = cpufreq_times_policy_notifier,
+};
+
+static struct notifier_block cpufreq_times_transition_nb = {
+	.notifier_call = cpufreq_times_transition_notifier,
+};
+
+static int __init cpufreq_times_init(void)
+{
+	unsigned int cpu;
+
+	cpufreq_register_notifier(&cpufreq_times_policy_nb,
+				  CPUFREQ_POLICY_NOTIFIER);
+	cpufreq_register_notifier(&cpufreq_times_transition_nb,
+				  CPUFREQ_TRANSITION_NOTIFIER);
+	for_each_online_cpu(cpu)
+		cpufreq_update_policy(cpu);
+
+	proc_create("uid_time_in_state", S_IRUGO, NULL,
+		    &uid_time_in_state_fops);
+	return 0;
+}
+late_initcall(cpufreq_times_init);
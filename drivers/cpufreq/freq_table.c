@@ -325,6 +325,113 @@ struct cpufreq_frequency_table *cpufreq_frequency_get_table(unsigned int cpu)
 }
 EXPORT_SYMBOL_GPL(cpufreq_frequency_get_table);
 
+static DEFINE_PER_CPU(const unsigned int *, cpufreq_energy_table);
+
+/**
+ * cpufreq_frequency_table_set_energy - attach energy estimates to a table
+ * @energy: energy per cycle, in pJ, of each entry of the table passed to
+ *	    cpufreq_frequency_table_get_attr(), or NULL to drop them
+ * @cpu: cpu the table was registered for
+ *
+ * Same lifetime rules as cpufreq_frequency_table_get_attr().
+ */
+void cpufreq_frequency_table_set_energy(const unsigned int *energy,
+					unsigned int cpu)
+{
+	per_cpu(cpufreq_energy_table, cpu) = energy;
+}
+EXPORT_SYMBOL_GPL(cpufreq_frequency_table_set_energy);
+
+/* higher entry of @table costing no more per cycle than entry @i, or -1 */
+static int cpufreq_frequency_table_better(struct cpufreq_frequency_table *table,
+		const unsigned int *energy, unsigned int i, unsigned int max)
+{
+	unsigned int freq = table[i].frequency;
+	int best = -1;
+	unsigned int j;
+
+	for (j = 0; table[j].frequency != CPUFREQ_TABLE_END; j++) {
+		unsigned int f = table[j].frequency;
+
+		if (f == CPUFREQ_ENTRY_INVALID || f <= freq || f > max)
+			continue;
+		if (energy[j] > energy[i])
+			continue;
+		if (best < 0 || energy[j] < energy[best] ||
+		    (energy[j] == energy[best] && f < table[best].frequency))
+			best = j;
+	}
+
+	return best;
+}
+
+/**
+ * cpufreq_frequency_table_efficient - skip inefficient frequencies
+ * @policy: policy the frequency is meant for
+ * @table: frequency table of @policy
+ * @freq: frequency picked from @table
+ *
+ * Returns the frequency to run instead of @freq: a higher one within
+ * policy->max whose energy per cycle is no higher, so the same work is
+ * done both sooner and cheaper, or @freq itself if there is none or no
+ * energy estimates were registered.
+ */
+unsigned int cpufreq_frequency_table_efficient(struct cpufreq_policy *policy,
+		struct cpufreq_frequency_table *table, unsigned int freq)
+{
+	const unsigned int *energy = per_cpu(cpufreq_energy_table, policy->cpu);
+	unsigned int i;
+	int best;
+
+	if (!energy || table != per_cpu(cpufreq_show_table, policy->cpu))
+		return freq;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		if (table[i].frequency != freq)
+			continue;
+		best = cpufreq_frequency_table_better(table, energy, i,
+						      policy->max);
+		return best < 0 ? freq : table[best].frequency;
+	}
+
+	return freq;
+}
+EXPORT_SYMBOL_GPL(cpufreq_frequency_table_efficient);
+
+/**
+ * show_energy_per_cycle - show the energy estimate of each frequency
+ */
+static ssize_t show_energy_per_cycle(struct cpufreq_policy *policy, char *buf)
+{
+	unsigned int cpu = policy->cpu;
+	struct cpufreq_frequency_table *table = per_cpu(cpufreq_show_table, cpu);
+	const unsigned int *energy = per_cpu(cpufreq_energy_table, cpu);
+	ssize_t count = 0;
+	unsigned int i;
+
+	if (!table || !energy)
+		return -ENODEV;
+
+	for (i = 0; (table[i].frequency != CPUFREQ_TABLE_END); i++) {
+		if (table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+		count += sprintf(&buf[count], "%u %u%s\n", table[i].frequency,
+			energy[i],
+			cpufreq_frequency_table_better(table, energy, i,
+				UINT_MAX) < 0 ? "" : " inefficient");
+	}
+
+	return count;
+}
+
+struct freq_attr cpufreq_freq_attr_scaling_energy_per_cycle = {
+	.attr = { .name = "scaling_energy_per_cycle",
+		  .mode = 0444,
+		},
+	.show = show_energy_per_cycle,
+};
+EXPORT_SYMBOL_GPL(cpufreq_freq_attr_scaling_energy_per_cycle);
+
 MODULE_AUTHOR("Dominik Brodowski <linux@brodo.de>");
 MODULE_DESCRIPTION("CPUfreq frequency table helpers");
 MODULE_LICENSE("GPL");
@@ -15,6 +15,7 @@
  */
 
 #include <linux/device.h>
+#include <linux/dma-buf.h>
 #include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/anon_inodes.h>
@@ -546,6 +547,263 @@ end:
 }
 EXPORT_SYMBOL(ion_import);
 
+/*
+ * dma-buf export.  An attachment's sg_table is built on its first map and
+ * kept until the attachment goes away: ion buffers never move, so an
+ * importer that holds on to its attachment maps a buffer once, not once
+ * per use.  Entries carry the bus address the device sees, which for the
+ * tiler is not backed by struct pages.
+ */
+struct ion_dma_buf_attachment {
+	struct sg_table table;
+	bool dmap;		/* holds a reference on buffer->dmap_cnt */
+};
+
+static struct sg_table *ion_dma_buf_map(struct dma_buf_attachment *attach,
+					enum dma_data_direction dir)
+{
+	struct ion_buffer *buffer = attach->dmabuf->priv;
+	struct ion_heap *heap = buffer->heap;
+	struct ion_dma_buf_attachment *a = attach->priv;
+	struct scatterlist *sg, *sglist;
+	ion_phys_addr_t addr;
+	size_t len;
+	int i, n, ret;
+
+	if (a)
+		return &a->table;
+
+	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	if (!a)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_lock(&buffer->lock);
+	if (heap->ops->phys) {
+		ret = heap->ops->phys(heap, buffer, &addr, &len);
+		if (ret)
+			goto err;
+		ret = sg_alloc_table(&a->table, 1, GFP_KERNEL);
+		if (ret)
+			goto err;
+		sg = a->table.sgl;
+		if (pfn_valid(addr >> PAGE_SHIFT))
+			sg_set_page(sg, phys_to_page(addr), len, 0);
+		else
+			sg->length = len;
+		sg_dma_address(sg) = addr;
+		sg_dma_len(sg) = len;
+	} else if (heap->ops->map_dma) {
+		if (!buffer->dmap_cnt) {
+			sglist = heap->ops->map_dma(heap, buffer);
+			if (IS_ERR_OR_NULL(sglist)) {
+				ret = sglist ? PTR_ERR(sglist) : -ENOMEM;
+				goto err;
+			}
+			buffer->sglist = sglist;
+		}
+		buffer->dmap_cnt++;
+		a->dmap = true;
+
+		n = PAGE_ALIGN(buffer->size) >> PAGE_SHIFT;
+		ret = sg_alloc_table(&a->table, n, GFP_KERNEL);
+		if (ret)
+			goto err;
+		for_each_sg(a->table.sgl, sg, n, i) {
+			sg_set_page(sg, sg_page(&buffer->sglist[i]),
+				    buffer->sglist[i].length,
+				    buffer->sglist[i].offset);
+			sg_dma_address(sg) = sg_phys(sg);
+			sg_dma_len(sg) = sg->length;
+		}
+	} else {
+		ret = -ENODEV;
+		goto err;
+	}
+	mutex_unlock(&buffer->lock);
+
+	attach->priv = a;
+	return &a->table;
+
+err:
+	if (a->dmap && --buffer->dmap_cnt == 0) {
+		heap->ops->unmap_dma(heap, buffer);
+		buffer->sglist = NULL;
+	}
+	mutex_unlock(&buffer->lock);
+	kfree(a);
+	return ERR_PTR(ret);
+}
+
+static void ion_dma_buf_unmap(struct dma_buf_attachment *attach,
+			      struct sg_table *table,
+			      enum dma_data_direction dir)
+{
+	/* the table lives as long as the attachment */
+}
+
+static void ion_dma_buf_detach(struct dma_buf *dmabuf,
+			       struct dma_buf_attachment *attach)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+	struct ion_dma_buf_attachment *a = attach->priv;
+
+	if (!a)
+		return;
+	sg_free_table(&a->table);
+	if (a->dmap) {
+		mutex_lock(&buffer->lock);
+		if (--buffer->dmap_cnt == 0) {
+			buffer->heap->ops->unmap_dma(buffer->heap, buffer);
+			buffer->sglist = NULL;
+		}
+		mutex_unlock(&buffer->lock);
+	}
+	kfree(a);
+	attach->priv = NULL;
+}
+
+static void ion_dma_buf_release(struct dma_buf *dmabuf)
+{
+	ion_buffer_put(dmabuf->priv);
+}
+
+static void *ion_dma_buf_kmap(struct dma_buf *dmabuf, unsigned long offset)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+	void *vaddr = NULL;
+
+	if (!buffer->heap->ops->map_kernel)
+		return NULL;
+
+	mutex_lock(&buffer->lock);
+	if (!buffer->kmap_cnt) {
+		vaddr = buffer->heap->ops->map_kernel(buffer->heap, buffer);
+		if (IS_ERR_OR_NULL(vaddr)) {
+			vaddr = NULL;
+			goto out;
+		}
+		buffer->vaddr = vaddr;
+	}
+	buffer->kmap_cnt++;
+	vaddr = buffer->vaddr + offset * PAGE_SIZE;
+out:
+	mutex_unlock(&buffer->lock);
+	return vaddr;
+}
+
+static void ion_dma_buf_kunmap(struct dma_buf *dmabuf, unsigned long offset,
+			       void *ptr)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	if (--buffer->kmap_cnt == 0) {
+		buffer->heap->ops->unmap_kernel(buffer->heap, buffer);
+		buffer->vaddr = NULL;
+	}
+	mutex_unlock(&buffer->lock);
+}
+
+/* only works on a buffer someone already holds mapped in the kernel */
+static void *ion_dma_buf_kmap_atomic(struct dma_buf *dmabuf,
+				     unsigned long offset)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	return buffer->vaddr ? buffer->vaddr + offset * PAGE_SIZE : NULL;
+}
+
+static int ion_dma_buf_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+	int ret;
+
+	if (!buffer->heap->ops->map_user)
+		return -EINVAL;
+
+	mutex_lock(&buffer->lock);
+	ret = buffer->heap->ops->map_user(buffer->heap, buffer, vma);
+	if (!ret && buffer->cached) {
+		buffer->dirty_start = 0;
+		buffer->dirty_end = buffer->size;
+	}
+	mutex_unlock(&buffer->lock);
+	return ret;
+}
+
+static const struct dma_buf_ops ion_dma_buf_ops = {
+	.detach		= ion_dma_buf_detach,
+	.map_dma_buf	= ion_dma_buf_map,
+	.unmap_dma_buf	= ion_dma_buf_unmap,
+	.release	= ion_dma_buf_release,
+	.kmap_atomic	= ion_dma_buf_kmap_atomic,
+	.kmap		= ion_dma_buf_kmap,
+	.kunmap		= ion_dma_buf_kunmap,
+	.mmap		= ion_dma_buf_mmap,
+};
+
+struct dma_buf *ion_share_dma_buf(struct ion_client *client,
+				  struct ion_handle *handle)
+{
+	struct ion_buffer *buffer;
+	struct dma_buf *dmabuf;
+	bool valid_handle;
+
+	mutex_lock(&client->lock);
+	valid_handle = ion_handle_validate(client, handle);
+	mutex_unlock(&client->lock);
+	if (!valid_handle) {
+		WARN(1, "%s: invalid handle passed to share.\n", __func__);
+		return ERR_PTR(-EINVAL);
+	}
+
+	buffer = handle->buffer;
+	ion_buffer_get(buffer);
+	dmabuf = dma_buf_export(buffer, &ion_dma_buf_ops, buffer->size,
+				O_RDWR);
+	if (IS_ERR(dmabuf))
+		ion_buffer_put(buffer);
+	return dmabuf;
+}
+EXPORT_SYMBOL(ion_share_dma_buf);
+
+int ion_share_dma_buf_fd(struct ion_client *client, struct ion_handle *handle)
+{
+	struct dma_buf *dmabuf;
+	int fd;
+
+	dmabuf = ion_share_dma_buf(client, handle);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	fd = dma_buf_fd(dmabuf, O_CLOEXEC);
+	if (fd < 0)
+		dma_buf_put(dmabuf);
+	return fd;
+}
+EXPORT_SYMBOL(ion_share_dma_buf_fd);
+
+struct ion_handle *ion_import_dma_buf(struct ion_client *client, int fd)
+{
+	struct dma_buf *dmabuf;
+	struct ion_handle *handle;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return ERR_CAST(dmabuf);
+	if (dmabuf->ops != &ion_dma_buf_ops) {
+		pr_err("%s: imported dma-buf was not exported by ion.\n",
+		       __func__);
+		handle = ERR_PTR(-EINVAL);
+		goto end;
+	}
+	handle = ion_import(client, dmabuf->priv);
+end:
+	dma_buf_put(dmabuf);
+	return handle;
+}
+EXPORT_SYMBOL(ion_import_dma_buf);
+
 static const struct file_operations ion_share_fops;
 
 struct ion_handle *ion_import_fd(struct ion_client *client, int fd)
@@ -558,13 +816,11 @@ struct ion_handle *ion_import_fd(struct ion_client *client, int fd)
 		return ERR_PTR(-EINVAL);
 	}
 	if (file->f_op != &ion_share_fops) {
-		pr_err("%s: imported file is not a shared ion file.\n",
-		       __func__);
-		handle = ERR_PTR(-EINVAL);
-		goto end;
+		/* importers of share fds take ion dma-bufs as well */
+		fput(file);
+		return ion_import_dma_buf(client, fd);
 	}
 	handle = ion_import(client, file->private_data);
-end:
 	fput(file);
 	return handle;
 }
@@ -576,6 +832,7 @@ static int ion_debug_client_show(struct seq_file *s, void *unused)
 	struct rb_node *n;
 	size_t sizes[ION_NUM_HEAPS] = {0};
 	const char *names[ION_NUM_HEAPS] = {0};
+	struct ion_heap *heaps[ION_NUM_HEAPS] = {0};
 	int i;
 
 	mutex_lock(&client->lock);
@@ -584,8 +841,10 @@ static int ion_debug_client_show(struct seq_file *s, void *unused)
 						     node);
 		enum ion_heap_type type = handle->buffer->heap->type;
 
-		if (!names[type])
+		if (!names[type]) {
 			names[type] = handle->buffer->heap->name;
+			heaps[type] = handle->buffer->heap;
+		}
 		sizes[type] += handle->buffer->size;
 	}
 	mutex_unlock(&client->lock);
@@ -597,6 +856,14 @@ static int ion_debug_client_show(struct seq_file *s, void *unused)
 		seq_printf(s, "%16.16s: %16u %d\n", names[i], sizes[i],
 			   atomic_read(&client->ref.refcount));
 	}
+
+	/* heaps are never destroyed while clients exist */
+	for (i = 0; i < ION_NUM_HEAPS; i++) {
+		if (!heaps[i] || !heaps[i]->ops->debug_show)
+			continue;
+		seq_printf(s, "\n%16.16s:\n", names[i]);
+		heaps[i]->ops->debug_show(heaps[i], s);
+	}
 	return 0;
 }
 
@@ -873,6 +1140,11 @@ static int ion_share_mmap(struct file *file, struct vm_area_struct *vma)
 	mutex_lock(&buffer->lock);
 	/* now map it to userspace */
 	ret = buffer->heap->ops->map_user(buffer->heap, buffer, vma);
+	/* nothing is known about what a new cacheable mapping writes */
+	if (!ret && buffer->cached) {
+		buffer->dirty_start = 0;
+		buffer->dirty_end = buffer->size;
+	}
 	mutex_unlock(&buffer->lock);
 	if (ret) {
 		pr_err("%s: failure mapping buffer to userspace\n",
@@ -900,6 +1172,19 @@ err:
 	return ret;
 }
 
+/*
+ * Drop [start, end) from the buffer's dirty region.  The region is a single
+ * range, so a hole in its middle leaves it as is.
+ */
+static void ion_buffer_clean_range(struct ion_buffer *buffer, size_t start,
+				   size_t end)
+{
+	if (start <= buffer->dirty_start && end > buffer->dirty_start)
+		buffer->dirty_start = min(end, buffer->dirty_end);
+	if (end >= buffer->dirty_end && start < buffer->dirty_end)
+		buffer->dirty_end = max(start, buffer->dirty_start);
+}
+
 static int ion_flush_cached(struct ion_handle *handle, size_t size,
 			   unsigned long vaddr)
 {
@@ -917,6 +1202,8 @@ static int ion_flush_cached(struct ion_handle *handle, size_t size,
 	mutex_lock(&buffer->lock);
 	/* now flush buffer mapped to userspace */
 	ret = buffer->heap->ops->flush_user(buffer, size, vaddr);
+	if (!ret)
+		ion_buffer_clean_range(buffer, 0, size);
 	mutex_unlock(&buffer->lock);
 	if (ret) {
 		pr_err("%s: failure flushing buffer\n",
@@ -944,6 +1231,8 @@ static int ion_inval_cached(struct ion_handle *handle, size_t size,
 	mutex_lock(&buffer->lock);
 	/* now flush buffer mapped to userspace */
 	ret = buffer->heap->ops->inval_user(buffer, size, vaddr);
+	if (!ret)
+		ion_buffer_clean_range(buffer, 0, size);
 	mutex_unlock(&buffer->lock);
 	if (ret) {
 		pr_err("%s: failure invalidating buffer\n",
@@ -954,6 +1243,58 @@ static int ion_inval_cached(struct ion_handle *handle, size_t size,
 	return 0;
 }
 
+static int ion_cache_range(struct ion_handle *handle,
+			   struct ion_cached_user_range_data *data)
+{
+	struct ion_buffer *buffer = handle->buffer;
+	size_t start = data->offset;
+	size_t end = data->offset + data->size;
+	int ret = 0;
+
+	if (!buffer->heap->ops->cache_range) {
+		pr_err("%s: this heap does not define a method for range cache "
+		       "maintenance\n", __func__);
+		return -EINVAL;
+	}
+	if (data->op > ION_CACHE_OP_MARK_DIRTY || end < start ||
+	    end > buffer->size)
+		return -EINVAL;
+
+	mutex_lock(&buffer->lock);
+	if (data->op == ION_CACHE_OP_MARK_DIRTY) {
+		if (start == end)
+			goto out;
+		if (buffer->dirty_start == buffer->dirty_end) {
+			buffer->dirty_start = start;
+			buffer->dirty_end = end;
+		} else {
+			buffer->dirty_start = min(buffer->dirty_start, start);
+			buffer->dirty_end = max(buffer->dirty_end, end);
+		}
+		goto out;
+	}
+
+	/*
+	 * Invalidation is about what devices wrote, which the dirty region
+	 * says nothing about, so only cleans are cut down to it.
+	 */
+	if ((data->flags & ION_CACHE_RANGE_DIRTY_ONLY) &&
+	    data->op != ION_CACHE_OP_INVALIDATE) {
+		start = max(start, buffer->dirty_start);
+		end = min(end, buffer->dirty_end);
+	}
+	if (start >= end)
+		goto out;
+
+	ret = buffer->heap->ops->cache_range(buffer, start, end - start,
+					     data->vaddr, data->op);
+	if (!ret)
+		ion_buffer_clean_range(buffer, start, end);
+out:
+	mutex_unlock(&buffer->lock);
+	return ret;
+}
+
 static const struct file_operations ion_share_fops = {
 	.owner		= THIS_MODULE,
 	.release	= ion_share_release,
@@ -1039,6 +1380,19 @@ static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			return -EFAULT;
 		break;
 	}
+	case ION_IOC_SHARE_DMA_BUF:
+	{
+		struct ion_fd_data data;
+
+		if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+			return -EFAULT;
+		data.fd = ion_share_dma_buf_fd(client, data.handle);
+		if (data.fd < 0)
+			return data.fd;
+		if (copy_to_user((void __user *)arg, &data, sizeof(data)))
+			return -EFAULT;
+		break;
+	}
 	case ION_IOC_IMPORT:
 	{
 		struct ion_fd_data data;
@@ -1111,6 +1465,25 @@ static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		break;
 	}
 
+	case ION_IOC_CACHE_RANGE:
+	{
+		struct ion_cached_user_range_data data;
+		bool valid;
+
+		if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+			return -EFAULT;
+		mutex_lock(&client->lock);
+		valid = ion_handle_validate(client, data.handle);
+		mutex_unlock(&client->lock);
+		if (!valid) {
+			pr_err("%s: invalid handle passed to cache range "
+			       "ioctl.\n", __func__);
+			return -EINVAL;
+		}
+
+		return ion_cache_range(data.handle, &data);
+	}
+
 	default:
 		return -ENOTTY;
 	}
@@ -1195,6 +1568,11 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 		seq_printf(s, "%16.s %16u %16u\n", client->name, client->pid,
 			   size);
 	}
+
+	if (heap->ops->debug_show) {
+		seq_printf(s, "\n");
+		heap->ops->debug_show(heap, s);
+	}
 	return 0;
 }
 
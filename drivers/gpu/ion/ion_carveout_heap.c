@@ -127,8 +127,10 @@ static void per_cpu_cache_flush_arm(void *arg)
 	flush_cache_all();
 }
 
-int ion_carveout_heap_cache_operation(struct ion_buffer *buffer, size_t len,
-			unsigned long vaddr, enum cache_operation cacheop)
+static int ion_carveout_heap_cache_range(struct ion_buffer *buffer,
+					 size_t offset, size_t len,
+					 unsigned long vaddr,
+					 enum cache_operation cacheop)
 {
 	if (!buffer || !buffer->cached) {
 		pr_err("%s(): buffer not mapped as cacheable\n",
@@ -136,20 +138,45 @@ int ion_carveout_heap_cache_operation(struct ion_buffer *buffer, size_t len,
 		return -EINVAL;
 	}
 
-	if (len > FULL_CACHE_FLUSH_THRESHOLD) {
+	ion_cache_maintenance(vaddr + offset, buffer->priv_phys + offset, len,
+			      cacheop);
+	return 0;
+}
+
+void ion_cache_maintenance(unsigned long vaddr, ion_phys_addr_t paddr,
+			   size_t len, enum cache_operation op)
+{
+	/*
+	 * by line operations cost in proportion to the range while set/way
+	 * ones cost a fixed amount, so switch over separately for each level
+	 */
+	if (len > FULL_CACHE_FLUSH_THRESHOLD)
 		on_each_cpu(per_cpu_cache_flush_arm, NULL, 1);
+	else
+		flush_cache_user_range(vaddr, vaddr + len);
+
+	if (len > OUTER_FULL_CACHE_FLUSH_THRESHOLD) {
 		outer_flush_all();
-		return 0;
+		return;
 	}
 
-	flush_cache_user_range(vaddr, (vaddr+len));
-
-	if (cacheop == CACHE_FLUSH)
-		outer_flush_range(buffer->priv_phys, buffer->priv_phys+len);
-	else
-		outer_inv_range(buffer->priv_phys, buffer->priv_phys+len);
+	switch (op) {
+	case CACHE_CLEAN:
+		outer_clean_range(paddr, paddr + len);
+		break;
+	case CACHE_INVALIDATE:
+		outer_inv_range(paddr, paddr + len);
+		break;
+	default:
+		outer_flush_range(paddr, paddr + len);
+		break;
+	}
+}
 
-	return 0;
+int ion_carveout_heap_cache_operation(struct ion_buffer *buffer, size_t len,
+			unsigned long vaddr, enum cache_operation cacheop)
+{
+	return ion_carveout_heap_cache_range(buffer, 0, len, vaddr, cacheop);
 }
 
 int ion_carveout_heap_flush_user(struct ion_buffer *buffer, size_t len,
@@ -172,6 +199,7 @@ static struct ion_heap_ops carveout_heap_ops = {
 	.map_user = ion_carveout_heap_map_user,
 	.flush_user = ion_carveout_heap_flush_user,
 	.inval_user = ion_carveout_heap_inval_user,
+	.cache_range = ion_carveout_heap_cache_range,
 	.map_kernel = ion_carveout_heap_map_kernel,
 	.unmap_kernel = ion_carveout_heap_unmap_kernel,
 };
@@ -0,0 +1,262 @@
+/*
+ * drivers/gpu/ion/ion_page_pool.c
+ *
+ * Copyright (C) 2011 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/err.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include "ion_priv.h"
+
+/* all pools, walked by the shrinker */
+static LIST_HEAD(ion_page_pools);
+static DEFINE_MUTEX(ion_page_pools_lock);
+
+/*
+ * Pages handed out by a pool must be visible to devices without any further
+ * cache maintenance, so push the zeroes written through the cpu out to
+ * memory once, when the pages enter the pool, rather than on every
+ * allocation.
+ */
+static void ion_page_pool_sync_for_device(struct page *page,
+					  unsigned int order)
+{
+#ifdef CONFIG_ARM
+	/*
+	 * this is only being used to flush the page for dma, there is no
+	 * better interface for a driver to do so at this time
+	 */
+	__dma_page_cpu_to_dev(page, 0, PAGE_SIZE << order, DMA_BIDIRECTIONAL);
+#endif
+}
+
+/*
+ * Blocks handed out count as pinned, NR_ION_PAGES, and blocks kept in a
+ * pool as reclaimable, NR_ION_POOL_PAGES, as the shrinker may free them.
+ */
+static void ion_page_pool_account(struct page *page, unsigned int order,
+				  enum zone_stat_item from,
+				  enum zone_stat_item to)
+{
+	struct zone *zone = page_zone(page);
+
+	mod_zone_page_state(zone, from, -(1 << order));
+	mod_zone_page_state(zone, to, 1 << order);
+}
+
+static struct page *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
+{
+	struct page *page;
+
+	page = alloc_pages(pool->gfp_mask | __GFP_ZERO, pool->order);
+	if (!page)
+		return NULL;
+	mod_zone_page_state(page_zone(page), NR_ION_PAGES, 1 << pool->order);
+	/*
+	 * callers map and insert the pages one at a time, so every page of
+	 * the block needs its own reference count
+	 */
+	if (pool->order)
+		split_page(page, pool->order);
+	ion_page_pool_sync_for_device(page, pool->order);
+	return page;
+}
+
+static void ion_page_pool_free_pages(struct ion_page_pool *pool,
+				     struct page *page)
+{
+	int i;
+
+	mod_zone_page_state(page_zone(page), NR_ION_PAGES,
+			    -(1 << pool->order));
+	for (i = 0; i < (1 << pool->order); i++)
+		__free_page(page + i);
+}
+
+/**
+ * ion_page_pool_alloc - get a zeroed, flushed block from a pool
+ * @pool:		the pool
+ *
+ * Falls back to the page allocator when the pool is empty.  The block is
+ * returned split, so each of its 1 << order pages may be freed on its own;
+ * ion_page_pool_free() however expects the block back as a whole.
+ */
+struct page *ion_page_pool_alloc(struct ion_page_pool *pool)
+{
+	struct page *page = NULL;
+
+	mutex_lock(&pool->lock);
+	if (pool->count) {
+		page = list_first_entry(&pool->items, struct page, lru);
+		list_del(&page->lru);
+		pool->count--;
+		pool->hits++;
+		ion_page_pool_account(page, pool->order, NR_ION_POOL_PAGES,
+				      NR_ION_PAGES);
+	} else {
+		pool->misses++;
+	}
+	mutex_unlock(&pool->lock);
+
+	if (!page)
+		page = ion_page_pool_alloc_pages(pool);
+	return page;
+}
+
+/**
+ * ion_page_pool_free - return a block obtained from ion_page_pool_alloc
+ * @pool:		the pool the block came from
+ * @page:		first page of the block
+ *
+ * The block is scrubbed before it is made available again, so it never
+ * carries the previous owner's data to the next one.
+ */
+void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
+{
+	int i;
+
+	mutex_lock(&pool->lock);
+	if (pool->count >= pool->max_count) {
+		mutex_unlock(&pool->lock);
+		ion_page_pool_free_pages(pool, page);
+		return;
+	}
+	mutex_unlock(&pool->lock);
+
+	for (i = 0; i < (1 << pool->order); i++)
+		clear_highpage(page + i);
+	ion_page_pool_sync_for_device(page, pool->order);
+
+	mutex_lock(&pool->lock);
+	list_add(&page->lru, &pool->items);
+	pool->count++;
+	ion_page_pool_account(page, pool->order, NR_ION_PAGES,
+			      NR_ION_POOL_PAGES);
+	mutex_unlock(&pool->lock);
+}
+
+/**
+ * ion_page_pool_shrink - release pooled blocks back to the page allocator
+ * @pool:		the pool
+ * @nr_to_scan:		number of pages to release, 0 only counts
+ *
+ * Returns the number of pages left in the pool.
+ */
+int ion_page_pool_shrink(struct ion_page_pool *pool, int nr_to_scan)
+{
+	int freed = 0;
+	int count;
+
+	while (freed < nr_to_scan) {
+		struct page *page;
+
+		mutex_lock(&pool->lock);
+		if (!pool->count) {
+			mutex_unlock(&pool->lock);
+			break;
+		}
+		page = list_first_entry(&pool->items, struct page, lru);
+		list_del(&page->lru);
+		pool->count--;
+		pool->shrunk++;
+		ion_page_pool_account(page, pool->order, NR_ION_POOL_PAGES,
+				      NR_ION_PAGES);
+		mutex_unlock(&pool->lock);
+
+		ion_page_pool_free_pages(pool, page);
+		freed += 1 << pool->order;
+	}
+
+	mutex_lock(&pool->lock);
+	count = pool->count << pool->order;
+	mutex_unlock(&pool->lock);
+	return count;
+}
+
+void ion_page_pool_debug_show(struct ion_page_pool *pool, struct seq_file *s)
+{
+	mutex_lock(&pool->lock);
+	seq_printf(s, "%16s %5u %8d %10lu %10lu %10lu %10lu\n", "pool",
+		   pool->order, pool->count,
+		   (unsigned long)(pool->count << pool->order) * PAGE_SIZE,
+		   pool->hits, pool->misses, pool->shrunk);
+	mutex_unlock(&pool->lock);
+}
+
+struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
+					   int max_count)
+{
+	struct ion_page_pool *pool;
+
+	pool = kzalloc(sizeof(struct ion_page_pool), GFP_KERNEL);
+	if (!pool)
+		return ERR_PTR(-ENOMEM);
+	INIT_LIST_HEAD(&pool->items);
+	mutex_init(&pool->lock);
+	pool->gfp_mask = gfp_mask;
+	pool->order = order;
+	pool->max_count = max_count;
+
+	mutex_lock(&ion_page_pools_lock);
+	list_add_tail(&pool->list, &ion_page_pools);
+	mutex_unlock(&ion_page_pools_lock);
+	return pool;
+}
+
+void ion_page_pool_destroy(struct ion_page_pool *pool)
+{
+	mutex_lock(&ion_page_pools_lock);
+	list_del(&pool->list);
+	mutex_unlock(&ion_page_pools_lock);
+
+	ion_page_pool_shrink(pool, INT_MAX);
+	kfree(pool);
+}
+
+static int ion_page_pool_shrinker_fn(struct shrinker *shrinker,
+				     struct shrink_control *sc)
+{
+	struct ion_page_pool *pool;
+	int nr_to_scan = sc->nr_to_scan;
+	int count = 0;
+
+	mutex_lock(&ion_page_pools_lock);
+	list_for_each_entry(pool, &ion_page_pools, list) {
+		int before, after;
+
+		before = ion_page_pool_shrink(pool, 0);
+		after = ion_page_pool_shrink(pool, nr_to_scan);
+		nr_to_scan = max(nr_to_scan - (before - after), 0);
+		count += after;
+	}
+	mutex_unlock(&ion_page_pools_lock);
+	return count;
+}
+
+static struct shrinker ion_page_pool_shrinker = {
+	.shrink = ion_page_pool_shrinker_fn,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int __init ion_page_pool_init(void)
+{
+	register_shrinker(&ion_page_pool_shrinker);
+	return 0;
+}
+device_initcall(ion_page_pool_init);
@@ -25,6 +25,7 @@
 #include <linux/miscdevice.h>
 
 struct ion_mapping;
+struct seq_file;
 
 struct ion_dma_mapping {
 	struct kref ref;
@@ -126,6 +127,8 @@ struct ion_buffer *ion_handle_buffer(struct ion_handle *handle);
  * @vaddr:		the kenrel mapping if kmap_cnt is not zero
  * @dmap_cnt:		number of times the buffer is mapped for dma
  * @sglist:		the scatterlist for the buffer is dmap_cnt is not zero
+ * @dirty_start:	start of the range cpu caches may hold dirty lines for
+ * @dirty_end:		end of that range, equal to dirty_start when clean
 */
 struct ion_buffer {
 	struct kref ref;
@@ -144,6 +147,14 @@ struct ion_buffer {
 	int dmap_cnt;
 	struct scatterlist *sglist;
 	bool cached;
+	size_t dirty_start;
+	size_t dirty_end;
+};
+
+enum cache_operation {
+	CACHE_CLEAN		= ION_CACHE_OP_CLEAN,
+	CACHE_INVALIDATE	= ION_CACHE_OP_INVALIDATE,
+	CACHE_FLUSH		= ION_CACHE_OP_FLUSH,
 };
 
 /**
@@ -159,6 +170,8 @@ struct ion_buffer {
  * @map_user		map memory to userspace
  * @flush_user		flush memory if mapped as cacheable
  * @inval_user		invalidate memory if mapped as cacheable
+ * @cache_range		clean, invalidate or flush part of a cacheable buffer
+ * @debug_show		print heap specific state to the debugfs files
  */
 struct ion_heap_ops {
 	int (*allocate) (struct ion_heap *heap,
@@ -178,6 +191,10 @@ struct ion_heap_ops {
 			unsigned long vaddr);
 	int (*inval_user) (struct ion_buffer *buffer, size_t len,
 			unsigned long vaddr);
+	int (*cache_range) (struct ion_buffer *buffer, size_t offset,
+			    size_t len, unsigned long vaddr,
+			    enum cache_operation op);
+	void (*debug_show) (struct ion_heap *heap, struct seq_file *s);
 };
 
 /**
@@ -258,6 +275,45 @@ ion_phys_addr_t ion_carveout_allocate(struct ion_heap *heap, unsigned long size,
 				      unsigned long align);
 void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
 		       unsigned long size);
+/**
+ * struct ion_page_pool - cache of zeroed, flushed blocks of a single order
+ * @count:		number of blocks in the pool
+ * @max_count:		blocks beyond this go straight back to the allocator
+ * @hits:		allocations satisfied from the pool
+ * @misses:		allocations that fell through to the page allocator
+ * @shrunk:		blocks released to the page allocator under pressure
+ * @items:		list of blocks, linked through the first page's lru
+ * @lock:		protects the count, stats and items list
+ * @gfp_mask:		gfp mask used when the pool is empty
+ * @order:		order of the blocks kept in this pool
+ * @list:		node in the list of pools walked by the shrinker
+ *
+ * Keeps freed buffers' pages around so heaps allocating at frame rate do
+ * not pay for the page allocator, zeroing and cache maintenance each time.
+ * Blocks are split, so each page can be mapped individually, but are
+ * always returned to the pool whole.
+ */
+struct ion_page_pool {
+	int count;
+	int max_count;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long shrunk;
+	struct list_head items;
+	struct mutex lock;
+	gfp_t gfp_mask;
+	unsigned int order;
+	struct list_head list;
+};
+
+struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
+					   int max_count);
+void ion_page_pool_destroy(struct ion_page_pool *);
+struct page *ion_page_pool_alloc(struct ion_page_pool *);
+void ion_page_pool_free(struct ion_page_pool *, struct page *);
+int ion_page_pool_shrink(struct ion_page_pool *pool, int nr_to_scan);
+void ion_page_pool_debug_show(struct ion_page_pool *pool, struct seq_file *s);
+
 /**
  * The carveout heap returns physical addresses, since 0 may be a valid
  * physical address, this is used to indicate allocation failed
@@ -271,10 +327,23 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  */
 #define FULL_CACHE_FLUSH_THRESHOLD 200000
 
-enum cache_operation {
-	CACHE_CLEAN		= 0x0,
-	CACHE_INVALIDATE	= 0x1,
-	CACHE_FLUSH		= 0x2,
-};
+/**
+ * The outer cache is much larger and slower to clean completely, so by line
+ * operations remain cheaper up to about its size
+ */
+#define OUTER_FULL_CACHE_FLUSH_THRESHOLD (1 << 20)
+
+/**
+ * ion_cache_maintenance - maintain a range mapped cacheable to userspace
+ * @vaddr:		user address of the range in the current process
+ * @paddr:		physical address of the range
+ * @len:		length of the range
+ * @op:			operation to apply
+ *
+ * Picks a by line or full cache operation for each level depending on the
+ * length of the range.
+ */
+void ion_cache_maintenance(unsigned long vaddr, ion_phys_addr_t paddr,
+			   size_t len, enum cache_operation op);
 
 #endif /* _ION_PRIV_H */
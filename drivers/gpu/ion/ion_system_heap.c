@@ -18,50 +18,116 @@
 #include <linux/ion.h>
 #include <linux/mm.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include "ion_priv.h"
 
+/*
+ * Buffers are built from the largest blocks that fit, so camera and video
+ * sized allocations take a handful of trips to the pools rather than one
+ * per page.  The index of the pool each block came from is kept in
+ * page_private() of its first page so free can hand it back to that pool.
+ */
+static const unsigned int orders[] = {8, 4, 0};
+#define NUM_ORDERS ARRAY_SIZE(orders)
+
+/* upper bound on the memory each pool holds on to between allocations */
+#define ION_SYSTEM_HEAP_POOL_SIZE	(8 << 20)
+
+struct ion_system_heap {
+	struct ion_heap heap;
+	struct ion_page_pool *pools[NUM_ORDERS];
+};
+
+static struct page *alloc_largest_available(struct ion_system_heap *heap,
+					    unsigned long size,
+					    unsigned int max_order)
+{
+	struct page *page;
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		if (size < (PAGE_SIZE << orders[i]))
+			continue;
+		if (max_order < orders[i])
+			continue;
+
+		page = ion_page_pool_alloc(heap->pools[i]);
+		if (!page)
+			continue;
+		set_page_private(page, i);
+		return page;
+	}
+	return NULL;
+}
+
+static void free_buffer_pages(struct ion_system_heap *heap,
+			      struct page **page_list, int n_pages)
+{
+	int i = 0;
+
+	while (i < n_pages) {
+		struct page *page = page_list[i];
+		int pool = page_private(page);
+
+		set_page_private(page, 0);
+		ion_page_pool_free(heap->pools[pool], page);
+		i += 1 << orders[pool];
+	}
+}
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				    struct ion_buffer *buffer,
 				    unsigned long size, unsigned long align,
 				    unsigned long flags)
 {
+	struct ion_system_heap *sys_heap = container_of(heap,
+							struct ion_system_heap,
+							heap);
 	int n_pages = PAGE_ALIGN(size) / PAGE_SIZE;
+	unsigned long size_remaining = PAGE_ALIGN(size);
+	unsigned int max_order = orders[0];
 	struct page **page_list;
-	const int gfp_mask = GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO;
 	int i = 0;
 
 	page_list = kmalloc(n_pages * sizeof(void *), GFP_KERNEL);
+	if (!page_list)
+		return -ENOMEM;
 
-	for (i = 0; i < n_pages; i++) {
-		page_list[i] = alloc_page(gfp_mask);
-		if (page_list[i] == NULL)
+	while (size_remaining > 0) {
+		struct page *page;
+		int j;
+
+		page = alloc_largest_available(sys_heap, size_remaining,
+					       max_order);
+		if (!page)
 			goto out;
+		/* no point retrying orders that have already failed */
+		max_order = orders[page_private(page)];
+		for (j = 0; j < (1 << max_order); j++)
+			page_list[i++] = page + j;
+		size_remaining -= PAGE_SIZE << max_order;
 	}
 
 	buffer->priv_virt = page_list;
 	return 0;
 
 out:
-	/* failed on i, so go to i-1 */
-	i--;
-
-	for (; i >= 0; i--)
-		__free_page(page_list[i]);
-
+	free_buffer_pages(sys_heap, page_list, i);
 	kfree(page_list);
 	return -ENOMEM;
 }
 
 void ion_system_heap_free(struct ion_buffer *buffer)
 {
-	int i;
+	struct ion_system_heap *sys_heap = container_of(buffer->heap,
+							struct ion_system_heap,
+							heap);
 	int n_pages = PAGE_ALIGN(buffer->size) / PAGE_SIZE;
 	struct page **page_list = (struct page **)buffer->priv_virt;
 
-	for (i = 0; i < n_pages; i++)
-		__free_page(page_list[i]);
+	free_buffer_pages(sys_heap, page_list, n_pages);
 	kfree(page_list);
 }
 
@@ -137,6 +203,20 @@ int ion_system_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 	return 0;
 }
 
+static void ion_system_heap_debug_show(struct ion_heap *heap,
+				       struct seq_file *s)
+{
+	struct ion_system_heap *sys_heap = container_of(heap,
+							struct ion_system_heap,
+							heap);
+	int i;
+
+	seq_printf(s, "%16s %5s %8s %10s %10s %10s %10s\n", "", "order",
+		   "blocks", "bytes", "hits", "misses", "shrunk");
+	for (i = 0; i < NUM_ORDERS; i++)
+		ion_page_pool_debug_show(sys_heap->pools[i], s);
+}
+
 static struct ion_heap_ops vmalloc_ops = {
 	.allocate = ion_system_heap_allocate,
 	.free = ion_system_heap_free,
@@ -145,23 +225,54 @@ static struct ion_heap_ops vmalloc_ops = {
 	.map_kernel = ion_system_heap_map_kernel,
 	.unmap_kernel = ion_system_heap_unmap_kernel,
 	.map_user = ion_system_heap_map_user,
+	.debug_show = ion_system_heap_debug_show,
 };
 
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 {
-	struct ion_heap *heap;
+	struct ion_system_heap *heap;
+	int i;
 
-	heap = kzalloc(sizeof(struct ion_heap), GFP_KERNEL);
+	heap = kzalloc(sizeof(struct ion_system_heap), GFP_KERNEL);
 	if (!heap)
 		return ERR_PTR(-ENOMEM);
-	heap->ops = &vmalloc_ops;
-	heap->type = ION_HEAP_TYPE_SYSTEM;
-	return heap;
+	heap->heap.ops = &vmalloc_ops;
+	heap->heap.type = ION_HEAP_TYPE_SYSTEM;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		gfp_t gfp_mask = GFP_KERNEL | __GFP_HIGHMEM;
+		struct ion_page_pool *pool;
+
+		/* large blocks are opportunistic, never dig into reclaim */
+		if (orders[i])
+			gfp_mask |= __GFP_NORETRY | __GFP_NOWARN;
+		pool = ion_page_pool_create(gfp_mask, orders[i],
+				(ION_SYSTEM_HEAP_POOL_SIZE >> PAGE_SHIFT) >>
+				orders[i]);
+		if (IS_ERR(pool))
+			goto err_create_pool;
+		heap->pools[i] = pool;
+	}
+	return &heap->heap;
+
+err_create_pool:
+	for (i = 0; i < NUM_ORDERS; i++)
+		if (heap->pools[i])
+			ion_page_pool_destroy(heap->pools[i]);
+	kfree(heap);
+	return ERR_PTR(-ENOMEM);
 }
 
 void ion_system_heap_destroy(struct ion_heap *heap)
 {
-	kfree(heap);
+	struct ion_system_heap *sys_heap = container_of(heap,
+							struct ion_system_heap,
+							heap);
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		ion_page_pool_destroy(sys_heap->pools[i]);
+	kfree(sys_heap);
 }
 
 static int ion_system_contig_heap_allocate(struct ion_heap *heap,
@@ -17,13 +17,20 @@
 
 #include <linux/err.h>
 #include <linux/genalloc.h>
+#include <linux/highmem.h>
 #include <linux/io.h>
 #include <linux/ion.h>
 #include <linux/mm.h>
 #include <linux/omap_ion.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <mach/tiler.h>
 #include <asm/cacheflush.h>
 #include <asm/mach/map.h>
@@ -35,10 +42,45 @@
 bool use_dynamic_pages;
 #define TILER_ENABLE_NON_PAGE_ALIGNED_ALLOCATIONS  1
 
+/*
+ * Freed containers of the pinned tiler heaps are kept, still pinned to
+ * their pages, so that buffers which are recycled with the same geometry
+ * (camera preview, video decode) skip both page allocation and pinning.
+ */
+#define OMAP_TILER_CACHE_DEPTH		16
+#define OMAP_TILER_CACHE_MAX_PAGES	((32 << 20) >> PAGE_SHIFT)
+
+/*
+ * Dynamic pages are taken in runs of up to 1 << OMAP_TILER_ALLOC_ORDER
+ * while the page allocator has them at hand, which means fewer trips
+ * through it and one outer cache flush per run.  A run is split, the tiler
+ * pins and frees single pages.  Runs are only tried without reclaim: a
+ * fragmented system falls back to single pages rather than stalling.
+ */
+#define OMAP_TILER_ALLOC_ORDER		4
+#define OMAP_TILER_GFP			(GFP_HIGHUSER | __GFP_ZERO)
+#define OMAP_TILER_GFP_RUN		(OMAP_TILER_GFP | __GFP_NORETRY | \
+					 __GFP_NOWARN | __GFP_NO_KSWAPD)
+
 struct omap_ion_heap {
 	struct ion_heap heap;
 	struct gen_pool *pool;
 	ion_phys_addr_t base;
+	struct mutex cache_lock;	/* protects the fields below */
+	struct list_head cache;		/* most recently freed first */
+	int cache_count;
+	u32 cache_pages;
+	unsigned long cache_hits;
+	unsigned long cache_misses;
+	u32 shrink_target;		/* pages to keep after shrink_work */
+	struct shrinker shrinker;
+	struct work_struct shrink_work;
+	/* allocations, cache hits included, under cache_lock */
+	unsigned long allocs;
+	u64 alloc_ns;
+	u64 max_alloc_ns;
+	unsigned long run_pages;	/* dynamic pages taken in runs */
+	unsigned long single_pages;	/* and one at a time */
 };
 
 struct omap_tiler_info {
@@ -52,8 +94,17 @@ struct omap_tiler_info {
 	u32 tiler_start;                /* start addr in tiler -- if not page
 					   aligned this may not equal the
 					   first entry onf tiler_addrs */
+	u32 w, h;                       /* requested geometry */
+	u32 token, out_align, offset;   /* requested placement */
+	struct list_head cache_node;    /* entry in the heap's cache */
 };
 
+static bool omap_tiler_heap_pinned(struct ion_heap *heap)
+{
+	return heap->id == OMAP_ION_HEAP_TILER ||
+	       heap->id == OMAP_ION_HEAP_NONSECURE_TILER;
+}
+
 static int omap_tiler_heap_allocate(struct ion_heap *heap,
 				    struct ion_buffer *buffer,
 				    unsigned long size, unsigned long align,
@@ -120,34 +171,60 @@ static void omap_tiler_free_carveout(struct ion_heap *heap,
 		gen_pool_free(omap_heap->pool, info->phys_addrs[i], PAGE_SIZE);
 }
 
-static int omap_tiler_alloc_dynamicpages(struct omap_tiler_info *info)
+static int omap_tiler_alloc_dynamicpages(struct ion_heap *heap,
+					 struct omap_tiler_info *info)
 {
-	int i;
-	int ret;
+	struct omap_ion_heap *omap_heap = (struct omap_ion_heap *)heap;
+	int order = OMAP_TILER_ALLOC_ORDER;
+	unsigned long run_pages = 0;
 	struct page *pg;
-
-	for (i = 0; i < info->n_phys_pages; i++) {
-		pg = alloc_page(GFP_KERNEL | GFP_DMA | GFP_HIGHUSER);
+	u32 i = 0, j;
+	void *va;
+
+	while (i < info->n_phys_pages) {
+		while (order && (1 << order) > info->n_phys_pages - i)
+			order--;
+
+		pg = alloc_pages(order ? OMAP_TILER_GFP_RUN : OMAP_TILER_GFP,
+				 order);
+		if (!pg && order) {
+			order--;
+			continue;
+		}
 		if (!pg) {
-			ret = -ENOMEM;
-			pr_err("%s: alloc_page failed\n",
-				__func__);
+			pr_err("%s: alloc_page failed\n", __func__);
 			goto err_page_alloc;
 		}
-		info->phys_addrs[i] = page_to_phys(pg);
-		dmac_flush_range((void *)page_address(pg),
-			(void *)page_address(pg) + PAGE_SIZE);
-		outer_flush_range(info->phys_addrs[i],
-			info->phys_addrs[i] + PAGE_SIZE);
+
+		mod_zone_page_state(page_zone(pg), NR_ION_PAGES, 1 << order);
+		if (order) {
+			split_page(pg, order);
+			run_pages += 1 << order;
+		}
+		for (j = 0; j < (1 << order); j++) {
+			va = kmap_atomic(pg + j, KM_USER0);
+			dmac_flush_range(va, va + PAGE_SIZE);
+			kunmap_atomic(va, KM_USER0);
+			info->phys_addrs[i + j] = page_to_phys(pg + j);
+		}
+		outer_flush_range(page_to_phys(pg),
+				  page_to_phys(pg) + (PAGE_SIZE << order));
+		i += 1 << order;
 	}
+
+	mutex_lock(&omap_heap->cache_lock);
+	omap_heap->run_pages += run_pages;
+	omap_heap->single_pages += info->n_phys_pages - run_pages;
+	mutex_unlock(&omap_heap->cache_lock);
 	return 0;
 
 err_page_alloc:
-	for (i -= 1; i >= 0; i--) {
+	while (i--) {
 		pg = phys_to_page(info->phys_addrs[i]);
+		dec_zone_page_state(pg, NR_ION_PAGES);
 		__free_page(pg);
 	}
-	return ret;
+	return -ENOMEM;
 }
 
 static void omap_tiler_free_dynamicpages(struct omap_tiler_info *info)
@@ -157,11 +234,188 @@ static void omap_tiler_free_dynamicpages(struct omap_tiler_info *info)
 
 	for (i = 0; i < info->n_phys_pages; i++) {
 		pg = phys_to_page(info->phys_addrs[i]);
+		dec_zone_page_state(pg, NR_ION_PAGES);
 		__free_page(pg);
 	}
 	return;
 }
 
+static void omap_tiler_release(struct ion_heap *heap,
+			       struct omap_tiler_info *info)
+{
+	tiler_unpin_block(info->tiler_handle);
+	tiler_free_block_area(info->tiler_handle);
+
+	if (omap_tiler_heap_pinned(heap)) {
+		if (use_dynamic_pages)
+			omap_tiler_free_dynamicpages(info);
+		else
+			omap_tiler_free_carveout(heap, info);
+	}
+
+	kfree(info);
+}
+
+static struct omap_tiler_info *omap_tiler_cache_get(struct ion_heap *heap,
+				struct omap_ion_tiler_alloc_data *data)
+{
+	struct omap_ion_heap *omap_heap = (struct omap_ion_heap *)heap;
+	struct omap_tiler_info *info;
+
+	if (!omap_tiler_heap_pinned(heap))
+		return NULL;
+
+	mutex_lock(&omap_heap->cache_lock);
+	list_for_each_entry(info, &omap_heap->cache, cache_node) {
+		if (info->fmt != data->fmt || info->w != data->w ||
+		    info->h != data->h || info->token != data->token)
+			continue;
+		if (data->token && (info->out_align != data->out_align ||
+				    info->offset != data->offset))
+			continue;
+
+		list_del(&info->cache_node);
+		omap_heap->cache_count--;
+		omap_heap->cache_pages -= info->n_phys_pages;
+		omap_heap->cache_hits++;
+		mutex_unlock(&omap_heap->cache_lock);
+		return info;
+	}
+	omap_heap->cache_misses++;
+	mutex_unlock(&omap_heap->cache_lock);
+	return NULL;
+}
+
+/*
+ * Drop cached containers, oldest first, until at most @count entries and
+ * @pages pages remain.  Returns the number of pages released.
+ */
+static u32 omap_tiler_cache_trim(struct ion_heap *heap, int count, u32 pages)
+{
+	struct omap_ion_heap *omap_heap = (struct omap_ion_heap *)heap;
+	struct omap_tiler_info *info, *tmp;
+	LIST_HEAD(evict);
+	u32 freed = 0;
+
+	mutex_lock(&omap_heap->cache_lock);
+	while (omap_heap->cache_count > count ||
+	       omap_heap->cache_pages > pages) {
+		info = list_entry(omap_heap->cache.prev,
+				  struct omap_tiler_info, cache_node);
+		list_move(&info->cache_node, &evict);
+		omap_heap->cache_count--;
+		omap_heap->cache_pages -= info->n_phys_pages;
+		freed += info->n_phys_pages;
+	}
+	mutex_unlock(&omap_heap->cache_lock);
+
+	/* unpinning and freeing may sleep, keep it out of the lock */
+	list_for_each_entry_safe(info, tmp, &evict, cache_node)
+		omap_tiler_release(heap, info);
+	return freed;
+}
+
+/*
+ * A container taken from the cache may go to another process: scrub the
+ * previous owner's data (camera, video frames) first.  Dynamic and
+ * carveout pages alike are mapped once, uncached, for the whole
+ * container, the way the carveout heap maps its buffers, so no cache
+ * maintenance is needed.
+ */
+static int omap_tiler_clear(struct omap_tiler_info *info)
+{
+	const struct mem_type *mt = get_mem_type(MT_MEMORY_NONCACHED);
+	size_t size = info->n_phys_pages * PAGE_SIZE;
+	struct vm_struct *area;
+	unsigned long va;
+	int ret = 0;
+	u32 i;
+
+	area = get_vm_area(size, VM_IOREMAP);
+	if (!area)
+		return -ENOMEM;
+
+	va = (unsigned long)area->addr;
+	for (i = 0; i < info->n_phys_pages && !ret; i++)
+		ret = ioremap_page(va + i * PAGE_SIZE, info->phys_addrs[i], mt);
+	if (!ret) {
+		memset(area->addr, 0, size);
+		wmb();
+	}
+
+	free_vm_area(area);
+	return ret;
+}
+
+static void omap_tiler_cache_put(struct ion_heap *heap,
+				 struct omap_tiler_info *info)
+{
+	struct omap_ion_heap *omap_heap = (struct omap_ion_heap *)heap;
+
+	if (!omap_tiler_heap_pinned(heap) ||
+	    info->n_phys_pages > OMAP_TILER_CACHE_MAX_PAGES) {
+		omap_tiler_release(heap, info);
+		return;
+	}
+
+	mutex_lock(&omap_heap->cache_lock);
+	list_add(&info->cache_node, &omap_heap->cache);
+	omap_heap->cache_count++;
+	omap_heap->cache_pages += info->n_phys_pages;
+	mutex_unlock(&omap_heap->cache_lock);
+
+	omap_tiler_cache_trim(heap, OMAP_TILER_CACHE_DEPTH,
+			      OMAP_TILER_CACHE_MAX_PAGES);
+}
+
+static void omap_tiler_cache_shrink_work(struct work_struct *work)
+{
+	struct omap_ion_heap *omap_heap = container_of(work,
+						       struct omap_ion_heap,
+						       shrink_work);
+	u32 target;
+
+	mutex_lock(&omap_heap->cache_lock);
+	target = omap_heap->shrink_target;
+	mutex_unlock(&omap_heap->cache_lock);
+	omap_tiler_cache_trim(&omap_heap->heap, INT_MAX, target);
+}
+
+/*
+ * Reclaim can be entered from inside the tiler driver, which would then
+ * be re-entered to unpin, so the cache is trimmed from a work item.
+ */
+static int omap_tiler_cache_shrink(struct shrinker *shrinker,
+				   struct shrink_control *sc)
+{
+	struct omap_ion_heap *omap_heap = container_of(shrinker,
+						       struct omap_ion_heap,
+						       shrinker);
+	u32 pages;
+
+	mutex_lock(&omap_heap->cache_lock);
+	pages = omap_heap->cache_pages;
+	if (sc->nr_to_scan && pages) {
+		omap_heap->shrink_target = pages > sc->nr_to_scan ?
+					   pages - sc->nr_to_scan : 0;
+		schedule_work(&omap_heap->shrink_work);
+	}
+	mutex_unlock(&omap_heap->cache_lock);
+	return pages;
+}
+
+static void omap_tiler_account_alloc(struct ion_heap *heap, u64 ns)
+{
+	struct omap_ion_heap *omap_heap = (struct omap_ion_heap *)heap;
+
+	mutex_lock(&omap_heap->cache_lock);
+	omap_heap->allocs++;
+	omap_heap->alloc_ns += ns;
+	if (ns > omap_heap->max_alloc_ns)
+		omap_heap->max_alloc_ns = ns;
+	mutex_unlock(&omap_heap->cache_lock);
+}
+
 int omap_tiler_alloc(struct ion_heap *heap,
 		     struct ion_client *client,
 		     struct omap_ion_tiler_alloc_data *data)
@@ -174,6 +428,7 @@ int omap_tiler_alloc(struct ion_heap *heap,
 	u32 tiler_start = 0;
 	u32 v_size;
 	tiler_blk_handle tiler_handle;
+	ktime_t start = ktime_get();
 	int ret;
 
 	if (data->fmt == TILER_PIXEL_FMT_PAGE && data->h != 1) {
@@ -194,6 +449,21 @@ int omap_tiler_alloc(struct ion_heap *heap,
 
 	BUG_ON(!n_phys_pages || !n_tiler_pages);
 
+	info = omap_tiler_cache_get(heap, data);
+	if (info && omap_tiler_clear(info)) {
+		omap_tiler_release(heap, info);
+		info = NULL;
+	}
+	if (info) {
+		tiler_handle = info->tiler_handle;
+		v_size = tiler_block_vsize(tiler_handle);
+		n_tiler_pages = info->n_tiler_pages;
+		omap_tiler_account_alloc(heap, ktime_to_ns(ktime_sub(ktime_get(),
+								     start)));
+		goto alloc_handle;
+	}
+
+retry:
 	if( (TILER_ENABLE_NON_PAGE_ALIGNED_ALLOCATIONS)
 			&& (data->token != 0) ) {
 		tiler_handle = tiler_alloc_block_area_aligned(data->fmt, data->w, data->h,
@@ -208,6 +478,11 @@ int omap_tiler_alloc(struct ion_heap *heap,
 							    NULL);
 	}
 
+	if (IS_ERR_OR_NULL(tiler_handle) &&
+	    omap_tiler_cache_trim(heap, 0, 0))
+		/* cached containers may be holding the address space */
+		goto retry;
+
 	if (IS_ERR_OR_NULL(tiler_handle)) {
 		ret = PTR_ERR(tiler_handle);
 		pr_err("%s: failure to allocate address space from tiler\n",
@@ -235,14 +510,25 @@ int omap_tiler_alloc(struct ion_heap *heap,
 	info->phys_addrs = (u32 *)(info + 1);
 	info->tiler_addrs = info->phys_addrs + n_phys_pages;
 	info->fmt = data->fmt;
+	info->w = data->w;
+	info->h = data->h;
+	info->token = data->token;
+	info->out_align = data->out_align;
+	info->offset = data->offset;
 
-	if ((heap->id == OMAP_ION_HEAP_TILER) ||
-	    (heap->id == OMAP_ION_HEAP_NONSECURE_TILER)) {
+	if (omap_tiler_heap_pinned(heap)) {
 		if (use_dynamic_pages)
-			ret = omap_tiler_alloc_dynamicpages(info);
+			ret = omap_tiler_alloc_dynamicpages(heap, info);
 		else
 			ret = omap_tiler_alloc_carveout(heap, info);
 
+		if (ret && omap_tiler_cache_trim(heap, 0, 0)) {
+			if (use_dynamic_pages)
+				ret = omap_tiler_alloc_dynamicpages(heap, info);
+			else
+				ret = omap_tiler_alloc_carveout(heap, info);
+		}
+
 		if (ret)
 			goto err_alloc;
 
@@ -254,6 +540,9 @@ int omap_tiler_alloc(struct ion_heap *heap,
 			goto err_pin;
 		}
 	}
+	omap_tiler_account_alloc(heap, ktime_to_ns(ktime_sub(ktime_get(),
+							     start)));
+alloc_handle:
 	data->stride = tiler_block_vstride(info->tiler_handle);
 
 	/* create an ion handle  for the allocation */
@@ -283,8 +572,7 @@ int omap_tiler_alloc(struct ion_heap *heap,
 err:
 	tiler_unpin_block(info->tiler_handle);
 err_pin:
-	if ((heap->id == OMAP_ION_HEAP_TILER) ||
-	    (heap->id == OMAP_ION_HEAP_NONSECURE_TILER)) {
+	if (omap_tiler_heap_pinned(heap)) {
 		if (use_dynamic_pages)
 			omap_tiler_free_dynamicpages(info);
 		else
@@ -301,18 +589,7 @@ void omap_tiler_heap_free(struct ion_buffer *buffer)
 {
 	struct omap_tiler_info *info = buffer->priv_virt;
 
-	tiler_unpin_block(info->tiler_handle);
-	tiler_free_block_area(info->tiler_handle);
-
-	if ((buffer->heap->id == OMAP_ION_HEAP_TILER) ||
-	    (buffer->heap->id == OMAP_ION_HEAP_NONSECURE_TILER)) {
-		if (use_dynamic_pages)
-			omap_tiler_free_dynamicpages(info);
-		else
-			omap_tiler_free_carveout(buffer->heap, info);
-	}
-
-	kfree(info);
+	omap_tiler_cache_put(buffer->heap, info);
 }
 
 static int omap_tiler_phys(struct ion_heap *heap,
@@ -386,13 +663,9 @@ int omap_tiler_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 	return ret;
 }
 
-static void per_cpu_cache_flush_arm(void *arg)
-{
-	   flush_cache_all();
-}
-
-int omap_tiler_cache_operation(struct ion_buffer *buffer, size_t len,
-			unsigned long vaddr, enum cache_operation cacheop)
+static int omap_tiler_cache_range(struct ion_buffer *buffer, size_t offset,
+				  size_t len, unsigned long vaddr,
+				  enum cache_operation cacheop)
 {
 	struct omap_tiler_info *info;
 	int n_pages;
@@ -413,7 +686,7 @@ int omap_tiler_cache_operation(struct ion_buffer *buffer, size_t len,
 	}
 
 	n_pages = info->n_tiler_pages;
-	if (len > (n_pages * PAGE_SIZE)) {
+	if (offset + len > (n_pages * PAGE_SIZE)) {
 		pr_err("%s(): size to flush is greater than allocated size\n",
 			__func__);
 		return -EINVAL;
@@ -425,23 +698,18 @@ int omap_tiler_cache_operation(struct ion_buffer *buffer, size_t len,
 		return -EINVAL;
 	}
 
-	if (len > FULL_CACHE_FLUSH_THRESHOLD) {
-		on_each_cpu(per_cpu_cache_flush_arm, NULL, 1);
-		outer_flush_all();
-		return 0;
-	}
-
-	flush_cache_user_range(vaddr, vaddr + len);
-
-	if (cacheop == CACHE_FLUSH)
-		outer_flush_range(info->tiler_addrs[0],
-			info->tiler_addrs[0] + len);
-	else
-		outer_inv_range(info->tiler_addrs[0],
-			info->tiler_addrs[0] + len);
+	/* 1D buffers are linear in both the user and the tiler space */
+	ion_cache_maintenance(vaddr + offset, info->tiler_addrs[0] + offset,
+			      len, cacheop);
 	return 0;
 }
 
+int omap_tiler_cache_operation(struct ion_buffer *buffer, size_t len,
+			unsigned long vaddr, enum cache_operation cacheop)
+{
+	return omap_tiler_cache_range(buffer, 0, len, vaddr, cacheop);
+}
+
 int omap_tiler_heap_flush_user(struct ion_buffer *buffer, size_t len,
 			unsigned long vaddr)
 {
@@ -454,6 +722,34 @@ int omap_tiler_heap_inval_user(struct ion_buffer *buffer, size_t len,
 	return omap_tiler_cache_operation(buffer, len, vaddr, CACHE_INVALIDATE);
 }
 
+static void omap_tiler_heap_debug_show(struct ion_heap *heap,
+				       struct seq_file *s)
+{
+	struct omap_ion_heap *omap_heap = (struct omap_ion_heap *)heap;
+	struct omap_tiler_info *info;
+
+	if (!omap_tiler_heap_pinned(heap))
+		return;
+
+	mutex_lock(&omap_heap->cache_lock);
+	seq_printf(s, "allocations: %lu avg: %llu us max: %llu us\n",
+		   omap_heap->allocs,
+		   omap_heap->allocs ?
+		   div64_u64(omap_heap->alloc_ns,
+			     (u64)omap_heap->allocs * NSEC_PER_USEC) : 0,
+		   div_u64(omap_heap->max_alloc_ns, NSEC_PER_USEC));
+	if (use_dynamic_pages)
+		seq_printf(s, "dynamic pages: %lu in runs %lu single\n",
+			   omap_heap->run_pages, omap_heap->single_pages);
+	seq_printf(s, "cached containers: %d pages: %u hits: %lu misses: %lu\n",
+		   omap_heap->cache_count, omap_heap->cache_pages,
+		   omap_heap->cache_hits, omap_heap->cache_misses);
+	list_for_each_entry(info, &omap_heap->cache, cache_node)
+		seq_printf(s, "%16s fmt %d %ux%u pages %u\n", "", info->fmt,
+			   info->w, info->h, info->n_phys_pages);
+	mutex_unlock(&omap_heap->cache_lock);
+}
+
 static struct ion_heap_ops omap_tiler_ops = {
 	.allocate = omap_tiler_heap_allocate,
 	.free = omap_tiler_heap_free,
@@ -461,6 +757,8 @@ static struct ion_heap_ops omap_tiler_ops = {
 	.map_user = omap_tiler_heap_map_user,
 	.flush_user = omap_tiler_heap_flush_user,
 	.inval_user = omap_tiler_heap_inval_user,
+	.cache_range = omap_tiler_cache_range,
+	.debug_show = omap_tiler_heap_debug_show,
 };
 
 struct ion_heap *omap_tiler_heap_create(struct ion_platform_heap *data)
@@ -471,6 +769,10 @@ struct ion_heap *omap_tiler_heap_create(struct ion_platform_heap *data)
 	if (!heap)
 		return ERR_PTR(-ENOMEM);
 
+	mutex_init(&heap->cache_lock);
+	INIT_LIST_HEAD(&heap->cache);
+	INIT_WORK(&heap->shrink_work, omap_tiler_cache_shrink_work);
+
 	if ((data->id == OMAP_ION_HEAP_TILER) ||
 	    (data->id == OMAP_ION_HEAP_NONSECURE_TILER)) {
 		heap->pool = gen_pool_create(12, -1);
@@ -486,10 +788,21 @@ struct ion_heap *omap_tiler_heap_create(struct ion_platform_heap *data)
 	heap->heap.name = data->name;
 	heap->heap.id = data->id;
 
+#ifdef CONFIG_ION_OMAP_DYNAMIC_TILER
+	use_dynamic_pages = true;
+#else
 	if (omap_total_ram_size() <= SZ_512M)
 		use_dynamic_pages = true;
 	else
 		use_dynamic_pages = false;
+#endif
+
+	/* carveout pages are no use to reclaim, only give back real memory */
+	if (omap_tiler_heap_pinned(&heap->heap) && use_dynamic_pages) {
+		heap->shrinker.shrink = omap_tiler_cache_shrink;
+		heap->shrinker.seeks = DEFAULT_SEEKS;
+		register_shrinker(&heap->shrinker);
+	}
 
 	return &heap->heap;
 }
@@ -497,6 +810,11 @@ struct ion_heap *omap_tiler_heap_create(struct ion_platform_heap *data)
 void omap_tiler_heap_destroy(struct ion_heap *heap)
 {
 	struct omap_ion_heap *omap_ion_heap = (struct omap_ion_heap *)heap;
+
+	if (omap_ion_heap->shrinker.shrink)
+		unregister_shrinker(&omap_ion_heap->shrinker);
+	cancel_work_sync(&omap_ion_heap->shrink_work);
+	omap_tiler_cache_trim(heap, 0, 0);
 	if (omap_ion_heap->pool)
 		gen_pool_destroy(omap_ion_heap->pool);
 	kfree(heap);
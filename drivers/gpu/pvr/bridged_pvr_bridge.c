@@ -4241,6 +4241,8 @@ _SetDispatchTableEntry(IMG_UINT32 ui32Index,
 	g_BridgeDispatchTable[ui32Index].pszFunctionName = pszFunctionName;
 	g_BridgeDispatchTable[ui32Index].ui32CallCount = 0;
 	g_BridgeDispatchTable[ui32Index].ui32CopyFromUserTotalBytes = 0;
+	g_BridgeDispatchTable[ui32Index].ui32TotalTimeus = 0;
+	g_BridgeDispatchTable[ui32Index].ui32MaxTimeus = 0;
 #endif
 
 	ui32PrevIndex = ui32Index;
@@ -5361,6 +5363,8 @@ CommonBridgeInit(IMG_VOID)
 			g_BridgeDispatchTable[i].ui32CallCount = 0;
 			g_BridgeDispatchTable[i].ui32CopyFromUserTotalBytes = 0;
 			g_BridgeDispatchTable[i].ui32CopyToUserTotalBytes = 0;
+			g_BridgeDispatchTable[i].ui32TotalTimeus = 0;
+			g_BridgeDispatchTable[i].ui32MaxTimeus = 0;
 #endif
 		}
 	}
@@ -5376,6 +5380,9 @@ IMG_INT BridgedDispatchKM(PVRSRV_PER_PROCESS_DATA * psPerProc,
 	BridgeWrapperFunction pfBridgeHandler;
 	IMG_UINT32   ui32BridgeID = psBridgePackageKM->ui32BridgeID;
 	IMG_INT      err          = -EFAULT;
+#if defined(DEBUG_BRIDGE_KM)
+	IMG_UINT32   ui32StartTimeus, ui32Timeus;
+#endif
 
 #if defined(DEBUG_TRACE_BRIDGE_KM)
 	PVR_DPF((PVR_DBG_ERROR, "%s: %s",
@@ -5478,10 +5485,22 @@ IMG_INT BridgedDispatchKM(PVRSRV_PER_PROCESS_DATA * psPerProc,
 	}
 	pfBridgeHandler =
 		(BridgeWrapperFunction)g_BridgeDispatchTable[ui32BridgeID].pfFunction;
+#if defined(DEBUG_BRIDGE_KM)
+	ui32StartTimeus = OSFuncHighResTimerGetus(IMG_NULL);
+#endif
 	err = pfBridgeHandler(ui32BridgeID,
 						  psBridgeIn,
 						  psBridgeOut,
 						  psPerProc);
+#if defined(DEBUG_BRIDGE_KM)
+	/* Calls are serialised by the bridge lock, so plain updates are safe */
+	ui32Timeus = OSFuncHighResTimerGetus(IMG_NULL) - ui32StartTimeus;
+	g_BridgeDispatchTable[ui32BridgeID].ui32TotalTimeus += ui32Timeus;
+	if (ui32Timeus > g_BridgeDispatchTable[ui32BridgeID].ui32MaxTimeus)
+	{
+		g_BridgeDispatchTable[ui32BridgeID].ui32MaxTimeus = ui32Timeus;
+	}
+#endif
 	if(err < 0)
 	{
 		goto return_fault;
@@ -183,6 +183,8 @@ typedef struct _PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY
 											 userspace within this ioctl */
 	IMG_UINT32 ui32CopyToUserTotalBytes; /*!< The total number of bytes copied from
 										   userspace within this ioctl */
+	IMG_UINT32 ui32TotalTimeus; /*!< The total time spent in the wrapper function */
+	IMG_UINT32 ui32MaxTimeus; /*!< The longest single call to the wrapper function */
 #endif
 }PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY;
 
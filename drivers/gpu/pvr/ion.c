@@ -55,6 +55,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/module.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/dma-buf.h>
+#include <linux/platform_device.h>
 
 #if defined (CONFIG_ION_OMAP)
 #define MAX_HANDLES_PER_FD 2
@@ -164,8 +166,14 @@ EXPORT_SYMBOL(PVRSRVExportFDToIONHandle);
 #include "../drivers/gpu/ion/ion_priv.h"
 #include "linux/kernel.h"
 
+/* Idle dma-buf mappings kept: a few swap chains' worth */
+#define ION_DMA_BUF_MAP_CACHE_SIZE 32
+
+extern struct platform_device *gpsPVRLDMDev;
+
 struct ion_heap **apsIonHeaps;
 struct ion_device *psIonDev;
+static struct dma_buf_map_cache gsIonDmaBufMapCache;
 
 static struct ion_platform_data generic_config = {
 	.nr = 2,
@@ -211,6 +219,8 @@ PVRSRV_ERROR IonInit(IMG_VOID)
 		ion_device_add_heap(psIonDev, apsIonHeaps[i]);
 	}
 
+	dma_buf_map_cache_init(&gsIonDmaBufMapCache, &gpsPVRLDMDev->dev,
+						   DMA_BIDIRECTIONAL, ION_DMA_BUF_MAP_CACHE_SIZE);
 	return PVRSRV_OK;
 failHeapCreate:
 	for (i = 0; i < uiHeapCount; i++) {
@@ -228,6 +238,11 @@ IMG_VOID IonDeinit(IMG_VOID)
 	int uiHeapCount = generic_config.nr;
 	int i;
 
+	dma_buf_map_cache_flush(&gsIonDmaBufMapCache);
+	PVR_DPF((PVR_DBG_MESSAGE, "%s: dma-buf map cache %lu hits, %lu misses, "
+			 "%lu evictions", __FUNCTION__, gsIonDmaBufMapCache.hits,
+			 gsIonDmaBufMapCache.misses, gsIonDmaBufMapCache.evictions));
+
 	for (i = 0; i < uiHeapCount; i++) {
 		if (apsIonHeaps[i])
 		{
@@ -243,8 +258,67 @@ typedef struct _ION_IMPORT_DATA_
 	struct ion_client *psIonClient;
 	struct ion_handle *psIonHandle;
 	IMG_PVOID pvKernAddr;
+	struct dma_buf *psDmaBuf;
+	struct dma_buf_map *psDmaBufMap;
 } ION_IMPORT_DATA;
 
+/*
+	A dma-buf is imported through the map cache: the buffers of a swap
+	chain come back every frame, and only their first import attaches and
+	maps them.  No kernel mapping is made for these; pvLinAddrKM is only
+	looked at by pdump.
+*/
+static PVRSRV_ERROR IonImportDmaBuf(struct dma_buf *psDmaBuf,
+									ION_IMPORT_DATA *psImportData,
+									IMG_UINT32 *pui32PageCount,
+									IMG_SYS_PHYADDR **ppasSysPhysAddr)
+{
+	struct dma_buf_map *psMap;
+	struct sg_table *psTable;
+	struct scatterlist *psSg;
+	IMG_SYS_PHYADDR *pasSysPhysAddr;
+	IMG_UINT32 ui32PageCount = 0;
+	IMG_UINT32 i, j;
+
+	psMap = dma_buf_map_cache_get(&gsIonDmaBufMapCache, psDmaBuf);
+	if (IS_ERR(psMap))
+	{
+		return PVRSRV_ERROR_BAD_MAPPING;
+	}
+	psTable = dma_buf_map_sg_table(psMap);
+
+	for_each_sg(psTable->sgl, psSg, psTable->nents, i)
+	{
+		ui32PageCount += PAGE_ALIGN(sg_dma_len(psSg)) >> PAGE_SHIFT;
+	}
+
+	pasSysPhysAddr = kmalloc(sizeof(IMG_SYS_PHYADDR) * ui32PageCount, GFP_KERNEL);
+	if (pasSysPhysAddr == NULL)
+	{
+		dma_buf_map_cache_put(&gsIonDmaBufMapCache, psMap);
+		return PVRSRV_ERROR_OUT_OF_MEMORY;
+	}
+
+	ui32PageCount = 0;
+	for_each_sg(psTable->sgl, psSg, psTable->nents, i)
+	{
+		for (j = 0; j < sg_dma_len(psSg); j += PAGE_SIZE)
+		{
+			pasSysPhysAddr[ui32PageCount++].uiAddr = sg_dma_address(psSg) + j;
+		}
+	}
+
+	psImportData->psIonClient = IMG_NULL;
+	psImportData->psIonHandle = IMG_NULL;
+	psImportData->pvKernAddr = IMG_NULL;
+	psImportData->psDmaBuf = psDmaBuf;
+	psImportData->psDmaBufMap = psMap;
+
+	*pui32PageCount = ui32PageCount;
+	*ppasSysPhysAddr = pasSysPhysAddr;
+	return PVRSRV_OK;
+}
+
 PVRSRV_ERROR IonImportBufferAndAquirePhysAddr(IMG_HANDLE hIonDev,
 											  IMG_HANDLE hIonFD,
 											  IMG_UINT32 *pui32PageCount,
@@ -262,6 +336,7 @@ PVRSRV_ERROR IonImportBufferAndAquirePhysAddr(IMG_HANDLE hIonDev,
 	IMG_UINT32 ui32PageCount = 0;
 	IMG_UINT32 i;
 	IMG_PVOID pvKernAddr;
+	struct dma_buf *psDmaBuf;
 	int fd = (int) hIonFD;
 
 	psImportData = kmalloc(sizeof(ION_IMPORT_DATA), GFP_KERNEL);
@@ -270,6 +345,23 @@ PVRSRV_ERROR IonImportBufferAndAquirePhysAddr(IMG_HANDLE hIonDev,
 		return PVRSRV_ERROR_OUT_OF_MEMORY;
 	}
 
+	psDmaBuf = dma_buf_get(fd);
+	if (!IS_ERR(psDmaBuf))
+	{
+		/* The dma-buf reference is held until the unimport */
+		eError = IonImportDmaBuf(psDmaBuf, psImportData,
+								 pui32PageCount, ppasSysPhysAddr);
+		if (eError != PVRSRV_OK)
+		{
+			dma_buf_put(psDmaBuf);
+			kfree(psImportData);
+			return eError;
+		}
+		*ppvKernAddr = IMG_NULL;
+		*phPriv = psImportData;
+		return PVRSRV_OK;
+	}
+
 	/* Get the buffer handle */
 	psIonHandle = ion_import_fd(psIonClient, fd);
 	if (psIonHandle == IMG_NULL)
@@ -281,6 +373,8 @@ PVRSRV_ERROR IonImportBufferAndAquirePhysAddr(IMG_HANDLE hIonDev,
 	/* Create data for free callback */
 	psImportData->psIonClient = psIonClient;
 	psImportData->psIonHandle = psIonHandle;	
+	psImportData->psDmaBuf = IMG_NULL;
+	psImportData->psDmaBufMap = IMG_NULL;
 
 	psScatterList = ion_map_dma(psIonClient, psIonHandle);
 	if (psScatterList == NULL)
@@ -352,6 +446,15 @@ IMG_VOID IonUnimportBufferAndReleasePhysAddr(IMG_HANDLE hPriv)
 {
 	ION_IMPORT_DATA *psImportData = hPriv;
 
+	if (psImportData->psDmaBufMap)
+	{
+		/* The mapping stays cached for the next import */
+		dma_buf_map_cache_put(&gsIonDmaBufMapCache, psImportData->psDmaBufMap);
+		dma_buf_put(psImportData->psDmaBuf);
+		kfree(psImportData);
+		return;
+	}
+
 	ion_unmap_dma(psImportData->psIonClient, psImportData->psIonHandle);
 	if (psImportData->pvKernAddr)
 	{
@@ -641,6 +641,7 @@ AllocPageFromLinux(void)
             return NULL;
 
         }
+        inc_zone_page_state(psPage, NR_PVR_PAGES);
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,15))
     	/* Reserve those pages to allow them to be re-mapped to user space */
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,0))		
@@ -663,6 +664,7 @@ FreePageToLinux(struct page *psPage)
         mem_map_reserve(psPage);
 #endif		
 #endif	
+        dec_zone_page_state(psPage, NR_PVR_PAGES);
         __free_pages(psPage, 0);
 }
 
@@ -707,11 +709,17 @@ PagePoolTrylock(void)
 #endif	/* (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0) */
 
 
+/*
+ * Pages in the pool are counted as reclaimable, NR_PVR_POOL_PAGES, rather
+ * than as pinned, NR_PVR_PAGES, as the shrinker may give them back.
+ */
 static inline void
 AddEntryToPool(LinuxPagePoolEntry *psPagePoolEntry)
 {
 	list_add_tail(&psPagePoolEntry->sPagePoolItem, &g_sPagePoolList);
 	atomic_inc(&g_sPagePoolEntryCount);
+	dec_zone_page_state(psPagePoolEntry->psPage, NR_PVR_PAGES);
+	inc_zone_page_state(psPagePoolEntry->psPage, NR_PVR_POOL_PAGES);
 }
 
 static inline void
@@ -719,6 +727,8 @@ RemoveEntryFromPool(LinuxPagePoolEntry *psPagePoolEntry)
 {
 	list_del(&psPagePoolEntry->sPagePoolItem);
 	atomic_dec(&g_sPagePoolEntryCount);
+	dec_zone_page_state(psPagePoolEntry->psPage, NR_PVR_POOL_PAGES);
+	inc_zone_page_state(psPagePoolEntry->psPage, NR_PVR_PAGES);
 }
 
 static inline LinuxPagePoolEntry *
@@ -14,10 +14,33 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
 #include <linux/opp.h>
 #include <plat/gpu.h>
 #include "sgxfreq.h"
 
+/* length of the windows the busy histogram is sampled over */
+#define SGXFREQ_STAT_WINDOW_MS		100
+#define SGXFREQ_STAT_BUSY_BUCKETS	10
+
+/*
+ * OPP residency and transition statistics, in the style of cpufreq_stats.
+ * Everything but the busy histogram is protected by freq_mutex.
+ */
+struct sgxfreq_stats {
+	unsigned long *time_in_state;	/* ms spent at each OPP */
+	unsigned int *trans_table;	/* [from * freq_cnt + to] */
+	unsigned int total_trans;
+	unsigned long last_time;	/* ms of the last residency update */
+	unsigned long lat_last_us;	/* duration of device_scale calls */
+	unsigned long lat_max_us;
+	u64 lat_total_us;
+	unsigned long busy_hist[SGXFREQ_STAT_BUSY_BUCKETS];
+	unsigned long hist_prev_active;
+	unsigned long hist_prev_idle;
+};
+
 static struct sgxfreq_data {
 	int freq_cnt;
 	unsigned long *freq_list;
@@ -33,6 +56,7 @@ static struct sgxfreq_data {
 	struct sgxfreq_sgx_data sgx_data;
 	struct device *dev;
 	struct gpu_platform_data *pdata;
+	struct sgxfreq_stats stats;
 } sfd;
 
 /* Governor init/deinit functions */
@@ -44,6 +68,10 @@ int on3demand_init(void);
 int on3demand_deinit(void);
 int userspace_init(void);
 int userspace_deinit(void);
+#if defined(CONFIG_DSSCOMP)
+int predictive_init(void);
+int predictive_deinit(void);
+#endif
 
 
 typedef int sgxfreq_gov_init_t(void);
@@ -52,6 +80,9 @@ sgxfreq_gov_init_t *sgxfreq_gov_init[] = {
 	activeidle_init,
 	on3demand_init,
 	userspace_init,
+#if defined(CONFIG_DSSCOMP)
+	predictive_init,
+#endif
 	NULL,
 };
 
@@ -61,6 +92,9 @@ sgxfreq_gov_deinit_t *sgxfreq_gov_deinit[] = {
 	activeidle_deinit,
 	on3demand_deinit,
 	userspace_deinit,
+#if defined(CONFIG_DSSCOMP)
+	predictive_deinit,
+#endif
 	NULL,
 };
 
@@ -75,6 +109,34 @@ int cool_init(void);
 void cool_deinit(void);
 #endif
 
+static int __freq_index(unsigned long freq)
+{
+	int i;
+
+	for (i = 0; i < sfd.freq_cnt; i++)
+		if (sfd.freq_list[i] == freq)
+			return i;
+
+	return -1;
+}
+
+/* charge the time since the last update to the current OPP */
+static void __update_time_in_state(void)
+{
+	struct timeval tv;
+	unsigned long now;
+	int i;
+
+	do_gettimeofday(&tv);
+	now = __tv2msec(tv);
+
+	i = __freq_index(sfd.freq);
+	if (i >= 0)
+		sfd.stats.time_in_state[i] +=
+			__delta32(now, sfd.stats.last_time);
+	sfd.stats.last_time = now;
+}
+
 /*********************** begin sysfs interface ***********************/
 
 struct kobject *sgxfreq_kobj;
@@ -187,6 +249,89 @@ static ssize_t store_governor(struct device *dev,
 		return count;
 }
 
+static ssize_t show_time_in_state(struct device *dev,
+				  struct device_attribute *attr,
+				  char *buf)
+{
+	ssize_t count = 0;
+	int i;
+
+	mutex_lock(&sfd.freq_mutex);
+	__update_time_in_state();
+	for (i = 0; i < sfd.freq_cnt; i++)
+		count += sprintf(&buf[count], "%lu %lu\n", sfd.freq_list[i],
+				 sfd.stats.time_in_state[i]);
+	mutex_unlock(&sfd.freq_mutex);
+
+	return count;
+}
+
+static ssize_t show_total_trans(struct device *dev,
+				struct device_attribute *attr,
+				char *buf)
+{
+	return sprintf(buf, "%u\n", sfd.stats.total_trans);
+}
+
+static ssize_t show_trans_table(struct device *dev,
+				struct device_attribute *attr,
+				char *buf)
+{
+	ssize_t count = 0;
+	int i, j;
+
+	mutex_lock(&sfd.freq_mutex);
+	count += sprintf(&buf[count], "   From  :    To\n");
+	count += sprintf(&buf[count], "         : ");
+	for (j = 0; j < sfd.freq_cnt; j++)
+		count += sprintf(&buf[count], "%10lu ",
+				 sfd.freq_list[j] / 1000);
+	count += sprintf(&buf[count], "\n");
+
+	for (i = 0; i < sfd.freq_cnt; i++) {
+		count += sprintf(&buf[count], "%9lu: ",
+				 sfd.freq_list[i] / 1000);
+		for (j = 0; j < sfd.freq_cnt; j++)
+			count += sprintf(&buf[count], "%10u ",
+				sfd.stats.trans_table[i * sfd.freq_cnt + j]);
+		count += sprintf(&buf[count], "\n");
+	}
+	mutex_unlock(&sfd.freq_mutex);
+
+	return count;
+}
+
+static ssize_t show_busy_histogram(struct device *dev,
+				   struct device_attribute *attr,
+				   char *buf)
+{
+	ssize_t count = 0;
+	int i;
+
+	for (i = 0; i < SGXFREQ_STAT_BUSY_BUCKETS; i++)
+		count += sprintf(&buf[count], "%3d-%3d%% %lu\n",
+				 i * 100 / SGXFREQ_STAT_BUSY_BUCKETS,
+				 (i + 1) * 100 / SGXFREQ_STAT_BUSY_BUCKETS,
+				 sfd.stats.busy_hist[i]);
+
+	return count;
+}
+
+static ssize_t show_transition_latency(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	unsigned long avg = 0;
+
+	mutex_lock(&sfd.freq_mutex);
+	if (sfd.stats.total_trans)
+		avg = div_u64(sfd.stats.lat_total_us, sfd.stats.total_trans);
+	mutex_unlock(&sfd.freq_mutex);
+
+	return sprintf(buf, "last %lu max %lu avg %lu us\n",
+		       sfd.stats.lat_last_us, sfd.stats.lat_max_us, avg);
+}
+
 static DEVICE_ATTR(frequency_list, 0444, show_frequency_list, NULL);
 static DEVICE_ATTR(frequency_request, 0444, show_frequency_request, NULL);
 static DEVICE_ATTR(frequency_limit, 0644, show_frequency_limit, store_frequency_limit);
@@ -194,6 +339,11 @@ static DEVICE_ATTR(frequency, 0444, show_frequency, NULL);
 static DEVICE_ATTR(governor_list, 0444, show_governor_list, NULL);
 static DEVICE_ATTR(governor, 0644, show_governor, store_governor);
 static DEVICE_ATTR(stat, 0444, show_stat, NULL);
+static DEVICE_ATTR(time_in_state, 0444, show_time_in_state, NULL);
+static DEVICE_ATTR(total_trans, 0444, show_total_trans, NULL);
+static DEVICE_ATTR(trans_table, 0444, show_trans_table, NULL);
+static DEVICE_ATTR(busy_histogram, 0444, show_busy_histogram, NULL);
+static DEVICE_ATTR(transition_latency, 0444, show_transition_latency, NULL);
 
 static const struct attribute *sgxfreq_attributes[] = {
 	&dev_attr_frequency_list.attr,
@@ -206,6 +356,20 @@ static const struct attribute *sgxfreq_attributes[] = {
 	NULL
 };
 
+static struct attribute *sgxfreq_stats_attributes[] = {
+	&dev_attr_time_in_state.attr,
+	&dev_attr_total_trans.attr,
+	&dev_attr_trans_table.attr,
+	&dev_attr_busy_histogram.attr,
+	&dev_attr_transition_latency.attr,
+	NULL
+};
+
+static struct attribute_group sgxfreq_stats_attr_group = {
+	.attrs = sgxfreq_stats_attributes,
+	.name = "stats",
+};
+
 /************************ end sysfs interface ************************/
 
 static void __set_freq(void)
@@ -214,15 +378,59 @@ static void __set_freq(void)
 
 	freq = min(sfd.freq_request, sfd.freq_limit);
 	if (freq != sfd.freq) {
+		int from = __freq_index(sfd.freq);
+		int to = __freq_index(freq);
+		unsigned long lat_us;
+		ktime_t start;
+
+		__update_time_in_state();
+
+		start = ktime_get();
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,4,0))
 		sfd.pdata->device_scale(sfd.dev, sfd.dev, freq);
 #else
 		sfd.pdata->device_scale(sfd.dev, freq);
 #endif
+		lat_us = ktime_to_us(ktime_sub(ktime_get(), start));
 		sfd.freq = freq;
+
+		/* the first scaling at init is not a transition */
+		if (from >= 0 && to >= 0) {
+			sfd.stats.trans_table[from * sfd.freq_cnt + to]++;
+			sfd.stats.total_trans++;
+			sfd.stats.lat_last_us = lat_us;
+			sfd.stats.lat_max_us = max(sfd.stats.lat_max_us,
+						   lat_us);
+			sfd.stats.lat_total_us += lat_us;
+		}
 	}
 }
 
+/*
+ * Bucket the busy ratio of each SGXFREQ_STAT_WINDOW_MS window.  Samples
+ * only come with active/idle changes, so a span of several windows without
+ * one counts once for each window at the span's ratio.
+ */
+static void __update_busy_histogram(void)
+{
+	unsigned long active, idle, span;
+	int bucket;
+
+	active = __delta32(sfd.total_active_time, sfd.stats.hist_prev_active);
+	idle = __delta32(sfd.total_idle_time, sfd.stats.hist_prev_idle);
+	span = active + idle;
+	if (span < SGXFREQ_STAT_WINDOW_MS)
+		return;
+
+	bucket = active * SGXFREQ_STAT_BUSY_BUCKETS / span;
+	if (bucket >= SGXFREQ_STAT_BUSY_BUCKETS)
+		bucket = SGXFREQ_STAT_BUSY_BUCKETS - 1;
+	sfd.stats.busy_hist[bucket] += span / SGXFREQ_STAT_WINDOW_MS;
+
+	sfd.stats.hist_prev_active = sfd.total_active_time;
+	sfd.stats.hist_prev_idle = sfd.total_idle_time;
+}
+
 static struct sgxfreq_governor *__find_governor(const char *name)
 {
         struct sgxfreq_governor *t;
@@ -286,6 +494,8 @@ static void __update_timing_info(bool active)
 			_idle_prev_time = _idle_curr_time;
 		}
 	}
+
+	__update_busy_histogram();
 }
 
 int sgxfreq_init(struct device *dev)
@@ -333,6 +543,19 @@ int sgxfreq_init(struct device *dev)
 	}
 	rcu_read_unlock();
 
+	sfd.stats.time_in_state = kzalloc(sfd.freq_cnt * sizeof(unsigned long),
+					  GFP_KERNEL);
+	sfd.stats.trans_table = kzalloc(sfd.freq_cnt * sfd.freq_cnt *
+					sizeof(unsigned int), GFP_KERNEL);
+	if (!sfd.stats.time_in_state || !sfd.stats.trans_table) {
+		kfree(sfd.stats.time_in_state);
+		kfree(sfd.stats.trans_table);
+		kfree(sfd.freq_list);
+		return -ENOMEM;
+	}
+	do_gettimeofday(&tv);
+	sfd.stats.last_time = __tv2msec(tv);
+
 	mutex_init(&sfd.freq_mutex);
 	sfd.freq_limit = sfd.freq_list[sfd.freq_cnt - 1];
 	sgxfreq_set_freq_request(sfd.freq_list[sfd.freq_cnt - 1]);
@@ -344,7 +567,12 @@ int sgxfreq_init(struct device *dev)
 
 	sgxfreq_kobj = kobject_create_and_add("sgxfreq", &sfd.dev->kobj);
 	ret = sysfs_create_files(sgxfreq_kobj, sgxfreq_attributes);
+	if (!ret)
+		ret = sysfs_create_group(sgxfreq_kobj,
+					 &sgxfreq_stats_attr_group);
 	if (ret) {
+		kfree(sfd.stats.time_in_state);
+		kfree(sfd.stats.trans_table);
 		kfree(sfd.freq_list);
 		return ret;
 	}
@@ -357,6 +585,8 @@ int sgxfreq_init(struct device *dev)
 		sgxfreq_gov_init[i]();
 
 	if (sgxfreq_set_governor(SGXFREQ_DEFAULT_GOV_NAME)) {
+		kfree(sfd.stats.time_in_state);
+		kfree(sfd.stats.trans_table);
 		kfree(sfd.freq_list);
 		return -ENODEV;
 	}
@@ -382,9 +612,12 @@ int sgxfreq_deinit(void)
 	for (i = 0; sgxfreq_gov_deinit[i] != NULL; i++)
 		sgxfreq_gov_deinit[i]();
 
+	sysfs_remove_group(sgxfreq_kobj, &sgxfreq_stats_attr_group);
 	sysfs_remove_files(sgxfreq_kobj, sgxfreq_attributes);
 	kobject_put(sgxfreq_kobj);
 
+	kfree(sfd.stats.time_in_state);
+	kfree(sfd.stats.trans_table);
 	kfree(sfd.freq_list);
 
 	return 0;
@@ -608,3 +841,13 @@ void sgxfreq_notif_sgx_frame_done(void)
 
 	mutex_unlock(&sfd.gov_mutex);
 }
+
+void sgxfreq_notif_sgx_kick(bool last_in_scene)
+{
+	mutex_lock(&sfd.gov_mutex);
+
+	if (sfd.gov && sfd.gov->sgx_kick)
+		sfd.gov->sgx_kick(last_in_scene);
+
+	mutex_unlock(&sfd.gov_mutex);
+}
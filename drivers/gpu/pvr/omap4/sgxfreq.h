@@ -43,6 +43,7 @@ struct sgxfreq_governor {
 	void (*sgx_active) (void);
 	void (*sgx_idle) (void);
 	void (*sgx_frame_done) (void);
+	void (*sgx_kick) (bool last_in_scene);
 	struct list_head governor_list;
 };
 
@@ -93,5 +94,6 @@ void sgxfreq_notif_sgx_clk_off(void);
 void sgxfreq_notif_sgx_active(void);
 void sgxfreq_notif_sgx_idle(void);
 void sgxfreq_notif_sgx_frame_done(void);
+void sgxfreq_notif_sgx_kick(bool last_in_scene);
 
 #endif
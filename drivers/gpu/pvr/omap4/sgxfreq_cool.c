@@ -17,14 +17,18 @@
 #include <linux/thermal_framework.h>
 
 static int cool_device(struct thermal_dev *dev, int cooling_level);
+static int cool_get_load(struct thermal_dev *dev);
 
 static struct cool_data {
 	int freq_cnt;
 	unsigned long *freq_list;
+	unsigned long prev_active;
+	unsigned long prev_idle;
 } cd;
 
 static struct thermal_dev_ops cool_dev_ops = {
 	.cool_device = cool_device,
+	.get_load = cool_get_load,
 };
 
 static struct thermal_dev cool_dev = {
@@ -102,3 +106,22 @@ static int cool_device(struct thermal_dev *dev, int cooling_level)
 
 	return 0;
 }
+
+static int cool_get_load(struct thermal_dev *dev)
+{
+	unsigned long total_active, total_idle;
+	unsigned long active, idle;
+
+	total_active = sgxfreq_get_total_active_time();
+	total_idle = sgxfreq_get_total_idle_time();
+
+	active = __delta32(total_active, cd.prev_active);
+	idle = __delta32(total_idle, cd.prev_idle);
+	cd.prev_active = total_active;
+	cd.prev_idle = total_idle;
+
+	if (!active && !idle)
+		return 0;
+
+	return (active * 100) / (active + idle);
+}
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2012 Texas Instruments, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * predictive: frame deadline driven governor
+ *
+ * Rather than reacting to past load, this governor works out how many SGX
+ * cycles a display frame takes and the time until the frame has to be on
+ * screen, and asks for the lowest OPP that fits the one into the other.
+ *
+ * Frame boundaries and the frame period come from dsscomp, which reports
+ * each time a new composition goes out on the primary display.  The work
+ * in a frame is accounted in cycles (busy time at the frequency it ran at)
+ * and divided by the number of TA kicks submitted during the frame.  As
+ * kicks arrive, the frame's work is predicted from the per-kick average and
+ * the larger of the kicks seen so far and the usual kicks per frame, so a
+ * frame that turns out heavier than usual ramps up before it misses.
+ * Lowering the frequency is only considered once per frame.
+ */
+
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/notifier.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
+#include <linux/workqueue.h>
+#include <plat/dsscomp.h>
+#include "sgxfreq.h"
+
+static int predictive_start(struct sgxfreq_sgx_data *data);
+static void predictive_stop(void);
+static void predictive_sgx_active(void);
+static void predictive_sgx_idle(void);
+static void predictive_sgx_kick(bool last_in_scene);
+
+static struct sgxfreq_governor predictive_gov = {
+	.name = "predictive",
+	.gov_start = predictive_start,
+	.gov_stop = predictive_stop,
+	.sgx_active = predictive_sgx_active,
+	.sgx_idle = predictive_sgx_idle,
+	.sgx_kick = predictive_sgx_kick,
+};
+
+/* averages are kept as (3 * old + new) / 4 */
+#define PREDICTIVE_AVG(avg, sample)	(((avg) * 3 + (sample)) / 4)
+
+#define PREDICTIVE_DEFAULT_PERIOD_US		16667
+#define PREDICTIVE_MIN_PERIOD_US		4000
+#define PREDICTIVE_MAX_PERIOD_US		100000
+#define PREDICTIVE_DEFAULT_TARGET_LOAD		80
+#define PREDICTIVE_DEFAULT_IDLE_TIMEOUT_MS	100
+/* frames needed before the averages are trusted */
+#define PREDICTIVE_WARMUP_FRAMES		2
+/* kicks_avg is kept in 1/16ths of a kick */
+#define PREDICTIVE_KICK_SHIFT			4
+
+static struct predictive_data {
+	spinlock_t lock;		/* protects the frame accounting */
+	bool busy;
+	ktime_t busy_start;
+	u64 cycles;			/* sgx cycles spent in this frame */
+	unsigned int kicks;		/* kicks submitted in this frame */
+	ktime_t last_frame;
+	unsigned int period_us;
+	u64 cycles_per_kick;
+	unsigned int kicks_avg;
+	unsigned long freq_target;
+	unsigned long frames;
+	unsigned long missed;
+
+	unsigned int target_load;
+	unsigned int idle_timeout;
+	struct notifier_block nb;
+	struct work_struct work;
+	struct delayed_work idle_work;
+} pdd;
+
+/*********************** begin sysfs interface ***********************/
+
+extern struct kobject *sgxfreq_kobj;
+
+static ssize_t show_target_load(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", pdd.target_load);
+}
+
+static ssize_t store_target_load(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned int load;
+
+	ret = sscanf(buf, "%u", &load);
+	if (ret != 1 || !load || load > 100)
+		return -EINVAL;
+
+	pdd.target_load = load;
+
+	return count;
+}
+
+static ssize_t show_idle_timeout(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", pdd.idle_timeout);
+}
+
+static ssize_t store_idle_timeout(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned int timeout;
+
+	ret = sscanf(buf, "%u", &timeout);
+	if (ret != 1 || !timeout)
+		return -EINVAL;
+
+	pdd.idle_timeout = timeout;
+
+	return count;
+}
+
+static ssize_t show_frame_stat(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "period_us %u cycles_per_kick %llu kicks %u.%02u "
+		       "frames %lu missed %lu\n", pdd.period_us,
+		       (unsigned long long)pdd.cycles_per_kick,
+		       pdd.kicks_avg >> PREDICTIVE_KICK_SHIFT,
+		       ((pdd.kicks_avg & ((1 << PREDICTIVE_KICK_SHIFT) - 1)) *
+			100) >> PREDICTIVE_KICK_SHIFT,
+		       pdd.frames, pdd.missed);
+}
+
+static DEVICE_ATTR(target_load, 0644,
+	show_target_load, store_target_load);
+static DEVICE_ATTR(idle_timeout, 0644,
+	show_idle_timeout, store_idle_timeout);
+static DEVICE_ATTR(frame_stat, 0444,
+	show_frame_stat, NULL);
+
+static struct attribute *predictive_attributes[] = {
+	&dev_attr_target_load.attr,
+	&dev_attr_idle_timeout.attr,
+	&dev_attr_frame_stat.attr,
+	NULL
+};
+
+static struct attribute_group predictive_attr_group = {
+	.attrs = predictive_attributes,
+	.name = "predictive",
+};
+
+/************************ end sysfs interface ************************/
+
+/* lowest frequency that runs @cycles within the frame budget */
+static unsigned long predictive_freq_for(u64 cycles)
+{
+	u64 budget_us = (u64)pdd.period_us * pdd.target_load / 100;
+
+	if (!budget_us)
+		return sgxfreq_get_freq_max();
+
+	cycles *= USEC_PER_SEC;
+	do_div(cycles, budget_us);
+	if (cycles >= sgxfreq_get_freq_max())
+		return sgxfreq_get_freq_max();
+	return sgxfreq_get_freq_ceil((unsigned long)cycles);
+}
+
+/* fold the busy time up to @now into the frame's cycles, pdd.lock held */
+static void predictive_account(ktime_t now)
+{
+	u64 busy_us;
+
+	if (!pdd.busy)
+		return;
+
+	busy_us = ktime_to_us(ktime_sub(now, pdd.busy_start));
+	pdd.cycles += div_u64(busy_us * (sgxfreq_get_freq() / 1000), 1000);
+	pdd.busy_start = now;
+}
+
+static int predictive_frame_displayed(struct notifier_block *nb,
+				      unsigned long mgr_ix, void *data)
+{
+	ktime_t now = *(ktime_t *)data;
+	unsigned long flags;
+	s64 period_us;
+
+	/* only the primary display paces the gpu */
+	if (mgr_ix)
+		return NOTIFY_DONE;
+
+	spin_lock_irqsave(&pdd.lock, flags);
+
+	predictive_account(now);
+
+	period_us = ktime_to_us(ktime_sub(now, pdd.last_frame));
+	pdd.last_frame = now;
+	/* a gap in the animation, not a frame period */
+	if (period_us < PREDICTIVE_MIN_PERIOD_US ||
+	    period_us > PREDICTIVE_MAX_PERIOD_US)
+		goto reset;
+
+	pdd.period_us = PREDICTIVE_AVG(pdd.period_us, (unsigned int)period_us);
+
+	if (!pdd.kicks)
+		goto reset;
+
+	/* the frame took longer than it had at the frequency it got */
+	if (div_u64(pdd.cycles * 1000, sgxfreq_get_freq() / 1000) > period_us)
+		pdd.missed++;
+
+	pdd.cycles_per_kick = PREDICTIVE_AVG(pdd.cycles_per_kick,
+					     div_u64(pdd.cycles, pdd.kicks));
+	pdd.kicks_avg = PREDICTIVE_AVG(pdd.kicks_avg,
+				       pdd.kicks << PREDICTIVE_KICK_SHIFT);
+	pdd.frames++;
+
+	if (pdd.frames >= PREDICTIVE_WARMUP_FRAMES) {
+		pdd.freq_target = predictive_freq_for(
+			(pdd.cycles_per_kick * pdd.kicks_avg) >>
+			PREDICTIVE_KICK_SHIFT);
+		/* frequency changes sleep, do them from process context */
+		schedule_work(&pdd.work);
+	}
+
+reset:
+	pdd.cycles = 0;
+	pdd.kicks = 0;
+	spin_unlock_irqrestore(&pdd.lock, flags);
+
+	return NOTIFY_OK;
+}
+
+static void predictive_work(struct work_struct *work)
+{
+	unsigned long flags;
+	unsigned long freq;
+
+	spin_lock_irqsave(&pdd.lock, flags);
+	freq = pdd.freq_target;
+	spin_unlock_irqrestore(&pdd.lock, flags);
+
+	if (freq != sgxfreq_get_freq_request()) {
+		SGXFREQ_TRACE("predictive: frame %lu period %uus -> %lu\n",
+			      pdd.frames, pdd.period_us, freq);
+		sgxfreq_set_freq_request(freq);
+	}
+}
+
+static void predictive_idle_work(struct work_struct *work)
+{
+	sgxfreq_set_freq_request(sgxfreq_get_freq_min());
+}
+
+int predictive_init(void)
+{
+	spin_lock_init(&pdd.lock);
+	INIT_WORK(&pdd.work, predictive_work);
+	INIT_DELAYED_WORK(&pdd.idle_work, predictive_idle_work);
+	pdd.nb.notifier_call = predictive_frame_displayed;
+
+	return sgxfreq_register_governor(&predictive_gov);
+}
+
+int predictive_deinit(void)
+{
+	return 0;
+}
+
+static int predictive_start(struct sgxfreq_sgx_data *data)
+{
+	int ret;
+
+	pdd.busy = data->active;
+	pdd.busy_start = ktime_get();
+	pdd.cycles = 0;
+	pdd.kicks = 0;
+	pdd.last_frame = pdd.busy_start;
+	pdd.period_us = PREDICTIVE_DEFAULT_PERIOD_US;
+	pdd.cycles_per_kick = 0;
+	pdd.kicks_avg = 0;
+	pdd.freq_target = sgxfreq_get_freq_max();
+	pdd.frames = 0;
+	pdd.missed = 0;
+	pdd.target_load = PREDICTIVE_DEFAULT_TARGET_LOAD;
+	pdd.idle_timeout = PREDICTIVE_DEFAULT_IDLE_TIMEOUT_MS;
+
+	ret = sysfs_create_group(sgxfreq_kobj, &predictive_attr_group);
+	if (ret)
+		return ret;
+
+	ret = dsscomp_register_display_notifier(&pdd.nb);
+	if (ret) {
+		sysfs_remove_group(sgxfreq_kobj, &predictive_attr_group);
+		return ret;
+	}
+
+	sgxfreq_set_freq_request(pdd.freq_target);
+
+	return 0;
+}
+
+static void predictive_stop(void)
+{
+	dsscomp_unregister_display_notifier(&pdd.nb);
+	cancel_work_sync(&pdd.work);
+	cancel_delayed_work_sync(&pdd.idle_work);
+	sysfs_remove_group(sgxfreq_kobj, &predictive_attr_group);
+}
+
+static void predictive_sgx_active(void)
+{
+	unsigned long flags;
+
+	cancel_delayed_work(&pdd.idle_work);
+
+	spin_lock_irqsave(&pdd.lock, flags);
+	pdd.busy = true;
+	pdd.busy_start = ktime_get();
+	spin_unlock_irqrestore(&pdd.lock, flags);
+}
+
+static void predictive_sgx_idle(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pdd.lock, flags);
+	predictive_account(ktime_get());
+	pdd.busy = false;
+	spin_unlock_irqrestore(&pdd.lock, flags);
+
+	schedule_delayed_work(&pdd.idle_work,
+			      msecs_to_jiffies(pdd.idle_timeout));
+}
+
+static void predictive_sgx_kick(bool last_in_scene)
+{
+	unsigned long flags;
+	unsigned long freq;
+	unsigned int kicks;
+	s64 since_frame_us;
+
+	spin_lock_irqsave(&pdd.lock, flags);
+
+	pdd.kicks++;
+	since_frame_us = ktime_to_us(ktime_sub(ktime_get(), pdd.last_frame));
+
+	if (pdd.frames < PREDICTIVE_WARMUP_FRAMES ||
+	    since_frame_us > PREDICTIVE_MAX_PERIOD_US) {
+		/* no idea of the deadline, or not rendering for the display */
+		freq = sgxfreq_get_freq_max();
+	} else {
+		kicks = max(pdd.kicks,
+			    pdd.kicks_avg >> PREDICTIVE_KICK_SHIFT);
+		freq = predictive_freq_for(pdd.cycles_per_kick * kicks);
+	}
+
+	spin_unlock_irqrestore(&pdd.lock, flags);
+
+	/* only ramp up here, the frame boundary decides on going down */
+	if (freq > sgxfreq_get_freq_request())
+		sgxfreq_set_freq_request(freq);
+}
@@ -66,6 +66,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/interrupt.h>
 #include <asm/hardirq.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
 #include <linux/capability.h>
 #include <asm/uaccess.h>
 #include <linux/spinlock.h>
@@ -790,7 +791,10 @@ IMG_HANDLE OSFuncHighResTimerCreate(IMG_VOID)
 ******************************************************************************/ 
 IMG_UINT32 OSFuncHighResTimerGetus(IMG_HANDLE hTimer)
 {
-	return (IMG_UINT32) jiffies_to_usecs(jiffies);
+	PVR_UNREFERENCED_PARAMETER(hTimer);
+
+	/* jiffies are far too coarse to time individual bridge calls */
+	return (IMG_UINT32) ktime_to_us(ktime_get());
 }
 
 /*!
@@ -209,7 +209,7 @@ static void ProcSeqShowBridgeStats(struct seq_file *sfile,void* el)
 						  "Total number of bytes copied via copy_from_user = %u\n"
 						  "Total number of bytes copied via copy_to_user = %u\n"
 						  "Total number of bytes copied via copy_*_user = %u\n\n"
-						  "%-45s | %-40s | %10s | %20s | %10s\n",
+						  "%-45s | %-40s | %10s | %20s | %10s | %12s | %10s\n",
 						  g_BridgeGlobalStats.ui32IOCTLCount,
 						  g_BridgeGlobalStats.ui32TotalCopyFromUserBytes,
 						  g_BridgeGlobalStats.ui32TotalCopyToUserBytes,
@@ -218,18 +218,22 @@ static void ProcSeqShowBridgeStats(struct seq_file *sfile,void* el)
 						  "Wrapper Function",
 						  "Call Count",
 						  "copy_from_user Bytes",
-						  "copy_to_user Bytes"
+						  "copy_to_user Bytes",
+						  "Total Time us",
+						  "Max Time us"
 						 );
 		return;
 	}
 
 	seq_printf(sfile,
-				   "%-45s   %-40s   %-10u   %-20u   %-10u\n",
+				   "%-45s   %-40s   %-10u   %-20u   %-10u   %-12u   %-10u\n",
 				   psEntry->pszIOCName,
 				   psEntry->pszFunctionName,
 				   psEntry->ui32CallCount,
 				   psEntry->ui32CopyFromUserTotalBytes,
-				   psEntry->ui32CopyToUserTotalBytes);
+				   psEntry->ui32CopyToUserTotalBytes,
+				   psEntry->ui32TotalTimeus,
+				   psEntry->ui32MaxTimeus);
 }
 
 #endif /* DEBUG_BRIDGE_KM */
@@ -45,6 +45,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "lists.h"
 #include "ttrace.h"
 
+#include <trace/events/pvr.h>
+
 /*
  * The number of commands of each type which can be in flight at once.
  */
@@ -1072,6 +1074,10 @@ PVRSRV_ERROR PVRSRVProcessCommand(SYS_DATA			*psSysData,
 
 		n.b. ui32DataSize (packet size) is useful for packet validation
 	*/
+	trace_pvr_cmd_process(psCmdCompleteData,
+						  psCmdCompleteData->ui32SrcSyncCount,
+						  psCmdCompleteData->ui32DstSyncCount);
+
 	if (psDeviceCommandData[psCommand->CommandType].pfnCmdProc((IMG_HANDLE)psCmdCompleteData,
 															   (IMG_UINT32)psCommand->uDataSize,
 															   psCommand->pvData) == IMG_FALSE)
@@ -1248,6 +1254,10 @@ IMG_VOID PVRSRVCommandCompleteKM(IMG_HANDLE	hCmdCookie,
 
 	SysAcquireData(&psSysData);
 
+	trace_pvr_cmd_complete(psCmdCompleteData,
+						   psCmdCompleteData->ui32SrcSyncCount,
+						   psCmdCompleteData->ui32DstSyncCount);
+
 	PVR_TTRACE(PVRSRV_TRACE_GROUP_QUEUE, PVRSRV_TRACE_CLASS_CMD_COMP_START,
 			QUEUE_TOKEN_COMMAND_COMPLETE);
 
@@ -69,6 +69,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "buffer_manager.h"
 #include "pdump_km.h"
 
+/* Destination syncs a kick may carry before SGXDoKickBW has to allocate */
+#define SGX_DOKICK_ONSTACK_DST_SYNCS	16
+
 static IMG_INT
 SGXGetClientInfoBW(IMG_UINT32 ui32BridgeID,
 				   PVRSRV_BRIDGE_IN_GETCLIENTINFO *psGetClientInfoIN,
@@ -198,6 +201,12 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 	SGX_CCB_KICK_KM sCCBKickKM = {{0}};
 	IMG_HANDLE	ahSyncInfoHandles[16];
 #else
+	/*
+	 * Nearly every kick carries only a handful of destination syncs, so
+	 * keep the translated handles on the stack and only go to the heap
+	 * for unusually large kicks.
+	 */
+	IMG_HANDLE ahKernelSyncInfoHandles[SGX_DOKICK_ONSTACK_DST_SYNCS];
 	IMG_HANDLE *phKernelSyncInfoHandles = IMG_NULL;
 #endif
 
@@ -516,14 +525,23 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 			return -EFAULT;
 		}
 
-		psRetOUT->eError = OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-										ui32NumDstSyncs * sizeof(IMG_HANDLE),
-										(IMG_VOID **)&phKernelSyncInfoHandles,
-										0,
-										"Array of Synchronization Info Handles");
-		if (psRetOUT->eError != PVRSRV_OK)
+#if !defined (SUPPORT_SID_INTERFACE)
+		if (ui32NumDstSyncs <= SGX_DOKICK_ONSTACK_DST_SYNCS)
 		{
-			return 0;
+			phKernelSyncInfoHandles = ahKernelSyncInfoHandles;
+		}
+		else
+#endif
+		{
+			psRetOUT->eError = OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+											ui32NumDstSyncs * sizeof(IMG_HANDLE),
+											(IMG_VOID **)&phKernelSyncInfoHandles,
+											0,
+											"Array of Synchronization Info Handles");
+			if (psRetOUT->eError != PVRSRV_OK)
+			{
+				return 0;
+			}
 		}
 
 #if defined (SUPPORT_SID_INTERFACE)
@@ -609,7 +627,11 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 
 PVRSRV_BRIDGE_SGX_DOKICK_RETURN_RESULT:
 
-	if(phKernelSyncInfoHandles)
+	if(phKernelSyncInfoHandles
+#if !defined (SUPPORT_SID_INTERFACE)
+	   && phKernelSyncInfoHandles != ahKernelSyncInfoHandles
+#endif
+	   )
 	{
 		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
 				  ui32NumDstSyncs * sizeof(IMG_HANDLE),
@@ -68,6 +68,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "srvkm.h"
 #include "ttrace.h"
 
+#include <trace/events/pvr.h>
+
 IMG_UINT32 g_ui32HostIRQCountSample = 0;
 extern int powering_down;
 
@@ -1892,6 +1894,8 @@ IMG_BOOL SGX_ISRHandler (IMG_VOID *pvData)
 				interrupt.
 			*/
 			g_ui32HostIRQCountSample = psDevInfo->psSGXHostCtl->ui32InterruptCount;
+
+			trace_pvr_sgx_event(ui32EventStatus, g_ui32HostIRQCountSample);
 		}
 	}
 
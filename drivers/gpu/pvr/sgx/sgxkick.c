@@ -53,6 +53,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sgxutils.h"
 #include "ttrace.h"
 
+#include <trace/events/pvr.h>
+
+#if defined(SYS_OMAP4_HAS_DVFS_FRAMEWORK)
+extern void sgxfreq_notif_sgx_kick(bool last_in_scene);
+#endif /* (SYS_OMAP4_HAS_DVFS_FRAMEWORK) */
+
 /*!
 ******************************************************************************
 
@@ -806,6 +812,17 @@ PVRSRV_ERROR SGXDoKickKM(IMG_HANDLE hDevHandle, SGX_CCB_KICK *psCCBKick)
 		return eError;
 	}
 
+	trace_pvr_sgx_kick(psCCBKick->ui32CCBOffset,
+					   psCCBKick->bFirstKickOrResume ? true : false,
+					   psCCBKick->bLastInScene ? true : false,
+					   psCCBKick->ui32NumSrcSyncs,
+					   psCCBKick->ui32NumDstSyncObjects);
+
+#if defined(SYS_OMAP4_HAS_DVFS_FRAMEWORK)
+	/* Let the DVFS governor see the workload as it is submitted */
+	sgxfreq_notif_sgx_kick(psCCBKick->bLastInScene ? true : false);
+#endif /* (SYS_OMAP4_HAS_DVFS_FRAMEWORK) */
+
 
 #if defined(NO_HARDWARE)
 
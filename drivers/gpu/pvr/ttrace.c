@@ -38,6 +38,10 @@ COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
 IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */ /**************************************************************************/
+/* the ftrace events always exist; the ttrace buffers only with TTRACE */
+#define CREATE_TRACE_POINTS
+#include <trace/events/pvr.h>
+
 #if defined (TTRACE)
 
 #include "services_headers.h"
@@ -42,6 +42,11 @@
 #include <linux/i2c-omap.h>
 #include <linux/pm_runtime.h>
 #include <linux/pm_qos.h>
+#include <linux/dma-mapping.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+
+#include <plat/dma.h>
 
 #ifdef CONFIG_OMAP4_DPLL_CASCADING
 #include <linux/notifier.h>
@@ -62,6 +67,19 @@
 /* timeout waiting for the controller to respond */
 #define OMAP_I2C_TIMEOUT (msecs_to_jiffies(1000))
 
+/* bounce buffer for DMA, longer messages use the FIFO */
+#define OMAP_I2C_DMA_BUF_SIZE	PAGE_SIZE
+
+/* Messages at least this long go through DMA, 0 for never */
+static unsigned int dma_min = 64;
+module_param(dma_min, uint, 0644);
+MODULE_PARM_DESC(dma_min, "Shortest message moved by DMA (0 to disable)");
+
+/* Transfers taking less than this on the bus are polled, in us */
+static unsigned int poll_us = 100;
+module_param(poll_us, uint, 0644);
+MODULE_PARM_DESC(poll_us, "Longest transfer polled without interrupts (us)");
+
 /* For OMAP3 I2C_IV has changed to I2C_WE (wakeup enable) */
 enum {
 	OMAP_I2C_REV_REG = 0,
@@ -170,6 +188,18 @@ enum {
 #define I2C_OMAP_ERRATA_I207		(1 << 0)
 #define I2C_OMAP3_1P153			(1 << 1)
 
+struct omap_i2c_stats {
+	u32			xfers;		/* i2c_transfer() calls */
+	u32			msgs;
+	u32			errors;
+	u32			polled;		/* transfers without interrupts */
+	u32			dma;		/* messages moved by DMA */
+	u32			irqs;
+	u64			bytes;
+	u64			total_us;	/* time on the bus */
+	u32			max_us;
+};
+
 struct omap_i2c_dev {
 	struct device		*dev;
 	void __iomem		*base;		/* virtual */
@@ -201,6 +231,16 @@ struct omap_i2c_dev {
 	u16			bufstate;
 	u16			westate;
 	u16			errata;
+	bool			polled;		/* transfer in progress is polled */
+	int			dma_tx;		/* channels, -1 without DMA */
+	int			dma_rx;
+	int			dma_tx_req;
+	int			dma_rx_req;
+	u8			*dma_buf;	/* coherent bounce buffer */
+	dma_addr_t		dma_buf_pa;
+	resource_size_t		phys_base;
+	struct completion	dma_complete;
+	struct omap_i2c_stats	stats;
 #ifdef CONFIG_OMAP4_DPLL_CASCADING
 	struct notifier_block   nb;
 	int                     dpll_entry;
@@ -294,6 +334,16 @@ static void omap_i2c_hwspinlock_unlock(struct omap_i2c_dev *dev)
 		pdata->hwspin_unlock(pdata->handle);
 }
 
+static void omap_i2c_set_ie(struct omap_i2c_dev *dev, u16 ie)
+{
+	if (cpu_is_omap44xx() && dev->rev >= OMAP_I2C_REV_ON_4430) {
+		omap_i2c_write_reg(dev, OMAP_I2C_IRQENABLE_CLR, 0x6FFF);
+		omap_i2c_write_reg(dev, OMAP_I2C_IRQENABLE_SET, ie);
+	} else {
+		omap_i2c_write_reg(dev, OMAP_I2C_IE_REG, ie);
+	}
+}
+
 static void omap_i2c_unidle(struct omap_i2c_dev *dev)
 {
 	struct platform_device *pdev;
@@ -329,12 +379,7 @@ static void omap_i2c_unidle(struct omap_i2c_dev *dev)
 	}
 	dev->idle = 0;
 
-	if (cpu_is_omap44xx() && dev->rev >= OMAP_I2C_REV_ON_4430) {
-		omap_i2c_write_reg(dev, OMAP_I2C_IRQENABLE_CLR,0x6FFF);
-		omap_i2c_write_reg(dev, OMAP_I2C_IRQENABLE_SET, dev->iestate);
-	} else {
-		omap_i2c_write_reg(dev, OMAP_I2C_IE_REG, dev->iestate);
-	}
+	omap_i2c_set_ie(dev, dev->iestate);
 }
 
 static void omap_i2c_idle(struct omap_i2c_dev *dev)
@@ -554,6 +599,109 @@ static int omap_i2c_bus_clear(struct omap_i2c_dev *dev)
 	return omap_i2c_wait_for_bb(dev);
 }
 
+static irqreturn_t omap_i2c_isr(int this_irq, void *dev_id);
+
+/*
+ * Wait for the end of a message: sleep until the interrupt handler
+ * completes it, or run the handler ourselves in a polled transfer.
+ */
+static int omap_i2c_wait(struct omap_i2c_dev *dev)
+{
+	unsigned long timeout = jiffies + OMAP_I2C_TIMEOUT;
+
+	if (!dev->polled)
+		return wait_for_completion_timeout(&dev->cmd_complete,
+						   OMAP_I2C_TIMEOUT);
+
+	while (!completion_done(&dev->cmd_complete)) {
+		if (time_after(jiffies, timeout))
+			return 0;
+		omap_i2c_isr(0, dev);
+		cpu_relax();
+	}
+	return 1;
+}
+
+static bool omap_i2c_use_dma(struct omap_i2c_dev *dev, struct i2c_msg *msg)
+{
+	return dev->dma_buf && dma_min && msg->len >= dma_min &&
+		msg->len <= OMAP_I2C_DMA_BUF_SIZE;
+}
+
+static void omap_i2c_dma_callback(int lch, u16 ch_status, void *data)
+{
+	struct omap_i2c_dev *dev = data;
+
+	complete(&dev->dma_complete);
+}
+
+/*
+ * Move the data of a message by DMA, one byte per request: the FIFO
+ * thresholds are dropped to a byte, and only the end of the message and
+ * errors interrupt.
+ */
+static void omap_i2c_dma_start(struct omap_i2c_dev *dev, struct i2c_msg *msg)
+{
+	int rx = msg->flags & I2C_M_RD;
+	int ch = rx ? dev->dma_rx : dev->dma_tx;
+	u32 data = dev->phys_base +
+		(dev->regs[OMAP_I2C_DATA_REG] << dev->reg_shift);
+
+	if (!rx)
+		memcpy(dev->dma_buf, msg->buf, msg->len);
+	init_completion(&dev->dma_complete);
+
+	omap_set_dma_transfer_params(ch, OMAP_DMA_DATA_TYPE_S8, msg->len, 1,
+				     OMAP_DMA_SYNC_ELEMENT,
+				     rx ? dev->dma_rx_req : dev->dma_tx_req,
+				     rx ? OMAP_DMA_SRC_SYNC :
+					  OMAP_DMA_DST_SYNC);
+	if (rx) {
+		omap_set_dma_src_params(ch, 0, OMAP_DMA_AMODE_CONSTANT,
+					data, 0, 0);
+		omap_set_dma_dest_params(ch, 0, OMAP_DMA_AMODE_POST_INC,
+					 dev->dma_buf_pa, 0, 0);
+	} else {
+		omap_set_dma_src_params(ch, 0, OMAP_DMA_AMODE_POST_INC,
+					dev->dma_buf_pa, 0, 0);
+		omap_set_dma_dest_params(ch, 0, OMAP_DMA_AMODE_CONSTANT,
+					 data, 0, 0);
+	}
+
+	dev->iestate = OMAP_I2C_IE_ARDY | OMAP_I2C_IE_NACK | OMAP_I2C_IE_AL;
+	omap_i2c_set_ie(dev, dev->iestate);
+	omap_i2c_write_reg(dev, OMAP_I2C_BUF_REG,
+			   (rx ? OMAP_I2C_BUF_RDMA_EN : OMAP_I2C_BUF_XDMA_EN) |
+			   OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR);
+
+	/* the interrupt handler has no data to move */
+	dev->buf_len = 0;
+	dev->stats.dma++;
+
+	omap_start_dma(ch);
+}
+
+/* Returns 0 if the message timed out, as omap_i2c_wait() */
+static int omap_i2c_dma_end(struct omap_i2c_dev *dev, struct i2c_msg *msg,
+			    u16 iestate, int r)
+{
+	int rx = msg->flags & I2C_M_RD;
+
+	/* received bytes may still be on their way to memory */
+	if (r && !dev->cmd_err && rx)
+		r = wait_for_completion_timeout(&dev->dma_complete,
+						OMAP_I2C_TIMEOUT);
+
+	omap_stop_dma(rx ? dev->dma_rx : dev->dma_tx);
+	omap_i2c_write_reg(dev, OMAP_I2C_BUF_REG, dev->bufstate);
+	dev->iestate = iestate;
+	omap_i2c_set_ie(dev, dev->iestate);
+
+	if (r && !dev->cmd_err && rx)
+		memcpy(msg->buf, dev->dma_buf, msg->len);
+	return r;
+}
+
 /*
  * Low level master read/write transaction.
  */
@@ -561,6 +709,8 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 			     struct i2c_msg *msg, int stop)
 {
 	struct omap_i2c_dev *dev = i2c_get_adapdata(adap);
+	bool dma = omap_i2c_use_dma(dev, msg);
+	u16 iestate = dev->iestate;
 	int r;
 	u16 w;
 
@@ -586,6 +736,9 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 	init_completion(&dev->cmd_complete);
 	dev->cmd_err = 0;
 
+	if (dma)
+		omap_i2c_dma_start(dev, msg);
+
 	w = OMAP_I2C_CON_EN | OMAP_I2C_CON_MST | OMAP_I2C_CON_STT;
 
 	/* High speed configuration */
@@ -615,6 +768,8 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 			if (time_after(jiffies, delay)) {
 				dev_err(dev->dev, "controller timed out "
 				"waiting for start condition to finish\n");
+				if (dma)
+					omap_i2c_dma_end(dev, msg, iestate, 0);
 				return -ETIMEDOUT;
 			}
 			cpu_relax();
@@ -629,8 +784,10 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 	 * REVISIT: We should abort the transfer on signals, but the bus goes
 	 * into arbitration and we're currently unable to recover from it.
 	 */
-	r = wait_for_completion_timeout(&dev->cmd_complete, OMAP_I2C_TIMEOUT);
+	r = omap_i2c_wait(dev);
 	dev->buf_len = 0;
+	if (dma)
+		r = omap_i2c_dma_end(dev, msg, iestate, r);
 	if (r == 0) {
 		dev_err(dev->dev, "controller timed out\n");
 		omap_i2c_reset(dev);
@@ -768,6 +925,10 @@ omap_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	struct omap_i2c_dev *dev = i2c_get_adapdata(adap);
 	int i;
 	int r;
+	u64 bits = 0;
+	bool dma = false;
+	u32 us;
+	ktime_t start;
 #ifdef CONFIG_OMAP4_DPLL_CASCADING
 	struct platform_device *pdev;
 	struct omap_i2c_bus_platform_data *pdata;
@@ -790,8 +951,21 @@ omap_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	if (r != 0)
 		return r;
 
+	/*
+	 * Short transfers, say a register address write and a read back
+	 * with a repeated start, are over before an interrupt per message
+	 * would be handled: poll them through, without any interrupt.
+	 */
+	for (i = 0; i < num; i++) {
+		bits += (msgs[i].len + 1) * 9;
+		dma |= omap_i2c_use_dma(dev, &msgs[i]);
+	}
+	dev->polled = dev->rev >= OMAP_I2C_REV_2 && poll_us && !dma &&
+		div_u64(bits * 1000, dev->speed) < poll_us;
+
 	/* We have the bus, enable IRQ */
-	enable_irq(dev->irq);
+	if (!dev->polled)
+		enable_irq(dev->irq);
 
 	omap_i2c_unidle(dev);
 
@@ -830,15 +1004,28 @@ omap_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	}
 	spin_unlock(&dev->dpll_lock);
 #endif
+	start = ktime_get();
 	for (i = 0; i < num; i++) {
 		r = omap_i2c_xfer_msg(adap, &msgs[i], (i == (num - 1)));
 		if (r != 0)
 			break;
+		dev->stats.bytes += msgs[i].len;
 	}
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
 
 	if (dev->pm_qos)
 		pm_qos_update_request(dev->pm_qos, PM_QOS_DEFAULT_VALUE);
 
+	dev->stats.xfers++;
+	dev->stats.msgs += i;
+	dev->stats.total_us += us;
+	if (us > dev->stats.max_us)
+		dev->stats.max_us = us;
+	if (dev->polled)
+		dev->stats.polled++;
+	if (r != 0)
+		dev->stats.errors++;
+
 	if (r == 0)
 		r = num;
 
@@ -846,7 +1033,9 @@ omap_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 out:
 	omap_i2c_idle(dev);
 	omap_i2c_hwspinlock_unlock(dev);
-	disable_irq(dev->irq);
+	if (!dev->polled)
+		disable_irq(dev->irq);
+	dev->polled = false;
 	return r;
 }
 
@@ -997,6 +1186,10 @@ omap_i2c_isr(int this_irq, void *dev_id)
 	if (dev->idle || dev->shutdown)
 		return IRQ_NONE;
 
+	/* polled transfers call in with no irq */
+	if (this_irq)
+		dev->stats.irqs++;
+
 	while ((stat = (omap_i2c_read_reg(dev, OMAP_I2C_STAT_REG))) & dev->iestate) {
 		dev_dbg(dev->dev, "IRQ (ISR = 0x%04x)\n", stat);
 		if (count++ == 100) {
@@ -1146,6 +1339,66 @@ static const struct i2c_algorithm omap_i2c_algo = {
 	.functionality	= omap_i2c_func,
 };
 
+static void omap_i2c_dma_free(struct omap_i2c_dev *dev)
+{
+	if (dev->dma_buf)
+		dma_free_coherent(dev->dev, OMAP_I2C_DMA_BUF_SIZE,
+				  dev->dma_buf, dev->dma_buf_pa);
+	dev->dma_buf = NULL;
+	if (dev->dma_tx != -1)
+		omap_free_dma(dev->dma_tx);
+	if (dev->dma_rx != -1)
+		omap_free_dma(dev->dma_rx);
+	dev->dma_tx = dev->dma_rx = -1;
+}
+
+/* Without DMA requests, channels or memory, the FIFO is used */
+static void __devinit omap_i2c_dma_init(struct omap_i2c_dev *dev)
+{
+	struct platform_device *pdev = to_platform_device(dev->dev);
+	struct resource *tx, *rx;
+
+	tx = platform_get_resource_byname(pdev, IORESOURCE_DMA, "tx");
+	rx = platform_get_resource_byname(pdev, IORESOURCE_DMA, "rx");
+	if (!tx || !rx)
+		return;
+	dev->dma_tx_req = tx->start;
+	dev->dma_rx_req = rx->start;
+
+	if (omap_request_dma(dev->dma_tx_req, "I2C TX",
+			     omap_i2c_dma_callback, dev, &dev->dma_tx) ||
+	    omap_request_dma(dev->dma_rx_req, "I2C RX",
+			     omap_i2c_dma_callback, dev, &dev->dma_rx))
+		goto err;
+
+	dev->dma_buf = dma_alloc_coherent(dev->dev, OMAP_I2C_DMA_BUF_SIZE,
+					  &dev->dma_buf_pa, GFP_KERNEL);
+	if (dev->dma_buf)
+		return;
+err:
+	dev_warn(dev->dev, "no DMA, using the FIFO only\n");
+	omap_i2c_dma_free(dev);
+}
+
+static ssize_t omap_i2c_stats_show(struct device *d,
+				   struct device_attribute *attr, char *buf)
+{
+	struct omap_i2c_dev *dev = dev_get_drvdata(d);
+	struct omap_i2c_stats *s = &dev->stats;
+
+	return snprintf(buf, PAGE_SIZE,
+			"xfers:\t%u\nmsgs:\t%u\nbytes:\t%llu\nerrors:\t%u\n"
+			"polled:\t%u\ndma:\t%u\nirqs:\t%u\n"
+			"avg_us:\t%llu\nmax_us:\t%u\nkbps:\t%llu\n",
+			s->xfers, s->msgs, s->bytes, s->errors, s->polled,
+			s->dma, s->irqs,
+			s->xfers ? div_u64(s->total_us, s->xfers) : 0,
+			s->max_us,
+			s->total_us ? div64_u64(s->bytes * 8000, s->total_us)
+				    : 0);
+}
+static DEVICE_ATTR(stats, S_IRUGO, omap_i2c_stats_show, NULL);
+
 static int __devinit
 omap_i2c_probe(struct platform_device *pdev)
 {
@@ -1273,6 +1526,11 @@ omap_i2c_probe(struct platform_device *pdev)
 	/* reset ASAP, clearing any IRQs */
 	omap_i2c_init(dev);
 
+	dev->phys_base = mem->start;
+	dev->dma_tx = dev->dma_rx = -1;
+	if (dev->fifo_size && (cpu_is_omap34xx() || cpu_is_omap44xx()))
+		omap_i2c_dma_init(dev);
+
 	/* Decide what interrupts are needed */
 	dev->iestate = (OMAP_I2C_IE_XRDY | OMAP_I2C_IE_RRDY |
 			OMAP_I2C_IE_ARDY | OMAP_I2C_IE_NACK |
@@ -1311,11 +1569,15 @@ omap_i2c_probe(struct platform_device *pdev)
 		goto err_free_irq;
 	}
 
+	if (device_create_file(&pdev->dev, &dev_attr_stats))
+		dev_warn(dev->dev, "cannot create stats\n");
+
 	return 0;
 
 err_free_irq:
 	free_irq(dev->irq, dev);
 err_unuse_clocks:
+	omap_i2c_dma_free(dev);
 	omap_i2c_write_reg(dev, OMAP_I2C_CON_REG, 0);
 	omap_i2c_idle(dev);
 	if (dev->pm_qos) {
@@ -1341,8 +1603,10 @@ omap_i2c_remove(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, NULL);
 
+	device_remove_file(&pdev->dev, &dev_attr_stats);
 	free_irq(dev->irq, dev);
 	i2c_del_adapter(&dev->adapter);
+	omap_i2c_dma_free(dev);
 	omap_i2c_write_reg(dev, OMAP_I2C_CON_REG, 0);
 	iounmap(dev->base);
 	if (dev->pm_qos) {
@@ -14,6 +14,8 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+/* hand batches over anyway if the display stops sending vsyncs */
+#define EVDEV_BATCH_TIMEOUT	msecs_to_jiffies(34)
 
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -24,6 +26,8 @@
 #include <linux/major.h>
 #include <linux/device.h>
 #include <linux/wakelock.h>
+#include <linux/timer.h>
+#include <linux/notifier.h>
 #include "input-compat.h"
 
 struct evdev {
@@ -46,6 +50,10 @@ struct evdev_client {
 	spinlock_t buffer_lock; /* protects access to buffer, head and tail */
 	struct wake_lock wake_lock;
 	bool use_wake_lock;
+	bool batch;		/* readers only see events up to batch_head */
+	unsigned int batch_head; /* end of the events of the frames gone by */
+	struct list_head batch_node;
+	struct timer_list batch_timer;
 	char name[28];
 	struct fasync_struct *fasync;
 	struct evdev *evdev;
@@ -57,6 +65,16 @@ struct evdev_client {
 static struct evdev *evdev_table[EVDEV_MINORS];
 static DEFINE_MUTEX(evdev_table_mutex);
 
+/* clients in batch mode, flushed on every display vsync */
+static LIST_HEAD(evdev_batch_list);
+static DEFINE_SPINLOCK(evdev_batch_lock);
+
+/* end of the events readers may take; called with buffer_lock held */
+static inline unsigned int evdev_ready_head(struct evdev_client *client)
+{
+	return client->batch ? client->batch_head : client->packet_head;
+}
+
 static void evdev_pass_event(struct evdev_client *client,
 			     struct input_event *event)
 {
@@ -79,6 +97,7 @@ static void evdev_pass_event(struct evdev_client *client,
 		client->buffer[client->tail].value = 0;
 
 		client->packet_head = client->tail;
+		client->batch_head = client->tail;
 		if (client->use_wake_lock)
 			wake_unlock(&client->wake_lock);
 	}
@@ -87,7 +106,11 @@ static void evdev_pass_event(struct evdev_client *client,
 		client->packet_head = client->head;
 		if (client->use_wake_lock)
 			wake_lock(&client->wake_lock);
-		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+		if (!client->batch)
+			kill_fasync(&client->fasync, SIGIO, POLL_IN);
+		else if (!timer_pending(&client->batch_timer))
+			mod_timer(&client->batch_timer,
+				  jiffies + EVDEV_BATCH_TIMEOUT);
 	}
 
 	spin_unlock(&client->buffer_lock);
@@ -104,7 +127,11 @@ static void evdev_event(struct input_handle *handle,
 	struct input_event event;
 	struct timespec ts;
 
-	ktime_get_ts(&ts);
+	/* the driver knows when the events happened, better than we do */
+	if (handle->dev->timestamp.tv64)
+		ts = ktime_to_timespec(handle->dev->timestamp);
+	else
+		ktime_get_ts(&ts);
 	event.time.tv_sec = ts.tv_sec;
 	event.time.tv_usec = ts.tv_nsec / NSEC_PER_USEC;
 	event.type = type;
@@ -126,6 +153,56 @@ static void evdev_event(struct input_handle *handle,
 		wake_up_interruptible(&evdev->wait);
 }
 
+/*
+ * Make the packets received so far readable by a client in batch mode,
+ * at once, so that it sees all the events of a frame in one read.
+ */
+static void evdev_batch_flush(struct evdev_client *client)
+{
+	unsigned long flags;
+	bool flushed = false;
+
+	spin_lock_irqsave(&client->buffer_lock, flags);
+	if (client->batch && client->batch_head != client->packet_head) {
+		client->batch_head = client->packet_head;
+		flushed = true;
+	}
+	spin_unlock_irqrestore(&client->buffer_lock, flags);
+
+	if (flushed) {
+		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+		wake_up_interruptible(&client->evdev->wait);
+	}
+}
+
+static void evdev_batch_timeout(unsigned long data)
+{
+	evdev_batch_flush((struct evdev_client *)data);
+}
+
+static int evdev_vsync(struct notifier_block *nb, unsigned long unused,
+		       void *timestamp)
+{
+	struct evdev_client *client;
+	unsigned long flags;
+
+	if (list_empty(&evdev_batch_list))
+		return NOTIFY_DONE;
+
+	spin_lock_irqsave(&evdev_batch_lock, flags);
+	list_for_each_entry(client, &evdev_batch_list, batch_node) {
+		del_timer(&client->batch_timer);
+		evdev_batch_flush(client);
+	}
+	spin_unlock_irqrestore(&evdev_batch_lock, flags);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block evdev_vsync_nb = {
+	.notifier_call = evdev_vsync,
+};
+
 static int evdev_fasync(int fd, struct file *file, int on)
 {
 	struct evdev_client *client = file->private_data;
@@ -266,6 +343,12 @@ static int evdev_release(struct inode *inode, struct file *file)
 	mutex_unlock(&evdev->mutex);
 
 	evdev_detach_client(evdev, client);
+	if (client->batch) {
+		spin_lock_irq(&evdev_batch_lock);
+		list_del(&client->batch_node);
+		spin_unlock_irq(&evdev_batch_lock);
+	}
+	del_timer_sync(&client->batch_timer);
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
 	kfree(client);
@@ -319,6 +402,8 @@ static int evdev_open(struct inode *inode, struct file *file)
 
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
+	setup_timer(&client->batch_timer, evdev_batch_timeout,
+		    (unsigned long)client);
 	snprintf(client->name, sizeof(client->name), "%s-%d",
 			dev_name(&evdev->dev), task_tgid_vnr(current));
 	client->evdev = evdev;
@@ -384,7 +469,7 @@ static int evdev_fetch_next_event(struct evdev_client *client,
 
 	spin_lock_irq(&client->buffer_lock);
 
-	have_event = client->packet_head != client->tail;
+	have_event = evdev_ready_head(client) != client->tail;
 	if (have_event) {
 		*event = client->buffer[client->tail++];
 		client->tail &= client->bufsize - 1;
@@ -411,7 +496,8 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 
 	if (!(file->f_flags & O_NONBLOCK)) {
 		retval = wait_event_interruptible(evdev->wait,
-			 client->packet_head != client->tail || !evdev->exist);
+			 evdev_ready_head(client) != client->tail ||
+			 !evdev->exist);
 		if (retval)
 			return retval;
 	}
@@ -443,7 +529,7 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	poll_wait(file, &evdev->wait, wait);
 
 	mask = evdev->exist ? POLLOUT | POLLWRNORM : POLLHUP | POLLERR;
-	if (client->packet_head != client->tail)
+	if (evdev_ready_head(client) != client->tail)
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
@@ -668,6 +754,53 @@ static int evdev_disable_suspend_block(struct evdev *evdev,
 	return 0;
 }
 
+static int evdev_set_batch(struct evdev_client *client, bool on)
+{
+	if (client->batch == on)
+		return 0;
+
+	spin_lock_irq(&evdev_batch_lock);
+	if (on)
+		list_add_tail(&client->batch_node, &evdev_batch_list);
+	else
+		list_del(&client->batch_node);
+	spin_unlock_irq(&evdev_batch_lock);
+
+	spin_lock_irq(&client->buffer_lock);
+	client->batch_head = client->packet_head;
+	client->batch = on;
+	spin_unlock_irq(&client->buffer_lock);
+
+	if (!on) {
+		del_timer_sync(&client->batch_timer);
+		wake_up_interruptible(&client->evdev->wait);
+	}
+
+	return 0;
+}
+
+/* Hand over the events of the frames gone by, without waiting for more */
+static int evdev_read_batch(struct evdev_client *client, unsigned int size,
+			    void __user *p)
+{
+	struct input_event event;
+	int retval = 0;
+
+	if (!client->evdev->exist)
+		return -ENODEV;
+
+	while (retval + input_event_size() <= size &&
+	       evdev_fetch_next_event(client, &event)) {
+
+		if (input_event_to_user(p + retval, &event))
+			return -EFAULT;
+
+		retval += input_event_size();
+	}
+
+	return retval;
+}
+
 static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 			   void __user *p, int compat_mode)
 {
@@ -750,6 +883,9 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 			return evdev_enable_suspend_block(evdev, client);
 		else
 			return evdev_disable_suspend_block(evdev, client);
+
+	case EVIOCSBATCH:
+		return evdev_set_batch(client, p != NULL);
 	}
 
 	size = _IOC_SIZE(cmd);
@@ -783,6 +919,9 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 	case EVIOCGUNIQ(0):
 		return str_to_user(dev->uniq, size, p);
 
+	case EVIOCGBATCH(0):
+		return evdev_read_batch(client, size, p);
+
 	case EVIOC_MASK_SIZE(EVIOCSFF):
 		if (input_ff_effect_from_user(p, size, &effect))
 			return -EFAULT;
@@ -1053,11 +1192,19 @@ static struct input_handler evdev_handler = {
 
 static int __init evdev_init(void)
 {
-	return input_register_handler(&evdev_handler);
+	int error;
+
+	error = input_register_handler(&evdev_handler);
+	if (error)
+		return error;
+
+	input_register_vsync_notifier(&evdev_vsync_nb);
+	return 0;
 }
 
 static void __exit evdev_exit(void)
 {
+	input_unregister_vsync_notifier(&evdev_vsync_nb);
 	input_unregister_handler(&evdev_handler);
 }
 
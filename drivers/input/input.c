@@ -325,6 +325,9 @@ static void input_handle_event(struct input_dev *dev,
 
 	if (disposition & INPUT_PASS_TO_HANDLERS)
 		input_pass_event(dev, type, code, value);
+
+	if (type == EV_SYN && code == SYN_REPORT)
+		dev->timestamp = ktime_set(0, 0);
 }
 
 /**
@@ -359,6 +362,34 @@ void input_event(struct input_dev *dev,
 }
 EXPORT_SYMBOL(input_event);
 
+static ATOMIC_NOTIFIER_HEAD(input_vsync_chain);
+
+/**
+ * input_vsync - tell input handlers that the display started a new frame
+ * @timestamp: CLOCK_MONOTONIC time of the vertical sync
+ *
+ * Called from the display controller's interrupt handler, so that
+ * handlers delivering events once per frame hand over what they got
+ * since the last one.
+ */
+void input_vsync(ktime_t timestamp)
+{
+	atomic_notifier_call_chain(&input_vsync_chain, 0, &timestamp);
+}
+EXPORT_SYMBOL(input_vsync);
+
+int input_register_vsync_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&input_vsync_chain, nb);
+}
+EXPORT_SYMBOL(input_register_vsync_notifier);
+
+int input_unregister_vsync_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&input_vsync_chain, nb);
+}
+EXPORT_SYMBOL(input_unregister_vsync_notifier);
+
 /**
  * input_inject_event() - send input event from input handler
  * @handle: input handle to send event through
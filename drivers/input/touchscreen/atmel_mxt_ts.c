@@ -20,6 +20,12 @@
 #include <linux/input/mt.h>
 #include <linux/interrupt.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/log2_hist.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/atmel_mxt_ts.h>
 
 /* Version */
 #define MXT_VER_20		20
@@ -206,6 +212,9 @@
 
 #define MXT_MAX_FINGER		10
 
+/* IRQ to input_sync() latency histogram, powers of two ms from 1ms */
+#define MXT_LAT_BINS		8
+
 struct mxt_info {
 	u8 family_id;
 	u8 variant_id;
@@ -251,6 +260,26 @@ struct mxt_data {
 	unsigned int irq;
 	unsigned int max_x;
 	unsigned int max_y;
+
+	/* message processing */
+	u16 T5_address;
+	u8 T5_msg_size;
+	u16 T44_address;
+	u8 T9_reportid_min;
+	u8 T9_reportid_max;
+	u8 max_msgs;
+	u8 *msg_buf;
+	int finger_num;
+
+	/* touch latency */
+	ktime_t irq_time;
+	unsigned int nr_irqs;
+	unsigned int nr_xfers;
+	unsigned int nr_msgs;
+	unsigned int nr_syncs;
+	u64 lat_total_us;
+	unsigned int lat_max_us;
+	unsigned int lat_hist[MXT_LAT_BINS];
 };
 
 static bool mxt_object_readable(unsigned int type)
@@ -492,6 +521,21 @@ static int mxt_write_object(struct mxt_data *data,
 	return mxt_write_reg(data->client, reg + offset, val);
 }
 
+static void mxt_account_latency(struct mxt_data *data, int finger_num)
+{
+	s64 us = ktime_us_delta(ktime_get(), data->irq_time);
+
+	if (us < 0)
+		us = 0;
+	trace_mxt_input_sync(finger_num, us);
+
+	data->nr_syncs++;
+	data->lat_total_us += us;
+	if (us > data->lat_max_us)
+		data->lat_max_us = us;
+	data->lat_hist[log2_hist_bucket(us >> 10, MXT_LAT_BINS)]++;
+}
+
 static void mxt_input_report(struct mxt_data *data, int single_id)
 {
 	struct mxt_finger *finger = data->finger;
@@ -500,6 +544,8 @@ static void mxt_input_report(struct mxt_data *data, int single_id)
 	int finger_num = 0;
 	int id;
 
+	input_set_timestamp(input_dev, data->irq_time);
+
 	for (id = 0; id < MXT_MAX_FINGER; id++) {
 		if (!finger[id].status)
 			continue;
@@ -529,6 +575,8 @@ static void mxt_input_report(struct mxt_data *data, int single_id)
 	}
 
 	input_sync(input_dev);
+	data->finger_num = finger_num;
+	mxt_account_latency(data, finger_num);
 }
 
 static void mxt_input_touchevent(struct mxt_data *data,
@@ -578,41 +626,120 @@ static void mxt_input_touchevent(struct mxt_data *data,
 	mxt_input_report(data, id);
 }
 
-static irqreturn_t mxt_interrupt(int irq, void *dev_id)
+/* Handle one T5 message, returning its report id */
+static u8 mxt_proc_message(struct mxt_data *data, const u8 *msg)
 {
-	struct mxt_data *data = dev_id;
-	struct mxt_message message;
-	struct mxt_object *object;
 	struct device *dev = &data->client->dev;
-	int id;
-	u8 reportid;
-	u8 max_reportid;
-	u8 min_reportid;
+	struct mxt_message message = { 0 };
+	u8 reportid = msg[0];
 
-	do {
-		if (mxt_read_message(data, &message)) {
-			dev_err(dev, "Failed to read message\n");
-			goto end;
-		}
+	memcpy(&message, msg, min_t(unsigned int, data->T5_msg_size,
+				    sizeof(message)));
+	data->nr_msgs++;
+
+	if (reportid >= data->T9_reportid_min &&
+	    reportid <= data->T9_reportid_max)
+		mxt_input_touchevent(data, &message,
+				     reportid - data->T9_reportid_min);
+	else if (reportid != 0xff)
+		mxt_dump_message(dev, &message);
+
+	return reportid;
+}
+
+static int mxt_read_messages(struct mxt_data *data, u8 count, u8 *buf)
+{
+	data->nr_xfers++;
+	return __mxt_read_reg(data->client, data->T5_address,
+			      data->T5_msg_size * count, buf);
+}
+
+/*
+ * The message count object tells how many messages are pending: read
+ * it along with the first message when it sits right before T5, as it
+ * usually does, and the others in one burst.
+ */
+static int mxt_process_messages_t44(struct mxt_data *data)
+{
+	u8 *buf = data->msg_buf;
+	int count, n, i;
+	int error;
+
+	data->nr_xfers++;
+	if (data->T44_address + 1 == data->T5_address) {
+		error = __mxt_read_reg(data->client, data->T44_address,
+				       1 + data->T5_msg_size, buf);
+		if (error)
+			return error;
+		count = buf[0];
+		if (!count)
+			return 0;
+		mxt_proc_message(data, buf + 1);
+		count--;
+	} else {
+		error = __mxt_read_reg(data->client, data->T44_address,
+				       1, buf);
+		if (error)
+			return error;
+		count = buf[0];
+	}
+
+	while (count) {
+		n = min_t(int, count, data->max_msgs);
+		error = mxt_read_messages(data, n, buf);
+		if (error)
+			return error;
+		for (i = 0; i < n; i++)
+			mxt_proc_message(data, buf + i * data->T5_msg_size);
+		count -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * Without it, read one message per finger down plus one in a burst:
+ * that is usually all of them and the 0xff report id ending the queue.
+ */
+static int mxt_process_messages(struct mxt_data *data)
+{
+	u8 *buf = data->msg_buf;
+	int n, i;
+	int error;
 
-		reportid = message.reportid;
+	for (;;) {
+		n = clamp_t(int, data->finger_num + 1, 1, data->max_msgs);
+		error = mxt_read_messages(data, n, buf);
+		if (error)
+			return error;
+		for (i = 0; i < n; i++)
+			if (mxt_proc_message(data,
+					buf + i * data->T5_msg_size) == 0xff)
+				return 0;
+	}
+}
 
-		/* whether reportid is thing of MXT_TOUCH_MULTI */
-		object = mxt_get_object(data, MXT_TOUCH_MULTI);
-		if (!object)
-			goto end;
+static irqreturn_t mxt_irq_edge(int irq, void *dev_id)
+{
+	struct mxt_data *data = dev_id;
 
-		max_reportid = object->max_reportid;
-		min_reportid = max_reportid - object->num_report_ids + 1;
-		id = reportid - min_reportid;
+	data->irq_time = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
 
-		if (reportid >= min_reportid && reportid <= max_reportid)
-			mxt_input_touchevent(data, &message, id);
-		else
-			mxt_dump_message(dev, &message);
-	} while (reportid != 0xff);
+static irqreturn_t mxt_interrupt(int irq, void *dev_id)
+{
+	struct mxt_data *data = dev_id;
+	int error;
+
+	data->nr_irqs++;
+	if (data->T44_address)
+		error = mxt_process_messages_t44(data);
+	else
+		error = mxt_process_messages(data);
+	if (error)
+		dev_err(&data->client->dev, "Failed to read message\n");
 
-end:
 	return IRQ_HANDLED;
 }
 
@@ -763,6 +890,11 @@ static int mxt_get_object_table(struct mxt_data *data)
 	u8 reportid = 0;
 	u8 buf[MXT_OBJECT_SIZE];
 
+	data->T5_address = 0;
+	data->T44_address = 0;
+	data->T9_reportid_min = 0xff;
+	data->T9_reportid_max = 0;
+
 	for (i = 0; i < data->info.object_num; i++) {
 		struct mxt_object *object = data->object_table + i;
 
@@ -782,8 +914,35 @@ static int mxt_get_object_table(struct mxt_data *data)
 					(object->instances + 1);
 			object->max_reportid = reportid;
 		}
+
+		switch (object->type) {
+		case MXT_GEN_MESSAGE:
+			data->T5_address = object->start_address;
+			data->T5_msg_size = object->size + 1;
+			break;
+		case MXT_SPT_MESSAGECOUNT:
+			data->T44_address = object->start_address;
+			break;
+		case MXT_TOUCH_MULTI:
+			data->T9_reportid_max = object->max_reportid;
+			data->T9_reportid_min = object->max_reportid -
+				object->num_report_ids + 1;
+			break;
+		}
 	}
 
+	if (!data->T5_address) {
+		dev_err(&data->client->dev, "No message object\n");
+		return -EINVAL;
+	}
+
+	/* room for all the report ids and the message count */
+	data->max_msgs = max_t(u8, reportid, 1);
+	data->msg_buf = kcalloc(data->max_msgs, data->T5_msg_size + 1,
+				GFP_KERNEL);
+	if (!data->msg_buf)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -1001,6 +1160,8 @@ static ssize_t mxt_update_fw_store(struct device *dev,
 
 		kfree(data->object_table);
 		data->object_table = NULL;
+		kfree(data->msg_buf);
+		data->msg_buf = NULL;
 
 		mxt_initialize(data);
 	}
@@ -1014,12 +1175,37 @@ static ssize_t mxt_update_fw_store(struct device *dev,
 	return count;
 }
 
+static ssize_t mxt_latency_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct mxt_data *data = dev_get_drvdata(dev);
+	int count;
+	int i;
+
+	count = sprintf(buf, "%s, %u irqs, %u transfers, %u messages\n",
+			data->T44_address ? "message count" : "burst",
+			data->nr_irqs, data->nr_xfers, data->nr_msgs);
+	count += sprintf(buf + count, "%u reports, avg %llu us, max %u us\n",
+			 data->nr_syncs, data->nr_syncs ?
+			 div_u64(data->lat_total_us, data->nr_syncs) : 0ULL,
+			 data->lat_max_us);
+	for (i = 0; i < MXT_LAT_BINS; i++)
+		count += sprintf(buf + count, "%s%llums: %u\n",
+				 i < MXT_LAT_BINS - 1 ? "<" : ">=",
+				 log2_hist_bound(i, MXT_LAT_BINS),
+				 data->lat_hist[i]);
+
+	return count;
+}
+
 static DEVICE_ATTR(object, 0444, mxt_object_show, NULL);
 static DEVICE_ATTR(update_fw, 0664, NULL, mxt_update_fw_store);
+static DEVICE_ATTR(latency, 0444, mxt_latency_show, NULL);
 
 static struct attribute *mxt_attrs[] = {
 	&dev_attr_object.attr,
 	&dev_attr_update_fw.attr,
+	&dev_attr_latency.attr,
 	NULL
 };
 
@@ -1115,7 +1301,7 @@ static int __devinit mxt_probe(struct i2c_client *client,
 	if (error)
 		goto err_free_object;
 
-	error = request_threaded_irq(client->irq, NULL, mxt_interrupt,
+	error = request_threaded_irq(client->irq, mxt_irq_edge, mxt_interrupt,
 			pdata->irqflags, client->dev.driver->name, data);
 	if (error) {
 		dev_err(&client->dev, "Failed to register interrupt\n");
@@ -1142,6 +1328,7 @@ err_unregister_device:
 err_free_irq:
 	free_irq(client->irq, data);
 err_free_object:
+	kfree(data->msg_buf);
 	kfree(data->object_table);
 err_free_mem:
 	input_free_device(input_dev);
@@ -1156,6 +1343,7 @@ static int __devexit mxt_remove(struct i2c_client *client)
 	sysfs_remove_group(&client->dev.kobj, &mxt_attr_group);
 	free_irq(data->irq, data);
 	input_unregister_device(data->input_dev);
+	kfree(data->msg_buf);
 	kfree(data->object_table);
 	kfree(data);
 
@@ -828,6 +828,9 @@ static int __devinit mms_ts_probe(struct i2c_client *client,
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	info->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
+	/* the controller takes a while to come back, let the rest go on */
+	info->early_suspend.flags = EARLY_SUSPEND_ASYNC |
+				    EARLY_SUSPEND_RESUME_FIRST;
 	info->early_suspend.suspend = mms_ts_early_suspend;
 	info->early_suspend.resume = mms_ts_late_resume;
 	register_early_suspend(&info->early_suspend);
@@ -19,6 +19,7 @@
 #include <linux/workqueue.h>
 #include <linux/backing-dev.h>
 #include <linux/percpu.h>
+#include <linux/sched.h>
 #include <asm/atomic.h>
 #include <linux/scatterlist.h>
 #include <asm/page.h>
@@ -102,13 +103,16 @@ struct iv_lmk_private {
  * Crypt: maps a linear range of a block device
  * and encrypts / decrypts at the same time.
  */
-enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID };
+enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID, DM_CRYPT_SAME_CPU };
 
 /*
  * Duplicated per-CPU state for cipher.
  */
 struct crypt_cpu {
 	struct ablkcipher_request *req;
+	/* sectors converted, indexed by READ/WRITE, and time spent on it */
+	u64 sectors[2];
+	u64 busy_ns;
 	/* ESSIV: struct crypto_cipher *essiv_tfm */
 	void *iv_private;
 	struct crypto_ablkcipher *tfms[0];
@@ -146,6 +150,10 @@ struct crypt_config {
 	sector_t iv_offset;
 	unsigned int iv_size;
 
+	/* bytes handed to the cipher in one request, 512 unless configured */
+	unsigned int sector_size;
+	unsigned int sector_shift;
+
 	/*
 	 * Duplicated per cpu state. Access through
 	 * per_cpu_ptr() only.
@@ -168,6 +176,18 @@ struct crypt_config {
 	 */
 	unsigned int dmreq_start;
 
+	/*
+	 * Unless DM_CRYPT_SAME_CPU is set, bios are spread round robin
+	 * over the per-CPU kcryptd workers starting after next_cpu (a
+	 * hint, updated without locking), and the encrypted writes are
+	 * collected in write_bios, sorted by sector, to be sent down
+	 * together by write_work.
+	 */
+	int next_cpu;
+	spinlock_t write_lock;
+	struct bio_list write_bios;
+	struct work_struct write_work;
+
 	unsigned long flags;
 	unsigned int key_size;
 	unsigned int key_parts;
@@ -697,26 +717,31 @@ static int crypt_convert_block(struct crypt_config *cc,
 	u8 *iv;
 	int r = 0;
 
+	/* a crypto sector may not straddle two bio_vecs */
+	if (unlikely((bv_in->bv_len & (cc->sector_size - 1)) ||
+		     (bv_out->bv_len & (cc->sector_size - 1))))
+		return -EIO;
+
 	dmreq = dmreq_of_req(cc, req);
 	iv = iv_of_dmreq(cc, dmreq);
 
 	dmreq->iv_sector = ctx->sector;
 	dmreq->ctx = ctx;
 	sg_init_table(&dmreq->sg_in, 1);
-	sg_set_page(&dmreq->sg_in, bv_in->bv_page, 1 << SECTOR_SHIFT,
+	sg_set_page(&dmreq->sg_in, bv_in->bv_page, cc->sector_size,
 		    bv_in->bv_offset + ctx->offset_in);
 
 	sg_init_table(&dmreq->sg_out, 1);
-	sg_set_page(&dmreq->sg_out, bv_out->bv_page, 1 << SECTOR_SHIFT,
+	sg_set_page(&dmreq->sg_out, bv_out->bv_page, cc->sector_size,
 		    bv_out->bv_offset + ctx->offset_out);
 
-	ctx->offset_in += 1 << SECTOR_SHIFT;
+	ctx->offset_in += cc->sector_size;
 	if (ctx->offset_in >= bv_in->bv_len) {
 		ctx->offset_in = 0;
 		ctx->idx_in++;
 	}
 
-	ctx->offset_out += 1 << SECTOR_SHIFT;
+	ctx->offset_out += cc->sector_size;
 	if (ctx->offset_out >= bv_out->bv_len) {
 		ctx->offset_out = 0;
 		ctx->idx_out++;
@@ -729,7 +754,7 @@ static int crypt_convert_block(struct crypt_config *cc,
 	}
 
 	ablkcipher_request_set_crypt(req, &dmreq->sg_in, &dmreq->sg_out,
-				     1 << SECTOR_SHIFT, iv);
+				     cc->sector_size, iv);
 
 	if (bio_data_dir(ctx->bio_in) == WRITE)
 		r = crypto_ablkcipher_encrypt(req);
@@ -767,6 +792,9 @@ static int crypt_convert(struct crypt_config *cc,
 			 struct convert_context *ctx)
 {
 	struct crypt_cpu *this_cc = this_crypt_config(cc);
+	sector_t first_sector = ctx->sector;
+	u64 start = local_clock();
+	int rw = bio_data_dir(ctx->bio_in);
 	int r;
 
 	atomic_set(&ctx->pending, 1);
@@ -788,24 +816,30 @@ static int crypt_convert(struct crypt_config *cc,
 			/* fall through*/
 		case -EINPROGRESS:
 			this_cc->req = NULL;
-			ctx->sector++;
+			ctx->sector += 1 << cc->sector_shift;
 			continue;
 
 		/* sync */
 		case 0:
 			atomic_dec(&ctx->pending);
-			ctx->sector++;
+			ctx->sector += 1 << cc->sector_shift;
 			cond_resched();
 			continue;
 
 		/* error */
 		default:
 			atomic_dec(&ctx->pending);
-			return r;
+			goto out;
 		}
 	}
+	r = 0;
 
-	return 0;
+out:
+	/* cond_resched() keeps us on this CPU, kcryptd workers are bound */
+	this_cc->sectors[rw] += ctx->sector - first_sector;
+	this_cc->busy_ns += local_clock() - start;
+
+	return r;
 }
 
 static void dm_crypt_bio_destructor(struct bio *bio)
@@ -1044,6 +1078,53 @@ static void kcryptd_queue_io(struct dm_crypt_io *io)
 	queue_work(cc->io_queue, &io->work);
 }
 
+/*
+ * With several kcryptd workers encrypting at once, writes come out of
+ * them in whatever order they finish.  Put them back in sector order and
+ * submit them from kcryptd_io in a batch, so that the device still sees
+ * the sequential streams it was given.
+ */
+static void kcryptd_io_write_sorted(struct work_struct *work)
+{
+	struct crypt_config *cc = container_of(work, struct crypt_config,
+					       write_work);
+	struct bio_list bios;
+	struct blk_plug plug;
+	struct bio *clone;
+
+	spin_lock_irq(&cc->write_lock);
+	bios = cc->write_bios;
+	bio_list_init(&cc->write_bios);
+	spin_unlock_irq(&cc->write_lock);
+
+	blk_start_plug(&plug);
+	while ((clone = bio_list_pop(&bios)))
+		generic_make_request(clone);
+	blk_finish_plug(&plug);
+}
+
+static void kcryptd_queue_write(struct crypt_config *cc, struct bio *clone)
+{
+	struct bio **p;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cc->write_lock, flags);
+	if (bio_list_empty(&cc->write_bios) ||
+	    cc->write_bios.tail->bi_sector < clone->bi_sector)
+		bio_list_add(&cc->write_bios, clone);
+	else {
+		/* the tail sorts after us, so this stops before it */
+		for (p = &cc->write_bios.head;
+		     (*p)->bi_sector < clone->bi_sector; p = &(*p)->bi_next)
+			;
+		clone->bi_next = *p;
+		*p = clone;
+	}
+	spin_unlock_irqrestore(&cc->write_lock, flags);
+
+	queue_work(cc->io_queue, &cc->write_work);
+}
+
 static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 {
 	struct bio *clone = io->ctx.bio_out;
@@ -1061,7 +1142,9 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 
 	clone->bi_sector = cc->start + io->sector;
 
-	if (async)
+	if (!test_bit(DM_CRYPT_SAME_CPU, &cc->flags))
+		kcryptd_queue_write(cc, clone);
+	else if (async)
 		kcryptd_queue_io(io);
 	else
 		generic_make_request(clone);
@@ -1227,12 +1310,32 @@ static void kcryptd_crypt(struct work_struct *work)
 		kcryptd_crypt_write_convert(io);
 }
 
+/*
+ * Read completions all arrive on the CPU taking the disk interrupt and
+ * writes mostly come from a single flusher, so left to queue_work() the
+ * cipher would run on one CPU however many there are.
+ */
+static int crypt_next_cpu(struct crypt_config *cc)
+{
+	int cpu;
+
+	cpu = cpumask_next(ACCESS_ONCE(cc->next_cpu), cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first(cpu_online_mask);
+	cc->next_cpu = cpu;
+
+	return cpu;
+}
+
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->target->private;
 
 	INIT_WORK(&io->work, kcryptd_crypt);
-	queue_work(cc->crypt_queue, &io->work);
+	if (test_bit(DM_CRYPT_SAME_CPU, &cc->flags))
+		queue_work(cc->crypt_queue, &io->work);
+	else
+		queue_work_on(crypt_next_cpu(cc), cc->crypt_queue, &io->work);
 }
 
 /*
@@ -1581,9 +1684,10 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	int ret;
 	struct dm_arg_set as;
 	const char *opt_string;
+	char dummy;
 
 	static struct dm_arg _args[] = {
-		{0, 1, "Invalid number of feature args"},
+		{0, 3, "Invalid number of feature args"},
 	};
 
 	if (argc < 5) {
@@ -1599,6 +1703,11 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		return -ENOMEM;
 	}
 	cc->key_size = key_size;
+	cc->sector_size = 1 << SECTOR_SHIFT;
+	cc->next_cpu = -1;
+	spin_lock_init(&cc->write_lock);
+	bio_list_init(&cc->write_bios);
+	INIT_WORK(&cc->write_work, kcryptd_io_write_sorted);
 
 	ti->private = cc;
 	ret = crypt_ctr_cipher(ti, argv[0], argv[1]);
@@ -1667,14 +1776,48 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		if (ret)
 			goto bad;
 
-		opt_string = dm_shift_arg(&as);
+		while (opt_params--) {
+			opt_string = dm_shift_arg(&as);
+			if (!opt_string) {
+				ret = -EINVAL;
+				ti->error = "Not enough feature arguments";
+				goto bad;
+			}
 
-		if (opt_params == 1 && opt_string &&
-		    !strcasecmp(opt_string, "allow_discards"))
-			ti->num_discard_requests = 1;
-		else if (opt_params) {
-			ret = -EINVAL;
-			ti->error = "Invalid feature arguments";
+			if (!strcasecmp(opt_string, "allow_discards"))
+				ti->num_discard_requests = 1;
+			else if (!strcasecmp(opt_string, "same_cpu_crypt"))
+				set_bit(DM_CRYPT_SAME_CPU, &cc->flags);
+			else if (sscanf(opt_string, "sector_size:%u%c",
+					&cc->sector_size, &dummy) == 1) {
+				if (cc->sector_size < (1 << SECTOR_SHIFT) ||
+				    cc->sector_size > PAGE_SIZE ||
+				    !is_power_of_2(cc->sector_size)) {
+					ret = -EINVAL;
+					ti->error = "Invalid sector_size";
+					goto bad;
+				}
+				cc->sector_shift = __ffs(cc->sector_size) -
+						   SECTOR_SHIFT;
+			} else {
+				ret = -EINVAL;
+				ti->error = "Invalid feature arguments";
+				goto bad;
+			}
+		}
+	}
+
+	if (cc->sector_shift) {
+		ret = -EINVAL;
+		if ((ti->len | cc->iv_offset) &
+		    ((1 << cc->sector_shift) - 1)) {
+			ti->error = "Device size or iv_offset not a multiple "
+				    "of sector_size";
+			goto bad;
+		}
+		/* lmk and multi-key mode are defined on 512 byte sectors */
+		if (cc->tfms_count > 1 || cc->iv_gen_ops == &crypt_iv_lmk_ops) {
+			ti->error = "sector_size not supported with this cipher";
 			goto bad;
 		}
 	}
@@ -1728,6 +1871,11 @@ static int crypt_map(struct dm_target *ti, struct bio *bio,
 		return DM_MAPIO_REMAPPED;
 	}
 
+	cc = ti->private;
+	if (unlikely((dm_target_offset(ti, bio->bi_sector) |
+		      bio_sectors(bio)) & ((1 << cc->sector_shift) - 1)))
+		return -EIO;
+
 	io = crypt_io_alloc(ti, bio, dm_target_offset(ti, bio->bi_sector));
 
 	if (bio_data_dir(io->base_bio) == READ) {
@@ -1744,10 +1892,27 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 {
 	struct crypt_config *cc = ti->private;
 	unsigned int sz = 0;
+	unsigned int num_feature_args;
+	u64 sectors[2] = { 0, 0 }, busy_ns = 0;
+	struct crypt_cpu *cpu_cc;
+	int cpu;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		result[0] = '\0';
+		/*
+		 * <sectors decrypted> <sectors encrypted> <worker usecs>,
+		 * throughput being the change in the first two over the
+		 * change in the third.
+		 */
+		for_each_possible_cpu(cpu) {
+			cpu_cc = per_cpu_ptr(cc->cpu, cpu);
+			sectors[READ] += cpu_cc->sectors[READ];
+			sectors[WRITE] += cpu_cc->sectors[WRITE];
+			busy_ns += cpu_cc->busy_ns;
+		}
+		DMEMIT("%llu %llu %llu", (unsigned long long)sectors[READ],
+		       (unsigned long long)sectors[WRITE],
+		       (unsigned long long)div_u64(busy_ns, NSEC_PER_USEC));
 		break;
 
 	case STATUSTYPE_TABLE:
@@ -1768,8 +1933,18 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 		DMEMIT(" %llu %s %llu", (unsigned long long)cc->iv_offset,
 				cc->dev->name, (unsigned long long)cc->start);
 
-		if (ti->num_discard_requests)
-			DMEMIT(" 1 allow_discards");
+		num_feature_args = !!ti->num_discard_requests +
+				   test_bit(DM_CRYPT_SAME_CPU, &cc->flags) +
+				   !!cc->sector_shift;
+		if (num_feature_args) {
+			DMEMIT(" %u", num_feature_args);
+			if (ti->num_discard_requests)
+				DMEMIT(" allow_discards");
+			if (test_bit(DM_CRYPT_SAME_CPU, &cc->flags))
+				DMEMIT(" same_cpu_crypt");
+			if (cc->sector_shift)
+				DMEMIT(" sector_size:%u", cc->sector_size);
+		}
 
 		break;
 	}
@@ -1865,9 +2040,24 @@ static int crypt_iterate_devices(struct dm_target *ti,
 	return fn(ti, cc->dev, cc->start, ti->len, data);
 }
 
+static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
+{
+	struct crypt_config *cc = ti->private;
+
+	/* never hand us less than a whole crypto sector */
+	limits->logical_block_size = max_t(unsigned short,
+					   limits->logical_block_size,
+					   cc->sector_size);
+	limits->physical_block_size = max_t(unsigned int,
+					    limits->physical_block_size,
+					    cc->sector_size);
+	blk_limits_io_min(limits, max_t(unsigned int, limits->io_min,
+					cc->sector_size));
+}
+
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 11, 0},
+	.version = {1, 12, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -1879,6 +2069,7 @@ static struct target_type crypt_target = {
 	.message = crypt_message,
 	.merge  = crypt_merge,
 	.iterate_devices = crypt_iterate_devices,
+	.io_hints = crypt_io_hints,
 };
 
 static int __init dm_crypt_init(void)
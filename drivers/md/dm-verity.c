@@ -0,0 +1,1071 @@
+/*
+ * A read-only target checking every block read against a tree of hashes
+ * whose root is given in the table, so that trusting the root digest is
+ * enough to trust the whole device.  The on-disk format and the table
+ * are those of the dm-verity target used by Chromium OS and Android.
+ *
+ * This file is released under the GPL.
+ *
+ * Hash blocks are kept in a small cache of their own, remembering which
+ * have already been checked against their parent, so that most reads
+ * only have to hash the data.  The hash blocks a read will need are
+ * read ahead, alongside the data, when the bio is mapped, and the data
+ * is verified on a per-CPU workqueue once it has arrived, a bio at a
+ * time.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/ctype.h>
+#include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/mempool.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/device-mapper.h>
+#include <crypto/hash.h>
+
+#define DM_MSG_PREFIX			"verity"
+
+#define DM_VERITY_MEMPOOL_SIZE		4
+#define DM_VERITY_IO_VEC_INLINE		16
+#define DM_VERITY_MAX_LEVELS		63
+
+/* hash blocks a single mapped bio may read ahead per tree level */
+#define DM_VERITY_MAX_PREFETCH		32
+
+static unsigned cache_kb = 1024;
+module_param(cache_kb, uint, 0644);
+MODULE_PARM_DESC(cache_kb, "Hash block cache size in KB for new targets");
+
+enum {
+	HB_READING,
+	HB_VALID,
+	HB_ERROR,
+};
+
+struct dm_verity;
+
+struct verity_hblock {
+	struct hlist_node node;
+	struct list_head lru;
+	struct dm_verity *v;
+	sector_t block;
+	struct page *page;
+	unsigned refs;
+	int state;
+	bool verified;		/* checked against its parent */
+};
+
+struct dm_verity {
+	struct dm_dev *data_dev;
+	struct dm_dev *hash_dev;
+	struct dm_target *ti;
+	struct crypto_shash *tfm;
+	u8 *root_digest;
+	u8 *salt;
+	unsigned salt_size;
+	unsigned digest_size;
+	unsigned shash_descsize;
+	sector_t hash_start;		/* in hash blocks */
+	sector_t data_blocks;
+	sector_t hash_blocks;
+	unsigned char data_dev_block_bits;
+	unsigned char hash_dev_block_bits;
+	unsigned char hash_per_block_bits;	/* log2(hashes in a block) */
+	unsigned char levels;
+	unsigned char version;
+	int hash_failed;
+	sector_t hash_level_block[DM_VERITY_MAX_LEVELS];
+
+	mempool_t *io_mempool;
+	mempool_t *vec_mempool;
+	struct workqueue_struct *verify_wq;
+
+	/* the hash block cache, and its counters, under lock */
+	spinlock_t lock;
+	struct hlist_head *buckets;
+	unsigned nr_buckets;
+	struct list_head lru;
+	unsigned cached;
+	unsigned max_cached;
+	wait_queue_head_t wait;
+	atomic_t reads_in_flight;
+
+	u64 hits;
+	u64 misses;
+	u64 prefetched;
+	u64 verified_ios;
+	u64 verify_ns;
+	u64 max_verify_ns;
+};
+
+struct dm_verity_io {
+	struct dm_verity *v;
+	struct bio *bio;
+	bio_end_io_t *orig_bi_end_io;
+	void *orig_bi_private;
+
+	sector_t block;
+	unsigned n_blocks;
+	ktime_t start;
+
+	struct work_struct work;
+
+	/* the drivers below may change the bio's own vector */
+	unsigned io_vec_size;
+	struct bio_vec *io_vec;
+	struct bio_vec io_vec_inline[DM_VERITY_IO_VEC_INLINE];
+
+	/*
+	 * Followed by the shash_desc, of v->shash_descsize bytes, then the
+	 * digest computed and the one expected, v->digest_size each.
+	 */
+};
+
+static struct shash_desc *io_hash_desc(struct dm_verity *v,
+				       struct dm_verity_io *io)
+{
+	return (struct shash_desc *)(io + 1);
+}
+
+static u8 *io_real_digest(struct dm_verity *v, struct dm_verity_io *io)
+{
+	return (u8 *)(io + 1) + v->shash_descsize;
+}
+
+static u8 *io_want_digest(struct dm_verity *v, struct dm_verity_io *io)
+{
+	return (u8 *)(io + 1) + v->shash_descsize + v->digest_size;
+}
+
+/*
+ * Version 0 hashes the salt after the data, version 1 before it.
+ */
+static int verity_hash_init(struct dm_verity *v, struct shash_desc *desc)
+{
+	int r;
+
+	desc->tfm = v->tfm;
+	desc->flags = CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	r = crypto_shash_init(desc);
+	if (r < 0 || !v->version)
+		return r;
+
+	return crypto_shash_update(desc, v->salt, v->salt_size);
+}
+
+static int verity_hash_final(struct dm_verity *v, struct shash_desc *desc,
+			     u8 *digest)
+{
+	int r;
+
+	if (!v->version) {
+		r = crypto_shash_update(desc, v->salt, v->salt_size);
+		if (r < 0)
+			return r;
+	}
+
+	return crypto_shash_final(desc, digest);
+}
+
+static int verity_hash(struct dm_verity *v, struct shash_desc *desc,
+		       const u8 *data, size_t len, u8 *digest)
+{
+	int r;
+
+	r = verity_hash_init(v, desc);
+	if (r < 0)
+		return r;
+
+	r = crypto_shash_update(desc, data, len);
+	if (r < 0)
+		return r;
+
+	return verity_hash_final(v, desc, digest);
+}
+
+/*
+ * The hash block at @level holding the digest of @block, the data block
+ * at level 0 or the hash block below otherwise, and the digest's offset
+ * within it.
+ */
+static void verity_hash_at_level(struct dm_verity *v, sector_t block,
+				 int level, sector_t *hash_block,
+				 unsigned *offset)
+{
+	sector_t position = block >> (level * v->hash_per_block_bits);
+	unsigned idx;
+
+	*hash_block = v->hash_level_block[level] +
+		      (position >> v->hash_per_block_bits);
+	if (!offset)
+		return;
+
+	idx = position & ((1 << v->hash_per_block_bits) - 1);
+	*offset = idx << (v->hash_dev_block_bits - v->hash_per_block_bits);
+}
+
+/* --- the hash block cache --- */
+
+static struct verity_hblock *verity_hb_find(struct dm_verity *v,
+					    sector_t block)
+{
+	struct verity_hblock *hb;
+	struct hlist_node *n;
+
+	hlist_for_each_entry(hb, n, &v->buckets[block & (v->nr_buckets - 1)],
+			     node)
+		if (hb->block == block)
+			return hb;
+
+	return NULL;
+}
+
+static struct verity_hblock *verity_hb_alloc(struct dm_verity *v,
+					     sector_t block, gfp_t gfp)
+{
+	struct verity_hblock *hb;
+
+	hb = kmalloc(sizeof(*hb), gfp);
+	if (!hb)
+		return NULL;
+
+	hb->page = alloc_page(gfp);
+	if (!hb->page) {
+		kfree(hb);
+		return NULL;
+	}
+
+	hb->v = v;
+	hb->block = block;
+	hb->refs = 0;
+	hb->state = HB_READING;
+	hb->verified = false;
+
+	return hb;
+}
+
+static void verity_hb_free(struct verity_hblock *hb)
+{
+	__free_page(hb->page);
+	kfree(hb);
+}
+
+static void verity_hb_end_io(struct bio *bio, int error)
+{
+	struct verity_hblock *hb = bio->bi_private;
+	struct dm_verity *v = hb->v;
+	unsigned long flags;
+
+	if (!error && !bio_flagged(bio, BIO_UPTODATE))
+		error = -EIO;
+
+	spin_lock_irqsave(&v->lock, flags);
+	hb->state = error ? HB_ERROR : HB_VALID;
+	spin_unlock_irqrestore(&v->lock, flags);
+
+	bio_put(bio);
+	wake_up_all(&v->wait);
+
+	/* last, the destructor waits for this to drop to zero */
+	atomic_dec(&v->reads_in_flight);
+}
+
+static void verity_hb_submit(struct dm_verity *v, struct verity_hblock *hb,
+			     gfp_t gfp)
+{
+	struct bio *bio;
+	unsigned long flags;
+
+	bio = bio_alloc(gfp, 1);
+	if (!bio) {
+		spin_lock_irqsave(&v->lock, flags);
+		hb->state = HB_ERROR;
+		spin_unlock_irqrestore(&v->lock, flags);
+		wake_up_all(&v->wait);
+		atomic_dec(&v->reads_in_flight);
+		return;
+	}
+
+	bio->bi_sector = hb->block << (v->hash_dev_block_bits - SECTOR_SHIFT);
+	bio->bi_bdev = v->hash_dev->bdev;
+	bio->bi_end_io = verity_hb_end_io;
+	bio->bi_private = hb;
+	bio_add_page(bio, hb->page, 1 << v->hash_dev_block_bits, 0);
+
+	submit_bio(READ | REQ_META, bio);
+}
+
+/* the least recently used block nobody holds or waits on, if any */
+static struct verity_hblock *verity_hb_evict(struct dm_verity *v)
+{
+	struct verity_hblock *hb;
+
+	list_for_each_entry(hb, &v->lru, lru) {
+		if (hb->refs || hb->state == HB_READING)
+			continue;
+
+		hlist_del(&hb->node);
+		list_del(&hb->lru);
+		v->cached--;
+		return hb;
+	}
+
+	return NULL;
+}
+
+/*
+ * Look up hash block @block, reading it in when it is not cached.
+ *
+ * With @prefetch set the read is only started, nothing is waited for or
+ * returned, and nothing at all is done when the memory is not at hand.
+ * Otherwise a reference to the block is returned once it has been read,
+ * or an error pointer.
+ */
+static struct verity_hblock *verity_hb_get(struct dm_verity *v,
+					   sector_t block, bool prefetch)
+{
+	struct verity_hblock *hb, *new = NULL, *drop = NULL;
+	unsigned long flags;
+	bool submit = false;
+
+	spin_lock_irqsave(&v->lock, flags);
+	hb = verity_hb_find(v, block);
+	if (hb)
+		goto found;
+	spin_unlock_irqrestore(&v->lock, flags);
+
+	new = verity_hb_alloc(v, block, prefetch ?
+			      GFP_NOWAIT | __GFP_NOWARN : GFP_NOIO);
+	if (!new)
+		return prefetch ? NULL : ERR_PTR(-ENOMEM);
+
+	spin_lock_irqsave(&v->lock, flags);
+	hb = verity_hb_find(v, block);
+	if (hb) {
+		/* raced with another reader */
+		drop = new;
+		goto found;
+	}
+
+	hb = new;
+	hlist_add_head(&hb->node, &v->buckets[block & (v->nr_buckets - 1)]);
+	list_add_tail(&hb->lru, &v->lru);
+	if (++v->cached > v->max_cached)
+		drop = verity_hb_evict(v);
+	atomic_inc(&v->reads_in_flight);
+	submit = true;
+
+	if (prefetch) {
+		v->prefetched++;
+		spin_unlock_irqrestore(&v->lock, flags);
+		if (drop)
+			verity_hb_free(drop);
+		verity_hb_submit(v, hb, GFP_NOWAIT | __GFP_NOWARN);
+		return NULL;
+	}
+	v->misses++;
+	goto get;
+
+found:
+	if (prefetch) {
+		spin_unlock_irqrestore(&v->lock, flags);
+		if (drop)
+			verity_hb_free(drop);
+		return NULL;
+	}
+	v->hits++;
+	list_move_tail(&hb->lru, &v->lru);
+	if (hb->state == HB_ERROR && !hb->refs) {
+		/* try again */
+		hb->state = HB_READING;
+		atomic_inc(&v->reads_in_flight);
+		submit = true;
+	}
+
+get:
+	hb->refs++;
+	spin_unlock_irqrestore(&v->lock, flags);
+
+	if (drop)
+		verity_hb_free(drop);
+	if (submit)
+		verity_hb_submit(v, hb, GFP_NOIO);
+
+	wait_event(v->wait, ACCESS_ONCE(hb->state) != HB_READING);
+
+	return hb;
+}
+
+static void verity_hb_put(struct dm_verity *v, struct verity_hblock *hb)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&v->lock, flags);
+	hb->refs--;
+	spin_unlock_irqrestore(&v->lock, flags);
+}
+
+/*
+ * Start reading the hash blocks the data blocks @block..@block+@n-1
+ * will be checked against, at every level.
+ */
+static void verity_prefetch(struct dm_verity *v, sector_t block, unsigned n)
+{
+	sector_t first, last;
+	int i;
+
+	for (i = 0; i < v->levels; i++) {
+		verity_hash_at_level(v, block, i, &first, NULL);
+		verity_hash_at_level(v, block + n - 1, i, &last, NULL);
+		last = min_t(sector_t, last, first + DM_VERITY_MAX_PREFETCH - 1);
+
+		for (; first <= last; first++)
+			verity_hb_get(v, first, true);
+	}
+}
+
+/* --- verification --- */
+
+/*
+ * Walk the tree from the root down to the hash block holding the digest
+ * of data block @block, checking whatever has not been checked yet on
+ * the way, and leave that digest in io_want_digest().
+ */
+static int verity_tree_walk(struct dm_verity_io *io, sector_t block)
+{
+	struct dm_verity *v = io->v;
+	u8 *want = io_want_digest(v, io);
+	u8 *real = io_real_digest(v, io);
+	struct verity_hblock *hb;
+	sector_t hash_block;
+	unsigned offset;
+	u8 *data;
+	int i, r;
+
+	memcpy(want, v->root_digest, v->digest_size);
+
+	for (i = v->levels - 1; i >= 0; i--) {
+		verity_hash_at_level(v, block, i, &hash_block, &offset);
+
+		hb = verity_hb_get(v, hash_block, false);
+		if (IS_ERR(hb))
+			return PTR_ERR(hb);
+
+		if (hb->state == HB_ERROR) {
+			DMERR_LIMIT("error reading metadata block %llu",
+				    (unsigned long long)hash_block);
+			verity_hb_put(v, hb);
+			return -EIO;
+		}
+
+		data = page_address(hb->page);
+		if (!hb->verified) {
+			r = verity_hash(v, io_hash_desc(v, io), data,
+					1 << v->hash_dev_block_bits, real);
+			if (r < 0) {
+				verity_hb_put(v, hb);
+				return r;
+			}
+
+			if (memcmp(real, want, v->digest_size)) {
+				DMERR_LIMIT("metadata block %llu is corrupted",
+					    (unsigned long long)hash_block);
+				v->hash_failed = 1;
+				verity_hb_put(v, hb);
+				return -EIO;
+			}
+			hb->verified = true;
+		}
+
+		memcpy(want, data + offset, v->digest_size);
+		verity_hb_put(v, hb);
+	}
+
+	return 0;
+}
+
+static int verity_verify_io(struct dm_verity_io *io)
+{
+	struct dm_verity *v = io->v;
+	struct shash_desc *desc = io_hash_desc(v, io);
+	unsigned vector = 0, offset = 0;
+	unsigned b, todo, len;
+	struct bio_vec *bv;
+	u8 *page;
+	int r;
+
+	for (b = 0; b < io->n_blocks; b++) {
+		r = verity_tree_walk(io, io->block + b);
+		if (r < 0)
+			return r;
+
+		r = verity_hash_init(v, desc);
+		if (r < 0)
+			return r;
+
+		todo = 1 << v->data_dev_block_bits;
+		do {
+			BUG_ON(vector >= io->io_vec_size);
+			bv = &io->io_vec[vector];
+			len = min(bv->bv_len - offset, todo);
+
+			page = kmap(bv->bv_page);
+			r = crypto_shash_update(desc,
+					page + bv->bv_offset + offset, len);
+			kunmap(bv->bv_page);
+			if (r < 0)
+				return r;
+
+			offset += len;
+			if (offset == bv->bv_len) {
+				offset = 0;
+				vector++;
+			}
+			todo -= len;
+		} while (todo);
+
+		r = verity_hash_final(v, desc, io_real_digest(v, io));
+		if (r < 0)
+			return r;
+
+		if (memcmp(io_real_digest(v, io), io_want_digest(v, io),
+			   v->digest_size)) {
+			DMERR_LIMIT("data block %llu is corrupted",
+				    (unsigned long long)(io->block + b));
+			v->hash_failed = 1;
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static void verity_finish_io(struct dm_verity_io *io, int error)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = io->bio;
+	unsigned long flags;
+	u64 ns;
+
+	if (!error) {
+		ns = ktime_to_ns(ktime_sub(ktime_get(), io->start));
+		spin_lock_irqsave(&v->lock, flags);
+		v->verified_ios++;
+		v->verify_ns += ns;
+		if (ns > v->max_verify_ns)
+			v->max_verify_ns = ns;
+		spin_unlock_irqrestore(&v->lock, flags);
+	}
+
+	bio->bi_end_io = io->orig_bi_end_io;
+	bio->bi_private = io->orig_bi_private;
+
+	if (io->io_vec != io->io_vec_inline)
+		mempool_free(io->io_vec, v->vec_mempool);
+	mempool_free(io, v->io_mempool);
+
+	bio_endio(bio, error);
+}
+
+static void verity_work(struct work_struct *w)
+{
+	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
+
+	verity_finish_io(io, verity_verify_io(io));
+}
+
+static void verity_end_io(struct bio *bio, int error)
+{
+	struct dm_verity_io *io = bio->bi_private;
+
+	if (error) {
+		verity_finish_io(io, error);
+		return;
+	}
+
+	/* what verification adds to the read is timed from here */
+	io->start = ktime_get();
+	INIT_WORK(&io->work, verity_work);
+	queue_work(io->v->verify_wq, &io->work);
+}
+
+static int verity_map(struct dm_target *ti, struct bio *bio,
+		      union map_info *map_context)
+{
+	struct dm_verity *v = ti->private;
+	struct dm_verity_io *io;
+	sector_t offset = dm_target_offset(ti, bio->bi_sector);
+
+	bio->bi_bdev = v->data_dev->bdev;
+	bio->bi_sector = offset;
+
+	if (((unsigned)offset | bio_sectors(bio)) &
+	    ((1 << (v->data_dev_block_bits - SECTOR_SHIFT)) - 1)) {
+		DMERR_LIMIT("unaligned io");
+		return -EIO;
+	}
+
+	if ((offset + bio_sectors(bio)) >>
+	    (v->data_dev_block_bits - SECTOR_SHIFT) > v->data_blocks) {
+		DMERR_LIMIT("io out of range");
+		return -EIO;
+	}
+
+	if (bio_data_dir(bio) == WRITE)
+		return -EIO;
+
+	io = mempool_alloc(v->io_mempool, GFP_NOIO);
+	io->v = v;
+	io->bio = bio;
+	io->orig_bi_end_io = bio->bi_end_io;
+	io->orig_bi_private = bio->bi_private;
+	io->block = offset >> (v->data_dev_block_bits - SECTOR_SHIFT);
+	io->n_blocks = bio->bi_size >> v->data_dev_block_bits;
+
+	io->io_vec_size = bio->bi_vcnt - bio->bi_idx;
+	if (io->io_vec_size <= DM_VERITY_IO_VEC_INLINE)
+		io->io_vec = io->io_vec_inline;
+	else
+		io->io_vec = mempool_alloc(v->vec_mempool, GFP_NOIO);
+	memcpy(io->io_vec, bio_iovec(bio),
+	       io->io_vec_size * sizeof(struct bio_vec));
+
+	bio->bi_end_io = verity_end_io;
+	bio->bi_private = io;
+
+	if (io->n_blocks)
+		verity_prefetch(v, io->block, io->n_blocks);
+
+	generic_make_request(bio);
+
+	return DM_MAPIO_SUBMITTED;
+}
+
+/*
+ * Status: V (valid) or C (corruption found), then
+ * <hits> <misses> <prefetched> <verified bios> <avg usecs> <max usecs>
+ * for the hash block cache and the time verification adds to a read.
+ */
+static int verity_status(struct dm_target *ti, status_type_t type,
+			 char *result, unsigned maxlen)
+{
+	struct dm_verity *v = ti->private;
+	u64 hits, misses, prefetched, ios, ns, max_ns;
+	unsigned sz = 0;
+	unsigned x;
+
+	switch (type) {
+	case STATUSTYPE_INFO:
+		spin_lock_irq(&v->lock);
+		hits = v->hits;
+		misses = v->misses;
+		prefetched = v->prefetched;
+		ios = v->verified_ios;
+		ns = v->verify_ns;
+		max_ns = v->max_verify_ns;
+		spin_unlock_irq(&v->lock);
+
+		DMEMIT("%c %llu %llu %llu %llu %llu %llu",
+		       v->hash_failed ? 'C' : 'V',
+		       (unsigned long long)hits, (unsigned long long)misses,
+		       (unsigned long long)prefetched, (unsigned long long)ios,
+		       (unsigned long long)div_u64(ios ? div64_u64(ns, ios) : 0,
+						   NSEC_PER_USEC),
+		       (unsigned long long)div_u64(max_ns, NSEC_PER_USEC));
+		break;
+
+	case STATUSTYPE_TABLE:
+		DMEMIT("%u %s %s %u %u %llu %llu %s ",
+		       v->version,
+		       v->data_dev->name,
+		       v->hash_dev->name,
+		       1 << v->data_dev_block_bits,
+		       1 << v->hash_dev_block_bits,
+		       (unsigned long long)v->data_blocks,
+		       (unsigned long long)v->hash_start,
+		       crypto_tfm_alg_name(crypto_shash_tfm(v->tfm)));
+		for (x = 0; x < v->digest_size; x++)
+			DMEMIT("%02x", v->root_digest[x]);
+		DMEMIT(" ");
+		if (!v->salt_size)
+			DMEMIT("-");
+		else
+			for (x = 0; x < v->salt_size; x++)
+				DMEMIT("%02x", v->salt[x]);
+		break;
+	}
+
+	return 0;
+}
+
+static int verity_merge(struct dm_target *ti, struct bvec_merge_data *bvm,
+			struct bio_vec *biovec, int max_size)
+{
+	struct dm_verity *v = ti->private;
+	struct request_queue *q = bdev_get_queue(v->data_dev->bdev);
+
+	if (!q->merge_bvec_fn)
+		return max_size;
+
+	bvm->bi_bdev = v->data_dev->bdev;
+	bvm->bi_sector = dm_target_offset(ti, bvm->bi_sector);
+
+	return min(max_size, q->merge_bvec_fn(q, bvm, biovec));
+}
+
+static int verity_iterate_devices(struct dm_target *ti,
+				  iterate_devices_callout_fn fn, void *data)
+{
+	struct dm_verity *v = ti->private;
+
+	return fn(ti, v->data_dev, 0, ti->len, data);
+}
+
+static void verity_io_hints(struct dm_target *ti, struct queue_limits *limits)
+{
+	struct dm_verity *v = ti->private;
+
+	if (limits->logical_block_size < 1 << v->data_dev_block_bits)
+		limits->logical_block_size = 1 << v->data_dev_block_bits;
+
+	if (limits->physical_block_size < 1 << v->data_dev_block_bits)
+		limits->physical_block_size = 1 << v->data_dev_block_bits;
+
+	blk_limits_io_min(limits, limits->logical_block_size);
+}
+
+static void verity_dtr(struct dm_target *ti)
+{
+	struct dm_verity *v = ti->private;
+	struct verity_hblock *hb, *tmp;
+
+	if (v->verify_wq)
+		destroy_workqueue(v->verify_wq);
+
+	/* read-ahead of hash blocks nobody ended up waiting for */
+	while (atomic_read(&v->reads_in_flight))
+		msleep(1);
+
+	list_for_each_entry_safe(hb, tmp, &v->lru, lru)
+		verity_hb_free(hb);
+	kfree(v->buckets);
+
+	if (v->vec_mempool)
+		mempool_destroy(v->vec_mempool);
+
+	if (v->io_mempool)
+		mempool_destroy(v->io_mempool);
+
+	kfree(v->salt);
+	kfree(v->root_digest);
+
+	if (v->tfm)
+		crypto_free_shash(v->tfm);
+
+	if (v->hash_dev)
+		dm_put_device(ti, v->hash_dev);
+
+	if (v->data_dev)
+		dm_put_device(ti, v->data_dev);
+
+	kfree(v);
+}
+
+static int verity_parse_hex(const char *hex, u8 *out, unsigned size)
+{
+	unsigned i;
+
+	if (strlen(hex) != size * 2)
+		return -EINVAL;
+
+	for (i = 0; i < size * 2; i++)
+		if (!isxdigit(hex[i]))
+			return -EINVAL;
+
+	hex2bin(out, hex, size);
+	return 0;
+}
+
+static int verity_parse_block_size(struct dm_dev *dev, const char *arg,
+				   unsigned char *bits)
+{
+	unsigned num;
+	char dummy;
+
+	if (sscanf(arg, "%u%c", &num, &dummy) != 1 ||
+	    !num || (num & (num - 1)) ||
+	    num < bdev_logical_block_size(dev->bdev) || num > PAGE_SIZE)
+		return -EINVAL;
+
+	*bits = __ffs(num);
+	return 0;
+}
+
+/*
+ * Target parameters:
+ *	<version>	The current format is version 1.
+ *			Vsn 0 is compatible with original Chromium OS releases.
+ *	<data device>
+ *	<hash device>
+ *	<data block size>
+ *	<hash block size>
+ *	<the number of data blocks>
+ *	<hash start block>
+ *	<algorithm>
+ *	<digest>
+ *	<salt>		Hex string or "-" if no salt.
+ */
+static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
+{
+	struct dm_verity *v;
+	unsigned num;
+	unsigned long long num_ll;
+	sector_t hash_position;
+	char dummy;
+	int i, r;
+
+	if (argc != 10) {
+		ti->error = "Invalid argument count: exactly 10 arguments required";
+		return -EINVAL;
+	}
+
+	v = kzalloc(sizeof(*v), GFP_KERNEL);
+	if (!v) {
+		ti->error = "Cannot allocate verity structure";
+		return -ENOMEM;
+	}
+	ti->private = v;
+	v->ti = ti;
+	spin_lock_init(&v->lock);
+	INIT_LIST_HEAD(&v->lru);
+	init_waitqueue_head(&v->wait);
+	atomic_set(&v->reads_in_flight, 0);
+
+	if ((dm_table_get_mode(ti->table) & ~FMODE_READ)) {
+		ti->error = "Device must be readonly";
+		r = -EINVAL;
+		goto bad;
+	}
+
+	if (sscanf(argv[0], "%u%c", &num, &dummy) != 1 || num > 1) {
+		ti->error = "Invalid version";
+		r = -EINVAL;
+		goto bad;
+	}
+	v->version = num;
+
+	r = dm_get_device(ti, argv[1], FMODE_READ, &v->data_dev);
+	if (r) {
+		ti->error = "Data device lookup failed";
+		goto bad;
+	}
+
+	r = dm_get_device(ti, argv[2], FMODE_READ, &v->hash_dev);
+	if (r) {
+		ti->error = "Hash device lookup failed";
+		goto bad;
+	}
+
+	r = verity_parse_block_size(v->data_dev, argv[3],
+				    &v->data_dev_block_bits);
+	if (r) {
+		ti->error = "Invalid data device block size";
+		goto bad;
+	}
+
+	r = verity_parse_block_size(v->hash_dev, argv[4],
+				    &v->hash_dev_block_bits);
+	if (r) {
+		ti->error = "Invalid hash device block size";
+		goto bad;
+	}
+
+	r = -EINVAL;
+	if (sscanf(argv[5], "%llu%c", &num_ll, &dummy) != 1 ||
+	    (sector_t)(num_ll << (v->data_dev_block_bits - SECTOR_SHIFT))
+	    >> (v->data_dev_block_bits - SECTOR_SHIFT) != num_ll) {
+		ti->error = "Invalid data blocks";
+		goto bad;
+	}
+	v->data_blocks = num_ll;
+
+	if (ti->len > (v->data_blocks << (v->data_dev_block_bits - SECTOR_SHIFT))) {
+		ti->error = "Data device is too small";
+		goto bad;
+	}
+
+	if (sscanf(argv[6], "%llu%c", &num_ll, &dummy) != 1 ||
+	    (sector_t)(num_ll << (v->hash_dev_block_bits - SECTOR_SHIFT))
+	    >> (v->hash_dev_block_bits - SECTOR_SHIFT) != num_ll) {
+		ti->error = "Invalid hash start";
+		goto bad;
+	}
+	v->hash_start = num_ll;
+
+	v->tfm = crypto_alloc_shash(argv[7], 0, 0);
+	if (IS_ERR(v->tfm)) {
+		ti->error = "Cannot initialize hash function";
+		r = PTR_ERR(v->tfm);
+		v->tfm = NULL;
+		goto bad;
+	}
+	v->digest_size = crypto_shash_digestsize(v->tfm);
+	if ((1 << v->hash_dev_block_bits) < v->digest_size * 2) {
+		ti->error = "Digest size too big";
+		r = -EINVAL;
+		goto bad;
+	}
+	v->shash_descsize =
+		sizeof(struct shash_desc) + crypto_shash_descsize(v->tfm);
+
+	r = -ENOMEM;
+	v->root_digest = kmalloc(v->digest_size, GFP_KERNEL);
+	if (!v->root_digest) {
+		ti->error = "Cannot allocate root digest";
+		goto bad;
+	}
+	if (verity_parse_hex(argv[8], v->root_digest, v->digest_size)) {
+		ti->error = "Invalid root digest";
+		r = -EINVAL;
+		goto bad;
+	}
+
+	if (strcmp(argv[9], "-")) {
+		v->salt_size = strlen(argv[9]) / 2;
+		v->salt = kmalloc(v->salt_size, GFP_KERNEL);
+		if (!v->salt) {
+			ti->error = "Cannot allocate salt";
+			goto bad;
+		}
+		if (verity_parse_hex(argv[9], v->salt, v->salt_size)) {
+			ti->error = "Invalid salt";
+			r = -EINVAL;
+			goto bad;
+		}
+	}
+
+	v->hash_per_block_bits =
+		__fls((1 << v->hash_dev_block_bits) / v->digest_size);
+
+	v->levels = 0;
+	if (v->data_blocks)
+		while (v->hash_per_block_bits * v->levels < 64 &&
+		       (unsigned long long)(v->data_blocks - 1) >>
+		       (v->hash_per_block_bits * v->levels))
+			v->levels++;
+
+	if (v->levels > DM_VERITY_MAX_LEVELS) {
+		ti->error = "Too many tree levels";
+		r = -E2BIG;
+		goto bad;
+	}
+
+	/* the top level comes first on the hash device */
+	hash_position = v->hash_start;
+	for (i = v->levels - 1; i >= 0; i--) {
+		sector_t s;
+
+		v->hash_level_block[i] = hash_position;
+		s = (v->data_blocks +
+		     ((sector_t)1 << ((i + 1) * v->hash_per_block_bits)) - 1)
+		    >> ((i + 1) * v->hash_per_block_bits);
+		if (hash_position + s < hash_position) {
+			ti->error = "Hash device offset overflow";
+			r = -E2BIG;
+			goto bad;
+		}
+		hash_position += s;
+	}
+	v->hash_blocks = hash_position;
+
+	if (i_size_read(v->hash_dev->bdev->bd_inode) >> v->hash_dev_block_bits <
+	    v->hash_blocks) {
+		ti->error = "Hash device is too small";
+		r = -EINVAL;
+		goto bad;
+	}
+
+	/* room for a few walks from the root at least */
+	v->max_cached = max_t(unsigned, (cache_kb << 10) >> v->hash_dev_block_bits,
+			      4 * (v->levels + 1));
+	v->nr_buckets = min_t(unsigned, roundup_pow_of_two(v->max_cached), 4096);
+	v->buckets = kcalloc(v->nr_buckets, sizeof(*v->buckets), GFP_KERNEL);
+	if (!v->buckets) {
+		ti->error = "Cannot allocate hash block cache";
+		r = -ENOMEM;
+		goto bad;
+	}
+
+	r = -ENOMEM;
+	v->io_mempool = mempool_create_kmalloc_pool(DM_VERITY_MEMPOOL_SIZE,
+			sizeof(struct dm_verity_io) + v->shash_descsize +
+			v->digest_size * 2);
+	if (!v->io_mempool) {
+		ti->error = "Cannot allocate io mempool";
+		goto bad;
+	}
+
+	v->vec_mempool = mempool_create_kmalloc_pool(DM_VERITY_MEMPOOL_SIZE,
+					BIO_MAX_PAGES * sizeof(struct bio_vec));
+	if (!v->vec_mempool) {
+		ti->error = "Cannot allocate vector mempool";
+		goto bad;
+	}
+
+	/* bound, so that a bio is verified on the CPU it completed on */
+	v->verify_wq = alloc_workqueue("kverityd",
+				       WQ_CPU_INTENSIVE | WQ_HIGHPRI |
+				       WQ_MEM_RECLAIM,
+				       num_online_cpus());
+	if (!v->verify_wq) {
+		ti->error = "Cannot allocate workqueue";
+		goto bad;
+	}
+
+	return 0;
+
+bad:
+	verity_dtr(ti);
+	return r;
+}
+
+static struct target_type verity_target = {
+	.name		= "verity",
+	.version	= {1, 0, 0},
+	.module		= THIS_MODULE,
+	.ctr		= verity_ctr,
+	.dtr		= verity_dtr,
+	.map		= verity_map,
+	.status		= verity_status,
+	.merge		= verity_merge,
+	.iterate_devices = verity_iterate_devices,
+	.io_hints	= verity_io_hints,
+};
+
+static int __init dm_verity_init(void)
+{
+	int r;
+
+	r = dm_register_target(&verity_target);
+	if (r < 0)
+		DMERR("register failed %d", r);
+
+	return r;
+}
+
+static void __exit dm_verity_exit(void)
+{
+	dm_unregister_target(&verity_target);
+}
+
+module_init(dm_verity_init);
+module_exit(dm_verity_exit);
+
+MODULE_DESCRIPTION(DM_NAME " target for transparent disk integrity checking");
+MODULE_LICENSE("GPL");
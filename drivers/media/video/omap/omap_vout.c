@@ -39,6 +39,10 @@
 #include <linux/irq.h>
 #include <linux/videodev2.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include <media/videobuf-dma-contig.h>
 #include <media/v4l2-device.h>
@@ -48,6 +52,9 @@
 #include <plat/vram.h>
 #include <plat/vrfb.h>
 #include <video/omapdss.h>
+#ifdef CONFIG_TI_TILER
+#include <mach/tiler.h>
+#endif
 
 #include "omap_voutlib.h"
 #include "omap_voutdef.h"
@@ -306,27 +313,36 @@ static int omap_vout_try_format(struct v4l2_pix_format *pix)
  */
 static u32 omap_vout_uservirt_to_phys(u32 virtp)
 {
-	unsigned long physp = 0;
+	unsigned long physp = 0, pfn;
 	struct vm_area_struct *vma;
 	struct mm_struct *mm = current->mm;
 
-	vma = find_vma(mm, virtp);
 	/* For kernel direct-mapped memory, take the easy way */
-	if (virtp >= PAGE_OFFSET) {
-		physp = virt_to_phys((void *) virtp);
-	} else if (vma && (vma->vm_flags & VM_IO) && vma->vm_pgoff) {
-		/* this will catch, kernel-allocated, mmaped-to-usermode
-		   addresses */
-		physp = (vma->vm_pgoff << PAGE_SHIFT) + (virtp - vma->vm_start);
+	if (virtp >= PAGE_OFFSET)
+		return virt_to_phys((void *) virtp);
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, virtp);
+	if (vma && vma->vm_start <= virtp &&
+			(vma->vm_flags & (VM_IO | VM_PFNMAP))) {
+		/*
+		 * This will catch kernel-allocated, mmaped-to-usermode
+		 * addresses, such as ION carveout and TILER buffers.  Ask
+		 * the page tables: remap_pfn_range() only records the pfn
+		 * in vm_pgoff for COW mappings, and a TILER mapping is not
+		 * contiguous past the first row anyway.
+		 */
+		if (!follow_pfn(vma, virtp, &pfn))
+			physp = (pfn << PAGE_SHIFT) + (virtp & ~PAGE_MASK);
+		up_read(&mm->mmap_sem);
 	} else {
 		/* otherwise, use get_user_pages() for general userland pages */
 		int res, nr_pages = 1;
 		struct page *pages;
-		down_read(&current->mm->mmap_sem);
 
 		res = get_user_pages(current, current->mm, virtp, nr_pages, 1,
 				0, &pages, NULL);
-		up_read(&current->mm->mmap_sem);
+		up_read(&mm->mmap_sem);
 
 		if (res == nr_pages) {
 			physp =  __pa(page_address(&pages[0]) +
@@ -341,6 +357,71 @@ static u32 omap_vout_uservirt_to_phys(u32 virtp)
 	return physp;
 }
 
+/*
+ * TILER buffers are rotated and mirrored by DISPC itself, reading the
+ * container through another view, so they need neither the VRFB copy
+ * nor the VRFB crop offsets.
+ */
+static inline bool omap_vout_tiler_buf(u32 addr)
+{
+#ifdef CONFIG_TI_TILER
+	return is_tiler_addr(addr);
+#else
+	return false;
+#endif
+}
+
+/*
+ * Address DSS is to read a queued buffer from, with the crop applied.
+ */
+static u32 omap_vout_frame_addr(struct omap_vout_device *vout, int i)
+{
+	u32 addr = (unsigned long) vout->queued_buf_addr[i];
+#ifdef CONFIG_TI_TILER
+	struct tiler_view_t view;
+	u32 width = vout->pix.width, left = vout->crop.left;
+	u32 cwidth = vout->crop.width;
+
+	if (!is_tiler_addr(addr))
+		return addr + vout->cropped_offset;
+
+	/* YUV422 lives in the 32-bit container, two pixels per element */
+	if (V4L2_PIX_FMT_YUYV == vout->pix.pixelformat ||
+			V4L2_PIX_FMT_UYVY == vout->pix.pixelformat) {
+		width /= 2;
+		left /= 2;
+		cwidth /= 2;
+	}
+	tilview_create(&view, addr, width, vout->pix.height);
+	if (tilview_crop(&view, left, vout->crop.top, cwidth,
+				vout->crop.height))
+		return addr;
+	return view.tsptr;
+#else
+	return addr + vout->cropped_offset;
+#endif
+}
+
+/*
+ * Account a frame reaching the screen: how long it took from QBUF, and
+ * how many buffers were queued behind it.
+ */
+static void omap_vout_account_frame(struct omap_vout_device *vout,
+		struct videobuf_buffer *vb)
+{
+	struct omap_vout_stats *st = &vout->stats;
+	u32 us;
+
+	us = ktime_to_us(ktime_sub(ktime_get(), vout->queued_time[vb->i]));
+	st->frames++;
+	if (omap_vout_tiler_buf((unsigned long) vout->queued_buf_addr[vb->i]))
+		st->tiler_frames++;
+	st->latency_sum_us += us;
+	if (us > st->latency_max_us)
+		st->latency_max_us = us;
+	st->depth_sum += vout->queue_depth;
+}
+
 /*
  * Wakes up the application once the DMA transfer to VRFB space is completed.
  */
@@ -720,6 +801,12 @@ int omapvid_setup_overlay(struct omap_vout_device *vout,
 		info.rotation_type = OMAP_DSS_ROT_VRFB;
 		info.screen_width = 2048;
 	}
+	if (omap_vout_tiler_buf(addr)) {
+		/* DISPC walks the TILER view itself */
+		info.rotation = vout->rotation;
+		info.rotation_type = OMAP_DSS_ROT_TILER;
+		info.screen_width = 0;
+	}
 
 	v4l2_dbg(1, debug, &vout->vid_dev->v4l2_dev,
 		"%s enable=%d addr=%x width=%d\n height=%d color_mode=%d\n"
@@ -857,6 +944,7 @@ void omap_vout_isr(void *arg, unsigned int irqstatus)
 			vout->cur_frm->state = VIDEOBUF_DONE;
 			wake_up_interruptible(&vout->cur_frm->done);
 			vout->cur_frm = vout->next_frm;
+			omap_vout_account_frame(vout, vout->cur_frm);
 		}
 		vout->first_int = 0;
 		if (list_empty(&vout->dma_queue))
@@ -865,11 +953,11 @@ void omap_vout_isr(void *arg, unsigned int irqstatus)
 		vout->next_frm = list_entry(vout->dma_queue.next,
 				struct videobuf_buffer, queue);
 		list_del(&vout->next_frm->queue);
+		vout->queue_depth--;
 
 		vout->next_frm->state = VIDEOBUF_ACTIVE;
 
-		addr = (unsigned long) vout->queued_buf_addr[vout->next_frm->i]
-			+ vout->cropped_offset;
+		addr = omap_vout_frame_addr(vout, vout->next_frm->i);
 
 		/* First save the configuration in ovelray structure */
 		ret = omapvid_init(vout, addr);
@@ -908,6 +996,7 @@ void omap_vout_isr(void *arg, unsigned int irqstatus)
 			vout->cur_frm->state = VIDEOBUF_DONE;
 			wake_up_interruptible(&vout->cur_frm->done);
 			vout->cur_frm = vout->next_frm;
+			omap_vout_account_frame(vout, vout->cur_frm);
 		} else if (1 == fid) {
 			if (list_empty(&vout->dma_queue) ||
 					(vout->cur_frm != vout->next_frm))
@@ -916,11 +1005,10 @@ void omap_vout_isr(void *arg, unsigned int irqstatus)
 			vout->next_frm = list_entry(vout->dma_queue.next,
 					struct videobuf_buffer, queue);
 			list_del(&vout->next_frm->queue);
+			vout->queue_depth--;
 
 			vout->next_frm->state = VIDEOBUF_ACTIVE;
-			addr = (unsigned long)
-				vout->queued_buf_addr[vout->next_frm->i] +
-				vout->cropped_offset;
+			addr = omap_vout_frame_addr(vout, vout->next_frm->i);
 			/* First save the configuration in ovelray structure */
 			ret = omapvid_init(vout, addr);
 			if (ret)
@@ -1056,7 +1144,8 @@ static void omap_vout_free_allbuffers(struct omap_vout_device *vout)
  * It prepare buffers before give out for the display. This function
  * converts user space virtual address into physical address if userptr memory
  * exchange mechanism is used. If rotation is enabled, it copies entire
- * buffer into VRFB memory space before giving it to the DSS.
+ * buffer into VRFB memory space before giving it to the DSS, unless the
+ * buffer is in TILER, which DSS reads rotated in place.
  */
 static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 			    struct videobuf_buffer *vb,
@@ -1086,14 +1175,23 @@ static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 		/* Physical address */
 		vout->queued_buf_addr[vb->i] = (u8 *)
 			omap_vout_uservirt_to_phys(vb->baddr);
+		if (0 == vout->queued_buf_addr[vb->i])
+			return -EINVAL;
 	} else {
 		vout->queued_buf_addr[vb->i] = (u8 *)vout->buf_phy_addr[vb->i];
 	}
 
-	if (!rotation_enabled(vout))
+	dmabuf = (unsigned long) vout->queued_buf_addr[vb->i];
+	if (!rotation_enabled(vout) || omap_vout_tiler_buf(dmabuf))
 		return 0;
 
-	dmabuf = vout->buf_phy_addr[vb->i];
+	if (vout->vrfb_dma_tx.req_status == DMA_CHAN_NOT_ALLOTED) {
+		v4l2_warn(&vout->vid_dev->v4l2_dev,
+				"DMA Channel not allocated for Rotation\n");
+		return -EINVAL;
+	}
+	vout->stats.vrfb_copies++;
+
 	/* If rotation is enabled, copy input buffer into VRFB
 	 * memory space using DMA. We are copying input buffer
 	 * into VRFB memory space of desired angle and DSS will
@@ -1162,6 +1260,9 @@ static void omap_vout_buffer_queue(struct videobuf_queue *q,
 	/* Driver is also maintainig a queue. So enqueue buffer in the driver
 	 * queue */
 	list_add_tail(&vb->queue, &vout->dma_queue);
+	vout->queued_time[vb->i] = ktime_get();
+	if (++vout->queue_depth > vout->stats.max_depth)
+		vout->stats.max_depth = vout->queue_depth;
 
 	vb->state = VIDEOBUF_QUEUED;
 }
@@ -1854,6 +1955,7 @@ static int vidioc_reqbufs(struct file *file, void *fh,
 	vout->memory = req->memory;
 
 	INIT_LIST_HEAD(&vout->dma_queue);
+	vout->queue_depth = 0;
 
 	/* call videobuf_reqbufs api */
 	ret = videobuf_reqbufs(q, req);
@@ -1893,7 +1995,9 @@ static int vidioc_qbuf(struct file *file, void *fh,
 		}
 	}
 
+	/* user buffers may be in TILER; buffer_prepare checks those */
 	if ((rotation_enabled(vout)) &&
+			V4L2_MEMORY_MMAP == buffer->memory &&
 			vout->vrfb_dma_tx.req_status == DMA_CHAN_NOT_ALLOTED) {
 		v4l2_warn(&vout->vid_dev->v4l2_dev,
 				"DMA Channel not allocated for Rotation\n");
@@ -1948,6 +2052,7 @@ static int vidioc_streamon(struct file *file, void *fh, enum v4l2_buf_type i)
 			struct videobuf_buffer, queue);
 	/* Remove buffer from the buffer queue */
 	list_del(&vout->cur_frm->queue);
+	vout->queue_depth--;
 	/* Mark state of the current frame to active */
 	vout->cur_frm->state = VIDEOBUF_ACTIVE;
 	/* Initialize field_id and started member */
@@ -1962,8 +2067,7 @@ static int vidioc_streamon(struct file *file, void *fh, enum v4l2_buf_type i)
 		ret = -EINVAL;
 		goto streamon_err1;
 	}
-	addr = (unsigned long) vout->queued_buf_addr[vout->cur_frm->i]
-		+ vout->cropped_offset;
+	addr = omap_vout_frame_addr(vout, vout->cur_frm->i);
 
 	mask = DISPC_IRQ_VSYNC | DISPC_IRQ_EVSYNC_EVEN | DISPC_IRQ_EVSYNC_ODD;
 
@@ -2041,6 +2145,7 @@ static int vidioc_streamoff(struct file *file, void *fh, enum v4l2_buf_type i)
 				" streamoff\n");
 
 	INIT_LIST_HEAD(&vout->dma_queue);
+	vout->queue_depth = 0;
 	ret = videobuf_streamoff(&vout->vbq);
 
 	return ret;
@@ -2360,6 +2465,63 @@ free_buffers:
 }
 
 /* Create video out devices */
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *omap_vout_debugfs_dir;
+
+static int omap_vout_stats_show(struct seq_file *s, void *unused)
+{
+	struct omap_vout_device *vout = s->private;
+	struct omap_vout_stats st;
+	unsigned long flags;
+	int depth;
+
+	spin_lock_irqsave(&vout->vbq_lock, flags);
+	st = vout->stats;
+	depth = vout->queue_depth;
+	spin_unlock_irqrestore(&vout->vbq_lock, flags);
+
+	seq_printf(s, "frames: %u (tiler %u, vrfb copies %u)\n",
+			st.frames, st.tiler_frames, st.vrfb_copies);
+	seq_printf(s, "queue depth: %d now, %u max, %u.%02u avg\n", depth,
+			st.max_depth,
+			st.frames ? (u32)div_u64(st.depth_sum, st.frames) : 0,
+			st.frames ? (u32)div_u64(st.depth_sum * 100, st.frames)
+				% 100 : 0);
+	seq_printf(s, "qbuf to scanout: %u us avg, %u us max\n",
+			st.frames ? (u32)div_u64(st.latency_sum_us, st.frames)
+				: 0, st.latency_max_us);
+	return 0;
+}
+
+static int omap_vout_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap_vout_stats_show, inode->i_private);
+}
+
+static const struct file_operations omap_vout_stats_fops = {
+	.open		= omap_vout_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void omap_vout_debugfs_add(struct omap_vout_device *vout)
+{
+	char name[8];
+
+	if (!omap_vout_debugfs_dir)
+		omap_vout_debugfs_dir = debugfs_create_dir(VOUT_NAME, NULL);
+	if (IS_ERR_OR_NULL(omap_vout_debugfs_dir))
+		return;
+
+	snprintf(name, sizeof(name), "video%d", vout->vid + 1);
+	vout->debugfs = debugfs_create_file(name, S_IRUGO,
+			omap_vout_debugfs_dir, vout, &omap_vout_stats_fops);
+}
+#else
+static inline void omap_vout_debugfs_add(struct omap_vout_device *vout) { }
+#endif
+
 static int __init omap_vout_create_video_devices(struct platform_device *pdev)
 {
 	int ret = 0, k;
@@ -2431,6 +2593,7 @@ error:
 		return ret;
 
 success:
+		omap_vout_debugfs_add(vout);
 		dev_info(&pdev->dev, ": registered and initialized"
 				" video device %d\n", vfd->minor);
 		if (k == (pdev->num_resources - 1))
@@ -2447,6 +2610,9 @@ static void omap_vout_cleanup_device(struct omap_vout_device *vout)
 	if (!vout)
 		return;
 
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove(vout->debugfs);
+#endif
 	vfd = vout->vfd;
 	if (vfd) {
 		if (!video_is_registered(vfd)) {
@@ -2630,6 +2796,9 @@ static int __init omap_vout_init(void)
 static void omap_vout_cleanup(void)
 {
 	platform_driver_unregister(&omap_vout_driver);
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove(omap_vout_debugfs_dir);
+#endif
 }
 
 late_initcall(omap_vout_init);
@@ -72,6 +72,17 @@ struct omap2video_device {
 };
 
 /* per-device data structure */
+/* frames shown, and how long they waited in the queue */
+struct omap_vout_stats {
+	u32 frames;
+	u32 tiler_frames;
+	u32 vrfb_copies;
+	u32 max_depth;
+	u64 depth_sum;
+	u64 latency_sum_us;
+	u32 latency_max_us;
+};
+
 struct omap_vout_device {
 
 	struct omapvideo_info vid_info;
@@ -137,6 +148,14 @@ struct omap_vout_device {
 	s32 tv_field1_offset;
 	void *isr_handle;
 
+	/* QBUF time of each buffer, and buffers waiting in dma_queue */
+	ktime_t queued_time[VIDEO_MAX_FRAME];
+	int queue_depth;
+	struct omap_vout_stats stats;
+#ifdef CONFIG_DEBUG_FS
+	struct dentry *debugfs;
+#endif
+
 	/* Buffer queue variables */
 	struct omap_vout_device *vout;
 	enum v4l2_buf_type type;
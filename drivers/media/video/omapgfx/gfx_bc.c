@@ -484,6 +484,10 @@ int bc_sync_status(int id, int bufidx)
 	struct gfx_bc_devinfo *devinfo = g_devices[id];
 	int ui32ReadOpsPending, ui32ReadOpsComplete;
 
+	/* not yet handed to SGX, maybe a pool buffer it never mapped */
+	if (!devinfo->bc_buf[bufidx].pvr_sync_data)
+		return 1;
+
 	ui32ReadOpsPending =
 		devinfo->bc_buf[bufidx].pvr_sync_data->ui32ReadOpsPending;
 	ui32ReadOpsComplete =
@@ -49,6 +49,7 @@
 #define VID_MIN_WIDTH		0
 #define VID_MIN_HEIGHT		0
 #define V4GFX_FRAME_UNLOCK_TIMEOUT 16	/* ms */
+#define V4GFX_FRAME_POLL_US	500
 
 
 /*
@@ -173,6 +174,25 @@ void v4gfx_acquire_timer(unsigned long arg)
 	set_bit(1, &vout->acquire_timedout);
 }
 
+/*
+ * Wait for SGX to be done reading a buffer, for up to
+ * V4GFX_FRAME_UNLOCK_TIMEOUT.  msleep(1) sleeps a jiffy or two, 8-16ms at
+ * HZ=128, which is a whole video frame, so poll finer than that.
+ *
+ * Returns 1 once SGX is done with the buffer, 0 on timeout.
+ */
+static int v4gfx_wait_sync(int bufidx)
+{
+	int n = V4GFX_FRAME_UNLOCK_TIMEOUT * 1000 / V4GFX_FRAME_POLL_US;
+
+	while (!bc_sync_status(0, bufidx)) {
+		if (!n--)
+			return 0;
+		usleep_range(V4GFX_FRAME_POLL_US, V4GFX_FRAME_POLL_US + 100);
+	}
+	return 1;
+}
+
 #if V4GFX_WAITMETHOD == V4GFX_WAIT_DEQUE
 static struct videobuf_buffer *v4gfx_get_next_syncframe(
 						struct v4gfx_device *vout)
@@ -190,28 +210,7 @@ static struct videobuf_buffer *v4gfx_get_next_syncframe(
 
 static int v4gfx_wait_on_pending(struct v4gfx_device *vout, int bufidx)
 {
-	int dqable = 0;
-	int iteration = 0;
-
-	do {
-		dqable = bc_sync_status(0, bufidx);
-		if (!dqable) {
-			/* printk("w-on %d [%d]\n", bufidx, iteration); */
-			if (iteration++ < V4GFX_FRAME_UNLOCK_TIMEOUT) {
-				msleep(1);	/* milliseconds */
-			} else {
-				/*printk("t-o %d\n", bufidx); */
-				break;	/* Timed out */
-			}
-		}
-/*
-		else {
-			printk("dq-o %d\n", bufidx);
-		}
- */
-	} while (!dqable);
-
-	return dqable;
+	return v4gfx_wait_sync(bufidx);
 }
 
 static void v4gfx_done_syncframe(struct v4gfx_device *vout,
@@ -439,9 +438,6 @@ static int v4gfx_frame_unlock(struct v4gfx_device *vout, int bufidx)
 {
 	struct videobuf_buffer *vbuf;
 	int rv = 0;
-#if V4GFX_WAITMETHOD == V4GFX_WAIT_UNLOCK
-	int iteration = 0;
-#endif
 
 	mutex_lock(&vout->lock);
 	vbuf = vout->locked_frm;
@@ -462,19 +458,11 @@ static int v4gfx_frame_unlock(struct v4gfx_device *vout, int bufidx)
 	if (rv != 0)
 		goto end;
 
-	do {
-		/*
-		 * Interrogate the buffer class synch data buffer to see if SGX
-		 * is done with this buffer
-		 */
-		rv = bc_sync_status(0, bufidx);
-		if (rv == 0) {
-			if (iteration++ < V4GFX_FRAME_UNLOCK_TIMEOUT)
-				msleep(1);	/* milliseconds */
-		}
-	} while (rv == 0);
-
-	if (iteration >= V4GFX_FRAME_UNLOCK_TIMEOUT) {
+	/*
+	 * Interrogate the buffer class synch data buffer to see if SGX
+	 * is done with this buffer
+	 */
+	if (!v4gfx_wait_sync(bufidx)) {
 		printk("%s: INFO: timed out\n", __func__);
 		rv = -ETIMEDOUT;
 	} else
@@ -510,6 +498,12 @@ static int vbq_ops_buf_setup(struct videobuf_queue *q, unsigned int *count,
 	GFXLOG(1, V4L2DEV(vout), "height=%d, size=%d\n",
 		   vout->pix.height, *size);
 
+	/* reusing the pool, the buffers are already there */
+	if (vout->pool_reuse) {
+		*count = vout->buffer_allocated;
+		goto end;
+	}
+
 	if (v4gfx_tiler_buffer_setup(vout, count, 0, &vout->pix)) {
 			rv = -ENOMEM; goto end;
 	}
@@ -715,11 +709,11 @@ static int vidfop_release(struct file *file)
 		videobuf_mmap_free(q);
 	vout->mmap_count = 0;
 
-	/* Free buffers */
-	if (vout->buffer_allocated) {
-		v4gfx_tiler_buffer_free(vout, vout->buffer_allocated, 0);
-		vout->buffer_allocated = 0;
-	}
+	/*
+	 * The buffers are kept as a pool for the next producer, see
+	 * v4gfx_pool_match(); they go when the format changes or the
+	 * module is removed.
+	 */
 
 	memset(&vout->crop, 0, sizeof(vout->crop));
 	memset(&vout->pix, 0, sizeof(vout->pix));
@@ -884,6 +878,21 @@ end:
 	return rv;
 }
 
+/*
+ * The TILER buffers of a stream, their page lists and the buffer class
+ * device built from them outlive the stream.  A new stream of the same
+ * format and count gets them back as they are, so that SGX can keep the
+ * mappings it made of them instead of mapping new buffers every time a
+ * video starts, seeks or loops.
+ */
+static bool v4gfx_pool_match(struct v4gfx_device *vout, unsigned int count)
+{
+	return vout->buffer_allocated && count == vout->buffer_allocated &&
+		vout->pool_pix.width == vout->pix.width &&
+		vout->pool_pix.height == vout->pix.height &&
+		vout->pool_pix.pixelformat == vout->pix.pixelformat;
+}
+
 static int vidioc_reqbufs(struct file *file, void *fh,
 			struct v4l2_requestbuffers *req)
 {
@@ -922,10 +931,17 @@ static int vidioc_reqbufs(struct file *file, void *fh,
 			rv = -EBUSY; goto end;
 		}
 
+		videobuf_mmap_free(q);
+	}
+
+	vout->pool_reuse = v4gfx_pool_match(vout, req->count);
+	if (vout->pool_reuse) {
+		GFXLOG(1, V4L2DEV(vout), "%s: reusing %d buffers\n",
+				__func__, vout->buffer_allocated);
+	} else if (vout->buffer_allocated) {
 		v4gfx_tiler_buffer_free(vout, vout->buffer_allocated, 0);
+		v4gfx_buffer_array_free(vout, vout->buffer_allocated);
 		vout->buffer_allocated = 0;
-
-		videobuf_mmap_free(q);
 	}
 
 	bc_params.count = req->count;
@@ -933,11 +949,14 @@ static int vidioc_reqbufs(struct file *file, void *fh,
 	bc_params.height = vout->pix.height;
 	bc_params.pixel_fmt = vout->pix.pixelformat;
 /*	bc_params.stride = vout->pix.bytesperline; */
-	rv = bc_setup(0, &bc_params);
-	if (rv < 0) {
-		GFXLOG(1, V4L2DEV(vout),
+	if (!vout->pool_reuse) {
+		rv = bc_setup(0, &bc_params);
+		if (rv < 0) {
+			GFXLOG(1, V4L2DEV(vout),
 				"+%s bc_setup() failed %d\n", __func__, rv);
-		goto end;
+			mutex_unlock(&vout->lock);
+			goto end;
+		}
 	}
 
 	/*
@@ -953,6 +972,13 @@ static int vidioc_reqbufs(struct file *file, void *fh,
 	INIT_LIST_HEAD(&vout->dma_queue);
 	INIT_LIST_HEAD(&vout->sync_queue);
 
+	/* SGX still has the pool's buffer class device as it was */
+	if (vout->pool_reuse) {
+		vout->memory = req->memory;
+		mutex_unlock(&vout->lock);
+		goto end;
+	}
+
 	/*
 	 * The realloc will free the old array and allocate a new one
 	 */
@@ -965,6 +991,7 @@ static int vidioc_reqbufs(struct file *file, void *fh,
 
 	vout->memory = req->memory;
 	vout->buffer_allocated = req->count;
+	vout->pool_pix = vout->pix;
 
 	for (i = 0; i < req->count; i++) {
 
@@ -65,6 +65,13 @@ struct v4gfx_device {
 	 */
 	unsigned long **buf_phys_addr_array;
 
+	/*
+	 * Format of the buffers above, kept as a pool across streams.
+	 * pool_reuse is set while REQBUFS is handing the pool out again.
+	 */
+	struct v4l2_pix_format pool_pix;
+	bool pool_reuse;
+
 	int mmap_count;
 
 	int opened; /* inc/dec on open/close of the device */
@@ -86,10 +86,12 @@ struct gid_info {
 struct area_info {
 	struct list_head by_gid;	/* areas in this sid/gid */
 	struct list_head blocks;	/* blocks in this area */
+	struct list_head global;	/* all 2D areas */
 	u32 nblocks;			/* # of blocks in this area */
 
 	struct tcm_area area;		/* area details */
 	struct gid_info *gi;		/* link to parent, if still alive */
+	u16 align;			/* alignment it was reserved with */
 
 	u32 allowed_modes;
 };
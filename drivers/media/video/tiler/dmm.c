@@ -24,6 +24,7 @@
 #include <linux/errno.h>
 #include <linux/slab.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 
 #include <mach/dmm.h>
 
@@ -41,6 +42,7 @@
 #endif
 
 static struct mutex dmm_mtx;
+static struct dmm_pat_stats stats;	/* protected by dmm_mtx */
 
 static struct omap_dmm_platform_data *device_data;
 
@@ -69,17 +71,50 @@ static struct platform_driver dmm_driver_ldm = {
 	},
 };
 
+/* (must have dmm_mtx) account for a refill of n areas started at start */
+static void dmm_pat_account(u32 n, ktime_t start)
+{
+	u32 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stats.refills++;
+	stats.areas += n;
+	stats.total_ns += ns;
+	if (ns > stats.max_ns)
+		stats.max_ns = ns;
+}
+
+/* (must have dmm_mtx) clear DMM_PAT_IRQSTATUS, and wait for it to clear */
+static s32 dmm_pat_clear_irqstatus(struct dmm *dmm)
+{
+	void __iomem *r;
+	u32 i = 1000;
+
+	r = dmm->base + DMM_PAT_IRQSTATUS;
+	__raw_writel(0xFFFFFFFF, r);
+	wmb();
+
+	r = dmm->base + DMM_PAT_IRQSTATUS_RAW;
+	while (__raw_readl(r) != 0) {
+		if (--i == 0)
+			return -EIO;
+		udelay(1);
+	}
+	return 0;
+}
+
 s32 dmm_pat_refill(struct dmm *dmm, struct pat *pd, enum pat_mode mode)
 {
 	s32 ret = -EFAULT;
 	void __iomem *r;
 	u32 v, i;
+	ktime_t start;
 
 	/* Only manual refill supported */
 	if (mode != MANUAL)
 		return ret;
 
 	mutex_lock(&dmm_mtx);
+	start = ktime_get();
 
 	/* Check that the DMM_PAT_STATUS register has not reported an error */
 	r = dmm->base + DMM_PAT_STATUS__0;
@@ -114,18 +149,9 @@ s32 dmm_pat_refill(struct dmm *dmm, struct pat *pd, enum pat_mode mode)
 #endif
 
 	/* First, clear the DMM_PAT_IRQSTATUS register */
-	r = dmm->base + DMM_PAT_IRQSTATUS;
-	__raw_writel(0xFFFFFFFF, r);
-	wmb();
-
-	r = dmm->base + DMM_PAT_IRQSTATUS_RAW;
-	i = 1000;
-	while(__raw_readl(r) != 0) {
-		if (--i == 0) {
-			printk(KERN_ERR "Cannot clear status register\n");
-			goto refill_error;
-		}
-		udelay(1);
+	if (dmm_pat_clear_irqstatus(dmm)) {
+		printk(KERN_ERR "Cannot clear status register\n");
+		goto refill_error;
 	}
 
 	/* Fill data register */
@@ -170,30 +196,101 @@ s32 dmm_pat_refill(struct dmm *dmm, struct pat *pd, enum pat_mode mode)
 	}
 
 	/* Again, clear the DMM_PAT_IRQSTATUS register */
-	r = dmm->base + DMM_PAT_IRQSTATUS;
-	__raw_writel(0xFFFFFFFF, r);
+	if (dmm_pat_clear_irqstatus(dmm)) {
+		printk(KERN_ERR "Failed to clear DMM PAT IRQSTATUS\n");
+		goto refill_error;
+	}
+
+	/* Again, set "next" register to NULL to clear any PAT STATUS errors */
+	r = dmm->base + DMM_PAT_DESCR__0;
+	v = __raw_readl(r);
+	v = SET_FLD(v, 31, 4, (u32) NULL);
+	__raw_writel(v, r);
+
+	/*
+	 * Now, check that the DMM_PAT_STATUS register
+	 * has not reported an error before exiting.
+	*/
+	r = dmm->base + DMM_PAT_STATUS__0;
+	v = __raw_readl(r);
+	if ((v & 0xFC00) != 0) {
+		printk(KERN_ERR "Abort dmm refill.  Operation failed\n");
+		goto refill_error;
+	}
+
+	ret = 0;
+	dmm_pat_account(1, start);
+
+refill_error:
+	mutex_unlock(&dmm_mtx);
+
+	return ret;
+}
+EXPORT_SYMBOL(dmm_pat_refill);
+
+s32 dmm_pat_refill_list(struct dmm *dmm, struct pat *desc, u32 desc_pa,
+			u32 n)
+{
+	s32 ret = -EIO;
+	void __iomem *r;
+	u32 v, i;
+	ktime_t start;
+
+	if (!n)
+		return 0;
+
+	/* descriptors must be 16 aligned */
+	BUG_ON(desc_pa & 15);
+
+	/* chain the descriptors by their physical address */
+	for (i = 0; i < n; i++)
+		desc[i].next = i + 1 < n ? (struct pat *)
+				(desc_pa + (i + 1) * sizeof(*desc)) : NULL;
 	wmb();
 
+	mutex_lock(&dmm_mtx);
+	start = ktime_get();
+
+	/* Check that the DMM_PAT_STATUS register has not reported an error */
+	r = dmm->base + DMM_PAT_STATUS__0;
+	v = __raw_readl(r);
+	if (WARN(v & 0xFC00, KERN_ERR "Abort dmm refill, bad status\n"))
+		goto refill_error;
+
+	if (dmm_pat_clear_irqstatus(dmm)) {
+		printk(KERN_ERR "Cannot clear status register\n");
+		goto refill_error;
+	}
+
+	/* Setting "next" to the first descriptor starts the refill */
+	r = dmm->base + DMM_PAT_DESCR__0;
+	v = __raw_readl(r);
+	v = SET_FLD(v, 31, 4, desc_pa >> 4);
+	__raw_writel(v, r);
+	wmb();
+
+	/* Both the last descriptor and its data are done at the end */
 	r = dmm->base + DMM_PAT_IRQSTATUS_RAW;
-	i = 1000;
-	while (__raw_readl(r) != 0x0) {
+	i = 1000 * n;
+	while ((__raw_readl(r) & 0x3) != 0x3) {
 		if (--i == 0) {
-			printk(KERN_ERR "Failed to clear DMM PAT IRQSTATUS\n");
+			printk(KERN_ERR "Status check failed after PAT refill\n");
 			goto refill_error;
 		}
 		udelay(1);
 	}
 
+	if (dmm_pat_clear_irqstatus(dmm)) {
+		printk(KERN_ERR "Failed to clear DMM PAT IRQSTATUS\n");
+		goto refill_error;
+	}
+
 	/* Again, set "next" register to NULL to clear any PAT STATUS errors */
 	r = dmm->base + DMM_PAT_DESCR__0;
 	v = __raw_readl(r);
 	v = SET_FLD(v, 31, 4, (u32) NULL);
 	__raw_writel(v, r);
 
-	/*
-	 * Now, check that the DMM_PAT_STATUS register
-	 * has not reported an error before exiting.
-	*/
 	r = dmm->base + DMM_PAT_STATUS__0;
 	v = __raw_readl(r);
 	if ((v & 0xFC00) != 0) {
@@ -202,13 +299,22 @@ s32 dmm_pat_refill(struct dmm *dmm, struct pat *pd, enum pat_mode mode)
 	}
 
 	ret = 0;
+	dmm_pat_account(n, start);
 
 refill_error:
 	mutex_unlock(&dmm_mtx);
 
 	return ret;
 }
-EXPORT_SYMBOL(dmm_pat_refill);
+EXPORT_SYMBOL(dmm_pat_refill_list);
+
+void dmm_pat_get_stats(struct dmm_pat_stats *s)
+{
+	mutex_lock(&dmm_mtx);
+	*s = stats;
+	mutex_unlock(&dmm_mtx);
+}
+EXPORT_SYMBOL(dmm_pat_get_stats);
 
 struct dmm *dmm_pat_init(u32 id)
 {
@@ -55,6 +55,13 @@ struct tcm_area {
 	struct tcm_pt  p1;
 };
 
+/* free space of a container */
+struct tcm_free_info {
+	u32 slots;		/* slots in the container */
+	u32 free;		/* free slots */
+	u16 max_w, max_h;	/* largest free 2D area */
+};
+
 struct tcm {
 	u16 width, height;	/* container dimensions */
 
@@ -70,6 +77,7 @@ struct tcm {
 	s32 (*reserve_1d)(struct tcm *tcm, u32 slots, struct tcm_area *area);
 	s32 (*free)      (struct tcm *tcm, struct tcm_area *area);
 	void (*deinit)   (struct tcm *tcm);
+	s32 (*free_info) (struct tcm *tcm, struct tcm_free_info *info);
 };
 
 /*=============================================================================
@@ -216,6 +224,24 @@ static inline s32 tcm_free(struct tcm_area *area)
 	return res;
 }
 
+/**
+ * Describes the free space of the container.  Optional for a container
+ * manager to support.
+ *
+ * @param tcm	Pointer to container manager.
+ * @param info	Pointer to where the free space info is stored.
+ *
+ * @return 0 on success.  Non-0 error code on failure.  Some error codes:
+ *	   -ENODEV: invalid manager, or one not describing its free space.
+ */
+static inline s32 tcm_free_info(struct tcm *tcm, struct tcm_free_info *info)
+{
+	if (tcm == NULL || tcm->free_info == NULL)
+		return -ENODEV;
+
+	return tcm->free_info(tcm, info);
+}
+
 /*=============================================================================
     HELPER FUNCTION FOR ANY TILER CONTAINER MANAGER
 =============================================================================*/
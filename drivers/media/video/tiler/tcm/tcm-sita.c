@@ -46,6 +46,7 @@ static s32 sita_reserve_2d(struct tcm *tcm, u16 h, u16 w, u8 align,
 static s32 sita_reserve_1d(struct tcm *tcm, u32 slots, struct tcm_area *area);
 static s32 sita_free(struct tcm *tcm, struct tcm_area *area);
 static void sita_deinit(struct tcm *tcm);
+static s32 sita_free_info(struct tcm *tcm, struct tcm_free_info *info);
 
 /*********************************************
  *	Main Scanner functions
@@ -118,6 +119,7 @@ struct tcm *sita_init(u16 width, u16 height, struct tcm_pt *attr)
 	tcm->reserve_1d = sita_reserve_1d;
 	tcm->free = sita_free;
 	tcm->deinit = sita_deinit;
+	tcm->free_info = sita_free_info;
 	tcm->pvt = (void *)pvt;
 
 	mutex_init(&(pvt->mtx));
@@ -272,6 +274,67 @@ static s32 sita_free(struct tcm *tcm, struct tcm_area *area)
 	return 0;
 }
 
+/**
+ * Describe the free space of the container: the number of free slots, and
+ * the largest free 2D area, which is what decides whether a large 2D
+ * reservation can succeed.
+ *
+ * The largest area is found row by row: h[x] is the height of the free
+ * column ending in the current row at x, and the largest area below this
+ * histogram is found with a stack of increasing heights.
+ *
+ * @param info	pointer to where the free space info is stored
+ * @return 0 - success
+ */
+static s32 sita_free_info(struct tcm *tcm, struct tcm_free_info *info)
+{
+	struct sita_pvt *pvt = (struct sita_pvt *)tcm->pvt;
+	u16 *h, *st_h, *st_x;
+	u16 x, y, hx, start, top;
+
+	h = kzalloc(sizeof(*h) * 3 * (tcm->width + 1), GFP_KERNEL);
+	if (!h)
+		return -ENOMEM;
+	st_h = h + tcm->width + 1;
+	st_x = st_h + tcm->width + 1;
+
+	memset(info, 0, sizeof(*info));
+	info->slots = tcm->width * (u32) tcm->height;
+
+	mutex_lock(&(pvt->mtx));
+	for (y = 0; y < tcm->height; y++) {
+		for (x = 0; x < tcm->width; x++) {
+			if (pvt->map[x][y]) {
+				h[x] = 0;
+			} else {
+				h[x]++;
+				info->free++;
+			}
+		}
+
+		/* h[width] stays 0 to empty the stack */
+		for (x = 0, top = 0; x <= tcm->width; x++) {
+			hx = h[x];
+			start = x;
+			while (top && st_h[top - 1] >= hx) {
+				top--;
+				if (st_h[top] * (u32) (x - st_x[top]) >
+				    info->max_w * (u32) info->max_h) {
+					info->max_w = x - st_x[top];
+					info->max_h = st_h[top];
+				}
+				start = st_x[top];
+			}
+			st_h[top] = hx;
+			st_x[top++] = start;
+		}
+	}
+	mutex_unlock(&(pvt->mtx));
+
+	kfree(h);
+	return 0;
+}
+
 /**
  * Note: In general the cordinates in the scan field area relevant to the can
  * sweep directions. The scan origin (e.g. top-left corner) will always be
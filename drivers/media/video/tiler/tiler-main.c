@@ -33,6 +33,7 @@
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/debugfs.h>
+#include <linux/math64.h>
 
 #include <mach/dmm.h>
 #include "tmm.h"
@@ -61,9 +62,20 @@ static struct dentry *dbg_map;
 static struct tiler_ops tiler;		/* shared methods and variables */
 
 static struct list_head blocks;		/* all tiler blocks */
+static struct list_head areas;		/* all 2D areas */
 static struct list_head orphan_areas;	/* orphaned 2D areas */
 static struct list_head orphan_onedim;	/* orphaned 1D areas */
 
+/* 2D compaction statistics */
+static struct {
+	u32 failed;		/* 2D area reservations failed */
+	u32 fragmented;		/* ... although enough slots were free */
+	u32 compactions;	/* compactions run */
+	u32 succeeded;		/* ... after which the reservation fit */
+	u32 moved;		/* pre-reserved areas moved */
+	u32 dropped;		/* ... and dropped, not fitting back */
+} compact_stats;
+
 #ifdef CONFIG_TILER_ENABLE_USERSPACE
 struct tiler_dev {
 	struct cdev cdev;
@@ -85,35 +97,87 @@ static dev_t dev;
  *  TMM connectors
  *  ==========================================================================
  */
-/* wrapper around tmm_pin */
-static s32 pin_mem_to_area(struct tmm *tmm, struct tcm_area *area, u32 *ptr)
+/* areas pinned with one PAT refill */
+#define PIN_BATCH	32
+
+/*
+ * Slices waiting to be pinned.  Their page lists are laid out one after
+ * the other in the coherent dmac buffer.
+ */
+struct pin_batch {
+	struct tmm *tmm;
+	u32 n;				/* slices in the batch */
+	u32 used;			/* entries of dmac_va in use */
+	struct pat_area area[PIN_BATCH];
+	u32 data[PIN_BATCH];		/* phys.addr of each page list */
+};
+
+/* (must have dmac_mtx) pin the slices of the batch and empty it */
+static s32 pin_batch_flush(struct pin_batch *b)
 {
+	s32 res = b->n ? tmm_pin_list(b->tmm, b->area, b->data, b->n) : 0;
+
+	b->n = b->used = 0;
+	return res;
+}
+
+/* (must have dmac_mtx) add a slice to the batch, which may flush it */
+static s32 pin_batch_add(struct pin_batch *b, struct tmm *tmm,
+			 struct tcm_area *slice, u32 *ptr)
+{
+	u32 n = tcm_sizeof(*slice);
 	s32 res = 0;
-	struct pat_area p_area = {0};
-	struct tcm_area slice, area_s;
 
-	/* Ensure the data reaches to main memory before PAT refill */
-	wmb();
+	if (b->n == PIN_BATCH || (b->n && b->tmm != tmm) ||
+	    b->used + n > tiler.width * tiler.height)
+		res = pin_batch_flush(b);
+	b->tmm = tmm;
 
-	mutex_lock(&dmac_mtx);
-	tcm_for_each_slice(slice, *area, area_s) {
-		p_area.x0 = slice.p0.x;
-		p_area.y0 = slice.p0.y;
-		p_area.x1 = slice.p1.x;
-		p_area.y1 = slice.p1.y;
+	b->area[b->n].x0 = slice->p0.x;
+	b->area[b->n].y0 = slice->p0.y;
+	b->area[b->n].x1 = slice->p1.x;
+	b->area[b->n].y1 = slice->p1.y;
+	b->data[b->n++] = dmac_pa + b->used * sizeof(*dmac_va);
 
-		memcpy(dmac_va, ptr, sizeof(*ptr) * tcm_sizeof(slice));
-		ptr += tcm_sizeof(slice);
+	memcpy(dmac_va + b->used, ptr, sizeof(*ptr) * n);
+	/* page lists must start at a 16-byte aligned physical address */
+	b->used += ALIGN(n, 4);
+	return res;
+}
+
+/* (must have dmac_mtx) add all slices of an area to the batch */
+static s32 pin_batch_add_area(struct pin_batch *b, struct tmm *tmm,
+			      struct tcm_area *area, u32 *ptr)
+{
+	struct tcm_area slice, area_s;
+	s32 res = 0;
 
-		/* pin memory into DMM */
-		if (tmm_pin(tmm, p_area, dmac_pa)) {
-			res = -EFAULT;
+	tcm_for_each_slice(slice, *area, area_s) {
+		res = pin_batch_add(b, tmm, &slice, ptr);
+		if (res)
 			break;
-		}
+		ptr += tcm_sizeof(slice);
 	}
+	return res;
+}
+
+/* wrapper around tmm_pin */
+static s32 pin_mem_to_area(struct tmm *tmm, struct tcm_area *area, u32 *ptr)
+{
+	struct pin_batch b = { .n = 0 };
+	s32 res;
+
+	/* Ensure the data reaches to main memory before PAT refill */
+	wmb();
+
+	/* pin memory into DMM */
+	mutex_lock(&dmac_mtx);
+	res = pin_batch_add_area(&b, tmm, area, ptr);
+	if (!res)
+		res = pin_batch_flush(&b);
 	mutex_unlock(&dmac_mtx);
 
-	return res;
+	return res ? -EFAULT : 0;
 }
 
 /* wrapper around tmm_unpin */
@@ -309,6 +373,57 @@ error:
 	kfree(global_map);
 }
 
+static void debug_fragmentation(struct seq_file *s, u32 arg)
+{
+	struct tcm_free_info info;
+
+	if (tcm_free_info(tcm[TILFMT_8BIT], &info))
+		return;
+
+	mutex_lock(&mtx);
+	seq_printf(s, "slots:\t\t%u\n"
+		      "free:\t\t%u\n"
+		      "largest free:\t%u*%u\n"
+		      "fragmentation:\t%u%%\n",
+		   info.slots, info.free, info.max_w, info.max_h,
+		   info.free ? 100 - info.max_w * info.max_h * 100 / info.free
+			     : 0);
+	seq_printf(s, "failed:\t\t%u\n"
+		      "fragmented:\t%u\n"
+		      "compactions:\t%u\n"
+		      "succeeded:\t%u\n"
+		      "moved:\t\t%u\n"
+		      "dropped:\t%u\n",
+		   compact_stats.failed, compact_stats.fragmented,
+		   compact_stats.compactions, compact_stats.succeeded,
+		   compact_stats.moved, compact_stats.dropped);
+	mutex_unlock(&mtx);
+}
+
+static const struct tiler_debugfs_data debugfs_fragmentation = {
+	"fragmentation", debug_fragmentation, 0
+};
+
+static void debug_refill(struct seq_file *s, u32 arg)
+{
+	struct dmm_pat_stats st;
+
+	dmm_pat_get_stats(&st);
+	seq_printf(s, "refills:\t%u\n"
+		      "areas:\t\t%u\n"
+		      "total:\t\t%llu us\n"
+		      "average:\t%llu us\n"
+		      "max:\t\t%u us\n",
+		   st.refills, st.areas, div_u64(st.total_ns, NSEC_PER_USEC),
+		   st.refills ? div_u64(div_u64(st.total_ns, st.refills),
+					NSEC_PER_USEC) : 0,
+		   st.max_ns / (u32) NSEC_PER_USEC);
+}
+
+static const struct tiler_debugfs_data debugfs_refill = {
+	"refill", debug_refill, 0
+};
+
 const struct tiler_debugfs_data debugfs_maps[] = {
 	{ "1x1", debug_allocation_map, 0x0101 },
 	{ "2x1", debug_allocation_map, 0x0201 },
@@ -422,6 +537,136 @@ static void release_gi(struct gid_info *gi)
  *  ==========================================================================
  */
 
+/* (must have mutex) free an area */
+static inline void _m_area_free(struct area_info *ai)
+{
+	if (ai) {
+		list_del(&ai->by_gid);
+		list_del(&ai->global);
+		kfree(ai);
+	}
+}
+
+/*
+ * 2D compaction
+ *
+ * A live 2D area cannot move, as the container address of its blocks is
+ * what their users (DSS, codecs, user space mappings) hold.  An area whose
+ * blocks are all still just pre-reserved is only known to its group,
+ * however, and has no pages pinned in the PAT either: these can move out
+ * of the way of a 2D area that finds no room, if there are enough free
+ * slots for it.  Pre-reservations are a best effort, so an area that does
+ * not fit back after that is dropped.
+ */
+
+/* (must have mutex) see if all blocks of an area are idle pre-reservations */
+static bool _m_area_movable(struct area_info *ai)
+{
+	struct mem_info *mi, *r;
+	bool reserved;
+
+	if (!ai->gi || !ai->nblocks)
+		return false;
+
+	list_for_each_entry(mi, &ai->blocks, by_area) {
+		if (mi->alloced || mi->refs || mi->pa.num_pg)
+			return false;
+
+		/* blocks being laid out are not yet on the reserved list */
+		reserved = false;
+		list_for_each_entry(r, &ai->gi->reserved, global) {
+			if (r == mi) {
+				reserved = true;
+				break;
+			}
+		}
+		if (!reserved)
+			return false;
+	}
+	return true;
+}
+
+/* (must have mutex) drop the pre-reserved blocks of an area, and the area */
+static void _m_area_drop(struct area_info *ai)
+{
+	struct gid_info *gi = ai->gi;
+	struct mem_info *mi, *mi_;
+
+	list_for_each_entry_safe(mi, mi_, &ai->blocks, by_area) {
+		list_del(&mi->global);
+		list_del(&mi->by_area);
+		kfree(mi);
+	}
+	_m_area_free(ai);
+	_m_try_free_group(gi);
+}
+
+/* move pre-reserved areas to make room for a 2D area */
+static s32 compact_2d(enum tiler_fmt fmt, u16 width, u16 height, u16 align,
+		      struct tcm_area *area)
+{
+	struct area_info *ai, *ai_;
+	struct tcm_free_info info;
+	struct mem_info *mi;
+	LIST_HEAD(moving);
+	s32 res = -ENOMEM;
+
+	mutex_lock(&mtx);
+	compact_stats.failed++;
+	if (tcm_free_info(tcm[fmt], &info) ||
+	    info.free < width * (u32) height)
+		goto done;
+	compact_stats.fragmented++;
+
+	list_for_each_entry_safe(ai, ai_, &areas, global)
+		if (ai->area.tcm == tcm[fmt] && _m_area_movable(ai))
+			list_move_tail(&ai->global, &moving);
+	if (list_empty(&moving))
+		goto done;
+	compact_stats.compactions++;
+
+	/* take them out, their blocks keeping their offsets in the area */
+	list_for_each_entry(ai, &moving, global) {
+		list_for_each_entry(mi, &ai->blocks, by_area) {
+			mi->area.p0.x -= ai->area.p0.x;
+			mi->area.p1.x -= ai->area.p0.x;
+		}
+		tcm_free(&ai->area);
+	}
+
+	res = tcm_reserve_2d(tcm[fmt], width, height, align, area);
+	if (!res)
+		compact_stats.succeeded++;
+
+	/* and put them back wherever they fit now */
+	list_for_each_entry_safe(ai, ai_, &moving, global) {
+		list_move_tail(&ai->global, &areas);
+		if (tcm_reserve_2d(tcm[fmt], tcm_awidth(ai->area),
+				   tcm_aheight(ai->area), ai->align,
+				   &ai->area)) {
+			_m_area_drop(ai);
+			compact_stats.dropped++;
+			continue;
+		}
+
+		list_for_each_entry(mi, &ai->blocks, by_area) {
+			mi->area.tcm = ai->area.tcm;
+			mi->area.p0.x += ai->area.p0.x;
+			mi->area.p1.x += ai->area.p0.x;
+			mi->area.p0.y = ai->area.p0.y;
+			mi->area.p1.y = ai->area.p1.y;
+		}
+		compact_stats.moved++;
+	}
+
+	if (tiler_alloc_debug & 1)
+		printk(KERN_ERR "(compacted for %d*%d: %s)\n", width, height,
+		       res ? "failed" : "fits");
+done:
+	mutex_unlock(&mtx);
+	return res;
+}
+
 /* allocate an reserved area of size, alignment and link it to gi */
 /* leaves mutex locked to be able to add block to area */
 static struct area_info *area_new_m(enum tiler_fmt fmt, u16 width, u16 height,
@@ -437,29 +682,23 @@ static struct area_info *area_new_m(enum tiler_fmt fmt, u16 width, u16 height,
 	INIT_LIST_HEAD(&ai->blocks);
 
 	/* reserve an allocation area */
-	if (tcm_reserve_2d(tcm[fmt], width, height, align, &ai->area)) {
+	if (tcm_reserve_2d(tcm[fmt], width, height, align, &ai->area) &&
+	    compact_2d(fmt, width, height, align, &ai->area)) {
 		kfree(ai);
 		return NULL;
 	}
 
 	ai->gi = gi;
+	ai->align = align;
 	if (alloc_flags & FLAGS_ALLOC_NO_COLOCATE)
 		ai->allowed_modes |= 1 << fmt;
 
 	mutex_lock(&mtx);
 	list_add_tail(&ai->by_gid, &gi->areas);
+	list_add_tail(&ai->global, &areas);
 	return ai;
 }
 
-/* (must have mutex) free an area */
-static inline void _m_area_free(struct area_info *ai)
-{
-	if (ai) {
-		list_del(&ai->by_gid);
-		kfree(ai);
-	}
-}
-
 static s32 __analize_area(enum tiler_fmt fmt, u32 width, u32 height,
 			  u16 *x_area, u16 *y_area, u16 *band, u16 *align,
 			u16 *offs, u16 *remainder)
@@ -901,6 +1140,7 @@ static s32 _m_free(struct mem_info *mi)
 
 			res = tcm_free(&ai->area);
 			list_del(&ai->by_gid);
+			list_del(&ai->global);
 			/* try to remove parent if it became empty */
 			_m_try_free_group(ai->gi);
 			kfree(ai);
@@ -1555,22 +1795,40 @@ static int tiler_resume(struct device *pdev)
 {
 	struct mem_info *mi;
 	struct pat_area area = {0};
+	struct pin_batch b = { .n = 0 };
+	struct tcm_area a;
+	u32 fmt;
 
 	/* clear out PAT entries and set dummy page */
 	area.x1 = tiler.width - 1;
 	area.y1 = tiler.height - 1;
 	mutex_lock(&dmac_mtx);
 	tmm_unpin(tmm[TILFMT_8BIT], area);
-	mutex_unlock(&dmac_mtx);
 
-	/* iterate over all the blocks and refresh the PAT entries */
+	/* Ensure the data reaches to main memory before PAT refill */
+	wmb();
+
+	/*
+	 * Refresh the PAT entries of all the blocks, batching them into as
+	 * few refills as the descriptors allow.
+	 */
 	list_for_each_entry(mi, &blocks, global) {
-		if (mi->pa.mem)
-			if (pin_mem_to_area(tmm[tiler_fmt(mi->blk.phys)],
-						&mi->area, mi->pa.mem))
-				printk(KERN_ERR "Failed PAT restore - %08x\n",
-					mi->blk.phys);
+		if (!mi->pa.mem || !mi->pa.num_pg)
+			continue;
+
+		/* only available pages were pinned for 1D */
+		fmt = tiler_fmt(mi->blk.phys);
+		a = mi->area;
+		if (fmt == TILFMT_PAGE)
+			tcm_1d_limit(&a, mi->pa.num_pg);
+
+		if (pin_batch_add_area(&b, tmm[fmt], &a, mi->pa.mem))
+			printk(KERN_ERR "Failed PAT restore - %08x\n",
+				mi->blk.phys);
 	}
+	if (pin_batch_flush(&b))
+		printk(KERN_ERR "Failed PAT restore\n");
+	mutex_unlock(&dmac_mtx);
 
 	return 0;
 }
@@ -1712,13 +1970,21 @@ static s32 __init tiler_init(void)
 	mutex_init(&mtx);
 	INIT_LIST_HEAD(&blocks);
 	INIT_LIST_HEAD(&orphan_areas);
+	INIT_LIST_HEAD(&areas);
 	INIT_LIST_HEAD(&orphan_onedim);
 
 	dbgfs = debugfs_create_dir("tiler", NULL);
 	if (IS_ERR_OR_NULL(dbgfs))
 		dev_warn(device, "failed to create debug files.\n");
-	else
+	else {
 		dbg_map = debugfs_create_dir("map", dbgfs);
+		debugfs_create_file(debugfs_fragmentation.name, S_IRUGO, dbgfs,
+				    (void *) &debugfs_fragmentation,
+				    &tiler_debug_fops);
+		debugfs_create_file(debugfs_refill.name, S_IRUGO, dbgfs,
+				    (void *) &debugfs_refill,
+				    &tiler_debug_fops);
+	}
 	if (!IS_ERR_OR_NULL(dbg_map)) {
 		int i;
 		for (i = 0; i < ARRAY_SIZE(debugfs_maps); i++)
@@ -23,9 +23,13 @@
 #include <linux/mutex.h>
 #include <linux/list.h>
 #include <linux/slab.h>
+#include <linux/dma-mapping.h>
 
 #include "tmm.h"
 
+/* PAT descriptors chained into one refill */
+#define TMM_PAT_DESCS	32
+
 static int param_set_mem(const char *val, struct kernel_param *kp);
 
 /* Memory limit to cache free pages. TILER will eventually use this much */
@@ -65,6 +69,8 @@ struct dmm_mem {
 	u32 dmac_pa;		/* phys.addr of coherent memory */
 	struct page *dummy_pg;	/* dummy page */
 	u32 dummy_pa;		/* phys.addr of dummy page */
+	struct pat *desc;	/* coherent PAT descriptors, or NULL */
+	dma_addr_t desc_pa;	/* phys.addr of descriptors */
 };
 
 /* read mem values for a param */
@@ -168,6 +174,9 @@ static void tmm_pat_deinit(struct tmm *tmm)
 		free_page_cache();
 
 	__free_page(pvt->dummy_pg);
+	if (pvt->desc)
+		dma_free_coherent(NULL, TMM_PAT_DESCS * sizeof(*pvt->desc),
+				  pvt->desc, pvt->desc_pa);
 
 	mutex_unlock(&mtx);
 }
@@ -268,6 +277,39 @@ static s32 tmm_pat_pin(struct tmm *tmm, struct pat_area area, u32 page_pa)
 	return dmm_pat_refill(pvt->dmm, &pat_desc, MANUAL);
 }
 
+/*
+ * Like the data the areas point to, the descriptors are guarded by the
+ * caller: the TILER driver pins under its dmac mutex.
+ */
+static s32 tmm_pat_pin_list(struct tmm *tmm, struct pat_area *areas,
+			    u32 *page_pa, u32 n)
+{
+	struct dmm_mem *pvt = (struct dmm_mem *) tmm->pvt;
+	struct pat *d;
+	s32 res = 0;
+	u32 i, k;
+
+	/* no descriptor memory: one refill per area */
+	if (!pvt->desc) {
+		for (i = 0; i < n && !res; i++)
+			res = tmm_pat_pin(tmm, areas[i], page_pa[i]);
+		return res;
+	}
+
+	for (i = 0; i < n && !res; i += k) {
+		k = min_t(u32, n - i, TMM_PAT_DESCS);
+		memset(pvt->desc, 0, k * sizeof(*pvt->desc));
+		for (d = pvt->desc; d < pvt->desc + k; d++) {
+			d->ctrl.start = 1;
+			d->area = areas[i + (d - pvt->desc)];
+			/* must be a 16-byte aligned physical address */
+			d->data = page_pa[i + (d - pvt->desc)];
+		}
+		res = dmm_pat_refill_list(pvt->dmm, pvt->desc, pvt->desc_pa, k);
+	}
+	return res;
+}
+
 static void tmm_pat_unpin(struct tmm *tmm, struct pat_area area)
 {
 	u16 w = (u8) area.x1 - (u8) area.x0;
@@ -300,6 +342,11 @@ struct tmm *tmm_pat_init(u32 pat_id, u32 *dmac_va, u32 dmac_pa)
 		pvt->dmac_va = dmac_va;
 		pvt->dummy_pa = page_to_phys(pvt->dummy_pg);
 
+		/* without descriptors, lists are pinned one area at a time */
+		pvt->desc = dma_alloc_coherent(NULL, TMM_PAT_DESCS *
+					sizeof(*pvt->desc), &pvt->desc_pa,
+					GFP_KERNEL);
+
 		INIT_LIST_HEAD(&pvt->fast_list);
 
 		/* increate tmm_pat references */
@@ -313,6 +360,7 @@ struct tmm *tmm_pat_init(u32 pat_id, u32 *dmac_va, u32 dmac_pa)
 		tmm->get = tmm_pat_get_pages;
 		tmm->free = tmm_pat_free_pages;
 		tmm->pin = tmm_pat_pin;
+		tmm->pin_list = tmm_pat_pin_list;
 		tmm->unpin = tmm_pat_unpin;
 
 		return tmm;
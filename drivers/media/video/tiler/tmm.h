@@ -50,6 +50,8 @@ struct tmm {
 	u32 *(*get)	(struct tmm *tmm, u32 num_pages);
 	void (*free)	(struct tmm *tmm, u32 *pages);
 	s32  (*pin)	(struct tmm *tmm, struct pat_area area, u32 page_pa);
+	s32  (*pin_list)(struct tmm *tmm, struct pat_area *areas, u32 *page_pa,
+			 u32 n);
 	void (*unpin)	(struct tmm *tmm, struct pat_area area);
 	void (*deinit)	(struct tmm *tmm);
 };
@@ -90,6 +92,27 @@ s32 tmm_pin(struct tmm *tmm, struct pat_area area, u32 page_pa)
 	return -ENODEV;
 }
 
+/**
+ * Program the physical address translator for a list of areas, in as
+ * few refills as the implementation can.
+ * @param areas PAT areas
+ * @param page_pa list of pages for each area
+ * @param n number of areas
+ */
+static inline
+s32 tmm_pin_list(struct tmm *tmm, struct pat_area *areas, u32 *page_pa, u32 n)
+{
+	s32 res = 0;
+	u32 i;
+
+	if (tmm && tmm->pin_list && tmm->pvt)
+		return tmm->pin_list(tmm, areas, page_pa, n);
+
+	for (i = 0; i < n && !res; i++)
+		res = tmm_pin(tmm, areas[i], page_pa[i]);
+	return res;
+}
+
 /**
  * Clears the physical address translator.
  * @param area PAT area
@@ -0,0 +1,153 @@
+/*
+ $License:
+    Copyright (C) 2011 InvenSense Corporation, All Rights Reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  $
+ */
+#include <linux/kernel.h>
+#include <linux/hrtimer.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+
+#include "irqbatch.h"
+
+#define IRQBATCH_MASK		(IRQBATCH_SIZE - 1)
+
+static void irqbatch_wake(struct irqbatch *b)
+{
+	b->ready = true;
+	wake_up_interruptible(b->wait);
+}
+
+static enum hrtimer_restart irqbatch_timer(struct hrtimer *timer)
+{
+	struct irqbatch *b = container_of(timer, struct irqbatch, timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&b->lock, flags);
+	if (b->count)
+		irqbatch_wake(b);
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+void irqbatch_init(struct irqbatch *b, wait_queue_head_t *wait)
+{
+	spin_lock_init(&b->lock);
+	b->head = 0;
+	b->count = 0;
+	b->latency_us = 0;
+	b->dropped = 0;
+	b->ready = false;
+	b->wait = wait;
+	hrtimer_init(&b->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	b->timer.function = irqbatch_timer;
+}
+
+void irqbatch_exit(struct irqbatch *b)
+{
+	hrtimer_cancel(&b->timer);
+}
+
+/* called from the interrupt handlers */
+void irqbatch_add(struct irqbatch *b, const struct mpuirq_data *ev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&b->lock, flags);
+
+	if (!b->latency_us) {
+		b->ring[0] = *ev;
+		b->head = 0;
+		b->count = 1;
+		irqbatch_wake(b);
+		goto out;
+	}
+
+	if (b->count == IRQBATCH_SIZE) {
+		b->head = (b->head + 1) & IRQBATCH_MASK;
+		b->count--;
+		b->dropped++;
+	}
+	b->ring[(b->head + b->count) & IRQBATCH_MASK] = *ev;
+	b->count++;
+
+	if (b->ready)
+		goto out;
+	if (b->count >= IRQBATCH_WATERMARK) {
+		hrtimer_try_to_cancel(&b->timer);
+		irqbatch_wake(b);
+	} else if (b->count == 1) {
+		hrtimer_start(&b->timer, ns_to_ktime(b->latency_us * 1000),
+			      HRTIMER_MODE_REL);
+	}
+out:
+	spin_unlock_irqrestore(&b->lock, flags);
+}
+
+/*
+ * Copy out as many of the queued events, oldest first, as fit in @count
+ * bytes.  Returns the number of bytes copied.
+ */
+ssize_t irqbatch_read(struct irqbatch *b, char __user *buf, size_t count)
+{
+	struct mpuirq_data ev[8];
+	unsigned long flags;
+	size_t done = 0;
+	unsigned int i, n;
+
+	while (count - done >= sizeof(ev[0])) {
+		spin_lock_irqsave(&b->lock, flags);
+		n = min_t(unsigned int, b->count, ARRAY_SIZE(ev));
+		n = min_t(unsigned int, n, (count - done) / sizeof(ev[0]));
+		for (i = 0; i < n; i++)
+			ev[i] = b->ring[(b->head + i) & IRQBATCH_MASK];
+		b->head = (b->head + n) & IRQBATCH_MASK;
+		b->count -= n;
+		if (!b->count)
+			b->ready = false;
+		spin_unlock_irqrestore(&b->lock, flags);
+
+		if (!n)
+			break;
+		if (copy_to_user(buf + done, ev, n * sizeof(ev[0])))
+			return -EFAULT;
+		done += n * sizeof(ev[0]);
+	}
+	return done;
+}
+
+int irqbatch_set_latency(struct irqbatch *b, unsigned long us)
+{
+	unsigned long flags;
+
+	if (us > IRQBATCH_MAX_LATENCY_US)
+		return -EINVAL;
+
+	spin_lock_irqsave(&b->lock, flags);
+	b->latency_us = us;
+	/* back to one event at a time: keep the latest */
+	if (!us && b->count > 1) {
+		b->ring[0] = b->ring[(b->head + b->count - 1) & IRQBATCH_MASK];
+		b->head = 0;
+		b->count = 1;
+	}
+	if (b->count && !b->ready)
+		irqbatch_wake(b);
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ $License:
+    Copyright (C) 2011 InvenSense Corporation, All Rights Reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  $
+ */
+
+#ifndef __IRQBATCH__
+#define __IRQBATCH__
+
+#include <linux/hrtimer.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/mpu.h>
+
+/*
+ * Ring of the interrupt events of one of the irq devices, each the
+ * struct mpuirq_data a read returned for it.
+ *
+ * With a report latency of 0 the ring only holds the latest event and
+ * readers are woken for every interrupt, as the devices always did.
+ * Otherwise events queue up, and readers are only woken once the oldest
+ * one has waited for the latency or the ring is filling up, to take them
+ * all with one read and drain the sensor FIFO in one burst.
+ */
+#define IRQBATCH_SIZE		64	/* events, a power of 2 */
+#define IRQBATCH_WATERMARK	(IRQBATCH_SIZE * 3 / 4)
+#define IRQBATCH_MAX_LATENCY_US	1000000
+
+struct irqbatch {
+	spinlock_t lock;
+	struct mpuirq_data ring[IRQBATCH_SIZE];
+	unsigned int head;	/* oldest event */
+	unsigned int count;
+	unsigned long latency_us;
+	unsigned long dropped;	/* events lost to a full ring */
+	bool ready;		/* readers have been woken */
+	struct hrtimer timer;
+	wait_queue_head_t *wait;
+};
+
+void irqbatch_init(struct irqbatch *b, wait_queue_head_t *wait);
+void irqbatch_exit(struct irqbatch *b);
+void irqbatch_add(struct irqbatch *b, const struct mpuirq_data *ev);
+ssize_t irqbatch_read(struct irqbatch *b, char __user *buf, size_t count);
+int irqbatch_set_latency(struct irqbatch *b, unsigned long us);
+
+static inline bool irqbatch_ready(struct irqbatch *b)
+{
+	return b->ready;
+}
+
+#endif
@@ -40,6 +40,7 @@
 #include <linux/mpu.h>
 #include "mpuirq.h"
 #include "mldl_cfg.h"
+#include "irqbatch.h"
 
 #define MPUIRQ_NAME "mpuirq"
 
@@ -53,8 +54,8 @@ struct mpuirq_dev_data {
 	int irq;
 	int pid;
 	int accel_divider;
-	int data_ready;
 	int timeout;
+	struct irqbatch batch;
 };
 
 static struct mpuirq_dev_data mpuirq_dev_data;
@@ -81,30 +82,28 @@ static int mpuirq_release(struct inode *inode, struct file *file)
 static ssize_t mpuirq_read(struct file *file,
 			   char *buf, size_t count, loff_t *ppos)
 {
-	int len, err;
+	ssize_t len;
 	struct mpuirq_dev_data *p_mpuirq_dev_data = file->private_data;
 
-	if (!mpuirq_dev_data.data_ready &&
+	if (!irqbatch_ready(&mpuirq_dev_data.batch) &&
 	    mpuirq_dev_data.timeout && (!(file->f_flags & O_NONBLOCK))) {
 		wait_event_interruptible_timeout(mpuirq_wait,
-						 mpuirq_dev_data.data_ready,
-						 mpuirq_dev_data.timeout);
+				irqbatch_ready(&mpuirq_dev_data.batch),
+				mpuirq_dev_data.timeout);
 	}
 
-	if (mpuirq_dev_data.data_ready && NULL != buf
-	    && count >= sizeof(mpuirq_data)) {
-		err = copy_to_user(buf, &mpuirq_data, sizeof(mpuirq_data));
-		mpuirq_data.data_type = 0;
-	} else {
+	if (NULL == buf)
 		return 0;
-	}
-	if (err != 0) {
+
+	/* as many events as fit, one struct mpuirq_data each */
+	len = irqbatch_read(&mpuirq_dev_data.batch, buf, count);
+	if (len < 0) {
 		dev_err(p_mpuirq_dev_data->dev->this_device,
-			"Copy to user returned %d\n", err);
-		return -EFAULT;
+			"Copy to user returned %d\n", (int)len);
+		return len;
 	}
-	mpuirq_dev_data.data_ready = 0;
-	len = sizeof(mpuirq_data);
+	if (len)
+		mpuirq_data.data_type = 0;
 	return len;
 }
 
@@ -113,7 +112,7 @@ unsigned int mpuirq_poll(struct file *file, struct poll_table_struct *poll)
 	int mask = 0;
 
 	poll_wait(file, &mpuirq_wait, poll);
-	if (mpuirq_dev_data.data_ready)
+	if (irqbatch_ready(&mpuirq_dev_data.batch))
 		mask |= POLLIN | POLLRDNORM;
 	return mask;
 }
@@ -146,6 +145,15 @@ static long mpuirq_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case MPUIRQ_SET_FREQUENCY_DIVIDER:
 		mpuirq_dev_data.accel_divider = arg;
 		break;
+	case MPUIRQ_SET_BATCH_LATENCY:
+		retval = irqbatch_set_latency(&mpuirq_dev_data.batch, arg);
+		break;
+	case MPUIRQ_GET_BATCH_DROPPED:
+		if (copy_to_user((unsigned long *)arg,
+				 &mpuirq_dev_data.batch.dropped,
+				 sizeof(unsigned long)))
+			return -EFAULT;
+		break;
 	default:
 		retval = -EINVAL;
 	}
@@ -159,15 +167,12 @@ static irqreturn_t mpuirq_handler(int irq, void *dev_id)
 
 	mpuirq_data.interruptcount++;
 
-	/* wake up (unblock) for reading data from userspace */
-	/* and ignore first interrupt generated in module init */
-	mpuirq_dev_data.data_ready = 1;
-
 	mpuirq_data.irqtime = ktime_to_ns(ktime_get());
 	mpuirq_data.data_type = MPUIRQ_DATA_TYPE_MPU_IRQ;
 	mpuirq_data.data = 0;
 
-	wake_up_interruptible(&mpuirq_wait);
+	/* wake up (unblock) for reading data from userspace */
+	irqbatch_add(&mpuirq_dev_data.batch, &mpuirq_data);
 
 	return IRQ_HANDLED;
 
@@ -203,9 +208,9 @@ int mpuirq_init(struct i2c_client *mpu_client, struct mldl_cfg *mldl_cfg)
 	mpuirq_dev_data.irq = mpu_client->irq;
 	mpuirq_dev_data.pid = 0;
 	mpuirq_dev_data.accel_divider = -1;
-	mpuirq_dev_data.data_ready = 0;
 	mpuirq_dev_data.timeout = 0;
 	mpuirq_dev_data.dev = &mpuirq_device;
+	irqbatch_init(&mpuirq_dev_data.batch, &mpuirq_wait);
 
 	if (mpuirq_dev_data.irq) {
 		unsigned long flags;
@@ -242,6 +247,7 @@ void mpuirq_exit(void)
 {
 	if (mpuirq_dev_data.irq > 0)
 		free_irq(mpuirq_dev_data.irq, &mpuirq_dev_data.irq);
+	irqbatch_exit(&mpuirq_dev_data.batch);
 
 	dev_info(mpuirq_device.this_device, "Unregistering %s\n", MPUIRQ_NAME);
 	misc_deregister(&mpuirq_device);
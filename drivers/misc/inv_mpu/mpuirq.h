@@ -29,6 +29,9 @@
 #define MPUIRQ_GET_INTERRUPT_CNT     _IOR(MPU_IOCTL, 0x41, unsigned long)
 #define MPUIRQ_GET_IRQ_TIME          _IOR(MPU_IOCTL, 0x42, struct timeval)
 #define MPUIRQ_SET_FREQUENCY_DIVIDER _IOW(MPU_IOCTL, 0x43, unsigned long)
+/* max report latency in usecs, 0 to be woken for every interrupt */
+#define MPUIRQ_SET_BATCH_LATENCY     _IOW(MPU_IOCTL, 0x44, unsigned long)
+#define MPUIRQ_GET_BATCH_DROPPED     _IOR(MPU_IOCTL, 0x45, unsigned long)
 
 void mpuirq_exit(void);
 int mpuirq_init(struct i2c_client *mpu_client, struct mldl_cfg *mldl_cfg);
@@ -42,6 +42,7 @@
 #include <linux/mpu.h>
 #include "slaveirq.h"
 #include "mldl_cfg.h"
+#include "irqbatch.h"
 
 /* function which gets slave data and sends it to SLAVE */
 
@@ -52,8 +53,8 @@ struct slaveirq_dev_data {
 	wait_queue_head_t slaveirq_wait;
 	int irq;
 	int pid;
-	int data_ready;
 	int timeout;
+	struct irqbatch batch;
 };
 
 /* The following depends on patch fa1f68db6ca7ebb6fc4487ac215bffba06c01c28
@@ -84,30 +85,29 @@ static int slaveirq_release(struct inode *inode, struct file *file)
 static ssize_t slaveirq_read(struct file *file,
 			     char *buf, size_t count, loff_t *ppos)
 {
-	int len, err;
+	ssize_t len;
 	struct slaveirq_dev_data *data =
 	    container_of(file->private_data, struct slaveirq_dev_data, dev);
 
-	if (!data->data_ready && data->timeout &&
+	if (!irqbatch_ready(&data->batch) && data->timeout &&
 	    !(file->f_flags & O_NONBLOCK)) {
 		wait_event_interruptible_timeout(data->slaveirq_wait,
-						 data->data_ready,
+						 irqbatch_ready(&data->batch),
 						 data->timeout);
 	}
 
-	if (data->data_ready && NULL != buf && count >= sizeof(data->data)) {
-		err = copy_to_user(buf, &data->data, sizeof(data->data));
-		data->data.data_type = 0;
-	} else {
+	if (NULL == buf)
 		return 0;
-	}
-	if (err != 0) {
+
+	/* as many events as fit, one struct mpuirq_data each */
+	len = irqbatch_read(&data->batch, buf, count);
+	if (len < 0) {
 		dev_err(data->dev.this_device,
-			"Copy to user returned %d\n", err);
-		return -EFAULT;
+			"Copy to user returned %d\n", (int)len);
+		return len;
 	}
-	data->data_ready = 0;
-	len = sizeof(data->data);
+	if (len)
+		data->data.data_type = 0;
 	return len;
 }
 
@@ -119,7 +119,7 @@ static unsigned int slaveirq_poll(struct file *file,
 	    container_of(file->private_data, struct slaveirq_dev_data, dev);
 
 	poll_wait(file, &data->slaveirq_wait, poll);
-	if (data->data_ready)
+	if (irqbatch_ready(&data->batch))
 		mask |= POLLIN | POLLRDNORM;
 	return mask;
 }
@@ -152,6 +152,14 @@ static long slaveirq_ioctl(struct file *file,
 			return -EFAULT;
 		data->data.irqtime = 0;
 		break;
+	case SLAVEIRQ_SET_BATCH_LATENCY:
+		retval = irqbatch_set_latency(&data->batch, arg);
+		break;
+	case SLAVEIRQ_GET_BATCH_DROPPED:
+		if (copy_to_user((unsigned long *)arg, &data->batch.dropped,
+				 sizeof(unsigned long)))
+			return -EFAULT;
+		break;
 	default:
 		retval = -EINVAL;
 	}
@@ -166,13 +174,11 @@ static irqreturn_t slaveirq_handler(int irq, void *dev_id)
 
 	data->data.interruptcount++;
 
-	/* wake up (unblock) for reading data from userspace */
-	data->data_ready = 1;
-
 	data->data.irqtime = ktime_to_ns(ktime_get());
 	data->data.data_type |= 1;
 
-	wake_up_interruptible(&data->slaveirq_wait);
+	/* wake up (unblock) for reading data from userspace */
+	irqbatch_add(&data->batch, &data->data);
 
 	return IRQ_HANDLED;
 
@@ -214,10 +220,10 @@ int slaveirq_init(struct i2c_adapter *slave_adapter,
 	data->dev.fops = &slaveirq_fops;
 	data->irq = pdata->irq;
 	data->pid = 0;
-	data->data_ready = 0;
 	data->timeout = 0;
 
 	init_waitqueue_head(&data->slaveirq_wait);
+	irqbatch_init(&data->batch, &data->slaveirq_wait);
 
 	res = request_irq(data->irq, slaveirq_handler, IRQF_TRIGGER_RISING,
 			  data->dev.name, data);
@@ -256,6 +262,7 @@ void slaveirq_exit(struct ext_slave_platform_data *pdata)
 	dev_info(data->dev.this_device, "Unregistering %s\n", data->dev.name);
 
 	free_irq(data->irq, data);
+	irqbatch_exit(&data->batch);
 	misc_deregister(&data->dev);
 	kfree(pdata->irq_data);
 	pdata->irq_data = NULL;
@@ -28,6 +28,9 @@
 #define SLAVEIRQ_SET_TIMEOUT           _IOW(MPU_IOCTL, 0x50, unsigned long)
 #define SLAVEIRQ_GET_INTERRUPT_CNT     _IOR(MPU_IOCTL, 0x51, unsigned long)
 #define SLAVEIRQ_GET_IRQ_TIME          _IOR(MPU_IOCTL, 0x52, unsigned long)
+/* as MPUIRQ_SET_BATCH_LATENCY and MPUIRQ_GET_BATCH_DROPPED */
+#define SLAVEIRQ_SET_BATCH_LATENCY     _IOW(MPU_IOCTL, 0x53, unsigned long)
+#define SLAVEIRQ_GET_BATCH_DROPPED     _IOR(MPU_IOCTL, 0x54, unsigned long)
 
 
 void slaveirq_exit(struct ext_slave_platform_data *pdata);
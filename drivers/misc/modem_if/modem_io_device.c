@@ -333,9 +333,12 @@ static int rx_iodev_skb_raw(struct io_device *iod)
 			skb_pull(skb, sizeof(struct ethhdr));
 		}
 
-		err = netif_rx_ni(skb);
-		if (err != NET_RX_SUCCESS)
+		/* rx_iodev_work() runs the stack once for the whole batch */
+		err = netif_rx(skb);
+		if (err != NET_RX_SUCCESS) {
+			ndev->stats.rx_dropped++;
 			dev_err(&ndev->dev, "rx error: %d\n", err);
+		}
 		return err;
 
 	default:
@@ -352,6 +355,7 @@ static void rx_iodev_work(struct work_struct *work)
 	struct io_device *iod = container_of(work, struct io_device,
 				rx_work.work);
 
+	local_bh_disable();
 	skb = skb_dequeue(&iod->sk_rx_q);
 	while (skb) {
 		real_iod = *((struct io_device **)skb->cb);
@@ -370,6 +374,7 @@ static void rx_iodev_work(struct work_struct *work)
 
 		skb = skb_dequeue(&iod->sk_rx_q);
 	}
+	local_bh_enable();
 }
 
 static int rx_multipdp(struct io_device *iod)
@@ -499,6 +504,108 @@ exit:
 	return err;
 }
 
+/*
+ * Hand the frames of a bulk over as clones of it, pointing at their
+ * payload, instead of copying them out.  Each is charged its share of
+ * the bulk's memory.  The last frame gets the bulk itself.  A frame
+ * running past the end of the bulk goes through the copying path, which
+ * finishes it with the next bulk.
+ */
+static int rx_hdlc_packet_skb(struct io_device *iod, struct sk_buff *bulk)
+{
+	unsigned int truesize = bulk->truesize;
+	unsigned int bulk_len = bulk->len;
+	unsigned int rest = bulk->len;
+	char *buf = (char *)bulk->data;
+	struct raw_hdr *hdr;
+	struct sk_buff *skb;
+	unsigned int frame_len, data_len;
+	int err = 0;
+
+	while (rest) {
+		hdr = (struct raw_hdr *)(buf + SIZE_OF_HDLC_START);
+		if (rest < SIZE_OF_HDLC_START + sizeof(*hdr) ||
+		    hdr->len > rest - SIZE_OF_HDLC_START - SIZE_OF_HDLC_END) {
+			err = rx_hdlc_packet(iod, buf, rest);
+			break;
+		}
+
+		frame_len = SIZE_OF_HDLC_START + hdr->len + SIZE_OF_HDLC_END;
+		data_len = hdr->len - sizeof(*hdr);
+		if (buf[0] != HDLC_START || buf[frame_len - 1] != HDLC_END ||
+		    hdr->len < sizeof(*hdr)) {
+			pr_err("[MODEM_IF] Wrong HDLC frame: 0x%x(%s)\n",
+						*buf, iod->name);
+			err = -EBADMSG;
+			break;
+		}
+		if (data_len > MAX_RXDATA_SIZE) {
+			pr_err("%s: %s: packet size too large (%d)\n",
+					__func__, iod->name, data_len);
+			err = -EINVAL;
+			break;
+		}
+
+		if (frame_len == rest) {
+			skb = bulk;
+			bulk = NULL;
+		} else {
+			skb = skb_clone(bulk, GFP_ATOMIC);
+			if (unlikely(!skb)) {
+				err = -ENOMEM;
+				break;
+			}
+		}
+		skb_pull(skb, buf + SIZE_OF_HDLC_START + sizeof(*hdr) -
+				(char *)skb->data);
+		skb_trim(skb, data_len);
+		skb->truesize = max_t(unsigned int,
+				      truesize * frame_len / bulk_len,
+				      data_len + sizeof(*skb));
+
+		memcpy(iod->h_data.hdr, hdr, sizeof(*hdr));
+		iod->skb_recv = skb;
+		err = rx_iodev_skb(iod);
+		if (err < 0)
+			dev_kfree_skb_any(skb);
+		iod->skb_recv = NULL;
+		memset(&iod->h_data, 0x00, sizeof(struct header_data));
+		if (err < 0)
+			break;
+
+		buf += frame_len;
+		rest -= frame_len;
+	}
+
+	if (bulk)
+		dev_kfree_skb_any(bulk);
+	return err;
+}
+
+static int io_dev_recv_skb_from_link_dev(struct io_device *iod,
+			struct sk_buff *skb)
+{
+	int err;
+
+	/*
+	 * Only multiplexed raw frames go up in place, and only when none is
+	 * left to finish from the last bulk.  Links wanting an ethernet
+	 * header in front of the IP data need the room the HDLC framing
+	 * of a shared bulk doesn't have.
+	 */
+	if (iod->format == IPC_MULTI_RAW && iod->net_typ == UMTS_NETWORK &&
+	    !iod->h_data.start && !iod->skb_recv) {
+		err = rx_hdlc_packet_skb(iod, skb);
+		if (err < 0)
+			pr_err("[MODEM_IF] fail process hdlc fram\n");
+		return err;
+	}
+
+	err = iod->recv(iod, skb->data, skb->len);
+	dev_kfree_skb_any(skb);
+	return err;
+}
+
 /* called from link device when a packet arrives for this io device */
 static int io_dev_recv_data_from_link_dev(struct io_device *iod,
 			const char *data, unsigned int len)
@@ -863,6 +970,7 @@ int init_io_device(struct io_device *iod)
 	iod->modem_state_changed = io_dev_modem_state_changed;
 	/* get data from link device */
 	iod->recv = io_dev_recv_data_from_link_dev;
+	iod->recv_skb = io_dev_recv_skb_from_link_dev;
 
 	INIT_LIST_HEAD(&iod->list);
 
@@ -23,6 +23,9 @@
 #include <linux/gpio.h>
 #include <linux/if_arp.h>
 #include <linux/wakelock.h>
+#include <linux/hrtimer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/hsi_driver_if.h>
 
@@ -155,10 +158,18 @@ static int mipi_hsi_send(struct link_device *ld, struct io_device *iod,
 	/* en queue skb data */
 	skb_queue_tail(txq, skb);
 
-	if (iod->format == IPC_RAW)
-		queue_delayed_work(ld->tx_raw_wq, &ld->tx_delayed_work, 0);
-	else
+	/*
+	 * Give raw frames, TCP acks mostly, a moment to gather, so that
+	 * they share the handshake and the wakeup of one transfer.
+	 */
+	if (iod->format != IPC_RAW)
 		queue_work(ld->tx_wq, &ld->tx_work);
+	else if (skb_queue_len(txq) >= MIPI_TX_AGGR_FRAMES)
+		queue_delayed_work(ld->tx_raw_wq, &ld->tx_delayed_work, 0);
+	else if (!hrtimer_active(&mipi_ld->tx_aggr_timer))
+		hrtimer_start(&mipi_ld->tx_aggr_timer,
+			      ns_to_ktime(MIPI_TX_AGGR_US * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
 
 	return tx_size;
 }
@@ -221,6 +232,16 @@ static void mipi_hsi_tx_work(struct work_struct *work)
 	}
 }
 
+static enum hrtimer_restart mipi_hsi_tx_aggr_func(struct hrtimer *timer)
+{
+	struct mipi_link_device *mipi_ld = container_of(timer,
+				struct mipi_link_device, tx_aggr_timer);
+
+	queue_delayed_work(mipi_ld->ld.tx_raw_wq,
+			   &mipi_ld->ld.tx_delayed_work, 0);
+	return HRTIMER_NORESTART;
+}
+
 static void mipi_hsi_tx_raw_work(struct work_struct *work)
 {
 	int ret;
@@ -229,6 +250,7 @@ static void mipi_hsi_tx_raw_work(struct work_struct *work)
 	struct mipi_link_device *mipi_ld = to_mipi_link_device(ld);
 	struct sk_buff *raw_skb;
 	unsigned bulk_size;
+	unsigned int frames;
 
 	while (ld->sk_raw_tx_q.qlen) {
 		pr_debug("[MIPI-HSI] raw qlen:%d\n", ld->sk_raw_tx_q.qlen);
@@ -239,12 +261,14 @@ static void mipi_hsi_tx_raw_work(struct work_struct *work)
 		}
 
 		bulk_size = 0;
+		frames = 0;
 		raw_skb = skb_dequeue(&ld->sk_raw_tx_q);
 		while (raw_skb) {
 			if (bulk_size + raw_skb->len < MIPI_BULK_TX_SIZE) {
 				memcpy(mipi_ld->bulk_tx_buf + bulk_size,
 						raw_skb->data, raw_skb->len);
 				bulk_size += raw_skb->len;
+				frames++;
 				skb_queue_head(&mipi_ld->bulk_txq, raw_skb);
 			} else {
 				skb_queue_head(&ld->sk_raw_tx_q, raw_skb);
@@ -261,8 +285,13 @@ static void mipi_hsi_tx_raw_work(struct work_struct *work)
 				skb_queue_head(&ld->sk_raw_tx_q, raw_skb);
 				raw_skb = skb_dequeue(&mipi_ld->bulk_txq);
 			}
-		} else
+		} else {
 			skb_queue_purge(&mipi_ld->bulk_txq);
+			mipi_ld->tx_bulks++;
+			mipi_ld->tx_frames += frames;
+			if (frames > mipi_ld->tx_max_frames)
+				mipi_ld->tx_max_frames = frames;
+		}
 	}
 }
 
@@ -275,10 +304,29 @@ static struct hsi_device_driver if_hsi_driver = {
 	},
 };
 
+/*
+ * Called with the line about to go up: hold it longer if it was dropped
+ * too early, back towards the default once the link stays quiet.
+ */
+static void if_hsi_acwake_hysteresis(struct mipi_link_device *mipi_ld)
+{
+	unsigned long idle = jiffies - mipi_ld->acwake_down_at;
+
+	if (idle < mipi_ld->acwake_hold)
+		mipi_ld->acwake_hold = min_t(unsigned int,
+				2 * mipi_ld->acwake_hold, HSI_ACWAKE_HOLD_MAX);
+	else if (idle > 4 * mipi_ld->acwake_hold)
+		mipi_ld->acwake_hold = max_t(unsigned int,
+				mipi_ld->acwake_hold / 2,
+				HSI_ACWAKE_DOWN_TIMEOUT);
+}
+
 static int if_hsi_set_wakeline(struct if_hsi_channel *channel,
 			unsigned int state)
 {
 	int ret;
+	struct mipi_link_device *mipi_ld =
+			(struct mipi_link_device *)if_hsi_driver.priv_data;
 
 	spin_lock_bh(&channel->acwake_lock);
 	if (channel->acwake == state) {
@@ -300,6 +348,13 @@ static int if_hsi_set_wakeline(struct if_hsi_channel *channel,
 	}
 
 	channel->acwake = state;
+	if (state) {
+		if_hsi_acwake_hysteresis(mipi_ld);
+		mipi_ld->acwake_ups++;
+	} else {
+		mipi_ld->acwake_down_at = jiffies;
+		mipi_ld->acwake_downs++;
+	}
 	spin_unlock_bh(&channel->acwake_lock);
 
 	pr_debug("[MIPI-HSI] ACWAKE_%d(%d)\n", channel->channel_id, state);
@@ -322,9 +377,9 @@ static void if_hsi_acwake_down_func(unsigned long data)
 			if_hsi_set_wakeline(channel, 0);
 		} else {
 			mod_timer(&mipi_ld->hsi_acwake_down_timer, jiffies +
-					HSI_ACWAKE_DOWN_TIMEOUT);
+					mipi_ld->acwake_hold);
 			pr_debug("[MIPI-HSI] mod_timer done(%d)\n",
-					HSI_ACWAKE_DOWN_TIMEOUT);
+					mipi_ld->acwake_hold);
 			return;
 		}
 	}
@@ -846,7 +901,7 @@ static void if_hsi_cmd_work(struct work_struct *work)
 			channel->send_step = STEP_TX;
 			if_hsi_set_wakeline(channel, 1);
 			mod_timer(&mipi_ld->hsi_acwake_down_timer, jiffies +
-					HSI_ACWAKE_DOWN_TIMEOUT);
+					mipi_ld->acwake_hold);
 		} else {
 			spin_unlock_irqrestore(&mipi_ld->list_cmd_lock, flags);
 			channel->send_step = STEP_IDLE;
@@ -988,6 +1043,27 @@ static int if_hsi_decode_cmd(struct mipi_link_device *mipi_ld,
 	return 0;
 }
 
+/*
+ * Pick the buffer the next bulk of @channel is read into: the pre-posted
+ * skb for the RAW channel, so that its frames go up without a copy, if
+ * the bulk fits.
+ */
+static u32 *if_hsi_rx_buf(struct if_hsi_channel *channel)
+{
+	channel->rx_in_skb = false;
+	if (channel->channel_id != HSI_RAW_CHANNEL)
+		return channel->rx_data;
+
+	if (!channel->rx_skb)
+		channel->rx_skb = alloc_skb(MIPI_RX_SKB_SIZE, GFP_ATOMIC);
+	if (!channel->rx_skb ||
+	    channel->rx_count > skb_tailroom(channel->rx_skb))
+		return channel->rx_data;
+
+	channel->rx_in_skb = true;
+	return (u32 *)channel->rx_skb->data;
+}
+
 static int if_hsi_rx_cmd_handle(struct mipi_link_device *mipi_ld, u32 cmd,
 			u32 ch, u32 param)
 {
@@ -1010,9 +1086,9 @@ static int if_hsi_rx_cmd_handle(struct mipi_link_device *mipi_ld, u32 cmd,
 
 			if_hsi_set_wakeline(channel, 1);
 			mod_timer(&mipi_ld->hsi_acwake_down_timer, jiffies +
-						HSI_ACWAKE_DOWN_TIMEOUT);
+						mipi_ld->acwake_hold);
 			pr_debug("[MIPI-HSI] mod_timer done(%d)\n",
-						HSI_ACWAKE_DOWN_TIMEOUT);
+						mipi_ld->acwake_hold);
 
 			ret = if_hsi_send_command(mipi_ld, HSI_LL_MSG_ACK, ch,
 						param);
@@ -1027,7 +1103,7 @@ static int if_hsi_rx_cmd_handle(struct mipi_link_device *mipi_ld, u32 cmd,
 			if (param % 4)
 				param += (4 - (param % 4));
 			channel->rx_count = param;
-			ret = hsi_read(channel->dev, channel->rx_data,
+			ret = hsi_read(channel->dev, if_hsi_rx_buf(channel),
 						channel->rx_count / 4);
 			if (ret) {
 				pr_err("[MIPI-HSI] hsi_read fail : %d\n", ret);
@@ -1065,7 +1141,7 @@ static int if_hsi_rx_cmd_handle(struct mipi_link_device *mipi_ld, u32 cmd,
 				if (param % 4)
 					param += (4 - (param % 4));
 				channel->rx_count = param;
-				hsi_read(channel->dev, channel->rx_data,
+				hsi_read(channel->dev, if_hsi_rx_buf(channel),
 						channel->rx_count / 4);
 				pr_err("[MIPI-HSI] read again with new len\n");
 			}
@@ -1114,7 +1190,7 @@ static int if_hsi_rx_cmd_handle(struct mipi_link_device *mipi_ld, u32 cmd,
 			pr_debug("[MIPI-HSI] got close\n");
 
 			mod_timer(&mipi_ld->hsi_acwake_down_timer, jiffies +
-					HSI_ACWAKE_DOWN_TIMEOUT);
+					mipi_ld->acwake_hold);
 			channel->send_step = STEP_IDLE;
 			up(&channel->close_conn_done_sem);
 			return 0;
@@ -1170,9 +1246,9 @@ static int if_hsi_protocol_send(struct mipi_link_device *mipi_ld, int ch,
 
 	if_hsi_set_wakeline(channel, 1);
 	mod_timer(&mipi_ld->hsi_acwake_down_timer, jiffies +
-					HSI_ACWAKE_DOWN_TIMEOUT);
+					mipi_ld->acwake_hold);
 	pr_debug("[MIPI-HSI] mod_timer done(%d)\n",
-				HSI_ACWAKE_DOWN_TIMEOUT);
+				mipi_ld->acwake_hold);
 
 retry_send:
 
@@ -1358,7 +1434,7 @@ static void if_hsi_write_done(struct hsi_device *dev, unsigned int size)
 			(mipi_ld->ld.com_state == COM_ONLINE ||
 			mipi_ld->ld.com_state == COM_HANDSHAKE)) {
 		mod_timer(&mipi_ld->hsi_acwake_down_timer, jiffies +
-					HSI_ACWAKE_DOWN_TIMEOUT);
+					mipi_ld->acwake_hold);
 		mipi_ld->hsi_channles[
 		(*channel->tx_data & 0x0F000000) >> 24].recv_step = STEP_IDLE;
 	}
@@ -1390,9 +1466,17 @@ static void if_hsi_read_done(struct hsi_device *dev, unsigned int size)
 	struct if_hsi_channel *channel = &mipi_ld->hsi_channles[dev->n_ch];
 	struct io_device *iod;
 	enum dev_format format_type = 0;
+	struct sk_buff *skb = NULL;
+	u32 *rx_data = channel->rx_data;
+
+	if (channel->rx_in_skb) {
+		skb = channel->rx_skb;
+		rx_data = (u32 *)skb->data;
+		channel->rx_skb = NULL;
+		channel->rx_in_skb = false;
+	}
 
-	pr_debug("[MIPI-HSI] got read data : 0x%x(%d)\n",
-				*(u32 *)channel->rx_data, size);
+	pr_debug("[MIPI-HSI] got read data : 0x%x(%d)\n", *rx_data, size);
 
 	spin_lock_irqsave(&channel->rx_state_lock, flags);
 	channel->rx_state &= ~HSI_CHANNEL_RX_STATE_READING;
@@ -1555,19 +1639,32 @@ static void if_hsi_read_done(struct hsi_device *dev, unsigned int size)
 			channel->recv_step = STEP_RX;
 
 			pr_debug("[MIPI-HSI] RECV DATA : %08x(%d)-%d\n",
-				*channel->rx_data, channel->packet_size,
+				*rx_data, channel->packet_size,
 					iod->format);
 
 			pr_debug("%08x %08x %08x %08x %08x %08x %08x %08x\n",
-			*channel->rx_data, *(channel->rx_data + 1),
-			*(channel->rx_data + 2), *(channel->rx_data + 3),
-			*(channel->rx_data + 4), *(channel->rx_data + 5),
-			*(channel->rx_data + 6), *(channel->rx_data + 7));
-
-			ret = iod->recv(iod, (char *)channel->rx_data,
+			*rx_data, *(rx_data + 1),
+			*(rx_data + 2), *(rx_data + 3),
+			*(rx_data + 4), *(rx_data + 5),
+			*(rx_data + 6), *(rx_data + 7));
+
+			channel->rx_bulks++;
+			channel->rx_bytes += channel->packet_size;
+			if (skb) {
+				skb_put(skb, channel->packet_size);
+				channel->rx_in_place++;
+				ret = iod->recv_skb(iod, skb);
+				skb = NULL;
+				/* post the next one before the modem asks */
+				channel->rx_skb = alloc_skb(MIPI_RX_SKB_SIZE,
+							GFP_ATOMIC);
+			} else {
+				ret = iod->recv(iod, (char *)rx_data,
 						channel->packet_size);
+			}
 			if (ret < 0) {
 				pr_err("[MIPI-HSI] recv call fail : %d\n", ret);
+				channel->rx_drops++;
 
 				ch = channel->channel_id;
 				param = 0;
@@ -1577,9 +1674,11 @@ static void if_hsi_read_done(struct hsi_device *dev, unsigned int size)
 					pr_err("[MIPI-HSI] send_cmd fail=%d\n",
 						ret);
 
-				print_hex_dump_bytes("[HSI]",
-					DUMP_PREFIX_OFFSET,
-					channel->rx_data, channel->packet_size);
+				/* a bulk read in place is gone with its skb */
+				if (rx_data == channel->rx_data)
+					print_hex_dump_bytes("[HSI]",
+						DUMP_PREFIX_OFFSET,
+						rx_data, channel->packet_size);
 
 				/* to clean the all wrong packet */
 				channel->packet_size = 0;
@@ -1597,6 +1696,10 @@ static void if_hsi_read_done(struct hsi_device *dev, unsigned int size)
 			return;
 		}
 	}
+
+	/* nobody to give it to, post it again */
+	if (skb)
+		channel->rx_skb = skb;
 }
 
 static void if_hsi_port_event(struct hsi_device *dev, unsigned int event,
@@ -1733,6 +1836,10 @@ static int if_hsi_init(struct link_device *ld)
 
 	setup_timer(&mipi_ld->hsi_acwake_down_timer, if_hsi_acwake_down_func,
 				(unsigned long)mipi_ld);
+	mipi_ld->acwake_hold = HSI_ACWAKE_DOWN_TIMEOUT;
+	hrtimer_init(&mipi_ld->tx_aggr_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	mipi_ld->tx_aggr_timer.function = mipi_hsi_tx_aggr_func;
 
 	/* TODO - allocate rx buff */
 	mipi_ld->hsi_channles[HSI_CONTROL_CHANNEL].rx_data =
@@ -1777,6 +1884,87 @@ static int if_hsi_init(struct link_device *ld)
 	return 0;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int mipi_hsi_rx_show(struct seq_file *s, void *unused)
+{
+	struct mipi_link_device *mipi_ld = s->private;
+	struct if_hsi_channel *channel;
+	unsigned long now = jiffies;
+	unsigned long bytes, ms;
+	int i;
+
+	seq_printf(s, "ch     bulks      bytes   in place      drops   kB/s\n");
+	for (i = 0; i < HSI_NUM_OF_USE_CHANNELS; i++) {
+		channel = &mipi_ld->hsi_channles[i];
+
+		/* throughput since the last time anybody looked */
+		bytes = channel->rx_bytes - channel->rx_last_bytes;
+		ms = jiffies_to_msecs(now - channel->rx_last_jiffies);
+		channel->rx_last_bytes = channel->rx_bytes;
+		channel->rx_last_jiffies = now;
+
+		seq_printf(s, "%2d %10lu %10lu %10lu %10lu %6lu\n", i,
+			   channel->rx_bulks, channel->rx_bytes,
+			   channel->rx_in_place, channel->rx_drops,
+			   ms ? bytes / ms : 0);
+	}
+	return 0;
+}
+
+static int mipi_hsi_rx_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mipi_hsi_rx_show, inode->i_private);
+}
+
+static const struct file_operations mipi_hsi_rx_fops = {
+	.open		= mipi_hsi_rx_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int mipi_hsi_tx_show(struct seq_file *s, void *unused)
+{
+	struct mipi_link_device *mipi_ld = s->private;
+	unsigned long bulks = mipi_ld->tx_bulks;
+
+	seq_printf(s, "raw transfers: %lu\n", bulks);
+	seq_printf(s, "raw frames: %lu, %lu.%02lu per transfer, max %u\n",
+		   mipi_ld->tx_frames,
+		   bulks ? mipi_ld->tx_frames / bulks : 0,
+		   bulks ? mipi_ld->tx_frames * 100 / bulks % 100 : 0,
+		   mipi_ld->tx_max_frames);
+	seq_printf(s, "acwake: %lu up, %lu down, hold %u ms\n",
+		   mipi_ld->acwake_ups, mipi_ld->acwake_downs,
+		   jiffies_to_msecs(mipi_ld->acwake_hold));
+	return 0;
+}
+
+static int mipi_hsi_tx_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mipi_hsi_tx_show, inode->i_private);
+}
+
+static const struct file_operations mipi_hsi_tx_fops = {
+	.open		= mipi_hsi_tx_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void mipi_hsi_init_debugfs(struct mipi_link_device *mipi_ld)
+{
+	mipi_ld->debugfs = debugfs_create_file("mipi_hsi_rx", 0444, NULL,
+					       mipi_ld, &mipi_hsi_rx_fops);
+	mipi_ld->debugfs_tx = debugfs_create_file("mipi_hsi_tx", 0444, NULL,
+					       mipi_ld, &mipi_hsi_tx_fops);
+}
+#else
+static inline void mipi_hsi_init_debugfs(struct mipi_link_device *mipi_ld)
+{
+}
+#endif
+
 struct link_device *mipi_create_link_device(struct platform_device *pdev)
 {
 	int ret;
@@ -1829,6 +2017,7 @@ struct link_device *mipi_create_link_device(struct platform_device *pdev)
 	if (ret)
 		return NULL;
 
+	mipi_hsi_init_debugfs(mipi_ld);
 	return ld;
 }
 
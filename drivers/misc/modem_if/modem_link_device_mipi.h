@@ -30,6 +30,7 @@
 #define HSI_ACK_DONE_TIMEOUT	(HZ / 2)
 #define HSI_CLOSE_CONN_DONE_TIMEOUT	(HZ / 10)
 #define HSI_ACWAKE_DOWN_TIMEOUT	(HZ / 2)
+#define HSI_ACWAKE_HOLD_MAX	(2 * HZ)
 
 #define HSI_CONTROL_CHANNEL	0
 #define HSI_FLASHLESS_CHANNEL	0
@@ -46,6 +47,11 @@
 #define DUMP_ERR_INFO_SIZE	39 /* 150 bytes + 4 length , word unit */
 
 #define MIPI_BULK_TX_SIZE	(8 * 1024)
+/* how long raw tx frames may wait for more to share their transfer */
+#define MIPI_TX_AGGR_US		2000
+#define MIPI_TX_AGGR_FRAMES	16
+/* pre-posted RAW channel rx skbs, bigger bulks go to rx_data */
+#define MIPI_RX_SKB_SIZE	SKB_WITH_OVERHEAD(16 * 1024)
 
 enum {
 	HSI_LL_MSG_BREAK, /* 0x0 */
@@ -118,6 +124,17 @@ struct if_hsi_channel {
 	struct semaphore close_conn_done_sem;
 
 	unsigned int opened;
+
+	/* skb the next RAW bulk is read into, and whether this one is */
+	struct sk_buff *rx_skb;
+	bool rx_in_skb;
+
+	unsigned long rx_bulks;
+	unsigned long rx_bytes;
+	unsigned long rx_in_place;
+	unsigned long rx_drops;
+	unsigned long rx_last_bytes;
+	unsigned long rx_last_jiffies;
 };
 
 struct if_hsi_command {
@@ -139,6 +156,17 @@ struct mipi_link_device {
 
 	struct wake_lock wlock;
 	struct timer_list hsi_acwake_down_timer;
+	/* ACWAKE is held this long after the last transfer, longer while
+	 * the modem link keeps being woken up right after going down */
+	unsigned int acwake_hold;
+	unsigned long acwake_down_at;
+	unsigned long acwake_ups;
+	unsigned long acwake_downs;
+
+	struct hrtimer tx_aggr_timer;
+	unsigned long tx_bulks;
+	unsigned long tx_frames;
+	unsigned int tx_max_frames;
 
 	/* maybe -list of io devices for the link device to use
 	 * to find where to send incoming packets to */
@@ -146,6 +174,9 @@ struct mipi_link_device {
 
 	void *bulk_tx_buf;
 	struct sk_buff_head bulk_txq;
+
+	struct dentry *debugfs;
+	struct dentry *debugfs_tx;
 };
 /* converts from struct link_device* to struct xxx_link_device* */
 #define to_mipi_link_device(linkdev) \
@@ -21,6 +21,8 @@
 #include <linux/poll.h>
 #include <linux/gpio.h>
 #include <linux/if_arp.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/platform_data/modem.h>
 #include "modem_prj.h"
@@ -246,8 +248,16 @@ usb_change_modem_state(struct usb_link_device *usb_ld, enum modem_state state)
 	}
 }
 
+/*
+ * Completions on one endpoint come back in order, so when more raw
+ * packets are already queued the urb for this one need not interrupt:
+ * the ehci reports it along with the last urb of the burst, which
+ * always asks for its irq.  A burst cut short by an error is still
+ * reaped by the ehci io watchdog.
+ */
 static int usb_tx_urb_with_skb(struct usb_link_device *usb_ld,
-		struct sk_buff *skb, struct if_usb_devdata *pipe_data)
+		struct sk_buff *skb, struct if_usb_devdata *pipe_data,
+		bool more)
 {
 	int ret, cnt = 0;
 	struct urb *urb;
@@ -304,12 +314,22 @@ static int usb_tx_urb_with_skb(struct usb_link_device *usb_ld,
 	}
 
 	urb->transfer_flags = URB_ZERO_PACKET;
+	if (more && ++usb_ld->tx_batch < TX_BATCH_MAX) {
+		urb->transfer_flags |= URB_NO_INTERRUPT;
+	} else {
+		usb_ld->tx_batch = 0;
+		usb_ld->tx_irq_urbs++;
+	}
+	usb_ld->tx_urbs++;
+	usb_ld->tx_bytes += skb->len;
 	usb_fill_bulk_urb(urb, usbdev, pipe_data->tx_pipe, skb->data,
 			skb->len, usb_tx_complete, (void *)skb);
 
 	spin_lock_irqsave(&usb_ld->lock, flags);
 	if (atomic_read(&usb_ld->suspend_count)) {
-		/* transmission will be done in resume */
+		/* transmission will be done in resume, unbatched */
+		urb->transfer_flags &= ~URB_NO_INTERRUPT;
+		usb_ld->tx_batch = 0;
 		usb_anchor_urb(urb, &usb_ld->deferred);
 		usb_put_urb(urb);
 		pr_debug("%s: anchor urb (0x%p)\n", __func__, urb);
@@ -359,7 +379,8 @@ static void usb_tx_work(struct work_struct *work)
 				continue;
 			}
 
-			ret = usb_tx_urb_with_skb(usb_ld, skb, pipe_data);
+			ret = usb_tx_urb_with_skb(usb_ld, skb, pipe_data,
+					false);
 			if (ret < 0) {
 				pr_err("%s usb_tx_urb_with_skb for iod(%d), ret(%d)\n",
 						__func__, iod->format, ret);
@@ -371,10 +392,12 @@ static void usb_tx_work(struct work_struct *work)
 		skb = skb_dequeue(&ld->sk_raw_tx_q);
 		if (skb) {
 			pipe_data = &usb_ld->devdata[IF_USB_RAW_EP];
-			ret = usb_tx_urb_with_skb(usb_ld, skb, pipe_data);
+			ret = usb_tx_urb_with_skb(usb_ld, skb, pipe_data,
+					!skb_queue_empty(&ld->sk_raw_tx_q));
 			if (ret < 0) {
 				pr_err("%s usb_tx_urb_with_skb for raw, ret(%d)\n",
 						__func__, ret);
+				usb_ld->tx_batch = 0;
 				skb_queue_head(&ld->sk_raw_tx_q, skb);
 				return;
 			}
@@ -741,6 +764,43 @@ static irqreturn_t usb_resume_irq(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int usb_tx_stats_show(struct seq_file *s, void *unused)
+{
+	struct usb_link_device *usb_ld = s->private;
+	unsigned long urbs = usb_ld->tx_urbs;
+	unsigned long irqs = usb_ld->tx_irq_urbs;
+
+	seq_printf(s, "tx urbs: %lu, %llu bytes\n", urbs, usb_ld->tx_bytes);
+	seq_printf(s, "tx urbs asking for an irq: %lu, %lu.%02lu urbs per irq\n",
+		   irqs, irqs ? urbs / irqs : 0,
+		   irqs ? urbs * 100 / irqs % 100 : 0);
+	return 0;
+}
+
+static int usb_tx_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, usb_tx_stats_show, inode->i_private);
+}
+
+static const struct file_operations usb_tx_stats_fops = {
+	.open		= usb_tx_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void usb_init_debugfs(struct usb_link_device *usb_ld)
+{
+	usb_ld->debugfs = debugfs_create_file("modem_usb_tx", 0444, NULL,
+					      usb_ld, &usb_tx_stats_fops);
+}
+#else
+static inline void usb_init_debugfs(struct usb_link_device *usb_ld)
+{
+}
+#endif
+
 static int if_usb_init(struct usb_link_device *usb_ld)
 {
 	int ret;
@@ -821,6 +881,8 @@ struct link_device *usb_create_link_device(void *data)
 	if (ret)
 		return NULL;
 
+	usb_init_debugfs(usb_ld);
+
 	return ld;
 }
 
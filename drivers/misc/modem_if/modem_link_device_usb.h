@@ -30,6 +30,9 @@
 #define WAIT_ENUMURATION_TIMEOUT_JIFFIES	msecs_to_jiffies(15000)
 #define MAX_RETRY	3
 
+/* raw urbs sent back to back before one asks for its completion irq */
+#define TX_BATCH_MAX	8
+
 enum RESUME_STATUS {
 	CP_INITIATED_RESUME,
 	AP_INITIATED_RESUME,
@@ -84,6 +87,13 @@ struct usb_link_device {
 	spinlock_t		lock;
 	struct usb_anchor	deferred;
 
+	/* raw tx batching, only touched by the tx work */
+	unsigned int		tx_batch;
+	unsigned long		tx_urbs;
+	unsigned long		tx_irq_urbs;
+	unsigned long long	tx_bytes;
+	struct dentry		*debugfs;
+
 	/*COMMON LINK DEVICE*/
 	/* maybe -list of io devices for the link device to use */
 	/* to find where to send incoming packets to */
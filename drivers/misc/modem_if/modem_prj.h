@@ -123,6 +123,9 @@ struct io_device {
 
 	/* called from linkdevice when a packet arrives for this iodevice */
 	int (*recv)(struct io_device *iod, const char *data, unsigned int len);
+	/* same, for data the link device received in place into @skb,
+	 * which the io device takes over */
+	int (*recv_skb)(struct io_device *iod, struct sk_buff *skb);
 
 	/* inform the IO device that the modem is now online or offline or
 	 * crashing or whatever...
@@ -106,6 +106,13 @@ static struct omap_temp_sensor_regs temp_sensor_context;
 static struct omap_temp_sensor *temp_sensor_pm;
 #endif
 
+static bool temp_sensor_hot;
+
+bool omap_temp_sensor_hot(void)
+{
+	return temp_sensor_hot;
+}
+
 /*
  * Temperature values in milli degrees celsius ADC code values from 530 to 923
  */
@@ -431,12 +438,14 @@ static irqreturn_t omap_talert_irq_handler(int irq, void *data)
 	    & OMAP4_COLD_FLAG_MASK;
 	temp_offset = omap_temp_sensor_readl(temp_sensor, BGAP_CTRL_OFFSET);
 	if (t_hot) {
+		temp_sensor_hot = true;
 		omap_thermal_throttle();
 		schedule_delayed_work(&temp_sensor->throttle_work,
 			msecs_to_jiffies(THROTTLE_DELAY_MS));
 		temp_offset &= ~(OMAP4_MASK_HOT_MASK);
 		temp_offset |= OMAP4_MASK_COLD_MASK;
 	} else if (t_cold) {
+		temp_sensor_hot = false;
 		cancel_delayed_work_sync(&temp_sensor->throttle_work);
 		omap_thermal_unthrottle();
 		temp_offset &= ~(OMAP4_MASK_COLD_MASK);
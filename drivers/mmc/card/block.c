@@ -59,6 +59,17 @@ MODULE_ALIAS("mmc:block");
 #define INAND_CMD38_ARG_SECTRIM1 0x81
 #define INAND_CMD38_ARG_SECTRIM2 0x88
 
+#define MMC_CMD23_ARG_REL_WR	(1 << 31)
+#define MMC_CMD23_ARG_PACKED	(1 << 30)
+
+#define PACKED_CMD_VER		0x01
+#define PACKED_CMD_WR		0x02
+
+#define MMC_PACKED_NO_FAILURE	(-1)
+
+/* shorter writes are left to finish rather than stopped early */
+#define MMC_PREEMPT_MIN_BLOCKS	64
+
 static DEFINE_MUTEX(block_mutex);
 
 /*
@@ -431,14 +442,6 @@ static const struct block_device_operations mmc_bdops = {
 #endif
 };
 
-struct mmc_blk_request {
-	struct mmc_request	mrq;
-	struct mmc_command	sbc;
-	struct mmc_command	cmd;
-	struct mmc_command	stop;
-	struct mmc_data		data;
-};
-
 static inline int mmc_blk_part_switch(struct mmc_card *card,
 				      struct mmc_blk_data *md)
 {
@@ -561,6 +564,17 @@ static int get_card_status(struct mmc_card *card, u32 *status, int retries)
 #define ERR_ABORT	1
 #define ERR_CONTINUE	0
 
+enum mmc_blk_status {
+	MMC_BLK_SUCCESS = 0,
+	MMC_BLK_PARTIAL,
+	MMC_BLK_RETRY,
+	MMC_BLK_RETRY_SINGLE,
+	MMC_BLK_DATA_ERR,
+	MMC_BLK_CMD_ERR,
+	MMC_BLK_ABORT,
+	MMC_BLK_URGENT,
+};
+
 static int mmc_blk_cmd_error(struct request *req, const char *name, int error,
 	bool status_valid, u32 status)
 {
@@ -785,16 +799,20 @@ out:
 static int mmc_blk_issue_flush(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	int ret;
 
 	/*
-	 * No-op, only service this because we need REQ_FUA for reliable
-	 * writes.
+	 * Without a cache this is a no-op, only serviced because we need
+	 * REQ_FUA for reliable writes.
 	 */
+	ret = mmc_flush_cache(card);
+
 	spin_lock_irq(&md->lock);
-	__blk_end_request_all(req, 0);
+	__blk_end_request_all(req, ret ? -EIO : 0);
 	spin_unlock_irq(&md->lock);
 
-	return 1;
+	return ret ? 0 : 1;
 }
 
 /*
@@ -828,234 +846,715 @@ static inline void mmc_apply_rel_rw(struct mmc_blk_request *brq,
 	 R1_CC_ERROR |		/* Card controller error */		\
 	 R1_ERROR)		/* General/unknown error */
 
-static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *req)
+/*
+ * Check the outcome of a completed read/write request.  Runs from
+ * mmc_start_req(), before the request queued behind this one is started.
+ */
+static int mmc_blk_err_check(struct mmc_card *card,
+			     struct mmc_async_req *areq)
 {
-	struct mmc_blk_data *md = mq->data;
-	struct mmc_card *card = md->queue.card;
-	struct mmc_blk_request brq;
-	int ret = 1, disable_multi = 0, retry = 0;
+	struct mmc_queue_req *mq_mrq = container_of(areq, struct mmc_queue_req,
+						    mmc_active);
+	struct mmc_blk_request *brq = &mq_mrq->brq;
+	struct request *req = mq_mrq->req;
 
 	/*
-	 * Reliable writes are used to implement Forced Unit Access and
-	 * REQ_META accesses, and are supported only on MMCs.
+	 * sbc.error indicates a problem with the set block count
+	 * command.  No data will have been transferred.
+	 *
+	 * cmd.error indicates a problem with the r/w command.  No
+	 * data will have been transferred.
 	 *
-	 * XXX: this really needs a good explanation of why REQ_META
-	 * is treated special.
+	 * stop.error indicates a problem with the stop command.  Data
+	 * may have been transferred, or may still be transferring.
+	 */
+	if (brq->sbc.error || brq->cmd.error || brq->stop.error) {
+		switch (mmc_blk_cmd_recovery(card, req, brq)) {
+		case ERR_RETRY:
+			return MMC_BLK_RETRY;
+		case ERR_ABORT:
+			return MMC_BLK_ABORT;
+		case ERR_CONTINUE:
+			break;
+		}
+	}
+
+	/*
+	 * Check for errors relating to the execution of the
+	 * initial command - such as address errors.  No data
+	 * has been transferred.
 	 */
-	bool do_rel_wr = ((req->cmd_flags & REQ_FUA) ||
-			  (req->cmd_flags & REQ_META)) &&
+	if (brq->cmd.resp[0] & CMD_ERRORS) {
+		pr_err("%s: r/w command failed, status = %#x\n",
+		       req->rq_disk->disk_name, brq->cmd.resp[0]);
+		return MMC_BLK_ABORT;
+	}
+
+	/*
+	 * Everything else is either success, or a data error of some
+	 * kind.  If it was a write, we may have transitioned to
+	 * program mode, which we have to wait for it to complete.
+	 */
+	if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ) {
+		u32 status;
+		do {
+			int err = get_card_status(card, &status, 5);
+			if (err) {
+				printk(KERN_ERR "%s: error %d requesting status\n",
+				       req->rq_disk->disk_name, err);
+				return MMC_BLK_CMD_ERR;
+			}
+			/*
+			 * Some cards mishandle the status bits,
+			 * so make sure to check both the busy
+			 * indication and the card state.
+			 */
+		} while (!(status & R1_READY_FOR_DATA) ||
+			 (R1_CURRENT_STATE(status) == R1_STATE_PRG));
+	}
+
+	if (brq->data.error) {
+		pr_err("%s: error %d transferring data, sector %u, nr %u, cmd response %#x, card status %#x\n",
+		       req->rq_disk->disk_name, brq->data.error,
+		       (unsigned)blk_rq_pos(req),
+		       (unsigned)blk_rq_sectors(req),
+		       brq->cmd.resp[0], brq->stop.resp[0]);
+
+		if (rq_data_dir(req) == READ) {
+			if (brq->data.blocks > 1) {
+				/* Redo read one sector at a time */
+				pr_warning("%s: retrying using single block read\n",
+					   req->rq_disk->disk_name);
+				return MMC_BLK_RETRY_SINGLE;
+			}
+			return MMC_BLK_DATA_ERR;
+		} else {
+			return MMC_BLK_CMD_ERR;
+		}
+	}
+
+	/* stopped for an urgent request, the rest goes back to the queue */
+	if (areq->stopped)
+		return MMC_BLK_URGENT;
+
+	if (blk_rq_bytes(req) != brq->data.bytes_xfered)
+		return MMC_BLK_PARTIAL;
+
+	return MMC_BLK_SUCCESS;
+}
+
+/*
+ * Reliable writes are used to implement Forced Unit Access and
+ * REQ_META accesses, and are supported only on MMCs.
+ *
+ * XXX: this really needs a good explanation of why REQ_META
+ * is treated special.
+ */
+static inline bool mmc_req_rel_wr(struct request *req)
+{
+	return (req->cmd_flags & REQ_FUA) || (req->cmd_flags & REQ_META);
+}
+
+static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
+			       struct mmc_card *card,
+			       int disable_multi,
+			       struct mmc_queue *mq)
+{
+	u32 readcmd, writecmd;
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mqrq->req;
+	struct mmc_blk_data *md = mq->data;
+
+	bool do_rel_wr = mmc_req_rel_wr(req) &&
 		(rq_data_dir(req) == WRITE) &&
 		(md->flags & MMC_BLK_REL_WR);
 
-	do {
-		u32 readcmd, writecmd;
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
 
-		memset(&brq, 0, sizeof(struct mmc_blk_request));
-		brq.mrq.cmd = &brq.cmd;
-		brq.mrq.data = &brq.data;
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	brq->data.blksz = 512;
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+	brq->data.blocks = blk_rq_sectors(req);
 
-		brq.cmd.arg = blk_rq_pos(req);
-		if (!mmc_card_blockaddr(card))
-			brq.cmd.arg <<= 9;
-		brq.cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
-		brq.data.blksz = 512;
-		brq.stop.opcode = MMC_STOP_TRANSMISSION;
-		brq.stop.arg = 0;
-		brq.stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-		brq.data.blocks = blk_rq_sectors(req);
+	/*
+	 * The block layer doesn't support all sector count
+	 * restrictions, so we need to be prepared for too big
+	 * requests.
+	 */
+	if (brq->data.blocks > card->host->max_blk_count)
+		brq->data.blocks = card->host->max_blk_count;
 
-		/*
-		 * The block layer doesn't support all sector count
-		 * restrictions, so we need to be prepared for too big
-		 * requests.
-		 */
-		if (brq.data.blocks > card->host->max_blk_count)
-			brq.data.blocks = card->host->max_blk_count;
+	/*
+	 * After a read error, we redo the request one sector at a time
+	 * in order to accurately determine which sectors can be read
+	 * successfully.
+	 */
+	if (disable_multi && brq->data.blocks > 1)
+		brq->data.blocks = 1;
 
-		/*
-		 * After a read error, we redo the request one sector at a time
-		 * in order to accurately determine which sectors can be read
-		 * successfully.
+	if (brq->data.blocks > 1 || do_rel_wr) {
+		/* SPI multiblock writes terminate using a special
+		 * token, not a STOP_TRANSMISSION request.
 		 */
-		if (disable_multi && brq.data.blocks > 1)
-			brq.data.blocks = 1;
+		if (!mmc_host_is_spi(card->host) ||
+		    rq_data_dir(req) == READ)
+			brq->mrq.stop = &brq->stop;
+		readcmd = MMC_READ_MULTIPLE_BLOCK;
+		writecmd = MMC_WRITE_MULTIPLE_BLOCK;
+	} else {
+		brq->mrq.stop = NULL;
+		readcmd = MMC_READ_SINGLE_BLOCK;
+		writecmd = MMC_WRITE_BLOCK;
+	}
+	if (rq_data_dir(req) == READ) {
+		brq->cmd.opcode = readcmd;
+		brq->data.flags |= MMC_DATA_READ;
+	} else {
+		brq->cmd.opcode = writecmd;
+		brq->data.flags |= MMC_DATA_WRITE;
+	}
 
-		if (brq.data.blocks > 1 || do_rel_wr) {
-			/* SPI multiblock writes terminate using a special
-			 * token, not a STOP_TRANSMISSION request.
-			 */
-			if (!mmc_host_is_spi(card->host) ||
-			    rq_data_dir(req) == READ)
-				brq.mrq.stop = &brq.stop;
-			readcmd = MMC_READ_MULTIPLE_BLOCK;
-			writecmd = MMC_WRITE_MULTIPLE_BLOCK;
-		} else {
-			brq.mrq.stop = NULL;
-			readcmd = MMC_READ_SINGLE_BLOCK;
-			writecmd = MMC_WRITE_BLOCK;
+	if (do_rel_wr)
+		mmc_apply_rel_rw(brq, card, req);
+
+	/*
+	 * Pre-defined multi-block transfers are preferable to
+	 * open ended-ones (and necessary for reliable writes).
+	 * However, it is not sufficient to just send CMD23,
+	 * and avoid the final CMD12, as on an error condition
+	 * CMD12 (stop) needs to be sent anyway. This, coupled
+	 * with Auto-CMD23 enhancements provided by some
+	 * hosts, means that the complexity of dealing
+	 * with this is best left to the host. If CMD23 is
+	 * supported by card and host, we'll fill sbc in and let
+	 * the host deal with handling it correctly. This means
+	 * that for hosts that don't expose MMC_CAP_CMD23, no
+	 * change of behavior will be observed.
+	 *
+	 * N.B: Some MMC cards experience perf degradation.
+	 * We'll avoid using CMD23-bounded multiblock writes for
+	 * these, while retaining features like reliable writes.
+	 */
+
+	if ((md->flags & MMC_BLK_CMD23) &&
+	    mmc_op_multi(brq->cmd.opcode) &&
+	    (do_rel_wr || !(card->quirks & MMC_QUIRK_BLK_NO_CMD23))) {
+		brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+		brq->sbc.arg = brq->data.blocks |
+			(do_rel_wr ? (1 << 31) : 0);
+		brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		brq->mrq.sbc = &brq->sbc;
+	}
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	/*
+	 * Adjust the sg list so it is the same size as the
+	 * request.
+	 */
+	if (brq->data.blocks != blk_rq_sectors(req)) {
+		int i, data_size = brq->data.blocks << 9;
+		struct scatterlist *sg;
+
+		for_each_sg(brq->data.sg, sg, brq->data.sg_len, i) {
+			data_size -= sg->length;
+			if (data_size <= 0) {
+				sg->length += data_size;
+				i++;
+				break;
+			}
 		}
-		if (rq_data_dir(req) == READ) {
-			brq.cmd.opcode = readcmd;
-			brq.data.flags |= MMC_DATA_READ;
-		} else {
-			brq.cmd.opcode = writecmd;
-			brq.data.flags |= MMC_DATA_WRITE;
+		brq->data.sg_len = i;
+	}
+
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.err_check = mmc_blk_err_check;
+	/*
+	 * A long write may be stopped for an urgent request if what is
+	 * left of it can be handed back to the scheduler.  Reliable
+	 * writes are never split.
+	 */
+	mqrq->mmc_active.preemptible = rq_data_dir(req) == WRITE &&
+		!do_rel_wr && brq->data.blocks >= MMC_PREEMPT_MIN_BLOCKS &&
+		mq->queue->urgent_request_fn &&
+		blk_reinsert_req_sup(mq->queue);
+
+	mmc_queue_bounce_pre(mqrq);
+}
+
+static inline bool mmc_packed_cmd(struct mmc_queue_req *mqrq)
+{
+	return mqrq->packed && mqrq->packed->nr_entries;
+}
+
+static void mmc_blk_clear_packed(struct mmc_packed *packed)
+{
+	INIT_LIST_HEAD(&packed->list);
+	packed->blocks = 0;
+	packed->nr_entries = 0;
+	packed->retries = 0;
+	packed->idx_failure = MMC_PACKED_NO_FAILURE;
+}
+
+static void mmc_blk_packed_stat(struct mmc_card *card, int reason, u8 reqs)
+{
+	struct mmc_wr_pack_stats *stats = &card->wr_pack_stats;
+
+	spin_lock_irq(&stats->lock);
+	stats->packs[reqs]++;
+	stats->stop_reason[reason]++;
+	spin_unlock_irq(&stats->lock);
+}
+
+/*
+ * Reliable writes can only share a packed command on cards doing
+ * enhanced reliable writes, legacy ones have alignment constraints.
+ */
+static inline bool mmc_blk_rel_wr_packable(struct mmc_blk_data *md,
+					   struct request *req)
+{
+	struct mmc_card *card = md->queue.card;
+
+	return !(mmc_req_rel_wr(req) && (md->flags & MMC_BLK_REL_WR)) ||
+		(card->ext_csd.rel_param & EXT_CSD_WR_REL_PARAM_EN);
+}
+
+/*
+ * Pull the writes queued behind req off the queue, for as long as they
+ * fit into one packed command along with it.  Returns the number of
+ * requests packed, req included, or 0 if req is to be sent on its own.
+ */
+static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_card *card = mq->card;
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = mq->mqrq_cur->packed;
+	unsigned int max_blk_count, max_phys_segs;
+	unsigned int sectors, phys_segments;
+	struct request *next;
+	int reason;
+	u8 reqs = 1;
+
+	if (!packed || card->max_packed_wr < 2 ||
+	    !(md->flags & MMC_BLK_CMD23) || rq_data_dir(req) != WRITE ||
+	    !mmc_blk_rel_wr_packable(md, req))
+		return 0;
+
+	max_blk_count = min(card->host->max_blk_count,
+			    card->host->max_req_size >> 9);
+	if (max_blk_count > 0xffff)
+		max_blk_count = 0xffff;
+	max_phys_segs = queue_max_segments(q);
+
+	/* the header takes one block and one segment */
+	sectors = blk_rq_sectors(req) + 1;
+	phys_segments = req->nr_phys_segments + 1;
+
+	do {
+		if (reqs >= card->max_packed_wr) {
+			reason = MMC_PACKED_STOP_MAX_ENTRIES;
+			break;
 		}
 
-		if (do_rel_wr)
-			mmc_apply_rel_rw(&brq, card, req);
+		spin_lock_irq(q->queue_lock);
+		next = blk_fetch_request(q);
+		spin_unlock_irq(q->queue_lock);
+		if (!next) {
+			reason = MMC_PACKED_STOP_EMPTY_QUEUE;
+			break;
+		}
 
-		/*
-		 * Pre-defined multi-block transfers are preferable to
-		 * open ended-ones (and necessary for reliable writes).
-		 * However, it is not sufficient to just send CMD23,
-		 * and avoid the final CMD12, as on an error condition
-		 * CMD12 (stop) needs to be sent anyway. This, coupled
-		 * with Auto-CMD23 enhancements provided by some
-		 * hosts, means that the complexity of dealing
-		 * with this is best left to the host. If CMD23 is
-		 * supported by card and host, we'll fill sbc in and let
-		 * the host deal with handling it correctly. This means
-		 * that for hosts that don't expose MMC_CAP_CMD23, no
-		 * change of behavior will be observed.
-		 *
-		 * N.B: Some MMC cards experience perf degradation.
-		 * We'll avoid using CMD23-bounded multiblock writes for
-		 * these, while retaining features like reliable writes.
-		 */
+		if (next->cmd_flags & (REQ_DISCARD | REQ_FLUSH))
+			reason = MMC_PACKED_STOP_FLUSH_DISCARD;
+		else if (rq_data_dir(next) != WRITE)
+			reason = MMC_PACKED_STOP_DIRECTION;
+		else if (!mmc_blk_rel_wr_packable(md, next))
+			reason = MMC_PACKED_STOP_REL_WRITE;
+		else if (sectors + blk_rq_sectors(next) > max_blk_count)
+			reason = MMC_PACKED_STOP_SECTORS;
+		else if (phys_segments + next->nr_phys_segments > max_phys_segs)
+			reason = MMC_PACKED_STOP_SEGMENTS;
+		else
+			reason = -1;
 
-		if ((md->flags & MMC_BLK_CMD23) &&
-		    mmc_op_multi(brq.cmd.opcode) &&
-		    (do_rel_wr || !(card->quirks & MMC_QUIRK_BLK_NO_CMD23))) {
-			brq.sbc.opcode = MMC_SET_BLOCK_COUNT;
-			brq.sbc.arg = brq.data.blocks |
-				(do_rel_wr ? (1 << 31) : 0);
-			brq.sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
-			brq.mrq.sbc = &brq.sbc;
+		if (reason >= 0) {
+			spin_lock_irq(q->queue_lock);
+			blk_requeue_request(q, next);
+			spin_unlock_irq(q->queue_lock);
+			break;
 		}
 
-		mmc_set_data_timeout(&brq.data, card);
+		if (reqs == 1)
+			list_add_tail(&req->queuelist, &packed->list);
+		list_add_tail(&next->queuelist, &packed->list);
+		sectors += blk_rq_sectors(next);
+		phys_segments += next->nr_phys_segments;
+		reqs++;
+	} while (1);
 
-		brq.data.sg = mq->sg;
-		brq.data.sg_len = mmc_queue_map_sg(mq);
+	mmc_blk_packed_stat(card, reason, reqs);
 
-		/*
-		 * Adjust the sg list so it is the same size as the
-		 * request.
-		 */
-		if (brq.data.blocks != blk_rq_sectors(req)) {
-			int i, data_size = brq.data.blocks << 9;
-			struct scatterlist *sg;
-
-			for_each_sg(brq.data.sg, sg, brq.data.sg_len, i) {
-				data_size -= sg->length;
-				if (data_size <= 0) {
-					sg->length += data_size;
-					i++;
-					break;
-				}
-			}
-			brq.data.sg_len = i;
+	if (reqs < 2)
+		return 0;
+
+	packed->nr_entries = reqs;
+	packed->retries = reqs;
+	return reqs;
+}
+
+/*
+ * Check a packed write.  The card points out the first request it
+ * failed to write through an exception event, those before it made it.
+ */
+static int mmc_blk_packed_err_check(struct mmc_card *card,
+				    struct mmc_async_req *areq)
+{
+	struct mmc_queue_req *mq_rq = container_of(areq, struct mmc_queue_req,
+						   mmc_active);
+	struct mmc_blk_request *brq = &mq_rq->brq;
+	struct request *req = mq_rq->req;
+	struct mmc_packed *packed = mq_rq->packed;
+	int err, check;
+	u32 status;
+	u8 *ext_csd;
+
+	packed->retries--;
+	check = mmc_blk_err_check(card, areq);
+	/* the header is not part of any request */
+	if (check == MMC_BLK_PARTIAL &&
+	    brq->data.bytes_xfered == brq->data.blocks << 9)
+		check = MMC_BLK_SUCCESS;
+
+	err = get_card_status(card, &status, 0);
+	if (err) {
+		pr_err("%s: error %d sending status command\n",
+		       req->rq_disk->disk_name, err);
+		check = MMC_BLK_ABORT;
+		goto out;
+	}
+
+	if (!(status & R1_EXCEPTION_EVENT) || !card->ext_csd.packed_event_en)
+		goto out;
+
+	ext_csd = kzalloc(512, GFP_KERNEL);
+	if (!ext_csd) {
+		check = MMC_BLK_ABORT;
+		goto out;
+	}
+
+	err = mmc_send_ext_csd(card, ext_csd);
+	if (err) {
+		pr_err("%s: error %d sending ext_csd\n",
+		       req->rq_disk->disk_name, err);
+		check = MMC_BLK_ABORT;
+	} else if ((ext_csd[EXT_CSD_EXP_EVENTS_STATUS] &
+		    EXT_CSD_PACKED_FAILURE) &&
+		   (ext_csd[EXT_CSD_PACKED_CMD_STATUS] &
+		    EXT_CSD_PACKED_GENERIC_ERROR)) {
+		int idx = ext_csd[EXT_CSD_PACKED_FAILURE_INDEX] - 1;
+
+		if ((ext_csd[EXT_CSD_PACKED_CMD_STATUS] &
+		     EXT_CSD_PACKED_INDEXED_ERROR) &&
+		    idx >= 0 && idx < packed->nr_entries) {
+			packed->idx_failure = idx;
+			check = MMC_BLK_PARTIAL;
+		} else {
+			/* no telling which one failed, send them all again */
+			check = MMC_BLK_RETRY;
 		}
+		pr_err("%s: packed write failed, nr %u, sectors %u, failure index %d\n",
+		       req->rq_disk->disk_name, packed->nr_entries,
+		       packed->blocks, packed->idx_failure);
+	}
+	kfree(ext_csd);
+
+out:
+	if (check != MMC_BLK_SUCCESS) {
+		spin_lock_irq(&card->wr_pack_stats.lock);
+		card->wr_pack_stats.failures++;
+		spin_unlock_irq(&card->wr_pack_stats.lock);
+	}
+	return check;
+}
+
+static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
+					struct mmc_card *card,
+					struct mmc_queue *mq)
+{
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = mqrq->packed;
+	struct request *prq;
+	__le32 *hdr = packed->cmd_hdr;
+	bool do_rel_wr = false;
+	int i = 1;
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	memset(packed->cmd_hdr, 0, sizeof(packed->cmd_hdr));
+	packed->blocks = 0;
+	packed->idx_failure = MMC_PACKED_NO_FAILURE;
+
+	hdr[0] = cpu_to_le32((packed->nr_entries << 16) |
+			     (PACKED_CMD_WR << 8) | PACKED_CMD_VER);
+
+	/* a CMD23 and a CMD25 argument for each request */
+	list_for_each_entry(prq, &packed->list, queuelist) {
+		bool rel_wr = mmc_req_rel_wr(prq) &&
+			(md->flags & MMC_BLK_REL_WR);
+		u32 addr = blk_rq_pos(prq);
 
-		mmc_queue_bounce_pre(mq);
+		if (!mmc_card_blockaddr(card))
+			addr <<= 9;
+		hdr[i * 2] = cpu_to_le32(blk_rq_sectors(prq) |
+					 (rel_wr ? MMC_CMD23_ARG_REL_WR : 0));
+		hdr[i * 2 + 1] = cpu_to_le32(addr);
+		packed->blocks += blk_rq_sectors(prq);
+		do_rel_wr |= rel_wr;
+		i++;
+	}
 
-		mmc_wait_for_req(card->host, &brq.mrq);
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+	brq->mrq.sbc = &brq->sbc;
+	brq->mrq.stop = &brq->stop;
 
-		mmc_queue_bounce_post(mq);
+	brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+	brq->sbc.arg = MMC_CMD23_ARG_PACKED | (packed->blocks + 1) |
+		(do_rel_wr ? MMC_CMD23_ARG_REL_WR : 0);
+	brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
 
-		/*
-		 * sbc.error indicates a problem with the set block count
-		 * command.  No data will have been transferred.
-		 *
-		 * cmd.error indicates a problem with the r/w command.  No
-		 * data will have been transferred.
-		 *
-		 * stop.error indicates a problem with the stop command.  Data
-		 * may have been transferred, or may still be transferring.
-		 */
-		if (brq.sbc.error || brq.cmd.error || brq.stop.error) {
-			switch (mmc_blk_cmd_recovery(card, req, &brq)) {
-			case ERR_RETRY:
-				if (retry++ < 5)
-					continue;
-			case ERR_ABORT:
-				goto cmd_abort;
-			case ERR_CONTINUE:
-				break;
+	brq->cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	brq->cmd.arg = blk_rq_pos(mqrq->req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	brq->data.blksz = 512;
+	brq->data.blocks = packed->blocks + 1;
+	brq->data.flags |= MMC_DATA_WRITE;
+
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.err_check = mmc_blk_packed_err_check;
+	mqrq->mmc_active.preemptible = false;
+}
+
+/*
+ * Complete the requests of a packed write up to the one that failed.
+ * Returns 1 if some are left to retry, mqrq->req then points at the
+ * first of them.
+ */
+static int mmc_blk_end_packed_req(struct mmc_queue *mq,
+				  struct mmc_queue_req *mqrq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = mqrq->packed;
+	struct request *prq;
+	int idx = packed->idx_failure, i = 0;
+
+	spin_lock_irq(&md->lock);
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.next);
+		if (i == idx) {
+			packed->nr_entries -= idx;
+			mqrq->req = prq;
+			/* just the one left, retry it as a normal write */
+			if (packed->nr_entries == 1) {
+				list_del_init(&prq->queuelist);
+				mmc_blk_clear_packed(packed);
 			}
+			spin_unlock_irq(&md->lock);
+			return 1;
 		}
+		list_del_init(&prq->queuelist);
+		__blk_end_request_all(prq, 0);
+		i++;
+	}
+	spin_unlock_irq(&md->lock);
 
-		/*
-		 * Check for errors relating to the execution of the
-		 * initial command - such as address errors.  No data
-		 * has been transferred.
-		 */
-		if (brq.cmd.resp[0] & CMD_ERRORS) {
-			pr_err("%s: r/w command failed, status = %#x\n",
-				req->rq_disk->disk_name, brq.cmd.resp[0]);
-			goto cmd_abort;
-		}
+	mmc_blk_clear_packed(packed);
+	return 0;
+}
 
-		/*
-		 * Everything else is either success, or a data error of some
-		 * kind.  If it was a write, we may have transitioned to
-		 * program mode, which we have to wait for it to complete.
-		 */
-		if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ) {
-			u32 status;
-			do {
-				int err = get_card_status(card, &status, 5);
-				if (err) {
-					printk(KERN_ERR "%s: error %d requesting status\n",
-					       req->rq_disk->disk_name, err);
-					goto cmd_err;
-				}
-				/*
-				 * Some cards mishandle the status bits,
-				 * so make sure to check both the busy
-				 * indication and the card state.
-				 */
-			} while (!(status & R1_READY_FOR_DATA) ||
-				 (R1_CURRENT_STATE(status) == R1_STATE_PRG));
-		}
+static void mmc_blk_abort_packed_req(struct mmc_queue *mq,
+				     struct mmc_queue_req *mqrq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = mqrq->packed;
+	struct request *prq;
+
+	spin_lock_irq(&md->lock);
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.next);
+		list_del_init(&prq->queuelist);
+		__blk_end_request_all(prq, -EIO);
+	}
+	spin_unlock_irq(&md->lock);
 
-		if (brq.data.error) {
-			pr_err("%s: error %d transferring data, sector %u, nr %u, cmd response %#x, card status %#x\n",
-				req->rq_disk->disk_name, brq.data.error,
-				(unsigned)blk_rq_pos(req),
-				(unsigned)blk_rq_sectors(req),
-				brq.cmd.resp[0], brq.stop.resp[0]);
-
-			if (rq_data_dir(req) == READ) {
-				if (brq.data.blocks > 1) {
-					/* Redo read one sector at a time */
-					pr_warning("%s: retrying using single block read\n",
-						req->rq_disk->disk_name);
-					disable_multi = 1;
-					continue;
-				}
+	mmc_blk_clear_packed(packed);
+}
 
+/* put back all but the first request of a pack that was never started */
+static void mmc_blk_revert_packed_req(struct mmc_queue *mq,
+				      struct mmc_queue_req *mqrq)
+{
+	struct mmc_packed *packed = mqrq->packed;
+	struct request_queue *q = mq->queue;
+	struct request *prq;
+
+	spin_lock_irq(q->queue_lock);
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.prev);
+		list_del_init(&prq->queuelist);
+		if (prq != mqrq->req)
+			blk_requeue_request(q, prq);
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	mmc_blk_clear_packed(packed);
+}
+
+/* called with the queue lock held */
+static void mmc_blk_reinsert_req(struct mmc_queue *mq, struct request *req)
+{
+	if (blk_reinsert_request(mq->queue, req))
+		blk_requeue_request(mq->queue, req);
+}
+
+/*
+ * Start rqc, if any, and complete the request issued before it.  The
+ * new request is prepared and mapped while the previous one is still
+ * being transferred; it is only started once the previous one has
+ * completed without error, otherwise the remainder of the previous
+ * request is retried first.
+ */
+static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_blk_request *brq = &mq->mqrq_cur->brq;
+	int ret = 1, disable_multi = 0, retry = 0;
+	enum mmc_blk_status status;
+	struct mmc_queue_req *mq_rq;
+	struct request *req;
+	struct mmc_async_req *areq;
+
+	if (!rqc && !mq->mqrq_prev->req)
+		return 0;
+
+	if (rqc)
+		mmc_blk_prep_packed_list(mq, rqc);
+
+	do {
+		if (rqc) {
+			if (mmc_packed_cmd(mq->mqrq_cur))
+				mmc_blk_packed_hdr_wrq_prep(mq->mqrq_cur,
+							    card, mq);
+			else
+				mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
+			areq = &mq->mqrq_cur->mmc_active;
+		} else
+			areq = NULL;
+		areq = mmc_start_req(card->host, areq, (int *) &status);
+		if (!areq)
+			return 0;
+
+		mq_rq = container_of(areq, struct mmc_queue_req, mmc_active);
+		brq = &mq_rq->brq;
+		req = mq_rq->req;
+		mmc_queue_bounce_post(mq_rq);
+
+		switch (status) {
+		case MMC_BLK_SUCCESS:
+		case MMC_BLK_PARTIAL:
+			if (mmc_packed_cmd(mq_rq)) {
+				ret = mmc_blk_end_packed_req(mq, mq_rq);
+				break;
+			}
+			/*
+			 * A block was successfully transferred.
+			 */
+			spin_lock_irq(&md->lock);
+			ret = __blk_end_request(req, 0,
+						brq->data.bytes_xfered);
+			spin_unlock_irq(&md->lock);
+			if (status == MMC_BLK_SUCCESS && ret) {
 				/*
-				 * After an error, we redo I/O one sector at a
-				 * time, so we only reach here after trying to
-				 * read a single sector.
+				 * All of the data was transferred without
+				 * an error, yet the request is not done.
+				 * rqc has been started already.
 				 */
-				spin_lock_irq(&md->lock);
-				ret = __blk_end_request(req, -EIO, brq.data.blksz);
-				spin_unlock_irq(&md->lock);
-				continue;
-			} else {
-				goto cmd_err;
+				pr_err("%s: BUG rq_tot %d d_xfer %d\n",
+				       req->rq_disk->disk_name,
+				       blk_rq_bytes(req),
+				       brq->data.bytes_xfered);
+				rqc = NULL;
+				goto cmd_abort;
 			}
+			break;
+		case MMC_BLK_CMD_ERR:
+			/* a packed write is sent again as a whole */
+			if (mmc_packed_cmd(mq_rq))
+				break;
+			goto cmd_err;
+		case MMC_BLK_RETRY_SINGLE:
+			disable_multi = 1;
+			break;
+		case MMC_BLK_RETRY:
+			if (retry++ < 5)
+				break;
+		case MMC_BLK_ABORT:
+			goto cmd_abort;
+		case MMC_BLK_URGENT:
+			goto urgent;
+		case MMC_BLK_DATA_ERR:
+			/*
+			 * After an error, we redo I/O one sector at a
+			 * time, so we only reach here after trying to
+			 * read a single sector.
+			 */
+			spin_lock_irq(&md->lock);
+			ret = __blk_end_request(req, -EIO,
+						brq->data.blksz);
+			spin_unlock_irq(&md->lock);
+			if (!ret)
+				goto start_new_req;
+			break;
 		}
 
-		/*
-		 * A block was successfully transferred.
-		 */
-		spin_lock_irq(&md->lock);
-		ret = __blk_end_request(req, 0, brq.data.bytes_xfered);
-		spin_unlock_irq(&md->lock);
+		if (ret) {
+			/*
+			 * The request is not complete: prepare what is
+			 * left of it and send that first.
+			 */
+			if (mmc_packed_cmd(mq_rq)) {
+				if (!mq_rq->packed->retries)
+					goto cmd_abort;
+				mmc_blk_packed_hdr_wrq_prep(mq_rq, card, mq);
+			} else
+				mmc_blk_rw_rq_prep(mq_rq, card,
+						   disable_multi, mq);
+			mmc_start_req(card->host, &mq_rq->mmc_active, NULL);
+		}
 	} while (ret);
 
 	return 1;
@@ -1080,16 +1579,54 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *req)
 		}
 	} else {
 		spin_lock_irq(&md->lock);
-		ret = __blk_end_request(req, 0, brq.data.bytes_xfered);
+		ret = __blk_end_request(req, 0, brq->data.bytes_xfered);
 		spin_unlock_irq(&md->lock);
 	}
 
  cmd_abort:
+	if (mmc_packed_cmd(mq_rq)) {
+		mmc_blk_abort_packed_req(mq, mq_rq);
+	} else {
+		spin_lock_irq(&md->lock);
+		while (ret)
+			ret = __blk_end_request(req, -EIO,
+						blk_rq_cur_bytes(req));
+		spin_unlock_irq(&md->lock);
+	}
+
+ start_new_req:
+	if (rqc) {
+		/* send it on its own, the rest of its pack goes back */
+		if (mmc_packed_cmd(mq->mqrq_cur))
+			mmc_blk_revert_packed_req(mq, mq->mqrq_cur);
+		mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
+		mmc_start_req(card->host, &mq->mqrq_cur->mmc_active, NULL);
+	}
+
+	return 0;
+
+ urgent:
+	/*
+	 * Stopped for an urgent request: complete what reached the card
+	 * and hand the rest back to the scheduler, along with rqc which
+	 * was never started, so that the urgent request is fetched next.
+	 */
+	if (rqc && mmc_packed_cmd(mq->mqrq_cur))
+		mmc_blk_revert_packed_req(mq, mq->mqrq_cur);
+
 	spin_lock_irq(&md->lock);
-	while (ret)
-		ret = __blk_end_request(req, -EIO, blk_rq_cur_bytes(req));
+	if (__blk_end_request(req, 0, brq->data.bytes_xfered))
+		mmc_blk_reinsert_req(mq, req);
+	if (rqc)
+		mmc_blk_reinsert_req(mq, rqc);
 	spin_unlock_irq(&md->lock);
 
+	/* nothing is left in flight, let go of the host like for a NULL rqc */
+	if (rqc) {
+		mq->mqrq_cur->req = NULL;
+		mmc_release_host(card->host);
+	}
+
 	return 0;
 }
 
@@ -1109,26 +1646,42 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	}
 #endif
 
-	mmc_claim_host(card->host);
+	/* the host stays claimed while a request is in flight */
+	if (req && !mq->mqrq_prev->req)
+		mmc_claim_host(card->host);
+
 	ret = mmc_blk_part_switch(card, md);
 	if (ret) {
+		if (req) {
+			spin_lock_irq(&md->lock);
+			__blk_end_request_all(req, -EIO);
+			spin_unlock_irq(&md->lock);
+		}
 		ret = 0;
 		goto out;
 	}
 
-	if (req->cmd_flags & REQ_DISCARD) {
+	if (req && req->cmd_flags & REQ_DISCARD) {
+		/* complete ongoing async transfer before issuing discard */
+		if (card->host->areq)
+			mmc_blk_issue_rw_rq(mq, NULL);
 		if (req->cmd_flags & REQ_SECURE)
 			ret = mmc_blk_issue_secdiscard_rq(mq, req);
 		else
 			ret = mmc_blk_issue_discard_rq(mq, req);
-	} else if (req->cmd_flags & REQ_FLUSH) {
+	} else if (req && req->cmd_flags & REQ_FLUSH) {
+		/* complete ongoing async transfer before issuing flush */
+		if (card->host->areq)
+			mmc_blk_issue_rw_rq(mq, NULL);
 		ret = mmc_blk_issue_flush(mq, req);
 	} else {
 		ret = mmc_blk_issue_rw_rq(mq, req);
 	}
 
 out:
-	mmc_release_host(card->host);
+	/* release the host once there is nothing left in flight */
+	if (!req)
+		mmc_release_host(card->host);
 	return ret;
 }
 
@@ -1235,6 +1788,9 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 	     card->ext_csd.rel_sectors)) {
 		md->flags |= MMC_BLK_REL_WR;
 		blk_queue_flush(md->queue.queue, REQ_FLUSH | REQ_FUA);
+	} else if (mmc_card_mmc(card) && card->ext_csd.cache_size) {
+		/* FUA writes are then followed by a flush */
+		blk_queue_flush(md->queue.queue, REQ_FLUSH);
 	}
 
 	return md;
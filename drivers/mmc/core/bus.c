@@ -237,6 +237,7 @@ struct mmc_card *mmc_alloc_card(struct mmc_host *host, struct device_type *type)
 		return ERR_PTR(-ENOMEM);
 
 	card->host = host;
+	spin_lock_init(&card->wr_pack_stats.lock);
 
 	device_initialize(&card->dev);
 
@@ -186,6 +186,9 @@ mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 		mrq->cmd->data = mrq->data;
 		mrq->data->error = 0;
 		mrq->data->mrq = mrq;
+		/* it may sit in the card's cache until the next flush */
+		if ((mrq->data->flags & MMC_DATA_WRITE) && host->card)
+			host->card->cache_dirty = true;
 		if (mrq->stop) {
 			mrq->data->stop = mrq->stop;
 			mrq->stop->error = 0;
@@ -199,9 +202,154 @@ mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 
 static void mmc_wait_done(struct mmc_request *mrq)
 {
-	complete(mrq->done_data);
+	complete(&mrq->completion);
+	wake_up(&mrq->host->req_wait);
+}
+
+static void __mmc_start_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	init_completion(&mrq->completion);
+	mrq->done = mmc_wait_done;
+	mrq->host = host;
+	mmc_start_request(host, mrq);
+}
+
+static void mmc_wait_for_req_done(struct mmc_host *host,
+				  struct mmc_request *mrq)
+{
+	wait_for_completion(&mrq->completion);
+}
+
+/*
+ * Wait for a request started by mmc_start_req().  If mmc_preempt_req()
+ * is called meanwhile and the request is preemptible, the host is asked
+ * to stop it; the request still completes, with areq->stopped set.
+ */
+static void mmc_wait_for_areq_done(struct mmc_host *host,
+				   struct mmc_async_req *areq)
+{
+	struct completion *done = &areq->mrq->completion;
+
+	areq->stopped = false;
+	for (;;) {
+		wait_event(host->req_wait, completion_done(done) ||
+			   host->preempt);
+		if (completion_done(done))
+			break;
+
+		host->preempt = false;
+		if (areq->preemptible && host->ops->stop_request &&
+		    !host->ops->stop_request(host))
+			areq->stopped = true;
+	}
+	host->preempt = false;
+	wait_for_completion(done);
 }
 
+/**
+ *	mmc_preempt_req - stop the request in flight early
+ *	@host: MMC host
+ *
+ *	Ask for the request started by mmc_start_req() to be stopped, e.g.
+ *	for an urgent one waiting behind it.  Only preemptible requests on
+ *	hosts with a stop_request method are stopped, others complete as
+ *	usual.  May be called from atomic context.
+ */
+void mmc_preempt_req(struct mmc_host *host)
+{
+	struct mmc_async_req *areq = host->areq;
+
+	if (!areq || !areq->preemptible)
+		return;
+
+	host->preempt = true;
+	wake_up(&host->req_wait);
+}
+EXPORT_SYMBOL(mmc_preempt_req);
+
+/**
+ *	mmc_pre_req - prepare for a new request
+ *	@host: MMC host to prepare command
+ *	@mrq: MMC request to prepare for
+ *	@is_first_req: true if no other request is running on the host
+ *
+ *	Let the host prepare, e.g. DMA map, a request before it is
+ *	started.  This may run while another request is in flight.
+ */
+static void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq,
+		 bool is_first_req)
+{
+	if (host->ops->pre_req)
+		host->ops->pre_req(host, mrq, is_first_req);
+}
+
+/**
+ *	mmc_post_req - post process a completed request
+ *	@host: MMC host to post process command
+ *	@mrq: MMC request to post process for
+ *	@err: non zero if the request was prepared but never started
+ *
+ *	Let the host undo what mmc_pre_req() did.  This may run while
+ *	another request is in flight.
+ */
+static void mmc_post_req(struct mmc_host *host, struct mmc_request *mrq,
+			 int err)
+{
+	if (host->ops->post_req)
+		host->ops->post_req(host, mrq, err);
+}
+
+/**
+ *	mmc_start_req - start a non-blocking request
+ *	@host: MMC host to start command
+ *	@areq: async request to start, or NULL to only complete the last one
+ *	@error: returns the err_check() result of the completed request
+ *
+ *	Prepare @areq, wait for the request started before it to complete
+ *	and then start @areq without waiting for it.  Preparing the new
+ *	request overlaps with the transfer of the previous one.  If the
+ *	previous request failed @areq is not started.
+ *
+ *	Returns the completed request, or NULL without waiting if there
+ *	was none in flight.
+ */
+struct mmc_async_req *mmc_start_req(struct mmc_host *host,
+				    struct mmc_async_req *areq, int *error)
+{
+	int err = 0;
+	struct mmc_async_req *data = host->areq;
+
+	/* Prepare a new request */
+	if (areq)
+		mmc_pre_req(host, areq->mrq, !host->areq);
+
+	if (host->areq) {
+		mmc_wait_for_areq_done(host, host->areq);
+		err = host->areq->err_check(host->card, host->areq);
+		if (err) {
+			mmc_post_req(host, host->areq->mrq, 0);
+			if (areq)
+				mmc_post_req(host, areq->mrq, -EINVAL);
+
+			host->areq = NULL;
+			goto out;
+		}
+	}
+
+	if (areq)
+		__mmc_start_req(host, areq->mrq);
+
+	if (host->areq)
+		mmc_post_req(host, host->areq->mrq, 0);
+
+	host->areq = areq;
+ out:
+	if (error)
+		*error = err;
+	return data;
+}
+EXPORT_SYMBOL(mmc_start_req);
+
 /**
  *	mmc_wait_for_req - start a request and wait for completion
  *	@host: MMC host to start command
@@ -213,14 +361,8 @@ static void mmc_wait_done(struct mmc_request *mrq)
  */
 void mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 {
-	DECLARE_COMPLETION_ONSTACK(complete);
-
-	mrq->done_data = &complete;
-	mrq->done = mmc_wait_done;
-
-	mmc_start_request(host, mrq);
-
-	wait_for_completion(&complete);
+	__mmc_start_req(host, mrq);
+	mmc_wait_for_req_done(host, mrq);
 }
 
 EXPORT_SYMBOL(mmc_wait_for_req);
@@ -1832,6 +1974,71 @@ int mmc_card_can_sleep(struct mmc_host *host)
 }
 EXPORT_SYMBOL(mmc_card_can_sleep);
 
+/**
+ *	mmc_flush_cache - write the card's volatile cache back to flash
+ *	@card: mmc card
+ *
+ *	Nothing is sent if no data was written since the last flush, so
+ *	flushes issued back to back cost a single one.  Must be called
+ *	with the host claimed.
+ */
+int mmc_flush_cache(struct mmc_card *card)
+{
+	int err = 0;
+
+	if (!mmc_card_mmc(card) || !card->ext_csd.cache_ctrl ||
+	    !card->cache_dirty)
+		return 0;
+
+	err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+			 EXT_CSD_FLUSH_CACHE, 1, 0);
+	if (err)
+		pr_err("%s: cache flush error %d\n",
+		       mmc_hostname(card->host), err);
+	else
+		card->cache_dirty = false;
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_flush_cache);
+
+/**
+ *	mmc_cache_ctrl - turn the card's volatile cache on or off
+ *	@host: mmc host
+ *	@enable: 1 to enable, 0 to flush and disable
+ *
+ *	Must be called with the host claimed.
+ */
+int mmc_cache_ctrl(struct mmc_host *host, u8 enable)
+{
+	struct mmc_card *card = host->card;
+	int err;
+
+	if (!card || !mmc_card_mmc(card) || !card->ext_csd.cache_size)
+		return 0;
+
+	enable = !!enable;
+	if (card->ext_csd.cache_ctrl == enable)
+		return 0;
+
+	if (!enable) {
+		err = mmc_flush_cache(card);
+		if (err)
+			return err;
+	}
+
+	err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CACHE_CTRL,
+			 enable, card->ext_csd.generic_cmd6_time);
+	if (err)
+		pr_err("%s: cache %s error %d\n", mmc_hostname(host),
+		       enable ? "on" : "off", err);
+	else
+		card->ext_csd.cache_ctrl = enable;
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_cache_ctrl);
+
 #ifdef CONFIG_PM
 
 /**
@@ -284,6 +284,78 @@ static const struct file_operations mmc_dbg_ext_csd_fops = {
 	.llseek		= default_llseek,
 };
 
+static const char *mmc_packed_stop_str[MMC_PACKED_STOP_MAX] = {
+	[MMC_PACKED_STOP_EMPTY_QUEUE]	= "empty queue",
+	[MMC_PACKED_STOP_MAX_ENTRIES]	= "max entries",
+	[MMC_PACKED_STOP_SECTORS]	= "max sectors",
+	[MMC_PACKED_STOP_SEGMENTS]	= "max segments",
+	[MMC_PACKED_STOP_DIRECTION]	= "read in between",
+	[MMC_PACKED_STOP_FLUSH_DISCARD]	= "flush or discard",
+	[MMC_PACKED_STOP_REL_WRITE]	= "reliable write",
+};
+
+static int mmc_wr_pack_stats_show(struct seq_file *s, void *data)
+{
+	struct mmc_card *card = s->private;
+	struct mmc_wr_pack_stats *stats = &card->wr_pack_stats;
+	u32 packs[MMC_PACKED_MAX_ENTRIES + 1];
+	u32 stop_reason[MMC_PACKED_STOP_MAX];
+	u32 failures;
+	int i;
+
+	spin_lock_irq(&stats->lock);
+	memcpy(packs, stats->packs, sizeof(packs));
+	memcpy(stop_reason, stats->stop_reason, sizeof(stop_reason));
+	failures = stats->failures;
+	spin_unlock_irq(&stats->lock);
+
+	seq_printf(s, "max requests per pack: %u\n", card->max_packed_wr);
+	seq_printf(s, "packed command failures: %u\n", failures);
+
+	seq_printf(s, "requests per pack:\n");
+	for (i = 1; i <= MMC_PACKED_MAX_ENTRIES; i++)
+		if (packs[i])
+			seq_printf(s, "  %2d: %u\n", i, packs[i]);
+
+	seq_printf(s, "pack cut short by:\n");
+	for (i = 0; i < MMC_PACKED_STOP_MAX; i++)
+		seq_printf(s, "  %s: %u\n", mmc_packed_stop_str[i],
+			   stop_reason[i]);
+
+	return 0;
+}
+
+static int mmc_wr_pack_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_wr_pack_stats_show, inode->i_private);
+}
+
+/* any write clears the statistics */
+static ssize_t mmc_wr_pack_stats_write(struct file *file,
+				       const char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct mmc_card *card = s->private;
+	struct mmc_wr_pack_stats *stats = &card->wr_pack_stats;
+
+	spin_lock_irq(&stats->lock);
+	memset(stats->packs, 0, sizeof(stats->packs));
+	memset(stats->stop_reason, 0, sizeof(stats->stop_reason));
+	stats->failures = 0;
+	spin_unlock_irq(&stats->lock);
+
+	return count;
+}
+
+static const struct file_operations mmc_dbg_wr_pack_stats_fops = {
+	.open		= mmc_wr_pack_stats_open,
+	.read		= seq_read,
+	.write		= mmc_wr_pack_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void mmc_add_card_debugfs(struct mmc_card *card)
 {
 	struct mmc_host	*host = card->host;
@@ -316,6 +388,11 @@ void mmc_add_card_debugfs(struct mmc_card *card)
 					&mmc_dbg_ext_csd_fops))
 			goto err;
 
+	if (mmc_card_mmc(card) && card->ext_csd.max_packed_writes)
+		if (!debugfs_create_file("wr_pack_stats", S_IRUSR | S_IWUSR,
+					root, card, &mmc_dbg_wr_pack_stats_fops))
+			goto err;
+
 	return;
 
 err:
@@ -260,7 +260,7 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 	}
 
 	card->ext_csd.rev = ext_csd[EXT_CSD_REV];
-	if (card->ext_csd.rev > 5) {
+	if (card->ext_csd.rev > 6) {
 		printk(KERN_ERR "%s: unrecognised EXT_CSD revision %d\n",
 			mmc_hostname(card->host), card->ext_csd.rev);
 		err = -EINVAL;
@@ -407,6 +407,30 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 	if (card->ext_csd.rev >= 5)
 		card->ext_csd.rel_param = ext_csd[EXT_CSD_WR_REL_PARAM];
 
+	card->ext_csd.data_sector_size = 512;
+	if (card->ext_csd.rev >= 6) {
+		card->ext_csd.max_packed_writes =
+			ext_csd[EXT_CSD_MAX_PACKED_WRITES];
+		card->ext_csd.max_packed_reads =
+			ext_csd[EXT_CSD_MAX_PACKED_READS];
+		if (ext_csd[EXT_CSD_DATA_SECTOR_SIZE])
+			card->ext_csd.data_sector_size = 4096;
+
+		card->ext_csd.generic_cmd6_time = 10 *
+			ext_csd[EXT_CSD_GENERIC_CMD6_TIME];
+		card->ext_csd.cache_size =
+			ext_csd[EXT_CSD_CACHE_SIZE + 0] << 0 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 1] << 8 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 2] << 16 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 3] << 24;
+	}
+
+	/* the packed header is a single 512 byte block */
+	if (card->ext_csd.data_sector_size == 512)
+		card->max_packed_wr = min_t(unsigned int,
+					    card->ext_csd.max_packed_writes,
+					    MMC_PACKED_MAX_ENTRIES);
+
 	card->ext_csd.raw_erased_mem_count = ext_csd[EXT_CSD_ERASED_MEM_CONT];
 	if (ext_csd[EXT_CSD_ERASED_MEM_CONT])
 		card->erased_byte = 0xFF;
@@ -517,6 +541,38 @@ MMC_DEV_ATTR(enhanced_area_offset, "%llu\n",
 		card->ext_csd.enhanced_area_offset);
 MMC_DEV_ATTR(enhanced_area_size, "%u\n", card->ext_csd.enhanced_area_size);
 
+static ssize_t mmc_packed_writes_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct mmc_card *card = mmc_dev_to_card(dev);
+
+	return sprintf(buf, "%u\n", card->max_packed_wr);
+}
+
+/* requests per packed write, limited by the card; 0 or 1 disables packing */
+static ssize_t mmc_packed_writes_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct mmc_card *card = mmc_dev_to_card(dev);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	if (card->ext_csd.data_sector_size != 512)
+		val = 0;
+	if (val > card->ext_csd.max_packed_writes)
+		val = card->ext_csd.max_packed_writes;
+	if (val > MMC_PACKED_MAX_ENTRIES)
+		val = MMC_PACKED_MAX_ENTRIES;
+
+	card->max_packed_wr = val;
+	return count;
+}
+static DEVICE_ATTR(packed_writes, S_IRUGO | S_IWUSR, mmc_packed_writes_show,
+		   mmc_packed_writes_store);
+
 static struct attribute *mmc_std_attrs[] = {
 	&dev_attr_cid.attr,
 	&dev_attr_csd.attr,
@@ -531,6 +587,7 @@ static struct attribute *mmc_std_attrs[] = {
 	&dev_attr_serial.attr,
 	&dev_attr_enhanced_area_offset.attr,
 	&dev_attr_enhanced_area_size.attr,
+	&dev_attr_packed_writes.attr,
 #ifdef CONFIG_MMC_SAMSUNG_SMART
 	&dev_attr_samsung_smart.attr,
 #endif
@@ -759,6 +816,45 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 			goto free_card;
 	}
 
+	/*
+	 * Have the card report which request of a packed write failed,
+	 * rather than failing the whole of it.
+	 */
+	if (card->ext_csd.max_packed_writes) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_EXP_EVENTS_CTRL,
+				 EXT_CSD_PACKED_EVENT_EN, 0);
+		if (err && err != -EBADMSG)
+			goto free_card;
+
+		card->ext_csd.packed_event_en = !err;
+		if (err) {
+			printk(KERN_WARNING "%s: enabling packed event failed\n",
+			       mmc_hostname(card->host));
+			err = 0;
+		}
+	}
+
+	/*
+	 * Enable the volatile cache.  Writes are then only stable once
+	 * flushed, the block driver does so on REQ_FLUSH.
+	 */
+	if (card->ext_csd.cache_size) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_CACHE_CTRL, 1,
+				 card->ext_csd.generic_cmd6_time);
+		if (err && err != -EBADMSG)
+			goto free_card;
+
+		card->ext_csd.cache_ctrl = !err;
+		card->cache_dirty = false;
+		if (err) {
+			printk(KERN_WARNING "%s: enabling cache failed\n",
+			       mmc_hostname(card->host));
+			err = 0;
+		}
+	}
+
 	/*
 	 * Activate high speed (if supported)
 	 */
@@ -969,11 +1065,16 @@ static int mmc_suspend(struct mmc_host *host)
 	BUG_ON(!host->card);
 
 	mmc_claim_host(host);
+	err = mmc_cache_ctrl(host, 0);
+	if (err)
+		goto out;
+
 	if (mmc_card_can_sleep(host))
 		err = mmc_card_sleep(host);
 	else if (!mmc_host_is_spi(host))
 		mmc_deselect_cards(host);
 	host->card->state &= ~MMC_STATE_HIGHSPEED;
+out:
 	mmc_release_host_sync(host);
 
 	return err;
@@ -1017,6 +1118,11 @@ static int mmc_sleep(struct mmc_host *host)
 	int err = -ENOSYS;
 
 	if (card && card->ext_csd.rev >= 3) {
+		/* the host may cut the card's power once it sleeps */
+		err = mmc_flush_cache(card);
+		if (err)
+			return err;
+
 		err = mmc_card_sleepawake(host, 1);
 		if (err < 0)
 			pr_debug("%s: Error %d while putting card into sleep",
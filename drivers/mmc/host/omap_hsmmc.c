@@ -25,6 +25,8 @@
 #include <linux/platform_device.h>
 #include <linux/workqueue.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/clk.h>
 #include <linux/mmc/host.h>
 #include <linux/mmc/core.h>
@@ -35,6 +37,7 @@
 #include <linux/gpio.h>
 #include <linux/regulator/consumer.h>
 #include <linux/pm_runtime.h>
+#include <linux/log2_hist.h>
 
 #include <plat/dma.h>
 #include <mach/hardware.h>
@@ -134,6 +137,8 @@
 #define DMA_TABLE_NUM_ENTRIES	1024
 #define ADMA_TABLE_SZ 	\
 	(DMA_TABLE_NUM_ENTRIES * sizeof(struct adma_desc_table))
+/* one for the request in flight, one to prepare the next in */
+#define ADMA_TABLE_NUM		2
 
 #define SDMA_XFER	1
 #define ADMA_XFER	2
@@ -197,6 +202,34 @@ struct adma_desc_table {
 	dma_addr_t addr;
 };
 
+/*
+ * Short requests are completed by busy waiting on the status register
+ * for up to poll_us, rather than through an interrupt for each command
+ * and data phase.  Data requests are polled up to poll_max_bytes.
+ */
+static unsigned int poll_us = 100;
+module_param(poll_us, uint, 0644);
+
+static unsigned int poll_max_bytes = 4096;
+module_param(poll_max_bytes, uint, 0644);
+
+/* request latency by transfer size, log2 buckets of 1K: <1K ... >=64K */
+#define OMAP_HSMMC_LAT_BUCKETS	8
+
+struct omap_hsmmc_lat {
+	u32		count;
+	u32		polled;		/* completed without an interrupt */
+	u32		max_us;
+	u64		total_us;
+};
+
+/* a request mapped by pre_req ahead of being issued */
+struct omap_hsmmc_next {
+	unsigned int	dma_len;
+	int		adma_idx;
+	s32		cookie;
+};
+
 struct omap_hsmmc_host {
 	struct	device		*dev;
 	struct	mmc_host	*mmc;
@@ -238,6 +271,8 @@ struct omap_hsmmc_host {
 	int			dma_type, dma_ch;
 	struct adma_desc_table	*adma_table;
 	dma_addr_t		phy_adma_table;
+	int			adma_cur;	/* table of the last request */
+	struct omap_hsmmc_next	next_data;
 	int			dma_line_tx, dma_line_rx;
 	int			slot_id;
 	int			got_dbclk;
@@ -248,6 +283,10 @@ struct omap_hsmmc_host {
 	int			reqs_blocked;
 	int			use_reg;
 	int			req_in_progress;
+	int			polling;	/* irqs masked, polled instead */
+	ktime_t			req_start;
+	spinlock_t		lat_lock;
+	struct omap_hsmmc_lat	lat[OMAP_HSMMC_LAT_BUCKETS];
 	unsigned int		flags;
 	unsigned int		errata;
 
@@ -280,6 +319,9 @@ static void omap_hsmmc_status_notify_cb(int card_present, void *dev_id)
 
 static int
 omap_hsmmc_prepare_data(struct omap_hsmmc_host *host, struct mmc_request *req);
+static int omap_hsmmc_pre_dma_transfer(struct omap_hsmmc_host *host,
+				       struct mmc_data *data,
+				       struct omap_hsmmc_next *next);
 
 static int omap_hsmmc_card_detect(struct device *dev, int slot)
 {
@@ -666,7 +708,8 @@ static void omap_hsmmc_enable_irq(struct omap_hsmmc_host *host,
 		irq_mask &= ~DTO_ENABLE;
 
 	OMAP_HSMMC_WRITE(host->base, STAT, STAT_CLEAR);
-	OMAP_HSMMC_WRITE(host->base, ISE, irq_mask);
+	/* while polling, status is latched but raises no interrupt */
+	OMAP_HSMMC_WRITE(host->base, ISE, host->polling ? 0 : irq_mask);
 	OMAP_HSMMC_WRITE(host->base, IE, irq_mask);
 }
 
@@ -960,6 +1003,32 @@ omap_hsmmc_get_dma_dir(struct omap_hsmmc_host *host, struct mmc_data *data)
 		return DMA_FROM_DEVICE;
 }
 
+static void omap_hsmmc_account(struct omap_hsmmc_host *host,
+			       struct mmc_request *mrq)
+{
+	struct mmc_data *data = mrq->data;
+	struct omap_hsmmc_lat *lat;
+	unsigned long flags;
+	unsigned int blocks;
+	u32 us;
+
+	if (!data || data->error)
+		return;
+
+	us = ktime_us_delta(ktime_get(), host->req_start);
+	blocks = max(data->blocks * data->blksz >> 9, 1U);
+	lat = &host->lat[log2_hist_bucket(blocks >> 1, OMAP_HSMMC_LAT_BUCKETS)];
+
+	spin_lock_irqsave(&host->lat_lock, flags);
+	lat->count++;
+	if (host->polling)
+		lat->polled++;
+	lat->total_us += us;
+	if (us > lat->max_us)
+		lat->max_us = us;
+	spin_unlock_irqrestore(&host->lat_lock, flags);
+}
+
 static void omap_hsmmc_request_done(struct omap_hsmmc_host *host, struct mmc_request *mrq)
 {
 	int dma_ch;
@@ -974,6 +1043,7 @@ static void omap_hsmmc_request_done(struct omap_hsmmc_host *host, struct mmc_req
 	if (mrq->data && host->dma_type && dma_ch != -1)
 		return;
 	host->mrq = NULL;
+	omap_hsmmc_account(host, mrq);
 	mmc_request_done(host->mmc, mrq);
 }
 
@@ -999,8 +1069,8 @@ omap_hsmmc_xfer_done(struct omap_hsmmc_host *host, struct mmc_data *data)
 
 	host->data = NULL;
 
-	if (host->dma_type == ADMA_XFER)
-		dma_unmap_sg(mmc_dev(host->mmc), data->sg, host->dma_len,
+	if (host->dma_type == ADMA_XFER && !data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
 					omap_hsmmc_get_dma_dir(host, data));
 
 	if (!data->error)
@@ -1095,9 +1165,10 @@ static void omap_hsmmc_dma_cleanup(struct omap_hsmmc_host *host, int errno)
 	spin_unlock(&host->irq_lock);
 
 	if ((host->dma_type == SDMA_XFER) && (dma_ch != -1)) {
-		dma_unmap_sg(mmc_dev(host->mmc), host->data->sg,
-			host->data->sg_len,
-			omap_hsmmc_get_dma_dir(host, host->data));
+		if (!host->data->host_cookie)
+			dma_unmap_sg(mmc_dev(host->mmc), host->data->sg,
+				host->data->sg_len,
+				omap_hsmmc_get_dma_dir(host, host->data));
 		omap_free_dma(dma_ch);
 	}
 	host->data = NULL;
@@ -1522,8 +1593,9 @@ static void omap_hsmmc_dma_cb(int lch, u16 ch_status, void *cb_data)
 		return;
 	}
 
-	dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
-		omap_hsmmc_get_dma_dir(host, data));
+	if (!data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			omap_hsmmc_get_dma_dir(host, data));
 
 	req_in_progress = host->req_in_progress;
 	dma_ch = host->dma_ch;
@@ -1537,6 +1609,7 @@ static void omap_hsmmc_dma_cb(int lch, u16 ch_status, void *cb_data)
 		struct mmc_request *mrq = host->mrq;
 
 		host->mrq = NULL;
+		omap_hsmmc_account(host, mrq);
 		mmc_request_done(host->mmc, mrq);
 	}
 }
@@ -1575,8 +1648,11 @@ static int omap_hsmmc_start_sdma_transfer(struct omap_hsmmc_host *host,
 		return ret;
 	}
 
-	host->dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
-			data->sg_len, omap_hsmmc_get_dma_dir(host, data));
+	ret = omap_hsmmc_pre_dma_transfer(host, data, NULL);
+	if (ret) {
+		omap_free_dma(dma_ch);
+		return ret;
+	}
 	host->dma_ch = dma_ch;
 	host->dma_sg_idx = 0;
 
@@ -1586,17 +1662,15 @@ static int omap_hsmmc_start_sdma_transfer(struct omap_hsmmc_host *host,
 }
 
 static int mmc_populate_adma_desc_table(struct omap_hsmmc_host *host,
-		struct mmc_request *req, struct adma_desc_table *pdesc)
+		struct mmc_data *data, unsigned int dma_len,
+		struct adma_desc_table *pdesc)
 {
 	int i, j, dmalen;
 	int splitseg, xferaddr;
 	int numblocks = 0;
 	dma_addr_t dmaaddr;
-	struct mmc_data *data = req->data;
 
-	host->dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
-			data->sg_len, omap_hsmmc_get_dma_dir(host, data));
-	for (i = 0, j = 0; i < host->dma_len; i++) {
+	for (i = 0, j = 0; i < dma_len; i++) {
 		dmaaddr = sg_dma_address(data->sg + i);
 		dmalen = sg_dma_len(data->sg + i);
 		numblocks += dmalen / data->blksz;
@@ -1634,14 +1708,69 @@ static int mmc_populate_adma_desc_table(struct omap_hsmmc_host *host,
 	WARN_ON((i + j - 1) > DMA_TABLE_NUM_ENTRIES);
 	dev_dbg(mmc_dev(host->mmc),
 		"ADMA table has %d entries from %d sglist\n",
-		i + j, host->dma_len);
+		i + j, dma_len);
 	return numblocks;
 }
 
 static void omap_hsmmc_start_adma_transfer(struct omap_hsmmc_host *host)
 {
 	wmb();
-	OMAP_HSMMC_WRITE(host->base, ADMA_SAL, host->phy_adma_table);
+	OMAP_HSMMC_WRITE(host->base, ADMA_SAL,
+			 host->phy_adma_table + host->adma_cur * ADMA_TABLE_SZ);
+}
+
+/*
+ * Map the data and, for ADMA, build its descriptor table.  With next set
+ * this is pre_req working ahead while the previous request is still on
+ * the bus, and the result is picked up by the request once it is issued.
+ * The table in use by the last request issued is never written to.
+ */
+static int omap_hsmmc_pre_dma_transfer(struct omap_hsmmc_host *host,
+				       struct mmc_data *data,
+				       struct omap_hsmmc_next *next)
+{
+	int dma_len, idx;
+
+	if (!next && data->host_cookie &&
+	    data->host_cookie != host->next_data.cookie) {
+		dev_warn(mmc_dev(host->mmc), "invalid cookie %d, expected %d\n",
+			 data->host_cookie, host->next_data.cookie);
+		data->host_cookie = 0;
+	}
+
+	if (!next && data->host_cookie) {
+		host->dma_len = host->next_data.dma_len;
+		host->adma_cur = host->next_data.adma_idx;
+		host->next_data.dma_len = 0;
+		return 0;
+	}
+
+	dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     omap_hsmmc_get_dma_dir(host, data));
+	if (dma_len == 0)
+		return -EINVAL;
+
+	idx = host->adma_cur ^ 1;
+	if (host->dma_type == ADMA_XFER) {
+		int numblks;
+
+		numblks = mmc_populate_adma_desc_table(host, data, dma_len,
+				host->adma_table + idx * DMA_TABLE_NUM_ENTRIES);
+		WARN_ON(numblks != data->blocks);
+	}
+
+	if (next) {
+		next->dma_len = dma_len;
+		next->adma_idx = idx;
+		if (++next->cookie <= 0)
+			next->cookie = 1;
+		data->host_cookie = next->cookie;
+	} else {
+		host->dma_len = dma_len;
+		host->adma_cur = idx;
+	}
+
+	return 0;
 }
 
 static void set_data_timeout(struct omap_hsmmc_host *host,
@@ -1688,7 +1817,6 @@ static int
 omap_hsmmc_prepare_data(struct omap_hsmmc_host *host, struct mmc_request *req)
 {
 	int ret;
-	int numblks;
 
 	host->data = req->data;
 
@@ -1714,20 +1842,171 @@ omap_hsmmc_prepare_data(struct omap_hsmmc_host *host, struct mmc_request *req)
 			return ret;
 		}
 	} else if (host->dma_type == ADMA_XFER) {
-		numblks = mmc_populate_adma_desc_table(host,
-				req, host->adma_table);
-		WARN_ON(numblks != req->data->blocks);
+		ret = omap_hsmmc_pre_dma_transfer(host, req->data, NULL);
+		if (ret)
+			return ret;
 		omap_hsmmc_start_adma_transfer(host);
 	}
 	return 0;
 }
 
+static void omap_hsmmc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+				int err)
+{
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (host->dma_type && data && data->host_cookie) {
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     omap_hsmmc_get_dma_dir(host, data));
+		data->host_cookie = 0;
+	}
+}
+
+static void omap_hsmmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			       bool is_first_req)
+{
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!host->dma_type || !data)
+		return;
+
+	if (data->host_cookie) {
+		data->host_cookie = 0;
+		return;
+	}
+
+	if (omap_hsmmc_pre_dma_transfer(host, data, &host->next_data))
+		data->host_cookie = 0;
+}
+
+static bool omap_hsmmc_can_poll(struct omap_hsmmc_host *host,
+				struct mmc_request *req)
+{
+	struct mmc_data *data = req->data;
+
+	/* a retry from the completion path is already being polled */
+	if (!poll_us || host->polling || in_interrupt() || irqs_disabled())
+		return false;
+
+	if (!data)
+		return req->cmd->opcode != MMC_ERASE;
+
+	return host->dma_type && data->blocks * data->blksz <= poll_max_bytes;
+}
+
+/*
+ * Run the interrupt handler from here for as long as the request is
+ * in flight and poll_us has not run out, then hand whatever is left
+ * over to the interrupt.
+ */
+static void omap_hsmmc_poll(struct omap_hsmmc_host *host,
+			    struct mmc_request *mrq)
+{
+	unsigned long flags;
+	u32 status;
+
+	while (host->mrq == mrq) {
+		status = OMAP_HSMMC_READ(host->base, STAT);
+		if (status & INT_EN_MASK) {
+			/* the dma callback takes irq_lock from irq context */
+			local_irq_save(flags);
+			omap_hsmmc_do_irq(host, status);
+			local_irq_restore(flags);
+			continue;
+		}
+
+		if (ktime_us_delta(ktime_get(), host->req_start) >= poll_us)
+			break;
+		cpu_relax();
+	}
+
+	/* status latched since the last read raises the interrupt now */
+	host->polling = 0;
+	OMAP_HSMMC_WRITE(host->base, ISE, OMAP_HSMMC_READ(host->base, IE));
+}
+
+/*
+ * Stop a write in flight for an urgent request: CMD12 is sent as an
+ * abort and the data line reset.  The blocks left in BLK were counted
+ * before the abort, so bytes_xfered may fall short of what the card got
+ * but never exceeds it.
+ */
+static int omap_hsmmc_stop_request(struct mmc_host *mmc)
+{
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+	struct mmc_request *mrq;
+	struct mmc_data *data;
+	unsigned long flags, timeout;
+	u32 status, nblk;
+	int ret = -EBUSY;
+
+	if (host->dma_type != ADMA_XFER)
+		return -ENOSYS;
+
+	/* keep the interrupt handler off the request while it is stopped */
+	disable_irq(host->irq);
+
+	mrq = host->mrq;
+	data = host->data;
+	status = OMAP_HSMMC_READ(host->base, STAT);
+	/* still in the command phase, or completing anyway */
+	if (!mrq || !data || host->cmd || !(data->flags & MMC_DATA_WRITE) ||
+	    (status & INT_EN_MASK))
+		goto out;
+
+	nblk = OMAP_HSMMC_READ(host->base, BLK) >> 16;
+
+	OMAP_HSMMC_WRITE(host->base, ISE, 0);
+	OMAP_HSMMC_WRITE(host->base, STAT, STAT_CLEAR);
+	OMAP_HSMMC_WRITE(host->base, ARG, 0);
+	OMAP_HSMMC_WRITE(host->base, CMD, (MMC_STOP_TRANSMISSION << 24) |
+			 (3 << 16) | (3 << 22));
+
+	timeout = jiffies + msecs_to_jiffies(MMC_TIMEOUT_MS);
+	do {
+		status = OMAP_HSMMC_READ(host->base, STAT);
+		if (status & (CC | ERR))
+			break;
+		cpu_relax();
+	} while (time_before(jiffies, timeout));
+
+	if (!(status & CC) || (status & ERR))
+		data->error = -ETIMEDOUT;
+	else if (mrq->stop)
+		mrq->stop->resp[0] = OMAP_HSMMC_READ(host->base, RSP10);
+
+	omap_hsmmc_reset_controller_fsm(host, SRC);
+	omap_hsmmc_reset_controller_fsm(host, SRD);
+	OMAP_HSMMC_WRITE(host->base, STAT, STAT_CLEAR);
+
+	if (!data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     omap_hsmmc_get_dma_dir(host, data));
+	if (nblk > data->blocks)
+		nblk = data->blocks;
+	data->bytes_xfered = (data->blocks - nblk) * data->blksz;
+	host->data = NULL;
+	host->response_busy = 0;
+
+	/* the dma callback takes irq_lock from irq context */
+	local_irq_save(flags);
+	omap_hsmmc_request_done(host, mrq);
+	local_irq_restore(flags);
+	ret = 0;
+out:
+	enable_irq(host->irq);
+	return ret;
+}
+
 /*
  * Request function. for read/write operation
  */
 static void omap_hsmmc_request(struct mmc_host *mmc, struct mmc_request *req)
 {
 	struct omap_hsmmc_host *host = mmc_priv(mmc);
+	bool poll;
 	int err;
 
 	BUG_ON(host->req_in_progress);
@@ -1773,9 +2052,14 @@ static void omap_hsmmc_request(struct mmc_host *mmc, struct mmc_request *req)
 	}
 
 	host->mrq = req;
+	host->req_start = ktime_get();
+	poll = omap_hsmmc_can_poll(host, req);
+	if (poll)
+		host->polling = 1;
+
 	if (req->sbc) {
 		omap_hsmmc_start_command(host, req->sbc, NULL, 0);
-		return;
+		goto out;
 	}
 
 	err = omap_hsmmc_prepare_data(host, req);
@@ -1784,11 +2068,16 @@ static void omap_hsmmc_request(struct mmc_host *mmc, struct mmc_request *req)
 		if (req->data)
 			req->data->error = err;
 		host->mrq = NULL;
+		if (poll)
+			host->polling = 0;
 		mmc_request_done(mmc, req);
 		return;
 	}
 
 	omap_hsmmc_start_command(host, req->cmd, req->data, 0);
+out:
+	if (poll)
+		omap_hsmmc_poll(host, req);
 }
 
 /* Routine to configure clock values. Exposed API to core */
@@ -2251,6 +2540,9 @@ static const struct mmc_host_ops omap_hsmmc_ops = {
 	.enable = omap_hsmmc_enable_simple,
 	.disable = omap_hsmmc_disable_simple,
 	.request = omap_hsmmc_request,
+	.pre_req = omap_hsmmc_pre_req,
+	.post_req = omap_hsmmc_post_req,
+	.stop_request = omap_hsmmc_stop_request,
 	.set_ios = omap_hsmmc_set_ios,
 	.get_cd = omap_hsmmc_get_cd,
 	.get_ro = omap_hsmmc_get_ro,
@@ -2262,6 +2554,9 @@ static const struct mmc_host_ops omap_hsmmc_ps_ops = {
 	.enable = omap_hsmmc_enable,
 	.disable = omap_hsmmc_disable,
 	.request = omap_hsmmc_request,
+	.pre_req = omap_hsmmc_pre_req,
+	.post_req = omap_hsmmc_post_req,
+	.stop_request = omap_hsmmc_stop_request,
 	.set_ios = omap_hsmmc_set_ios,
 	.get_cd = omap_hsmmc_get_cd,
 	.get_ro = omap_hsmmc_get_ro,
@@ -2324,11 +2619,67 @@ static const struct file_operations mmc_regs_fops = {
 	.release        = single_release,
 };
 
+static int omap_hsmmc_lat_show(struct seq_file *s, void *data)
+{
+	struct mmc_host *mmc = s->private;
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+	struct omap_hsmmc_lat lat[OMAP_HSMMC_LAT_BUCKETS];
+	int i;
+
+	spin_lock_irq(&host->lat_lock);
+	memcpy(lat, host->lat, sizeof(lat));
+	spin_unlock_irq(&host->lat_lock);
+
+	seq_printf(s, "poll:		%uus up to %u bytes\n", poll_us,
+		   poll_max_bytes);
+	seq_printf(s, "bytes	count	polled	avg_us	max_us\n");
+	for (i = 0; i < OMAP_HSMMC_LAT_BUCKETS; i++)
+		seq_printf(s, "%s%llu\t%u\t%u\t%llu\t%u\n",
+			   i < OMAP_HSMMC_LAT_BUCKETS - 1 ? "<" : ">=",
+			   log2_hist_bound(i, OMAP_HSMMC_LAT_BUCKETS) << 10,
+			   lat[i].count, lat[i].polled,
+			   lat[i].count ?
+			   div_u64(lat[i].total_us, lat[i].count) : 0,
+			   lat[i].max_us);
+
+	return 0;
+}
+
+static int omap_hsmmc_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap_hsmmc_lat_show, inode->i_private);
+}
+
+static ssize_t omap_hsmmc_lat_write(struct file *file,
+				    const char __user *buf, size_t count,
+				    loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct omap_hsmmc_host *host = mmc_priv(s->private);
+
+	spin_lock_irq(&host->lat_lock);
+	memset(host->lat, 0, sizeof(host->lat));
+	spin_unlock_irq(&host->lat_lock);
+
+	return count;
+}
+
+static const struct file_operations mmc_lat_fops = {
+	.open           = omap_hsmmc_lat_open,
+	.read           = seq_read,
+	.write          = omap_hsmmc_lat_write,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static void omap_hsmmc_debugfs(struct mmc_host *mmc)
 {
-	if (mmc->debugfs_root)
+	if (mmc->debugfs_root) {
 		debugfs_create_file("regs", S_IRUSR, mmc->debugfs_root,
 			mmc, &mmc_regs_fops);
+		debugfs_create_file("xfer_latency", S_IRUSR | S_IWUSR,
+			mmc->debugfs_root, mmc, &mmc_lat_fops);
+	}
 }
 
 #else
@@ -2450,6 +2801,7 @@ static int __init omap_hsmmc_probe(struct platform_device *pdev)
 	mmc->f_max	= 52000000;
 
 	spin_lock_init(&host->irq_lock);
+	spin_lock_init(&host->lat_lock);
 
 	host->iclk = clk_get(&pdev->dev, "ick");
 	if (IS_ERR(host->iclk)) {
@@ -2516,7 +2868,8 @@ static int __init omap_hsmmc_probe(struct platform_device *pdev)
 		 * due to unset conherency mask
 		 */
 		host->adma_table = dma_alloc_coherent(NULL,
-			ADMA_TABLE_SZ, &host->phy_adma_table, 0);
+			ADMA_TABLE_SZ * ADMA_TABLE_NUM,
+			&host->phy_adma_table, 0);
 		if (host->adma_table != NULL)
 			host->dma_type = ADMA_XFER;
 	}
@@ -2669,7 +3022,7 @@ err_irq:
 	}
 err1:
 	if (host->adma_table != NULL)
-		dma_free_coherent(NULL, ADMA_TABLE_SZ,
+		dma_free_coherent(NULL, ADMA_TABLE_SZ * ADMA_TABLE_NUM,
 			host->adma_table, host->phy_adma_table);
 	iounmap(host->base);
 err_ioremap:
@@ -2700,7 +3053,7 @@ static int omap_hsmmc_remove(struct platform_device *pdev)
 		flush_work_sync(&host->mmc_carddetect_work);
 
 		if (host->adma_table != NULL)
-			dma_free_coherent(NULL, ADMA_TABLE_SZ,
+			dma_free_coherent(NULL, ADMA_TABLE_SZ * ADMA_TABLE_NUM,
 				host->adma_table, host->phy_adma_table);
 
 		mmc_host_disable(host->mmc);
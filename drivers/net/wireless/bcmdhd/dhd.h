@@ -257,6 +257,13 @@ typedef struct dhd_pub {
 	ulong wd_dpc_sched;   /* Number of times dhd dpc scheduled by watchdog timer */
 
 	ulong rx_readahead_cnt;	/* Number of packets where header read-ahead was used. */
+#ifdef DHD_RX_NAPI
+	ulong rx_napi_polls;	/* Number of rx NAPI polls */
+	ulong rx_napi_pkts;	/* Packets handed up by the polls */
+	ulong rx_napi_merged;	/* Packets merged into another by GRO */
+	ulong rx_napi_full;	/* Polls that used up their budget */
+	ulong rx_napi_remote;	/* Polls scheduled on the rx CPU */
+#endif /* DHD_RX_NAPI */
 	ulong tx_realloc;	/* Number of tx packets we had to realloc for headroom */
 	ulong fc_packets;       /* Number of flow control pkts recvd */
 
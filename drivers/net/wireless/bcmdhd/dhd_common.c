@@ -260,6 +260,15 @@ dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 	            dhdp->rx_ctlpkts, dhdp->rx_ctlerrs, dhdp->rx_dropped);
 	bcm_bprintf(strbuf, "rx_readahead_cnt %lu tx_realloc %lu\n",
 	            dhdp->rx_readahead_cnt, dhdp->tx_realloc);
+#ifdef DHD_RX_NAPI
+	bcm_bprintf(strbuf, "rx_napi_polls %lu rx_napi_pkts %lu rx_napi_merged %lu "
+	            "rx_napi_full %lu rx_napi_remote %lu\n", dhdp->rx_napi_polls,
+	            dhdp->rx_napi_pkts, dhdp->rx_napi_merged, dhdp->rx_napi_full,
+	            dhdp->rx_napi_remote);
+#endif /* DHD_RX_NAPI */
+#ifdef DHD_PKT_RECYCLE
+	osl_pktrecycle_stats(dhdp->osh, strbuf);
+#endif /* DHD_PKT_RECYCLE */
 	bcm_bprintf(strbuf, "\n");
 
 	/* Add any prot info */
@@ -402,6 +411,11 @@ dhd_doiovar(dhd_pub_t *dhd_pub, const bcm_iovar_t *vi, uint32 actionid, const ch
 		dhd_pub->rx_dropped = 0;
 		dhd_pub->rx_readahead_cnt = 0;
 		dhd_pub->tx_realloc = 0;
+#ifdef DHD_RX_NAPI
+		dhd_pub->rx_napi_polls = dhd_pub->rx_napi_pkts = 0;
+		dhd_pub->rx_napi_merged = dhd_pub->rx_napi_full = 0;
+		dhd_pub->rx_napi_remote = 0;
+#endif /* DHD_RX_NAPI */
 		dhd_pub->wd_dpc_sched = 0;
 		memset(&dhd_pub->dstats, 0, sizeof(dhd_pub->dstats));
 		dhd_bus_clearcounts(dhd_pub);
@@ -43,6 +43,7 @@
 #include <linux/fcntl.h>
 #include <linux/fs.h>
 #include <linux/ip.h>
+#include <linux/cpu.h>
 #include <net/addrconf.h>
 
 #include <asm/uaccess.h>
@@ -349,6 +350,11 @@ typedef struct dhd_info {
 #ifdef DHDTCPACK_SUPPRESS
 	spinlock_t	tcpack_lock;
 #endif /* DHDTCPACK_SUPPRESS */
+#ifdef DHD_RX_NAPI
+	struct napi_struct rx_napi;
+	struct sk_buff_head rx_napi_queue;	/* frames queued by dhd_rx_frame */
+	struct sk_buff_head rx_napi_batch;	/* frames taken by the poll */
+#endif /* DHD_RX_NAPI */
 } dhd_info_t;
 
 /* Flag to indicate if we should download firmware on driver load */
@@ -447,6 +453,77 @@ int dhd_rxf_prio = CUSTOM_RXF_PRIO_SETTING;
 module_param(dhd_rxf_prio, int, 0);
 #endif /* RXFRAME_THREAD */
 
+/*
+ * CPU the DPC thread services the bus on, and CPU the received frames are
+ * handed to the stack on, by the rx frame thread or the NAPI poll; -1 for
+ * any.  A CPU that is offline counts as -1 until it comes back.  Both can
+ * be changed at run time through /sys/module/bcmdhd/parameters.
+ */
+#ifdef CUSTOM_DPC_CPUCORE
+int dhd_dpc_cpu = CUSTOM_DPC_CPUCORE;
+#else
+int dhd_dpc_cpu = 0;
+#endif /* CUSTOM_DPC_CPUCORE */
+int dhd_rx_cpu = 1;
+
+/* Bumped on every change of the above or of the online CPUs */
+static atomic_t dhd_cpu_gen = ATOMIC_INIT(0);
+
+static int
+dhd_cpu_param_set(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_int(val, kp);
+
+	if (ret == 0)
+		atomic_inc(&dhd_cpu_gen);
+	return ret;
+}
+
+static struct kernel_param_ops dhd_cpu_param_ops = {
+	.set = dhd_cpu_param_set,
+	.get = param_get_int,
+};
+module_param_cb(dhd_dpc_cpu, &dhd_cpu_param_ops, &dhd_dpc_cpu, 0644);
+module_param_cb(dhd_rx_cpu, &dhd_cpu_param_ops, &dhd_rx_cpu, 0644);
+
+static bool
+dhd_cpu_usable(int cpu)
+{
+	return (cpu >= 0) && (cpu < nr_cpu_ids) && cpu_online(cpu);
+}
+
+/* Called by a thread when woken, to move itself if the settings changed */
+static void
+dhd_thread_follow_cpu(int cpu, int *gen)
+{
+	int cur = atomic_read(&dhd_cpu_gen);
+
+	if (*gen == cur)
+		return;
+	*gen = cur;
+
+	if (dhd_cpu_usable(cpu))
+		set_cpus_allowed_ptr(current, cpumask_of(cpu));
+	else
+		set_cpus_allowed_ptr(current, cpu_possible_mask);
+}
+
+static int
+dhd_cpu_callback(struct notifier_block *nfb, unsigned long action, void *hcpu)
+{
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+	case CPU_DEAD:
+		atomic_inc(&dhd_cpu_gen);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block dhd_cpu_notifier = {
+	.notifier_call = dhd_cpu_callback,
+};
+
 /* DPC thread priority, -1 to use tasklet */
 extern int dhd_dongle_ramsize;
 module_param(dhd_dongle_ramsize, int, 0);
@@ -492,6 +569,12 @@ module_param(dhd_rxbound, uint, 0);
 extern uint dhd_deferred_tx;
 module_param(dhd_deferred_tx, uint, 0);
 
+#ifdef DHD_RX_NAPI
+/* Frames handed to the stack per NAPI poll */
+uint dhd_napi_budget = 64;
+module_param(dhd_napi_budget, uint, 0);
+#endif /* DHD_RX_NAPI */
+
 #ifdef BCMDBGFS
 extern void dhd_dbg_init(dhd_pub_t *dhdp);
 extern void dhd_dbg_remove(void);
@@ -1766,6 +1849,104 @@ static const char *_get_packet_type_str(uint16 type)
 }
 #endif /* DHD_RX_DUMP */
 
+#ifdef DHD_RX_NAPI
+/*
+ * Received frames are queued by dhd_rx_frame() and handed to the stack
+ * from the NET_RX softirq, up to a budget per poll and through GRO, so
+ * that the TCP segments of a download reach the stack merged instead of
+ * raising the softirq and walking the stack once per frame.
+ */
+static int
+dhd_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, rx_napi);
+	struct sk_buff *skb;
+	gro_result_t ret;
+	unsigned long flags;
+	int processed = 0;
+
+	while (processed < budget) {
+		skb = __skb_dequeue(&dhd->rx_napi_batch);
+		if (skb == NULL) {
+			spin_lock_irqsave(&dhd->rx_napi_queue.lock, flags);
+			skb_queue_splice_tail_init(&dhd->rx_napi_queue,
+				&dhd->rx_napi_batch);
+			spin_unlock_irqrestore(&dhd->rx_napi_queue.lock, flags);
+
+			skb = __skb_dequeue(&dhd->rx_napi_batch);
+			if (skb == NULL)
+				break;
+		}
+
+		ret = napi_gro_receive(napi, skb);
+		if (ret == GRO_MERGED || ret == GRO_MERGED_FREE)
+			dhd->pub.rx_napi_merged++;
+		processed++;
+	}
+
+	dhd->pub.rx_napi_polls++;
+	dhd->pub.rx_napi_pkts += processed;
+
+	if (processed < budget) {
+		napi_complete(napi);
+		/* Frames queued while the poll found nothing left */
+		smp_mb();
+		if (!skb_queue_empty(&dhd->rx_napi_queue))
+			napi_schedule(napi);
+	} else {
+		dhd->pub.rx_napi_full++;
+	}
+
+	return processed;
+}
+
+#ifdef DHDTHREAD
+static void
+dhd_napi_schedule_on(void *info)
+{
+	dhd_info_t *dhd = (dhd_info_t *)info;
+
+	napi_schedule(&dhd->rx_napi);
+}
+#endif /* DHDTHREAD */
+
+static void
+dhd_napi_schedule(dhd_info_t *dhd, struct sk_buff_head *rxq)
+{
+	unsigned long flags;
+#ifdef DHDTHREAD
+	int cpu = dhd_rx_cpu;
+#endif /* DHDTHREAD */
+
+	spin_lock_irqsave(&dhd->rx_napi_queue.lock, flags);
+	skb_queue_splice_tail_init(rxq, &dhd->rx_napi_queue);
+	spin_unlock_irqrestore(&dhd->rx_napi_queue.lock, flags);
+
+#ifdef DHDTHREAD
+	/* A poll that is pending picks these up before it completes */
+	if (test_bit(NAPI_STATE_SCHED, &dhd->rx_napi.state))
+		return;
+
+	/* Leave the stack to the rx CPU while the DPC goes on with the bus */
+	if (dhd_cpu_usable(cpu) && (cpu != raw_smp_processor_id()) && !irqs_disabled()) {
+		if (smp_call_function_single(cpu, dhd_napi_schedule_on, dhd, 0) == 0) {
+			dhd->pub.rx_napi_remote++;
+			return;
+		}
+	}
+#endif /* DHDTHREAD */
+
+	if (in_interrupt()) {
+		napi_schedule(&dhd->rx_napi);
+	} else {
+		/* Run the softirq right away, as netif_rx_ni() would */
+		local_bh_disable();
+		napi_schedule(&dhd->rx_napi);
+		local_bh_enable();
+	}
+}
+#endif /* DHD_RX_NAPI */
+
 void
 dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 {
@@ -1783,6 +1964,9 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 	void *skbhead = NULL;
 	void *skbprev = NULL;
 #endif /* defined(DHDTHREAD) && defined(RXFRAME_THREAD) */
+#ifdef DHD_RX_NAPI
+	struct sk_buff_head rxq;
+#endif /* DHD_RX_NAPI */
 #ifdef DHD_RX_DUMP
 #ifdef DHD_RX_FULL_DUMP
 	int k;
@@ -1793,6 +1977,9 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
+#ifdef DHD_RX_NAPI
+	__skb_queue_head_init(&rxq);
+#endif /* DHD_RX_NAPI */
 	for (i = 0; pktbuf && i < numpkt; i++, pktbuf = pnext) {
 
 		pnext = PKTNEXT(dhdp->osh, pktbuf);
@@ -1950,6 +2137,9 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		ifp->stats.rx_bytes += skb->len;
 		ifp->stats.rx_packets++;
 
+#ifdef DHD_RX_NAPI
+		__skb_queue_tail(&rxq, skb);
+#else
 		if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
@@ -1977,8 +2167,12 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0) */
 #endif /* defined(DHDTHREAD) && defined(RXFRAME_THREAD) */
 		}
+#endif /* DHD_RX_NAPI */
 	}
-#if defined(DHDTHREAD) && defined(RXFRAME_THREAD)
+#if defined(DHD_RX_NAPI)
+	if (!skb_queue_empty(&rxq))
+		dhd_napi_schedule(dhd, &rxq);
+#elif defined(DHDTHREAD) && defined(RXFRAME_THREAD)
 	if (skbhead)
 		dhd_sched_rxf(dhdp, skbhead);
 #endif
@@ -2095,6 +2289,10 @@ dhd_watchdog_thread(void *data)
 				dhd_os_spin_unlock(&dhd->pub, flags);
 			}
 			dhd_os_sdunlock(&dhd->pub);
+#ifdef DHD_PKT_RECYCLE
+			/* Top up the rx buffers while not holding the bus */
+			osl_pktrecycle_refill(dhd->pub.osh);
+#endif /* DHD_PKT_RECYCLE */
 		} else {
 			break;
 	}
@@ -2140,6 +2338,7 @@ dhd_dpc_thread(void *data)
 {
 	tsk_ctl_t *tsk = (tsk_ctl_t *)data;
 	dhd_info_t *dhd = (dhd_info_t *)tsk->parent;
+	int cpu_gen = -1;
 
 	/* This thread doesn't need any user-level access,
 	 * so get rid of all our resources
@@ -2151,10 +2350,6 @@ dhd_dpc_thread(void *data)
 		setScheduler(current, SCHED_FIFO, &param);
 	}
 
-#ifdef CUSTOM_DPC_CPUCORE
-	set_cpus_allowed_ptr(current, cpumask_of(CUSTOM_DPC_CPUCORE));
-#endif /* CUSTOM_DPC_CPUCORE */
-
 	/* Run until signal received */
 	while (1) {
 		if (!binary_sema_down(tsk)) {
@@ -2163,6 +2358,7 @@ dhd_dpc_thread(void *data)
 			if (tsk->terminated) {
 				break;
 			}
+			dhd_thread_follow_cpu(dhd_dpc_cpu, &cpu_gen);
 
 			/* Call bus dpc unless it indicated down (then clean stop) */
 			if (dhd->pub.busstate != DHD_BUS_DOWN) {
@@ -2192,6 +2388,7 @@ dhd_rxf_thread(void *data)
 	tsk_ctl_t *tsk = (tsk_ctl_t *)data;
 	dhd_info_t *dhd = (dhd_info_t *)tsk->parent;
 	dhd_pub_t *pub = &dhd->pub;
+	int cpu_gen = -1;
 
 	/* This thread doesn't need any user-level access,
 	 * so get rid of all our resources
@@ -2222,6 +2419,7 @@ dhd_rxf_thread(void *data)
 			if (tsk->terminated) {
 				break;
 			}
+			dhd_thread_follow_cpu(dhd_rx_cpu, &cpu_gen);
 			skb = dhd_rxf_dequeue(pub);
 
 			if (skb == NULL) {
@@ -3223,6 +3421,15 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 		goto fail;
 	dhd_state |= DHD_ATTACH_STATE_ADD_IF;
 
+#ifdef DHD_RX_NAPI
+	/* The poll serves the frames of all interfaces, so it is kept on */
+	skb_queue_head_init(&dhd->rx_napi_queue);
+	__skb_queue_head_init(&dhd->rx_napi_batch);
+	netif_napi_add(net, &dhd->rx_napi, dhd_napi_poll,
+		dhd_napi_budget ? dhd_napi_budget : 64);
+	napi_enable(&dhd->rx_napi);
+#endif /* DHD_RX_NAPI */
+
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 31))
 	net->open = NULL;
 #else
@@ -3373,6 +3580,9 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 	KERNEL_VERSION(2, 6, 39)) && defined(CONFIG_PM_SLEEP)
 	register_pm_notifier(&dhd_sleep_pm_notifier);
 #endif /* (LINUX_VERSION >= 2.6.27 && LINUX_VERSION <= 2.6.39 && CONFIG_PM_SLEEP */
+#ifdef DHDTHREAD
+	register_hotcpu_notifier(&dhd_cpu_notifier);
+#endif /* DHDTHREAD */
 
 #if defined(CONFIG_HAS_EARLYSUSPEND) && defined(DHD_USE_EARLYSUSPEND)
 	dhd->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 20;
@@ -4653,6 +4863,13 @@ void dhd_detach(dhd_pub_t *dhdp)
 		int i = 1;
 		dhd_if_t *ifp;
 
+#ifdef DHD_RX_NAPI
+		/* The bus is down already, nothing is queued past this */
+		napi_disable(&dhd->rx_napi);
+		skb_queue_purge(&dhd->rx_napi_queue);
+		__skb_queue_purge(&dhd->rx_napi_batch);
+#endif /* DHD_RX_NAPI */
+
 		/* Cleanup virtual interfaces */
 		for (i = 1; i < DHD_MAX_IFS; i++) {
 			dhd_net_if_lock_local(dhd);
@@ -4725,6 +4942,9 @@ void dhd_detach(dhd_pub_t *dhdp)
 	KERNEL_VERSION(2, 6, 39)) && defined(CONFIG_PM_SLEEP)
 		unregister_pm_notifier(&dhd_sleep_pm_notifier);
 #endif /* (LINUX_VERSION >= 2.6.27 && LINUX_VERSION <= 2.6.39 && CONFIG_PM_SLEEP */
+#ifdef DHDTHREAD
+	unregister_hotcpu_notifier(&dhd_cpu_notifier);
+#endif /* DHDTHREAD */
 
 	if (dhd->dhd_state & DHD_ATTACH_STATE_WAKELOCKS_INIT) {
 		DHD_TRACE(("wd wakelock count:%d\n", dhd->wakelock_wd_counter));
@@ -200,6 +200,15 @@ typedef struct dhd_console {
 #define OVERFLOW_BLKSZ512_MES		80
 
 #define CC_PMUCC3	(0x3)
+
+/* Glom histogram buckets: 1, 2-3, 4-7, 8-15, 16-31 and 32+ packets */
+#define DHD_GLOM_HIST	6
+
+#ifdef BCMSDIOH_TXGLOM
+/* Average frames read per dpc above which rx is considered busy */
+#define DHD_GLOM_RXBUSY	8
+#endif
+
 /* Private data for SDIO bus interaction */
 typedef struct dhd_bus {
 	dhd_pub_t	*dhd;
@@ -341,6 +350,7 @@ typedef struct dhd_bus {
 	uint		rxglomfail;		/* Failed deglom attempts */
 	uint		rxglomframes;		/* Number of glom frames (superframes) */
 	uint		rxglompkts;		/* Number of packets from glom frames */
+	uint		rxglom_hist[DHD_GLOM_HIST];	/* Superframes by packet count */
 	uint		f2rxhdrs;		/* Number of header reads */
 	uint		f2rxdata;		/* Number of frame data reads */
 	uint		f2txdata;		/* Number of f2 frame writes */
@@ -369,6 +379,10 @@ typedef struct dhd_bus {
 	bool		glom_enable;	/* Flag to indicate whether tx glom is enabled/disabled */
 	uint8		glom_mode;	/* Glom mode - 0-copy mode, 1 - Multi-descriptor mode */
 	uint32		glomsize;	/* Glom size limitation */
+	bool		glom_adapt;	/* Let the glom size follow the load */
+	uint		txq_avg;	/* Tx queue depth at send, average x8 */
+	uint		rxframes_avg;	/* Frames read per dpc, average x8 */
+	uint		txglom_hist[DHD_GLOM_HIST];	/* Tx gloms by packet count */
 #endif
 } dhd_bus_t;
 
@@ -2265,6 +2279,46 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 	return ret;
 }
 
+static uint
+dhdsdio_glom_bucket(uint pkts)
+{
+	uint bucket = 0;
+
+	while (pkts > 1 && bucket < DHD_GLOM_HIST - 1) {
+		pkts >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+#ifdef BCMSDIOH_TXGLOM
+/*
+ * Pick the most packets to glom into the next tx transaction.  Every SDIO
+ * transaction costs the host controller a command, a DMA setup and a
+ * completion interrupt whatever its size, so a backlog is best sent in few
+ * large ones; but a glom holds the bus until its last packet is written,
+ * so the size only goes past txglomsize while the queue stays deep, or
+ * while rx superframes keep coming and compete for the bus.
+ */
+static uint
+dhdsdio_txglom_size(dhd_bus_t *bus, uint qlen)
+{
+	uint size;
+
+	if (!bus->glom_adapt)
+		return bus->glomsize;
+
+	bus->txq_avg = bus->txq_avg - (bus->txq_avg >> 3) + qlen;
+
+	if ((bus->rxframes_avg >> 3) >= DHD_GLOM_RXBUSY)
+		size = SDPCM_MAXGLOM_SIZE;
+	else
+		size = MAX(bus->txq_avg >> 3, bus->glomsize);
+
+	return MIN(size, SDPCM_MAXGLOM_SIZE);
+}
+#endif /* BCMSDIOH_TXGLOM */
+
 static uint
 dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 {
@@ -2279,6 +2333,7 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 #ifdef BCMSDIOH_TXGLOM
 	uint i;
 	uint8 glom_cnt;
+	uint qlen;
 #endif
 
 	dhd_pub_t *dhd = bus->dhd;
@@ -2299,8 +2354,9 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 		if (bus->glom_enable) {
 			void *pkttable[SDPCM_MAXGLOM_SIZE];
 			dhd_os_sdlock_txq(bus->dhd);
-			glom_cnt = MIN(DATABUFCNT(bus), bus->glomsize);
-			glom_cnt = MIN(glom_cnt, pktq_mlen(&bus->txq, tx_prec_map));
+			qlen = pktq_mlen(&bus->txq, tx_prec_map);
+			glom_cnt = MIN(DATABUFCNT(bus), dhdsdio_txglom_size(bus, qlen));
+			glom_cnt = MIN(glom_cnt, qlen);
 			glom_cnt = MIN(glom_cnt, maxframes-cnt);
 
 			/* Limiting the size to 2pkts in case of copy */
@@ -2315,6 +2371,7 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 
 			if (glom_cnt == 0)
 				break;
+			bus->txglom_hist[dhdsdio_glom_bucket(glom_cnt)]++;
 			datalen = 0;
 			for (i = 0; i < glom_cnt; i++) {
 				uint datalen_tmp = 0;
@@ -2759,6 +2816,7 @@ enum {
 #endif
 	IOV_TXGLOMSIZE,
 	IOV_TXGLOMMODE,
+	IOV_TXGLOMADAPT,
 	IOV_HANGREPORT
 };
 
@@ -2812,6 +2870,7 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 #endif
 	{"txglomsize", IOV_TXGLOMSIZE, 0, IOVT_UINT32, 0 },
 	{"txglommode", IOV_TXGLOMMODE, 0, IOVT_UINT32, 0 },
+	{"txglomadapt", IOV_TXGLOMADAPT, 0, IOVT_BOOL, 0 },
 	{"fw_hang_report", IOV_HANGREPORT, 0, IOVT_BOOL, 0 },
 	{NULL, 0, 0, 0, 0 }
 };
@@ -2830,6 +2889,17 @@ dhd_dump_pct(struct bcmstrbuf *strbuf, char *desc, uint num, uint div)
 	}
 }
 
+static void
+dhd_dump_glom_hist(struct bcmstrbuf *strbuf, char *desc, uint *hist)
+{
+	int i;
+
+	bcm_bprintf(strbuf, "%s pkts 1/2-3/4-7/8-15/16-31/32+", desc);
+	for (i = 0; i < DHD_GLOM_HIST; i++)
+		bcm_bprintf(strbuf, " %u", hist[i]);
+	bcm_bprintf(strbuf, "\n");
+}
+
 void
 dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 {
@@ -2856,6 +2926,13 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	            bus->fc_rcvd, bus->fc_xoff, bus->fc_xon);
 	bcm_bprintf(strbuf, "rxglomfail %u, rxglomframes %u, rxglompkts %u\n",
 	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts);
+	dhd_dump_glom_hist(strbuf, "rxglom", bus->rxglom_hist);
+#ifdef BCMSDIOH_TXGLOM
+	dhd_dump_glom_hist(strbuf, "txglom", bus->txglom_hist);
+	bcm_bprintf(strbuf, "txglom adapt %d size %u txq avg %u rxframes avg %u\n",
+	            bus->glom_adapt, bus->glomsize, bus->txq_avg >> 3,
+	            bus->rxframes_avg >> 3);
+#endif /* BCMSDIOH_TXGLOM */
 	bcm_bprintf(strbuf, "f2rx (hdrs/data) %u (%u/%u), f2tx %u f1regs %u\n",
 	            (bus->f2rxhdrs + bus->f2rxdata), bus->f2rxhdrs, bus->f2rxdata,
 	            bus->f2txdata, bus->f1regdata);
@@ -2922,6 +2999,10 @@ dhd_bus_clearcounts(dhd_pub_t *dhdp)
 	bus->rx_hdrfail = bus->rx_badhdr = bus->rx_badseq = 0;
 	bus->tx_sderrs = bus->fc_rcvd = bus->fc_xoff = bus->fc_xon = 0;
 	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = 0;
+	bzero(bus->rxglom_hist, sizeof(bus->rxglom_hist));
+#ifdef BCMSDIOH_TXGLOM
+	bzero(bus->txglom_hist, sizeof(bus->txglom_hist));
+#endif
 	bus->f2rxhdrs = bus->f2rxdata = bus->f2txdata = bus->f1regdata = 0;
 }
 
@@ -4067,6 +4148,15 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 				bcmerror = BCME_ERROR;
 		}
 		break;
+
+	case IOV_GVAL(IOV_TXGLOMADAPT):
+		int_val = (int32)bus->glom_adapt;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_TXGLOMADAPT):
+		bus->glom_adapt = bool_val;
+		break;
 #endif /* BCMSDIOH_TXGLOM */
 
 	case IOV_SVAL(IOV_HANGREPORT):
@@ -5318,6 +5408,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 		}
 		bus->rxglomframes++;
 		bus->rxglompkts += num;
+		bus->rxglom_hist[dhdsdio_glom_bucket(num)]++;
 	}
 	return num;
 }
@@ -6205,6 +6296,9 @@ dhdsdio_dpc(dhd_bus_t *bus)
 			intstatus  &= ~FRAME_AVAIL_MASK(bus);
 		rxlimit -= MIN(framecnt, rxlimit);
 	}
+#ifdef BCMSDIOH_TXGLOM
+	bus->rxframes_avg = bus->rxframes_avg - (bus->rxframes_avg >> 3) + framecnt;
+#endif
 
 	/* Keep still-pending events for next scheduling */
 	bus->intstatus = intstatus;
@@ -7324,6 +7418,7 @@ dhdsdio_probe_attach(struct dhd_bus *bus, osl_t *osh, void *sdh, void *regsva,
 	bus->glom_mode = bcmsdh_set_mode(bus->sdh, SDPCM_DEFGLOM_MODE);
 	/* Setting default Glom size */
 	bus->glomsize = SDPCM_DEFGLOM_SIZE;
+	bus->glom_adapt = TRUE;
 #endif
 
 	return TRUE;
@@ -386,6 +386,11 @@ extern void osl_ctfpool_stats(osl_t *osh, void *b);
 #define	PKTISFAST(osh, skb)	(FALSE)
 #endif /* CTFPOOL */
 
+#ifdef DHD_PKT_RECYCLE
+extern void osl_pktrecycle_refill(osl_t *osh);
+extern void osl_pktrecycle_stats(osl_t *osh, void *b);
+#endif /* DHD_PKT_RECYCLE */
+
 #define	PKTSETCTF(osh, skb)
 #define	PKTCLRCTF(osh, skb)
 #define	PKTISCTF(osh, skb)	(FALSE)
@@ -112,6 +112,13 @@ struct osl_info {
 	int ctrace_num;
 #endif /* BCMDBG_CTRACE */
 	spinlock_t pktalloc_lock;
+#ifdef DHD_PKT_RECYCLE
+	struct sk_buff_head recycle;	/* Full sized skbs kept for reuse */
+	uint recycle_hits;
+	uint recycle_misses;
+	uint recycle_frees;
+	uint recycle_refills;
+#endif /* DHD_PKT_RECYCLE */
 };
 
 #define OSL_PKTTAG_CLEAR(p) \
@@ -295,6 +302,9 @@ osl_attach(void *pdev, uint bustype, bool pkttag)
 #endif /* BCMDBG_CTRACE */
 
 	spin_lock_init(&(osh->pktalloc_lock));
+#ifdef DHD_PKT_RECYCLE
+	skb_queue_head_init(&osh->recycle);
+#endif /* DHD_PKT_RECYCLE */
 
 	return osh;
 }
@@ -315,6 +325,9 @@ osl_detach(osl_t *osh)
 #endif
 
 	ASSERT(osh->magic == OS_HANDLE_MAGIC);
+#ifdef DHD_PKT_RECYCLE
+	skb_queue_purge(&osh->recycle);
+#endif /* DHD_PKT_RECYCLE */
 	kfree(osh);
 }
 
@@ -331,6 +344,84 @@ static struct sk_buff *osl_alloc_skb(osl_t *osh, unsigned int len)
 	return skb;
 }
 
+#ifdef DHD_PKT_RECYCLE
+/*
+ * Buffers for full sized frames are taken from a pool of skbs rather
+ * than from the allocator each time.  The driver's own packets go back
+ * to the pool when they are freed, if they are big enough and nobody
+ * else holds them.  osl_pktrecycle_refill() also tops the pool up from
+ * process context.  Together they keep a burst of receives off atomic
+ * allocations from the kmalloc-4096 slabs, which are high order.
+ */
+#define OSL_RECYCLE_BUFSZ	2048	/* An MTU frame with the bus headers */
+#define OSL_RECYCLE_MINSZ	512	/* Smaller buffers come from the allocator */
+#define OSL_RECYCLE_MAX		64	/* Most skbs kept in the pool */
+#define OSL_RECYCLE_LOW		16	/* The refill tops the pool up to this */
+
+static struct sk_buff *
+osl_pktrecycle_get(osl_t *osh, uint len)
+{
+	struct sk_buff *skb;
+
+	if (len < OSL_RECYCLE_MINSZ || len > OSL_RECYCLE_BUFSZ)
+		return NULL;
+
+	if ((skb = skb_dequeue(&osh->recycle)) != NULL) {
+		osh->recycle_hits++;
+		return skb;
+	}
+
+	/* Allocate it full sized so that it can come back to the pool */
+	osh->recycle_misses++;
+	return osl_alloc_skb(osh, OSL_RECYCLE_BUFSZ);
+}
+
+static bool
+osl_pktrecycle_put(osl_t *osh, struct sk_buff *skb)
+{
+	/* The destructor of a tx skb must not run in hard irq */
+	if (in_irq() || skb_queue_len(&osh->recycle) >= OSL_RECYCLE_MAX)
+		return FALSE;
+
+	if (!skb_recycle_check(skb, OSL_RECYCLE_BUFSZ))
+		return FALSE;
+
+	skb_queue_tail(&osh->recycle, skb);
+	osh->recycle_frees++;
+	return TRUE;
+}
+
+/* Called from process context, outside the bus lock */
+void
+osl_pktrecycle_refill(osl_t *osh)
+{
+	struct sk_buff *skb;
+
+	if ((osh == NULL) || in_atomic() || irqs_disabled())
+		return;
+
+	while (skb_queue_len(&osh->recycle) < OSL_RECYCLE_LOW) {
+		if ((skb = __dev_alloc_skb(OSL_RECYCLE_BUFSZ, GFP_KERNEL)) == NULL)
+			break;
+		skb_queue_tail(&osh->recycle, skb);
+		osh->recycle_refills++;
+	}
+}
+
+void
+osl_pktrecycle_stats(osl_t *osh, void *b)
+{
+	struct bcmstrbuf *bb = b;
+
+	if (osh == NULL)
+		return;
+
+	bcm_bprintf(bb, "recycle pool %u hits %u misses %u frees %u refills %u\n",
+	            skb_queue_len(&osh->recycle), osh->recycle_hits,
+	            osh->recycle_misses, osh->recycle_frees, osh->recycle_refills);
+}
+#endif /* DHD_PKT_RECYCLE */
+
 #ifdef CTFPOOL
 
 #ifdef CTFPOOL_SPINLOCK
@@ -635,15 +726,17 @@ void * BCMFASTPATH
 osl_pktget(osl_t *osh, uint len)
 #endif /* BCMDBG_CTRACE */
 {
-	struct sk_buff *skb;
+	struct sk_buff *skb = NULL;
 
 #ifdef CTFPOOL
 	/* Allocate from local pool */
 	skb = osl_pktfastget(osh, len);
-	if ((skb != NULL) || ((skb = osl_alloc_skb(osh, len)) != NULL)) {
-#else /* CTFPOOL */
-	if ((skb = osl_alloc_skb(osh, len))) {
 #endif /* CTFPOOL */
+#ifdef DHD_PKT_RECYCLE
+	if (skb == NULL)
+		skb = osl_pktrecycle_get(osh, len);
+#endif /* DHD_PKT_RECYCLE */
+	if ((skb != NULL) || ((skb = osl_alloc_skb(osh, len)) != NULL)) {
 		skb->tail += len;
 		skb->len  += len;
 		skb->priority = 0;
@@ -741,6 +834,10 @@ osl_pktfree(osl_t *osh, void *p, bool send)
 		} else
 #endif
 		{
+#ifdef DHD_PKT_RECYCLE
+			if (osl_pktrecycle_put(osh, skb))
+				goto next_skb;
+#endif /* DHD_PKT_RECYCLE */
 			if (skb->destructor)
 				/* cannot kfree_skb() on hard IRQ (net/core/skbuff.c) if
 				 * destructor exists
@@ -752,7 +849,7 @@ osl_pktfree(osl_t *osh, void *p, bool send)
 				 */
 				dev_kfree_skb(skb);
 		}
-#ifdef CTFPOOL
+#if defined(CTFPOOL) || defined(DHD_PKT_RECYCLE)
 next_skb:
 #endif
 		atomic_dec(&osh->pktalloced);
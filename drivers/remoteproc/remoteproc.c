@@ -39,12 +39,24 @@
 #include <linux/uaccess.h>
 #include <linux/elf.h>
 #include <linux/elfcore.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
 #include <plat/remoteproc.h>
 
 /* list of available remote processors on this board */
 static LIST_HEAD(rprocs);
 static DEFINE_SPINLOCK(rprocs_lock);
 
+/*
+ * Keep a remote processor running after its last user is gone, so that the
+ * next rproc_get() doesn't have to load and boot its firmware again.  It
+ * idles out through runtime suspend like it would with users, and is only
+ * stopped for real when the system runs short of memory.
+ */
+static bool retain = true;
+module_param(retain, bool, 0644);
+MODULE_PARM_DESC(retain, "Keep remote processors loaded after their last user");
+
 /* debugfs parent dir */
 static struct dentry *rproc_dbg;
 
@@ -529,6 +541,50 @@ DEBUGFS_READONLY_FILE(cdump1, rproc->cdump_buf1, rproc->cdump_len1);
 	debugfs_create_file(#name, 0444, rproc->dbg_dir,		\
 			rproc, &name## _rproc_ops)
 
+static void rproc_account_resume(struct rproc *rproc,
+				 enum rproc_resume_mode mode, ktime_t start)
+{
+	struct rproc_resume_stats *rs = &rproc->resume_stats[mode];
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	if (us < 0)
+		us = 0;
+
+	rs->count++;
+	rs->total_us += us;
+	if (us > rs->max_us)
+		rs->max_us = us;
+}
+
+static ssize_t rproc_resume_read(struct file *filp, char __user *userbuf,
+						size_t count, loff_t *ppos)
+{
+	static const char *modes[RPROC_RESUME_MODES] = {
+		"cold", "warm", "runtime",
+	};
+	struct rproc *rproc = filp->private_data;
+	char buf[128], *p = buf;
+	int i;
+
+	p += sprintf(p, "%-8s %8s %10s %10s\n", "mode", "count", "avg us",
+								"max us");
+	for (i = 0; i < RPROC_RESUME_MODES; i++) {
+		struct rproc_resume_stats *rs = &rproc->resume_stats[i];
+
+		p += sprintf(p, "%-8s %8lu %10llu %10u\n", modes[i], rs->count,
+			rs->count ? div_u64(rs->total_us, rs->count) : 0ULL,
+			rs->max_us);
+	}
+
+	return simple_read_from_buffer(userbuf, count, ppos, buf, p - buf);
+}
+
+static const struct file_operations rproc_resume_ops = {
+	.read = rproc_resume_read,
+	.open = rproc_open_generic,
+	.llseek	= generic_file_llseek,
+};
+
 /**
  * __find_rproc_by_name - find a registered remote processor by name
  * @name: name of the remote processor
@@ -633,6 +689,9 @@ static int _event_notify(struct rproc *rproc, int type, void *data)
 			return 0;
 		}
 		rproc_crash(rproc);
+		/* no user is left to put it and complete the recovery */
+		if (rproc->retained)
+			schedule_work(&rproc->release_work);
 		mutex_unlock(&rproc->lock);
 		/* If halt_on_crash do not notify the error */
 		pr_info("remoteproc: %s has crashed\n", rproc->name);
@@ -705,6 +764,7 @@ static void rproc_start(struct rproc *rproc, u64 bootaddr)
 #endif
 
 	rproc->state = RPROC_RUNNING;
+	rproc_account_resume(rproc, RPROC_RESUME_COLD, rproc->load_start);
 
 	dev_info(dev, "remote processor %s is now up\n", rproc->name);
 	rproc->secure_ok = true;
@@ -1294,10 +1354,24 @@ struct rproc *rproc_get(const char *name)
 		goto unlock_mutex;
 	}
 
+	/* or if it was kept running since its last user left */
+	if (rproc->retained) {
+		ktime_t start = ktime_get();
+
+		rproc->retained = false;
+		/* it still holds the owner reference of its last rproc_get() */
+		module_put(rproc->owner);
+		rproc_account_resume(rproc, RPROC_RESUME_WARM, start);
+		dev_info(dev, "%s was kept loaded\n", name);
+		ret = rproc;
+		goto unlock_mutex;
+	}
+
 	/* rproc_put() calls should wait until async loader completes */
 	init_completion(&rproc->firmware_loading_complete);
 
 	dev_info(dev, "powering up %s\n", name);
+	rproc->load_start = ktime_get();
 
 	err = rproc_loader(rproc);
 	if (err) {
@@ -1317,32 +1391,17 @@ unlock_mutex:
 }
 EXPORT_SYMBOL_GPL(rproc_get);
 
-void rproc_put(struct rproc *rproc)
+/*
+ * Stop a remote processor and release what it was loaded with.  Called with
+ * rproc->lock held, once the last user is gone.
+ */
+static int rproc_shutdown(struct rproc *rproc)
 {
 	struct device *dev = rproc->dev;
-	int ret;
-
-	/* make sure rproc is not loading now */
-	wait_for_completion(&rproc->firmware_loading_complete);
-
-	ret = mutex_lock_interruptible(&rproc->lock);
-	if (ret) {
-		dev_err(dev, "can't lock rproc %s: %d\n", rproc->name, ret);
-		return;
-	}
-
-	if (!rproc->count) {
-		dev_warn(dev, "asymmetric rproc_put\n");
-		ret = -EINVAL;
-		goto out;
-	}
-
-	/* if the remote proc is still needed, bail out */
-	if (--rproc->count)
-		goto out;
+	int ret = 0;
 
 	if (mutex_lock_interruptible(&rproc->tlock))
-		goto out;
+		return -ERESTARTSYS;
 
 	if (rproc->trace_buf0)
 		/* iounmap normal memory, so make sparse happy */
@@ -1388,14 +1447,14 @@ void rproc_put(struct rproc *rproc)
 		if (ret) {
 			dev_err(dev, "can't stop rproc %s: %d\n", rproc->name,
 									ret);
-			goto out;
+			return ret;
 		}
 		if (rproc->ops->watchdog_exit) {
 			ret = rproc->ops->watchdog_exit(rproc);
 			if (ret) {
 				dev_err(rproc->dev, "error watchdog_exit %d\n",
 					ret);
-				goto out;
+				return ret;
 			}
 		}
 		if (rproc->ops->iommu_exit) {
@@ -1403,7 +1462,7 @@ void rproc_put(struct rproc *rproc)
 			if (ret) {
 				dev_err(rproc->dev, "error iommu_exit %d\n",
 					ret);
-				goto out;
+				return ret;
 			}
 		}
 	}
@@ -1415,6 +1474,65 @@ void rproc_put(struct rproc *rproc)
 
 	dev_info(dev, "stopped remote processor %s\n", rproc->name);
 
+	return 0;
+}
+
+/* whether to keep @rproc running without users, see 'retain' */
+static bool rproc_may_retain(struct rproc *rproc)
+{
+	return retain && rproc->state == RPROC_RUNNING && !rproc->secure_mode;
+}
+
+static void rproc_release_work(struct work_struct *work)
+{
+	struct rproc *rproc = container_of(work, struct rproc, release_work);
+	int ret = -EBUSY;
+
+	mutex_lock(&rproc->lock);
+	if (rproc->retained && !rproc->count) {
+		rproc->retained = false;
+		ret = rproc_shutdown(rproc);
+	}
+	mutex_unlock(&rproc->lock);
+
+	if (!ret)
+		module_put(rproc->owner);
+}
+
+void rproc_put(struct rproc *rproc)
+{
+	struct device *dev = rproc->dev;
+	int ret;
+
+	/* make sure rproc is not loading now */
+	wait_for_completion(&rproc->firmware_loading_complete);
+
+	ret = mutex_lock_interruptible(&rproc->lock);
+	if (ret) {
+		dev_err(dev, "can't lock rproc %s: %d\n", rproc->name, ret);
+		return;
+	}
+
+	if (!rproc->count) {
+		dev_warn(dev, "asymmetric rproc_put\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* if the remote proc is still needed, bail out */
+	if (--rproc->count)
+		goto out;
+
+	if (rproc_may_retain(rproc)) {
+		/* the owner reference stays with the running processor */
+		rproc->retained = true;
+		dev_info(dev, "keeping %s loaded\n", rproc->name);
+		mutex_unlock(&rproc->lock);
+		return;
+	}
+
+	ret = rproc_shutdown(rproc);
+
 out:
 	mutex_unlock(&rproc->lock);
 	if (!ret)
@@ -1464,7 +1582,15 @@ void rproc_last_busy(struct rproc *rproc)
 			return;
 		}
 		mutex_unlock(&rproc->lock);
-		pm_runtime_get_sync(dev);
+		if (pm_runtime_suspended(dev)) {
+			ktime_t start = ktime_get();
+
+			pm_runtime_get_sync(dev);
+			rproc_account_resume(rproc, RPROC_RESUME_RUNTIME,
+									start);
+		} else {
+			pm_runtime_get_sync(dev);
+		}
 		pm_runtime_mark_last_busy(dev);
 		pm_runtime_put_autosuspend(dev);
 		return;
@@ -1713,6 +1839,7 @@ int rproc_register(struct device *dev, const char *name,
 	mutex_init(&rproc->secure_lock);
 	mutex_init(&rproc->tlock);
 	INIT_WORK(&rproc->error_work, rproc_error_work);
+	INIT_WORK(&rproc->release_work, rproc_release_work);
 	BLOCKING_INIT_NOTIFIER_HEAD(&rproc->nbh);
 
 	rproc->state = RPROC_OFFLINE;
@@ -1750,6 +1877,8 @@ int rproc_register(struct device *dev, const char *name,
 
 	debugfs_create_file("name", 0444, rproc->dbg_dir, rproc,
 							&rproc_name_ops);
+	debugfs_create_file("resume", 0444, rproc->dbg_dir, rproc,
+							&rproc_resume_ops);
 
 out:
 	return 0;
@@ -1775,6 +1904,8 @@ int rproc_unregister(const char *name)
 	list_del(&rproc->next);
 	spin_unlock(&rprocs_lock);
 
+	cancel_work_sync(&rproc->release_work);
+
 	rproc->secure_mode = false;
 	rproc->secure_ttb = NULL;
 	pm_qos_remove_request(rproc->qos_request);
@@ -1787,6 +1918,35 @@ int rproc_unregister(const char *name)
 }
 EXPORT_SYMBOL_GPL(rproc_unregister);
 
+/*
+ * Under memory pressure, stop the processors that are only kept loaded
+ * because of 'retain'.  The next rproc_get() cold boots them again.
+ */
+static int rproc_shrink(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct rproc *rproc;
+	int nr = 0;
+
+	spin_lock(&rprocs_lock);
+	list_for_each_entry(rproc, &rprocs, next) {
+		if (!rproc->retained)
+			continue;
+		if (sc->nr_to_scan)
+			schedule_work(&rproc->release_work);
+		else
+			nr++;
+	}
+	spin_unlock(&rprocs_lock);
+
+	return nr;
+}
+
+static struct shrinker rproc_shrinker = {
+	.shrink = rproc_shrink,
+	.seeks = DEFAULT_SEEKS,
+	.batch = 1,
+};
+
 static int __init remoteproc_init(void)
 {
 	if (debugfs_initialized()) {
@@ -1795,6 +1955,8 @@ static int __init remoteproc_init(void)
 			pr_err("can't create debugfs dir\n");
 	}
 
+	register_shrinker(&rproc_shrinker);
+
 	return 0;
 }
 /* must be ready in time for device_initcall users */
@@ -1802,6 +1964,7 @@ subsys_initcall(remoteproc_init);
 
 static void __exit remoteproc_exit(void)
 {
+	unregister_shrinker(&rproc_shrinker);
 	if (rproc_dbg)
 		debugfs_remove(rproc_dbg);
 }
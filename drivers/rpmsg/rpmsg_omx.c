@@ -49,6 +49,9 @@ extern struct ion_device *omap_ion_device;
 /* maximum OMX devices this driver can handle */
 #define MAX_OMX_DEVICES		8
 
+/* ION buffers whose device address an instance remembers */
+#define OMX_MAP_CACHE_SIZE	32
+
 enum rpc_omx_map_info_type {
 	RPC_OMX_MAP_INFO_NONE          = 0,
 	RPC_OMX_MAP_INFO_ONE_BUF       = 1,
@@ -77,6 +80,15 @@ struct rpmsg_omx_service {
 #endif
 };
 
+/*
+ * A buffer passed in a message, as an ION handle of the instance's client,
+ * and the device address it was translated to.
+ */
+struct rpmsg_omx_map {
+	long buffer;
+	u32 da;
+};
+
 struct rpmsg_omx_instance {
 	struct list_head next;
 	struct rpmsg_omx_service *omxserv;
@@ -89,6 +101,9 @@ struct rpmsg_omx_instance {
 	int state;
 #ifdef CONFIG_ION_OMAP
 	struct ion_client *ion_client;
+	struct mutex map_lock;
+	struct rpmsg_omx_map maps[OMX_MAP_CACHE_SIZE];
+	int map_next;
 #endif
 };
 
@@ -129,6 +144,48 @@ static int _rpmsg_pa_to_da(u32 pa, u32 *da)
 	return ret;
 }
 
+#ifdef CONFIG_ION_OMAP
+/*
+ * The same few video buffers go by in every frame, so remember what their
+ * ION handles translated to, rather than going through ion_phys() for each
+ * message.  A handle stays valid until it is freed through this instance,
+ * and the entry is dropped then.  Called with map_lock held.
+ */
+static struct rpmsg_omx_map *
+_rpmsg_omx_map_find(struct rpmsg_omx_instance *omx, long buffer)
+{
+	int i;
+
+	/* 0 marks the free entries */
+	if (!buffer)
+		return NULL;
+
+	for (i = 0; i < OMX_MAP_CACHE_SIZE; i++)
+		if (omx->maps[i].buffer == buffer)
+			return &omx->maps[i];
+
+	return NULL;
+}
+
+static void _rpmsg_omx_map_add(struct rpmsg_omx_instance *omx, long buffer,
+								u32 da)
+{
+	struct rpmsg_omx_map *map = &omx->maps[omx->map_next];
+
+	map->buffer = buffer;
+	map->da = da;
+	omx->map_next = (omx->map_next + 1) % OMX_MAP_CACHE_SIZE;
+}
+
+static void _rpmsg_omx_map_drop(struct rpmsg_omx_instance *omx, long buffer)
+{
+	struct rpmsg_omx_map *map = _rpmsg_omx_map_find(omx, buffer);
+
+	if (map)
+		map->buffer = 0;
+}
+#endif
+
 static int _rpmsg_omx_buffer_lookup(struct rpmsg_omx_instance *omx,
 					long buffer, u32 *va)
 {
@@ -138,15 +195,28 @@ static int _rpmsg_omx_buffer_lookup(struct rpmsg_omx_instance *omx,
 
 #ifdef CONFIG_ION_OMAP
 	{
+		struct rpmsg_omx_map *map;
 		struct ion_handle *handle;
 		ion_phys_addr_t paddr;
 		size_t unused;
 
+		mutex_lock(&omx->map_lock);
+		map = _rpmsg_omx_map_find(omx, buffer);
+		if (map) {
+			*va = map->da;
+			mutex_unlock(&omx->map_lock);
+			return 0;
+		}
+
 		handle = (struct ion_handle *)buffer;
 		if (!ion_phys(omx->ion_client, handle, &paddr, &unused)) {
 			ret = _rpmsg_pa_to_da((phys_addr_t)paddr, va);
+			if (!ret)
+				_rpmsg_omx_map_add(omx, buffer, *va);
+			mutex_unlock(&omx->map_lock);
 			goto exit;
 		}
+		mutex_unlock(&omx->map_lock);
 	}
 #endif
 	ret =  _rpmsg_pa_to_da((phys_addr_t)tiler_virt2phys(buffer), va);
@@ -417,7 +487,10 @@ long rpmsg_omx_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 				_IOC_NR(cmd), ret);
 			return -EFAULT;
 		}
+		mutex_lock(&omx->map_lock);
+		_rpmsg_omx_map_drop(omx, (long)data.handle);
 		ion_free(omx->ion_client, data.handle);
+		mutex_unlock(&omx->map_lock);
 		if (copy_to_user((char __user *) arg, &data, sizeof(data))) {
 			dev_err(omxserv->dev,
 				"%s: %d: copy_to_user fail: %d\n", __func__,
@@ -470,6 +543,7 @@ static int rpmsg_omx_open(struct inode *inode, struct file *filp)
 					    (1 << ION_HEAP_TYPE_CARVEOUT) |
 					    (1 << OMAP_ION_HEAP_TYPE_TILER),
 					    "rpmsg-omx");
+	mutex_init(&omx->map_lock);
 #endif
 
 	init_completion(&omx->reply_arrived);
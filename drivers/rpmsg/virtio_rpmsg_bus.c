@@ -30,6 +30,8 @@
 #include <linux/jiffies.h>
 #include <linux/sched.h>
 #include <linux/wait.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/rpmsg.h>
 
 /**
@@ -100,6 +102,25 @@ rpmsg_show_attr(dst, dst, "0x%x\n");
 rpmsg_show_attr(src, src, "0x%x\n");
 rpmsg_show_attr(announce, announce ? "true" : "false", "%s\n");
 
+/*
+ * tx: <msgs> <kicks> <bytes> <avg usecs> <max usecs>, then
+ * rx: <msgs> <bytes> <avg usecs> <max usecs>
+ */
+static ssize_t stats_show(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct rpmsg_channel *rpdev = to_rpmsg_channel(dev);
+	struct rpmsg_stats *tx = &rpdev->tx, *rx = &rpdev->rx;
+
+	return sprintf(buf, "%lu %lu %llu %llu %u %lu %llu %llu %u\n",
+		tx->msgs, rpdev->tx_kicks, (unsigned long long)tx->bytes,
+		tx->msgs ? (unsigned long long)div_u64(tx->usecs, tx->msgs) : 0,
+		tx->max_usecs,
+		rx->msgs, (unsigned long long)rx->bytes,
+		rx->msgs ? (unsigned long long)div_u64(rx->usecs, rx->msgs) : 0,
+		rx->max_usecs);
+}
+
 /* unique (free running) numbering for rpmsg devices */
 static unsigned int rpmsg_dev_index;
 
@@ -117,6 +138,7 @@ static struct device_attribute rpmsg_dev_attrs[] = {
 	__ATTR_RO(dst),
 	__ATTR_RO(src),
 	__ATTR_RO(announce),
+	__ATTR_RO(stats),
 	__ATTR_NULL
 };
 
@@ -432,8 +454,43 @@ static void *get_a_buf(struct virtproc_info *vrp)
 	return buf;
 }
 
-/* XXX: the blocking 'wait' mechanism hasn't been tested yet */
-int rpmsg_send_offchannel_raw(struct rpmsg_channel *rpdev, u32 src, u32 dst,
+/* time since @start, in usecs, for the stats */
+static u32 rpmsg_usecs_since(ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	return us > 0 ? (u32)us : 0;
+}
+
+static void rpmsg_account(struct rpmsg_stats *st, int msgs, int bytes,
+							ktime_t start)
+{
+	u32 us = rpmsg_usecs_since(start);
+
+	st->msgs += msgs;
+	st->bytes += bytes;
+	st->usecs += us;
+	if (us > st->max_usecs)
+		st->max_usecs = us;
+}
+
+/* tell the remote processor about the messages added since the last kick */
+static void rpmsg_kick(struct virtproc_info *vrp, struct rpmsg_channel *rpdev)
+{
+	/* descriptors must be written before kicking remote processor */
+	wmb();
+
+	virtqueue_kick(vrp->svq);
+	rpdev->tx_kicks++;
+}
+
+/*
+ * Put one message in the tx vring, without telling the remote processor.
+ * Must be called with svq_lock held.
+ *
+ * XXX: the blocking 'wait' mechanism hasn't been tested yet
+ */
+static int rpmsg_queue_msg(struct rpmsg_channel *rpdev, u32 src, u32 dst,
 					void *data, int len, bool wait)
 {
 	struct virtproc_info *vrp = rpdev->vrp;
@@ -444,29 +501,16 @@ int rpmsg_send_offchannel_raw(struct rpmsg_channel *rpdev, u32 src, u32 dst,
 	unsigned long offset;
 	void *sim_addr;
 
-	if (src == RPMSG_ADDR_ANY || dst == RPMSG_ADDR_ANY) {
-		dev_err(dev, "invalid addr (src 0x%x, dst 0x%x)\n", src, dst);
-		return -EINVAL;
-	}
-
 	/* the payload's size is currently limited */
 	if (len > vrp->buf_size - sizeof(struct rpmsg_hdr)) {
 		dev_err(dev, "message is too big (%d)\n", len);
 		return -EMSGSIZE;
 	}
 
-	/*
-	 * protect svq from simultaneous concurrent manipulations,
-	 * and serialize the sending of messages
-	 */
-	if (mutex_lock_interruptible(&vrp->svq_lock))
-		return -ERESTARTSYS;
 	/* grab a buffer */
 	msg = get_a_buf(vrp);
-	if (!msg && !wait) {
-		err = -ENOMEM;
-		goto out;
-	}
+	if (!msg && !wait)
+		return -ENOMEM;
 
 	/* no free buffer ? wait for one (but bail after 15 seconds) */
 	if (!msg) {
@@ -486,15 +530,12 @@ int rpmsg_send_offchannel_raw(struct rpmsg_channel *rpdev, u32 src, u32 dst,
 		/* on success, suppress "tx-complete" interrupts again */
 		virtqueue_disable_cb(vrp->svq);
 
-		if (err < 0) {
-			err = -ERESTARTSYS;
-			goto out;
-		}
+		if (err < 0)
+			return -ERESTARTSYS;
 
 		if (!msg) {
 			dev_err(dev, "timeout waiting for buffer\n");
-			err = -ETIMEDOUT;
-			goto out;
+			return -ETIMEDOUT;
 		}
 	}
 
@@ -521,41 +562,110 @@ int rpmsg_send_offchannel_raw(struct rpmsg_channel *rpdev, u32 src, u32 dst,
 	err = virtqueue_add_buf_gfp(vrp->svq, &sg, 1, 0, msg, GFP_KERNEL);
 	if (err < 0) {
 		dev_err(dev, "virtqueue_add_buf_gfp failed: %d\n", err);
-		goto out;
+		return err;
 	}
-	/* descriptors must be written before kicking remote processor */
-	wmb();
 
-	/* tell the remote processor it has a pending message to read */
-	virtqueue_kick(vrp->svq);
+	return 0;
+}
+
+int rpmsg_send_offchannel_raw(struct rpmsg_channel *rpdev, u32 src, u32 dst,
+					void *data, int len, bool wait)
+{
+	struct virtproc_info *vrp = rpdev->vrp;
+	ktime_t start = ktime_get();
+	int err;
+
+	if (src == RPMSG_ADDR_ANY || dst == RPMSG_ADDR_ANY) {
+		dev_err(&rpdev->dev, "invalid addr (src 0x%x, dst 0x%x)\n",
+								src, dst);
+		return -EINVAL;
+	}
+
+	/*
+	 * protect svq from simultaneous concurrent manipulations,
+	 * and serialize the sending of messages
+	 */
+	if (mutex_lock_interruptible(&vrp->svq_lock))
+		return -ERESTARTSYS;
+
+	err = rpmsg_queue_msg(rpdev, src, dst, data, len, wait);
+	if (!err) {
+		/* tell the remote processor it has a pending message to read */
+		rpmsg_kick(vrp, rpdev);
+		rpmsg_account(&rpdev->tx, 1, len, start);
+	}
 
-	err = 0;
-out:
 	mutex_unlock(&vrp->svq_lock);
 	return err;
 }
 EXPORT_SYMBOL(rpmsg_send_offchannel_raw);
 
-static void rpmsg_recv_done(struct virtqueue *rvq)
+/*
+ * Send the messages of @vec in order, all from @src to @dst, and notify the
+ * remote processor once for the lot rather than once per message: each
+ * notification is a mailbox interrupt on the remote side.
+ *
+ * Stops at the first message that can't be sent, and returns the number
+ * sent before it, or its error if it was the first.
+ */
+int rpmsg_send_offchannel_batch(struct rpmsg_channel *rpdev, u32 src, u32 dst,
+					struct kvec *vec, int n, bool wait)
+{
+	struct virtproc_info *vrp = rpdev->vrp;
+	ktime_t start = ktime_get();
+	int i, kicked = 0, bytes = 0, err = 0;
+
+	if (src == RPMSG_ADDR_ANY || dst == RPMSG_ADDR_ANY) {
+		dev_err(&rpdev->dev, "invalid addr (src 0x%x, dst 0x%x)\n",
+								src, dst);
+		return -EINVAL;
+	}
+
+	if (mutex_lock_interruptible(&vrp->svq_lock))
+		return -ERESTARTSYS;
+
+	for (i = 0; i < n; i++) {
+		err = rpmsg_queue_msg(rpdev, src, dst, vec[i].iov_base,
+						vec[i].iov_len, false);
+		if (err == -ENOMEM && wait) {
+			/*
+			 * the remote processor only gives back the buffers of
+			 * messages it knows about: tell it about the ones
+			 * queued so far before waiting for one of them.
+			 */
+			if (kicked < i) {
+				rpmsg_kick(vrp, rpdev);
+				kicked = i;
+			}
+			err = rpmsg_queue_msg(rpdev, src, dst, vec[i].iov_base,
+							vec[i].iov_len, true);
+		}
+		if (err)
+			break;
+		bytes += vec[i].iov_len;
+	}
+
+	if (kicked < i)
+		rpmsg_kick(vrp, rpdev);
+	if (i)
+		rpmsg_account(&rpdev->tx, i, bytes, start);
+
+	mutex_unlock(&vrp->svq_lock);
+	return i ? i : err;
+}
+EXPORT_SYMBOL(rpmsg_send_offchannel_batch);
+
+/* hand a received message to its endpoint, and give the buffer back */
+static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
+			     struct rpmsg_hdr *msg, unsigned int len,
+			     ktime_t start)
 {
-	struct rpmsg_hdr *msg;
-	unsigned int len;
 	struct rpmsg_endpoint *ept;
 	struct scatterlist sg;
 	unsigned long offset;
 	void *sim_addr;
-	struct virtproc_info *vrp = rvq->vdev->priv;
-	struct device *dev = &rvq->vdev->dev;
 	int err;
 
-	/* make sure the descriptors are updated before reading */
-	rmb();
-	msg = virtqueue_get_buf(rvq, &len);
-	if (!msg) {
-		dev_err(dev, "uhm, incoming signal, but no used buffer ?\n");
-		return;
-	}
-
 	dev_dbg(dev, "From: 0x%x, To: 0x%x, Len: %d, Flags: %d, Unused: %d\n",
 					msg->src, msg->dst, msg->len,
 					msg->flags, msg->unused);
@@ -569,9 +679,12 @@ static void rpmsg_recv_done(struct virtqueue *rvq)
 	ept = idr_find(&vrp->endpoints, msg->dst);
 	spin_unlock(&vrp->endpoints_lock);
 
-	if (ept && ept->cb)
+	if (ept && ept->cb) {
 		ept->cb(ept->rpdev, msg->data, msg->len, ept->priv, msg->src);
-	else
+		/* the name service endpoint has no channel */
+		if (ept->rpdev)
+			rpmsg_account(&ept->rpdev->rx, 1, msg->len, start);
+	} else
 		dev_warn(dev, "msg received with no recepient\n");
 
 	/* add the buffer back to the remote processor's virtqueue */
@@ -580,15 +693,68 @@ static void rpmsg_recv_done(struct virtqueue *rvq)
 	sg_init_one(&sg, sim_addr, sizeof(*msg) + len);
 
 	err = virtqueue_add_buf_gfp(vrp->rvq, &sg, 0, 1, msg, GFP_KERNEL);
-	if (err < 0) {
+	if (err < 0)
 		dev_err(dev, "failed to add a virtqueue buffer: %d\n", err);
-		return;
-	}
-	/* descriptors must be written before kicking remote processor */
-	wmb();
 
-	/* tell the remote processor we added another available rx buffer */
-	virtqueue_kick(vrp->rvq);
+	return err;
+}
+
+/* messages handled before the rx buffers are given back and we resched */
+#define RPMSG_RX_BUDGET		(16)
+
+/*
+ * The remote processor sends a bunch of messages for each video frame, so
+ * rather than taking an interrupt for each of them, ask it not to interrupt
+ * us while we go through whatever it has sent, the way NAPI does, and only
+ * turn the interrupt back on once the vring is empty.
+ */
+static void rpmsg_recv_done(struct virtqueue *rvq)
+{
+	struct rpmsg_hdr *msg;
+	unsigned int len, last;
+	struct virtproc_info *vrp = rvq->vdev->priv;
+	struct device *dev = &rvq->vdev->dev;
+	ktime_t start;
+	int added = 0, total = 0;
+
+	virtqueue_disable_cb(rvq);
+	do {
+		start = ktime_get();
+
+		/* make sure the descriptors are updated before reading */
+		rmb();
+		while ((msg = virtqueue_get_buf(rvq, &len))) {
+			if (!rpmsg_recv_single(vrp, dev, msg, len, start))
+				added++;
+			total++;
+
+			if (added == RPMSG_RX_BUDGET) {
+				/* descriptors must be written before kicking */
+				wmb();
+				virtqueue_kick(rvq);
+				added = 0;
+				cond_resched();
+				start = ktime_get();
+			}
+		}
+
+		last = virtqueue_enable_cb_prepare(rvq);
+		if (!virtqueue_poll(rvq, last))
+			break;
+		/* more came in while we turned interrupts back on */
+		virtqueue_disable_cb(rvq);
+	} while (1);
+
+	if (!total)
+		dev_dbg(dev, "uhm, incoming signal, but no used buffer ?\n");
+
+	if (added) {
+		/* descriptors must be written before kicking remote processor */
+		wmb();
+
+		/* tell the remote processor we added available rx buffers */
+		virtqueue_kick(rvq);
+	}
 }
 
 static void rpmsg_xmit_done(struct virtqueue *svq)
@@ -34,10 +34,13 @@
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
 #include <linux/security.h>
+#include <linux/hrtimer.h>
+#include <linux/log2_hist.h>
 
 #include "binder.h"
+#include "binder_trace.h"
 
-static DEFINE_MUTEX(binder_lock);
+static DEFINE_MUTEX(binder_main_lock);
 static DEFINE_MUTEX(binder_deferred_lock);
 static DEFINE_MUTEX(binder_mmap_lock);
 
@@ -52,6 +55,55 @@ static uid_t binder_context_mgr_uid = -1;
 static int binder_last_id;
 static struct workqueue_struct *binder_deferred_workqueue;
 
+/*
+ * Contention on binder_main_lock, updated by the lock holder.  Times are
+ * local_clock() nanoseconds; the holder with the longest hold time is
+ * remembered by the tag it passed to binder_lock().
+ */
+static struct binder_lock_stats {
+	unsigned long acquired;
+	unsigned long contended;
+	u64 wait_ns;
+	u64 max_wait_ns;
+	u64 max_hold_ns;
+	const char *max_hold_tag;
+} binder_lock_stats;
+
+static u64 binder_lock_time;
+static const char *binder_lock_tag;
+
+static void binder_lock(const char *tag)
+{
+	u64 start, wait;
+
+	trace_binder_lock(tag);
+	if (!mutex_trylock(&binder_main_lock)) {
+		start = local_clock();
+		mutex_lock(&binder_main_lock);
+		wait = local_clock() - start;
+		binder_lock_stats.contended++;
+		binder_lock_stats.wait_ns += wait;
+		if (wait > binder_lock_stats.max_wait_ns)
+			binder_lock_stats.max_wait_ns = wait;
+	}
+	binder_lock_stats.acquired++;
+	binder_lock_tag = tag;
+	binder_lock_time = local_clock();
+	trace_binder_locked(tag);
+}
+
+static void binder_unlock(const char *tag)
+{
+	s64 hold = local_clock() - binder_lock_time;
+
+	if (hold > 0 && hold > binder_lock_stats.max_hold_ns) {
+		binder_lock_stats.max_hold_ns = hold;
+		binder_lock_stats.max_hold_tag = binder_lock_tag;
+	}
+	trace_binder_unlock(tag);
+	mutex_unlock(&binder_main_lock);
+}
+
 #define BINDER_DEBUG_ENTRY(name) \
 static int binder_##name##_open(struct inode *inode, struct file *file) \
 { \
@@ -82,6 +134,15 @@ BINDER_DEBUG_ENTRY(proc);
 
 #define BINDER_SMALL_BUF_SIZE (PAGE_SIZE * 64)
 
+/*
+ * Freed buffers of up to two pages are kept mapped on per-proc free lists,
+ * one per power of two size class starting at 32 bytes, so the common small
+ * transaction neither walks free_buffers nor maps pages.
+ */
+#define BINDER_BUFFER_CACHE_SHIFT   5
+#define BINDER_BUFFER_CACHE_CLASSES (PAGE_SHIFT - BINDER_BUFFER_CACHE_SHIFT + 1)
+#define BINDER_BUFFER_CACHE_DEPTH   4
+
 enum {
 	BINDER_DEBUG_USER_ERROR             = 1U << 0,
 	BINDER_DEBUG_FAILED_TRANSACTION     = 1U << 1,
@@ -149,7 +210,7 @@ enum binder_stat_types {
 
 struct binder_stats {
 	int br[_IOC_NR(BR_FAILED_REPLY) + 1];
-	int bc[_IOC_NR(BC_DEAD_BINDER_DONE) + 1];
+	int bc[_IOC_NR(BC_REPLY_SG) + 1];
 	int obj_created[BINDER_STAT_COUNT];
 	int obj_deleted[BINDER_STAT_COUNT];
 };
@@ -166,6 +227,41 @@ static inline void binder_stats_created(enum binder_stat_types type)
 	binder_stats.obj_created[type]++;
 }
 
+/*
+ * Transaction latency histograms: bucket 0 counts events under 1us, bucket
+ * n those under 2^n us and the last bucket everything above.
+ *   queue:  from queueing a transaction or reply until it is read
+ *   wakeup: from queueing until the reading thread, asleep at the time,
+ *           runs again
+ *   reply:  from delivering a synchronous transaction until its reply
+ */
+enum binder_latency_types {
+	BINDER_LATENCY_QUEUE,
+	BINDER_LATENCY_WAKEUP,
+	BINDER_LATENCY_REPLY,
+	BINDER_LATENCY_COUNT
+};
+
+#define BINDER_LATENCY_BUCKETS 16
+
+struct binder_latency {
+	unsigned int hist[BINDER_LATENCY_COUNT][BINDER_LATENCY_BUCKETS];
+};
+
+static struct binder_latency binder_latency;
+
+static void binder_latency_add(struct binder_latency *lat,
+			       enum binder_latency_types type, ktime_t start,
+			       ktime_t end)
+{
+	s64 us = ktime_us_delta(end, start);
+	unsigned int bucket;
+
+	bucket = log2_hist_bucket(us > 0 ? us : 0, BINDER_LATENCY_BUCKETS);
+	lat->hist[type][bucket]++;
+	binder_latency.hist[type][bucket]++;
+}
+
 struct binder_transaction_log_entry {
 	int debug_id;
 	int call_type;
@@ -233,7 +329,13 @@ struct binder_node {
 	unsigned has_async_transaction:1;
 	unsigned accept_fds:1;
 	unsigned min_priority:8;
+	unsigned inherit_rt:1;
+	unsigned max_rt_prio:7;
 	struct list_head async_todo;
+	/* replies to transactions on this node */
+	unsigned int reply_count;
+	u64 reply_ns;
+	u64 reply_max_ns;
 };
 
 struct binder_ref_death {
@@ -260,18 +362,23 @@ struct binder_ref {
 
 struct binder_buffer {
 	struct list_head entry; /* free and allocated entries by addesss */
-	struct rb_node rb_node; /* free entry by size or allocated entry */
-				/* by address */
+	union {
+		struct rb_node rb_node; /* free entry by size or allocated */
+					/* entry by address */
+		struct list_head cache_entry; /* cached entry by size class */
+	};
 	unsigned free:1;
+	unsigned cached:1;
 	unsigned allow_user_free:1;
 	unsigned async_transaction:1;
-	unsigned debug_id:29;
+	unsigned debug_id:28;
 
 	struct binder_transaction *transaction;
 
 	struct binder_node *target_node;
 	size_t data_size;
 	size_t offsets_size;
+	size_t extra_buffers_size;
 	uint8_t data[0];
 };
 
@@ -300,6 +407,8 @@ struct binder_proc {
 	struct list_head buffers;
 	struct rb_root free_buffers;
 	struct rb_root allocated_buffers;
+	struct list_head buffer_cache[BINDER_BUFFER_CACHE_CLASSES];
+	int buffer_cache_count[BINDER_BUFFER_CACHE_CLASSES];
 	size_t free_async_space;
 
 	struct page **pages;
@@ -315,6 +424,7 @@ struct binder_proc {
 	int ready_threads;
 	long default_priority;
 	struct dentry *debugfs_entry;
+	struct binder_latency latency;
 };
 
 enum {
@@ -339,6 +449,7 @@ struct binder_thread {
 		/* we are also waiting on */
 	wait_queue_head_t wait;
 	struct binder_stats stats;
+	ktime_t wake_time; /* last return from waiting for work */
 };
 
 struct binder_transaction {
@@ -350,6 +461,7 @@ struct binder_transaction {
 	struct binder_thread *to_thread;
 	struct binder_transaction *to_parent;
 	unsigned need_reply:1;
+	unsigned rt_boosted:1;
 	/* unsigned is_dead:1; */	/* not used at the moment */
 
 	struct binder_buffer *buffer;
@@ -357,7 +469,13 @@ struct binder_transaction {
 	unsigned int	flags;
 	long	priority;
 	long	saved_priority;
+	int	sched_policy;		/* caller's policy and RT priority */
+	int	rt_priority;
+	int	saved_policy;		/* target's, while rt_boosted */
+	int	saved_rt_priority;
 	uid_t	sender_euid;
+	ktime_t	queue_time;
+	ktime_t	deliver_time;
 };
 
 struct binder_stats_data {
@@ -522,12 +640,17 @@ out_unlock:
 
 static void binder_set_nice(long nice)
 {
+	long old_nice = task_nice(current);
 	long min_nice;
 	if (can_nice(current, nice)) {
+		if (nice != old_nice)
+			trace_binder_set_nice(current->pid, old_nice, nice,
+					      nice);
 		set_user_nice(current, nice);
 		return;
 	}
 	min_nice = 20 - current->signal->rlim[RLIMIT_NICE].rlim_cur;
+	trace_binder_set_nice(current->pid, old_nice, min_nice, nice);
 	binder_debug(BINDER_DEBUG_PRIORITY_CAP,
 		     "binder: %d: nice value %ld not allowed use "
 		     "%ld instead\n", current->pid, nice, min_nice);
@@ -537,6 +660,61 @@ static void binder_set_nice(long nice)
 	binder_user_error("binder: %d RLIMIT_NICE not set\n", current->pid);
 }
 
+static int binder_is_rt_policy(int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static void binder_set_scheduler(int policy, int rt_priority)
+{
+	struct sched_param param = { .sched_priority = rt_priority };
+	int ret;
+
+	trace_binder_set_scheduler(current->pid, current->policy,
+				   current->rt_priority, policy, rt_priority);
+	ret = sched_setscheduler_nocheck(current, policy, &param);
+	if (ret)
+		binder_debug(BINDER_DEBUG_PRIORITY_CAP,
+			     "binder: %d: set policy %d prio %d failed %d\n",
+			     current->pid, policy, rt_priority, ret);
+}
+
+/*
+ * Run the thread picking up synchronous transaction t with the caller's
+ * real-time policy, if the target node asked for it.  Never lowers the
+ * priority of a thread that is already real-time.
+ */
+static void binder_inherit_rt(struct binder_transaction *t,
+			      struct binder_node *node)
+{
+	int prio = t->rt_priority;
+
+	if ((t->flags & TF_ONE_WAY) || !node->inherit_rt ||
+	    !binder_is_rt_policy(t->sched_policy))
+		return;
+	if (node->max_rt_prio && prio > node->max_rt_prio)
+		prio = node->max_rt_prio;
+	if (binder_is_rt_policy(current->policy) &&
+	    current->rt_priority >= prio)
+		return;
+
+	t->saved_policy = current->policy;
+	t->saved_rt_priority = current->rt_priority;
+	binder_set_scheduler(t->sched_policy, prio);
+	t->rt_boosted = 1;
+}
+
+/* Undo the priority changes made when t was delivered to thread. */
+static void binder_restore_priority(struct binder_transaction *t,
+				    struct binder_thread *thread)
+{
+	if (t->rt_boosted && t->to_thread == thread) {
+		binder_set_scheduler(t->saved_policy, t->saved_rt_priority);
+		t->rt_boosted = 0;
+	}
+	binder_set_nice(t->saved_priority);
+}
+
 static size_t binder_buffer_size(struct binder_proc *proc,
 				 struct binder_buffer *buffer)
 {
@@ -682,6 +860,7 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 			       "for page at %p\n", proc->pid, page_addr);
 			goto err_alloc_page_failed;
 		}
+		inc_zone_page_state(*page, NR_BINDER_PAGES);
 		tmp_area.addr = page_addr;
 		tmp_area.size = PAGE_SIZE + PAGE_SIZE /* guard page? */;
 		page_array_ptr = page;
@@ -719,6 +898,7 @@ free_range:
 err_vm_insert_page_failed:
 		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
 err_map_kernel_failed:
+		dec_zone_page_state(*page, NR_BINDER_PAGES);
 		__free_page(*page);
 		*page = NULL;
 err_alloc_page_failed:
@@ -732,17 +912,92 @@ err_no_vma:
 	return -ENOMEM;
 }
 
+static struct binder_buffer *binder_alloc_cached_buf(struct binder_proc *proc,
+						     size_t size)
+{
+	struct binder_buffer *buffer;
+	int class, last;
+
+	if (size > PAGE_SIZE)
+		return NULL;
+	if (size <= 1 << BINDER_BUFFER_CACHE_SHIFT)
+		class = 0;
+	else
+		class = fls(size - 1) - BINDER_BUFFER_CACHE_SHIFT;
+
+	/* don't hand out buffers more than four times the size asked for */
+	last = min(class + 1, BINDER_BUFFER_CACHE_CLASSES - 1);
+	for (; class <= last; class++) {
+		if (list_empty(&proc->buffer_cache[class]))
+			continue;
+		buffer = list_first_entry(&proc->buffer_cache[class],
+					  struct binder_buffer, cache_entry);
+		list_del(&buffer->cache_entry);
+		proc->buffer_cache_count[class]--;
+		buffer->cached = 0;
+		return buffer;
+	}
+	return NULL;
+}
+
+static int binder_cache_buf(struct binder_proc *proc,
+			    struct binder_buffer *buffer, size_t buffer_size)
+{
+	int class;
+
+	if (buffer_size < 1 << BINDER_BUFFER_CACHE_SHIFT ||
+	    buffer_size >= 2 * PAGE_SIZE)
+		return 0;
+	class = fls(buffer_size) - 1 - BINDER_BUFFER_CACHE_SHIFT;
+	if (proc->buffer_cache_count[class] >= BINDER_BUFFER_CACHE_DEPTH)
+		return 0;
+
+	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
+		     "binder: %d: cache buffer %p size %zd class %d\n",
+		     proc->pid, buffer, buffer_size, class);
+	buffer->cached = 1;
+	list_add(&buffer->cache_entry, &proc->buffer_cache[class]);
+	proc->buffer_cache_count[class]++;
+	return 1;
+}
+
+static void binder_put_free_buf(struct binder_proc *proc,
+				struct binder_buffer *buffer,
+				size_t buffer_size);
+
+static int binder_drain_buffer_cache(struct binder_proc *proc)
+{
+	struct binder_buffer *buffer, *tmp;
+	int class, count = 0;
+
+	for (class = 0; class < BINDER_BUFFER_CACHE_CLASSES; class++) {
+		list_for_each_entry_safe(buffer, tmp,
+					 &proc->buffer_cache[class],
+					 cache_entry) {
+			list_del(&buffer->cache_entry);
+			buffer->cached = 0;
+			binder_put_free_buf(proc, buffer,
+					    binder_buffer_size(proc, buffer));
+			count++;
+		}
+		proc->buffer_cache_count[class] = 0;
+	}
+	return count;
+}
+
 static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 					      size_t data_size,
-					      size_t offsets_size, int is_async)
+					      size_t offsets_size,
+					      size_t extra_buffers_size,
+					      int is_async)
 {
-	struct rb_node *n = proc->free_buffers.rb_node;
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
 	struct rb_node *best_fit = NULL;
 	void *has_page_addr;
 	void *end_page_addr;
-	size_t size;
+	size_t size, data_offsets_size;
 
 	if (proc->vma == NULL) {
 		printk(KERN_ERR "binder: %d: binder_alloc_buf, no vma\n",
@@ -750,14 +1005,21 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		return NULL;
 	}
 
-	size = ALIGN(data_size, sizeof(void *)) +
+	data_offsets_size = ALIGN(data_size, sizeof(void *)) +
 		ALIGN(offsets_size, sizeof(void *));
 
-	if (size < data_size || size < offsets_size) {
+	if (data_offsets_size < data_size || data_offsets_size < offsets_size) {
 		binder_user_error("binder: %d: got transaction with invalid "
 			"size %zd-%zd\n", proc->pid, data_size, offsets_size);
 		return NULL;
 	}
+	size = data_offsets_size + ALIGN(extra_buffers_size, sizeof(void *));
+	if (size < data_offsets_size || size < extra_buffers_size) {
+		binder_user_error("binder: %d: got transaction with invalid "
+			"extra_buffers_size %zd\n", proc->pid,
+			extra_buffers_size);
+		return NULL;
+	}
 
 	if (is_async &&
 	    proc->free_async_space < size + sizeof(struct binder_buffer)) {
@@ -767,6 +1029,15 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		return NULL;
 	}
 
+	buffer = binder_alloc_cached_buf(proc, size);
+	if (buffer) {
+		binder_insert_allocated_buffer(proc, buffer);
+		goto found;
+	}
+
+retry:
+	n = proc->free_buffers.rb_node;
+	best_fit = NULL;
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(!buffer->free);
@@ -783,6 +1054,8 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		}
 	}
 	if (best_fit == NULL) {
+		if (binder_drain_buffer_cache(proc))
+			goto retry;
 		printk(KERN_ERR "binder: %d: binder_alloc_buf size %zd failed, "
 		       "no address space\n", proc->pid, size);
 		return NULL;
@@ -821,11 +1094,13 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		new_buffer->free = 1;
 		binder_insert_free_buffer(proc, new_buffer);
 	}
+found:
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "binder: %d: binder_alloc_buf size %zd got "
 		     "%p\n", proc->pid, size, buffer);
 	buffer->data_size = data_size;
 	buffer->offsets_size = offsets_size;
+	buffer->extra_buffers_size = extra_buffers_size;
 	buffer->async_transaction = is_async;
 	if (is_async) {
 		proc->free_async_space -= size + sizeof(struct binder_buffer);
@@ -908,7 +1183,8 @@ static void binder_free_buf(struct binder_proc *proc,
 	buffer_size = binder_buffer_size(proc, buffer);
 
 	size = ALIGN(buffer->data_size, sizeof(void *)) +
-		ALIGN(buffer->offsets_size, sizeof(void *));
+		ALIGN(buffer->offsets_size, sizeof(void *)) +
+		ALIGN(buffer->extra_buffers_size, sizeof(void *));
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "binder: %d: binder_free_buf %p size %zd buffer"
@@ -929,11 +1205,24 @@ static void binder_free_buf(struct binder_proc *proc,
 			     proc->free_async_space);
 	}
 
+	rb_erase(&buffer->rb_node, &proc->allocated_buffers);
+	if (binder_cache_buf(proc, buffer, buffer_size))
+		return;
+	binder_put_free_buf(proc, buffer, buffer_size);
+}
+
+/*
+ * Unmap the pages only used by an unlinked buffer and merge it back into
+ * free_buffers.
+ */
+static void binder_put_free_buf(struct binder_proc *proc,
+				struct binder_buffer *buffer,
+				size_t buffer_size)
+{
 	binder_update_page_range(proc, 0,
 		(void *)PAGE_ALIGN((uintptr_t)buffer->data),
 		(void *)(((uintptr_t)buffer->data + buffer_size) & PAGE_MASK),
 		NULL);
-	rb_erase(&buffer->rb_node, &proc->allocated_buffers);
 	buffer->free = 1;
 	if (!list_is_last(&buffer->entry, &proc->buffers)) {
 		struct binder_buffer *next = list_entry(buffer->entry.next,
@@ -1399,6 +1688,10 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 				task_close_fd(proc, fp->handle);
 			break;
 
+		case BINDER_TYPE_PTR:
+			/* the buffer is part of this transaction buffer */
+			break;
+
 		default:
 			printk(KERN_ERR "binder: transaction release %d bad "
 			       "object type %lx\n", debug_id, fp->type);
@@ -1407,13 +1700,67 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 	}
 }
 
+/*
+ * Point the parent of bp at bp's copy.  The parent is an earlier
+ * BINDER_TYPE_PTR object; the pointer it holds is only patched if it lies
+ * in the part of the scatter-gather area that was already filled in.
+ */
+static int binder_fixup_parent(struct binder_proc *target_proc,
+			       struct binder_buffer *buffer,
+			       struct binder_buffer_object *bp,
+			       size_t *off_start, size_t *offp,
+			       void *sg_start, void *sg_bufp)
+{
+	struct binder_buffer_object *parent;
+	void *fixup;
+
+	if (bp->parent >= offp - off_start)
+		return -EINVAL;
+	parent = (struct binder_buffer_object *)
+		(buffer->data + off_start[bp->parent]);
+	if (parent->type != BINDER_TYPE_PTR ||
+	    parent->length < sizeof(void *) ||
+	    bp->parent_offset > parent->length - sizeof(void *) ||
+	    !IS_ALIGNED(bp->parent_offset, sizeof(void *)))
+		return -EINVAL;
+
+	fixup = parent->buffer - target_proc->user_buffer_offset +
+		bp->parent_offset;
+	if (fixup < sg_start || fixup + sizeof(void *) > sg_bufp)
+		return -EINVAL;
+	*(void **)fixup = bp->buffer;
+	return 0;
+}
+
+static void binder_reply_latency(struct binder_proc *proc,
+				 struct binder_transaction *in_reply_to)
+{
+	struct binder_node *node = NULL;
+	ktime_t now = ktime_get();
+	u64 ns = ktime_to_ns(ktime_sub(now, in_reply_to->deliver_time));
+
+	binder_latency_add(&proc->latency, BINDER_LATENCY_REPLY,
+			   in_reply_to->deliver_time, now);
+	/* the node is only pinned while the transaction buffer is alive */
+	if (in_reply_to->buffer)
+		node = in_reply_to->buffer->target_node;
+	if (node) {
+		node->reply_count++;
+		node->reply_ns += ns;
+		if (ns > node->reply_max_ns)
+			node->reply_max_ns = ns;
+	}
+}
+
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
-			       struct binder_transaction_data *tr, int reply)
+			       struct binder_transaction_data *tr, int reply,
+			       size_t extra_buffers_size)
 {
 	struct binder_transaction *t;
 	struct binder_work *tcomplete;
-	size_t *offp, *off_end;
+	size_t *offp, *off_end, *off_start;
+	void *sg_start, *sg_bufp, *sg_buf_end;
 	struct binder_proc *target_proc;
 	struct binder_thread *target_thread = NULL;
 	struct binder_node *target_node = NULL;
@@ -1440,7 +1787,7 @@ static void binder_transaction(struct binder_proc *proc,
 			return_error = BR_FAILED_REPLY;
 			goto err_empty_call_stack;
 		}
-		binder_set_nice(in_reply_to->saved_priority);
+		binder_restore_priority(in_reply_to, thread);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("binder: %d:%d got reply transaction "
 				"with bad transaction stack,"
@@ -1474,6 +1821,7 @@ static void binder_transaction(struct binder_proc *proc,
 			goto err_dead_binder;
 		}
 		target_proc = target_thread->proc;
+		binder_reply_latency(proc, in_reply_to);
 	} else {
 		if (tr->target.handle) {
 			struct binder_ref *ref;
@@ -1579,12 +1927,19 @@ static void binder_transaction(struct binder_proc *proc,
 	t->code = tr->code;
 	t->flags = tr->flags;
 	t->priority = task_nice(current);
+	t->sched_policy = current->policy;
+	t->rt_priority = current->rt_priority;
+
+	trace_binder_transaction(reply, t, target_node);
+
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
-		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
+		tr->offsets_size, extra_buffers_size,
+		!reply && (t->flags & TF_ONE_WAY));
 	if (t->buffer == NULL) {
 		return_error = BR_FAILED_REPLY;
 		goto err_binder_alloc_buf_failed;
 	}
+	trace_binder_transaction_alloc_buf(t->buffer);
 	t->buffer->allow_user_free = 0;
 	t->buffer->debug_id = t->debug_id;
 	t->buffer->transaction = t;
@@ -1613,7 +1968,12 @@ static void binder_transaction(struct binder_proc *proc,
 		return_error = BR_FAILED_REPLY;
 		goto err_bad_offset;
 	}
+	off_start = offp;
 	off_end = (void *)offp + tr->offsets_size;
+	sg_start = t->buffer->data + ALIGN(tr->data_size, sizeof(void *)) +
+		ALIGN(tr->offsets_size, sizeof(void *));
+	sg_bufp = sg_start;
+	sg_buf_end = sg_start + extra_buffers_size;
 	for (; offp < off_end; offp++) {
 		struct flat_binder_object *fp;
 		if (*offp > t->buffer->data_size - sizeof(*fp) ||
@@ -1639,6 +1999,9 @@ static void binder_transaction(struct binder_proc *proc,
 				}
 				node->min_priority = fp->flags & FLAT_BINDER_FLAG_PRIORITY_MASK;
 				node->accept_fds = !!(fp->flags & FLAT_BINDER_FLAG_ACCEPTS_FDS);
+				node->inherit_rt = !!(fp->flags & FLAT_BINDER_FLAG_INHERIT_RT);
+				node->max_rt_prio = (fp->flags & FLAT_BINDER_FLAG_RT_PRIO_MASK) >>
+					FLAT_BINDER_FLAG_RT_PRIO_SHIFT;
 			}
 			if (fp->cookie != node->cookie) {
 				binder_user_error("binder: %d:%d sending u%p "
@@ -1756,6 +2119,53 @@ static void binder_transaction(struct binder_proc *proc,
 			fp->handle = target_fd;
 		} break;
 
+		case BINDER_TYPE_PTR: {
+			struct binder_buffer_object *bp = (void *)fp;
+			size_t buf_left = sg_buf_end - sg_bufp;
+
+			if (*offp > t->buffer->data_size - sizeof(*bp) ||
+			    t->buffer->data_size < sizeof(*bp)) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"invalid offset, %zd\n",
+					proc->pid, thread->pid, *offp);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_offset;
+			}
+			if (bp->length > buf_left ||
+			    ALIGN(bp->length, sizeof(u64)) > buf_left) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"too large buffer, %zd of %zd\n",
+					proc->pid, thread->pid, bp->length,
+					buf_left);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_offset;
+			}
+			/* copied once, straight into the target's buffer */
+			if (copy_from_user(sg_bufp, bp->buffer, bp->length)) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"invalid buffer ptr\n",
+					proc->pid, thread->pid);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_offset;
+			}
+			bp->buffer = sg_bufp + target_proc->user_buffer_offset;
+			if ((bp->flags & BINDER_BUFFER_FLAG_HAS_PARENT) &&
+			    binder_fixup_parent(target_proc, t->buffer, bp,
+						off_start, offp, sg_start,
+						sg_bufp)) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"invalid parent %zd offset %zd\n",
+					proc->pid, thread->pid, bp->parent,
+					bp->parent_offset);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_offset;
+			}
+			binder_debug(BINDER_DEBUG_TRANSACTION,
+				     "        buffer %zd bytes at %p\n",
+				     bp->length, bp->buffer);
+			sg_bufp += ALIGN(bp->length, sizeof(u64));
+		} break;
+
 		default:
 			binder_user_error("binder: %d:%d got transactio"
 				"n with invalid object type, %lx\n",
@@ -1782,6 +2192,7 @@ static void binder_transaction(struct binder_proc *proc,
 			target_node->has_async_transaction = 1;
 	}
 	t->work.type = BINDER_WORK_TRANSACTION;
+	t->queue_time = ktime_get();
 	list_add_tail(&t->work.entry, target_list);
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	list_add_tail(&tcomplete->entry, &thread->todo);
@@ -2024,7 +2435,19 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 			if (copy_from_user(&tr, ptr, sizeof(tr)))
 				return -EFAULT;
 			ptr += sizeof(tr);
-			binder_transaction(proc, thread, &tr, cmd == BC_REPLY);
+			binder_transaction(proc, thread, &tr, cmd == BC_REPLY, 0);
+			break;
+		}
+
+		case BC_TRANSACTION_SG:
+		case BC_REPLY_SG: {
+			struct binder_transaction_data_sg tr;
+
+			if (copy_from_user(&tr, ptr, sizeof(tr)))
+				return -EFAULT;
+			ptr += sizeof(tr);
+			binder_transaction(proc, thread, &tr.transaction_data,
+					   cmd == BC_REPLY_SG, tr.buffers_size);
 			break;
 		}
 
@@ -2250,6 +2673,7 @@ static int binder_thread_read(struct binder_proc *proc,
 
 	int ret = 0;
 	int wait_for_proc_work;
+	bool slept;
 
 	if (*consumed == 0) {
 		if (put_user(BR_NOOP, (uint32_t __user *)ptr))
@@ -2283,7 +2707,10 @@ retry:
 	thread->looper |= BINDER_LOOPER_STATE_WAITING;
 	if (wait_for_proc_work)
 		proc->ready_threads++;
-	mutex_unlock(&binder_lock);
+	/* work already queued is taken without sleeping, not a wakeup */
+	slept = wait_for_proc_work ? !binder_has_proc_work(proc, thread) :
+				     !binder_has_thread_work(thread);
+	binder_unlock(__func__);
 	if (wait_for_proc_work) {
 		if (!(thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
 					BINDER_LOOPER_STATE_ENTERED))) {
@@ -2307,7 +2734,9 @@ retry:
 		} else
 			ret = wait_event_interruptible(thread->wait, binder_has_thread_work(thread));
 	}
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
+	thread->wake_time = (slept && !non_block) ? ktime_get() :
+						    ktime_set(0, 0);
 	if (wait_for_proc_work)
 		proc->ready_threads--;
 	thread->looper &= ~BINDER_LOOPER_STATE_WAITING;
@@ -2465,6 +2894,7 @@ retry:
 			else if (!(t->flags & TF_ONE_WAY) ||
 				 t->saved_priority > target_node->min_priority)
 				binder_set_nice(target_node->min_priority);
+			binder_inherit_rt(t, target_node);
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = NULL;
@@ -2510,6 +2940,19 @@ retry:
 			     t->buffer->data_size, t->buffer->offsets_size,
 			     tr.data.ptr.buffer, tr.data.ptr.offsets);
 
+		trace_binder_transaction_received(t);
+		t->deliver_time = ktime_get();
+		binder_latency_add(&proc->latency, BINDER_LATENCY_QUEUE,
+				   t->queue_time, t->deliver_time);
+		if (ktime_to_ns(thread->wake_time) >
+		    ktime_to_ns(t->queue_time)) {
+			binder_latency_add(&proc->latency,
+					   BINDER_LATENCY_WAKEUP,
+					   t->queue_time, thread->wake_time);
+			/* only the first transaction read woke us up */
+			thread->wake_time = ktime_set(0, 0);
+		}
+
 		list_del(&t->work.entry);
 		t->buffer->allow_user_free = 1;
 		if (cmd == BR_TRANSACTION && !(t->flags & TF_ONE_WAY)) {
@@ -2647,6 +3090,9 @@ static int binder_free_thread(struct binder_proc *proc,
 			     (t->to_thread == thread) ? "in" : "out");
 
 		if (t->to_thread == thread) {
+			/* BINDER_THREAD_EXIT from a thread still boosted */
+			if (t->rt_boosted && thread->pid == current->pid)
+				binder_restore_priority(t, thread);
 			t->to_proc = NULL;
 			t->to_thread = NULL;
 			if (t->buffer) {
@@ -2675,12 +3121,12 @@ static unsigned int binder_poll(struct file *filp,
 	struct binder_thread *thread = NULL;
 	int wait_for_proc_work;
 
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
 	thread = binder_get_thread(proc);
 
 	wait_for_proc_work = thread->transaction_stack == NULL &&
 		list_empty(&thread->todo) && thread->return_error == BR_OK;
-	mutex_unlock(&binder_lock);
+	binder_unlock(__func__);
 
 	if (wait_for_proc_work) {
 		if (binder_has_proc_work(proc, thread))
@@ -2708,11 +3154,13 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 	/*printk(KERN_INFO "binder_ioctl: %d:%d %x %lx\n", proc->pid, current->pid, cmd, arg);*/
 
+	trace_binder_ioctl(cmd, arg);
+
 	ret = wait_event_interruptible(binder_user_error_wait, binder_stop_on_user_error < 2);
 	if (ret)
 		return ret;
 
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
 	thread = binder_get_thread(proc);
 	if (thread == NULL) {
 		ret = -ENOMEM;
@@ -2824,10 +3272,11 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 err:
 	if (thread)
 		thread->looper &= ~BINDER_LOOPER_STATE_NEED_RETURN;
-	mutex_unlock(&binder_lock);
+	binder_unlock(__func__);
 	wait_event_interruptible(binder_user_error_wait, binder_stop_on_user_error < 2);
 	if (ret && ret != -ERESTARTSYS)
 		printk(KERN_INFO "binder: %d:%d ioctl %x %lx returned %d\n", proc->pid, current->pid, cmd, arg, ret);
+	trace_binder_ioctl_done(ret);
 	return ret;
 }
 
@@ -2964,6 +3413,7 @@ err_bad_arg:
 static int binder_open(struct inode *nodp, struct file *filp)
 {
 	struct binder_proc *proc;
+	int i;
 
 	binder_debug(BINDER_DEBUG_OPEN_CLOSE, "binder_open: %d:%d\n",
 		     current->group_leader->pid, current->pid);
@@ -2975,14 +3425,16 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	proc->tsk = current;
 	INIT_LIST_HEAD(&proc->todo);
 	init_waitqueue_head(&proc->wait);
+	for (i = 0; i < BINDER_BUFFER_CACHE_CLASSES; i++)
+		INIT_LIST_HEAD(&proc->buffer_cache[i]);
 	proc->default_priority = task_nice(current);
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
 	binder_stats_created(BINDER_STAT_PROC);
 	hlist_add_head(&proc->proc_node, &binder_procs);
 	proc->pid = current->group_leader->pid;
 	INIT_LIST_HEAD(&proc->delivered_death);
 	filp->private_data = proc;
-	mutex_unlock(&binder_lock);
+	binder_unlock(__func__);
 
 	if (binder_debugfs_dir_entry_proc) {
 		char strbuf[11];
@@ -3121,6 +3573,7 @@ static void binder_deferred_release(struct binder_proc *proc)
 		binder_free_buf(proc, buffer);
 		buffers++;
 	}
+	binder_drain_buffer_cache(proc);
 
 	binder_stats_deleted(BINDER_STAT_PROC);
 
@@ -3137,6 +3590,8 @@ static void binder_deferred_release(struct binder_proc *proc)
 					     page_addr);
 				unmap_kernel_range((unsigned long)page_addr,
 					PAGE_SIZE);
+				dec_zone_page_state(proc->pages[i],
+						    NR_BINDER_PAGES);
 				__free_page(proc->pages[i]);
 				page_count++;
 			}
@@ -3164,7 +3619,7 @@ static void binder_deferred_func(struct work_struct *work)
 
 	int defer;
 	do {
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 		mutex_lock(&binder_deferred_lock);
 		if (!hlist_empty(&binder_deferred_list)) {
 			proc = hlist_entry(binder_deferred_list.first,
@@ -3191,7 +3646,7 @@ static void binder_deferred_func(struct work_struct *work)
 		if (defer & BINDER_DEFERRED_RELEASE)
 			binder_deferred_release(proc); /* frees proc */
 
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
 		if (files)
 			put_files_struct(files);
 	} while (proc);
@@ -3423,7 +3878,9 @@ static const char *binder_command_strings[] = {
 	"BC_EXIT_LOOPER",
 	"BC_REQUEST_DEATH_NOTIFICATION",
 	"BC_CLEAR_DEATH_NOTIFICATION",
-	"BC_DEAD_BINDER_DONE"
+	"BC_DEAD_BINDER_DONE",
+	"BC_TRANSACTION_SG",
+	"BC_REPLY_SG"
 };
 
 static const char *binder_objstat_strings[] = {
@@ -3476,6 +3933,7 @@ static void print_binder_proc_stats(struct seq_file *m,
 	struct binder_work *w;
 	struct rb_node *n;
 	int count, strong, weak;
+	int i;
 
 	seq_printf(m, "proc %d\n", proc->pid);
 	count = 0;
@@ -3508,6 +3966,11 @@ static void print_binder_proc_stats(struct seq_file *m,
 		count++;
 	seq_printf(m, "  buffers: %d\n", count);
 
+	count = 0;
+	for (i = 0; i < BINDER_BUFFER_CACHE_CLASSES; i++)
+		count += proc->buffer_cache_count[i];
+	seq_printf(m, "  cached buffers: %d\n", count);
+
 	count = 0;
 	list_for_each_entry(w, &proc->todo, entry) {
 		switch (w->type) {
@@ -3547,7 +4010,7 @@ static void *binder_stats_seq_start(struct seq_file *m, loff_t *pos)
 {
  struct binder_stats_data *data = m->private;
  if (data->do_lock)
- mutex_lock(&binder_lock);
+ binder_lock(__func__);
  return binder_stats_find(m, pos);
 }
 
@@ -3559,8 +4022,17 @@ static void *binder_stats_seq_next(struct seq_file *m, void *v, loff_t *pos)
 
 static int binder_stats_header(struct seq_file *m)
 {
+ struct binder_lock_stats *ls = &binder_lock_stats;
+
  seq_puts(m, "binder stats:\n");
  print_binder_stats(m, "", &binder_stats);
+ seq_printf(m, "lock: acquired %lu contended %lu wait %llu us "
+	    "max wait %llu us max hold %llu us (%s)\n",
+	    ls->acquired, ls->contended,
+	    (unsigned long long)div_u64(ls->wait_ns, NSEC_PER_USEC),
+	    (unsigned long long)div_u64(ls->max_wait_ns, NSEC_PER_USEC),
+	    (unsigned long long)div_u64(ls->max_hold_ns, NSEC_PER_USEC),
+	    ls->max_hold_tag ? ls->max_hold_tag : "none");
  return 0;
 }
 
@@ -3577,7 +4049,7 @@ static void binder_stats_seq_stop(struct seq_file *m, void *v)
 {
  struct binder_stats_data *data = m->private;
  if (data->do_lock)
- mutex_unlock(&binder_lock);
+ binder_unlock(__func__);
 }
 
 
@@ -3645,7 +4117,7 @@ static void *binder_state_seq_start(struct seq_file *m, loff_t *pos)
 {
  struct binder_state_data *d = m->private;
  if (d->do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 
 return binder_state_find(m, pos, 1);
 }
@@ -3777,7 +4249,7 @@ static void binder_state_seq_stop(struct seq_file *m, void *v)
 {
  struct binder_state_data *d = m->private;
  if (d->do_lock)
- mutex_unlock(&binder_lock);
+ binder_unlock(__func__);
 }
 
 static int binder_transactions_show(struct seq_file *m, void *unused)
@@ -3787,13 +4259,13 @@ static int binder_transactions_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 
 	seq_puts(m, "binder transactions:\n");
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
 		print_binder_proc(m, proc, 0);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
 	return 0;
 }
 
@@ -3803,11 +4275,11 @@ static int binder_proc_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 	seq_puts(m, "binder proc state:\n");
 	print_binder_proc(m, proc, 1);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
 	return 0;
 }
 
@@ -3854,8 +4326,72 @@ static struct miscdevice binder_miscdev = {
 
 
 
+static const char *binder_latency_strings[] = {
+	"queue",
+	"wakeup",
+	"reply"
+};
+
+static void print_binder_latency(struct seq_file *m, const char *prefix,
+				 struct binder_latency *lat)
+{
+	int i, j;
+
+	BUILD_BUG_ON(ARRAY_SIZE(binder_latency_strings) !=
+		     BINDER_LATENCY_COUNT);
+	for (i = 0; i < BINDER_LATENCY_COUNT; i++) {
+		seq_printf(m, "%s%-6s:", prefix, binder_latency_strings[i]);
+		for (j = 0; j < BINDER_LATENCY_BUCKETS; j++)
+			seq_printf(m, " %u", lat->hist[i][j]);
+		seq_puts(m, "\n");
+	}
+}
+
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+	struct binder_node *node;
+	struct hlist_node *pos;
+	struct rb_node *n;
+	int do_lock = !binder_debug_no_lock;
+	int i;
+
+	if (do_lock)
+		binder_lock(__func__);
+
+	seq_puts(m, "buckets (us):");
+	for (i = 0; i < BINDER_LATENCY_BUCKETS; i++)
+		seq_printf(m, " %s%llu",
+			   i < BINDER_LATENCY_BUCKETS - 1 ? "<" : ">=",
+			   log2_hist_bound(i, BINDER_LATENCY_BUCKETS));
+	seq_puts(m, "\n");
+	print_binder_latency(m, "", &binder_latency);
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
+		seq_printf(m, "proc %d\n", proc->pid);
+		print_binder_latency(m, "  ", &proc->latency);
+		for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n)) {
+			node = rb_entry(n, struct binder_node, rb_node);
+			if (!node->reply_count)
+				continue;
+			seq_printf(m, "  node %d u%p c%p: replies %u "
+				   "avg %llu us max %llu us\n",
+				   node->debug_id, node->ptr, node->cookie,
+				   node->reply_count,
+				   div_u64(div_u64(node->reply_ns,
+						   node->reply_count),
+					   NSEC_PER_USEC),
+				   div_u64(node->reply_max_ns, NSEC_PER_USEC));
+		}
+	}
+
+	if (do_lock)
+		binder_unlock(__func__);
+	return 0;
+}
+
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
+BINDER_DEBUG_ENTRY(latency);
 
 static const struct seq_operations binder_stats_seq_ops = {
  .start = binder_stats_seq_start,
@@ -3986,11 +4522,19 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+		debugfs_create_file("latency",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
 	}
 	return ret;
 }
 
 device_initcall(binder_init);
 
+#define CREATE_TRACE_POINTS
+#include "binder_trace.h"
+
 MODULE_LICENSE("GPL v2");
 
@@ -32,11 +32,21 @@ enum {
 	BINDER_TYPE_HANDLE	= B_PACK_CHARS('s', 'h', '*', B_TYPE_LARGE),
 	BINDER_TYPE_WEAK_HANDLE	= B_PACK_CHARS('w', 'h', '*', B_TYPE_LARGE),
 	BINDER_TYPE_FD		= B_PACK_CHARS('f', 'd', '*', B_TYPE_LARGE),
+	BINDER_TYPE_PTR		= B_PACK_CHARS('p', 't', '*', B_TYPE_LARGE),
 };
 
 enum {
 	FLAT_BINDER_FLAG_PRIORITY_MASK = 0xff,
 	FLAT_BINDER_FLAG_ACCEPTS_FDS = 0x100,
+
+	/*
+	 * Synchronous calls from SCHED_FIFO/SCHED_RR threads run with the
+	 * caller's policy and RT priority until the reply.  A non-zero
+	 * FLAT_BINDER_FLAG_RT_PRIO field caps the inherited priority.
+	 */
+	FLAT_BINDER_FLAG_INHERIT_RT = 0x800,
+	FLAT_BINDER_FLAG_RT_PRIO_MASK = 0x7f000,
+	FLAT_BINDER_FLAG_RT_PRIO_SHIFT = 12,
 };
 
 /*
@@ -61,6 +71,27 @@ struct flat_binder_object {
 	void			*cookie;
 };
 
+enum {
+	BINDER_BUFFER_FLAG_HAS_PARENT = 0x01,
+};
+
+/*
+ * A BINDER_TYPE_PTR object describes a buffer in the sender's address space
+ * that is copied into the scatter-gather area of the receiver's transaction
+ * buffer (see BC_TRANSACTION_SG).  On delivery 'buffer' points at the copy.
+ * With BINDER_BUFFER_FLAG_HAS_PARENT set, the pointer at 'parent_offset' in
+ * the buffer of the earlier BINDER_TYPE_PTR object at index 'parent' of the
+ * offsets array is rewritten to point at the copy as well.
+ */
+struct binder_buffer_object {
+	unsigned long		type;
+	unsigned long		flags;
+	void			*buffer;
+	size_t			length;
+	size_t			parent;
+	size_t			parent_offset;
+};
+
 /*
  * On 64-bit platforms where user code may run in 32-bits the driver must
  * translate the buffer (and local binder) addresses apropriately.
@@ -147,6 +178,15 @@ struct binder_transaction_data {
 	} data;
 };
 
+/*
+ * Each BINDER_TYPE_PTR buffer takes its length rounded up to 8 bytes out of
+ * buffers_size.
+ */
+struct binder_transaction_data_sg {
+	struct binder_transaction_data transaction_data;
+	size_t buffers_size;
+};
+
 struct binder_ptr_cookie {
 	void *ptr;
 	void *cookie;
@@ -324,6 +364,13 @@ enum BinderDriverCommandProtocol {
 	/*
 	 * void *: cookie
 	 */
+
+	BC_TRANSACTION_SG = _IOW('c', 17, struct binder_transaction_data_sg),
+	BC_REPLY_SG = _IOW('c', 18, struct binder_transaction_data_sg),
+	/*
+	 * binder_transaction_data_sg: the sent command, with room for the
+	 * BINDER_TYPE_PTR buffers it carries.
+	 */
 };
 
 #endif /* _LINUX_BINDER_H */
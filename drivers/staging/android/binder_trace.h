@@ -84,6 +84,51 @@ DEFINE_BINDER_FUNCTION_RETURN_EVENT(binder_ioctl_done);
 DEFINE_BINDER_FUNCTION_RETURN_EVENT(binder_write_done);
 DEFINE_BINDER_FUNCTION_RETURN_EVENT(binder_read_done);
 
+TRACE_EVENT(binder_set_nice,
+	TP_PROTO(int thread, long old_nice, long new_nice, long desired_nice),
+	TP_ARGS(thread, old_nice, new_nice, desired_nice),
+
+	TP_STRUCT__entry(
+		__field(int, thread)
+		__field(long, old_nice)
+		__field(long, new_nice)
+		__field(long, desired_nice)
+	),
+	TP_fast_assign(
+		__entry->thread = thread;
+		__entry->old_nice = old_nice;
+		__entry->new_nice = new_nice;
+		__entry->desired_nice = desired_nice;
+	),
+	TP_printk("thread=%d old=%ld new=%ld desired=%ld",
+		  __entry->thread, __entry->old_nice, __entry->new_nice,
+		  __entry->desired_nice)
+);
+
+TRACE_EVENT(binder_set_scheduler,
+	TP_PROTO(int thread, int old_policy, int old_prio, int new_policy,
+		 int new_prio),
+	TP_ARGS(thread, old_policy, old_prio, new_policy, new_prio),
+
+	TP_STRUCT__entry(
+		__field(int, thread)
+		__field(int, old_policy)
+		__field(int, old_prio)
+		__field(int, new_policy)
+		__field(int, new_prio)
+	),
+	TP_fast_assign(
+		__entry->thread = thread;
+		__entry->old_policy = old_policy;
+		__entry->old_prio = old_prio;
+		__entry->new_policy = new_policy;
+		__entry->new_prio = new_prio;
+	),
+	TP_printk("thread=%d old=%d:%d new=%d:%d",
+		  __entry->thread, __entry->old_policy, __entry->old_prio,
+		  __entry->new_policy, __entry->new_prio)
+);
+
 TRACE_EVENT(binder_wait_for_work,
 	TP_PROTO(bool proc_work, bool transaction_stack, bool thread_todo),
 	TP_ARGS(proc_work, transaction_stack, thread_todo),
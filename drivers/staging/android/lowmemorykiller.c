@@ -17,6 +17,32 @@
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
  *
+ * With /sys/module/lowmemorykiller/parameters/swap_aware set, anonymous memory
+ * that still fits into free swap (e.g. zram) is credited to the free memory as
+ * well, scaled by swap_credit_percent, as long as more than swap_free_percent
+ * of the swap is free and the swap-in rate stays under swapin_budget pages per
+ * second.  Once swap runs low or the system starts thrashing on swap-ins the
+ * thresholds apply to the real free memory again.
+ *
+ * Right after a kill the lmk_reaper thread unmaps the victim's private memory
+ * (see lowmem_reap_task()) so it comes back without waiting for the victim to
+ * be scheduled and exit; reclaimers that triggered the kill wait up to
+ * reap_wait_ms for that to finish.  Set reap to 0 to rely on the victim's exit
+ * alone.
+ *
+ * With pressure_trigger set the thresholds are adjusted by how well global
+ * reclaim is doing, as reported by vmpressure over its last window: while the
+ * pressure stays under pressure_low only the first (lowest adj) threshold
+ * kills, and once it reaches pressure_critical tasks at the last adj level are
+ * killed even though free memory is still above minfree.  Samples older than a
+ * second are ignored.  The same pressure levels reach user-space through the
+ * memory.pressure_level eventfd of the root memory cgroup.
+ *
+ * The lowmemory_scan, lowmemory_kill and lowmemory_victim_freed trace events
+ * record each decision, and debugfs lowmemorykiller/scan_latency and
+ * lowmemorykiller/kill_latency hold histograms of the victim selection time
+ * and of the time from SIGKILL until the victim is freed.
+ *
  * Copyright (C) 2007-2008 Google, Inc.
  *
  * This software is licensed under the terms of the GNU General Public
@@ -37,6 +63,18 @@
 #include <linux/sched.h>
 #include <linux/rcupdate.h>
 #include <linux/notifier.h>
+#include <linux/hrtimer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/swap.h>
+#include <linux/kthread.h>
+#include <linux/wait.h>
+#include <linux/vmpressure.h>
+#include <linux/zsmalloc.h>
+#include <linux/log2_hist.h>
+
+#define CREATE_TRACE_POINTS
+#include "lowmemorykiller_trace.h"
 
 static uint32_t lowmem_debug_level = 2;
 static int lowmem_adj[6] = {
@@ -56,13 +94,280 @@ static int lowmem_minfree_size = 4;
 
 static unsigned long lowmem_deathpending_timeout;
 
+static bool lowmem_swap_aware;
+static int lowmem_swap_free_percent = 10;
+static int lowmem_swap_credit_percent = 50;
+static unsigned int lowmem_swapin_budget;
+
+static bool lowmem_reap = true;
+static unsigned int lowmem_reap_wait_ms = 20;
+
+static bool lowmem_pressure_trigger;
+static unsigned int lowmem_pressure_low = 60;
+static unsigned int lowmem_pressure_critical = 95;
+/* last global vmpressure sample and when it was taken */
+static unsigned long lowmem_pressure;
+static unsigned long lowmem_pressure_jiffies;
+
+static struct task_struct *lowmem_reaper_thread;
+static DECLARE_WAIT_QUEUE_HEAD(lowmem_reaper_wait);
+static DECLARE_WAIT_QUEUE_HEAD(lowmem_reap_done_wait);
+static DEFINE_SPINLOCK(lowmem_reap_lock);
+/* victim handed to the reaper, holding a task reference */
+static struct task_struct *lowmem_reap_victim;
+/* bumped each time the reaper is done with a victim */
+static atomic_t lowmem_reap_seq = ATOMIC_INIT(0);
+
 #define lowmem_print(level, x...)			\
 	do {						\
 		if (lowmem_debug_level >= (level))	\
 			printk(x);			\
 	} while (0)
 
+/* Latency histograms exported in debugfs, log2 buckets of 1us */
+#define LOWMEM_HIST_BUCKETS 16
 
+struct lowmem_hist {
+	atomic_t count[LOWMEM_HIST_BUCKETS];
+};
+
+/* time spent walking the task list to pick a victim */
+static struct lowmem_hist lowmem_scan_hist;
+/* time from SIGKILL until the victim's task_struct is freed */
+static struct lowmem_hist lowmem_kill_hist;
+
+static struct task_struct *lowmem_victim;
+static ktime_t lowmem_kill_time;
+
+static void lowmem_hist_add(struct lowmem_hist *hist, u64 ns)
+{
+	do_div(ns, NSEC_PER_USEC);
+	atomic_inc(&hist->count[log2_hist_bucket(ns, LOWMEM_HIST_BUCKETS)]);
+}
+
+static unsigned long lowmem_swapin_events(void)
+{
+	unsigned long sum = 0;
+#ifdef CONFIG_VM_EVENT_COUNTERS
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		sum += per_cpu(vm_event_states, cpu).event[PSWPIN];
+#endif
+	return sum;
+}
+
+/*
+ * Swap-in rate in pages per second, resampled at most once a second.
+ * Concurrent callers may race on the sample; the result only needs to be
+ * roughly right.
+ */
+static unsigned long lowmem_swapin_rate(void)
+{
+	static unsigned long last_jiffies, last_events, rate;
+	unsigned long now = jiffies;
+
+	if (time_after_eq(now, last_jiffies + HZ)) {
+		unsigned long events = lowmem_swapin_events();
+
+		rate = (events - last_events) * HZ / (now - last_jiffies);
+		last_events = events;
+		last_jiffies = now;
+	}
+	return rate;
+}
+
+/*
+ * Anonymous pages that can still be pushed out to swap instead of being
+ * freed by a kill, or 0 when swap is nearly exhausted or thrashing.
+ */
+static int lowmem_swap_headroom(void)
+{
+	long swap_free = nr_swap_pages;
+	long anon;
+
+	if (!lowmem_swap_aware || total_swap_pages <= 0)
+		return 0;
+	if (swap_free * 100 <= total_swap_pages * lowmem_swap_free_percent)
+		return 0;
+	if (lowmem_swapin_budget &&
+	    lowmem_swapin_rate() > lowmem_swapin_budget)
+		return 0;
+
+	anon = global_page_state(NR_ACTIVE_ANON) +
+		global_page_state(NR_INACTIVE_ANON);
+	return min(anon, swap_free) * lowmem_swap_credit_percent / 100;
+}
+
+/*
+ * Pages that compacting zram's zsmalloc pools gave back.  Cheaper than
+ * any kill, so it is tried first.
+ */
+#ifdef CONFIG_ZSMALLOC
+static unsigned long lowmem_compact(void)
+{
+	return zs_compact_all();
+}
+#else
+static inline unsigned long lowmem_compact(void)
+{
+	return 0;
+}
+#endif
+
+static int lowmem_vmpressure_notify(struct notifier_block *nb,
+				    unsigned long action, void *data)
+{
+	lowmem_pressure = *(unsigned long *)data;
+	smp_wmb();
+	lowmem_pressure_jiffies = jiffies;
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lowmem_vmpressure_nb = {
+	.notifier_call = lowmem_vmpressure_notify,
+};
+
+/*
+ * Returns the current reclaim pressure (0-100), or -1 when the trigger is off
+ * or no reclaim window completed during the last second.
+ */
+static int lowmem_current_pressure(void)
+{
+	unsigned long stamp = lowmem_pressure_jiffies;
+
+	if (!lowmem_pressure_trigger || !stamp ||
+	    time_after(jiffies, stamp + HZ))
+		return -1;
+	smp_rmb();
+	return lowmem_pressure;
+}
+
+static void lowmem_scan_done(ktime_t start, int min_score_adj, int minfree,
+			     int other_free, int other_file)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	lowmem_hist_add(&lowmem_scan_hist, ns);
+	trace_lowmemory_scan(min_score_adj, minfree, other_free, other_file,
+			     ns);
+}
+
+
+
+/*
+ * Unmap the private memory of a killed task, much like a MADV_DONTNEED of
+ * all of it.  The victim cannot use it anymore, so there is no point in
+ * waiting until it gets to run exit_mm().  Bail out if the mm is shared
+ * with another process that survives the kill, or if mmap_sem is
+ * contended, which means the victim is in the middle of changing its
+ * mappings and will be gone soon anyway.  Returns true if the memory
+ * was unmapped.
+ */
+static bool lowmem_reap_task(struct task_struct *tsk)
+{
+	struct task_struct *p;
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	bool shared = false;
+	bool reaped = false;
+
+	p = find_lock_task_mm(tsk);
+	if (!p)
+		return false;
+	mm = p->mm;
+	atomic_inc(&mm->mm_users);
+	task_unlock(p);
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (p->mm == mm && !same_thread_group(p, tsk) &&
+		    !(p->flags & PF_KTHREAD)) {
+			shared = true;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	if (shared || !down_read_trylock(&mm->mmap_sem))
+		goto out;
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (vma->vm_flags & (VM_LOCKED | VM_HUGETLB | VM_PFNMAP |
+				     VM_MIXEDMAP | VM_IO | VM_SHARED))
+			continue;
+		zap_page_range(vma, vma->vm_start, vma->vm_end - vma->vm_start,
+			       NULL);
+	}
+	up_read(&mm->mmap_sem);
+	reaped = true;
+	lowmem_print(2, "reaped %d (%s), rss now %lu\n",
+		     tsk->pid, tsk->comm, get_mm_rss(mm));
+out:
+	mmput(mm);
+	return reaped;
+}
+
+static int lowmem_reaper(void *unused)
+{
+	struct task_struct *tsk;
+	bool reaped;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(lowmem_reaper_wait,
+					 lowmem_reap_victim ||
+					 kthread_should_stop());
+
+		spin_lock(&lowmem_reap_lock);
+		tsk = lowmem_reap_victim;
+		lowmem_reap_victim = NULL;
+		spin_unlock(&lowmem_reap_lock);
+		if (!tsk)
+			continue;
+
+		reaped = lowmem_reap_task(tsk);
+		put_task_struct(tsk);
+
+		/*
+		 * The memory is back, allow the next kill right away.  If it
+		 * is not, the victim still holds it until it exits, and the
+		 * usual death pending timeout keeps the next kill back.
+		 */
+		if (reaped)
+			lowmem_deathpending_timeout = jiffies;
+		atomic_inc(&lowmem_reap_seq);
+		wake_up_all(&lowmem_reap_done_wait);
+	}
+
+	spin_lock(&lowmem_reap_lock);
+	tsk = lowmem_reap_victim;
+	lowmem_reap_victim = NULL;
+	spin_unlock(&lowmem_reap_lock);
+	if (tsk)
+		put_task_struct(tsk);
+	return 0;
+}
+
+/* Hand a freshly killed task to the reaper; true if it was queued. */
+static bool lowmem_queue_reap(struct task_struct *tsk)
+{
+	bool queued = false;
+
+	if (!lowmem_reap || !lowmem_reaper_thread)
+		return false;
+
+	spin_lock(&lowmem_reap_lock);
+	if (!lowmem_reap_victim) {
+		get_task_struct(tsk);
+		lowmem_reap_victim = tsk;
+		queued = true;
+	}
+	spin_unlock(&lowmem_reap_lock);
+
+	if (queued)
+		wake_up(&lowmem_reaper_wait);
+	return queued;
+}
 
 #ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
 static struct task_struct *pick_next_from_adj_tree(struct task_struct *task);
@@ -80,11 +385,18 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	int min_score_adj = OOM_SCORE_ADJ_MAX + 1;
 	int selected_tasksize = 0;
 	int selected_oom_score_adj;
+	int minfree = 0;
+	int pressure;
+	int reap_seq = -1;
+	unsigned long compacted;
+	ktime_t scan_start;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free = global_page_state(NR_FREE_PAGES);
 	int other_file = global_page_state(NR_FILE_PAGES) -
 						global_page_state(NR_SHMEM);
 
+	other_free += lowmem_swap_headroom();
+
 	if (lowmem_adj_size < array_size)
 		array_size = lowmem_adj_size;
 	if (lowmem_minfree_size < array_size)
@@ -93,9 +405,23 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		if (other_free < lowmem_minfree[i] &&
 		    other_file < lowmem_minfree[i]) {
 			min_score_adj = lowmem_adj[i];
+			minfree = lowmem_minfree[i];
 			break;
 		}
 	}
+
+	pressure = lowmem_current_pressure();
+	if (pressure >= (int)lowmem_pressure_critical && array_size > 0 &&
+	    min_score_adj == OOM_SCORE_ADJ_MAX + 1) {
+		/* reclaim is failing, don't wait for free memory to drop */
+		min_score_adj = lowmem_adj[array_size - 1];
+		minfree = lowmem_minfree[array_size - 1];
+	} else if (pressure >= 0 && pressure < (int)lowmem_pressure_low && i > 0 &&
+		   min_score_adj != OOM_SCORE_ADJ_MAX + 1) {
+		/* reclaim keeps up, only the last resort threshold applies */
+		min_score_adj = OOM_SCORE_ADJ_MAX + 1;
+	}
+
 	if (sc->nr_to_scan > 0)
 		lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, ma %d\n",
 				sc->nr_to_scan, sc->gfp_mask, other_free,
@@ -111,6 +437,15 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	}
 	selected_oom_score_adj = min_score_adj;
 
+	/* the next call judges again with what compaction freed */
+	compacted = lowmem_compact();
+	if (compacted) {
+		lowmem_print(3, "lowmem_shrink %lu, %x, compacted %lu\n",
+			     sc->nr_to_scan, sc->gfp_mask, compacted);
+		return rem;
+	}
+
+	scan_start = ktime_get();
 	rcu_read_lock();
 
 #ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
@@ -130,10 +465,14 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		if (!p)
 			continue;
 
-		if (test_tsk_thread_flag(p, TIF_MEMDIE) &&
-		    time_before_eq(jiffies, lowmem_deathpending_timeout)) {
+		if (test_tsk_thread_flag(p, TIF_MEMDIE)) {
 			task_unlock(p);
+			if (time_after(jiffies, lowmem_deathpending_timeout))
+				/* already killed and reaped, or stuck */
+				continue;
 			rcu_read_unlock();
+			lowmem_scan_done(scan_start, min_score_adj, minfree,
+					 other_free, other_file);
 			return 0;
 		}
 		oom_score_adj = p->signal->oom_score_adj;
@@ -167,18 +506,38 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
 			     p->pid, p->comm, oom_score_adj, tasksize);
 	}
+	lowmem_scan_done(scan_start, min_score_adj, minfree,
+			 other_free, other_file);
 	if (selected) {
 		lowmem_print(1, "send sigkill to %d (%s), adj %d, size %d\n",
 			     selected->pid, selected->comm,
 			     selected_oom_score_adj, selected_tasksize);
+		trace_lowmemory_kill(selected, selected_oom_score_adj,
+				     selected_tasksize, minfree);
 		lowmem_deathpending_timeout = jiffies + HZ;
+		lowmem_kill_time = ktime_get();
+		smp_wmb();
+		lowmem_victim = selected;
 		send_sig(SIGKILL, selected, 0);
 		set_tsk_thread_flag(selected, TIF_MEMDIE);
+		tracing_snapshot_trigger("lowmemorykiller: kill");
 		rem -= selected_tasksize;
+		if (lowmem_queue_reap(selected))
+			reap_seq = atomic_read(&lowmem_reap_seq);
 	}
 	lowmem_print(4, "lowmem_shrink %lu, %x, return %d\n",
 		     sc->nr_to_scan, sc->gfp_mask, rem);
 	rcu_read_unlock();
+
+	/*
+	 * Let a direct reclaimer pick up the reaped memory instead of
+	 * going on to scan (and stall) while the victim is still exiting.
+	 */
+	if (reap_seq >= 0 && (sc->gfp_mask & __GFP_WAIT) &&
+	    current->reclaim_state && !current_is_kswapd())
+		wait_event_timeout(lowmem_reap_done_wait,
+				   atomic_read(&lowmem_reap_seq) != reap_seq,
+				   msecs_to_jiffies(lowmem_reap_wait_ms));
 	return rem;
 }
 
@@ -187,6 +546,82 @@ static struct shrinker lowmem_shrinker = {
 	.seeks = DEFAULT_SEEKS * 16
 };
 
+static int lowmem_task_free_notify(struct notifier_block *nb,
+				   unsigned long val, void *data)
+{
+	struct task_struct *tsk = data;
+	u64 ns;
+
+	if (tsk != ACCESS_ONCE(lowmem_victim) ||
+	    cmpxchg(&lowmem_victim, tsk, NULL) != tsk)
+		return NOTIFY_OK;
+
+	smp_rmb();
+	ns = ktime_to_ns(ktime_sub(ktime_get(), lowmem_kill_time));
+	lowmem_hist_add(&lowmem_kill_hist, ns);
+	trace_lowmemory_victim_freed(tsk, ns);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lowmem_task_free_nb = {
+	.notifier_call = lowmem_task_free_notify,
+};
+
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *lowmem_debugfs_root;
+
+static int lowmem_hist_show(struct seq_file *m, void *unused)
+{
+	struct lowmem_hist *hist = m->private;
+	int i;
+
+	for (i = 0; i < LOWMEM_HIST_BUCKETS; i++)
+		seq_printf(m, "%s%llu us: %d\n",
+			   i < LOWMEM_HIST_BUCKETS - 1 ? "<" : ">=",
+			   log2_hist_bound(i, LOWMEM_HIST_BUCKETS),
+			   atomic_read(&hist->count[i]));
+	return 0;
+}
+
+static int lowmem_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lowmem_hist_show, inode->i_private);
+}
+
+static const struct file_operations lowmem_hist_fops = {
+	.owner = THIS_MODULE,
+	.open = lowmem_hist_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void lowmem_debugfs_init(void)
+{
+	lowmem_debugfs_root = debugfs_create_dir("lowmemorykiller", NULL);
+	if (!lowmem_debugfs_root)
+		return;
+	debugfs_create_file("scan_latency", S_IRUGO, lowmem_debugfs_root,
+			    &lowmem_scan_hist, &lowmem_hist_fops);
+	debugfs_create_file("kill_latency", S_IRUGO, lowmem_debugfs_root,
+			    &lowmem_kill_hist, &lowmem_hist_fops);
+}
+
+static void lowmem_debugfs_exit(void)
+{
+	debugfs_remove_recursive(lowmem_debugfs_root);
+}
+#else
+static inline void lowmem_debugfs_init(void)
+{
+}
+
+static inline void lowmem_debugfs_exit(void)
+{
+}
+#endif
+
 #ifdef CONFIG_ANDROID_BG_SCAN_MEM
 static int lmk_task_migration_notify(struct notifier_block *nb,
 					unsigned long data, void *arg)
@@ -208,7 +643,17 @@ static struct notifier_block tsk_migration_nb = {
 
 static int __init lowmem_init(void)
 {
+	task_free_register(&lowmem_task_free_nb);
+	lowmem_reaper_thread = kthread_run(lowmem_reaper, NULL, "lmk_reaper");
+	if (IS_ERR(lowmem_reaper_thread)) {
+		pr_warning("lowmemorykiller: failed to start reaper\n");
+		lowmem_reaper_thread = NULL;
+	}
 	register_shrinker(&lowmem_shrinker);
+	if (vmpressure_notifier_register(&lowmem_vmpressure_nb))
+		pr_info("lowmemorykiller: vmpressure not available, "
+			"pressure_trigger has no effect\n");
+	lowmem_debugfs_init();
 #ifdef CONFIG_ANDROID_BG_SCAN_MEM
 	raw_notifier_chain_register(&bgtsk_migration_notifier_head,
 					&tsk_migration_nb);
@@ -218,7 +663,12 @@ static int __init lowmem_init(void)
 
 static void __exit lowmem_exit(void)
 {
+	lowmem_debugfs_exit();
+	vmpressure_notifier_unregister(&lowmem_vmpressure_nb);
 	unregister_shrinker(&lowmem_shrinker);
+	if (lowmem_reaper_thread)
+		kthread_stop(lowmem_reaper_thread);
+	task_free_unregister(&lowmem_task_free_nb);
 #ifdef CONFIG_ANDROID_BG_SCAN_MEM
 	raw_notifier_chain_unregister(&bgtsk_migration_notifier_head,
 					&tsk_migration_nb);
@@ -310,6 +760,21 @@ module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size,
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_named(swap_aware, lowmem_swap_aware, bool, S_IRUGO | S_IWUSR);
+module_param_named(swap_free_percent, lowmem_swap_free_percent, int,
+		   S_IRUGO | S_IWUSR);
+module_param_named(swap_credit_percent, lowmem_swap_credit_percent, int,
+		   S_IRUGO | S_IWUSR);
+module_param_named(swapin_budget, lowmem_swapin_budget, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(reap, lowmem_reap, bool, S_IRUGO | S_IWUSR);
+module_param_named(reap_wait_ms, lowmem_reap_wait_ms, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_trigger, lowmem_pressure_trigger, bool,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_low, lowmem_pressure_low, uint, S_IRUGO | S_IWUSR);
+module_param_named(pressure_critical, lowmem_pressure_critical, uint,
+		   S_IRUGO | S_IWUSR);
 module_init(lowmem_init);
 module_exit(lowmem_exit);
 
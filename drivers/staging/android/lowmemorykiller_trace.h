@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2012 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM lowmemorykiller
+
+#if !defined(_LOWMEMORYKILLER_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _LOWMEMORYKILLER_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(lowmemory_scan,
+	TP_PROTO(int min_score_adj, int minfree, int other_free,
+		 int other_file, u64 scan_ns),
+	TP_ARGS(min_score_adj, minfree, other_free, other_file, scan_ns),
+
+	TP_STRUCT__entry(
+		__field(int, min_score_adj)
+		__field(int, minfree)
+		__field(int, other_free)
+		__field(int, other_file)
+		__field(u64, scan_ns)
+	),
+	TP_fast_assign(
+		__entry->min_score_adj = min_score_adj;
+		__entry->minfree = minfree;
+		__entry->other_free = other_free;
+		__entry->other_file = other_file;
+		__entry->scan_ns = scan_ns;
+	),
+	TP_printk("min_adj=%d minfree=%d free=%d file=%d scan_ns=%llu",
+		  __entry->min_score_adj, __entry->minfree,
+		  __entry->other_free, __entry->other_file,
+		  __entry->scan_ns)
+);
+
+TRACE_EVENT(lowmemory_kill,
+	TP_PROTO(struct task_struct *victim, int oom_score_adj, int tasksize,
+		 int minfree),
+	TP_ARGS(victim, oom_score_adj, tasksize, minfree),
+
+	TP_STRUCT__entry(
+		__array(char, comm, TASK_COMM_LEN)
+		__field(pid_t, pid)
+		__field(int, oom_score_adj)
+		__field(int, tasksize)
+		__field(int, minfree)
+	),
+	TP_fast_assign(
+		memcpy(__entry->comm, victim->comm, TASK_COMM_LEN);
+		__entry->pid = victim->pid;
+		__entry->oom_score_adj = oom_score_adj;
+		__entry->tasksize = tasksize;
+		__entry->minfree = minfree;
+	),
+	TP_printk("%s pid=%d adj=%d size=%d minfree=%d",
+		  __entry->comm, __entry->pid, __entry->oom_score_adj,
+		  __entry->tasksize, __entry->minfree)
+);
+
+TRACE_EVENT(lowmemory_victim_freed,
+	TP_PROTO(struct task_struct *victim, u64 latency_ns),
+	TP_ARGS(victim, latency_ns),
+
+	TP_STRUCT__entry(
+		__array(char, comm, TASK_COMM_LEN)
+		__field(pid_t, pid)
+		__field(u64, latency_ns)
+	),
+	TP_fast_assign(
+		memcpy(__entry->comm, victim->comm, TASK_COMM_LEN);
+		__entry->pid = victim->pid;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("%s pid=%d latency_ns=%llu",
+		  __entry->comm, __entry->pid, __entry->latency_ns)
+);
+
+#endif /* _LOWMEMORYKILLER_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE lowmemorykiller_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,405 @@
+/*
+ * drivers/thermal/omap_pid_governor.c
+ *
+ * Predictive (PID) thermal governor for the OMAP on-die sensor
+ *
+ * Based on omap_die_governor.c
+ * Copyright (C) 2011 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+*/
+
+#include <linux/err.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/reboot.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <linux/suspend.h>
+#include <linux/thermal_framework.h>
+#include <plat/cpu.h>
+
+#define OMAP_FATAL_TEMP		125000
+#define OMAP_PANIC_TEMP		110000
+#define OMAP_TARGET_TEMP	95000
+#define OMAP_ENGAGE_TEMP	85000
+#define OMAP_SAFE_TEMP		25000
+#define HYSTERESIS_VALUE	2000
+
+#define NORMAL_TEMP_MONITORING_RATE	1000
+#define FAST_TEMP_MONITORING_RATE	250
+/* samples closer than this are too noisy to take a slope from */
+#define MIN_SLOPE_PERIOD		50
+
+/* one cooling level is one OPP below the maximum */
+#define PID_MAX_COOLING_LEVEL	4
+#define PID_LEVEL_SCALE		1000
+
+#define OMAP_GRADIENT_SLOPE_4460    348
+#define OMAP_GRADIENT_CONST_4460  -9301
+#define OMAP_GRADIENT_SLOPE_4470    308
+#define OMAP_GRADIENT_CONST_4470  -7896
+
+/* PCB sensor calculation constants */
+#define OMAP_GRADIENT_SLOPE_W_PCB_4460  1142
+#define OMAP_GRADIENT_CONST_W_PCB_4460  -393
+#define OMAP_GRADIENT_SLOPE_W_PCB_4470  1063
+#define OMAP_GRADIENT_CONST_W_PCB_4470  -477
+
+struct omap_pid_governor {
+	struct thermal_dev *temp_sensor;
+	struct list_head *cooling_list;
+	struct mutex lock;
+	struct delayed_work poll_work;
+	int report_rate;
+	int cooling_level;
+	int sensor_temp;
+	int avg_sensor_temp;
+	int pcb_temp;
+	int hotspot_temp;
+	int absolute_delta;
+	int slope;
+	int integral;
+	unsigned long last_sample;
+	bool controlling;
+	int gradient_slope;
+	int gradient_const;
+	int gradient_slope_w_pcb;
+	int gradient_const_w_pcb;
+};
+
+static struct thermal_dev *therm_fw;
+static struct omap_pid_governor *omap_gov;
+
+/*
+ * Controller gains.  The output is in thousandths of a cooling level:
+ * k_p per mC of error, k_i per mC*s of accumulated error and k_d per
+ * mC/s of hot spot slope.
+ */
+static int target_temp = OMAP_TARGET_TEMP;
+module_param(target_temp, int, 0644);
+static int k_p = 200;
+module_param(k_p, int, 0644);
+static int k_i = 20;
+module_param(k_i, int, 0644);
+static int k_d = 2000;
+module_param(k_d, int, 0644);
+
+/**
+ * DOC: Introduction
+ * =================
+ * The OMAP PID governor is an alternative to the zone based on-die governor.
+ * Instead of waiting for the hot spot to cross the alert and panic
+ * thresholds and then dropping the CPU to a much lower OPP, it samples the
+ * hot spot temperature periodically once it gets close to the target and
+ * computes a cooling level from the distance to the target (P), how long
+ * the hot spot has been above it (I) and how fast it is rising (D).
+ *
+ * The cooling level moves by at most one OPP per sample in either
+ * direction, so under a sustained load the integral term settles on the
+ * OPP the device can dissipate and the CPU stays there instead of cycling
+ * between the maximum and a throttled frequency.
+ *
+ * The hot spot temperature is extrapolated from the on-die sensor as in
+ * omap_die_governor.c, using the PCB sensor and the averaged on-die
+ * temperature when a PCB sensor is registered.
+ *
+ * The fatal temperature still restarts the device, and above the panic
+ * temperature the level is driven to the maximum regardless of the gains.
+*/
+
+static void omap_update_report_rate(int new_rate)
+{
+	if (omap_gov->report_rate == -EOPNOTSUPP)
+		return;
+
+	if (omap_gov->report_rate != new_rate)
+		omap_gov->report_rate = thermal_device_call(
+				omap_gov->temp_sensor, set_temp_report_rate,
+				new_rate);
+}
+
+static int convert_omap_sensor_temp_to_hotspot_temp(int sensor_temp)
+{
+	int absolute_delta;
+	int pcb_temp;
+
+	pcb_temp = thermal_lookup_temp("pcb");
+	omap_gov->pcb_temp = pcb_temp;
+	if (pcb_temp >= 0) {
+		absolute_delta = (
+			((omap_gov->avg_sensor_temp - pcb_temp) *
+			omap_gov->gradient_slope_w_pcb / 1000) +
+			omap_gov->gradient_const_w_pcb);
+
+		/* Ensure that this formula never returns negative value */
+		if (absolute_delta < 0)
+			absolute_delta = 0;
+	} else {
+		absolute_delta = (
+			(sensor_temp * omap_gov->gradient_slope / 1000) +
+			omap_gov->gradient_const);
+	}
+
+	omap_gov->absolute_delta = absolute_delta;
+
+	return sensor_temp + absolute_delta;
+}
+
+static int hotspot_temp_to_sensor_temp(int hot_spot_temp)
+{
+	if (omap_gov->pcb_temp >= 0)
+		return hot_spot_temp - omap_gov->absolute_delta;
+	else
+		return ((hot_spot_temp - omap_gov->gradient_const) * 1000) /
+			(1000 + omap_gov->gradient_slope);
+}
+
+static void omap_pid_set_cooling_level(int level)
+{
+	if (level == omap_gov->cooling_level)
+		return;
+
+	pr_info("%s: hot spot %d slope %d mC/s - cooling level %d -> %d\n",
+		__func__, omap_gov->hotspot_temp, omap_gov->slope,
+		omap_gov->cooling_level, level);
+
+	omap_gov->cooling_level = level;
+	thermal_device_call_all(omap_gov->cooling_list, cool_device, level);
+}
+
+/*
+ * omap_pid_update() - Run one controller step on a new hot spot sample
+ *
+ * Returns the cooling level to apply.
+ */
+static int omap_pid_update(int hotspot_temp, int dt_ms)
+{
+	int error = hotspot_temp - target_temp;
+	int level = omap_gov->cooling_level;
+	int integral_max;
+	int desired;
+	long output;
+
+	if (hotspot_temp >= OMAP_PANIC_TEMP) {
+		omap_gov->integral = 0;
+		return min(level + 1, PID_MAX_COOLING_LEVEL);
+	}
+
+	/*
+	 * Let the integral wind only while the output can still follow it,
+	 * and never below zero: it is what holds the level once the error
+	 * has settled around the target.
+	 */
+	if ((error > 0 && level < PID_MAX_COOLING_LEVEL) || error < 0)
+		omap_gov->integral += error * dt_ms / 1000;
+
+	integral_max = k_i ? PID_MAX_COOLING_LEVEL * PID_LEVEL_SCALE * 1000 /
+			k_i : 0;
+	omap_gov->integral = clamp(omap_gov->integral, 0, integral_max);
+
+	output = ((long)k_p * error + (long)k_i * omap_gov->integral +
+		  (long)k_d * omap_gov->slope) / 1000;
+	desired = DIV_ROUND_CLOSEST(output, PID_LEVEL_SCALE);
+	desired = clamp(desired, 0, PID_MAX_COOLING_LEVEL);
+
+	/* walk one OPP at a time */
+	if (desired > level)
+		level++;
+	else if (desired < level)
+		level--;
+
+	return level;
+}
+
+static void omap_pid_thermal_manager(int sensor_temp)
+{
+	unsigned long now = jiffies;
+	int hotspot_temp;
+	int upper;
+	int dt_ms;
+
+	omap_gov->sensor_temp = sensor_temp;
+	if (omap_gov->avg_sensor_temp)
+		omap_gov->avg_sensor_temp = (omap_gov->avg_sensor_temp * 7 +
+					     sensor_temp) / 8;
+	else
+		omap_gov->avg_sensor_temp = sensor_temp;
+
+	hotspot_temp = convert_omap_sensor_temp_to_hotspot_temp(sensor_temp);
+	if (hotspot_temp >= OMAP_FATAL_TEMP) {
+		pr_emerg("%s:FATAL ZONE (hot spot temp: %i)\n", __func__,
+			 hotspot_temp);
+		kernel_restart(NULL);
+	}
+
+	dt_ms = jiffies_to_msecs(now - omap_gov->last_sample);
+	if (omap_gov->last_sample && dt_ms >= MIN_SLOPE_PERIOD) {
+		int slope = (hotspot_temp - omap_gov->hotspot_temp) * 1000 /
+				dt_ms;
+
+		omap_gov->slope = (omap_gov->slope + slope) / 2;
+	} else if (omap_gov->last_sample) {
+		/* keep the previous sample as the slope reference */
+		return;
+	}
+	omap_gov->hotspot_temp = hotspot_temp;
+	omap_gov->last_sample = now;
+
+	if (!omap_gov->controlling &&
+	    hotspot_temp >= OMAP_ENGAGE_TEMP) {
+		omap_gov->controlling = true;
+		omap_gov->integral = 0;
+	} else if (omap_gov->controlling && !omap_gov->cooling_level &&
+		   hotspot_temp < OMAP_ENGAGE_TEMP - HYSTERESIS_VALUE) {
+		omap_gov->controlling = false;
+		omap_gov->integral = 0;
+	}
+
+	if (omap_gov->controlling && !list_empty(omap_gov->cooling_list))
+		omap_pid_set_cooling_level(omap_pid_update(hotspot_temp,
+				min(dt_ms, NORMAL_TEMP_MONITORING_RATE)));
+
+	/*
+	 * Sampling is done from poll_work; the thresholds only catch a
+	 * spike between two samples.
+	 */
+	upper = omap_gov->controlling ? OMAP_PANIC_TEMP : OMAP_ENGAGE_TEMP;
+	thermal_device_call(omap_gov->temp_sensor, set_temp_thresh,
+			    hotspot_temp_to_sensor_temp(OMAP_SAFE_TEMP),
+			    hotspot_temp_to_sensor_temp(upper));
+	omap_update_report_rate(omap_gov->controlling ?
+			FAST_TEMP_MONITORING_RATE : NORMAL_TEMP_MONITORING_RATE);
+}
+
+static void omap_pid_poll_work_fn(struct work_struct *work)
+{
+	struct omap_pid_governor *gov = container_of(work,
+					struct omap_pid_governor,
+					poll_work.work);
+	int rate;
+
+	/* the sensor reports back through omap_process_cpu_temp() */
+	if (gov->temp_sensor)
+		thermal_request_temp(gov->temp_sensor);
+
+	rate = gov->controlling ? FAST_TEMP_MONITORING_RATE :
+			NORMAL_TEMP_MONITORING_RATE;
+	schedule_delayed_work(&gov->poll_work, msecs_to_jiffies(rate));
+}
+
+static int omap_process_cpu_temp(struct thermal_dev *gov,
+				struct list_head *cooling_list,
+				struct thermal_dev *temp_sensor,
+				int temp)
+{
+	mutex_lock(&omap_gov->lock);
+	if (!omap_gov->temp_sensor)
+		omap_gov->temp_sensor = temp_sensor;
+	omap_gov->cooling_list = cooling_list;
+	omap_pid_thermal_manager(temp);
+	mutex_unlock(&omap_gov->lock);
+
+	return 0;
+}
+
+static int omap_pid_pm_notifier_cb(struct notifier_block *notifier,
+				unsigned long pm_event,  void *unused)
+{
+	switch (pm_event) {
+	case PM_SUSPEND_PREPARE:
+		cancel_delayed_work_sync(&omap_gov->poll_work);
+		break;
+	case PM_POST_SUSPEND:
+		/* the device cooled while suspended, restart the slope */
+		mutex_lock(&omap_gov->lock);
+		omap_gov->last_sample = 0;
+		omap_gov->slope = 0;
+		mutex_unlock(&omap_gov->lock);
+		schedule_delayed_work(&omap_gov->poll_work, 0);
+		break;
+	}
+
+	return NOTIFY_DONE;
+}
+
+static struct thermal_dev_ops omap_gov_ops = {
+	.process_temp = omap_process_cpu_temp,
+};
+
+static struct notifier_block omap_pid_pm_notifier = {
+	.notifier_call = omap_pid_pm_notifier_cb,
+};
+
+static int __init omap_pid_governor_init(void)
+{
+	struct thermal_dev *thermal_fw;
+
+	omap_gov = kzalloc(sizeof(struct omap_pid_governor), GFP_KERNEL);
+	if (!omap_gov) {
+		pr_err("%s:Cannot allocate memory\n", __func__);
+		return -ENOMEM;
+	}
+
+	mutex_init(&omap_gov->lock);
+	INIT_DELAYED_WORK(&omap_gov->poll_work, omap_pid_poll_work_fn);
+
+	if (cpu_is_omap446x()) {
+		omap_gov->gradient_slope = OMAP_GRADIENT_SLOPE_4460;
+		omap_gov->gradient_const = OMAP_GRADIENT_CONST_4460;
+		omap_gov->gradient_slope_w_pcb = OMAP_GRADIENT_SLOPE_W_PCB_4460;
+		omap_gov->gradient_const_w_pcb = OMAP_GRADIENT_CONST_W_PCB_4460;
+	} else if (cpu_is_omap447x()) {
+		omap_gov->gradient_slope = OMAP_GRADIENT_SLOPE_4470;
+		omap_gov->gradient_const = OMAP_GRADIENT_CONST_4470;
+		omap_gov->gradient_slope_w_pcb = OMAP_GRADIENT_SLOPE_W_PCB_4470;
+		omap_gov->gradient_const_w_pcb = OMAP_GRADIENT_CONST_W_PCB_4470;
+	}
+
+	thermal_fw = kzalloc(sizeof(struct thermal_dev), GFP_KERNEL);
+	if (!thermal_fw) {
+		pr_err("%s: Cannot allocate memory\n", __func__);
+		kfree(omap_gov);
+		return -ENOMEM;
+	}
+
+	thermal_fw->name = "omap_pid_governor";
+	thermal_fw->domain_name = "cpu";
+	thermal_fw->dev_ops = &omap_gov_ops;
+	thermal_governor_dev_register(thermal_fw);
+	therm_fw = thermal_fw;
+
+	if (register_pm_notifier(&omap_pid_pm_notifier))
+		pr_err("%s: omap_pid pm registration failed!\n", __func__);
+
+	schedule_delayed_work(&omap_gov->poll_work,
+			msecs_to_jiffies(NORMAL_TEMP_MONITORING_RATE));
+
+	return 0;
+}
+
+static void __exit omap_pid_governor_exit(void)
+{
+	unregister_pm_notifier(&omap_pid_pm_notifier);
+	cancel_delayed_work_sync(&omap_gov->poll_work);
+	thermal_governor_dev_unregister(therm_fw);
+	kfree(therm_fw);
+	kfree(omap_gov);
+}
+
+module_init(omap_pid_governor_init);
+module_exit(omap_pid_governor_exit);
+
+MODULE_DESCRIPTION("OMAP predictive (PID) thermal governor");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,195 @@
+/*
+ * OMAP CPU/GPU power budget cooling agent
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+*/
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/thermal_framework.h>
+
+/**
+ * DOC: Introduction
+ * =================
+ * The MPU and the SGX share one die and one hot spot, but only the MPU
+ * had a cooling agent on the "cpu" domain, so a GPU bound game had its CPU
+ * throttled while the GPU kept drawing the power.
+ *
+ * This agent sits on the "cpu" domain in place of the cpufreq one and
+ * treats the governor's cooling level as the number of OPP steps the
+ * system has to give up.  Those steps are split between the "mpu" and
+ * "gpu" domains by how idle each one is: the busier domain keeps more of
+ * its OPPs.  The split is re-evaluated while the budget is held, moving
+ * one step at a time so frame pacing does not see the frequencies swap
+ * back and forth.
+ */
+
+#define BUDGET_REBALANCE_PERIOD	1000
+
+static unsigned int mpu_max_level = 4;
+module_param(mpu_max_level, uint, 0644);
+
+static unsigned int gpu_max_level = 2;
+module_param(gpu_max_level, uint, 0644);
+
+struct power_budget {
+	int level;
+	int mpu_level;
+	int gpu_level;
+	int mpu_load;
+	int gpu_load;
+	bool gpu_present;
+	struct delayed_work rebalance_work;
+};
+
+static struct power_budget pb;
+static DEFINE_MUTEX(budget_lock);
+
+static void power_budget_update_loads(void)
+{
+	int load;
+
+	load = thermal_domain_get_load("mpu");
+	if (load >= 0)
+		pb.mpu_load = (pb.mpu_load * 3 + load) / 4;
+
+	load = thermal_domain_get_load("gpu");
+	pb.gpu_present = load >= 0;
+	if (pb.gpu_present)
+		pb.gpu_load = (pb.gpu_load * 3 + load) / 4;
+}
+
+/* number of the budget's steps the mpu should take, the gpu gets the rest */
+static int power_budget_mpu_share(void)
+{
+	int mpu_room, gpu_room, mpu_level;
+	int gpu_max = pb.gpu_present ? gpu_max_level : 0;
+
+	mpu_room = 101 - pb.mpu_load;
+	gpu_room = 101 - pb.gpu_load;
+	mpu_level = DIV_ROUND_CLOSEST(pb.level * mpu_room,
+				      mpu_room + gpu_room);
+	if (!gpu_max)
+		mpu_level = pb.level;
+
+	/* hand whatever one side cannot absorb to the other */
+	if (pb.level - mpu_level > gpu_max)
+		mpu_level = pb.level - gpu_max;
+	if (mpu_level > (int)mpu_max_level)
+		mpu_level = mpu_max_level;
+
+	return mpu_level;
+}
+
+static void power_budget_apply(int mpu_level)
+{
+	int gpu_level = pb.level - mpu_level;
+
+	if (gpu_level < 0 || !pb.gpu_present)
+		gpu_level = 0;
+	if (gpu_level > (int)gpu_max_level)
+		gpu_level = gpu_max_level;
+
+	if (mpu_level == pb.mpu_level && gpu_level == pb.gpu_level)
+		return;
+
+	pr_debug("%s: level %d load mpu %d gpu %d -> mpu %d gpu %d\n",
+		 __func__, pb.level, pb.mpu_load, pb.gpu_load,
+		 mpu_level, gpu_level);
+
+	/* throttle before releasing so the total never exceeds the budget */
+	if (mpu_level > pb.mpu_level) {
+		thermal_domain_cool("mpu", mpu_level);
+		if (pb.gpu_present)
+			thermal_domain_cool("gpu", gpu_level);
+	} else {
+		if (pb.gpu_present)
+			thermal_domain_cool("gpu", gpu_level);
+		thermal_domain_cool("mpu", mpu_level);
+	}
+
+	pb.mpu_level = mpu_level;
+	pb.gpu_level = gpu_level;
+}
+
+static void power_budget_rebalance_fn(struct work_struct *work)
+{
+	int target;
+
+	mutex_lock(&budget_lock);
+	if (!pb.level)
+		goto out;
+
+	power_budget_update_loads();
+	target = power_budget_mpu_share();
+	if (target > pb.mpu_level)
+		power_budget_apply(pb.mpu_level + 1);
+	else if (target < pb.mpu_level)
+		power_budget_apply(pb.mpu_level - 1);
+
+	schedule_delayed_work(&pb.rebalance_work,
+			      msecs_to_jiffies(BUDGET_REBALANCE_PERIOD));
+out:
+	mutex_unlock(&budget_lock);
+}
+
+static int power_budget_cool_device(struct thermal_dev *dev,
+				    int cooling_level)
+{
+	if (cooling_level < 0)
+		cooling_level = 0;
+
+	mutex_lock(&budget_lock);
+	if (cooling_level != pb.level) {
+		if (!pb.level)
+			schedule_delayed_work(&pb.rebalance_work,
+				msecs_to_jiffies(BUDGET_REBALANCE_PERIOD));
+
+		pb.level = cooling_level;
+		power_budget_update_loads();
+		power_budget_apply(power_budget_mpu_share());
+	}
+	mutex_unlock(&budget_lock);
+
+	return 0;
+}
+
+static struct thermal_dev_ops power_budget_ops = {
+	.cool_device = power_budget_cool_device,
+};
+
+static struct thermal_dev power_budget_dev = {
+	.name		= "power_budget",
+	.domain_name	= "cpu",
+	.dev_ops	= &power_budget_ops,
+};
+
+static int __init omap_power_budget_init(void)
+{
+	INIT_DELAYED_WORK(&pb.rebalance_work, power_budget_rebalance_fn);
+
+	return thermal_cooling_dev_register(&power_budget_dev);
+}
+
+static void __exit omap_power_budget_exit(void)
+{
+	thermal_cooling_dev_unregister(&power_budget_dev);
+	cancel_delayed_work_sync(&pb.rebalance_work);
+}
+
+module_init(omap_power_budget_init);
+module_exit(omap_power_budget_exit);
+
+MODULE_DESCRIPTION("OMAP CPU/GPU power budget cooling agent");
+MODULE_LICENSE("GPL");
@@ -337,6 +337,61 @@ int thermal_lookup_temp(const char *name)
 }
 EXPORT_SYMBOL_GPL(thermal_lookup_temp);
 
+/**
+ * thermal_domain_cool() - Apply a cooling level to the cooling agents of a
+ *			   domain directly.  This lets a cooling agent of one
+ *			   domain split its level across the agents of other
+ *			   domains that have no governor of their own.
+ *
+ * @domain_name: The domain whose cooling agents should be called.
+ * @cooling_level: The cooling level to pass to each agent.
+ *
+ * Returns the result of the last cool_device call.
+ * ENODEV if the domain does not exist or has no cooling agents.
+ */
+int thermal_domain_cool(const char *domain_name, int cooling_level)
+{
+	struct thermal_domain *thermal_domain;
+
+	thermal_domain = thermal_domain_find(domain_name);
+	if (!thermal_domain)
+		return -ENODEV;
+
+	return thermal_device_call_all(&thermal_domain->cooling_agents,
+					cool_device, cooling_level);
+}
+EXPORT_SYMBOL_GPL(thermal_domain_cool);
+
+/**
+ * thermal_domain_get_load() - Requests the load of the busiest cooling agent
+ *			       of a domain.
+ *
+ * @domain_name: The domain to look up.
+ *
+ * Returns the load in percent.
+ * ENODEV if the domain does not exist.
+ * EOPNOTSUPP if none of the cooling agents reports a load.
+ */
+int thermal_domain_get_load(const char *domain_name)
+{
+	struct thermal_domain *thermal_domain;
+	struct thermal_dev *tdev;
+	int load, ret = -EOPNOTSUPP;
+
+	thermal_domain = thermal_domain_find(domain_name);
+	if (!thermal_domain)
+		return -ENODEV;
+
+	list_for_each_entry(tdev, &thermal_domain->cooling_agents, node) {
+		load = thermal_device_call(tdev, get_load);
+		if (load > ret)
+			ret = load;
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(thermal_domain_get_load);
+
 /**
  * thermal_governor_dev_register() - Registration call for thermal domain governors
  *
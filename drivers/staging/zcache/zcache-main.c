@@ -30,6 +30,7 @@
 #include <linux/atomic.h>
 #include <linux/math64.h>
 #include <linux/crypto.h>
+#include <linux/hrtimer.h>
 #include <linux/string.h>
 #include "tmem.h"
 
@@ -86,29 +87,75 @@ static inline bool is_local_client(struct zcache_client *cli)
 /* crypto API for zcache  */
 #define ZCACHE_COMP_NAME_SZ CRYPTO_MAX_ALG_NAME
 static char zcache_comp_name[ZCACHE_COMP_NAME_SZ];
-static struct crypto_comp * __percpu *zcache_comp_pcpu_tfms;
+
+/*
+ * Compressors zcache can switch between at runtime.  Every stored page
+ * records the index of the compressor that produced it, so pages
+ * compressed before a switch are still decompressed correctly; per-cpu
+ * transforms are therefore kept for every available entry.
+ */
+struct zcache_comp {
+	const char *name;
+	bool avail;
+	struct crypto_comp * __percpu *tfms;
+	atomic64_t comp_count;
+	atomic64_t comp_ns;
+	atomic64_t decomp_count;
+	atomic64_t decomp_ns;
+};
+
+static struct zcache_comp zcache_comps[] = {
+	{ .name = "lzo" },
+	{ .name = "lz4" },
+	{ .name = "snappy" },
+};
+
+#define ZCACHE_NR_COMPS ARRAY_SIZE(zcache_comps)
+
+/* index into zcache_comps[] used for new puts */
+static int zcache_comp_cur;
+
+static int zcache_comp_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ZCACHE_NR_COMPS; i++)
+		if (sysfs_streq(name, zcache_comps[i].name))
+			return i;
+	return -1;
+}
 
 enum comp_op {
 	ZCACHE_COMPOP_COMPRESS,
 	ZCACHE_COMPOP_DECOMPRESS
 };
 
-static inline int zcache_comp_op(enum comp_op op,
+static inline int zcache_comp_op(enum comp_op op, int comp,
 				const u8 *src, unsigned int slen,
 				u8 *dst, unsigned int *dlen)
 {
+	struct zcache_comp *zc = &zcache_comps[comp];
 	struct crypto_comp *tfm;
+	ktime_t start;
+	s64 delta;
 	int ret;
 
-	BUG_ON(!zcache_comp_pcpu_tfms);
-	tfm = *per_cpu_ptr(zcache_comp_pcpu_tfms, get_cpu());
+	BUG_ON(!zc->avail);
+	tfm = *per_cpu_ptr(zc->tfms, get_cpu());
 	BUG_ON(!tfm);
+	start = ktime_get();
 	switch (op) {
 	case ZCACHE_COMPOP_COMPRESS:
 		ret = crypto_comp_compress(tfm, src, slen, dst, dlen);
+		delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+		atomic64_inc(&zc->comp_count);
+		atomic64_add(delta, &zc->comp_ns);
 		break;
 	case ZCACHE_COMPOP_DECOMPRESS:
 		ret = crypto_comp_decompress(tfm, src, slen, dst, dlen);
+		delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+		atomic64_inc(&zc->decomp_count);
+		atomic64_add(delta, &zc->decomp_ns);
 		break;
 	}
 	put_cpu();
@@ -143,6 +190,7 @@ struct zbud_hdr {
 	struct tmem_oid oid;
 	uint32_t index;
 	uint16_t size; /* compressed size in bytes, zero means unused */
+	uint8_t comp; /* zcache_comps[] index used to compress */
 	DECL_SENTINEL
 };
 
@@ -365,7 +413,7 @@ static void zbud_free_and_delist(struct zbud_hdr *zh)
 static struct zbud_hdr *zbud_create(uint16_t client_id, uint16_t pool_id,
 					struct tmem_oid *oid,
 					uint32_t index, struct page *page,
-					void *cdata, unsigned size)
+					void *cdata, unsigned size, int comp)
 {
 	struct zbud_hdr *zh0, *zh1, *zh = NULL;
 	struct zbud_page *zbpg = NULL, *ztmp;
@@ -419,6 +467,7 @@ found_unbuddied:
 init_zh:
 	SET_SENTINEL(zh, ZBH);
 	zh->size = size;
+	zh->comp = comp;
 	zh->index = index;
 	zh->oid = *oid;
 	zh->pool_id = pool_id;
@@ -458,7 +507,7 @@ static int zbud_decompress(struct page *page, struct zbud_hdr *zh)
 	to_va = kmap_atomic(page, KM_USER0);
 	size = zh->size;
 	from_va = zbud_data(zh, size);
-	ret = zcache_comp_op(ZCACHE_COMPOP_DECOMPRESS, from_va, size,
+	ret = zcache_comp_op(ZCACHE_COMPOP_DECOMPRESS, zh->comp, from_va, size,
 				to_va, &out_len);
 	BUG_ON(ret);
 	BUG_ON(out_len != PAGE_SIZE);
@@ -672,6 +721,7 @@ struct zv_hdr {
 	struct tmem_oid oid;
 	uint32_t index;
 	size_t size;
+	uint8_t comp; /* zcache_comps[] index used to compress */
 	DECL_SENTINEL
 };
 
@@ -695,7 +745,7 @@ static atomic_t zv_cumul_dist_counts[NCHUNKS];
 
 static unsigned long zv_create(struct zs_pool *pool, uint32_t pool_id,
 				struct tmem_oid *oid, uint32_t index,
-				void *cdata, unsigned clen)
+				void *cdata, unsigned clen, int comp)
 {
 	struct zv_hdr *zv;
 	u32 size = clen + sizeof(struct zv_hdr);
@@ -714,6 +764,7 @@ static unsigned long zv_create(struct zs_pool *pool, uint32_t pool_id,
 	zv->oid = *oid;
 	zv->pool_id = pool_id;
 	zv->size = clen;
+	zv->comp = comp;
 	SET_SENTINEL(zv, ZVH);
 	memcpy((char *)zv + sizeof(struct zv_hdr), cdata, clen);
 	zs_unmap_object(pool, handle);
@@ -754,8 +805,8 @@ static void zv_decompress(struct page *page, unsigned long handle)
 	BUG_ON(zv->size == 0);
 	ASSERT_SENTINEL(zv, ZVH);
 	to_va = kmap_atomic(page, KM_USER0);
-	ret = zcache_comp_op(ZCACHE_COMPOP_DECOMPRESS, (char *)zv + sizeof(*zv),
-				zv->size, to_va, &clen);
+	ret = zcache_comp_op(ZCACHE_COMPOP_DECOMPRESS, zv->comp,
+				(char *)zv + sizeof(*zv), zv->size, to_va, &clen);
 	kunmap_atomic(to_va, KM_USER0);
 	zs_unmap_object(zcache_host.zspool, handle);
 	BUG_ON(ret);
@@ -895,6 +946,74 @@ static ssize_t zv_page_count_policy_percent_store(struct kobject *kobj,
 	return count;
 }
 
+/*
+ * comp_name selects the compressor used for new puts; pages already
+ * stored keep being decompressed with the one that compressed them.
+ * Only compressors with a crypto driver available are listed.
+ */
+static ssize_t comp_name_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < ZCACHE_NR_COMPS; i++) {
+		if (!zcache_comps[i].avail)
+			continue;
+		if (i == zcache_comp_cur)
+			p += sprintf(p, "[%s] ", zcache_comps[i].name);
+		else
+			p += sprintf(p, "%s ", zcache_comps[i].name);
+	}
+	if (p > buf)
+		p--;
+	p += sprintf(p, "\n");
+	return p - buf;
+}
+
+static ssize_t comp_name_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	int comp;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	comp = zcache_comp_find(buf);
+	if (comp < 0 || !zcache_comps[comp].avail)
+		return -EINVAL;
+	zcache_comp_cur = comp;
+	return count;
+}
+
+/*
+ * show per-compressor call counts and mean latencies, in nanoseconds
+ */
+static ssize_t comp_stats_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < ZCACHE_NR_COMPS; i++) {
+		struct zcache_comp *zc = &zcache_comps[i];
+		u64 comps, decomps;
+
+		if (!zc->avail)
+			continue;
+		comps = atomic64_read(&zc->comp_count);
+		decomps = atomic64_read(&zc->decomp_count);
+		p += sprintf(p, "%s comp:%llu mean_ns:%llu decomp:%llu mean_ns:%llu\n",
+			zc->name, comps,
+			comps ? div64_u64(atomic64_read(&zc->comp_ns), comps) : 0,
+			decomps,
+			decomps ? div64_u64(atomic64_read(&zc->decomp_ns),
+					decomps) : 0);
+	}
+	return p - buf;
+}
+
 static struct kobj_attribute zcache_zv_max_zsize_attr = {
 		.attr = { .name = "zv_max_zsize", .mode = 0644 },
 		.show = zv_max_zsize_show,
@@ -913,6 +1032,17 @@ static struct kobj_attribute zcache_zv_page_count_policy_percent_attr = {
 		.show = zv_page_count_policy_percent_show,
 		.store = zv_page_count_policy_percent_store,
 };
+
+static struct kobj_attribute zcache_comp_name_attr = {
+		.attr = { .name = "comp_name", .mode = 0644 },
+		.show = comp_name_show,
+		.store = comp_name_store,
+};
+
+static struct kobj_attribute zcache_comp_stats_attr = {
+		.attr = { .name = "comp_stats", .mode = 0444 },
+		.show = comp_stats_show,
+};
 #endif
 
 /*
@@ -1168,7 +1298,8 @@ static atomic_t zcache_curr_pers_pampd_count = ATOMIC_INIT(0);
 static unsigned long zcache_curr_pers_pampd_count_max;
 
 /* forward reference */
-static int zcache_compress(struct page *from, void **out_va, unsigned *out_len);
+static int zcache_compress(struct page *from, void **out_va, unsigned *out_len,
+				int *out_comp);
 
 static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 				struct tmem_pool *pool, struct tmem_oid *oid,
@@ -1176,6 +1307,7 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 {
 	void *pampd = NULL, *cdata;
 	unsigned clen;
+	int comp;
 	int ret;
 	unsigned long count;
 	struct page *page = (struct page *)(data);
@@ -1186,7 +1318,7 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 	u64 total_zsize;
 
 	if (eph) {
-		ret = zcache_compress(page, &cdata, &clen);
+		ret = zcache_compress(page, &cdata, &clen, &comp);
 		if (ret == 0)
 			goto out;
 		if (clen == 0 || clen > zbud_max_buddy_size()) {
@@ -1194,7 +1326,7 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 			goto out;
 		}
 		pampd = (void *)zbud_create(client_id, pool->pool_id, oid,
-						index, page, cdata, clen);
+						index, page, cdata, clen, comp);
 		if (pampd != NULL) {
 			count = atomic_inc_return(&zcache_curr_eph_pampd_count);
 			if (count > zcache_curr_eph_pampd_count_max)
@@ -1206,7 +1338,7 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 		if (curr_pers_pampd_count >
 		    (zv_page_count_policy_percent * totalram_pages) / 100)
 			goto out;
-		ret = zcache_compress(page, &cdata, &clen);
+		ret = zcache_compress(page, &cdata, &clen, &comp);
 		if (ret == 0)
 			goto out;
 		/* reject if compression is too poor */
@@ -1225,7 +1357,7 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 			}
 		}
 		pampd = (void *)zv_create(cli->zspool, pool->pool_id,
-						oid, index, cdata, clen);
+						oid, index, cdata, clen, comp);
 		if (pampd == NULL)
 			goto out;
 		count = atomic_inc_return(&zcache_curr_pers_pampd_count);
@@ -1324,10 +1456,12 @@ static struct tmem_pamops zcache_pamops = {
 static DEFINE_PER_CPU(unsigned char *, zcache_dstmem);
 #define ZCACHE_DSTMEM_ORDER 1
 
-static int zcache_compress(struct page *from, void **out_va, unsigned *out_len)
+static int zcache_compress(struct page *from, void **out_va, unsigned *out_len,
+				int *out_comp)
 {
 	int ret = 0;
 	unsigned char *dmem = __get_cpu_var(zcache_dstmem);
+	int comp = ACCESS_ONCE(zcache_comp_cur);
 	char *from_va;
 
 	BUG_ON(!irqs_disabled());
@@ -1336,34 +1470,48 @@ static int zcache_compress(struct page *from, void **out_va, unsigned *out_len)
 	*out_len = PAGE_SIZE << ZCACHE_DSTMEM_ORDER;
 	from_va = kmap_atomic(from, KM_USER0);
 	mb();
-	ret = zcache_comp_op(ZCACHE_COMPOP_COMPRESS, from_va, PAGE_SIZE, dmem,
-				out_len);
+	ret = zcache_comp_op(ZCACHE_COMPOP_COMPRESS, comp, from_va, PAGE_SIZE,
+				dmem, out_len);
 	BUG_ON(ret);
 	*out_va = dmem;
+	*out_comp = comp;
 	kunmap_atomic(from_va, KM_USER0);
 	ret = 1;
 out:
 	return ret;
 }
 
-static int zcache_comp_cpu_up(int cpu)
+static void zcache_comp_cpu_down(int cpu)
 {
 	struct crypto_comp *tfm;
+	int i;
 
-	tfm = crypto_alloc_comp(zcache_comp_name, 0, 0);
-	if (IS_ERR(tfm))
-		return NOTIFY_BAD;
-	*per_cpu_ptr(zcache_comp_pcpu_tfms, cpu) = tfm;
-	return NOTIFY_OK;
+	for (i = 0; i < ZCACHE_NR_COMPS; i++) {
+		if (!zcache_comps[i].avail)
+			continue;
+		tfm = *per_cpu_ptr(zcache_comps[i].tfms, cpu);
+		if (tfm)
+			crypto_free_comp(tfm);
+		*per_cpu_ptr(zcache_comps[i].tfms, cpu) = NULL;
+	}
 }
 
-static void zcache_comp_cpu_down(int cpu)
+static int zcache_comp_cpu_up(int cpu)
 {
 	struct crypto_comp *tfm;
+	int i;
 
-	tfm = *per_cpu_ptr(zcache_comp_pcpu_tfms, cpu);
-	crypto_free_comp(tfm);
-	*per_cpu_ptr(zcache_comp_pcpu_tfms, cpu) = NULL;
+	for (i = 0; i < ZCACHE_NR_COMPS; i++) {
+		if (!zcache_comps[i].avail)
+			continue;
+		tfm = crypto_alloc_comp(zcache_comps[i].name, 0, 0);
+		if (IS_ERR(tfm)) {
+			zcache_comp_cpu_down(cpu);
+			return NOTIFY_BAD;
+		}
+		*per_cpu_ptr(zcache_comps[i].tfms, cpu) = tfm;
+	}
+	return NOTIFY_OK;
 }
 
 static int zcache_cpu_notifier(struct notifier_block *nb,
@@ -1515,6 +1663,8 @@ static struct attribute *zcache_attrs[] = {
 	&zcache_zv_max_zsize_attr.attr,
 	&zcache_zv_max_mean_zsize_attr.attr,
 	&zcache_zv_page_count_policy_percent_attr.attr,
+	&zcache_comp_name_attr.attr,
+	&zcache_comp_stats_attr.attr,
 	NULL,
 };
 
@@ -1983,31 +2133,36 @@ __setup("zcache=", enable_zcache_compressor);
 
 static int zcache_comp_init(void)
 {
-	int ret = 0;
+	int i, comp = -1;
+
+	/* check crypto algorithms and alloc their percpu transforms */
+	for (i = 0; i < ZCACHE_NR_COMPS; i++) {
+		struct zcache_comp *zc = &zcache_comps[i];
+
+		if (!crypto_has_comp(zc->name, 0, 0))
+			continue;
+		zc->tfms = alloc_percpu(struct crypto_comp *);
+		if (!zc->tfms)
+			continue;
+		zc->avail = true;
+	}
 
-	/* check crypto algorithm */
 	if (*zcache_comp_name != '\0') {
-		ret = crypto_has_comp(zcache_comp_name, 0, 0);
-		if (!ret)
+		comp = zcache_comp_find(zcache_comp_name);
+		if (comp < 0 || !zcache_comps[comp].avail) {
 			pr_info("zcache: %s not supported\n",
 					zcache_comp_name);
+			comp = -1;
+		}
 	}
-	if (!ret)
-		strcpy(zcache_comp_name, "lzo");
-	ret = crypto_has_comp(zcache_comp_name, 0, 0);
-	if (!ret) {
-		ret = 1;
-		goto out;
-	}
-	pr_info("zcache: using %s compressor\n", zcache_comp_name);
+	if (comp < 0)
+		comp = zcache_comp_find("lzo");
+	if (!zcache_comps[comp].avail)
+		return 1;
 
-	/* alloc percpu transforms */
-	ret = 0;
-	zcache_comp_pcpu_tfms = alloc_percpu(struct crypto_comp *);
-	if (!zcache_comp_pcpu_tfms)
-		ret = 1;
-out:
-	return ret;
+	zcache_comp_cur = comp;
+	pr_info("zcache: using %s compressor\n", zcache_comps[comp].name);
+	return 0;
 }
 
 static int __init zcache_init(void)
@@ -273,6 +273,13 @@ static void adb_android_function_disable(struct android_usb_function *f)
 		android_enable(dev);
 }
 
+static struct device_attribute dev_attr_adb_stats =
+	__ATTR(stats, S_IRUGO, adb_stats_show, NULL);
+static struct device_attribute *adb_function_attributes[] = {
+	&dev_attr_adb_stats,
+	NULL
+};
+
 static struct android_usb_function adb_function = {
 	.name		= "adb",
 	.enable		= adb_android_function_enable,
@@ -280,6 +287,7 @@ static struct android_usb_function adb_function = {
 	.init		= adb_function_init,
 	.cleanup	= adb_function_cleanup,
 	.bind_config	= adb_function_bind_config,
+	.attributes	= adb_function_attributes,
 };
 
 static void adb_ready_callback(void)
@@ -423,12 +431,20 @@ static int mtp_function_ctrlrequest(struct android_usb_function *f,
 	return mtp_ctrlrequest(cdev, c);
 }
 
+static struct device_attribute dev_attr_mtp_stats =
+	__ATTR(stats, S_IRUGO, mtp_stats_show, NULL);
+static struct device_attribute *mtp_function_attributes[] = {
+	&dev_attr_mtp_stats,
+	NULL
+};
+
 static struct android_usb_function mtp_function = {
 	.name		= "mtp",
 	.init		= mtp_function_init,
 	.cleanup	= mtp_function_cleanup,
 	.bind_config	= mtp_function_bind_config,
 	.ctrlrequest	= mtp_function_ctrlrequest,
+	.attributes	= mtp_function_attributes,
 };
 
 /* PTP function is same as MTP with slightly different interface descriptor */
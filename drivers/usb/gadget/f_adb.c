@@ -32,8 +32,44 @@
 /* number of tx requests to allocate */
 #define TX_REQ_MAX 4
 
+/* limit of adb_rx_reqs */
+#define ADB_RX_REQS_MAX 8
+
+/*
+ * Size and number of the bulk requests, read when the function binds.
+ * adb_read() and adb_write() take up to a request at a time.  Received
+ * transfers are held in up to adb_rx_reqs buffers until adbd reads them.
+ */
+static unsigned int adb_tx_req_len = 16384;
+module_param(adb_tx_req_len, uint, S_IRUGO | S_IWUSR);
+static unsigned int adb_tx_reqs = 8;
+module_param(adb_tx_reqs, uint, S_IRUGO | S_IWUSR);
+static unsigned int adb_rx_req_len = 16384;
+module_param(adb_rx_req_len, uint, S_IRUGO | S_IWUSR);
+static unsigned int adb_rx_reqs = 4;
+module_param(adb_rx_reqs, uint, S_IRUGO | S_IWUSR);
+
 static const char adb_shortname[] = "android_adb";
 
+/* struct amessage of adb, sent by the host before each payload */
+struct adb_msg_header {
+	__le32 command;
+	__le32 arg0;
+	__le32 arg1;
+	__le32 data_length;
+	__le32 data_check;
+	__le32 magic;		/* command ^ 0xffffffff */
+};
+
+struct adb_stats {
+	u64 rx_bytes;
+	u64 tx_bytes;
+	unsigned long rx_xfers;
+	unsigned long tx_xfers;
+	/* reads that found their data already received */
+	unsigned long rx_ahead;
+};
+
 struct adb_dev {
 	struct usb_function function;
 	struct usb_composite_dev *cdev;
@@ -53,8 +89,29 @@ struct adb_dev {
 
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
-	struct usb_request *rx_req;
-	int rx_done;
+
+	/*
+	 * One OUT request is kept queued as long as there is an idle
+	 * buffer and the length of the next transfer is known: the host
+	 * does not end its transfers with a zero length packet, so a
+	 * request longer than the transfer would not complete.  A header
+	 * gives the length of the payload after it, a payload is followed
+	 * by a header.  When it is not known, adb_read() queues a request
+	 * of the length it was asked for.  Under lock.
+	 */
+	struct usb_request *rx_req[ADB_RX_REQS_MAX];
+	struct list_head rx_idle;
+	struct list_head rx_full;	/* received, not read yet */
+	unsigned rx_offset;		/* already read of the first one */
+	unsigned rx_next_len;		/* 0 if not known */
+	int rx_busy;			/* a request is queued */
+
+	unsigned tx_req_len;
+	unsigned tx_reqs;
+	unsigned rx_req_len;
+	unsigned rx_reqs;
+
+	struct adb_stats stats;
 };
 
 static struct usb_interface_descriptor adb_interface_desc = {
@@ -196,23 +253,101 @@ static void adb_complete_in(struct usb_ep *ep, struct usb_request *req)
 
 	if (req->status != 0)
 		dev->error = 1;
+	else
+		dev->stats.tx_xfers++;
 
 	adb_req_put(dev, &dev->tx_idle, req);
 
 	wake_up(&dev->write_wq);
 }
 
+/* the length of the transfer that follows @req, 0 if not known */
+static unsigned adb_next_rx_len(struct adb_dev *dev, struct usb_request *req)
+{
+	struct adb_msg_header *msg = req->buf;
+	u32 len;
+
+	/* after a payload, the header of the next message */
+	if (req->actual != sizeof(*msg) ||
+	    le32_to_cpu(msg->magic) != (le32_to_cpu(msg->command) ^ 0xffffffff))
+		return sizeof(*msg);
+
+	len = le32_to_cpu(msg->data_length);
+	if (!len)
+		return sizeof(*msg);
+	if (len > dev->rx_req_len)
+		return 0;
+	return len;
+}
+
+/* queue an idle OUT request if the next transfer length is known */
+static void adb_rx_queue(struct adb_dev *dev)
+{
+	struct usb_request *req = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->online && !dev->error && !dev->rx_busy && dev->rx_next_len &&
+	    !list_empty(&dev->rx_idle)) {
+		req = list_first_entry(&dev->rx_idle, struct usb_request, list);
+		list_del(&req->list);
+		req->length = dev->rx_next_len;
+		dev->rx_busy = 1;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (!req)
+		return;
+
+	/* not under the lock, the request may complete right away */
+	if (usb_ep_queue(dev->ep_out, req, GFP_ATOMIC) < 0) {
+		pr_debug("adb_rx_queue: failed to queue req %p\n", req);
+		spin_lock_irqsave(&dev->lock, flags);
+		list_add(&req->list, &dev->rx_idle);
+		dev->rx_busy = 0;
+		dev->error = 1;
+		spin_unlock_irqrestore(&dev->lock, flags);
+		wake_up(&dev->read_wq);
+	}
+}
+
 static void adb_complete_out(struct usb_ep *ep, struct usb_request *req)
 {
 	struct adb_dev *dev = _adb_dev;
+	unsigned long flags;
 
-	dev->rx_done = 1;
-	if (req->status != 0)
+	spin_lock_irqsave(&dev->lock, flags);
+	dev->rx_busy = 0;
+	if (req->status != 0) {
 		dev->error = 1;
+		list_add(&req->list, &dev->rx_idle);
+	} else if (req->actual == 0) {
+		/* a 0-len packet: throw it back, same length */
+		list_add(&req->list, &dev->rx_idle);
+	} else {
+		dev->rx_next_len = adb_next_rx_len(dev, req);
+		list_add_tail(&req->list, &dev->rx_full);
+		dev->stats.rx_bytes += req->actual;
+		dev->stats.rx_xfers++;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
 
+	adb_rx_queue(dev);
 	wake_up(&dev->read_wq);
 }
 
+/* forget what was received before a reconnect or a new adbd */
+static void adb_rx_reset(struct adb_dev *dev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	list_splice_init(&dev->rx_full, &dev->rx_idle);
+	dev->rx_offset = 0;
+	dev->rx_next_len = 0;
+	spin_unlock_irqrestore(&dev->lock, flags);
+}
+
 static int adb_create_bulk_endpoints(struct adb_dev *dev,
 				struct usb_endpoint_descriptor *in_desc,
 				struct usb_endpoint_descriptor *out_desc)
@@ -242,17 +377,45 @@ static int adb_create_bulk_endpoints(struct adb_dev *dev,
 	ep->driver_data = dev;		/* claim the endpoint */
 	dev->ep_out = ep;
 
-	/* now allocate requests for our endpoints */
-	req = adb_request_new(dev->ep_out, ADB_BULK_BUFFER_SIZE);
-	if (!req)
-		goto fail;
-	req->complete = adb_complete_out;
-	dev->rx_req = req;
-
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = adb_request_new(dev->ep_in, ADB_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+	/* now allocate requests for our endpoints, or the old 4KB ones */
+	dev->rx_req_len = max(adb_rx_req_len, (unsigned)ADB_BULK_BUFFER_SIZE);
+	dev->rx_reqs = clamp(adb_rx_reqs, 1U, (unsigned)ADB_RX_REQS_MAX);
+retry_rx_alloc:
+	for (i = 0; i < dev->rx_reqs; i++) {
+		req = adb_request_new(dev->ep_out, dev->rx_req_len);
+		if (!req) {
+			if (dev->rx_req_len == ADB_BULK_BUFFER_SIZE &&
+			    dev->rx_reqs == 1)
+				goto fail;
+			while (i--) {
+				adb_request_free(dev->rx_req[i], dev->ep_out);
+				dev->rx_req[i] = NULL;
+			}
+			INIT_LIST_HEAD(&dev->rx_idle);
+			dev->rx_req_len = ADB_BULK_BUFFER_SIZE;
+			dev->rx_reqs = 1;
+			goto retry_rx_alloc;
+		}
+		req->complete = adb_complete_out;
+		dev->rx_req[i] = req;
+		adb_req_put(dev, &dev->rx_idle, req);
+	}
+
+	dev->tx_req_len = max(adb_tx_req_len, (unsigned)ADB_BULK_BUFFER_SIZE);
+	dev->tx_reqs = max(adb_tx_reqs, 1U);
+retry_tx_alloc:
+	for (i = 0; i < dev->tx_reqs; i++) {
+		req = adb_request_new(dev->ep_in, dev->tx_req_len);
+		if (!req) {
+			if (dev->tx_req_len == ADB_BULK_BUFFER_SIZE &&
+			    dev->tx_reqs == TX_REQ_MAX)
+				goto fail;
+			while ((req = adb_req_get(dev, &dev->tx_idle)))
+				adb_request_free(req, dev->ep_in);
+			dev->tx_req_len = ADB_BULK_BUFFER_SIZE;
+			dev->tx_reqs = TX_REQ_MAX;
+			goto retry_tx_alloc;
+		}
 		req->complete = adb_complete_in;
 		adb_req_put(dev, &dev->tx_idle, req);
 	}
@@ -276,9 +439,6 @@ static ssize_t adb_read(struct file *fp, char __user *buf,
 	if (!_adb_dev)
 		return -ENODEV;
 
-	if (count > ADB_BULK_BUFFER_SIZE)
-		return -EINVAL;
-
 	if (adb_lock(&dev->read_excl))
 		return -EBUSY;
 
@@ -296,42 +456,57 @@ static ssize_t adb_read(struct file *fp, char __user *buf,
 		r = -EIO;
 		goto done;
 	}
-
-requeue_req:
-	/* queue a request */
-	req = dev->rx_req;
-	req->length = count;
-	dev->rx_done = 0;
-	ret = usb_ep_queue(dev->ep_out, req, GFP_ATOMIC);
-	if (ret < 0) {
-		pr_debug("adb_read: failed to queue req %p (%d)\n", req, ret);
-		r = -EIO;
-		dev->error = 1;
+	if (count > dev->rx_req_len) {
+		r = -EINVAL;
 		goto done;
-	} else {
-		pr_debug("rx %p queue\n", req);
 	}
 
-	/* wait for a request to complete */
-	ret = wait_event_interruptible(dev->read_wq, dev->rx_done);
-	if (ret < 0) {
-		dev->error = 1;
-		r = ret;
-		usb_ep_dequeue(dev->ep_out, req);
-		goto done;
-	}
-	if (!dev->error) {
-		/* If we got a 0-len packet, throw it back and try again. */
-		if (req->actual == 0)
-			goto requeue_req;
+	spin_lock_irq(&dev->lock);
+	if (!list_empty(&dev->rx_full))
+		dev->stats.rx_ahead++;
+	while (list_empty(&dev->rx_full)) {
+		/* nothing on the way whose length we know: ask for ours */
+		if (!dev->rx_busy && !dev->rx_next_len)
+			dev->rx_next_len = count;
+		spin_unlock_irq(&dev->lock);
 
-		pr_debug("rx %p %d\n", req, req->actual);
-		xfer = (req->actual < count) ? req->actual : count;
-		if (copy_to_user(buf, req->buf, xfer))
-			r = -EFAULT;
+		adb_rx_queue(dev);
 
-	} else
-		r = -EIO;
+		/* wait for a request to complete */
+		ret = wait_event_interruptible(dev->read_wq,
+			!list_empty(&dev->rx_full) || dev->error);
+		if (ret < 0) {
+			/* the request stays queued for the next read */
+			r = ret;
+			goto done;
+		}
+		if (dev->error) {
+			r = -EIO;
+			goto done;
+		}
+		spin_lock_irq(&dev->lock);
+	}
+	/* we are the only reader, completions only add at the tail */
+	req = list_first_entry(&dev->rx_full, struct usb_request, list);
+	spin_unlock_irq(&dev->lock);
+
+	pr_debug("rx %p %d\n", req, req->actual);
+	xfer = min_t(unsigned, req->actual - dev->rx_offset, count);
+	if (copy_to_user(buf, req->buf + dev->rx_offset, xfer)) {
+		r = -EFAULT;
+		goto done;
+	}
+	r = xfer;
+
+	/* keep what was not read for the next read */
+	spin_lock_irq(&dev->lock);
+	dev->rx_offset += xfer;
+	if (dev->rx_offset == req->actual) {
+		list_move_tail(&req->list, &dev->rx_idle);
+		dev->rx_offset = 0;
+	}
+	spin_unlock_irq(&dev->lock);
+	adb_rx_queue(dev);
 
 done:
 	adb_unlock(&dev->read_excl);
@@ -372,8 +547,8 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 		}
 
 		if (req != 0) {
-			if (count > ADB_BULK_BUFFER_SIZE)
-				xfer = ADB_BULK_BUFFER_SIZE;
+			if (count > dev->tx_req_len)
+				xfer = dev->tx_req_len;
 			else
 				xfer = count;
 			if (copy_from_user(req->buf, buf, xfer)) {
@@ -392,6 +567,7 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 
 			buf += xfer;
 			count -= xfer;
+			dev->stats.tx_bytes += xfer;
 
 			/* zero this so we don't try to free it on error exit */
 			req = 0;
@@ -419,6 +595,7 @@ static int adb_open(struct inode *ip, struct file *fp)
 
 	/* clear the error latch */
 	_adb_dev->error = 0;
+	adb_rx_reset(_adb_dev);
 
 	adb_ready_callback();
 
@@ -450,6 +627,23 @@ static struct miscdevice adb_device = {
 	.fops = &adb_fops,
 };
 
+static ssize_t adb_stats_show(struct device *pdev,
+		struct device_attribute *attr, char *buf)
+{
+	struct adb_dev *dev = _adb_dev;
+
+	if (!dev)
+		return -ENODEV;
+
+	return sprintf(buf, "rx_bytes=%llu rx_xfers=%lu rx_ahead=%lu "
+		       "tx_bytes=%llu tx_xfers=%lu\n"
+		       "rx_reqs=%u rx_req_len=%u tx_reqs=%u tx_req_len=%u\n",
+		       dev->stats.rx_bytes, dev->stats.rx_xfers,
+		       dev->stats.rx_ahead, dev->stats.tx_bytes,
+		       dev->stats.tx_xfers, dev->rx_reqs, dev->rx_req_len,
+		       dev->tx_reqs, dev->tx_req_len);
+}
+
 
 
 
@@ -495,14 +689,19 @@ adb_function_unbind(struct usb_configuration *c, struct usb_function *f)
 {
 	struct adb_dev	*dev = func_to_adb(f);
 	struct usb_request *req;
-
+	int i;
 
 	dev->online = 0;
 	dev->error = 1;
 
 	wake_up(&dev->read_wq);
 
-	adb_request_free(dev->rx_req, dev->ep_out);
+	adb_rx_reset(dev);
+	INIT_LIST_HEAD(&dev->rx_idle);
+	for (i = 0; i < ADB_RX_REQS_MAX; i++) {
+		adb_request_free(dev->rx_req[i], dev->ep_out);
+		dev->rx_req[i] = NULL;
+	}
 	while ((req = adb_req_get(dev, &dev->tx_idle)))
 		adb_request_free(req, dev->ep_in);
 }
@@ -529,6 +728,7 @@ static int adb_function_set_alt(struct usb_function *f,
 		usb_ep_disable(dev->ep_in);
 		return ret;
 	}
+	adb_rx_reset(dev);
 	dev->online = 1;
 
 	/* readers may be blocked waiting for us to go online */
@@ -590,6 +790,8 @@ static int adb_setup(void)
 	atomic_set(&dev->write_excl, 0);
 
 	INIT_LIST_HEAD(&dev->tx_idle);
+	INIT_LIST_HEAD(&dev->rx_idle);
+	INIT_LIST_HEAD(&dev->rx_full);
 
 	_adb_dev = dev;
 
@@ -25,6 +25,10 @@
 #include <linux/wait.h>
 #include <linux/err.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/backing-dev.h>
+#include <linux/pagemap.h>
 
 #include <linux/types.h>
 #include <linux/file.h>
@@ -37,6 +41,7 @@
 #include <linux/usb/f_mtp.h>
 
 #define MTP_BULK_BUFFER_SIZE       16384
+#define MTP_FILE_BUFFER_SIZE       65536
 #define INTR_BUFFER_SIZE           28
 
 /* String IDs */
@@ -54,6 +59,25 @@
 #define RX_REQ_MAX 2
 #define INTR_REQ_MAX 5
 
+/* the file transfers keep up to this many requests queued */
+#define MTP_TX_REQS 8
+#define MTP_RX_REQS 4
+#define MTP_RX_REQS_MAX 8
+
+/*
+ * Size and number of the bulk requests, read when the function binds.
+ * If the buffers cannot be allocated, the function falls back to
+ * TX_REQ_MAX and RX_REQ_MAX buffers of MTP_BULK_BUFFER_SIZE.
+ */
+static unsigned int mtp_tx_req_len = MTP_FILE_BUFFER_SIZE;
+module_param(mtp_tx_req_len, uint, S_IRUGO | S_IWUSR);
+static unsigned int mtp_tx_reqs = MTP_TX_REQS;
+module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
+static unsigned int mtp_rx_req_len = MTP_FILE_BUFFER_SIZE;
+module_param(mtp_rx_req_len, uint, S_IRUGO | S_IWUSR);
+static unsigned int mtp_rx_reqs = MTP_RX_REQS;
+module_param(mtp_rx_reqs, uint, S_IRUGO | S_IWUSR);
+
 /* ID for Microsoft MTP OS String */
 #define MTP_OS_STRING_ID   0xEE
 
@@ -69,6 +93,16 @@
 
 static const char mtp_shortname[] = "mtp_usb";
 
+/* totals of the MTP_SEND_FILE* or of the MTP_RECEIVE_FILE transfers */
+struct mtp_xfer_stats {
+	unsigned long files;
+	u64 bytes;
+	u64 usecs;		/* from the ioctl to the last request queued */
+	u64 vfs_usecs;		/* of which in vfs_read() or vfs_write() */
+	unsigned int last_kbps;	/* KB/s of the last file */
+	unsigned int max_kbps;
+};
+
 struct mtp_dev {
 	struct usb_function function;
 	struct usb_composite_dev *cdev;
@@ -91,8 +125,15 @@ struct mtp_dev {
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
 	wait_queue_head_t intr_wq;
-	struct usb_request *rx_req[RX_REQ_MAX];
-	int rx_done;
+	struct usb_request *rx_req[MTP_RX_REQS_MAX];
+	/* completed rx requests, they complete in the order queued */
+	unsigned rx_done;
+
+	/* what mtp_create_bulk_endpoints() could allocate */
+	unsigned tx_req_len;
+	unsigned tx_reqs;
+	unsigned rx_req_len;
+	unsigned rx_reqs;
 
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
 	 * MTP_SEND_FILE_WITH_HEADER ioctls on a work queue
@@ -109,6 +150,9 @@ struct mtp_dev {
 	int xfer_result;
 
 	int zlp_maxpacket;
+
+	struct mtp_xfer_stats send_stats;
+	struct mtp_xfer_stats receive_stats;
 };
 
 static struct usb_interface_descriptor mtp_interface_desc = {
@@ -363,8 +407,9 @@ static void mtp_complete_out(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
 
-	dev->rx_done = 1;
-	if (req->status != 0)
+	dev->rx_done++;
+	/* -ECONNRESET is a request we dequeued ourselves */
+	if (req->status != 0 && req->status != -ECONNRESET)
 		dev->state = STATE_ERROR;
 
 	wake_up(&dev->read_wq);
@@ -431,17 +476,42 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	dev->ep_intr = ep;
 
 	/* now allocate requests for our endpoints */
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_in, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+	dev->tx_req_len = max(mtp_tx_req_len, (unsigned)MTP_BULK_BUFFER_SIZE);
+	dev->tx_reqs = max(mtp_tx_reqs, 2U);
+retry_tx_alloc:
+	for (i = 0; i < dev->tx_reqs; i++) {
+		req = mtp_request_new(dev->ep_in, dev->tx_req_len);
+		if (!req) {
+			if (dev->tx_req_len == MTP_BULK_BUFFER_SIZE &&
+			    dev->tx_reqs == TX_REQ_MAX)
+				goto fail;
+			while ((req = mtp_req_get(dev, &dev->tx_idle)))
+				mtp_request_free(req, dev->ep_in);
+			dev->tx_req_len = MTP_BULK_BUFFER_SIZE;
+			dev->tx_reqs = TX_REQ_MAX;
+			goto retry_tx_alloc;
+		}
 		req->complete = mtp_complete_in;
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
-	for (i = 0; i < RX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_out, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+
+	dev->rx_req_len = max(mtp_rx_req_len, (unsigned)MTP_BULK_BUFFER_SIZE);
+	dev->rx_reqs = clamp(mtp_rx_reqs, 2U, (unsigned)MTP_RX_REQS_MAX);
+retry_rx_alloc:
+	for (i = 0; i < dev->rx_reqs; i++) {
+		req = mtp_request_new(dev->ep_out, dev->rx_req_len);
+		if (!req) {
+			if (dev->rx_req_len == MTP_BULK_BUFFER_SIZE &&
+			    dev->rx_reqs == RX_REQ_MAX)
+				goto fail;
+			while (i--) {
+				mtp_request_free(dev->rx_req[i], dev->ep_out);
+				dev->rx_req[i] = NULL;
+			}
+			dev->rx_req_len = MTP_BULK_BUFFER_SIZE;
+			dev->rx_reqs = RX_REQ_MAX;
+			goto retry_rx_alloc;
+		}
 		req->complete = mtp_complete_out;
 		dev->rx_req[i] = req;
 	}
@@ -471,7 +541,7 @@ static ssize_t mtp_read(struct file *fp, char __user *buf,
 
 	DBG(cdev, "mtp_read(%d)\n", count);
 
-	if (count > MTP_BULK_BUFFER_SIZE)
+	if (count > dev->rx_req_len)
 		return -EINVAL;
 
 	/* we will block until we're online */
@@ -590,8 +660,8 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 		if (xfer && copy_from_user(req->buf, buf, xfer)) {
@@ -628,6 +698,47 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+/* add one finished file transfer to @stats */
+static void mtp_account_xfer(struct mtp_xfer_stats *stats, u64 bytes,
+			     ktime_t start, u64 vfs_usecs)
+{
+	u64 usecs = ktime_us_delta(ktime_get(), start);
+	unsigned int kbps = 0;
+
+	if (usecs)
+		kbps = div64_u64((bytes >> 10) * USEC_PER_SEC, usecs);
+
+	stats->files++;
+	stats->bytes += bytes;
+	stats->usecs += usecs;
+	stats->vfs_usecs += vfs_usecs;
+	stats->last_kbps = kbps;
+	if (kbps > stats->max_kbps)
+		stats->max_kbps = kbps;
+}
+
+/*
+ * The file is read in order: give it the read-ahead window that
+ * POSIX_FADV_SEQUENTIAL would, and at least the size of the tx queue,
+ * so the disk reads the next buffers while the queued ones are sent.
+ */
+static void mtp_file_readahead(struct mtp_dev *dev, struct file *filp)
+{
+	struct address_space *mapping = filp->f_mapping;
+	unsigned long ra_pages;
+
+	if (!mapping || !mapping->backing_dev_info)
+		return;
+
+	ra_pages = max_t(unsigned long,
+			 mapping->backing_dev_info->ra_pages * 2,
+			 (dev->tx_reqs * dev->tx_req_len) >> PAGE_CACHE_SHIFT);
+	spin_lock(&filp->f_lock);
+	filp->f_ra.ra_pages = ra_pages;
+	filp->f_mode &= ~FMODE_RANDOM;
+	spin_unlock(&filp->f_lock);
+}
+
 /* read from a local file and write to USB */
 static void send_file_work(struct work_struct *data) {
 	struct mtp_dev	*dev = container_of(data, struct mtp_dev, send_file_work);
@@ -640,6 +751,8 @@ static void send_file_work(struct work_struct *data) {
 	int xfer, ret, hdr_size;
 	int r = 0;
 	int sendZLP = 0;
+	ktime_t start, t;
+	u64 bytes = 0, vfs_usecs = 0;
 
 	/* read our parameters */
 	smp_rmb();
@@ -649,6 +762,9 @@ static void send_file_work(struct work_struct *data) {
 
 	DBG(cdev, "send_file_work(%lld %lld)\n", offset, count);
 
+	start = ktime_get();
+	mtp_file_readahead(dev, filp);
+
 	if (dev->xfer_send_header) {
 		hdr_size = sizeof(struct mtp_data_header);
 		count += hdr_size;
@@ -667,7 +783,7 @@ static void send_file_work(struct work_struct *data) {
 		if (count == 0)
 			sendZLP = 0;
 
-		/* get an idle tx request to use */
+		/* get an idle tx request to use, the others are on the wire */
 		req = 0;
 		ret = wait_event_interruptible(dev->write_wq,
 			(req = mtp_req_get(dev, &dev->tx_idle))
@@ -681,8 +797,8 @@ static void send_file_work(struct work_struct *data) {
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 
@@ -695,7 +811,9 @@ static void send_file_work(struct work_struct *data) {
 			header->transaction_id = __cpu_to_le32(dev->xfer_transaction_id);
 		}
 
+		t = ktime_get();
 		ret = vfs_read(filp, req->buf + hdr_size, xfer - hdr_size, &offset);
+		vfs_usecs += ktime_us_delta(ktime_get(), t);
 		if (ret < 0) {
 			r = ret;
 			break;
@@ -713,6 +831,7 @@ static void send_file_work(struct work_struct *data) {
 		}
 
 		count -= xfer;
+		bytes += xfer;
 
 		/* zero this so we don't try to free it on error exit */
 		req = 0;
@@ -721,23 +840,37 @@ static void send_file_work(struct work_struct *data) {
 	if (req)
 		mtp_req_put(dev, &dev->tx_idle, req);
 
+	if (!r)
+		mtp_account_xfer(&dev->send_stats, bytes, start, vfs_usecs);
+
 	DBG(cdev, "send_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
 	smp_wmb();
 }
 
-/* read from USB and write to a local file */
+/*
+ * read from USB and write to a local file
+ *
+ * Up to rx_reqs requests are kept queued on ep_out, so the host can go
+ * on sending while the oldest one is written to the file.  Requests of
+ * one endpoint complete in the order they were queued, rx_done counts
+ * them.
+ */
 static void receive_file_work(struct work_struct *data)
 {
 	struct mtp_dev	*dev = container_of(data, struct mtp_dev, receive_file_work);
 	struct usb_composite_dev *cdev = dev->cdev;
-	struct usb_request *read_req = NULL, *write_req = NULL;
+	struct usb_request *req;
 	struct file *filp;
 	loff_t offset;
 	int64_t count;
-	int ret, cur_buf = 0;
+	unsigned head = 0, queued = 0, completed = 0, i;
+	bool unbounded, eof = false;
+	int ret;
 	int r = 0;
+	ktime_t start, t;
+	u64 bytes = 0, vfs_usecs = 0;
 
 	/* read our parameters */
 	smp_rmb();
@@ -747,62 +880,90 @@ static void receive_file_work(struct work_struct *data)
 
 	DBG(cdev, "receive_file_work(%lld)\n", count);
 
-	while (count > 0 || write_req) {
-		if (count > 0) {
-			/* queue a request */
-			read_req = dev->rx_req[cur_buf];
-			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
+	start = ktime_get();
+	/* if xfer_file_length is 0xFFFFFFFF, then we read until
+	 * we get a short packet
+	 */
+	unbounded = (count == 0xFFFFFFFF);
+	dev->rx_done = 0;
 
-			read_req->length = (count > MTP_BULK_BUFFER_SIZE
-					? MTP_BULK_BUFFER_SIZE : count);
-			dev->rx_done = 0;
-			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
+	for (;;) {
+		/* queue every idle request the data left can fill */
+		while (!eof && queued < dev->rx_reqs &&
+		       (unbounded || count > 0)) {
+			req = dev->rx_req[(head + queued) % dev->rx_reqs];
+			if (unbounded || count > dev->rx_req_len)
+				req->length = dev->rx_req_len;
+			else
+				req->length = count;
+			ret = usb_ep_queue(dev->ep_out, req, GFP_KERNEL);
 			if (ret < 0) {
 				r = -EIO;
 				dev->state = STATE_ERROR;
-				break;
+				goto out;
 			}
+			if (!unbounded)
+				count -= req->length;
+			queued++;
 		}
+		if (!queued)
+			break;
 
-		if (write_req) {
-			DBG(cdev, "rx %p %d\n", write_req, write_req->actual);
-			ret = vfs_write(filp, write_req->buf, write_req->actual,
-				&offset);
-			DBG(cdev, "vfs_write %d\n", ret);
-			if (ret != write_req->actual) {
-				r = -EIO;
-				dev->state = STATE_ERROR;
-				break;
-			}
-			write_req = NULL;
+		/* wait for the oldest one to complete */
+		ret = wait_event_interruptible(dev->read_wq,
+			dev->rx_done != completed || dev->state != STATE_BUSY);
+		if (dev->state == STATE_CANCELED) {
+			r = -ECANCELED;
+			break;
+		}
+		if (dev->state != STATE_BUSY) {
+			r = -EIO;
+			break;
+		}
+		if (ret < 0) {
+			r = ret;
+			break;
 		}
+		smp_rmb();
 
-		if (read_req) {
-			/* wait for our last read to complete */
-			ret = wait_event_interruptible(dev->read_wq,
-				dev->rx_done || dev->state != STATE_BUSY);
-			if (dev->state == STATE_CANCELED) {
-				r = -ECANCELED;
-				if (!dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
-			}
-			/* if xfer_file_length is 0xFFFFFFFF, then we read until
-			 * we get a zero length packet
-			 */
-			if (count != 0xFFFFFFFF)
-				count -= read_req->actual;
-			if (read_req->actual < read_req->length) {
-				/* short packet is used to signal EOF for sizes > 4 gig */
-				DBG(cdev, "got short packet\n");
-				count = 0;
-			}
+		req = dev->rx_req[head];
+		head = (head + 1) % dev->rx_reqs;
+		queued--;
+		completed++;
+
+		DBG(cdev, "rx %p %d\n", req, req->actual);
+		if (req->actual < req->length) {
+			/* short packet is used to signal EOF for sizes > 4 gig */
+			DBG(cdev, "got short packet\n");
+			eof = true;
+		}
 
-			write_req = read_req;
-			read_req = NULL;
+		t = ktime_get();
+		ret = vfs_write(filp, req->buf, req->actual, &offset);
+		vfs_usecs += ktime_us_delta(ktime_get(), t);
+		DBG(cdev, "vfs_write %d\n", ret);
+		if (ret != req->actual) {
+			r = -EIO;
+			dev->state = STATE_ERROR;
+			break;
 		}
+		bytes += ret;
+		if (eof)
+			break;
 	}
 
+out:
+	/* take back the requests still queued before they are reused */
+	if (queued) {
+		for (i = 0; i < queued; i++)
+			usb_ep_dequeue(dev->ep_out,
+				dev->rx_req[(head + i) % dev->rx_reqs]);
+		wait_event(dev->read_wq, dev->rx_done == completed + queued);
+	}
+
+	if (!r)
+		mtp_account_xfer(&dev->receive_stats, bytes, start, vfs_usecs);
+
 	DBG(cdev, "receive_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
@@ -1002,6 +1163,32 @@ static struct miscdevice mtp_device = {
 	.fops = &mtp_fops,
 };
 
+static ssize_t mtp_stats_show(struct device *pdev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mtp_dev *dev = _mtp_dev;
+	struct mtp_xfer_stats *stats[2];
+	char *p = buf;
+	int i;
+
+	if (!dev)
+		return -ENODEV;
+
+	stats[0] = &dev->send_stats;
+	stats[1] = &dev->receive_stats;
+	for (i = 0; i < 2; i++)
+		p += sprintf(p, "%s files=%lu bytes=%llu usecs=%llu "
+			     "vfs_usecs=%llu last_kbps=%u max_kbps=%u\n",
+			     i ? "receive" : "send", stats[i]->files,
+			     stats[i]->bytes, stats[i]->usecs,
+			     stats[i]->vfs_usecs, stats[i]->last_kbps,
+			     stats[i]->max_kbps);
+	p += sprintf(p, "tx_reqs=%u tx_req_len=%u rx_reqs=%u rx_req_len=%u\n",
+		     dev->tx_reqs, dev->tx_req_len,
+		     dev->rx_reqs, dev->rx_req_len);
+	return p - buf;
+}
+
 static int mtp_ctrlrequest(struct usb_composite_dev *cdev,
 				const struct usb_ctrlrequest *ctrl)
 {
@@ -1139,8 +1326,10 @@ mtp_function_unbind(struct usb_configuration *c, struct usb_function *f)
 
 	while ((req = mtp_req_get(dev, &dev->tx_idle)))
 		mtp_request_free(req, dev->ep_in);
-	for (i = 0; i < RX_REQ_MAX; i++)
+	for (i = 0; i < MTP_RX_REQS_MAX; i++) {
 		mtp_request_free(dev->rx_req[i], dev->ep_out);
+		dev->rx_req[i] = NULL;
+	}
 	while ((req = mtp_req_get(dev, &dev->intr_idle)))
 		mtp_request_free(req, dev->ep_intr);
 	dev->state = STATE_OFFLINE;
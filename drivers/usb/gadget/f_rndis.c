@@ -76,6 +76,22 @@
  *   - MS-Windows drivers sometimes emit undocumented requests.
  */
 
+/* Packets per transfer in each direction, taking effect at the next
+ * connection.  The host learns the uplink limit from us; downlink
+ * batches are also kept within the transfer size the host gave.
+ */
+#define RNDIS_MAX_PKT_PER_XFER	10
+
+static unsigned int rndis_ul_max_pkt_per_xfer = 3;
+module_param(rndis_ul_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_ul_max_pkt_per_xfer,
+	"max packets per host to device transfer (1 disables batching)");
+
+static unsigned int rndis_dl_max_pkt_per_xfer = RNDIS_MAX_PKT_PER_XFER;
+module_param(rndis_dl_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_dl_max_pkt_per_xfer,
+	"max packets per device to host transfer (1 disables batching)");
+
 struct rndis_ep_descs {
 	struct usb_endpoint_descriptor	*in;
 	struct usb_endpoint_descriptor	*out;
@@ -313,6 +329,15 @@ static struct sk_buff *rndis_add_header(struct gether *port,
 {
 	struct sk_buff *skb2;
 
+	/* the header usually fits in front, as gether_connect() asked
+	 * the stack to leave room for it
+	 */
+	if (skb_headroom(skb) >= sizeof(struct rndis_packet_msg_type)
+			&& !skb_header_cloned(skb)) {
+		rndis_add_hdr(skb);
+		return skb;
+	}
+
 	skb2 = skb_realloc_headroom(skb, sizeof(struct rndis_packet_msg_type));
 	if (skb2)
 		rndis_add_hdr(skb2);
@@ -514,6 +539,15 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 		/* Avoid ZLPs; they can be troublesome. */
 		rndis->port.is_zlp_ok = false;
 
+		rndis->port.ul_max_pkts_per_xfer = clamp_t(unsigned int,
+				rndis_ul_max_pkt_per_xfer,
+				1, RNDIS_MAX_PKT_PER_XFER);
+		rndis->port.dl_max_pkts_per_xfer = clamp_t(unsigned int,
+				rndis_dl_max_pkt_per_xfer,
+				1, RNDIS_MAX_PKT_PER_XFER);
+		/* until REMOTE_NDIS_INITIALIZE_MSG says otherwise */
+		rndis->port.dl_max_xfer_size = 0;
+
 		/* RNDIS should be in the "RNDIS uninitialized" state,
 		 * either never activated or after rndis_uninit().
 		 *
@@ -535,6 +569,9 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 
 		rndis_set_param_dev(rndis->config, net,
 				&rndis->port.cdc_filter);
+		rndis_set_param_xfer(rndis->config,
+				rndis->port.ul_max_pkts_per_xfer,
+				&rndis->port.dl_max_xfer_size);
 	} else
 		goto fail;
 
@@ -586,16 +586,20 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = cpu_to_le32(RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32(RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32(RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32(1);
-	resp->MaxTransferSize = cpu_to_le32(
-		  params->dev->mtu
+	resp->MaxPacketsPerTransfer = cpu_to_le32(params->max_pkt_per_xfer);
+	resp->MaxTransferSize = cpu_to_le32(params->max_pkt_per_xfer *
+		(params->dev->mtu
 		+ sizeof(struct ethhdr)
-		+ sizeof(struct rndis_packet_msg_type)
+		+ sizeof(struct rndis_packet_msg_type))
 		+ 22);
 	resp->PacketAlignmentFactor = cpu_to_le32(0);
 	resp->AFListOffset = cpu_to_le32(0);
 	resp->AFListSize = cpu_to_le32(0);
 
+	/* what the host takes in one transfer bounds our tx batches */
+	if (params->host_max_xfer)
+		*params->host_max_xfer = get_unaligned_le32(&buf->MaxTransferSize);
+
 	params->resp_avail(params->v);
 	return 0;
 }
@@ -903,6 +907,8 @@ int rndis_register(void (*resp_avail)(void *v), void *v)
 			rndis_per_dev_params[i].used = 1;
 			rndis_per_dev_params[i].resp_avail = resp_avail;
 			rndis_per_dev_params[i].v = v;
+			rndis_per_dev_params[i].max_pkt_per_xfer = 1;
+			rndis_per_dev_params[i].host_max_xfer = NULL;
 			pr_debug("%s: configNr = %d\n", __func__, i);
 			return i;
 		}
@@ -933,6 +939,19 @@ int rndis_set_param_dev(u8 configNr, struct net_device *dev, u16 *cdc_filter)
 	return 0;
 }
 
+int rndis_set_param_xfer(u8 configNr, u32 max_pkt_per_xfer, u32 *host_max_xfer)
+{
+	pr_debug("%s: %u\n", __func__, max_pkt_per_xfer);
+	if (!max_pkt_per_xfer)
+		return -EINVAL;
+	if (configNr >= RNDIS_MAX_CONFIGS) return -1;
+
+	rndis_per_dev_params[configNr].max_pkt_per_xfer = max_pkt_per_xfer;
+	rndis_per_dev_params[configNr].host_max_xfer = host_max_xfer;
+
+	return 0;
+}
+
 int rndis_set_param_vendor(u8 configNr, u32 vendorID, const char *vendorDescr)
 {
 	pr_debug("%s:\n", __func__);
@@ -1024,30 +1043,61 @@ static rndis_resp_t *rndis_add_response(int configNr, u32 length)
 	return r;
 }
 
+/*
+ * A transfer from the host may hold up to max_pkt_per_xfer messages back
+ * to back.  All but the last are split off as clones sharing its data;
+ * anything after the last that isn't another packet is padding.
+ */
 int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32 *tmp = (void *)skb->data;
+	for (;;) {
+		/* tmp points to a struct rndis_packet_msg_type */
+		__le32		*tmp = (void *)skb->data;
+		struct sk_buff	*skb2 = skb;
+		u32		msg_len, data_offset, data_len;
+
+		/* MessageType, MessageLength */
+		if (skb->len < sizeof(struct rndis_packet_msg_type)
+				|| cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+					!= get_unaligned(tmp++)) {
+			dev_kfree_skb_any(skb);
+			return -EINVAL;
+		}
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+
+		/* another packet follows this one */
+		if (msg_len >= sizeof(struct rndis_packet_msg_type)
+				&& msg_len <= skb->len
+					- sizeof(struct rndis_packet_msg_type)
+				&& cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+					== get_unaligned((__le32 *)
+						(skb->data + msg_len))) {
+			skb2 = skb_clone(skb, GFP_ATOMIC);
+			if (!skb2) {
+				dev_kfree_skb_any(skb);
+				return -ENOMEM;
+			}
+		}
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+		if (!skb_pull(skb2, data_offset)) {
+			dev_kfree_skb_any(skb2);
+			if (skb2 != skb)
+				dev_kfree_skb_any(skb);
+			return -EOVERFLOW;
+		}
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		if (skb2 == skb)
+			return 0;
+		skb_pull(skb, msg_len);
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
-
-	skb_queue_tail(list, skb);
-	return 0;
 }
 
 #ifdef CONFIG_USB_GADGET_DEBUG_FILES
@@ -233,6 +233,8 @@ typedef struct rndis_params
 	const u8		*host_mac;
 	u16			*filter;
 	struct net_device	*dev;
+	u32			max_pkt_per_xfer;
+	u32			*host_max_xfer;
 
 	u32			vendorID;
 	const char		*vendorDescr;
@@ -247,6 +249,8 @@ int  rndis_register(void (*resp_avail)(void *v), void *v);
 void rndis_deregister (int configNr);
 int  rndis_set_param_dev (u8 configNr, struct net_device *dev,
 			 u16 *cdc_filter);
+int  rndis_set_param_xfer (u8 configNr, u32 max_pkt_per_xfer,
+			  u32 *host_max_xfer);
 int  rndis_set_param_vendor (u8 configNr, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium (u8 configNr, u32 medium, u32 speed);
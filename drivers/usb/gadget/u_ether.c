@@ -69,6 +69,14 @@ struct eth_dev {
 	struct list_head	tx_reqs, rx_reqs;
 	atomic_t		tx_qlen;
 
+	/* packets batched into one IN transfer while others are in
+	 * flight, and the buffers of completed batches for reuse;
+	 * both guarded by req_lock
+	 */
+	struct sk_buff		*tx_agg;
+	unsigned		tx_agg_pkts;
+	struct sk_buff_head	tx_agg_pool;
+
 	struct sk_buff_head	rx_frames;
 
 	unsigned		header_len;
@@ -84,6 +92,10 @@ struct eth_dev {
 
 	bool			zlp;
 	u8			host_mac[ETH_ALEN];
+
+	/* transfers, and those carrying more than one packet */
+	unsigned long		tx_xfers, tx_aggr_xfers, tx_aggr_pkts;
+	unsigned long		rx_xfers, rx_aggr_xfers, rx_aggr_pkts;
 };
 
 /*-------------------------------------------------------------------------*/
@@ -92,6 +104,19 @@ struct eth_dev {
 
 #define DEFAULT_QLEN	2	/* double buffering by default */
 
+/* batch tx packets only once this many transfers are in flight, so a
+ * lone packet never waits; and keep batch buffers to order-1 pages
+ */
+#define TX_AGG_MIN_QLEN	2
+#define TX_AGG_MAX_SIZE	(SKB_MAX_ORDER(0, 1) - 1)
+
+/* what a queued tx skb carries */
+struct eth_tx_cb {
+	unsigned	pkts;
+	bool		batch;		/* one of tx_agg_pool's buffers */
+};
+#define TX_CB(skb)	((struct eth_tx_cb *)(skb)->cb)
+
 
 #ifdef CONFIG_USB_GADGET_DUALSPEED
 
@@ -235,8 +260,11 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 * means receivers can't recover lost synch on their own (because
 	 * new packets don't only start after a short RX).
 	 */
-	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
+	size += sizeof(struct ethhdr) + dev->net->mtu;
 	size += dev->port_usb->header_len;
+	if (dev->port_usb->ul_max_pkts_per_xfer > 1)
+		size *= dev->port_usb->ul_max_pkts_per_xfer;
+	size += RX_EXTRA;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -305,6 +333,16 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 		}
 		skb = NULL;
 
+		if (status >= 0) {
+			unsigned	n = skb_queue_len(&dev->rx_frames);
+
+			dev->rx_xfers++;
+			if (n > 1) {
+				dev->rx_aggr_xfers++;
+				dev->rx_aggr_pkts += n;
+			}
+		}
+
 		skb2 = skb_dequeue(&dev->rx_frames);
 		while (skb2) {
 			if (status < 0
@@ -461,10 +499,123 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+static void tx_complete(struct usb_ep *ep, struct usb_request *req);
+
+static int tx_submit(struct eth_dev *dev, struct usb_ep *in,
+		struct usb_request *req, struct sk_buff *skb, bool throttle)
+{
+	int	length = skb->len;
+
+	req->buf = skb->data;
+	req->context = skb;
+	req->complete = tx_complete;
+
+	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
+	if (dev->port_usb && dev->port_usb->is_fixed &&
+	    length == dev->port_usb->fixed_in_len &&
+	    (length % in->maxpacket) == 0)
+		req->zero = 0;
+	else
+		req->zero = 1;
+
+	/* use zlp framing on tx for strict CDC-Ether conformance,
+	 * though any robust network rx path ignores extra padding.
+	 * and some hardware doesn't like to write zlps.
+	 */
+	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
+		length++;
+
+	req->length = length;
+
+	/* throttle highspeed IRQ rate back slightly; not while batching,
+	 * where a held back batch waits for a completion to go out
+	 */
+	if (gadget_is_dualspeed(dev->gadget))
+		req->no_interrupt = (throttle &&
+				dev->gadget->speed == USB_SPEED_HIGH)
+			? ((atomic_read(&dev->tx_qlen) % qmult) != 0)
+			: 0;
+
+	return usb_ep_queue(in, req, GFP_ATOMIC);
+}
+
+/* the helpers below are called with req_lock held */
+
+static void tx_agg_free(struct eth_dev *dev, struct sk_buff *agg)
+{
+	skb_trim(agg, 0);
+	__skb_queue_head(&dev->tx_agg_pool, agg);
+}
+
+static struct sk_buff *tx_agg_close(struct eth_dev *dev)
+{
+	struct sk_buff	*agg = dev->tx_agg;
+
+	TX_CB(agg)->pkts = dev->tx_agg_pkts;
+	TX_CB(agg)->batch = true;
+	dev->tx_agg = NULL;
+	return agg;
+}
+
+/*
+ * Copies the framed @skb into the batch being filled, returning what
+ * is to be queued now: the batch once it is full or nothing else is
+ * in flight, or NULL while it waits for tx_complete() to send it.
+ * The byte after @max_size is kept for zlp padding.
+ */
+static struct sk_buff *tx_aggregate(struct eth_dev *dev, struct sk_buff *skb,
+		unsigned max_pkts, unsigned max_size)
+{
+	struct sk_buff	*agg = dev->tx_agg;
+	struct sk_buff	*out = NULL;
+
+	/* too big to join: send the batch, this packet starts the next */
+	if (agg && agg->len + skb->len > max_size) {
+		out = tx_agg_close(dev);
+		agg = NULL;
+	}
+
+	if (!agg) {
+		while ((agg = __skb_dequeue(&dev->tx_agg_pool)) != NULL) {
+			if (skb_tailroom(agg) > max_size)
+				break;
+			dev_kfree_skb_any(agg);
+		}
+		if (!agg)
+			agg = alloc_skb(max_size + 1, GFP_ATOMIC);
+		if (!agg) {
+			if (!out)
+				return skb;
+			dev->net->stats.tx_dropped++;
+			dev_kfree_skb_any(skb);
+			return out;
+		}
+		dev->tx_agg = agg;
+		dev->tx_agg_pkts = 0;
+	}
+
+	memcpy(skb_put(agg, skb->len), skb->data, skb->len);
+	dev->tx_agg_pkts++;
+	dev_kfree_skb_any(skb);
+
+	/* the request carrying the old batch will send this one */
+	if (out)
+		return out;
+
+	if (dev->tx_agg_pkts >= max_pkts
+			|| agg->len + dev->net->mtu + ETH_HLEN
+				+ dev->header_len > max_size
+			|| !atomic_read(&dev->tx_qlen))
+		return tx_agg_close(dev);
+	return NULL;
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev = ep->driver_data;
+	unsigned	pkts = TX_CB(skb)->pkts;
+	struct sk_buff	*agg = NULL;
 
 	switch (req->status) {
 	default:
@@ -476,15 +627,41 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 		break;
 	case 0:
 		dev->net->stats.tx_bytes += skb->len;
+		dev->tx_xfers++;
+		if (pkts > 1) {
+			dev->tx_aggr_xfers++;
+			dev->tx_aggr_pkts += pkts;
+		}
 	}
-	dev->net->stats.tx_packets++;
+	dev->net->stats.tx_packets += pkts;
 
 	spin_lock(&dev->req_lock);
-	list_add(&req->list, &dev->tx_reqs);
+	if (TX_CB(skb)->batch) {
+		tx_agg_free(dev, skb);
+		skb = NULL;
+	}
+	atomic_dec(&dev->tx_qlen);
+
+	/* a batch held back for this request goes out on it now */
+	if (dev->tx_agg && !req->status) {
+		agg = tx_agg_close(dev);
+		atomic_inc(&dev->tx_qlen);
+	} else {
+		list_add(&req->list, &dev->tx_reqs);
+	}
 	spin_unlock(&dev->req_lock);
-	dev_kfree_skb_any(skb);
+	if (skb)
+		dev_kfree_skb_any(skb);
+
+	if (agg && tx_submit(dev, ep, req, agg, false)) {
+		dev->net->stats.tx_dropped += TX_CB(agg)->pkts;
+		spin_lock(&dev->req_lock);
+		tx_agg_free(dev, agg);
+		atomic_dec(&dev->tx_qlen);
+		list_add(&req->list, &dev->tx_reqs);
+		spin_unlock(&dev->req_lock);
+	}
 
-	atomic_dec(&dev->tx_qlen);
 	if (netif_carrier_ok(dev->net))
 		netif_wake_queue(dev->net);
 }
@@ -498,23 +675,33 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 					struct net_device *net)
 {
 	struct eth_dev		*dev = netdev_priv(net);
-	int			length = skb->len;
 	int			retval;
 	struct usb_request	*req = NULL;
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	unsigned		agg_pkts, agg_size;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
 		cdc_filter = dev->port_usb->cdc_filter;
+		agg_pkts = dev->port_usb->dl_max_pkts_per_xfer;
+		agg_size = min_t(u32, dev->port_usb->dl_max_xfer_size,
+				TX_AGG_MAX_SIZE);
 	} else {
 		in = NULL;
 		cdc_filter = 0;
+		agg_pkts = 0;
+		agg_size = 0;
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
+	/* batching only pays with room for two full size packets */
+	if (agg_pkts < 2 || agg_size < 2 * (net->mtu + ETH_HLEN
+					+ dev->header_len))
+		agg_size = 0;
+
 	if (!in) {
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
@@ -574,48 +761,49 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		spin_unlock_irqrestore(&dev->lock, flags);
 		if (!skb)
 			goto drop;
-
-		length = skb->len;
 	}
-	req->buf = skb->data;
-	req->context = skb;
-	req->complete = tx_complete;
-
-	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
-	if (dev->port_usb->is_fixed &&
-	    length == dev->port_usb->fixed_in_len &&
-	    (length % in->maxpacket) == 0)
-		req->zero = 0;
-	else
-		req->zero = 1;
+	TX_CB(skb)->pkts = 1;
+	TX_CB(skb)->batch = false;
 
-	/* use zlp framing on tx for strict CDC-Ether conformance,
-	 * though any robust network rx path ignores extra padding.
-	 * and some hardware doesn't like to write zlps.
+	/* while the endpoint is busy, packets are copied into a batch
+	 * sent as one transfer, rather than each waiting for a request
 	 */
-	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
-		length++;
-
-	req->length = length;
-
-	/* throttle highspeed IRQ rate back slightly */
-	if (gadget_is_dualspeed(dev->gadget))
-		req->no_interrupt = (dev->gadget->speed == USB_SPEED_HIGH)
-			? ((atomic_read(&dev->tx_qlen) % qmult) != 0)
-			: 0;
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (agg_size && (dev->tx_agg
+			|| atomic_read(&dev->tx_qlen) >= TX_AGG_MIN_QLEN)) {
+		skb = tx_aggregate(dev, skb, agg_pkts, agg_size);
+		if (!skb) {
+			if (list_empty(&dev->tx_reqs))
+				netif_start_queue(net);
+			list_add(&req->list, &dev->tx_reqs);
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			return NETDEV_TX_OK;
+		}
+	}
+	/* counted before queueing, so tx_complete() can't miss a batch */
+	atomic_inc(&dev->tx_qlen);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
 
-	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	retval = tx_submit(dev, in, req, skb, !agg_size);
 	switch (retval) {
 	default:
 		DBG(dev, "tx queue err %d\n", retval);
 		break;
 	case 0:
 		net->trans_start = jiffies;
-		atomic_inc(&dev->tx_qlen);
 	}
 
 	if (retval) {
-		dev_kfree_skb_any(skb);
+		dev->net->stats.tx_dropped += TX_CB(skb)->pkts - 1;
+		spin_lock_irqsave(&dev->req_lock, flags);
+		atomic_dec(&dev->tx_qlen);
+		if (TX_CB(skb)->batch) {
+			tx_agg_free(dev, skb);
+			skb = NULL;
+		}
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		if (skb)
+			dev_kfree_skb_any(skb);
 drop:
 		dev->net->stats.tx_dropped++;
 		spin_lock_irqsave(&dev->req_lock, flags);
@@ -750,6 +938,39 @@ static struct device_type gadget_type = {
 	.name	= "gadget",
 };
 
+/* /sys/class/net/usb0/transfers/: how well packets are being batched */
+#define ETH_XFER_ATTR(name)						\
+static ssize_t show_##name(struct device *d,				\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	struct eth_dev	*dev = netdev_priv(to_net_dev(d));		\
+									\
+	return sprintf(buf, "%lu\n", dev->name);			\
+}									\
+static DEVICE_ATTR(name, S_IRUGO, show_##name, NULL)
+
+ETH_XFER_ATTR(tx_xfers);
+ETH_XFER_ATTR(tx_aggr_xfers);
+ETH_XFER_ATTR(tx_aggr_pkts);
+ETH_XFER_ATTR(rx_xfers);
+ETH_XFER_ATTR(rx_aggr_xfers);
+ETH_XFER_ATTR(rx_aggr_pkts);
+
+static struct attribute *eth_xfer_attrs[] = {
+	&dev_attr_tx_xfers.attr,
+	&dev_attr_tx_aggr_xfers.attr,
+	&dev_attr_tx_aggr_pkts.attr,
+	&dev_attr_rx_xfers.attr,
+	&dev_attr_rx_aggr_xfers.attr,
+	&dev_attr_rx_aggr_pkts.attr,
+	NULL,
+};
+
+static const struct attribute_group eth_xfer_group = {
+	.name	= "transfers",
+	.attrs	= eth_xfer_attrs,
+};
+
 /**
  * gether_setup - initialize one ethernet-over-usb link
  * @g: gadget to associated with these links
@@ -803,6 +1024,7 @@ int gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
+	skb_queue_head_init(&dev->tx_agg_pool);
 	skb_queue_head_init(&dev->rx_frames);
 
 	/* network device setup */
@@ -826,6 +1048,7 @@ int gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 	dev->gadget = g;
 	SET_NETDEV_DEV(net, &g->dev);
 	SET_NETDEV_DEVTYPE(net, &gadget_type);
+	net->sysfs_groups[0] = &eth_xfer_group;
 
 	status = register_netdev(net);
 	if (status < 0) {
@@ -917,6 +1140,9 @@ struct net_device *gether_connect(struct gether *link)
 		dev->unwrap = link->unwrap;
 		dev->wrap = link->wrap;
 
+		/* let locally built packets leave room for the framing */
+		dev->net->needed_headroom = link->header_len;
+
 		spin_lock(&dev->lock);
 		dev->port_usb = link;
 		link->ioport = dev;
@@ -962,6 +1188,7 @@ void gether_disconnect(struct gether *link)
 {
 	struct eth_dev		*dev = link->ioport;
 	struct usb_request	*req;
+	struct sk_buff		*skb;
 
 	if (!dev)
 		return;
@@ -977,6 +1204,13 @@ void gether_disconnect(struct gether *link)
 	 */
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
+	if (dev->tx_agg) {
+		dev->net->stats.tx_dropped += dev->tx_agg_pkts;
+		dev_kfree_skb_any(dev->tx_agg);
+		dev->tx_agg = NULL;
+	}
+	while ((skb = __skb_dequeue(&dev->tx_agg_pool)) != NULL)
+		dev_kfree_skb_any(skb);
 	while (!list_empty(&dev->tx_reqs)) {
 		req = container_of(dev->tx_reqs.next,
 					struct usb_request, list);
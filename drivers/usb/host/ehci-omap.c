@@ -42,6 +42,7 @@
 #include <linux/regulator/consumer.h>
 #include <linux/pm_runtime.h>
 #include <linux/clk.h>
+#include <linux/math64.h>
 
 #include <plat/omap_hwmod.h>
 #include <plat/usb.h>
@@ -70,6 +71,112 @@
 
 static const struct hc_driver ehci_omap_hc_driver;
 
+/*
+ * Interrupt threshold tuning.  The modem moves its data in bulk urbs,
+ * and at the one microframe default every one of them costs an irq.
+ * USBCMD.ITC may only change while the controller is halted, so the
+ * threshold is picked at each bus resume from the bulk throughput of
+ * the period that ended with the last bus suspend: after a busy one
+ * completions are coalesced over itc_bulk_log2 microframes and the
+ * async schedule is parked, if the controller can, so that several
+ * packets go out per qh fetch; after a quiet one the defaults return.
+ */
+static unsigned itc_bulk_kbps = 1024;
+module_param(itc_bulk_kbps, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(itc_bulk_kbps,
+		"omap: bulk kB/s above which irqs are coalesced, 0 never");
+
+static unsigned itc_bulk_log2 = 3;
+module_param(itc_bulk_log2, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(itc_bulk_log2,
+		"omap: log2 IRQ latency under bulk load, 1-64 microframes");
+
+static struct ehci_omap_itc {
+	ktime_t		start;		/* of the current active period */
+	unsigned long	irqs;		/* ehci counts at its start */
+	u64		bytes;
+	unsigned long	kbps;		/* bulk throughput of the last one */
+	unsigned	log2;		/* threshold in use */
+	unsigned long	raised;
+	unsigned long	lowered;
+} omap_itc;
+
+static irqreturn_t ehci_omap_irq(struct usb_hcd *hcd)
+{
+	irqreturn_t ret = ehci_irq(hcd);
+
+	if (ret == IRQ_HANDLED)
+		hcd_to_ehci(hcd)->irqs++;
+	return ret;
+}
+
+/* called with the controller just halted by ehci_bus_suspend() */
+static void ehci_omap_itc_period_end(struct ehci_hcd *ehci)
+{
+	s64 us = ktime_us_delta(ktime_get(), omap_itc.start);
+	u64 bytes = ehci->bulk_bytes - omap_itc.bytes;
+
+	/* bytes per ms, near enough to kB/s */
+	omap_itc.kbps = us > 0 ? div64_u64(bytes * 1000, us) : 0;
+}
+
+/* called before ehci_bus_resume() sets the controller running again */
+static void ehci_omap_itc_period_start(struct ehci_hcd *ehci)
+{
+	unsigned log2 = log2_irq_thresh;
+	bool bulk = itc_bulk_kbps && omap_itc.kbps >= itc_bulk_kbps;
+	u32 hcc_params;
+
+	if (bulk)
+		log2 = min(itc_bulk_log2, 6U);
+	if (log2 > omap_itc.log2)
+		omap_itc.raised++;
+	else if (log2 < omap_itc.log2)
+		omap_itc.lowered++;
+	omap_itc.log2 = log2;
+
+	hcc_params = ehci_readl(ehci, &ehci->caps->hcc_params);
+
+	spin_lock_irq(&ehci->lock);
+	ehci->command &= ~(0xff << 16);
+	ehci->command |= 1 << (16 + log2);
+	if (HCC_CANPARK(hcc_params)) {
+		ehci->command &= ~(CMD_PARK | (3 << 8));
+		if (bulk)
+			ehci->command |= CMD_PARK | (3 << 8);
+		else if (park)
+			ehci->command |= CMD_PARK | (park << 8);
+	}
+	omap_itc.start = ktime_get();
+	omap_itc.irqs = ehci->irqs;
+	omap_itc.bytes = ehci->bulk_bytes;
+	spin_unlock_irq(&ehci->lock);
+}
+
+static ssize_t ehci_omap_itc_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ehci_hcd *ehci = hcd_to_ehci(dev_get_drvdata(dev));
+	unsigned long irqs;
+	u64 bytes;
+
+	spin_lock_irq(&ehci->lock);
+	irqs = ehci->irqs;
+	bytes = ehci->bulk_bytes;
+	spin_unlock_irq(&ehci->lock);
+
+	return sprintf(buf, "irqs: %lu\nbulk bytes: %llu\nirqs per MB: %llu\n"
+			"threshold: %u microframes\nlast period: %lu kB/s\n"
+			"raised: %lu\nlowered: %lu\n",
+			irqs, (unsigned long long)bytes,
+			(unsigned long long)(bytes >> 20 ?
+				div64_u64((u64)irqs << 20, bytes) : 0),
+			1 << omap_itc.log2, omap_itc.kbps,
+			omap_itc.raised, omap_itc.lowered);
+}
+
+static DEVICE_ATTR(itc, S_IRUGO, ehci_omap_itc_show, NULL);
+
 
 static inline void ehci_write(void __iomem *base, u32 reg, u32 val)
 {
@@ -625,6 +732,11 @@ static int ehci_hcd_omap_probe(struct platform_device *pdev)
 			OCP_INITIATOR_AGENT,
 			(200*1000*4));
 
+	omap_itc.start = ktime_get();
+	omap_itc.log2 = log2_irq_thresh;
+	if (device_create_file(dev, &dev_attr_itc))
+		dev_warn(dev, "failed to create itc attribute\n");
+
 	/* root ports should always stay powered */
 	ehci_port_power(omap_ehci, 1);
 
@@ -657,6 +769,7 @@ static int ehci_hcd_omap_remove(struct platform_device *pdev)
 	struct device *dev	= &pdev->dev;
 	struct usb_hcd *hcd	= dev_get_drvdata(dev);
 
+	device_remove_file(dev, &dev_attr_itc);
 	usb_remove_hcd(hcd);
 	pm_runtime_put_sync(dev->parent);
 	usb_put_hcd(hcd);
@@ -693,6 +806,8 @@ static int ehci_omap_bus_suspend(struct usb_hcd *hcd)
 		return ret;
 	}
 
+	ehci_omap_itc_period_end(hcd_to_ehci(hcd));
+
 	oh = omap_hwmod_lookup(USBHS_EHCI_HWMODNAME);
 
 	omap_hwmod_enable_ioring_wakeup(oh);
@@ -748,6 +863,8 @@ static int ehci_omap_bus_resume(struct usb_hcd *hcd)
 
 	*pdata->usbhs_update_sar = 1;
 
+	ehci_omap_itc_period_start(hcd_to_ehci(hcd));
+
 	return ehci_bus_resume(hcd);
 }
 
@@ -770,7 +887,7 @@ static const struct hc_driver ehci_omap_hc_driver = {
 	/*
 	 * generic hardware linkage
 	 */
-	.irq			= ehci_irq,
+	.irq			= ehci_omap_irq,
 	.flags			= HCD_MEMORY | HCD_USB2,
 
 	/*
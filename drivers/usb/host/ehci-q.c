@@ -283,6 +283,8 @@ __acquires(ehci->lock)
 		if (status == -EINPROGRESS || status == -EREMOTEIO)
 			status = 0;
 		COUNT(ehci->stats.complete);
+		if (usb_pipebulk(urb->pipe))
+			ehci->bulk_bytes += urb->actual_length;
 	}
 
 #ifdef EHCI_URB_TRACE
@@ -124,6 +124,10 @@ struct ehci_hcd {			/* one per controller */
 	ktime_t			last_periodic_enable;
 	u32			command;
 
+	/* for glue that tunes the irq threshold to the bulk load */
+	unsigned long		irqs;
+	u64			bulk_bytes;
+
 	/* SILICON QUIRKS */
 	unsigned		no_selective_suspend:1;
 	unsigned		has_fsl_port_bug:1; /* FreeScale */
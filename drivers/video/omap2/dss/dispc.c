@@ -36,6 +36,7 @@
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/ratelimit.h>
+#include <linux/input.h>
 
 #include <plat/sram.h>
 #include <plat/clock.h>
@@ -60,6 +61,19 @@
 					 DISPC_IRQ_SYNC_LOST | \
 					 DISPC_IRQ_SYNC_LOST_DIGIT)
 
+#define DISPC_IRQ_MASK_UDF		(DISPC_IRQ_GFX_FIFO_UNDERFLOW | \
+					 DISPC_IRQ_VID1_FIFO_UNDERFLOW | \
+					 DISPC_IRQ_VID2_FIFO_UNDERFLOW | \
+					 DISPC_IRQ_VID3_FIFO_UNDERFLOW)
+
+/* underflow irq of each overlay, by enum omap_plane */
+static const u32 dispc_udf_irq[MAX_DSS_OVERLAYS] = {
+	DISPC_IRQ_GFX_FIFO_UNDERFLOW,
+	DISPC_IRQ_VID1_FIFO_UNDERFLOW,
+	DISPC_IRQ_VID2_FIFO_UNDERFLOW,
+	DISPC_IRQ_VID3_FIFO_UNDERFLOW,
+};
+
 #define DISPC_MAX_NR_ISRS		8
 
 static struct clockdomain *l3_1_clkdm, *l3_2_clkdm;
@@ -111,9 +125,21 @@ static struct {
 	u32 error_irqs;
 	struct work_struct error_work;
 
+	/* FIFO underflows seen on each overlay */
+	u32 underflows[MAX_DSS_OVERLAYS];
+
 	bool		ctx_valid;
 	u32		ctx[DISPC_SZ_REGS / sizeof(u32)];
 
+	/*
+	 * FIR coefficient tables last written to each plane (including WB),
+	 * for the RGB/Y and the UV banks; NULL when the bank is unknown
+	 */
+	struct {
+		const struct dispc_hv_coef *h, *v;
+		bool five_taps;
+	} fir_coef[MAX_DSS_OVERLAYS + 1][2];
+
 #ifdef CONFIG_OMAP2_DSS_COLLECT_IRQ_STATS
 	spinlock_t irq_stats_lock;
 	struct dispc_irq_stats irq_stats;
@@ -588,6 +614,9 @@ int dispc_runtime_get(void)
 		if (r < 0)
 			goto err_runtime_get;
 
+		/* the coefficient banks may not have survived */
+		memset(dispc.fir_coef, 0, sizeof(dispc.fir_coef));
+
 		dispc_restore_context();
 	}
 
@@ -949,11 +978,24 @@ static void _dispc_set_scale_coef(enum omap_plane plane, int hinc,
 {
 	const struct dispc_hv_coef *h_coef;
 	const struct dispc_hv_coef *v_coef;
-	int i;
+	int i, bank = color_comp == DISPC_COLOR_COMPONENT_RGB_Y ? 0 : 1;
 
 	h_coef = dispc_get_scaling_coef(hinc, true);
 	v_coef = dispc_get_scaling_coef(vinc, five_taps);
 
+	/*
+	 * The tables are picked by scaling ratio only, so an overlay whose
+	 * geometry did not change between frames keeps its coefficients;
+	 * skip rewriting up to 24 registers per bank in that case.
+	 */
+	if (dispc.fir_coef[plane][bank].h == h_coef &&
+	    dispc.fir_coef[plane][bank].v == v_coef &&
+	    dispc.fir_coef[plane][bank].five_taps == five_taps)
+		return;
+	dispc.fir_coef[plane][bank].h = h_coef;
+	dispc.fir_coef[plane][bank].v = v_coef;
+	dispc.fir_coef[plane][bank].five_taps = five_taps;
+
 	for (i = 0; i < 8; i++) {
 		u32 h, hv;
 
@@ -3544,6 +3586,13 @@ void dispc_dump_clocks(struct seq_file *s)
 	dispc_runtime_put();
 }
 
+u32 dispc_get_underflow_count(enum omap_plane plane)
+{
+	if (plane >= ARRAY_SIZE(dispc.underflows))
+		return 0;
+	return dispc.underflows[plane];
+}
+
 #ifdef CONFIG_OMAP2_DSS_COLLECT_IRQ_STATS
 void dispc_dump_irqs(struct seq_file *s)
 {
@@ -4067,6 +4116,25 @@ static irqreturn_t omap_dispc_irq_handler(int irq, void *arg)
 	/* flush posted write */
 	dispc_read_reg(DISPC_IRQSTATUS);
 
+	/*
+	 * Count the underflows reported as errors, even while the error
+	 * worker is handling earlier ones; the WB source planes have theirs
+	 * masked because of an erratum.
+	 */
+	if (irqstatus & DISPC_IRQ_MASK_UDF) {
+		u32 udf = irqstatus & (dispc.irq_error_mask | dispc.error_irqs);
+
+		for (i = 0; i < ARRAY_SIZE(dispc_udf_irq); i++)
+			if (udf & dispc_udf_irq[i])
+				dispc.underflows[i]++;
+	}
+
+#ifdef CONFIG_INPUT
+	/* let input handlers batching events per frame hand them over */
+	if (irqstatus & irqenable & DISPC_IRQ_VSYNC)
+		input_vsync(ktime_get());
+#endif
+
 	/* make a copy and unlock, so that isrs can unregister
 	 * themselves */
 	memcpy(registered_isr, dispc.registered_isr,
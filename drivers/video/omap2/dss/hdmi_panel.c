@@ -34,6 +34,8 @@
 static struct {
 	struct mutex hdmi_lock;
 	struct switch_dev hpd_switch;
+	/* size of the picture sent to HDMI, 0 if unknown */
+	u32 src_x, src_y;
 } hdmi;
 
 static ssize_t hdmi_deepcolor_show(struct device *dev,
@@ -152,7 +154,36 @@ static DEVICE_ATTR(s3d_enable, S_IRUGO | S_IWUSR, hdmi_s3d_enable_show,
 							hdmi_s3d_enable_store);
 static DEVICE_ATTR(s3d_type, S_IRUGO | S_IWUSR, hdmi_s3d_mode_show,
 							hdmi_s3d_mode_store);
+/*
+ * The size of what will be shown on HDMI, e.g. the primary display when
+ * mirroring it, as "<width>x<height>".  The modes offered then start with
+ * the ones DISPC has the least scaling to do for, see hdmi_get_modedb().
+ */
+static ssize_t hdmi_source_size_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%ux%u\n", hdmi.src_x, hdmi.src_y);
+}
+
+static ssize_t hdmi_source_size_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buf, size_t size)
+{
+	u32 x, y;
+
+	if (sscanf(buf, "%ux%u", &x, &y) != 2 || x > 4096 || y > 4096)
+		return -EINVAL;
+
+	mutex_lock(&hdmi.hdmi_lock);
+	hdmi.src_x = x;
+	hdmi.src_y = y;
+	mutex_unlock(&hdmi.hdmi_lock);
+	return size;
+}
+
 static DEVICE_ATTR(edid, S_IRUGO, hdmi_edid_show, NULL);
+static DEVICE_ATTR(source_size, S_IRUGO | S_IWUSR, hdmi_source_size_show,
+							hdmi_source_size_store);
 static DEVICE_ATTR(deepcolor, S_IRUGO | S_IWUSR, hdmi_deepcolor_show,
 							hdmi_deepcolor_store);
 
@@ -161,6 +192,7 @@ static struct attribute *hdmi_panel_attrs[] = {
 	&dev_attr_s3d_type.attr,
 	&dev_attr_edid.attr,
 	&dev_attr_deepcolor.attr,
+	&dev_attr_source_size.attr,
 	NULL,
 };
 
@@ -399,14 +431,52 @@ err:
 	return r;
 }
 
+enum hdmi_mode_fit {
+	HDMI_FIT_EXACT,		/* no scaling */
+	HDMI_FIT_MULTIPLE,	/* same integer factor both ways */
+	HDMI_FIT_UPSCALE,
+	HDMI_FIT_DOWNSCALE,	/* fetches more than it shows, may underflow */
+};
+
+static enum hdmi_mode_fit hdmi_mode_fit(const struct fb_videomode *m,
+					u32 src_x, u32 src_y)
+{
+	if (m->xres == src_x && m->yres == src_y)
+		return HDMI_FIT_EXACT;
+	if (m->xres % src_x == 0 && m->yres % src_y == 0 &&
+	    m->xres / src_x == m->yres / src_y)
+		return HDMI_FIT_MULTIPLE;
+	if (m->xres >= src_x && m->yres >= src_y)
+		return HDMI_FIT_UPSCALE;
+	return HDMI_FIT_DOWNSCALE;
+}
+
+/*
+ * The modes come in the order of the EDID, unless the source size is
+ * known: then by how well they fit it, and in the EDID order for the same
+ * fit, so that picking the first one saves DISPC a scaling pass where it
+ * can.
+ */
 static int hdmi_get_modedb(struct omap_dss_device *dssdev,
 			   struct fb_videomode *modedb, int modedb_len)
 {
 	struct fb_monspecs *specs = &dssdev->panel.monspecs;
+	u32 src_x = hdmi.src_x, src_y = hdmi.src_y;
+	int fit, i, n = 0;
+
 	if (specs->modedb_len < modedb_len)
 		modedb_len = specs->modedb_len;
-	memcpy(modedb, specs->modedb, sizeof(*modedb) * modedb_len);
-	return modedb_len;
+
+	if (!src_x || !src_y) {
+		memcpy(modedb, specs->modedb, sizeof(*modedb) * modedb_len);
+		return modedb_len;
+	}
+
+	for (fit = HDMI_FIT_EXACT; fit <= HDMI_FIT_DOWNSCALE; fit++)
+		for (i = 0; i < specs->modedb_len && n < modedb_len; i++)
+			if (hdmi_mode_fit(&specs->modedb[i], src_x, src_y) == fit)
+				modedb[n++] = specs->modedb[i];
+	return n;
 }
 static void hdmi_get_resolution(struct omap_dss_device *dssdev,
 			       u16 *xres, u16 *yres)
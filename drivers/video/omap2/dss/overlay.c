@@ -381,6 +381,12 @@ static ssize_t overlay_y_decim_show(struct omap_overlay *ovl, char *buf)
 									buf);
 }
 
+static ssize_t overlay_underflows_show(struct omap_overlay *ovl, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			dispc_get_underflow_count(ovl->id));
+}
+
 static ssize_t overlay_decim_store(u16 *min, u16 *max,
 						const char *buf, size_t size)
 {
@@ -476,6 +482,7 @@ static OVERLAY_ATTR(y_decim, S_IRUGO|S_IWUSR,
 		overlay_y_decim_show, overlay_y_decim_store);
 static OVERLAY_ATTR(zorder, S_IRUGO|S_IWUSR,
 		overlay_zorder_show, overlay_zorder_store);
+static OVERLAY_ATTR(underflows, S_IRUGO, overlay_underflows_show, NULL);
 
 static struct attribute *overlay_sysfs_attrs[] = {
 	&overlay_attr_name.attr,
@@ -490,6 +497,7 @@ static struct attribute *overlay_sysfs_attrs[] = {
 	&overlay_attr_zorder.attr,
 	&overlay_attr_x_decim.attr,
 	&overlay_attr_y_decim.attr,
+	&overlay_attr_underflows.attr,
 	NULL
 };
 
@@ -114,6 +114,8 @@ struct dsscomp_data {
 	void *extra_cb_data;
 	bool must_apply;	/* whether composition must be applied */
 	bool m2m_only;
+	struct list_head apply_q;	/* on the manager's pending queue */
+	ktime_t apply_time;	/* when programming of this frame started */
 #ifdef CONFIG_DEBUG_FS
 	struct list_head dbg_q;
 	u32 dbg_used;
@@ -35,6 +35,7 @@ static bool blanked;
 static u32 dev_display_mask;
 
 #include <linux/ion.h>
+#include <linux/dma-buf.h>
 #include <plat/dma.h>
 
 extern struct ion_device *omap_ion_device;
@@ -80,8 +81,17 @@ struct dsscomp_gralloc_t {
 	atomic_t refs;
 	bool early_callback;
 	bool programmed;
+	struct dma_buf_map *maps[MAX_OVERLAYS * 2];	/* Y and UV planes */
+	int num_maps;
 };
 
+/*
+ * dma-bufs being scanned out stay attached and mapped in between frames;
+ * the buffers of a swap chain come back every frame.
+ */
+#define DMA_BUF_MAP_CACHE_SIZE	16
+static struct dma_buf_map_cache dma_buf_maps;
+
 /* local cache */
 static struct kmem_cache *gsync_cachep;
 
@@ -104,6 +114,43 @@ static void unpin_tiler_blocks(struct list_head *slots)
 	list_splice_init(slots, &free_slots);
 }
 
+/* the buffers of a composition are held until it is released */
+static void put_dma_buf_maps(struct dsscomp_gralloc_t *gsync)
+{
+	while (gsync->num_maps)
+		dma_buf_map_cache_put(&dma_buf_maps,
+				      gsync->maps[--gsync->num_maps]);
+}
+
+/* returns the bus address of a dma-buf fd, or 0 */
+static u32 get_dma_buf_addr(struct dsscomp_gralloc_t *gsync, int fd)
+{
+	struct dma_buf *dmabuf;
+	struct dma_buf_map *map;
+	struct sg_table *sgt;
+
+	if (gsync->num_maps >= ARRAY_SIZE(gsync->maps))
+		return 0;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return 0;
+	/* the cache holds its own reference while the buffer is mapped */
+	map = dma_buf_map_cache_get(&dma_buf_maps, dmabuf);
+	dma_buf_put(dmabuf);
+	if (IS_ERR(map))
+		return 0;
+
+	/* DISPC reads a contiguous or TILER range, not a page list */
+	sgt = dma_buf_map_sg_table(map);
+	if (sgt->nents != 1) {
+		dma_buf_map_cache_put(&dma_buf_maps, map);
+		return 0;
+	}
+	gsync->maps[gsync->num_maps++] = map;
+	return sg_dma_address(sgt->sgl);
+}
+
 static void dsscomp_gralloc_cb(void *data, int status)
 {
 	struct dsscomp_gralloc_t *gsync = data, *gsync_;
@@ -115,8 +162,10 @@ static void dsscomp_gralloc_cb(void *data, int status)
 		gsync->programmed = true;
 
 	if (status & DSS_COMPLETION_RELEASED) {
-		if (atomic_dec_and_test(&gsync->refs))
+		if (atomic_dec_and_test(&gsync->refs)) {
 			unpin_tiler_blocks(&gsync->slots);
+			put_dma_buf_maps(gsync);
+		}
 
 		log_event(0, 0, gsync, "--refs=%d on %s",
 				atomic_read(&gsync->refs),
@@ -582,6 +631,21 @@ int dsscomp_gralloc_queue(struct dsscomp_setup_dispc_data *d,
 			oi->ba = phys;
 			oi->uv = oi->ba;
 			goto skip_map1d;
+		} else if (oi->addressing == OMAP_DSS_BUFADDR_DMA_BUF) {
+			u32 ba = get_dma_buf_addr(gsync, oi->ba);
+			u32 uv = ba;
+
+			if (ba && oi->cfg.color_mode == OMAP_DSS_COLOR_NV12)
+				uv = get_dma_buf_addr(gsync, oi->uv);
+			if (!ba || !uv) {
+				dev_err(DEV(cdev), "could not map dma-buf for "
+					"ovl%d\n", oi->cfg.ix);
+				goto skip_buffer;
+			}
+
+			oi->ba = ba;
+			oi->uv = uv;
+			goto skip_map1d;
 		}
 
 		/* map non-TILER buffers to 1D */
@@ -759,6 +823,7 @@ static struct early_suspend early_suspend_info = {
 	.suspend = dsscomp_early_suspend,
 	.resume = dsscomp_late_resume,
 	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.flags = EARLY_SUSPEND_RESUME_FIRST,
 };
 #endif
 
@@ -823,6 +888,13 @@ void dsscomp_dbg_gralloc(struct seq_file *s)
 	}
 	seq_printf(s, "\n");
 	mutex_unlock(&dbg_mtx);
+
+	mutex_lock(&dma_buf_maps.lock);
+	seq_printf(s, "DMA-BUF MAPPINGS\n\n"
+		   "  cached=%u hits=%lu misses=%lu evictions=%lu\n\n",
+		   dma_buf_maps.count, dma_buf_maps.hits,
+		   dma_buf_maps.misses, dma_buf_maps.evictions);
+	mutex_unlock(&dma_buf_maps.lock);
 #endif
 }
 
@@ -836,6 +908,8 @@ void dsscomp_gralloc_init(struct dsscomp_dev *cdev_)
 	/* save at least cdev pointer */
 	if (!cdev && cdev_) {
 		cdev = cdev_;
+		dma_buf_map_cache_init(&dma_buf_maps, cdev->pdev,
+				       DMA_TO_DEVICE, DMA_BUF_MAP_CACHE_SIZE);
 #ifdef CONFIG_HAS_EARLYSUSPEND
 		register_early_suspend(&early_suspend_info);
 #endif
@@ -894,4 +968,6 @@ void dsscomp_gralloc_exit(void)
 		tiler_free_block_area(slot->slot);
 	}
 	INIT_LIST_HEAD(&free_slots);
+
+	dma_buf_map_cache_flush(&dma_buf_maps);
 }
@@ -24,6 +24,9 @@
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/ratelimit.h>
+#include <linux/hrtimer.h>
+#include <linux/notifier.h>
+#include <linux/math64.h>
 
 #include <video/omapdss.h>
 #include <video/dsscomp.h>
@@ -32,6 +35,10 @@
 #include <linux/debugfs.h>
 
 #include "dsscomp.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/dsscomp.h>
+
 /* queue state */
 
 static DEFINE_MUTEX(mtx);
@@ -48,11 +55,32 @@ static struct {
 	u32 ovl_mask;		/* overlays used on this display */
 	struct maskref ovl_qmask;		/* overlays queued to this display */
 	bool blanking;
+
+	struct list_head pending;	/* compositions waiting to be applied */
+	u32 num_pending;
+
+	struct {
+		u32 applied;		/* compositions programmed */
+		u32 latched_out;	/* superseded while still pending */
+		u32 displayed;		/* apply-to-display samples below */
+		u32 lat_last_us;
+		u32 lat_max_us;
+		u64 lat_total_us;
+	} stats;
 } mgrq[MAX_MANAGERS];
 
+/*
+ * Pending compositions a manager holds before a new one starts to push out
+ * the ones it supersedes right away, rather than when the apply worker
+ * gets to them.
+ */
+#define DSSCOMP_MAX_PENDING	3
+
 static struct workqueue_struct *cb_wkq;		/* callback work queue */
 static struct dsscomp_dev *cdev;
 
+static ATOMIC_NOTIFIER_HEAD(display_notifier);
+
 #ifdef CONFIG_DEBUG_FS
 LIST_HEAD(dbg_comps);
 DEFINE_MUTEX(dbg_mtx);
@@ -107,7 +135,7 @@ struct dsscomp_cb_work {
 
 struct dsscomp_apply_work {
 	struct work_struct work;
-	dsscomp_t comp;
+	u32 ix;			/* manager whose pending queue to service */
 };
 
 /* Local caches */
@@ -129,6 +157,7 @@ int dsscomp_queue_init(struct dsscomp_dev *cdev_)
 		mgrq[i].apply_workq = create_singlethread_workqueue("dsscomp_apply");
 		if (!mgrq[i].apply_workq)
 			goto error;
+		INIT_LIST_HEAD(&mgrq[i].pending);
 
 		/* record overlays on this display */
 		mgr = cdev->mgrs[i];
@@ -143,7 +172,8 @@ int dsscomp_queue_init(struct dsscomp_dev *cdev_)
 				mgrq[i].ovl_mask |= 1 << OMAP_DSS_WB;
 	}
 
-	cb_wkq = create_singlethread_workqueue("dsscomp_cb");
+	/* callbacks release buffers back to the GPU, keep them off writeback */
+	cb_wkq = alloc_ordered_workqueue("dsscomp_cb", WQ_MEM_RECLAIM | WQ_RT);
 	if (!cb_wkq)
 		goto error;
 
@@ -224,6 +254,7 @@ dsscomp_t dsscomp_new(struct omap_overlay_manager *mgr)
 	comp->frm.sync_id = 0;
 	comp->frm.mgr.ix = display_ix;
 	comp->state = DSSCOMP_STATE_ACTIVE;
+	INIT_LIST_HEAD(&comp->apply_q);
 
 	DO_IF_DEBUG_FS({
 		__log_state(comp, dsscomp_new, 0);
@@ -456,15 +487,50 @@ static void dsscomp_mgr_delayed_cb(struct work_struct *work)
 		log_event(20 * comp->ix + 20, 0, comp, "%pf on %s",
 				(u32) dsscomp_mgr_delayed_cb,
 				(u32) log_status_str(status));
+		/* programmed, but replaced before it made it to the screen */
+		if (comp->state == DSSCOMP_STATE_PROGRAMMED)
+			tracing_snapshot_trigger("dsscomp: frame missed");
 		dsscomp_drop(comp);
 	}
 	mutex_unlock(&mtx);
 }
 
+int dsscomp_register_display_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&display_notifier, nb);
+}
+EXPORT_SYMBOL(dsscomp_register_display_notifier);
+
+int dsscomp_unregister_display_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&display_notifier, nb);
+}
+EXPORT_SYMBOL(dsscomp_unregister_display_notifier);
+
 u32 dsscomp_mgr_callback(void *data, int id, int status)
 {
 	struct dsscomp_data *comp = data;
 
+	trace_dsscomp_callback(comp, comp->ix, comp->frm.sync_id, status);
+
+	/* this is as close to the vsync the frame went out on as we get */
+	if (status == DSS_COMPLETION_DISPLAYED &&
+	    comp->state != DSSCOMP_STATE_DISPLAYED) {
+		ktime_t now = ktime_get();
+
+		if (comp->apply_time.tv64) {
+			u32 us = ktime_to_us(ktime_sub(now, comp->apply_time));
+
+			mgrq[comp->ix].stats.displayed++;
+			mgrq[comp->ix].stats.lat_last_us = us;
+			mgrq[comp->ix].stats.lat_total_us += us;
+			if (us > mgrq[comp->ix].stats.lat_max_us)
+				mgrq[comp->ix].stats.lat_max_us = us;
+		}
+
+		atomic_notifier_call_chain(&display_notifier, comp->ix, &now);
+	}
+
 	if (status == DSS_COMPLETION_PROGRAMMED ||
 	    (status == DSS_COMPLETION_DISPLAYED &&
 	     comp->state != DSSCOMP_STATE_DISPLAYED) ||
@@ -523,6 +589,8 @@ int dsscomp_apply(dsscomp_t comp)
 
 	BUG_ON(comp->state != DSSCOMP_STATE_APPLYING);
 
+	comp->apply_time = ktime_get();
+
 	/* check if the display is valid and used */
 	r = -ENODEV;
 	d = &comp->frm;
@@ -764,6 +832,8 @@ skip_ovl_set:
 		if (!r && !cb_programmed)
 			r = -EINVAL;
 	}
+	if (!r)
+		mgrq[comp->ix].stats.applied++;
 	mutex_unlock(&mtx);
 
 	/*
@@ -817,6 +887,7 @@ skip_ovl_set:
 	}
 
 done:
+	trace_dsscomp_apply(comp, display_ix, d->sync_id, comp->ovl_mask, r);
 	return r;
 }
 EXPORT_SYMBOL(dsscomp_apply);
@@ -840,19 +911,92 @@ int dsscomp_state_notifier(struct notifier_block *nb,
 	return 0;
 }
 
+/*
+ * A pending composition may be dropped in favour of a newer one only if the
+ * newer one sets up every overlay the older one touches; otherwise changes
+ * such as an overlay being disabled would be lost.  Writeback frames have
+ * side effects beyond the display and are always applied.
+ */
+static bool dsscomp_supersedes(dsscomp_t newer, dsscomp_t older)
+{
+	const u32 wb_mask = 1 << OMAP_DSS_WB;
+
+	if (older->ovl_mask & ~newer->ovl_mask)
+		return false;
+	if ((older->ovl_mask | newer->ovl_mask) & wb_mask ||
+	    older->m2m_only || newer->m2m_only)
+		return false;
+	return older->frm.mode == newer->frm.mode &&
+	       older->frm.mgr.ix == newer->frm.mgr.ix;
+}
+
+/* must be called with mtx held */
+static void dsscomp_eclipse(dsscomp_t comp)
+{
+	list_del_init(&comp->apply_q);
+	mgrq[comp->ix].num_pending--;
+	mgrq[comp->ix].stats.latched_out++;
+
+	if (debug & DEBUG_PHASES)
+		dev_info(DEV(cdev), "[%p] superseded\n", comp);
+
+	/* this releases the buffers and drops the composition */
+	dsscomp_mgr_callback(comp, -1, DSS_COMPLETION_ECLIPSED_SET);
+}
+
+/*
+ * Take the composition to program next off a manager's queue.  Anything
+ * queued behind it that supersedes it is taken instead, so that a display
+ * that fell behind catches up on the newest frame rather than showing the
+ * stale ones one vsync at a time.
+ */
+static dsscomp_t dsscomp_latch(u32 ix)
+{
+	dsscomp_t comp, next;
+
+	mutex_lock(&mtx);
+	if (list_empty(&mgrq[ix].pending)) {
+		mutex_unlock(&mtx);
+		return NULL;
+	}
+
+	comp = list_first_entry(&mgrq[ix].pending, typeof(*comp), apply_q);
+	while (!list_is_last(&comp->apply_q, &mgrq[ix].pending)) {
+		next = list_entry(comp->apply_q.next, typeof(*comp), apply_q);
+		if (!dsscomp_supersedes(next, comp))
+			break;
+		dsscomp_eclipse(comp);
+		comp = next;
+	}
+	list_del_init(&comp->apply_q);
+	mgrq[ix].num_pending--;
+	mutex_unlock(&mtx);
+
+	return comp;
+}
+
 static void dsscomp_do_apply(struct work_struct *work)
 {
 	struct dsscomp_apply_work *wk = container_of(work, typeof(*wk), work);
-	/* complete compositions that failed to apply */
-	if (dsscomp_apply(wk->comp))
-		dsscomp_mgr_callback(wk->comp, -1, DSS_COMPLETION_ECLIPSED_SET);
+	dsscomp_t comp = dsscomp_latch(wk->ix);
+
 	kmem_cache_free(dsscomp_app_wk_cachep, wk);
+
+	/* an earlier work item already latched past our composition */
+	if (!comp)
+		return;
+
+	/* complete compositions that failed to apply */
+	if (dsscomp_apply(comp))
+		dsscomp_mgr_callback(comp, -1, DSS_COMPLETION_ECLIPSED_SET);
 }
 
 int dsscomp_delayed_apply(dsscomp_t comp)
 {
 	/* don't block in case we are called from interrupt context */
 	struct dsscomp_apply_work *wk;
+	dsscomp_t c, n;
+	u32 ix = comp->ix;
 
 	/* allocate work object from cache */
 	wk = kmem_cache_zalloc(dsscomp_app_wk_cachep, GFP_NOWAIT);
@@ -870,11 +1014,24 @@ int dsscomp_delayed_apply(dsscomp_t comp)
 
 	if (debug & DEBUG_PHASES)
 		dev_info(DEV(cdev), "[%p] applying\n", comp);
+
+	/* keep the queue bounded if the display has fallen behind */
+	if (mgrq[ix].num_pending >= DSSCOMP_MAX_PENDING)
+		list_for_each_entry_safe(c, n, &mgrq[ix].pending, apply_q)
+			if (dsscomp_supersedes(comp, c))
+				dsscomp_eclipse(c);
+
+	list_add_tail(&comp->apply_q, &mgrq[ix].pending);
+	mgrq[ix].num_pending++;
 	mutex_unlock(&mtx);
 
-	wk->comp = comp;
+	/*
+	 * one work item per composition; items that find the queue already
+	 * drained by latching simply return
+	 */
+	wk->ix = ix;
 	INIT_WORK(&wk->work, dsscomp_do_apply);
-	return queue_work(mgrq[comp->ix].apply_workq, &wk->work) ? 0 : -EBUSY;
+	return queue_work(mgrq[ix].apply_workq, &wk->work) ? 0 : -EBUSY;
 }
 EXPORT_SYMBOL(dsscomp_delayed_apply);
 
@@ -942,7 +1099,17 @@ void dsscomp_dbg_comps(struct seq_file *s)
 	mutex_lock(&dbg_mtx);
 	for (i = 0; i < cdev->num_mgrs; i++) {
 		struct omap_overlay_manager *mgr = cdev->mgrs[i];
-		seq_printf(s, "ACTIVE COMPOSITIONS on %s\n\n", mgr->name);
+		u32 n = mgrq[i].stats.displayed;
+
+		seq_printf(s, "ACTIVE COMPOSITIONS on %s\n", mgr->name);
+		seq_printf(s, "  pending=%u applied=%u superseded=%u\n",
+			   mgrq[i].num_pending, mgrq[i].stats.applied,
+			   mgrq[i].stats.latched_out);
+		seq_printf(s, "  apply-to-display: frames=%u last=%uus "
+			   "avg=%uus max=%uus\n\n", n,
+			   mgrq[i].stats.lat_last_us,
+			   n ? (u32) div_u64(mgrq[i].stats.lat_total_us, n) : 0,
+			   mgrq[i].stats.lat_max_us);
 		list_for_each_entry(c, &dbg_comps, dbg_q) {
 			struct dss2_mgr_info *mi = &c->frm.mgr;
 			if (mi->ix < cdev->num_displays &&
@@ -904,6 +904,7 @@ OMAPLFB_ERROR OMAPLFBEnableLFBEventNotification(OMAPLFB_DEVINFO *psDevInfo)
 	psDevInfo->sEarlySuspend.suspend = OMAPLFBEarlySuspendHandler;
 	psDevInfo->sEarlySuspend.resume = OMAPLFBEarlyResumeHandler;
 	psDevInfo->sEarlySuspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1;
+	psDevInfo->sEarlySuspend.flags = EARLY_SUSPEND_RESUME_FIRST;
 	register_early_suspend(&psDevInfo->sEarlySuspend);
 #endif
 
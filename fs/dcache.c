@@ -37,6 +37,10 @@
 #include <linux/rculist_bl.h>
 #include <linux/prefetch.h>
 #include <linux/earlysuspend.h>
+#include <linux/ktime.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/log2_hist.h>
 #include "internal.h"
 
 /*
@@ -80,6 +84,9 @@
 int sysctl_vfs_cache_pressure __read_mostly = 46;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
+/* max unused negative dentries per superblock, 0 for no limit */
+int sysctl_negative_dentry_limit __read_mostly;
+
 static __cacheline_aligned_in_smp DEFINE_SPINLOCK(dcache_lru_lock);
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
@@ -118,6 +125,38 @@ struct dentry_stat_t dentry_stat = {
 
 static DEFINE_PER_CPU(unsigned int, nr_dentry);
 
+/* log2 histogram of 1us buckets, see <linux/log2_hist.h> */
+#define D_LOOKUP_HIST_BUCKETS	16
+
+struct d_lookup_stat {
+	unsigned long hits;
+	unsigned long negative_hits;
+	unsigned long misses;
+	unsigned long miss_hist[D_LOOKUP_HIST_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct d_lookup_stat, d_lookup_stat);
+
+/* a component was found in the dcache by the path walk */
+void d_lookup_hit(int negative)
+{
+	if (negative)
+		this_cpu_inc(d_lookup_stat.negative_hits);
+	else
+		this_cpu_inc(d_lookup_stat.hits);
+}
+
+/* a component had to be looked up by the filesystem, taking @ns */
+void d_lookup_miss(s64 ns)
+{
+	unsigned int i;
+
+	i = log2_hist_bucket(ns > 0 ? div_u64(ns, NSEC_PER_USEC) : 0,
+			     D_LOOKUP_HIST_BUCKETS);
+	this_cpu_inc(d_lookup_stat.misses);
+	this_cpu_inc(d_lookup_stat.miss_hist[i]);
+}
+
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 static int get_nr_dentry(void)
 {
@@ -225,6 +264,35 @@ static void dentry_unlink_inode(struct dentry * dentry)
 		iput(inode);
 }
 
+/*
+ * Negative dentries on the LRU are counted per superblock, so that a
+ * lookup storm for names that do not exist cannot push everything else
+ * out of the dcache.  Past sysctl_negative_dentry_limit, with some slack
+ * to avoid kicking the pruning for every dentry, the oldest of them are
+ * pruned from a work item.  Called with d_lock and dcache_lru_lock held.
+ */
+static void dentry_lru_count_negative(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+	int limit = sysctl_negative_dentry_limit;
+
+	if (dentry->d_inode || (dentry->d_flags & DCACHE_NEGATIVE_LRU))
+		return;
+
+	dentry->d_flags |= DCACHE_NEGATIVE_LRU;
+	sb->s_nr_negative_dentry++;
+	if (limit && sb->s_nr_negative_dentry > limit + limit / 8)
+		schedule_work(&sb->s_negative_prune_work);
+}
+
+static void dentry_lru_uncount_negative(struct dentry *dentry)
+{
+	if (dentry->d_flags & DCACHE_NEGATIVE_LRU) {
+		dentry->d_flags &= ~DCACHE_NEGATIVE_LRU;
+		dentry->d_sb->s_nr_negative_dentry--;
+	}
+}
+
 /*
  * dentry_lru_(add|del|move_tail) must be called with d_lock held.
  */
@@ -235,6 +303,13 @@ static void dentry_lru_add(struct dentry *dentry)
 		list_add(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 		dentry->d_sb->s_nr_dentry_unused++;
 		dentry_stat.nr_unused++;
+		dentry_lru_count_negative(dentry);
+		spin_unlock(&dcache_lru_lock);
+	} else if (!dentry->d_inode &&
+		   !(dentry->d_flags & DCACHE_NEGATIVE_LRU)) {
+		/* went negative, by d_delete(), while on the LRU */
+		spin_lock(&dcache_lru_lock);
+		dentry_lru_count_negative(dentry);
 		spin_unlock(&dcache_lru_lock);
 	}
 }
@@ -245,6 +320,7 @@ static void __dentry_lru_del(struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_SHRINK_LIST;
 	dentry->d_sb->s_nr_dentry_unused--;
 	dentry_stat.nr_unused--;
+	dentry_lru_uncount_negative(dentry);
 }
 
 static void dentry_lru_del(struct dentry *dentry)
@@ -263,6 +339,7 @@ static void dentry_lru_move_tail(struct dentry *dentry)
 		list_add_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 		dentry->d_sb->s_nr_dentry_unused++;
 		dentry_stat.nr_unused++;
+		dentry_lru_count_negative(dentry);
 	} else {
 		list_move_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 	}
@@ -771,6 +848,70 @@ relock:
 	*count = cnt;
 }
 
+/*
+ * Prune the oldest unused negative dentries of @sb until no more than
+ * sysctl_negative_dentry_limit are left.  Like __shrink_dcache_sb() it
+ * gives referenced ones a second chance, and anything it skips keeps its
+ * place at the cold end of the LRU.
+ */
+static void prune_negative_dentries(struct super_block *sb)
+{
+	struct dentry *dentry;
+	LIST_HEAD(skipped);
+	LIST_HEAD(tmp);
+	int limit = sysctl_negative_dentry_limit;
+	int scan;
+
+	if (!limit)
+		return;
+
+relock:
+	spin_lock(&dcache_lru_lock);
+	scan = sb->s_nr_dentry_unused;
+	while (!list_empty(&sb->s_dentry_lru) && scan-- > 0 &&
+	       sb->s_nr_negative_dentry > limit) {
+		dentry = list_entry(sb->s_dentry_lru.prev,
+				struct dentry, d_lru);
+
+		if (!spin_trylock(&dentry->d_lock)) {
+			spin_unlock(&dcache_lru_lock);
+			cpu_relax();
+			goto relock;
+		}
+
+		if (dentry->d_inode || dentry->d_count ||
+		    (dentry->d_flags & DCACHE_REFERENCED)) {
+			dentry->d_flags &= ~DCACHE_REFERENCED;
+			list_move(&dentry->d_lru, &skipped);
+		} else {
+			/* off the count now, shrink_dentry_list() kills it */
+			list_move_tail(&dentry->d_lru, &tmp);
+			dentry->d_flags |= DCACHE_SHRINK_LIST;
+			dentry_lru_uncount_negative(dentry);
+		}
+		spin_unlock(&dentry->d_lock);
+		cond_resched_lock(&dcache_lru_lock);
+	}
+	if (!list_empty(&skipped))
+		list_splice_tail(&skipped, &sb->s_dentry_lru);
+	spin_unlock(&dcache_lru_lock);
+
+	shrink_dentry_list(&tmp);
+}
+
+void prune_negative_dentries_work(struct work_struct *work)
+{
+	struct super_block *sb = container_of(work, struct super_block,
+					      s_negative_prune_work);
+
+	/* an unmount in progress will get rid of them anyway */
+	if (!down_read_trylock(&sb->s_umount))
+		return;
+	if (sb->s_root)
+		prune_negative_dentries(sb);
+	up_read(&sb->s_umount);
+}
+
 /**
  * prune_dcache - shrink the dcache
  * @count: number of entries to try to free
@@ -1385,6 +1526,11 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 		if (unlikely(IS_AUTOMOUNT(inode)))
 			dentry->d_flags |= DCACHE_NEED_AUTOMOUNT;
 		list_add(&dentry->d_alias, &inode->i_dentry);
+		if (dentry->d_flags & DCACHE_NEGATIVE_LRU) {
+			spin_lock(&dcache_lru_lock);
+			dentry_lru_uncount_negative(dentry);
+			spin_unlock(&dcache_lru_lock);
+		}
 	}
 	dentry->d_inode = inode;
 	dentry_rcuwalk_barrier(dentry);
@@ -3125,6 +3271,88 @@ EXPORT_SYMBOL(names_cachep);
 
 EXPORT_SYMBOL(d_genocide);
 
+#ifdef CONFIG_PROC_FS
+/*
+ * /proc/fs/dcache_stats: how the path walk fared in the dcache, the time
+ * the lookups that missed took in power of two buckets of microseconds,
+ * and the unused and negative dentries of each superblock.  Writing to
+ * it clears the counters.
+ */
+static int dcache_stats_show(struct seq_file *m, void *v)
+{
+	struct d_lookup_stat sum;
+	struct super_block *sb;
+	int cpu, i;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		struct d_lookup_stat *s = &per_cpu(d_lookup_stat, cpu);
+
+		sum.hits += s->hits;
+		sum.negative_hits += s->negative_hits;
+		sum.misses += s->misses;
+		for (i = 0; i < D_LOOKUP_HIST_BUCKETS; i++)
+			sum.miss_hist[i] += s->miss_hist[i];
+	}
+
+	seq_printf(m, "hits %lu\nnegative_hits %lu\nmisses %lu\n",
+		   sum.hits, sum.negative_hits, sum.misses);
+	seq_printf(m, "%-16s", "miss_usecs");
+	for (i = 0; i < D_LOOKUP_HIST_BUCKETS; i++)
+		seq_printf(m, " %s%llu",
+			   i < D_LOOKUP_HIST_BUCKETS - 1 ? "<" : ">=",
+			   log2_hist_bound(i, D_LOOKUP_HIST_BUCKETS));
+	seq_printf(m, "\n%-16s", "");
+	for (i = 0; i < D_LOOKUP_HIST_BUCKETS; i++)
+		seq_printf(m, " %lu", sum.miss_hist[i]);
+	seq_printf(m, "\nnegative_dentry_limit %d\n",
+		   sysctl_negative_dentry_limit);
+
+	seq_printf(m, "%-16s %10s %10s\n", "sb", "unused", "negative");
+	spin_lock(&sb_lock);
+	list_for_each_entry(sb, &super_blocks, s_list) {
+		if (list_empty(&sb->s_instances) || !sb->s_nr_dentry_unused)
+			continue;
+		seq_printf(m, "%-16s %10d %10d\n", sb->s_id,
+			   sb->s_nr_dentry_unused, sb->s_nr_negative_dentry);
+	}
+	spin_unlock(&sb_lock);
+
+	return 0;
+}
+
+static int dcache_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dcache_stats_show, NULL);
+}
+
+static ssize_t dcache_stats_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(d_lookup_stat, cpu), 0,
+		       sizeof(struct d_lookup_stat));
+	return count;
+}
+
+static const struct file_operations dcache_stats_fops = {
+	.open		= dcache_stats_open,
+	.read		= seq_read,
+	.write		= dcache_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dcache_stats_init(void)
+{
+	proc_create("fs/dcache_stats", 0644, NULL, &dcache_stats_fops);
+	return 0;
+}
+module_init(dcache_stats_init);
+#endif
+
 void __init vfs_caches_init_early(void)
 {
 	dcache_init_early();
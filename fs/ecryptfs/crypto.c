@@ -37,17 +37,6 @@
 #include <asm/unaligned.h>
 #include "ecryptfs_kernel.h"
 
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-
 /**
  * ecryptfs_to_hex
  * @dst: Buffer to take hex character representation of contents of
@@ -243,7 +232,7 @@ void ecryptfs_destroy_crypt_stat(struct ecryptfs_crypt_stat *crypt_stat)
 	struct ecryptfs_key_sig *key_sig, *key_sig_tmp;
 
 	if (crypt_stat->tfm)
-		crypto_free_blkcipher(crypt_stat->tfm);
+		crypto_free_ablkcipher(crypt_stat->tfm);
 	if (crypt_stat->hash_tfm)
 		crypto_free_hash(crypt_stat->hash_tfm);
 	list_for_each_entry_safe(key_sig, key_sig_tmp,
@@ -323,26 +312,120 @@ int virt_to_scatterlist(const void *addr, int size, struct scatterlist *sg,
 }
 
 /**
- * encrypt_scatterlist
- * @crypt_stat: Pointer to the crypt_stat struct to initialize.
- * @dest_sg: Destination of encrypted data
- * @src_sg: Data to be encrypted
- * @size: Length of data to be encrypted
- * @iv: iv to use during encryption
+ * ecryptfs_lower_offset_for_extent
  *
- * Returns the number of bytes encrypted; negative value on error
+ * Convert an eCryptfs page index into a lower byte offset
  */
-static int encrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
+static void ecryptfs_lower_offset_for_extent(loff_t *offset, loff_t extent_num,
+					     struct ecryptfs_crypt_stat *crypt_stat)
 {
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
-	int rc = 0;
+	(*offset) = ecryptfs_lower_header_size(crypt_stat)
+		    + (crypt_stat->extent_size * extent_num);
+}
+
+/*
+ * One extent's share of a page going through the cipher.  The request
+ * is last, followed by its tfm's context.
+ */
+struct ecryptfs_extent_crypt {
+	struct scatterlist src_sg;
+	struct scatterlist dst_sg;
+	char iv[ECRYPTFS_MAX_IV_BYTES];
+	struct ablkcipher_request req;
+};
+
+/*
+ * A page going through the cipher, all of its extents at once, so that
+ * an asynchronous engine gets them as one batch and several pages can
+ * be in flight together.
+ */
+struct ecryptfs_page_crypt {
+	struct completion done;
+	atomic_t pending;
+	int rc;
+	struct page *page;
+	struct page *enc_page;
+	int nr_extents;
+	size_t stride;
+	char extents[];
+};
+
+static struct ecryptfs_extent_crypt *
+ecryptfs_page_crypt_extent(struct ecryptfs_page_crypt *pc, int i)
+{
+	return (struct ecryptfs_extent_crypt *)(pc->extents + i * pc->stride);
+}
+
+struct page *ecryptfs_page_crypt_page(struct ecryptfs_page_crypt *pc)
+{
+	return pc->page;
+}
+
+static struct ecryptfs_page_crypt *
+ecryptfs_page_crypt_alloc(struct ecryptfs_crypt_stat *crypt_stat,
+			  struct page *page)
+{
+	struct ecryptfs_page_crypt *pc;
+	int nr_extents = PAGE_CACHE_SIZE / crypt_stat->extent_size;
+	size_t stride;
+
+	stride = ALIGN(sizeof(struct ecryptfs_extent_crypt) +
+		       crypto_ablkcipher_reqsize(crypt_stat->tfm),
+		       CRYPTO_MINALIGN);
+	pc = kmalloc(sizeof(*pc) + nr_extents * stride, GFP_NOFS);
+	if (!pc)
+		return NULL;
+
+	pc->enc_page = alloc_page(GFP_USER);
+	if (!pc->enc_page) {
+		kfree(pc);
+		return NULL;
+	}
+	pc->page = page;
+	pc->nr_extents = nr_extents;
+	pc->stride = stride;
+	return pc;
+}
+
+static void ecryptfs_page_crypt_free(struct ecryptfs_page_crypt *pc)
+{
+	__free_page(pc->enc_page);
+	kfree(pc);
+}
+
+static void ecryptfs_extent_crypt_done(struct crypto_async_request *req,
+				       int rc)
+{
+	struct ecryptfs_page_crypt *pc = req->data;
+
+	/* a backlogged request has just been taken up */
+	if (rc == -EINPROGRESS)
+		return;
+
+	if (rc)
+		pc->rc = rc;
+	if (atomic_dec_and_test(&pc->pending))
+		complete(&pc->done);
+}
+
+/**
+ * ecryptfs_page_crypt_start
+ * @crypt_stat: The cryptographic context
+ * @pc: The page and its encrypted counterpart
+ * @encrypt: Encrypt pc->page into pc->enc_page, or decrypt the other way
+ *
+ * Hands every extent of the page to the cipher, without waiting for any
+ * of them; ecryptfs_page_crypt_wait() does.
+ *
+ * Returns zero once everything is submitted; negative on error
+ */
+static int ecryptfs_page_crypt_start(struct ecryptfs_crypt_stat *crypt_stat,
+				     struct ecryptfs_page_crypt *pc,
+				     int encrypt)
+{
+	struct ecryptfs_extent_crypt *ec;
+	loff_t extent_base;
+	int i, rc = 0;
 
 	BUG_ON(!crypt_stat || !crypt_stat->tfm
 	       || !(crypt_stat->flags & ECRYPTFS_STRUCT_INITIALIZED));
@@ -352,84 +435,166 @@ static int encrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
 		ecryptfs_dump_hex(crypt_stat->key,
 				  crypt_stat->key_size);
 	}
-	/* Consider doing this once, when the file is opened */
+
+	init_completion(&pc->done);
+	pc->rc = 0;
+	/* held until all are submitted, the callbacks may come first */
+	atomic_set(&pc->pending, pc->nr_extents + 1);
+
 	mutex_lock(&crypt_stat->cs_tfm_mutex);
 	if (!(crypt_stat->flags & ECRYPTFS_KEY_SET)) {
-		rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-					     crypt_stat->key_size);
-		crypt_stat->flags |= ECRYPTFS_KEY_SET;
+		rc = crypto_ablkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
+					      crypt_stat->key_size);
+		if (!rc)
+			crypt_stat->flags |= ECRYPTFS_KEY_SET;
 	}
+	mutex_unlock(&crypt_stat->cs_tfm_mutex);
 	if (rc) {
 		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
 				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
-		rc = -EINVAL;
-		goto out;
+		return -EINVAL;
 	}
-	ecryptfs_printk(KERN_DEBUG, "Encrypting [%d] bytes.\n", size);
-	crypto_blkcipher_encrypt_iv(&desc, dest_sg, src_sg, size);
-	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-out:
-	return rc;
+
+	extent_base = (((loff_t)pc->page->index)
+		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
+	for (i = 0; i < pc->nr_extents; i++) {
+		unsigned int offset = i * crypt_stat->extent_size;
+
+		ec = ecryptfs_page_crypt_extent(pc, i);
+		rc = ecryptfs_derive_iv(ec->iv, crypt_stat, extent_base + i);
+		if (rc) {
+			ecryptfs_printk(KERN_ERR, "Error attempting to derive "
+				"IV for extent [0x%.16llx]; rc = [%d]\n",
+				(unsigned long long)(extent_base + i), rc);
+			pc->rc = rc;
+			atomic_sub(pc->nr_extents - i, &pc->pending);
+			break;
+		}
+
+		sg_init_table(&ec->src_sg, 1);
+		sg_init_table(&ec->dst_sg, 1);
+		if (encrypt) {
+			sg_set_page(&ec->src_sg, pc->page,
+				    crypt_stat->extent_size, offset);
+			sg_set_page(&ec->dst_sg, pc->enc_page,
+				    crypt_stat->extent_size, offset);
+		} else {
+			sg_set_page(&ec->src_sg, pc->enc_page,
+				    crypt_stat->extent_size, offset);
+			sg_set_page(&ec->dst_sg, pc->page,
+				    crypt_stat->extent_size, offset);
+		}
+
+		ablkcipher_request_set_tfm(&ec->req, crypt_stat->tfm);
+		ablkcipher_request_set_callback(&ec->req,
+				CRYPTO_TFM_REQ_MAY_BACKLOG |
+				CRYPTO_TFM_REQ_MAY_SLEEP,
+				ecryptfs_extent_crypt_done, pc);
+		ablkcipher_request_set_crypt(&ec->req, &ec->src_sg,
+					     &ec->dst_sg,
+					     crypt_stat->extent_size, ec->iv);
+		rc = encrypt ? crypto_ablkcipher_encrypt(&ec->req) :
+			       crypto_ablkcipher_decrypt(&ec->req);
+		if (rc == -EINPROGRESS || rc == -EBUSY)
+			continue;
+
+		/* done already, or failed */
+		if (rc)
+			pc->rc = rc;
+		atomic_dec(&pc->pending);
+	}
+
+	if (atomic_dec_and_test(&pc->pending))
+		complete(&pc->done);
+	return 0;
+}
+
+static int ecryptfs_page_crypt_wait(struct ecryptfs_page_crypt *pc)
+{
+	wait_for_completion(&pc->done);
+	if (pc->rc)
+		printk(KERN_ERR "%s: Error attempting to crypt page with "
+		       "page->index = [%ld]; rc = [%d]\n", __func__,
+		       pc->page->index, pc->rc);
+	return pc->rc;
 }
 
 /**
- * ecryptfs_lower_offset_for_extent
+ * ecryptfs_encrypt_page_start
+ * @page: Page mapped from the eCryptfs inode for the file; contains
+ *        decrypted content that needs to be encrypted (to a temporary
+ *        page; not in place) and written out to the lower file
  *
- * Convert an eCryptfs page index into a lower byte offset
+ * Starts encrypting @page, all extents at once, for
+ * ecryptfs_encrypt_page_finish() to write out.  Writeback keeps several
+ * pages started this way so that they are all in flight together.
+ *
+ * Returns the page in flight; an ERR_PTR() on error
  */
-static void ecryptfs_lower_offset_for_extent(loff_t *offset, loff_t extent_num,
-					     struct ecryptfs_crypt_stat *crypt_stat)
+struct ecryptfs_page_crypt *ecryptfs_encrypt_page_start(struct page *page)
 {
-	(*offset) = ecryptfs_lower_header_size(crypt_stat)
-		    + (crypt_stat->extent_size * extent_num);
+	struct inode *ecryptfs_inode;
+	struct ecryptfs_crypt_stat *crypt_stat;
+	struct ecryptfs_page_crypt *pc;
+	int rc;
+
+	ecryptfs_inode = page->mapping->host;
+	crypt_stat =
+		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
+	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
+	pc = ecryptfs_page_crypt_alloc(crypt_stat, page);
+	if (!pc) {
+		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
+				"encrypted extent\n");
+		return ERR_PTR(-ENOMEM);
+	}
+	rc = ecryptfs_page_crypt_start(crypt_stat, pc, 1);
+	if (rc) {
+		ecryptfs_page_crypt_free(pc);
+		return ERR_PTR(rc);
+	}
+	return pc;
 }
 
 /**
- * ecryptfs_encrypt_extent
- * @enc_extent_page: Allocated page into which to encrypt the data in
- *                   @page
- * @crypt_stat: crypt_stat containing cryptographic context for the
- *              encryption operation
- * @page: Page containing plaintext data extent to encrypt
- * @extent_offset: Page extent offset for use in generating IV
+ * ecryptfs_encrypt_page_finish
+ * @pc: The page returned by ecryptfs_encrypt_page_start()
  *
- * Encrypts one extent of data.
+ * Waits for the page's encryption to complete, writes it to the lower
+ * file in one go, and frees @pc.
  *
- * Return zero on success; non-zero otherwise
+ * Returns zero on success; negative on error
  */
-static int ecryptfs_encrypt_extent(struct page *enc_extent_page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *page,
-				   unsigned long extent_offset)
+int ecryptfs_encrypt_page_finish(struct ecryptfs_page_crypt *pc)
 {
-	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
+	struct inode *ecryptfs_inode = pc->page->mapping->host;
+	struct ecryptfs_crypt_stat *crypt_stat =
+		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
+	char *enc_extent_virt;
+	loff_t offset;
 	int rc;
 
-	extent_base = (((loff_t)page->index)
-		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
-				(extent_base + extent_offset));
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error attempting to derive IV for "
-			"extent [0x%.16llx]; rc = [%d]\n",
-			(unsigned long long)(extent_base + extent_offset), rc);
+	rc = ecryptfs_page_crypt_wait(pc);
+	if (rc)
 		goto out;
-	}
-	rc = ecryptfs_encrypt_page_offset(crypt_stat, enc_extent_page, 0,
-					  page, (extent_offset
-						 * crypt_stat->extent_size),
-					  crypt_stat->extent_size, extent_iv);
+
+	ecryptfs_lower_offset_for_extent(
+		&offset, (((loff_t)pc->page->index)
+			  * (PAGE_CACHE_SIZE / crypt_stat->extent_size)),
+		crypt_stat);
+	enc_extent_virt = kmap(pc->enc_page);
+	rc = ecryptfs_write_lower(ecryptfs_inode, enc_extent_virt, offset,
+				  PAGE_CACHE_SIZE);
+	kunmap(pc->enc_page);
 	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to encrypt page with "
-		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
+		ecryptfs_printk(KERN_ERR, "Error attempting "
+				"to write lower page; rc = [%d]"
+				"\n", rc);
 		goto out;
 	}
 	rc = 0;
 out:
+	ecryptfs_page_crypt_free(pc);
 	return rc;
 }
 
@@ -451,94 +616,12 @@ out:
  */
 int ecryptfs_encrypt_page(struct page *page)
 {
-	struct inode *ecryptfs_inode;
-	struct ecryptfs_crypt_stat *crypt_stat;
-	char *enc_extent_virt;
-	struct page *enc_extent_page = NULL;
-	loff_t extent_offset;
-	int rc = 0;
-
-	ecryptfs_inode = page->mapping->host;
-	crypt_stat =
-		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
-	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
-	enc_extent_page = alloc_page(GFP_USER);
-	if (!enc_extent_page) {
-		rc = -ENOMEM;
-		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
-				"encrypted extent\n");
-		goto out;
-	}
-	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
-	     extent_offset++) {
-		loff_t offset;
-
-		rc = ecryptfs_encrypt_extent(enc_extent_page, crypt_stat, page,
-					     extent_offset);
-		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
-			       "rc = [%d]\n", __func__, rc);
-			goto out;
-		}
-		ecryptfs_lower_offset_for_extent(
-			&offset, ((((loff_t)page->index)
-				   * (PAGE_CACHE_SIZE
-				      / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_write_lower(ecryptfs_inode, enc_extent_virt,
-					  offset, crypt_stat->extent_size);
-		if (rc < 0) {
-			ecryptfs_printk(KERN_ERR, "Error attempting "
-					"to write lower page; rc = [%d]"
-					"\n", rc);
-			goto out;
-		}
-	}
-	rc = 0;
-out:
-	if (enc_extent_page) {
-		kunmap(enc_extent_page);
-		__free_page(enc_extent_page);
-	}
-	return rc;
-}
-
-static int ecryptfs_decrypt_extent(struct page *page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *enc_extent_page,
-				   unsigned long extent_offset)
-{
-	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
-	int rc;
+	struct ecryptfs_page_crypt *pc;
 
-	extent_base = (((loff_t)page->index)
-		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
-				(extent_base + extent_offset));
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error attempting to derive IV for "
-			"extent [0x%.16llx]; rc = [%d]\n",
-			(unsigned long long)(extent_base + extent_offset), rc);
-		goto out;
-	}
-	rc = ecryptfs_decrypt_page_offset(crypt_stat, page,
-					  (extent_offset
-					   * crypt_stat->extent_size),
-					  enc_extent_page, 0,
-					  crypt_stat->extent_size, extent_iv);
-	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to decrypt to page with "
-		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
-		goto out;
-	}
-	rc = 0;
-out:
-	return rc;
+	pc = ecryptfs_encrypt_page_start(page);
+	if (IS_ERR(pc))
+		return PTR_ERR(pc);
+	return ecryptfs_encrypt_page_finish(pc);
 }
 
 /**
@@ -561,160 +644,45 @@ int ecryptfs_decrypt_page(struct page *page)
 {
 	struct inode *ecryptfs_inode;
 	struct ecryptfs_crypt_stat *crypt_stat;
+	struct ecryptfs_page_crypt *pc;
 	char *enc_extent_virt;
-	struct page *enc_extent_page = NULL;
-	unsigned long extent_offset;
-	int rc = 0;
+	loff_t offset;
+	int rc;
 
 	ecryptfs_inode = page->mapping->host;
 	crypt_stat =
 		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
 	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
-	enc_extent_page = alloc_page(GFP_USER);
-	if (!enc_extent_page) {
-		rc = -ENOMEM;
+	pc = ecryptfs_page_crypt_alloc(crypt_stat, page);
+	if (!pc) {
 		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
 				"encrypted extent\n");
-		goto out;
-	}
-	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
-	     extent_offset++) {
-		loff_t offset;
-
-		ecryptfs_lower_offset_for_extent(
-			&offset, ((page->index * (PAGE_CACHE_SIZE
-						  / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_read_lower(enc_extent_virt, offset,
-					 crypt_stat->extent_size,
-					 ecryptfs_inode);
-		if (rc < 0) {
-			ecryptfs_printk(KERN_ERR, "Error attempting "
-					"to read lower page; rc = [%d]"
-					"\n", rc);
-			goto out;
-		}
-		rc = ecryptfs_decrypt_extent(page, crypt_stat, enc_extent_page,
-					     extent_offset);
-		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
-			       "rc = [%d]\n", __func__, rc);
-			goto out;
-		}
-	}
-out:
-	if (enc_extent_page) {
-		kunmap(enc_extent_page);
-		__free_page(enc_extent_page);
+		return -ENOMEM;
 	}
-	return rc;
-}
-
-/**
- * decrypt_scatterlist
- * @crypt_stat: Cryptographic context
- * @dest_sg: The destination scatterlist to decrypt into
- * @src_sg: The source scatterlist to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
- *
- * Returns the number of bytes decrypted; negative value on error
- */
-static int decrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
-{
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
-	int rc = 0;
 
-	/* Consider doing this once, when the file is opened */
-	mutex_lock(&crypt_stat->cs_tfm_mutex);
-	rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-				     crypt_stat->key_size);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
-				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
-		rc = -EINVAL;
-		goto out;
-	}
-	ecryptfs_printk(KERN_DEBUG, "Decrypting [%d] bytes.\n", size);
-	rc = crypto_blkcipher_decrypt_iv(&desc, dest_sg, src_sg, size);
-	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error decrypting; rc = [%d]\n",
-				rc);
+	ecryptfs_lower_offset_for_extent(
+		&offset, (((loff_t)page->index)
+			  * (PAGE_CACHE_SIZE / crypt_stat->extent_size)),
+		crypt_stat);
+	enc_extent_virt = kmap(pc->enc_page);
+	rc = ecryptfs_read_lower(enc_extent_virt, offset, PAGE_CACHE_SIZE,
+				 ecryptfs_inode);
+	kunmap(pc->enc_page);
+	if (rc < 0) {
+		ecryptfs_printk(KERN_ERR, "Error attempting "
+				"to read lower page; rc = [%d]"
+				"\n", rc);
 		goto out;
 	}
-	rc = size;
+
+	rc = ecryptfs_page_crypt_start(crypt_stat, pc, 0);
+	if (!rc)
+		rc = ecryptfs_page_crypt_wait(pc);
 out:
+	ecryptfs_page_crypt_free(pc);
 	return rc;
 }
 
-/**
- * ecryptfs_encrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to encrypt into
- * @dst_offset: The offset in the page to encrypt into
- * @src_page: The page to encrypt from
- * @src_offset: The offset in the page to encrypt from
- * @size: The number of bytes to encrypt
- * @iv: The initialization vector to use for the encryption
- *
- * Returns the number of bytes encrypted
- */
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_init_table(&dst_sg, 1);
-
-	sg_set_page(&src_sg, src_page, size, src_offset);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-	return encrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
-}
-
-/**
- * ecryptfs_decrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to decrypt into
- * @dst_offset: The offset in the page to decrypt into
- * @src_page: The page to decrypt from
- * @src_offset: The offset in the page to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
- *
- * Returns the number of bytes decrypted
- */
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_set_page(&src_sg, src_page, size, src_offset);
-
-	sg_init_table(&dst_sg, 1);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-
-	return decrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
-}
-
 #define ECRYPTFS_MAX_SCATTERLIST_LEN 4
 
 /**
@@ -749,8 +717,8 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 						    crypt_stat->cipher, "cbc");
 	if (rc)
 		goto out_unlock;
-	crypt_stat->tfm = crypto_alloc_blkcipher(full_alg_name, 0,
-						 CRYPTO_ALG_ASYNC);
+	/* asynchronous implementations welcome, pages are batched for them */
+	crypt_stat->tfm = crypto_alloc_ablkcipher(full_alg_name, 0, 0);
 	kfree(full_alg_name);
 	if (IS_ERR(crypt_stat->tfm)) {
 		rc = PTR_ERR(crypt_stat->tfm);
@@ -760,7 +728,7 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 				crypt_stat->cipher);
 		goto out_unlock;
 	}
-	crypto_blkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
+	crypto_ablkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
 	rc = 0;
 out_unlock:
 	mutex_unlock(&crypt_stat->cs_tfm_mutex);
@@ -87,6 +87,84 @@ out:
 	return rc;
 }
 
+/* pages writeback keeps in flight through the cipher at once */
+#define ECRYPTFS_WRITEBACK_BATCH 16
+
+struct ecryptfs_writeback_batch {
+	struct ecryptfs_page_crypt *pages[ECRYPTFS_WRITEBACK_BATCH];
+	int nr;
+};
+
+/*
+ * Write out the pages of @batch as their encryption completes, in the
+ * order they were started.
+ */
+static void ecryptfs_writeback_flush(struct address_space *mapping,
+				     struct ecryptfs_writeback_batch *batch)
+{
+	struct page *page;
+	int i, rc;
+
+	for (i = 0; i < batch->nr; i++) {
+		page = ecryptfs_page_crypt_page(batch->pages[i]);
+		rc = ecryptfs_encrypt_page_finish(batch->pages[i]);
+		if (rc) {
+			ecryptfs_printk(KERN_WARNING, "Error encrypting "
+					"page (upper index [0x%.16lx])\n",
+					page->index);
+			SetPageError(page);
+			mapping_set_error(mapping, rc);
+		}
+		end_page_writeback(page);
+	}
+	batch->nr = 0;
+}
+
+static int ecryptfs_writepage_batched(struct page *page,
+				      struct writeback_control *wbc,
+				      void *data)
+{
+	struct ecryptfs_writeback_batch *batch = data;
+	struct ecryptfs_page_crypt *pc;
+
+	pc = ecryptfs_encrypt_page_start(page);
+	if (IS_ERR(pc)) {
+		ecryptfs_printk(KERN_WARNING, "Error encrypting "
+				"page (upper index [0x%.16lx])\n", page->index);
+		ClearPageUptodate(page);
+		unlock_page(page);
+		return PTR_ERR(pc);
+	}
+
+	/* the page stays in writeback until its encryption is written */
+	set_page_writeback(page);
+	unlock_page(page);
+
+	batch->pages[batch->nr++] = pc;
+	if (batch->nr == ECRYPTFS_WRITEBACK_BATCH)
+		ecryptfs_writeback_flush(page->mapping, batch);
+	return 0;
+}
+
+/**
+ * ecryptfs_writepages
+ *
+ * Like ecryptfs_writepage() over every dirty page, but with up to
+ * ECRYPTFS_WRITEBACK_BATCH pages started through the cipher before the
+ * first is waited for, so that an asynchronous engine stays busy.
+ */
+static int ecryptfs_writepages(struct address_space *mapping,
+			       struct writeback_control *wbc)
+{
+	struct ecryptfs_writeback_batch batch = { .nr = 0 };
+	int rc;
+
+	rc = write_cache_pages(mapping, wbc, ecryptfs_writepage_batched,
+			       &batch);
+	ecryptfs_writeback_flush(mapping, &batch);
+	return rc;
+}
+
 static void strip_xattr_flag(char *page_virt,
 			     struct ecryptfs_crypt_stat *crypt_stat)
 {
@@ -559,6 +637,7 @@ static sector_t ecryptfs_bmap(struct address_space *mapping, sector_t block)
 
 const struct address_space_operations ecryptfs_aops = {
 	.writepage = ecryptfs_writepage,
+	.writepages = ecryptfs_writepages,
 	.readpage = ecryptfs_readpage,
 	.write_begin = ecryptfs_write_begin,
 	.write_end = ecryptfs_write_end,
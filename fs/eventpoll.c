@@ -203,6 +203,16 @@ struct eventpoll {
 	/* used to optimize loop detection check */
 	int visited;
 	struct list_head visited_list_link;
+
+	/*
+	 * Wakeup statistics, shown in the fdinfo of the epoll file.  All
+	 * but "lockless" are updated under ->lock; that one is not, and
+	 * may lose a count now and then.
+	 */
+	unsigned long stat_locked;	/* ep_poll_callback() under ->lock */
+	unsigned long stat_lockless;	/* ... for an item already queued */
+	unsigned long stat_wakeups;	/* wakeups of epoll_wait() */
+	unsigned long stat_batched;	/* ... left to the one already sent */
 };
 
 /* Wait structure used by the poll hooks */
@@ -298,6 +308,34 @@ static inline int is_file_epoll(struct file *f)
 	return f->f_op == &eventpoll_fops;
 }
 
+/**
+ * eventpoll_fdinfo - append the wakeup statistics of an epoll file
+ *
+ * @file: The file shown in /proc/<pid>/fdinfo.
+ * @buf: Where to print.
+ * @size: The room left in @buf.
+ *
+ * Returns: Returns the length printed, zero for a file that is not an
+ *          epoll one.
+ */
+int eventpoll_fdinfo(struct file *file, char *buf, int size)
+{
+	struct eventpoll *ep;
+
+	if (!is_file_epoll(file))
+		return 0;
+
+	/* the counters are only read, a torn snapshot will do */
+	ep = file->private_data;
+	return scnprintf(buf, size,
+			 "callbacks:\t%lu\n"
+			 "lockless:\t%lu\n"
+			 "wakeups:\t%lu\n"
+			 "batched:\t%lu\n",
+			 ep->stat_locked + ep->stat_lockless, ep->stat_lockless,
+			 ep->stat_wakeups, ep->stat_batched);
+}
+
 /* Setup the structure that is used as key for the RB tree */
 static inline void ep_set_ffd(struct epoll_filefd *ffd,
 			      struct file *file, int fd)
@@ -584,8 +622,10 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 		 * Wake up (if active) both the eventpoll wait list and
 		 * the ->poll() wait list (delayed after we release the lock).
 		 */
-		if (waitqueue_active(&ep->wq))
+		if (waitqueue_active(&ep->wq)) {
 			wake_up_locked(&ep->wq);
+			ep->stat_wakeups++;
+		}
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -870,7 +910,28 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 		list_del_init(&wait->task_list);
 	}
 
+	/*
+	 * Lockless fast path: an item still on the ready list, outside of an
+	 * event transfer, needs nothing more done to it.  It will be polled
+	 * for its events when it is transferred, and waking up epoll_wait()
+	 * was already done when it was queued.  It is the common case of a
+	 * burst of wakeups on a busy fd, such as binder's.  The barrier pairs
+	 * with the one in ep_send_events_proc(): either we see the item off
+	 * the list and queue it again, or its ->poll() sees our event.
+	 *
+	 * A ->poll() waiter on the epoll file itself wants every event, and
+	 * takes the locked path.
+	 */
+	smp_mb();
+	if (ep_is_linked(&epi->rdllink) &&
+	    ACCESS_ONCE(ep->ovflist) == EP_UNACTIVE_PTR &&
+	    !waitqueue_active(&ep->poll_wait)) {
+		ep->stat_lockless++;
+		return 1;
+	}
+
 	spin_lock_irqsave(&ep->lock, flags);
+	ep->stat_locked++;
 
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
@@ -904,16 +965,26 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 		goto out_unlock;
 	}
 
-	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink))
-		list_add_tail(&epi->rdllink, &ep->rdllist);
-
 	/*
-	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * If this file is already in the ready list we exit soon.  Only the
+	 * first item of a burst wakes up epoll_wait(): a waiter sleeps only on
+	 * an empty ready list, the one woken up transfers the whole burst, and
+	 * ep_scan_ready_list() wakes up the next one for what it leaves.
 	 */
-	if (waitqueue_active(&ep->wq))
-		wake_up_locked(&ep->wq);
+	if (ep_is_linked(&epi->rdllink) || !list_empty(&ep->rdllist)) {
+		if (!ep_is_linked(&epi->rdllink))
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+		if (waitqueue_active(&ep->wq))
+			ep->stat_batched++;
+	} else {
+		list_add_tail(&epi->rdllink, &ep->rdllist);
+		if (waitqueue_active(&ep->wq)) {
+			wake_up_locked(&ep->wq);
+			ep->stat_wakeups++;
+		}
+	}
+
+	/* Wake up ( if active ) the ->poll() wait list */
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1271,6 +1342,9 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 
 		list_del_init(&epi->rdllink);
 
+		/* pairs with the barrier of ep_poll_callback()'s fast path */
+		smp_mb();
+
 		revents = epi->ffd.file->f_op->poll(epi->ffd.file, NULL) &
 			epi->event.events;
 
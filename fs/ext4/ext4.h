@@ -922,6 +922,9 @@ struct ext4_inode_info {
 #define EXT4_MOUNT_DISCARD		0x40000000 /* Issue DISCARD requests */
 #define EXT4_MOUNT_INIT_INODE_TABLE	0x80000000 /* Initialize uninitialized itables */
 
+#define EXT4_MOUNT2_FAST_FSYNC		0x00000001 /* fsync skips commits of
+						      timestamps only */
+
 #define clear_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt &= \
 						~EXT4_MOUNT_##opt
 #define set_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt |= \
@@ -1160,6 +1163,7 @@ struct ext4_sb_info {
 	/* ext4 extent cache stats */
 	unsigned long extent_cache_hits;
 	unsigned long extent_cache_misses;
+	unsigned long s_fast_fsyncs;
 
 	/* for buddy allocator */
 	struct ext4_group_info ***s_group_info;
@@ -243,6 +243,35 @@ int ext4_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 	}
 
 	commit_tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
+
+	/*
+	 * fast_fsync: when the blocks, size and attributes of the file are
+	 * committed, what the running transaction still holds of the inode
+	 * is the timestamps of the writes since.  Leave those to the next
+	 * periodic commit and only flush the data, like fdatasync does.
+	 *
+	 * This is crash safe because everything else advances
+	 * i_datasync_tid to the transaction that logs it: block
+	 * allocation and unwritten extent conversion, i_disksize and link
+	 * count changes (inode creation included) in
+	 * ext4_do_update_inode(), setattr and xattrs.  The data was written
+	 * and waited for above, and the completed unwritten extents were
+	 * converted above, both before the tid is sampled here.  Writers,
+	 * setattr and the conversions all hold i_mutex, as we do, so the
+	 * tid cannot move on until we are done; only the flusher can
+	 * allocate blocks meanwhile, and for data written after this
+	 * fsync started.  A crash therefore loses at most the timestamps.
+	 */
+	if (!datasync && test_opt2(inode->i_sb, FAST_FSYNC)) {
+		read_lock(&journal->j_state_lock);
+		if (tid_geq(journal->j_commit_sequence, ei->i_datasync_tid) &&
+		    commit_tid != ei->i_datasync_tid) {
+			commit_tid = ei->i_datasync_tid;
+			EXT4_SB(inode->i_sb)->s_fast_fsyncs++;
+		}
+		read_unlock(&journal->j_state_lock);
+	}
+
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
 		needs_barrier = true;
@@ -5392,6 +5392,9 @@ static int ext4_do_update_inode(handle_t *handle,
 		raw_inode->i_uid_high = 0;
 		raw_inode->i_gid_high = 0;
 	}
+	/* new inodes included, their raw inode was cleared above */
+	if (le16_to_cpu(raw_inode->i_links_count) != inode->i_nlink)
+		need_datasync = 1;
 	raw_inode->i_links_count = cpu_to_le16(inode->i_nlink);
 
 	EXT4_INODE_SET_XTIME(i_ctime, inode, raw_inode);
@@ -5664,6 +5667,8 @@ int ext4_setattr(struct dentry *dentry, struct iattr *attr)
 	if (!rc) {
 		setattr_copy(inode, attr);
 		mark_inode_dirty(inode);
+		/* fast_fsync must not leave explicit changes in the journal */
+		EXT4_I(inode)->i_datasync_tid = EXT4_I(inode)->i_sync_tid;
 	}
 
 	/*
@@ -1056,6 +1056,7 @@ ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 		inode->i_ctime = ext4_current_time(inode);
 		if (!value)
 			ext4_clear_inode_state(inode, EXT4_STATE_NO_EXPAND);
+		ext4_update_inode_fsync_trans(handle, inode, 1);
 		error = ext4_mark_iloc_dirty(handle, inode, &is.iloc);
 		/*
 		 * The bh is consumed by ext4_mark_iloc_dirty, even with
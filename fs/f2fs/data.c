@@ -277,47 +277,63 @@ int f2fs_reserve_block(struct dnode_of_data *dn, pgoff_t index)
 	return err;
 }
 
+static void map_extent_bh(struct inode *inode, pgoff_t pgofs,
+			pgoff_t start_fofs, pgoff_t end_fofs,
+			block_t start_blkaddr, struct buffer_head *bh_result)
+{
+	unsigned int blkbits = inode->i_sb->s_blocksize_bits;
+	size_t count;
+
+	clear_buffer_new(bh_result);
+	map_bh(bh_result, inode->i_sb, start_blkaddr + pgofs - start_fofs);
+	count = end_fofs - pgofs + 1;
+	if (count < (UINT_MAX >> blkbits))
+		bh_result->b_size = (count << blkbits);
+	else
+		bh_result->b_size = UINT_MAX;
+
+	stat_inc_read_hit(inode->i_sb);
+}
+
 static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
 					struct buffer_head *bh_result)
 {
 	struct f2fs_inode_info *fi = F2FS_I(inode);
 	pgoff_t start_fofs, end_fofs;
 	block_t start_blkaddr;
+	unsigned int fofs, len;
+
+	stat_inc_total_hit(inode->i_sb);
 
 	if (is_inode_flag_set(fi, FI_NO_EXTENT))
-		return 0;
+		goto lookup_tree;
 
 	read_lock(&fi->ext.ext_lock);
 	if (fi->ext.len == 0) {
 		read_unlock(&fi->ext.ext_lock);
-		return 0;
+		goto lookup_tree;
 	}
 
-	stat_inc_total_hit(inode->i_sb);
-
 	start_fofs = fi->ext.fofs;
 	end_fofs = fi->ext.fofs + fi->ext.len - 1;
 	start_blkaddr = fi->ext.blk_addr;
 
 	if (pgofs >= start_fofs && pgofs <= end_fofs) {
-		unsigned int blkbits = inode->i_sb->s_blocksize_bits;
-		size_t count;
-
-		clear_buffer_new(bh_result);
-		map_bh(bh_result, inode->i_sb,
-				start_blkaddr + pgofs - start_fofs);
-		count = end_fofs - pgofs + 1;
-		if (count < (UINT_MAX >> blkbits))
-			bh_result->b_size = (count << blkbits);
-		else
-			bh_result->b_size = UINT_MAX;
-
-		stat_inc_read_hit(inode->i_sb);
+		map_extent_bh(inode, pgofs, start_fofs, end_fofs,
+						start_blkaddr, bh_result);
 		read_unlock(&fi->ext.ext_lock);
 		return 1;
 	}
 	read_unlock(&fi->ext.ext_lock);
-	return 0;
+
+lookup_tree:
+	/* then the extents the read path cached before */
+	if (!f2fs_lookup_extent_tree(inode, pgofs, &fofs, &start_blkaddr,
+									&len))
+		return 0;
+	map_extent_bh(inode, pgofs, fofs, fofs + len - 1, start_blkaddr,
+								bh_result);
+	return 1;
 }
 
 void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
@@ -333,6 +349,7 @@ void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
 
 	/* Update the page address in the parent node */
 	__set_data_blkaddr(dn, blk_addr);
+	f2fs_update_extent_tree(dn->inode, fofs, blk_addr);
 
 	if (is_inode_flag_set(fi, FI_NO_EXTENT))
 		return;
@@ -628,6 +645,10 @@ static int get_data_block(struct inode *inode, sector_t iblock,
 	pgoff_t pgofs, end_offset;
 	int err = 0, ofs = 1;
 	bool allocated = false;
+	/* the run of blocks mapped by the current dnode, for the extent tree */
+	pgoff_t ext_fofs = 0;
+	block_t ext_blkaddr = NULL_ADDR;
+	unsigned int ext_len = 0;
 
 	/* Get the page offset from the block offset(iblock) */
 	pgofs =	(pgoff_t)(iblock >> (PAGE_CACHE_SHIFT - blkbits));
@@ -661,6 +682,10 @@ static int get_data_block(struct inode *inode, sector_t iblock,
 		goto put_out;
 	}
 
+	ext_fofs = pgofs;
+	ext_blkaddr = dn.data_blkaddr;
+	ext_len = 1;
+
 	end_offset = IS_INODE(dn.node_page) ?
 			ADDRS_PER_INODE(F2FS_I(inode)) : ADDRS_PER_BLOCK;
 	bh_result->b_size = (((size_t)1) << blkbits);
@@ -672,6 +697,12 @@ get_next:
 		if (allocated)
 			sync_inode_page(&dn);
 		allocated = false;
+		if (!create && ext_len)
+			f2fs_insert_extent_tree(inode, ext_fofs, ext_blkaddr,
+								ext_len);
+		ext_fofs = pgofs;
+		ext_blkaddr = bh_result->b_blocknr + ofs;
+		ext_len = 0;
 		f2fs_put_dnode(&dn);
 
 		set_new_dnode(&dn, inode, NULL, NULL, 0);
@@ -700,6 +731,7 @@ get_next:
 		/* Give more consecutive addresses for the read ahead */
 		if (blkaddr == (bh_result->b_blocknr + ofs)) {
 			ofs++;
+			ext_len++;
 			dn.ofs_in_node++;
 			pgofs++;
 			bh_result->b_size += (((size_t)1) << blkbits);
@@ -710,6 +742,8 @@ sync_out:
 	if (allocated)
 		sync_inode_page(&dn);
 put_out:
+	if (!create && ext_len)
+		f2fs_insert_extent_tree(inode, ext_fofs, ext_blkaddr, ext_len);
 	f2fs_put_dnode(&dn);
 unlock_out:
 	if (create)
@@ -752,6 +786,25 @@ static int f2fs_read_data_pages(struct file *file,
 	return mpage_readpages(mapping, pages, nr_pages, get_data_block);
 }
 
+/*
+ * Count the overwrites of an inode's data blocks, halving the count every
+ * HOT_UPDATE_DECAY so that only files rewritten lately stay hot.
+ */
+static void update_inode_temperature(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	unsigned long periods = (jiffies - fi->i_update_stamp) /
+							HOT_UPDATE_DECAY;
+
+	if (periods) {
+		fi->i_update_count = periods < 32 ?
+					fi->i_update_count >> periods : 0;
+		fi->i_update_stamp = jiffies;
+	}
+	if (fi->i_update_count < UINT_MAX)
+		fi->i_update_count++;
+}
+
 int do_write_data_page(struct page *page, struct f2fs_io_info *fio)
 {
 	struct inode *inode = page->mapping->host;
@@ -772,6 +825,9 @@ int do_write_data_page(struct page *page, struct f2fs_io_info *fio)
 
 	set_page_writeback(page);
 
+	if (old_blkaddr != NEW_ADDR && !is_cold_data(page))
+		update_inode_temperature(inode);
+
 	/*
 	 * If current allocation needs SSR,
 	 * it had better in-place writes for updated data.
@@ -35,6 +35,7 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	/* valid check of the segment numbers */
 	si->hit_ext = sbi->read_hit_ext;
 	si->total_ext = sbi->total_hit_ext;
+	si->ext_node = sbi->total_ext_node;
 	si->ndirty_node = get_pages(sbi, F2FS_DIRTY_NODES);
 	si->ndirty_dent = get_pages(sbi, F2FS_DIRTY_DENTS);
 	si->ndirty_dirs = sbi->n_dirty_dirs;
@@ -58,6 +59,13 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->sits = SIT_I(sbi)->dirty_sentries;
 	si->fnids = NM_I(sbi)->fcnt;
 	si->bg_gc = sbi->bg_gc;
+	si->ndiscard_cmds = SM_I(sbi)->nr_discard_cmds;
+	si->ndiscard_blks = SM_I(sbi)->nr_discard_blks;
+	si->ndiscard_bios = SM_I(sbi)->nr_discard_bios;
+	si->issued_discard = SM_I(sbi)->issued_discard;
+	si->merged_discard = SM_I(sbi)->merged_discard;
+	si->issued_flush = SM_I(sbi)->issued_flush;
+	si->merged_flush = SM_I(sbi)->merged_flush;
 	si->util_free = (int)(free_user_blocks(sbi) >> sbi->log_blocks_per_seg)
 		* 100 / (int)(sbi->user_block_count >> sbi->log_blocks_per_seg)
 		/ 2;
@@ -243,6 +251,15 @@ static int stat_show(struct seq_file *s, void *v)
 		seq_printf(s, "  - node blocks : %d\n", si->node_blks);
 		seq_printf(s, "\nExtent Hit Ratio: %d / %d\n",
 			   si->hit_ext, si->total_ext);
+		seq_printf(s, "  - cached extents: %u\n", si->ext_node);
+		seq_printf(s, "\nDiscard: %u cmds pending (%u blocks), "
+			   "%u bios in flight\n",
+			   si->ndiscard_cmds, si->ndiscard_blks,
+			   si->ndiscard_bios);
+		seq_printf(s, "  - issued: %u\n  - merged: %u\n",
+			   si->issued_discard, si->merged_discard);
+		seq_printf(s, "\nFlush: %u issued, %u saved by merging\n",
+			   si->issued_flush, si->merged_flush);
 		seq_puts(s, "\nBalancing F2FS Async:\n");
 		seq_printf(s, "  - nodes: %4d in %4d\n",
 			   si->ndirty_node, si->node_pages);
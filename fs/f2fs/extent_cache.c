@@ -0,0 +1,332 @@
+/*
+ * fs/f2fs/extent_cache.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *             http://www.samsung.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/fs.h>
+#include <linux/f2fs_fs.h>
+#include <linux/rbtree.h>
+#include <linux/mm.h>
+
+#include "f2fs.h"
+#include "node.h"
+
+/*
+ * Besides the single largest extent kept in the inode, every regular file
+ * caches the contiguous runs of blocks found by the read path in an rb-tree
+ * sorted by file offset, so that mapping a range again needs no node page.
+ * Writes and truncation keep the tree in step with the node pages while
+ * holding the dnode that changes.  The nodes of all the trees are on one
+ * lru list per filesystem, which a shrinker trims under memory pressure.
+ */
+
+static struct kmem_cache *extent_node_slab;
+
+static struct extent_node *__lookup_extent_node(struct f2fs_inode_info *fi,
+							unsigned int fofs)
+{
+	struct rb_node *node = fi->ext_tree.rb_node;
+
+	while (node) {
+		struct extent_node *en = rb_entry(node, struct extent_node,
+								rb_node);
+
+		if (fofs < en->fofs)
+			node = node->rb_left;
+		else if (fofs >= en->fofs + en->len)
+			node = node->rb_right;
+		else
+			return en;
+	}
+	return NULL;
+}
+
+/* the extent containing fofs, or else the first one after it */
+static struct extent_node *__lookup_next_extent_node(
+			struct f2fs_inode_info *fi, unsigned int fofs)
+{
+	struct rb_node *node = fi->ext_tree.rb_node;
+	struct extent_node *next = NULL;
+
+	while (node) {
+		struct extent_node *en = rb_entry(node, struct extent_node,
+								rb_node);
+
+		if (fofs < en->fofs) {
+			next = en;
+			node = node->rb_left;
+		} else if (fofs >= en->fofs + en->len) {
+			node = node->rb_right;
+		} else {
+			return en;
+		}
+	}
+	return next;
+}
+
+static void __link_extent_node(struct f2fs_sb_info *sbi,
+			struct f2fs_inode_info *fi, struct extent_node *en)
+{
+	struct rb_node **p = &fi->ext_tree.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*p) {
+		parent = *p;
+		if (en->fofs < rb_entry(parent, struct extent_node,
+							rb_node)->fofs)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&en->rb_node, parent, p);
+	rb_insert_color(&en->rb_node, &fi->ext_tree);
+	en->fi = fi;
+
+	spin_lock(&sbi->extent_lock);
+	list_add_tail(&en->list, &sbi->extent_list);
+	sbi->total_ext_node++;
+	spin_unlock(&sbi->extent_lock);
+}
+
+static void __detach_extent_node(struct f2fs_sb_info *sbi,
+			struct f2fs_inode_info *fi, struct extent_node *en)
+{
+	rb_erase(&en->rb_node, &fi->ext_tree);
+	if (fi->cached_en == en)
+		fi->cached_en = NULL;
+
+	spin_lock(&sbi->extent_lock);
+	list_del(&en->list);
+	sbi->total_ext_node--;
+	spin_unlock(&sbi->extent_lock);
+
+	kmem_cache_free(extent_node_slab, en);
+}
+
+/* forget whatever is cached for [fofs, fofs + len) */
+static void __drop_extent_range(struct f2fs_sb_info *sbi,
+		struct f2fs_inode_info *fi, unsigned int fofs, unsigned int len)
+{
+	unsigned int end = fofs + len;
+	struct extent_node *en, *next;
+
+	en = __lookup_next_extent_node(fi, fofs);
+	while (en && en->fofs < end) {
+		unsigned int en_end = en->fofs + en->len;
+		struct rb_node *node = rb_next(&en->rb_node);
+
+		next = node ? rb_entry(node, struct extent_node, rb_node) :
+									NULL;
+
+		if (en->fofs < fofs && en_end > end) {
+			/* split it, keeping the tail if we get the memory */
+			struct extent_node *tail;
+
+			tail = kmem_cache_alloc(extent_node_slab, GFP_ATOMIC);
+			if (tail) {
+				tail->fofs = end;
+				tail->blk_addr = en->blk_addr + end - en->fofs;
+				tail->len = en_end - end;
+			}
+			en->len = fofs - en->fofs;
+			if (tail)
+				__link_extent_node(sbi, fi, tail);
+			break;
+		} else if (en->fofs < fofs) {
+			en->len = fofs - en->fofs;
+		} else if (en_end > end) {
+			en->blk_addr += end - en->fofs;
+			en->len = en_end - end;
+			en->fofs = end;
+		} else {
+			__detach_extent_node(sbi, fi, en);
+		}
+		en = next;
+	}
+}
+
+/* cache [fofs, fofs + len) at blk_addr, which must not overlap the tree */
+static void __add_extent_range(struct f2fs_sb_info *sbi,
+		struct f2fs_inode_info *fi, unsigned int fofs,
+		block_t blk_addr, unsigned int len)
+{
+	struct extent_node *prev = NULL, *next, *en;
+
+	if (fofs)
+		prev = __lookup_extent_node(fi, fofs - 1);
+	next = __lookup_extent_node(fi, fofs + len);
+
+	if (prev && prev->blk_addr + prev->len == blk_addr) {
+		prev->len += len;
+		en = prev;
+		if (next && en->blk_addr + en->len == next->blk_addr) {
+			en->len += next->len;
+			__detach_extent_node(sbi, fi, next);
+		}
+	} else if (next && blk_addr + len == next->blk_addr) {
+		next->fofs = fofs;
+		next->blk_addr = blk_addr;
+		next->len += len;
+		en = next;
+	} else {
+		en = kmem_cache_alloc(extent_node_slab, GFP_ATOMIC);
+		if (!en)
+			return;
+		en->fofs = fofs;
+		en->blk_addr = blk_addr;
+		en->len = len;
+		__link_extent_node(sbi, fi, en);
+	}
+	fi->cached_en = en;
+}
+
+void f2fs_init_extent_tree(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	rwlock_init(&fi->ext_tree_lock);
+	fi->ext_tree = RB_ROOT;
+	fi->cached_en = NULL;
+}
+
+bool f2fs_lookup_extent_tree(struct inode *inode, pgoff_t pgofs,
+		unsigned int *fofs, block_t *blk_addr, unsigned int *len)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct extent_node *en;
+
+	read_lock(&fi->ext_tree_lock);
+	en = fi->cached_en;
+	if (!en || pgofs < en->fofs || pgofs >= en->fofs + en->len)
+		en = __lookup_extent_node(fi, pgofs);
+	if (en) {
+		*fofs = en->fofs;
+		*blk_addr = en->blk_addr;
+		*len = en->len;
+		fi->cached_en = en;
+
+		spin_lock(&sbi->extent_lock);
+		list_move_tail(&en->list, &sbi->extent_list);
+		spin_unlock(&sbi->extent_lock);
+	}
+	read_unlock(&fi->ext_tree_lock);
+
+	return en != NULL;
+}
+
+/*
+ * Called by the read path with a run of contiguous blocks it just found,
+ * while it still holds the dnode mapping them.
+ */
+void f2fs_insert_extent_tree(struct inode *inode, pgoff_t fofs,
+				block_t blk_addr, unsigned int len)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	if (!S_ISREG(inode->i_mode))
+		return;
+
+	write_lock(&fi->ext_tree_lock);
+	__drop_extent_range(sbi, fi, fofs, len);
+	__add_extent_range(sbi, fi, fofs, blk_addr, len);
+	write_unlock(&fi->ext_tree_lock);
+}
+
+/* block fofs was just moved to blk_addr, or truncated with NULL_ADDR */
+void f2fs_update_extent_tree(struct inode *inode, pgoff_t fofs,
+							block_t blk_addr)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	if (!S_ISREG(inode->i_mode))
+		return;
+
+	write_lock(&fi->ext_tree_lock);
+	__drop_extent_range(sbi, fi, fofs, 1);
+	if (blk_addr != NULL_ADDR && blk_addr != NEW_ADDR)
+		__add_extent_range(sbi, fi, fofs, blk_addr, 1);
+	write_unlock(&fi->ext_tree_lock);
+}
+
+void f2fs_destroy_extent_tree(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct rb_node *node;
+
+	write_lock(&fi->ext_tree_lock);
+	while ((node = rb_first(&fi->ext_tree)))
+		__detach_extent_node(sbi, fi,
+				rb_entry(node, struct extent_node, rb_node));
+	write_unlock(&fi->ext_tree_lock);
+}
+
+/*
+ * The tree locks nest outside extent_lock, so only try them from here.  A
+ * node still on the list means its inode has not been torn down yet.
+ */
+static int f2fs_shrink_extent_cache(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	struct f2fs_sb_info *sbi = container_of(shrink, struct f2fs_sb_info,
+							extent_shrinker);
+	int nr = sc->nr_to_scan;
+
+	spin_lock(&sbi->extent_lock);
+	while (nr-- > 0 && !list_empty(&sbi->extent_list)) {
+		struct extent_node *en = list_first_entry(&sbi->extent_list,
+						struct extent_node, list);
+		struct f2fs_inode_info *fi = en->fi;
+
+		if (!write_trylock(&fi->ext_tree_lock)) {
+			list_move_tail(&en->list, &sbi->extent_list);
+			continue;
+		}
+		rb_erase(&en->rb_node, &fi->ext_tree);
+		if (fi->cached_en == en)
+			fi->cached_en = NULL;
+		list_del(&en->list);
+		sbi->total_ext_node--;
+		write_unlock(&fi->ext_tree_lock);
+
+		kmem_cache_free(extent_node_slab, en);
+	}
+	nr = sbi->total_ext_node;
+	spin_unlock(&sbi->extent_lock);
+
+	return nr;
+}
+
+void f2fs_register_extent_shrinker(struct f2fs_sb_info *sbi)
+{
+	sbi->extent_shrinker.shrink = f2fs_shrink_extent_cache;
+	sbi->extent_shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&sbi->extent_shrinker);
+}
+
+void f2fs_unregister_extent_shrinker(struct f2fs_sb_info *sbi)
+{
+	unregister_shrinker(&sbi->extent_shrinker);
+}
+
+int __init create_extent_cache(void)
+{
+	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
+			sizeof(struct extent_node));
+	if (!extent_node_slab)
+		return -ENOMEM;
+	return 0;
+}
+
+void destroy_extent_cache(void)
+{
+	kmem_cache_destroy(extent_node_slab);
+}
@@ -61,20 +61,10 @@ struct f2fs_mount_info {
 	unsigned int	opt;
 };
 
-#define CRCPOLY_LE 0xedb88320
-
+/* the same crc as the bit at a time loop this used to be, table driven */
 static inline __u32 f2fs_crc32(void *buf, size_t len)
 {
-	unsigned char *p = (unsigned char *)buf;
-	__u32 crc = F2FS_SUPER_MAGIC;
-	int i;
-
-	while (len--) {
-		crc ^= *p++;
-		for (i = 0; i < 8; i++)
-			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
-	}
-	return crc;
+	return crc32_le(F2FS_SUPER_MAGIC, buf, len);
 }
 
 static inline bool f2fs_crc_valid(__u32 blk_crc, void *buf, size_t buf_size)
@@ -119,6 +109,15 @@ struct discard_entry {
 	int len;		/* # of consecutive blocks of the discard */
 };
 
+/* for the queue of discards issued in the background */
+struct discard_cmd {
+	struct list_head list;	/* list head */
+	struct f2fs_sb_info *sbi;	/* owner, for the bio completion */
+	block_t lstart;		/* start block address of the discard */
+	block_t len;		/* # of consecutive blocks of the discard */
+	int bio_ref;		/* # of bios in flight, 0 while still queued */
+};
+
 /* for the list of fsync inodes, used only during recovery */
 struct fsync_inode_entry {
 	struct list_head list;	/* list head */
@@ -195,6 +194,16 @@ struct extent_info {
 	unsigned int len;	/* length of the extent */
 };
 
+/* for the per-inode tree of cached extents */
+struct extent_node {
+	struct rb_node rb_node;		/* rb node located in the tree */
+	struct list_head list;		/* node in the global lru list */
+	struct f2fs_inode_info *fi;	/* inode owning the tree */
+	unsigned int fofs;		/* start offset in a file */
+	u32 blk_addr;			/* start block address of the extent */
+	unsigned int len;		/* length of the extent */
+};
+
 /*
  * i_advise uses FADVISE_XXX_BIT. We can add additional hints later.
  */
@@ -203,6 +212,10 @@ struct extent_info {
 
 #define DEF_DIR_LEVEL		0
 
+/* inodes rewritten this often per decay period go to the hot data log */
+#define DEF_HOT_UPDATE_THRESHOLD	16
+#define HOT_UPDATE_DECAY		(30 * HZ)
+
 struct f2fs_inode_info {
 	struct inode vfs_inode;		/* serve a vfs inode */
 	unsigned long i_flags;		/* keep an inode flags for ioctl */
@@ -221,7 +234,12 @@ struct f2fs_inode_info {
 	nid_t i_xattr_nid;		/* node id that contains xattrs */
 	unsigned long long xattr_ver;	/* cp version of xattr modification */
 	struct extent_info ext;		/* in-memory extent cache entry */
+	rwlock_t ext_tree_lock;		/* for the extent tree below */
+	struct rb_root ext_tree;	/* cached extents, by file offset */
+	struct extent_node *cached_en;	/* the last extent looked up */
 	struct dir_inode_entry *dirty_dir;	/* the pointer of dirty dir */
+	unsigned int i_update_count;	/* decayed # of data block updates */
+	unsigned long i_update_stamp;	/* last decay of i_update_count */
 };
 
 static inline void get_extent_info(struct extent_info *ext,
@@ -353,6 +371,24 @@ struct f2fs_sm_info {
 	int nr_discards;			/* # of discards in the list */
 	int max_discards;			/* max. discards to be issued */
 
+	/* for discard command control */
+	struct task_struct *f2fs_issue_discard;	/* discard thread */
+	wait_queue_head_t discard_wait_queue;	/* waiting queue for wake-up */
+	wait_queue_head_t discard_done_queue;	/* waiting for issued discards */
+	spinlock_t discard_lock;		/* for the two lists below */
+	struct list_head discard_pend_list;	/* queued, sorted by address */
+	struct list_head discard_issue_list;	/* under discard */
+	bool discard_wake;			/* new commands were queued */
+	unsigned int nr_discard_cmds;		/* # of queued commands */
+	unsigned int nr_discard_blks;		/* # of queued blocks */
+	unsigned int nr_discard_bios;		/* # of discard bios in flight */
+	unsigned int max_discard_requests;	/* max. discard bios in flight */
+	unsigned int discard_idle_time;		/* device idle time to issue */
+	unsigned int issued_discard;		/* # of issued commands */
+	unsigned int merged_discard;		/* # of merged ranges */
+	unsigned long discard_bios;		/* # of discard bios submitted */
+	unsigned long discard_last_ios;		/* device ios at the last check */
+
 	unsigned int ipu_policy;	/* in-place-update policy */
 	unsigned int min_ipu_util;	/* in-place-update threshold */
 
@@ -363,6 +399,8 @@ struct f2fs_sm_info {
 	struct flush_cmd *dispatch_list;	/* list for command dispatch */
 	spinlock_t issue_lock;			/* for issue list lock */
 	struct flush_cmd *issue_tail;		/* list tail of issue list */
+	unsigned int issued_flush;		/* # of issued flushes */
+	unsigned int merged_flush;		/* # of flushes saved by merging */
 };
 
 /*
@@ -455,6 +493,12 @@ struct f2fs_sb_info {
 	struct list_head dir_inode_list;	/* dir inode list */
 	spinlock_t dir_inode_lock;		/* for dir inode list lock */
 
+	/* for extent tree cache */
+	struct list_head extent_list;		/* lru list of extent nodes */
+	spinlock_t extent_lock;			/* for extent_list and count */
+	unsigned int total_ext_node;		/* # of cached extent nodes */
+	struct shrinker extent_shrinker;	/* frees extent nodes */
+
 	/* basic file system units */
 	unsigned int log_sectors_per_block;	/* log2 sectors per block */
 	unsigned int log_blocksize;		/* log2 block size */
@@ -482,6 +526,11 @@ struct f2fs_sb_info {
 
 	struct f2fs_mount_info mount_opt;	/* mount options */
 
+	/* for hot/cold data separation */
+	__u8 cold_ext[F2FS_MAX_EXTENSION][8];	/* cold_ext= mount option */
+	int cold_ext_count;			/* # of cold_ext entries */
+	unsigned int hot_update_threshold;	/* updates for hot data */
+
 	/* for cleaning operations */
 	struct mutex gc_mutex;			/* mutex for GC */
 	struct f2fs_gc_kthread	*gc_thread;	/* GC thread */
@@ -1245,6 +1294,21 @@ struct page *get_new_data_page(struct inode *, struct page *, pgoff_t, bool);
 int do_write_data_page(struct page *, struct f2fs_io_info *);
 int f2fs_fiemap(struct inode *inode, struct fiemap_extent_info *, u64, u64);
 
+/*
+ * extent_cache.c
+ */
+void f2fs_init_extent_tree(struct inode *);
+bool f2fs_lookup_extent_tree(struct inode *, pgoff_t, unsigned int *,
+					block_t *, unsigned int *);
+void f2fs_insert_extent_tree(struct inode *, pgoff_t, block_t,
+					unsigned int);
+void f2fs_update_extent_tree(struct inode *, pgoff_t, block_t);
+void f2fs_destroy_extent_tree(struct inode *);
+void f2fs_register_extent_shrinker(struct f2fs_sb_info *);
+void f2fs_unregister_extent_shrinker(struct f2fs_sb_info *);
+int __init create_extent_cache(void);
+void destroy_extent_cache(void);
+
 /*
  * gc.c
  */
@@ -1277,6 +1341,10 @@ struct f2fs_stat_info {
 	int nats, sits, fnids;
 	int total_count, utilization;
 	int bg_gc, inline_inode;
+	unsigned int ext_node;
+	unsigned int ndiscard_cmds, ndiscard_blks, ndiscard_bios;
+	unsigned int issued_discard, merged_discard;
+	unsigned int issued_flush, merged_flush;
 	unsigned int valid_count, valid_node_count, valid_inode_count;
 	unsigned int bimodal, avg_vblocks;
 	int util_free, util_valid, util_invalid;
@@ -17,6 +17,7 @@
 #include <linux/delay.h>
 #include <linux/freezer.h>
 #include <linux/blkdev.h>
+#include <linux/ioprio.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -32,6 +33,7 @@ static int gc_thread_func(void *data)
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	wait_queue_head_t *wq = &sbi->gc_thread->gc_wait_queue_head;
 	long wait_ms;
+	bool urgent;
 
 	wait_ms = gc_th->min_sleep_time;
 
@@ -40,40 +42,51 @@ static int gc_thread_func(void *data)
 			continue;
 		else
 			wait_event_interruptible_timeout(*wq,
-						kthread_should_stop(),
-						msecs_to_jiffies(wait_ms));
+					kthread_should_stop() || gc_th->gc_wake,
+					msecs_to_jiffies(wait_ms));
 		if (kthread_should_stop())
 			break;
+		gc_th->gc_wake = false;
 
 		/*
 		 * [GC triggering condition]
 		 * 0. GC is not conducted currently.
 		 * 1. There are enough dirty segments.
-		 * 2. IO subsystem is idle by checking the # of writeback pages.
-		 * 3. IO subsystem is idle by checking the # of requests in
-		 *    bdev's request list.
+		 * 2. The device has had no requests in flight and completed
+		 *    none for idle_time, or, when foreground GC is near, has
+		 *    none in flight right now.
 		 *
 		 * Note) We have to avoid triggering GCs too much frequently.
 		 * Because it is possible that some segments can be
 		 * invalidated soon after by user update or deletion.
 		 * So, I'd like to wait some time to collect dirty segments.
+		 * The closer free space gets to foreground GC, which stalls
+		 * whoever is writing in f2fs_balance_fs(), the less we wait.
 		 */
 		if (!mutex_trylock(&sbi->gc_mutex))
 			continue;
 
-		if (!is_idle(sbi)) {
-			wait_ms = increase_sleep_time(gc_th, wait_ms);
+		urgent = gc_urgent(sbi);
+		if (!is_idle(sbi, urgent ? 0 : gc_th->idle_time)) {
+			wait_ms = urgent ? gc_th->urgent_sleep_time :
+						gc_th->idle_time;
 			mutex_unlock(&sbi->gc_mutex);
 			continue;
 		}
 
-		if (has_enough_invalid_blocks(sbi))
-			wait_ms = decrease_sleep_time(gc_th, wait_ms);
+		if (urgent)
+			wait_ms = gc_th->urgent_sleep_time;
+		else if (has_enough_invalid_blocks(sbi))
+			wait_ms = scaled_sleep_time(gc_th, gc_pressure(sbi));
 		else
 			wait_ms = increase_sleep_time(gc_th, wait_ms);
 
 		stat_inc_bggc_count(sbi);
 
+		/* stay out of the way of foreground I/O unless it needs us */
+		set_task_ioprio(current, urgent ? GC_URGENT_IOPRIO :
+							GC_IDLE_IOPRIO);
+
 		/* if return value is not zero, no victim was selected */
 		if (f2fs_gc(sbi))
 			wait_ms = gc_th->no_gc_sleep_time;
@@ -102,9 +115,15 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->min_sleep_time = DEF_GC_THREAD_MIN_SLEEP_TIME;
 	gc_th->max_sleep_time = DEF_GC_THREAD_MAX_SLEEP_TIME;
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
+	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
 
 	gc_th->gc_idle = 0;
 
+	gc_th->idle_time = DEF_GC_THREAD_IDLE_TIME;
+	gc_th->idle_since = jiffies;
+	gc_th->last_ios = 0;
+	gc_th->gc_wake = false;
+
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
 	sbi->gc_thread->f2fs_gc_task = kthread_run(gc_thread_func, sbi,
@@ -520,20 +539,24 @@ static void move_data_page(struct inode *inode, struct page *page, int gc_type)
 		.rw = WRITE_SYNC,
 	};
 
+	/*
+	 * Background GC writes the page itself rather than leaving it to
+	 * the flusher, so that the write goes out at the GC thread's idle
+	 * priority.
+	 */
 	if (gc_type == BG_GC) {
 		if (PageWriteback(page))
 			goto out;
-		set_page_dirty(page);
-		set_cold_data(page);
+		fio.rw = WRITE;
 	} else {
 		f2fs_wait_on_page_writeback(page, DATA);
-
-		if (clear_page_dirty_for_io(page))
-			inode_dec_dirty_dents(inode);
-		set_cold_data(page);
-		do_write_data_page(page, &fio);
-		clear_cold_data(page);
 	}
+
+	if (clear_page_dirty_for_io(page))
+		inode_dec_dirty_dents(inode);
+	set_cold_data(page);
+	do_write_data_page(page, &fio);
+	clear_cold_data(page);
 out:
 	f2fs_put_page(page, 1);
 }
@@ -624,9 +647,9 @@ next_iput:
 	if (++phase < 4)
 		goto next_step;
 
-	if (gc_type == FG_GC) {
-		f2fs_submit_merged_bio(sbi, DATA, WRITE);
+	f2fs_submit_merged_bio(sbi, DATA, WRITE);
 
+	if (gc_type == FG_GC) {
 		/*
 		 * In the case of FG_GC, it'd be better to reclaim this victim
 		 * completely.
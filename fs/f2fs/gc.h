@@ -16,6 +16,12 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	500	/* foreground GC is near */
+#define DEF_GC_THREAD_IDLE_TIME		2000	/* device idle before bg GC */
+
+/* I/O priority of background GC, and of it when foreground GC is near */
+#define GC_IDLE_IOPRIO		IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0)
+#define GC_URGENT_IOPRIO	IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, IOPRIO_NORM)
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -30,9 +36,18 @@ struct f2fs_gc_kthread {
 	unsigned int min_sleep_time;
 	unsigned int max_sleep_time;
 	unsigned int no_gc_sleep_time;
+	unsigned int urgent_sleep_time;
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
+
+	/* for waiting on an idle device */
+	unsigned int idle_time;
+	unsigned long idle_since;
+	unsigned long last_ios;
+
+	/* woken up by f2fs_balance_fs() */
+	bool gc_wake;
 };
 
 struct inode_entry {
@@ -75,15 +90,29 @@ static inline long increase_sleep_time(struct f2fs_gc_kthread *gc_th, long wait)
 	return wait;
 }
 
-static inline long decrease_sleep_time(struct f2fs_gc_kthread *gc_th, long wait)
+/*
+ * How far free space has fallen below where background GC starts, in
+ * percent of that limit.
+ */
+static inline unsigned int gc_pressure(struct f2fs_sb_info *sbi)
 {
-	if (wait == gc_th->no_gc_sleep_time)
-		wait = gc_th->max_sleep_time;
+	block_t limit = limit_free_user_blocks(sbi);
+	block_t free = free_user_blocks(sbi);
 
-	wait -= gc_th->min_sleep_time;
-	if (wait <= gc_th->min_sleep_time)
-		wait = gc_th->min_sleep_time;
-	return wait;
+	if (!limit || free >= limit)
+		return 0;
+	return div_u64((u64)(limit - free) * 100, limit);
+}
+
+/* from max_sleep_time down to min_sleep_time as the pressure grows */
+static inline long scaled_sleep_time(struct f2fs_gc_kthread *gc_th,
+						unsigned int pressure)
+{
+	long range = (long)gc_th->max_sleep_time - gc_th->min_sleep_time;
+
+	if (range <= 0)
+		return gc_th->min_sleep_time;
+	return gc_th->max_sleep_time - range * pressure / 100;
 }
 
 static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
@@ -101,10 +130,30 @@ static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
 	return false;
 }
 
-static inline int is_idle(struct f2fs_sb_info *sbi)
+/*
+ * The device is idle when it has no requests allocated or in flight, and
+ * has completed none, on any of its partitions, for @idle_ms.
+ */
+static inline bool is_idle(struct f2fs_sb_info *sbi, unsigned int idle_ms)
 {
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	struct block_device *bdev = sbi->sb->s_bdev;
 	struct request_queue *q = bdev_get_queue(bdev);
 	struct request_list *rl = &q->rq;
-	return !(rl->count[BLK_RW_SYNC]) && !(rl->count[BLK_RW_ASYNC]);
+	struct hd_struct *part = &bdev->bd_disk->part0;
+	unsigned long ios;
+	bool busy;
+
+	busy = rl->count[BLK_RW_SYNC] || rl->count[BLK_RW_ASYNC] ||
+		queue_in_flight(q);
+	ios = part_stat_read(part, ios[READ]) + part_stat_read(part, ios[WRITE]);
+
+	if (busy || ios != gc_th->last_ios) {
+		gc_th->last_ios = ios;
+		gc_th->idle_since = jiffies;
+	}
+	if (busy)
+		return false;
+	return time_after_eq(jiffies,
+			gc_th->idle_since + msecs_to_jiffies(idle_ms));
 }
@@ -91,7 +91,8 @@ static int is_multimedia_file(const unsigned char *s, const char *sub)
 }
 
 /*
- * Set multimedia files as cold files for hot/cold data separation
+ * Set multimedia files as cold files for hot/cold data separation, by
+ * the extensions recorded at mkfs time and those given with cold_ext=
  */
 static inline void set_cold_files(struct f2fs_sb_info *sbi, struct inode *inode,
 		const unsigned char *name)
@@ -103,7 +104,14 @@ static inline void set_cold_files(struct f2fs_sb_info *sbi, struct inode *inode,
 	for (i = 0; i < count; i++) {
 		if (is_multimedia_file(name, extlist[i])) {
 			file_set_cold(inode);
-			break;
+			return;
+		}
+	}
+
+	for (i = 0; i < sbi->cold_ext_count; i++) {
+		if (is_multimedia_file(name, sbi->cold_ext[i])) {
+			file_set_cold(inode);
+			return;
 		}
 	}
 }
@@ -309,6 +309,14 @@ static inline void clear_file(struct inode *inode, int type)
 #define file_clear_cold(inode)	clear_file(inode, FADVISE_COLD_BIT)
 #define file_got_pino(inode)	clear_file(inode, FADVISE_LOST_PINO_BIT)
 
+/* rewritten often enough lately to be kept in the hot data log */
+static inline int file_is_hot(struct inode *inode)
+{
+	unsigned int threshold = F2FS_SB(inode->i_sb)->hot_update_threshold;
+
+	return threshold && F2FS_I(inode)->i_update_count >= threshold;
+}
+
 static inline int is_cold_data(struct page *page)
 {
 	return PageChecked(page);
@@ -19,12 +19,14 @@
 
 #include "f2fs.h"
 #include "segment.h"
+#include "gc.h"
 #include "node.h"
 #include <trace/events/f2fs.h>
 
 #define __reverse_ffz(x) __reverse_ffs(~(x))
 
 static struct kmem_cache *discard_entry_slab;
+static struct kmem_cache *discard_cmd_slab;
 static struct kmem_cache *flush_cmd_slab;
 
 /*
@@ -186,6 +188,11 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi)
 	if (has_not_enough_free_secs(sbi, 0)) {
 		mutex_lock(&sbi->gc_mutex);
 		f2fs_gc(sbi);
+	} else if (sbi->gc_thread && !sbi->gc_thread->gc_wake &&
+							gc_urgent(sbi)) {
+		/* let background GC catch up before we get there */
+		sbi->gc_thread->gc_wake = true;
+		wake_up_interruptible_all(&sbi->gc_thread->gc_wait_queue_head);
 	}
 }
 
@@ -237,9 +244,14 @@ repeat:
 	}
 	spin_unlock(&sm_i->issue_lock);
 
+	/*
+	 * Everyone queued while the previous flush was in flight shares
+	 * this one, like a group commit.
+	 */
 	if (sm_i->dispatch_list) {
 		struct bio *bio = bio_alloc(GFP_NOIO, 0);
 		struct flush_cmd *cmd, *next;
+		unsigned int waiters = 0;
 		int ret;
 
 		bio->bi_bdev = sbi->sb->s_bdev;
@@ -249,9 +261,12 @@ repeat:
 			cmd->ret = ret;
 			next = cmd->next;
 			complete(&cmd->wait);
+			waiters++;
 		}
 		bio_put(bio);
 		sm_i->dispatch_list = NULL;
+		sm_i->issued_flush++;
+		sm_i->merged_flush += waiters - 1;
 	}
 
 	if (kthread_should_stop())
@@ -270,7 +285,7 @@ int f2fs_issue_flush(struct f2fs_sb_info *sbi)
 	if (test_opt(sbi, NOBARRIER))
 		return 0;
 
-	if (!test_opt(sbi, FLUSH_MERGE))
+	if (!test_opt(sbi, FLUSH_MERGE) || !sm_i->f2fs_issue_flush)
 		return blkdev_issue_flush(sbi->sb->s_bdev, GFP_KERNEL, NULL);
 
 	cmd = f2fs_kmem_cache_alloc(flush_cmd_slab, GFP_ATOMIC);
@@ -376,6 +391,298 @@ static void f2fs_issue_discard(struct f2fs_sb_info *sbi,
 	trace_f2fs_issue_discard(sbi->sb, blkstart, blklen);
 }
 
+/*
+ * Discards are queued as ranges sorted by address, merging adjacent ones,
+ * and the discard thread issues them once the device has gone idle, so a
+ * checkpoint does not wait for them.  Without the thread they are issued
+ * right away as before.
+ */
+static void f2fs_queue_discard(struct f2fs_sb_info *sbi,
+				block_t blkstart, block_t blklen)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct list_head *head = &sm_i->discard_pend_list;
+	struct discard_cmd *cmd, *next, *new;
+	block_t blkend = blkstart + blklen;
+
+	if (!sm_i->f2fs_issue_discard) {
+		f2fs_issue_discard(sbi, blkstart, blklen);
+		return;
+	}
+
+	new = f2fs_kmem_cache_alloc(discard_cmd_slab, GFP_NOFS);
+
+	spin_lock_irq(&sm_i->discard_lock);
+	list_for_each_entry(cmd, head, list) {
+		if (cmd->lstart + cmd->len < blkstart)
+			continue;
+		if (cmd->lstart > blkend)
+			break;
+
+		/* adjacent or overlapping, so grow this one */
+		sm_i->nr_discard_blks -= cmd->len;
+		blkend = max(blkend, cmd->lstart + cmd->len);
+		cmd->lstart = min(blkstart, cmd->lstart);
+		cmd->len = blkend - cmd->lstart;
+		sm_i->merged_discard++;
+
+		/* which may now reach the following ones */
+		while (cmd->list.next != head) {
+			next = list_entry(cmd->list.next,
+					struct discard_cmd, list);
+			if (next->lstart > blkend)
+				break;
+			blkend = max(blkend, next->lstart + next->len);
+			cmd->len = blkend - cmd->lstart;
+			sm_i->nr_discard_blks -= next->len;
+			sm_i->nr_discard_cmds--;
+			sm_i->merged_discard++;
+			list_del(&next->list);
+			kmem_cache_free(discard_cmd_slab, next);
+		}
+		sm_i->nr_discard_blks += cmd->len;
+		goto out;
+	}
+
+	new->sbi = sbi;
+	new->lstart = blkstart;
+	new->len = blklen;
+	new->bio_ref = 0;
+	/* before the first one past it, or at the tail */
+	list_add_tail(&new->list, &cmd->list);
+	sm_i->nr_discard_cmds++;
+	sm_i->nr_discard_blks += blklen;
+	new = NULL;
+out:
+	spin_unlock_irq(&sm_i->discard_lock);
+	if (new)
+		kmem_cache_free(discard_cmd_slab, new);
+}
+
+static bool __discard_issued(struct f2fs_sm_info *sm_i,
+				block_t blkstart, block_t blkend)
+{
+	struct discard_cmd *cmd;
+
+	list_for_each_entry(cmd, &sm_i->discard_issue_list, list)
+		if (cmd->lstart < blkend && cmd->lstart + cmd->len > blkstart)
+			return true;
+	return false;
+}
+
+static bool discard_issued(struct f2fs_sm_info *sm_i,
+				block_t blkstart, block_t blkend)
+{
+	bool ret;
+
+	spin_lock_irq(&sm_i->discard_lock);
+	ret = __discard_issued(sm_i, blkstart, blkend);
+	spin_unlock_irq(&sm_i->discard_lock);
+	return ret;
+}
+
+/*
+ * Blocks are about to be written again: drop them from the queued discards
+ * and wait for the ones already under discard.
+ */
+static void f2fs_wait_discard(struct f2fs_sb_info *sbi,
+				block_t blkstart, block_t blklen)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct discard_cmd *cmd, *next, *new;
+	block_t blkend = blkstart + blklen;
+	bool issued;
+
+	if (!sm_i->f2fs_issue_discard)
+		return;
+
+	spin_lock_irq(&sm_i->discard_lock);
+	list_for_each_entry_safe(cmd, next, &sm_i->discard_pend_list, list) {
+		block_t cmd_end = cmd->lstart + cmd->len;
+
+		if (cmd_end <= blkstart)
+			continue;
+		if (cmd->lstart >= blkend)
+			break;
+
+		sm_i->nr_discard_blks -= cmd->len;
+		if (cmd->lstart < blkstart && cmd_end > blkend) {
+			/* keep the tail queued too, if we can */
+			new = kmem_cache_alloc(discard_cmd_slab, GFP_ATOMIC);
+			if (new) {
+				new->sbi = sbi;
+				new->lstart = blkend;
+				new->len = cmd_end - blkend;
+				new->bio_ref = 0;
+				list_add(&new->list, &cmd->list);
+				sm_i->nr_discard_cmds++;
+				sm_i->nr_discard_blks += new->len;
+			}
+			cmd->len = blkstart - cmd->lstart;
+		} else if (cmd->lstart < blkstart) {
+			cmd->len = blkstart - cmd->lstart;
+		} else if (cmd_end > blkend) {
+			cmd->lstart = blkend;
+			cmd->len = cmd_end - blkend;
+		} else {
+			list_del(&cmd->list);
+			sm_i->nr_discard_cmds--;
+			kmem_cache_free(discard_cmd_slab, cmd);
+			continue;
+		}
+		sm_i->nr_discard_blks += cmd->len;
+	}
+	issued = __discard_issued(sm_i, blkstart, blkend);
+	spin_unlock_irq(&sm_i->discard_lock);
+
+	if (issued)
+		wait_event(sm_i->discard_done_queue,
+			!discard_issued(sm_i, blkstart, blkend));
+}
+
+static void f2fs_discard_end_io(struct bio *bio, int err)
+{
+	struct discard_cmd *cmd = bio->bi_private;
+	struct f2fs_sm_info *sm_i = SM_I(cmd->sbi);
+	unsigned long flags;
+
+	/* waiters check under the lock, so sm_i stays valid until we drop it */
+	spin_lock_irqsave(&sm_i->discard_lock, flags);
+	sm_i->nr_discard_bios--;
+	if (!--cmd->bio_ref) {
+		list_del(&cmd->list);
+		kmem_cache_free(discard_cmd_slab, cmd);
+	}
+	sm_i->discard_wake = true;
+	wake_up(&sm_i->discard_done_queue);
+	wake_up_interruptible(&sm_i->discard_wait_queue);
+	spin_unlock_irqrestore(&sm_i->discard_lock, flags);
+
+	bio_put(bio);
+}
+
+/* issue queued discards, up to max_discard_requests bios in flight */
+static void submit_discard_cmds(struct f2fs_sb_info *sbi, bool all)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct block_device *bdev = sbi->sb->s_bdev;
+	struct request_queue *q = bdev_get_queue(bdev);
+	unsigned int max_sects;
+	block_t max_blks;
+
+	max_sects = min(q->limits.max_discard_sectors, UINT_MAX >> 9);
+	if (q->limits.discard_granularity)
+		max_sects &= ~((q->limits.discard_granularity >> 9) - 1);
+	max_blks = max_t(block_t, max_sects >> sbi->log_sectors_per_block, 1);
+
+	while (1) {
+		struct discard_cmd *cmd;
+		block_t blkstart, blklen;
+
+		spin_lock_irq(&sm_i->discard_lock);
+		if (list_empty(&sm_i->discard_pend_list) || (!all &&
+		    sm_i->nr_discard_bios >=
+				max(sm_i->max_discard_requests, 1U))) {
+			spin_unlock_irq(&sm_i->discard_lock);
+			break;
+		}
+		cmd = list_first_entry(&sm_i->discard_pend_list,
+					struct discard_cmd, list);
+		list_move_tail(&cmd->list, &sm_i->discard_issue_list);
+		cmd->bio_ref = DIV_ROUND_UP(cmd->len, max_blks);
+		sm_i->nr_discard_cmds--;
+		sm_i->nr_discard_blks -= cmd->len;
+		sm_i->nr_discard_bios += cmd->bio_ref;
+		sm_i->discard_bios += cmd->bio_ref;
+		sm_i->issued_discard++;
+		blkstart = cmd->lstart;
+		blklen = cmd->len;
+		spin_unlock_irq(&sm_i->discard_lock);
+
+		trace_f2fs_issue_discard(sbi->sb, blkstart, blklen);
+
+		/* cmd may be gone once its last bio completes */
+		while (blklen) {
+			block_t len = min(blklen, max_blks);
+			struct bio *bio = bio_alloc(GFP_NOFS, 1);
+
+			bio->bi_sector = SECTOR_FROM_BLOCK(sbi, blkstart);
+			bio->bi_size = len << sbi->log_blocksize;
+			bio->bi_bdev = bdev;
+			bio->bi_private = cmd;
+			bio->bi_end_io = f2fs_discard_end_io;
+			submit_bio(REQ_WRITE | REQ_DISCARD, bio);
+
+			blkstart += len;
+			blklen -= len;
+		}
+	}
+}
+
+static bool discard_bios_done(struct f2fs_sm_info *sm_i)
+{
+	bool ret;
+
+	spin_lock_irq(&sm_i->discard_lock);
+	ret = !sm_i->nr_discard_bios;
+	spin_unlock_irq(&sm_i->discard_lock);
+	return ret;
+}
+
+/*
+ * Nothing but our own discards was queued or completed on the device since
+ * the last check.
+ */
+static bool discard_device_idle(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct block_device *bdev = sbi->sb->s_bdev;
+	struct request_list *rl = &bdev_get_queue(bdev)->rq;
+	struct hd_struct *part = &bdev->bd_disk->part0;
+	unsigned int ours = sm_i->nr_discard_bios;
+	unsigned long ios;
+	bool idle;
+
+	ios = part_stat_read(part, ios[READ]) + part_stat_read(part, ios[WRITE]);
+	ios -= sm_i->discard_bios - ours;
+
+	idle = rl->count[BLK_RW_SYNC] + rl->count[BLK_RW_ASYNC] <= ours &&
+		ios == sm_i->discard_last_ios;
+	sm_i->discard_last_ios = ios;
+	return idle;
+}
+
+static int issue_discard_thread(void *data)
+{
+	struct f2fs_sb_info *sbi = data;
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	long wait = MAX_SCHEDULE_TIMEOUT;
+
+	do {
+		wait_event_interruptible_timeout(sm_i->discard_wait_queue,
+				kthread_should_stop() || sm_i->discard_wake,
+				wait);
+		sm_i->discard_wake = false;
+
+		if (kthread_should_stop())
+			break;
+
+		if (!sm_i->nr_discard_cmds) {
+			wait = MAX_SCHEDULE_TIMEOUT;
+			continue;
+		}
+
+		/* unless too much has piled up, wait for the device to idle */
+		wait = msecs_to_jiffies(sm_i->discard_idle_time);
+		if (sm_i->nr_discard_cmds < MAX_DISCARD_CMDS &&
+				!discard_device_idle(sbi))
+			continue;
+
+		submit_discard_cmds(sbi, false);
+	} while (!kthread_should_stop());
+	return 0;
+}
+
 static void add_discard_addrs(struct f2fs_sb_info *sbi,
 			unsigned int segno, struct seg_entry *se)
 {
@@ -392,6 +699,10 @@ static void add_discard_addrs(struct f2fs_sb_info *sbi,
 	if (!test_opt(sbi, DISCARD))
 		return;
 
+	/* SSR could reuse them before a queued discard went out */
+	if (SM_I(sbi)->f2fs_issue_discard && IS_CURSEG(sbi, segno))
+		return;
+
 	/* zero block will be discarded through the prefree list */
 	if (!se->valid_blocks || se->valid_blocks == max_blocks)
 		return;
@@ -439,6 +750,7 @@ static void set_prefree_as_free_segments(struct f2fs_sb_info *sbi)
 
 void clear_prefree_segments(struct f2fs_sb_info *sbi)
 {
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
 	struct list_head *head = &(SM_I(sbi)->discard_list);
 	struct discard_entry *entry, *this;
 	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
@@ -463,18 +775,23 @@ void clear_prefree_segments(struct f2fs_sb_info *sbi)
 		if (!test_opt(sbi, DISCARD))
 			continue;
 
-		f2fs_issue_discard(sbi, START_BLOCK(sbi, start),
+		f2fs_queue_discard(sbi, START_BLOCK(sbi, start),
 				(end - start) << sbi->log_blocks_per_seg);
 	}
 	mutex_unlock(&dirty_i->seglist_lock);
 
 	/* send small discards */
 	list_for_each_entry_safe(entry, this, head, list) {
-		f2fs_issue_discard(sbi, entry->blkaddr, entry->len);
+		f2fs_queue_discard(sbi, entry->blkaddr, entry->len);
 		list_del(&entry->list);
 		SM_I(sbi)->nr_discards -= entry->len;
 		kmem_cache_free(discard_entry_slab, entry);
 	}
+
+	if (sm_i->f2fs_issue_discard && sm_i->nr_discard_cmds) {
+		sm_i->discard_wake = true;
+		wake_up_interruptible(&sm_i->discard_wait_queue);
+	}
 }
 
 static void __mark_sit_entry_dirty(struct f2fs_sb_info *sbi, unsigned int segno)
@@ -738,6 +1055,9 @@ static void reset_curseg(struct f2fs_sb_info *sbi, int type, int modified)
 	if (IS_NODESEG(type))
 		SET_SUM_TYPE(sum_footer, SUM_TYPE_NODE);
 	__set_sit_entry_type(sbi, type, curseg->segno, modified);
+
+	f2fs_wait_discard(sbi, START_BLOCK(sbi, curseg->segno),
+						sbi->blocks_per_seg);
 }
 
 /*
@@ -910,6 +1230,9 @@ static int __get_segment_type_4(struct page *page, enum page_type p_type)
 
 		if (S_ISDIR(inode->i_mode))
 			return CURSEG_HOT_DATA;
+		else if (!is_cold_data(page) && !file_is_cold(inode) &&
+							file_is_hot(inode))
+			return CURSEG_HOT_DATA;
 		else
 			return CURSEG_COLD_DATA;
 	} else {
@@ -929,6 +1252,8 @@ static int __get_segment_type_6(struct page *page, enum page_type p_type)
 			return CURSEG_HOT_DATA;
 		else if (is_cold_data(page) || file_is_cold(inode))
 			return CURSEG_COLD_DATA;
+		else if (file_is_hot(inode))
+			return CURSEG_HOT_DATA;
 		else
 			return CURSEG_WARM_DATA;
 	} else {
@@ -1891,6 +2216,25 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 	sm_info->nr_discards = 0;
 	sm_info->max_discards = 0;
 
+	init_waitqueue_head(&sm_info->discard_wait_queue);
+	init_waitqueue_head(&sm_info->discard_done_queue);
+	spin_lock_init(&sm_info->discard_lock);
+	INIT_LIST_HEAD(&sm_info->discard_pend_list);
+	INIT_LIST_HEAD(&sm_info->discard_issue_list);
+	sm_info->max_discard_requests = DEF_MAX_DISCARD_REQUESTS;
+	sm_info->discard_idle_time = DEF_DISCARD_IDLE_TIME;
+
+	if (test_opt(sbi, DISCARD) && !f2fs_readonly(sbi->sb) &&
+			blk_queue_discard(bdev_get_queue(sbi->sb->s_bdev))) {
+		sm_info->f2fs_issue_discard = kthread_run(issue_discard_thread,
+				sbi, "f2fs_discard-%u:%u", MAJOR(dev), MINOR(dev));
+		if (IS_ERR(sm_info->f2fs_issue_discard)) {
+			err = PTR_ERR(sm_info->f2fs_issue_discard);
+			sm_info->f2fs_issue_discard = NULL;
+			return err;
+		}
+	}
+
 	if (test_opt(sbi, FLUSH_MERGE) && !f2fs_readonly(sbi->sb)) {
 		spin_lock_init(&sm_info->issue_lock);
 		init_waitqueue_head(&sm_info->flush_wait_queue);
@@ -2010,6 +2354,14 @@ void destroy_segment_manager(struct f2fs_sb_info *sbi)
 		return;
 	if (sm_info->f2fs_issue_flush)
 		kthread_stop(sm_info->f2fs_issue_flush);
+	if (sm_info->f2fs_issue_discard) {
+		kthread_stop(sm_info->f2fs_issue_discard);
+		sm_info->f2fs_issue_discard = NULL;
+		/* whatever is still queued goes out now */
+		submit_discard_cmds(sbi, true);
+		wait_event(sm_info->discard_done_queue,
+				discard_bios_done(sm_info));
+	}
 	destroy_dirty_segmap(sbi);
 	destroy_curseg(sbi);
 	destroy_free_segmap(sbi);
@@ -2024,17 +2376,26 @@ int __init create_segment_manager_caches(void)
 			sizeof(struct discard_entry));
 	if (!discard_entry_slab)
 		return -ENOMEM;
+	discard_cmd_slab = f2fs_kmem_cache_create("discard_cmd",
+			sizeof(struct discard_cmd));
+	if (!discard_cmd_slab)
+		goto free_discard_entry;
 	flush_cmd_slab = f2fs_kmem_cache_create("flush_command",
 			sizeof(struct flush_cmd));
-	if (!flush_cmd_slab) {
-		kmem_cache_destroy(discard_entry_slab);
-		return -ENOMEM;
-	}
+	if (!flush_cmd_slab)
+		goto free_discard_cmd;
 	return 0;
+
+free_discard_cmd:
+	kmem_cache_destroy(discard_cmd_slab);
+free_discard_entry:
+	kmem_cache_destroy(discard_entry_slab);
+	return -ENOMEM;
 }
 
 void destroy_segment_manager_caches(void)
 {
 	kmem_cache_destroy(discard_entry_slab);
+	kmem_cache_destroy(discard_cmd_slab);
 	kmem_cache_destroy(flush_cmd_slab);
 }
@@ -16,6 +16,11 @@
 
 #define DEF_RECLAIM_PREFREE_SEGMENTS	5	/* 5% over total segments */
 
+/* for the discard command queue */
+#define DEF_MAX_DISCARD_REQUESTS	8	/* discard bios in flight */
+#define DEF_DISCARD_IDLE_TIME		200	/* ms */
+#define MAX_DISCARD_CMDS		512	/* issued even when busy above */
+
 /* L: Logical segment # in volume, R: Relative segment # in main area */
 #define GET_L2R_SEGNO(free_i, segno)	(segno - free_i->start_segno)
 #define GET_R2L_SEGNO(free_i, segno)	(segno + free_i->start_segno)
@@ -446,6 +451,12 @@ static inline bool has_not_enough_free_secs(struct f2fs_sb_info *sbi, int freed)
 						reserved_sections(sbi));
 }
 
+/* foreground GC is within the reserved sections of kicking in */
+static inline bool gc_urgent(struct f2fs_sb_info *sbi)
+{
+	return has_not_enough_free_secs(sbi, reserved_sections(sbi));
+}
+
 static inline bool excess_prefree_segs(struct f2fs_sb_info *sbi)
 {
 	return prefree_segments(sbi) > SM_I(sbi)->rec_prefree_segments;
@@ -10,6 +10,8 @@
 
 #include <linux/init.h>
 #include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
 
 #define FUSE_CTL_SUPER_MAGIC 0x65735543
 
@@ -176,6 +178,66 @@ static ssize_t fuse_conn_congestion_threshold_write(struct file *file,
 	return ret;
 }
 
+/*
+ * One line per opcode that had replies: the opcode, the number of
+ * replies, and their average and maximum latency in microseconds from
+ * the request being queued.  Writing anything clears the counters.
+ */
+static ssize_t fuse_conn_latency_read(struct file *file, char __user *buf,
+				      size_t len, loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	char *page;
+	size_t size = 0;
+	ssize_t ret;
+	int i;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	page = (char *)__get_free_page(GFP_KERNEL);
+	if (!page) {
+		fuse_conn_put(fc);
+		return -ENOMEM;
+	}
+
+	spin_lock(&fc->lock);
+	for (i = 0; i < FUSE_STAT_OPCODES; i++) {
+		struct fuse_opcode_stat *stat = &fc->opstat[i];
+
+		if (!stat->count)
+			continue;
+		size += scnprintf(page + size, PAGE_SIZE - size,
+				  "%d %llu %llu %llu\n", i, stat->count,
+				  div_u64(div64_u64(stat->total_ns, stat->count),
+					  NSEC_PER_USEC),
+				  div_u64(stat->max_ns, NSEC_PER_USEC));
+	}
+	spin_unlock(&fc->lock);
+	fuse_conn_put(fc);
+
+	ret = simple_read_from_buffer(buf, len, ppos, page, size);
+	free_page((unsigned long)page);
+
+	return ret;
+}
+
+static ssize_t fuse_conn_latency_write(struct file *file,
+				       const char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	struct fuse_conn *fc = fuse_ctl_file_conn_get(file);
+
+	if (fc) {
+		spin_lock(&fc->lock);
+		memset(fc->opstat, 0, sizeof(fc->opstat));
+		spin_unlock(&fc->lock);
+		fuse_conn_put(fc);
+	}
+	return count;
+}
+
 static const struct file_operations fuse_ctl_abort_ops = {
 	.open = nonseekable_open,
 	.write = fuse_conn_abort_write,
@@ -202,6 +264,13 @@ static const struct file_operations fuse_conn_congestion_threshold_ops = {
 	.llseek = no_llseek,
 };
 
+static const struct file_operations fuse_conn_latency_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_latency_read,
+	.write = fuse_conn_latency_write,
+	.llseek = no_llseek,
+};
+
 static struct dentry *fuse_ctl_add_dentry(struct dentry *parent,
 					  struct fuse_conn *fc,
 					  const char *name,
@@ -266,7 +335,9 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "latency", S_IFREG | 0600, 1,
+				 NULL, &fuse_conn_latency_ops))
 		goto err;
 
 	return 0;
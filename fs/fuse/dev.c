@@ -209,6 +209,10 @@ void fuse_put_request(struct fuse_conn *fc, struct fuse_req *req)
 		if (req->waiting)
 			atomic_dec(&fc->num_waiting);
 
+		/* nobody took the lower file of an open reply */
+		if (req->passthrough_filp)
+			fput(req->passthrough_filp);
+
 		if (req->stolen_file)
 			put_reserved_req(fc, req);
 		else
@@ -238,20 +242,56 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 	return fc->reqctr;
 }
 
+static struct fuse_pqueue *fuse_cpu_pqueue(struct fuse_conn *fc, int cpu)
+{
+	return &fc->pqueue[cpu % FUSE_NR_QUEUES];
+}
+
+/*
+ * The request goes on the queue of the cpu it was queued from.  A reader
+ * bound to that cpu picks it up if one is waiting, so the request is
+ * handled where the caller's data is still in the cache; any other
+ * reader takes it otherwise.
+ */
 static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 {
+	struct fuse_pqueue *pq = fuse_cpu_pqueue(fc, smp_processor_id());
+
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
+	list_add_tail(&req->list, &pq->pending);
+	fc->nr_pending++;
 	req->state = FUSE_REQ_PENDING;
+	req->queue_ns = ktime_to_ns(ktime_get());
 	if (!req->waiting) {
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
+	if (waitqueue_active(&pq->waitq))
+		wake_up(&pq->waitq);
+	else
+		wake_up(&fc->waitq);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 }
 
+static void fuse_account_reply(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_opcode_stat *stat;
+	u64 delta;
+
+	if (!req->queue_ns || req->aborted ||
+	    req->out.h.error == -ECONNABORTED ||
+	    req->in.h.opcode >= FUSE_STAT_OPCODES)
+		return;
+
+	delta = ktime_to_ns(ktime_get()) - req->queue_ns;
+	stat = &fc->opstat[req->in.h.opcode];
+	stat->count++;
+	stat->total_ns += delta;
+	if (delta > stat->max_ns)
+		stat->max_ns = delta;
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -301,6 +341,10 @@ __releases(fc->lock)
 	req->end = NULL;
 	list_del(&req->list);
 	list_del(&req->intr_entry);
+	if (req->state == FUSE_REQ_PENDING)
+		fc->nr_pending--;
+	else
+		fuse_account_reply(fc, req);
 	req->state = FUSE_REQ_FINISHED;
 	if (req->background) {
 		if (fc->num_background == fc->max_background) {
@@ -377,6 +421,7 @@ __acquires(fc->lock)
 		/* Request is not yet in userspace, bail out */
 		if (req->state == FUSE_REQ_PENDING) {
 			list_del(&req->list);
+			fc->nr_pending--;
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
@@ -917,18 +962,55 @@ static int forget_pending(struct fuse_conn *fc)
 
 static int request_pending(struct fuse_conn *fc)
 {
-	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts) ||
+	return fc->nr_pending || !list_empty(&fc->interrupts) ||
 		forget_pending(fc);
 }
 
-/* Wait until a request is available on the pending list */
+/* A reader that may only run on one cpu serves that cpu's queue */
+static struct fuse_pqueue *fuse_bound_pqueue(struct fuse_conn *fc)
+{
+	if (cpumask_weight(&current->cpus_allowed) != 1)
+		return NULL;
+	return fuse_cpu_pqueue(fc, cpumask_first(&current->cpus_allowed));
+}
+
+/*
+ * Take the oldest request of the reader's own queue, or else of the
+ * first other queue that has one.  Called with fc->lock held and at
+ * least one request pending.
+ */
+static struct fuse_req *fuse_next_pending(struct fuse_conn *fc)
+{
+	int first = smp_processor_id() % FUSE_NR_QUEUES;
+	int i;
+
+	for (i = 0; i < FUSE_NR_QUEUES; i++) {
+		struct fuse_pqueue *pq =
+			&fc->pqueue[(first + i) % FUSE_NR_QUEUES];
+
+		if (!list_empty(&pq->pending))
+			return list_entry(pq->pending.next, struct fuse_req,
+					  list);
+	}
+	return NULL;
+}
+
+/*
+ * Wait until a request is available on the pending list.  Bound readers
+ * wait on their own queue too, so the requests queued from their cpu
+ * wake them rather than some other reader.
+ */
 static void request_wait(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	struct fuse_pqueue *pq = fuse_bound_pqueue(fc);
 	DECLARE_WAITQUEUE(wait, current);
+	DECLARE_WAITQUEUE(bound_wait, current);
 
 	add_wait_queue_exclusive(&fc->waitq, &wait);
+	if (pq)
+		add_wait_queue_exclusive(&pq->waitq, &bound_wait);
 	while (fc->connected && !request_pending(fc)) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (signal_pending(current))
@@ -939,6 +1021,8 @@ __acquires(fc->lock)
 		spin_lock(&fc->lock);
 	}
 	set_current_state(TASK_RUNNING);
+	if (pq)
+		remove_wait_queue(&pq->waitq, &bound_wait);
 	remove_wait_queue(&fc->waitq, &wait);
 }
 
@@ -1133,14 +1217,15 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	}
 
 	if (forget_pending(fc)) {
-		if (list_empty(&fc->pending) || fc->forget_batch-- > 0)
+		if (!fc->nr_pending || fc->forget_batch-- > 0)
 			return fuse_read_forget(fc, cs, nbytes);
 
 		if (fc->forget_batch <= -8)
 			fc->forget_batch = 16;
 	}
 
-	req = list_entry(fc->pending.next, struct fuse_req, list);
+	req = fuse_next_pending(fc);
+	fc->nr_pending--;
 	req->state = FUSE_REQ_READING;
 	list_move(&req->list, &fc->io);
 
@@ -1726,6 +1811,8 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 
 	err = copy_out_args(cs, &req->out, nbytes);
 	fuse_copy_finish(cs);
+	if (!err)
+		fuse_passthrough_setup(fc, req);
 
 	spin_lock(&fc->lock);
 	req->locked = 0;
@@ -1914,9 +2001,12 @@ static void end_queued_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	int i;
+
 	fc->max_background = UINT_MAX;
 	flush_bg_queue(fc);
-	end_requests(fc, &fc->pending);
+	for (i = 0; i < FUSE_NR_QUEUES; i++)
+		end_requests(fc, &fc->pqueue[i].pending);
 	end_requests(fc, &fc->processing);
 	while (forget_pending(fc))
 		kfree(dequeue_forget(fc, 1, NULL));
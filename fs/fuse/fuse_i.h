@@ -33,7 +33,15 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
+
+/** Number of pending queues, the cpus beyond share them round robin */
+#define FUSE_NR_QUEUES (NR_CPUS < 8 ? NR_CPUS : 8)
+
+/** Opcodes with latency statistics */
+#define FUSE_STAT_OPCODES (FUSE_BATCH_FORGET + 1)
+
+#define FUSE_SUPER_MAGIC 0x65735546
 
 /** If the FUSE_DEFAULT_PERMISSIONS flag is given, the filesystem
     module will check permissions based on the file mode.  Otherwise no
@@ -133,6 +141,9 @@ struct fuse_file {
 	/** Entry on inode's write_files list */
 	struct list_head write_entry;
 
+	/** Lower file read and written in place of the filesystem */
+	struct file *passthrough_filp;
+
 	/** RB node to be linked on fuse_conn->polled_files */
 	struct rb_node polled_node;
 
@@ -310,6 +321,32 @@ struct fuse_req {
 
 	/** Request is stolen from fuse_file->reserved_req */
 	struct file *stolen_file;
+
+	/** Lower file named in the reply to open or create */
+	struct file *passthrough_filp;
+
+	/** Time the request was queued for userspace, in ns */
+	u64 queue_ns;
+};
+
+/**
+ * Requests queued from the cpus of one pending queue.  Readers bound to
+ * one of those cpus wait on it as well as on fuse_conn->waitq, and take
+ * its requests first.
+ */
+struct fuse_pqueue {
+	/** Bound readers are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+};
+
+/** Time the replies to one opcode took */
+struct fuse_opcode_stat {
+	u64 count;
+	u64 total_ns;
+	u64 max_ns;
 };
 
 /**
@@ -347,8 +384,11 @@ struct fuse_conn {
 	/** Readers of the connection are waiting on this */
 	wait_queue_head_t waitq;
 
-	/** The list of pending requests */
-	struct list_head pending;
+	/** Pending requests by the cpu that queued them */
+	struct fuse_pqueue pqueue[FUSE_NR_QUEUES];
+
+	/** Number of requests on all pending queues */
+	unsigned nr_pending;
 
 	/** The list of requests being processed */
 	struct list_head processing;
@@ -475,12 +515,18 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+	/** Can the filesystem hand back a lower file on open? */
+	unsigned passthrough:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
 	/** Negotiated minor version */
 	unsigned minor;
 
+	/** Reply latency by opcode, protected by the lock */
+	struct fuse_opcode_stat opstat[FUSE_STAT_OPCODES];
+
 	/** Backing dev info */
 	struct backing_dev_info bdi;
 
@@ -767,4 +813,15 @@ int fuse_dev_release(struct inode *inode, struct file *file);
 
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/**
+ * Take a reference to the lower file named in an open reply, in the
+ * context of the filesystem daemon writing the reply.
+ */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req);
+
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos);
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos);
+
 #endif /* _FS_FUSE_I_H */
@@ -0,0 +1,126 @@
+/*
+  FUSE: Filesystem in Userspace
+  Copyright (C) 2001-2008  Miklos Szeredi <miklos@szeredi.hu>
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+/*
+ * A filesystem that only forwards to files of another one, like the
+ * Android sdcard daemon, may answer OPEN and CREATE with
+ * FOPEN_PASSTHROUGH and the descriptor of the lower file it opened.
+ * Reads and writes of that file are then done on the lower file from
+ * the kernel, without a round trip through the daemon and the copies
+ * of the data in and out of it.  Permissions are still checked by the
+ * daemon when it opens the lower file; everything else, mmap and splice
+ * included, still goes through the daemon.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/pagemap.h>
+#include <linux/aio.h>
+#include <linux/cred.h>
+#include <linux/uio.h>
+
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_open_out *open_out;
+	struct file *lower;
+
+	if (!fc->passthrough || req->out.h.error)
+		return;
+
+	if (req->in.h.opcode == FUSE_OPEN && req->out.numargs == 1)
+		open_out = req->out.args[0].value;
+	else if (req->in.h.opcode == FUSE_CREATE && req->out.numargs == 2)
+		open_out = req->out.args[1].value;
+	else
+		return;
+
+	if (!(open_out->open_flags & FOPEN_PASSTHROUGH))
+		return;
+	open_out->open_flags &= ~FOPEN_PASSTHROUGH;
+
+	/* the descriptor is looked up in the daemon writing the reply */
+	lower = fget(open_out->passthrough_fd);
+	if (!lower)
+		return;
+
+	if (!S_ISREG(lower->f_path.dentry->d_inode->i_mode) ||
+	    !lower->f_op || !lower->f_op->aio_read || !lower->f_op->aio_write ||
+	    lower->f_path.dentry->d_sb->s_magic == FUSE_SUPER_MAGIC) {
+		fput(lower);
+		return;
+	}
+
+	open_out->open_flags |= FOPEN_PASSTHROUGH;
+	req->passthrough_filp = lower;
+}
+
+static ssize_t fuse_passthrough_rw(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos, int write)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	struct inode *inode = file->f_mapping->host;
+	const struct cred *old_cred;
+	struct kiocb kiocb;
+	ssize_t ret;
+
+	if (!(lower->f_mode & (write ? FMODE_WRITE : FMODE_READ)))
+		return -EBADF;
+
+	if (write) {
+		mutex_lock(&inode->i_mutex);
+		if (file->f_flags & O_APPEND)
+			pos = i_size_read(lower->f_mapping->host);
+	}
+
+	init_sync_kiocb(&kiocb, lower);
+	kiocb.ki_pos = pos;
+	kiocb.ki_left = iov_length(iov, nr_segs);
+	kiocb.ki_nbytes = kiocb.ki_left;
+
+	old_cred = override_creds(lower->f_cred);
+	if (write)
+		ret = lower->f_op->aio_write(&kiocb, iov, nr_segs, pos);
+	else
+		ret = lower->f_op->aio_read(&kiocb, iov, nr_segs, pos);
+	if (ret == -EIOCBQUEUED)
+		ret = wait_on_sync_kiocb(&kiocb);
+	revert_creds(old_cred);
+
+	if (ret > 0)
+		iocb->ki_pos = pos + ret;
+
+	if (write) {
+		if (ret > 0) {
+			fuse_write_update_size(inode, pos + ret);
+			/* drop what a mapping of the file cached of the range */
+			if (inode->i_mapping->nrpages)
+				invalidate_inode_pages2_range(inode->i_mapping,
+					pos >> PAGE_CACHE_SHIFT,
+					(pos + ret - 1) >> PAGE_CACHE_SHIFT);
+		}
+		fuse_invalidate_attr(inode);
+		mutex_unlock(&inode->i_mutex);
+	}
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	return fuse_passthrough_rw(iocb, iov, nr_segs, pos, 0);
+}
+
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos)
+{
+	return fuse_passthrough_rw(iocb, iov, nr_segs, pos, 1);
+}
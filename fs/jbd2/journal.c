@@ -635,6 +635,7 @@ EXPORT_SYMBOL(jbd2_trans_will_send_data_barrier);
 int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 {
 	int err = 0;
+	ktime_t start = ktime_set(0, 0);
 
 	read_lock(&journal->j_state_lock);
 #ifdef CONFIG_JBD2_DEBUG
@@ -647,6 +648,8 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	while (tid_gt(tid, journal->j_commit_sequence)) {
 		jbd_debug(1, "JBD: want %d, j_commit_sequence=%d\n",
 				  tid, journal->j_commit_sequence);
+		if (!start.tv64)
+			start = ktime_get();
 		wake_up(&journal->j_wait_commit);
 		read_unlock(&journal->j_state_lock);
 		wait_event(journal->j_wait_done_commit,
@@ -655,6 +658,17 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	}
 	read_unlock(&journal->j_state_lock);
 
+	if (start.tv64) {
+		u64 delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		spin_lock(&journal->j_history_lock);
+		journal->j_stats.ts_commit_waits++;
+		journal->j_stats.ts_commit_wait_time += delta;
+		if (delta > journal->j_stats.ts_commit_wait_max)
+			journal->j_stats.ts_commit_wait_max = delta;
+		spin_unlock(&journal->j_history_lock);
+	}
+
 	if (unlikely(is_journal_aborted(journal))) {
 		printk(KERN_EMERG "journal commit I/O error\n");
 		err = -EIO;
@@ -790,6 +804,16 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	if (!s->stats->ts_commit_waits)
+		return 0;
+	seq_printf(seq, "%lu waits for a commit\n",
+		   s->stats->ts_commit_waits);
+	seq_printf(seq, "  %lluus average wait\n",
+		   div_u64(div64_u64(s->stats->ts_commit_wait_time,
+				     s->stats->ts_commit_waits),
+			   NSEC_PER_USEC));
+	seq_printf(seq, "  %lluus longest wait\n",
+		   div_u64(s->stats->ts_commit_wait_max, NSEC_PER_USEC));
 	return 0;
 }
 
@@ -32,6 +32,7 @@
 #include <linux/fcntl.h>
 #include <linux/device_cgroup.h>
 #include <linux/fs_struct.h>
+#include <linux/ktime.h>
 #include <asm/uaccess.h>
 
 #include "internal.h"
@@ -1151,6 +1152,7 @@ static int do_lookup(struct nameidata *nd, struct qstr *name,
 	struct dentry *dentry, *parent = nd->path.dentry;
 	int need_reval = 1;
 	int status = 1;
+	int miss = 0;
 	int err;
 
 	/*
@@ -1184,6 +1186,7 @@ static int do_lookup(struct nameidata *nd, struct qstr *name,
 			goto unlazy;
 		if (unlikely(path->dentry->d_flags & DCACHE_NEED_AUTOMOUNT))
 			goto unlazy;
+		d_lookup_hit(*inode == NULL);
 		return 0;
 unlazy:
 		if (unlazy_walk(nd, dentry))
@@ -1200,7 +1203,12 @@ retry:
 		mutex_lock(&dir->i_mutex);
 		dentry = d_lookup(parent, name);
 		if (likely(!dentry)) {
+			ktime_t start = ktime_get();
+
 			dentry = d_alloc_and_lookup(parent, name, nd);
+			d_lookup_miss(ktime_to_ns(ktime_sub(ktime_get(),
+							    start)));
+			miss = 1;
 			if (IS_ERR(dentry)) {
 				mutex_unlock(&dir->i_mutex);
 				return PTR_ERR(dentry);
@@ -1226,6 +1234,8 @@ retry:
 		}
 	}
 
+	if (!miss)
+		d_lookup_hit(dentry->d_inode == NULL);
 	path->mnt = mnt;
 	path->dentry = dentry;
 	err = follow_managed(path, nd->flags);
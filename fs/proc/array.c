@@ -81,6 +81,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/ptrace.h>
 #include <linux/tracehook.h>
+#include <linux/proc_summary.h>
 
 #include <asm/pgtable.h>
 #include <asm/processor.h>
@@ -544,3 +545,71 @@ int proc_pid_statm(struct seq_file *m, struct pid_namespace *ns,
 
 	return 0;
 }
+
+static inline u64 cputime_to_ns(cputime_t ct)
+{
+	return (u64)cputime_to_jiffies(ct) * (NSEC_PER_SEC / HZ);
+}
+
+/*
+ * The binary record of /proc/<pid>/summary and /proc/summary: what stat,
+ * statm and status tell of the thread group, from counters only.
+ */
+void task_summary(struct task_struct *task, struct pid_namespace *ns,
+		  struct proc_summary *ps)
+{
+	struct mm_struct *mm;
+	cputime_t utime = cputime_zero, stime = cputime_zero;
+	unsigned long min_flt = 0, maj_flt = 0, flags;
+
+	memset(ps, 0, sizeof(*ps));
+	ps->ps_size = sizeof(*ps);
+	ps->ps_pid = task_tgid_nr_ns(task, ns);
+	ps->ps_uid = task_uid(task);
+	ps->ps_state = *get_task_state(task);
+	ps->ps_pss_age_ms = ~0U;
+	get_task_comm(ps->ps_comm, task);
+	ps->ps_start_time_ns = timespec_to_ns(&task->real_start_time);
+
+	if (lock_task_sighand(task, &flags)) {
+		struct signal_struct *sig = task->signal;
+		struct task_struct *t = task;
+
+		do {
+			min_flt += t->min_flt;
+			maj_flt += t->maj_flt;
+			t = next_thread(t);
+		} while (t != task);
+		min_flt += sig->min_flt;
+		maj_flt += sig->maj_flt;
+		thread_group_times(task, &utime, &stime);
+
+		ps->ps_threads = get_nr_threads(task);
+		ps->ps_oom_score_adj = sig->oom_score_adj;
+		ps->ps_ppid = task_tgid_nr_ns(task->real_parent, ns);
+		unlock_task_sighand(task, &flags);
+	}
+	ps->ps_min_flt = min_flt;
+	ps->ps_maj_flt = maj_flt;
+	ps->ps_utime_ns = cputime_to_ns(utime);
+	ps->ps_stime_ns = cputime_to_ns(stime);
+
+	mm = get_task_mm(task);
+	if (mm) {
+		unsigned long stamp = mm->smaps_pss_time;
+
+		ps->ps_vm_kb = mm->total_vm << (PAGE_SHIFT - 10);
+		ps->ps_rss_anon_kb = get_mm_counter(mm, MM_ANONPAGES)
+							<< (PAGE_SHIFT - 10);
+		ps->ps_rss_file_kb = get_mm_counter(mm, MM_FILEPAGES)
+							<< (PAGE_SHIFT - 10);
+		ps->ps_swap_kb = get_mm_counter(mm, MM_SWAPENTS)
+							<< (PAGE_SHIFT - 10);
+		if (stamp) {
+			ps->ps_pss_kb = mm->smaps_pss;
+			ps->ps_pss_age_ms = min_t(unsigned long, ~0U - 1,
+					jiffies_to_msecs(jiffies - stamp));
+		}
+		mmput(mm);
+	}
+}
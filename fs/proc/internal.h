@@ -51,6 +51,10 @@ extern int proc_pid_status(struct seq_file *m, struct pid_namespace *ns,
 				struct pid *pid, struct task_struct *task);
 extern int proc_pid_statm(struct seq_file *m, struct pid_namespace *ns,
 				struct pid *pid, struct task_struct *task);
+extern const struct file_operations proc_pid_summary_operations;
+struct proc_summary;
+extern void task_summary(struct task_struct *task, struct pid_namespace *ns,
+			 struct proc_summary *ps);
 extern loff_t mem_lseek(struct file *file, loff_t offset, int orig);
 
 extern const struct file_operations proc_maps_operations;
@@ -66,6 +70,7 @@ struct proc_maps_private {
 	struct task_struct *task;
 #ifdef CONFIG_MMU
 	struct vm_area_struct *tail_vma;
+	u64 pss;		/* smaps: Pss summed up to the current vma */
 #endif
 };
 
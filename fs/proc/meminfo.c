@@ -93,6 +93,12 @@ static int meminfo_proc_show(struct seq_file *m, void *v)
 		"NFS_Unstable:   %8lu kB\n"
 		"Bounce:         %8lu kB\n"
 		"WritebackTmp:   %8lu kB\n"
+		"ZsPages:        %8lu kB\n"
+		"IonPinned:      %8lu kB\n"
+		"IonPool:        %8lu kB\n"
+		"PvrPinned:      %8lu kB\n"
+		"PvrPool:        %8lu kB\n"
+		"Binder:         %8lu kB\n"
 		"CommitLimit:    %8lu kB\n"
 		"Committed_AS:   %8lu kB\n"
 		"VmallocTotal:   %8lu kB\n"
@@ -152,6 +158,12 @@ static int meminfo_proc_show(struct seq_file *m, void *v)
 		K(global_page_state(NR_UNSTABLE_NFS)),
 		K(global_page_state(NR_BOUNCE)),
 		K(global_page_state(NR_WRITEBACK_TEMP)),
+		K(global_page_state(NR_ZSPAGES)),
+		K(global_page_state(NR_ION_PAGES)),
+		K(global_page_state(NR_ION_POOL_PAGES)),
+		K(global_page_state(NR_PVR_PAGES)),
+		K(global_page_state(NR_PVR_POOL_PAGES)),
+		K(global_page_state(NR_BINDER_PAGES)),
 		K(allowed),
 		K(committed),
 		(unsigned long)VMALLOC_TOTAL >> 10,
@@ -0,0 +1,99 @@
+/*
+ *  linux/fs/proc/summary.c
+ *
+ *  /proc/<pid>/summary and /proc/summary: a binary struct proc_summary
+ *  per process, for monitors that poll every process at an interval and
+ *  would otherwise parse stat, statm and status, or walk smaps.
+ */
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/pid_namespace.h>
+#include <linux/proc_fs.h>
+#include <linux/proc_summary.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include "internal.h"
+
+static ssize_t proc_pid_summary_read(struct file *file, char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct pid_namespace *ns = file->f_dentry->d_sb->s_fs_info;
+	struct task_struct *task = get_proc_task(file->f_dentry->d_inode);
+	struct proc_summary ps;
+
+	if (!task)
+		return -ESRCH;
+	task_summary(task, ns, &ps);
+	put_task_struct(task);
+
+	return simple_read_from_buffer(buf, count, ppos, &ps, sizeof(ps));
+}
+
+const struct file_operations proc_pid_summary_operations = {
+	.read		= proc_pid_summary_read,
+	.llseek		= generic_file_llseek,
+};
+
+/*
+ * As many whole records as fit in the buffer, in pid order.  The file
+ * position is the pid to carry on from, so that one read() with a large
+ * enough buffer returns every process.
+ */
+static ssize_t proc_summary_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct pid_namespace *ns = file->f_dentry->d_sb->s_fs_info;
+	struct proc_summary ps;
+	struct task_struct *task;
+	struct pid *pid;
+	ssize_t done = 0;
+	int nr;
+
+	if (count < sizeof(ps))
+		return -EINVAL;
+	if (*ppos < 0 || *ppos > PID_MAX_LIMIT)
+		return 0;
+	nr = *ppos;
+
+	while (count - done >= sizeof(ps)) {
+		rcu_read_lock();
+		task = NULL;
+		while ((pid = find_ge_pid(nr, ns))) {
+			nr = pid_nr_ns(pid, ns) + 1;
+			task = pid_task(pid, PIDTYPE_PID);
+			/* one record per thread group, as readdir of /proc */
+			if (task && has_group_leader_pid(task))
+				break;
+			task = NULL;
+		}
+		if (task)
+			get_task_struct(task);
+		rcu_read_unlock();
+		if (!task)
+			break;
+
+		task_summary(task, ns, &ps);
+		put_task_struct(task);
+		if (copy_to_user(buf + done, &ps, sizeof(ps)))
+			return done ? done : -EFAULT;
+		done += sizeof(ps);
+		*ppos = nr;
+
+		if (fatal_signal_pending(current))
+			break;
+		cond_resched();
+	}
+	return done;
+}
+
+static const struct file_operations proc_summary_operations = {
+	.read		= proc_summary_read,
+	.llseek		= default_llseek,
+};
+
+static int __init proc_summary_init(void)
+{
+	proc_create("summary", 0, NULL, &proc_summary_operations);
+	return 0;
+}
+module_init(proc_summary_init);
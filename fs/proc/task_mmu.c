@@ -51,7 +51,8 @@ void task_mem(struct seq_file *m, struct mm_struct *mm)
 		"VmExe:\t%8lu kB\n"
 		"VmLib:\t%8lu kB\n"
 		"VmPTE:\t%8lu kB\n"
-		"VmSwap:\t%8lu kB\n",
+		"VmSwap:\t%8lu kB\n"
+		"FaultAround:\t%lu\n",
 		hiwater_vm << (PAGE_SHIFT-10),
 		(total_vm - mm->reserved_vm) << (PAGE_SHIFT-10),
 		mm->locked_vm << (PAGE_SHIFT-10),
@@ -60,7 +61,8 @@ void task_mem(struct seq_file *m, struct mm_struct *mm)
 		data << (PAGE_SHIFT-10),
 		mm->stack_vm << (PAGE_SHIFT-10), text, lib,
 		(PTRS_PER_PTE*sizeof(pte_t)*mm->nr_ptes) >> 10,
-		swap << (PAGE_SHIFT-10));
+		swap << (PAGE_SHIFT-10),
+		atomic_long_read(&mm->fault_around));
 }
 
 unsigned long task_vsize(struct mm_struct *mm)
@@ -423,6 +425,27 @@ static int smaps_pte_range(pmd_t *pmd, unsigned long addr, unsigned long end,
 	return 0;
 }
 
+/*
+ * Sum up the Pss of a whole read of smaps and leave it in the mm, where
+ * /proc/<pid>/summary finds it without walking the page tables again.
+ */
+static void smaps_account_pss(struct proc_maps_private *priv,
+			      struct vm_area_struct *vma, u64 pss)
+{
+	struct mm_struct *mm = vma->vm_mm;
+
+	if (!mm)	/* the gate vma, after all the others */
+		return;
+	if (vma == mm->mmap)
+		priv->pss = 0;
+	priv->pss += pss;
+
+	if (!vma->vm_next) {
+		mm->smaps_pss = priv->pss >> (10 + PSS_SHIFT);
+		mm->smaps_pss_time = jiffies ? jiffies : 1;
+	}
+}
+
 static int show_smap(struct seq_file *m, void *v)
 {
 	struct proc_maps_private *priv = m->private;
@@ -474,9 +497,11 @@ static int show_smap(struct seq_file *m, void *v)
 		   (vma->vm_flags & VM_LOCKED) ?
 			(unsigned long)(mss.pss >> (10 + PSS_SHIFT)) : 0);
 
-	if (m->count < m->size)  /* vma is copied successfully */
+	if (m->count < m->size) {  /* vma is copied successfully */
 		m->version = (vma != get_gate_vma(task->mm))
 			? vma->vm_start : 0;
+		smaps_account_pss(priv, vma, mss.pss);
+	}
 	return 0;
 }
 
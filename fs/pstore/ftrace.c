@@ -0,0 +1,421 @@
+/*
+ * Persistent per-cpu trace ring
+ *
+ * Copyright (C) 2012 Google, Inc.
+ *
+ * A region of ram that survives a warm reset is split in one zone per
+ * possible cpu.  Each zone starts with a header, written once at boot
+ * and protected by Reed-Solomon parity, followed by a ring of 8-byte
+ * records.  Recording an event is a single 8-byte store into the zone
+ * of the current cpu, at an index taken with local_inc_return(): there
+ * is no lock, nothing is shared between cpus, and an interrupt on the
+ * same cpu simply takes the next slot.
+ *
+ * The write position is never stored.  Bit 0 of the first word of a
+ * record is the parity of the lap of the ring it was written in, so
+ * after a reset the oldest record is the first one whose lap differs
+ * from that of the record before it.  A zone whose header cannot be
+ * corrected is dropped, a record damaged in place only shows up as one
+ * bad line.
+ *
+ * Function entries record the ip and the parent ip.  Scheduler switches
+ * record the next and previous pids and are told apart by bit 1 of the
+ * first word, which is clear in the address of an ARM function.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/debugfs.h>
+#include <linux/ftrace.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/platform_device.h>
+#include <linux/proc_fs.h>
+#include <linux/rslib.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <asm/local.h>
+#include <trace/events/sched.h>
+
+#include "internal.h"
+
+#define PSTORE_FTRACE_SIG	0x54464350	/* PCFT */
+
+#define PSTORE_FTRACE_LAP	0x1
+#define PSTORE_FTRACE_SCHED	0x2
+
+/* the header is short: one block, 16 parity bytes correct 8 of them */
+#define ECC_SIZE		16
+#define ECC_SYMSIZE		8
+#define ECC_POLY		0x11d
+
+struct pstore_ftrace_rec {
+	u32 a;		/* ip, or next pid << 2 | PSTORE_FTRACE_SCHED */
+	u32 b;		/* parent ip, or prev pid */
+};
+
+struct pstore_ftrace_hdr {
+	u32 sig;
+	u32 cpu;
+	u32 nr;		/* records in the ring, a power of two */
+	u32 rec_offset;
+};
+
+struct pstore_ftrace_zone {
+	struct pstore_ftrace_hdr __iomem *hdr;
+	struct pstore_ftrace_rec __iomem *recs;
+	unsigned int nr;
+	unsigned int shift;	/* ilog2(nr) */
+
+	/* what the previous boot left, oldest first */
+	struct pstore_ftrace_rec *old;
+	unsigned int old_nr;
+};
+
+static DEFINE_PER_CPU(struct pstore_ftrace_zone, pstore_ftrace_zone);
+static DEFINE_PER_CPU(local_t, pstore_ftrace_head);
+
+static struct rs_control *pstore_ftrace_rs;
+static u32 pstore_ftrace_recording;
+
+static void notrace pstore_ftrace_store(u32 a, u32 b)
+{
+	struct pstore_ftrace_zone *zone;
+	union {
+		struct pstore_ftrace_rec rec;
+		u64 v;
+	} u;
+	unsigned long i;
+
+	preempt_disable_notrace();
+	zone = &__get_cpu_var(pstore_ftrace_zone);
+	i = local_inc_return(&__get_cpu_var(pstore_ftrace_head)) - 1;
+	u.rec.a = a | ((i >> zone->shift) & PSTORE_FTRACE_LAP);
+	u.rec.b = b;
+	*(volatile u64 __force *)&zone->recs[i & (zone->nr - 1)] = u.v;
+	preempt_enable_notrace();
+}
+
+static void notrace pstore_ftrace_call(unsigned long ip,
+				       unsigned long parent_ip)
+{
+	pstore_ftrace_store(ip, parent_ip);
+}
+
+static struct ftrace_ops pstore_ftrace_ops __read_mostly = {
+	.func	= pstore_ftrace_call,
+};
+
+static void notrace pstore_ftrace_sched_switch(void *ignore,
+		struct task_struct *prev, struct task_struct *next)
+{
+	pstore_ftrace_store(next->pid << 2 | PSTORE_FTRACE_SCHED, prev->pid);
+}
+
+static void pstore_ftrace_encode_hdr(struct pstore_ftrace_hdr *hdr, u8 *ecc)
+{
+	uint16_t par[ECC_SIZE];
+	int i;
+
+	memset(par, 0, sizeof(par));
+	encode_rs8(pstore_ftrace_rs, (uint8_t *)hdr, sizeof(*hdr), par, 0);
+	for (i = 0; i < ECC_SIZE; i++)
+		ecc[i] = par[i];
+}
+
+static int pstore_ftrace_decode_hdr(struct pstore_ftrace_hdr *hdr, u8 *ecc)
+{
+	uint16_t par[ECC_SIZE];
+	int i;
+
+	for (i = 0; i < ECC_SIZE; i++)
+		par[i] = ecc[i];
+	return decode_rs8(pstore_ftrace_rs, (uint8_t *)hdr, par, sizeof(*hdr),
+			  NULL, 0, NULL, 0, NULL);
+}
+
+/* copy out what the last boot recorded in this zone, oldest first */
+static void __init pstore_ftrace_save_old(struct pstore_ftrace_zone *zone,
+					  struct pstore_ftrace_hdr *hdr)
+{
+	struct pstore_ftrace_rec __iomem *recs;
+	struct pstore_ftrace_rec *ring;
+	unsigned int nr = hdr->nr;
+	unsigned int head, count;
+	u32 lap;
+
+	/* the zone must not have grown since */
+	if (!is_power_of_2(nr) || nr > zone->nr ||
+	    hdr->rec_offset != sizeof(*hdr) + ECC_SIZE)
+		return;
+
+	ring = vmalloc(nr * sizeof(*ring));
+	if (!ring)
+		return;
+	recs = (void __iomem *)zone->hdr + hdr->rec_offset;
+	memcpy_fromio(ring, recs, nr * sizeof(*ring));
+
+	if (!ring[0].a) {
+		vfree(ring);
+		return;
+	}
+	lap = ring[0].a & PSTORE_FTRACE_LAP;
+	for (head = 1; head < nr; head++)
+		if (!ring[head].a ||
+		    (ring[head].a & PSTORE_FTRACE_LAP) != lap)
+			break;
+
+	if (head < nr && !ring[head].a) {
+		/* never wrapped */
+		count = head;
+		head = 0;
+	} else {
+		count = nr;
+		if (head == nr)
+			head = 0;
+	}
+
+	zone->old = vmalloc(count * sizeof(*ring));
+	if (zone->old) {
+		memcpy(zone->old, ring + head, (count - head) * sizeof(*ring));
+		memcpy(zone->old + count - head, ring, head * sizeof(*ring));
+		zone->old_nr = count;
+	}
+	vfree(ring);
+}
+
+static int __init pstore_ftrace_init_zone(unsigned int cpu,
+					  void __iomem *base, size_t size)
+{
+	struct pstore_ftrace_zone *zone = &per_cpu(pstore_ftrace_zone, cpu);
+	struct pstore_ftrace_hdr hdr;
+	u8 ecc[ECC_SIZE];
+	size_t rec_offset = sizeof(hdr) + ECC_SIZE;
+	int numerr;
+
+	if (size < rec_offset + 2 * sizeof(struct pstore_ftrace_rec))
+		return -EINVAL;
+
+	zone->hdr = base;
+	zone->recs = base + rec_offset;
+	zone->nr = rounddown_pow_of_two((size - rec_offset) /
+					sizeof(struct pstore_ftrace_rec));
+	zone->shift = ilog2(zone->nr);
+
+	memcpy_fromio(&hdr, base, sizeof(hdr));
+	memcpy_fromio(ecc, base + sizeof(hdr), ECC_SIZE);
+	numerr = pstore_ftrace_decode_hdr(&hdr, ecc);
+	if (numerr < 0)
+		pr_info("pstore_ftrace: cpu%u: uncorrectable header\n", cpu);
+	else if (hdr.sig != PSTORE_FTRACE_SIG || hdr.cpu != cpu)
+		pr_info("pstore_ftrace: cpu%u: no trace (sig 0x%08x)\n",
+			cpu, hdr.sig);
+	else {
+		if (numerr)
+			pr_info("pstore_ftrace: cpu%u: %d header bytes "
+				"corrected\n", cpu, numerr);
+		pstore_ftrace_save_old(zone, &hdr);
+	}
+
+	memset_io(zone->recs, 0, zone->nr * sizeof(struct pstore_ftrace_rec));
+	hdr.sig = PSTORE_FTRACE_SIG;
+	hdr.cpu = cpu;
+	hdr.nr = zone->nr;
+	hdr.rec_offset = rec_offset;
+	pstore_ftrace_encode_hdr(&hdr, ecc);
+	memcpy_toio(base, &hdr, sizeof(hdr));
+	memcpy_toio(base + sizeof(hdr), ecc, ECC_SIZE);
+	return 0;
+}
+
+static int pstore_ftrace_get(void *data, u64 *val)
+{
+	*val = pstore_ftrace_recording;
+	return 0;
+}
+
+static int pstore_ftrace_set(void *data, u64 val)
+{
+	int ret = 0;
+
+	val = !!val;
+	if (val == pstore_ftrace_recording)
+		return 0;
+	if (val)
+		ret = register_ftrace_function(&pstore_ftrace_ops);
+	else
+		ret = unregister_ftrace_function(&pstore_ftrace_ops);
+	if (ret) {
+		pr_err("pstore_ftrace: %sregistering failed: %d\n",
+		       val ? "" : "un", ret);
+		return ret;
+	}
+	pstore_ftrace_recording = val;
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(pstore_ftrace_knob_fops, pstore_ftrace_get,
+			pstore_ftrace_set, "%llu\n");
+
+/*
+ * The ring has its own ram and comes up with its platform device, it
+ * does not depend on which backend, if any, registers with pstore.
+ */
+void pstore_register_ftrace(void)
+{
+}
+
+static void *pstore_ftrace_seq_start(struct seq_file *s, loff_t *pos)
+{
+	loff_t n = *pos;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct pstore_ftrace_zone *zone =
+			&per_cpu(pstore_ftrace_zone, cpu);
+
+		if (n < zone->old_nr) {
+			s->private = (void *)(unsigned long)cpu;
+			return &zone->old[n];
+		}
+		n -= zone->old_nr;
+	}
+	return NULL;
+}
+
+static void *pstore_ftrace_seq_next(struct seq_file *s, void *v, loff_t *pos)
+{
+	(*pos)++;
+	return pstore_ftrace_seq_start(s, pos);
+}
+
+static void pstore_ftrace_seq_stop(struct seq_file *s, void *v)
+{
+}
+
+static int pstore_ftrace_seq_show(struct seq_file *s, void *v)
+{
+	struct pstore_ftrace_rec *rec = v;
+	unsigned int cpu = (unsigned long)s->private;
+	u32 a = rec->a & ~PSTORE_FTRACE_LAP;
+
+	if (a & PSTORE_FTRACE_SCHED)
+		seq_printf(s, "%u switch %u -> %u\n", cpu, rec->b, a >> 2);
+	else
+		seq_printf(s, "%u %08x  %08x  %pf <- %pF\n", cpu, a, rec->b,
+			   (void *)(unsigned long)a,
+			   (void *)(unsigned long)rec->b);
+	return 0;
+}
+
+static const struct seq_operations pstore_ftrace_seq_ops = {
+	.start	= pstore_ftrace_seq_start,
+	.next	= pstore_ftrace_seq_next,
+	.stop	= pstore_ftrace_seq_stop,
+	.show	= pstore_ftrace_seq_show,
+};
+
+static int pstore_ftrace_old_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &pstore_ftrace_seq_ops);
+}
+
+static const struct file_operations pstore_ftrace_old_fops = {
+	.open		= pstore_ftrace_old_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init pstore_ftrace_probe(struct platform_device *pdev)
+{
+	struct resource *res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	struct dentry *dir;
+	void __iomem *base;
+	size_t zone_size;
+	unsigned int cpu, n = 0;
+	bool old = false;
+	int ret;
+
+	if (!res) {
+		pr_err("pstore_ftrace: no memory resource\n");
+		return -ENXIO;
+	}
+
+	pstore_ftrace_rs = init_rs(ECC_SYMSIZE, ECC_POLY, 0, 1, ECC_SIZE);
+	if (!pstore_ftrace_rs) {
+		pr_err("pstore_ftrace: init_rs failed\n");
+		return -ENOMEM;
+	}
+
+	/* write combined: the stores are posted, a warm reset keeps ram */
+	base = ioremap_wc(res->start, resource_size(res));
+	if (!base) {
+		pr_err("pstore_ftrace: failed to map memory\n");
+		ret = -ENOMEM;
+		goto err_rs;
+	}
+
+	zone_size = resource_size(res) / num_possible_cpus();
+	zone_size &= ~(sizeof(u64) - 1);
+	for_each_possible_cpu(cpu) {
+		ret = pstore_ftrace_init_zone(cpu, base + n++ * zone_size,
+					      zone_size);
+		if (ret) {
+			pr_err("pstore_ftrace: %zu bytes per cpu is too "
+			       "small\n", zone_size);
+			goto err_unmap;
+		}
+		if (per_cpu(pstore_ftrace_zone, cpu).old_nr)
+			old = true;
+	}
+
+	ret = register_trace_sched_switch(pstore_ftrace_sched_switch, NULL);
+	if (ret)
+		pr_warn("pstore_ftrace: no sched_switch probe: %d\n", ret);
+
+	dir = debugfs_create_dir("pstore", NULL);
+	if (!IS_ERR_OR_NULL(dir))
+		debugfs_create_file("record_ftrace", 0600, dir, NULL,
+				    &pstore_ftrace_knob_fops);
+
+	if (old && !proc_create("last_ftrace", S_IRUSR, NULL,
+				&pstore_ftrace_old_fops))
+		pr_err("pstore_ftrace: failed to create proc entry\n");
+
+	pr_info("pstore_ftrace: %u records per cpu at 0x%08lx\n",
+		per_cpu(pstore_ftrace_zone, 0).nr, (unsigned long)res->start);
+	return 0;
+
+err_unmap:
+	iounmap(base);
+err_rs:
+	free_rs(pstore_ftrace_rs);
+	return ret;
+}
+
+static struct platform_driver pstore_ftrace_driver = {
+	.driver		= {
+		.name	= "pstore_ftrace",
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init pstore_ftrace_init(void)
+{
+	return platform_driver_probe(&pstore_ftrace_driver,
+				     pstore_ftrace_probe);
+}
+device_initcall(pstore_ftrace_init);
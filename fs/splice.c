@@ -32,6 +32,33 @@
 #include <linux/security.h>
 #include <linux/gfp.h>
 #include <linux/socket.h>
+#include <linux/vmstat.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/splice.h>
+
+/*
+ * Pages one splice call passed on by reference and copied, for
+ * /proc/vmstat and the splice_pages trace event.
+ */
+static void splice_account(bool to_pipe, unsigned int moved,
+			   unsigned int copied)
+{
+	if (!moved && !copied)
+		return;
+
+	count_vm_events(SPLICE_MOVED, moved);
+	count_vm_events(SPLICE_COPIED, copied);
+	trace_splice_pages(to_pipe, moved, copied);
+}
+
+/* number of pages covering len bytes from pos */
+static inline unsigned int splice_pages_spanned(loff_t pos, size_t len)
+{
+	unsigned long offset = pos & ~PAGE_CACHE_MASK;
+
+	return (offset + len + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+}
 
 /*
  * Attempt to steal a page from a pipe buffer. This should perhaps go into
@@ -536,6 +563,7 @@ ssize_t generic_file_splice_read(struct file *in, loff_t *ppos,
 
 	ret = __generic_file_splice_read(in, ppos, pipe, len, flags);
 	if (ret > 0) {
+		splice_account(true, splice_pages_spanned(*ppos, ret), 0);
 		*ppos += ret;
 		file_accessed(in);
 	}
@@ -664,8 +692,10 @@ ssize_t default_file_splice_read(struct file *in, loff_t *ppos,
 	spd.nr_pages -= nr_freed;
 
 	res = splice_to_pipe(pipe, &spd);
-	if (res > 0)
+	if (res > 0) {
+		splice_account(true, 0, splice_pages_spanned(*ppos, res));
 		*ppos += res;
+	}
 
 shrink_ret:
 	if (vec != __vec)
@@ -691,7 +721,7 @@ static int pipe_to_sendpage(struct pipe_inode_info *pipe,
 {
 	struct file *file = sd->u.file;
 	loff_t pos = sd->pos;
-	int more;
+	int more, ret;
 
 	if (!likely(file->f_op && file->f_op->sendpage))
 		return -EINVAL;
@@ -701,8 +731,11 @@ static int pipe_to_sendpage(struct pipe_inode_info *pipe,
 	if (sd->len < sd->total_len && pipe->nrbufs > 1)
 		more |= MSG_SENDPAGE_NOTLAST;
 
-	return file->f_op->sendpage(file, buf->page, buf->offset,
-				    sd->len, &pos, more);
+	ret = file->f_op->sendpage(file, buf->page, buf->offset,
+				   sd->len, &pos, more);
+	if (ret > 0)
+		sd->pages_moved++;
+	return ret;
 }
 
 /*
@@ -721,18 +754,80 @@ static int pipe_to_sendpage(struct pipe_inode_info *pipe,
  * If asked to move pages to the output file (SPLICE_F_MOVE is set in
  * sd->flags), we attempt to migrate pages from the pipe to the output
  * file address space page cache. This is possible if no one else has
- * the pipe page referenced outside of the pipe and page cache. If
- * SPLICE_F_MOVE isn't set, or we cannot move the page, we simply create
- * a new page in the output file page cache and fill/dirty that.
+ * the pipe page referenced outside of the pipe and page cache, and if
+ * the buffer is a whole page going to a page aligned position where the
+ * output file has no cached page yet. If SPLICE_F_MOVE isn't set, or we
+ * cannot move the page, we simply create a new page in the output file
+ * page cache and fill/dirty that.
  */
+static bool pipe_to_file_steal(struct pipe_inode_info *pipe,
+			       struct pipe_buffer *buf, struct splice_desc *sd)
+{
+	struct address_space *mapping = sd->u.file->f_mapping;
+	pgoff_t index = sd->pos >> PAGE_CACHE_SHIFT;
+	struct page *page = buf->page;
+	bool cached;
+
+	if (!(sd->flags & SPLICE_F_MOVE) || sd->len != PAGE_CACHE_SIZE ||
+	    buf->offset || (sd->pos & ~PAGE_CACHE_MASK))
+		return false;
+
+	/*
+	 * Only pages the pipe releases with a plain page_cache_release():
+	 * anon pipe buffers may be recycled by the pipe once unreferenced.
+	 */
+	if (buf->ops != &page_cache_pipe_buf_ops &&
+	    buf->ops != &user_page_pipe_buf_ops)
+		return false;
+
+	/* cheap check first, add_to_page_cache_locked() closes the race */
+	rcu_read_lock();
+	cached = radix_tree_lookup(&mapping->page_tree, index) != NULL;
+	rcu_read_unlock();
+	if (cached)
+		return false;
+
+	if (buf->ops->steal(pipe, buf))
+		return false;
+
+	if (add_stolen_page_to_page_cache(page, mapping, index)) {
+		unlock_page(page);
+		return false;
+	}
+	/* shared with the page cache now, not to be stolen again */
+	buf->flags &= ~PIPE_BUF_FLAG_GIFT;
+	unlock_page(page);
+	return true;
+}
+
+/*
+ * ->write_begin() failed after the stolen page went in the page cache:
+ * take it back out, it holds data that was never written, and give the
+ * pipe buffer back its gift.
+ */
+static void pipe_to_file_unsteal(struct pipe_buffer *buf,
+				 struct address_space *mapping,
+				 unsigned int gift)
+{
+	struct page *page = buf->page;
+
+	lock_page(page);
+	if (page->mapping == mapping && !page_mapped(page))
+		delete_from_page_cache(page);
+	unlock_page(page);
+	buf->flags |= gift;
+}
+
 int pipe_to_file(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 		 struct splice_desc *sd)
 {
 	struct file *file = sd->u.file;
 	struct address_space *mapping = file->f_mapping;
 	unsigned int offset, this_len;
+	unsigned int gift = buf->flags & PIPE_BUF_FLAG_GIFT;
 	struct page *page;
 	void *fsdata;
+	bool stolen;
 	int ret;
 
 	offset = sd->pos & ~PAGE_CACHE_MASK;
@@ -741,12 +836,23 @@ int pipe_to_file(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 	if (this_len + offset > PAGE_CACHE_SIZE)
 		this_len = PAGE_CACHE_SIZE - offset;
 
+	/*
+	 * A stolen page is found in the page cache by ->write_begin(),
+	 * which then has nothing to read in and we nothing to copy.
+	 */
+	stolen = pipe_to_file_steal(pipe, buf, sd);
+
 	ret = pagecache_write_begin(file, mapping, sd->pos, this_len,
 				AOP_FLAG_UNINTERRUPTIBLE, &page, &fsdata);
-	if (unlikely(ret))
+	if (unlikely(ret)) {
+		if (stolen)
+			pipe_to_file_unsteal(buf, mapping, gift);
 		goto out;
+	}
 
-	if (buf->page != page) {
+	if (buf->page == page) {
+		sd->pages_moved++;
+	} else {
 		/*
 		 * Careful, ->map() uses KM_USER0!
 		 */
@@ -757,6 +863,7 @@ int pipe_to_file(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 		flush_dcache_page(page);
 		kunmap_atomic(dst, KM_USER1);
 		buf->ops->unmap(pipe, buf, src);
+		sd->pages_copied++;
 	}
 	ret = pagecache_write_end(file, mapping, sd->pos, this_len, this_len,
 				page, fsdata);
@@ -892,6 +999,8 @@ void splice_from_pipe_begin(struct splice_desc *sd)
 {
 	sd->num_spliced = 0;
 	sd->need_wakeup = false;
+	sd->pages_moved = 0;
+	sd->pages_copied = 0;
 }
 EXPORT_SYMBOL(splice_from_pipe_begin);
 
@@ -901,14 +1010,15 @@ EXPORT_SYMBOL(splice_from_pipe_begin);
  * @sd:		information about the splice operation
  *
  * Description:
- *    This function will wake up pipe writers if necessary.  It should
- *    be called after a loop containing splice_from_pipe_next() and
- *    splice_from_pipe_feed().
+ *    This function will wake up pipe writers if necessary, and account
+ *    the pages moved and copied.  It should be called after a loop
+ *    containing splice_from_pipe_next() and splice_from_pipe_feed().
  */
 void splice_from_pipe_end(struct pipe_inode_info *pipe, struct splice_desc *sd)
 {
 	if (sd->need_wakeup)
 		wakeup_pipe_writers(pipe);
+	splice_account(false, sd->pages_moved, sd->pages_copied);
 }
 EXPORT_SYMBOL(splice_from_pipe_end);
 
@@ -1053,6 +1163,8 @@ static int write_pipe_buf(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 	data = buf->ops->map(pipe, buf, 0);
 	ret = kernel_write(sd->u.file, data + buf->offset, sd->len, sd->pos);
 	buf->ops->unmap(pipe, buf, data);
+	if (ret > 0)
+		sd->pages_copied++;
 
 	return ret;
 }
@@ -1523,8 +1635,10 @@ static int pipe_to_user(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 
 	buf->ops->unmap(pipe, buf, src);
 out:
-	if (ret > 0)
+	if (ret > 0) {
 		sd->u.userptr += ret;
+		sd->pages_copied++;
+	}
 	return ret;
 }
 
@@ -1643,6 +1757,8 @@ static long vmsplice_to_pipe(struct file *file, const struct iovec __user *iov,
 		ret = spd.nr_pages;
 	else
 		ret = splice_to_pipe(pipe, &spd);
+	if (ret > 0)
+		splice_account(true, spd.nr_pages, 0);
 
 	splice_shrink_spd(&spd);
 	return ret;
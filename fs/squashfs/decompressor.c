@@ -25,6 +25,7 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/buffer_head.h>
+#include <linux/percpu.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -52,6 +53,12 @@ static const struct squashfs_decompressor squashfs_xz_comp_ops = {
 };
 #endif
 
+#ifndef CONFIG_SQUASHFS_LZ4
+static const struct squashfs_decompressor squashfs_lz4_comp_ops = {
+	NULL, NULL, NULL, LZ4_COMPRESSION, "lz4", 0
+};
+#endif
+
 static const struct squashfs_decompressor squashfs_unknown_comp_ops = {
 	NULL, NULL, NULL, 0, "unknown", 0
 };
@@ -60,11 +67,134 @@ static const struct squashfs_decompressor *decompressor[] = {
 	&squashfs_zlib_comp_ops,
 	&squashfs_lzo_comp_ops,
 	&squashfs_xz_comp_ops,
+	&squashfs_lz4_comp_ops,
 	&squashfs_lzma_unsupported_comp_ops,
 	&squashfs_unknown_comp_ops
 };
 
 
+#ifdef CONFIG_SQUASHFS_DECOMP_MULTI_PERCPU
+/*
+ * One decompressor stream for each possible cpu.  Callers decompress with
+ * preemption disabled on the stream of their cpu, and so never wait for
+ * each other.  The buffers of the block were read before, see
+ * squashfs_read_data(), so nothing sleeps while the stream is used.
+ */
+struct squashfs_stream {
+	void		*stream;
+};
+
+static void *squashfs_decompressor_create(struct squashfs_sb_info *msblk,
+	void *comp_opts, int length)
+{
+	struct squashfs_stream __percpu *percpu;
+	struct squashfs_stream *stream;
+	int err, cpu;
+
+	percpu = alloc_percpu(struct squashfs_stream);
+	if (percpu == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	for_each_possible_cpu(cpu) {
+		stream = per_cpu_ptr(percpu, cpu);
+		stream->stream = msblk->decompressor->init(msblk, comp_opts,
+			length);
+		if (IS_ERR(stream->stream)) {
+			err = PTR_ERR(stream->stream);
+			stream->stream = NULL;
+			goto failed;
+		}
+	}
+
+	return (__force void *) percpu;
+
+failed:
+	for_each_possible_cpu(cpu) {
+		stream = per_cpu_ptr(percpu, cpu);
+		if (stream->stream)
+			msblk->decompressor->free(stream->stream);
+	}
+	free_percpu(percpu);
+	return ERR_PTR(err);
+}
+
+
+void squashfs_decompressor_free(struct squashfs_sb_info *msblk, void *strm)
+{
+	struct squashfs_stream __percpu *percpu =
+			(struct squashfs_stream __percpu *) strm;
+	int cpu;
+
+	if (msblk->decompressor == NULL || strm == NULL)
+		return;
+
+	for_each_possible_cpu(cpu)
+		msblk->decompressor->free(per_cpu_ptr(percpu, cpu)->stream);
+	free_percpu(percpu);
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	struct squashfs_stream __percpu *percpu =
+			(struct squashfs_stream __percpu *) msblk->stream;
+	struct squashfs_stream *stream = get_cpu_ptr(percpu);
+	int res;
+
+	res = msblk->decompressor->decompress(msblk, stream->stream, buffer,
+		bh, b, offset, length, srclength, pages);
+	put_cpu_ptr(stream);
+
+	return res;
+}
+
+
+int squashfs_max_decompressors(void)
+{
+	return num_possible_cpus();
+}
+#else
+/*
+ * A single decompressor stream, serialised by read_data_mutex.
+ */
+static void *squashfs_decompressor_create(struct squashfs_sb_info *msblk,
+	void *comp_opts, int length)
+{
+	return msblk->decompressor->init(msblk, comp_opts, length);
+}
+
+
+void squashfs_decompressor_free(struct squashfs_sb_info *msblk, void *strm)
+{
+	if (msblk->decompressor)
+		msblk->decompressor->free(strm);
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	int res;
+
+	mutex_lock(&msblk->read_data_mutex);
+	res = msblk->decompressor->decompress(msblk, msblk->stream, buffer,
+		bh, b, offset, length, srclength, pages);
+	mutex_unlock(&msblk->read_data_mutex);
+
+	return res;
+}
+
+
+int squashfs_max_decompressors(void)
+{
+	return 1;
+}
+#endif
+
+
 const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 {
 	int i;
@@ -101,7 +231,7 @@ void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
 		}
 	}
 
-	strm = msblk->decompressor->init(msblk, buffer, length);
+	strm = squashfs_decompressor_create(msblk, buffer, length);
 
 finished:
 	kfree(buffer);
@@ -200,8 +200,13 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
-	/* Allocate read_page block */
-	msblk->read_page = squashfs_cache_init("data", 1, msblk->block_size);
+	/*
+	 * Allocate read_page blocks, at least one for each decompressor so
+	 * that they can all be busy at once
+	 */
+	msblk->read_page = squashfs_cache_init("data",
+		max(SQUASHFS_CACHED_DATA_BLKS, squashfs_max_decompressors()),
+		msblk->block_size);
 	if (msblk->read_page == NULL) {
 		ERROR("Failed to allocate read_page block\n");
 		goto failed_mount;
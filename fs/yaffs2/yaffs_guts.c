@@ -50,8 +50,8 @@ static int yaffs_wr_data_obj(struct yaffs_obj *in, int inode_chunk,
 
 /* Function to calculate chunk and offset */
 
-static void yaffs_addr_to_chunk(struct yaffs_dev *dev, loff_t addr,
-				int *chunk_out, u32 * offset_out)
+void yaffs_addr_to_chunk(struct yaffs_dev *dev, loff_t addr,
+			 int *chunk_out, u32 * offset_out)
 {
 	int chunk;
 	u32 offset;
@@ -799,6 +799,8 @@ unsigned yaffs_get_obj_type(struct yaffs_obj *obj);
 int yaffs_get_obj_link_count(struct yaffs_obj *obj);
 
 /* File operations */
+void yaffs_addr_to_chunk(struct yaffs_dev *dev, loff_t addr,
+			 int *chunk_out, u32 * offset_out);
 int yaffs_file_rd(struct yaffs_obj *obj, u8 * buffer, loff_t offset,
 		  int n_bytes);
 int yaffs_wr_file(struct yaffs_obj *obj, const u8 * buffer, loff_t offset,
@@ -18,6 +18,33 @@
 
 #include "yportenv.h"
 
+#define YAFFS_READ_CACHE_HASH_BITS	7
+
+/*
+ * Chunks of a read-only mount, kept so that readers that find theirs
+ * here copy it out without taking the gross lock.  Nothing changes the
+ * data of an (obj_id, chunk_id) pair on a read-only mount, so entries
+ * never go stale; remounting drops them all.
+ */
+struct yaffs_read_cache_entry {
+	struct hlist_node hash;
+	struct list_head lru;
+	atomic_t ref;		/* one for the cache, one per reader */
+	int obj_id;
+	int chunk_id;
+	u8 data[0];
+};
+
+struct yaffs_read_cache {
+	spinlock_t lock;
+	struct hlist_head hash[1 << YAFFS_READ_CACHE_HASH_BITS];
+	struct list_head lru;	/* most recently used first */
+	unsigned n_entries;
+	unsigned max_entries;
+	unsigned long hits;
+	unsigned long misses;
+};
+
 struct yaffs_linux_context {
 	struct list_head context_list;	/* List of these we have mounted */
 	struct yaffs_dev *dev;
@@ -33,6 +60,8 @@ struct yaffs_linux_context {
 
 	struct task_struct *readdir_process;
 	unsigned mount_id;
+
+	struct yaffs_read_cache read_cache;
 };
 
 #define yaffs_dev_to_lc(dev) ((struct yaffs_linux_context *)((dev)->os_context))
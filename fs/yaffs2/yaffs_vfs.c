@@ -54,6 +54,7 @@
 #include <linux/kthread.h>
 #include <linux/delay.h>
 #include <linux/freezer.h>
+#include <linux/hash.h>
 
 #include <asm/div64.h>
 
@@ -97,6 +98,7 @@ unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+unsigned int yaffs_read_cache_chunks = 256;
 
 /* Module Parameters */
 module_param(yaffs_trace_mask, uint, 0644);
@@ -104,6 +106,7 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_read_cache_chunks, uint, 0644);
 
 
 #define yaffs_inode_to_obj_lv(iptr) ((iptr)->i_private)
@@ -1125,6 +1128,172 @@ static void yaffs_touch_super(struct yaffs_dev *dev)
 		sb->s_dirt = 1;
 }
 
+/* Read cache for read-only mounts, see yaffs_linux.h */
+
+static void yaffs_read_cache_init(struct yaffs_dev *dev)
+{
+	struct yaffs_read_cache *rc = &yaffs_dev_to_lc(dev)->read_cache;
+	int i;
+
+	spin_lock_init(&rc->lock);
+	for (i = 0; i < (1 << YAFFS_READ_CACHE_HASH_BITS); i++)
+		INIT_HLIST_HEAD(&rc->hash[i]);
+	INIT_LIST_HEAD(&rc->lru);
+	rc->n_entries = 0;
+	rc->max_entries = dev->read_only ? yaffs_read_cache_chunks : 0;
+}
+
+static struct hlist_head *yaffs_read_cache_bucket(struct yaffs_read_cache *rc,
+						  int obj_id, int chunk_id)
+{
+	return &rc->hash[hash_long(((unsigned long)obj_id << 16) ^ chunk_id,
+				   YAFFS_READ_CACHE_HASH_BITS)];
+}
+
+static void yaffs_read_cache_put(struct yaffs_read_cache_entry *e)
+{
+	if (atomic_dec_and_test(&e->ref))
+		kfree(e);
+}
+
+static struct yaffs_read_cache_entry *
+yaffs_read_cache_get(struct yaffs_read_cache *rc, int obj_id, int chunk_id)
+{
+	struct yaffs_read_cache_entry *e;
+	struct hlist_node *node;
+
+	spin_lock(&rc->lock);
+	hlist_for_each_entry(e, node,
+			     yaffs_read_cache_bucket(rc, obj_id, chunk_id),
+			     hash) {
+		if (e->obj_id == obj_id && e->chunk_id == chunk_id) {
+			atomic_inc(&e->ref);
+			list_move(&e->lru, &rc->lru);
+			rc->hits++;
+			spin_unlock(&rc->lock);
+			return e;
+		}
+	}
+	rc->misses++;
+	spin_unlock(&rc->lock);
+	return NULL;
+}
+
+/* Another reader may have added the same chunk meanwhile, keep theirs */
+static void yaffs_read_cache_add(struct yaffs_read_cache *rc,
+				 struct yaffs_read_cache_entry *new)
+{
+	struct yaffs_read_cache_entry *e, *victim = NULL;
+	struct hlist_head *bucket;
+	struct hlist_node *node;
+
+	bucket = yaffs_read_cache_bucket(rc, new->obj_id, new->chunk_id);
+
+	spin_lock(&rc->lock);
+	hlist_for_each_entry(e, node, bucket, hash) {
+		if (e->obj_id == new->obj_id && e->chunk_id == new->chunk_id) {
+			spin_unlock(&rc->lock);
+			return;
+		}
+	}
+	atomic_inc(&new->ref);
+	hlist_add_head(&new->hash, bucket);
+	list_add(&new->lru, &rc->lru);
+	if (++rc->n_entries > rc->max_entries) {
+		victim = list_entry(rc->lru.prev,
+				    struct yaffs_read_cache_entry, lru);
+		hlist_del(&victim->hash);
+		list_del(&victim->lru);
+		rc->n_entries--;
+	}
+	spin_unlock(&rc->lock);
+
+	/* still in use by a reader, it frees the chunk when done */
+	if (victim)
+		yaffs_read_cache_put(victim);
+}
+
+static void yaffs_read_cache_flush(struct yaffs_dev *dev)
+{
+	struct yaffs_read_cache *rc = &yaffs_dev_to_lc(dev)->read_cache;
+	struct yaffs_read_cache_entry *e, *n;
+	LIST_HEAD(dead);
+
+	spin_lock(&rc->lock);
+	list_for_each_entry_safe(e, n, &rc->lru, lru) {
+		hlist_del(&e->hash);
+		list_move(&e->lru, &dead);
+	}
+	rc->n_entries = 0;
+	spin_unlock(&rc->lock);
+
+	list_for_each_entry_safe(e, n, &dead, lru) {
+		list_del(&e->lru);
+		yaffs_read_cache_put(e);
+	}
+}
+
+/*
+ * yaffs_file_rd() for read-only mounts: chunks found in the read cache
+ * are copied out without the gross lock, so that readers only queue
+ * behind each other for the chunks they have to read from flash.
+ * The rest of yaffs keeps the gross lock even for reads, as looking
+ * things up updates the short op cache, temp buffers and lazily
+ * loaded objects.
+ */
+static int yaffs_read_cache_rd(struct yaffs_obj *obj, u8 *buffer,
+			       loff_t offset, int n_bytes)
+{
+	struct yaffs_dev *dev = obj->my_dev;
+	struct yaffs_read_cache *rc = &yaffs_dev_to_lc(dev)->read_cache;
+	struct yaffs_read_cache_entry *e;
+	int n_done = 0;
+	int chunk;
+	u32 start;
+	int n_copy;
+	int ret;
+
+	while (n_bytes > 0) {
+		yaffs_addr_to_chunk(dev, offset, &chunk, &start);
+		n_copy = min_t(int, n_bytes, dev->data_bytes_per_chunk - start);
+
+		e = yaffs_read_cache_get(rc, obj->obj_id, chunk);
+		if (!e) {
+			e = kmalloc(sizeof(*e) + dev->data_bytes_per_chunk,
+				    GFP_NOFS);
+			yaffs_gross_lock(dev);
+			if (e)
+				ret = yaffs_file_rd(obj, e->data,
+						    offset - start,
+						    dev->data_bytes_per_chunk);
+			else
+				ret = yaffs_file_rd(obj, buffer, offset,
+						    n_copy);
+			yaffs_gross_unlock(dev);
+			if (ret < 0) {
+				kfree(e);
+				return ret;
+			}
+			if (e) {
+				atomic_set(&e->ref, 1);
+				e->obj_id = obj->obj_id;
+				e->chunk_id = chunk;
+				yaffs_read_cache_add(rc, e);
+			}
+		}
+		if (e) {
+			memcpy(buffer, &e->data[start], n_copy);
+			yaffs_read_cache_put(e);
+		}
+
+		offset += n_copy;
+		buffer += n_copy;
+		n_bytes -= n_copy;
+		n_done += n_copy;
+	}
+	return n_done;
+}
+
 static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 {
 	/* Lifted from jffs2 */
@@ -1149,12 +1318,19 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	pg_buf = kmap(pg);
 	/* FIXME: Can kmap fail? */
 
-	yaffs_gross_lock(dev);
+	if (yaffs_dev_to_lc(dev)->read_cache.max_entries) {
+		ret = yaffs_read_cache_rd(obj, pg_buf,
+				(loff_t)pg->index << PAGE_CACHE_SHIFT,
+				PAGE_CACHE_SIZE);
+	} else {
+		yaffs_gross_lock(dev);
 
-	ret = yaffs_file_rd(obj, pg_buf,
-			    pg->index << PAGE_CACHE_SHIFT, PAGE_CACHE_SIZE);
+		ret = yaffs_file_rd(obj, pg_buf,
+				    pg->index << PAGE_CACHE_SHIFT,
+				    PAGE_CACHE_SIZE);
 
-	yaffs_gross_unlock(dev);
+		yaffs_gross_unlock(dev);
+	}
 
 	if (ret >= 0)
 		ret = 0;
@@ -1976,6 +2152,7 @@ static void yaffs_put_super(struct super_block *sb)
 	yaffs_deinitialise(dev);
 
 	yaffs_gross_unlock(dev);
+	yaffs_read_cache_flush(dev);
 	mutex_lock(&yaffs_context_lock);
 	list_del_init(&(yaffs_dev_to_lc(dev)->context_list));
 	mutex_unlock(&yaffs_context_lock);
@@ -1998,8 +2175,27 @@ static void yaffs_mtd_put_super(struct super_block *sb)
 	put_mtd_device(mtd);
 }
 
+/*
+ * Nothing else stops a read-only mount from being remounted read-write,
+ * and the read cache must then not outlive the first write.
+ */
+static int yaffs_remount_fs(struct super_block *sb, int *flags, char *data)
+{
+	struct yaffs_dev *dev = yaffs_super_to_dev(sb);
+	struct yaffs_read_cache *rc = &yaffs_dev_to_lc(dev)->read_cache;
+
+	if (!(*flags & MS_RDONLY)) {
+		spin_lock(&rc->lock);
+		rc->max_entries = 0;
+		spin_unlock(&rc->lock);
+		yaffs_read_cache_flush(dev);
+	}
+	return 0;
+}
+
 static const struct super_operations yaffs_super_ops = {
 	.statfs = yaffs_statfs,
+	.remount_fs = yaffs_remount_fs,
 	.put_super = yaffs_put_super,
 	.evict_inode = yaffs_evict_inode,
 	.sync_fs = yaffs_sync_fs,
@@ -2321,6 +2517,7 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 	param->remove_obj_fn = yaffs_remove_obj_callback;
 
 	mutex_init(&(yaffs_dev_to_lc(dev)->gross_lock));
+	yaffs_read_cache_init(dev);
 
 	yaffs_gross_lock(dev);
 
@@ -2486,6 +2683,10 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	    sprintf(buf, "n_tags_ecc_unfixed.... %u\n",
 		    dev->n_tags_ecc_unfixed);
 	buf += sprintf(buf, "cache_hits............ %u\n", dev->cache_hits);
+	buf += sprintf(buf, "read_cache_hits....... %lu\n",
+		       yaffs_dev_to_lc(dev)->read_cache.hits);
+	buf += sprintf(buf, "read_cache_misses..... %lu\n",
+		       yaffs_dev_to_lc(dev)->read_cache.misses);
 	buf +=
 	    sprintf(buf, "n_deleted_files....... %u\n", dev->n_deleted_files);
 	buf +=
@@ -64,4 +64,7 @@
 #define SO_DOMAIN		39
 
 #define SO_RXQ_OVFL             40
+
+#define SO_BUSY_POLL		46
+#define SO_BUSY_POLL_STATS	47
 #endif /* __ASM_GENERIC_SOCKET_H */
@@ -40,6 +40,8 @@ typedef int (congested_fn)(void *, int);
 enum bdi_stat_item {
 	BDI_RECLAIMABLE,
 	BDI_WRITEBACK,
+	BDI_RA_HIT,		/* readahead pages the reader went on to */
+	BDI_RA_MISS,		/* readahead pages it left behind */
 	NR_BDI_STAT_ITEMS
 };
 
@@ -74,6 +76,15 @@ struct backing_dev_info {
 	struct prop_local_percpu completions;
 	int dirty_exceeded;
 
+	/* adaptive readahead, see bdi_ra_account_read() */
+	unsigned long ra_max_pages;	/* 0 keeps ra_pages fixed */
+	unsigned long ra_window;	/* current window in pages, 0 if none */
+	unsigned long read_bandwidth;	/* KB/s while the device is busy */
+	u64 ra_bw_bytes;
+	u64 ra_bw_ns;
+	s64 ra_last_hit;
+	s64 ra_last_miss;
+
 	unsigned int min_ratio;
 	unsigned int max_ratio, max_prop_frac;
 
@@ -195,6 +206,9 @@ static inline unsigned long bdi_stat_error(struct backing_dev_info *bdi)
 #endif
 }
 
+void bdi_ra_account_read(struct backing_dev_info *bdi, u64 bytes, u64 busy_ns);
+void bdi_set_ra_max_pages(struct backing_dev_info *bdi, unsigned long pages);
+
 int bdi_set_min_ratio(struct backing_dev_info *bdi, unsigned int min_ratio);
 int bdi_set_max_ratio(struct backing_dev_info *bdi, unsigned int max_ratio);
 
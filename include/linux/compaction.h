@@ -18,7 +18,10 @@ extern int sysctl_compaction_handler(struct ctl_table *table, int write,
 extern int sysctl_extfrag_threshold;
 extern int sysctl_extfrag_handler(struct ctl_table *table, int write,
 			void __user *buffer, size_t *length, loff_t *ppos);
+extern int sysctl_compact_proactive_order;
+extern int sysctl_compact_proactive_blocks;
 
+extern void wakeup_kcompactd(void);
 extern int fragmentation_index(struct zone *zone, unsigned int order);
 extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
 			int order, gfp_t gfp_mask, nodemask_t *mask,
@@ -79,6 +82,10 @@ static inline void defer_compaction(struct zone *zone)
 {
 }
 
+static inline void wakeup_kcompactd(void)
+{
+}
+
 static inline bool compaction_deferred(struct zone *zone)
 {
 	return 1;
@@ -337,6 +337,31 @@ static inline unsigned int cpufreq_quick_get(unsigned int cpu)
 }
 #endif
 
+/*
+ * Scheduler load input: a governor may hook a cpu to be told from the
+ * scheduler when its run queue changes, instead of sampling it from a timer.
+ * The hook runs with the run queue lock held and interrupts off, so it must
+ * not wake anything up directly; defer the actual evaluation (irq_work).
+ */
+#define SCHED_CPUFREQ_ENQUEUE	(1U << 0)
+#define SCHED_CPUFREQ_DEQUEUE	(1U << 1)
+#define SCHED_CPUFREQ_TICK	(1U << 2)
+#define SCHED_CPUFREQ_RT	(1U << 3)
+/* a latency sensitive task is queued on the cpu */
+#define SCHED_CPUFREQ_LATENCY	(1U << 4)
+
+struct update_util_data {
+	void (*func)(struct update_util_data *data, u64 time,
+		     unsigned int flags);
+};
+
+#ifdef CONFIG_CPU_FREQ
+void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
+			void (*func)(struct update_util_data *data, u64 time,
+				     unsigned int flags));
+void cpufreq_remove_update_util_hook(int cpu);
+#endif
+
 #if defined(CONFIG_CPU_FREQ_GOV_INTERACTIVE) && \
 					defined(CONFIG_OMAP4_DPLL_CASCADING)
 extern void cpufreq_interactive_set_timer_rate(unsigned long val,
@@ -422,6 +447,12 @@ void cpufreq_frequency_table_get_attr(struct cpufreq_frequency_table *table,
 
 void cpufreq_frequency_table_put_attr(unsigned int cpu);
 
+/* energy per cycle estimates, in pJ, one per entry of the table */
+extern struct freq_attr cpufreq_freq_attr_scaling_energy_per_cycle;
+
+void cpufreq_frequency_table_set_energy(const unsigned int *energy,
+					unsigned int cpu);
+
 /* the following are for use in governors, or anywhere else */
 extern int cpufreq_frequency_table_next_lowest(struct cpufreq_policy *policy,
 					struct cpufreq_frequency_table *table,
@@ -431,6 +462,10 @@ extern int cpufreq_frequency_table_next_highest(struct cpufreq_policy *policy,
 					struct cpufreq_frequency_table *table,
 					int *index);
 
+unsigned int cpufreq_frequency_table_efficient(struct cpufreq_policy *policy,
+					struct cpufreq_frequency_table *table,
+					unsigned int freq);
+
 
 extern unsigned int screen_off_max_freq;
 extern unsigned int screen_on_min_freq;
@@ -0,0 +1,32 @@
+/*
+ * Time in each cpu frequency, per task and per uid
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _LINUX_CPUFREQ_TIMES_H
+#define _LINUX_CPUFREQ_TIMES_H
+
+#include <linux/sched.h>
+
+struct seq_file;
+struct pid_namespace;
+struct pid;
+
+#ifdef CONFIG_CPU_FREQ_TIMES
+extern void cpufreq_task_times_init(struct task_struct *p);
+extern void cpufreq_task_times_exit(struct task_struct *p);
+extern void cpufreq_task_times_account(struct task_struct *p,
+				       cputime_t cputime);
+extern int proc_time_in_state_show(struct seq_file *m,
+				   struct pid_namespace *ns, struct pid *pid,
+				   struct task_struct *p);
+#else
+static inline void cpufreq_task_times_init(struct task_struct *p) {}
+static inline void cpufreq_task_times_exit(struct task_struct *p) {}
+static inline void cpufreq_task_times_account(struct task_struct *p,
+					      cputime_t cputime) {}
+#endif
+
+#endif /* _LINUX_CPUFREQ_TIMES_H */
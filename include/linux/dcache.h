@@ -208,6 +208,7 @@ struct dentry_operations {
 #define DCACHE_CANT_MOUNT	0x0100
 #define DCACHE_GENOCIDE		0x0200
 #define DCACHE_SHRINK_LIST	0x0400
+#define DCACHE_NEGATIVE_LRU	0x0800	/* counted in s_nr_negative_dentry */
 
 #define DCACHE_OP_HASH		0x1000
 #define DCACHE_OP_COMPARE	0x2000
@@ -424,5 +425,9 @@ static inline bool d_mountpoint(struct dentry *dentry)
 extern struct dentry *lookup_create(struct nameidata *nd, int is_dir);
 
 extern int sysctl_vfs_cache_pressure;
+extern int sysctl_negative_dentry_limit;
+
+extern void d_lookup_hit(int negative);
+extern void d_lookup_miss(s64 ns);
 
 #endif	/* __LINUX_DCACHE_H */
@@ -125,6 +125,36 @@ struct list_head node;
 void *priv;
 };
 
+struct dma_buf_map;
+
+/**
+ * struct dma_buf_map_cache - importer side cache of mapped attachments
+ * @dev: device the buffers are attached to.
+ * @dir: direction the buffers are mapped for.
+ * @size: number of mappings kept once they are no longer in use.
+ * @count: number of mappings cached.
+ * @lru: mappings, most recently used first.
+ * @lock: protects all of the above and the counters.
+ * @hits: lookups that found their buffer mapped.
+ * @misses: lookups that had to attach and map it.
+ * @evictions: mappings dropped to stay within @size.
+ *
+ * Keeps the attachment and sg_table of the buffers a device keeps coming
+ * back to, so that only the first use of a buffer pays for the attach and
+ * the map.
+ */
+struct dma_buf_map_cache {
+	struct device *dev;
+	enum dma_data_direction dir;
+	unsigned int size;
+	unsigned int count;
+	struct list_head lru;
+	struct mutex lock;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+};
+
 /**
  * get_dma_buf - convenience wrapper for get_file.
  * @dmabuf: [in] pointer to dma_buf
@@ -163,6 +193,16 @@ void dma_buf_kunmap(struct dma_buf *, unsigned long, void *);
 
 int dma_buf_mmap(struct dma_buf *, struct vm_area_struct *,
  unsigned long);
+
+void dma_buf_map_cache_init(struct dma_buf_map_cache *cache,
+			    struct device *dev, enum dma_data_direction dir,
+			    unsigned int size);
+struct dma_buf_map *dma_buf_map_cache_get(struct dma_buf_map_cache *cache,
+					  struct dma_buf *dmabuf);
+struct sg_table *dma_buf_map_sg_table(struct dma_buf_map *map);
+void dma_buf_map_cache_put(struct dma_buf_map_cache *cache,
+			   struct dma_buf_map *map);
+void dma_buf_map_cache_flush(struct dma_buf_map_cache *cache);
 #else
 static inline struct dma_buf_attachment *dma_buf_attach(struct dma_buf *dmabuf,
 struct device *dev)
@@ -244,5 +284,36 @@ static inline int dma_buf_mmap(struct dma_buf *dmabuf,
  return -ENODEV;
 }
 
+
+static inline void dma_buf_map_cache_init(struct dma_buf_map_cache *cache,
+					  struct device *dev,
+					  enum dma_data_direction dir,
+					  unsigned int size)
+{
+	/* keeps the counters and lock of an unused cache readable */
+	memset(cache, 0, sizeof(*cache));
+	INIT_LIST_HEAD(&cache->lru);
+	mutex_init(&cache->lock);
+}
+
+static inline struct dma_buf_map *dma_buf_map_cache_get(
+	struct dma_buf_map_cache *cache, struct dma_buf *dmabuf)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline struct sg_table *dma_buf_map_sg_table(struct dma_buf_map *map)
+{
+	return NULL;
+}
+
+static inline void dma_buf_map_cache_put(struct dma_buf_map_cache *cache,
+					 struct dma_buf_map *map)
+{
+}
+
+static inline void dma_buf_map_cache_flush(struct dma_buf_map_cache *cache)
+{
+}
 #endif /* CONFIG_DMA_SHARED_BUFFER */
 #endif /* __DMA_BUF_H__ */
@@ -18,6 +18,7 @@
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/list.h>
+#include <linux/types.h>
 #endif
 
 /* The early_suspend structure defines suspend and resume hooks to be called
@@ -29,18 +30,32 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ *
+ * An EARLY_SUSPEND_ASYNC handler is started in its turn but does not hold up
+ * the ones after it, which must not depend on it; all of them have returned
+ * by the end of early suspend or late resume.  EARLY_SUSPEND_RESUME_FIRST
+ * handlers, the display and the touchscreen, are resumed before all others,
+ * still in reverse level order among themselves.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
 	EARLY_SUSPEND_LEVEL_STOP_DRAWING = 100,
 	EARLY_SUSPEND_LEVEL_DISABLE_FB = 150,
 };
+
+#define EARLY_SUSPEND_ASYNC		(1U << 0)
+#define EARLY_SUSPEND_RESUME_FIRST	(1U << 1)
+
 struct early_suspend {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct list_head link;
 	int level;
+	unsigned int flags;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	/* duration of the last and slowest calls, in usecs */
+	u32 suspend_us, max_suspend_us;
+	u32 resume_us, max_resume_us;
 #endif
 };
 
@@ -68,6 +68,9 @@ static inline void eventpoll_init_file(struct file *file)
 /* Used to release the epoll bits inside the "struct file" */
 void eventpoll_release_file(struct file *file);
 
+/* Used to show the wakeup statistics of an epoll file in its fdinfo */
+int eventpoll_fdinfo(struct file *file, char *buf, int size);
+
 /*
  * This is called from inside fs/file_table.c:__fput() to unlink files
  * from the eventpoll interface. We need to have this facility to cleanup
@@ -100,6 +103,10 @@ static inline void eventpoll_release(struct file *file)
 
 static inline void eventpoll_init_file(struct file *file) {}
 static inline void eventpoll_release(struct file *file) {}
+static inline int eventpoll_fdinfo(struct file *file, char *buf, int size)
+{
+	return 0;
+}
 
 #endif
 
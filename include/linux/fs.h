@@ -391,6 +391,7 @@ struct inodes_stat_t {
 #include <linux/semaphore.h>
 #include <linux/fiemap.h>
 #include <linux/rculist_bl.h>
+#include <linux/workqueue.h>
 
 #include <asm/atomic.h>
 #include <asm/byteorder.h>
@@ -1399,6 +1400,8 @@ struct super_block {
 	/* s_dentry_lru, s_nr_dentry_unused protected by dcache.c lru locks */
 	struct list_head	s_dentry_lru;	/* unused dentry lru */
 	int			s_nr_dentry_unused;	/* # of dentry on lru */
+	int			s_nr_negative_dentry;	/* # of them negative */
+	struct work_struct	s_negative_prune_work;
 
 	struct block_device	*s_bdev;
 	struct backing_dev_info *s_bdi;
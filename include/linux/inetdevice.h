@@ -38,6 +38,8 @@ enum
 	IPV4_DEVCONF_ACCEPT_LOCAL,
 	IPV4_DEVCONF_SRC_VMARK,
 	IPV4_DEVCONF_PROXY_ARP_PVLAN,
+	IPV4_DEVCONF_TCP_INITCWND,
+	IPV4_DEVCONF_TCP_INITRWND,
 	__IPV4_DEVCONF_MAX
 };
 
@@ -158,6 +158,19 @@ extern void (*late_time_init)(void);
 
 extern int initcall_debug;
 
+/*
+ * An initcall that may run asynchronously, see __define_async_initcall().
+ * @after is the one it has to wait for, if any.
+ */
+struct async_initcall {
+	initcall_t fn;
+	struct async_initcall *after;
+	unsigned long long cookie;
+	int scheduled;
+};
+
+extern int async_initcall(struct async_initcall *ac);
+
 #endif
   
 #ifndef MODULE
@@ -211,6 +224,50 @@ extern int initcall_debug;
 
 #define __initcall(fn) device_initcall(fn)
 
+/*
+ * With CONFIG_ASYNC_INITCALLS, an async initcall is handed to a thread
+ * as its turn comes in the level, and the level's _sync initcalls only
+ * start once all of them have returned.  Without it, it is a plain
+ * initcall of that level.
+ *
+ * The _after variants wait for @dep, another async initcall of the same
+ * or an earlier level, to have returned first: they are for drivers that
+ * need what @dep registers, a regulator or an I2C client, and which
+ * would otherwise find it missing.  DECLARE_ASYNC_INITCALL() makes @dep
+ * visible when it lives in another file.  Anything else an async
+ * initcall relies on must be finished by the end of an earlier level.
+ */
+#define DECLARE_ASYNC_INITCALL(fn) \
+	extern struct async_initcall __async_initcall_##fn
+
+#define __define_async_initcall(level,fn,id,dep) \
+	struct async_initcall __async_initcall_##fn __initdata = { fn, dep }; \
+	static int __init __async_initcall_call_##fn(void) \
+	{ return async_initcall(&__async_initcall_##fn); } \
+	__define_initcall(level,__async_initcall_call_##fn,id)
+
+#define core_initcall_async(fn) \
+	__define_async_initcall("1",fn,1,NULL)
+#define postcore_initcall_async(fn) \
+	__define_async_initcall("2",fn,2,NULL)
+#define arch_initcall_async(fn) \
+	__define_async_initcall("3",fn,3,NULL)
+#define subsys_initcall_async(fn) \
+	__define_async_initcall("4",fn,4,NULL)
+#define fs_initcall_async(fn) \
+	__define_async_initcall("5",fn,5,NULL)
+#define device_initcall_async(fn) \
+	__define_async_initcall("6",fn,6,NULL)
+#define late_initcall_async(fn) \
+	__define_async_initcall("7",fn,7,NULL)
+
+#define subsys_initcall_async_after(fn, dep) \
+	__define_async_initcall("4",fn,4,&__async_initcall_##dep)
+#define device_initcall_async_after(fn, dep) \
+	__define_async_initcall("6",fn,6,&__async_initcall_##dep)
+#define late_initcall_async_after(fn, dep) \
+	__define_async_initcall("7",fn,7,&__async_initcall_##dep)
+
 #define __exitcall(fn) \
 	static exitcall_t __exitcall_##fn __exit_call = fn
 
@@ -289,6 +346,18 @@ void __init parse_early_options(char *cmdline);
 #define device_initcall(fn)		module_init(fn)
 #define late_initcall(fn)		module_init(fn)
 
+#define DECLARE_ASYNC_INITCALL(fn)
+#define core_initcall_async(fn)		module_init(fn)
+#define postcore_initcall_async(fn)	module_init(fn)
+#define arch_initcall_async(fn)		module_init(fn)
+#define subsys_initcall_async(fn)	module_init(fn)
+#define fs_initcall_async(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
+#define late_initcall_async(fn)		module_init(fn)
+#define subsys_initcall_async_after(fn, dep)	module_init(fn)
+#define device_initcall_async_after(fn, dep)	module_init(fn)
+#define late_initcall_async_after(fn, dep)	module_init(fn)
+
 #define security_initcall(fn)		module_init(fn)
 
 /* Each module must use one module_init(). */
@@ -132,6 +132,9 @@ struct input_keymap_entry {
 #define EVIOCGSUSPENDBLOCK	_IOR('E', 0x91, int)			/* get suspend block enable */
 #define EVIOCSSUSPENDBLOCK	_IOW('E', 0x91, int)			/* set suspend block enable */
 
+#define EVIOCSBATCH		_IOW('E', 0x92, int)			/* deliver events per display frame */
+#define EVIOCGBATCH(len)	_IOC(_IOC_READ, 'E', 0x93, len)		/* read the events of the frames gone by */
+
 /*
  * Device properties and quirks
  */
@@ -1135,6 +1138,8 @@ struct ff_effect {
 #include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
+#include <linux/notifier.h>
 #include <linux/mod_devicetable.h>
 
 /**
@@ -1214,6 +1219,9 @@ struct ff_effect {
  * @going_away: marks devices that are in a middle of unregistering and
  *	causes input_open_device*() fail with -ENODEV.
  * @sync: set to %true when there were no new events since last EV_SYN
+ * @timestamp: when the events up to the next EV_SYN/SYN_REPORT happened,
+ *	if the driver knows better than the time they are reported at; see
+ *	input_set_timestamp()
  * @dev: driver model's view of this device
  * @h_list: list of input handles associated with the device. When
  *	accessing the list dev->mutex must be held
@@ -1283,6 +1291,8 @@ struct input_dev {
 
 	bool sync;
 
+	ktime_t timestamp;
+
 	struct device dev;
 
 	struct list_head	h_list;
@@ -1509,6 +1519,26 @@ static inline void input_mt_sync(struct input_dev *dev)
 	input_event(dev, EV_SYN, SYN_MT_REPORT, 0);
 }
 
+/**
+ * input_set_timestamp - set the time of the events of the current packet
+ * @dev: input device
+ * @timestamp: CLOCK_MONOTONIC time, typically of the interrupt telling
+ *	the driver about them
+ *
+ * Handlers stamp the events reported up to the next input_sync() with
+ * it rather than with the time they get them at, after the driver is
+ * done talking to the device.
+ */
+static inline void input_set_timestamp(struct input_dev *dev,
+				       ktime_t timestamp)
+{
+	dev->timestamp = timestamp;
+}
+
+void input_vsync(ktime_t timestamp);
+int input_register_vsync_notifier(struct notifier_block *nb);
+int input_unregister_vsync_notifier(struct notifier_block *nb);
+
 void input_set_capability(struct input_dev *dev, unsigned int type, unsigned int code);
 
 /**
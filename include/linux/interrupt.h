@@ -237,6 +237,12 @@ extern int irq_select_affinity(unsigned int irq);
 
 extern int irq_set_affinity_hint(unsigned int irq, const struct cpumask *m);
 
+#ifdef CONFIG_IRQ_BALANCE
+extern void irq_set_balance_avoid_fg(unsigned int irq, bool avoid);
+#else
+static inline void irq_set_balance_avoid_fg(unsigned int irq, bool avoid) { }
+#endif
+
 /**
  * struct irq_affinity_notify - context for notification of IRQ affinity changes
  * @irq:		Interrupt to which notification applies
@@ -284,6 +290,8 @@ static inline int irq_set_affinity_hint(unsigned int irq,
 {
 	return -EINVAL;
 }
+
+static inline void irq_set_balance_avoid_fg(unsigned int irq, bool avoid) { }
 #endif /* CONFIG_SMP && CONFIG_GENERIC_HARDIRQS */
 
 #ifdef CONFIG_GENERIC_HARDIRQS
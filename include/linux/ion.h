@@ -54,6 +54,7 @@ struct ion_heap;
 struct ion_mapper;
 struct ion_client;
 struct ion_buffer;
+struct dma_buf;
 
 /* This should be removed some day when phys_addr_t's are fully
    plumbed in the kernel, and all instances of ion_phys_addr_t should
@@ -249,6 +250,37 @@ struct ion_handle *ion_import(struct ion_client *client,
  * the handle to use to refer to it further.
  */
 struct ion_handle *ion_import_fd(struct ion_client *client, int fd);
+
+/**
+ * ion_share_dma_buf() - export a handle's buffer as a dma-buf
+ * @client:	the client
+ * @handle:	the handle to export
+ *
+ * The dma-buf holds its own reference to the buffer, so the handle may be
+ * freed while the dma-buf lives on.  Attachments to it keep their sg_table
+ * from the first map until they are detached.
+ */
+struct dma_buf *ion_share_dma_buf(struct ion_client *client,
+				  struct ion_handle *handle);
+
+/**
+ * ion_share_dma_buf_fd() - export a handle's buffer as a dma-buf fd
+ * @client:	the client
+ * @handle:	the handle to export
+ *
+ * Returns a close-on-exec file descriptor for the dma-buf or a negative error.
+ */
+int ion_share_dma_buf_fd(struct ion_client *client, struct ion_handle *handle);
+
+/**
+ * ion_import_dma_buf() - import a dma-buf fd exported by ion
+ * @client:	this blocks client
+ * @fd:		the dma-buf fd
+ *
+ * Returns the client's handle for the underlying buffer.  ion_import_fd()
+ * falls back to this when given something other than a share fd.
+ */
+struct ion_handle *ion_import_dma_buf(struct ion_client *client, int fd);
 #endif /* __KERNEL__ */
 
 /**
@@ -331,6 +363,40 @@ struct ion_cached_user_buf_data {
 	size_t size;
 };
 
+/* cache operations for ION_IOC_CACHE_RANGE */
+#define ION_CACHE_OP_CLEAN		0
+#define ION_CACHE_OP_INVALIDATE		1
+#define ION_CACHE_OP_FLUSH		2
+#define ION_CACHE_OP_MARK_DIRTY		3
+
+/* only clean the part of the range recorded dirty, skip it if clean */
+#define ION_CACHE_RANGE_DIRTY_ONLY	0x1
+
+/**
+ * struct ion_cached_user_range_data - metadata passed from userspace for
+ * maintaining part of a buffer which was mapped cacheable.
+ * @handle:	a handle
+ * @vaddr:	virtual address the start of the buffer is mapped at
+ * @offset:	offset of the range into the buffer
+ * @size:	size of the range
+ * @op:		one of the ION_CACHE_OP_* operations
+ * @flags:	ION_CACHE_RANGE_* flags
+ *
+ * The kernel keeps a dirty region per buffer.  It covers the whole buffer
+ * once it is mapped cacheable, grows with ION_CACHE_OP_MARK_DIRTY and
+ * shrinks as ranges are cleaned, flushed or invalidated.  Writers that
+ * report what they touched with ION_CACHE_OP_MARK_DIRTY can then pass
+ * ION_CACHE_RANGE_DIRTY_ONLY to have clean buffers skip maintenance.
+ */
+struct ion_cached_user_range_data {
+	struct ion_handle *handle;
+	unsigned long vaddr;
+	size_t offset;
+	size_t size;
+	unsigned int op;
+	unsigned int flags;
+};
+
 #define ION_IOC_MAGIC		'I'
 
 /**
@@ -392,4 +458,23 @@ struct ion_cached_user_buf_data {
 #define ION_IOC_INVAL_CACHED	_IOWR(ION_IOC_MAGIC, 8, \
 					struct ion_cached_user_buf_data)
 
+/**
+ * DOC: ION_IOC_CACHE_RANGE - maintain part of a cacheable buffer
+ *
+ * Takes an ion_cached_user_range_data struct and cleans, invalidates or
+ * flushes the given range of the buffer, or records it as dirty.
+ */
+#define ION_IOC_CACHE_RANGE	_IOWR(ION_IOC_MAGIC, 9, \
+					struct ion_cached_user_range_data)
+
+/**
+ * DOC: ION_IOC_SHARE_DMA_BUF - creates a dma-buf file descriptor for a handle
+ *
+ * Takes an ion_fd_data struct with the handle field populated with a valid
+ * opaque handle.  Returns the struct with the fd field set to a dma-buf file
+ * descriptor, which can be mmapped, passed to another process or handed to
+ * any driver that imports dma-bufs, and which ION_IOC_IMPORT also accepts.
+ */
+#define ION_IOC_SHARE_DMA_BUF	_IOWR(ION_IOC_MAGIC, 10, struct ion_fd_data)
+
 #endif /* _LINUX_ION_H */
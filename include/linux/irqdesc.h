@@ -11,6 +11,41 @@
 struct irq_affinity_notify;
 struct proc_dir_entry;
 struct timer_rand_state;
+
+#ifdef CONFIG_IRQ_BALANCE
+/**
+ * struct irq_balance - handler timing and balancing state of an irq
+ * @hard_ns:		total time spent in the hard irq handlers
+ * @thread_ns:		total time spent in the threaded handlers
+ * @wait_ns:		total time from hard irq to threaded handler start
+ * @hard_max_ns:	longest hard irq handling
+ * @thread_max_ns:	longest threaded handler run
+ * @wait_max_ns:	longest hard irq to threaded handler start
+ * @nr_hard:		number of hard irqs handled
+ * @nr_thread:		number of threaded handler runs
+ * @hard_stamp:		entry time of the last hard irq
+ * @last_cost:		handler time seen by the last balancing pass
+ * @last_thread:	threaded handler time seen by the last balancing pass
+ * @pinned:		affinity was set from user space, do not balance
+ * @avoid_fg:		keep away from cpus running foreground tasks
+ */
+struct irq_balance {
+	u64		hard_ns;
+	u64		thread_ns;
+	u64		wait_ns;
+	u64		hard_max_ns;
+	u64		thread_max_ns;
+	u64		wait_max_ns;
+	unsigned int	nr_hard;
+	unsigned int	nr_thread;
+	u64		hard_stamp;
+	u64		last_cost;
+	u64		last_thread;
+	bool		pinned;
+	bool		avoid_fg;
+};
+#endif
+
 /**
  * struct irq_desc - interrupt descriptor
  * @irq_data:		per irq and chip data passed down to chip functions
@@ -34,6 +69,7 @@ struct timer_rand_state;
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
  * @dir:		/proc/irq/ procfs entry
+ * @balance:		handler timing and balancing state
  * @name:		flow handler name for /proc/interrupts output
  */
 struct irq_desc {
@@ -64,6 +100,9 @@ struct irq_desc {
 	wait_queue_head_t       wait_for_threads;
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
+#endif
+#ifdef CONFIG_IRQ_BALANCE
+	struct irq_balance	balance;
 #endif
 	const char		*name;
 } ____cacheline_internodealigned_in_smp;
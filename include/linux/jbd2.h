@@ -685,6 +685,11 @@ struct transaction_run_stats_s {
 struct transaction_stats_s {
 	unsigned long		ts_tid;
 	struct transaction_run_stats_s run;
+
+	/* Callers that had to wait for a commit, e.g. from fsync, in ns */
+	unsigned long		ts_commit_waits;
+	u64			ts_commit_wait_time;
+	u64			ts_commit_wait_max;
 };
 
 static inline unsigned long
@@ -421,6 +421,13 @@ static inline void tracing_off_permanent(void) { }
 static inline int tracing_is_on(void) { return 0; }
 #endif
 
+#ifdef CONFIG_TRACER_SNAPSHOT
+/* freeze the last moments of the trace, if userspace armed a snapshot */
+void tracing_snapshot_trigger(const char *why);
+#else
+static inline void tracing_snapshot_trigger(const char *why) { }
+#endif
+
 enum ftrace_dump_mode {
 	DUMP_NONE,
 	DUMP_ALL,
@@ -0,0 +1,37 @@
+/* Power of two histograms
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _LINUX_LOG2_HIST_H
+#define _LINUX_LOG2_HIST_H
+
+#include <linux/types.h>
+#include <linux/bitops.h>
+
+/*
+ * A log2 histogram of nr buckets, as kept by the latency statistics:
+ * bucket 0 counts the values under 1, bucket i those under 2^i and the
+ * last bucket everything from 2^(nr - 2) up.  Callers scale the value
+ * to the unit of the first bucket beforehand, usually with a shift.
+ */
+static inline unsigned int log2_hist_bucket(u64 val, unsigned int nr)
+{
+	unsigned int i = fls64(val);
+
+	return i < nr ? i : nr - 1;
+}
+
+/*
+ * The bound to print for bucket @i: the values it holds are below it,
+ * except for the last bucket whose values are at or above it.
+ */
+static inline u64 log2_hist_bound(unsigned int i, unsigned int nr)
+{
+	return i < nr - 1 ? 1ULL << i : 1ULL << (nr - 2);
+}
+
+#endif /* _LINUX_LOG2_HIST_H */
@@ -261,6 +261,9 @@ struct mm_struct {
 
 	unsigned long hiwater_rss;	/* High-watermark of RSS usage */
 	unsigned long hiwater_vm;	/* High-water virtual memory usage */
+	atomic_long_t fault_around;	/* Faults saved by fault-around */
+	unsigned long smaps_pss;	/* kB, Pss of the last full smaps read */
+	unsigned long smaps_pss_time;	/* jiffies then, 0 if never read */
 
 	unsigned long total_vm, locked_vm, shared_vm, exec_vm;
 	unsigned long stack_vm, reserved_vm, def_flags, nr_ptes;
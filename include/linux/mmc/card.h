@@ -12,6 +12,7 @@
 
 #include <linux/mmc/core.h>
 #include <linux/mod_devicetable.h>
+#include <linux/spinlock.h>
 
 struct mmc_cid {
 	unsigned int		manfid;
@@ -50,6 +51,13 @@ struct mmc_ext_csd {
 	u8			rel_sectors;
 	u8			rel_param;
 	u8			part_config;
+	u8			max_packed_writes;
+	u8			max_packed_reads;
+	bool			packed_event_en;	/* packed failures reported */
+	bool			cache_ctrl;		/* cache enabled */
+	unsigned int		cache_size;		/* Units: KB */
+	unsigned int		generic_cmd6_time;	/* Units: ms */
+	unsigned int		data_sector_size;	/* 512 bytes or 4KB */
 	unsigned int		part_time;		/* Units: ms */
 	unsigned int		sa_timeout;		/* Units: 100ns */
 	unsigned int		hs_max_dtr;
@@ -79,6 +87,28 @@ struct mmc_ext_csd {
 	u8			raw_sectors[4];		/* 212 - 4 bytes */
 };
 
+/* requests that fit in a single block packed command header */
+#define MMC_PACKED_MAX_ENTRIES	63
+
+/* why a packed write did not take in more requests */
+enum mmc_packed_stop_reason {
+	MMC_PACKED_STOP_EMPTY_QUEUE,
+	MMC_PACKED_STOP_MAX_ENTRIES,
+	MMC_PACKED_STOP_SECTORS,
+	MMC_PACKED_STOP_SEGMENTS,
+	MMC_PACKED_STOP_DIRECTION,
+	MMC_PACKED_STOP_FLUSH_DISCARD,
+	MMC_PACKED_STOP_REL_WRITE,
+	MMC_PACKED_STOP_MAX,
+};
+
+struct mmc_wr_pack_stats {
+	spinlock_t		lock;
+	u32			packs[MMC_PACKED_MAX_ENTRIES + 1];	/* by size */
+	u32			stop_reason[MMC_PACKED_STOP_MAX];
+	u32			failures;	/* packed commands that failed */
+};
+
 struct sd_scr {
 	unsigned char		sda_vsn;
 	unsigned char		sda_spec3;
@@ -218,6 +248,12 @@ struct mmc_card {
 
 	unsigned int		sd_bus_speed;	/* Bus Speed Mode set for the card */
 
+	unsigned int		max_packed_wr;	/* requests per packed write, */
+						/* below 2 disables packing */
+	struct mmc_wr_pack_stats wr_pack_stats;
+
+	bool			cache_dirty;	/* written since the last flush */
+
 	struct dentry		*debugfs_root;
 };
 
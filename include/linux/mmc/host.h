@@ -108,6 +108,26 @@ struct mmc_host_ops {
 	int (*enable)(struct mmc_host *host);
 	int (*disable)(struct mmc_host *host, int lazy);
 	void	(*request)(struct mmc_host *host, struct mmc_request *req);
+	/*
+	 * Optional, for asynchronous requests.  pre_req is called before a
+	 * request is started, usually while the previous one is still in
+	 * flight, so that its DMA mapping is not on the critical path;
+	 * is_first_req is set when the host is idle.  post_req undoes the
+	 * work of pre_req once the request has completed, or with a non
+	 * zero err if it was prepared but never started.
+	 */
+	void	(*pre_req)(struct mmc_host *host, struct mmc_request *req,
+			   bool is_first_req);
+	void	(*post_req)(struct mmc_host *host, struct mmc_request *req,
+			    int err);
+	/*
+	 * Optional, stop the data transfer of the request in flight at the
+	 * block it has got to and complete the request with bytes_xfered
+	 * set to what reached the card.  Called in process context from
+	 * the thread waiting on the request.  Returns 0 if the request was
+	 * stopped, non zero if it is completing normally.
+	 */
+	int	(*stop_request)(struct mmc_host *host);
 	/*
 	 * Avoid calling these three functions too often or in a "fast path",
 	 * since underlaying controller might implement them in an expensive
@@ -143,6 +163,19 @@ struct mmc_host_ops {
 };
 
 struct mmc_card;
+
+/* a request issued with mmc_start_req() */
+struct mmc_async_req {
+	struct mmc_request	*mrq;
+	/*
+	 * Check the status of the completed request, 0 for success.  On
+	 * an error the request queued behind it is not started.
+	 */
+	int (*err_check)(struct mmc_card *, struct mmc_async_req *);
+	bool			preemptible;	/* may be stopped early */
+	bool			stopped;	/* was stopped early */
+};
+
 struct device;
 
 struct mmc_host {
@@ -256,6 +289,9 @@ struct mmc_host {
 	struct delayed_work	disable;	/* disabling work */
 
 	struct mmc_card		*card;		/* device attached to this host */
+	struct mmc_async_req	*areq;		/* request in flight */
+	wait_queue_head_t	req_wait;	/* for areq or a preemption */
+	bool			preempt;	/* areq wanted stopped */
 
 	wait_queue_head_t	wq;
 	struct task_struct	*claimer;	/* task that has host claimed */
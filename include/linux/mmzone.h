@@ -106,6 +106,15 @@ enum zone_stat_item {
 	NR_SHMEM,		/* shmem pages (included tmpfs/GEM pages) */
 	NR_DIRTIED,		/* page dirtyings since bootup */
 	NR_WRITTEN,		/* page writings since bootup */
+	WORKINGSET_REFAULT,	/* evicted file pages faulted back in */
+	WORKINGSET_ACTIVATE,	/* refaults activated as working set */
+	/* driver memory taken straight from the page allocator */
+	NR_ZSPAGES,		/* zsmalloc pool pages, zram */
+	NR_ION_PAGES,		/* backing ion buffers */
+	NR_ION_POOL_PAGES,	/* in ion page pools, reclaimable */
+	NR_PVR_PAGES,		/* backing pvr allocations */
+	NR_PVR_POOL_PAGES,	/* in the pvr page pool, reclaimable */
+	NR_BINDER_PAGES,	/* binder transaction buffers */
 #ifdef CONFIG_NUMA
 	NUMA_HIT,		/* allocated in intended node */
 	NUMA_MISS,		/* allocated in non intended node */
@@ -196,8 +205,26 @@ enum zone_watermarks {
 };
 
 #define min_wmark_pages(z) (z->watermark[WMARK_MIN])
-#define low_wmark_pages(z) (z->watermark[WMARK_LOW])
-#define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
+#define low_wmark_pages(z) (z->watermark[WMARK_LOW] + z->watermark_boost)
+#define high_wmark_pages(z) (z->watermark[WMARK_HIGH] + z->watermark_boost)
+
+/* direct reclaim time, log2 histogram of 1us buckets (linux/log2_hist.h) */
+#define RECLAIM_STALL_BUCKETS	20
+
+/*
+ * Orders above 0 the per-cpu lists also keep, for kernel stacks, slabs
+ * and skb data.  Their high mark and batch are derived from the order-0
+ * ones by pcp_order_batch().
+ */
+#define PCP_MAX_ORDER	2
+
+struct per_cpu_order_pages {
+	int count;		/* number of blocks in the lists */
+	unsigned long hits;	/* allocations served from the lists */
+	unsigned long refills;	/* allocations that had to refill them */
+
+	struct list_head lists[MIGRATE_PCPTYPES];
+};
 
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
@@ -206,6 +233,9 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+
+	/* Blocks of order 1 to PCP_MAX_ORDER, at orders[order - 1] */
+	struct per_cpu_order_pages orders[PCP_MAX_ORDER];
 };
 
 struct per_cpu_pageset {
@@ -311,6 +341,9 @@ struct zone {
 	/* zone watermarks, access with *_wmark_pages(zone) macros */
 	unsigned long watermark[NR_WMARK];
 
+	/* added to the low and high watermarks after allocation stalls */
+	unsigned long watermark_boost;
+
 	/*
 	 * When free pages are below this point, additional steps are taken
 	 * when reading the number of free pages to avoid per-cpu counter
@@ -376,6 +409,12 @@ struct zone {
 
 	struct zone_reclaim_stat reclaim_stat;
 
+	/* Evictions and activations, for refault distances: workingset.c */
+	atomic_long_t		inactive_age;
+
+	/* Direct reclaim runs that preferred this zone, by duration */
+	unsigned long		reclaim_stall[RECLAIM_STALL_BUCKETS];
+
 	unsigned long		pages_scanned;	   /* since last reclaim */
 	unsigned long		flags;		   /* zone flags, see below */
 
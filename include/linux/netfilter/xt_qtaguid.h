@@ -10,4 +10,11 @@
 #define XT_QTAGUID_SOCKET XT_OWNER_SOCKET
 #define xt_qtaguid_match_info xt_owner_match_info
 
+#ifdef __KERNEL__
+struct net_device;
+
+extern void qtaguid_account_iface(const struct net_device *dev, bool tx,
+				  int proto, unsigned int bytes);
+#endif
+
 #endif /* _XT_QTAGUID_MATCH_H */
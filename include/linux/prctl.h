@@ -108,4 +108,22 @@
  */
 #define PR_SET_TIMERSLACK_PID 41
 
+/*
+ * Marks arbitrary threads as latency sensitive for cpufreq, and the tasks
+ * they wake up until those sleep again.
+ * arg2 0 to clear, non-zero to set
+ * arg3 pid of the thread, 0 for the calling thread
+ */
+#define PR_SET_LATENCY_SENSITIVE_PID 42
+
+/*
+ * Have fork() leave out of the child the ptes of the page cache pages
+ * the calling process maps, for them to be faulted in on first access,
+ * instead of copying them.  For a zygote whose children use only some
+ * of the files it has mapped.  Not inherited.
+ * arg2 0 to clear, non-zero to set
+ */
+#define PR_SET_FORK_LAZY 43
+#define PR_GET_FORK_LAZY 44
+
 #endif /* _LINUX_PRCTL_H */
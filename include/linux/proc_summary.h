@@ -0,0 +1,36 @@
+#ifndef _LINUX_PROC_SUMMARY_H
+#define _LINUX_PROC_SUMMARY_H
+
+#include <linux/types.h>
+
+/*
+ * One process, as read from /proc/<pid>/summary, or one after the other
+ * for every process from /proc/summary.  All of it comes from counters
+ * the kernel keeps anyway: reading it walks no page tables and takes no
+ * mmap_sem.  Append new fields at the end and check ps_size, the size of
+ * the record as the kernel wrote it.
+ */
+struct proc_summary {
+	__u32	ps_size;		/* of this record */
+	__s32	ps_pid;
+	__s32	ps_ppid;
+	__u32	ps_uid;
+	__s32	ps_oom_score_adj;
+	__u32	ps_threads;
+	__u8	ps_state;		/* as in /proc/<pid>/stat */
+	__u8	ps_pad[3];
+	__u32	ps_pss_age_ms;		/* ~0 if smaps was never read */
+	char	ps_comm[16];
+	__u64	ps_utime_ns;		/* all threads, live and dead */
+	__u64	ps_stime_ns;
+	__u64	ps_start_time_ns;	/* since boot */
+	__u64	ps_min_flt;
+	__u64	ps_maj_flt;
+	__u64	ps_vm_kb;
+	__u64	ps_rss_anon_kb;
+	__u64	ps_rss_file_kb;
+	__u64	ps_swap_kb;
+	__u64	ps_pss_kb;		/* of the last complete smaps read */
+};
+
+#endif /* _LINUX_PROC_SUMMARY_H */
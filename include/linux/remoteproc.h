@@ -38,6 +38,7 @@
 #include <linux/workqueue.h>
 #include <linux/notifier.h>
 #include <linux/pm_qos.h>
+#include <linux/ktime.h>
 
 /* Must match the BIOS version embeded in the BIOS firmware image */
 #define RPROC_BIOS_VERSION	2
@@ -212,6 +213,28 @@ enum rproc_event {
 
 #define RPROC_MAX_NAME	100
 
+/*
+ * enum rproc_resume_mode - how a remote processor was brought back for use
+ *
+ * @RPROC_RESUME_COLD: firmware loaded and booted, from rproc_get()
+ * @RPROC_RESUME_WARM: rproc_get() of a processor kept loaded after its last
+ * rproc_put()
+ * @RPROC_RESUME_RUNTIME: woken up from runtime suspend, which keeps its
+ * memory and iommu page tables, by rproc_last_busy()
+ */
+enum rproc_resume_mode {
+	RPROC_RESUME_COLD,
+	RPROC_RESUME_WARM,
+	RPROC_RESUME_RUNTIME,
+	RPROC_RESUME_MODES,
+};
+
+struct rproc_resume_stats {
+	unsigned long count;
+	u64 total_us;
+	u32 max_us;
+};
+
 /*
  * struct rproc - a physical remote processor device
  *
@@ -247,6 +270,10 @@ enum rproc_event {
  * @secure_mode: flag to dictate whether to enable secure loading
  * @secure_ok: restart status flag to be looked up upon the event's completion
  * @secure_reset: flag to uninstall the firewalls
+ * @retained: still running after its last rproc_put(), until rproc_get()
+ * reuses it or memory pressure has it stopped by @release_work
+ * @load_start: when the firmware loading in progress was started
+ * @resume_stats: how long coming back took, by enum rproc_resume_mode
  */
 struct rproc {
 	struct list_head next;
@@ -289,6 +316,10 @@ struct rproc {
 	bool halt_on_crash;
 	char *header;
 	int header_len;
+	bool retained;
+	struct work_struct release_work;
+	ktime_t load_start;
+	struct rproc_resume_stats resume_stats[RPROC_RESUME_MODES];
 };
 
 int rproc_set_secure(const char *, bool);
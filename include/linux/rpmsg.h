@@ -36,6 +36,7 @@
 #include <linux/types.h>
 #include <linux/device.h>
 #include <linux/mod_devicetable.h>
+#include <linux/uio.h>
 
 /* The feature bitmap for virtio rpmsg */
 #define VIRTIO_RPMSG_F_NS	0 /* RP supports name service notifications */
@@ -78,6 +79,23 @@ enum {
 
 struct virtproc_info;
 
+/**
+ * rpmsg_stats - message counters of one direction of a channel
+ *
+ * @msgs: number of messages
+ * @bytes: payload bytes of these messages
+ * @usecs: total time they took: for tx, from the send call to the message
+ *	being in the vring, for rx from the bus picking up the batch the
+ *	message arrived in to the endpoint's callback returning
+ * @max_usecs: the longest of these
+ */
+struct rpmsg_stats {
+	unsigned long msgs;
+	u64 bytes;
+	u64 usecs;
+	u32 max_usecs;
+};
+
 /**
  * rpmsg_channel - rpmsg channels are the devices of the rpmsg bus
  *
@@ -89,6 +107,9 @@ struct virtproc_info;
  * @priv: private pointer for the driver's use.
  * @ept: local rpmsg endpoint of this channel
  * @announce: need to tell remoteproc about channel creation/removal
+ * @tx: messages sent on this channel, on any of its endpoints
+ * @rx: messages received on it
+ * @tx_kicks: notifications sent to the remote processor for @tx
  */
 struct rpmsg_channel {
 	struct virtproc_info *vrp;
@@ -99,6 +120,8 @@ struct rpmsg_channel {
 	void *priv;
 	struct rpmsg_endpoint *ept;
 	bool announce;
+	struct rpmsg_stats tx, rx;
+	unsigned long tx_kicks;
 };
 
 struct rpmsg_channel_info {
@@ -149,6 +172,8 @@ struct rpmsg_endpoint *rpmsg_create_ept(struct rpmsg_channel *,
 
 int
 rpmsg_send_offchannel_raw(struct rpmsg_channel *, u32, u32, void *, int, bool);
+int rpmsg_send_offchannel_batch(struct rpmsg_channel *, u32, u32,
+						struct kvec *, int, bool);
 
 static inline
 int rpmsg_send_offchannel(struct rpmsg_channel *rpdev, u32 src, u32 dst,
@@ -188,4 +213,22 @@ int rpmsg_trysendto(struct rpmsg_channel *rpdev, void *data, int len, u32 dst)
 	return rpmsg_trysend_offchannel(rpdev, rpdev->src, dst, data, len);
 }
 
+/*
+ * Send @n messages, one per kvec, and notify the remote processor once for
+ * all of them.  Returns how many were sent, or an error if none was.
+ */
+static inline
+int rpmsg_send_batch(struct rpmsg_channel *rpdev, struct kvec *vec, int n)
+{
+	return rpmsg_send_offchannel_batch(rpdev, rpdev->src, rpdev->dst,
+								vec, n, true);
+}
+
+static inline
+int rpmsg_sendto_batch(struct rpmsg_channel *rpdev, struct kvec *vec, int n,
+								u32 dst)
+{
+	return rpmsg_send_offchannel_batch(rpdev, rpdev->src, dst, vec, n, true);
+}
+
 #endif /* _LINUX_RPMSG_H */
@@ -140,7 +140,15 @@ extern unsigned long nr_running(void);
 extern unsigned long nr_uninterruptible(void);
 extern unsigned long nr_iowait(void);
 extern unsigned long nr_iowait_cpu(int cpu);
+extern unsigned long nr_foreground_cpu(int cpu);
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
+/* averages are fixed point with FSHIFT fractional bits */
+extern unsigned long avg_nr_running(void);
+extern unsigned long avg_cpu_nr_running(unsigned int cpu);
+#endif
 extern unsigned long this_cpu_load(void);
+/* decayed share of the time CFS kept the cpu busy, 0..SCHED_LOAD_SCALE */
+extern unsigned long sched_cpu_usage(int cpu);
 
 
 extern void calc_global_load(unsigned long ticks);
@@ -436,6 +444,7 @@ extern int get_dumpable(struct mm_struct *mm);
 					/* leave room for more dump flags */
 #define MMF_VM_MERGEABLE	16	/* KSM may merge identical pages */
 #define MMF_VM_HUGEPAGE		17	/* set when VM_HUGEPAGE is set on vma */
+#define MMF_FORK_LAZY		18	/* fork leaves page cache ptes out */
 
 #define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
 
@@ -1103,6 +1112,7 @@ struct sched_class {
 	void (*post_schedule) (struct rq *this_rq);
 	void (*task_waking) (struct task_struct *task);
 	void (*task_woken) (struct rq *this_rq, struct task_struct *task);
+	void (*migrate_task_rq)(struct task_struct *p, int next_cpu);
 
 	void (*set_cpus_allowed)(struct task_struct *p,
 				 const struct cpumask *newmask);
@@ -1165,6 +1175,26 @@ struct sched_statistics {
 	u64			nr_wakeups_affine_attempts;
 	u64			nr_wakeups_passive;
 	u64			nr_wakeups_idle;
+
+	/* rq->clock at the last wakeup, cleared once the task got the cpu */
+	u64			wakeup_stamp;
+};
+#endif
+
+#ifdef CONFIG_SMP
+/*
+ * Per-entity load tracking, see update_entity_load_avg().  The sums are
+ * geometric series of the time, in ~1ms periods, the entity was runnable
+ * (running for usage_avg_sum) and are bounded by LOAD_AVG_MAX, so a u32
+ * holds them.
+ */
+struct sched_avg {
+	u32			runnable_avg_sum, runnable_avg_period;
+	u32			usage_avg_sum;
+	u64			last_runnable_update;
+	s64			decay_count;
+	unsigned long		load_avg_contrib;
+	unsigned long		usage_avg_contrib;
 };
 #endif
 
@@ -1192,6 +1222,10 @@ struct sched_entity {
 	/* rq "owned" by this entity/group: */
 	struct cfs_rq		*my_q;
 #endif
+
+#ifdef CONFIG_SMP
+	struct sched_avg	avg;
+#endif
 };
 
 struct sched_rt_entity {
@@ -1240,6 +1274,23 @@ struct task_struct {
 	struct sched_rt_entity rt;
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group *sched_task_group;
+	/* counted in rq->nr_foreground */
+	bool foreground_queued;
+#endif
+#ifdef CONFIG_CPU_FREQ
+	/*
+	 * Latency hints for the cpufreq governor: set by prctl, or inherited
+	 * from a latency sensitive waker until the task sleeps again.
+	 * latency_queued records what was counted in rq->nr_latency.
+	 */
+	bool latency_sensitive;
+	bool latency_wakee;
+	bool latency_queued;
+#endif
+#ifdef CONFIG_CPU_FREQ_TIMES
+	/* cputime spent at each frequency, see cpufreq_times.c */
+	cputime64_t *time_in_state;
+	unsigned int max_state;
 #endif
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
@@ -1876,6 +1927,7 @@ extern void do_set_cpus_allowed(struct task_struct *p,
 
 extern int set_cpus_allowed_ptr(struct task_struct *p,
 				const struct cpumask *new_mask);
+extern void sched_evacuate_cpu(int cpu);
 #else
 static inline void do_set_cpus_allowed(struct task_struct *p,
 				      const struct cpumask *new_mask)
@@ -1997,8 +2049,8 @@ extern enum sched_tunable_scaling sysctl_sched_tunable_scaling;
 extern unsigned int sysctl_sched_migration_cost;
 extern unsigned int sysctl_sched_nr_migrate;
 extern unsigned int sysctl_sched_time_avg;
+extern unsigned int sysctl_sched_bg_saturation;
 extern unsigned int sysctl_timer_migration;
-extern unsigned int sysctl_sched_shares_window;
 
 int sched_proc_update_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *length,
@@ -2024,8 +2076,10 @@ int sched_rt_handler(struct ctl_table *table, int write,
 
 #ifdef CONFIG_SCHED_AUTOGROUP
 extern unsigned int sysctl_sched_autogroup_enabled;
+extern unsigned int sysctl_sched_autogroup_shares;
 
 extern void sched_autogroup_create_attach(struct task_struct *p);
+extern void sched_autogroup_setuid(struct task_struct *p);
 extern void sched_autogroup_detach(struct task_struct *p);
 extern void sched_autogroup_fork(struct signal_struct *sig);
 extern void sched_autogroup_exit(struct signal_struct *sig);
@@ -2035,6 +2089,7 @@ extern int proc_sched_autogroup_set_nice(struct task_struct *p, int *nice);
 #endif
 #else
 static inline void sched_autogroup_create_attach(struct task_struct *p) { }
+static inline void sched_autogroup_setuid(struct task_struct *p) { }
 static inline void sched_autogroup_detach(struct task_struct *p) { }
 static inline void sched_autogroup_fork(struct signal_struct *sig) { }
 static inline void sched_autogroup_exit(struct signal_struct *sig) { }
@@ -92,6 +92,10 @@ struct kmem_cache {
 #ifdef CONFIG_SYSFS
 	struct kobject kobj;	/* For sysfs */
 #endif
+#ifdef CONFIG_SLUB_STATS
+	int min_partial_auto;	/* Tune min_partial from the statistics */
+	unsigned int tune_slabs[2];	/* Slabs allocated/freed at last tune */
+#endif
 
 #ifdef CONFIG_NUMA
 	/*
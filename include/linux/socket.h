@@ -16,6 +16,12 @@ struct __kernel_sockaddr_storage {
 				/* _SS_MAXSIZE value minus size of ss_family */
 } __attribute__ ((aligned(_K_SS_ALIGNSIZE)));	/* force desired alignment */
 
+/* getsockopt(SO_BUSY_POLL_STATS) */
+struct so_busy_poll_stats {
+	unsigned int	polls;		/* receives that busy polled */
+	unsigned int	hits;		/* ... and found a packet doing so */
+};
+
 #ifdef __KERNEL__
 
 #include <asm/socket.h>			/* arch-dependent defines	*/
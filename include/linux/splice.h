@@ -37,6 +37,8 @@ struct splice_desc {
 	loff_t pos;			/* file position */
 	size_t num_spliced;		/* number of bytes already spliced */
 	bool need_wakeup;		/* need to wake up writer */
+	unsigned int pages_moved;	/* pages passed on by reference */
+	unsigned int pages_copied;	/* pages whose data was copied */
 };
 
 struct partial_page {
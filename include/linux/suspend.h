@@ -299,6 +299,16 @@ static inline bool pm_wakeup_pending(void) { return false; }
 
 extern struct mutex pm_mutex;
 
+#ifdef CONFIG_SUSPEND_TIME
+extern void suspend_time_dev_begin(bool resume);
+extern void suspend_time_dev(struct device *dev, struct device *blocker,
+			     bool async, ktime_t start, ktime_t ready);
+#else
+static inline void suspend_time_dev_begin(bool resume) {}
+static inline void suspend_time_dev(struct device *dev, struct device *blocker,
+				    bool async, ktime_t start, ktime_t ready) {}
+#endif
+
 #ifndef CONFIG_HIBERNATE_CALLBACKS
 static inline void lock_system_sleep(void) {}
 static inline void unlock_system_sleep(void) {}
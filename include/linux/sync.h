@@ -87,6 +87,10 @@ struct sync_timeline_ops {
  *			  sync_pt.status
  * @active_list_head:	list of active (unsignaled/errored) sync_pts
  * @sync_timeline_list:	membership in global sync_timeline_list
+ * @signaled_pts:	sync_pts that signaled after being added to a fence
+ * @signal_ns:		total time those took to signal once in a fence
+ * @max_signal_ns:	longest of those times
+ * @signaled_on_activate: sync_pts already signaled when added to a fence
  */
 struct sync_timeline {
 	const struct sync_timeline_ops	*ops;
@@ -102,6 +106,12 @@ struct sync_timeline {
 	spinlock_t		active_list_lock;
 
 	struct list_head	sync_timeline_list;
+
+	/* protected by active_list_lock */
+	unsigned long		signaled_pts;
+	u64			signal_ns;
+	u64			max_signal_ns;
+	unsigned long		signaled_on_activate;
 };
 
 /**
@@ -114,6 +124,7 @@ struct sync_timeline {
  * @status:		1: signaled, 0:active, <0: error
  * @timestamp:		time which sync_pt status transitioned from active to
  *			  singaled or error.
+ * @activated:		time the sync_pt was added to its fence
  */
 struct sync_pt {
 	struct sync_timeline		*parent;
@@ -128,6 +139,7 @@ struct sync_pt {
 	int			status;
 
 	ktime_t			timestamp;
+	ktime_t			activated;
 };
 
 /**
@@ -249,7 +261,10 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt);
  * @b:		fence b
  *
  * Creates a new fence which contains copies of all the sync_pts in both
- * @a and @b.  @a and @b remain valid, independent fences.
+ * @a and @b.  @a and @b remain valid, independent fences.  Of the sync_pts
+ * on one timeline only the last to signal is kept, and signaled ones are
+ * not copied.  If one of @a and @b has signaled, a new reference to the
+ * other one is returned instead of a new fence.
  */
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b);
@@ -287,7 +302,7 @@ void sync_fence_install(struct sync_fence *fence, int fd);
  * @callback:		callback
  * @callback_data	data to pass to the callback
  *
- * Returns 1 if @fence has already signaled.
+ * Returns 1 if @fence has already signaled, without allocating anything.
  *
  * Registers a callback to be called when @fence signals or has an error
  */
@@ -34,6 +34,8 @@ struct thermal_domain;
  *		reports the temperature change.  This API should return the
 *		current measurement rate that the sensor is measuring at.
  * @cool_device: The cooling agent call back to process a list of cooling agents
+ * @get_load: The cooling agent call back returning how busy the device was,
+ *		in percent, since the previous call.
  * @process_temp: The governors call back for processing a domain temperature
  *
  */
@@ -45,6 +47,7 @@ struct thermal_dev_ops {
 	int (*set_temp_report_rate) (struct thermal_dev *, int rate);
 	/* Cooling agent call backs */
 	int (*cool_device) (struct thermal_dev *, int temp);
+	int (*get_load) (struct thermal_dev *);
 	/* Governor call backs */
 	int (*process_temp) (struct thermal_dev *gov,
 				struct list_head *cooling_list,
@@ -113,6 +116,8 @@ struct thermal_dev {
 extern int thermal_request_temp(struct thermal_dev *tdev);
 extern int thermal_lookup_temp(const char *domain_name);
 extern int thermal_sensor_set_temp(struct thermal_dev *tdev);
+extern int thermal_domain_cool(const char *domain_name, int cooling_level);
+extern int thermal_domain_get_load(const char *domain_name);
 
 /* Registration and unregistration calls for the thermal devices */
 extern int thermal_sensor_dev_register(struct thermal_dev *tdev);
@@ -286,6 +286,7 @@ extern int try_to_del_timer_sync(struct timer_list *timer);
 
 extern void init_timers(void);
 extern void run_local_timers(void);
+extern unsigned long timer_wheel_coalesced(int cpu);
 struct hrtimer;
 extern enum hrtimer_restart it_real_fn(struct hrtimer *);
 
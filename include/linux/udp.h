@@ -81,6 +81,11 @@ struct udp_sock {
 	 * For encapsulation sockets.
 	 */
 	int (*encap_rcv)(struct sock *sk, struct sk_buff *skb);
+	/*
+	 * Route of the last send to an explicit address, owned by
+	 * whoever takes it out with xchg().
+	 */
+	struct dst_entry *last_dst;
 };
 
 static inline struct udp_sock *udp_sk(const struct sock *sk)
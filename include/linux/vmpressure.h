@@ -6,6 +6,7 @@
 #include <linux/workqueue.h>
 #include <linux/gfp.h>
 #include <linux/types.h>
+#include <linux/errno.h>
 #include <linux/cgroup.h>
 
 struct vmpressure {
@@ -23,6 +24,7 @@ struct vmpressure {
 };
 
 struct mem_cgroup;
+struct notifier_block;
 
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR
 extern void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
@@ -38,10 +40,20 @@ extern int vmpressure_register_event(struct cgroup *cg, struct cftype *cft,
 				     const char *args);
 extern void vmpressure_unregister_event(struct cgroup *cg, struct cftype *cft,
 					struct eventfd_ctx *eventfd);
+extern int vmpressure_notifier_register(struct notifier_block *nb);
+extern int vmpressure_notifier_unregister(struct notifier_block *nb);
 #else
 static inline void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 			      unsigned long scanned, unsigned long reclaimed) {}
 static inline void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg,
 				   int prio) {}
+static inline int vmpressure_notifier_register(struct notifier_block *nb)
+{
+	return -ENOSYS;
+}
+static inline int vmpressure_notifier_unregister(struct notifier_block *nb)
+{
+	return 0;
+}
 #endif /* CONFIG_CGROUP_MEM_RES_CTLR */
 #endif /* __LINUX_VMPRESSURE_H */
@@ -32,6 +32,9 @@ enum {
 	WAKE_LOCK_TYPE_COUNT
 };
 
+/* hold times below 1ms, 10ms, ... 100s, 1000s, and longer */
+#define WAKE_LOCK_HIST_BINS	8
+
 struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 	struct list_head    link;
@@ -47,6 +50,10 @@ struct wake_lock {
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		int             prevent_count;
+		unsigned int    hold_hist[WAKE_LOCK_HIST_BINS];
+		pid_t           owner_pid;	/* last user space locker */
+		uid_t           owner_uid;
 	} stat;
 #endif
 #endif
@@ -0,0 +1,63 @@
+/*
+ * Busy polling of the receive path from the socket layer
+ *
+ * A socket with SO_BUSY_POLL set remembers the NAPI context its last
+ * packet came in through, and a receive that finds its queue empty polls
+ * that context directly for up to sk_ll_usec microseconds before going
+ * to sleep, saving the softirq and the wakeup on latency sensitive flows.
+ */
+#ifndef _NET_BUSY_POLL_H
+#define _NET_BUSY_POLL_H
+
+#include <linux/netdevice.h>
+#include <net/sock.h>
+
+/* longest busy poll a socket may ask for without CAP_NET_ADMIN */
+#define BUSY_POLL_MAX_USEC	200
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+
+extern unsigned int sysctl_net_busy_read __read_mostly;
+
+static inline bool sk_can_busy_loop(const struct sock *sk)
+{
+	return sk->sk_ll_usec && sk->sk_napi_id &&
+	       !need_resched() && !signal_pending(current);
+}
+
+static inline void skb_mark_napi_id(struct sk_buff *skb,
+				    const struct napi_struct *napi)
+{
+	skb->napi_id = napi->napi_id;
+}
+
+static inline void sk_mark_napi_id(struct sock *sk, const struct sk_buff *skb)
+{
+	sk->sk_napi_id = skb->napi_id;
+}
+
+extern bool sk_busy_loop(struct sock *sk, int nonblock);
+
+#else /* CONFIG_NET_RX_BUSY_POLL */
+
+static inline bool sk_can_busy_loop(const struct sock *sk)
+{
+	return false;
+}
+
+static inline void skb_mark_napi_id(struct sk_buff *skb,
+				    const struct napi_struct *napi)
+{
+}
+
+static inline void sk_mark_napi_id(struct sock *sk, const struct sk_buff *skb)
+{
+}
+
+static inline bool sk_busy_loop(struct sock *sk, int nonblock)
+{
+	return false;
+}
+
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+#endif /* _NET_BUSY_POLL_H */
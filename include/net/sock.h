@@ -216,6 +216,10 @@ struct sock_common {
   *	@sk_rcvtimeo: %SO_RCVTIMEO setting
   *	@sk_sndtimeo: %SO_SNDTIMEO setting
   *	@sk_rxhash: flow hash received from netif layer
+  *	@sk_napi_id: id of the last NAPI context to deliver to this socket
+  *	@sk_ll_usec: %SO_BUSY_POLL setting, in usecs
+  *	@sk_ll_polls: receives that busy polled
+  *	@sk_ll_hits: busy polls that found a packet
   *	@sk_filter: socket filtering instructions
   *	@sk_protinfo: private area, net family specific, when not using slab
   *	@sk_timer: sock cleanup timer
@@ -277,6 +281,12 @@ struct sock {
 	int			sk_forward_alloc;
 #ifdef CONFIG_RPS
 	__u32			sk_rxhash;
+#endif
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	unsigned int		sk_napi_id;
+	unsigned int		sk_ll_usec;
+	unsigned int		sk_ll_polls;
+	unsigned int		sk_ll_hits;
 #endif
 	atomic_t		sk_drops;
 	int			sk_rcvbuf;
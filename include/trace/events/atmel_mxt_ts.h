@@ -0,0 +1,32 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM atmel_mxt_ts
+
+#if !defined(_TRACE_ATMEL_MXT_TS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ATMEL_MXT_TS_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(mxt_input_sync,
+
+	TP_PROTO(int fingers, unsigned int latency_us),
+
+	TP_ARGS(fingers, latency_us),
+
+	TP_STRUCT__entry(
+		__field(int, fingers)
+		__field(unsigned int, latency_us)
+	),
+
+	TP_fast_assign(
+		__entry->fingers = fingers;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("fingers=%d latency=%uus", __entry->fingers,
+		__entry->latency_us)
+);
+
+#endif /* _TRACE_ATMEL_MXT_TS_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
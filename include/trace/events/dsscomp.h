@@ -0,0 +1,64 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM dsscomp
+
+#if !defined(_TRACE_DSSCOMP_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_DSSCOMP_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(dsscomp_apply,
+	TP_PROTO(const void *comp, u32 ix, u32 sync_id, u32 ovl_mask, int ret),
+	TP_ARGS(comp, ix, sync_id, ovl_mask, ret),
+
+	TP_STRUCT__entry(
+		__field(const void *,	comp		)
+		__field(u32,		ix		)
+		__field(u32,		sync_id		)
+		__field(u32,		ovl_mask	)
+		__field(int,		ret		)
+	),
+
+	TP_fast_assign(
+		__entry->comp = comp;
+		__entry->ix = ix;
+		__entry->sync_id = sync_id;
+		__entry->ovl_mask = ovl_mask;
+		__entry->ret = ret;
+	),
+
+	TP_printk("comp=%p mgr=%u sync_id=%u ovls=0x%02x ret=%d",
+		  __entry->comp, __entry->ix, __entry->sync_id,
+		  __entry->ovl_mask, __entry->ret)
+);
+
+/*
+ * Raised from the DSS interrupt path: PROGRAMMED when the shadow registers
+ * were latched and DISPLAYED on the vsync the composition first went out on.
+ */
+TRACE_EVENT(dsscomp_callback,
+	TP_PROTO(const void *comp, u32 ix, u32 sync_id, int status),
+	TP_ARGS(comp, ix, sync_id, status),
+
+	TP_STRUCT__entry(
+		__field(const void *,	comp		)
+		__field(u32,		ix		)
+		__field(u32,		sync_id		)
+		__field(int,		status		)
+	),
+
+	TP_fast_assign(
+		__entry->comp = comp;
+		__entry->ix = ix;
+		__entry->sync_id = sync_id;
+		__entry->status = status;
+	),
+
+	TP_printk("comp=%p mgr=%u sync_id=%u status=0x%x",
+		  __entry->comp, __entry->ix, __entry->sync_id,
+		  __entry->status)
+);
+
+#endif /* _TRACE_DSSCOMP_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
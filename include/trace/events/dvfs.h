@@ -0,0 +1,71 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM dvfs
+
+#if !defined(_TRACE_DVFS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_DVFS_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * One scale of a vdd: time spent ramping the voltage (ABB included),
+ * reprogramming the device clocks and scaling the dependent vdds.
+ */
+TRACE_EVENT(dvfs_scale,
+	TP_PROTO(const char *vdd, unsigned long old_volt,
+		 unsigned long new_volt, u32 volt_us, u32 clk_us, u32 dep_us),
+	TP_ARGS(vdd, old_volt, new_volt, volt_us, clk_us, dep_us),
+
+	TP_STRUCT__entry(
+		__string(	vdd,		vdd		)
+		__field(	unsigned long,	old_volt	)
+		__field(	unsigned long,	new_volt	)
+		__field(	u32,		volt_us		)
+		__field(	u32,		clk_us		)
+		__field(	u32,		dep_us		)
+	),
+
+	TP_fast_assign(
+		__assign_str(vdd, vdd);
+		__entry->old_volt = old_volt;
+		__entry->new_volt = new_volt;
+		__entry->volt_us = volt_us;
+		__entry->clk_us = clk_us;
+		__entry->dep_us = dep_us;
+	),
+
+	TP_printk("vdd_%s %lu->%lu uV volt=%uus clk=%uus dep=%uus",
+		  __get_str(vdd), __entry->old_volt, __entry->new_volt,
+		  __entry->volt_us, __entry->clk_us, __entry->dep_us)
+);
+
+/* a request was recorded but another device holds the vdd higher */
+TRACE_EVENT(dvfs_request_blocked,
+	TP_PROTO(const char *vdd, const char *req, const char *holder,
+		 unsigned long requested, unsigned long held),
+	TP_ARGS(vdd, req, holder, requested, held),
+
+	TP_STRUCT__entry(
+		__string(	vdd,		vdd		)
+		__string(	req,		req		)
+		__string(	holder,		holder		)
+		__field(	unsigned long,	requested	)
+		__field(	unsigned long,	held		)
+	),
+
+	TP_fast_assign(
+		__assign_str(vdd, vdd);
+		__assign_str(req, req);
+		__assign_str(holder, holder);
+		__entry->requested = requested;
+		__entry->held = held;
+	),
+
+	TP_printk("vdd_%s %s wants %lu, held at %lu by %s",
+		  __get_str(vdd), __get_str(req), __entry->requested,
+		  __entry->held, __get_str(holder))
+);
+
+#endif /* _TRACE_DVFS_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,96 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM pvr
+
+#if !defined(_TRACE_PVR_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_PVR_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * Host side view of the SGX pipeline.  The TA and 3D phases run entirely in
+ * the microkernel, so what the host can timestamp is the kick that submits
+ * a scene, the SGX event interrupt raised as work retires, and the queue
+ * commands (flips) whose source syncs that work releases.
+ */
+
+TRACE_EVENT(pvr_sgx_kick,
+	TP_PROTO(u32 ccb_offset, bool first_kick, bool last_in_scene,
+		 u32 src_syncs, u32 dst_syncs),
+	TP_ARGS(ccb_offset, first_kick, last_in_scene, src_syncs, dst_syncs),
+
+	TP_STRUCT__entry(
+		__field(u32,	ccb_offset	)
+		__field(bool,	first_kick	)
+		__field(bool,	last_in_scene	)
+		__field(u32,	src_syncs	)
+		__field(u32,	dst_syncs	)
+	),
+
+	TP_fast_assign(
+		__entry->ccb_offset = ccb_offset;
+		__entry->first_kick = first_kick;
+		__entry->last_in_scene = last_in_scene;
+		__entry->src_syncs = src_syncs;
+		__entry->dst_syncs = dst_syncs;
+	),
+
+	TP_printk("ccb=%u first=%d last=%d src=%u dst=%u",
+		  __entry->ccb_offset, __entry->first_kick,
+		  __entry->last_in_scene, __entry->src_syncs,
+		  __entry->dst_syncs)
+);
+
+TRACE_EVENT(pvr_sgx_event,
+	TP_PROTO(u32 status, u32 irq_count),
+	TP_ARGS(status, irq_count),
+
+	TP_STRUCT__entry(
+		__field(u32,	status		)
+		__field(u32,	irq_count	)
+	),
+
+	TP_fast_assign(
+		__entry->status = status;
+		__entry->irq_count = irq_count;
+	),
+
+	TP_printk("status=0x%08x irq_count=%u",
+		  __entry->status, __entry->irq_count)
+);
+
+DECLARE_EVENT_CLASS(pvr_cmd,
+	TP_PROTO(const void *cookie, u32 src_syncs, u32 dst_syncs),
+	TP_ARGS(cookie, src_syncs, dst_syncs),
+
+	TP_STRUCT__entry(
+		__field(const void *,	cookie		)
+		__field(u32,		src_syncs	)
+		__field(u32,		dst_syncs	)
+	),
+
+	TP_fast_assign(
+		__entry->cookie = cookie;
+		__entry->src_syncs = src_syncs;
+		__entry->dst_syncs = dst_syncs;
+	),
+
+	TP_printk("cookie=%p src=%u dst=%u",
+		  __entry->cookie, __entry->src_syncs, __entry->dst_syncs)
+);
+
+/* all source syncs satisfied, the command was handed to its device */
+DEFINE_EVENT(pvr_cmd, pvr_cmd_process,
+	TP_PROTO(const void *cookie, u32 src_syncs, u32 dst_syncs),
+	TP_ARGS(cookie, src_syncs, dst_syncs)
+);
+
+/* the device reported the command done, e.g. a flip went on screen */
+DEFINE_EVENT(pvr_cmd, pvr_cmd_complete,
+	TP_PROTO(const void *cookie, u32 src_syncs, u32 dst_syncs),
+	TP_ARGS(cookie, src_syncs, dst_syncs)
+);
+
+#endif /* _TRACE_PVR_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
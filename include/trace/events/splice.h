@@ -0,0 +1,37 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM splice
+
+#if !defined(_TRACE_SPLICE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SPLICE_H
+#include <linux/tracepoint.h>
+
+/* pages one splice call moved by reference and copied, into or out of a pipe */
+TRACE_EVENT(splice_pages,
+
+	TP_PROTO(bool to_pipe, unsigned int moved, unsigned int copied),
+
+	TP_ARGS(to_pipe, moved, copied),
+
+	TP_STRUCT__entry(
+		__field(	pid_t,		pid)
+		__field(	bool,		to_pipe)
+		__field(	unsigned int,	moved)
+		__field(	unsigned int,	copied)
+	),
+
+	TP_fast_assign(
+		__entry->pid = current->pid;
+		__entry->to_pipe = to_pipe;
+		__entry->moved = moved;
+		__entry->copied = copied;
+	),
+
+	TP_printk("pid=%d %s moved=%u copied=%u", __entry->pid,
+		__entry->to_pipe ? "to_pipe" : "from_pipe",
+		__entry->moved, __entry->copied)
+);
+
+#endif
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
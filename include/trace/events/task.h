@@ -55,6 +55,45 @@ TRACE_EVENT(task_rename,
 		__entry->newcomm, __entry->oom_score_adj)
 );
 
+/* how long fork() took to copy the mm, and what it copied of it */
+TRACE_EVENT(task_dup_mm,
+
+	TP_PROTO(struct task_struct *task, struct mm_struct *mm,
+		 struct mm_struct *oldmm, u64 ns),
+
+	TP_ARGS(task, mm, oldmm, ns),
+
+	TP_STRUCT__entry(
+		__field(	pid_t,	pid)
+		__array(	char,	comm, TASK_COMM_LEN)
+		__field(	int,	map_count)
+		__field(	bool,	lazy)
+		__field( unsigned long,	anon)
+		__field( unsigned long,	file)
+		__field( unsigned long,	parent_anon)
+		__field( unsigned long,	parent_file)
+		__field(	u64,	ns)
+	),
+
+	TP_fast_assign(
+		__entry->pid = task->pid;
+		memcpy(__entry->comm, current->comm, TASK_COMM_LEN);
+		__entry->map_count = mm->map_count;
+		__entry->lazy = test_bit(MMF_FORK_LAZY, &oldmm->flags);
+		__entry->anon = get_mm_counter(mm, MM_ANONPAGES);
+		__entry->file = get_mm_counter(mm, MM_FILEPAGES);
+		__entry->parent_anon = get_mm_counter(oldmm, MM_ANONPAGES);
+		__entry->parent_file = get_mm_counter(oldmm, MM_FILEPAGES);
+		__entry->ns = ns;
+	),
+
+	TP_printk("pid=%d comm=%s vmas=%d lazy=%d anon=%lu/%lu file=%lu/%lu "
+		  "ns=%llu", __entry->pid, __entry->comm,
+		__entry->map_count, __entry->lazy, __entry->anon,
+		__entry->parent_anon, __entry->file, __entry->parent_file,
+		(unsigned long long)__entry->ns)
+);
+
 #endif
 
 /* This part must be outside protection */
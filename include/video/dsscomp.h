@@ -375,6 +375,7 @@ enum omapdss_buffer_addressing_type {
 	OMAP_DSS_BUFADDR_OVL_IX,	/* using a prior overlay */
 	OMAP_DSS_BUFADDR_LAYER_IX,	/* using a Post2 layer */
 	OMAP_DSS_BUFADDR_FB,		/* using framebuffer memory */
+	OMAP_DSS_BUFADDR_DMA_BUF,	/* using dma-buf fd(s), uv for NV12 */
 };
 
 struct dss2_ovl_info {
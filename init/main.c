@@ -641,6 +641,71 @@ static void __init do_ctors(void)
 int initcall_debug;
 core_param(initcall_debug, initcall_debug, bool, 0644);
 
+/*
+ * "initcall_report=N" keeps the N slowest built-in initcalls, and prints
+ * them once do_initcalls() is done.  The table isn't __initdata as
+ * do_one_initcall() is also there for modules; it is only filled in
+ * while booting.
+ */
+#define INITCALL_REPORT_MAX	32
+
+struct initcall_time {
+	initcall_t fn;
+	unsigned long long usecs;
+};
+
+static unsigned int initcall_report;
+static struct initcall_time initcall_slowest[INITCALL_REPORT_MAX];
+static unsigned int initcall_count;
+static unsigned long long initcall_total;
+static DEFINE_SPINLOCK(initcall_report_lock);
+
+static int __init initcall_report_setup(char *str)
+{
+	get_option(&str, &initcall_report);
+	initcall_report = min_t(unsigned int, initcall_report,
+				INITCALL_REPORT_MAX);
+	return 1;
+}
+__setup("initcall_report=", initcall_report_setup);
+
+static void __init_or_module initcall_report_add(initcall_t fn,
+						 unsigned long long usecs)
+{
+	int i;
+
+	spin_lock(&initcall_report_lock);
+	initcall_count++;
+	initcall_total += usecs;
+	for (i = initcall_report; i > 0; i--) {
+		if (initcall_slowest[i - 1].fn &&
+		    initcall_slowest[i - 1].usecs >= usecs)
+			break;
+		if (i < initcall_report)
+			initcall_slowest[i] = initcall_slowest[i - 1];
+	}
+	if (i < initcall_report) {
+		initcall_slowest[i].fn = fn;
+		initcall_slowest[i].usecs = usecs;
+	}
+	spin_unlock(&initcall_report_lock);
+}
+
+static void __init initcall_report_print(void)
+{
+	int i;
+
+	if (!initcall_report)
+		return;
+
+	printk(KERN_INFO "initcall report: %u initcalls took %llu usecs, "
+	       "slowest:\n", initcall_count, initcall_total);
+	for (i = 0; i < initcall_report && initcall_slowest[i].fn; i++)
+		printk(KERN_INFO "  %8llu usecs  %pF\n",
+		       initcall_slowest[i].usecs, initcall_slowest[i].fn);
+	initcall_report = 0;
+}
+
 static char msgbuf[64];
 
 static int __init_or_module do_one_initcall_debug(initcall_t fn)
@@ -649,14 +714,19 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 	unsigned long long duration;
 	int ret;
 
-	printk(KERN_DEBUG "calling  %pF @ %i\n", fn, task_pid_nr(current));
+	if (initcall_debug)
+		printk(KERN_DEBUG "calling  %pF @ %i\n", fn,
+		       task_pid_nr(current));
 	calltime = ktime_get();
 	ret = fn();
 	rettime = ktime_get();
 	delta = ktime_sub(rettime, calltime);
 	duration = (unsigned long long) ktime_to_ns(delta) >> 10;
-	printk(KERN_DEBUG "initcall %pF returned %d after %lld usecs\n", fn,
-		ret, duration);
+	if (initcall_debug)
+		printk(KERN_DEBUG "initcall %pF returned %d after %lld usecs\n",
+		       fn, ret, duration);
+	if (initcall_report)
+		initcall_report_add(fn, duration);
 
 	return ret;
 }
@@ -666,7 +736,7 @@ int __init_or_module do_one_initcall(initcall_t fn)
 	int count = preempt_count();
 	int ret;
 
-	if (initcall_debug)
+	if (initcall_debug || initcall_report)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
@@ -692,6 +762,58 @@ int __init_or_module do_one_initcall(initcall_t fn)
 }
 
 
+#ifdef CONFIG_ASYNC_INITCALLS
+/*
+ * Async initcalls of a level all run in this domain, and the level's
+ * first _sync initcall waits for them: main.o is linked ahead of the
+ * rest, so that is async_initcall_barrier().
+ */
+static LIST_HEAD(async_initcall_domain);
+
+static void __init async_initcall_run(void *data, async_cookie_t cookie)
+{
+	struct async_initcall *ac = data;
+
+	if (ac->after)
+		async_synchronize_cookie_domain(ac->after->cookie + 1,
+						&async_initcall_domain);
+	do_one_initcall(ac->fn);
+}
+
+int __init async_initcall(struct async_initcall *ac)
+{
+	if (ac->after && !ac->after->scheduled) {
+		/* it would never be waited for: keep to link order instead */
+		printk(KERN_WARNING "initcall %pF comes before %pF, which it "
+		       "waits for\n", ac->fn, ac->after->fn);
+		return ac->fn();
+	}
+
+	ac->cookie = async_schedule_domain(async_initcall_run, ac,
+					   &async_initcall_domain);
+	ac->scheduled = 1;
+	return 0;
+}
+
+static int __init async_initcall_barrier(void)
+{
+	async_synchronize_full_domain(&async_initcall_domain);
+	return 0;
+}
+core_initcall_sync(async_initcall_barrier);
+postcore_initcall_sync(async_initcall_barrier);
+arch_initcall_sync(async_initcall_barrier);
+subsys_initcall_sync(async_initcall_barrier);
+fs_initcall_sync(async_initcall_barrier);
+device_initcall_sync(async_initcall_barrier);
+late_initcall_sync(async_initcall_barrier);
+#else
+int __init async_initcall(struct async_initcall *ac)
+{
+	return ac->fn();
+}
+#endif
+
 extern initcall_t __initcall_start[], __initcall_end[], __early_initcall_end[];
 
 static void __init do_initcalls(void)
@@ -700,6 +822,8 @@ static void __init do_initcalls(void)
 
 	for (fn = __early_initcall_end; fn < __initcall_end; fn++)
 		do_one_initcall(*fn);
+
+	initcall_report_print();
 }
 
 /*
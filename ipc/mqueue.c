@@ -45,9 +45,11 @@
 #define RECV		1
 
 #define STATE_NONE	0
-#define STATE_PENDING	1
 #define STATE_READY	2
 
+/* free message buffers a cpu keeps for a queue, see mq_load_msg() */
+#define MQ_MSG_CACHE	8
+
 struct ext_wait_queue {		/* queue of sleeping tasks */
 	struct task_struct *task;
 	struct list_head list;
@@ -55,6 +57,11 @@ struct ext_wait_queue {		/* queue of sleeping tasks */
 	int state;		/* one of STATE_* values */
 };
 
+struct mq_msg_cache {
+	struct list_head free;	/* message buffers of mq_msgsize bytes */
+	int count;
+};
+
 struct mqueue_inode_info {
 	spinlock_t lock;
 	struct inode vfs_inode;
@@ -73,6 +80,9 @@ struct mqueue_inode_info {
 	struct ext_wait_queue e_wait_q[2];
 
 	unsigned long qsize; /* size of queue in memory (sum of all msgs) */
+
+	/* NULL unless mq_msgsize fits a single allocation */
+	struct mq_msg_cache __percpu *msg_cache;
 };
 
 static const struct inode_operations mqueue_dir_inode_operations;
@@ -107,6 +117,112 @@ static struct ipc_namespace *get_ns_from_inode(struct inode *inode)
 	return ns;
 }
 
+/*
+ * Queues of messages small enough for a single allocation keep the
+ * buffers of received messages on per cpu free lists, up to MQ_MSG_CACHE
+ * of them, so that a send takes one back without locking nor going to
+ * kmalloc.  The buffers all have room for mq_msgsize bytes.
+ */
+static void mq_put_msg_buf(struct mqueue_inode_info *info,
+			   struct msg_msg *msg)
+{
+	struct mq_msg_cache *cache = get_cpu_ptr(info->msg_cache);
+
+	if (cache->count < MQ_MSG_CACHE) {
+		list_add(&msg->m_list, &cache->free);
+		cache->count++;
+		msg = NULL;
+	}
+	put_cpu_ptr(info->msg_cache);
+	kfree(msg);
+}
+
+static struct msg_msg *mq_load_msg(struct mqueue_inode_info *info,
+				   const void __user *src, int len)
+{
+	struct mq_msg_cache *cache;
+	struct msg_msg *msg = NULL;
+	int err;
+
+	if (!info->msg_cache)
+		return load_msg(src, len);
+
+	cache = get_cpu_ptr(info->msg_cache);
+	if (cache->count) {
+		msg = list_first_entry(&cache->free, struct msg_msg, m_list);
+		list_del(&msg->m_list);
+		cache->count--;
+	}
+	put_cpu_ptr(info->msg_cache);
+
+	if (!msg) {
+		msg = kmalloc(sizeof(*msg) + info->attr.mq_msgsize, GFP_KERNEL);
+		if (!msg)
+			return ERR_PTR(-ENOMEM);
+	}
+
+	err = load_msg_into(msg, src, len);
+	if (err) {
+		mq_put_msg_buf(info, msg);
+		return ERR_PTR(err);
+	}
+	return msg;
+}
+
+static void mq_free_msg(struct mqueue_inode_info *info, struct msg_msg *msg)
+{
+	if (!info->msg_cache) {
+		free_msg(msg);
+		return;
+	}
+	release_msg(msg);
+	mq_put_msg_buf(info, msg);
+}
+
+static void mq_msg_cache_init(struct mqueue_inode_info *info)
+{
+	struct mq_msg_cache *cache;
+	struct msg_msg *msg;
+	int cpu, i;
+
+	if (info->attr.mq_msgsize > DATALEN_MSG)
+		return;
+
+	info->msg_cache = alloc_percpu(struct mq_msg_cache);
+	if (!info->msg_cache)
+		return;		/* kmalloc each message then */
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(info->msg_cache, cpu);
+		INIT_LIST_HEAD(&cache->free);
+		cache->count = 0;
+	}
+
+	/* the creator is likely to send first, fill its cpu */
+	for (i = 0; i < min_t(long, info->attr.mq_maxmsg, MQ_MSG_CACHE); i++) {
+		msg = kmalloc(sizeof(*msg) + info->attr.mq_msgsize, GFP_KERNEL);
+		if (!msg)
+			break;
+		mq_put_msg_buf(info, msg);
+	}
+}
+
+static void mq_msg_cache_free(struct mqueue_inode_info *info)
+{
+	struct mq_msg_cache *cache;
+	struct msg_msg *msg, *tmp;
+	int cpu;
+
+	if (!info->msg_cache)
+		return;
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(info->msg_cache, cpu);
+		list_for_each_entry_safe(msg, tmp, &cache->free, m_list)
+			kfree(msg);
+	}
+	free_percpu(info->msg_cache);
+	info->msg_cache = NULL;
+}
+
 static struct inode *mqueue_get_inode(struct super_block *sb,
 		struct ipc_namespace *ipc_ns, int mode,
 		struct mq_attr *attr)
@@ -140,6 +256,7 @@ static struct inode *mqueue_get_inode(struct super_block *sb,
 		INIT_LIST_HEAD(&info->e_wait_q[1].list);
 		info->notify_owner = NULL;
 		info->qsize = 0;
+		info->msg_cache = NULL;
 		info->user = NULL;	/* set when all is ok */
 		memset(&info->attr, 0, sizeof(info->attr));
 		info->attr.mq_maxmsg = ipc_ns->mq_msg_max;
@@ -167,6 +284,8 @@ static struct inode *mqueue_get_inode(struct super_block *sb,
 		u->mq_bytes += mq_bytes;
 		spin_unlock(&mq_lock);
 
+		mq_msg_cache_init(info);
+
 		/* all is ok */
 		info->user = get_uid(u);
 	} else if (S_ISDIR(mode)) {
@@ -268,9 +387,10 @@ static void mqueue_evict_inode(struct inode *inode)
 	info = MQUEUE_I(inode);
 	spin_lock(&info->lock);
 	for (i = 0; i < info->attr.mq_curmsgs; i++)
-		free_msg(info->messages[i]);
+		mq_free_msg(info, info->messages[i]);
 	kfree(info->messages);
 	spin_unlock(&info->lock);
+	mq_msg_cache_free(info);
 
 	/* Total amount of bytes accounted for the mqueue */
 	mq_bytes = info->attr.mq_maxmsg * (sizeof(struct msg_msg *)
@@ -451,10 +571,9 @@ static int wq_sleep(struct mqueue_inode_info *info, int sr,
 		time = schedule_hrtimeout_range_clock(timeout,
 		    HRTIMER_MODE_ABS, 0, CLOCK_REALTIME);
 
-		while (ewp->state == STATE_PENDING)
-			cpu_relax();
-
 		if (ewp->state == STATE_READY) {
+			/* pairs with the smp_wmb() in pipelined_send/receive */
+			smp_rmb();
 			retval = 0;
 			goto out;
 		}
@@ -805,45 +924,63 @@ out_unlock:
  * bypasses the message array and directly hands the message over to the
  * receiver.
  * The receiver accepts the message and returns without grabbing the queue
- * spinlock. Therefore an intermediate STATE_PENDING state and memory barriers
- * are necessary. The same algorithm is used for sysv semaphores, see
- * ipc/sem.c for more details.
+ * spinlock. It may thus see STATE_READY and return before it is woken:
+ * the waker takes a reference on its task, and wakes it with
+ * mq_wake_waiter() only once the queue spinlock is dropped, so that the
+ * woken task does not spin on it nor wait for the waker to leave it.
  *
  * The same algorithm is used for senders.
  */
 
 /* pipelined_send() - send a message directly to the task waiting in
  * sys_mq_timedreceive() (without inserting message into a queue).
+ * Returns the task to wake.
  */
-static inline void pipelined_send(struct mqueue_inode_info *info,
-				  struct msg_msg *message,
-				  struct ext_wait_queue *receiver)
+static inline struct task_struct *pipelined_send(
+				struct mqueue_inode_info *info,
+				struct msg_msg *message,
+				struct ext_wait_queue *receiver)
 {
+	struct task_struct *task = receiver->task;
+
 	receiver->msg = message;
 	list_del(&receiver->list);
-	receiver->state = STATE_PENDING;
-	wake_up_process(receiver->task);
+	get_task_struct(task);
 	smp_wmb();
 	receiver->state = STATE_READY;
+	return task;
 }
 
 /* pipelined_receive() - if there is task waiting in sys_mq_timedsend()
- * gets its message and put to the queue (we have one free place for sure). */
-static inline void pipelined_receive(struct mqueue_inode_info *info)
+ * gets its message and put to the queue (we have one free place for sure).
+ * Returns the task to wake, if any. */
+static inline struct task_struct *pipelined_receive(
+				struct mqueue_inode_info *info)
 {
 	struct ext_wait_queue *sender = wq_get_first_waiter(info, SEND);
+	struct task_struct *task;
 
 	if (!sender) {
 		/* for poll */
 		wake_up_interruptible(&info->wait_q);
-		return;
+		return NULL;
 	}
+	task = sender->task;
 	msg_insert(sender->msg, info);
 	list_del(&sender->list);
-	sender->state = STATE_PENDING;
-	wake_up_process(sender->task);
+	get_task_struct(task);
 	smp_wmb();
 	sender->state = STATE_READY;
+	return task;
+}
+
+/* called without the queue spinlock, see above */
+static inline void mq_wake_waiter(struct task_struct *task)
+{
+	if (task) {
+		wake_up_process(task);
+		put_task_struct(task);
+	}
 }
 
 SYSCALL_DEFINE5(mq_timedsend, mqd_t, mqdes, const char __user *, u_msg_ptr,
@@ -854,6 +991,7 @@ SYSCALL_DEFINE5(mq_timedsend, mqd_t, mqdes, const char __user *, u_msg_ptr,
 	struct inode *inode;
 	struct ext_wait_queue wait;
 	struct ext_wait_queue *receiver;
+	struct task_struct *waiter = NULL;
 	struct msg_msg *msg_ptr;
 	struct mqueue_inode_info *info;
 	ktime_t expires, *timeout = NULL;
@@ -898,7 +1036,7 @@ SYSCALL_DEFINE5(mq_timedsend, mqd_t, mqdes, const char __user *, u_msg_ptr,
 
 	/* First try to allocate memory, before doing anything with
 	 * existing queues. */
-	msg_ptr = load_msg(u_msg_ptr, msg_len);
+	msg_ptr = mq_load_msg(info, u_msg_ptr, msg_len);
 	if (IS_ERR(msg_ptr)) {
 		ret = PTR_ERR(msg_ptr);
 		goto out_fput;
@@ -919,11 +1057,11 @@ SYSCALL_DEFINE5(mq_timedsend, mqd_t, mqdes, const char __user *, u_msg_ptr,
 			ret = wq_sleep(info, SEND, timeout, &wait);
 		}
 		if (ret < 0)
-			free_msg(msg_ptr);
+			mq_free_msg(info, msg_ptr);
 	} else {
 		receiver = wq_get_first_waiter(info, RECV);
 		if (receiver) {
-			pipelined_send(info, msg_ptr, receiver);
+			waiter = pipelined_send(info, msg_ptr, receiver);
 		} else {
 			/* adds message to the queue */
 			msg_insert(msg_ptr, info);
@@ -932,6 +1070,7 @@ SYSCALL_DEFINE5(mq_timedsend, mqd_t, mqdes, const char __user *, u_msg_ptr,
 		inode->i_atime = inode->i_mtime = inode->i_ctime =
 				CURRENT_TIME;
 		spin_unlock(&info->lock);
+		mq_wake_waiter(waiter);
 		ret = 0;
 	}
 out_fput:
@@ -946,6 +1085,7 @@ SYSCALL_DEFINE5(mq_timedreceive, mqd_t, mqdes, char __user *, u_msg_ptr,
 {
 	ssize_t ret;
 	struct msg_msg *msg_ptr;
+	struct task_struct *waiter = NULL;
 	struct file *filp;
 	struct inode *inode;
 	struct mqueue_inode_info *info;
@@ -1005,8 +1145,9 @@ SYSCALL_DEFINE5(mq_timedreceive, mqd_t, mqdes, char __user *, u_msg_ptr,
 				CURRENT_TIME;
 
 		/* There is now free space in queue. */
-		pipelined_receive(info);
+		waiter = pipelined_receive(info);
 		spin_unlock(&info->lock);
+		mq_wake_waiter(waiter);
 		ret = 0;
 	}
 	if (ret == 0) {
@@ -1016,7 +1157,7 @@ SYSCALL_DEFINE5(mq_timedreceive, mqd_t, mqdes, char __user *, u_msg_ptr,
 			store_msg(u_msg_ptr, msg_ptr, msg_ptr->m_ts)) {
 			ret = -EFAULT;
 		}
-		free_msg(msg_ptr);
+		mq_free_msg(info, msg_ptr);
 	}
 out_fput:
 	fput(filp);
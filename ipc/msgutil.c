@@ -42,7 +42,6 @@ struct msg_msgseg {
 	/* the next part of the message follows immediately */
 };
 
-#define DATALEN_MSG	(PAGE_SIZE-sizeof(struct msg_msg))
 #define DATALEN_SEG	(PAGE_SIZE-sizeof(struct msg_msgseg))
 
 struct msg_msg *load_msg(const void __user *src, int len)
@@ -131,6 +130,31 @@ int store_msg(void __user *dest, struct msg_msg *msg, int len)
 	return 0;
 }
 
+/*
+ * load_msg_into - fill a message buffer kept by the caller
+ *
+ * @msg has room for @len bytes after it, at most DATALEN_MSG so that
+ * the message needs no segment.  On error @msg is left unused.
+ */
+int load_msg_into(struct msg_msg *msg, const void __user *src, int len)
+{
+	BUG_ON(len > DATALEN_MSG);
+
+	msg->next = NULL;
+	msg->security = NULL;
+
+	if (copy_from_user(msg + 1, src, len))
+		return -EFAULT;
+
+	return security_msg_msg_alloc(msg);
+}
+
+/* the counterpart of load_msg_into(), the buffer itself is kept */
+void release_msg(struct msg_msg *msg)
+{
+	security_msg_msg_free(msg);
+}
+
 void free_msg(struct msg_msg *msg)
 {
 	struct msg_msgseg *seg;
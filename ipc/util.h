@@ -137,8 +137,14 @@ struct kern_ipc_perm *ipcctl_pre_down(struct ipc_namespace *ns,
 int ipc_parse_version (int *cmd);
 #endif
 
+/* largest message held in a single allocation, without segments */
+#define DATALEN_MSG	(PAGE_SIZE-sizeof(struct msg_msg))
+
 extern void free_msg(struct msg_msg *msg);
 extern struct msg_msg *load_msg(const void __user *src, int len);
+extern int load_msg_into(struct msg_msg *msg, const void __user *src,
+			 int len);
+extern void release_msg(struct msg_msg *msg);
 extern int store_msg(void __user *dest, struct msg_msg *msg, int len);
 
 extern void recompute_msgmni(struct ipc_namespace *);
@@ -13,6 +13,7 @@
 #include <linux/module.h>
 #include <linux/kthread.h>
 #include <linux/stop_machine.h>
+#include <linux/cpuset.h>
 #include <linux/mutex.h>
 #include <linux/gfp.h>
 #include <linux/suspend.h>
@@ -208,6 +209,50 @@ static int __ref take_cpu_down(void *_param)
 	return 0;
 }
 
+/*
+ * A parked cpu stays online but leaves scheduling, for a fraction of the
+ * cost of cpu_down() and cpu_up(): it is marked inactive, the sched
+ * domains are rebuilt without it and the tasks queued on it are pushed
+ * away.  Wakeups and forks then place tasks elsewhere, see
+ * select_task_rq(), so only its per-cpu kthreads, its own timers and its
+ * interrupts wake it.  Idle drivers can use cpu_is_parked() to go for
+ * their deepest state rather than trusting recent wakeup history.
+ */
+static DEFINE_PER_CPU(bool, cpu_parked);
+
+int set_cpu_parked(unsigned int cpu, bool parked)
+{
+	int err = 0;
+
+	cpu_maps_update_begin();
+
+	if (parked == per_cpu(cpu_parked, cpu))
+		goto out;
+	if (parked && (!cpu_active(cpu) || num_active_cpus() == 1)) {
+		err = -EBUSY;
+		goto out;
+	}
+
+	get_online_cpus();
+	per_cpu(cpu_parked, cpu) = parked;
+	set_cpu_active(cpu, !parked);
+	cpuset_update_active_cpus();
+	put_online_cpus();
+
+	if (parked)
+		sched_evacuate_cpu(cpu);
+out:
+	cpu_maps_update_done();
+	return err;
+}
+EXPORT_SYMBOL_GPL(set_cpu_parked);
+
+bool cpu_is_parked(unsigned int cpu)
+{
+	return per_cpu(cpu_parked, cpu);
+}
+EXPORT_SYMBOL_GPL(cpu_is_parked);
+
 /* Requires cpu_add_remove_lock to be held */
 static int __ref _cpu_down(unsigned int cpu, int tasks_frozen)
 {
@@ -225,6 +270,9 @@ static int __ref _cpu_down(unsigned int cpu, int tasks_frozen)
 	if (!cpu_online(cpu))
 		return -EINVAL;
 
+	/* going down unparks; if it fails the cpu comes back active */
+	per_cpu(cpu_parked, cpu) = false;
+
 	cpu_hotplug_begin();
 
 	err = __cpu_notify(CPU_DOWN_PREPARE | mod, hcpu, -1, &nr_calls);
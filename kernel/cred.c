@@ -537,6 +537,9 @@ int commit_creds(struct cred *new)
 	    new->fsgid != old->fsgid)
 		proc_id_connector(task, PROC_EVENT_GID);
 
+	if (new->uid != old->uid)
+		sched_autogroup_setuid(task);
+
 	/* release the old obj and subj refs both */
 	put_cred(old);
 	put_cred(old);
@@ -3833,7 +3833,12 @@ static int perf_mmap(struct file *file, struct vm_area_struct *vma)
 	if (vma->vm_flags & VM_WRITE)
 		flags |= PERF_BUFFER_WRITABLE;
 
-	buffer = perf_buffer_alloc(nr_pages, event->attr.wakeup_watermark,
+	/*
+	 * wakeup_watermark shares its storage with wakeup_events: taken as
+	 * bytes when it is not one, it would wake the reader on every write.
+	 */
+	buffer = perf_buffer_alloc(nr_pages, event->attr.watermark ?
+				   event->attr.wakeup_watermark : 0,
 				   event->cpu, flags);
 	if (!buffer) {
 		ret = -ENOMEM;
@@ -4211,7 +4216,8 @@ void perf_output_end(struct perf_output_handle *handle)
 
 	int wakeup_events = event->attr.wakeup_events;
 
-	if (handle->sample && wakeup_events) {
+	/* with a byte watermark, this is not a count of events */
+	if (handle->sample && wakeup_events && !event->attr.watermark) {
 		int events = local_inc_return(&buffer->events);
 		if (events >= wakeup_events) {
 			local_sub(wakeup_events, &buffer->events);
@@ -69,6 +69,7 @@
 #include <linux/oom.h>
 #include <linux/khugepaged.h>
 #include <linux/signalfd.h>
+#include <linux/cpufreq_times.h>
 
 #include <asm/pgtable.h>
 #include <asm/pgalloc.h>
@@ -176,6 +177,7 @@ void free_task(struct task_struct *tsk)
 	free_thread_info(tsk->stack);
 	rt_mutex_debug_task_free(tsk);
 	ftrace_graph_exit_task(tsk);
+	cpufreq_task_times_exit(tsk);
 	free_task_struct(tsk);
 }
 EXPORT_SYMBOL(free_task);
@@ -516,6 +518,9 @@ static struct mm_struct * mm_init(struct mm_struct * mm, struct task_struct *p)
 	mm->core_state = NULL;
 	mm->nr_ptes = 0;
 	memset(&mm->rss_stat, 0, sizeof(mm->rss_stat));
+	atomic_long_set(&mm->fault_around, 0);
+	mm->smaps_pss = 0;
+	mm->smaps_pss_time = 0;
 	spin_lock_init(&mm->page_table_lock);
 	mm->free_area_cache = TASK_UNMAPPED_BASE;
 	mm->cached_hole_size = ~0UL;
@@ -739,6 +744,7 @@ void mm_release(struct task_struct *tsk, struct mm_struct *mm)
 struct mm_struct *dup_mm(struct task_struct *tsk)
 {
 	struct mm_struct *mm, *oldmm = current->mm;
+	ktime_t start = ktime_get();
 	int err;
 
 	if (!oldmm)
@@ -777,6 +783,8 @@ struct mm_struct *dup_mm(struct task_struct *tsk)
 	if (mm->binfmt && !try_module_get(mm->binfmt->module))
 		goto free_pt;
 
+	trace_task_dup_mm(tsk, mm, oldmm,
+			  ktime_to_ns(ktime_sub(ktime_get(), start)));
 	return mm;
 
 free_pt:
@@ -1125,6 +1133,7 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 		goto fork_out;
 
 	ftrace_graph_init_task(p);
+	cpufreq_task_times_init(p);
 
 	rt_mutex_init_task(p);
 
@@ -61,6 +61,8 @@
 #include <linux/nsproxy.h>
 #include <linux/ptrace.h>
 #include <linux/hugetlb.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #include <asm/futex.h>
 
@@ -105,9 +107,22 @@ static const struct futex_q futex_q_init = {
 	.bitset = FUTEX_BITSET_MATCH_ANY
 };
 
+#ifdef CONFIG_FUTEX_STATS
+struct futex_hb_stats {
+	unsigned long locks;
+	unsigned long contended;
+	unsigned long waits;
+	atomic_t spins;
+	atomic_t spin_hits;
+};
+#endif
+
 struct futex_hash_bucket {
 	spinlock_t lock;
 	struct plist_head chain;
+#ifdef CONFIG_FUTEX_STATS
+	struct futex_hb_stats stats;
+#endif
 };
 
 static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
@@ -123,6 +138,20 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
 }
 
+static inline void futex_hb_lock(struct futex_hash_bucket *hb)
+	__acquires(&hb->lock)
+{
+#ifdef CONFIG_FUTEX_STATS
+	if (!spin_trylock(&hb->lock)) {
+		spin_lock(&hb->lock);
+		hb->stats.contended++;
+	}
+	hb->stats.locks++;
+#else
+	spin_lock(&hb->lock);
+#endif
+}
+
 static inline int match_futex(union futex_key *key1, union futex_key *key2)
 {
 	return (key1 && key2
@@ -846,7 +875,7 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 		goto out;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	futex_hb_lock(hb);
 	head = &hb->chain;
 
 	plist_for_each_entry_safe(this, next, head, list) {
@@ -1250,7 +1279,7 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 	hb = hash_futex(&q->key);
 	q->lock_ptr = &hb->lock;
 
-	spin_lock(&hb->lock);
+	futex_hb_lock(hb);
 	return hb;
 }
 
@@ -1271,6 +1300,9 @@ static inline void queue_me(struct futex_q *q, struct futex_hash_bucket *hb)
 	plist_node_init(&q->list, prio);
 	plist_add(&q->list, &hb->chain);
 	q->task = current;
+#ifdef CONFIG_FUTEX_STATS
+	hb->stats.waits++;
+#endif
 	spin_unlock(&hb->lock);
 }
 
@@ -1533,6 +1565,87 @@ out:
 }
 
 
+#ifdef CONFIG_SMP
+#ifdef CONFIG_FUTEX_STATS
+static void futex_stat_spin(u32 __user *uaddr, unsigned int flags, int hit)
+{
+	union futex_key key = FUTEX_KEY_INIT;
+	struct futex_hash_bucket *hb;
+
+	if (get_futex_key(uaddr, flags & FLAGS_SHARED, &key, VERIFY_READ))
+		return;
+
+	hb = hash_futex(&key);
+	atomic_inc(&hb->stats.spins);
+	if (hit)
+		atomic_inc(&hb->stats.spin_hits);
+	put_futex_key(&key);
+}
+#else
+static inline void
+futex_stat_spin(u32 __user *uaddr, unsigned int flags, int hit) { }
+#endif
+
+/*
+ * Adaptive spinning, after mutex_spin_on_owner(): the low FUTEX_TID_MASK
+ * bits of a lock word hold the TID of its owner, as for the PI futexes.
+ * While that owner is running on another cpu it is likely to release the
+ * lock soon, so rather than sleep right away, spin until the word moves
+ * away from @val or the owner gets off its cpu.
+ *
+ * Returns 1 if the lock word changed, 0 if the caller has to block.
+ */
+static int futex_spin_on_owner(u32 __user *uaddr, unsigned int flags, u32 val)
+{
+	struct task_struct *owner;
+	pid_t pid = val & FUTEX_TID_MASK;
+	u32 uval;
+	int ret = 0;
+
+	if (!pid || pid == task_pid_vnr(current))
+		return 0;
+
+	owner = futex_find_get_task(pid);
+	if (!owner)
+		return 0;
+
+	while (owner->on_cpu && !need_resched()) {
+		if (get_futex_value_locked(&uval, uaddr))
+			break;
+		if (uval != val) {
+			ret = 1;
+			break;
+		}
+		cpu_relax();
+	}
+	put_task_struct(owner);
+
+	futex_stat_spin(uaddr, flags, ret);
+	return ret;
+}
+#else
+static inline int
+futex_spin_on_owner(u32 __user *uaddr, unsigned int flags, u32 val)
+{
+	return 0;
+}
+#endif
+
+/*
+ * FUTEX_WAIT for a lock word holding the owner's TID: spin while the owner
+ * runs, and return -EWOULDBLOCK like a changed word does for FUTEX_WAIT
+ * when it released the lock meanwhile, so a short critical section does
+ * not cost the waiter a context switch.
+ */
+static int futex_wait_adaptive(u32 __user *uaddr, unsigned int flags, u32 val,
+			       ktime_t *abs_time)
+{
+	if (futex_spin_on_owner(uaddr, flags, val))
+		return -EWOULDBLOCK;
+
+	return futex_wait(uaddr, flags, val, abs_time, FUTEX_BITSET_MATCH_ANY);
+}
+
 static long futex_wait_restart(struct restart_block *restart)
 {
 	u32 __user *uaddr = restart->futex.uaddr;
@@ -1556,10 +1669,15 @@ static int futex_lock_pi(u32 __user *uaddr, unsigned int flags, int detect,
 	struct futex_hash_bucket *hb;
 	struct futex_q q = futex_q_init;
 	int res, ret;
+	u32 uval;
 
 	if (refill_pi_state_cache())
 		return -ENOMEM;
 
+	/* a lock held by a running owner is likely free before we'd sleep */
+	if (!trylock && !get_user(uval, uaddr))
+		futex_spin_on_owner(uaddr, flags, uval);
+
 	if (time) {
 		to = &timeout;
 		hrtimer_init_on_stack(&to->timer, CLOCK_REALTIME,
@@ -1663,7 +1781,7 @@ retry:
 		goto out;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	futex_hb_lock(hb);
 
 	/*
 	* To avoid races, try to do the TID -> 0 atomic transition
@@ -2029,6 +2147,9 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	case FUTEX_CMP_REQUEUE_PI:
 		ret = futex_requeue(uaddr, flags, uaddr2, val, val2, &val3, 1);
 		break;
+	case FUTEX_WAIT_ADAPTIVE:
+		ret = futex_wait_adaptive(uaddr, flags, val, timeout);
+		break;
 	default:
 		ret = -ENOSYS;
 	}
@@ -2047,14 +2168,15 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_ADAPTIVE)) {
 		if (copy_from_user(&ts, utime, sizeof(ts)) != 0)
 			return -EFAULT;
 		if (!timespec_valid(&ts))
 			return -EINVAL;
 
 		t = timespec_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_ADAPTIVE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -2081,3 +2203,77 @@ static int __init futex_init(void)
 	return 0;
 }
 __initcall(futex_init);
+
+#ifdef CONFIG_FUTEX_STATS
+/*
+ * /proc/futex_stats: per hash bucket in use, how often its lock was taken
+ * and found contended, the waiters it queued and the adaptive spins done
+ * on its futexes with how many of them saw the lock released.  A write
+ * clears it.
+ */
+static int futex_stats_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	seq_printf(m, "# bucket locks contended waits spins spin_hits\n");
+
+	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+		struct futex_hash_bucket *hb = &futex_queues[i];
+		struct futex_hb_stats stats;
+
+		spin_lock(&hb->lock);
+		stats = hb->stats;
+		spin_unlock(&hb->lock);
+
+		if (!stats.locks && !atomic_read(&stats.spins))
+			continue;
+
+		seq_printf(m, "%d %lu %lu %lu %d %d\n", i, stats.locks,
+			   stats.contended, stats.waits,
+			   atomic_read(&stats.spins),
+			   atomic_read(&stats.spin_hits));
+	}
+
+	return 0;
+}
+
+static ssize_t futex_stats_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+		struct futex_hash_bucket *hb = &futex_queues[i];
+
+		spin_lock(&hb->lock);
+		hb->stats.locks = 0;
+		hb->stats.contended = 0;
+		hb->stats.waits = 0;
+		atomic_set(&hb->stats.spins, 0);
+		atomic_set(&hb->stats.spin_hits, 0);
+		spin_unlock(&hb->lock);
+	}
+
+	return count;
+}
+
+static int futex_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, futex_stats_show, NULL);
+}
+
+static const struct file_operations futex_stats_fops = {
+	.open		= futex_stats_open,
+	.read		= seq_read,
+	.write		= futex_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init futex_stats_init(void)
+{
+	proc_create("futex_stats", S_IRUGO | S_IWUSR, NULL, &futex_stats_fops);
+	return 0;
+}
+module_init(futex_stats_init);
+#endif /* CONFIG_FUTEX_STATS */
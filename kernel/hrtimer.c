@@ -950,6 +950,25 @@ remove_hrtimer(struct hrtimer *timer, struct hrtimer_clock_base *base)
 	return 0;
 }
 
+/*
+ * Pull the hard expiry of a timer with slack down to the coarsest power
+ * of two nanosecond boundary that still lies inside its range.  Timers
+ * armed independently of each other with a similar slack then share the
+ * same boundaries and are run from one interrupt, instead of each of
+ * them waking the cpu on its own.
+ */
+static inline void hrtimer_align_expires(struct hrtimer *timer,
+					 unsigned long delta_ns)
+{
+	s64 expires = hrtimer_get_expires_tv64(timer);
+
+	if (!delta_ns || expires == KTIME_MAX)
+		return;
+
+	hrtimer_set_expires_tv64(timer,
+				 expires & ~((1LL << __fls(delta_ns)) - 1));
+}
+
 int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 		unsigned long delta_ns, const enum hrtimer_mode mode,
 		int wakeup)
@@ -981,6 +1000,7 @@ int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 	}
 
 	hrtimer_set_expires_range_ns(timer, tim, delta_ns);
+	hrtimer_align_expires(timer, delta_ns);
 
 	timer_stats_hrtimer_set_start_info(timer);
 
@@ -1324,6 +1344,10 @@ retry:
 				break;
 			}
 
+			/* ran early off another timer's interrupt */
+			if (basenow.tv64 < hrtimer_get_expires_tv64(timer))
+				cpu_base->nr_coalesced++;
+
 			__run_hrtimer(timer, &basenow);
 		}
 	}
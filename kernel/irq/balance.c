@@ -0,0 +1,301 @@
+/*
+ * linux/kernel/irq/balance.c
+ *
+ * In kernel interrupt balancing.
+ *
+ * Device interrupts all start out on the boot cpu.  Every
+ * irq_balance.interval_ms the time spent in each interrupt's hard and
+ * threaded handlers is compared with how busy each online cpu was, and
+ * interrupts are moved, most expensive first, to the least loaded cpu.
+ * Moving the hard irq moves its handler threads along with it; for an
+ * irq chip that cannot route its interrupts, e.g. gpio banks demuxed from
+ * one parent interrupt, only the handler threads are moved.
+ *
+ * An interrupt stays where it is unless another cpu is less loaded by
+ * more than the interrupt's own cost, so the assignment settles instead
+ * of bouncing.  Interrupts marked with irq_set_balance_avoid_fg() - the
+ * display and the touchscreen - are kept off the cpus that foreground
+ * tasks are queued on.  Per cpu and IRQF_NOBALANCING interrupts, and
+ * those with an affinity hint or set from user space, are left alone;
+ * writing a mask of all cpus to smp_affinity hands one back to the
+ * balancer.
+ */
+
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/kernel_stat.h>
+#include <linux/workqueue.h>
+#include <linux/cpu.h>
+#include <linux/sort.h>
+#include <linux/slab.h>
+#include <linux/module.h>
+
+#include "internals.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "irq_balance."
+
+static unsigned int interval_ms = 2000;
+module_param(interval_ms, uint, 0644);
+
+struct irq_balance_entry {
+	unsigned int	irq;
+	int		cpu;
+	bool		avoid_fg;
+	bool		thread_only;
+	u64		cost;
+	u64		thread;
+};
+
+static DEFINE_PER_CPU(u64, balance_load);
+static DEFINE_PER_CPU(u64, balance_busy);
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DEFERRED_WORK(irq_balance_work, irq_balance_fn);
+
+void irq_balance_account_thread(struct irq_desc *desc, u64 start, u64 end)
+{
+	struct irq_balance *b = &desc->balance;
+	u64 delta = end - start;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	b->thread_ns += delta;
+	if (delta > b->thread_max_ns)
+		b->thread_max_ns = delta;
+	b->nr_thread++;
+
+	if ((s64)(start - b->hard_stamp) > 0) {
+		delta = start - b->hard_stamp;
+		b->wait_ns += delta;
+		if (delta > b->wait_max_ns)
+			b->wait_max_ns = delta;
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+}
+
+void irq_balance_user_affinity(struct irq_desc *desc,
+			       const struct cpumask *mask)
+{
+	desc->balance.pinned = !cpumask_subset(cpu_possible_mask, mask);
+}
+
+/**
+ *	irq_set_balance_avoid_fg - keep an irq off the foreground cpus
+ *	@irq:		Interrupt to mark
+ *	@avoid:		Whether to place it away from foreground tasks
+ *
+ *	For interrupts whose handlers would otherwise compete with the UI
+ *	thread, e.g. display and touch.
+ */
+void irq_set_balance_avoid_fg(unsigned int irq, bool avoid)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+
+	if (desc)
+		desc->balance.avoid_fg = avoid;
+}
+
+/* time the cpu spent in tasks, interrupt handler threads included */
+static u64 cpu_busy_ns(int cpu)
+{
+	struct cpu_usage_stat *stat = &kstat_cpu(cpu).cpustat;
+	cputime64_t busy;
+
+	busy = cputime64_add(stat->user, stat->nice);
+	busy = cputime64_add(busy, stat->system);
+
+	return cputime64_to_jiffies64(busy) * TICK_NSEC;
+}
+
+static int irq_balance_cmp(const void *a, const void *b)
+{
+	const struct irq_balance_entry *ea = a, *eb = b;
+
+	if (ea->cost == eb->cost)
+		return 0;
+	return ea->cost > eb->cost ? -1 : 1;
+}
+
+static bool irq_balance_cpu_ok(struct irq_balance_entry *e, int cpu,
+			       bool fg_free)
+{
+	return !(e->avoid_fg && fg_free && nr_foreground_cpu(cpu));
+}
+
+static int irq_balance_pick(struct irq_balance_entry *e)
+{
+	bool fg_free = false;
+	int cpu, best = -1;
+
+	if (e->avoid_fg)
+		for_each_online_cpu(cpu)
+			if (!nr_foreground_cpu(cpu))
+				fg_free = true;
+
+	for_each_online_cpu(cpu) {
+		if (!irq_balance_cpu_ok(e, cpu, fg_free))
+			continue;
+		if (best < 0 ||
+		    per_cpu(balance_load, cpu) < per_cpu(balance_load, best))
+			best = cpu;
+	}
+
+	/* not worth a move unless it takes more than the irq's own cost */
+	if (e->cpu >= 0 && irq_balance_cpu_ok(e, e->cpu, fg_free) &&
+	    per_cpu(balance_load, e->cpu) <=
+	    per_cpu(balance_load, best) + e->cost)
+		best = e->cpu;
+
+	return best;
+}
+
+/*
+ * Snapshot the cost of each interrupt since the last pass.  Hard irq
+ * time is not part of a cpu's busy time, so that of the interrupts which
+ * stay put is added to the load of their cpu.
+ */
+static int irq_balance_collect(struct irq_balance_entry *entries, int max)
+{
+	struct irq_desc *desc;
+	int irq, n = 0;
+
+	for_each_irq_desc(irq, desc) {
+		struct irq_balance *b = &desc->balance;
+		struct irq_data *d = &desc->irq_data;
+		struct irq_balance_entry *e = &entries[n];
+		struct irqaction *action;
+		bool balance, threaded = false;
+
+		if (n == max)
+			break;
+
+		raw_spin_lock_irq(&desc->lock);
+		e->cost = b->hard_ns + b->thread_ns - b->last_cost;
+		e->thread = b->thread_ns - b->last_thread;
+		b->last_cost = b->hard_ns + b->thread_ns;
+		b->last_thread = b->thread_ns;
+		for (action = desc->action; action; action = action->next)
+			if (action->thread)
+				threaded = true;
+		e->thread_only = !d->chip || !d->chip->irq_set_affinity;
+		balance = desc->action && irqd_can_balance(d) && !b->pinned &&
+			  !desc->affinity_hint && (!e->thread_only || threaded);
+		e->irq = irq;
+		e->avoid_fg = b->avoid_fg;
+		e->cpu = cpumask_first_and(d->affinity, cpu_online_mask);
+		raw_spin_unlock_irq(&desc->lock);
+
+		if (e->cpu >= nr_cpu_ids)
+			e->cpu = -1;
+		/* only the threads move, the hard irq is its parent's */
+		if (e->thread_only)
+			e->cost = e->thread;
+
+		if (balance) {
+			n++;
+		} else if (e->cpu >= 0) {
+			per_cpu(balance_load, e->cpu) += e->cost - e->thread;
+		}
+	}
+
+	return n;
+}
+
+static void irq_balance_move(struct irq_balance_entry *e, int cpu)
+{
+	struct irq_desc *desc = irq_to_desc(e->irq);
+	unsigned long flags;
+
+	if (!e->thread_only) {
+		irq_set_affinity(e->irq, cpumask_of(cpu));
+		return;
+	}
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	cpumask_copy(desc->irq_data.affinity, cpumask_of(cpu));
+	irq_set_thread_affinity(desc);
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	struct irq_balance_entry *entries;
+	int cpu, i, n;
+
+	entries = kmalloc(nr_irqs * sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		goto out;
+
+	get_online_cpus();
+
+	for_each_possible_cpu(cpu) {
+		u64 busy = cpu_busy_ns(cpu);
+
+		per_cpu(balance_load, cpu) = busy - per_cpu(balance_busy, cpu);
+		per_cpu(balance_busy, cpu) = busy;
+	}
+
+	n = irq_balance_collect(entries, nr_irqs);
+
+	/* the threads of the balanced ones move along with them */
+	for (i = 0; i < n; i++) {
+		struct irq_balance_entry *e = &entries[i];
+		u64 *load;
+
+		if (e->cpu < 0)
+			continue;
+		load = &per_cpu(balance_load, e->cpu);
+		*load -= min(*load, e->thread);
+	}
+
+	sort(entries, n, sizeof(*entries), irq_balance_cmp, NULL);
+
+	for (i = 0; i < n; i++) {
+		struct irq_balance_entry *e = &entries[i];
+
+		cpu = irq_balance_pick(e);
+		if (cpu < 0)
+			continue;
+
+		per_cpu(balance_load, cpu) += e->cost;
+		if (cpu != e->cpu)
+			irq_balance_move(e, cpu);
+	}
+
+	put_online_cpus();
+	kfree(entries);
+out:
+	queue_delayed_work(system_nrt_wq, &irq_balance_work,
+			   msecs_to_jiffies(interval_ms));
+}
+
+static int __cpuinit irq_balance_cpu_notify(struct notifier_block *self,
+					    unsigned long action, void *hcpu)
+{
+	switch (action) {
+	case CPU_ONLINE:
+	case CPU_DEAD:
+		/* rebalance right away rather than at the next pass */
+		if (cancel_delayed_work(&irq_balance_work))
+			queue_delayed_work(system_nrt_wq, &irq_balance_work, 0);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static int __init irq_balance_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		per_cpu(balance_busy, cpu) = cpu_busy_ns(cpu);
+
+	hotcpu_notifier(irq_balance_cpu_notify, 0);
+	queue_delayed_work(system_nrt_wq, &irq_balance_work,
+			   msecs_to_jiffies(interval_ms));
+	return 0;
+}
+late_initcall(irq_balance_init);
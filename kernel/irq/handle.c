@@ -166,6 +166,7 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 irqreturn_t handle_irq_event(struct irq_desc *desc)
 {
 	struct irqaction *action = desc->action;
+	u64 start = irq_balance_clock();
 	irqreturn_t ret;
 
 	desc->istate &= ~IRQS_PENDING;
@@ -175,6 +176,7 @@ irqreturn_t handle_irq_event(struct irq_desc *desc)
 	ret = handle_irq_event_percpu(desc, action);
 
 	raw_spin_lock(&desc->lock);
+	irq_balance_account_hard(desc, start, irq_balance_clock());
 	irqd_clear(&desc->irq_data, IRQD_IRQ_INPROGRESS);
 	return ret;
 }
@@ -6,6 +6,7 @@
  * of this file for your non core code.
  */
 #include <linux/irqdesc.h>
+#include <linux/sched.h>
 
 #ifdef CONFIG_SPARSE_IRQ
 # define IRQ_BITMAP_BITS	(NR_IRQS + 8196)
@@ -101,6 +102,44 @@ extern int irq_select_affinity_usr(unsigned int irq, struct cpumask *mask);
 
 extern void irq_set_thread_affinity(struct irq_desc *desc);
 
+#ifdef CONFIG_IRQ_BALANCE
+static inline u64 irq_balance_clock(void)
+{
+	return local_clock();
+}
+
+/* Called with desc->lock held */
+static inline void
+irq_balance_account_hard(struct irq_desc *desc, u64 start, u64 end)
+{
+	struct irq_balance *b = &desc->balance;
+	u64 delta = end - start;
+
+	b->hard_ns += delta;
+	if (delta > b->hard_max_ns)
+		b->hard_max_ns = delta;
+	b->nr_hard++;
+	b->hard_stamp = start;
+}
+
+extern void irq_balance_account_thread(struct irq_desc *desc, u64 start,
+				       u64 end);
+extern void irq_balance_user_affinity(struct irq_desc *desc,
+				      const struct cpumask *mask);
+#else
+static inline u64 irq_balance_clock(void)
+{
+	return 0;
+}
+
+static inline void
+irq_balance_account_hard(struct irq_desc *desc, u64 start, u64 end) { }
+static inline void
+irq_balance_account_thread(struct irq_desc *desc, u64 start, u64 end) { }
+static inline void
+irq_balance_user_affinity(struct irq_desc *desc, const struct cpumask *mask) { }
+#endif
+
 /* Inline functions for support of irq chips on slow busses */
 static inline void chip_bus_lock(struct irq_desc *desc)
 {
@@ -806,10 +806,13 @@ static int irq_thread(void *data)
 			desc->istate |= IRQS_PENDING;
 			raw_spin_unlock_irq(&desc->lock);
 		} else {
+			u64 start = irq_balance_clock();
 			irqreturn_t action_ret;
 
 			raw_spin_unlock_irq(&desc->lock);
 			action_ret = handler_fn(desc, action);
+			irq_balance_account_thread(desc, start,
+						   irq_balance_clock());
 			if (!noirqdebug)
 				note_interrupt(action->irq, desc, action_ret);
 		}
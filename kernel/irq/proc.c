@@ -109,6 +109,7 @@ static ssize_t write_irq_affinity(int type, struct file *file,
 		err = irq_select_affinity_usr(irq, new_value) ? -EINVAL : count;
 	} else {
 		irq_set_affinity(irq, new_value);
+		irq_balance_user_affinity(irq_to_desc(irq), new_value);
 		err = count;
 	}
 
@@ -266,6 +267,81 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_IRQ_BALANCE
+static int irq_latency_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	struct irq_balance b;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	b = desc->balance;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	seq_printf(m, "hard_count %u\n" "hard_total %llu us\n"
+		   "hard_max %llu us\n", b.nr_hard,
+		   div_u64(b.hard_ns, NSEC_PER_USEC),
+		   div_u64(b.hard_max_ns, NSEC_PER_USEC));
+	seq_printf(m, "thread_count %u\n" "thread_total %llu us\n"
+		   "thread_max %llu us\n", b.nr_thread,
+		   div_u64(b.thread_ns, NSEC_PER_USEC),
+		   div_u64(b.thread_max_ns, NSEC_PER_USEC));
+	seq_printf(m, "thread_wakeup_total %llu us\n"
+		   "thread_wakeup_max %llu us\n",
+		   div_u64(b.wait_ns, NSEC_PER_USEC),
+		   div_u64(b.wait_max_ns, NSEC_PER_USEC));
+	return 0;
+}
+
+static int irq_latency_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_latency_proc_show, PDE(inode)->data);
+}
+
+static const struct file_operations irq_latency_proc_fops = {
+	.open		= irq_latency_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int irq_avoid_fg_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+
+	seq_printf(m, "%d\n", desc->balance.avoid_fg);
+	return 0;
+}
+
+static ssize_t irq_avoid_fg_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE(file->f_path.dentry->d_inode)->data;
+	unsigned int avoid;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 0, &avoid);
+	if (err)
+		return err;
+
+	irq_set_balance_avoid_fg(irq, avoid);
+	return count;
+}
+
+static int irq_avoid_fg_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_avoid_fg_proc_show, PDE(inode)->data);
+}
+
+static const struct file_operations irq_avoid_fg_proc_fops = {
+	.open		= irq_avoid_fg_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_avoid_fg_proc_write,
+};
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -339,6 +415,14 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 			 &irq_node_proc_fops, (void *)(long)irq);
 #endif
 
+#ifdef CONFIG_IRQ_BALANCE
+	proc_create_data("latency", 0444, desc->dir,
+			 &irq_latency_proc_fops, (void *)(long)irq);
+
+	proc_create_data("avoid_foreground", 0644, desc->dir,
+			 &irq_avoid_fg_proc_fops, (void *)(long)irq);
+#endif
+
 	proc_create_data("spurious", 0444, desc->dir,
 			 &irq_spurious_proc_fops, (void *)(long)irq);
 }
@@ -354,6 +438,10 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("affinity_hint", desc->dir);
 	remove_proc_entry("smp_affinity_list", desc->dir);
 	remove_proc_entry("node", desc->dir);
+#endif
+#ifdef CONFIG_IRQ_BALANCE
+	remove_proc_entry("latency", desc->dir);
+	remove_proc_entry("avoid_foreground", desc->dir);
 #endif
 	remove_proc_entry("spurious", desc->dir);
 
@@ -13,10 +13,13 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/seq_file.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
@@ -45,6 +48,11 @@ enum {
 };
 static int state;
 
+/* EARLY_SUSPEND_ASYNC handlers of the early suspend or late resume running */
+static LIST_HEAD(early_suspend_domain);
+static bool late_resuming;
+static u32 early_suspend_us, late_resume_us;
+
 void register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
@@ -71,11 +79,64 @@ void unregister_early_suspend(struct early_suspend *handler)
 }
 EXPORT_SYMBOL(unregister_early_suspend);
 
+static u32 early_suspend_since(ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	return us > 0 ? us : 0;
+}
+
+static void early_suspend_call(struct early_suspend *h)
+{
+	ktime_t start = ktime_get();
+	u32 us;
+
+	if (late_resuming) {
+		h->resume(h);
+		us = early_suspend_since(start);
+		h->resume_us = us;
+		if (us > h->max_resume_us)
+			h->max_resume_us = us;
+	} else {
+		h->suspend(h);
+		us = early_suspend_since(start);
+		h->suspend_us = us;
+		if (us > h->max_suspend_us)
+			h->max_suspend_us = us;
+	}
+}
+
+static void early_suspend_call_async(void *data, async_cookie_t cookie)
+{
+	early_suspend_call(data);
+}
+
+/* Called with early_suspend_lock held, see late_resuming. */
+static void early_suspend_run(struct early_suspend *h)
+{
+	void (*fn)(struct early_suspend *h);
+
+	fn = late_resuming ? h->resume : h->suspend;
+	if (fn == NULL)
+		return;
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("%s: calling %pf%s\n",
+			late_resuming ? "late_resume" : "early_suspend", fn,
+			h->flags & EARLY_SUSPEND_ASYNC ? " async" : "");
+	if (h->flags & EARLY_SUSPEND_ASYNC)
+		async_schedule_domain(early_suspend_call_async, h,
+				      &early_suspend_domain);
+	else
+		early_suspend_call(h);
+}
+
 static void early_suspend(struct work_struct *work)
 {
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -94,13 +155,12 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("early_suspend: calling %pf\n", pos->suspend);
-			pos->suspend(pos);
-		}
-	}
+	start = ktime_get();
+	late_resuming = false;
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		early_suspend_run(pos);
+	async_synchronize_full_domain(&early_suspend_domain);
+	early_suspend_us = early_suspend_since(start);
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -119,6 +179,7 @@ static void late_resume(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -135,14 +196,17 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-		if (pos->resume != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("late_resume: calling %pf\n", pos->resume);
-
-			pos->resume(pos);
-		}
-	}
+	start = ktime_get();
+	late_resuming = true;
+	/* what the screen needs first, then everything else */
+	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
+		if (pos->flags & EARLY_SUSPEND_RESUME_FIRST)
+			early_suspend_run(pos);
+	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
+		if (!(pos->flags & EARLY_SUSPEND_RESUME_FIRST))
+			early_suspend_run(pos);
+	async_synchronize_full_domain(&early_suspend_domain);
+	late_resume_us = early_suspend_since(start);
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 abort:
@@ -185,3 +249,48 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_debug_show(struct seq_file *s, void *data)
+{
+	struct early_suspend *pos;
+
+	mutex_lock(&early_suspend_lock);
+	seq_printf(s, "last early suspend %u us, late resume %u us\n",
+		   early_suspend_us, late_resume_us);
+	seq_printf(s, "level flags    suspend        max     resume        max"
+		   "  handler\n");
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		seq_printf(s, "%5d %c%c    %10u %10u %10u %10u  %pf\n",
+			   pos->level,
+			   pos->flags & EARLY_SUSPEND_ASYNC ? 'a' : '-',
+			   pos->flags & EARLY_SUSPEND_RESUME_FIRST ? 'f' : '-',
+			   pos->suspend_us, pos->max_suspend_us,
+			   pos->resume_us, pos->max_resume_us,
+			   pos->suspend ? (void *)pos->suspend :
+					  (void *)pos->resume);
+	mutex_unlock(&early_suspend_lock);
+
+	return 0;
+}
+
+static int early_suspend_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_debug_show, NULL);
+}
+
+static const struct file_operations early_suspend_debug_fops = {
+	.open		= early_suspend_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_debug_init(void)
+{
+	debugfs_create_file("earlysuspend", 0444, NULL, NULL,
+			    &early_suspend_debug_fops);
+	return 0;
+}
+late_initcall(early_suspend_debug_init);
+#endif
@@ -59,6 +59,7 @@ static void start_drawing_late_resume(struct early_suspend *h)
 
 static struct early_suspend stop_drawing_early_suspend_desc = {
 	.level = EARLY_SUSPEND_LEVEL_STOP_DRAWING,
+	.flags = EARLY_SUSPEND_RESUME_FIRST,
 	.suspend = stop_drawing_early_suspend,
 	.resume = start_drawing_late_resume,
 };
@@ -41,6 +41,9 @@
 #include <linux/platform_device.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
+#include <linux/jiffies.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/uaccess.h>
 
@@ -54,6 +57,21 @@ enum pm_qos_type {
 	PM_QOS_MIN		/* return the smallest value */
 };
 
+/*
+ * How often the requests of a class are updated, for the rate the hot
+ * paths changing them run at.  @unchanged counts the updates returning
+ * early since they asked for what the request already had, without
+ * taking pm_qos_lock; the rest is under it.
+ */
+struct pm_qos_stats {
+	unsigned long updates;
+	atomic_t unchanged;
+	unsigned long target_changes;
+	unsigned int peak_rate;
+	unsigned long window;
+	unsigned int window_updates;
+};
+
 /*
  * Note: The lockless read path depends on the CPU accessing
  * target_value atomically.  Atomic access is only guaranteed on all CPU
@@ -67,6 +85,7 @@ struct pm_qos_object {
 	s32 target_value;	/* Do not change to 64 bit */
 	s32 default_value;
 	enum pm_qos_type type;
+	struct pm_qos_stats stats;
 };
 
 static DEFINE_SPINLOCK(pm_qos_lock);
@@ -155,6 +174,17 @@ static inline void pm_qos_set_value(struct pm_qos_object *o, s32 value)
 	o->target_value = value;
 }
 
+static void pm_qos_count_update(struct pm_qos_stats *st)
+{
+	st->updates++;
+	if (time_after_eq(jiffies, st->window + HZ)) {
+		st->window = jiffies;
+		st->window_updates = 0;
+	}
+	if (++st->window_updates > st->peak_rate)
+		st->peak_rate = st->window_updates;
+}
+
 static void update_target(struct pm_qos_object *o, struct plist_node *node,
 			  int del, int value)
 {
@@ -162,6 +192,7 @@ static void update_target(struct pm_qos_object *o, struct plist_node *node,
 	int prev_value, curr_value;
 
 	spin_lock_irqsave(&pm_qos_lock, flags);
+	pm_qos_count_update(&o->stats);
 	prev_value = pm_qos_get_value(o);
 	/* PM_QOS_DEFAULT_VALUE is a signal that the value is unchanged */
 	if (value != PM_QOS_DEFAULT_VALUE) {
@@ -180,6 +211,8 @@ static void update_target(struct pm_qos_object *o, struct plist_node *node,
 	}
 	curr_value = pm_qos_get_value(o);
 	pm_qos_set_value(o, curr_value);
+	if (prev_value != curr_value)
+		o->stats.target_changes++;
 	spin_unlock_irqrestore(&pm_qos_lock, flags);
 
 	if (prev_value != curr_value)
@@ -294,6 +327,8 @@ void pm_qos_update_request(struct pm_qos_request_list *pm_qos_req,
 
 	if (temp != pm_qos_req->list.prio)
 		update_target(o, &pm_qos_req->list, 0, temp);
+	else
+		atomic_inc(&o->stats.unchanged);
 }
 EXPORT_SYMBOL_GPL(pm_qos_update_request);
 
@@ -455,11 +490,57 @@ static ssize_t pm_qos_power_write(struct file *filp, const char __user *buf,
 	return count;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int pm_qos_stats_show(struct seq_file *s, void *unused)
+{
+	struct pm_qos_object *o;
+	struct pm_qos_stats st;
+	struct plist_node *node;
+	unsigned long flags;
+	int i, nr, target;
+
+	for (i = 1; i < PM_QOS_NUM_CLASSES; i++) {
+		o = pm_qos_array[i];
+		nr = 0;
+
+		spin_lock_irqsave(&pm_qos_lock, flags);
+		plist_for_each(node, &o->requests)
+			nr++;
+		target = pm_qos_get_value(o);
+		st = o->stats;
+		spin_unlock_irqrestore(&pm_qos_lock, flags);
+
+		seq_printf(s, "%s: target %d, %d requests, %lu updates, "
+			   "%d unchanged, %lu target changes, peak %u/s\n",
+			   o->name, target, nr, st.updates,
+			   atomic_read(&st.unchanged), st.target_changes,
+			   st.peak_rate);
+	}
+
+	return 0;
+}
+
+static int pm_qos_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_qos_stats_show, NULL);
+}
+
+static const struct file_operations pm_qos_stats_fops = {
+	.open		= pm_qos_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
 
 static int __init pm_qos_power_init(void)
 {
 	int ret = 0;
 
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("pm_qos", S_IRUGO, NULL, NULL, &pm_qos_stats_fops);
+#endif
+
 	ret = register_pm_qos_misc(&cpu_dma_pm_qos);
 	if (ret < 0) {
 		printk(KERN_ERR "pm_qos_param: cpu_dma_latency setup failed\n");
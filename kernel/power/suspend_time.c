@@ -1,5 +1,6 @@
 /*
- * debugfs file to track time spent in suspend
+ * debugfs file to track time spent in suspend, and where the time of the
+ * last device suspend and resume went
  *
  * Copyright (c) 2011, Google, Inc.
  *
@@ -15,16 +16,108 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/device.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/suspend.h>
 #include <linux/syscore_ops.h>
 #include <linux/time.h>
 
 static struct timespec suspend_time_before;
 static unsigned int time_in_suspend_bins[32];
 
+#define SUSPEND_TIME_DEVS	512
+/* shorter callbacks are only counted on the critical path */
+#define SUSPEND_TIME_PATH_MIN_US	500
+
+/*
+ * One device callback of the last dpm_suspend() or dpm_resume(), in the
+ * order they completed.  @prev is the record of the device it had to wait
+ * for, or of the synchronous one handled before it, so that following @prev
+ * from the last record to complete gives the critical path of the phase.
+ */
+struct suspend_time_dev {
+	const struct device *dev;
+	char name[20];
+	u32 start_us;
+	u32 ready_us;
+	u32 end_us;
+	s16 prev;
+	bool async;
+};
+
+static struct suspend_time_devs {
+	ktime_t begin;
+	int nr;
+	int last_sync;
+	int dropped;
+	struct suspend_time_dev devs[SUSPEND_TIME_DEVS];
+} suspend_time_devs[2];
+
+static bool suspend_time_resume;
+static DEFINE_SPINLOCK(suspend_time_lock);
+
+void suspend_time_dev_begin(bool resume)
+{
+	struct suspend_time_devs *st = &suspend_time_devs[resume];
+
+	spin_lock(&suspend_time_lock);
+	suspend_time_resume = resume;
+	st->begin = ktime_get();
+	st->nr = 0;
+	st->last_sync = -1;
+	st->dropped = 0;
+	spin_unlock(&suspend_time_lock);
+}
+
+static u32 suspend_time_us(struct suspend_time_devs *st, ktime_t t)
+{
+	s64 us = ktime_us_delta(t, st->begin);
+
+	return us > 0 ? us : 0;
+}
+
+void suspend_time_dev(struct device *dev, struct device *blocker,
+		      bool async, ktime_t start, ktime_t ready)
+{
+	ktime_t end = ktime_get();
+	struct suspend_time_devs *st;
+	struct suspend_time_dev *sd;
+	int i;
+
+	spin_lock(&suspend_time_lock);
+	st = &suspend_time_devs[suspend_time_resume];
+	if (st->nr == SUSPEND_TIME_DEVS) {
+		st->dropped++;
+		goto out;
+	}
+
+	sd = &st->devs[st->nr];
+	sd->dev = dev;
+	strlcpy(sd->name, dev_name(dev), sizeof(sd->name));
+	sd->start_us = suspend_time_us(st, start);
+	sd->ready_us = suspend_time_us(st, ready);
+	sd->end_us = suspend_time_us(st, end);
+	sd->async = async;
+
+	sd->prev = async ? -1 : st->last_sync;
+	if (blocker) {
+		for (i = st->nr - 1; i >= 0; i--)
+			if (st->devs[i].dev == blocker) {
+				sd->prev = i;
+				break;
+			}
+	}
+	if (!async)
+		st->last_sync = st->nr;
+	st->nr++;
+out:
+	spin_unlock(&suspend_time_lock);
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int suspend_time_debug_show(struct seq_file *s, void *data)
 {
@@ -53,6 +146,65 @@ static const struct file_operations suspend_time_debug_fops = {
 	.release	= single_release,
 };
 
+static void suspend_time_devs_show(struct seq_file *s, const char *phase,
+				   struct suspend_time_devs *st)
+{
+	struct suspend_time_dev *sd;
+	unsigned int short_us = 0, nr_short = 0;
+	int i, last = -1;
+
+	for (i = 0; i < st->nr; i++)
+		if (last < 0 || st->devs[i].end_us >= st->devs[last].end_us)
+			last = i;
+
+	seq_printf(s, "%s: %d devices, %u usecs", phase, st->nr,
+		   last < 0 ? 0 : st->devs[last].end_us);
+	if (st->dropped)
+		seq_printf(s, ", %d more not recorded", st->dropped);
+	seq_printf(s, "\ncritical path, last first:\n");
+	seq_printf(s, "%10s %10s %10s  device\n", "start", "wait", "usecs");
+
+	for (i = last; i >= 0; i = sd->prev) {
+		u32 us;
+
+		sd = &st->devs[i];
+		us = sd->end_us - sd->ready_us;
+		if (us < SUSPEND_TIME_PATH_MIN_US &&
+		    sd->ready_us == sd->start_us) {
+			short_us += us;
+			nr_short++;
+			continue;
+		}
+		seq_printf(s, "%10u %10u %10u  %s%s\n", sd->start_us,
+			   sd->ready_us - sd->start_us, us, sd->name,
+			   sd->async ? " (async)" : "");
+	}
+	seq_printf(s, "%10s %10s %10u  %u shorter callbacks\n\n", "", "",
+		   short_us, nr_short);
+}
+
+static int suspend_time_devs_debug_show(struct seq_file *s, void *data)
+{
+	spin_lock(&suspend_time_lock);
+	suspend_time_devs_show(s, "suspend", &suspend_time_devs[0]);
+	suspend_time_devs_show(s, "resume", &suspend_time_devs[1]);
+	spin_unlock(&suspend_time_lock);
+
+	return 0;
+}
+
+static int suspend_time_devs_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_time_devs_debug_show, NULL);
+}
+
+static const struct file_operations suspend_time_devs_debug_fops = {
+	.open		= suspend_time_devs_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init suspend_time_debug_init(void)
 {
 	struct dentry *d;
@@ -64,6 +216,13 @@ static int __init suspend_time_debug_init(void)
 		return -ENOMEM;
 	}
 
+	d = debugfs_create_file("suspend_time_devices", 0444, NULL, NULL,
+		&suspend_time_devs_debug_fops);
+	if (!d) {
+		pr_err("Failed to create suspend_time_devices debug file\n");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
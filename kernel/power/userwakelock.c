@@ -14,7 +14,9 @@
  */
 
 #include <linux/ctype.h>
+#include <linux/cred.h>
 #include <linux/module.h>
+#include <linux/sched.h>
 #include <linux/wakelock.h>
 #include <linux/slab.h>
 
@@ -164,6 +166,11 @@ ssize_t wake_lock_store(
 	if (debug_mask & DEBUG_ACCESS)
 		pr_info("wake_lock_store: %s, timeout %ld\n", l->name, timeout);
 
+#ifdef CONFIG_WAKELOCK_STAT
+	/* charge the lock to whoever took it last */
+	l->wake_lock.stat.owner_pid = task_tgid_vnr(current);
+	l->wake_lock.stat.owner_uid = current_uid();
+#endif
 	if (timeout)
 		wake_lock_timeout(&l->wake_lock, timeout);
 	else
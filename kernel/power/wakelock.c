@@ -60,6 +60,11 @@ static struct wake_lock deleted_wake_locks;
 static ktime_t last_sleep_time_update;
 static int wait_for_wakeup;
 
+/* screen off is main_wake_lock released, in boot time to count suspend */
+static ktime_t screen_off_start;
+static ktime_t screen_off_time;
+static bool screen_off;
+
 int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 {
 	struct timespec ts;
@@ -120,6 +125,82 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 		     ktime_to_ns(lock->stat.last_time));
 }
 
+static ktime_t screen_off_time_locked(void)
+{
+	if (!screen_off)
+		return screen_off_time;
+	return ktime_add(screen_off_time,
+			 ktime_sub(ktime_get_boottime(), screen_off_start));
+}
+
+static void print_lock_cost(struct seq_file *m, struct wake_lock *lock,
+			    unsigned long off_secs)
+{
+	unsigned long per_hour = 0;
+	char owner[24] = "-";
+	int i;
+
+	if (off_secs)
+		per_hour = div_u64((u64)lock->stat.wakeup_count * 3600 * 100,
+				   off_secs);
+	if (lock->stat.owner_pid)
+		snprintf(owner, sizeof(owner), "%d/%u",
+			 lock->stat.owner_pid, lock->stat.owner_uid);
+
+	seq_printf(m, "\"%s\"\t%s\t%d\t%d\t%d\t%lu.%02lu\t%lld\t%lld",
+		   lock->name, owner, lock->stat.count,
+		   lock->stat.prevent_count, lock->stat.wakeup_count,
+		   per_hour / 100, per_hour % 100,
+		   ktime_to_ms(lock->stat.total_time),
+		   ktime_to_ms(lock->stat.max_time));
+	for (i = 0; i < WAKE_LOCK_HIST_BINS; i++)
+		seq_printf(m, "\t%u", lock->stat.hold_hist[i]);
+	seq_putc(m, '\n');
+}
+
+/*
+ * What each lock cost in standby: the suspends it aborted, the wakeups it
+ * was the first lock taken after, per hour of screen off time, and how
+ * long it was held.  Only completed holds are counted.
+ */
+static int wakelock_cost_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	unsigned long off_secs;
+	struct wake_lock *lock;
+	int type;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+
+	off_secs = ktime_to_timespec(screen_off_time_locked()).tv_sec;
+	seq_printf(m, "screen off %lu s\n", off_secs);
+	seq_puts(m, "name\towner\tcount\tprevented\twakeups\twakeups/h"
+		 "\ttotal_ms\tmax_ms\t<1ms\t<10ms\t<100ms\t<1s\t<10s"
+		 "\t<100s\t<1000s\tlonger\n");
+	list_for_each_entry(lock, &inactive_locks, link)
+		print_lock_cost(m, lock, off_secs);
+	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
+		list_for_each_entry(lock, &active_wake_locks[type], link)
+			print_lock_cost(m, lock, off_secs);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+	return 0;
+}
+
+/* Charge a suspend attempt that failed to the locks that were held. */
+static void suspend_prevented(void)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+	ktime_t etime;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link)
+		if (!get_expired_time(lock, &etime))
+			lock->stat.prevent_count++;
+	spin_unlock_irqrestore(&list_lock, irqflags);
+}
+
 static int wakelock_stats_show(struct seq_file *m, void *unused)
 {
 	unsigned long irqflags;
@@ -141,6 +222,17 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static void wake_lock_hist_locked(struct wake_lock *lock, ktime_t duration)
+{
+	s64 ns = ktime_to_ns(duration), limit = NSEC_PER_MSEC;
+	int bin;
+
+	for (bin = 0; bin < WAKE_LOCK_HIST_BINS - 1; bin++, limit *= 10)
+		if (ns < limit)
+			break;
+	lock->stat.hold_hist[bin]++;
+}
+
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
@@ -158,6 +250,7 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
+	wake_lock_hist_locked(lock, duration);
 	lock->stat.last_time = ktime_get();
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
 		duration = ktime_sub(now, last_sleep_time_update);
@@ -277,6 +370,9 @@ static void suspend(struct work_struct *work)
 	if (has_wake_lock(WAKE_LOCK_SUSPEND)) {
 		if (debug_mask & DEBUG_SUSPEND)
 			pr_info("suspend: abort suspend\n");
+#ifdef CONFIG_WAKELOCK_STAT
+		suspend_prevented();
+#endif
 		return;
 	}
 
@@ -339,6 +435,8 @@ static int power_suspend_late(struct device *dev)
 	int ret = has_wake_lock(WAKE_LOCK_SUSPEND) ? -EAGAIN : 0;
 #ifdef CONFIG_WAKELOCK_STAT
 	wait_for_wakeup = !ret;
+	if (ret)
+		suspend_prevented();
 #endif
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("power_suspend_late return %d\n", ret);
@@ -375,6 +473,10 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
 	lock->stat.last_time = ktime_set(0, 0);
+	lock->stat.prevent_count = 0;
+	memset(lock->stat.hold_hist, 0, sizeof(lock->stat.hold_hist));
+	lock->stat.owner_pid = 0;
+	lock->stat.owner_uid = 0;
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
@@ -388,6 +490,9 @@ EXPORT_SYMBOL(wake_lock_init);
 void wake_lock_destroy(struct wake_lock *lock)
 {
 	unsigned long irqflags;
+#ifdef CONFIG_WAKELOCK_STAT
+	int i;
+#endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
@@ -405,6 +510,13 @@ void wake_lock_destroy(struct wake_lock *lock)
 		deleted_wake_locks.stat.max_time =
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
+		deleted_wake_locks.stat.prevent_count +=
+			lock->stat.prevent_count;
+		deleted_wake_locks.stat.wakeup_count +=
+			lock->stat.wakeup_count;
+		for (i = 0; i < WAKE_LOCK_HIST_BINS; i++)
+			deleted_wake_locks.stat.hold_hist[i] +=
+				lock->stat.hold_hist[i];
 	}
 #endif
 	list_del(&lock->link);
@@ -461,6 +573,10 @@ static void wake_lock_internal(
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
 #ifdef CONFIG_WAKELOCK_STAT
+		if (lock == &main_wake_lock && screen_off) {
+			screen_off_time = screen_off_time_locked();
+			screen_off = false;
+		}
 		if (lock == &main_wake_lock)
 			update_sleep_wait_stats_locked(1);
 		else if (!wake_lock_active(&main_wake_lock))
@@ -533,6 +649,10 @@ void wake_unlock(struct wake_lock *lock)
 				print_active_locks(WAKE_LOCK_SUSPEND);
 #ifdef CONFIG_WAKELOCK_STAT
 			update_sleep_wait_stats_locked(0);
+			if (!screen_off) {
+				screen_off_start = ktime_get_boottime();
+				screen_off = true;
+			}
 #endif
 		}
 	}
@@ -559,6 +679,19 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+static int wakelock_cost_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_cost_show, NULL);
+}
+
+static const struct file_operations wakelock_cost_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_cost_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init wakelocks_init(void)
 {
 	int ret;
@@ -596,6 +729,7 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelock_stats", S_IRUGO, NULL, &wakelock_cost_fops);
 #endif
 
 	return 0;
@@ -617,6 +751,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelock_stats", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
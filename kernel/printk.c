@@ -41,6 +41,7 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
 
 #include <asm/uaccess.h>
 
@@ -146,6 +147,11 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+#define PRINTK_PENDING_WAKEUP	0x01
+#define PRINTK_PENDING_FLUSH	0x02
+
+static DEFINE_PER_CPU(int, printk_pending);
+
 #ifdef CONFIG_PRINTK
 
 static char __log_buf[__LOG_BUF_LEN];
@@ -887,61 +893,19 @@ static inline void printk_delay(void)
 	}
 }
 
-asmlinkage int vprintk(const char *fmt, va_list args)
+/*
+ * Copy a formatted message into log_buf, inserting the log level prefix
+ * and the time stamp @t at the start of each of its lines.  Returns the
+ * number of prefix characters added.  Called with logbuf_lock held.
+ */
+static int emit_log_text(const char *text, unsigned long long t)
 {
-	int printed_len = 0;
 	int current_log_level = default_message_loglevel;
-	unsigned long flags;
-	int this_cpu;
-	char *p;
+	const char *p = text;
+	int added = 0;
 	size_t plen;
 	char special;
 
-	boot_delay_msec();
-	printk_delay();
-
-	preempt_disable();
-	/* This stops the holder of console_sem just where we want him */
-	raw_local_irq_save(flags);
-	this_cpu = smp_processor_id();
-
-	/*
-	 * Ouch, printk recursed into itself!
-	 */
-	if (unlikely(printk_cpu == this_cpu)) {
-		/*
-		 * If a crash is occurring during printk() on this CPU,
-		 * then try to get the crash message out but make sure
-		 * we can't deadlock. Otherwise just return to avoid the
-		 * recursion and return - but flag the recursion so that
-		 * it can be printed at the next appropriate moment:
-		 */
-		if (!oops_in_progress) {
-			recursion_bug = 1;
-			goto out_restore_irqs;
-		}
-		zap_locks();
-	}
-
-	lockdep_off();
-	spin_lock(&logbuf_lock);
-	printk_cpu = this_cpu;
-
-	if (recursion_bug) {
-		recursion_bug = 0;
-		strcpy(printk_buf, recursion_bug_msg);
-		printed_len = strlen(recursion_bug_msg);
-	}
-	/* Emit the output into the temporary buffer */
-	printed_len += vscnprintf(printk_buf + printed_len,
-				  sizeof(printk_buf) - printed_len, fmt, args);
-
-#ifdef	CONFIG_DEBUG_LL
-	printascii(printk_buf);
-#endif
-
-	p = printk_buf;
-
 	/* Read log level and handle special printk prefix */
 	plen = log_prefix(p, &current_log_level, &special);
 	if (plen) {
@@ -974,32 +938,31 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				int i;
 
 				for (i = 0; i < plen; i++)
-					emit_log_char(printk_buf[i]);
-				printed_len += plen;
+					emit_log_char(text[i]);
+				added += plen;
 			} else {
 				/* Add log prefix */
 				emit_log_char('<');
 				emit_log_char(current_log_level + '0');
 				emit_log_char('>');
-				printed_len += 3;
+				added += 3;
 			}
 
 			if (printk_time) {
-				/* Add the current time stamp */
+				/* Add the time stamp */
 				char tbuf[50], *tp;
 				unsigned tlen;
-				unsigned long long t;
+				unsigned long long ts = t;
 				unsigned long nanosec_rem;
 
-				t = cpu_clock(printk_cpu);
-				nanosec_rem = do_div(t, 1000000000);
+				nanosec_rem = do_div(ts, 1000000000);
 				tlen = sprintf(tbuf, "[%5lu.%06lu] ",
-						(unsigned long) t,
+						(unsigned long) ts,
 						nanosec_rem / 1000);
 
 				for (tp = tbuf; tp < tbuf + tlen; tp++)
 					emit_log_char(*tp);
-				printed_len += tlen;
+				added += tlen;
 			}
 
 			if (!*p)
@@ -1011,6 +974,304 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 			new_text_line = 1;
 	}
 
+	return added;
+}
+
+#ifdef CONFIG_PRINTK_DEFERRED
+/*
+ * Deferred printk: each cpu formats its messages into a ring of its own,
+ * with interrupts off and no lock taken, and printkd moves them over to
+ * log_buf and the consoles.  A message that finds its ring full is
+ * dropped and counted rather than waited for, so printk() never spins on
+ * logbuf_lock nor pays for a slow console.  Oopses bypass all of this.
+ *
+ * A ring has a single writer, its cpu, and a single reader, whoever holds
+ * logbuf_lock; each message is a struct printk_record followed by its
+ * text.
+ */
+#define PRINTK_CPU_LOG_LEN	(1 << CONFIG_PRINTK_CPU_LOG_SHIFT)
+#define PRINTK_CPU_LOG_MASK	(PRINTK_CPU_LOG_LEN - 1)
+
+struct printk_record {
+	unsigned long long ts;
+	unsigned int len;
+};
+
+struct printk_cpu_log {
+	char buf[PRINTK_CPU_LOG_LEN];
+	unsigned int head;		/* written by the cpu */
+	unsigned int tail;		/* written by the reader */
+	unsigned long dropped;
+	unsigned long dropped_reported;
+	int busy;
+	char text[1024];
+};
+
+static DEFINE_PER_CPU(struct printk_cpu_log, printk_cpu_log);
+static struct task_struct *printk_flush_task;
+/* a message being moved to log_buf, protected by logbuf_lock */
+static char printk_flush_buf[1024];
+
+static void cpu_log_copy_in(struct printk_cpu_log *cl, unsigned int pos,
+			    const void *src, unsigned int len)
+{
+	unsigned int off = pos & PRINTK_CPU_LOG_MASK;
+	unsigned int n = min(len, PRINTK_CPU_LOG_LEN - off);
+
+	memcpy(cl->buf + off, src, n);
+	memcpy(cl->buf, src + n, len - n);
+}
+
+static void cpu_log_copy_out(struct printk_cpu_log *cl, unsigned int pos,
+			     void *dst, unsigned int len)
+{
+	unsigned int off = pos & PRINTK_CPU_LOG_MASK;
+	unsigned int n = min(len, PRINTK_CPU_LOG_LEN - off);
+
+	memcpy(dst, cl->buf + off, n);
+	memcpy(dst + n, cl->buf, len - n);
+}
+
+/* Called with interrupts off, on the cpu owning @cl. */
+static void cpu_log_put(struct printk_cpu_log *cl, unsigned long long ts,
+			const char *text, unsigned int len)
+{
+	struct printk_record rec = { .ts = ts, .len = len };
+	unsigned int head = cl->head;
+	unsigned int need = sizeof(rec) + len;
+
+	if (need > PRINTK_CPU_LOG_LEN - (head - ACCESS_ONCE(cl->tail))) {
+		cl->dropped++;
+		return;
+	}
+	/* read the tail before overwriting what the reader released */
+	smp_mb();
+
+	cpu_log_copy_in(cl, head, &rec, sizeof(rec));
+	cpu_log_copy_in(cl, head + sizeof(rec), text, len);
+
+	smp_wmb();
+	cl->head = head + need;
+}
+
+static int cpu_log_peek(struct printk_cpu_log *cl, struct printk_record *rec)
+{
+	if (cl->tail == ACCESS_ONCE(cl->head))
+		return 0;
+	smp_rmb();
+
+	cpu_log_copy_out(cl, cl->tail, rec, sizeof(*rec));
+	return 1;
+}
+
+/*
+ * Move the oldest message of all the cpu rings, or a note of messages
+ * dropped, to log_buf.  Returns 0 once there is nothing left.  Called
+ * with logbuf_lock held.
+ */
+static int printk_drain_one(void)
+{
+	struct printk_cpu_log *cl, *oldest = NULL;
+	struct printk_record rec, oldest_rec;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		cl = &per_cpu(printk_cpu_log, cpu);
+
+		if (cl->dropped != cl->dropped_reported) {
+			unsigned long dropped = cl->dropped;
+
+			snprintf(printk_flush_buf, sizeof(printk_flush_buf),
+				 KERN_WARNING "printk: %lu messages dropped "
+				 "on cpu %d\n", dropped - cl->dropped_reported,
+				 cpu);
+			cl->dropped_reported = dropped;
+			emit_log_text(printk_flush_buf,
+				      cpu_clock(raw_smp_processor_id()));
+			return 1;
+		}
+
+		if (cpu_log_peek(cl, &rec) &&
+		    (!oldest || rec.ts < oldest_rec.ts)) {
+			oldest = cl;
+			oldest_rec = rec;
+		}
+	}
+
+	if (!oldest)
+		return 0;
+
+	cpu_log_copy_out(oldest, oldest->tail + sizeof(oldest_rec),
+			 printk_flush_buf, oldest_rec.len);
+	printk_flush_buf[oldest_rec.len] = '\0';
+	/* done reading before the writer may reuse the space */
+	smp_mb();
+	oldest->tail += sizeof(oldest_rec) + oldest_rec.len;
+
+	emit_log_text(printk_flush_buf, oldest_rec.ts);
+	return 1;
+}
+
+static void printk_drain_cpu_logs(void)
+{
+	unsigned long flags;
+	int more;
+
+	do {
+		spin_lock_irqsave(&logbuf_lock, flags);
+		more = printk_drain_one();
+		spin_unlock_irqrestore(&logbuf_lock, flags);
+	} while (more);
+}
+
+static int printk_cpu_logs_pending(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct printk_cpu_log *cl = &per_cpu(printk_cpu_log, cpu);
+
+		if (cl->tail != ACCESS_ONCE(cl->head) ||
+		    cl->dropped != cl->dropped_reported)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Queue a message on this cpu's ring, to be flushed by printkd from the
+ * next tick.  Returns 0 when the message has to go the synchronous way.
+ * Called with interrupts off.
+ */
+static int printk_defer(int cpu, const char *fmt, va_list args, int *len)
+{
+	struct printk_cpu_log *cl = &per_cpu(printk_cpu_log, cpu);
+
+	if (!printk_flush_task || oops_in_progress)
+		return 0;
+
+	/* printk from within vscnprintf() */
+	if (unlikely(cl->busy)) {
+		cl->dropped++;
+		*len = 0;
+		return 1;
+	}
+	cl->busy = 1;
+
+	*len = vscnprintf(cl->text, sizeof(cl->text), fmt, args);
+#ifdef	CONFIG_DEBUG_LL
+	printascii(cl->text);
+#endif
+	cpu_log_put(cl, printk_time ? cpu_clock(cpu) : 0, cl->text, *len);
+
+	cl->busy = 0;
+	__this_cpu_or(printk_pending, PRINTK_PENDING_FLUSH);
+	return 1;
+}
+
+static int printk_flush_thread(void *unused)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!printk_cpu_logs_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		printk_drain_cpu_logs();
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
+static int __init printk_flush_init(void)
+{
+	struct task_struct *t;
+
+	t = kthread_run(printk_flush_thread, NULL, "printkd");
+	if (IS_ERR(t))
+		return PTR_ERR(t);
+	printk_flush_task = t;
+	return 0;
+}
+early_initcall(printk_flush_init);
+#else
+static inline int printk_drain_one(void)
+{
+	return 0;
+}
+
+static inline void printk_drain_cpu_logs(void)
+{
+}
+
+static inline int
+printk_defer(int cpu, const char *fmt, va_list args, int *len)
+{
+	return 0;
+}
+#endif /* CONFIG_PRINTK_DEFERRED */
+
+asmlinkage int vprintk(const char *fmt, va_list args)
+{
+	int printed_len = 0;
+	unsigned long flags;
+	int this_cpu;
+
+	boot_delay_msec();
+	printk_delay();
+
+	preempt_disable();
+	/* This stops the holder of console_sem just where we want him */
+	raw_local_irq_save(flags);
+	this_cpu = smp_processor_id();
+
+	if (printk_defer(this_cpu, fmt, args, &printed_len))
+		goto out_restore_irqs;
+
+	/*
+	 * Ouch, printk recursed into itself!
+	 */
+	if (unlikely(printk_cpu == this_cpu)) {
+		/*
+		 * If a crash is occurring during printk() on this CPU,
+		 * then try to get the crash message out but make sure
+		 * we can't deadlock. Otherwise just return to avoid the
+		 * recursion and return - but flag the recursion so that
+		 * it can be printed at the next appropriate moment:
+		 */
+		if (!oops_in_progress) {
+			recursion_bug = 1;
+			goto out_restore_irqs;
+		}
+		zap_locks();
+	}
+
+	lockdep_off();
+	spin_lock(&logbuf_lock);
+	printk_cpu = this_cpu;
+
+	/* get what the other cpus had queued out ahead of the oops */
+	if (unlikely(oops_in_progress))
+		while (printk_drain_one())
+			;
+
+	if (recursion_bug) {
+		recursion_bug = 0;
+		strcpy(printk_buf, recursion_bug_msg);
+		printed_len = strlen(recursion_bug_msg);
+	}
+	/* Emit the output into the temporary buffer */
+	printed_len += vscnprintf(printk_buf + printed_len,
+				  sizeof(printk_buf) - printed_len, fmt, args);
+
+#ifdef	CONFIG_DEBUG_LL
+	printascii(printk_buf);
+#endif
+
+	printed_len += emit_log_text(printk_buf,
+				     printk_time ? cpu_clock(this_cpu) : 0);
+
 	/*
 	 * Try to acquire and then immediately release the
 	 * console semaphore. The release will do all the
@@ -1268,13 +1529,17 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
 	if (__this_cpu_read(printk_pending)) {
-		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+		int pending = __this_cpu_xchg(printk_pending, 0);
+
+#ifdef CONFIG_PRINTK_DEFERRED
+		if (pending & PRINTK_PENDING_FLUSH)
+			wake_up_process(printk_flush_task);
+#endif
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1288,7 +1553,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
 /**
@@ -1775,6 +2040,11 @@ void kmsg_dump(enum kmsg_dump_reason reason)
 	unsigned long l1, l2;
 	unsigned long flags;
 
+	/* Get the deferred messages in before the system goes down */
+	printk_drain_cpu_logs();
+	if (console_trylock())
+		console_unlock();
+
 	/* Theoretically, the log could move on after we do this, but
 	   there's not a lot we can do about that. The new messages
 	   will overwrite the start of what we dump. */
@@ -1212,8 +1212,10 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 			rdp->nxttail[count] = &rdp->nxtlist;
 	local_irq_restore(flags);
 
-	/* Invoke callbacks. */
-	count = 0;
+	/* Invoke callbacks, unless this CPU's rcuo kthread takes them. */
+	count = rcu_nocb_enqueue(rdp->cpu, list, tail);
+	if (count)
+		list = NULL;
 	while (list) {
 		next = list->next;
 		prefetch(next);
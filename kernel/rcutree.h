@@ -466,5 +466,7 @@ static void rcu_yield(void (*f)(unsigned long), unsigned long arg);
 #endif /* #ifdef CONFIG_RCU_BOOST */
 static void rcu_cpu_kthread_setrt(int cpu, int to_rt);
 static void __cpuinit rcu_prepare_kthreads(int cpu);
+static long rcu_nocb_enqueue(int cpu, struct rcu_head *list,
+			     struct rcu_head **tail);
 
 #endif /* #ifndef RCU_TREE_NONCORE */
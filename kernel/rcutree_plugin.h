@@ -2008,3 +2008,145 @@ static void rcu_needs_cpu_flush(void)
 }
 
 #endif /* #else #if !defined(CONFIG_RCU_FAST_NO_HZ) */
+
+#ifdef CONFIG_RCU_NOCB_CPU
+
+/*
+ * Callback offloading.  On the CPUs given by rcu_nocbs=, RCU core still
+ * runs its grace-period processing from softirq, but the callbacks whose
+ * grace period has ended are handed over to a per-CPU "rcuo" kthread
+ * instead of being invoked in place.  So the long invocation bursts that
+ * follow, say, an application exit freeing thousands of objects no longer
+ * run in softirq on top of whatever that CPU was doing.  The kthreads are
+ * ordinary unbound tasks: by default they stay off the offloaded CPUs,
+ * and their affinity and priority may be changed from userspace.
+ */
+struct rcu_nocb {
+	raw_spinlock_t lock;		/* Protects ->head and ->tail. */
+	struct rcu_head *head;		/* Callbacks awaiting invocation. */
+	struct rcu_head **tail;
+	wait_queue_head_t wq;		/* Where the kthread waits for work. */
+	struct task_struct *task;	/* NULL until the kthread is up. */
+};
+
+static DEFINE_PER_CPU(struct rcu_nocb, rcu_nocb);
+static cpumask_var_t rcu_nocb_mask;
+static bool have_rcu_nocb_mask;
+
+static int __init rcu_nocb_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_mask);
+	have_rcu_nocb_mask = true;
+	cpulist_parse(str, rcu_nocb_mask);
+	return 1;
+}
+__setup("rcu_nocbs=", rcu_nocb_setup);
+
+/*
+ * Append the ready callbacks from list to tail to the specified CPU's
+ * offload list and wake its kthread.  Returns the number of callbacks
+ * taken, or zero if the CPU does not offload and the caller must invoke
+ * them itself.
+ */
+static long rcu_nocb_enqueue(int cpu, struct rcu_head *list,
+			     struct rcu_head **tail)
+{
+	struct rcu_nocb *nocb = &per_cpu(rcu_nocb, cpu);
+	struct rcu_head *rhp;
+	unsigned long flags;
+	long count = 0;
+
+	if (!have_rcu_nocb_mask || !cpumask_test_cpu(cpu, rcu_nocb_mask) ||
+	    !ACCESS_ONCE(nocb->task))
+		return 0;
+
+	for (rhp = list; rhp; rhp = rhp->next)
+		count++;
+
+	raw_spin_lock_irqsave(&nocb->lock, flags);
+	*nocb->tail = list;
+	nocb->tail = tail;
+	raw_spin_unlock_irqrestore(&nocb->lock, flags);
+	wake_up(&nocb->wq);
+	return count;
+}
+
+/*
+ * Invoke the callbacks handed over by rcu_nocb_enqueue(), blimit at a
+ * time with bh disabled as the softirq would, rescheduling in between.
+ */
+static int rcu_nocb_kthread(void *arg)
+{
+	struct rcu_nocb *nocb = arg;
+	struct rcu_head *list, *next;
+	unsigned long flags;
+	int count;
+
+	for (;;) {
+		wait_event_interruptible(nocb->wq, ACCESS_ONCE(nocb->head));
+
+		raw_spin_lock_irqsave(&nocb->lock, flags);
+		list = nocb->head;
+		nocb->head = NULL;
+		nocb->tail = &nocb->head;
+		raw_spin_unlock_irqrestore(&nocb->lock, flags);
+
+		while (list) {
+			local_bh_disable();
+			for (count = 0; list && count < blimit; count++) {
+				next = list->next;
+				prefetch(next);
+				debug_rcu_head_unqueue(list);
+				__rcu_reclaim(list);
+				list = next;
+			}
+			local_bh_enable();
+			cond_resched();
+		}
+	}
+	return 0;
+}
+
+static int __init rcu_spawn_nocb_kthreads(void)
+{
+	cpumask_var_t housekeeping;
+	struct task_struct *t;
+	int cpu;
+
+	if (!have_rcu_nocb_mask)
+		return 0;
+	if (!alloc_cpumask_var(&housekeeping, GFP_KERNEL))
+		return -ENOMEM;
+	cpumask_andnot(housekeeping, cpu_possible_mask, rcu_nocb_mask);
+
+	for_each_possible_cpu(cpu) {
+		struct rcu_nocb *nocb = &per_cpu(rcu_nocb, cpu);
+
+		if (!cpumask_test_cpu(cpu, rcu_nocb_mask))
+			continue;
+
+		raw_spin_lock_init(&nocb->lock);
+		nocb->tail = &nocb->head;
+		init_waitqueue_head(&nocb->wq);
+		t = kthread_run(rcu_nocb_kthread, nocb, "rcuo/%d", cpu);
+		if (IS_ERR(t))
+			continue;
+		if (!cpumask_empty(housekeeping))
+			set_cpus_allowed_ptr(t, housekeeping);
+		ACCESS_ONCE(nocb->task) = t;
+	}
+
+	free_cpumask_var(housekeeping);
+	return 0;
+}
+early_initcall(rcu_spawn_nocb_kthreads);
+
+#else /* #ifdef CONFIG_RCU_NOCB_CPU */
+
+static long rcu_nocb_enqueue(int cpu, struct rcu_head *list,
+			     struct rcu_head **tail)
+{
+	return 0;
+}
+
+#endif /* #else #ifdef CONFIG_RCU_NOCB_CPU */
@@ -72,6 +72,9 @@
 #include <linux/ftrace.h>
 #include <linux/slab.h>
 #include <linux/cpuacct.h>
+#include <linux/cpufreq.h>
+#include <linux/cpufreq_times.h>
+#include <linux/log2_hist.h>
 
 #include <asm/tlb.h>
 #include <asm/irq_regs.h>
@@ -251,10 +254,42 @@ struct cfs_rq;
 static LIST_HEAD(task_groups);
 
 /* task group related information */
+/*
+ * Wakeup placement class of a task group, see select_placement_cpu():
+ * foreground tasks get a cpu of their own where possible and
+ * background tasks are packed away from them.
+ */
+enum {
+	SCHED_PLACE_DEFAULT,
+	SCHED_PLACE_FOREGROUND,
+	SCHED_PLACE_BACKGROUND,
+};
+
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * log2 histogram of the wakeup to run latency: bucket i counts latencies
+ * below 2^i usec (taken as 1024ns), the last bucket everything above.
+ */
+#define WAKEUP_LAT_BUCKETS	20
+
+struct wakeup_latency_hist {
+	unsigned int count[WAKEUP_LAT_BUCKETS];
+};
+
+enum {
+	WAKEUP_LAT_FAIR,
+	WAKEUP_LAT_RT,
+	WAKEUP_LAT_NR_CLASSES,
+};
+#endif
+
 struct task_group {
 	struct cgroup_subsys_state css;
 
 	bool notify_on_migrate;
+	int placement;
+	/* timer slack imposed on member tasks, 0 leaves their default */
+	unsigned long timer_slack_ns;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* schedulable entities of this group on each cpu */
@@ -283,6 +318,10 @@ struct task_group {
 #ifdef CONFIG_SCHED_AUTOGROUP
 	struct autogroup *autogroup;
 #endif
+
+#ifdef CONFIG_SCHEDSTATS
+	struct wakeup_latency_hist __percpu *wakeup_lat;
+#endif
 };
 
 /* task_group_lock serializes the addition/removal of task groups */
@@ -310,6 +349,9 @@ static int root_task_group_load = ROOT_TASK_GROUP_LOAD;
  *	Every task in system belong to this group at bootup.
  */
 struct task_group root_task_group;
+#ifdef CONFIG_SCHEDSTATS
+static DEFINE_PER_CPU(struct wakeup_latency_hist, root_wakeup_lat);
+#endif
 
 #endif	/* CONFIG_CGROUP_SCHED */
 
@@ -340,6 +382,23 @@ struct cfs_rq {
 	unsigned int nr_spread_over;
 #endif
 
+#ifdef CONFIG_SMP
+	/*
+	 * Per-entity load tracking: runnable_load_avg sums the load_avg_contrib
+	 * of the entities queued here and blocked_load_avg that of the ones
+	 * which went to sleep from here, decayed until they wake up.
+	 * usage_load_avg sums the usage_avg_contrib of the queued entities.
+	 *
+	 * decay_counter counts the periods blocked_load_avg was decayed by, so
+	 * a sleeper can be taken out of it without the rq lock: removed_load
+	 * collects what remote wakeups migrated away.
+	 */
+	unsigned long runnable_load_avg, blocked_load_avg;
+	unsigned long usage_load_avg;
+	atomic64_t decay_counter, removed_load;
+	u64 last_decay;
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	struct rq *rq;	/* cpu runqueue to which this cfs_rq is attached */
 
@@ -369,18 +428,8 @@ struct cfs_rq {
 	 */
 	unsigned long h_load;
 
-	/*
-	 * Maintaining per-cpu shares distribution for group scheduling
-	 *
-	 * load_stamp is the last time we updated the load average
-	 * load_last is the last time we updated the load average and saw load
-	 * load_unacc_exec_time is currently unaccounted execution time
-	 */
-	u64 load_avg;
-	u64 load_period;
-	u64 load_stamp, load_last, load_unacc_exec_time;
-
-	unsigned long load_contribution;
+	/* this cpu's share of tg->load_weight */
+	unsigned long tg_load_contrib;
 #endif
 #endif
 };
@@ -500,6 +549,15 @@ struct rq {
 	 */
 	unsigned long nr_uninterruptible;
 
+#ifdef CONFIG_CPU_FREQ
+	/* queued tasks with a latency hint, reported to cpufreq */
+	unsigned int nr_latency;
+#endif
+#if defined(CONFIG_CGROUP_SCHED) && defined(CONFIG_SMP)
+	/* queued tasks of foreground groups */
+	unsigned int nr_foreground;
+#endif
+
 	struct task_struct *curr, *idle, *stop;
 	unsigned long next_balance;
 	struct mm_struct *prev_mm;
@@ -566,6 +624,15 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int ttwu_count;
 	unsigned int ttwu_local;
+
+	/* select_placement_cpu() stats */
+	unsigned int ttwu_fg_own;
+	unsigned int ttwu_fg_shared;
+	unsigned int ttwu_bg_packed;
+	unsigned int ttwu_bg_saturated;
+
+	/* wakeup to run latency of fair and rt tasks */
+	struct wakeup_latency_hist wakeup_lat[WAKEUP_LAT_NR_CLASSES];
 #endif
 
 #ifdef CONFIG_SMP
@@ -575,7 +642,7 @@ struct rq {
 
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 DEFINE_PER_CPU_SHARED_ALIGNED(struct nr_stats_s, runqueue_stats);
 #endif
 
@@ -611,7 +678,7 @@ static inline int cpu_of(struct rq *rq)
 #define cpu_curr(cpu)		(cpu_rq(cpu)->curr)
 #define raw_rq()		(&__raw_get_cpu_var(runqueues))
 
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 struct nr_stats_s {
 	/* time-based average load */
 	u64 nr_last_stamp;
@@ -652,6 +719,11 @@ static inline bool task_notify_on_migrate(struct task_struct *p)
 	return task_group(p)->notify_on_migrate;
 }
 
+static inline int task_placement(struct task_struct *p)
+{
+	return task_group(p)->placement;
+}
+
 /* Change a task's cfs_rq and parent entity if it moves across CPUs/groups */
 static inline void set_task_rq(struct task_struct *p, unsigned int cpu)
 {
@@ -683,6 +755,11 @@ static inline bool task_notify_on_migrate(struct task_struct *p)
 	return false;
 }
 
+static inline int task_placement(struct task_struct *p)
+{
+	return SCHED_PLACE_DEFAULT;
+}
+
 #endif /* CONFIG_CGROUP_SCHED */
 
 static void update_rq_clock_task(struct rq *rq, s64 delta);
@@ -699,7 +776,7 @@ static void update_rq_clock(struct rq *rq)
 	update_rq_clock_task(rq, delta);
 }
 
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 static inline unsigned int do_avg_nr_running(struct rq *rq)
 {
 
@@ -921,6 +998,14 @@ const_debug unsigned int sysctl_sched_nr_migrate = 32;
  */
 const_debug unsigned int sysctl_sched_time_avg = MSEC_PER_SEC;
 
+/*
+ * sched_cpu_usage() past which a cpu takes no more background wakeups,
+ * out of SCHED_LOAD_SCALE.
+ *
+ * default: 80%
+ */
+const_debug unsigned int sysctl_sched_bg_saturation = 819;
+
 /*
  * period over which we measure -rt task cpu usage in us.
  * default: 1s
@@ -1623,7 +1708,7 @@ static int tg_nop(struct task_group *tg, void *data)
 /* Used instead of source_load when we know the type == 0 */
 static unsigned long weighted_cpuload(const int cpu)
 {
-	return cpu_rq(cpu)->load.weight;
+	return cpu_rq(cpu)->cfs.runnable_load_avg;
 }
 
 /*
@@ -1672,7 +1757,7 @@ static unsigned long cpu_avg_load_per_task(int cpu)
 	unsigned long nr_running = ACCESS_ONCE(rq->nr_running);
 
 	if (nr_running)
-		rq->avg_load_per_task = rq->load.weight / nr_running;
+		rq->avg_load_per_task = rq->cfs.runnable_load_avg / nr_running;
 	else
 		rq->avg_load_per_task = 0;
 
@@ -1692,11 +1777,11 @@ static int tg_load_down(struct task_group *tg, void *data)
 	long cpu = (long)data;
 
 	if (!tg->parent) {
-		load = cpu_rq(cpu)->load.weight;
+		load = cpu_rq(cpu)->cfs.runnable_load_avg;
 	} else {
 		load = tg->parent->cfs_rq[cpu]->h_load;
-		load *= tg->se[cpu]->load.weight;
-		load /= tg->parent->cfs_rq[cpu]->load.weight + 1;
+		load *= tg->se[cpu]->avg.load_avg_contrib;
+		load /= tg->parent->cfs_rq[cpu]->runnable_load_avg + 1;
 	}
 
 	tg->cfs_rq[cpu]->h_load = load;
@@ -1892,34 +1977,34 @@ static const struct sched_class rt_sched_class;
 
 static void inc_nr_running(struct rq *rq)
 {
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 	struct nr_stats_s *nr_stats = &per_cpu(runqueue_stats, rq->cpu);
 #endif
 
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 	write_seqcount_begin(&nr_stats->ave_seqcnt);
 	nr_stats->ave_nr_running = do_avg_nr_running(rq);
 	nr_stats->nr_last_stamp = rq->clock_task;
 #endif
 	rq->nr_running++;
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 	write_seqcount_end(&nr_stats->ave_seqcnt);
 #endif
 }
 
 static void dec_nr_running(struct rq *rq)
 {
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 	struct nr_stats_s *nr_stats = &per_cpu(runqueue_stats, rq->cpu);
 #endif
 
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 	write_seqcount_begin(&nr_stats->ave_seqcnt);
 	nr_stats->ave_nr_running = do_avg_nr_running(rq);
 	nr_stats->nr_last_stamp = rq->clock_task;
 #endif
 	rq->nr_running--;
-#ifdef CONFIG_INTELLI_PLUG
+#ifdef CONFIG_SCHED_AVG_NR_RUNNING
 	write_seqcount_end(&nr_stats->ave_seqcnt);
 #endif
 }
@@ -1942,10 +2027,62 @@ static void set_load_weight(struct task_struct *p)
 	load->inv_weight = prio_to_wmult[prio];
 }
 
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Counted before the class callbacks run, so the cpufreq update they
+ * raise already sees the new state.
+ */
+static inline void latency_enqueue(struct rq *rq, struct task_struct *p)
+{
+	if (p->latency_sensitive || p->latency_wakee) {
+		p->latency_queued = true;
+		rq->nr_latency++;
+	}
+}
+
+static inline void latency_dequeue(struct rq *rq, struct task_struct *p,
+				   int flags)
+{
+	if (p->latency_queued) {
+		p->latency_queued = false;
+		rq->nr_latency--;
+	}
+	if (flags & DEQUEUE_SLEEP)
+		p->latency_wakee = false;
+}
+#else
+static inline void latency_enqueue(struct rq *rq, struct task_struct *p) {}
+static inline void latency_dequeue(struct rq *rq, struct task_struct *p,
+				   int flags) {}
+#endif
+
+#if defined(CONFIG_CGROUP_SCHED) && defined(CONFIG_SMP)
+static inline void foreground_enqueue(struct rq *rq, struct task_struct *p)
+{
+	if (task_placement(p) == SCHED_PLACE_FOREGROUND) {
+		p->foreground_queued = true;
+		rq->nr_foreground++;
+	}
+}
+
+static inline void foreground_dequeue(struct rq *rq, struct task_struct *p)
+{
+	if (p->foreground_queued) {
+		p->foreground_queued = false;
+		rq->nr_foreground--;
+	}
+}
+#else
+static inline void foreground_enqueue(struct rq *rq, struct task_struct *p) {}
+static inline void foreground_dequeue(struct rq *rq, struct task_struct *p) {}
+#endif
+
 static void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_queued(p);
+	latency_enqueue(rq, p);
+	foreground_enqueue(rq, p);
 	p->sched_class->enqueue_task(rq, p, flags);
 }
 
@@ -1953,6 +2090,8 @@ static void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_dequeued(p);
+	latency_dequeue(rq, p, flags);
+	foreground_dequeue(rq, p);
 	p->sched_class->dequeue_task(rq, p, flags);
 }
 
@@ -2161,6 +2300,69 @@ static void update_rq_clock_task(struct rq *rq, s64 delta)
 
 #endif /* CONFIG_IRQ_TIME_ACCOUNTING */
 
+#ifdef CONFIG_CPU_FREQ
+static DEFINE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_add_update_util_hook - have the scheduler report load changes
+ * @cpu: cpu to hook
+ * @data: governor data, passed back to @func
+ * @func: callback, run from enqueue, dequeue and the tick of @cpu
+ *
+ * @func is called with the run queue of @cpu locked, see struct
+ * update_util_data.
+ */
+void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
+			void (*func)(struct update_util_data *data, u64 time,
+				     unsigned int flags))
+{
+	if (WARN_ON(!data || !func))
+		return;
+
+	if (WARN_ON(per_cpu(cpufreq_update_util_data, cpu)))
+		return;
+
+	data->func = func;
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_add_update_util_hook);
+
+/**
+ * cpufreq_remove_update_util_hook - stop load reports for a cpu
+ * @cpu: cpu to unhook
+ *
+ * The callback may still be running on return; the caller must
+ * synchronize_sched() before freeing the data it was registered with.
+ */
+void cpufreq_remove_update_util_hook(int cpu)
+{
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), NULL);
+}
+EXPORT_SYMBOL_GPL(cpufreq_remove_update_util_hook);
+
+static inline void cpufreq_update_util(struct rq *rq, unsigned int flags)
+{
+	struct update_util_data *data;
+
+	/*
+	 * Remote wakeups are seen again by the tick or the next local
+	 * enqueue; the governor side keeps per-cpu state only.
+	 */
+	if (cpu_of(rq) != smp_processor_id())
+		return;
+
+	data = rcu_dereference_sched(__get_cpu_var(cpufreq_update_util_data));
+	if (!data)
+		return;
+
+	if (rq->nr_latency)
+		flags |= SCHED_CPUFREQ_LATENCY;
+	data->func(data, rq->clock, flags);
+}
+#else
+static inline void cpufreq_update_util(struct rq *rq, unsigned int flags) {}
+#endif /* CONFIG_CPU_FREQ */
+
 #include "sched_idletask.c"
 #include "sched_fair.c"
 #include "sched_rt.c"
@@ -2354,6 +2556,8 @@ void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
 	trace_sched_migrate_task(p, new_cpu);
 
 	if (task_cpu(p) != new_cpu) {
+		if (p->sched_class->migrate_task_rq)
+			p->sched_class->migrate_task_rq(p, new_cpu);
 		p->se.nr_migrations++;
 		perf_sw_event(PERF_COUNT_SW_CPU_MIGRATIONS, 1, 1, NULL, 0);
 	}
@@ -2583,9 +2787,13 @@ int select_task_rq(struct task_struct *p, int sd_flags, int wake_flags)
 	 *
 	 * [ this allows ->select_task() to simply return task_cpu(p) and
 	 *   not worry about this generic constraint ]
+	 *
+	 * An inactive cpu is going down or parked (see set_cpu_parked()),
+	 * only tasks bound to it may still be placed there.
 	 */
 	if (unlikely(!cpumask_test_cpu(cpu, &p->cpus_allowed) ||
-		     !cpu_online(cpu)))
+		     !cpu_online(cpu) ||
+		     (!cpu_active(cpu) && p->rt.nr_cpus_allowed > 1)))
 		cpu = select_fallback_rq(task_cpu(p), p);
 
 	return cpu;
@@ -2684,6 +2892,7 @@ ttwu_do_activate(struct rq *rq, struct task_struct *p, int wake_flags)
 #endif
 
 	ttwu_activate(rq, p, ENQUEUE_WAKEUP | ENQUEUE_WAKING);
+	schedstat_set(p->se.statistics.wakeup_stamp, rq->clock);
 	ttwu_do_wakeup(rq, p, wake_flags);
 }
 
@@ -2854,6 +3063,12 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 	if (p->on_rq && ttwu_remote(p, wake_flags))
 		goto stat;
 
+#ifdef CONFIG_CPU_FREQ
+	/* only direct wakees, and not whatever an interrupt preempted */
+	if (current->latency_sensitive && !in_interrupt())
+		p->latency_wakee = true;
+#endif
+
 #ifdef CONFIG_SMP
 	/*
 	 * If the owning (remote) cpu is still in the middle of schedule() with
@@ -2981,6 +3196,10 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_SMP
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
@@ -3001,6 +3220,13 @@ void sched_fork(struct task_struct *p)
 	int cpu = get_cpu();
 
 	__sched_fork(p);
+#ifdef CONFIG_CPU_FREQ
+	p->latency_wakee = false;
+	p->latency_queued = false;
+#endif
+#ifdef CONFIG_CGROUP_SCHED
+	p->foreground_queued = false;
+#endif
 	/*
 	 * We mark the process as running here. This guarantees that
 	 * nobody will actually run it, and a signal or other external
@@ -3162,6 +3388,52 @@ fire_sched_out_preempt_notifiers(struct task_struct *curr,
 
 #endif /* CONFIG_PREEMPT_NOTIFIERS */
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Account the time @next waited since its wakeup, on this cpu and in its
+ * cpu cgroup.  Preemptions and requeues are not wakeups and aren't counted.
+ */
+static void sched_wakeup_latency(struct rq *rq, struct task_struct *next)
+{
+	u64 stamp = next->se.statistics.wakeup_stamp;
+	s64 delta;
+	unsigned int bucket;
+	int class;
+#ifdef CONFIG_CGROUP_SCHED
+	struct task_group *tg;
+#endif
+
+	if (!stamp)
+		return;
+	next->se.statistics.wakeup_stamp = 0;
+
+	if (next->sched_class == &fair_sched_class)
+		class = WAKEUP_LAT_FAIR;
+	else if (next->sched_class == &rt_sched_class)
+		class = WAKEUP_LAT_RT;
+	else
+		return;
+
+	/* the stamp was taken on another cpu's clock if we got migrated */
+	delta = rq->clock - stamp;
+	if (delta < 0)
+		delta = 0;
+	bucket = log2_hist_bucket(delta >> 10, WAKEUP_LAT_BUCKETS);
+
+	rq->wakeup_lat[class].count[bucket]++;
+#ifdef CONFIG_CGROUP_SCHED
+	tg = task_group(next);
+	if (task_group_is_autogroup(tg))
+		tg = tg->parent;
+	per_cpu_ptr(tg->wakeup_lat, cpu_of(rq))->count[bucket]++;
+#endif
+}
+#else
+static inline void sched_wakeup_latency(struct rq *rq, struct task_struct *next)
+{
+}
+#endif
+
 /**
  * prepare_task_switch - prepare to switch tasks
  * @rq: the runqueue preparing to switch
@@ -3180,6 +3452,7 @@ prepare_task_switch(struct rq *rq, struct task_struct *prev,
 		    struct task_struct *next)
 {
 	sched_info_switch(prev, next);
+	sched_wakeup_latency(rq, next);
 	perf_event_task_sched_out(prev, next);
 	fire_sched_out_preempt_notifiers(prev, next);
 	prepare_lock_switch(rq, next);
@@ -3421,12 +3694,41 @@ unsigned long nr_iowait_cpu(int cpu)
 	return atomic_read(&this->nr_iowait);
 }
 
+unsigned long nr_foreground_cpu(int cpu)
+{
+#if defined(CONFIG_CGROUP_SCHED) && defined(CONFIG_SMP)
+	return cpu_rq(cpu)->nr_foreground;
+#else
+	return 0;
+#endif
+}
+
 unsigned long this_cpu_load(void)
 {
 	struct rq *this = this_rq();
 	return this->cpu_load[0];
 }
 
+/**
+ * sched_cpu_usage - how busy CFS has kept a cpu lately
+ * @cpu: cpu to look at
+ *
+ * Sum of the decayed running time of the entities queued on @cpu, scaled
+ * to SCHED_LOAD_SCALE.  A task carries its history across sleeps, so the
+ * value already accounts for it on the enqueue that wakes it up.
+ */
+unsigned long sched_cpu_usage(int cpu)
+{
+#ifdef CONFIG_SMP
+	unsigned long usage = ACCESS_ONCE(cpu_rq(cpu)->cfs.usage_load_avg);
+
+	return min_t(unsigned long, usage, SCHED_LOAD_SCALE);
+#else
+	return cpu_rq(cpu)->cfs.nr_running ? SCHED_LOAD_SCALE : 0;
+#endif
+}
+EXPORT_SYMBOL_GPL(sched_cpu_usage);
+
 
 /* Variables and functions for calc_load */
 static atomic_long_t calc_load_tasks;
@@ -3785,6 +4087,16 @@ static void __update_cpu_load(struct rq *this_rq, unsigned long this_load,
 	sched_avg_update(this_rq);
 }
 
+/* the load fed to cpu_load[], in the units weighted_cpuload() compares */
+static inline unsigned long get_rq_runnable_load(struct rq *rq)
+{
+#ifdef CONFIG_SMP
+	return rq->cfs.runnable_load_avg;
+#else
+	return rq->load.weight;
+#endif
+}
+
 #ifdef CONFIG_NO_HZ
 /*
  * There is no sane way to deal with nohz on smp when using jiffies because the
@@ -3806,7 +4118,7 @@ static void __update_cpu_load(struct rq *this_rq, unsigned long this_load,
 static void update_idle_cpu_load(struct rq *this_rq)
 {
  unsigned long curr_jiffies = ACCESS_ONCE(jiffies);
- unsigned long load = this_rq->load.weight;
+ unsigned long load = get_rq_runnable_load(this_rq);
  unsigned long pending_updates;
 
        /*
@@ -3858,7 +4170,7 @@ static void update_cpu_load_active(struct rq *this_rq)
 	* See the mess around update_idle_cpu_load() / update_cpu_load_nohz().
 	*/
           this_rq->last_load_update_tick = jiffies;
-           __update_cpu_load(this_rq, this_rq->load.weight, 1);
+           __update_cpu_load(this_rq, get_rq_runnable_load(this_rq), 1);
 
 	calc_load_account_active(this_rq);
 }
@@ -3973,6 +4285,7 @@ void account_user_time(struct task_struct *p, cputime_t cputime,
 		cpustat->user = cputime64_add(cpustat->user, tmp);
 
 	cpuacct_update_stats(p, CPUACCT_STAT_USER, cputime);
+	cpufreq_task_times_account(p, cputime);
 	/* Account for user time used */
 	acct_update_integrals(p);
 }
@@ -4028,6 +4341,7 @@ void __account_system_time(struct task_struct *p, cputime_t cputime,
 	/* Add system time to cpustat. */
 	*target_cputime64 = cputime64_add(*target_cputime64, tmp);
 	cpuacct_update_stats(p, CPUACCT_STAT_SYSTEM, cputime);
+	cpufreq_task_times_account(p, cputime);
 
 	/* Account for system time used */
 	acct_update_integrals(p);
@@ -6369,6 +6683,59 @@ static int migration_cpu_stop(void *data)
 
 #ifdef CONFIG_HOTPLUG_CPU
 
+#define EVACUATE_BATCH	16
+#define EVACUATE_PASSES	64
+
+/*
+ * Push the runnable tasks that may run elsewhere off @cpu, which was
+ * just parked: marked inactive while staying online.  Sleeping tasks
+ * are placed elsewhere by select_task_rq() when they wake up.  Tasks
+ * are taken in batches, because the migration has to sleep, and the
+ * number of passes is bounded in case some keep racing back.
+ */
+void sched_evacuate_cpu(int cpu)
+{
+	struct task_struct *batch[EVACUATE_BATCH];
+	struct task_struct *g, *p;
+	struct migration_arg arg;
+	unsigned long flags;
+	struct rq *rq;
+	int i, n, passes = 0;
+
+	do {
+		n = 0;
+		rcu_read_lock();
+		do_each_thread(g, p) {
+			if (task_cpu(p) != cpu || !p->on_rq ||
+			    p->rt.nr_cpus_allowed == 1 ||
+			    !cpumask_intersects(tsk_cpus_allowed(p),
+						cpu_active_mask))
+				continue;
+			get_task_struct(p);
+			batch[n++] = p;
+			if (n == EVACUATE_BATCH)
+				goto full;
+		} while_each_thread(g, p);
+full:
+		rcu_read_unlock();
+
+		for (i = 0; i < n; i++) {
+			p = batch[i];
+			rq = task_rq_lock(p, &flags);
+			arg.task = p;
+			arg.dest_cpu = cpumask_any_and(cpu_active_mask,
+						       tsk_cpus_allowed(p));
+			if (task_cpu(p) == cpu && p->on_rq &&
+			    arg.dest_cpu < nr_cpu_ids) {
+				task_rq_unlock(rq, p, &flags);
+				stop_one_cpu(cpu, migration_cpu_stop, &arg);
+			} else
+				task_rq_unlock(rq, p, &flags);
+			put_task_struct(p);
+		}
+	} while (n == EVACUATE_BATCH && ++passes < EVACUATE_PASSES);
+}
+
 /*
  * Ensures that the idle task is using init_mm right before its cpu goes
  * offline.
@@ -8161,10 +8528,10 @@ static void init_cfs_rq(struct cfs_rq *cfs_rq, struct rq *rq)
 	INIT_LIST_HEAD(&cfs_rq->tasks);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	cfs_rq->rq = rq;
-	/* allow initial update_cfs_load() to truncate */
-#ifdef CONFIG_SMP
-	cfs_rq->load_stamp = 1;
 #endif
+#ifdef CONFIG_SMP
+	atomic64_set(&cfs_rq->decay_counter, 1);
+	atomic64_set(&cfs_rq->removed_load, 0);
 #endif
 	cfs_rq->min_vruntime = (u64)(-(1LL << 20));
 #ifndef CONFIG_64BIT
@@ -8317,6 +8684,9 @@ void __init sched_init(void)
 #ifdef CONFIG_CGROUP_SCHED
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
+#ifdef CONFIG_SCHEDSTATS
+	root_task_group.wakeup_lat = &root_wakeup_lat;
+#endif
 	autogroup_init(&init_task);
 #endif /* CONFIG_CGROUP_SCHED */
 
@@ -8762,6 +9132,9 @@ static void free_sched_group(struct task_group *tg)
 	free_fair_sched_group(tg);
 	free_rt_sched_group(tg);
 	autogroup_free(tg);
+#ifdef CONFIG_SCHEDSTATS
+	free_percpu(tg->wakeup_lat);
+#endif
 	kfree(tg);
 }
 
@@ -8781,12 +9154,20 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!alloc_rt_sched_group(tg, parent))
 		goto err;
 
+#ifdef CONFIG_SCHEDSTATS
+	tg->wakeup_lat = alloc_percpu(struct wakeup_latency_hist);
+	if (!tg->wakeup_lat)
+		goto err;
+#endif
+
 	spin_lock_irqsave(&task_group_lock, flags);
 	list_add_rcu(&tg->list, &task_groups);
 
 	WARN_ON(!parent); /* root should already exist */
 
 	tg->parent = parent;
+	tg->placement = parent->placement;
+	tg->timer_slack_ns = parent->timer_slack_ns;
 	INIT_LIST_HEAD(&tg->children);
 	list_add_rcu(&tg->siblings, &parent->children);
 	spin_unlock_irqrestore(&task_group_lock, flags);
@@ -9246,10 +9627,18 @@ cpu_cgroup_can_attach_task(struct cgroup *cgrp, struct task_struct *tsk)
 	return 0;
 }
 
+static void
+cpu_cgroup_set_timer_slack(struct task_group *tg, struct task_struct *tsk)
+{
+	tsk->timer_slack_ns = tg->timer_slack_ns ? : tsk->default_timer_slack_ns;
+}
+
 static void
 cpu_cgroup_attach_task(struct cgroup *cgrp, struct task_struct *tsk)
 {
 	sched_move_task(tsk);
+	cpu_cgroup_set_timer_slack(cgroup_tg(cgrp), tsk);
+	autogroup_cgroup_attach(tsk);
 #ifdef CONFIG_ANDROID_BG_SCAN_MEM
 		if (task_notify_on_migrate(tsk) && thread_group_leader(tsk))
 			raw_notifier_call_chain(&bgtsk_migration_notifier_head,
@@ -9290,6 +9679,64 @@ static int cpu_notify_on_migrate_write_u64(struct cgroup *cgrp,
 	return 0;
 }
 
+static u64 cpu_placement_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+
+	return tg->placement;
+}
+
+/*
+ * Takes effect on the next wakeup of each task; tasks already queued keep
+ * being counted in the class they were queued with.
+ */
+static int cpu_placement_write_u64(struct cgroup *cgrp, struct cftype *cft,
+				   u64 placement)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+
+	if (placement > SCHED_PLACE_BACKGROUND)
+		return -EINVAL;
+
+	tg->placement = placement;
+
+	return 0;
+}
+
+static u64 cpu_timer_slack_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+
+	return tg->timer_slack_ns;
+}
+
+/*
+ * The slack is what lets hrtimers and wheel timers of the group's tasks
+ * be aligned to common expiry boundaries (see hrtimer_align_expires() and
+ * apply_slack()), so a background group with a large slack wakes the
+ * system once for many timers.  Writing 0 puts the tasks back on their
+ * default slack.
+ */
+static int cpu_timer_slack_write_u64(struct cgroup *cgrp, struct cftype *cft,
+				     u64 slack_ns)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	struct cgroup_iter it;
+	struct task_struct *tsk;
+
+	if (slack_ns > ULONG_MAX)
+		return -EINVAL;
+
+	tg->timer_slack_ns = slack_ns;
+
+	cgroup_iter_start(cgrp, &it);
+	while ((tsk = cgroup_iter_next(cgrp, &it)))
+		cpu_cgroup_set_timer_slack(tg, tsk);
+	cgroup_iter_end(cgrp, &it);
+
+	return 0;
+}
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static int cpu_shares_write_u64(struct cgroup *cgrp, struct cftype *cftype,
 				u64 shareval)
@@ -9329,12 +9776,44 @@ static u64 cpu_rt_period_read_uint(struct cgroup *cgrp, struct cftype *cft)
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_SCHEDSTATS
+static int cpu_wakeup_latency_show(struct cgroup *cgrp, struct cftype *cft,
+				   struct seq_file *m)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	int cpu;
+
+	wakeup_latency_header(m);
+	for_each_online_cpu(cpu) {
+		seq_printf(m, "cpu%d", cpu);
+		wakeup_latency_print(m, per_cpu_ptr(tg->wakeup_lat, cpu));
+	}
+	return 0;
+}
+#endif
+
 static struct cftype cpu_files[] = {
 	{
 		.name = "notify_on_migrate",
 		.read_u64 = cpu_notify_on_migrate_read_u64,
 		.write_u64 = cpu_notify_on_migrate_write_u64,
 	},
+	{
+		.name = "placement",
+		.read_u64 = cpu_placement_read_u64,
+		.write_u64 = cpu_placement_write_u64,
+	},
+	{
+		.name = "timer_slack_ns",
+		.read_u64 = cpu_timer_slack_read_u64,
+		.write_u64 = cpu_timer_slack_write_u64,
+	},
+#ifdef CONFIG_SCHEDSTATS
+	{
+		.name = "wakeup_latency",
+		.read_seq_string = cpu_wakeup_latency_show,
+	},
+#endif
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
 		.name = "shares",
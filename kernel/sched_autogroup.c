@@ -5,15 +5,48 @@
 #include <linux/kallsyms.h>
 #include <linux/utsname.h>
 
-unsigned int __read_mostly sysctl_sched_autogroup_enabled = 1;
+/*
+ * sched_autogroup_enabled selects how groups are formed:
+ *
+ *  0 - off, tasks stay in their cpu cgroup.
+ *  1 - one group per tty session, created by setsid().
+ *  2 - one group per (uid, cpu cgroup): every process of an application
+ *      shares a group below whichever cpuctl group (foreground, background)
+ *      it was put into, so an app spawning many threads only competes with
+ *      other apps as a single entity.  The group follows the process when
+ *      its uid changes or its leader is moved to another cpu cgroup.
+ */
+enum {
+	AUTOGROUP_OFF,
+	AUTOGROUP_SESSION,
+	AUTOGROUP_UID,
+};
+
+#ifdef CONFIG_SCHED_AUTOGROUP_UID
+unsigned int __read_mostly sysctl_sched_autogroup_enabled = AUTOGROUP_UID;
+#else
+unsigned int __read_mostly sysctl_sched_autogroup_enabled = AUTOGROUP_SESSION;
+#endif
+/* cpu.shares each new autogroup starts out with */
+unsigned int __read_mostly sysctl_sched_autogroup_shares =
+						scale_load_down(NICE_0_LOAD);
 static struct autogroup autogroup_default;
 static atomic_t autogroup_seq_nr;
 
+/*
+ * uid keyed groups; the list holds no reference, so lookups have to skip
+ * groups whose last reference is already gone.  Groups may be released
+ * from RCU callbacks, hence the irqsave.
+ */
+static LIST_HEAD(autogroup_uid_list);
+static DEFINE_SPINLOCK(autogroup_uid_lock);
+
 static void __init autogroup_init(struct task_struct *init_task)
 {
 	autogroup_default.tg = &root_task_group;
 	kref_init(&autogroup_default.kref);
 	init_rwsem(&autogroup_default.lock);
+	INIT_LIST_HEAD(&autogroup_default.uid_node);
 	init_task->signal->autogroup = &autogroup_default;
 }
 
@@ -25,6 +58,14 @@ static inline void autogroup_free(struct task_group *tg)
 static inline void autogroup_destroy(struct kref *kref)
 {
 	struct autogroup *ag = container_of(kref, struct autogroup, kref);
+	struct task_group *parent = ag->tg->parent;
+	unsigned long flags;
+
+	if (!list_empty(&ag->uid_node)) {
+		spin_lock_irqsave(&autogroup_uid_lock, flags);
+		list_del(&ag->uid_node);
+		spin_unlock_irqrestore(&autogroup_uid_lock, flags);
+	}
 
 #ifdef CONFIG_RT_GROUP_SCHED
 	/* We've redirected RT tasks to the root task group... */
@@ -32,6 +73,7 @@ static inline void autogroup_destroy(struct kref *kref)
 	ag->tg->rt_rq = NULL;
 #endif
 	sched_destroy_group(ag->tg);
+	css_put(&parent->css);
 }
 
 static inline void autogroup_kref_put(struct autogroup *ag)
@@ -63,7 +105,8 @@ static inline struct autogroup *autogroup_task_get(struct task_struct *p)
 static void free_rt_sched_group(struct task_group *tg);
 #endif
 
-static inline struct autogroup *autogroup_create(void)
+/* The caller holds a reference on @parent, the new group takes its own */
+static inline struct autogroup *autogroup_create(struct task_group *parent)
 {
 	struct autogroup *ag = kzalloc(sizeof(*ag), GFP_KERNEL);
 	struct task_group *tg;
@@ -71,13 +114,15 @@ static inline struct autogroup *autogroup_create(void)
 	if (!ag)
 		goto out_fail;
 
-	tg = sched_create_group(&root_task_group);
+	tg = sched_create_group(parent);
 
 	if (IS_ERR(tg))
 		goto out_free;
 
+	css_get(&parent->css);
 	kref_init(&ag->kref);
 	init_rwsem(&ag->lock);
+	INIT_LIST_HEAD(&ag->uid_node);
 	ag->id = atomic_inc_return(&autogroup_seq_nr);
 	ag->tg = tg;
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -95,6 +140,10 @@ static inline struct autogroup *autogroup_create(void)
 #endif
 	tg->autogroup = ag;
 
+	if (sysctl_sched_autogroup_shares != scale_load_down(NICE_0_LOAD))
+		sched_group_set_shares(tg,
+				scale_load(sysctl_sched_autogroup_shares));
+
 	return ag;
 
 out_free:
@@ -111,7 +160,12 @@ out_fail:
 static inline bool
 task_wants_autogroup(struct task_struct *p, struct task_group *tg)
 {
-	if (tg != &root_task_group)
+	/*
+	 * Only redirect tasks sitting in the group the autogroup was made
+	 * under: a thread moved to another cpu cgroup on its own follows
+	 * that cgroup.  The default group has no parent and never matches.
+	 */
+	if (tg != p->signal->autogroup->tg->parent)
 		return false;
 
 	if (p->sched_class != &fair_sched_class)
@@ -169,17 +223,114 @@ autogroup_move_group(struct task_struct *p, struct autogroup *ag)
 	autogroup_kref_put(prev);
 }
 
+/* Takes a reference on the group found, called with autogroup_uid_lock */
+static struct autogroup *
+autogroup_uid_find(uid_t uid, struct task_group *parent)
+{
+	struct autogroup *ag;
+
+	list_for_each_entry(ag, &autogroup_uid_list, uid_node) {
+		if (ag->uid == uid && ag->tg->parent == parent &&
+		    atomic_inc_not_zero(&ag->kref.refcount))
+			return ag;
+	}
+
+	return NULL;
+}
+
+static struct autogroup *autogroup_uid_get(uid_t uid, struct task_group *parent)
+{
+	struct autogroup *ag, *new;
+	unsigned long flags;
+
+	spin_lock_irqsave(&autogroup_uid_lock, flags);
+	ag = autogroup_uid_find(uid, parent);
+	spin_unlock_irqrestore(&autogroup_uid_lock, flags);
+	if (ag)
+		return ag;
+
+	new = autogroup_create(parent);
+	if (new == &autogroup_default)
+		return new;
+	new->uid = uid;
+
+	/* another thread of the same app may have raced us here */
+	spin_lock_irqsave(&autogroup_uid_lock, flags);
+	ag = autogroup_uid_find(uid, parent);
+	if (!ag) {
+		list_add(&new->uid_node, &autogroup_uid_list);
+		ag = new;
+		new = NULL;
+	}
+	spin_unlock_irqrestore(&autogroup_uid_lock, flags);
+
+	if (new)
+		autogroup_kref_put(new);
+
+	return ag;
+}
+
+/*
+ * Move @p's thread group to the autogroup of @p's uid below @p's current
+ * cpu cgroup.  Allocates GFP_KERNEL, cannot be called under any spinlock.
+ */
+static void autogroup_uid_attach(struct task_struct *p)
+{
+	struct task_group *parent;
+	struct autogroup *ag;
+	uid_t uid;
+
+	rcu_read_lock();
+	uid = __task_cred(p)->uid;
+	parent = container_of(task_subsys_state(p, cpu_cgroup_subsys_id),
+			      struct task_group, css);
+	if (!css_tryget(&parent->css))
+		parent = NULL;
+	rcu_read_unlock();
+
+	if (!parent)
+		return;
+
+	ag = autogroup_uid_get(uid, parent);
+	autogroup_move_group(p, ag);
+	autogroup_kref_put(ag);
+	css_put(&parent->css);
+}
+
 /* Allocates GFP_KERNEL, cannot be called under any spinlock */
 void sched_autogroup_create_attach(struct task_struct *p)
 {
-	struct autogroup *ag = autogroup_create();
+	struct autogroup *ag;
 
+	if (ACCESS_ONCE(sysctl_sched_autogroup_enabled) == AUTOGROUP_UID) {
+		autogroup_uid_attach(p);
+		return;
+	}
+
+	ag = autogroup_create(&root_task_group);
 	autogroup_move_group(p, ag);
 	/* drop extra reference added by autogroup_create() */
 	autogroup_kref_put(ag);
 }
 EXPORT_SYMBOL(sched_autogroup_create_attach);
 
+/* Called from commit_creds() once current's real uid changed */
+void sched_autogroup_setuid(struct task_struct *p)
+{
+	if (ACCESS_ONCE(sysctl_sched_autogroup_enabled) == AUTOGROUP_UID)
+		autogroup_uid_attach(p);
+}
+
+/* @p was attached to another cpu cgroup, called with cgroup_mutex held */
+static void autogroup_cgroup_attach(struct task_struct *p)
+{
+	if (ACCESS_ONCE(sysctl_sched_autogroup_enabled) != AUTOGROUP_UID)
+		return;
+
+	if (thread_group_leader(p) && !(p->flags & PF_EXITING))
+		autogroup_uid_attach(p);
+}
+
 /* Cannot be called under siglock.  Currently has no users */
 void sched_autogroup_detach(struct task_struct *p)
 {
@@ -6,6 +6,9 @@ struct autogroup {
 	struct rw_semaphore	lock;
 	unsigned long		id;
 	int			nice;
+	/* uid grouping: keyed on (uid, tg->parent), empty otherwise */
+	uid_t			uid;
+	struct list_head	uid_node;
 };
 
 static inline struct task_group *
@@ -20,6 +23,8 @@ static inline bool task_group_is_autogroup(struct task_group *tg)
 	return 0;
 }
 
+static inline void autogroup_cgroup_attach(struct task_struct *p) { }
+
 static inline struct task_group *
 autogroup_task_group(struct task_struct *p, struct task_group *tg)
 {
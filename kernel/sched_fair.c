@@ -82,13 +82,6 @@ unsigned int normalized_sysctl_sched_wakeup_granularity = 1000000UL;
 
 const_debug unsigned int sysctl_sched_migration_cost = 500000UL;
 
-/*
- * The exponential sliding  window over which load is averaged for shares
- * distribution.
- * (default: 10msec)
- */
-unsigned int __read_mostly sysctl_sched_shares_window = 10000000UL;
-
 static const struct sched_class fair_sched_class;
 
 static unsigned long __read_mostly max_load_balance_interval = HZ/10;
@@ -548,7 +541,6 @@ static u64 sched_vslice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	return calc_delta_fair(sched_slice(cfs_rq, se), se);
 }
 
-static void update_cfs_load(struct cfs_rq *cfs_rq, int global_update);
 static void update_cfs_shares(struct cfs_rq *cfs_rq);
 
 /*
@@ -570,10 +562,6 @@ __update_curr(struct cfs_rq *cfs_rq, struct sched_entity *curr,
 
 	curr->vruntime += delta_exec_weighted;
 	update_min_vruntime(cfs_rq);
-
-#if defined CONFIG_SMP && defined CONFIG_FAIR_GROUP_SCHED
-	cfs_rq->load_unacc_exec_time += delta_exec;
-#endif
 }
 
 static void update_curr(struct cfs_rq *cfs_rq)
@@ -710,67 +698,23 @@ account_entity_dequeue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 # ifdef CONFIG_SMP
-static void update_cfs_rq_load_contribution(struct cfs_rq *cfs_rq,
-					    int global_update)
+/* fold this cpu's runnable and blocked load into the group's */
+static inline void __update_cfs_rq_tg_load_contrib(struct cfs_rq *cfs_rq,
+						   int force_update)
 {
 	struct task_group *tg = cfs_rq->tg;
-	long load_avg;
-
-	load_avg = div64_u64(cfs_rq->load_avg, cfs_rq->load_period+1);
-	load_avg -= cfs_rq->load_contribution;
-
-	if (global_update || abs(load_avg) > cfs_rq->load_contribution / 8) {
-		atomic_add(load_avg, &tg->load_weight);
-		cfs_rq->load_contribution += load_avg;
-	}
-}
-
-static void update_cfs_load(struct cfs_rq *cfs_rq, int global_update)
-{
-	u64 period = sysctl_sched_shares_window;
-	u64 now, delta;
-	unsigned long load = cfs_rq->load.weight;
+	long tg_contrib;
 
-	if (cfs_rq->tg == &root_task_group)
+	if (tg == &root_task_group)
 		return;
 
-	now = rq_of(cfs_rq)->clock_task;
-	delta = now - cfs_rq->load_stamp;
+	tg_contrib = cfs_rq->runnable_load_avg + cfs_rq->blocked_load_avg;
+	tg_contrib -= cfs_rq->tg_load_contrib;
 
-	/* truncate load history at 4 idle periods */
-	if (cfs_rq->load_stamp > cfs_rq->load_last &&
-	    now - cfs_rq->load_last > 4 * period) {
-		cfs_rq->load_period = 0;
-		cfs_rq->load_avg = 0;
-		delta = period - 1;
+	if (force_update || abs(tg_contrib) > cfs_rq->tg_load_contrib / 8) {
+		atomic_add(tg_contrib, &tg->load_weight);
+		cfs_rq->tg_load_contrib += tg_contrib;
 	}
-
-	cfs_rq->load_stamp = now;
-	cfs_rq->load_unacc_exec_time = 0;
-	cfs_rq->load_period += delta;
-	if (load) {
-		cfs_rq->load_last = now;
-		cfs_rq->load_avg += delta * load;
-	}
-
-	/* consider updating load contribution on each fold or truncate */
-	if (global_update || cfs_rq->load_period > period
-	    || !cfs_rq->load_period)
-		update_cfs_rq_load_contribution(cfs_rq, global_update);
-
-	while (cfs_rq->load_period > period) {
-		/*
-		 * Inline assembly required to prevent the compiler
-		 * optimising this loop into a divmod call.
-		 * See __iter_div_u64_rem() for another example of this.
-		 */
-		asm("" : "+rm" (cfs_rq->load_period));
-		cfs_rq->load_period /= 2;
-		cfs_rq->load_avg /= 2;
-	}
-
-	if (!cfs_rq->curr && !cfs_rq->nr_running && !cfs_rq->load_avg)
-		list_del_leaf_cfs_rq(cfs_rq);
 }
 
 static long calc_cfs_shares(struct cfs_rq *cfs_rq, struct task_group *tg)
@@ -781,7 +725,7 @@ static long calc_cfs_shares(struct cfs_rq *cfs_rq, struct task_group *tg)
 
 	load_weight = atomic_read(&tg->load_weight);
 	load_weight += load;
-	load_weight -= cfs_rq->load_contribution;
+	load_weight -= cfs_rq->tg_load_contrib;
 
 	shares = (tg->shares * load);
 	if (load_weight)
@@ -794,27 +738,11 @@ static long calc_cfs_shares(struct cfs_rq *cfs_rq, struct task_group *tg)
 
 	return shares;
 }
-
-static void update_entity_shares_tick(struct cfs_rq *cfs_rq)
-{
-	if (cfs_rq->load_unacc_exec_time > sysctl_sched_shares_window) {
-		update_cfs_load(cfs_rq, 0);
-		update_cfs_shares(cfs_rq);
-	}
-}
 # else /* CONFIG_SMP */
-static void update_cfs_load(struct cfs_rq *cfs_rq, int global_update)
-{
-}
-
 static inline long calc_cfs_shares(struct cfs_rq *cfs_rq, struct task_group *tg)
 {
 	return tg->shares;
 }
-
-static inline void update_entity_shares_tick(struct cfs_rq *cfs_rq)
-{
-}
 # endif /* CONFIG_SMP */
 static void reweight_entity(struct cfs_rq *cfs_rq, struct sched_entity *se,
 			    unsigned long weight)
@@ -851,18 +779,364 @@ static void update_cfs_shares(struct cfs_rq *cfs_rq)
 	reweight_entity(cfs_rq_of(se), se, shares);
 }
 #else /* CONFIG_FAIR_GROUP_SCHED */
-static void update_cfs_load(struct cfs_rq *cfs_rq, int global_update)
+static inline void update_cfs_shares(struct cfs_rq *cfs_rq)
 {
 }
+#endif /* CONFIG_FAIR_GROUP_SCHED */
 
-static inline void update_cfs_shares(struct cfs_rq *cfs_rq)
+#if !defined(CONFIG_FAIR_GROUP_SCHED) && defined(CONFIG_SMP)
+static inline void __update_cfs_rq_tg_load_contrib(struct cfs_rq *cfs_rq,
+						   int force_update)
 {
 }
+#endif
+
+#ifdef CONFIG_SMP
+/*
+ * Per-entity load tracking.
+ *
+ * The load of an entity is the geometric series
+ *
+ *   u_0 + u_1*y + u_2*y^2 + ...
+ *
+ * where u_i is the part of the i-th most recent 1024us period it was
+ * runnable, and y^LOAD_AVG_PERIOD = 1/2: what the entity did 32ms ago
+ * counts half of what it does now.  Its load_avg_contrib is that series
+ * as a fraction of the one a never sleeping entity has, times its weight,
+ * and a cfs_rq sums the contributions of what it has queued.
+ *
+ * A group entity is runnable while its cfs_rq has anything queued and
+ * weighs the shares it was given, so the history of a group reaches the
+ * root through its entity the same way a task's does.
+ *
+ * usage_avg_sum is the same series over the time the entity was running.
+ */
+#define LOAD_AVG_PERIOD	32
+#define LOAD_AVG_MAX	47742	/* maximum possible runnable_avg_sum */
+#define LOAD_AVG_MAX_N	345	/* number of full periods to get there */
+
+/* floor(2^32 * y^n) */
+static const u32 runnable_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99b, 0xeac0c6e7, 0xe5b906e7,
+	0xe0ccdeec, 0xdbfbb797, 0xd744fcca, 0xd2a81d91, 0xce248c15, 0xc9b9bd86,
+	0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47, 0xb504f333, 0xb123f581,
+	0xad583eea, 0xa9a15ab4, 0xa5fed6a9, 0xa2704303, 0x9ef53260, 0x9b8d39b9,
+	0x9837f051, 0x94f4efa8, 0x91c3d373, 0x8ea4398b, 0x8b95c1e3, 0x88980e80,
+	0x85aac367, 0x82cd8698,
+};
 
-static inline void update_entity_shares_tick(struct cfs_rq *cfs_rq)
+/*
+ * floor(1024 * \Sum y^k { 1 <= k <= n }), rounded down so recombining
+ * them never over-estimates.
+ */
+static const u32 runnable_avg_yN_sum[] = {
+	    0,  1002,  1982,  2942,  3881,  4800,  5699,  6579,  7440,  8282,
+	 9107,  9914, 10704, 11476, 12232, 12972, 13696, 14405, 15098, 15777,
+	16441, 17091, 17726, 18349, 18957, 19553, 20136, 20707, 21265, 21812,
+	22346, 22870, 23382,
+};
+
+/* val * y^n */
+static __always_inline u64 decay_load(u64 val, u64 n)
 {
+	unsigned int local_n;
+
+	if (!n)
+		return val;
+	else if (unlikely(n > LOAD_AVG_PERIOD * 63))
+		return 0;
+
+	local_n = n;
+	if (unlikely(local_n >= LOAD_AVG_PERIOD)) {
+		val >>= local_n / LOAD_AVG_PERIOD;
+		local_n %= LOAD_AVG_PERIOD;
+	}
+
+	val *= runnable_avg_yN_inv[local_n];
+	return val >> 32;
+}
+
+/* what n full periods add to a series: 1024 * \Sum y^k { 1 <= k <= n } */
+static u32 __compute_runnable_contrib(u64 n)
+{
+	u32 contrib = 0;
+
+	if (likely(n <= LOAD_AVG_PERIOD))
+		return runnable_avg_yN_sum[n];
+	else if (unlikely(n >= LOAD_AVG_MAX_N))
+		return LOAD_AVG_MAX;
+
+	/* combine whole half-lives, y^LOAD_AVG_PERIOD = 1/2 */
+	do {
+		contrib /= 2;
+		contrib += runnable_avg_yN_sum[LOAD_AVG_PERIOD];
+
+		n -= LOAD_AVG_PERIOD;
+	} while (n > LOAD_AVG_PERIOD);
+
+	contrib = decay_load(contrib, n);
+	return contrib + runnable_avg_yN_sum[n];
+}
+
+/*
+ * Account the time since the last update to @sa, the entity having been
+ * @runnable and @running all along.  Returns whether a period boundary
+ * was crossed, that is whether the sums decayed.
+ */
+static __always_inline int __update_entity_runnable_avg(u64 now,
+							struct sched_avg *sa,
+							int runnable,
+							int running)
+{
+	u64 delta, periods;
+	u32 contrib;
+	int delta_w, decayed = 0;
+
+	delta = now - sa->last_runnable_update;
+	/* clock_task is per cpu: resync an entity that came from ahead */
+	if ((s64)delta < 0) {
+		sa->last_runnable_update = now;
+		return 0;
+	}
+
+	/* ~1us resolution keeps the sums within a u32 */
+	delta >>= 10;
+	if (!delta)
+		return 0;
+	sa->last_runnable_update = now;
+
+	/* time already accounted to the current, partial period */
+	delta_w = sa->runnable_avg_period % 1024;
+	if (delta + delta_w >= 1024) {
+		decayed = 1;
+
+		/* complete the partial period */
+		delta_w = 1024 - delta_w;
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		if (running)
+			sa->usage_avg_sum += delta_w;
+		sa->runnable_avg_period += delta_w;
+
+		delta -= delta_w;
+
+		/* age it by the periods which followed it */
+		periods = delta / 1024;
+		delta %= 1024;
+
+		sa->runnable_avg_sum = decay_load(sa->runnable_avg_sum,
+						  periods + 1);
+		sa->usage_avg_sum = decay_load(sa->usage_avg_sum, periods + 1);
+		sa->runnable_avg_period = decay_load(sa->runnable_avg_period,
+						     periods + 1);
+
+		/* and add those periods themselves */
+		contrib = __compute_runnable_contrib(periods);
+		if (runnable)
+			sa->runnable_avg_sum += contrib;
+		if (running)
+			sa->usage_avg_sum += contrib;
+		sa->runnable_avg_period += contrib;
+	}
+
+	/* the remainder opens the new partial period */
+	if (runnable)
+		sa->runnable_avg_sum += delta;
+	if (running)
+		sa->usage_avg_sum += delta;
+	sa->runnable_avg_period += delta;
+
+	return decayed;
+}
+
+/* recompute the contributions of @se, returning how its load changed */
+static long __update_entity_load_avg_contrib(struct sched_entity *se,
+					     long *usage_delta)
+{
+	long old_contrib = se->avg.load_avg_contrib;
+	long old_usage = se->avg.usage_avg_contrib;
+	u32 period = se->avg.runnable_avg_period + 1;
+
+	se->avg.load_avg_contrib = div_u64((u64)se->avg.runnable_avg_sum *
+					   se->load.weight, period);
+	se->avg.usage_avg_contrib =
+		(se->avg.usage_avg_sum << SCHED_LOAD_SHIFT) / period;
+
+	*usage_delta = (long)se->avg.usage_avg_contrib - old_usage;
+	return (long)se->avg.load_avg_contrib - old_contrib;
+}
+
+static inline void subtract_blocked_load_contrib(struct cfs_rq *cfs_rq,
+						 long load_contrib)
+{
+	if (likely(load_contrib < (long)cfs_rq->blocked_load_avg))
+		cfs_rq->blocked_load_avg -= load_contrib;
+	else
+		cfs_rq->blocked_load_avg = 0;
+}
+
+/*
+ * Bring the averages of @se up to date and, with @update_cfs_rq, reflect
+ * the change in the sums of the cfs_rq it is queued on.  A sleeper is
+ * left alone: its part of blocked_load_avg decays with the whole.
+ */
+static void update_entity_load_avg(struct sched_entity *se, int update_cfs_rq)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+	long contrib_delta, usage_delta;
+
+	if (!__update_entity_runnable_avg(rq_of(cfs_rq)->clock_task, &se->avg,
+					  se->on_rq, cfs_rq->curr == se))
+		return;
+
+	contrib_delta = __update_entity_load_avg_contrib(se, &usage_delta);
+
+	if (!update_cfs_rq || !se->on_rq)
+		return;
+
+	cfs_rq->runnable_load_avg += contrib_delta;
+	cfs_rq->usage_load_avg += usage_delta;
+}
+
+/*
+ * Decay the blocked load of @cfs_rq by the periods elapsed since it was
+ * last done, drop what remote wakeups took away, and fold the result into
+ * the group's load when it moved enough or @force_update is set.
+ */
+static void update_cfs_rq_blocked_load(struct cfs_rq *cfs_rq, int force_update)
+{
+	u64 now = rq_of(cfs_rq)->clock_task >> 20;
+	u64 decays;
+
+	decays = now - cfs_rq->last_decay;
+	if (!decays && !force_update)
+		return;
+
+	if (atomic64_read(&cfs_rq->removed_load)) {
+		u64 removed_load = atomic64_xchg(&cfs_rq->removed_load, 0);
+		subtract_blocked_load_contrib(cfs_rq, removed_load);
+	}
+
+	if (decays) {
+		cfs_rq->blocked_load_avg = decay_load(cfs_rq->blocked_load_avg,
+						      decays);
+		atomic64_add(decays, &cfs_rq->decay_counter);
+		cfs_rq->last_decay = now;
+	}
+
+	__update_cfs_rq_tg_load_contrib(cfs_rq, force_update);
+}
+
+/*
+ * Decay the load_avg_contrib of a sleeper by what its cfs_rq decayed the
+ * blocked load by since it went to sleep, so the two still match.
+ */
+static inline u64 __synchronize_entity_decay(struct sched_entity *se)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+	u64 decays = atomic64_read(&cfs_rq->decay_counter);
+
+	decays -= se->avg.decay_count;
+	se->avg.decay_count = 0;
+	if (!decays)
+		return 0;
+
+	se->avg.load_avg_contrib = decay_load(se->avg.load_avg_contrib, decays);
+
+	return decays;
+}
+
+static inline void enqueue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se, int wakeup)
+{
+	/*
+	 * A positive decay_count is a sleeper still part of our blocked load.
+	 * A sleeper which a wakeup moved here instead carries minus the
+	 * periods its old cfs_rq decayed it by: clock_task is not comparable
+	 * between cpus, so that is how long it is taken to have slept.  An
+	 * entity moved while runnable carries none and keeps its history.
+	 */
+	if (unlikely(se->avg.decay_count <= 0)) {
+		se->avg.last_runnable_update = rq_of(cfs_rq)->clock_task;
+		if (se->avg.decay_count) {
+			se->avg.last_runnable_update -=
+				(-se->avg.decay_count) << 20;
+			update_entity_load_avg(se, 0);
+			se->avg.decay_count = 0;
+		}
+		wakeup = 0;
+	} else {
+		__synchronize_entity_decay(se);
+	}
+
+	if (wakeup) {
+		subtract_blocked_load_contrib(cfs_rq, se->avg.load_avg_contrib);
+		update_entity_load_avg(se, 0);
+	}
+
+	cfs_rq->runnable_load_avg += se->avg.load_avg_contrib;
+	cfs_rq->usage_load_avg += se->avg.usage_avg_contrib;
+	/* load balancer moves change the group's load, always fold them */
+	update_cfs_rq_blocked_load(cfs_rq, !wakeup);
 }
-#endif /* CONFIG_FAIR_GROUP_SCHED */
+
+static inline void dequeue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se, int sleep)
+{
+	update_entity_load_avg(se, 1);
+	/* load balancer moves change the group's load, always fold them */
+	update_cfs_rq_blocked_load(cfs_rq, !sleep);
+
+	cfs_rq->runnable_load_avg -= se->avg.load_avg_contrib;
+	cfs_rq->usage_load_avg -= se->avg.usage_avg_contrib;
+	if (sleep) {
+		cfs_rq->blocked_load_avg += se->avg.load_avg_contrib;
+		se->avg.decay_count = atomic64_read(&cfs_rq->decay_counter);
+	}
+}
+
+/*
+ * A new task starts out as busy as it can be, for a slice, so it is
+ * placed and clocked like a running task until its history says more.
+ */
+static inline void init_task_runnable_average(struct cfs_rq *cfs_rq,
+					      struct task_struct *p)
+{
+	u32 slice = sched_slice(cfs_rq, &p->se) >> 10;
+	long usage_delta;
+
+	p->se.avg.decay_count = 0;
+	p->se.avg.runnable_avg_sum = slice;
+	p->se.avg.runnable_avg_period = slice;
+	p->se.avg.usage_avg_sum = slice;
+	__update_entity_load_avg_contrib(&p->se, &usage_delta);
+}
+#else /* CONFIG_SMP */
+static inline void update_entity_load_avg(struct sched_entity *se,
+					  int update_cfs_rq)
+{
+}
+
+static inline void update_cfs_rq_blocked_load(struct cfs_rq *cfs_rq,
+					      int force_update)
+{
+}
+
+static inline void enqueue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se, int wakeup)
+{
+}
+
+static inline void dequeue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se, int sleep)
+{
+}
+
+static inline void init_task_runnable_average(struct cfs_rq *cfs_rq,
+					      struct task_struct *p)
+{
+}
+#endif /* CONFIG_SMP */
 
 static void enqueue_sleeper(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
@@ -985,7 +1259,7 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
-	update_cfs_load(cfs_rq, 0);
+	enqueue_entity_load_avg(cfs_rq, se, flags & ENQUEUE_WAKEUP);
 	account_entity_enqueue(cfs_rq, se);
 	update_cfs_shares(cfs_rq);
 
@@ -1056,6 +1330,7 @@ dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	dequeue_entity_load_avg(cfs_rq, se, flags & DEQUEUE_SLEEP);
 
 	update_stats_dequeue(cfs_rq, se);
 	if (flags & DEQUEUE_SLEEP) {
@@ -1076,7 +1351,6 @@ dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	if (se != cfs_rq->curr)
 		__dequeue_entity(cfs_rq, se);
 	se->on_rq = 0;
-	update_cfs_load(cfs_rq, 0);
 	account_entity_dequeue(cfs_rq, se);
 
 	/*
@@ -1146,6 +1420,8 @@ set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		 */
 		update_stats_wait_end(cfs_rq, se);
 		__dequeue_entity(cfs_rq, se);
+		/* close the period it spent waiting, before it runs */
+		update_entity_load_avg(se, 1);
 	}
 
 	update_stats_curr_start(cfs_rq, se);
@@ -1220,6 +1496,8 @@ static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 		update_stats_wait_start(cfs_rq, prev);
 		/* Put 'current' back into the tree. */
 		__enqueue_entity(cfs_rq, prev);
+		/* in the !on_rq case the dequeue did this */
+		update_entity_load_avg(prev, 1);
 	}
 	cfs_rq->curr = NULL;
 }
@@ -1232,10 +1510,16 @@ entity_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr, int queued)
 	 */
 	update_curr(cfs_rq);
 
+	/*
+	 * Keep the averages of long-running entities current.
+	 */
+	update_entity_load_avg(curr, 1);
+	update_cfs_rq_blocked_load(cfs_rq, 1);
+
 	/*
 	 * Update share accounting for long-running entities.
 	 */
-	update_entity_shares_tick(cfs_rq);
+	update_cfs_shares(cfs_rq);
 
 #ifdef CONFIG_SCHED_HRTICK
 	/*
@@ -1340,11 +1624,12 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	for_each_sched_entity(se) {
 		struct cfs_rq *cfs_rq = cfs_rq_of(se);
 
-		update_cfs_load(cfs_rq, 0);
 		update_cfs_shares(cfs_rq);
+		update_entity_load_avg(se, 1);
 	}
 
 	hrtick_update(rq);
+	cpufreq_update_util(rq, SCHED_CPUFREQ_ENQUEUE);
 }
 
 static void set_next_buddy(struct sched_entity *se);
@@ -1380,11 +1665,12 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	for_each_sched_entity(se) {
 		struct cfs_rq *cfs_rq = cfs_rq_of(se);
 
-		update_cfs_load(cfs_rq, 0);
 		update_cfs_shares(cfs_rq);
+		update_entity_load_avg(se, 1);
 	}
 
 	hrtick_update(rq);
+	cpufreq_update_util(rq, SCHED_CPUFREQ_DEQUEUE);
 }
 
 #ifdef CONFIG_SMP
@@ -1410,6 +1696,22 @@ static void task_waking_fair(struct task_struct *p)
 	se->vruntime -= min_vruntime;
 }
 
+/*
+ * A sleeper moving to @next_cpu leaves the blocked load of its old cfs_rq.
+ * That wants the old rq's lock, so queue its load in removed_load for the
+ * next update there and carry over how much it has decayed meanwhile.
+ */
+static void migrate_task_rq_fair(struct task_struct *p, int next_cpu)
+{
+	struct sched_entity *se = &p->se;
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+
+	if (se->avg.decay_count) {
+		se->avg.decay_count = -__synchronize_entity_decay(se);
+		atomic64_add(se->avg.load_avg_contrib, &cfs_rq->removed_load);
+	}
+}
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 /*
  * effective_load() calculates the load change as seen from the root_task_group
@@ -1433,7 +1735,7 @@ static long effective_load(struct task_group *tg, int cpu, long wl, long wg)
 
 		/* use this cpu's instantaneous contribution */
 		lw = atomic_read(&tg->load_weight);
-		lw -= se->my_q->load_contribution;
+		lw -= se->my_q->tg_load_contrib;
 		lw += w + wg;
 
 		wl += w;
@@ -1677,6 +1979,81 @@ static int select_idle_sibling(struct task_struct *p, int target)
 	return target;
 }
 
+/*
+ * Wakeup placement by cpu cgroup class.  load and wake_affine() don't know
+ * which groups matter, so background work would wake up next to the UI
+ * thread as readily as anywhere else.
+ *
+ * A foreground task goes to a cpu with no other foreground task queued,
+ * idle first, so the tasks of a frame don't queue behind each other or
+ * behind background work.  A background task is packed on the cpus no
+ * foreground task is queued on, its previous one first, as long as they
+ * are not saturated.  Returns -1 to leave the choice to the load balancing
+ * path.
+ */
+#ifdef CONFIG_CGROUP_SCHED
+static int select_placement_cpu(struct task_struct *p, int prev_cpu)
+{
+	int place = task_placement(p);
+	unsigned long usage, best_usage = 0;
+	int i, best_cpu = -1;
+
+	if (place == SCHED_PLACE_DEFAULT || !sched_feat(GROUP_PLACEMENT))
+		return -1;
+
+	for_each_cpu_and(i, &p->cpus_allowed, cpu_active_mask) {
+		if (cpu_rq(i)->nr_foreground)
+			continue;
+
+		usage = sched_cpu_usage(i);
+		if (place == SCHED_PLACE_FOREGROUND) {
+			/* idle first, then the least busy, then prev_cpu */
+			if (idle_cpu(i))
+				usage = 0;
+			else
+				usage++;
+			if (best_cpu < 0 || usage < best_usage ||
+			    (usage == best_usage && i == prev_cpu)) {
+				best_cpu = i;
+				best_usage = usage;
+			}
+			continue;
+		}
+
+		if (usage >= sysctl_sched_bg_saturation)
+			continue;
+		/* prev_cpu if it can take it, else pack on the busiest */
+		if (i == prev_cpu) {
+			best_cpu = i;
+			break;
+		}
+		if (best_cpu < 0 || usage > best_usage) {
+			best_cpu = i;
+			best_usage = usage;
+		}
+	}
+
+	if (place == SCHED_PLACE_FOREGROUND) {
+		if (best_cpu >= 0)
+			schedstat_inc(this_rq(), ttwu_fg_own);
+		else
+			schedstat_inc(this_rq(), ttwu_fg_shared);
+	} else {
+		if (best_cpu >= 0)
+			schedstat_inc(this_rq(), ttwu_bg_packed);
+		else
+			schedstat_inc(this_rq(), ttwu_bg_saturated);
+	}
+
+	return best_cpu;
+}
+#else
+static inline int select_placement_cpu(struct task_struct *p, int prev_cpu)
+{
+	return -1;
+}
+#endif
+
 /*
  * sched_balance_self: balance the current task (running on cpu) in domains
  * that have the 'flag' flag set. In practice, this is SD_BALANCE_FORK and
@@ -1700,6 +2077,10 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 	int sync = wake_flags & WF_SYNC;
 
 	if (sd_flag & SD_BALANCE_WAKE) {
+		new_cpu = select_placement_cpu(p, prev_cpu);
+		if (new_cpu >= 0)
+			return new_cpu;
+
 		if (cpumask_test_cpu(cpu, &p->cpus_allowed))
 			want_affine = 1;
 		new_cpu = prev_cpu;
@@ -2162,14 +2543,14 @@ balance_tasks(struct rq *this_rq, int this_cpu, struct rq *busiest,
 		if (loops++ > sysctl_sched_nr_migrate)
 			break;
 
-		if ((p->se.load.weight >> 1) > rem_load_move ||
+		if ((p->se.avg.load_avg_contrib >> 1) > rem_load_move ||
 		    !can_migrate_task(p, busiest, this_cpu, sd, idle,
 				      all_pinned))
 			continue;
 
 		pull_task(busiest, p, this_rq, this_cpu);
 		pulled++;
-		rem_load_move -= p->se.load.weight;
+		rem_load_move -= p->se.avg.load_avg_contrib;
 
 #ifdef CONFIG_PREEMPT
 		/*
@@ -2200,25 +2581,13 @@ out:
 }
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
-/*
- * update tg->load_weight by folding this cpu's load_avg
- */
-static int update_shares_cpu(struct task_group *tg, int cpu)
+static void __update_blocked_averages_cpu(struct cfs_rq *cfs_rq)
 {
-	struct cfs_rq *cfs_rq;
-	unsigned long flags;
-	struct rq *rq;
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq_of(cfs_rq))];
 
-	if (!tg->se[cpu])
-		return 0;
-
-	rq = cpu_rq(cpu);
-	cfs_rq = tg->cfs_rq[cpu];
-
-	raw_spin_lock_irqsave(&rq->lock, flags);
-
-	update_rq_clock(rq);
-	update_cfs_load(cfs_rq, 1);
+	update_cfs_rq_blocked_load(cfs_rq, 1);
+	if (!se)
+		return;
 
 	/*
 	 * We need to update shares after updating tg->load_weight in
@@ -2226,22 +2595,49 @@ static int update_shares_cpu(struct task_group *tg, int cpu)
 	 */
 	update_cfs_shares(cfs_rq);
 
-	raw_spin_unlock_irqrestore(&rq->lock, flags);
+	if (se->on_rq) {
+		update_entity_load_avg(se, 1);
+		return;
+	}
 
-	return 0;
+	/*
+	 * Once the history of an idle group's entity has decayed away, so
+	 * has the blocked load below it: stop walking it until it is used.
+	 */
+	__update_entity_runnable_avg(rq_of(cfs_rq)->clock_task, &se->avg,
+				     0, 0);
+	if (!se->avg.runnable_avg_sum && !cfs_rq->nr_running)
+		list_del_leaf_cfs_rq(cfs_rq);
+}
+#else
+static inline void __update_blocked_averages_cpu(struct cfs_rq *cfs_rq)
+{
+	update_cfs_rq_blocked_load(cfs_rq, 1);
 }
+#endif
 
-static void update_shares(int cpu)
+/*
+ * Decay the blocked load of @cpu's cfs_rqs and fold it into their groups,
+ * which keeps the averages of idle groups from going stale.
+ */
+static void update_blocked_averages(int cpu)
 {
-	struct cfs_rq *cfs_rq;
 	struct rq *rq = cpu_rq(cpu);
+	struct cfs_rq *cfs_rq;
+	unsigned long flags;
 
-	rcu_read_lock();
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	update_rq_clock(rq);
+	/*
+	 * Iterates the task_group tree in a bottom up fashion, see
+	 * list_add_leaf_cfs_rq() for details.
+	 */
 	for_each_leaf_cfs_rq(rq, cfs_rq)
-		update_shares_cpu(cfs_rq->tg, cpu);
-	rcu_read_unlock();
+		__update_blocked_averages_cpu(cfs_rq);
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
 }
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
 static unsigned long
 load_balance_fair(struct rq *this_rq, int this_cpu, struct rq *busiest,
 		  unsigned long max_load_move,
@@ -2258,7 +2654,7 @@ load_balance_fair(struct rq *this_rq, int this_cpu, struct rq *busiest,
 	list_for_each_entry_rcu(tg, &task_groups, list) {
 		struct cfs_rq *busiest_cfs_rq = tg->cfs_rq[busiest_cpu];
 		unsigned long busiest_h_load = busiest_cfs_rq->h_load;
-		unsigned long busiest_weight = busiest_cfs_rq->load.weight;
+		unsigned long busiest_weight = busiest_cfs_rq->runnable_load_avg;
 		u64 rem_load, moved_load;
 
 		/*
@@ -2289,10 +2685,6 @@ load_balance_fair(struct rq *this_rq, int this_cpu, struct rq *busiest,
 	return max_load_move - rem_load_move;
 }
 #else
-static inline void update_shares(int cpu)
-{
-}
-
 static unsigned long
 load_balance_fair(struct rq *this_rq, int this_cpu, struct rq *busiest,
 		  unsigned long max_load_move,
@@ -3523,7 +3915,7 @@ static void idle_balance(int this_cpu, struct rq *this_rq)
 	 */
 	raw_spin_unlock(&this_rq->lock);
 
-	update_shares(this_cpu);
+	update_blocked_averages(this_cpu);
 	rcu_read_lock();
 	for_each_domain(this_cpu, sd) {
 		unsigned long interval;
@@ -3919,7 +4311,7 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 	int update_next_balance = 0;
 	int need_serialize;
 
-	update_shares(cpu);
+	update_blocked_averages(cpu);
 
 	rcu_read_lock();
 	for_each_domain(cpu, sd) {
@@ -4146,6 +4538,8 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		cfs_rq = cfs_rq_of(se);
 		entity_tick(cfs_rq, se, queued);
 	}
+
+	cpufreq_update_util(rq, SCHED_CPUFREQ_TICK);
 }
 
 /*
@@ -4176,6 +4570,7 @@ static void task_fork_fair(struct task_struct *p)
 	if (curr)
 		se->vruntime = curr->vruntime;
 	place_entity(cfs_rq, se, 1);
+	init_task_runnable_average(cfs_rq, p);
 
 	if (sysctl_sched_child_runs_first && curr && entity_before(curr, se)) {
 		/*
@@ -4330,6 +4725,7 @@ static const struct sched_class fair_sched_class = {
 	.rq_offline		= rq_offline_fair,
 
 	.task_waking		= task_waking_fair,
+	.migrate_task_rq	= migrate_task_rq_fair,
 #endif
 
 	.set_curr_task          = set_curr_task_fair,
@@ -72,3 +72,9 @@ SCHED_FEAT(NONIRQ_POWER, 1)
 SCHED_FEAT(TTWU_QUEUE, 1)
 
 SCHED_FEAT(FORCE_SD_OVERLAP, 0)
+
+/*
+ * Place wakeups by the placement class of the task's cpu cgroup, see
+ * select_placement_cpu().
+ */
+SCHED_FEAT(GROUP_PLACEMENT, 1)
@@ -97,9 +97,61 @@ static const struct file_operations proc_schedstat_operations = {
 	.release = single_release,
 };
 
+static void wakeup_latency_header(struct seq_file *seq)
+{
+	int i;
+
+	seq_printf(seq, "usecs");
+	for (i = 0; i < WAKEUP_LAT_BUCKETS; i++)
+		seq_printf(seq, " %s%llu",
+			   i < WAKEUP_LAT_BUCKETS - 1 ? "<" : ">=",
+			   log2_hist_bound(i, WAKEUP_LAT_BUCKETS));
+	seq_printf(seq, "\n");
+}
+
+static void
+wakeup_latency_print(struct seq_file *seq, struct wakeup_latency_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < WAKEUP_LAT_BUCKETS; i++)
+		seq_printf(seq, " %u", hist->count[i]);
+	seq_printf(seq, "\n");
+}
+
+static int show_wakeup_latency(struct seq_file *seq, void *v)
+{
+	int cpu;
+
+	wakeup_latency_header(seq);
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		seq_printf(seq, "cpu%d fair", cpu);
+		wakeup_latency_print(seq, &rq->wakeup_lat[WAKEUP_LAT_FAIR]);
+		seq_printf(seq, "cpu%d rt", cpu);
+		wakeup_latency_print(seq, &rq->wakeup_lat[WAKEUP_LAT_RT]);
+	}
+	return 0;
+}
+
+static int wakeup_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, show_wakeup_latency, NULL);
+}
+
+static const struct file_operations proc_wakeup_latency_operations = {
+	.open    = wakeup_latency_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
 static int __init proc_schedstat_init(void)
 {
 	proc_create("schedstat", 0, NULL, &proc_schedstat_operations);
+	proc_create("sched_wakeup_latency", 0, NULL,
+		    &proc_wakeup_latency_operations);
 	return 0;
 }
 module_init(proc_schedstat_init);
@@ -1826,6 +1826,38 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			put_task_struct(tsk);
 			error = 0;
 			break;
+		case PR_SET_FORK_LAZY:
+			if (arg3 | arg4 | arg5)
+				return -EINVAL;
+			if (arg2)
+				set_bit(MMF_FORK_LAZY, &me->mm->flags);
+			else
+				clear_bit(MMF_FORK_LAZY, &me->mm->flags);
+			error = 0;
+			break;
+		case PR_GET_FORK_LAZY:
+			if (arg2 | arg3 | arg4 | arg5)
+				return -EINVAL;
+			error = test_bit(MMF_FORK_LAZY, &me->mm->flags);
+			break;
+#ifdef CONFIG_CPU_FREQ
+		case PR_SET_LATENCY_SENSITIVE_PID:
+			if (!arg3)
+				arg3 = current->pid;
+			if (current->pid != (pid_t)arg3 &&
+					!capable(CAP_SYS_NICE))
+				return -EPERM;
+			rcu_read_lock();
+			tsk = find_task_by_pid_ns((pid_t)arg3, &init_pid_ns);
+			if (tsk == NULL) {
+				rcu_read_unlock();
+				return -EINVAL;
+			}
+			tsk->latency_sensitive = !!arg2;
+			rcu_read_unlock();
+			error = 0;
+			break;
+#endif
 		default:
 			error = -EINVAL;
 			break;
@@ -152,10 +152,13 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 	P(nr_events);
 	P(nr_retries);
 	P(nr_hangs);
+	P(nr_coalesced);
 	P_ns(max_hang_time);
 #endif
 #undef P
 #undef P_ns
+	SEQ_printf(m, "  .%-15s: %Lu\n", "wheel_coalesced",
+		   (unsigned long long)timer_wheel_coalesced(cpu));
 
 #ifdef CONFIG_TICK_ONESHOT
 # define P(x) \
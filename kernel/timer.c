@@ -78,6 +78,7 @@ struct tvec_base {
 	struct timer_list *running_timer;
 	unsigned long timer_jiffies;
 	unsigned long next_timer;
+	unsigned long nr_coalesced;
 	struct tvec_root tv1;
 	struct tvec tv2;
 	struct tvec tv3;
@@ -737,6 +738,8 @@ int mod_timer_pending(struct timer_list *timer, unsigned long expires)
 }
 EXPORT_SYMBOL(mod_timer_pending);
 
+static void process_timeout(unsigned long __data);
+
 /*
  * Decide where to put the timer while taking the slack into account
  *
@@ -755,11 +758,26 @@ unsigned long apply_slack(struct timer_list *timer, unsigned long expires)
 		expires_limit = expires + timer->slack;
 	} else {
 		long delta = expires - jiffies;
+		unsigned long slack = delta < 256 ? 0 : delta / 256;
 
-		if (delta < 256)
+		/*
+		 * A task sleeping in schedule_timeout() may also be held off
+		 * by its own timer slack, which is how the timers of a
+		 * background cgroup get coalesced.  Other timers a task
+		 * happens to arm, driver watchdogs and retransmits, keep
+		 * their deadline.  The default slack is well below a tick
+		 * and never gets here.
+		 */
+		if (timer->function == process_timeout &&
+		    timer->data == (unsigned long)current &&
+		    !rt_task(current) && current->timer_slack_ns >= TICK_NSEC)
+			slack = max(slack,
+				    nsecs_to_jiffies(current->timer_slack_ns));
+
+		if (!slack)
 			return expires;
 
-		expires_limit = expires + delta / 256;
+		expires_limit = expires + slack;
 	}
 	mask = expires ^ expires_limit;
 	if (mask == 0)
@@ -1098,6 +1116,7 @@ static inline void __run_timers(struct tvec_base *base)
 		struct list_head work_list;
 		struct list_head *head = &work_list;
 		int index = base->timer_jiffies & TVR_MASK;
+		int nr_timers = 0;
 
 		/*
 		 * Cascade timers:
@@ -1117,6 +1136,10 @@ static inline void __run_timers(struct tvec_base *base)
 			fn = timer->function;
 			data = timer->data;
 
+			/* a tick already taken for an earlier timer */
+			if (!tbase_get_deferrable(timer->base) && nr_timers++)
+				base->nr_coalesced++;
+
 			timer_stats_account_timer(timer);
 
 			base->running_timer = timer;
@@ -1131,6 +1154,16 @@ static inline void __run_timers(struct tvec_base *base)
 	spin_unlock_irq(&base->lock);
 }
 
+/*
+ * Number of timers on @cpu that expired in a tick which had already been
+ * taken for another timer, i.e. wakeups that slack alignment (or chance)
+ * saved.
+ */
+unsigned long timer_wheel_coalesced(int cpu)
+{
+	return per_cpu(tvec_bases, cpu)->nr_coalesced;
+}
+
 #ifdef CONFIG_NO_HZ
 /*
  * Find out when the next timer event is due to happen. This
@@ -725,6 +725,143 @@ update_max_tr_single(struct trace_array *tr, struct task_struct *tsk, int cpu)
 }
 #endif /* CONFIG_TRACER_MAX_TRACE */
 
+#ifdef CONFIG_TRACER_SNAPSHOT
+/*
+ * The snapshot borrows max_tr when no latency tracer needs it: it is
+ * grown to the size of the live buffer, and swapped with it as a whole,
+ * so that the trace goes on in what was the snapshot while the frozen
+ * copy is read out of the "snapshot" file.  Writers pick up
+ * global_trace.buffer on every event, so nothing stops for the swap.
+ *
+ * A snapshot is not taken while tracing is stopped or while it is
+ * being read, both of which hold iterators on the buffers.
+ */
+static bool snapshot_allocated;
+static int snapshot_readers;		/* protected by ftrace_max_lock */
+static atomic_t snapshot_armed = ATOMIC_INIT(0);
+static unsigned long snapshot_window_ms;
+static u64 snapshot_cutoff;
+
+/* drop what the snapshot holds from before its window */
+static void snapshot_trim(struct work_struct *work)
+{
+	u64 ts;
+	int cpu;
+
+	for_each_tracing_cpu(cpu) {
+		while (ring_buffer_peek(max_tr.buffer, cpu, &ts, NULL) &&
+		       ts < snapshot_cutoff)
+			ring_buffer_consume(max_tr.buffer, cpu, NULL, NULL);
+	}
+}
+
+static DECLARE_WORK(snapshot_trim_work, snapshot_trim);
+
+static int tracing_snapshot_swap(const char *why)
+{
+	struct ring_buffer *buf;
+	unsigned long flags;
+	u64 now, window;
+	int ret = 0;
+
+	local_irq_save(flags);
+	arch_spin_lock(&ftrace_max_lock);
+
+	if (trace_stop_count || snapshot_readers) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	/* the last entry of the snapshot says what took it */
+	trace_array_printk(&global_trace, _THIS_IP_, "snapshot: %s\n", why);
+	now = ring_buffer_time_stamp(global_trace.buffer, smp_processor_id());
+
+	buf = global_trace.buffer;
+	global_trace.buffer = max_tr.buffer;
+	max_tr.buffer = buf;
+	max_tr.time_start = now;
+ out:
+	arch_spin_unlock(&ftrace_max_lock);
+	local_irq_restore(flags);
+
+	if (!ret && snapshot_window_ms) {
+		window = (u64)snapshot_window_ms * NSEC_PER_MSEC;
+		snapshot_cutoff = now > window ? now - window : 0;
+		schedule_work(&snapshot_trim_work);
+	}
+	return ret;
+}
+
+/**
+ * tracing_snapshot_trigger - take the snapshot userspace armed
+ * @why: a word on the event, recorded as the last entry of the snapshot
+ *
+ * For the places where the kernel notices something userspace will want
+ * to see the run up to, such as a missed frame.  Does nothing unless
+ * "3" was written to the snapshot file, and disarms it: the snapshot
+ * keeps the first such event until it is read and armed again.
+ *
+ * Callable from any context.
+ */
+void tracing_snapshot_trigger(const char *why)
+{
+	unsigned long flags;
+
+	/* snapshot_free() waits for this irqs off section to finish */
+	local_irq_save(flags);
+	if (atomic_cmpxchg(&snapshot_armed, 1, 0) == 1)
+		tracing_snapshot_swap(why);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL_GPL(tracing_snapshot_trigger);
+
+/*
+ * Called with trace_types_lock held, which is also what keeps readers
+ * from coming and going.  Leaves max_tr to be resized by the caller.
+ */
+static int snapshot_free(void)
+{
+	if (snapshot_readers)
+		return -EBUSY;
+
+	atomic_set(&snapshot_armed, 0);
+	synchronize_sched();
+	flush_work(&snapshot_trim_work);
+	snapshot_allocated = false;
+	return 0;
+}
+
+static int snapshot_reader_get(void)
+{
+	if (current_trace->use_max_tr)
+		return -EBUSY;
+
+	local_irq_disable();
+	arch_spin_lock(&ftrace_max_lock);
+	snapshot_readers++;
+	arch_spin_unlock(&ftrace_max_lock);
+	local_irq_enable();
+
+	/* no swap can schedule it any more, let it finish */
+	flush_work(&snapshot_trim_work);
+	return 0;
+}
+
+static void snapshot_reader_put(void)
+{
+	local_irq_disable();
+	arch_spin_lock(&ftrace_max_lock);
+	snapshot_readers--;
+	arch_spin_unlock(&ftrace_max_lock);
+	local_irq_enable();
+}
+#else
+#define snapshot_allocated	false
+static inline int snapshot_free(void) { return 0; }
+static inline int snapshot_reader_get(void) { return -ENODEV; }
+static inline void snapshot_reader_put(void) { }
+#endif /* CONFIG_TRACER_SNAPSHOT */
+
 /**
  * register_tracer - register a tracer with the ftrace system.
  * @type - the plugin for the tracer
@@ -2122,7 +2259,7 @@ static const struct seq_operations tracer_seq_ops = {
 };
 
 static struct trace_iterator *
-__tracing_open(struct inode *inode, struct file *file)
+__tracing_open(struct inode *inode, struct file *file, bool snapshot)
 {
 	long cpu_file = (long) inode->i_private;
 	void *fail_ret = ERR_PTR(-ENOMEM);
@@ -2152,7 +2289,15 @@ __tracing_open(struct inode *inode, struct file *file)
 	if (!zalloc_cpumask_var(&iter->started, GFP_KERNEL))
 		goto fail;
 
-	if (current_trace && current_trace->print_max)
+	if (snapshot) {
+		ret = snapshot_reader_get();
+		if (ret) {
+			fail_ret = ERR_PTR(ret);
+			goto fail;
+		}
+		iter->tr = &max_tr;
+		iter->iter_flags |= TRACE_FILE_SNAPSHOT;
+	} else if (current_trace && current_trace->print_max)
 		iter->tr = &max_tr;
 	else
 		iter->tr = &global_trace;
@@ -2168,8 +2313,9 @@ __tracing_open(struct inode *inode, struct file *file)
 	if (ring_buffer_overruns(iter->tr->buffer))
 		iter->iter_flags |= TRACE_FILE_ANNOTATE;
 
-	/* stop the trace while dumping */
-	tracing_stop();
+	/* stop the trace while dumping, the snapshot is not written to */
+	if (!snapshot)
+		tracing_stop();
 
 	if (iter->cpu_file == TRACE_PIPE_ALL_CPU) {
 		for_each_tracing_cpu(cpu) {
@@ -2209,7 +2355,10 @@ __tracing_open(struct inode *inode, struct file *file)
 			ring_buffer_read_finish(iter->buffer_iter[cpu]);
 	}
 	free_cpumask_var(iter->started);
-	tracing_start();
+	if (snapshot)
+		snapshot_reader_put();
+	else
+		tracing_start();
  fail:
 	mutex_unlock(&trace_types_lock);
 	kfree(iter->trace);
@@ -2248,7 +2397,10 @@ static int tracing_release(struct inode *inode, struct file *file)
 		iter->trace->close(iter);
 
 	/* reenable tracing if it was previously enabled */
-	tracing_start();
+	if (iter->iter_flags & TRACE_FILE_SNAPSHOT)
+		snapshot_reader_put();
+	else
+		tracing_start();
 	mutex_unlock(&trace_types_lock);
 
 	seq_release(inode, file);
@@ -2276,7 +2428,7 @@ static int tracing_open(struct inode *inode, struct file *file)
 	}
 
 	if (file->f_mode & FMODE_READ) {
-		iter = __tracing_open(inode, file);
+		iter = __tracing_open(inode, file, false);
 		if (IS_ERR(iter))
 			ret = PTR_ERR(iter);
 		else if (trace_flags & TRACE_ITER_LATENCY_FMT)
@@ -2811,7 +2963,7 @@ static int tracing_resize_ring_buffer(unsigned long size)
 	if (ret < 0)
 		return ret;
 
-	if (!current_trace->use_max_tr)
+	if (!current_trace->use_max_tr && !snapshot_allocated)
 		goto out;
 
 	ret = ring_buffer_resize(max_tr.buffer, size);
@@ -2906,6 +3058,13 @@ static int tracing_set_tracer(const char *buf)
 	if (t == current_trace)
 		goto out;
 
+	/* the latency tracers take max_tr back from the snapshot */
+	if (t->use_max_tr && snapshot_allocated) {
+		ret = snapshot_free();
+		if (ret)
+			goto out;
+	}
+
 	trace_branch_disable();
 
 	current_trace->enabled = false;
@@ -3638,6 +3797,146 @@ static int tracing_clock_open(struct inode *inode, struct file *file)
 	return single_open(file, tracing_clock_show, NULL);
 }
 
+#ifdef CONFIG_TRACER_SNAPSHOT
+static int tracing_snapshot_open(struct inode *inode, struct file *file)
+{
+	struct trace_iterator *iter;
+	int ret = 0;
+
+	if (file->f_mode & FMODE_READ) {
+		iter = __tracing_open(inode, file, true);
+		if (IS_ERR(iter))
+			ret = PTR_ERR(iter);
+		else if (trace_flags & TRACE_ITER_LATENCY_FMT)
+			iter->iter_flags |= TRACE_FILE_LAT_FMT;
+	}
+	return ret;
+}
+
+/*
+ * 0 frees the snapshot, 1 takes one now, 2 clears it and 3 arms it for
+ * tracing_snapshot_trigger().  The first of 1 or 3 allocates it.
+ */
+static ssize_t
+tracing_snapshot_write(struct file *filp, const char __user *ubuf,
+		       size_t cnt, loff_t *ppos)
+{
+	char buf[64];
+	unsigned long val;
+	int ret;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(&buf, ubuf, cnt))
+		return -EFAULT;
+
+	buf[cnt] = 0;
+
+	ret = strict_strtoul(buf, 10, &val);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&trace_types_lock);
+
+	if (current_trace->use_max_tr) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	/* a previous snapshot may still be trimmed */
+	flush_work(&snapshot_trim_work);
+
+	switch (val) {
+	case 0:
+		if (!snapshot_allocated)
+			break;
+		ret = snapshot_free();
+		if (ret)
+			break;
+		ring_buffer_resize(max_tr.buffer, 1);
+		max_tr.entries = 1;
+		break;
+	case 1:
+	case 3:
+		if (!snapshot_allocated) {
+			if (snapshot_readers) {
+				ret = -EBUSY;
+				break;
+			}
+			ret = ring_buffer_resize(max_tr.buffer,
+						 global_trace.entries);
+			if (ret < 0)
+				break;
+			ret = 0;
+			max_tr.entries = global_trace.entries;
+			snapshot_allocated = true;
+		}
+		if (val == 1)
+			ret = tracing_snapshot_swap("user");
+		else
+			atomic_set(&snapshot_armed, 1);
+		break;
+	case 2:
+		if (snapshot_readers)
+			ret = -EBUSY;
+		else if (snapshot_allocated)
+			tracing_reset_online_cpus(&max_tr);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+ out:
+	mutex_unlock(&trace_types_lock);
+
+	if (ret < 0)
+		return ret;
+
+	*ppos += cnt;
+
+	return cnt;
+}
+
+static ssize_t
+tracing_snapshot_window_read(struct file *filp, char __user *ubuf,
+			     size_t cnt, loff_t *ppos)
+{
+	char buf[64];
+	int r;
+
+	r = snprintf(buf, sizeof(buf), "%lu\n", snapshot_window_ms);
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static ssize_t
+tracing_snapshot_window_write(struct file *filp, const char __user *ubuf,
+			      size_t cnt, loff_t *ppos)
+{
+	char buf[64];
+	unsigned long val;
+	int ret;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(&buf, ubuf, cnt))
+		return -EFAULT;
+
+	buf[cnt] = 0;
+
+	ret = strict_strtoul(buf, 10, &val);
+	if (ret < 0)
+		return ret;
+
+	/* 0 keeps all the snapshot holds */
+	snapshot_window_ms = val;
+
+	*ppos += cnt;
+
+	return cnt;
+}
+#endif /* CONFIG_TRACER_SNAPSHOT */
+
 static const struct file_operations tracing_max_lat_fops = {
 	.open		= tracing_open_generic,
 	.read		= tracing_max_lat_read,
@@ -3689,6 +3988,23 @@ static const struct file_operations trace_clock_fops = {
 	.write		= tracing_clock_write,
 };
 
+#ifdef CONFIG_TRACER_SNAPSHOT
+static const struct file_operations snapshot_fops = {
+	.open		= tracing_snapshot_open,
+	.read		= seq_read,
+	.write		= tracing_snapshot_write,
+	.llseek		= tracing_seek,
+	.release	= tracing_release,
+};
+
+static const struct file_operations snapshot_window_fops = {
+	.open		= tracing_open_generic,
+	.read		= tracing_snapshot_window_read,
+	.write		= tracing_snapshot_window_write,
+	.llseek		= generic_file_llseek,
+};
+#endif
+
 struct ftrace_buffer_info {
 	struct trace_array	*tr;
 	void			*spare;
@@ -4400,6 +4716,14 @@ static __init int tracer_init_debugfs(void)
 	trace_create_file("tracing_thresh", 0644, d_tracer,
 			&tracing_thresh, &tracing_max_lat_fops);
 
+#ifdef CONFIG_TRACER_SNAPSHOT
+	trace_create_file("snapshot", 0644, d_tracer,
+			(void *) TRACE_PIPE_ALL_CPU, &snapshot_fops);
+
+	trace_create_file("snapshot_window_ms", 0644, d_tracer,
+			NULL, &snapshot_window_fops);
+#endif
+
 	trace_create_file("README", 0444, d_tracer,
 			NULL, &tracing_readme_fops);
 
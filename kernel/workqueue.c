@@ -41,6 +41,9 @@
 #include <linux/debug_locks.h>
 #include <linux/lockdep.h>
 #include <linux/idr.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/log2_hist.h>
 
 #include "workqueue_sched.h"
 
@@ -91,6 +94,9 @@ enum {
 	 * all cpus.  Give -20.
 	 */
 	RESCUER_NICE_LEVEL	= -20,
+
+	/* lowest RT priority: above every fair task, below audio & irqs */
+	RT_WORKER_DFL_PRIO	= 1,
 };
 
 /*
@@ -116,6 +122,22 @@ enum {
 
 struct global_cwq;
 
+#ifdef CONFIG_WQ_LATENCY_STATS
+/* log2 histogram of the queue to execute latency, 1us buckets */
+#define WQ_LAT_HIST_BUCKETS	16
+
+/* queue to execute latency and execution time of a cwq's works, in ns */
+struct wq_latency_stats {
+	unsigned long		nr_works;
+	u64			wait_sum;
+	u64			wait_max;
+	work_func_t		wait_max_func;
+	u64			exec_max;
+	work_func_t		exec_max_func;
+	unsigned int		wait_hist[WQ_LAT_HIST_BUCKETS];
+};
+#endif
+
 /*
  * The poor guys doing the actual heavy lifting.  All on-duty workers
  * are either serving the manager role, on idle list or on busy hash.
@@ -184,6 +206,10 @@ struct cpu_workqueue_struct {
 	int			nr_active;	/* L: nr of active works */
 	int			max_active;	/* L: max active works */
 	struct list_head	delayed_works;	/* L: delayed works */
+	struct worker		*rt_worker;	/* I: WQ_RT worker */
+#ifdef CONFIG_WQ_LATENCY_STATS
+	struct wq_latency_stats	stats;		/* L: latency stats */
+#endif
 };
 
 /*
@@ -241,6 +267,7 @@ struct workqueue_struct {
 	struct worker		*rescuer;	/* I: rescue worker */
 
 	int			saved_max_active; /* W: saved cwq max_active */
+	int			rt_prio;	/* WQ_RT worker priority */
 	const char		*name;		/* I: workqueue name */
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map	lockdep_map;
@@ -253,12 +280,18 @@ struct workqueue_struct *system_nrt_wq __read_mostly;
 struct workqueue_struct *system_unbound_wq __read_mostly;
 struct workqueue_struct *system_freezable_wq __read_mostly;
 struct workqueue_struct *system_nrt_freezable_wq __read_mostly;
+struct workqueue_struct *system_rt_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_wq);
 EXPORT_SYMBOL_GPL(system_long_wq);
 EXPORT_SYMBOL_GPL(system_nrt_wq);
 EXPORT_SYMBOL_GPL(system_unbound_wq);
 EXPORT_SYMBOL_GPL(system_freezable_wq);
 EXPORT_SYMBOL_GPL(system_nrt_freezable_wq);
+EXPORT_SYMBOL_GPL(system_rt_wq);
+
+/* SCHED_FIFO priority WQ_RT workqueues start out with */
+static int wq_rt_prio = RT_WORKER_DFL_PRIO;
+module_param_named(rt_prio, wq_rt_prio, int, 0644);
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/workqueue.h>
@@ -876,7 +909,9 @@ static struct worker *find_worker_executing_work(struct global_cwq *gcwq,
  * @cwq: cwq a work is being queued for
  *
  * A work for @cwq is about to be queued on @gcwq, determine insertion
- * position for the work.  If @cwq is for HIGHPRI wq, the work is
+ * position for the work.  If @cwq is for an RT wq, the work goes to
+ * the tail of its RT worker's scheduled list and never reaches the
+ * shared worklist.  If @cwq is for HIGHPRI wq, the work is
  * queued at the head of the queue but in FIFO order with respect to
  * other HIGHPRI works; otherwise, at the end of the queue.  This
  * function also sets GCWQ_HIGHPRI_PENDING flag to hint @gcwq that
@@ -893,6 +928,9 @@ static inline struct list_head *gcwq_determine_ins_pos(struct global_cwq *gcwq,
 {
 	struct work_struct *twork;
 
+	if (unlikely(cwq->rt_worker))
+		return &cwq->rt_worker->scheduled;
+
 	if (likely(!(cwq->wq->flags & WQ_HIGHPRI)))
 		return &gcwq->worklist;
 
@@ -907,6 +945,57 @@ static inline struct list_head *gcwq_determine_ins_pos(struct global_cwq *gcwq,
 	return &twork->entry;
 }
 
+#ifdef CONFIG_WQ_LATENCY_STATS
+static inline void wq_stat_queued(struct work_struct *work)
+{
+	work->queued_at = local_clock();
+}
+
+/* @work is about to run, returns the time its execution starts at */
+static u64 wq_stat_wait(struct cpu_workqueue_struct *cwq,
+			struct work_struct *work)
+{
+	struct wq_latency_stats *stats = &cwq->stats;
+	u64 now = local_clock();
+	s64 wait = now - work->queued_at;
+
+	/* unbound works may run on another cpu than the one they came from */
+	if (wait < 0)
+		wait = 0;
+
+	stats->nr_works++;
+	stats->wait_sum += wait;
+	stats->wait_hist[log2_hist_bucket(div_u64(wait, NSEC_PER_USEC),
+					  WQ_LAT_HIST_BUCKETS)]++;
+	if (wait > stats->wait_max) {
+		stats->wait_max = wait;
+		stats->wait_max_func = work->func;
+	}
+	return now;
+}
+
+static void wq_stat_exec(struct cpu_workqueue_struct *cwq, work_func_t f,
+			 u64 start)
+{
+	struct wq_latency_stats *stats = &cwq->stats;
+	u64 exec = local_clock() - start;
+
+	if (exec > stats->exec_max) {
+		stats->exec_max = exec;
+		stats->exec_max_func = f;
+	}
+}
+#else
+static inline void wq_stat_queued(struct work_struct *work) { }
+static inline u64 wq_stat_wait(struct cpu_workqueue_struct *cwq,
+			       struct work_struct *work)
+{
+	return 0;
+}
+static inline void wq_stat_exec(struct cpu_workqueue_struct *cwq,
+				work_func_t f, u64 start) { }
+#endif
+
 /**
  * insert_work - insert a work into gcwq
  * @cwq: cwq @work belongs to
@@ -928,6 +1017,7 @@ static void insert_work(struct cpu_workqueue_struct *cwq,
 
 	/* we own @work, set data and link */
 	set_work_cwq(work, cwq, extra_flags);
+	wq_stat_queued(work);
 
 	/*
 	 * Ensure that we get the right work->data if we see the
@@ -944,7 +1034,9 @@ static void insert_work(struct cpu_workqueue_struct *cwq,
 	 */
 	smp_mb();
 
-	if (__need_more_worker(gcwq))
+	if (unlikely(cwq->rt_worker))
+		wake_up_process(cwq->rt_worker->task);
+	else if (__need_more_worker(gcwq))
 		wake_up_worker(gcwq);
 }
 
@@ -1811,6 +1903,7 @@ __acquires(&gcwq->lock)
 	work_func_t f = work->func;
 	int work_color;
 	struct worker *collision;
+	u64 start;
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -1840,6 +1933,8 @@ __acquires(&gcwq->lock)
 	worker->current_cwq = cwq;
 	work_color = get_work_color(work);
 
+	start = wq_stat_wait(cwq, work);
+
 	/* record the current cpu number in the work data and dequeue */
 	set_work_cpu(work, gcwq->cpu);
 	list_del_init(&work->entry);
@@ -1895,6 +1990,8 @@ __acquires(&gcwq->lock)
 
 	spin_lock_irq(&gcwq->lock);
 
+	wq_stat_exec(cwq, f, start);
+
 	/* clear cpu intensive status */
 	if (unlikely(cpu_intensive))
 		worker_clr_flags(worker, WORKER_CPU_INTENSIVE);
@@ -2092,6 +2189,38 @@ repeat:
 	goto repeat;
 }
 
+/**
+ * rt_worker_thread - the WQ_RT worker thread function
+ * @__worker: self
+ *
+ * Each cwq of a WQ_RT workqueue has a SCHED_FIFO worker of its own.
+ * Works are queued directly on its scheduled list, so they neither
+ * wait for the gcwq's concurrency management nor queue up behind the
+ * works of other workqueues.  Like the rescuer, the worker stays in
+ * WORKER_PREP and never takes part in concurrency management.  While
+ * its cpu is down it runs unbound.
+ */
+static int rt_worker_thread(void *__worker)
+{
+	struct worker *worker = __worker;
+	struct global_cwq *gcwq = worker->gcwq;
+
+	while (true) {
+		worker_maybe_bind_and_lock(worker);
+		process_scheduled_works(worker);
+
+		/* works are queued and we're woken up under gcwq->lock */
+		__set_current_state(TASK_INTERRUPTIBLE);
+		spin_unlock_irq(&gcwq->lock);
+
+		if (kthread_should_stop()) {
+			__set_current_state(TASK_RUNNING);
+			return 0;
+		}
+		schedule();
+	}
+}
+
 struct wq_barrier {
 	struct work_struct	work;
 	struct completion	done;
@@ -2911,6 +3040,58 @@ static int wq_clamp_max_active(int max_active, unsigned int flags,
 	return clamp_val(max_active, 1, lim);
 }
 
+static void destroy_rt_workers(struct workqueue_struct *wq)
+{
+	unsigned int cpu;
+
+	for_each_cwq_cpu(cpu, wq) {
+		struct cpu_workqueue_struct *cwq = get_cwq(cpu, wq);
+
+		if (!cwq->rt_worker)
+			continue;
+
+		kthread_stop(cwq->rt_worker->task);
+		kfree(cwq->rt_worker);
+		cwq->rt_worker = NULL;
+	}
+}
+
+static int create_rt_workers(struct workqueue_struct *wq)
+{
+	struct sched_param param = { .sched_priority = wq->rt_prio };
+	unsigned int cpu;
+
+	for_each_cwq_cpu(cpu, wq) {
+		struct cpu_workqueue_struct *cwq = get_cwq(cpu, wq);
+		struct worker *worker;
+
+		worker = alloc_worker();
+		if (!worker)
+			return -ENOMEM;
+
+		worker->gcwq = cwq->gcwq;
+		if (cpu == WORK_CPU_UNBOUND)
+			worker->task = kthread_create(rt_worker_thread, worker,
+						      "%s/u", wq->name);
+		else
+			worker->task = kthread_create(rt_worker_thread, worker,
+						      "%s/%u", wq->name, cpu);
+		if (IS_ERR(worker->task)) {
+			int ret = PTR_ERR(worker->task);
+
+			kfree(worker);
+			return ret;
+		}
+
+		worker->task->flags |= PF_THREAD_BOUND;
+		sched_setscheduler_nocheck(worker->task, SCHED_FIFO, &param);
+		cwq->rt_worker = worker;
+		wake_up_process(worker->task);
+	}
+
+	return 0;
+}
+
 struct workqueue_struct *__alloc_workqueue_key(const char *name,
 					       unsigned int flags,
 					       int max_active,
@@ -2943,6 +3124,7 @@ struct workqueue_struct *__alloc_workqueue_key(const char *name,
 
 	wq->flags = flags;
 	wq->saved_max_active = max_active;
+	wq->rt_prio = clamp(wq_rt_prio, 1, MAX_USER_RT_PRIO - 1);
 	mutex_init(&wq->flush_mutex);
 	atomic_set(&wq->nr_cwqs_to_flush, 0);
 	INIT_LIST_HEAD(&wq->flusher_queue);
@@ -2985,6 +3167,11 @@ struct workqueue_struct *__alloc_workqueue_key(const char *name,
 		wake_up_process(rescuer->task);
 	}
 
+	if (flags & WQ_RT && create_rt_workers(wq) < 0) {
+		destroy_rt_workers(wq);
+		goto err;
+	}
+
 	/*
 	 * workqueue_lock protects global freeze state and workqueues
 	 * list.  Grab it, set max_active accordingly and add the new
@@ -3073,6 +3260,9 @@ reflush:
 		BUG_ON(!list_empty(&cwq->delayed_works));
 	}
 
+	if (wq->flags & WQ_RT)
+		destroy_rt_workers(wq);
+
 	if (wq->flags & WQ_RESCUER) {
 		kthread_stop(wq->rescuer->task);
 		free_mayday_mask(wq->mayday_mask);
@@ -3120,6 +3310,33 @@ void workqueue_set_max_active(struct workqueue_struct *wq, int max_active)
 }
 EXPORT_SYMBOL_GPL(workqueue_set_max_active);
 
+/**
+ * workqueue_set_rt_prio - adjust the priority of a WQ_RT workqueue
+ * @wq: target workqueue
+ * @prio: new SCHED_FIFO priority of @wq's workers
+ *
+ * CONTEXT:
+ * Might sleep.
+ *
+ * RETURNS:
+ * 0 on success, -EINVAL if @wq isn't WQ_RT or @prio is out of range.
+ */
+int workqueue_set_rt_prio(struct workqueue_struct *wq, int prio)
+{
+	struct sched_param param = { .sched_priority = prio };
+	unsigned int cpu;
+
+	if (!(wq->flags & WQ_RT) || prio < 1 || prio >= MAX_USER_RT_PRIO)
+		return -EINVAL;
+
+	wq->rt_prio = prio;
+	for_each_cwq_cpu(cpu, wq)
+		sched_setscheduler_nocheck(get_cwq(cpu, wq)->rt_worker->task,
+					   SCHED_FIFO, &param);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(workqueue_set_rt_prio);
+
 /**
  * workqueue_congested - test whether a workqueue is congested
  * @cpu: CPU in question
@@ -3839,9 +4056,118 @@ static int __init init_workqueues(void)
 					      WQ_FREEZABLE, 0);
 	system_nrt_freezable_wq = alloc_workqueue("events_nrt_freezable",
 			WQ_NON_REENTRANT | WQ_FREEZABLE, 0);
+	system_rt_wq = alloc_workqueue("events_rt", WQ_RT, 0);
 	BUG_ON(!system_wq || !system_long_wq || !system_nrt_wq ||
 	       !system_unbound_wq || !system_freezable_wq ||
-		!system_nrt_freezable_wq);
+		!system_nrt_freezable_wq || !system_rt_wq);
 	return 0;
 }
 early_initcall(init_workqueues);
+
+#ifdef CONFIG_WQ_LATENCY_STATS
+/*
+ * /proc/workqueue_latency: per workqueue, the number of works run, their
+ * average and worst queue to execute latency and the longest execution,
+ * with the functions the worst cases were seen for, then the histogram
+ * of the latency.  A write clears it.
+ */
+static int wq_latency_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	unsigned int cpu;
+	int i;
+
+	seq_printf(m, "# name works avg_wait_us max_wait_us func "
+		   "max_exec_us func wait_us");
+	for (i = 0; i < WQ_LAT_HIST_BUCKETS; i++)
+		seq_printf(m, " %s%llu",
+			   i < WQ_LAT_HIST_BUCKETS - 1 ? "<" : ">=",
+			   log2_hist_bound(i, WQ_LAT_HIST_BUCKETS));
+	seq_printf(m, "\n");
+
+	spin_lock(&workqueue_lock);
+	list_for_each_entry(wq, &workqueues, list) {
+		struct wq_latency_stats sum = { };
+
+		for_each_cwq_cpu(cpu, wq) {
+			struct cpu_workqueue_struct *cwq = get_cwq(cpu, wq);
+			struct wq_latency_stats *stats = &cwq->stats;
+
+			spin_lock_irq(&cwq->gcwq->lock);
+			sum.nr_works += stats->nr_works;
+			sum.wait_sum += stats->wait_sum;
+			if (stats->wait_max > sum.wait_max) {
+				sum.wait_max = stats->wait_max;
+				sum.wait_max_func = stats->wait_max_func;
+			}
+			if (stats->exec_max > sum.exec_max) {
+				sum.exec_max = stats->exec_max;
+				sum.exec_max_func = stats->exec_max_func;
+			}
+			for (i = 0; i < WQ_LAT_HIST_BUCKETS; i++)
+				sum.wait_hist[i] += stats->wait_hist[i];
+			spin_unlock_irq(&cwq->gcwq->lock);
+		}
+
+		if (!sum.nr_works)
+			continue;
+
+		seq_printf(m, "%s %lu %llu %llu %pf %llu %pf", wq->name,
+			   sum.nr_works,
+			   div_u64(div_u64(sum.wait_sum, sum.nr_works),
+				   NSEC_PER_USEC),
+			   div_u64(sum.wait_max, NSEC_PER_USEC),
+			   sum.wait_max_func,
+			   div_u64(sum.exec_max, NSEC_PER_USEC),
+			   sum.exec_max_func);
+		for (i = 0; i < WQ_LAT_HIST_BUCKETS; i++)
+			seq_printf(m, " %u", sum.wait_hist[i]);
+		seq_printf(m, "\n");
+	}
+	spin_unlock(&workqueue_lock);
+
+	return 0;
+}
+
+static ssize_t wq_latency_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct workqueue_struct *wq;
+	unsigned int cpu;
+
+	spin_lock(&workqueue_lock);
+	list_for_each_entry(wq, &workqueues, list) {
+		for_each_cwq_cpu(cpu, wq) {
+			struct cpu_workqueue_struct *cwq = get_cwq(cpu, wq);
+
+			spin_lock_irq(&cwq->gcwq->lock);
+			memset(&cwq->stats, 0, sizeof(cwq->stats));
+			spin_unlock_irq(&cwq->gcwq->lock);
+		}
+	}
+	spin_unlock(&workqueue_lock);
+
+	return count;
+}
+
+static int wq_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_latency_show, NULL);
+}
+
+static const struct file_operations wq_latency_fops = {
+	.open		= wq_latency_open,
+	.read		= seq_read,
+	.write		= wq_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_latency_init(void)
+{
+	proc_create("workqueue_latency", S_IRUGO | S_IWUSR, NULL,
+		    &wq_latency_fops);
+	return 0;
+}
+module_init(wq_latency_init);
+#endif /* CONFIG_WQ_LATENCY_STATS */
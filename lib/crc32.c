@@ -52,19 +52,28 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 {
 # ifdef __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[0][(crc ^ (x)) & 255] ^ (crc >> 8)
-#  define DO_CRC4 crc = tab[3][(crc) & 255] ^ \
-		tab[2][(crc >> 8) & 255] ^ \
-		tab[1][(crc >> 16) & 255] ^ \
-		tab[0][(crc >> 24) & 255]
+#  define DO_CRC4(q) (tab[3][(q) & 255] ^ \
+		tab[2][((q) >> 8) & 255] ^ \
+		tab[1][((q) >> 16) & 255] ^ \
+		tab[0][((q) >> 24) & 255])
+#  define DO_CRC8(q) (tab[7][(q) & 255] ^ \
+		tab[6][((q) >> 8) & 255] ^ \
+		tab[5][((q) >> 16) & 255] ^ \
+		tab[4][((q) >> 24) & 255])
 # else
 #  define DO_CRC(x) crc = tab[0][((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
-#  define DO_CRC4 crc = tab[0][(crc) & 255] ^ \
-		tab[1][(crc >> 8) & 255] ^ \
-		tab[2][(crc >> 16) & 255] ^ \
-		tab[3][(crc >> 24) & 255]
+#  define DO_CRC4(q) (tab[0][(q) & 255] ^ \
+		tab[1][((q) >> 8) & 255] ^ \
+		tab[2][((q) >> 16) & 255] ^ \
+		tab[3][((q) >> 24) & 255])
+#  define DO_CRC8(q) (tab[4][(q) & 255] ^ \
+		tab[5][((q) >> 8) & 255] ^ \
+		tab[6][((q) >> 16) & 255] ^ \
+		tab[7][((q) >> 24) & 255])
 # endif
 	const u32 *b;
 	size_t    rem_len;
+	u32       q;
 
 	/* Align it */
 	if (unlikely((long)buf & 3 && len)) {
@@ -72,13 +81,18 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 			DO_CRC(*buf++);
 		} while ((--len) && ((long)buf)&3);
 	}
-	rem_len = len & 3;
-	/* load data 32 bits wide, xor data 32 bits wide. */
-	len = len >> 2;
+	rem_len = len & 7;
+	/*
+	 * Slice by 8: load data 64 bits wide as two words, and look up
+	 * all eight bytes at once, the first word xored with the crc.
+	 */
+	len = len >> 3;
 	b = (const u32 *)buf;
 	for (--b; len; --len) {
-		crc ^= *++b; /* use pre increment for speed */
-		DO_CRC4;
+		q = crc ^ *++b; /* use pre increment for speed */
+		crc = DO_CRC8(q);
+		q = *++b;
+		crc ^= DO_CRC4(q);
 	}
 	len = rem_len;
 	/* And the last few bytes */
@@ -91,6 +105,7 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 	return crc;
 #undef DO_CRC
 #undef DO_CRC4
+#undef DO_CRC8
 }
 #endif
 /**
@@ -6,7 +6,8 @@
 #define CRCPOLY_LE 0xedb88320
 #define CRCPOLY_BE 0x04c11db7
 
-/* How many bits at a time to use.  Requires a table of 4<<CRC_xx_BITS bytes. */
+/* How many bits at a time to use.  Requires a table of 4<<CRC_xx_BITS bytes,
+ * times eight for the slice-by-8 loop when it is 8. */
 /* For less performance-sensitive, use 4 */
 #ifndef CRC_LE_BITS 
 # define CRC_LE_BITS 8
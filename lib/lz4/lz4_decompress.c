@@ -43,7 +43,39 @@
 #include <linux/lz4.h>
 #include <asm/unaligned.h>
 #include "lz4defs.h"
-static int lz4_uncompress(const char *source, char *dest, int osize)
+#if LZ4_NEON
+#include <asm/neon.h>
+#include <asm/simd.h>
+static bool lz4_use_neon = true;
+module_param_named(neon, lz4_use_neon, bool, 0644);
+MODULE_PARM_DESC(neon, "Use NEON for long copies when the CPU has it");
+/*
+* Kernel mode NEON runs with preemption disabled, which is fine for the
+* page and block sized buffers this is used on.
+*/
+static inline bool lz4_neon_begin(void)
+{
+if (!lz4_use_neon || !cpu_has_neon() || !may_use_simd())
+return false;
+kernel_neon_begin();
+return true;
+}
+static inline void lz4_neon_end(bool neon)
+{
+if (neon)
+kernel_neon_end();
+}
+#else
+static inline bool lz4_neon_begin(void)
+{
+return false;
+}
+static inline void lz4_neon_end(bool neon)
+{
+}
+#endif
+static int lz4_uncompress(const char *source, char *dest, int osize,
+bool neon)
 {
 const BYTE *ip = (const BYTE *) source;
 const BYTE *ref;
@@ -81,6 +113,7 @@ memcpy(op, ip, length);
 ip += length;
 break; /* EOF */
 }
+LZ4_NEONCOPY(ip, op, length, neon);
 LZ4_WILDCOPY(ip, op, cpy);
 ip -= (op - cpy);
 op = cpy;
@@ -134,6 +167,8 @@ if (op == oend)
 goto _output_error;
 continue;
 }
+if (op - ref >= 16)
+LZ4_NEONCOPY(ref, op, cpy - op, neon);
 LZ4_SECURECOPY(ref, op, cpy);
 op = cpy; /* correction */
 }
@@ -144,7 +179,7 @@ _output_error:
 return (int) (-(((char *)ip) - source));
 }
 static int lz4_uncompress_unknownoutputsize(const char *source, char *dest,
-int isize, size_t maxoutputsize)
+int isize, size_t maxoutputsize, bool neon)
 {
 const BYTE *ip = (const BYTE *) source;
 const BYTE *const iend = ip + isize;
@@ -186,6 +221,7 @@ memcpy(op, ip, length);
 op += length;
 break;/* Necessarily EOF, due to parsing restrictions */
 }
+LZ4_NEONCOPY(ip, op, length, neon);
 LZ4_WILDCOPY(ip, op, cpy);
 ip -= (op - cpy);
 op = cpy;
@@ -245,6 +281,8 @@ if (op == oend)
 goto _output_error;
 continue;
 }
+if (op - ref >= 16)
+LZ4_NEONCOPY(ref, op, cpy - op, neon);
 LZ4_SECURECOPY(ref, op, cpy);
 op = cpy; /* correction */
 }
@@ -259,7 +297,9 @@ size_t actual_dest_len)
 {
 int ret = -1;
 int input_len = 0;
-input_len = lz4_uncompress(src, dest, actual_dest_len);
+bool neon = lz4_neon_begin();
+input_len = lz4_uncompress(src, dest, actual_dest_len, neon);
+lz4_neon_end(neon);
 if (input_len < 0)
 goto exit_0;
 *src_len = input_len;
@@ -274,8 +314,10 @@ int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,un
 {
 int ret = -1;
 int out_len = 0;
+bool neon = lz4_neon_begin();
 out_len = lz4_uncompress_unknownoutputsize(src, dest, src_len,
-*dest_len);
+*dest_len, neon);
+lz4_neon_end(neon);
 if (out_len < 0)
 goto exit_0;
 *dest_len = out_len;
@@ -155,3 +155,30 @@ typedef struct _U64_S { u64 v; } U64_S;
  LZ4_WILDCOPY(s, d, e); \
  d = e; \
  } while (0)
+
+/*
+* NEON wild copy, 16 bytes at a time, for the decompressor: long
+* literal runs and matches at least 16 bytes back are moved with it
+* and whatever is left over is finished by LZ4_WILDCOPY as before, so
+* the bounds checks and the overrun they allow for are unchanged.
+*/
+#if defined(CONFIG_ARM) && defined(CONFIG_KERNEL_MODE_NEON) && \
+	!defined(STATIC)
+#define LZ4_NEON 1
+#define NEONCOPYLENGTH 32
+
+asmlinkage void lz4_copy_neon(u8 *dst, const u8 *src, size_t len);
+
+#define LZ4_NEONCOPY(s, d, l, neon) \
+ do { \
+ if ((neon) && (l) >= NEONCOPYLENGTH) { \
+ size_t n = (l) & ~15; \
+ lz4_copy_neon(d, s, n); \
+ d += n; \
+ s += n; \
+ } \
+ } while (0)
+#else
+#define LZ4_NEON 0
+#define LZ4_NEONCOPY(s, d, l, neon) do { } while (0)
+#endif
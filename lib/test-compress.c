@@ -0,0 +1,402 @@
+/*
+ * Compression benchmark for choosing a zram or zcache backend
+ *
+ * Samples resident anonymous pages from the running tasks, which is what
+ * zram and zcache end up compressing, and runs every compressor in the
+ * tree over them, printing the compression ratio and the compress and
+ * decompress throughput of one CPU:
+ *
+ *	modprobe test-compress pages=1024 sec=2 [alg=lz4]
+ *
+ * Like tcrypt, the module fails to load on purpose once it is done.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/highmem.h>
+#include <linux/hrtimer.h>
+#include <linux/jiffies.h>
+#include <linux/lz4.h>
+#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <asm/pgtable.h>
+
+#if defined(CONFIG_SNAPPY_COMPRESS) || defined(CONFIG_SNAPPY_COMPRESS_MODULE)
+#if defined(CONFIG_SNAPPY_DECOMPRESS) || \
+	defined(CONFIG_SNAPPY_DECOMPRESS_MODULE)
+#define TCOMP_SNAPPY
+#include "../drivers/staging/snappy/csnappy.h"
+#endif
+#endif
+
+static unsigned int pages = 512;
+static unsigned int sec = 1;
+static unsigned int stride = 8;
+static char *alg;
+
+/* room for what any of the compressors may make of one page */
+#define TCOMP_BOUND	(PAGE_SIZE + PAGE_SIZE / 4 + 64)
+#define TCOMP_MAX_TASKS	512
+
+struct tcomp_alg {
+	const char *name;
+	size_t wrkmem_size;
+	int (*compress)(const u8 *src, u8 *dst, size_t *dst_len, void *wrkmem);
+	int (*decompress)(const u8 *src, size_t src_len, u8 *dst);
+};
+
+static int tcomp_lzo_compress(const u8 *src, u8 *dst, size_t *dst_len,
+			      void *wrkmem)
+{
+	return lzo1x_1_compress(src, PAGE_SIZE, dst, dst_len, wrkmem);
+}
+
+static int tcomp_lzo_decompress(const u8 *src, size_t src_len, u8 *dst)
+{
+	size_t len = PAGE_SIZE;
+	int ret;
+
+	ret = lzo1x_decompress_safe(src, src_len, dst, &len);
+	return ret || len != PAGE_SIZE ? -EINVAL : 0;
+}
+
+static int tcomp_lz4_compress(const u8 *src, u8 *dst, size_t *dst_len,
+			      void *wrkmem)
+{
+	return lz4_compress(src, PAGE_SIZE, dst, dst_len, wrkmem);
+}
+
+static int tcomp_lz4hc_compress(const u8 *src, u8 *dst, size_t *dst_len,
+				void *wrkmem)
+{
+	return lz4hc_compress(src, PAGE_SIZE, dst, dst_len, wrkmem);
+}
+
+/* the same call zram makes, knowing the page size */
+static int tcomp_lz4_decompress(const u8 *src, size_t src_len, u8 *dst)
+{
+	size_t len = src_len;
+
+	return lz4_decompress(src, &len, dst, PAGE_SIZE);
+}
+
+#ifdef TCOMP_SNAPPY
+static int tcomp_snappy_compress(const u8 *src, u8 *dst, size_t *dst_len,
+				 void *wrkmem)
+{
+	uint32_t len;
+
+	csnappy_compress((const char *)src, PAGE_SIZE, (char *)dst, &len,
+			 wrkmem, CSNAPPY_WORKMEM_BYTES_POWER_OF_TWO);
+	*dst_len = len;
+	return 0;
+}
+
+static int tcomp_snappy_decompress(const u8 *src, size_t src_len, u8 *dst)
+{
+	return csnappy_decompress((const char *)src, src_len, (char *)dst,
+				  PAGE_SIZE) == CSNAPPY_E_OK ? 0 : -EINVAL;
+}
+#endif
+
+static const struct tcomp_alg tcomp_algs[] = {
+	{ "lzo", LZO1X_1_MEM_COMPRESS,
+	  tcomp_lzo_compress, tcomp_lzo_decompress },
+	{ "lz4", LZ4_MEM_COMPRESS,
+	  tcomp_lz4_compress, tcomp_lz4_decompress },
+	{ "lz4hc", LZ4HC_MEM_COMPRESS,
+	  tcomp_lz4hc_compress, tcomp_lz4_decompress },
+#ifdef TCOMP_SNAPPY
+	{ "snappy", CSNAPPY_WORKMEM_BYTES,
+	  tcomp_snappy_compress, tcomp_snappy_decompress },
+#endif
+};
+
+struct tcomp_corpus {
+	u8 *data;
+	unsigned int nr;
+	unsigned int tasks;
+	unsigned int zero;
+};
+
+static bool tcomp_page_is_zero(const u8 *p)
+{
+	const unsigned long *w = (const unsigned long *)p;
+	unsigned int i;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(*w); i++)
+		if (w[i])
+			return false;
+	return true;
+}
+
+/*
+ * Copy @addr of @mm into the corpus if it is a resident anonymous page,
+ * walking the page tables rather than faulting so that nothing is
+ * swapped in or allocated for the sake of the measurement.
+ */
+static void tcomp_sample(struct tcomp_corpus *c, struct mm_struct *mm,
+			 unsigned long addr)
+{
+	struct page *page = NULL;
+	spinlock_t *ptl;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *pte;
+	void *va;
+
+	pgd = pgd_offset(mm, addr);
+	if (pgd_none(*pgd) || pgd_bad(*pgd))
+		return;
+	pud = pud_offset(pgd, addr);
+	if (pud_none(*pud) || pud_bad(*pud))
+		return;
+	pmd = pmd_offset(pud, addr);
+	if (pmd_none(*pmd) || pmd_bad(*pmd))
+		return;
+
+	pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	if (pte_present(*pte) && pfn_valid(pte_pfn(*pte))) {
+		page = pte_page(*pte);
+		if (!PageAnon(page) || !get_page_unless_zero(page))
+			page = NULL;
+	}
+	pte_unmap_unlock(pte, ptl);
+	if (!page)
+		return;
+
+	va = kmap_atomic(page, KM_USER0);
+	memcpy(c->data + c->nr * PAGE_SIZE, va, PAGE_SIZE);
+	kunmap_atomic(va, KM_USER0);
+	put_page(page);
+
+	/* zram stores these without compressing them */
+	if (tcomp_page_is_zero(c->data + c->nr * PAGE_SIZE))
+		c->zero++;
+	else
+		c->nr++;
+}
+
+static void tcomp_sample_mm(struct tcomp_corpus *c, struct mm_struct *mm,
+			    unsigned int quota)
+{
+	unsigned int want = min(c->nr + quota, pages);
+	struct vm_area_struct *vma;
+	unsigned long addr;
+
+	down_read(&mm->mmap_sem);
+	for (vma = mm->mmap; vma && c->nr < want; vma = vma->vm_next) {
+		if (!vma->anon_vma || vma->vm_file ||
+		    (vma->vm_flags & (VM_IO | VM_PFNMAP)))
+			continue;
+		for (addr = vma->vm_start; addr < vma->vm_end && c->nr < want;
+		     addr += stride * PAGE_SIZE)
+			tcomp_sample(c, mm, addr);
+	}
+	up_read(&mm->mmap_sem);
+}
+
+/* spread the corpus over as many tasks as there are */
+static int tcomp_build_corpus(struct tcomp_corpus *c)
+{
+	struct task_struct **tasks, *p;
+	unsigned int i, n = 0, quota;
+	struct mm_struct *mm;
+
+	tasks = kcalloc(TCOMP_MAX_TASKS, sizeof(*tasks), GFP_KERNEL);
+	if (!tasks)
+		return -ENOMEM;
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (n == TCOMP_MAX_TASKS)
+			break;
+		if (p->flags & PF_KTHREAD)
+			continue;
+		get_task_struct(p);
+		tasks[n++] = p;
+	}
+	rcu_read_unlock();
+
+	quota = n ? DIV_ROUND_UP(pages, n) : 0;
+	for (i = 0; i < n; i++) {
+		mm = get_task_mm(tasks[i]);
+		if (mm) {
+			unsigned int before = c->nr;
+
+			tcomp_sample_mm(c, mm, quota);
+			if (c->nr != before)
+				c->tasks++;
+			mmput(mm);
+		}
+		put_task_struct(tasks[i]);
+		cond_resched();
+	}
+
+	kfree(tasks);
+	return c->nr ? 0 : -ENODATA;
+}
+
+static u64 tcomp_mbps(u64 bytes, s64 ns)
+{
+	return ns > 0 ? div64_u64(bytes * 1000, ns) : 0;
+}
+
+static int tcomp_run(const struct tcomp_alg *a, struct tcomp_corpus *c,
+		     u8 *comp, size_t *comp_len, u8 *out)
+{
+	u64 orig_bytes = 0, comp_bytes = 0, bytes;
+	unsigned int i, big = 0, ratio;
+	unsigned long end;
+	void *wrkmem;
+	ktime_t start;
+	u64 cmbps, dmbps;
+	int ret = 0;
+
+	wrkmem = vmalloc(a->wrkmem_size);
+	if (!wrkmem)
+		return -ENOMEM;
+
+	/* one pass for the ratio and the output the decompressor gets */
+	for (i = 0; i < c->nr; i++) {
+		ret = a->compress(c->data + i * PAGE_SIZE, comp + i * TCOMP_BOUND,
+				  &comp_len[i], wrkmem);
+		if (ret || comp_len[i] > TCOMP_BOUND) {
+			pr_err("test-compress: %s: compression failed (%d)\n",
+			       a->name, ret);
+			ret = -EINVAL;
+			goto out;
+		}
+		orig_bytes += PAGE_SIZE;
+		comp_bytes += comp_len[i];
+		/* past zram's max_zpage_size, stored as they are */
+		if (comp_len[i] > PAGE_SIZE / 4 * 3)
+			big++;
+
+		ret = a->decompress(comp + i * TCOMP_BOUND, comp_len[i], out);
+		if (ret || memcmp(out, c->data + i * PAGE_SIZE, PAGE_SIZE)) {
+			pr_err("test-compress: %s: page %u does not survive "
+			       "the round trip (%d)\n", a->name, i, ret);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	bytes = 0;
+	start = ktime_get();
+	end = jiffies + sec * HZ;
+	do {
+		for (i = 0; i < c->nr; i++) {
+			a->compress(c->data + i * PAGE_SIZE,
+				    comp + i * TCOMP_BOUND, &comp_len[i], wrkmem);
+			cond_resched();
+		}
+		bytes += (u64)c->nr * PAGE_SIZE;
+	} while (time_before(jiffies, end));
+	cmbps = tcomp_mbps(bytes, ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	bytes = 0;
+	start = ktime_get();
+	end = jiffies + sec * HZ;
+	do {
+		for (i = 0; i < c->nr; i++) {
+			a->decompress(comp + i * TCOMP_BOUND, comp_len[i], out);
+			cond_resched();
+		}
+		bytes += (u64)c->nr * PAGE_SIZE;
+	} while (time_before(jiffies, end));
+	dmbps = tcomp_mbps(bytes, ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	ratio = div64_u64(orig_bytes * 100, comp_bytes);
+	pr_info("test-compress: %-6s ratio %u.%02u, %3u%% incompressible, "
+		"compress %4llu MB/s, decompress %4llu MB/s\n", a->name,
+		ratio / 100, ratio % 100, big * 100 / c->nr, cmbps, dmbps);
+out:
+	vfree(wrkmem);
+	return ret;
+}
+
+static int __init tcomp_mod_init(void)
+{
+	struct tcomp_corpus c;
+	size_t *comp_len = NULL;
+	u8 *comp = NULL, *out = NULL;
+	unsigned int i, ran = 0;
+	int err = -ENOMEM;
+
+	if (!pages || !stride)
+		return -EINVAL;
+
+	memset(&c, 0, sizeof(c));
+	c.data = vmalloc(pages * PAGE_SIZE);
+	comp = vmalloc(pages * TCOMP_BOUND);
+	comp_len = vmalloc(pages * sizeof(*comp_len));
+	out = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!c.data || !comp || !comp_len || !out)
+		goto out;
+
+	err = tcomp_build_corpus(&c);
+	if (err) {
+		pr_err("test-compress: no anonymous pages to sample\n");
+		goto out;
+	}
+	pr_info("test-compress: %u anonymous pages from %u tasks "
+		"(%u zero pages left out)\n", c.nr, c.tasks, c.zero);
+
+	for (i = 0; i < ARRAY_SIZE(tcomp_algs); i++) {
+		if (alg && strcmp(alg, tcomp_algs[i].name))
+			continue;
+		err = tcomp_run(&tcomp_algs[i], &c, comp, comp_len, out);
+		if (err)
+			goto out;
+		ran++;
+	}
+	if (!ran) {
+		pr_err("test-compress: unknown algorithm %s\n", alg);
+		err = -ENOENT;
+		goto out;
+	}
+
+	/* We intentionally return -EAGAIN to prevent keeping the module,
+	 * just as tcrypt does.
+	 */
+	err = -EAGAIN;
+out:
+	kfree(out);
+	vfree(comp_len);
+	vfree(comp);
+	vfree(c.data);
+	return err;
+}
+
+/*
+ * If an init function is provided, an exit function must also be provided
+ * to allow module unload.
+ */
+static void __exit tcomp_mod_fini(void) { }
+
+module_init(tcomp_mod_init);
+module_exit(tcomp_mod_fini);
+
+module_param(pages, uint, 0);
+MODULE_PARM_DESC(pages, "Anonymous pages to sample for the corpus");
+module_param(sec, uint, 0);
+MODULE_PARM_DESC(sec, "Seconds to spend compressing and decompressing");
+module_param(stride, uint, 0);
+MODULE_PARM_DESC(stride, "Sample every stride-th page of a mapping");
+module_param(alg, charp, 0);
+MODULE_PARM_DESC(alg, "Only run this compressor (lzo, lz4, lz4hc, snappy)");
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Compressor benchmark over live anonymous pages");
@@ -0,0 +1,222 @@
+/*
+ * Self-test and benchmark for the LZ4 decompressor
+ *
+ * A few pages resembling what zram and squashfs hand to the decompressor
+ * are compressed, decompressed through both entry points and compared
+ * with the original, then decompressed in a loop to report MB/s.  Load
+ * it again after flipping /sys/module/lz4_decompress/parameters/neon to
+ * compare against the plain ARM copies.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/lz4.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+static unsigned int iterations = 2000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Decompressions of each page to time");
+
+static const char *const lz4_test_names[] = {
+	"mostly zero", "text", "pointers", "short periods", "random",
+};
+
+#define LZ4_TEST_PAGES	ARRAY_SIZE(lz4_test_names)
+
+struct lz4_test_page {
+	u8 *orig;
+	u8 *comp;
+	u8 *out;
+	size_t comp_len;
+};
+
+static void __init lz4_test_fill(u8 *p, unsigned int kind)
+{
+	struct rnd_state rnd;
+	unsigned int i, n;
+	u32 *w = (u32 *)p;
+
+	prandom32_seed(&rnd, kind + 1);
+
+	switch (kind) {
+	case 0:
+		/* a freshly touched page: zero but for a few fields */
+		memset(p, 0, PAGE_SIZE);
+		for (i = 0; i < 16; i++)
+			w[prandom32(&rnd) % (PAGE_SIZE / 4)] = prandom32(&rnd);
+		break;
+	case 1:
+		/* log or config text */
+		for (i = 0; i < PAGE_SIZE; i += n)
+			n = scnprintf(p + i, PAGE_SIZE - i,
+				      "<6>[%5u.%06u] wlan0: rx %u tx %u\n",
+				      i / 64, prandom32(&rnd) % 1000000,
+				      prandom32(&rnd) % 4096, i);
+		break;
+	case 2:
+		/* an array of small structures full of kernel pointers */
+		for (i = 0; i < PAGE_SIZE / 4; i += 4) {
+			w[i] = 0xc0800000 + (prandom32(&rnd) & 0xfffc0);
+			w[i + 1] = w[i] + 0x40;
+			w[i + 2] = i;
+			w[i + 3] = prandom32(&rnd) & 0x3;
+		}
+		break;
+	case 3:
+		/* runs repeating with every period from 1 to 40, which
+		 * exercise the overlapping match copies */
+		for (i = 0, n = 1; i < PAGE_SIZE; n = n % 40 + 1) {
+			unsigned int j, end = min_t(unsigned int, i + 96,
+						    PAGE_SIZE);
+
+			for (j = 0; j < n && i + j < end; j++)
+				p[i + j] = prandom32(&rnd);
+			for (j = i + n; j < end; j++)
+				p[j] = p[j - n];
+			i = end;
+		}
+		break;
+	default:
+		for (i = 0; i < PAGE_SIZE / 4; i++)
+			w[i] = prandom32(&rnd);
+		break;
+	}
+}
+
+static bool __init lz4_test_overrun(const u8 *p)
+{
+	unsigned int i;
+
+	for (i = 0; i < PAGE_SIZE; i++)
+		if (p[i] != 0x5a)
+			return true;
+	return false;
+}
+
+static int __init lz4_test_check(struct lz4_test_page *t, const char *name)
+{
+	size_t len = t->comp_len, out_len = PAGE_SIZE;
+	int ret;
+
+	memset(t->out, 0xa5, PAGE_SIZE);
+	ret = lz4_decompress(t->comp, &len, t->out, PAGE_SIZE);
+	if (ret || len != t->comp_len || memcmp(t->orig, t->out, PAGE_SIZE)) {
+		pr_err("lz4 test: %s: lz4_decompress() mismatch (%d)\n",
+		       name, ret);
+		return -EINVAL;
+	}
+
+	memset(t->out, 0xa5, PAGE_SIZE);
+	ret = lz4_decompress_unknownoutputsize(t->comp, t->comp_len, t->out,
+					       &out_len);
+	if (ret || out_len != PAGE_SIZE ||
+	    memcmp(t->orig, t->out, PAGE_SIZE)) {
+		pr_err("lz4 test: %s: lz4_decompress_unknownoutputsize() "
+		       "mismatch (%d)\n", name, ret);
+		return -EINVAL;
+	}
+
+	/* a truncated stream must be refused, not overrun the buffer */
+	out_len = PAGE_SIZE;
+	if (t->comp_len > 16 &&
+	    !lz4_decompress_unknownoutputsize(t->comp, t->comp_len / 2,
+					      t->out, &out_len) &&
+	    out_len == PAGE_SIZE) {
+		pr_err("lz4 test: %s: truncated input accepted\n", name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void __init lz4_test_bench(struct lz4_test_page *t, const char *name)
+{
+	unsigned int i;
+	ktime_t start;
+	s64 ns;
+	size_t len;
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		len = t->comp_len;
+		lz4_decompress(t->comp, &len, t->out, PAGE_SIZE);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (ns <= 0)
+		ns = 1;
+
+	pr_info("lz4 test: %-13s %4zu -> %lu bytes, %llu MB/s\n", name,
+		t->comp_len, PAGE_SIZE,
+		div64_u64((u64)iterations * PAGE_SIZE * 1000, ns));
+}
+
+static int __init test_lz4_init(void)
+{
+	struct lz4_test_page pages[LZ4_TEST_PAGES];
+	void *wrkmem;
+	unsigned int i;
+	int ret = -ENOMEM;
+
+	memset(pages, 0, sizeof(pages));
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!wrkmem)
+		return -ENOMEM;
+
+	for (i = 0; i < LZ4_TEST_PAGES; i++) {
+		struct lz4_test_page *t = &pages[i];
+
+		t->orig = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		t->comp = kmalloc(LZ4_COMPRESSBOUND(PAGE_SIZE), GFP_KERNEL);
+		/* room past the end for an overrun to be noticed */
+		t->out = kmalloc(2 * PAGE_SIZE, GFP_KERNEL);
+		if (!t->orig || !t->comp || !t->out)
+			goto out;
+
+		lz4_test_fill(t->orig, i);
+		ret = lz4_compress(t->orig, PAGE_SIZE, t->comp, &t->comp_len,
+				   wrkmem);
+		if (ret) {
+			pr_err("lz4 test: %s: compression failed (%d)\n",
+			       lz4_test_names[i], ret);
+			goto out;
+		}
+
+		memset(t->out + PAGE_SIZE, 0x5a, PAGE_SIZE);
+		ret = lz4_test_check(t, lz4_test_names[i]);
+		if (ret)
+			goto out;
+		if (lz4_test_overrun(t->out + PAGE_SIZE)) {
+			pr_err("lz4 test: %s: wrote past the output buffer\n",
+			       lz4_test_names[i]);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < LZ4_TEST_PAGES; i++)
+		lz4_test_bench(&pages[i], lz4_test_names[i]);
+
+	pr_info("lz4 test: passed\n");
+	ret = -EAGAIN;	/* nothing to keep loaded */
+out:
+	for (i = 0; i < LZ4_TEST_PAGES; i++) {
+		kfree(pages[i].orig);
+		kfree(pages[i].comp);
+		kfree(pages[i].out);
+	}
+	vfree(wrkmem);
+	return ret;
+}
+module_init(test_lz4_init);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 decompressor self-test and benchmark");
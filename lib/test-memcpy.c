@@ -0,0 +1,103 @@
+/*
+ * memcpy() and copy_page() throughput
+ *
+ * Prints MB/s for a range of copy sizes, within the caches and streamed
+ * through a buffer larger than them, for comparing architecture copy
+ * routines; on ARM, load it again after writing 0 to
+ * /sys/module/copy_neon/parameters/enable to see the ldm/stm figures.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+static unsigned int msec = 200;
+module_param(msec, uint, 0444);
+MODULE_PARM_DESC(msec, "Milliseconds to spend on each measurement");
+
+/* larger than any L2 this is likely to run on */
+#define TMEMCPY_COLD	(4 << 20)
+
+static const unsigned int tmemcpy_sizes[] = {
+	64, 256, 512, 1024, 2048, 4096, 16384, 65536,
+};
+
+/*
+ * Copy @size bytes at a time, walking through @span bytes of @src and
+ * @dst so that a @span beyond the caches measures memory, until @msec
+ * have passed.  Returns MB/s.
+ */
+static u64 __init tmemcpy_run(u8 *dst, u8 *src, size_t span,
+			      size_t size, bool page)
+{
+	s64 limit = (s64)msec * NSEC_PER_MSEC, ns;
+	u64 bytes = 0;
+	ktime_t start;
+	size_t off;
+
+	start = ktime_get();
+	do {
+		for (off = 0; off + size <= span; off += size) {
+			if (page)
+				copy_page(dst + off, src + off);
+			else
+				memcpy(dst + off, src + off, size);
+		}
+		bytes += span - span % size;
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		cond_resched();
+	} while (ns < limit);
+
+	return div64_u64(bytes * 1000, ns);
+}
+
+static int __init test_memcpy_init(void)
+{
+	unsigned int i;
+	u8 *src, *dst;
+
+	src = vmalloc(TMEMCPY_COLD);
+	dst = vmalloc(TMEMCPY_COLD);
+	if (!src || !dst) {
+		vfree(src);
+		vfree(dst);
+		return -ENOMEM;
+	}
+	memset(src, 0x5a, TMEMCPY_COLD);
+	memset(dst, 0, TMEMCPY_COLD);
+
+	pr_info("test-memcpy: %8s %10s %10s\n", "bytes", "hot MB/s",
+		"cold MB/s");
+	for (i = 0; i < ARRAY_SIZE(tmemcpy_sizes); i++) {
+		size_t size = tmemcpy_sizes[i];
+
+		pr_info("test-memcpy: %8zu %10llu %10llu\n", size,
+			tmemcpy_run(dst, src, max_t(size_t, size, 16384),
+				    size, false),
+			tmemcpy_run(dst, src, TMEMCPY_COLD, size, false));
+	}
+	/* one byte off, for the unaligned source paths */
+	pr_info("test-memcpy: %8s %10llu %10llu\n", "4096+1",
+		tmemcpy_run(dst, src + 1, 16384, PAGE_SIZE, false),
+		tmemcpy_run(dst, src + 1, TMEMCPY_COLD - 1, PAGE_SIZE, false));
+	pr_info("test-memcpy: %8s %10llu %10llu\n", "page",
+		tmemcpy_run(dst, src, 16384, PAGE_SIZE, true),
+		tmemcpy_run(dst, src, TMEMCPY_COLD, PAGE_SIZE, true));
+
+	vfree(src);
+	vfree(dst);
+	return -EAGAIN;	/* nothing to keep loaded */
+}
+module_init(test_memcpy_init);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("memcpy() and copy_page() throughput");
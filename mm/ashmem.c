@@ -27,6 +27,8 @@
 #include <linux/personality.h>
 #include <linux/bitops.h>
 #include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/jiffies.h>
 #include <linux/shmem_fs.h>
 #include <linux/ashmem.h>
 
@@ -46,6 +48,7 @@ struct ashmem_area {
 	struct file *file;		/* the shmem-based backing file */
 	size_t size;			/* size of the mapping, in bytes */
 	unsigned long prot_mask;	/* allowed prot bits, as vm_flags */
+	int purging;			/* ranges being truncated unlocked */
 };
 
 /*
@@ -60,6 +63,7 @@ struct ashmem_range {
 	size_t pgstart;			/* starting page, inclusive */
 	size_t pgend;			/* ending page, inclusive */
 	unsigned int purged;		/* ASHMEM_NOT or ASHMEM_WAS_PURGED */
+	unsigned long unpinned_at;	/* jiffies when it was unpinned */
 };
 
 /* LRU list of unpinned pages, protected by ashmem_mutex */
@@ -75,6 +79,12 @@ static unsigned long lru_count;
  */
 static DEFINE_MUTEX(ashmem_mutex);
 
+/* pin, unpin and release wait here for an area's purges to finish */
+static DECLARE_WAIT_QUEUE_HEAD(ashmem_purge_wait);
+
+/* number of LRU ranges, oldest first, the shrinker picks its victim from */
+#define ASHMEM_PURGE_WINDOW	8
+
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
 
@@ -122,12 +132,13 @@ static inline void lru_del(struct ashmem_range *range)
  * 'purged' - initial purge value (ASMEM_NOT_PURGED or ASHMEM_WAS_PURGED)
  * 'start' - starting page, inclusive
  * 'end' - ending page, inclusive
+ * 'unpinned_at' - jiffies when the pages were unpinned
  *
  * Caller must hold ashmem_mutex.
  */
 static int range_alloc(struct ashmem_area *asma,
 		       struct ashmem_range *prev_range, unsigned int purged,
-		       size_t start, size_t end)
+		       size_t start, size_t end, unsigned long unpinned_at)
 {
 	struct ashmem_range *range;
 
@@ -139,6 +150,7 @@ static int range_alloc(struct ashmem_area *asma,
 	range->pgstart = start;
 	range->pgend = end;
 	range->purged = purged;
+	range->unpinned_at = unpinned_at;
 
 	list_add_tail(&range->unpinned, &prev_range->unpinned);
 
@@ -173,6 +185,20 @@ static inline void range_shrink(struct ashmem_range *range,
 		lru_count -= pre - range_size(range);
 }
 
+/*
+ * ashmem_wait_purge - wait until the shrinker is done truncating asma
+ *
+ * Caller must hold ashmem_mutex, which is dropped while waiting.
+ */
+static void ashmem_wait_purge(struct ashmem_area *asma)
+{
+	while (asma->purging) {
+		mutex_unlock(&ashmem_mutex);
+		wait_event(ashmem_purge_wait, !asma->purging);
+		mutex_lock(&ashmem_mutex);
+	}
+}
+
 static int ashmem_open(struct inode *inode, struct file *file)
 {
 	struct ashmem_area *asma;
@@ -200,6 +226,7 @@ static int ashmem_release(struct inode *ignored, struct file *file)
 	struct ashmem_range *range, *next;
 
 	mutex_lock(&ashmem_mutex);
+	ashmem_wait_purge(asma);
 	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
 		range_del(range);
 	mutex_unlock(&ashmem_mutex);
@@ -350,13 +377,34 @@ out:
  * Return value is the number of objects (pages) remaining, or -1 if we cannot
  * proceed without risk of deadlock (due to gfp_mask).
  *
- * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
- * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
- * pages freed.
+ * We approximate LRU via least-recently-unpinned.  Each round picks, among the
+ * ASHMEM_PURGE_WINDOW oldest unpinned ranges, the one with the largest
+ * size * age, marks it purged and truncates it with ashmem_mutex dropped, so
+ * other ashmem users only wait for the truncation if they pin or unpin in the
+ * area being purged.  Rounds continue until we hit 'nr_to_scan' pages freed.
  */
+static struct ashmem_range *lru_pick(void)
+{
+	struct ashmem_range *range, *best = NULL;
+	unsigned long now = jiffies;
+	u64 score, best_score = 0;
+	int n = 0;
+
+	list_for_each_entry(range, &ashmem_lru_list, lru) {
+		score = (u64)range_size(range) * (now - range->unpinned_at + 1);
+		if (score > best_score) {
+			best = range;
+			best_score = score;
+		}
+		if (++n == ASHMEM_PURGE_WINDOW)
+			break;
+	}
+	return best;
+}
+
 static int ashmem_shrink(struct shrinker *s, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (sc->nr_to_scan && !(sc->gfp_mask & __GFP_FS))
@@ -365,18 +413,23 @@ static int ashmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		return lru_count;
 
 	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		struct inode *inode = range->asma->file->f_dentry->d_inode;
+	while (sc->nr_to_scan > 0 && (range = lru_pick())) {
+		struct ashmem_area *asma = range->asma;
+		struct inode *inode = asma->file->f_dentry->d_inode;
 		loff_t start = range->pgstart * PAGE_SIZE;
 		loff_t end = (range->pgend + 1) * PAGE_SIZE - 1;
 
-		vmtruncate_range(inode, start, end);
 		range->purged = ASHMEM_WAS_PURGED;
 		lru_del(range);
-
 		sc->nr_to_scan -= range_size(range);
-		if (sc->nr_to_scan <= 0)
-			break;
+
+		/* asma (and its file) outlive this, see ashmem_wait_purge */
+		asma->purging++;
+		mutex_unlock(&ashmem_mutex);
+		vmtruncate_range(inode, start, end);
+		mutex_lock(&ashmem_mutex);
+		if (!--asma->purging)
+			wake_up_all(&ashmem_purge_wait);
 	}
 	mutex_unlock(&ashmem_mutex);
 
@@ -516,7 +569,7 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 			 * second half and adjust the first chunk's endpoint.
 			 */
 			range_alloc(asma, range, range->purged,
-				    pgend + 1, range->pgend);
+				    pgend + 1, range->pgend, range->unpinned_at);
 			range_shrink(range, range->pgstart, pgstart - 1);
 			break;
 		}
@@ -556,7 +609,7 @@ restart:
 		}
 	}
 
-	return range_alloc(asma, range, purged, pgstart, pgend);
+	return range_alloc(asma, range, purged, pgstart, pgend, jiffies);
 }
 
 /*
@@ -614,6 +667,10 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 
 	mutex_lock(&ashmem_mutex);
 
+	/* a range being purged must be gone before it can change state */
+	if (cmd != ASHMEM_GET_PIN_STATUS)
+		ashmem_wait_purge(asma);
+
 	switch (cmd) {
 	case ASHMEM_PIN:
 		ret = ashmem_pin(asma, pgstart, pgend);
@@ -654,6 +654,15 @@ int bdi_init(struct backing_dev_info *bdi)
 	}
 
 	bdi->dirty_exceeded = 0;
+
+	bdi->ra_max_pages = 0;
+	bdi->ra_window = 0;
+	bdi->read_bandwidth = 0;
+	bdi->ra_bw_bytes = 0;
+	bdi->ra_bw_ns = 0;
+	bdi->ra_last_hit = 0;
+	bdi->ra_last_miss = 0;
+
 	err = prop_local_init_percpu(&bdi->completions);
 
 	if (err) {
@@ -14,6 +14,9 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/module.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -38,6 +41,8 @@ struct compact_control {
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
+
+	unsigned long target;		/* free order blocks kcompactd wants */
 };
 
 static unsigned long release_freepages(struct list_head *freelist)
@@ -447,6 +452,17 @@ static void update_nr_listpages(struct compact_control *cc)
 	cc->nr_freepages = nr_freepages;
 }
 
+/* free blocks of @order the zone could hand out, counting larger ones */
+static unsigned long zone_free_blocks(struct zone *zone, unsigned int order)
+{
+	unsigned long blocks = 0;
+	unsigned int o;
+
+	for (o = order; o < MAX_ORDER; o++)
+		blocks += zone->free_area[o].nr_free << (o - order);
+	return blocks;
+}
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -460,6 +476,14 @@ static int compact_finished(struct zone *zone,
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
 
+	/* kcompactd: stop as soon as the zone has its reserve of blocks */
+	if (cc->target) {
+		if (zone_free_blocks(zone, cc->order) >= cc->target ||
+		    kthread_should_stop())
+			return COMPACT_PARTIAL;
+		return COMPACT_CONTINUE;
+	}
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -545,6 +569,10 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	ret = compaction_suitable(zone, cc->order);
 	switch (ret) {
 	case COMPACT_PARTIAL:
+		/* one free page is not the reserve kcompactd is after */
+		if (cc->target)
+			break;
+		/* fall through */
 	case COMPACT_SKIPPED:
 		/* Compaction is likely to fail */
 		return ret;
@@ -646,6 +674,7 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 	int may_perform_io = gfp_mask & __GFP_IO;
 	struct zoneref *z;
 	struct zone *zone;
+	unsigned long start;
 	int rc = COMPACT_SKIPPED;
 
 	/*
@@ -657,6 +686,7 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 		return rc;
 
 	count_vm_event(COMPACTSTALL);
+	start = jiffies;
 
 	/* Compact each zone in the list */
 	for_each_zone_zonelist_nodemask(zone, z, zonelist, high_zoneidx,
@@ -671,6 +701,7 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 			break;
 	}
 
+	count_vm_events(COMPACTSTALLMS, jiffies_to_msecs(jiffies - start));
 	return rc;
 }
 
@@ -722,6 +753,120 @@ static void compact_nodes(void)
 		compact_node(nid);
 }
 
+/*
+ * kcompactd keeps a reserve of free blocks of compact_proactive_order in
+ * every zone, so that the drivers needing physically contiguous buffers
+ * (camera, display, wifi) rarely have to compact from their allocation.
+ * It is woken when an allocation of a higher order than 0 enters the
+ * slow path and when kswapd has balanced the node, and compacts the zones
+ * that are short of compact_proactive_blocks until they are not.  A zone
+ * it fails on is deferred the same way direct compaction defers it.
+ */
+int sysctl_compact_proactive_order = 4;
+int sysctl_compact_proactive_blocks = 16;
+
+static DECLARE_WAIT_QUEUE_HEAD(kcompactd_wait);
+static struct task_struct *kcompactd_task;
+static bool kcompactd_wakeup;
+
+static bool kcompactd_zone_needed(struct zone *zone)
+{
+	int order = sysctl_compact_proactive_order;
+
+	if (!populated_zone(zone) || !sysctl_compact_proactive_blocks)
+		return false;
+	return zone_free_blocks(zone, order) <
+			(unsigned long)sysctl_compact_proactive_blocks;
+}
+
+static void kcompactd_do_work(void)
+{
+	struct zone *zone;
+
+	for_each_zone(zone) {
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = sysctl_compact_proactive_order,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+			.sync = true,
+			.target = sysctl_compact_proactive_blocks,
+		};
+
+		if (kthread_should_stop())
+			return;
+		if (!kcompactd_zone_needed(zone) || compaction_deferred(zone))
+			continue;
+		if (compaction_suitable(zone, cc.order) == COMPACT_SKIPPED)
+			continue;
+
+		count_vm_event(KCOMPACTD_WAKE);
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		lru_add_drain();
+
+		compact_zone(zone, &cc);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+
+		/* migration frees to the pcp lists, merge what it freed */
+		drain_local_pages(NULL);
+
+		if (kcompactd_zone_needed(zone)) {
+			count_vm_event(KCOMPACTD_FAIL);
+			defer_compaction(zone);
+		} else {
+			count_vm_event(KCOMPACTD_SUCCESS);
+			zone->compact_considered = 0;
+			zone->compact_defer_shift = 0;
+		}
+		cond_resched();
+	}
+}
+
+static int kcompactd(void *unused)
+{
+	set_freezable();
+	set_user_nice(current, 10);
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(kcompactd_wait,
+				     kcompactd_wakeup || kthread_should_stop());
+		kcompactd_wakeup = false;
+		kcompactd_do_work();
+	}
+	return 0;
+}
+
+/**
+ * wakeup_kcompactd - have kcompactd check the reserve of free blocks
+ *
+ * Cheap enough for the allocator slow path: kcompactd only runs again
+ * if it has gone back to sleep since it was last woken.
+ */
+void wakeup_kcompactd(void)
+{
+	if (!sysctl_compact_proactive_blocks ||
+	    !waitqueue_active(&kcompactd_wait))
+		return;
+	kcompactd_wakeup = true;
+	wake_up_interruptible(&kcompactd_wait);
+}
+
+static int __init kcompactd_init(void)
+{
+	kcompactd_task = kthread_run(kcompactd, NULL, "kcompactd");
+	if (IS_ERR(kcompactd_task)) {
+		printk(KERN_ERR "Failed to start kcompactd\n");
+		kcompactd_task = NULL;
+		return -ENOMEM;
+	}
+	return 0;
+}
+module_init(kcompactd_init);
+
 /* The written value is actually unused, all memory is compacted */
 int sysctl_compact_memory;
 
@@ -500,15 +500,74 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page)) {
 			lru_cache_add_anon(page);
+		} else if (workingset_refault(mapping, offset)) {
+			/* evicted too soon to tell it was in use, keep it */
+			workingset_activation(page);
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+		} else {
+			lru_cache_add_file(page);
+		}
 	}
 	return ret;
 }
 EXPORT_SYMBOL_GPL(add_to_page_cache_lru);
 
+/**
+ * add_stolen_page_to_page_cache - insert a page stolen from a pipe
+ * @page:	the page, locked, and referenced by nobody but the caller
+ * @mapping:	the address_space to insert it into
+ * @offset:	page index
+ *
+ * The page comes from a pipe buffer's ->steal(): it may have been taken
+ * out of another file's page cache, be a page gifted with vmsplice() and
+ * since unmapped by its owner, or a pipe's own buffer.  Its whole content
+ * must be the data of @mapping at @offset, it is marked uptodate.  Pages
+ * still known to swap, mlocked or with private data are refused, and so
+ * are swap backed mappings.  The page stays locked on return.
+ */
+int add_stolen_page_to_page_cache(struct page *page,
+				  struct address_space *mapping, pgoff_t offset)
+{
+	int error;
+
+	VM_BUG_ON(!PageLocked(page));
+
+	if (mapping_cap_swap_backed(mapping))
+		return -EINVAL;
+	if (page_mapped(page) || PageSwapCache(page) || PageMlocked(page) ||
+	    PageUnevictable(page) || page_has_private(page))
+		return -EBUSY;
+
+	/* anonymous memory is on the anon lru, the page cache wants file */
+	if (PageSwapBacked(page)) {
+		if (PageLRU(page)) {
+			if (isolate_lru_page(page))
+				return -EBUSY;
+			put_page(page);
+		}
+		ClearPageActive(page);
+		ClearPageSwapBacked(page);
+		page->mapping = NULL;
+	}
+
+	ClearPageDirty(page);
+	ClearPageError(page);
+	ClearPageMappedToDisk(page);
+	SetPageUptodate(page);
+
+	error = add_to_page_cache_locked(page, mapping, offset, GFP_KERNEL);
+	if (error)
+		return error;
+	if (!PageLRU(page)) {
+		ClearPageActive(page);
+		lru_cache_add_file(page);
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(add_stolen_page_to_page_cache);
+
 #ifdef CONFIG_NUMA
 struct page *__page_cache_alloc(gfp_t gfp)
 {
@@ -1741,8 +1800,79 @@ page_not_uptodate:
 }
 EXPORT_SYMBOL(filemap_fault);
 
+/**
+ * filemap_map_pages - map the cached pages around a read fault
+ * @vma:	vma in which the fault was taken
+ * @vmf:	struct vm_fault, with the locked pte table of the window
+ *
+ * Maps those pages from @vmf->pgoff to @vmf->max_pgoff that are in the
+ * page cache, uptodate, and can be locked without sleeping, and whose
+ * pte is still empty.  Pages waiting on readahead are left to
+ * filemap_fault(), for it to start the next readahead window.
+ */
+void filemap_map_pages(struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	struct file *file = vma->vm_file;
+	struct address_space *mapping = file->f_mapping;
+	struct file_ra_state *ra = &file->f_ra;
+	struct page *pages[PAGEVEC_SIZE];
+	pgoff_t index = vmf->pgoff;
+	unsigned long address;
+	unsigned int i, nr;
+	pgoff_t size;
+	pte_t *pte;
+
+	while (index <= vmf->max_pgoff) {
+		nr = find_get_pages(mapping, index,
+				min_t(pgoff_t, PAGEVEC_SIZE,
+				      vmf->max_pgoff - index + 1), pages);
+		if (!nr)
+			break;
+
+		for (i = 0; i < nr; i++) {
+			struct page *page = pages[i];
+
+			index = page->index + 1;
+			if (page->index > vmf->max_pgoff)
+				goto skip;
+			if (!PageUptodate(page) || PageReadahead(page) ||
+			    PageHWPoison(page))
+				goto skip;
+			if (!trylock_page(page))
+				goto skip;
+			if (page->mapping != mapping || !PageUptodate(page))
+				goto unlock;
+
+			size = (i_size_read(mapping->host) + PAGE_CACHE_SIZE - 1)
+				>> PAGE_CACHE_SHIFT;
+			if (page->index >= size)
+				goto unlock;
+
+			pte = vmf->pte + page->index - vmf->pgoff;
+			if (!pte_none(*pte))
+				goto unlock;
+
+			if (ra->mmap_miss > 0)
+				ra->mmap_miss--;
+			address = (unsigned long)vmf->virtual_address +
+				((page->index - vmf->pgoff) << PAGE_SHIFT);
+			/* the pte takes over the page cache reference */
+			do_set_pte(vma, address, page, pte);
+			unlock_page(page);
+			vmf->mapped++;
+			continue;
+unlock:
+			unlock_page(page);
+skip:
+			page_cache_release(page);
+		}
+	}
+}
+EXPORT_SYMBOL(filemap_map_pages);
+
 const struct vm_operations_struct generic_file_vm_ops = {
 	.fault		= filemap_fault,
+	.map_pages	= filemap_map_pages,
 };
 
 /* This is used for a general mmap of a disk file */
@@ -38,6 +38,8 @@
 #include <linux/freezer.h>
 #include <linux/oom.h>
 #include <linux/numa.h>
+#include <linux/math64.h>
+#include <linux/earlysuspend.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -228,6 +230,34 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer = true;
 
+/*
+ * With ksm_thread_adaptive set, ksmd scans up to 8 times as many pages per
+ * batch while batches keep merging at least one page in KSM_MERGE_YIELD,
+ * and sleeps up to 8 times as long after full scans that merged nothing,
+ * or while the screen is off.  ksm_scan_level is the log2 of the speedup,
+ * negative for a slowdown.
+ */
+#define KSM_SCAN_LEVELS		3
+#define KSM_MERGE_YIELD		32
+
+static unsigned int ksm_thread_adaptive = 1;
+static int ksm_scan_level;
+static unsigned long ksm_scan_pass_merged;
+static bool ksm_screen_off;
+
+/* Pages merged and cpu time ksmd spent, for cpu_usecs_per_merge */
+static unsigned long ksm_pages_merged;
+static u64 ksm_scan_cpu_ns;
+
+/* Whether to map pages of zeroes to the zero page, bypassing the trees */
+static unsigned int ksm_use_zero_pages = 1;
+
+/* The number of pages mapped to the zero page so far */
+static unsigned long ksm_zero_pages_merged;
+
+/* Checksum of a page full of zeroes */
+static u32 zero_checksum __read_mostly;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -837,13 +867,26 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * The checksum only tells whether a page changed since the last scan, so
+ * a hash of one word out of every 64 bytes is enough and costs a fraction
+ * of one over the whole page.  A page whose changes it misses ends up in
+ * the unstable tree, where memcmp_pages() still keeps it from merging
+ * with anything that is not identical.
+ */
+#define KSM_CHECKSUM_STRIDE	(64 / sizeof(u32))
+#define KSM_CHECKSUM_WORDS	(PAGE_SIZE / 64)
+
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
-	void *addr = kmap_atomic(page);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	u32 sample[KSM_CHECKSUM_WORDS];
+	u32 *addr = kmap_atomic(page);
+	int i;
+
+	for (i = 0; i < KSM_CHECKSUM_WORDS; i++)
+		sample[i] = addr[i * KSM_CHECKSUM_STRIDE];
 	kunmap_atomic(addr);
-	return checksum;
+	return jhash2(sample, KSM_CHECKSUM_WORDS, 17);
 }
 
 static int memcmp_pages(struct page *page1, struct page *page2)
@@ -937,6 +980,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	int err = -EFAULT;
@@ -964,12 +1008,21 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	/* the zero page is mapped like do_anonymous_page() does it */
+	if (kpage != ZERO_PAGE(addr)) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		/* zap will not find the zero page to uncount it */
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -1114,6 +1167,39 @@ out:
 	return err;
 }
 
+/*
+ * try_to_merge_zero_page - map a page full of zeroes to the zero page,
+ * which a write to it will then copy on as for any other zero page.
+ *
+ * This function returns 0 if the page was replaced, -EFAULT otherwise.
+ */
+static int try_to_merge_zero_page(struct rmap_item *rmap_item,
+				  struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address)
+		goto out;
+	/* the zero page is never mlocked */
+	if (vma->vm_flags & VM_LOCKED)
+		goto out;
+
+	err = try_to_merge_one_page(vma, page, ZERO_PAGE(rmap_item->address));
+	if (!err) {
+		ksm_zero_pages_merged++;
+		ksm_pages_merged++;
+	}
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * try_to_merge_two_pages - take two identical pages and prepare them
  * to be merged into one page.
@@ -1407,6 +1493,7 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_sharing++;
 	else
 		ksm_pages_shared++;
+	ksm_pages_merged++;
 }
 
 /*
@@ -1425,6 +1512,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	struct stable_node *stable_node;
 	struct page *kpage;
 	unsigned int checksum;
+	bool checksummed = false;
 	int err;
 
 	stable_node = page_stable_node(page);
@@ -1441,6 +1529,21 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			return;
 	}
 
+	/*
+	 * A page that stayed all zeroes since the last scan is mapped to
+	 * the zero page rather than merged with others through the trees.
+	 */
+	if (!stable_node && ksm_use_zero_pages) {
+		checksum = calc_checksum(page);
+		checksummed = true;
+		if (checksum == zero_checksum &&
+		    rmap_item->oldchecksum == checksum) {
+			remove_rmap_item_from_tree(rmap_item);
+			if (!try_to_merge_zero_page(rmap_item, page))
+				return;
+		}
+	}
+
 	/* We first start with searching the page inside the stable tree */
 	kpage = stable_tree_search(page);
 	if (kpage == page && rmap_item->head == stable_node) {
@@ -1471,7 +1574,8 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
+	if (!checksummed)
+		checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -1716,6 +1820,61 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/*
+ * Adjust ksm_scan_level after a batch of @scanned pages that merged
+ * @merged of them and, if @full_scan, ended a scan of all mergeable areas.
+ */
+static void ksm_adapt_scan(unsigned int scanned, unsigned long merged,
+			   bool full_scan)
+{
+	if (!ksm_thread_adaptive) {
+		ksm_scan_level = 0;
+		return;
+	}
+	if (ksm_screen_off) {
+		ksm_scan_level = -KSM_SCAN_LEVELS;
+		return;
+	}
+
+	ksm_scan_pass_merged += merged;
+	if (merged && merged * KSM_MERGE_YIELD >= scanned) {
+		if (ksm_scan_level < 0)
+			ksm_scan_level = 0;
+		else if (ksm_scan_level < KSM_SCAN_LEVELS)
+			ksm_scan_level++;
+	} else if (!merged && ksm_scan_level > 0) {
+		ksm_scan_level--;
+	}
+
+	if (full_scan) {
+		if (!ksm_scan_pass_merged) {
+			if (ksm_scan_level > -KSM_SCAN_LEVELS)
+				ksm_scan_level--;
+		} else if (ksm_scan_level < 0) {
+			ksm_scan_level++;
+		}
+		ksm_scan_pass_merged = 0;
+	}
+}
+
+static unsigned int ksm_scan_pages(void)
+{
+	u64 pages = ksm_thread_pages_to_scan;
+
+	if (ksm_scan_level > 0)
+		pages <<= ksm_scan_level;
+	return min_t(u64, pages, UINT_MAX);
+}
+
+static unsigned int ksm_scan_sleep_millisecs(void)
+{
+	u64 msecs = ksm_thread_sleep_millisecs;
+
+	if (ksm_scan_level < 0)
+		msecs <<= -ksm_scan_level;
+	return min_t(u64, msecs, UINT_MAX);
+}
+
 static int ksm_scan_thread(void *nothing)
 {
 	set_freezable();
@@ -1724,15 +1883,24 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run()) {
+			unsigned int scan_npages = ksm_scan_pages();
+			unsigned long merged = ksm_pages_merged;
+			unsigned long seqnr = ksm_scan.seqnr;
+			u64 start = task_sched_runtime(current);
+
+			ksm_do_scan(scan_npages);
+			ksm_scan_cpu_ns += task_sched_runtime(current) - start;
+			ksm_adapt_scan(scan_npages, ksm_pages_merged - merged,
+				       ksm_scan.seqnr != seqnr);
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
 			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(ksm_scan_sleep_millisecs()));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -2244,6 +2412,52 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t adaptive_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_adaptive);
+}
+
+static ssize_t adaptive_store(struct kobject *kobj,
+			      struct kobj_attribute *attr,
+			      const char *buf, size_t count)
+{
+	unsigned long adaptive;
+	int err;
+
+	err = strict_strtoul(buf, 10, &adaptive);
+	if (err || adaptive > 1)
+		return -EINVAL;
+
+	ksm_thread_adaptive = adaptive;
+
+	return count;
+}
+KSM_ATTR(adaptive);
+
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = value;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -2367,6 +2581,13 @@ static ssize_t pages_sharing_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_sharing);
 
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
 static ssize_t pages_unshared_show(struct kobject *kobj,
 				   struct kobj_attribute *attr, char *buf)
 {
@@ -2398,15 +2619,34 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t cpu_usecs_per_merge_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	u64 ns = 0;
+
+	mutex_lock(&ksm_thread_mutex);
+	if (ksm_pages_merged)
+		ns = div64_u64(ksm_scan_cpu_ns, ksm_pages_merged);
+	mutex_unlock(&ksm_thread_mutex);
+
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)div_u64(ns, NSEC_PER_USEC));
+}
+KSM_ATTR_RO(cpu_usecs_per_merge);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&adaptive_attr.attr,
+	&use_zero_pages_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
+	&zero_pages_merged_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&cpu_usecs_per_merge_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
 #endif
@@ -2419,11 +2659,33 @@ static struct attribute_group ksm_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+/* nothing is launched with the screen off, so scan at the slowest rate */
+static void ksm_early_suspend(struct early_suspend *handler)
+{
+	ksm_screen_off = true;
+}
+
+static void ksm_late_resume(struct early_suspend *handler)
+{
+	ksm_screen_off = false;
+	ksm_scan_level = 0;
+}
+
+static struct early_suspend ksm_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = ksm_early_suspend,
+	.resume = ksm_late_resume,
+};
+#endif
+
 static int __init ksm_init(void)
 {
 	struct task_struct *ksm_thread;
 	int err;
 
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	err = ksm_slab_init();
 	if (err)
 		goto out;
@@ -2450,6 +2712,9 @@ static int __init ksm_init(void)
 #ifdef CONFIG_MEMORY_HOTREMOVE
 	/* There is no significance to this priority 100 */
 	hotplug_memory_notifier(ksm_memory_callback, 100);
+#endif
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&ksm_early_suspend_desc);
 #endif
 	return 0;
 
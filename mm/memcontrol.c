@@ -255,6 +255,14 @@ struct mem_cgroup {
 	atomic_t	refcnt;
 
 	unsigned int	swappiness;
+	/*
+	 * Background groups, e.g. the apps not in the foreground, are
+	 * reclaimed down to their soft limit before any other group.
+	 */
+	bool		background;
+	/* reclaim runs on hitting the limit and over the soft limit */
+	atomic64_t	reclaim_runs[2];
+	atomic64_t	reclaim_us[2];
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
 
@@ -424,6 +432,18 @@ soft_limit_tree_from_page(struct page *page)
 	return &soft_limit_tree.rb_tree_per_node[nid]->rb_tree_per_zone[zid];
 }
 
+/*
+ * Order of the soft limit trees, whose rightmost group is reclaimed from
+ * first: background groups go right of all others.
+ */
+static bool mem_cgroup_soft_limit_less(struct mem_cgroup_per_zone *mz,
+					 struct mem_cgroup_per_zone *mz_node)
+{
+	if (mz->mem->background != mz_node->mem->background)
+		return mz_node->mem->background;
+	return mz->usage_in_excess < mz_node->usage_in_excess;
+}
+
 static void
 __mem_cgroup_insert_exceeded(struct mem_cgroup *mem,
 				struct mem_cgroup_per_zone *mz,
@@ -444,13 +464,13 @@ __mem_cgroup_insert_exceeded(struct mem_cgroup *mem,
 		parent = *p;
 		mz_node = rb_entry(parent, struct mem_cgroup_per_zone,
 					tree_node);
-		if (mz->usage_in_excess < mz_node->usage_in_excess)
+		if (mem_cgroup_soft_limit_less(mz, mz_node))
 			p = &(*p)->rb_left;
 		/*
 		 * We can't avoid mem cgroups that are over their soft
 		 * limit by the same amount
 		 */
-		else if (mz->usage_in_excess >= mz_node->usage_in_excess)
+		else
 			p = &(*p)->rb_right;
 	}
 	rb_link_node(&mz->tree_node, parent, p);
@@ -515,6 +535,29 @@ static void mem_cgroup_update_tree(struct mem_cgroup *mem, struct page *page)
 	}
 }
 
+/* put @mem back where it belongs in every tree it is on */
+static void mem_cgroup_resort_trees(struct mem_cgroup *mem)
+{
+	int node, zone;
+	struct mem_cgroup_per_zone *mz;
+	struct mem_cgroup_tree_per_zone *mctz;
+	unsigned long long excess = res_counter_soft_limit_excess(&mem->res);
+
+	for_each_node_state(node, N_POSSIBLE) {
+		for (zone = 0; zone < MAX_NR_ZONES; zone++) {
+			mz = mem_cgroup_zoneinfo(mem, node, zone);
+			mctz = soft_limit_tree_node_zone(node, zone);
+			spin_lock(&mctz->lock);
+			if (mz->on_tree) {
+				__mem_cgroup_remove_exceeded(mem, mz, mctz);
+				__mem_cgroup_insert_exceeded(mem, mz, mctz,
+							     excess);
+			}
+			spin_unlock(&mctz->lock);
+		}
+	}
+}
+
 static void mem_cgroup_remove_from_trees(struct mem_cgroup *mem)
 {
 	int node, zone;
@@ -1825,6 +1868,13 @@ static int mem_cgroup_hierarchical_reclaim(struct mem_cgroup *root_mem,
 	return total;
 }
 
+static void mem_cgroup_account_reclaim(struct mem_cgroup *mem, int soft,
+				       ktime_t start)
+{
+	atomic64_inc(&mem->reclaim_runs[soft]);
+	atomic64_add(ktime_us_delta(ktime_get(), start), &mem->reclaim_us[soft]);
+}
+
 /*
  * Check OOM-Killer is already running under our hierarchy.
  * If someone is running, return false.
@@ -2237,6 +2287,7 @@ static int mem_cgroup_do_charge(struct mem_cgroup *mem, gfp_t gfp_mask,
 	struct mem_cgroup *mem_over_limit;
 	struct res_counter *fail_res;
 	unsigned long flags = 0;
+	ktime_t start;
 	int ret;
 
 	ret = res_counter_charge(&mem->res, csize, &fail_res);
@@ -2266,8 +2317,10 @@ static int mem_cgroup_do_charge(struct mem_cgroup *mem, gfp_t gfp_mask,
 	if (!(gfp_mask & __GFP_WAIT))
 		return CHARGE_WOULDBLOCK;
 
+	start = ktime_get();
 	ret = mem_cgroup_hierarchical_reclaim(mem_over_limit, NULL,
 					      gfp_mask, flags, NULL);
+	mem_cgroup_account_reclaim(mem_over_limit, 0, start);
 	if (mem_cgroup_margin(mem_over_limit) >= nr_pages)
 		return CHARGE_RETRY;
 	/*
@@ -3697,6 +3750,7 @@ unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 	struct mem_cgroup_tree_per_zone *mctz;
 	unsigned long long excess;
 	unsigned long nr_scanned;
+	ktime_t start;
 
 	if (order > 0)
 		return 0;
@@ -3716,10 +3770,12 @@ unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 			break;
 
 		nr_scanned = 0;
+		start = ktime_get();
 		reclaimed = mem_cgroup_hierarchical_reclaim(mz->mem, zone,
 						gfp_mask,
 						MEM_CGROUP_RECLAIM_SOFT,
 						&nr_scanned);
+		mem_cgroup_account_reclaim(mz->mem, 1, start);
 		nr_reclaimed += reclaimed;
 		*total_scanned += nr_scanned;
 		spin_lock(&mctz->lock);
@@ -4330,6 +4386,15 @@ static int mem_control_stat_show(struct cgroup *cont, struct cftype *cft,
 			cb->fill(cb, "hierarchical_memsw_limit", memsw_limit);
 	}
 
+	cb->fill(cb, "reclaim_stall",
+		 atomic64_read(&mem_cont->reclaim_runs[0]));
+	cb->fill(cb, "reclaim_stall_us",
+		 atomic64_read(&mem_cont->reclaim_us[0]));
+	cb->fill(cb, "soft_reclaim",
+		 atomic64_read(&mem_cont->reclaim_runs[1]));
+	cb->fill(cb, "soft_reclaim_us",
+		 atomic64_read(&mem_cont->reclaim_us[1]));
+
 	memset(&mystat, 0, sizeof(mystat));
 	mem_cgroup_get_total_stat(mem_cont, &mystat);
 	for (i = 0; i < NR_MCS_STAT; i++) {
@@ -4407,6 +4472,24 @@ static int mem_cgroup_swappiness_write(struct cgroup *cgrp, struct cftype *cft,
 	return 0;
 }
 
+static u64 mem_cgroup_background_read(struct cgroup *cgrp, struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cgrp)->background;
+}
+
+static int mem_cgroup_background_write(struct cgroup *cgrp, struct cftype *cft,
+				       u64 val)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+
+	if (val > 1 || cgrp->parent == NULL)
+		return -EINVAL;
+
+	memcg->background = val;
+	mem_cgroup_resort_trees(memcg);
+	return 0;
+}
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -4819,6 +4902,11 @@ static struct cftype mem_cgroup_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "background",
+		.read_u64 = mem_cgroup_background_read,
+		.write_u64 = mem_cgroup_background_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -5102,8 +5190,10 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	mem->last_scanned_node = MAX_NUMNODES;
 	INIT_LIST_HEAD(&mem->oom_notify);
 
-	if (parent)
+	if (parent) {
 		mem->swappiness = get_swappiness(parent);
+		mem->background = parent->background;
+	}
 	atomic_set(&mem->refcnt, 1);
 	mem->move_charge_at_immigrate = 0;
 	mutex_init(&mem->thresholds_lock);
@@ -57,6 +57,7 @@
 #include <linux/swapops.h>
 #include <linux/elf.h>
 #include <linux/gfp.h>
+#include <linux/debugfs.h>
 
 #include <asm/io.h>
 #include <asm/pgalloc.h>
@@ -929,6 +930,33 @@ out_set_pte:
 	return 0;
 }
 
+/*
+ * With MMF_FORK_LAZY, a file mapping's ptes of page cache pages are not
+ * copied but faulted in again by the child, much as copy_page_range()
+ * does for whole vmas without anon pages.  This saves touching the
+ * struct page of every one of them, and keeps the anon pages, which
+ * only a copy can preserve.  Nonlinear and pfn mappings can't be
+ * faulted in again.
+ */
+static inline bool fork_lazy_vma(struct mm_struct *src_mm,
+				 struct vm_area_struct *vma)
+{
+	return test_bit(MMF_FORK_LAZY, &src_mm->flags) && vma->vm_file &&
+	       !(vma->vm_flags & (VM_HUGETLB | VM_NONLINEAR | VM_PFNMAP |
+				  VM_MIXEDMAP | VM_INSERTPAGE));
+}
+
+static inline bool fork_lazy_pte(struct vm_area_struct *vma,
+				 unsigned long addr, pte_t pte)
+{
+	struct page *page;
+
+	if (!pte_present(pte))
+		return false;
+	page = vm_normal_page(vma, addr, pte);
+	return page && !PageAnon(page);
+}
+
 int copy_pte_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		   pmd_t *dst_pmd, pmd_t *src_pmd, struct vm_area_struct *vma,
 		   unsigned long addr, unsigned long end)
@@ -939,6 +967,7 @@ int copy_pte_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 	int progress = 0;
 	int rss[NR_MM_COUNTERS];
 	swp_entry_t entry = (swp_entry_t){0};
+	bool lazy = fork_lazy_vma(src_mm, vma);
 
 again:
 	init_rss_vec(rss);
@@ -964,7 +993,8 @@ again:
 			    spin_needbreak(src_ptl) || spin_needbreak(dst_ptl))
 				break;
 		}
-		if (pte_none(*src_pte)) {
+		if (pte_none(*src_pte) ||
+		    (lazy && fork_lazy_pte(vma, addr, *src_pte))) {
 			progress++;
 			continue;
 		}
@@ -3404,14 +3434,162 @@ unwritable_page:
 	return ret;
 }
 
+/**
+ * do_set_pte - map a page cache page read-only, for ->map_pages()
+ * @vma:	virtual memory area
+ * @address:	user virtual address
+ * @page:	locked, uptodate page, whose reference the pte takes over
+ * @pte:	pte, mapped and locked, to set
+ */
+void do_set_pte(struct vm_area_struct *vma, unsigned long address,
+		struct page *page, pte_t *pte)
+{
+	pte_t entry;
+
+	flush_icache_page(vma, page);
+	entry = mk_pte(page, vma->vm_page_prot);
+	inc_mm_counter_fast(vma->vm_mm, MM_FILEPAGES);
+	page_add_file_rmap(page);
+	set_pte_at(vma->vm_mm, address, pte, entry);
+
+	/* no need to invalidate: a not-present page won't be cached */
+	update_mmu_cache(vma, address, pte);
+}
+
+/*
+ * Size of the window mapped around a read fault on a file, for the
+ * pages of it already in the page cache: starting a big app faults in
+ * each page of its libraries' text one at a time otherwise.  A single
+ * page turns fault-around off.
+ */
+unsigned long sysctl_fault_around_bytes __read_mostly = 65536;
+
+#ifdef CONFIG_DEBUG_FS
+static int fault_around_bytes_get(void *data, u64 *val)
+{
+	*val = sysctl_fault_around_bytes;
+	return 0;
+}
+
+/*
+ * The same knob as vm.fault_around_bytes, for a launch test to set
+ * without a sysctl binary: the value is stored as the window it makes,
+ * PAGE_SIZE times a power of two no larger than a page table.
+ */
+static int fault_around_bytes_set(void *data, u64 val)
+{
+	if (val > PTRS_PER_PTE * PAGE_SIZE)
+		return -EINVAL;
+	if (val > PAGE_SIZE)
+		sysctl_fault_around_bytes =
+			rounddown_pow_of_two((unsigned long)val);
+	else
+		sysctl_fault_around_bytes = PAGE_SIZE;
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(fault_around_bytes_fops, fault_around_bytes_get,
+		fault_around_bytes_set, "%llu\n");
+
+static int __init fault_around_debugfs(void)
+{
+	void *ret;
+
+	ret = debugfs_create_file("fault_around_bytes", 0644, NULL, NULL,
+			&fault_around_bytes_fops);
+	if (!ret)
+		pr_warn("Failed to create fault_around_bytes in debugfs\n");
+	return 0;
+}
+late_initcall(fault_around_debugfs);
+#endif
+
+/*
+ * Map the pages of the window around @address that ->map_pages() finds
+ * in the page cache.  The window is aligned to its size, and stops at
+ * the vma and at the page table of @address.  Returns how many pages
+ * were mapped.
+ */
+static unsigned int do_fault_around(struct vm_area_struct *vma, unsigned long address,
+		pte_t *pte, pgoff_t pgoff, unsigned int flags)
+{
+	unsigned long start_addr, nr_pages, mask;
+	pgoff_t max_pgoff;
+	struct vm_fault vmf;
+	int off;
+
+	nr_pages = rounddown_pow_of_two(sysctl_fault_around_bytes >> PAGE_SHIFT);
+	mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
+
+	start_addr = max(address & mask, vma->vm_start);
+	off = ((address - start_addr) >> PAGE_SHIFT) & (PTRS_PER_PTE - 1);
+	pte -= off;
+	pgoff -= off;
+
+	/*
+	 * max_pgoff is either the end of the window, of the page table or
+	 * of the vma, whichever comes first.
+	 */
+	max_pgoff = pgoff - ((start_addr >> PAGE_SHIFT) & (PTRS_PER_PTE - 1)) +
+		PTRS_PER_PTE - 1;
+	max_pgoff = min_t(pgoff_t, max_pgoff, pgoff + nr_pages - 1);
+	max_pgoff = min_t(pgoff_t, max_pgoff,
+			vma_pages(vma) + vma->vm_pgoff - 1);
+
+	/* check if the page fault is solved already */
+	while (!pte_none(*pte)) {
+		if (++pgoff > max_pgoff)
+			return 0;
+		start_addr += PAGE_SIZE;
+		if (start_addr >= vma->vm_end)
+			return 0;
+		pte++;
+	}
+
+	vmf.virtual_address = (void __user *)start_addr;
+	vmf.pte = pte;
+	vmf.pgoff = pgoff;
+	vmf.max_pgoff = max_pgoff;
+	vmf.flags = flags;
+	vmf.mapped = 0;
+	vma->vm_ops->map_pages(vma, &vmf);
+	return vmf.mapped;
+}
+
 static int do_linear_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 		unsigned long address, pte_t *page_table, pmd_t *pmd,
 		unsigned int flags, pte_t orig_pte)
 {
 	pgoff_t pgoff = (((address & PAGE_MASK)
 			- vma->vm_start) >> PAGE_SHIFT) + vma->vm_pgoff;
+	unsigned int mapped;
+	spinlock_t *ptl;
+	bool done;
 
 	pte_unmap(page_table);
+
+	/*
+	 * A read fault may find its page, and those around it, in the page
+	 * cache: map them all under the pte lock, without taking the page
+	 * fault path for each one.
+	 */
+	if (!(flags & FAULT_FLAG_WRITE) && vma->vm_ops->map_pages &&
+	    sysctl_fault_around_bytes >> PAGE_SHIFT > 1) {
+		page_table = pte_offset_map_lock(mm, pmd, address, &ptl);
+		mapped = do_fault_around(vma, address, page_table, pgoff, flags);
+		done = !pte_same(*page_table, orig_pte);
+		pte_unmap_unlock(page_table, ptl);
+
+		/* the faulting page itself was not saved a fault */
+		if (done && mapped)
+			mapped--;
+		if (mapped) {
+			count_vm_events(PGFAULTAROUND, mapped);
+			atomic_long_add(mapped, &mm->fault_around);
+		}
+		if (done)
+			return 0;
+	}
+
 	return __do_fault(mm, vma, address, pmd, pgoff, flags, orig_pte);
 }
 
@@ -57,6 +57,7 @@
 #include <linux/ftrace_event.h>
 #include <linux/memcontrol.h>
 #include <linux/prefetch.h>
+#include <linux/log2_hist.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -207,6 +208,20 @@ int min_free_order_shift = 1;
  */
 int extra_free_kbytes = 0;
 
+/*
+ * After direct reclaim or a failed high order allocation, the low and high
+ * watermarks of the zones involved are raised so that kswapd wakes up
+ * sooner and frees more ahead of the next burst.  Each stall adds a
+ * quarter of the maximum boost, watermark_boost_factor / 10000 of the high
+ * watermark, and the boost halves every WATERMARK_BOOST_DECAY.
+ */
+int watermark_boost_factor __read_mostly = 15000;
+
+#define WATERMARK_BOOST_DECAY	HZ
+
+static void watermark_boost_decay(struct work_struct *work);
+static DECLARE_DELAYED_WORK(watermark_boost_work, watermark_boost_decay);
+
 static unsigned long __meminitdata nr_kernel_pages;
 static unsigned long __meminitdata nr_all_pages;
 static unsigned long __meminitdata dma_reserve;
@@ -669,6 +684,47 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	spin_unlock(&zone->lock);
 }
 
+/* blocks of @order moved between the buddy lists and @pcp at a time */
+static inline int pcp_order_batch(struct per_cpu_pages *pcp, int order)
+{
+	return max(1, pcp->batch >> (order + 1));
+}
+
+/*
+ * Frees count blocks of order from the order lists of a PCP, taking them
+ * from each migratetype in turn.  As free_pcppages_bulk().
+ */
+static void free_pcppages_bulk_order(struct zone *zone, int count,
+				struct per_cpu_pages *pcp, int order)
+{
+	struct per_cpu_order_pages *po = &pcp->orders[order - 1];
+	int migratetype = 0;
+
+	spin_lock(&zone->lock);
+	zone->all_unreclaimable = 0;
+	zone->pages_scanned = 0;
+
+	po->count -= count;
+	__mod_zone_page_state(zone, NR_FREE_PAGES, count << order);
+	while (count) {
+		struct list_head *list = &po->lists[migratetype];
+
+		if (!list_empty(list)) {
+			struct page *page;
+
+			page = list_entry(list->prev, struct page, lru);
+			list_del(&page->lru);
+			__free_one_page(page, zone, order, page_private(page));
+			trace_mm_page_pcpu_drain(page, order,
+						 page_private(page));
+			count--;
+		}
+		if (++migratetype == MIGRATE_PCPTYPES)
+			migratetype = 0;
+	}
+	spin_unlock(&zone->lock);
+}
+
 static void free_one_page(struct zone *zone, struct page *page, int order,
 				int migratetype)
 {
@@ -707,20 +763,58 @@ static bool free_pages_prepare(struct page *page, unsigned int order)
 	return true;
 }
 
+/*
+ * Free a block of order 1 to PCP_MAX_ORDER to the per-cpu lists, as
+ * free_hot_cold_page() does for order 0.  Called with interrupts off.
+ */
+static void free_pcp_order_page(struct zone *zone, struct page *page,
+				unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+	struct per_cpu_order_pages *po;
+	int batch;
+
+	/* the buddy allocator would take it apart when merging it */
+	if (unlikely(PageCompound(page)) &&
+	    unlikely(destroy_compound_page(page, order)))
+		return;
+
+	/*
+	 * As in free_hot_cold_page(), a RESERVE block goes on the movable
+	 * list but is given back to the buddy lists it came from.
+	 */
+	set_page_private(page, migratetype);
+	if (migratetype >= MIGRATE_PCPTYPES)
+		migratetype = MIGRATE_MOVABLE;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	po = &pcp->orders[order - 1];
+	list_add(&page->lru, &po->lists[migratetype]);
+	po->count++;
+
+	batch = pcp_order_batch(pcp, order);
+	if (po->count >= 2 * batch)
+		free_pcppages_bulk_order(zone, batch, pcp, order);
+}
+
 static void __free_pages_ok(struct page *page, unsigned int order)
 {
 	unsigned long flags;
+	int migratetype;
 	int wasMlocked = __TestClearPageMlocked(page);
 
 	if (!free_pages_prepare(page, order))
 		return;
 
+	migratetype = get_pageblock_migratetype(page);
 	local_irq_save(flags);
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, order,
-					get_pageblock_migratetype(page));
+	if (order <= PCP_MAX_ORDER && migratetype != MIGRATE_ISOLATE)
+		free_pcp_order_page(page_zone(page), page, order, migratetype);
+	else
+		free_one_page(page_zone(page), page, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -1125,6 +1219,7 @@ static void drain_pages(unsigned int cpu)
 	for_each_populated_zone(zone) {
 		struct per_cpu_pageset *pset;
 		struct per_cpu_pages *pcp;
+		int order;
 
 		local_irq_save(flags);
 		pset = per_cpu_ptr(zone->pageset, cpu);
@@ -1134,6 +1229,11 @@ static void drain_pages(unsigned int cpu)
 			free_pcppages_bulk(zone, pcp->count, pcp);
 			pcp->count = 0;
 		}
+		for (order = 1; order <= PCP_MAX_ORDER; order++)
+			if (pcp->orders[order - 1].count)
+				free_pcppages_bulk_order(zone,
+					pcp->orders[order - 1].count,
+					pcp, order);
 		local_irq_restore(flags);
 	}
 }
@@ -1327,11 +1427,11 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 {
 	unsigned long flags;
 	struct page *page;
+	struct per_cpu_pages *pcp;
 	int cold = !!(gfp_flags & __GFP_COLD);
 
 again:
 	if (likely(order == 0)) {
-		struct per_cpu_pages *pcp;
 		struct list_head *list;
 
 		local_irq_save(flags);
@@ -1352,6 +1452,28 @@ again:
 
 		list_del(&page->lru);
 		pcp->count--;
+	} else if (order <= PCP_MAX_ORDER) {
+		struct per_cpu_order_pages *po;
+		struct list_head *list;
+
+		local_irq_save(flags);
+		pcp = &this_cpu_ptr(zone->pageset)->pcp;
+		po = &pcp->orders[order - 1];
+		list = &po->lists[migratetype];
+		if (list_empty(list)) {
+			po->count += rmqueue_bulk(zone, order,
+					pcp_order_batch(pcp, order), list,
+					migratetype, cold);
+			if (unlikely(list_empty(list)))
+				goto failed;
+			po->refills++;
+		} else {
+			po->hits++;
+		}
+
+		page = list_entry(list->next, struct page, lru);
+		list_del(&page->lru);
+		po->count--;
 	} else {
 		if (unlikely(gfp_flags & __GFP_NOFAIL)) {
 			/*
@@ -1997,6 +2119,52 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 }
 #endif /* CONFIG_COMPACTION */
 
+static void watermark_boost_decay(struct work_struct *work)
+{
+	struct zone *zone;
+	bool boosted = false;
+
+	for_each_populated_zone(zone) {
+		zone->watermark_boost >>= 1;
+		if (zone->watermark_boost)
+			boosted = true;
+	}
+
+	if (boosted)
+		schedule_delayed_work(&watermark_boost_work,
+				      WATERMARK_BOOST_DECAY);
+}
+
+static void boost_watermarks(struct zonelist *zonelist,
+		enum zone_type high_zoneidx, nodemask_t *nodemask)
+{
+	struct zoneref *z;
+	struct zone *zone;
+
+	if (!watermark_boost_factor)
+		return;
+
+	for_each_zone_zonelist_nodemask(zone, z, zonelist,
+					high_zoneidx, nodemask) {
+		unsigned long max_boost;
+
+		max_boost = div_u64((u64)zone->watermark[WMARK_HIGH] *
+				    watermark_boost_factor, 10000);
+		zone->watermark_boost = min(zone->watermark_boost +
+					    max_boost / 4, max_boost);
+	}
+
+	schedule_delayed_work(&watermark_boost_work, WATERMARK_BOOST_DECAY);
+}
+
+static void account_reclaim_stall(struct zone *zone, ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	zone->reclaim_stall[log2_hist_bucket(us > 0 ? us : 0,
+					     RECLAIM_STALL_BUCKETS)]++;
+}
+
 /* The really slow allocator path where we enter direct reclaim */
 static inline struct page *
 __alloc_pages_direct_reclaim(gfp_t gfp_mask, unsigned int order,
@@ -2007,6 +2175,7 @@ __alloc_pages_direct_reclaim(gfp_t gfp_mask, unsigned int order,
 	struct page *page = NULL;
 	struct reclaim_state reclaim_state;
 	bool drained = false;
+	ktime_t start;
 
 	cond_resched();
 
@@ -2017,7 +2186,10 @@ __alloc_pages_direct_reclaim(gfp_t gfp_mask, unsigned int order,
 	reclaim_state.reclaimed_slab = 0;
 	current->reclaim_state = &reclaim_state;
 
+	start = ktime_get();
 	*did_some_progress = try_to_free_pages(zonelist, order, gfp_mask, nodemask);
+	account_reclaim_stall(preferred_zone, start);
+	boost_watermarks(zonelist, high_zoneidx, nodemask);
 
 	current->reclaim_state = NULL;
 	lockdep_clear_current_reclaim_state();
@@ -2166,9 +2338,12 @@ __alloc_pages_slowpath(gfp_t gfp_mask, unsigned int order,
 		goto nopage;
 
 restart:
-	if (!(gfp_mask & __GFP_NO_KSWAPD))
+	if (!(gfp_mask & __GFP_NO_KSWAPD)) {
 		wake_all_kswapd(order, zonelist, high_zoneidx,
 						zone_idx(preferred_zone));
+		if (order)
+			wakeup_kcompactd();
+	}
 
 	/*
 	 * OK, we're below the kswapd watermark and have kicked background
@@ -2320,6 +2495,8 @@ rebalance:
 	}
 
 nopage:
+	if (order && !(gfp_mask & __GFP_NO_KSWAPD))
+		boost_watermarks(zonelist, high_zoneidx, nodemask);
 	warn_alloc_failed(gfp_mask, order, NULL);
 	return page;
 got_pg:
@@ -3671,7 +3848,7 @@ static int zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -3681,6 +3858,10 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->batch = max(1UL, 1 * batch);
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	for (order = 0; order < PCP_MAX_ORDER; order++)
+		for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+		     migratetype++)
+			INIT_LIST_HEAD(&pcp->orders[order].lists[migratetype]);
 }
 
 /*
@@ -3776,7 +3957,7 @@ int zone_wait_table_init(struct zone *zone, unsigned long zone_size_pages)
 static int __zone_pcp_update(void *data)
 {
 	struct zone *zone = data;
-	int cpu;
+	int cpu, order;
 	unsigned long batch = zone_batchsize(zone), flags;
 
 	for_each_possible_cpu(cpu) {
@@ -3788,6 +3969,10 @@ static int __zone_pcp_update(void *data)
 
 		local_irq_save(flags);
 		free_pcppages_bulk(zone, pcp->count, pcp);
+		for (order = 1; order <= PCP_MAX_ORDER; order++)
+			free_pcppages_bulk_order(zone,
+					pcp->orders[order - 1].count,
+					pcp, order);
 		setup_pageset(pset, batch);
 		local_irq_restore(flags);
 	}
@@ -17,6 +17,7 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/math64.h>
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -245,6 +246,97 @@ unsigned long max_sane_readahead(unsigned long nr)
 		+ node_page_state(numa_node_id(), NR_FREE_PAGES)) / 2);
 }
 
+/*
+ * Adaptive readahead window.
+ *
+ * A device that opts in with bdi_set_ra_max_pages() has the block layer
+ * report the bytes it read while busy and for how long.  Every
+ * RA_SAMPLE_NS of busy time the window is sized to take RA_WINDOW_MS to
+ * read at the measured bandwidth, then scaled by the share of readahead
+ * pages that readers went on to since the last sample, so random access
+ * shrinks it again.  ra_pages stays the base that the per file limits
+ * are scaled from.
+ */
+#define RA_SAMPLE_NS	(100 * NSEC_PER_MSEC)
+#define RA_WINDOW_MS	16
+#define RA_MIN_SAMPLE	64	/* pages of hits and misses to trust a ratio */
+
+void bdi_ra_account_read(struct backing_dev_info *bdi, u64 bytes, u64 busy_ns)
+{
+	unsigned long bw, window, max = ACCESS_ONCE(bdi->ra_max_pages);
+	s64 hit, miss, dhit, dmiss;
+
+	if (!max)
+		return;
+
+	bdi->ra_bw_bytes += bytes;
+	bdi->ra_bw_ns += busy_ns;
+	if (bdi->ra_bw_ns < RA_SAMPLE_NS)
+		return;
+
+	bw = div64_u64((bdi->ra_bw_bytes >> 10) * NSEC_PER_SEC,
+		       bdi->ra_bw_ns);
+	bdi->ra_bw_bytes = 0;
+	bdi->ra_bw_ns = 0;
+	/* busy with writes only, nothing to learn about reads */
+	if (!bw)
+		return;
+
+	if (bdi->read_bandwidth)
+		bw = (bdi->read_bandwidth * 3 + bw) / 4;
+	bdi->read_bandwidth = bw;
+	window = (bw * RA_WINDOW_MS / MSEC_PER_SEC) >> (PAGE_CACHE_SHIFT - 10);
+
+	hit = bdi_stat(bdi, BDI_RA_HIT);
+	miss = bdi_stat(bdi, BDI_RA_MISS);
+	dhit = max_t(s64, hit - bdi->ra_last_hit, 0);
+	dmiss = max_t(s64, miss - bdi->ra_last_miss, 0);
+	if (dhit + dmiss >= RA_MIN_SAMPLE) {
+		window = div64_u64((u64)window * dhit, dhit + dmiss);
+		bdi->ra_last_hit = hit;
+		bdi->ra_last_miss = miss;
+	}
+
+	bdi->ra_window = clamp_t(unsigned long, window,
+			VM_MIN_READAHEAD >> (PAGE_CACHE_SHIFT - 10), max);
+}
+
+void bdi_set_ra_max_pages(struct backing_dev_info *bdi, unsigned long pages)
+{
+	bdi->ra_max_pages = pages;
+	if (!pages || bdi->ra_window > pages)
+		bdi->ra_window = pages;
+}
+EXPORT_SYMBOL(bdi_set_ra_max_pages);
+
+/* the readahead limit of @ra on its device's adaptive window */
+static unsigned long ra_max_pages(struct address_space *mapping,
+				  struct file_ra_state *ra)
+{
+	struct backing_dev_info *bdi = mapping->backing_dev_info;
+	unsigned long window = ACCESS_ONCE(bdi->ra_window);
+
+	if (!window || !bdi->ra_pages)
+		return ra->ra_pages;
+	return ra->ra_pages * window / bdi->ra_pages;
+}
+
+/*
+ * The reader starts a new window: count the pages of the last one past
+ * its previous read as readahead it did not use.
+ */
+static void ra_account_miss(struct address_space *mapping,
+			    struct file_ra_state *ra)
+{
+	pgoff_t last = ra->prev_pos >> PAGE_CACHE_SHIFT;
+
+	if (!ra->size || last < ra->start || last >= ra->start + ra->size)
+		return;
+
+	__add_bdi_stat(mapping->backing_dev_info, BDI_RA_MISS,
+		       ra->start + ra->size - last - 1);
+}
+
 /*
  * Submit IO for the read-ahead request in file_ra_state.
  */
@@ -398,13 +490,15 @@ ondemand_readahead(struct address_space *mapping,
 		   bool hit_readahead_marker, pgoff_t offset,
 		   unsigned long req_size)
 {
-	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long max = max_sane_readahead(ra_max_pages(mapping, ra));
 
 	/*
 	 * start of file
 	 */
-	if (!offset)
+	if (!offset) {
+		ra_account_miss(mapping, ra);
 		goto initial_readahead;
+	}
 
 	/*
 	 * It's the expected callback offset, assume sequential access.
@@ -412,6 +506,8 @@ ondemand_readahead(struct address_space *mapping,
 	 */
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
+		__add_bdi_stat(mapping->backing_dev_info, BDI_RA_HIT,
+			       ra->size);
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max);
 		ra->async_size = ra->size;
@@ -434,6 +530,8 @@ ondemand_readahead(struct address_space *mapping,
 		if (!start || start - offset > max)
 			return 0;
 
+		__add_bdi_stat(mapping->backing_dev_info, BDI_RA_HIT,
+			       start - offset);
 		ra->start = start;
 		ra->size = start - offset;	/* old async_size */
 		ra->size += req_size;
@@ -442,6 +540,8 @@ ondemand_readahead(struct address_space *mapping,
 		goto readit;
 	}
 
+	ra_account_miss(mapping, ra);
+
 	/*
 	 * oversize read
 	 */
@@ -1231,6 +1231,19 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 	} else if (PageAnon(page)) {
 		swp_entry_t entry = { .val = page_private(page) };
 
+		if ((flags & TTU_FREE) && !PageSwapCache(page)) {
+			/*
+			 * Given up with MADV_FREE: if nobody wrote to it since,
+			 * the contents can go and a later fault gets a new page.
+			 */
+			if (PageDirty(page)) {
+				set_pte_at(mm, address, pte, pteval);
+				goto out_unmap;
+			}
+			dec_mm_counter(mm, MM_ANONPAGES);
+			goto discard;
+		}
+
 		if (PageSwapCache(page)) {
 			/*
 			 * Store the swap location in the pte.
@@ -1268,6 +1281,7 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 	} else
 		dec_mm_counter(mm, MM_FILEPAGES);
 
+discard:
 	page_remove_rmap(page);
 	page_cache_release(page);
 
@@ -144,6 +144,12 @@ static inline int kmem_cache_debug(struct kmem_cache *s)
  */
 #define MAX_PARTIAL 10
 
+/*
+ * How far min_partial is raised for the caches that keep freeing empty
+ * slabs only to allocate new ones, see slub_tune_caches().
+ */
+#define MAX_PARTIAL_TUNED (4 * MAX_PARTIAL)
+
 #define DEBUG_DEFAULT_FLAGS (SLAB_DEBUG_FREE | SLAB_RED_ZONE | \
 				SLAB_POISON | SLAB_STORE_USER)
 
@@ -2610,6 +2616,9 @@ static int kmem_cache_open(struct kmem_cache *s,
 	 * list to avoid pounding the page allocator excessively.
 	 */
 	set_min_partial(s, ilog2(s->size));
+#ifdef CONFIG_SLUB_STATS
+	s->min_partial_auto = 1;
+#endif
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -4153,10 +4162,37 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 		return err;
 
 	set_min_partial(s, min);
+#ifdef CONFIG_SLUB_STATS
+	s->min_partial_auto = 0;
+#endif
 	return length;
 }
 SLAB_ATTR(min_partial);
 
+#ifdef CONFIG_SLUB_STATS
+static ssize_t min_partial_auto_show(struct kmem_cache *s, char *buf)
+{
+	return sprintf(buf, "%d\n", s->min_partial_auto);
+}
+
+static ssize_t min_partial_auto_store(struct kmem_cache *s, const char *buf,
+				      size_t length)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err)
+		return err;
+	if (val > 1)
+		return -EINVAL;
+
+	s->min_partial_auto = val;
+	return length;
+}
+SLAB_ATTR(min_partial_auto);
+#endif
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4511,6 +4547,9 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+#ifdef CONFIG_SLUB_STATS
+	&min_partial_auto_attr.attr,
+#endif
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -4916,3 +4955,145 @@ static int __init slab_proc_init(void)
 }
 module_init(slab_proc_init);
 #endif /* CONFIG_SLABINFO */
+
+#ifdef CONFIG_SLUB_STATS
+static unsigned int sum_stat(struct kmem_cache *s, enum stat_item si)
+{
+	unsigned int sum = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		sum += per_cpu_ptr(s->cpu_slab, cpu)->stat[si];
+	return sum;
+}
+
+/*
+ * Every SLUB_TUNE_INTERVAL, a cache that allocated and freed at least
+ * SLUB_TUNE_CHURN slabs since the last pass keeps twice as many empty
+ * slabs on its partial lists, up to MAX_PARTIAL_TUNED, so that the next
+ * burst of allocations is served without the page allocator.  Once it
+ * calms down again it drifts back to its default, one slab a pass.  Only
+ * the caches hot enough to need it, such as skbuff_head_cache, dentry
+ * or the kmalloc caches binder works from, end up raised.
+ */
+#define SLUB_TUNE_INTERVAL	(10 * HZ)
+#define SLUB_TUNE_CHURN		64
+
+static void slub_tune_caches(struct work_struct *work);
+static DECLARE_DEFERRED_WORK(slub_tune_work, slub_tune_caches);
+
+static void slub_tune_cache(struct kmem_cache *s)
+{
+	unsigned int allocs = sum_stat(s, ALLOC_SLAB);
+	unsigned int frees = sum_stat(s, FREE_SLAB);
+	unsigned long dflt = clamp_t(unsigned long, ilog2(s->size),
+				     MIN_PARTIAL, MAX_PARTIAL);
+	unsigned int churn;
+
+	/* the counters start over when cleared through sysfs */
+	churn = min(allocs >= s->tune_slabs[0] ? allocs - s->tune_slabs[0] :
+						 allocs,
+		    frees >= s->tune_slabs[1] ? frees - s->tune_slabs[1] :
+						frees);
+	s->tune_slabs[0] = allocs;
+	s->tune_slabs[1] = frees;
+
+	if (!s->min_partial_auto)
+		return;
+
+	if (churn >= SLUB_TUNE_CHURN)
+		s->min_partial = min_t(unsigned long, s->min_partial * 2,
+				       MAX_PARTIAL_TUNED);
+	else if (churn < SLUB_TUNE_CHURN / 4 && s->min_partial > dflt)
+		s->min_partial--;
+}
+
+static void slub_tune_caches(struct work_struct *work)
+{
+	struct kmem_cache *s;
+
+	down_read(&slub_lock);
+	list_for_each_entry(s, &slab_caches, list)
+		slub_tune_cache(s);
+	up_read(&slub_lock);
+
+	schedule_delayed_work(&slub_tune_work,
+			      round_jiffies_relative(SLUB_TUNE_INTERVAL));
+}
+
+#ifdef CONFIG_PROC_FS
+/* /proc/slab_hitstats: how often each cache gets by on its fast paths */
+static void *hs_start(struct seq_file *m, loff_t *pos)
+{
+	down_read(&slub_lock);
+	if (!*pos)
+		seq_puts(m, "# name            <alloc_fast> <alloc_slow> <hit%>"
+			 " <free_fast> <free_slow> <hit%> <min_partial>\n");
+	return seq_list_start(&slab_caches, *pos);
+}
+
+static void *hs_next(struct seq_file *m, void *p, loff_t *pos)
+{
+	return seq_list_next(p, &slab_caches, pos);
+}
+
+static void hs_stop(struct seq_file *m, void *p)
+{
+	up_read(&slub_lock);
+}
+
+static unsigned int hit_permille(unsigned int fast, unsigned int slow)
+{
+	if (!fast && !slow)
+		return 0;
+	return div_u64((u64)fast * 1000, fast + slow);
+}
+
+static int hs_show(struct seq_file *m, void *p)
+{
+	struct kmem_cache *s = list_entry(p, struct kmem_cache, list);
+	unsigned int af = sum_stat(s, ALLOC_FASTPATH);
+	unsigned int as = sum_stat(s, ALLOC_SLOWPATH);
+	unsigned int ff = sum_stat(s, FREE_FASTPATH);
+	unsigned int fs = sum_stat(s, FREE_SLOWPATH);
+	unsigned int ah = hit_permille(af, as);
+	unsigned int fh = hit_permille(ff, fs);
+
+	seq_printf(m, "%-17s %10u %10u %3u.%u %10u %10u %3u.%u %4lu%s\n",
+		   s->name, af, as, ah / 10, ah % 10, ff, fs, fh / 10, fh % 10,
+		   s->min_partial, s->min_partial_auto ? "" : " fixed");
+	return 0;
+}
+
+static const struct seq_operations slab_hitstats_op = {
+	.start = hs_start,
+	.next = hs_next,
+	.stop = hs_stop,
+	.show = hs_show,
+};
+
+static int slab_hitstats_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &slab_hitstats_op);
+}
+
+static const struct file_operations proc_slab_hitstats_operations = {
+	.open		= slab_hitstats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+#endif /* CONFIG_PROC_FS */
+
+static int __init slub_tune_init(void)
+{
+#ifdef CONFIG_PROC_FS
+	proc_create("slab_hitstats", S_IRUGO, NULL,
+		    &proc_slab_hitstats_operations);
+#endif
+	schedule_delayed_work(&slub_tune_work,
+			      round_jiffies_relative(SLUB_TUNE_INTERVAL));
+	return 0;
+}
+module_init(slub_tune_init);
+#endif /* CONFIG_SLUB_STATS */
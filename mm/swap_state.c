@@ -48,6 +48,11 @@ struct address_space swapper_space = {
 
 #define INC_CACHE_INFO(x)	do { swap_cache_info.x++; } while (0)
 
+/* readahead pages faulted in since the last swapin_nr_pages() */
+static atomic_t swapin_readahead_hits = ATOMIC_INIT(4);
+
+int sysctl_swap_vma_readahead = 1;
+
 static struct {
 	unsigned long add_total;
 	unsigned long del_total;
@@ -267,8 +272,14 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (unlikely(PageReadahead(page))) {
+			ClearPageReadahead(page);
+			atomic_inc(&swapin_readahead_hits);
+			count_vm_event(SWAP_RA_HIT);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -379,6 +390,123 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+/*
+ * Size of the next readahead window: as many pages as were hit since
+ * the last one, rounded up to a power of two and at most a page_cluster,
+ * but shrinking by no more than half at a time.  Without hits, only
+ * faults next to the previous one still get a window of two.
+ */
+static unsigned long swapin_nr_pages(unsigned long offset)
+{
+	static unsigned long prev_offset;
+	static atomic_t last_readahead_pages;
+	unsigned int pages, max_pages, last_ra;
+
+	max_pages = 1 << ACCESS_ONCE(page_cluster);
+	if (max_pages <= 1)
+		return 1;
+
+	pages = atomic_xchg(&swapin_readahead_hits, 0) + 2;
+	if (pages == 2) {
+		if (offset != prev_offset + 1 && offset != prev_offset - 1)
+			pages = 1;
+		prev_offset = offset;
+	} else {
+		unsigned int roundup = 4;
+
+		while (roundup < pages)
+			roundup <<= 1;
+		pages = roundup;
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	last_ra = atomic_read(&last_readahead_pages) / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+	atomic_set(&last_readahead_pages, pages);
+
+	return pages;
+}
+
+/* read @entry ahead, unless it is already in the swap cache */
+static void swap_readahead_entry(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct page *page;
+
+	page = find_get_page(&swapper_space, entry.val);
+	if (!page) {
+		page = read_swap_cache_async(entry, gfp_mask, vma, addr);
+		if (!page)
+			return;
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+}
+
+#define SWAP_RA_MAX_PAGES	32
+
+/*
+ * Read ahead the pages swapped out from around @addr in @vma, whichever
+ * swap slots they went to: on zram the order of the slots says nothing
+ * about which pages will be wanted next.  The window is aligned to its
+ * size and kept within the vma and the page table of @addr.
+ */
+static void swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	pte_t ptes[SWAP_RA_MAX_PAGES];
+	unsigned long nr, start, end, i;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *pte;
+	struct blk_plug plug;
+
+	nr = min_t(unsigned long, swapin_nr_pages(addr >> PAGE_SHIFT),
+		   SWAP_RA_MAX_PAGES);
+	if (nr <= 1)
+		return;
+
+	start = max3(addr & ~((nr << PAGE_SHIFT) - 1), addr & PMD_MASK,
+		     vma->vm_start);
+	end = min3(start + (nr << PAGE_SHIFT), (addr & PMD_MASK) + PMD_SIZE,
+		   vma->vm_end);
+
+	pgd = pgd_offset(vma->vm_mm, start);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return;
+	pud = pud_offset(pgd, start);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return;
+	pmd = pmd_offset(pud, start);
+	if (pmd_none(*pmd) || pmd_trans_huge(*pmd) || unlikely(pmd_bad(*pmd)))
+		return;
+
+	nr = (end - start) >> PAGE_SHIFT;
+	pte = pte_offset_map(pmd, start);
+	for (i = 0; i < nr; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++) {
+		swp_entry_t entry;
+
+		if (!is_swap_pte(ptes[i]))
+			continue;
+		entry = pte_to_swp_entry(ptes[i]);
+		if (non_swap_entry(entry) || entry.val == fentry.val)
+			continue;
+		swap_readahead_entry(entry, gfp_mask, vma,
+				     start + (i << PAGE_SHIFT));
+	}
+	blk_finish_plug(&plug);
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -393,6 +521,10 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
  * because it doesn't cost us any seek time.  We also make sure to queue
  * the 'original' request together with the readahead ones...
  *
+ * With vm.swap_vma_readahead and a @vma, the pages around @addr in it
+ * are read instead.  Either way the block shrinks when fewer of the pages
+ * read ahead are faulted in, and the device can opt out of readahead.
+ *
  * This has been extended to use the NUMA policies from the mm triggering
  * the readahead.
  *
@@ -402,12 +534,23 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
 	
-	struct page *page;
 	unsigned long offset = swp_offset(entry);
         unsigned long start_offset, end_offset;
-        unsigned long mask = (1UL << page_cluster) - 1;
+        unsigned long mask;
         struct blk_plug plug;
 
+	if (swap_readahead_disabled(entry))
+		goto skip;
+
+	if (vma && sysctl_swap_vma_readahead) {
+		swap_vma_readahead(entry, gfp_mask, vma, addr);
+		goto skip;
+	}
+
+	mask = swapin_nr_pages(offset) - 1;
+	if (!mask)
+		goto skip;
+
 	/* Read a page_cluster sized and aligned cluster around offset. */
         start_offset = offset & ~mask;
         end_offset = offset | mask;
@@ -417,14 +560,14 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
         blk_start_plug(&plug);
 	for (offset = start_offset; offset <= end_offset ; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
+		if (offset == swp_offset(entry))
 			continue;
-		page_cache_release(page);
+		swap_readahead_entry(swp_entry(swp_type(entry), offset),
+				     gfp_mask, vma, addr);
 	}
         blk_finish_plug(&plug);
 
+skip:
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
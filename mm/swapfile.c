@@ -752,6 +752,17 @@ int mem_cgroup_count_swap_user(swp_entry_t ent, struct page **pagep)
 }
 #endif
 
+/*
+ * Whether the device @entry is on asked not to be read ahead from: zram,
+ * where a page read ahead in vain costs a decompression, can ask for it.
+ */
+bool swap_readahead_disabled(swp_entry_t entry)
+{
+	struct swap_info_struct *si = swap_info[swp_type(entry)];
+
+	return si->bdev && blk_queue_no_swap_ra(bdev_get_queue(si->bdev));
+}
+
 #ifdef CONFIG_HIBERNATION
 /*
  * Find the swap type that corresponds to given device (if any).
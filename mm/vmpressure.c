@@ -22,6 +22,7 @@
 #include <linux/swap.h>
 #include <linux/printk.h>
 #include <linux/slab.h>
+#include <linux/notifier.h>
 #include <linux/vmpressure.h>
 
 /*
@@ -113,12 +114,39 @@ static enum vmpressure_levels vmpressure_level(unsigned long pressure)
 	return VMPRESSURE_LOW;
 }
 
-static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
-						    unsigned long reclaimed)
+/* In-kernel consumers of system wide (root cgroup) pressure. */
+static BLOCKING_NOTIFIER_HEAD(vmpressure_notifier);
+
+/**
+ * vmpressure_notifier_register() - Get system wide pressure updates
+ * @nb:	notifier block to add
+ *
+ * The notifier is called from process context once per vmpressure window
+ * of global reclaim, with a pointer to the pressure (an unsigned long
+ * from 0 to 100, see vmpressure_calc_pressure()) as its data argument.
+ */
+int vmpressure_notifier_register(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&vmpressure_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(vmpressure_notifier_register);
+
+int vmpressure_notifier_unregister(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&vmpressure_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(vmpressure_notifier_unregister);
+
+static unsigned long vmpressure_calc_pressure(unsigned long scanned,
+					      unsigned long reclaimed)
 {
 	unsigned long scale = scanned + reclaimed;
 	unsigned long pressure;
 
+	/* slab shrinkers can account more reclaimed than scanned pages */
+	if (reclaimed >= scanned)
+		return 0;
+
 	/*
 	 * We calculate the ratio (in percents) of how many pages were
 	 * scanned vs. reclaimed in a given time frame (window). Note that
@@ -132,7 +160,7 @@ static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
 	pr_debug("%s: %3lu  (s: %lu  r: %lu)\n", __func__, pressure,
 		 scanned, reclaimed);
 
-	return vmpressure_level(pressure);
+	return pressure;
 }
 
 struct vmpressure_event {
@@ -142,13 +170,13 @@ struct vmpressure_event {
 };
 
 static bool vmpressure_event(struct vmpressure *vmpr,
-			     unsigned long scanned, unsigned long reclaimed)
+			     unsigned long pressure)
 {
 	struct vmpressure_event *ev;
 	enum vmpressure_levels level;
 	bool signalled = false;
 
-	level = vmpressure_calc_level(scanned, reclaimed);
+	level = vmpressure_level(pressure);
 
 	mutex_lock(&vmpr->events_lock);
 
@@ -169,6 +197,7 @@ static void vmpressure_work_fn(struct work_struct *work)
 	struct vmpressure *vmpr = work_to_vmpressure(work);
 	unsigned long scanned;
 	unsigned long reclaimed;
+	unsigned long pressure;
 
 	/*
 	 * Several contexts might be calling vmpressure(), so it is
@@ -188,8 +217,12 @@ static void vmpressure_work_fn(struct work_struct *work)
 	vmpr->reclaimed = 0;
 	mutex_unlock(&vmpr->sr_lock);
 
+	pressure = vmpressure_calc_pressure(scanned, reclaimed);
+	if (vmpr == memcg_to_vmpressure(NULL))
+		blocking_notifier_call_chain(&vmpressure_notifier, 0, &pressure);
+
 	do {
-		if (vmpressure_event(vmpr, scanned, reclaimed))
+		if (vmpressure_event(vmpr, pressure))
 			break;
 		/*
 		 * If not handled, propagate the event upward into the
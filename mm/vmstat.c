@@ -708,6 +708,14 @@ const char * const vmstat_text[] = {
 	"nr_shmem",
 	"nr_dirtied",
 	"nr_written",
+	"workingset_refault",
+	"workingset_activate",
+	"nr_zspages",
+	"nr_ion_pages",
+	"nr_ion_pool_pages",
+	"nr_pvr_pages",
+	"nr_pvr_pool_pages",
+	"nr_binder_pages",
 
 #ifdef CONFIG_NUMA
 	"numa_hit",
@@ -735,6 +743,9 @@ const char * const vmstat_text[] = {
 
 	"pgfault",
 	"pgmajfault",
+	"pgfaultaround",
+	"splice_moved",
+	"splice_copied",
 
 	TEXTS_FOR_ZONES("pgrefill")
 	TEXTS_FOR_ZONES("pgsteal")
@@ -755,6 +766,12 @@ const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"pglazyfreed",
+
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+#endif
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -763,6 +780,10 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_stall_ms",
+	"compact_daemon_wake",
+	"compact_daemon_success",
+	"compact_daemon_fail",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -998,6 +1019,7 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 		   "\n  pagesets");
 	for_each_online_cpu(i) {
 		struct per_cpu_pageset *pageset;
+		int order;
 
 		pageset = per_cpu_ptr(zone->pageset, i);
 		seq_printf(m,
@@ -1009,6 +1031,15 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   pageset->pcp.count,
 			   pageset->pcp.high,
 			   pageset->pcp.batch);
+		for (order = 1; order <= PCP_MAX_ORDER; order++) {
+			struct per_cpu_order_pages *po;
+
+			po = &pageset->pcp.orders[order - 1];
+			seq_printf(m,
+				   "\n            order %d: count %i hits %lu"
+				   " refills %lu",
+				   order, po->count, po->hits, po->refills);
+		}
 #ifdef CONFIG_SMP
 		seq_printf(m, "\n  vm stats threshold: %d",
 				pageset->stat_threshold);
@@ -1017,10 +1048,15 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 	seq_printf(m,
 		   "\n  all_unreclaimable: %u"
 		   "\n  start_pfn:         %lu"
-		   "\n  inactive_ratio:    %u",
+		   "\n  inactive_ratio:    %u"
+		   "\n  watermark_boost:   %lu"
+		   "\n  reclaim_stall_us: ",
 		   zone->all_unreclaimable,
 		   zone->zone_start_pfn,
-		   zone->inactive_ratio);
+		   zone->inactive_ratio,
+		   zone->watermark_boost);
+	for (i = 0; i < RECLAIM_STALL_BUCKETS; i++)
+		seq_printf(m, " %lu", zone->reclaim_stall[i]);
 	seq_putc(m, '\n');
 }
 
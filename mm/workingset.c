@@ -0,0 +1,211 @@
+/*
+ * Workingset detection
+ *
+ * Pages evicted from the inactive file list are remembered for a while,
+ * together with how far the zone's inactive list had aged when they went:
+ * zone->inactive_age counts the evictions and activations in the zone,
+ * each one moving the pages on the inactive list one slot towards its
+ * tail.  When such a page is faulted back in, the age it missed since it
+ * left - its refault distance - is how many more inactive slots it would
+ * have needed to still be cached.  If that is no more than the zone's
+ * active file pages, which the inactive list could have taken over had
+ * the active list given them up, the page is part of a working set that
+ * no longer fits the inactive list, and it goes straight to the active
+ * list instead of being evicted again after one pass.
+ *
+ * The page cache has no place to keep those records once the page is
+ * gone, as its radix tree lookups expect nothing but pages in there, so
+ * they are kept in a hash table of (mapping, index) instead, sized
+ * to a quarter of memory.  A record is dropped when the page refaults
+ * or when later evictions that hash to the same bucket need its slot;
+ * one left behind by a truncated file only costs a wrong activation if
+ * its mapping is ever reused at the same index.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/vmalloc.h>
+#include <linux/vmstat.h>
+#include <linux/module.h>
+
+#define EVICTION_SHIFT	(NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	(~0U >> EVICTION_SHIFT)
+
+#define WORKINGSET_SLOTS	7
+
+struct workingset_bucket {
+	spinlock_t	lock;
+	unsigned int	hand;
+	u32		key[WORKINGSET_SLOTS];
+	u32		eviction[WORKINGSET_SLOTS];
+};
+
+static struct workingset_bucket *workingset_table __read_mostly;
+static unsigned int workingset_shift __read_mostly;
+
+/* never 0, which marks a free slot */
+static u32 workingset_key(struct address_space *mapping, pgoff_t index)
+{
+	unsigned long ino = mapping->host ? mapping->host->i_ino : 0;
+	u32 key;
+
+	key = hash_long((unsigned long)mapping ^ ino, 32);
+	key = hash_32(key ^ (u32)index, 32);
+	return key ? key : 1;
+}
+
+static struct workingset_bucket *workingset_bucket(u32 key)
+{
+	return &workingset_table[hash_32(key, workingset_shift)];
+}
+
+static u32 pack_eviction(struct zone *zone, unsigned long eviction)
+{
+	u32 packed = eviction & EVICTION_MASK;
+
+	packed = (packed << NODES_SHIFT) | zone_to_nid(zone);
+	packed = (packed << ZONES_SHIFT) | zone_idx(zone);
+	return packed;
+}
+
+static struct zone *unpack_eviction(u32 packed, unsigned long *eviction)
+{
+	int zid = packed & ((1U << ZONES_SHIFT) - 1);
+	int nid;
+
+	packed >>= ZONES_SHIFT;
+	nid = packed & ((1U << NODES_SHIFT) - 1);
+	packed >>= NODES_SHIFT;
+
+	*eviction = packed;
+	return NODE_DATA(nid)->node_zones + zid;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from the page cache
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Called by reclaim with the page locked and the mapping's tree_lock
+ * held, just before @page is deleted from the page cache.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	struct workingset_bucket *b;
+	unsigned long eviction;
+	u32 key;
+	int i;
+
+	if (!workingset_table)
+		return;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	key = workingset_key(mapping, page->index);
+	b = workingset_bucket(key);
+
+	spin_lock(&b->lock);
+	for (i = 0; i < WORKINGSET_SLOTS; i++)
+		if (b->key[i] == key)
+			break;
+	if (i == WORKINGSET_SLOTS) {
+		i = b->hand;
+		b->hand = (i + 1) % WORKINGSET_SLOTS;
+	}
+	b->key[i] = key;
+	b->eviction[i] = pack_eviction(zone, eviction);
+	spin_unlock(&b->lock);
+}
+
+/**
+ * workingset_refault - see whether a page coming in was recently evicted
+ * @mapping: address space the page is added to
+ * @index: page index in @mapping
+ *
+ * Returns %true if the page should be activated right away, as the
+ * refault distance says it belongs to the working set.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct workingset_bucket *b;
+	unsigned long refault, eviction;
+	unsigned long distance;
+	struct zone *zone;
+	u32 key, packed = 0;
+	int i;
+
+	if (!workingset_table)
+		return false;
+
+	key = workingset_key(mapping, index);
+	b = workingset_bucket(key);
+
+	spin_lock(&b->lock);
+	for (i = 0; i < WORKINGSET_SLOTS; i++) {
+		if (b->key[i] == key) {
+			packed = b->eviction[i];
+			b->key[i] = 0;
+			break;
+		}
+	}
+	spin_unlock(&b->lock);
+
+	if (i == WORKINGSET_SLOTS)
+		return false;
+
+	zone = unpack_eviction(packed, &eviction);
+	refault = atomic_long_read(&zone->inactive_age);
+	/* the counter may have wrapped past the bits kept of it */
+	distance = (refault - eviction) & EVICTION_MASK;
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	unsigned long buckets = totalram_pages / 4 / WORKINGSET_SLOTS;
+	struct workingset_bucket *table;
+	unsigned long i;
+
+	workingset_shift = buckets > 2 ? ilog2(buckets) : 1;
+	buckets = 1UL << workingset_shift;
+
+	table = vmalloc(buckets * sizeof(*table));
+	if (!table) {
+		printk(KERN_WARNING "workingset: no memory for %lu buckets\n",
+		       buckets);
+		return -ENOMEM;
+	}
+	for (i = 0; i < buckets; i++) {
+		spin_lock_init(&table[i].lock);
+		table[i].hand = 0;
+		memset(table[i].key, 0, sizeof(table[i].key));
+	}
+
+	/* reclaim may be running already */
+	smp_wmb();
+	workingset_table = table;
+
+	printk(KERN_INFO "workingset: %lu eviction records\n",
+	       buckets * WORKINGSET_SLOTS);
+	return 0;
+}
+module_init(workingset_init);
@@ -133,6 +133,7 @@
 #include <linux/pci.h>
 #include <linux/inetdevice.h>
 #include <linux/cpu_rmap.h>
+#include <net/busy_poll.h>
 
 #include "net-sysfs.h"
 
@@ -3508,6 +3509,7 @@ EXPORT_SYMBOL(skb_gro_reset_offset);
 
 gro_result_t napi_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 {
+	skb_mark_napi_id(skb, napi);
 	skb_gro_reset_offset(skb);
 
 	return napi_skb_finish(__napi_gro_receive(napi, skb), skb);
@@ -3610,6 +3612,7 @@ gro_result_t napi_gro_frags(struct napi_struct *napi)
 	if (!skb)
 		return GRO_DROP;
 
+	skb_mark_napi_id(skb, napi);
 	return napi_frags_finish(napi, skb, __napi_gro_receive(napi, skb));
 }
 EXPORT_SYMBOL(napi_gro_frags);
@@ -3744,6 +3747,128 @@ void napi_complete(struct napi_struct *n)
 }
 EXPORT_SYMBOL(napi_complete);
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+#define NAPI_HASH_SIZE		256
+#define BUSY_POLL_BUDGET	8
+
+unsigned int sysctl_net_busy_read __read_mostly;
+
+static struct hlist_head napi_hash[NAPI_HASH_SIZE];
+static DEFINE_SPINLOCK(napi_hash_lock);
+static unsigned int napi_gen_id;
+
+/* called under rcu_read_lock() or napi_hash_lock */
+static struct napi_struct *napi_by_id(unsigned int napi_id)
+{
+	struct hlist_node *node;
+	struct napi_struct *napi;
+
+	hlist_for_each_entry_rcu(napi, node,
+				 &napi_hash[napi_id % NAPI_HASH_SIZE],
+				 napi_hash_node)
+		if (napi->napi_id == napi_id)
+			return napi;
+	return NULL;
+}
+
+static void napi_hash_add(struct napi_struct *napi)
+{
+	spin_lock(&napi_hash_lock);
+	/* 0 is what sockets and skbs not from NAPI carry */
+	do {
+		if (unlikely(++napi_gen_id == 0))
+			napi_gen_id = 1;
+	} while (napi_by_id(napi_gen_id));
+	napi->napi_id = napi_gen_id;
+	hlist_add_head_rcu(&napi->napi_hash_node,
+			   &napi_hash[napi->napi_id % NAPI_HASH_SIZE]);
+	spin_unlock(&napi_hash_lock);
+}
+
+static bool napi_hash_del(struct napi_struct *napi)
+{
+	bool hashed = false;
+
+	spin_lock(&napi_hash_lock);
+	if (napi->napi_id) {
+		hlist_del_rcu(&napi->napi_hash_node);
+		napi->napi_id = 0;
+		hashed = true;
+	}
+	spin_unlock(&napi_hash_lock);
+	return hashed;
+}
+
+/**
+ *	sk_busy_loop - poll the receive path of a socket for a packet
+ *	@sk: socket whose receive queue is empty
+ *	@nonblock: poll once instead of for the socket's busy poll time
+ *
+ *	Polls the NAPI context the last packet of @sk came from whenever no
+ *	one else owns it, until a packet is queued on @sk, the time is up
+ *	or the task has something better to do.  Returns whether the receive
+ *	queue of @sk has a packet now.
+ */
+bool sk_busy_loop(struct sock *sk, int nonblock)
+{
+	u64 end_time = local_clock() +
+		(u64)ACCESS_ONCE(sk->sk_ll_usec) * NSEC_PER_USEC;
+	struct napi_struct *napi;
+	bool found = false;
+
+	sk->sk_ll_polls++;
+
+	rcu_read_lock_bh();
+	napi = napi_by_id(sk->sk_napi_id);
+	if (!napi)
+		goto out;
+
+	do {
+		if (napi_schedule_prep(napi)) {
+			void *have = netpoll_poll_lock(napi);
+			int work;
+
+			/* it was on no poll list while it was not scheduled */
+			INIT_LIST_HEAD(&napi->poll_list);
+			work = napi->poll(napi, BUSY_POLL_BUDGET);
+			trace_napi_poll(napi);
+
+			/* the driver left it scheduled, as net_rx_action would */
+			if (work == BUSY_POLL_BUDGET) {
+				if (unlikely(napi_disable_pending(napi)))
+					napi_complete(napi);
+				else
+					__napi_schedule(napi);
+			}
+			netpoll_poll_unlock(have);
+		}
+
+		found = !skb_queue_empty(&sk->sk_receive_queue);
+		if (found || nonblock)
+			break;
+		cpu_relax();
+	} while (local_clock() < end_time &&
+		 !need_resched() && !signal_pending(current));
+out:
+	rcu_read_unlock_bh();
+
+	/* unlocked, these only need to be roughly right */
+	if (found)
+		sk->sk_ll_hits++;
+	return found;
+}
+EXPORT_SYMBOL(sk_busy_loop);
+#else
+static inline void napi_hash_add(struct napi_struct *napi)
+{
+}
+
+static inline bool napi_hash_del(struct napi_struct *napi)
+{
+	return false;
+}
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
 void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 		    int (*poll)(struct napi_struct *, int), int weight)
 {
@@ -3760,6 +3885,7 @@ void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 	napi->poll_owner = -1;
 #endif
 	set_bit(NAPI_STATE_SCHED, &napi->state);
+	napi_hash_add(napi);
 }
 EXPORT_SYMBOL(netif_napi_add);
 
@@ -3767,6 +3893,10 @@ void netif_napi_del(struct napi_struct *napi)
 {
 	struct sk_buff *skb, *next;
 
+	/* busy polling sockets may still be looking at it */
+	if (napi_hash_del(napi))
+		synchronize_net();
+
 	list_del_init(&napi->dev_list);
 	napi_free_frags(napi);
 
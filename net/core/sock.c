@@ -125,6 +125,7 @@
 #include <net/xfrm.h>
 #include <linux/ipsec.h>
 #include <net/cls_cgroup.h>
+#include <net/busy_poll.h>
 
 #include <linux/filter.h>
 
@@ -741,6 +742,18 @@ set_rcvbuf:
 		else
 			sock_reset_flag(sk, SOCK_RXQ_OVFL);
 		break;
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	case SO_BUSY_POLL:
+		if (val < 0)
+			ret = -EINVAL;
+		else if (val > BUSY_POLL_MAX_USEC && val > sk->sk_ll_usec &&
+			 !capable(CAP_NET_ADMIN))
+			ret = -EPERM;
+		else
+			sk->sk_ll_usec = val;
+		break;
+#endif
 	default:
 		ret = -ENOPROTOOPT;
 		break;
@@ -779,6 +792,7 @@ int sock_getsockopt(struct socket *sock, int level, int optname,
 		int val;
 		struct linger ling;
 		struct timeval tm;
+		struct so_busy_poll_stats bp;
 	} v;
 
 	int lv = sizeof(int);
@@ -968,6 +982,18 @@ int sock_getsockopt(struct socket *sock, int level, int optname,
 		v.val = !!sock_flag(sk, SOCK_RXQ_OVFL);
 		break;
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	case SO_BUSY_POLL:
+		v.val = sk->sk_ll_usec;
+		break;
+
+	case SO_BUSY_POLL_STATS:
+		lv = sizeof(v.bp);
+		v.bp.polls = sk->sk_ll_polls;
+		v.bp.hits = sk->sk_ll_hits;
+		break;
+#endif
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -2017,6 +2043,13 @@ void sock_init_data(struct socket *sock, struct sock *sk)
 
 	sk->sk_stamp = ktime_set(-1L, 0);
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	sk->sk_napi_id		=	0;
+	sk->sk_ll_usec		=	sysctl_net_busy_read;
+	sk->sk_ll_polls		=	0;
+	sk->sk_ll_hits		=	0;
+#endif
+
 	/*
 	 * Before updating sk_refcnt, we must commit prior changes to memory
 	 * (Documentation/RCU/rculist_nulls.txt for details)
@@ -0,0 +1,636 @@
+/*
+ * Fast path for established forwarded IPv4 flows
+ *
+ * Once a forwarded TCP or UDP connection is established and assured, the
+ * address and port translation conntrack applies to it and the route it
+ * takes no longer change: every further packet walks the same tables and
+ * the same NAT binding only to be rewritten the same way.  The first such
+ * packet seen in POST_ROUTING, already translated, is used to learn the
+ * rewrite and the output route of its direction, and later packets of
+ * that direction are rewritten and handed to the output device from
+ * PRE_ROUTING, ahead of defragmentation, conntrack and the iptables rules.
+ *
+ * Anything unusual about a packet (options, fragments, an expiring TTL,
+ * an MTU that is too small, a stale route) sends it down the normal path,
+ * and TCP packets with FIN, RST or SYN set tear the flow down so that
+ * conntrack sees the end of the connection.  The packets and bytes that
+ * went through here are added to the conntrack counters and the
+ * connection's timeout is pushed back once a second; idle flows are
+ * dropped after NF_FLOW_IDLE_TIMEOUT.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/types.h>
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/netfilter/xt_qtaguid.h>
+#include <net/ip.h>
+#include <net/route.h>
+#include <net/neighbour.h>
+#include <net/checksum.h>
+#include <net/net_namespace.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_acct.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define NF_FLOW_HASH_SIZE	1024
+#define NF_FLOW_MAX		4096
+#define NF_FLOW_GC_INTERVAL	HZ
+#define NF_FLOW_IDLE_TIMEOUT	(30 * HZ)
+
+struct nf_flow_key {
+	__be32	saddr;
+	__be32	daddr;
+	__be16	sport;
+	__be16	dport;
+	u8	proto;
+	int	iif;
+};
+
+struct nf_flow {
+	struct hlist_node	hnode;
+	struct nf_flow_key	key;
+
+	/* what the packet looks like once translated */
+	__be32			new_saddr;
+	__be32			new_daddr;
+	__be16			new_sport;
+	__be16			new_dport;
+
+	struct dst_entry	*dst;
+	struct nf_conn		*ct;
+	enum ip_conntrack_dir	dir;
+	unsigned long		timeout;
+	unsigned long		last_used;
+	bool			dead;
+
+	atomic64_t		packets;
+	atomic64_t		bytes;
+	/* how much of the above conntrack was told about */
+	u64			synced_packets;
+	u64			synced_bytes;
+
+	struct rcu_head		rcu;
+};
+
+static int nf_flow_enable __read_mostly = 1;
+module_param_named(enable, nf_flow_enable, int, 0644);
+MODULE_PARM_DESC(enable, "Take established forwarded flows off the slow path");
+
+static struct hlist_head nf_flow_hash[NF_FLOW_HASH_SIZE] __read_mostly;
+static DEFINE_SPINLOCK(nf_flow_lock);
+static unsigned int nf_flow_count;
+static u32 nf_flow_rnd __read_mostly;
+static struct kmem_cache *nf_flow_cachep __read_mostly;
+
+static void nf_flow_gc(struct work_struct *work);
+static DECLARE_DELAYED_WORK(nf_flow_gc_work, nf_flow_gc);
+
+static u32 nf_flow_hashfn(const struct nf_flow_key *key)
+{
+	return jhash_3words((__force u32)key->saddr, (__force u32)key->daddr,
+			    ((__force u32)key->sport << 16 |
+			     (__force u32)key->dport) ^ key->proto ^ key->iif,
+			    nf_flow_rnd) & (NF_FLOW_HASH_SIZE - 1);
+}
+
+/* called under rcu_read_lock() or nf_flow_lock */
+static struct nf_flow *nf_flow_lookup(const struct nf_flow_key *key)
+{
+	struct hlist_node *n;
+	struct nf_flow *flow;
+
+	hlist_for_each_entry_rcu(flow, n, &nf_flow_hash[nf_flow_hashfn(key)],
+				 hnode) {
+		if (!memcmp(&flow->key, key, sizeof(*key)))
+			return flow;
+	}
+	return NULL;
+}
+
+static void nf_flow_free_rcu(struct rcu_head *head)
+{
+	struct nf_flow *flow = container_of(head, struct nf_flow, rcu);
+
+	dst_release(flow->dst);
+	nf_ct_put(flow->ct);
+	kmem_cache_free(nf_flow_cachep, flow);
+}
+
+/* called with BHs off and nf_flow_lock held */
+static void nf_flow_sync(struct nf_flow *flow)
+{
+	struct nf_conn *ct = flow->ct;
+	struct nf_conn_counter *acct;
+	u64 packets, bytes;
+
+	packets = atomic64_read(&flow->packets);
+	if (packets == flow->synced_packets)
+		return;
+	bytes = atomic64_read(&flow->bytes);
+
+	spin_lock(&ct->lock);
+	acct = nf_conn_acct_find(ct);
+	if (acct) {
+		acct[flow->dir].packets += packets - flow->synced_packets;
+		acct[flow->dir].bytes += bytes - flow->synced_bytes;
+	}
+	if (!nf_ct_is_dying(ct))
+		mod_timer_pending(&ct->timeout, jiffies + flow->timeout);
+	spin_unlock(&ct->lock);
+
+	flow->synced_packets = packets;
+	flow->synced_bytes = bytes;
+}
+
+/* called with BHs off and nf_flow_lock held */
+static void __nf_flow_remove(struct nf_flow *flow)
+{
+	if (flow->dead)
+		return;
+	flow->dead = true;
+	nf_flow_sync(flow);
+	hlist_del_rcu(&flow->hnode);
+	nf_flow_count--;
+	call_rcu(&flow->rcu, nf_flow_free_rcu);
+}
+
+/* from the packet path, which runs with BHs off */
+static void nf_flow_teardown(struct nf_flow *flow)
+{
+	spin_lock(&nf_flow_lock);
+	__nf_flow_remove(flow);
+	spin_unlock(&nf_flow_lock);
+}
+
+static void nf_flow_learn(const struct nf_flow_key *key, struct nf_conn *ct,
+			  enum ip_conntrack_dir dir, const struct iphdr *iph,
+			  const __be16 *ports, struct dst_entry *dst)
+{
+	struct nf_flow *flow;
+	long timeout;
+
+	if (nf_flow_lookup(key) || nf_flow_count >= NF_FLOW_MAX)
+		return;
+
+	timeout = (long)(ct->timeout.expires - jiffies);
+	if (timeout <= 0)
+		return;
+
+	flow = kmem_cache_zalloc(nf_flow_cachep, GFP_ATOMIC);
+	if (!flow)
+		return;
+
+	flow->key = *key;
+	flow->new_saddr = iph->saddr;
+	flow->new_daddr = iph->daddr;
+	flow->new_sport = ports[0];
+	flow->new_dport = ports[1];
+	flow->dir = dir;
+	flow->timeout = timeout;
+	flow->last_used = jiffies;
+	atomic64_set(&flow->packets, 0);
+	atomic64_set(&flow->bytes, 0);
+
+	/*
+	 * The tracked window stops moving while packets go around conntrack,
+	 * so stop checking it for whatever still comes through the slow path.
+	 */
+	if (key->proto == IPPROTO_TCP) {
+		spin_lock(&ct->lock);
+		ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		spin_unlock(&ct->lock);
+	}
+
+	spin_lock(&nf_flow_lock);
+	if (nf_flow_lookup(key) || nf_flow_count >= NF_FLOW_MAX) {
+		spin_unlock(&nf_flow_lock);
+		kmem_cache_free(nf_flow_cachep, flow);
+		return;
+	}
+	nf_conntrack_get(&ct->ct_general);
+	flow->ct = ct;
+	flow->dst = dst_clone(dst);
+	hlist_add_head_rcu(&flow->hnode, &nf_flow_hash[nf_flow_hashfn(key)]);
+	nf_flow_count++;
+	spin_unlock(&nf_flow_lock);
+}
+
+static unsigned int nf_flow_out(unsigned int hooknum, struct sk_buff *skb,
+				const struct net_device *in,
+				const struct net_device *out,
+				int (*okfn)(struct sk_buff *))
+{
+	const struct nf_conntrack_tuple *tuple;
+	enum ip_conntrack_info ctinfo;
+	struct nf_flow_key key;
+	struct dst_entry *dst;
+	const struct iphdr *iph;
+	struct nf_conn *ct;
+	union {
+		struct tcphdr tcp;
+		struct udphdr udp;
+	} _hdr, *hp;
+	unsigned int thlen;
+
+	if (!nf_flow_enable || !(IPCB(skb)->flags & IPSKB_FORWARDED))
+		return NF_ACCEPT;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || nf_ct_is_untracked(ct))
+		return NF_ACCEPT;
+	if (ctinfo != IP_CT_ESTABLISHED && ctinfo != IP_CT_ESTABLISHED_REPLY)
+		return NF_ACCEPT;
+	if (!test_bit(IPS_ASSURED_BIT, &ct->status) ||
+	    test_bit(IPS_SEQ_ADJUST_BIT, &ct->status) ||
+	    nf_ct_is_dying(ct) || nfct_help(ct))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || iph->frag_off & htons(IP_MF | IP_OFFSET))
+		return NF_ACCEPT;
+
+	dst = skb_dst(skb);
+	if (!dst || dst->xfrm ||
+	    ((struct rtable *)dst)->rt_type != RTN_UNICAST)
+		return NF_ACCEPT;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		if (ct->proto.tcp.state != TCP_CONNTRACK_ESTABLISHED)
+			return NF_ACCEPT;
+		thlen = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		thlen = sizeof(struct udphdr);
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+
+	hp = skb_header_pointer(skb, sizeof(*iph), thlen, &_hdr);
+	if (!hp)
+		return NF_ACCEPT;
+	if (iph->protocol == IPPROTO_TCP &&
+	    (hp->tcp.fin || hp->tcp.rst || hp->tcp.syn))
+		return NF_ACCEPT;
+
+	/* the key is the packet as it arrived, before any translation */
+	tuple = &ct->tuplehash[CTINFO2DIR(ctinfo)].tuple;
+	memset(&key, 0, sizeof(key));
+	key.saddr = tuple->src.u3.ip;
+	key.daddr = tuple->dst.u3.ip;
+	key.sport = tuple->src.u.all;
+	key.dport = tuple->dst.u.all;
+	key.proto = iph->protocol;
+	key.iif = skb->skb_iif;
+
+	nf_flow_learn(&key, ct, CTINFO2DIR(ctinfo), iph,
+		      (const __be16 *)hp, dst);
+	return NF_ACCEPT;
+}
+
+static void nf_flow_mangle(const struct nf_flow *flow, struct sk_buff *skb,
+			   struct iphdr *iph)
+{
+	__be16 *ports = (__be16 *)(iph + 1);
+	__sum16 *check = NULL;
+
+	if (iph->protocol == IPPROTO_TCP) {
+		check = &((struct tcphdr *)ports)->check;
+	} else {
+		struct udphdr *uh = (struct udphdr *)ports;
+
+		if (uh->check || skb->ip_summed == CHECKSUM_PARTIAL)
+			check = &uh->check;
+	}
+
+	if (iph->saddr != flow->new_saddr) {
+		csum_replace4(&iph->check, iph->saddr, flow->new_saddr);
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->saddr,
+						 flow->new_saddr, 1);
+		iph->saddr = flow->new_saddr;
+	}
+	if (iph->daddr != flow->new_daddr) {
+		csum_replace4(&iph->check, iph->daddr, flow->new_daddr);
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->daddr,
+						 flow->new_daddr, 1);
+		iph->daddr = flow->new_daddr;
+	}
+	if (ports[0] != flow->new_sport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[0],
+						 flow->new_sport, 0);
+		ports[0] = flow->new_sport;
+	}
+	if (ports[1] != flow->new_dport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[1],
+						 flow->new_dport, 0);
+		ports[1] = flow->new_dport;
+	}
+
+	if (iph->protocol == IPPROTO_UDP && check && !*check)
+		*check = CSUM_MANGLED_0;
+}
+
+/* the tail of ip_finish_output2(), under the hook's rcu_read_lock() */
+static void nf_flow_xmit(struct sk_buff *skb, struct dst_entry *dst)
+{
+	struct neighbour *neigh;
+
+	if (dst->hh) {
+		neigh_hh_output(dst->hh, skb);
+		return;
+	}
+	neigh = dst_get_neighbour(dst);
+	if (neigh)
+		neigh->output(skb);
+	else
+		kfree_skb(skb);
+}
+
+static unsigned int nf_flow_in(unsigned int hooknum, struct sk_buff *skb,
+			       const struct net_device *in,
+			       const struct net_device *out,
+			       int (*okfn)(struct sk_buff *))
+{
+	struct nf_flow_key key;
+	struct net_device *dev;
+	struct dst_entry *dst;
+	struct nf_flow *flow;
+	struct iphdr *iph;
+	unsigned int thlen;
+	__be16 *ports;
+
+	if (!nf_flow_enable || skb->pkt_type != PACKET_HOST)
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || iph->frag_off & htons(IP_MF | IP_OFFSET) ||
+	    iph->ttl <= 1)
+		return NF_ACCEPT;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		thlen = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		thlen = sizeof(struct udphdr);
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+	if (!pskb_may_pull(skb, sizeof(*iph) + thlen))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	ports = (__be16 *)(iph + 1);
+	memset(&key, 0, sizeof(key));
+	key.saddr = iph->saddr;
+	key.daddr = iph->daddr;
+	key.sport = ports[0];
+	key.dport = ports[1];
+	key.proto = iph->protocol;
+	key.iif = in->ifindex;
+
+	flow = nf_flow_lookup(&key);
+	if (!flow)
+		return NF_ACCEPT;
+
+	if (iph->protocol == IPPROTO_TCP) {
+		struct tcphdr *th = (struct tcphdr *)ports;
+
+		if (th->fin || th->rst || th->syn) {
+			nf_flow_teardown(flow);
+			return NF_ACCEPT;
+		}
+	}
+
+	dst = flow->dst;
+	if (!dst_check(dst, 0)) {
+		nf_flow_teardown(flow);
+		return NF_ACCEPT;
+	}
+	dev = dst->dev;
+	if (skb->len > dst_mtu(dst) && !skb_is_gso(skb))
+		return NF_ACCEPT;
+	if (unlikely(skb_headroom(skb) < LL_RESERVED_SPACE(dev) &&
+		     dev->header_ops))
+		return NF_ACCEPT;
+	if (!skb_make_writable(skb, sizeof(*iph) + thlen))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	nf_flow_mangle(flow, skb, iph);
+	ip_decrease_ttl(iph);
+	skb->priority = rt_tos2priority(iph->tos);
+
+	flow->last_used = jiffies;
+	atomic64_inc(&flow->packets);
+	atomic64_add(skb->len, &flow->bytes);
+#ifdef CONFIG_NETFILTER_XT_MATCH_QTAGUID
+	qtaguid_account_iface(in, false, iph->protocol, skb->len);
+	qtaguid_account_iface(dev, true, iph->protocol, skb->len);
+#endif
+	IP_INC_STATS_BH(dev_net(dev), IPSTATS_MIB_OUTFORWDATAGRAMS);
+
+	skb_dst_drop(skb);
+	skb_dst_set(skb, dst_clone(dst));
+	skb->dev = dev;
+	skb->protocol = htons(ETH_P_IP);
+	nf_flow_xmit(skb, dst);
+	return NF_STOLEN;
+}
+
+static void nf_flow_gc(struct work_struct *work)
+{
+	struct hlist_node *n, *tmp;
+	struct nf_flow *flow;
+	int i;
+
+	spin_lock_bh(&nf_flow_lock);
+	for (i = 0; i < NF_FLOW_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(flow, n, tmp, &nf_flow_hash[i],
+					  hnode) {
+			if (!nf_flow_enable || nf_ct_is_dying(flow->ct) ||
+			    time_after(jiffies, flow->last_used +
+				       NF_FLOW_IDLE_TIMEOUT))
+				__nf_flow_remove(flow);
+			else
+				nf_flow_sync(flow);
+		}
+	}
+	spin_unlock_bh(&nf_flow_lock);
+
+	schedule_delayed_work(&nf_flow_gc_work, NF_FLOW_GC_INTERVAL);
+}
+
+/* drop the flows through @dev, or all of them */
+static void nf_flow_flush(const struct net_device *dev)
+{
+	struct hlist_node *n, *tmp;
+	struct nf_flow *flow;
+	int i;
+
+	spin_lock_bh(&nf_flow_lock);
+	for (i = 0; i < NF_FLOW_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(flow, n, tmp, &nf_flow_hash[i],
+					  hnode) {
+			if (!dev || flow->dst->dev == dev ||
+			    flow->key.iif == dev->ifindex)
+				__nf_flow_remove(flow);
+		}
+	}
+	spin_unlock_bh(&nf_flow_lock);
+}
+
+static int nf_flow_netdev_event(struct notifier_block *this,
+				unsigned long event, void *ptr)
+{
+	struct net_device *dev = ptr;
+
+	if (event == NETDEV_DOWN || event == NETDEV_UNREGISTER)
+		nf_flow_flush(dev);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block nf_flow_netdev_notifier = {
+	.notifier_call = nf_flow_netdev_event,
+};
+
+#ifdef CONFIG_PROC_FS
+static int nf_flow_seq_show(struct seq_file *s, void *v)
+{
+	struct hlist_node *n;
+	struct nf_flow *flow;
+	int i;
+
+	seq_printf(s, "%u flows\n", nf_flow_count);
+	rcu_read_lock();
+	for (i = 0; i < NF_FLOW_HASH_SIZE; i++) {
+		hlist_for_each_entry_rcu(flow, n, &nf_flow_hash[i], hnode) {
+			seq_printf(s, "%s iif=%d src=%pI4:%u dst=%pI4:%u "
+				   "-> src=%pI4:%u dst=%pI4:%u dev=%s "
+				   "packets=%llu bytes=%llu idle=%u\n",
+				   flow->key.proto == IPPROTO_TCP ? "tcp" : "udp",
+				   flow->key.iif,
+				   &flow->key.saddr, ntohs(flow->key.sport),
+				   &flow->key.daddr, ntohs(flow->key.dport),
+				   &flow->new_saddr, ntohs(flow->new_sport),
+				   &flow->new_daddr, ntohs(flow->new_dport),
+				   flow->dst->dev->name,
+				   (unsigned long long)
+					atomic64_read(&flow->packets),
+				   (unsigned long long)
+					atomic64_read(&flow->bytes),
+				   jiffies_to_msecs(jiffies - flow->last_used));
+		}
+	}
+	rcu_read_unlock();
+	return 0;
+}
+
+static int nf_flow_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nf_flow_seq_show, NULL);
+}
+
+static const struct file_operations nf_flow_seq_fops = {
+	.owner		= THIS_MODULE,
+	.open		= nf_flow_seq_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static struct nf_hook_ops nf_flow_ops[] __read_mostly = {
+	{
+		.hook		= nf_flow_in,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_CONNTRACK_DEFRAG - 1,
+	},
+	{
+		.hook		= nf_flow_out,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_POST_ROUTING,
+		.priority	= NF_IP_PRI_LAST,
+	},
+};
+
+static int __init nf_flow_init(void)
+{
+	int ret;
+
+	get_random_bytes(&nf_flow_rnd, sizeof(nf_flow_rnd));
+
+	nf_flow_cachep = kmem_cache_create("nf_flow_offload",
+					   sizeof(struct nf_flow), 0, 0, NULL);
+	if (!nf_flow_cachep)
+		return -ENOMEM;
+
+	ret = register_netdevice_notifier(&nf_flow_netdev_notifier);
+	if (ret < 0)
+		goto err_cache;
+
+	ret = nf_register_hooks(nf_flow_ops, ARRAY_SIZE(nf_flow_ops));
+	if (ret < 0)
+		goto err_notifier;
+
+#ifdef CONFIG_PROC_FS
+	if (!proc_net_fops_create(&init_net, "nf_flow_offload", S_IRUGO,
+				  &nf_flow_seq_fops))
+		pr_warn("nf_flow_offload: cannot create /proc/net entry\n");
+#endif
+
+	schedule_delayed_work(&nf_flow_gc_work, NF_FLOW_GC_INTERVAL);
+	return 0;
+
+err_notifier:
+	unregister_netdevice_notifier(&nf_flow_netdev_notifier);
+err_cache:
+	kmem_cache_destroy(nf_flow_cachep);
+	return ret;
+}
+
+static void __exit nf_flow_fini(void)
+{
+#ifdef CONFIG_PROC_FS
+	proc_net_remove(&init_net, "nf_flow_offload");
+#endif
+	nf_unregister_hooks(nf_flow_ops, ARRAY_SIZE(nf_flow_ops));
+	cancel_delayed_work_sync(&nf_flow_gc_work);
+	unregister_netdevice_notifier(&nf_flow_netdev_notifier);
+	nf_flow_flush(NULL);
+	rcu_barrier();
+	kmem_cache_destroy(nf_flow_cachep);
+}
+
+module_init(nf_flow_init);
+module_exit(nf_flow_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Fast path for established forwarded IPv4 flows");
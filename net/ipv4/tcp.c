@@ -1817,6 +1817,13 @@ void tcp_set_state(struct sock *sk, int state)
 		if (oldstate == TCP_CLOSE_WAIT || oldstate == TCP_ESTABLISHED)
 			TCP_INC_STATS(sock_net(sk), TCP_MIB_ESTABRESETS);
 
+		/* A connection that never left its initial slow start */
+		if ((1 << oldstate) & (TCPF_ESTABLISHED | TCPF_FIN_WAIT1 |
+				       TCPF_FIN_WAIT2 | TCPF_CLOSE_WAIT |
+				       TCPF_LAST_ACK | TCPF_CLOSING) &&
+		    tcp_in_initial_slowstart(tcp_sk(sk)))
+			NET_INC_STATS(sock_net(sk), LINUX_MIB_TCPCLOSEINSLOWSTART);
+
 		sk->sk_prot->unhash(sk);
 		if (inet_csk(sk)->icsk_bind_hash &&
 		    !(sk->sk_userlocks & SOCK_BINDPORT_LOCK))
@@ -66,6 +66,7 @@
 #include <linux/module.h>
 #include <linux/sysctl.h>
 #include <linux/kernel.h>
+#include <linux/inetdevice.h>
 #include <net/dst.h>
 #include <net/tcp.h>
 #include <net/inet_common.h>
@@ -823,9 +824,44 @@ void tcp_update_metrics(struct sock *sk)
 	}
 }
 
+/*
+ * An initial window set on the route, or else on the interface it goes
+ * out of, in segments.  The interface one lets the connectivity service
+ * give a mobile data link its windows without touching every route.
+ */
+static __u32 tcp_dst_init_window(const struct dst_entry *dst, int metric,
+				 int devconf)
+{
+	struct in_device *in_dev;
+	__u32 win;
+
+	if (!dst)
+		return 0;
+
+	win = dst_metric(dst, metric);
+	if (win || !dst->dev)
+		return win;
+
+	rcu_read_lock();
+	in_dev = __in_dev_get_rcu(dst->dev);
+	if (in_dev)
+		win = max(ipv4_devconf_get(in_dev, devconf), 0);
+	rcu_read_unlock();
+
+	return win;
+}
+
+/* Initial receive window in segments, 0 when none is set */
+__u32 tcp_init_rwnd(const struct dst_entry *dst)
+{
+	return tcp_dst_init_window(dst, RTAX_INITRWND,
+				   IPV4_DEVCONF_TCP_INITRWND);
+}
+
 __u32 tcp_init_cwnd(struct tcp_sock *tp, struct dst_entry *dst)
 {
-	__u32 cwnd = (dst ? dst_metric(dst, RTAX_INITCWND) : 0);
+	__u32 cwnd = tcp_dst_init_window(dst, RTAX_INITCWND,
+					 IPV4_DEVCONF_TCP_INITCWND);
 
 	if (!cwnd)
 		cwnd = TCP_INIT_CWND;
@@ -245,8 +245,12 @@ void tcp_select_initial_window(int __space, __u32 mss,
 			*rcv_wnd = min(*rcv_wnd, init_cwnd * mss);
 	}
 
-                   /* Lock the initial TCP window size to 64K*/
-                    *rcv_wnd = 64240;
+	/* Unless the route or interface asks for a window of its own, start
+	 * at 64K, so that receive autotuning does not grow from a few
+	 * segments on every connection.
+	 */
+	if (!init_rcv_wnd)
+		*rcv_wnd = 64240;
 
 	/* Set the clamp no higher than max representable value */
 	(*window_clamp) = min(65535U << (*rcv_wscale), *window_clamp);
@@ -2461,7 +2465,7 @@ struct sk_buff *tcp_make_synack(struct sock *sk, struct dst_entry *dst,
 			&req->window_clamp,
 			ireq->wscale_ok,
 			&rcv_wscale,
-			dst_metric(dst, RTAX_INITRWND));
+			tcp_init_rwnd(dst));
 		ireq->rcv_wscale = rcv_wscale;
 	}
 
@@ -2591,7 +2595,7 @@ static void tcp_connect_init(struct sock *sk)
 				  &tp->window_clamp,
 				  sysctl_tcp_window_scaling,
 				  &rcv_wscale,
-				  dst_metric(dst, RTAX_INITRWND));
+				  tcp_init_rwnd(dst));
 
 	tp->rx_opt.rcv_wscale = rcv_wscale;
 	tp->rcv_ssthresh = tp->rcv_wnd;
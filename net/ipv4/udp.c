@@ -105,6 +105,7 @@
 #include <net/route.h>
 #include <net/checksum.h>
 #include <net/xfrm.h>
+#include <net/busy_poll.h>
 #include "udp_impl.h"
 
 struct udp_table udp_table __read_mostly;
@@ -786,6 +787,61 @@ out:
 }
 EXPORT_SYMBOL(udp_push_pending_frames);
 
+/*
+ * Unconnected sockets sending to the same peer again and again, as RTP
+ * streams and sendmmsg() batches do, keep the route of their last send
+ * and reuse it for as long as it is valid and the lookup would give it
+ * back anyway.  IPsec policies depend on more than the route, so nothing
+ * is reused while there are any.
+ */
+static struct rtable *udp_get_last_route(struct sock *sk, struct flowi4 *fl4)
+{
+	struct udp_sock *up = udp_sk(sk);
+	struct dst_entry *dst;
+	struct rtable *rt;
+
+	if (!ACCESS_ONCE(up->last_dst))
+		return NULL;
+	dst = xchg(&up->last_dst, NULL);
+	if (!dst)
+		return NULL;
+
+#ifdef CONFIG_XFRM
+	if (sk->sk_policy[1] ||
+	    sock_net(sk)->xfrm.policy_count[XFRM_POLICY_OUT])
+		goto drop;
+#endif
+	if (dst->obsolete > 0 || !dst_check(dst, 0))
+		goto drop;
+
+	rt = (struct rtable *)dst;
+	if (rt->rt_key_dst != fl4->daddr ||
+	    rt->rt_key_src != fl4->saddr ||
+	    rt->rt_oif != fl4->flowi4_oif ||
+	    rt->rt_mark != fl4->flowi4_mark ||
+	    rt->rt_uid != fl4->flowi4_uid ||
+	    ((rt->rt_key_tos ^ fl4->flowi4_tos) & (IPTOS_RT_MASK | RTO_ONLINK)))
+		goto drop;
+
+	dst_use(dst, jiffies);
+	if (!fl4->saddr)
+		fl4->saddr = rt->rt_src;
+	if (!fl4->daddr)
+		fl4->daddr = rt->rt_dst;
+	return rt;
+
+drop:
+	dst_release(dst);
+	return NULL;
+}
+
+static void udp_set_last_route(struct sock *sk, struct rtable *rt)
+{
+	if (rt->dst.xfrm)
+		return;
+	dst_release(xchg(&udp_sk(sk)->last_dst, dst_clone(&rt->dst)));
+}
+
 int udp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 		size_t len)
 {
@@ -932,14 +988,21 @@ int udp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 				   sock_i_uid(sk));
 
 		security_sk_classify_flow(sk, flowi4_to_flowi(fl4));
-		rt = ip_route_output_flow(net, fl4, sk);
-		if (IS_ERR(rt)) {
-			err = PTR_ERR(rt);
-			rt = NULL;
-			if (err == -ENETUNREACH)
-				IP_INC_STATS_BH(net, IPSTATS_MIB_OUTNOROUTES);
-			goto out;
+		if (!connected)
+			rt = udp_get_last_route(sk, fl4);
+		if (!rt) {
+			rt = ip_route_output_flow(net, fl4, sk);
+			if (IS_ERR(rt)) {
+				err = PTR_ERR(rt);
+				rt = NULL;
+				if (err == -ENETUNREACH)
+					IP_INC_STATS_BH(net,
+						IPSTATS_MIB_OUTNOROUTES);
+				goto out;
+			}
 		}
+		if (!connected)
+			udp_set_last_route(sk, rt);
 
 		err = -EACCES;
 		if ((rt->rt_flags & RTCF_BROADCAST) &&
@@ -1355,6 +1418,7 @@ static int __udp_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 
 	if (inet_sk(sk)->inet_daddr)
 		sock_rps_save_rxhash(sk, skb->rxhash);
+	sk_mark_napi_id(sk, skb);
 
 	rc = ip_queue_rcv_skb(sk, skb);
 	if (rc < 0) {
@@ -1719,6 +1783,7 @@ void udp_destroy_sock(struct sock *sk)
 	bool slow = lock_sock_fast(sk);
 	udp_flush_pending_frames(sk);
 	unlock_sock_fast(sk, slow);
+	dst_release(xchg(&udp_sk(sk)->last_dst, NULL));
 }
 
 /*
@@ -185,17 +185,26 @@ static struct proc_dir_entry *iface_stat_fmt_procfile;
  *     iface_stat_list_lock
  *
  * qtaguid_mt()
+ *   iface_stat_update_from_skb()
+ *     rcu_read_lock
  *   account_for_uid()
  *     if_tag_stat_update()
- *       get_sock_stat()
- *         sock_tag_list_lock
- *       struct iface_stat->tag_stat_list_lock
+ *       rcu_read_lock
+ *         get_sock_tag_rcu()
+ *           (sock_tag_seq)
+ *         tag_stat_tree_search_rcu()
+ *           (struct iface_stat->tag_stat_seq)
  *         tag_stat_update()
  *           get_active_counter_set()
- *             tag_counter_set_list_lock
+ *             (tag_counter_set_seq)
+ *       struct iface_stat->tag_stat_list_lock
  *         tag_stat_update()
  *           get_active_counter_set()
- *             tag_counter_set_list_lock
+ *             (tag_counter_set_seq)
+ *
+ * The packet path takes no lock once the entries it counts against
+ * exist: the trees it searches are also searched under RCU, and each of
+ * them only changes with its lock held and inside its seqcount.
  *
  *
  * qtaguid_ctrl_parse()
@@ -225,9 +234,11 @@ static DEFINE_SPINLOCK(iface_stat_list_lock);
 
 static struct rb_root sock_tag_tree = RB_ROOT;
 static DEFINE_SPINLOCK(sock_tag_list_lock);
+static seqcount_t sock_tag_seq = SEQCNT_ZERO;
 
 static struct rb_root tag_counter_set_tree = RB_ROOT;
 static DEFINE_SPINLOCK(tag_counter_set_list_lock);
+static seqcount_t tag_counter_set_seq = SEQCNT_ZERO;
 
 static struct rb_root uid_tag_data_tree = RB_ROOT;
 static DEFINE_SPINLOCK(uid_tag_data_tree_lock);
@@ -269,6 +280,44 @@ static inline void dc_add_byte_packets(struct data_counters *counters, int set,
 	counters->bpc[set][direction][ifs_proto].packets += packets;
 }
 
+/*
+ * Lookups without the tree lock, for the packet path.  A tree only changes
+ * with its lock held and inside its seqcount, and its nodes are freed
+ * after a grace period, so a walk under rcu_read_lock() that still sees
+ * the same sequence at the end found the right node.  A walk that runs
+ * into a rebalance may go astray, so it is bounded and then retried.
+ */
+#define TREE_WALK_MAX_DEPTH 64
+
+static struct tag_node *tag_node_tree_search_rcu(struct rb_root *root,
+						 seqcount_t *seq, tag_t tag)
+{
+	struct rb_node *node;
+	struct tag_node *found;
+	unsigned int start;
+	int depth, result;
+
+	do {
+		start = read_seqcount_begin(seq);
+		found = NULL;
+		node = ACCESS_ONCE(root->rb_node);
+		for (depth = 0; node && depth < TREE_WALK_MAX_DEPTH; depth++) {
+			struct tag_node *data = rb_entry(node, struct tag_node,
+							 node);
+			result = tag_compare(tag, data->tag);
+			if (result < 0) {
+				node = ACCESS_ONCE(node->rb_left);
+			} else if (result > 0) {
+				node = ACCESS_ONCE(node->rb_right);
+			} else {
+				found = data;
+				break;
+			}
+		}
+	} while (read_seqcount_retry(seq, start));
+	return found;
+}
+
 static struct tag_node *tag_node_tree_search(struct rb_root *root, tag_t tag)
 {
 	struct rb_node *node = root->rb_node;
@@ -379,6 +428,35 @@ static struct sock_tag *sock_tag_tree_search(struct rb_root *root,
 	return NULL;
 }
 
+/* The tag of sk, if it has one, looked up as tag_node_tree_search_rcu() */
+static bool get_sock_tag_rcu(const struct sock *sk, tag_t *tag)
+{
+	struct rb_node *node;
+	unsigned int start;
+	bool found;
+	int depth;
+
+	do {
+		start = read_seqcount_begin(&sock_tag_seq);
+		found = false;
+		node = ACCESS_ONCE(sock_tag_tree.rb_node);
+		for (depth = 0; node && depth < TREE_WALK_MAX_DEPTH; depth++) {
+			struct sock_tag *data = rb_entry(node, struct sock_tag,
+							 sock_node);
+			if (sk < data->sk) {
+				node = ACCESS_ONCE(node->rb_left);
+			} else if (sk > data->sk) {
+				node = ACCESS_ONCE(node->rb_right);
+			} else {
+				*tag = data->tag;
+				found = true;
+				break;
+			}
+		}
+	} while (read_seqcount_retry(&sock_tag_seq, start));
+	return found;
+}
+
 static void sock_tag_tree_insert(struct sock_tag *data, struct rb_root *root)
 {
 	struct rb_node **new = &(root->rb_node), *parent = NULL;
@@ -417,7 +495,7 @@ static void sock_tag_tree_erase(struct rb_root *st_to_free_tree)
 			 get_uid_from_tag(st_entry->tag));
 		rb_erase(&st_entry->sock_node, st_to_free_tree);
 		sockfd_put(st_entry->socket);
-		kfree(st_entry);
+		kfree_rcu(st_entry, rcu);
 	}
 }
 
@@ -732,23 +810,28 @@ static int get_active_counter_set(tag_t tag)
 {
 	int active_set = 0;
 	struct tag_counter_set *tcs;
+	struct tag_node *tn;
 
 	MT_DEBUG("qtaguid: get_active_counter_set(tag=0x%llx)"
 		 " (uid=%u)\n",
 		 tag, get_uid_from_tag(tag));
 	/* For now we only handle UID tags for active sets */
 	tag = get_utag_from_tag(tag);
-	spin_lock_bh(&tag_counter_set_list_lock);
-	tcs = tag_counter_set_tree_search(&tag_counter_set_tree, tag);
-	if (tcs)
-		active_set = tcs->active_set;
-	spin_unlock_bh(&tag_counter_set_list_lock);
+	rcu_read_lock();
+	tn = tag_node_tree_search_rcu(&tag_counter_set_tree,
+				      &tag_counter_set_seq, tag);
+	if (tn) {
+		tcs = rb_entry(&tn->node, struct tag_counter_set, tn.node);
+		active_set = ACCESS_ONCE(tcs->active_set);
+	}
+	rcu_read_unlock();
 	return active_set;
 }
 
 /*
  * Find the entry for tracking the specified interface.
- * Caller must hold iface_stat_list_lock
+ * Caller must hold iface_stat_list_lock or rcu_read_lock().  Entries are
+ * never freed, so they can still be used after either is dropped.
  */
 static struct iface_stat *get_iface_entry(const char *ifname)
 {
@@ -761,7 +844,7 @@ static struct iface_stat *get_iface_entry(const char *ifname)
 	}
 
 	/* Iterate over interfaces */
-	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+	list_for_each_entry_rcu(iface_entry, &iface_stat_list, list) {
 		if (!strcmp(ifname, iface_entry->ifname))
 			goto done;
 	}
@@ -788,9 +871,9 @@ static int pp_iface_stat_line(bool header, char *outp,
 			       "tx_other_bytes tx_other_packets\n"
 			);
 	} else {
-		struct data_counters *cnts;
+		struct data_counters totals, *cnts = &totals;
 		int cnt_set = 0;   /* We only use one set for the device */
-		cnts = &iface_entry->totals_via_skb;
+		dc_cpu_sum(iface_entry->totals_via_skb, cnts);
 		len = snprintf(
 			outp, char_count,
 			"%s "
@@ -991,7 +1074,16 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 		kfree(new_iface);
 		return NULL;
 	}
+	new_iface->totals_via_skb = dc_cpu_alloc(GFP_ATOMIC);
+	if (new_iface->totals_via_skb == NULL) {
+		pr_err("qtaguid: iface_stat: create(%s): "
+		       "counters alloc failed\n", net_dev->name);
+		kfree(new_iface->ifname);
+		kfree(new_iface);
+		return NULL;
+	}
 	spin_lock_init(&new_iface->tag_stat_list_lock);
+	seqcount_init(&new_iface->tag_stat_seq);
 	new_iface->tag_stat_tree = RB_ROOT;
 	_iface_stat_set_active(new_iface, net_dev, true);
 
@@ -1004,6 +1096,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 		pr_err("qtaguid: iface_stat: create(%s): "
 		       "work alloc failed\n", new_iface->ifname);
 		_iface_stat_set_active(new_iface, net_dev, false);
+		kfree(new_iface->totals_via_skb);
 		kfree(new_iface->ifname);
 		kfree(new_iface);
 		return NULL;
@@ -1011,7 +1104,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	isw->iface_entry = new_iface;
 	INIT_WORK(&isw->iface_work, iface_create_proc_worker);
 	schedule_work(&isw->iface_work);
-	list_add(&new_iface->list, &iface_stat_list);
+	list_add_rcu(&new_iface->list, &iface_stat_list);
 	return new_iface;
 }
 
@@ -1192,18 +1285,6 @@ static struct sock_tag *get_sock_stat_nl(const struct sock *sk)
 	return sock_tag_tree_search(&sock_tag_tree, sk);
 }
 
-static struct sock_tag *get_sock_stat(const struct sock *sk)
-{
-	struct sock_tag *sock_tag_entry;
-	MT_DEBUG("qtaguid: get_sock_stat(sk=%p)\n", sk);
-	if (!sk)
-		return NULL;
-	spin_lock_bh(&sock_tag_list_lock);
-	sock_tag_entry = get_sock_stat_nl(sk);
-	spin_unlock_bh(&sock_tag_list_lock);
-	return sock_tag_entry;
-}
-
 static int ipx_proto(const struct sk_buff *skb,
 		     struct xt_action_param *par)
 {
@@ -1225,10 +1306,18 @@ static int ipx_proto(const struct sk_buff *skb,
 	return tproto;
 }
 
+/* Called from both the softirq and the process side of the stack */
 static void
-data_counters_update(struct data_counters *dc, int set,
+data_counters_update(struct data_counters_cpu *pc, int set,
 		     enum ifs_tx_rx direction, int proto, int bytes)
 {
+	struct data_counters_cpu *c;
+	struct data_counters *dc;
+
+	local_bh_disable();
+	c = &pc[smp_processor_id()];
+	dc = &c->dc;
+	u64_stats_update_begin(&c->syncp);
 	switch (proto) {
 	case IPPROTO_TCP:
 		dc_add_byte_packets(dc, set, direction, IFS_TCP, bytes, 1);
@@ -1242,6 +1331,8 @@ data_counters_update(struct data_counters *dc, int set,
 				    1);
 		break;
 	}
+	u64_stats_update_end(&c->syncp);
+	local_bh_enable();
 }
 
 /*
@@ -1352,23 +1443,40 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 		 par->hooknum, __func__, el_dev->name, el_dev->type,
 		 par->family, proto, direction);
 
-	spin_lock_bh(&iface_stat_list_lock);
+	rcu_read_lock();
 	entry = get_iface_entry(el_dev->name);
+	rcu_read_unlock();
 	if (entry == NULL) {
 		IF_DEBUG("qtaguid[%d]: iface_stat: %s(%s): not tracked\n",
 			 par->hooknum, __func__, el_dev->name);
-		spin_unlock_bh(&iface_stat_list_lock);
 		return;
 	}
 
 	IF_DEBUG("qtaguid[%d]: %s(%s): entry=%p\n", par->hooknum,  __func__,
 		 el_dev->name, entry);
 
-	data_counters_update(&entry->totals_via_skb, 0, direction, proto,
+	data_counters_update(entry->totals_via_skb, 0, direction, proto,
 			     bytes);
-	spin_unlock_bh(&iface_stat_list_lock);
 }
 
+/*
+ * For forwarding paths that move packets without going through the
+ * iptables rules, so that the interface totals still see them.
+ */
+void qtaguid_account_iface(const struct net_device *dev, bool tx, int proto,
+			   unsigned int bytes)
+{
+	struct iface_stat *entry;
+
+	rcu_read_lock();
+	entry = get_iface_entry(dev->name);
+	if (entry)
+		data_counters_update(entry->totals_via_skb, 0,
+				     tx ? IFS_TX : IFS_RX, proto, bytes);
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL_GPL(qtaguid_account_iface);
+
 static void tag_stat_update(struct tag_stat *tag_entry,
 			enum ifs_tx_rx direction, int proto, int bytes)
 {
@@ -1378,7 +1486,7 @@ static void tag_stat_update(struct tag_stat *tag_entry,
 		 "dir=%d proto=%d bytes=%d)\n",
 		 tag_entry->tn.tag, get_uid_from_tag(tag_entry->tn.tag),
 		 active_set, direction, proto, bytes);
-	data_counters_update(&tag_entry->counters, active_set, direction,
+	data_counters_update(tag_entry->counters, active_set, direction,
 			     proto, bytes);
 	if (tag_entry->parent_counters)
 		data_counters_update(tag_entry->parent_counters, active_set,
@@ -1387,11 +1495,12 @@ static void tag_stat_update(struct tag_stat *tag_entry,
 
 /*
  * Create a new entry for tracking the specified {acct_tag,uid_tag} within
- * the interface.
+ * the interface, also counting against parent_counters if given.
  * iface_entry->tag_stat_list_lock should be held.
  */
 static struct tag_stat *create_if_tag_stat(struct iface_stat *iface_entry,
-					   tag_t tag)
+					   tag_t tag,
+					   struct data_counters_cpu *parent_counters)
 {
 	struct tag_stat *new_tag_stat_entry = NULL;
 	IF_DEBUG("qtaguid: iface_stat: %s(): ife=%p tag=0x%llx"
@@ -1402,21 +1511,39 @@ static struct tag_stat *create_if_tag_stat(struct iface_stat *iface_entry,
 		pr_err("qtaguid: iface_stat: tag stat alloc failed\n");
 		goto done;
 	}
+	new_tag_stat_entry->counters = dc_cpu_alloc(GFP_ATOMIC);
+	if (!new_tag_stat_entry->counters) {
+		pr_err("qtaguid: iface_stat: tag stat counters alloc failed\n");
+		kfree(new_tag_stat_entry);
+		new_tag_stat_entry = NULL;
+		goto done;
+	}
 	new_tag_stat_entry->tn.tag = tag;
+	new_tag_stat_entry->parent_counters = parent_counters;
+	write_seqcount_begin(&iface_entry->tag_stat_seq);
 	tag_stat_tree_insert(new_tag_stat_entry, &iface_entry->tag_stat_tree);
+	write_seqcount_end(&iface_entry->tag_stat_seq);
 done:
 	return new_tag_stat_entry;
 }
 
+static void tag_stat_free_rcu(struct rcu_head *head)
+{
+	struct tag_stat *ts_entry = container_of(head, struct tag_stat, rcu);
+
+	kfree(ts_entry->counters);
+	kfree(ts_entry);
+}
+
 static void if_tag_stat_update(const char *ifname, uid_t uid,
 			       const struct sock *sk, enum ifs_tx_rx direction,
 			       int proto, int bytes)
 {
 	struct tag_stat *tag_stat_entry;
+	struct tag_node *tn;
 	tag_t tag, acct_tag;
 	tag_t uid_tag;
-	struct data_counters *uid_tag_counters;
-	struct sock_tag *sock_tag_entry;
+	struct data_counters_cpu *uid_tag_counters;
 	struct iface_stat *iface_entry;
 	struct tag_stat *new_tag_stat = NULL;
 	MT_DEBUG("qtaguid: if_tag_stat_update(ifname=%s "
@@ -1424,8 +1551,10 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 ifname, uid, sk, direction, proto, bytes);
 
 
+	rcu_read_lock();
 	iface_entry = get_iface_entry(ifname);
 	if (!iface_entry) {
+		rcu_read_unlock();
 		pr_err_ratelimited("qtaguid: tag_stat: stat_update() "
 				   "%s not found\n", ifname);
 		return;
@@ -1439,9 +1568,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	 * Look for a tagged sock.
 	 * It will have an acct_uid.
 	 */
-	sock_tag_entry = get_sock_stat(sk);
-	if (sock_tag_entry) {
-		tag = sock_tag_entry->tag;
+	if (sk && get_sock_tag_rcu(sk, &tag)) {
 		acct_tag = get_atag_from_tag(tag);
 		uid_tag = get_utag_from_tag(tag);
 	} else {
@@ -1452,6 +1579,17 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	MT_DEBUG("qtaguid: tag_stat: stat_update(): "
 		 " looking for tag=0x%llx (uid=%u) in ife=%p\n",
 		 tag, get_uid_from_tag(tag), iface_entry);
+	/* Counting against entries that exist needs no lock */
+	tn = tag_node_tree_search_rcu(&iface_entry->tag_stat_tree,
+				      &iface_entry->tag_stat_seq, tag);
+	if (tn) {
+		tag_stat_entry = rb_entry(&tn->node, struct tag_stat, tn.node);
+		tag_stat_update(tag_stat_entry, direction, proto, bytes);
+		rcu_read_unlock();
+		return;
+	}
+	rcu_read_unlock();
+
 	/* Loop over tag list under this interface for {acct_tag,uid_tag} */
 	spin_lock_bh(&iface_entry->tag_stat_list_lock);
 
@@ -1476,20 +1614,20 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 * No parent counters. So
 		 *  - No {0, uid_tag} stats and no {acc_tag, uid_tag} stats.
 		 */
-		new_tag_stat = create_if_tag_stat(iface_entry, uid_tag);
+		new_tag_stat = create_if_tag_stat(iface_entry, uid_tag, NULL);
 		if (!new_tag_stat)
 			goto unlock;
-		uid_tag_counters = &new_tag_stat->counters;
+		uid_tag_counters = new_tag_stat->counters;
 	} else {
-		uid_tag_counters = &tag_stat_entry->counters;
+		uid_tag_counters = tag_stat_entry->counters;
 	}
 
 	if (acct_tag) {
 		/* Create the child {acct_tag, uid_tag} and hook up parent. */
-		new_tag_stat = create_if_tag_stat(iface_entry, tag);
+		new_tag_stat = create_if_tag_stat(iface_entry, tag,
+						  uid_tag_counters);
 		if (!new_tag_stat)
 			goto unlock;
-		new_tag_stat->parent_counters = uid_tag_counters;
 	} else {
 		/*
 		 * For new_tag_stat to be still NULL here would require:
@@ -2094,9 +2232,11 @@ static int ctrl_cmd_delete(const char *input)
 			 input, st_entry->tag, entry_uid);
 
 		if (!acct_tag || st_entry->tag == tag) {
+			write_seqcount_begin(&sock_tag_seq);
 			rb_erase(&st_entry->sock_node, &sock_tag_tree);
 			/* Can't sockfd_put() within spinlock, do it later. */
 			sock_tag_tree_insert(st_entry, &st_to_free_tree);
+			write_seqcount_end(&sock_tag_seq);
 			tr_entry = lookup_tag_ref(st_entry->tag, NULL);
 			BUG_ON(tr_entry->num_sock_tags <= 0);
 			tr_entry->num_sock_tags--;
@@ -2126,8 +2266,10 @@ static int ctrl_cmd_delete(const char *input)
 			 tcs_entry->tn.tag,
 			 get_uid_from_tag(tcs_entry->tn.tag),
 			 tcs_entry->active_set);
+		write_seqcount_begin(&tag_counter_set_seq);
 		rb_erase(&tcs_entry->tn.node, &tag_counter_set_tree);
-		kfree(tcs_entry);
+		write_seqcount_end(&tag_counter_set_seq);
+		kfree_rcu(tcs_entry, rcu);
 	}
 	spin_unlock_bh(&tag_counter_set_list_lock);
 
@@ -2156,9 +2298,12 @@ static int ctrl_cmd_delete(const char *input)
 					 input, iface_entry->ifname,
 					 get_atag_from_tag(ts_entry->tn.tag),
 					 entry_uid);
+				write_seqcount_begin(
+					&iface_entry->tag_stat_seq);
 				rb_erase(&ts_entry->tn.node,
 					 &iface_entry->tag_stat_tree);
-				kfree(ts_entry);
+				write_seqcount_end(&iface_entry->tag_stat_seq);
+				call_rcu(&ts_entry->rcu, tag_stat_free_rcu);
 			}
 		}
 		spin_unlock_bh(&iface_entry->tag_stat_list_lock);
@@ -2240,7 +2385,9 @@ static int ctrl_cmd_counter_set(const char *input)
 			goto err;
 		}
 		tcs->tn.tag = tag;
+		write_seqcount_begin(&tag_counter_set_seq);
 		tag_counter_set_tree_insert(tcs, &tag_counter_set_tree);
+		write_seqcount_end(&tag_counter_set_seq);
 		CT_DEBUG("qtaguid: ctrl_counterset(%s): added tcs tag=0x%llx "
 			 "(uid=%u) set=%d\n",
 			 input, tag, get_uid_from_tag(tag), counter_set);
@@ -2342,7 +2489,9 @@ static int ctrl_cmd_tag(const char *input)
 		BUG_ON(IS_ERR_OR_NULL(prev_tag_ref_entry));
 		BUG_ON(prev_tag_ref_entry->num_sock_tags <= 0);
 		prev_tag_ref_entry->num_sock_tags--;
+		write_seqcount_begin(&sock_tag_seq);
 		sock_tag_entry->tag = full_tag;
+		write_seqcount_end(&sock_tag_seq);
 	} else {
 		CT_DEBUG("qtaguid: ctrl_tag(%s): newtag for sk=%p\n",
 			 input, el_socket->sk);
@@ -2381,7 +2530,9 @@ static int ctrl_cmd_tag(const char *input)
 				 &pqd_entry->sock_tag_list);
 		spin_unlock_bh(&uid_tag_data_tree_lock);
 
+		write_seqcount_begin(&sock_tag_seq);
 		sock_tag_tree_insert(sock_tag_entry, &sock_tag_tree);
+		write_seqcount_end(&sock_tag_seq);
 		atomic64_inc(&qtu_events.sockets_tagged);
 	}
 	spin_unlock_bh(&sock_tag_list_lock);
@@ -2447,7 +2598,9 @@ static int ctrl_cmd_untag(const char *input)
 	 * The socket already belongs to the current process
 	 * so it can do whatever it wants to it.
 	 */
+	write_seqcount_begin(&sock_tag_seq);
 	rb_erase(&sock_tag_entry->sock_node, &sock_tag_tree);
+	write_seqcount_end(&sock_tag_seq);
 
 	tag_ref_entry = lookup_tag_ref(sock_tag_entry->tag, &utd_entry);
 	BUG_ON(!tag_ref_entry);
@@ -2484,7 +2637,7 @@ static int ctrl_cmd_untag(const char *input)
 		 atomic_long_read(&el_socket->file->f_count) - 1);
 	sockfd_put(el_socket);
 
-	kfree(sock_tag_entry);
+	kfree_rcu(sock_tag_entry, rcu);
 	atomic64_inc(&qtu_events.sockets_untagged);
 
 	return 0;
@@ -2571,7 +2724,7 @@ struct proc_print_info {
 static int pp_stats_line(struct proc_print_info *ppi, int cnt_set)
 {
 	int len;
-	struct data_counters *cnts;
+	struct data_counters counters, *cnts = &counters;
 
 	if (!ppi->item_index) {
 		if (ppi->item_index++ < ppi->items_to_skip)
@@ -2603,7 +2756,7 @@ static int pp_stats_line(struct proc_print_info *ppi, int cnt_set)
 		}
 		if (ppi->item_index++ < ppi->items_to_skip)
 			return 0;
-		cnts = &ppi->ts_entry->counters;
+		dc_cpu_sum(ppi->ts_entry->counters, cnts);
 		len = snprintf(
 			ppi->outp, ppi->char_count,
 			"%d %s 0x%llx %u %u "
@@ -2850,10 +3003,12 @@ static int qtudev_release(struct inode *inode, struct file *file)
 		tr->num_sock_tags--;
 		free_tag_ref_from_utd_entry(tr, utd_entry);
 
+		write_seqcount_begin(&sock_tag_seq);
 		rb_erase(&st_entry->sock_node, &sock_tag_tree);
 		list_del(&st_entry->list);
 		/* Can't sockfd_put() within spinlock, do it later. */
 		sock_tag_tree_insert(st_entry, &st_to_free_tree);
+		write_seqcount_end(&sock_tag_seq);
 
 		/*
 		 * Try to free the utd_entry if no other proc_qtu_data is
@@ -12,7 +12,12 @@
 
 #include <linux/types.h>
 #include <linux/rbtree.h>
+#include <linux/rcupdate.h>
+#include <linux/seqlock.h>
+#include <linux/slab.h>
 #include <linux/spinlock_types.h>
+#include <linux/string.h>
+#include <linux/u64_stats_sync.h>
 #include <linux/workqueue.h>
 
 /* Iface handling */
@@ -197,6 +202,50 @@ static inline uint64_t dc_sum_packets(struct data_counters *counters,
 		+ counters->bpc[set][direction][IFS_PROTO_OTHER].packets;
 }
 
+/*
+ * The counters updated per packet are kept per CPU, indexed by CPU id, so
+ * that the packet path only ever writes the copy of the CPU it runs on.
+ * Readers add the copies up with dc_cpu_sum().
+ */
+struct data_counters_cpu {
+	struct data_counters dc;
+	struct u64_stats_sync syncp;
+} ____cacheline_aligned_in_smp;
+
+static inline struct data_counters_cpu *dc_cpu_alloc(gfp_t gfp)
+{
+	return kcalloc(nr_cpu_ids, sizeof(struct data_counters_cpu), gfp);
+}
+
+static inline void dc_cpu_sum(struct data_counters_cpu *pc,
+			      struct data_counters *sum)
+{
+	int cpu, set, dir, proto;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		struct data_counters_cpu *c = &pc[cpu];
+		struct data_counters snap;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin_bh(&c->syncp);
+			snap = c->dc;
+		} while (u64_stats_fetch_retry_bh(&c->syncp, start));
+
+		for (set = 0; set < IFS_MAX_COUNTER_SETS; set++)
+			for (dir = 0; dir < IFS_MAX_DIRECTIONS; dir++)
+				for (proto = 0; proto < IFS_MAX_PROTOS; proto++) {
+					struct byte_packet_counters *to, *from;
+
+					to = &sum->bpc[set][dir][proto];
+					from = &snap.bpc[set][dir][proto];
+					to->bytes += from->bytes;
+					to->packets += from->packets;
+				}
+	}
+}
+
 
 /* Generic X based nodes used as a base for rb_tree ops */
 struct tag_node {
@@ -206,12 +255,13 @@ struct tag_node {
 
 struct tag_stat {
 	struct tag_node tn;
-	struct data_counters counters;
+	struct data_counters_cpu *counters;
 	/*
 	 * If this tag is acct_tag based, we need to count against the
 	 * matching parent uid_tag.
 	 */
-	struct data_counters *parent_counters;
+	struct data_counters_cpu *parent_counters;
+	struct rcu_head rcu;
 };
 
 struct iface_stat {
@@ -222,7 +272,7 @@ struct iface_stat {
 	struct net_device *net_dev;
 
 	struct byte_packet_counters totals_via_dev[IFS_MAX_DIRECTIONS];
-	struct data_counters totals_via_skb;
+	struct data_counters_cpu *totals_via_skb;
 	/*
 	 * We keep the last_known, because some devices reset their counters
 	 * just before NETDEV_UP, while some will reset just before
@@ -239,6 +289,8 @@ struct iface_stat {
 
 	struct rb_root tag_stat_tree;
 	spinlock_t tag_stat_list_lock;
+	/* Bumped around changes of tag_stat_tree, for lockless lookups */
+	seqcount_t tag_stat_seq;
 };
 
 /* This is needed to create proc_dir_entries from atomic context. */
@@ -263,6 +315,7 @@ struct sock_tag {
 	pid_t pid;
 
 	tag_t tag;
+	struct rcu_head rcu;
 };
 
 struct qtaguid_event_counts {
@@ -301,6 +354,7 @@ struct qtaguid_event_counts {
 struct tag_counter_set {
 	struct tag_node tn;
 	int active_set;
+	struct rcu_head rcu;
 };
 
 /*----------------------------------------------*/
@@ -2039,6 +2039,11 @@ int __sys_sendmmsg(int fd, struct mmsghdr __user *mmsg, unsigned int vlen,
 	if (vlen > UIO_MAXIOV)
 		vlen = UIO_MAXIOV;
 
+	/* check the whole vector once, the lengths are put unchecked */
+	if (!access_ok(VERIFY_WRITE, mmsg, vlen * (MSG_CMSG_COMPAT & flags ?
+			sizeof(*compat_entry) : sizeof(*entry))))
+		return -EFAULT;
+
 	datagrams = 0;
 
 	sock = sockfd_lookup_light(fd, &err, &fput_needed);
@@ -2064,7 +2069,7 @@ int __sys_sendmmsg(int fd, struct mmsghdr __user *mmsg, unsigned int vlen,
 					     &msg_sys, flags, &used_address);
 			if (err < 0)
 				break;
-			err = put_user(err, &entry->msg_len);
+			err = __put_user(err, &entry->msg_len);
 			++entry;
 		}
 
@@ -2232,6 +2237,14 @@ int __sys_recvmmsg(int fd, struct mmsghdr __user *mmsg, unsigned int vlen,
 				    timeout->tv_nsec))
 		return -EINVAL;
 
+	if (vlen > UIO_MAXIOV)
+		vlen = UIO_MAXIOV;
+
+	/* check the whole vector once, the lengths are put unchecked */
+	if (!access_ok(VERIFY_WRITE, mmsg, vlen * (MSG_CMSG_COMPAT & flags ?
+			sizeof(*compat_entry) : sizeof(*entry))))
+		return -EFAULT;
+
 	datagrams = 0;
 
 	sock = sockfd_lookup_light(fd, &err, &fput_needed);
@@ -2264,7 +2277,7 @@ int __sys_recvmmsg(int fd, struct mmsghdr __user *mmsg, unsigned int vlen,
 					     datagrams);
 			if (err < 0)
 				break;
-			err = put_user(err, &entry->msg_len);
+			err = __put_user(err, &entry->msg_len);
 			++entry;
 		}
 
@@ -41,6 +41,8 @@
 #include <linux/wait.h>
 #include <linux/firmware.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <linux/opp.h>
 #ifdef CONFIG_OMAP4_DPLL_CASCADING
 #include <linux/earlysuspend.h>
@@ -170,6 +172,18 @@ struct abe_data {
 	struct snd_pcm_substream *ping_pong_substream;
 	int first_irq;
 
+	/* low latency ping-pong playback, and what it achieves */
+	u32 ll_enable;
+	int ll_active;
+	u32 ll_period_us;
+	ktime_t irq_time;
+	ktime_t last_period;
+	u32 ll_periods;
+	u32 ll_wake_max_us;
+	u64 ll_wake_total_us;
+	u32 ll_jitter_max_us;
+	u32 ll_late;
+
 	struct snd_pcm_substream *psubs;
 
 #ifdef CONFIG_DEBUG_FS
@@ -234,6 +248,34 @@ static int abe_dsp_write(struct snd_soc_platform *platform, unsigned int reg,
 	return 0;
 }
 
+/*
+ * Account how long the ping-pong interrupt took to reach us and how far
+ * it was from one period after the previous one, in low latency mode.
+ */
+static void abe_ll_account(struct abe_data *abe)
+{
+	ktime_t now = ktime_get();
+	u32 wake, jitter;
+	s64 interval;
+
+	wake = (u32)ktime_us_delta(now, abe->irq_time);
+	abe->ll_wake_total_us += wake;
+	if (wake > abe->ll_wake_max_us)
+		abe->ll_wake_max_us = wake;
+
+	if (abe->ll_periods++) {
+		interval = ktime_us_delta(abe->irq_time, abe->last_period);
+		interval -= abe->ll_period_us;
+		jitter = (u32)(interval < 0 ? -interval : interval);
+		if (jitter > abe->ll_jitter_max_us)
+			abe->ll_jitter_max_us = jitter;
+		/* the ABE played the other buffer while we were away */
+		if (interval + wake > abe->ll_period_us)
+			abe->ll_late++;
+	}
+	abe->last_period = abe->irq_time;
+}
+
 static void abe_irq_pingpong_subroutine(u32 *data)
 {
 	u32 dst, n_bytes;
@@ -245,20 +287,44 @@ static void abe_irq_pingpong_subroutine(u32 *data)
 	if (the_abe->first_irq) {
 		the_abe->first_irq = 0;
 	} else {
+		if (the_abe->ll_active)
+			abe_ll_account(the_abe);
 		if (the_abe->ping_pong_substream)
 			snd_pcm_period_elapsed(the_abe->ping_pong_substream);
 	}
 }
 
+static irqreturn_t abe_irq_stamp(int irq, void *dev_id)
+{
+	struct abe_data *abe = dev_id;
+
+	abe->irq_time = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t abe_irq_handler(int irq, void *dev_id)
 {
 	struct abe_data *abe = dev_id;
+	int active = abe->active;
+
+	/*
+	 * An open stream holds the ABE awake, don't go through the runtime
+	 * PM locks every period for nothing then: with small periods this
+	 * is most of what the thread does before telling ALSA.
+	 */
+	if (active)
+		pm_runtime_get_noresume(abe->dev);
+	else
+		pm_runtime_get_sync(abe->dev);
 
 	/* TODO: handle underruns/overruns/errors */
-	pm_runtime_get_sync(abe->dev);
 	abe_clear_irq();  // TODO: why is IRQ not cleared after processing ?
 	abe_irq_processing();
-	pm_runtime_put_sync_suspend(abe->dev);
+
+	if (active)
+		pm_runtime_put_noidle(abe->dev);
+	else
+		pm_runtime_put_sync_suspend(abe->dev);
 	return IRQ_HANDLED;
 }
 
@@ -1132,6 +1198,25 @@ static const struct snd_kcontrol_new mm_ext_dl_switch_controls =
 	SOC_SINGLE_EXT("Switch", ABE_VIRTUAL_SWITCH, MIX_SWITCH_MM_EXT_DL, 1, 0,
 			abe_get_mixer, abe_put_switch);
 
+static int abe_get_low_latency(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] = the_abe->ll_enable;
+	return 0;
+}
+
+static int abe_put_low_latency(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	u32 val = !!ucontrol->value.integer.value[0];
+
+	if (the_abe->ll_enable == val)
+		return 0;
+
+	the_abe->ll_enable = val;
+	return 1;
+}
+
 static const struct snd_kcontrol_new abe_controls[] = {
 	/* DL1 mixer gains */
 	SOC_SINGLE_EXT_TLV("DL1 Media Playback Volume",
@@ -1228,6 +1313,10 @@ static const struct snd_kcontrol_new abe_controls[] = {
 #endif
 	SOC_SINGLE_EXT("AUDUL Mono Mixer", MIXAUDUL, MIX_AUDUL_MONO, 1, 0,
 		abe_get_mono_mixer, abe_put_mono_mixer),
+
+	/* small ping-pong periods for the next MM_DL LP stream opened */
+	SOC_SINGLE_EXT("MM_DL LP Low Latency", 0, 0, 1, 0,
+		abe_get_low_latency, abe_put_low_latency),
 };
 
 static const struct snd_soc_dapm_widget abe_dapm_widgets[] = {
@@ -1934,6 +2023,40 @@ static const struct file_operations abe_data_fops = {
 	.release = abe_release_data,
 };
 
+static int abe_latency_show(struct seq_file *s, void *unused)
+{
+	struct abe_data *abe = s->private;
+	u32 periods = abe->ll_periods;
+
+	seq_printf(s, "low latency: %s\n", abe->ll_enable ?
+		   (abe->ll_active ? "active" : "enabled") : "disabled");
+	if (!abe->ll_period_us)
+		return 0;
+
+	/* up to two periods queued in the ping-pong buffers, plus ours */
+	seq_printf(s, "period: %u us\n", abe->ll_period_us);
+	seq_printf(s, "buffering: %u us\n", 3 * abe->ll_period_us);
+	seq_printf(s, "periods: %u\n", periods);
+	seq_printf(s, "irq to thread: avg %llu us max %u us\n",
+		   periods ? div_u64(abe->ll_wake_total_us, periods) : 0,
+		   abe->ll_wake_max_us);
+	seq_printf(s, "period jitter: max %u us\n", abe->ll_jitter_max_us);
+	seq_printf(s, "late: %u\n", abe->ll_late);
+	return 0;
+}
+
+static int abe_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, abe_latency_show, inode->i_private);
+}
+
+static const struct file_operations abe_latency_fops = {
+	.open = abe_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static void abe_init_debugfs(struct abe_data *abe)
 {
 	abe->debugfs_root = debugfs_create_dir("omap4-abe", NULL);
@@ -1990,6 +2113,10 @@ static void abe_init_debugfs(struct abe_data *abe)
 	if (!abe->debugfs_opp_level)
 		printk(KERN_WARNING "ABE: Failed to create OPP level debugfs file\n");
 
+	if (!debugfs_create_file("latency", 0444, abe->debugfs_root,
+				 abe, &abe_latency_fops))
+		printk(KERN_WARNING "ABE: Failed to create latency debugfs file\n");
+
 	abe->dbg_buffer_msecs = 500;
 	init_waitqueue_head(&abe->wait);
 }
@@ -2026,6 +2153,26 @@ static const struct snd_pcm_hardware omap_abe_hardware = {
 	.buffer_bytes_max	= 24 * 1024 * 2,
 };
 
+/*
+ * Low latency ping-pong: periods down to 1ms of 16 bit stereo at 48kHz,
+ * the ABE's own processing period, costing an MPU wakeup every one.
+ */
+static const struct snd_pcm_hardware omap_abe_hardware_ll = {
+	.info			= SNDRV_PCM_INFO_MMAP |
+				  SNDRV_PCM_INFO_MMAP_VALID |
+				  SNDRV_PCM_INFO_INTERLEAVED |
+				  SNDRV_PCM_INFO_BLOCK_TRANSFER |
+				  SNDRV_PCM_INFO_PAUSE |
+				  SNDRV_PCM_INFO_RESUME,
+	.formats		= SNDRV_PCM_FMTBIT_S16_LE |
+				  SNDRV_PCM_FMTBIT_S32_LE,
+	.period_bytes_min	= 192,
+	.period_bytes_max	= 4 * 1024,
+	.periods_min		= 4,
+	.periods_max		= 4,
+	.buffer_bytes_max	= 4 * 1024 * 4,
+};
+
 static struct abe_opp_req *abe_opp_req_lookup(struct abe_data *abe,
 					struct device *dev)
 {
@@ -2414,6 +2561,15 @@ static int aess_open(struct snd_pcm_substream *substream)
 	case ABE_FRONTEND_DAI_MODEM:
 		break;
 	case ABE_FRONTEND_DAI_LP_MEDIA:
+		if (abe->ll_enable) {
+			/* whole ABE processing periods */
+			snd_soc_set_runtime_hwparams(substream,
+						     &omap_abe_hardware_ll);
+			ret = snd_pcm_hw_constraint_step(substream->runtime, 0,
+					SNDRV_PCM_HW_PARAM_PERIOD_SIZE, 48);
+			abe->ll_active = 1;
+			break;
+		}
 		snd_soc_set_runtime_hwparams(substream, &omap_abe_hardware);
 		ret = snd_pcm_hw_constraint_step(substream->runtime, 0,
 					 SNDRV_PCM_HW_PARAM_BUFFER_BYTES, 1024);
@@ -2456,6 +2612,16 @@ static int aess_hw_params(struct snd_pcm_substream *substream,
 
 	period_size = params_period_bytes(params);
 
+	if (abe->ll_active) {
+		abe->ll_period_us = div_u64((u64)params_period_size(params) *
+					    USEC_PER_SEC, params_rate(params));
+		abe->ll_periods = 0;
+		abe->ll_wake_max_us = 0;
+		abe->ll_wake_total_us = 0;
+		abe->ll_jitter_max_us = 0;
+		abe->ll_late = 0;
+	}
+
 	/*Adding ping pong buffer subroutine*/
 	abe_plug_subroutine(&abe_irq_pingpong_player_id,
 				(abe_subroutine2) abe_irq_pingpong_subroutine,
@@ -2506,6 +2672,9 @@ static int aess_close(struct snd_pcm_substream *substream)
 
 	dev_dbg(dai->dev, "%s: %s\n", __func__, dai->name);
 
+	if (dai->id == ABE_FRONTEND_DAI_LP_MEDIA)
+		abe->ll_active = 0;
+
 	if (!--abe->active) {
 		abe_disable_irq();
 		aess_save_context(abe);
@@ -2911,7 +3080,7 @@ static int abe_probe(struct snd_soc_platform *platform)
 		fw_data + sizeof(struct fw_header) + abe->hdr.coeff_size,
 		abe->hdr.firmware_size);
 
-	ret = request_threaded_irq(abe->irq, NULL, abe_irq_handler,
+	ret = request_threaded_irq(abe->irq, abe_irq_stamp, abe_irq_handler,
 				IRQF_ONESHOT, "ABE", (void *)abe);
 	if (ret) {
 		dev_err(platform->dev, "request for ABE IRQ %d failed %d\n",
@@ -24,6 +24,10 @@
 
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -48,13 +52,65 @@ static const struct snd_pcm_hardware omap_pcm_hardware = {
 	.buffer_bytes_max	= 128 * 1024,
 };
 
+/*
+ * Deep buffers, for music with the screen off: a few seconds of audio
+ * in DDR that sDMA plays on its own, the MPU only waking when userspace
+ * asked for a period, as a low watermark.  Buffers beyond the
+ * preallocated one are allocated at hw_params time.  Only OMAP2 and
+ * later, whose sDMA takes element counts this large.
+ */
+static const struct snd_pcm_hardware omap_pcm_hardware_deep = {
+	.info			= SNDRV_PCM_INFO_MMAP |
+				  SNDRV_PCM_INFO_MMAP_VALID |
+				  SNDRV_PCM_INFO_INTERLEAVED |
+				  SNDRV_PCM_INFO_PAUSE |
+				  SNDRV_PCM_INFO_RESUME |
+				  SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
+	.formats		= SNDRV_PCM_FMTBIT_S16_LE |
+				  SNDRV_PCM_FMTBIT_S32_LE,
+	.period_bytes_min	= 32,
+	.period_bytes_max	= 256 * 1024,
+	.periods_min		= 2,
+	.periods_max		= 255,
+	.buffer_bytes_max	= 512 * 1024,
+};
+
 struct omap_runtime_data {
 	spinlock_t			lock;
 	struct omap_pcm_dma_data	*dma_data;
 	int				dma_ch;
 	int				period_index;
+	struct snd_dma_buffer		deep_buf;
+	unsigned int			irqs;
+	unsigned long			start;
 };
 
+/* MPU wakeups for period interrupts, with normal and deep buffers */
+static struct omap_pcm_wakeups {
+	unsigned int	irqs;
+	unsigned long	ms;
+} omap_pcm_wakeups[2];
+static DEFINE_SPINLOCK(omap_pcm_wakeups_lock);
+
+static void omap_pcm_account(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct omap_runtime_data *prtd = runtime->private_data;
+	struct omap_pcm_wakeups *w;
+
+	if (!prtd->start)
+		return;
+
+	w = &omap_pcm_wakeups[prtd->deep_buf.area != NULL];
+	spin_lock(&omap_pcm_wakeups_lock);
+	w->irqs += prtd->irqs;
+	w->ms += jiffies_to_msecs(jiffies - prtd->start);
+	spin_unlock(&omap_pcm_wakeups_lock);
+
+	prtd->irqs = 0;
+	prtd->start = 0;
+}
+
 static void omap_pcm_dma_irq(int ch, u16 stat, void *data)
 {
 	struct snd_pcm_substream *substream = data;
@@ -91,9 +147,52 @@ static void omap_pcm_dma_irq(int ch, u16 stat, void *data)
 		spin_unlock_irqrestore(&prtd->lock, flags);
 	}
 
+	prtd->irqs++;
 	snd_pcm_period_elapsed(substream);
 }
 
+static void omap_pcm_free_deep_buffer(struct snd_pcm_substream *substream)
+{
+	struct omap_runtime_data *prtd = substream->runtime->private_data;
+	struct snd_dma_buffer *buf = &prtd->deep_buf;
+
+	if (!buf->area)
+		return;
+
+	dma_free_writecombine(substream->pcm->card->dev, buf->bytes,
+			      buf->area, buf->addr);
+	buf->area = NULL;
+}
+
+static int omap_pcm_set_buffer(struct snd_pcm_substream *substream,
+			       size_t bytes)
+{
+	struct omap_runtime_data *prtd = substream->runtime->private_data;
+	struct snd_dma_buffer *buf = &prtd->deep_buf;
+
+	if (bytes <= substream->dma_buffer.bytes) {
+		omap_pcm_free_deep_buffer(substream);
+		snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
+		return 0;
+	}
+
+	if (buf->area && buf->bytes == bytes)
+		return 0;
+
+	omap_pcm_free_deep_buffer(substream);
+	buf->dev = substream->dma_buffer.dev;
+	buf->area = dma_alloc_writecombine(substream->pcm->card->dev, bytes,
+					   &buf->addr, GFP_KERNEL);
+	if (!buf->area) {
+		snd_pcm_set_runtime_buffer(substream, NULL);
+		return -ENOMEM;
+	}
+	buf->bytes = bytes;
+
+	snd_pcm_set_runtime_buffer(substream, buf);
+	return 0;
+}
+
 /* this may get called several times by oss emulation */
 static int omap_pcm_hw_params(struct snd_pcm_substream *substream,
 			      struct snd_pcm_hw_params *params)
@@ -112,7 +211,9 @@ static int omap_pcm_hw_params(struct snd_pcm_substream *substream,
 	if (!dma_data)
 		return 0;
 
-	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
+	err = omap_pcm_set_buffer(substream, params_buffer_bytes(params));
+	if (err)
+		return err;
 	runtime->dma_bytes = params_buffer_bytes(params);
 
 	if (prtd->dma_data)
@@ -144,6 +245,7 @@ static int omap_pcm_hw_free(struct snd_pcm_substream *substream)
 	prtd->dma_data = NULL;
 
 	snd_pcm_set_runtime_buffer(substream, NULL);
+	omap_pcm_free_deep_buffer(substream);
 
 	return 0;
 }
@@ -235,6 +337,8 @@ static int omap_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		if (dma_data->set_threshold)
 			dma_data->set_threshold(substream);
 
+		prtd->irqs = 0;
+		prtd->start = jiffies ? jiffies : 1;
 		omap_start_dma(prtd->dma_ch);
 		break;
 
@@ -248,6 +352,7 @@ static int omap_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		   just after disabling it */
 		while (omap_get_dma_active_status(prtd->dma_ch))
 			omap_stop_dma(prtd->dma_ch);
+		omap_pcm_account(substream);
 		break;
 	default:
 		ret = -EINVAL;
@@ -286,7 +391,11 @@ static int omap_pcm_open(struct snd_pcm_substream *substream)
 	struct omap_runtime_data *prtd;
 	int ret;
 
-	snd_soc_set_runtime_hwparams(substream, &omap_pcm_hardware);
+	if (cpu_class_is_omap1())
+		snd_soc_set_runtime_hwparams(substream, &omap_pcm_hardware);
+	else
+		snd_soc_set_runtime_hwparams(substream,
+					     &omap_pcm_hardware_deep);
 
 	/* Ensure that buffer size is a multiple of period size */
 	ret = snd_pcm_hw_constraint_integer(runtime,
@@ -436,8 +545,64 @@ static struct platform_driver omap_pcm_driver = {
 	.remove = __devexit_p(omap_pcm_remove),
 };
 
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *omap_pcm_debugfs;
+
+static int omap_pcm_wakeups_show(struct seq_file *s, void *unused)
+{
+	static const char * const mode[] = { "normal", "deep" };
+	struct omap_pcm_wakeups w;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(omap_pcm_wakeups); i++) {
+		spin_lock_irq(&omap_pcm_wakeups_lock);
+		w = omap_pcm_wakeups[i];
+		spin_unlock_irq(&omap_pcm_wakeups_lock);
+
+		seq_printf(s, "%-6s: %u wakeups in %lu ms, %lu/min\n",
+			   mode[i], w.irqs, w.ms,
+			   w.ms ? (unsigned long)div_u64((u64)w.irqs * 60000,
+							 w.ms) : 0);
+	}
+	return 0;
+}
+
+static int omap_pcm_wakeups_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap_pcm_wakeups_show, NULL);
+}
+
+static const struct file_operations omap_pcm_wakeups_fops = {
+	.open		= omap_pcm_wakeups_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void omap_pcm_init_debugfs(void)
+{
+	omap_pcm_debugfs = debugfs_create_file("omap-pcm-wakeups", 0444,
+					       NULL, NULL,
+					       &omap_pcm_wakeups_fops);
+}
+
+static void omap_pcm_cleanup_debugfs(void)
+{
+	debugfs_remove(omap_pcm_debugfs);
+}
+#else
+static inline void omap_pcm_init_debugfs(void)
+{
+}
+
+static inline void omap_pcm_cleanup_debugfs(void)
+{
+}
+#endif
+
 static int __init snd_omap_pcm_init(void)
 {
+	omap_pcm_init_debugfs();
 	return platform_driver_register(&omap_pcm_driver);
 }
 module_init(snd_omap_pcm_init);
@@ -445,6 +610,7 @@ module_init(snd_omap_pcm_init);
 static void __exit snd_omap_pcm_exit(void)
 {
 	platform_driver_unregister(&omap_pcm_driver);
+	omap_pcm_cleanup_debugfs();
 }
 module_exit(snd_omap_pcm_exit);
 
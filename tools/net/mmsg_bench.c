@@ -0,0 +1,265 @@
+/* $(CROSS_COMPILE)cc -Wall -Wextra -O2 -g -o mmsg_bench mmsg_bench.c */
+
+/*
+ * Datagrams per second through sendmmsg() and recvmmsg() for a range of
+ * batch sizes, to see what batching saves over one system call per
+ * datagram.
+ *
+ * Without arguments a receiving child is forked and fed over loopback.
+ * To measure over a real link such as WiFi, run "mmsg_bench -r PORT" on
+ * one end and "mmsg_bench -c ADDR:PORT" on the other: the receiver prints
+ * what arrives every second, the sender what it managed to send.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MAX_BATCH	64
+#define MAX_SIZE	65507
+
+static const unsigned int batches[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+static unsigned int size = 200;		/* an RTP packet, roughly */
+static unsigned int seconds = 2;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static void setup(struct mmsghdr *msgs, struct iovec *iovs, char *buf,
+		  struct sockaddr_in *to)
+{
+	int i;
+
+	memset(msgs, 0, sizeof(*msgs) * MAX_BATCH);
+	for (i = 0; i < MAX_BATCH; i++) {
+		iovs[i].iov_base = buf + i * size;
+		iovs[i].iov_len = size;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		if (to) {
+			msgs[i].msg_hdr.msg_name = to;
+			msgs[i].msg_hdr.msg_namelen = sizeof(*to);
+		}
+	}
+}
+
+/* send in batches of @batch for @seconds, returns datagrams per second */
+static double send_run(int fd, struct sockaddr_in *to, unsigned int batch)
+{
+	static struct mmsghdr msgs[MAX_BATCH];
+	static struct iovec iovs[MAX_BATCH];
+	static char *buf;
+	unsigned long sent = 0;
+	double start, end;
+	int ret;
+
+	if (!buf) {
+		buf = calloc(MAX_BATCH, size);
+		if (!buf)
+			die("calloc");
+	}
+	setup(msgs, iovs, buf, to);
+
+	start = now();
+	end = start + seconds;
+	do {
+		ret = sendmmsg(fd, msgs, batch, 0);
+		if (ret < 0) {
+			if (errno == ENOBUFS || errno == EAGAIN ||
+			    errno == ECONNREFUSED)
+				continue;
+			die("sendmmsg");
+		}
+		sent += ret;
+	} while (now() < end);
+
+	return sent / (now() - start);
+}
+
+/* receive in batches of @batch until killed, printing the rate */
+static void recv_loop(int fd, unsigned int batch, int quiet)
+{
+	static struct mmsghdr msgs[MAX_BATCH];
+	static struct iovec iovs[MAX_BATCH];
+	unsigned long received = 0, calls = 0;
+	double start = now(), t;
+	char *buf;
+	int ret;
+
+	buf = calloc(MAX_BATCH, MAX_SIZE);
+	if (!buf)
+		die("calloc");
+	size = MAX_SIZE;
+	setup(msgs, iovs, buf, NULL);
+
+	for (;;) {
+		ret = recvmmsg(fd, msgs, batch, MSG_WAITFORONE, NULL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			die("recvmmsg");
+		}
+		received += ret;
+		calls++;
+
+		t = now();
+		if (!quiet && t - start >= 1) {
+			printf("%10.0f datagrams/s, %5.1f per call\n",
+			       received / (t - start),
+			       (double)received / calls);
+			fflush(stdout);
+			received = calls = 0;
+			start = t;
+		}
+	}
+}
+
+static int udp_socket(void)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	int buf = 4 << 20;
+
+	if (fd < 0)
+		die("socket");
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+	return fd;
+}
+
+static int bound_socket(unsigned short port)
+{
+	struct sockaddr_in addr;
+	int fd = udp_socket();
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		die("bind");
+	return fd;
+}
+
+static void sender(struct sockaddr_in *to)
+{
+	int fd = udp_socket();
+	unsigned int i;
+
+	printf("%5s %12s\n", "batch", "datagrams/s");
+	for (i = 0; i < sizeof(batches) / sizeof(batches[0]); i++)
+		printf("%5u %12.0f\n", batches[i],
+		       send_run(fd, to, batches[i]));
+	close(fd);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-s size] [-t seconds] [-r port | -c addr:port]\n"
+		"  -s  datagram payload size (default %u)\n"
+		"  -t  seconds per batch size (default %u)\n"
+		"  -r  receive on port, printing the rate every second\n"
+		"  -c  send to addr:port instead of a local child\n",
+		prog, size, seconds);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in to;
+	const char *connect_to = NULL;
+	int recv_port = 0;
+	socklen_t len;
+	pid_t child;
+	char *colon;
+	int fd, c;
+
+	while ((c = getopt(argc, argv, "s:t:r:c:")) != -1) {
+		switch (c) {
+		case 's':
+			size = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'r':
+			recv_port = atoi(optarg);
+			break;
+		case 'c':
+			connect_to = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!size || size > MAX_SIZE || !seconds)
+		usage(argv[0]);
+
+	if (recv_port) {
+		recv_loop(bound_socket(recv_port), MAX_BATCH, 0);
+		return 0;
+	}
+
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+
+	if (connect_to) {
+		colon = strchr(connect_to, ':');
+		if (!colon)
+			usage(argv[0]);
+		*colon = '\0';
+		if (inet_pton(AF_INET, connect_to, &to.sin_addr) != 1)
+			usage(argv[0]);
+		to.sin_port = htons(atoi(colon + 1));
+		sender(&to);
+		return 0;
+	}
+
+	/* loopback: a child drains whatever the sender manages */
+	fd = bound_socket(0);
+	len = sizeof(to);
+	if (getsockname(fd, (struct sockaddr *)&to, &len))
+		die("getsockname");
+	to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	child = fork();
+	if (child < 0)
+		die("fork");
+	if (!child) {
+		recv_loop(fd, MAX_BATCH, 1);
+		return 0;
+	}
+	close(fd);
+
+	sender(&to);
+
+	kill(child, SIGTERM);
+	waitpid(child, NULL, 0);
+	return 0;
+}
@@ -42,6 +42,7 @@ static u64			default_interval		=      0;
 
 static unsigned int		page_size;
 static unsigned int		mmap_pages			= UINT_MAX;
+static unsigned int		wakeup_kb			=      0;
 static unsigned int		user_freq 			= UINT_MAX;
 static int			freq				=   1000;
 static int			output;
@@ -218,6 +219,9 @@ static void config_attr(struct perf_evsel *evsel, struct perf_evlist *evlist)
 	if (nodelay) {
 		attr->watermark = 0;
 		attr->wakeup_events = 1;
+	} else if (wakeup_kb) {
+		attr->watermark = 1;
+		attr->wakeup_watermark = wakeup_kb * 1024;
 	}
 
 	attr->mmap		= track;
@@ -768,6 +772,8 @@ const struct option record_options[] = {
 		    "child tasks do not inherit counters"),
 	OPT_UINTEGER('F', "freq", &user_freq, "profile at this frequency"),
 	OPT_UINTEGER('m', "mmap-pages", &mmap_pages, "number of mmap data pages"),
+	OPT_UINTEGER(0, "wakeup-kb", &wakeup_kb,
+		     "wake up to write data every that many kbytes per buffer"),
 	OPT_BOOLEAN('g', "call-graph", &call_graph,
 		    "do call-graph (stack chain/backtrace) recording"),
 	OPT_INCR('v', "verbose", &verbose,
@@ -178,6 +178,7 @@ static int			run_idx				=  0;
 
 static int			run_count			=  1;
 static bool			no_inherit			= false;
+static bool			pinned				= false;
 static bool			scale				=  true;
 static bool			no_aggr				= false;
 static pid_t			target_pid			= -1;
@@ -276,6 +277,7 @@ static int create_perf_stat_counter(struct perf_evsel *evsel)
 				    PERF_FORMAT_TOTAL_TIME_RUNNING;
 
 	attr->inherit = !no_inherit;
+	attr->pinned = pinned;
 
 	if (system_wide)
 		return perf_evsel__open_per_cpu(evsel, evsel_list->cpus, false);
@@ -1029,6 +1031,8 @@ static const struct option options[] = {
 		     "event filter", parse_filter),
 	OPT_BOOLEAN('i', "no-inherit", &no_inherit,
 		    "child tasks do not inherit counters"),
+	OPT_BOOLEAN('P', "pinned", &pinned,
+		    "keep counters on the PMU, no multiplexing"),
 	OPT_INTEGER('p', "pid", &target_pid,
 		    "stat events on existing process id"),
 	OPT_INTEGER('t', "tid", &target_tid,
@@ -52,6 +52,77 @@ static struct event_symbol event_symbols[] = {
   { CSW(EMULATION_FAULTS),		"emulation-faults",		""			},
 };
 
+/*
+ * Raw events known by name: the Cortex-A9 ones no generic event covers,
+ * and the L310 cache controller's, which come from a PMU of its own.
+ * A NULL pmu is the CPU's, PERF_TYPE_RAW.
+ */
+struct pmu_event_symbol {
+	const char	*pmu;
+	u64		config;
+	const char	*symbol;
+};
+
+static struct pmu_event_symbol pmu_event_symbols[] = {
+  { NULL,	0x06, "a9-data-reads"				},
+  { NULL,	0x07, "a9-data-writes"				},
+  { NULL,	0x09, "a9-exceptions"				},
+  { NULL,	0x0A, "a9-exception-returns"			},
+  { NULL,	0x0F, "a9-unaligned-accesses"			},
+  { NULL,	0x50, "a9-coherent-line-misses"			},
+  { NULL,	0x51, "a9-coherent-line-hits"			},
+  { NULL,	0x60, "a9-icache-stall-cycles"			},
+  { NULL,	0x61, "a9-dcache-stall-cycles"			},
+  { NULL,	0x62, "a9-tlb-miss-stall-cycles"		},
+  { NULL,	0x63, "a9-strex-passed"				},
+  { NULL,	0x64, "a9-strex-failed"				},
+  { NULL,	0x65, "a9-data-evictions"			},
+  { NULL,	0x66, "a9-issue-no-dispatch-cycles"		},
+  { NULL,	0x67, "a9-issue-empty-cycles"			},
+  { NULL,	0x68, "a9-instructions-renamed"			},
+  { NULL,	0x6E, "a9-function-returns"			},
+  { NULL,	0x70, "a9-main-unit-instructions"		},
+  { NULL,	0x71, "a9-second-unit-instructions"		},
+  { NULL,	0x72, "a9-ldst-unit-instructions"		},
+  { NULL,	0x73, "a9-fp-instructions"			},
+  { NULL,	0x74, "a9-neon-instructions"			},
+  { NULL,	0x80, "a9-pld-stall-cycles"			},
+  { NULL,	0x81, "a9-write-stall-cycles"			},
+  { NULL,	0x82, "a9-itlb-stall-cycles"			},
+  { NULL,	0x83, "a9-dtlb-stall-cycles"			},
+  { NULL,	0x84, "a9-micro-itlb-stall-cycles"		},
+  { NULL,	0x85, "a9-micro-dtlb-stall-cycles"		},
+  { NULL,	0x86, "a9-dmb-stall-cycles"			},
+  { NULL,	0x8A, "a9-integer-clock-cycles"			},
+  { NULL,	0x8B, "a9-data-engine-clock-cycles"		},
+  { NULL,	0x90, "a9-isb"					},
+  { NULL,	0x91, "a9-dsb"					},
+  { NULL,	0x92, "a9-dmb"					},
+  { NULL,	0x93, "a9-external-interrupts"			},
+  { NULL,	0xA0, "a9-ple-lines-completed"			},
+  { NULL,	0xA1, "a9-ple-lines-skipped"			},
+  { NULL,	0xA2, "a9-ple-fifo-flushes"			},
+  { NULL,	0xA3, "a9-ple-requests-completed"		},
+  { NULL,	0xA4, "a9-ple-fifo-overflows"			},
+  { NULL,	0xA5, "a9-ple-requests-programmed"		},
+
+  { "l2x0",	0x1, "l2x0-castouts"				},
+  { "l2x0",	0x2, "l2x0-data-read-hits"			},
+  { "l2x0",	0x3, "l2x0-data-reads"				},
+  { "l2x0",	0x4, "l2x0-data-write-hits"			},
+  { "l2x0",	0x5, "l2x0-data-writes"				},
+  { "l2x0",	0x6, "l2x0-write-through-writes"		},
+  { "l2x0",	0x7, "l2x0-instruction-read-hits"		},
+  { "l2x0",	0x8, "l2x0-instruction-reads"			},
+  { "l2x0",	0x9, "l2x0-write-allocations"			},
+  { "l2x0",	0xA, "l2x0-prefetch-linefills"			},
+  { "l2x0",	0xB, "l2x0-prefetch-hint-hits"			},
+  { "l2x0",	0xC, "l2x0-prefetch-hint-linefills"		},
+  { "l2x0",	0xD, "l2x0-speculative-reads"			},
+  { "l2x0",	0xE, "l2x0-speculative-reads-confirmed"		},
+  { "l2x0",	0xF, "l2x0-prefetch-hints"			},
+};
+
 #define __PERF_EVENT_FIELD(config, name) \
 	((config & PERF_EVENT_##name##_MASK) >> PERF_EVENT_##name##_SHIFT)
 
@@ -683,6 +754,95 @@ parse_symbolic_event(const char **strp, struct perf_event_attr *attr)
 	return EVT_FAILED;
 }
 
+/*
+ * The type of the PMU called @name, from sysfs, or -1 if there is none.
+ */
+static int pmu_type(const char *name)
+{
+	char path[MAXPATHLEN];
+	FILE *file;
+	int type;
+
+	snprintf(path, sizeof(path), "/sys/bus/event_source/devices/%s/type",
+		 name);
+	file = fopen(path, "r");
+	if (!file)
+		return -1;
+	if (fscanf(file, "%d", &type) != 1)
+		type = -1;
+	fclose(file);
+	return type;
+}
+
+/*
+ * Whether the CPU raw events of the table are this CPU's: the part
+ * number of a Cortex-A9 is 0xc09.
+ */
+static int cpu_is_cortex_a9(void)
+{
+	static int is_a9 = -1;
+	char line[128];
+	FILE *file;
+
+	if (is_a9 >= 0)
+		return is_a9;
+
+	is_a9 = 0;
+	file = fopen("/proc/cpuinfo", "r");
+	if (!file)
+		return is_a9;
+	while (fgets(line, sizeof(line), file)) {
+		if (!strncmp(line, "CPU part", 8) && strstr(line, "0xc09")) {
+			is_a9 = 1;
+			break;
+		}
+	}
+	fclose(file);
+	return is_a9;
+}
+
+static int pmu_event_available(struct pmu_event_symbol *sym)
+{
+	if (sym->pmu)
+		return pmu_type(sym->pmu) >= 0;
+	return cpu_is_cortex_a9();
+}
+
+static enum event_result
+parse_pmu_symbol_event(const char **strp, struct perf_event_attr *attr)
+{
+	const char *str = *strp;
+	unsigned int i;
+	int n, type;
+
+	for (i = 0; i < ARRAY_SIZE(pmu_event_symbols); i++) {
+		struct pmu_event_symbol *sym = &pmu_event_symbols[i];
+
+		/* a9-dmb must not match a9-dmb-stall-cycles */
+		n = strlen(sym->symbol);
+		if (strncasecmp(str, sym->symbol, n) ||
+		    (str[n] && str[n] != ',' && str[n] != ':' &&
+		     !isspace(str[n])))
+			continue;
+
+		if (sym->pmu) {
+			type = pmu_type(sym->pmu);
+			if (type < 0) {
+				fprintf(stderr, "no %s PMU for '%s'\n",
+					sym->pmu, sym->symbol);
+				return EVT_FAILED;
+			}
+		} else
+			type = PERF_TYPE_RAW;
+
+		attr->type = type;
+		attr->config = sym->config;
+		*strp = str + n;
+		return EVT_HANDLED;
+	}
+	return EVT_FAILED;
+}
+
 static enum event_result
 parse_raw_event(const char **strp, struct perf_event_attr *attr)
 {
@@ -799,6 +959,10 @@ parse_event_symbols(const struct option *opt, const char **str,
 	if (ret != EVT_FAILED)
 		goto modifier;
 
+	ret = parse_pmu_symbol_event(str, attr);
+	if (ret != EVT_FAILED)
+		goto modifier;
+
 	ret = parse_generic_hw_event(str, attr);
 	if (ret != EVT_FAILED)
 		goto modifier;
@@ -1028,6 +1192,28 @@ int print_hwcache_events(const char *event_glob)
 	return printed;
 }
 
+int print_pmu_symbol_events(const char *event_glob)
+{
+	unsigned int i, printed = 0;
+
+	for (i = 0; i < ARRAY_SIZE(pmu_event_symbols); i++) {
+		struct pmu_event_symbol *sym = &pmu_event_symbols[i];
+
+		if (event_glob != NULL && !strglobmatch(sym->symbol, event_glob))
+			continue;
+		if (!pmu_event_available(sym))
+			continue;
+
+		if (!printed)
+			printf("\n");
+		printf("  %-50s [%s PMU event]\n", sym->symbol,
+		       sym->pmu ? sym->pmu : "Cortex-A9");
+		++printed;
+	}
+
+	return printed;
+}
+
 #define MAX_NAME_LEN 100
 
 /*
@@ -1072,6 +1258,7 @@ void print_events(const char *event_glob)
 		printf("\n");
 	}
 	print_hwcache_events(event_glob);
+	print_pmu_symbol_events(event_glob);
 
 	if (event_glob != NULL)
 		return;
@@ -0,0 +1,155 @@
+/*
+ * ashmem_bench: cost of ashmem pin, unpin and purge
+ *
+ * For regions of a few sizes, all of their pages faulted in, times
+ * unpinning and pinning them again, either as one range or as one
+ * range per other page, which is what the unpinned list of a
+ * fragmented cache looks like, and purging them once unpinned:
+ *
+ *   ashmem pages=<n> ranges=<n> unpin_ns= pin_ns= purge_ns=
+ *
+ * unpin_ns and pin_ns are per range, purge_ns per purge of the whole
+ * region.  Purging needs CAP_SYS_ADMIN.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/types.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "ashmem.h"
+#include "bench.h"
+
+static const char *device = "/dev/ashmem";
+static int iters = 1000;
+static int purges = 50;
+static const char *sizes = "1,16,256,4096";
+static long page_size;
+
+static void touch(char *map, int pages)
+{
+	int i;
+
+	for (i = 0; i < pages; i++)
+		map[i * page_size] = 1;
+}
+
+/* unpins (or pins) every @step th page, or all of them for a 0 @step */
+static int set_pinned(int fd, int pages, int step, int pin)
+{
+	struct ashmem_pin p;
+	int i, n = 0;
+
+	for (i = 0; i < pages; i += step ? step : pages) {
+		p.offset = i * page_size;
+		p.len = step ? page_size : pages * page_size;
+		if (ioctl(fd, pin ? ASHMEM_PIN : ASHMEM_UNPIN, &p) < 0)
+			die(pin ? "ASHMEM_PIN" : "ASHMEM_UNPIN");
+		n++;
+	}
+	return n;
+}
+
+static void bench(int pages, int step)
+{
+	unsigned long long unpin = 0, pin = 0, purge = 0, t;
+	int fd, i, ranges = 0;
+	char *map;
+
+	fd = open(device, O_RDWR);
+	if (fd < 0)
+		die("cannot open %s", device);
+	if (ioctl(fd, ASHMEM_SET_SIZE, pages * page_size) < 0)
+		die("ASHMEM_SET_SIZE");
+	map = mmap(NULL, pages * page_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		die("mmap");
+	touch(map, pages);
+
+	for (i = 0; i < iters; i++) {
+		t = now_ns();
+		ranges = set_pinned(fd, pages, step, 0);
+		unpin += now_ns() - t;
+
+		t = now_ns();
+		set_pinned(fd, pages, step, 1);
+		pin += now_ns() - t;
+	}
+
+	for (i = 0; i < purges && purge != ~0ULL; i++) {
+		set_pinned(fd, pages, 0, 0);
+		t = now_ns();
+		if (ioctl(fd, ASHMEM_PURGE_ALL_CACHES) < 0)
+			purge = ~0ULL;
+		else
+			purge += now_ns() - t;
+		set_pinned(fd, pages, 0, 1);
+		touch(map, pages);
+	}
+
+	printf("ashmem pages=%d ranges=%d unpin_ns=%llu pin_ns=%llu ",
+	       pages, ranges, unpin / iters / ranges, pin / iters / ranges);
+	if (purge == ~0ULL)
+		printf("purge_ns=-\n");
+	else
+		printf("purge_ns=%llu\n", purge / purges);
+
+	munmap(map, pages * page_size);
+	close(fd);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: ashmem_bench [-d device] [-n iterations] "
+		"[-p purges] [-s pages,...]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	char *list, *s;
+	int c, pages;
+
+	while ((c = getopt(argc, argv, "d:n:p:s:")) != -1) {
+		switch (c) {
+		case 'd':
+			device = optarg;
+			break;
+		case 'n':
+			iters = atoi(optarg);
+			break;
+		case 'p':
+			purges = atoi(optarg);
+			break;
+		case 's':
+			sizes = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (iters <= 0 || purges <= 0)
+		usage();
+
+	page_size = sysconf(_SC_PAGESIZE);
+	list = strdup(sizes);
+	if (!list)
+		die("out of memory");
+
+	for (s = strtok(list, ","); s; s = strtok(NULL, ",")) {
+		pages = atoi(s);
+		if (pages <= 0)
+			usage();
+		bench(pages, 0);
+		if (pages > 1)
+			bench(pages, 2);
+	}
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Helpers shared by the android-bench programs
+ *
+ * Every result is printed as one line, the name of the benchmark followed
+ * by key=value pairs, which run.sh collects and which two runs can be
+ * diffed or joined on.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef ANDROID_BENCH_H
+#define ANDROID_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+static inline unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void die(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	if (errno)
+		fprintf(stderr, ": %s", strerror(errno));
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* sorts @v, and returns its @pct percentile */
+static inline unsigned long long percentile(unsigned long long *v, int n,
+					    int pct)
+{
+	qsort(v, n, sizeof(*v), cmp_ull);
+	return v[(long long)(n - 1) * pct / 100];
+}
+
+/* bytes per ns * 1000 is MB/s */
+static inline unsigned long long mbs(unsigned long long bytes,
+				     unsigned long long ns)
+{
+	return ns ? bytes * 1000 / ns : 0;
+}
+
+#endif
@@ -0,0 +1,271 @@
+/*
+ * binder_bench: binder transaction round trip latency and throughput
+ *
+ * A child process becomes the context manager and replies to every
+ * transaction with a 4 byte status, the parent sends it synchronous
+ * transactions of each size and times them.  One line per size:
+ *
+ *   binder size=<bytes> iters=<n> avg_ns= p50_ns= p99_ns= max_ns= tps= mbs=
+ *
+ * Becoming the context manager fails while servicemanager runs,
+ * so on a phone run it after "stop".
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+
+#include "binder.h"
+#include "bench.h"
+
+#define BINDER_MAP_SIZE		(1024 * 1024)
+#define WARMUP			100
+
+static const char *device = "/dev/binder";
+static int iters = 10000;
+static const char *sizes = "0,64,256,1024,4096,16384,65536";
+
+struct cmdbuf {
+	uint8_t	buf[256];
+	size_t	len;
+};
+
+static void put(struct cmdbuf *c, const void *p, size_t len)
+{
+	memcpy(c->buf + c->len, p, len);
+	c->len += len;
+}
+
+static void put_cmd(struct cmdbuf *c, uint32_t cmd)
+{
+	put(c, &cmd, sizeof(cmd));
+}
+
+static void put_free(struct cmdbuf *c, const void *buffer)
+{
+	put_cmd(c, BC_FREE_BUFFER);
+	put(c, &buffer, sizeof(buffer));
+}
+
+static int binder_open(void)
+{
+	struct binder_version v;
+	int fd;
+
+	fd = open(device, O_RDWR);
+	if (fd < 0)
+		die("cannot open %s", device);
+	if (ioctl(fd, BINDER_VERSION, &v) < 0 ||
+	    v.protocol_version != BINDER_CURRENT_PROTOCOL_VERSION)
+		die("%s: not binder protocol %d", device,
+		    BINDER_CURRENT_PROTOCOL_VERSION);
+	if (mmap(NULL, BINDER_MAP_SIZE, PROT_READ, MAP_PRIVATE, fd, 0) ==
+	    MAP_FAILED)
+		die("cannot map %s", device);
+	return fd;
+}
+
+static size_t binder_io(int fd, struct cmdbuf *w, void *rbuf, size_t rsize)
+{
+	struct binder_write_read bwr;
+	int ret;
+
+	memset(&bwr, 0, sizeof(bwr));
+	if (w) {
+		bwr.write_size = w->len;
+		bwr.write_buffer = (unsigned long)w->buf;
+		w->len = 0;
+	}
+	bwr.read_size = rsize;
+	bwr.read_buffer = (unsigned long)rbuf;
+
+	do {
+		ret = ioctl(fd, BINDER_WRITE_READ, &bwr);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0)
+		die("BINDER_WRITE_READ");
+
+	return bwr.read_consumed;
+}
+
+/*
+ * Walk the returns in @rbuf, copying the transaction data of the
+ * first one of type @want to @tr.  Returns whether there was one.
+ */
+static int find_return(const uint8_t *rbuf, size_t len, uint32_t want,
+		       struct binder_transaction_data *tr)
+{
+	const uint8_t *p = rbuf;
+	uint32_t cmd;
+	int found = 0;
+
+	while (p + sizeof(cmd) <= rbuf + len) {
+		memcpy(&cmd, p, sizeof(cmd));
+		p += sizeof(cmd);
+		if (cmd == BR_FAILED_REPLY || cmd == BR_DEAD_REPLY)
+			die("transaction failed");
+		if (cmd == want && !found) {
+			memcpy(tr, p, sizeof(*tr));
+			found = 1;
+		}
+		p += _IOC_SIZE(cmd);
+	}
+	return found;
+}
+
+static void serve(int ready)
+{
+	struct binder_transaction_data tr, reply;
+	uint8_t rbuf[512];
+	uint32_t status = 0;
+	struct cmdbuf w = { .len = 0 };
+	size_t len;
+	char ok;
+	int fd;
+
+	fd = binder_open();
+	ok = ioctl(fd, BINDER_SET_CONTEXT_MGR, 0) == 0;
+	if (write(ready, &ok, 1) != 1 || !ok)
+		exit(1);
+
+	memset(&reply, 0, sizeof(reply));
+	reply.data_size = sizeof(status);
+	reply.data.ptr.buffer = &status;
+
+	put_cmd(&w, BC_ENTER_LOOPER);
+	for (;;) {
+		len = binder_io(fd, &w, rbuf, sizeof(rbuf));
+		if (!find_return(rbuf, len, BR_TRANSACTION, &tr))
+			continue;
+		put_free(&w, tr.data.ptr.buffer);
+		put_cmd(&w, BC_REPLY);
+		put(&w, &reply, sizeof(reply));
+	}
+}
+
+static void bench(int fd, size_t size, void *payload)
+{
+	unsigned long long *lat, start, t, total = 0, p50, p99;
+	struct binder_transaction_data tr, rtr;
+	const void *last = NULL;
+	struct cmdbuf w = { .len = 0 };
+	uint8_t rbuf[512];
+	size_t len;
+	int i;
+
+	lat = malloc(iters * sizeof(*lat));
+	if (!lat)
+		die("out of memory");
+
+	memset(&tr, 0, sizeof(tr));
+	tr.target.handle = 0;
+	tr.code = 1;
+	tr.data_size = size;
+	tr.data.ptr.buffer = payload;
+
+	for (i = -WARMUP; i < iters; i++) {
+		start = now_ns();
+		if (last)
+			put_free(&w, last);
+		put_cmd(&w, BC_TRANSACTION);
+		put(&w, &tr, sizeof(tr));
+		do {
+			len = binder_io(fd, &w, rbuf, sizeof(rbuf));
+		} while (!find_return(rbuf, len, BR_REPLY, &rtr));
+		last = rtr.data.ptr.buffer;
+		t = now_ns() - start;
+		if (i >= 0) {
+			lat[i] = t;
+			total += t;
+		}
+	}
+	put_free(&w, last);
+	binder_io(fd, &w, NULL, 0);
+
+	/* sorts lat[] */
+	p50 = percentile(lat, iters, 50);
+	p99 = percentile(lat, iters, 99);
+	printf("binder size=%zu iters=%d avg_ns=%llu p50_ns=%llu p99_ns=%llu "
+	       "max_ns=%llu tps=%llu mbs=%llu\n", size, iters, total / iters,
+	       p50, p99, lat[iters - 1], iters * 1000000000ULL / total,
+	       mbs((unsigned long long)size * iters, total));
+	free(lat);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: binder_bench [-d device] [-n iterations] "
+		"[-s size,...]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	char *list, *s, ok = 0;
+	int fds[2], fd, c, status;
+	void *payload;
+	pid_t server;
+
+	while ((c = getopt(argc, argv, "d:n:s:")) != -1) {
+		switch (c) {
+		case 'd':
+			device = optarg;
+			break;
+		case 'n':
+			iters = atoi(optarg);
+			break;
+		case 's':
+			sizes = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (iters <= 0)
+		usage();
+
+	if (pipe(fds) < 0)
+		die("pipe");
+	server = fork();
+	if (server < 0)
+		die("fork");
+	if (!server) {
+		close(fds[0]);
+		serve(fds[1]);
+	}
+	close(fds[1]);
+	if (read(fds[0], &ok, 1) != 1 || !ok) {
+		waitpid(server, &status, 0);
+		errno = 0;
+		die("cannot become the binder context manager, "
+		    "is servicemanager running?");
+	}
+
+	fd = binder_open();
+	payload = calloc(1, BINDER_MAP_SIZE / 4);
+	list = strdup(sizes);
+	if (!payload || !list)
+		die("out of memory");
+
+	for (s = strtok(list, ","); s; s = strtok(NULL, ",")) {
+		size_t size = strtoul(s, NULL, 0);
+
+		/* sync transactions may take the whole map, keep it sane */
+		if (size > BINDER_MAP_SIZE / 4)
+			die("size %zu is too large", size);
+		bench(fd, size, payload);
+	}
+
+	kill(server, SIGTERM);
+	waitpid(server, &status, 0);
+	return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * mq_bench: messages per second through POSIX and SysV message queues
+ *
+ * For messages of a few sizes, a child process receives what its parent
+ * sends, first as a stream, the queue kept full, then one message at a
+ * time, each one answered on a second queue:
+ *
+ *   mq type=<posix|sysv> size=<n> msgs_per_s= rtt_ns=
+ *
+ * rtt_ns is the median round trip of the second test.  The system calls
+ * are made directly, bionic has no wrappers for either kind of queue.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/ipc.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "bench.h"
+
+#define MAX_SIZE	8192
+
+struct mq_attr_bench {
+	long mq_flags;
+	long mq_maxmsg;
+	long mq_msgsize;
+	long mq_curmsgs;
+	long __reserved[4];
+};
+
+static int iters = 100000;
+static int rtts = 10000;
+static int depth = 10;
+static const char *sizes = "16,128,1024";
+
+struct queue {
+	int sysv;
+	int fd[2];		/* parent to child, child to parent */
+	int size;
+};
+
+struct sysv_msg {
+	long mtype;
+	char mtext[MAX_SIZE];
+};
+
+static void q_open(struct queue *q)
+{
+	struct mq_attr_bench attr;
+	char name[32];
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (q->sysv) {
+			q->fd[i] = syscall(__NR_msgget, IPC_PRIVATE,
+					   IPC_CREAT | 0600);
+			if (q->fd[i] < 0)
+				die("msgget");
+			continue;
+		}
+		memset(&attr, 0, sizeof(attr));
+		attr.mq_maxmsg = depth;
+		attr.mq_msgsize = q->size;
+		snprintf(name, sizeof(name), "mq_bench.%d.%d", getpid(), i);
+		q->fd[i] = syscall(__NR_mq_open, name,
+				   O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+		if (q->fd[i] < 0)
+			die("mq_open");
+		syscall(__NR_mq_unlink, name);
+	}
+}
+
+static void q_close(struct queue *q)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (q->sysv)
+			syscall(__NR_msgctl, q->fd[i], IPC_RMID, NULL);
+		else
+			close(q->fd[i]);
+	}
+}
+
+static void q_send(struct queue *q, int dir, struct sysv_msg *m)
+{
+	long ret;
+
+	if (q->sysv)
+		ret = syscall(__NR_msgsnd, q->fd[dir], m, q->size, 0);
+	else
+		ret = syscall(__NR_mq_timedsend, q->fd[dir], m->mtext, q->size,
+			      0, NULL);
+	if (ret < 0)
+		die("send");
+}
+
+static void q_receive(struct queue *q, int dir, struct sysv_msg *m)
+{
+	long ret;
+
+	if (q->sysv)
+		ret = syscall(__NR_msgrcv, q->fd[dir], m, q->size, 0, 0);
+	else
+		ret = syscall(__NR_mq_timedreceive, q->fd[dir], m->mtext,
+			      q->size, NULL, NULL);
+	if (ret != q->size)
+		die("receive");
+}
+
+/* the child receives @iters messages, then answers @rtts of them */
+static void child(struct queue *q)
+{
+	struct sysv_msg m;
+	int i;
+
+	for (i = 0; i < iters; i++)
+		q_receive(q, 0, &m);
+	for (i = 0; i < rtts; i++) {
+		q_receive(q, 0, &m);
+		q_send(q, 1, &m);
+	}
+	exit(0);
+}
+
+static void bench(int sysv, int size)
+{
+	unsigned long long t, stream, *rtt;
+	struct queue q = { .sysv = sysv, .size = size };
+	struct sysv_msg m;
+	int i, status;
+	pid_t pid;
+
+	rtt = malloc(rtts * sizeof(*rtt));
+	if (!rtt)
+		die("out of memory");
+	q_open(&q);
+	m.mtype = 1;
+	memset(m.mtext, 0x5a, size);
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		die("fork");
+	if (!pid)
+		child(&q);
+
+	t = now_ns();
+	for (i = 0; i < iters; i++)
+		q_send(&q, 0, &m);
+	/* the first round trip waits for the stream to drain */
+	q_send(&q, 0, &m);
+	q_receive(&q, 1, &m);
+	stream = now_ns() - t;
+
+	for (i = 1; i < rtts; i++) {
+		t = now_ns();
+		q_send(&q, 0, &m);
+		q_receive(&q, 1, &m);
+		rtt[i - 1] = now_ns() - t;
+	}
+
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status))
+		die("receiver failed");
+	q_close(&q);
+
+	printf("mq type=%s size=%d msgs_per_s=%llu rtt_ns=%llu\n",
+	       sysv ? "sysv" : "posix", size,
+	       stream ? (iters + 1) * 1000000000ULL / stream : 0,
+	       rtts > 1 ? percentile(rtt, rtts - 1, 50) : 0);
+	free(rtt);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: mq_bench [-n messages] [-r round trips] "
+		"[-d queue depth] [-s size,...]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	char *list, *s;
+	int c, size;
+
+	while ((c = getopt(argc, argv, "n:r:d:s:")) != -1) {
+		switch (c) {
+		case 'n':
+			iters = atoi(optarg);
+			break;
+		case 'r':
+			rtts = atoi(optarg);
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 's':
+			sizes = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (iters <= 0 || rtts <= 0 || depth <= 0)
+		usage();
+
+	list = strdup(sizes);
+	if (!list)
+		die("out of memory");
+
+	for (s = strtok(list, ","); s; s = strtok(NULL, ",")) {
+		size = atoi(s);
+		if (size <= 0 || size > MAX_SIZE)
+			usage();
+		bench(0, size);
+		bench(1, size);
+	}
+	return 0;
+}
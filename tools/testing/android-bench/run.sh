@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Run the android-bench suite and print its results, one per line,
+# after a line naming the kernel.  Two runs can then be compared with
+# diff, or joined on their leading fields.
+#
+#   run.sh [-z zram device number] [-m zcomp_bench.ko] [-y yaffs dir]
+#
+# zcomp_bench.ko (CONFIG_ZRAM_BENCHMARK) logs its results instead of
+# printing them, they are picked out of the kernel log.  The -y
+# directory should be on a read-only yaffs mount.  Needs root.
+
+dir=$(dirname "$0")
+zram=
+module=
+yaffs=
+
+while getopts "z:m:y:" opt; do
+	case $opt in
+	z) zram=$OPTARG ;;
+	m) module=$OPTARG ;;
+	y) yaffs=$OPTARG ;;
+	*) echo "usage: $0 [-z zram device] [-m zcomp_bench.ko] [-y yaffs dir]" >&2
+	   exit 2 ;;
+	esac
+done
+
+echo "kernel release=$(uname -r) version=\"$(uname -v)\""
+
+"$dir/binder_bench"
+"$dir/ashmem_bench"
+"$dir/mq_bench"
+
+if [ -n "$zram" ]; then
+	"$dir/zram_bench" -d "$zram"
+fi
+
+if [ -n "$yaffs" ]; then
+	"$dir/yaffs_bench" -d "$yaffs"
+fi
+
+if [ -n "$module" ]; then
+	dmesg -c > /dev/null
+	# fails on purpose once it is done
+	insmod "$module" 2> /dev/null
+	dmesg | sed -n 's/.*zcomp_bench: \(backend=.*\)/zcomp \1/p'
+fi
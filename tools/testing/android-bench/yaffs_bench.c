@@ -0,0 +1,155 @@
+/*
+ * yaffs_bench: concurrent reads from a read-only yaffs mount
+ *
+ * Drops the page cache, then has 1, 2 and 4 threads read every regular
+ * file of a directory at once, each from a different file first, the
+ * way the apps of a phone page in /system at boot:
+ *
+ *   yaffs threads=<n> read_mbs= max_ms=
+ *
+ * read_mbs counts the bytes of all the threads, max_ms is the time of
+ * the slowest of them.  Needs root, for drop_caches.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include "bench.h"
+
+#define CHUNK		(64 * 1024)
+#define MAX_FILES	1024
+#define MAX_THREADS	4
+
+static char *files[MAX_FILES];
+static int nr_files;
+
+struct reader {
+	pthread_t thread;
+	int first;
+	unsigned long long bytes;
+	unsigned long long ns;
+};
+
+static void drop_caches(void)
+{
+	int fd;
+
+	sync();
+	fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+	if (fd < 0 || write(fd, "3", 1) != 1)
+		die("cannot drop caches");
+	close(fd);
+}
+
+static void *reader_fn(void *arg)
+{
+	struct reader *r = arg;
+	unsigned long long t = now_ns();
+	char *buf;
+	ssize_t n;
+	int i, fd;
+
+	buf = malloc(CHUNK);
+	if (!buf)
+		die("out of memory");
+
+	for (i = 0; i < nr_files; i++) {
+		const char *path = files[(r->first + i) % nr_files];
+
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			die("cannot open %s", path);
+		while ((n = read(fd, buf, CHUNK)) > 0)
+			r->bytes += n;
+		if (n < 0)
+			die("read from %s", path);
+		close(fd);
+	}
+
+	r->ns = now_ns() - t;
+	free(buf);
+	return NULL;
+}
+
+static void bench(int threads)
+{
+	struct reader r[MAX_THREADS];
+	unsigned long long bytes = 0, ns = 0;
+	int i;
+
+	drop_caches();
+
+	memset(r, 0, sizeof(r));
+	for (i = 0; i < threads; i++) {
+		r[i].first = i * nr_files / threads;
+		if (pthread_create(&r[i].thread, NULL, reader_fn, &r[i]))
+			die("cannot create thread");
+	}
+	for (i = 0; i < threads; i++) {
+		pthread_join(r[i].thread, NULL);
+		bytes += r[i].bytes;
+		if (r[i].ns > ns)
+			ns = r[i].ns;
+	}
+
+	printf("yaffs threads=%d read_mbs=%llu max_ms=%llu\n", threads,
+	       mbs(bytes, ns), ns / 1000000);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: yaffs_bench -d directory\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dir = NULL;
+	char path[512];
+	struct dirent *de;
+	struct stat st;
+	DIR *d;
+	int c, threads;
+
+	while ((c = getopt(argc, argv, "d:")) != -1) {
+		switch (c) {
+		case 'd':
+			dir = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (!dir)
+		usage();
+
+	d = opendir(dir);
+	if (!d)
+		die("cannot open %s", dir);
+	while ((de = readdir(d)) && nr_files < MAX_FILES) {
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		if (stat(path, &st) || !S_ISREG(st.st_mode))
+			continue;
+		files[nr_files] = strdup(path);
+		if (!files[nr_files++])
+			die("out of memory");
+	}
+	closedir(d);
+	if (!nr_files) {
+		errno = 0;
+		die("no files in %s", dir);
+	}
+
+	for (threads = 1; threads <= MAX_THREADS; threads *= 2)
+		bench(threads);
+	return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * zram_bench: zram device throughput by backend and page content
+ *
+ * Resets the zram device, sets each compression backend in turn,
+ * and writes then reads the whole disk with O_DIRECT, once for each of
+ * the page contents zcomp_bench uses:
+ *
+ *   zram backend=<name> content=<type> write_mbs= read_mbs= ratio_pct=
+ *
+ * ratio_pct is mem_used_total against orig_data_size.  The device is
+ * left reset.  It must not be in use: zram0 usually is the swap device
+ * of a phone, so run with -d on another one.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "bench.h"
+
+#define CHUNK		(64 * 1024)
+
+static int dev;
+static unsigned long disk_mb = 32;
+static int force;
+static long page_size;
+
+static const char * const words[] = {
+	"the", "binder", "of", "surface", "and", "to", "activity", "a",
+	"window", "in", "view", "is", "layout", "for", "service", "with",
+};
+
+static uint32_t seed;
+
+static uint32_t rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static void fill_zero(uint8_t *page)
+{
+	memset(page, 0, page_size);
+}
+
+static void fill_text(uint8_t *page)
+{
+	size_t off = 0, len;
+	const char *w;
+
+	while (off < page_size) {
+		w = words[rnd() % (sizeof(words) / sizeof(words[0]))];
+		len = strlen(w);
+		if (len > page_size - off)
+			len = page_size - off;
+		memcpy(page + off, w, len);
+		off += len;
+		if (off < page_size)
+			page[off++] = ' ';
+	}
+}
+
+static void fill_heap(uint8_t *page)
+{
+	uint32_t *p = (uint32_t *)page, r;
+	int i;
+
+	for (i = 0; i < page_size / 4; i++) {
+		r = rnd();
+		if (r & 1)
+			p[i] = 0;
+		else if (r & 2)
+			p[i] = (r >> 8) & 0xff;
+		else
+			p[i] = 0x40000000 | ((r >> 4) & 0xfffff0);
+	}
+}
+
+static void fill_random(uint8_t *page)
+{
+	uint32_t *p = (uint32_t *)page;
+	int i;
+
+	for (i = 0; i < page_size / 4; i++)
+		p[i] = rnd();
+}
+
+static const struct {
+	const char *name;
+	void (*fill)(uint8_t *page);
+} contents[] = {
+	{ "zero", fill_zero },
+	{ "text", fill_text },
+	{ "heap", fill_heap },
+	{ "random", fill_random },
+};
+
+static void sysfs_write(const char *attr, const char *val)
+{
+	char path[64];
+	int fd;
+
+	snprintf(path, sizeof(path), "/sys/block/zram%d/%s", dev, attr);
+	fd = open(path, O_WRONLY);
+	if (fd < 0 || write(fd, val, strlen(val)) != (ssize_t)strlen(val))
+		die("cannot write %s to %s", val, path);
+	close(fd);
+}
+
+static void sysfs_read(const char *attr, char *buf, size_t size)
+{
+	char path[64];
+	ssize_t n;
+	int fd;
+
+	snprintf(path, sizeof(path), "/sys/block/zram%d/%s", dev, attr);
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || (n = read(fd, buf, size - 1)) < 0)
+		die("cannot read %s", path);
+	buf[n] = '\0';
+	close(fd);
+}
+
+static unsigned long long sysfs_ull(const char *attr)
+{
+	char buf[64];
+
+	sysfs_read(attr, buf, sizeof(buf));
+	return strtoull(buf, NULL, 0);
+}
+
+static void setup(const char *backend)
+{
+	char size[32];
+
+	sysfs_write("reset", "1");
+	sysfs_write("comp_algorithm", backend);
+	snprintf(size, sizeof(size), "%lu", disk_mb << 20);
+	sysfs_write("disksize", size);
+}
+
+static void bench(const char *backend, int c, uint8_t *data)
+{
+	unsigned long long size = disk_mb << 20, off, t, wns, rns, used, orig;
+	char path[32];
+	int fd;
+
+	setup(backend);
+	snprintf(path, sizeof(path), "/dev/block/zram%d", dev);
+	fd = open(path, O_RDWR | O_DIRECT);
+	if (fd < 0) {
+		snprintf(path, sizeof(path), "/dev/zram%d", dev);
+		fd = open(path, O_RDWR | O_DIRECT);
+	}
+	if (fd < 0)
+		die("cannot open zram%d", dev);
+
+	t = now_ns();
+	for (off = 0; off < size; off += CHUNK)
+		if (pwrite(fd, data + off, CHUNK, off) != CHUNK)
+			die("write to %s", path);
+	wns = now_ns() - t;
+
+	used = sysfs_ull("mem_used_total");
+	orig = sysfs_ull("orig_data_size");
+
+	t = now_ns();
+	for (off = 0; off < size; off += CHUNK)
+		if (pread(fd, data + off, CHUNK, off) != CHUNK)
+			die("read from %s", path);
+	rns = now_ns() - t;
+	close(fd);
+
+	printf("zram backend=%s content=%s write_mbs=%llu read_mbs=%llu "
+	       "ratio_pct=%llu\n", backend, contents[c].name, mbs(size, wns),
+	       mbs(size, rns), orig ? used * 100 / orig : 0);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: zram_bench [-d device number] [-m disk MB] "
+		"[-f]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	char algs[256], *list, *name, *p;
+	unsigned long long off;
+	uint8_t *data;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "d:m:f")) != -1) {
+		switch (c) {
+		case 'd':
+			dev = atoi(optarg);
+			break;
+		case 'm':
+			disk_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			force = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (!disk_mb)
+		usage();
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (!force && sysfs_ull("initstate")) {
+		errno = 0;
+		die("zram%d is in use, -f resets it anyway", dev);
+	}
+
+	/* O_DIRECT wants aligned buffers */
+	if (posix_memalign((void **)&data, page_size, disk_mb << 20))
+		die("out of memory");
+
+	sysfs_read("comp_algorithm", algs, sizeof(algs));
+
+	for (i = 0; i < sizeof(contents) / sizeof(contents[0]); i++) {
+		/* the same data on every run, for runs to be comparable */
+		seed = 0x7a636f6d;
+		for (off = 0; off < disk_mb << 20; off += page_size)
+			contents[i].fill(data + off);
+
+		/* the list looks like "lzo [lz4] lz4hc" */
+		p = list = strdup(algs);
+		if (!list)
+			die("out of memory");
+		while ((name = strsep(&p, " []\n")))
+			if (*name)
+				bench(name, i, data);
+		free(list);
+	}
+
+	sysfs_write("reset", "1");
+	return 0;
+}
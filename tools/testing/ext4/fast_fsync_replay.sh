@@ -0,0 +1,108 @@
+#!/bin/sh
+#
+# Crash test for the ext4 fast_fsync mount option: whatever fsync()
+# returned for must come back from journal replay.
+#
+#   fast_fsync_replay.sh prepare <dev> <mnt> <state dir>
+#   (the device is reset with sysrq-b; after the reboot:)
+#   fast_fsync_replay.sh verify <dev> <mnt> <state dir>
+#
+# prepare mounts <dev> with fast_fsync and a long commit interval, so
+# that only fsync can commit, and then fsyncs, one file each:
+#  - an in-place overwrite of committed blocks (the fast path)
+#  - an append, which changes i_size and allocates
+#  - a newly created empty file
+#  - a chmod of a committed file
+#  - a link() to a committed file
+# The expected state goes to <state dir>, which must be on another
+# filesystem, and the device is reset without syncing.  verify mounts
+# <dev> again, which replays the journal, and compares.  It prints one
+# PASS or FAIL line per file, and exits 1 if any failed.
+#
+# Needs root, dd with conv=fsync, md5sum and stat -c.  Destroys nothing
+# outside <mnt>/fast_fsync_test.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+
+usage() {
+	echo "usage: $0 prepare|verify <dev> <mnt> <state dir>" >&2
+	exit 2
+}
+
+[ $# -eq 4 ] || usage
+cmd=$1
+dev=$2
+mnt=$3
+state=$4
+dir=$mnt/fast_fsync_test
+
+# print the state fsync promised for each test file
+describe() {
+	for f in overwrite append empty chmod link; do
+		if [ -e "$dir/$f" ]; then
+			echo "$f $(stat -c '%s %a %h' "$dir/$f")" \
+			     "$(md5sum < "$dir/$f" | cut -d' ' -f1)"
+		else
+			echo "$f missing"
+		fi
+	done
+}
+
+fsync_file() {
+	dd if=/dev/null of="$1" bs=1 count=0 conv=notrunc,fsync 2> /dev/null
+}
+
+case $cmd in
+prepare)
+	mount -t ext4 -o fast_fsync,commit=600 "$dev" "$mnt" || exit 1
+	rm -rf "$dir"
+	mkdir "$dir"
+	dd if=/dev/urandom of="$dir/overwrite" bs=64k count=64 2> /dev/null
+	dd if=/dev/urandom of="$dir/append" bs=64k count=4 2> /dev/null
+	dd if=/dev/urandom of="$dir/chmod" bs=4k count=1 2> /dev/null
+	dd if=/dev/urandom of="$dir/target" bs=4k count=1 2> /dev/null
+	chmod 644 "$dir/chmod"
+	# commit the starting point
+	sync
+
+	dd if=/dev/urandom of="$dir/overwrite" bs=64k seek=16 count=16 \
+	   conv=notrunc,fsync 2> /dev/null
+	dd if=/dev/urandom bs=64k count=1 2> /dev/null |
+		dd of="$dir/append" bs=64k seek=4 conv=notrunc,fsync \
+		   2> /dev/null
+	: > "$dir/empty"
+	fsync_file "$dir/empty"
+	chmod 600 "$dir/chmod"
+	fsync_file "$dir/chmod"
+	ln "$dir/target" "$dir/link"
+	fsync_file "$dir/link"
+
+	mkdir -p "$state"
+	describe > "$state/expected"
+	fsync_file "$state/expected"
+	echo "resetting, run $0 verify after the reboot"
+	echo b > /proc/sysrq-trigger
+	;;
+verify)
+	[ -f "$state/expected" ] || usage
+	mount -t ext4 "$dev" "$mnt" || exit 1
+	describe > "$state/found"
+	umount "$mnt"
+	failed=0
+	while read f expected; do
+		found=$(sed -n "s/^$f //p" "$state/found")
+		if [ "$found" = "$expected" ]; then
+			echo "PASS $f"
+		else
+			echo "FAIL $f: expected $expected, found $found"
+			failed=1
+		fi
+	done < "$state/expected"
+	exit $failed
+	;;
+*)
+	usage
+	;;
+esac